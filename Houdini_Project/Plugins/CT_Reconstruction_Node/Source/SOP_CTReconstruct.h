@@ -0,0 +1,28 @@
+#pragma once
+#include <SOP/SOP_Node.h>
+
+namespace LJX_HDK_Sample {
+/// Filtered back-projection of a parallel beam sinogram volume into a
+/// density volume, one reconstructed slice per sinogram slice
+class SOP_CTReconstruct : public SOP_Node
+{
+public:
+
+	SOP_CTReconstruct(OP_Network *net, const char *name, OP_Operator *op);
+    virtual ~SOP_CTReconstruct();
+
+    static PRM_Template myTemplateList[];
+    static OP_Node * myConstructor(OP_Network*, const char *, OP_Operator *);
+
+protected:
+    /// Method to cook geometry for the SOP
+    virtual OP_ERROR cookMySop(OP_Context &context);
+
+private:
+    int		RESOLUTION(fpreal t)	{ return evalInt("resolution", 0, t); }
+    fpreal	ANGLERANGE(fpreal t)	{ return evalFloat("anglerange", 0, t); }
+    int		FILTER(fpreal t)	{ return evalInt("filter", 0, t); }
+    fpreal	SIZE(fpreal t)		{ return evalFloat("size", 0, t); }
+    void	NAME(UT_String &str, fpreal t) { evalString(str, "name", 0, t); }
+};
+}
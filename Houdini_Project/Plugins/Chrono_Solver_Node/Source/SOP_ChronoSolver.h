@@ -0,0 +1,83 @@
+#pragma once
+#include <SOP/SOP_Node.h>
+#include <UT/UT_Matrix3.h>
+#include <UT/UT_Quaternion.h>
+#include <UT/UT_String.h>
+#include <UT/UT_Vector3.h>
+#include <memory>
+#include <vector>
+
+namespace chrono {
+class ChSystem;
+class ChBody;
+}
+
+namespace LJX_HDK_Sample {
+/// Simulates the pieces of the input geometry as Chrono rigid bodies and
+/// moves their points along. Simulated frames stay cached in memory, so
+/// scrubbing back only reads the cache and playing forward continues from
+/// the newest frame; any upstream or parameter change starts over.
+class SOP_ChronoSolver : public SOP_Node
+{
+public:
+
+	SOP_ChronoSolver(OP_Network *net, const char *name, OP_Operator *op);
+    virtual ~SOP_ChronoSolver();
+
+    static PRM_Template myTemplateList[];
+    static OP_Node * myConstructor(OP_Network*, const char *, OP_Operator *);
+
+protected:
+    /// Method to cook geometry for the SOP
+    virtual OP_ERROR cookMySop(OP_Context &context);
+
+private:
+    /// Everything the simulation is built from, evaluated at the start frame
+    struct Settings
+    {
+	UT_String piece;
+	int startFrame = 1;
+	int substeps = 10;
+	int parallel = 0;
+	int threads = 0;
+	int iterations = 50;
+	fpreal density = 1000;
+	fpreal friction = 0.6;
+	UT_Vector3D gravity;
+	bool ground = true;
+	fpreal groundHeight = 0;
+	fpreal fps = 24;
+
+	bool operator==(const Settings &other) const;
+    };
+
+    /// One body in one frame
+    struct Pose
+    {
+	UT_Vector3D position;
+	UT_QuaternionD rotation;
+    };
+
+    static int resetCache(void *data, int index, fpreal t, const PRM_Template *);
+
+    void evalSettings(Settings &settings);
+    bool buildScene(const GU_Detail *input);
+    /// Steps until frame is cached, false when the user interrupted
+    bool simulateTo(int frame);
+    void cacheFrame();
+    void writePoints(const std::vector<Pose> &poses);
+
+    std::shared_ptr<chrono::ChSystem> mySystem;
+    std::vector<std::shared_ptr<chrono::ChBody>> myBodies;
+    std::vector<UT_Vector3D> myRestCenters;
+    /// Body of each point, by point offset, -1 for the points of no body
+    std::vector<int> myPointBody;
+    /// Frames since the start frame, the system sits at the last one
+    std::vector<std::vector<Pose>> myFrames;
+
+    Settings mySettings;
+    /// The input the cache was simulated from
+    exint myInputId;
+    exint myInputMetaCount;
+};
+}
@@ -1,8 +1,6 @@
 #pragma once
 #include <SOP/SOP_Node.h>
 
-class JoyconBase;
-
 namespace LJX_HDK_Sample {
 /// Run a sin() wave through geometry by deforming points
 /// @see @ref HOM/SOP_HOMWave.C, SOP_HOMWave, SOP_CPPWave
@@ -29,8 +27,7 @@ protected:
 private:
     void	getGroups(UT_String &str) { evalString(str, "group", 0, 0); }
     fpreal	SCALE(fpreal t)		{ return evalFloat("scale", 0, t); }
-
-	JoyconBase * jc = nullptr;
+    bool	TIMEDEP()		{ return evalInt("timedep", 0, 0) != 0; }
 	
     /// This is the group of geometry to be manipulated by this SOP and cooked
     /// by the method "cookInputGroups".
@@ -0,0 +1,68 @@
+import struct
+import zlib
+from array import array
+
+node = hou.pwd()
+geo = node.geometry()
+
+__frame = hou.frame()
+# Point attributes to export, float and int attributes of any size, every attribute becomes one block
+__export_attribute = ['P', 'N', 'Cd', 'value']
+# zlib each block, worth it for caches read from disk, skip it when the file is read right away
+__compress = True
+__output = 'output_data.%04d.hgeo' % int(round(__frame))
+
+MAGIC = 0x4F454748  # 'HGEO'
+VERSION = 1
+TYPE_FLOAT = 0
+TYPE_INT = 1
+ALIGN = 16
+HEADER = struct.Struct('<IIfiii')
+BLOCK = struct.Struct('<16sBBBBIqqq')
+
+blocks = list()
+for name in __export_attribute:
+    attrib = geo.findPointAttrib(name)
+    if attrib is None:
+        continue
+    # The bulk getters hand back the packed little endian values of all points at once
+    if attrib.dataType() == hou.attribData.Float:
+        blocks.append((name, TYPE_FLOAT, attrib.size(), geo.pointFloatAttribValuesAsString(name)))
+    elif attrib.dataType() == hou.attribData.Int:
+        blocks.append((name, TYPE_INT, attrib.size(), geo.pointIntAttribValuesAsString(name)))
+
+# Triangle list in Houdini's winding, polygons are split into fans
+index = array('i')
+for prim in geo.prims():
+    points = [vtx.point().number() for vtx in prim.vertices()]
+    for i in range(1, len(points) - 1):
+        index.extend((points[0], points[i], points[i + 1]))
+blocks.append(('__index', TYPE_INT, 1, index.tostring()))
+
+
+def align(offset):
+    return (offset + ALIGN - 1) // ALIGN * ALIGN
+
+
+offset = align(HEADER.size + BLOCK.size * len(blocks))
+table = list()
+payload = list()
+for name, data_type, width, raw in blocks:
+    stored = raw
+    compression = 0
+    if __compress:
+        packed = zlib.compress(raw, 1)
+        if len(packed) < len(raw):
+            stored = packed
+            compression = 1
+    table.append(BLOCK.pack(name.encode('ascii'), data_type, width, compression, 0, 0, offset, len(stored), len(raw)))
+    payload.append((offset, stored))
+    offset = align(offset + len(stored))
+
+with open(__output, 'wb') as f:
+    f.write(HEADER.pack(MAGIC, VERSION, __frame, len(geo.points()), len(index), len(blocks)))
+    for entry in table:
+        f.write(entry)
+    for block_offset, stored in payload:
+        f.write(b'\0' * (block_offset - f.tell()))
+        f.write(stored)
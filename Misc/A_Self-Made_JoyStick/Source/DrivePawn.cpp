@@ -9,7 +9,6 @@
 #include "Engine/World.h"
 #include "Engine.h"
 #include "Runtime/Networking/Public/Interfaces/IPv4/IPv4Address.h"
-#include "Runtime/Sockets/Public/SocketSubsystem.h"
 #include "Engine/StaticMesh.h"
 
 ADrivePawn::ADrivePawn()
@@ -54,25 +53,20 @@ void ADrivePawn::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (SocketCreate())
+	FIPv4Address ip;
+	if (!FIPv4Address::Parse(JoystickAddress, ip))
 	{
-		GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Black, FString("SocketClient Created Success!"));
-	}
-	else
-	{
-		GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Black, FString("Failed to Create SocketClient"));
+		UE_LOG(LogTemp, Warning, TEXT("Joystick address %s is not an IPv4 address"), *JoystickAddress);
+		return;
 	}
+	// Connects in the background, the pawn flies on its own until the first sample arrives
+	JoystickLink = MakeUnique<FJoystickLink>(ip.Value, JoystickPort);
 }
 
-void ADrivePawn::BeginDestroy()
+void ADrivePawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Black, FString("Begin Destroy!"));
-	if (SocketClient)
-	{
-		SocketClient->Close();
-		UE_LOG(LogTemp, Warning, TEXT("SocketClient Closed!"));
-	}
-	Super::BeginDestroy();
+	JoystickLink.Reset();
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -83,24 +77,34 @@ void ADrivePawn::Tick(float DeltaTime)
 
 
 
-	SocketSend(FString("Hello!!!"));
-	SocketReceive(received, response);
-	UE_LOG(LogTemp, Warning, TEXT("***response: %s"), *response);
-	response.Split("z", &temp, &z);
-	temp.Split("x", &left, &right);
+	FJoystickSample sample;
+	if (JoystickLink && JoystickLink->GetNewest(sample))
+	{
+		JoystickLatency.bReport = bReportLatency;
+		JoystickLatency.OnConsumed(sample.ReceiveTime);
+		PredictorX.AddSample(sample.X, sample.ReceiveTime);
+		PredictorY.AddSample(sample.Y, sample.ReceiveTime);
+		x = sample.X;
+		y = sample.Y;
+		// Left button speeds up, right button back to normal
+		if (sample.Buttons & 1)
+			acce = true;
+		else if (sample.Buttons & 2)
+			acce = false;
+	}
 
-	x = FCString::Atof(*left);
-	y = FCString::Atof(*right);
-	UE_LOG(LogTemp, Warning, TEXT("***result: %f %f"), x, y);
+	if (bPredictJoystick)
+	{
+		// Where the stick will be when this frame is on screen
+		double Target = FPlatformTime::Seconds() + DeltaTime;
+		x = PredictorX.Predict(Target);
+		y = PredictorY.Predict(Target);
+	}
 
 	MoveUpInput(x);
 	RollRightInput(y);
 
 	FVector LocalMove;
-	if (z == "l")
-		acce = true;
-	else if (z == "r")
-		acce = false;
 
 	if (acce)
 		LocalMove = FVector(CurrentForwardSpeed * 5 * DeltaTime, 0.f, 0.f);
@@ -182,88 +186,3 @@ void ADrivePawn::RollRightInput(float Val)
 	// Smoothly interpolate to target yaw speed
 	CurrentRollSpeed = FMath::FInterpTo(CurrentRollSpeed, TargetRollSpeed, GetWorld()->GetDeltaSeconds(), 0.5);
 }
-
-
-bool ADrivePawn::SocketCreate()
-{
-	FIPv4Address ip = FIPv4Address::FIPv4Address(127, 0, 0, 1);
-
-	TSharedRef<FInternetAddr> addr = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
-	addr->SetIp(ip.Value);
-	addr->SetPort(4484);
-
-	SocketClient = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateSocket(NAME_Stream, TEXT("default"), false);
-
-	if (SocketClient->Connect(*addr))
-	{
-		GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Green, TEXT("Connect Succ!"));
-		UE_LOG(LogTemp, Warning, TEXT("Connect Succ!"));
-		return true;
-	}
-	else
-	{
-		GEngine->AddOnScreenDebugMessage(10, 2.0f, FColor::Green, TEXT("Connect failed!"));
-		UE_LOG(LogTemp, Warning, TEXT("Connect failed!"));
-		return false;
-	}
-}
-
-void ADrivePawn::SocketSend(FString meesage)
-{
-	TCHAR *seriallizedChar = meesage.GetCharArray().GetData();
-	int32 size = FCString::Strlen(seriallizedChar) + 1;
-	int32 sent = 0;
-
-	if (SocketClient->Send((uint8*)TCHAR_TO_UTF8(seriallizedChar), size, sent))
-	{
-		GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Green, TEXT("_____Send Succ!"));
-		UE_LOG(LogTemp, Warning, TEXT("_____Send Succ!"));
-	}
-	else
-	{
-		GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Green, TEXT("_____Send failed!"));
-		UE_LOG(LogTemp, Warning, TEXT("_____Send failed!"));
-	}
-}
-
-void ADrivePawn::SocketReceive(bool & bReceive, FString & recvMessage)
-{
-	recvMessage = "";
-	bReceive = false;
-	if (!SocketClient)
-	{
-		return;
-	}
-
-	TArray<uint8> ReceiveData;
-	uint32 size = 4;
-	uint8 element = 0;
-	while (SocketClient->HasPendingData(size))
-	{
-		ReceiveData.Init(element, FMath::Min(size, 65507u));
-
-		int32 read = 0;
-		SocketClient->Recv(ReceiveData.GetData(), ReceiveData.Num(), read);
-
-	}
-
-	if (ReceiveData.Num() <= 0)
-	{
-		return;
-	}
-	FString log = "Total Data read! num: " + FString::FromInt(ReceiveData.Num());
-
-	GEngine->AddOnScreenDebugMessage(10, 2.0f, FColor::Green, log);
-	//UE_LOG(LogTemp, Warning, TEXT("Recv log:   %s"), *log);
-
-	FString ReceivedUE4String = (ANSI_TO_TCHAR(reinterpret_cast<const char*>(ReceiveData.GetData())));
-
-	ReceivedUE4String = ReceivedUE4String.Left(ReceiveData.Num());
-	log = "Server:" + ReceivedUE4String;
-	GEngine->AddOnScreenDebugMessage(1, 2.0f, FColor::Green, log);
-	//UE_LOG(LogTemp, Warning, TEXT("*** %s"), *log);
-
-	recvMessage = ReceivedUE4String;
-
-	bReceive = true;
-}
\ No newline at end of file
@@ -4,8 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
-#include "Networking.h"
-#include "Runtime/Sockets/Public/Sockets.h"
+#include "JoystickLink.h"
+#include "InputLatency.h"
 #include "DrivePawn.generated.h"
 
 UCLASS()
@@ -21,7 +21,7 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	virtual void BeginDestroy() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	// Called every frame
@@ -82,6 +82,21 @@ private:
 	UPROPERTY(Category = Yaw, EditAnywhere)
 		float MinSpeed = 5000.0f;
 
+	/** Where the joystick's WIFI chip listens */
+	UPROPERTY(Category = Joystick, EditAnywhere)
+		FString JoystickAddress = TEXT("127.0.0.1");
+
+	UPROPERTY(Category = Joystick, EditAnywhere)
+		int32 JoystickPort = 4484;
+
+	/** Log how long samples wait between the socket and the Tick that uses them */
+	UPROPERTY(Category = Joystick, EditAnywhere)
+		bool bReportLatency = false;
+
+	/** Extrapolate the stick by one frame to hide the pipeline delay */
+	UPROPERTY(Category = Joystick, EditAnywhere)
+		bool bPredictJoystick = false;
+
 	/** Current forward speed */
 	float CurrentForwardSpeed;
 
@@ -102,15 +117,12 @@ public:
 	/** Returns Camera subobject **/
 	FORCEINLINE class UCameraComponent* GetCamera() const { return Camera; }
 
-	bool SocketCreate();
-
-	void SocketSend(FString meesage);
-
-	void SocketReceive(bool& bReceive, FString& recvMessage);
+	/** Socket I/O and decoding run on the link's thread, Tick only reads its newest sample */
+	TUniquePtr<FJoystickLink> JoystickLink;
+	bool acce = false;
 
-	FSocket *SocketClient;
-	FString response, z, temp, left, right;
-	bool received, acce=false;
+	FInputLatencyTracker JoystickLatency { TEXT("Joystick") };
+	FAxisPredictor PredictorX, PredictorY;
 
-	float x, y;
+	float x = 0.f, y = 0.f;
 };
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JoystickLink.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Runtime/Sockets/Public/Sockets.h"
+#include "Runtime/Sockets/Public/SocketSubsystem.h"
+
+FJoystickLink::FJoystickLink(uint32 InAddress, int32 InPort)
+	: Address(InAddress)
+	, Port(InPort)
+	, Samples(64)
+{
+	Thread = FRunnableThread::Create(this, TEXT("JoystickLink"), 0, TPri_AboveNormal);
+}
+
+FJoystickLink::~FJoystickLink()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+	}
+	Disconnect();
+}
+
+bool FJoystickLink::GetNewest(FJoystickSample& OutSample)
+{
+	bool bAny = false;
+	while (Samples.Dequeue(OutSample))
+	{
+		bAny = true;
+	}
+	return bAny;
+}
+
+uint32 FJoystickLink::Run()
+{
+	double NextRequest = 0.0;
+	while (!bStop)
+	{
+		if (!Socket && !Connect())
+		{
+			FPlatformProcess::Sleep(1.f);
+			continue;
+		}
+
+		double Now = FPlatformTime::Seconds();
+		if (Now >= NextRequest)
+		{
+			SendRequest();
+			NextRequest = Now + RequestInterval;
+		}
+
+		// Wakes as soon as the answer is there, or in time for the next request
+		if (Socket && Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(FMath::Max(NextRequest - Now, 0.0))))
+		{
+			ReceivePackets();
+		}
+	}
+	return 0;
+}
+
+bool FJoystickLink::Connect()
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> Addr = SocketSubsystem->CreateInternetAddr();
+	Addr->SetIp(Address);
+	Addr->SetPort(Port);
+
+	Socket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("JoystickLink"), false);
+	if (!Socket)
+	{
+		return false;
+	}
+	// Every packet is a few bytes, they shouldn't wait for each other
+	Socket->SetNoDelay(true);
+	if (!Socket->Connect(*Addr))
+	{
+		Disconnect();
+		return false;
+	}
+	UE_LOG(LogTemp, Warning, TEXT("Joystick connected"));
+	PendingBytes = 0;
+	bConnected = true;
+	return true;
+}
+
+void FJoystickLink::Disconnect()
+{
+	if (Socket)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+	bConnected = false;
+}
+
+void FJoystickLink::SendRequest()
+{
+	FJoystickRequest Request = { JoystickPacketMagic, JoystickPacketVersion, 0, RequestSequence++ };
+	int32 Sent = 0;
+	if (!Socket->Send((const uint8*)&Request, sizeof(Request), Sent))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Joystick connection lost"));
+		Disconnect();
+	}
+}
+
+void FJoystickLink::ReceivePackets()
+{
+	int32 Read = 0;
+	if (!Socket->Recv(Pending + PendingBytes, sizeof(Pending) - PendingBytes, Read) || Read <= 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Joystick connection lost"));
+		Disconnect();
+		return;
+	}
+	PendingBytes += Read;
+	double Now = FPlatformTime::Seconds();
+
+	int32 Offset = 0;
+	while (PendingBytes - Offset >= (int32)sizeof(FJoystickPacket))
+	{
+		FJoystickPacket Packet;
+		FMemory::Memcpy(&Packet, Pending + Offset, sizeof(Packet));
+		// Out of step with the stream, look for the next magic one byte further
+		if (Packet.Magic != JoystickPacketMagic || Packet.Version != JoystickPacketVersion)
+		{
+			Offset++;
+			continue;
+		}
+		Offset += sizeof(Packet);
+
+		if (LastSequence != 0 && Packet.Sequence - LastSequence > 1)
+		{
+			LostSamples += Packet.Sequence - LastSequence - 1;
+		}
+		LastSequence = Packet.Sequence;
+
+		FJoystickSample Sample;
+		Sample.Sequence = Packet.Sequence;
+		Sample.X = Packet.X / 32767.f;
+		Sample.Y = Packet.Y / 32767.f;
+		Sample.Buttons = Packet.Buttons;
+		Sample.ReceiveTime = Now;
+		if (!Samples.Enqueue(Sample))
+		{
+			LostSamples++;
+		}
+	}
+
+	PendingBytes -= Offset;
+	FMemory::Memmove(Pending, Pending + Offset, PendingBytes);
+}
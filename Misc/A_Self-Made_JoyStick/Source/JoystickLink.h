@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+
+class FSocket;
+class FRunnableThread;
+
+/**
+ * Wire format of the joystick, little endian and packed. The PC sends a request every RequestInterval, the
+ * controller answers each one with a sample. Axes are -32767..32767, bit 0 of Buttons is the left button,
+ * bit 1 the right one
+ */
+#pragma pack(push, 1)
+struct FJoystickPacket
+{
+	uint16 Magic;
+	uint8 Version;
+	uint8 Buttons;
+	uint32 Sequence;
+	int16 X;
+	int16 Y;
+};
+
+struct FJoystickRequest
+{
+	uint16 Magic;
+	uint8 Version;
+	uint8 Pad;
+	uint32 Sequence;
+};
+#pragma pack(pop)
+
+static const uint16 JoystickPacketMagic = 0x534A; // "JS"
+static const uint8 JoystickPacketVersion = 1;
+
+/** One decoded packet, ReceiveTime is when the worker read it */
+struct FJoystickSample
+{
+	uint32 Sequence = 0;
+	float X = 0.f;
+	float Y = 0.f;
+	uint8 Buttons = 0;
+	double ReceiveTime = 0.0;
+};
+
+/**
+ * Talks to the joystick on its own thread. It connects, requests and decodes; the game thread only takes the
+ * newest sample from a lock free ring and never touches the socket or a string
+ */
+class FJoystickLink : public FRunnable
+{
+public:
+	FJoystickLink(uint32 InAddress, int32 InPort);
+	~FJoystickLink();
+
+	/** Drops everything older, false when nothing new came in since the last call */
+	bool GetNewest(FJoystickSample& OutSample);
+
+	bool IsConnected() const { return bConnected; }
+
+	/** Samples the controller skipped or the ring dropped, from gaps in the sequence numbers */
+	uint32 GetLostSamples() const { return LostSamples; }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override { bStop = true; }
+
+	static constexpr float RequestInterval = 0.01f;
+
+private:
+	bool Connect();
+	void Disconnect();
+	void SendRequest();
+	void ReceivePackets();
+
+	uint32 Address;
+	int32 Port;
+	FSocket* Socket = nullptr;
+	FRunnableThread* Thread = nullptr;
+	FThreadSafeBool bStop;
+	FThreadSafeBool bConnected;
+
+	/** Worker only, bytes of a packet that arrived split across two reads */
+	uint8 Pending[256];
+	int32 PendingBytes = 0;
+	uint32 RequestSequence = 0;
+	uint32 LastSequence = 0;
+	volatile uint32 LostSamples = 0;
+
+	TCircularQueue<FJoystickSample> Samples;
+};
@@ -9,15 +9,15 @@ public class DXRenderPlugin : ModuleRules
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
 
-        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
+        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "RHI" });
 
-        PrivateDependencyModuleNames.AddRange(new string[] { "RHI", "RenderCore", "MeshDescription", "RawMesh" });
+        PrivateDependencyModuleNames.AddRange(new string[] { "RenderCore", "MeshDescription", "RawMesh", "ImageWrapper" });
 
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Include"));
         PublicLibraryPaths.Add(Path.Combine(ModuleDirectory, "Lib"));
         PublicAdditionalLibraries.Add("dxgi.lib");
         PublicAdditionalLibraries.Add("d3d11.lib");
-        PublicAdditionalLibraries.Add("d3dx11.lib");
+        PublicAdditionalLibraries.Add("d3dcompiler.lib");
         PublicAdditionalLibraries.Add("d3dx10.lib");
         PublicAdditionalLibraries.Add("Dxerr.lib");
         PublicAdditionalLibraries.Add("legacy_stdio_definitions.lib");
@@ -0,0 +1,152 @@
+#include "BatchCapture.h"
+#include "DXManager.h"
+#include "Util.h"
+#include "FrameStats.h"
+#include "Async/Async.h"
+#include "Misc/FileHelper.h"
+#include "Modules/ModuleManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+
+bool BatchCapture::Initialize(int width, int height, DXGI_FORMAT format, int framesInFlight)
+{
+	HRESULT result;
+	D3D11_TEXTURE2D_DESC textureDesc;
+	mWidth = width;
+	mHeight = height;
+	bBGRA = format == DXGI_FORMAT_B8G8R8A8_UNORM;
+
+	// Loaded here, the workers may not load modules
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+
+	INIT_MEMORY(textureDesc);
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = 0;
+	textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	textureDesc.Format = format;
+	textureDesc.Height = height;
+	textureDesc.Width = width;
+	textureDesc.MipLevels = 1;
+	textureDesc.MiscFlags = 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_STAGING;
+
+	aSlots.SetNumZeroed(FMath::Max(framesInFlight, 1));
+	for (auto& slot : aSlots) {
+		result = GetDXManagerInstance()->GetDevice()->CreateTexture2D(&textureDesc, nullptr, &slot.pStagingTexture);
+		RETURN_FALSE_IF_ERROR(result, CreateBatchStagingTexture);
+	}
+	iWrite = 0;
+	iPending = 0;
+	bInitialized = true;
+	return true;
+}
+
+void BatchCapture::Destroy()
+{
+	if (bInitialized) {
+		while (iPending > 0) {
+			Poll(true);
+		}
+	}
+	for (auto& write : aWrites) {
+		write.Wait();
+	}
+	aWrites.Empty();
+	for (auto& slot : aSlots) {
+		SAFE_RELEASE(slot.pStagingTexture);
+	}
+	aSlots.Empty();
+	bInitialized = false;
+}
+
+bool BatchCapture::Capture(ID3D11Texture2D* source, const FString& fileName, bool bEXR)
+{
+	if (!bInitialized || !HasFreeSlot()) {
+		return false;
+	}
+	CaptureSlot& slot = aSlots[iWrite];
+	GetDXManagerInstance()->GetContext()->CopyResource(slot.pStagingTexture, source);
+	slot.fileName = fileName;
+	slot.bEXR = bEXR;
+	iWrite = (iWrite + 1) % aSlots.Num();
+	iPending++;
+	return true;
+}
+
+void BatchCapture::Poll(bool bWait)
+{
+	auto context = GetDXManagerInstance()->GetContext();
+	int count = aSlots.Num();
+	while (iPending > 0) {
+		CaptureSlot& slot = aSlots[(iWrite - iPending + count) % count];
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		HRESULT result = context->Map(slot.pStagingTexture, 0, D3D11_MAP_READ, bWait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedResource);
+		if (result == DXGI_ERROR_WAS_STILL_DRAWING) {
+			break;
+		}
+		iPending--;
+		bWait = false;
+		if (FAILED(result)) {
+			LOG("Map Batch StagingTexture Fail");
+			continue;
+		}
+
+		int rowBytes = mWidth * 4;
+		TArray<uint8> pixels;
+		pixels.SetNumUninitialized(rowBytes * mHeight);
+		for (int row = 0; row < mHeight; row++) {
+			FMemory::Memcpy(pixels.GetData() + row * rowBytes, (uint8*)mappedResource.pData + row * mappedResource.RowPitch, rowBytes);
+		}
+		context->Unmap(slot.pStagingTexture, 0);
+		FrameStats::AddReadbackBytes(pixels.Num());
+		WriteImage(MoveTemp(pixels), slot.fileName, slot.bEXR);
+	}
+
+	// Drop the writes that are done
+	aWrites.RemoveAll([](const TFuture<void>& write) { return write.IsReady(); });
+}
+
+int BatchCapture::GetWritingCount()
+{
+	int count = 0;
+	for (auto& write : aWrites) {
+		count += write.IsReady() ? 0 : 1;
+	}
+	return count;
+}
+
+void BatchCapture::WriteImage(TArray<uint8>&& pixels, const FString& fileName, bool bEXR)
+{
+	int width = mWidth;
+	int height = mHeight;
+	bool bBGRAPixels = bBGRA;
+	aWrites.Add(Async<void>(EAsyncExecution::ThreadPool, [pixels = MoveTemp(pixels), fileName, bEXR, width, height, bBGRAPixels]() {
+		IImageWrapperModule& imageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+		TSharedPtr<IImageWrapper> imageWrapper = imageWrapperModule.CreateImageWrapper(bEXR ? EImageFormat::EXR : EImageFormat::PNG);
+		if (!imageWrapper.IsValid()) {
+			return;
+		}
+
+		bool bSet = false;
+		if (bEXR) {
+			// The render target is 8 bit, EXR gets it as 32 bit float RGBA
+			TArray<float> floatPixels;
+			floatPixels.SetNumUninitialized(pixels.Num());
+			for (int i = 0; i < pixels.Num(); i += 4) {
+				floatPixels[i + 0] = pixels[i + (bBGRAPixels ? 2 : 0)] / 255.0f;
+				floatPixels[i + 1] = pixels[i + 1] / 255.0f;
+				floatPixels[i + 2] = pixels[i + (bBGRAPixels ? 0 : 2)] / 255.0f;
+				floatPixels[i + 3] = pixels[i + 3] / 255.0f;
+			}
+			bSet = imageWrapper->SetRaw(floatPixels.GetData(), floatPixels.Num() * sizeof(float), width, height, ERGBFormat::RGBA, 32);
+		}
+		else {
+			bSet = imageWrapper->SetRaw(pixels.GetData(), pixels.Num(), width, height, bBGRAPixels ? ERGBFormat::BGRA : ERGBFormat::RGBA, 8);
+		}
+		if (!bSet || !FFileHelper::SaveArrayToFile(imageWrapper->GetCompressed(), *fileName)) {
+			UE_LOG(LogTemp, Warning, TEXT("Write Batch Image Fail %s"), *fileName);
+		}
+	}));
+}
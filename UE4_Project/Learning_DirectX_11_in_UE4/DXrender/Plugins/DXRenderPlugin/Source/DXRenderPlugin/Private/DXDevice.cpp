@@ -0,0 +1,47 @@
+#include "DXDevice.h"
+#include "Util.h"
+
+ID3D11Device* DXDevice::pDevice = 0;
+ID3D11DeviceContext* DXDevice::pDeviceContext = 0;
+int DXDevice::UserCount = 0;
+
+bool DXDevice::Acquire(ID3D11Device*& outDevice, ID3D11DeviceContext*& outContext)
+{
+	check(IsInGameThread());
+	if (!pDevice) {
+		HRESULT result;
+		D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+		result = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, 0, &featureLevel, 1, D3D11_SDK_VERSION, &pDevice, NULL, &pDeviceContext);
+		RETURN_FALSE_IF_ERROR(result, CreateDeviceAndContext);
+		LOG("DXDevice Created");
+	}
+
+	// The users hold the references, the pointers here only find the device again
+	if (UserCount > 0) {
+		pDevice->AddRef();
+		pDeviceContext->AddRef();
+	}
+	UserCount++;
+	outDevice = pDevice;
+	outContext = pDeviceContext;
+	return true;
+}
+
+void DXDevice::Release(ID3D11Device*& device, ID3D11DeviceContext*& context)
+{
+	check(IsInGameThread());
+	if (!device) {
+		return;
+	}
+	check(device == pDevice && UserCount > 0);
+
+	UserCount--;
+	if (UserCount == 0) {
+		pDeviceContext->ClearState();
+		pDevice = 0;
+		pDeviceContext = 0;
+		LOG("DXDevice Released");
+	}
+	SAFE_RELEASE(context);
+	SAFE_RELEASE(device);
+}
@@ -1,29 +1,31 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 #include "DXManager.h"
 #include "Util.h"
+#include "DXDevice.h"
 
 bool DXManager::Initialize(int width, int height)
 {
 	HRESULT result;
-	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
 
 	D3D11_TEXTURE2D_DESC depthStencilTexDesc;
 	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC depthResourceViewDesc;
 	D3D11_DEPTH_STENCIL_DESC depthStencilStateDesc;
 	D3D11_BLEND_DESC blendStateDesc;
 	D3D11_SAMPLER_DESC samplerStateDesc;
 	D3D11_RASTERIZER_DESC rasterStateDesc;
 
-	// 0.Create Device and DeviceContext
-	result = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, 0, &featureLevel, 1, D3D11_SDK_VERSION, &pDevice, NULL, &pDeviceContext);
-	RETURN_FALSE_IF_ERROR(result, CreateDeviceAndContext);
+	// 0.Get the shared Device and DeviceContext
+	if (!DXDevice::Acquire(pDevice, pDeviceContext)) {
+		return false;
+	}
 
-	// 1.Create  DepthStencilTexture
+	// 1.Create  DepthStencilTexture, typeless so the occlusion pass can read the depth
 	INIT_MEMORY(depthStencilTexDesc);
 	depthStencilTexDesc.ArraySize = 1;
-	depthStencilTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	depthStencilTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	depthStencilTexDesc.CPUAccessFlags = 0;
-	depthStencilTexDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilTexDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
 	depthStencilTexDesc.Height = height;
 	depthStencilTexDesc.Width = width;
 	depthStencilTexDesc.MipLevels = 1;
@@ -38,13 +40,22 @@ bool DXManager::Initialize(int width, int height)
 	// 2.Create DSV
 	INIT_MEMORY(depthStencilViewDesc);
 	depthStencilViewDesc.Flags = 0;
-	depthStencilViewDesc.Format = depthStencilTexDesc.Format;
+	depthStencilViewDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	depthStencilViewDesc.Texture2D.MipSlice = 0;
 	depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 
 	result = pDevice->CreateDepthStencilView(pDepthStencilTexture, &depthStencilViewDesc, &pDepthStencilView);
 	RETURN_FALSE_IF_ERROR(result, CreateDepthStencilView);
 
+	INIT_MEMORY(depthResourceViewDesc);
+	depthResourceViewDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	depthResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	depthResourceViewDesc.Texture2D.MipLevels = 1;
+	depthResourceViewDesc.Texture2D.MostDetailedMip = 0;
+
+	result = pDevice->CreateShaderResourceView(pDepthStencilTexture, &depthResourceViewDesc, &pDepthResourceView);
+	RETURN_FALSE_IF_ERROR(result, CreateDepthResourceView);
+
 	// 3.Create DepthEnable DSS
 	INIT_MEMORY(depthStencilStateDesc);
 	depthStencilStateDesc.BackFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
@@ -128,14 +139,9 @@ bool DXManager::Initialize(int width, int height)
 	//9.Config
 	pDeviceContext->RSSetState(pRasterState);
 
-	D3D11_VIEWPORT viewport;
-	viewport.Width = (float)width;
-	viewport.Height = (float)height;
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-	viewport.TopLeftX = 0.0f;
-	viewport.TopLeftY = 0.0f;
-	pDeviceContext->RSSetViewports(1, &viewport);
+	mWidth = width;
+	mHeight = height;
+	SetSceneViewport(width, height);
 
 	float blendFactor[4];
 
@@ -155,17 +161,24 @@ bool DXManager::Initialize(int width, int height)
 
  void DXManager::Destroy()
  {
-	 SAFE_RELEASE(pDevice);
-	 pDeviceContext->ClearState();
-	 SAFE_RELEASE(pDeviceContext);
+	 for (auto& context : aDeferredContexts) {
+		 SAFE_RELEASE(context);
+	 }
+	 aDeferredContexts.Empty();
+	 if (bSharedStateValid) {
+		 ReleasePipelineState(mSharedState);
+		 bSharedStateValid = false;
+	 }
 	 SAFE_RELEASE(pDepthStencilTexture);
 	 SAFE_RELEASE(pDepthStencilView);
+	 SAFE_RELEASE(pDepthResourceView);
 	 SAFE_RELEASE(pDepthEnableStencilState);
 	 SAFE_RELEASE(pDepthDisableStencilState);
 	 SAFE_RELEASE(pAlphaEnableBlendingState);
 	 SAFE_RELEASE(pAlphaDisableBlendingState);
 	 SAFE_RELEASE(pSamplerState);
 	 SAFE_RELEASE(pRasterState);
+	 DXDevice::Release(pDevice, pDeviceContext);
  }
 
  void DXManager::InitializeScene(float r=0.2f, float g=0.2f, float b=0.2f, float a=1.0f)
@@ -188,12 +201,49 @@ bool DXManager::Initialize(int width, int height)
 	 }
  }
 
+ void DXManager::BeginFrame()
+ {
+	 // Another user of the device drew since the last frame, put back what this one left bound
+	 if (bSharedStateValid && DXDevice::GetUserCount() > 1) {
+		 ApplyPipelineState(pDeviceContext, mSharedState);
+	 }
+ }
+
+ void DXManager::EndFrame()
+ {
+	 // Kept even while this is the only user, the other one may come up before the next frame
+	 if (bSharedStateValid) {
+		 ReleasePipelineState(mSharedState);
+	 }
+	 CapturePipelineState(mSharedState);
+	 bSharedStateValid = true;
+ }
+
  void DXManager::SetRenderTargetView(ID3D11RenderTargetView * target)
  {
 	 pDeviceContext->OMSetRenderTargets(1, &target, pDepthStencilView);
 	 pCurrentRTV = target;
  }
 
+ void DXManager::SetViewport(int width, int height)
+ {
+	 D3D11_VIEWPORT viewport;
+	 viewport.Width = (float)width;
+	 viewport.Height = (float)height;
+	 viewport.MinDepth = 0.0f;
+	 viewport.MaxDepth = 1.0f;
+	 viewport.TopLeftX = 0.0f;
+	 viewport.TopLeftY = 0.0f;
+	 pDeviceContext->RSSetViewports(1, &viewport);
+ }
+
+ void DXManager::SetSceneViewport(int width, int height)
+ {
+	 mSceneWidth = FMath::Clamp(width, 1, mWidth);
+	 mSceneHeight = FMath::Clamp(height, 1, mHeight);
+	 SetViewport(mSceneWidth, mSceneHeight);
+ }
+
  void DXManager::TurnOnZBuffer()
  {
 	 pDeviceContext->OMSetDepthStencilState(pDepthEnableStencilState, 1);
@@ -235,3 +285,87 @@ bool DXManager::Initialize(int width, int height)
  {
 	 return DXManagerInstance;
  }
+
+ bool DXManager::CreateDeferredContexts(int count)
+ {
+	 HRESULT result;
+	 D3D11_FEATURE_DATA_THREADING threading;
+	 INIT_MEMORY(threading);
+	 pDevice->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading));
+	 if (!threading.DriverCommandLists) {
+		 // Still works, the runtime records the lists itself
+		 LOG("Driver Command Lists Not Supported");
+	 }
+
+	 while (aDeferredContexts.Num() < count) {
+		 ID3D11DeviceContext* context = 0;
+		 result = pDevice->CreateDeferredContext(0, &context);
+		 RETURN_FALSE_IF_ERROR(result, CreateDeferredContext);
+		 aDeferredContexts.Add(context);
+	 }
+	 return true;
+ }
+
+ void DXManager::CapturePipelineState(PipelineState& state)
+ {
+	 INIT_MEMORY(state);
+	 pDeviceContext->IAGetVertexBuffers(0, 2, state.vertexBuffers, state.strides, state.offsets);
+	 pDeviceContext->IAGetIndexBuffer(&state.indexBuffer, &state.indexFormat, &state.indexOffset);
+	 pDeviceContext->IAGetInputLayout(&state.inputLayout);
+	 pDeviceContext->IAGetPrimitiveTopology(&state.topology);
+	 pDeviceContext->VSGetShader(&state.vertexShader, nullptr, nullptr);
+	 pDeviceContext->PSGetShader(&state.pixelShader, nullptr, nullptr);
+	 pDeviceContext->VSGetConstantBuffers(0, 1, &state.VSConstBuffer);
+	 pDeviceContext->PSGetConstantBuffers(0, 1, &state.PSConstBuffer);
+	 pDeviceContext->PSGetShaderResources(0, 6, state.shaderResourceViews);
+	 pDeviceContext->PSGetSamplers(0, 2, state.samplerStates);
+	 pDeviceContext->RSGetState(&state.rasterState);
+	 UINT viewportCount = 1;
+	 pDeviceContext->RSGetViewports(&viewportCount, &state.viewport);
+	 pDeviceContext->OMGetRenderTargets(1, &state.renderTargetView, &state.depthStencilView);
+	 pDeviceContext->OMGetDepthStencilState(&state.depthStencilState, &state.stencilRef);
+	 pDeviceContext->OMGetBlendState(&state.blendState, state.blendFactor, &state.sampleMask);
+ }
+
+ void DXManager::ApplyPipelineState(ID3D11DeviceContext* context, const PipelineState& state)
+ {
+	 context->IASetVertexBuffers(0, 2, state.vertexBuffers, state.strides, state.offsets);
+	 context->IASetIndexBuffer(state.indexBuffer, state.indexFormat, state.indexOffset);
+	 context->IASetInputLayout(state.inputLayout);
+	 context->IASetPrimitiveTopology(state.topology);
+	 context->VSSetShader(state.vertexShader, nullptr, 0);
+	 context->PSSetShader(state.pixelShader, nullptr, 0);
+	 context->VSSetConstantBuffers(0, 1, &state.VSConstBuffer);
+	 context->PSSetConstantBuffers(0, 1, &state.PSConstBuffer);
+	 context->PSSetShaderResources(0, 6, state.shaderResourceViews);
+	 context->PSSetSamplers(0, 2, state.samplerStates);
+	 context->RSSetState(state.rasterState);
+	 context->RSSetViewports(1, &state.viewport);
+	 context->OMSetRenderTargets(1, &state.renderTargetView, state.depthStencilView);
+	 context->OMSetDepthStencilState(state.depthStencilState, state.stencilRef);
+	 context->OMSetBlendState(state.blendState, state.blendFactor, state.sampleMask);
+ }
+
+ void DXManager::ReleasePipelineState(PipelineState& state)
+ {
+	 // The Get calls add a reference to everything they return
+	 SAFE_RELEASE(state.vertexBuffers[0]);
+	 SAFE_RELEASE(state.vertexBuffers[1]);
+	 SAFE_RELEASE(state.indexBuffer);
+	 SAFE_RELEASE(state.inputLayout);
+	 SAFE_RELEASE(state.vertexShader);
+	 SAFE_RELEASE(state.pixelShader);
+	 SAFE_RELEASE(state.VSConstBuffer);
+	 SAFE_RELEASE(state.PSConstBuffer);
+	 for (auto& view : state.shaderResourceViews) {
+		 SAFE_RELEASE(view);
+	 }
+	 for (auto& sampler : state.samplerStates) {
+		 SAFE_RELEASE(sampler);
+	 }
+	 SAFE_RELEASE(state.rasterState);
+	 SAFE_RELEASE(state.renderTargetView);
+	 SAFE_RELEASE(state.depthStencilView);
+	 SAFE_RELEASE(state.depthStencilState);
+	 SAFE_RELEASE(state.blendState);
+ }
@@ -3,8 +3,15 @@
 #include "DXManager.h"
 #include "Util.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "DynamicRHI.h"
+#include "DXRenderStats.h"
+#include "FrameStats.h"
 
-bool Displayer::Initialize(int width, int height, UTextureRenderTarget2D * inURenderTarget)
+DECLARE_CYCLE_STAT(TEXT("Readback Copy And Map"), STAT_DXRenderReadback, STATGROUP_DXRender);
+
+bool Displayer::Initialize(int width, int height, UTextureRenderTarget2D * inURenderTarget, int readbackLatency)
 {
 	if (!GetDXManagerInstance()) {
 		return false;
@@ -22,7 +29,8 @@ bool Displayer::Initialize(int width, int height, UTextureRenderTarget2D * inURe
 	textureDesc.ArraySize = 1;
 	textureDesc.BindFlags = 0;
 	textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	// Same channel order as the UE render target, RTF_RGBA8 is BGRA on D3D11
+	textureDesc.Format = inURenderTarget && inURenderTarget->GetFormat() == PF_B8G8R8A8 ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
 	textureDesc.Height = height;
 	textureDesc.Width = width;
 	textureDesc.MipLevels = 1;
@@ -30,17 +38,39 @@ bool Displayer::Initialize(int width, int height, UTextureRenderTarget2D * inURe
 	textureDesc.SampleDesc.Count = 1;
 	textureDesc.SampleDesc.Quality = 0;
 	textureDesc.Usage = D3D11_USAGE_STAGING;
+	mFormat = textureDesc.Format;
 
-	result = DXManager->GetDevice()->CreateTexture2D(&textureDesc, nullptr, &pStagingTexture);
-	RETURN_FALSE_IF_ERROR(result, CreateStagingTexture);
+	iReadbackLatency = FMath::Clamp(readbackLatency, 0, 3);
+	aStagingTextures.Init(0, iReadbackLatency + 1);
+	for (auto& stagingTexture : aStagingTextures) {
+		result = DXManager->GetDevice()->CreateTexture2D(&textureDesc, nullptr, &stagingTexture);
+		RETURN_FALSE_IF_ERROR(result, CreateStagingTexture);
+	}
+	iStagingWrite = 0;
+	iStagingPending = 0;
 
 	// 1.Create RenderTarget Texture
+	bool bUERHIIsD3D11 = inURenderTarget && GDynamicRHI && FCString::Strcmp(GDynamicRHI->GetName(), TEXT("D3D11")) == 0;
 	textureDesc.CPUAccessFlags = 0;
 	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.MiscFlags = bUERHIIsD3D11 ? D3D11_RESOURCE_MISC_SHARED : 0;
 	result = DXManager->GetDevice()->CreateTexture2D(&textureDesc, nullptr, &pRenderTargetTexture);
 	RETURN_FALSE_IF_ERROR(result, CreateRenderTargetTexture);
 
+	if (bUERHIIsD3D11) {
+		IDXGIResource* dxgiResource = 0;
+		result = pRenderTargetTexture->QueryInterface(__uuidof(IDXGIResource), (void**)&dxgiResource);
+		if (!FAILED(result)) {
+			result = dxgiResource->GetSharedHandle(&hSharedHandle);
+			SAFE_RELEASE(dxgiResource);
+		}
+		bUseSharedTexture = !FAILED(result) && hSharedHandle;
+		if (!bUseSharedTexture) {
+			LOG("Share RenderTarget Texture Fail, using readback");
+		}
+	}
+
 	// 2.Create RenderTargetView
 	INIT_MEMORY(renderTargetViewDesc);
 	renderTargetViewDesc.Format = textureDesc.Format;
@@ -52,9 +82,20 @@ bool Displayer::Initialize(int width, int height, UTextureRenderTarget2D * inURe
 
 	pUERenderTarget = inURenderTarget;
 	if (!inURenderTarget) {
-		return false;
+		LOG("Displayer Initialize Headless");
+		return true;
+	}
+	iRowBytes = width * 4;
+	iPixelBytes = width * height * 4;
+	// One slot being filled, one queued and one being uploaded
+	aUploadSlots.Reset();
+	for (int i = 0; i < 3; i++) {
+		auto slot = MakeUnique<FDisplayerUploadSlot>();
+		slot->Region = FUpdateTextureRegion2D(0, 0, 0, 0, width, height);
+		slot->PixelData.Init(0, iPixelBytes);
+		freeUploadSlots.Push(slot.Get());
+		aUploadSlots.Add(MoveTemp(slot));
 	}
-	aPixelData.Init(0, width * height * 4);
 	bInitialized = true;
 	LOG("Displayer Initialize Success");
 	return true;
@@ -62,7 +103,27 @@ bool Displayer::Initialize(int width, int height, UTextureRenderTarget2D * inURe
 
 void Displayer::Destroy()
 {
-	SAFE_RELEASE(pStagingTexture);
+	// Pending copies still use the shared texture
+	FlushRenderingCommands();
+	ID3D11Texture2D* sharedTexture = pUESharedTexture;
+	pUESharedTexture = 0;
+	ENQUEUE_RENDER_COMMAND(ReleaseSharedTexture)(
+		[sharedTexture](FRHICommandListImmediate& RHICmdList)
+	{
+		if (sharedTexture) {
+			sharedTexture->Release();
+		}
+	});
+
+	for (auto& stagingTexture : aStagingTextures) {
+		SAFE_RELEASE(stagingTexture);
+	}
+	aStagingTextures.Reset();
+
+	// The flush above returned every slot
+	while (freeUploadSlots.Pop()) {
+	}
+	aUploadSlots.Reset();
 	SAFE_RELEASE(pRenderTargetTexture);
 	SAFE_RELEASE(pRenderTargetView);
 }
@@ -70,55 +131,138 @@ void Displayer::Destroy()
 void Displayer::Display()
 {
 	if (bInitialized) {
-		if (CopyDXResource()) {
-			RenderTexture();
+		if (bUseSharedTexture) {
+			CopySharedTexture();
+		}
+		else {
+			// Without a free slot the render thread is behind, the frame is read back and dropped
+			FDisplayerUploadSlot* slot = freeUploadSlots.Pop();
+			if (CopyDXResource(slot ? slot->PixelData.GetData() : nullptr) && slot) {
+				RenderTexture(slot);
+			}
+			else if (slot) {
+				freeUploadSlots.Push(slot);
+			}
 		}
 	}
 }
 
-bool Displayer::CopyDXResource()
+bool Displayer::CopyDXResource(uint8* pixelData)
 {
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	SCOPE_CYCLE_COUNTER(STAT_DXRenderReadback);
+	auto context = GetDXManagerInstance()->GetContext();
+	int count = aStagingTextures.Num();
+
+	context->CopyResource(aStagingTextures[iStagingWrite], pRenderTargetTexture);
+	iStagingWrite = (iStagingWrite + 1) % count;
+	iStagingPending++;
 
-	GetDXManagerInstance()->GetContext()->CopyResource(pStagingTexture, pRenderTargetTexture);
-	HRESULT result = GetDXManagerInstance()->GetContext()->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &mappedResource);
+	// Copies finish in order, so the last one mapped is the newest frame available
+	bool bHasFrame = false;
+	while (iStagingPending > 0) {
+		ID3D11Texture2D* stagingTexture = aStagingTextures[(iStagingWrite - iStagingPending + count) % count];
+		// Past the latency budget the oldest copy is waited for, which also frees its slot for the next frame
+		UINT flags = iStagingPending > iReadbackLatency ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT;
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		HRESULT result = context->Map(stagingTexture, 0, D3D11_MAP_READ, flags, &mappedResource);
+		if (result == DXGI_ERROR_WAS_STILL_DRAWING) {
+			break;
+		}
+		iStagingPending--;
+		if (FAILED(result)) {
+			LOG("Map StagingTexture Fail");
+			continue;
+		}
 
-	if (!FAILED(result)) {
 		uint8* dataPtr = reinterpret_cast<uint8*>(mappedResource.pData);
-		memcpy(aPixelData.GetData(), dataPtr, aPixelData.GetAllocatedSize());
-		GetDXManagerInstance()->GetContext()->Unmap(pStagingTexture, 0);
-		return true;
+		if (pixelData && (int)mappedResource.RowPitch == iRowBytes) {
+			memcpy(pixelData, dataPtr, iPixelBytes);
+		}
+		else if (pixelData) {
+			for (int row = 0; row < iPixelBytes / iRowBytes; row++) {
+				memcpy(pixelData + row * iRowBytes, dataPtr + row * mappedResource.RowPitch, iRowBytes);
+			}
+		}
+		context->Unmap(stagingTexture, 0);
+		FrameStats::AddReadbackBytes(iPixelBytes);
+		bHasFrame = true;
 	}
-	else {
-		LOG("Map StagingTexture Fail");
-		GetDXManagerInstance()->GetContext()->Unmap(pStagingTexture, 0);
-		return false;
+	return bHasFrame;
+}
+
+void Displayer::RenderTexture(FDisplayerUploadSlot* slot)
+{
+	if (!pUERenderTarget || !pUERenderTarget->Resource) {
+		freeUploadSlots.Push(slot);
+		return;
 	}
+
+	FTextureRenderTarget2DResource* textureResource = (FTextureRenderTarget2DResource*)pUERenderTarget->Resource;
+	uint32 srcPitch = iRowBytes;
+	ENQUEUE_RENDER_COMMAND(UpdateTextureRegionsData)(
+		[this, textureResource, slot, srcPitch](FRHICommandList& RHICmdList)
+	{
+		RHIUpdateTexture2D(
+			textureResource->GetTextureRHI(),
+			0,
+			slot->Region,
+			srcPitch,
+			slot->PixelData.GetData()
+		);
+		// The upload has copied the pixels, the game thread may fill the slot again
+		freeUploadSlots.Push(slot);
+	});
 }
 
-void Displayer::RenderTexture()
+void Displayer::CopySharedTexture()
 {
-	FUpdateTextureRegion2D* region = new FUpdateTextureRegion2D(0, 0, 0, 0, pUERenderTarget->SizeX, pUERenderTarget->SizeY);
-
-	FUpdateTextureRegionsData* RegionData = new FUpdateTextureRegionsData;
-	RegionData->TextureResource = (FTextureRenderTarget2DResource*)pUERenderTarget->Resource;
-	RegionData->Regions = region;
-	RegionData->SrcPitch = pUERenderTarget->SizeX * 4 * aPixelData.GetTypeSize();
-	RegionData->SrcBpp = 4 * aPixelData.GetTypeSize();
-	RegionData->SrcData = (uint8*)aPixelData.GetData();
-
-	if (pUERenderTarget && pUERenderTarget->Resource) {
-		ENQUEUE_RENDER_COMMAND(UpdateTextureRegionsData)(
-			[RegionData](FRHICommandList& RHICmdList)
-		{
-			RHIUpdateTexture2D(
-				RegionData->TextureResource->GetTextureRHI(),
-				0,
-				*RegionData->Regions,
-				RegionData->SrcPitch,
-				RegionData->SrcData
-			);
-			delete RegionData;
-		});
+	if (!pUERenderTarget || !pUERenderTarget->Resource) {
+		return;
 	}
+
+	// Legacy shared resources have no keyed mutex, the flush makes the frame visible to UE's device
+	GetDXManagerInstance()->GetContext()->Flush();
+
+	FTextureRenderTarget2DResource* textureResource = (FTextureRenderTarget2DResource*)pUERenderTarget->Resource;
+	ENQUEUE_RENDER_COMMAND(CopySharedTexture)(
+		[this, textureResource](FRHICommandListImmediate& RHICmdList)
+	{
+		ID3D11Device* ueDevice = (ID3D11Device*)GDynamicRHI->RHIGetNativeDevice();
+		ID3D11Texture2D* ueTexture = (ID3D11Texture2D*)textureResource->GetTextureRHI()->GetNativeResource();
+		if (!ueDevice || !ueTexture) {
+			return;
+		}
+
+		if (!pUESharedTexture) {
+			HRESULT result = ueDevice->OpenSharedResource(hSharedHandle, __uuidof(ID3D11Texture2D), (void**)&pUESharedTexture);
+			D3D11_TEXTURE2D_DESC sharedDesc, ueDesc;
+			if (!FAILED(result)) {
+				pUESharedTexture->GetDesc(&sharedDesc);
+				ueTexture->GetDesc(&ueDesc);
+			}
+			// CopyResource needs the same size and format family, sRGB targets have a typeless texture
+			auto family = [](DXGI_FORMAT format) {
+				if (format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_TYPELESS) {
+					return DXGI_FORMAT_B8G8R8A8_TYPELESS;
+				}
+				if (format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_R8G8B8A8_TYPELESS) {
+					return DXGI_FORMAT_R8G8B8A8_TYPELESS;
+				}
+				return format;
+			};
+			bool bCompatible = !FAILED(result) && sharedDesc.Width == ueDesc.Width && sharedDesc.Height == ueDesc.Height
+				&& family(sharedDesc.Format) == family(ueDesc.Format);
+			if (!bCompatible) {
+				LOG("Open Shared Texture Fail, using readback");
+				SAFE_RELEASE(pUESharedTexture);
+				bUseSharedTexture = false;
+				return;
+			}
+		}
+
+		ID3D11DeviceContext* ueContext = 0;
+		ueDevice->GetImmediateContext(&ueContext);
+		ueContext->CopyResource(ueTexture, pUESharedTexture);
+		ueContext->Release();
+	});
 }
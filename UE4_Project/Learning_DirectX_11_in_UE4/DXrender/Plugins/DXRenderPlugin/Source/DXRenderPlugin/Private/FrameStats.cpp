@@ -0,0 +1,107 @@
+#include "FrameStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Util.h"
+
+bool FrameStats::bEnabled = false;
+FrameStatsRecord FrameStats::Current = {};
+TArray<FrameStatsRecord> FrameStats::aHistory;
+int FrameStats::iNext = 0;
+int FrameStats::Count = 0;
+uint64 FrameStats::FrameNumber = 0;
+
+static FAutoConsoleCommand DumpFrameStatsCommand(
+	TEXT("DXRender.DumpFrameStats"),
+	TEXT("Writes the recorded DXRender frames as CSV, by default to Saved/DXRenderFrameStats.csv"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args) {
+		FString fileName = args.Num() ? args[0] : FPaths::Combine(FPaths::ProjectSavedDir(), FString("DXRenderFrameStats.csv"));
+		if (FrameStats::DumpCSV(fileName)) {
+			LOG("Frame Stats Written To %s", *fileName);
+		}
+	}));
+
+void FrameStats::Enable(int history)
+{
+	check(IsInGameThread());
+	aHistory.SetNumZeroed(FMath::Max(history, 1));
+	iNext = 0;
+	Count = 0;
+	FMemory::Memzero(Current);
+	Current.frame = FrameNumber;
+	bEnabled = true;
+}
+
+void FrameStats::Disable()
+{
+	bEnabled = false;
+}
+
+void FrameStats::SetGPUTimes(float clearMs, float drawMs, float copyMs)
+{
+	Current.gpuClearMs = clearMs;
+	Current.gpuDrawMs = drawMs;
+	Current.gpuCopyMs = copyMs;
+}
+
+void FrameStats::EndFrame()
+{
+	FrameNumber++;
+	if (!bEnabled) {
+		return;
+	}
+
+	// The GPU times carry over, GPUProfiler doesn't have new ones every frame
+	FrameStatsRecord next = {};
+	next.frame = FrameNumber;
+	next.gpuClearMs = Current.gpuClearMs;
+	next.gpuDrawMs = Current.gpuDrawMs;
+	next.gpuCopyMs = Current.gpuCopyMs;
+	next.textureBytes = Current.textureBytes;
+
+	aHistory[iNext] = Current;
+	iNext = (iNext + 1) % aHistory.Num();
+	Count = FMath::Min(Count + 1, aHistory.Num());
+	Current = next;
+}
+
+const FrameStatsRecord* FrameStats::GetLatest()
+{
+	if (Count == 0) {
+		return nullptr;
+	}
+	return &aHistory[(iNext - 1 + aHistory.Num()) % aHistory.Num()];
+}
+
+void FrameStats::GetHistory(TArray<FrameStatsRecord>& outRecords)
+{
+	outRecords.Reset(Count);
+	for (int i = Count; i > 0; i--) {
+		outRecords.Add(aHistory[(iNext - i + aHistory.Num()) % aHistory.Num()]);
+	}
+}
+
+bool FrameStats::DumpCSV(const FString& fileName)
+{
+	TArray<FrameStatsRecord> records;
+	GetHistory(records);
+	if (records.Num() == 0) {
+		LOG("No Frame Stats Recorded");
+		return false;
+	}
+
+	FString csv = TEXT("Frame,DrawCalls,Triangles,ConstantBufferBytes,UploadBytes,ReadbackBytes,TextureBytes,")
+		TEXT("CullMs,ShadowMs,SubmitMs,DisplayMs,BatchMs,GPUClearMs,GPUDrawMs,GPUCopyMs\n");
+	for (const auto& record : records) {
+		csv += FString::Printf(TEXT("%llu,%d,%d,%d,%d,%d,%lld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"),
+			record.frame, record.drawCalls, record.triangles, record.constantBufferBytes, record.uploadBytes, record.readbackBytes,
+			record.textureBytes, record.cpuMs[FrameStatsRecord::CullStage], record.cpuMs[FrameStatsRecord::ShadowStage],
+			record.cpuMs[FrameStatsRecord::SubmitStage], record.cpuMs[FrameStatsRecord::DisplayStage], record.cpuMs[FrameStatsRecord::BatchStage],
+			record.gpuClearMs, record.gpuDrawMs, record.gpuCopyMs);
+	}
+	if (!FFileHelper::SaveStringToFile(csv, *fileName)) {
+		LOG("Can't Write Frame Stats To %s", *fileName);
+		return false;
+	}
+	return true;
+}
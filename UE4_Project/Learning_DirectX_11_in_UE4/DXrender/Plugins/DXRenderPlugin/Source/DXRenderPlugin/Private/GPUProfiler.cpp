@@ -0,0 +1,94 @@
+#include "GPUProfiler.h"
+#include "DXManager.h"
+#include "Util.h"
+
+bool GPUProfiler::Initialize()
+{
+	HRESULT result;
+	D3D11_QUERY_DESC queryDesc;
+	INIT_MEMORY(queryDesc);
+
+	for (auto& frame : aFrames) {
+		queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+		result = GetDXManagerInstance()->GetDevice()->CreateQuery(&queryDesc, &frame.pDisjoint);
+		RETURN_FALSE_IF_ERROR(result, CreateDisjointQuery);
+
+		queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+		for (auto& timestamp : frame.pTimestamps) {
+			result = GetDXManagerInstance()->GetDevice()->CreateQuery(&queryDesc, &timestamp);
+			RETURN_FALSE_IF_ERROR(result, CreateTimestampQuery);
+		}
+		frame.bIssued = false;
+	}
+
+	bInitialized = true;
+	return true;
+}
+
+void GPUProfiler::Destroy()
+{
+	for (auto& frame : aFrames) {
+		SAFE_RELEASE(frame.pDisjoint);
+		for (auto& timestamp : frame.pTimestamps) {
+			SAFE_RELEASE(timestamp);
+		}
+		frame.bIssued = false;
+	}
+	bInitialized = false;
+}
+
+void GPUProfiler::BeginFrame()
+{
+	if (!bInitialized) {
+		return;
+	}
+	FrameQueries& frame = aFrames[iFrame];
+	GetDXManagerInstance()->GetContext()->Begin(frame.pDisjoint);
+	frame.bIssued = false;
+	Mark(FrameBegin);
+}
+
+void GPUProfiler::Mark(Marker marker)
+{
+	if (bInitialized) {
+		GetDXManagerInstance()->GetContext()->End(aFrames[iFrame].pTimestamps[marker]);
+	}
+}
+
+bool GPUProfiler::EndFrame()
+{
+	if (!bInitialized) {
+		return false;
+	}
+	auto context = GetDXManagerInstance()->GetContext();
+	context->End(aFrames[iFrame].pDisjoint);
+	aFrames[iFrame].bIssued = true;
+	iFrame = (iFrame + 1) % FrameLatency;
+
+	// The slot written next holds the oldest frame, DONOTFLUSH keeps the check from submitting work
+	FrameQueries& frame = aFrames[iFrame];
+	if (!frame.bIssued) {
+		return false;
+	}
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (context->GetData(frame.pDisjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+		return false;
+	}
+	frame.bIssued = false;
+	// The clock changed during the frame, its timestamps can't be compared
+	if (disjoint.Disjoint || disjoint.Frequency == 0) {
+		return false;
+	}
+
+	UINT64 timestamps[MarkerCount];
+	for (int i = 0; i < MarkerCount; i++) {
+		if (context->GetData(frame.pTimestamps[i], &timestamps[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			return false;
+		}
+	}
+	aTimes[FrameBegin] = 0.0f;
+	for (int i = 1; i < MarkerCount; i++) {
+		aTimes[i] = (float)((double)(timestamps[i] - timestamps[i - 1]) * 1000.0 / (double)disjoint.Frequency);
+	}
+	return true;
+}
@@ -1,19 +1,119 @@
 #include "GeometryDataManager.h"
 #include "DXManager.h"
 #include "Util.h"
+#include "FrameStats.h"
 #include "Runtime/Engine/Public/StaticMeshResources.h"
 #include "Engine/Texture2D.h"
+#include "RHI.h"
+#include "Async/ParallelFor.h"
+#include "Math/Float16.h"
 
-bool GeometryDataManager::Intialize()
+// Free space kept in the buffers for meshes streamed in after Intialize
+static const uint32 InitialVertexCapacity = 1 << 16;
+static const uint32 InitialIndexCapacity = 1 << 18;
+// Texture slices kept for objects registered after Intialize
+static const int TextureSliceReserve = 8;
+
+void GeometryRangeAllocator::Reset(uint32 inCapacity)
+{
+	aFreeRanges.Reset();
+	mCapacity = 0;
+	Grow(inCapacity);
+}
+
+int32 GeometryRangeAllocator::Allocate(uint32 count)
+{
+	for (int i = 0; i < aFreeRanges.Num(); i++) {
+		FreeRange& range = aFreeRanges[i];
+		if (range.count >= count) {
+			uint32 start = range.start;
+			range.start += count;
+			range.count -= count;
+			if (range.count == 0) {
+				aFreeRanges.RemoveAt(i);
+			}
+			return start;
+		}
+	}
+	return -1;
+}
+
+void GeometryRangeAllocator::Free(uint32 start, uint32 count)
+{
+	if (count == 0) {
+		return;
+	}
+
+	int i = 0;
+	while (i < aFreeRanges.Num() && aFreeRanges[i].start < start) {
+		i++;
+	}
+	aFreeRanges.Insert(FreeRange{ start, count }, i);
+
+	if (i + 1 < aFreeRanges.Num() && aFreeRanges[i].start + aFreeRanges[i].count == aFreeRanges[i + 1].start) {
+		aFreeRanges[i].count += aFreeRanges[i + 1].count;
+		aFreeRanges.RemoveAt(i + 1);
+	}
+	if (i > 0 && aFreeRanges[i - 1].start + aFreeRanges[i - 1].count == aFreeRanges[i].start) {
+		aFreeRanges[i - 1].count += aFreeRanges[i].count;
+		aFreeRanges.RemoveAt(i);
+	}
+}
+
+void GeometryRangeAllocator::Grow(uint32 newCapacity)
 {
-	int width = mTextureWidth;
-	int height = mTextureHeight;
+	if (newCapacity <= mCapacity) {
+		return;
+	}
+	uint32 oldCapacity = mCapacity;
+	mCapacity = newCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
 
+GeometryDataManager::GeometryDataManager()
+{
+	mVertexAllocator.Reset(InitialVertexCapacity);
+	mIndexAllocator.Reset(InitialIndexCapacity);
+}
+
+static DXGI_FORMAT GetTextureFormat(EPixelFormat pixelFormat)
+{
+	// Sampled without sRGB conversion, the shader works on the stored values
+	switch (pixelFormat) {
+	case PF_DXT1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case PF_DXT5:
+		return DXGI_FORMAT_BC3_UNORM;
+	case PF_BC7:
+		return DXGI_FORMAT_BC7_UNORM;
+	case PF_B8G8R8A8:
+		return DXGI_FORMAT_B8G8R8A8_UNORM;
+	case PF_R8G8B8A8:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	default:
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+static uint32 GetMipPitch(EPixelFormat pixelFormat, int width)
+{
+	const FPixelFormatInfo& info = GPixelFormats[pixelFormat];
+	return FMath::DivideAndRoundUp(FMath::Max(width, 1), info.BlockSizeX) * info.BlockBytes;
+}
+
+static uint32 GetMipBytes(EPixelFormat pixelFormat, int width, int height)
+{
+	const FPixelFormatInfo& info = GPixelFormats[pixelFormat];
+	return GetMipPitch(pixelFormat, width) * FMath::DivideAndRoundUp(FMath::Max(height, 1), info.BlockSizeY);
+}
+
+bool GeometryDataManager::Intialize()
+{
 	auto DXManagerInstance = GetDXManagerInstance();
 	if (!DXManagerInstance) {
 		return false;
 	}
-	if (aVertexData.Num() == 0 || aIndexData.Num() == 0) {
+	if (aMetaData.Num() == 0) {
 		LOG("Geometry Data is NULL");
 		return false;
 	}
@@ -21,13 +121,12 @@ bool GeometryDataManager::Intialize()
 	HRESULT result;
 	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
 	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	D3D11_TEXTURE2D_DESC textureDesc;
-	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
-	D3D11_SUBRESOURCE_DATA * textureData;
-	textureData = new D3D11_SUBRESOURCE_DATA[aMetaData.Num()];
 
-	int mVertexCount = aVertexData.Num();
-	int mIndexCount = aIndexData.Num();
+	// The staging arrays cover the whole capacity, the free ranges are uploaded as zeros
+	int mVertexCount = mVertexAllocator.GetCapacity();
+	int mIndexCount = mIndexAllocator.GetCapacity();
+	aVertexData.SetNumZeroed(mVertexCount);
+	aIndexData.SetNumZeroed(mIndexCount);
 
 	// 0.Create and Intialize Vertex Buffer
 	INIT_MEMORY(vertexBufferDesc);
@@ -62,28 +161,92 @@ bool GeometryDataManager::Intialize()
 	RETURN_FALSE_IF_ERROR(result, CreateIndexBuffer);
 
 	// 2.Create an Intialize TextureResource
+	if (aTextureGroups.Num() == 0) {
+		// Objects without a texture still sample slice 0 of the first group
+		TextureGroup& group = aTextureGroups[aTextureGroups.AddZeroed()];
+		group.width = 1;
+		group.height = 1;
+		group.pixelFormat = PF_R8G8B8A8;
+		group.mipCount = 1;
+		group.count = 1;
+		group.aStagedMips.Add(TArray<uint8>({ 255, 255, 255, 255 }));
+	}
+	LOG("Meta Count: %d, Object Count: %d, Texture Group Count: %d", aMetaData.Num(), GetObjectCount(), aTextureGroups.Num());
+
+	for (auto& group : aTextureGroups) {
+		if (!CreateGroupTexture(group)) {
+			return false;
+		}
+	}
+
+	// 3.Config
+	BindBuffers();
+	GetDXManagerInstance()->GetContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	BindTextures();
+
+	// Later meshes go straight to the GPU
+	aVertexData.Empty();
+	aIndexData.Empty();
+
+	bInitialized = true;
+	LOG("GeometryDataManager Initialize Success");
+	return true;
+}
+
+void GeometryDataManager::Destroy()
+{
+	SAFE_RELEASE(pVertexBuffer);
+	SAFE_RELEASE(pIndexBuffer);
+	for (auto& group : aTextureGroups) {
+		SAFE_RELEASE(group.pShaderResourceView);
+		SAFE_RELEASE(group.pTexture);
+	}
+	aTextureGroups.Empty();
+	bInitialized = false;
+}
+
+void GeometryDataManager::BindBuffers()
+{
+	uint32 stride = sizeof(VertexAttribute);
+	uint32 offset = 0;
+
+	GetDXManagerInstance()->GetContext()->IASetVertexBuffers(0, 1, &pVertexBuffer, &stride, &offset);
+	GetDXManagerInstance()->GetContext()->IASetIndexBuffer(pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+}
+
+void GeometryDataManager::BindTextures()
+{
+	ID3D11ShaderResourceView* views[MaxTextureGroups] = {};
+	for (int i = 0; i < aTextureGroups.Num(); i++) {
+		views[i] = aTextureGroups[i].pShaderResourceView;
+	}
+	GetDXManagerInstance()->GetContext()->PSSetShaderResources(0, MaxTextureGroups, views);
+}
+
+bool GeometryDataManager::CreateGroupTexture(TextureGroup& group)
+{
+	HRESULT result;
+	D3D11_TEXTURE2D_DESC textureDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
+
+	// Room for the objects registered later, the spare slices stay undefined until they are written
+	group.capacity = FMath::Min(group.count + TextureSliceReserve, 0xffff);
+
 	INIT_MEMORY(textureDesc);
-	textureDesc.ArraySize = aMetaData.Num();
+	textureDesc.ArraySize = group.capacity;
 	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.Height = height;
-	textureDesc.Width = width;
-	textureDesc.MipLevels = 1;
+	textureDesc.Format = GetTextureFormat(group.pixelFormat);
+	textureDesc.Height = group.height;
+	textureDesc.Width = group.width;
+	textureDesc.MipLevels = group.mipCount;
 	textureDesc.MiscFlags = 0;
 	textureDesc.SampleDesc.Count = 1;
 	textureDesc.SampleDesc.Quality = 0;
 	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-	LOG("Meta Count: %d", aMetaData.Num());
-
-	//INIT_MEMORY(textureData);
-	for (int i = 0; i < aMetaData.Num(); i++) {
-		textureData[i].pSysMem = aTexturePixelData.GetData() + width * height * 4 * i;
-		textureData[i].SysMemPitch = width * aTexturePixelData.GetTypeSize() * 4;
-		textureData[i].SysMemSlicePitch = textureData[i].SysMemPitch * height;
-	}
 
-	result = GetDXManagerInstance()->GetDevice()->CreateTexture2D(&textureDesc, textureData, &pTextureArray);
+	result = GetDXManagerInstance()->GetDevice()->CreateTexture2D(&textureDesc, nullptr, &group.pTexture);
 	RETURN_FALSE_IF_ERROR(result, CreateTexture2DArray);
 
 	INIT_MEMORY(shaderResourceViewDesc);
@@ -91,133 +254,408 @@ bool GeometryDataManager::Intialize()
 	shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
 	shaderResourceViewDesc.Texture2DArray.ArraySize = textureDesc.ArraySize;
 	shaderResourceViewDesc.Texture2DArray.FirstArraySlice = 0;
-	shaderResourceViewDesc.Texture2DArray.MipLevels = 1;
+	shaderResourceViewDesc.Texture2DArray.MipLevels = group.mipCount;
 	shaderResourceViewDesc.Texture2DArray.MostDetailedMip = 0;
 
-	result = GetDXManagerInstance()->GetDevice()->CreateShaderResourceView(pTextureArray, &shaderResourceViewDesc, &pTextureShaderResourceView);
+	result = GetDXManagerInstance()->GetDevice()->CreateShaderResourceView(group.pTexture, &shaderResourceViewDesc, &group.pShaderResourceView);
 	RETURN_FALSE_IF_ERROR(result, CreateShaderResourceView);
 
-	// 3.Config
-	uint32 stride = sizeof(VertexAttribute);
-	uint32 offset = 0;
+	for (int i = 0; i < group.aStagedMips.Num(); i++) {
+		int slice = i / group.mipCount;
+		int mip = i % group.mipCount;
+		int mipWidth = FMath::Max(group.width >> mip, 1);
+		int mipHeight = FMath::Max(group.height >> mip, 1);
+		GetDXManagerInstance()->GetContext()->UpdateSubresource(group.pTexture, D3D11CalcSubresource(mip, slice, group.mipCount), nullptr,
+			group.aStagedMips[i].GetData(), GetMipPitch(group.pixelFormat, mipWidth), GetMipBytes(group.pixelFormat, mipWidth, mipHeight));
+	}
+	group.aStagedMips.Empty();
+	return true;
+}
 
-	GetDXManagerInstance()->GetContext()->IASetVertexBuffers(0, 1, &pVertexBuffer, &stride, &offset);
-	GetDXManagerInstance()->GetContext()->IASetIndexBuffer(pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
-	GetDXManagerInstance()->GetContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+int64 GeometryDataManager::GetTextureBytes()
+{
+	int64 bytes = 0;
+	for (const TextureGroup& group : aTextureGroups) {
+		if (!group.pTexture) {
+			continue;
+		}
+		for (int mip = 0; mip < group.mipCount; mip++) {
+			bytes += (int64)GetMipBytes(group.pixelFormat, FMath::Max(group.width >> mip, 1), FMath::Max(group.height >> mip, 1)) * group.capacity;
+		}
+	}
+	return bytes;
+}
 
-	GetDXManagerInstance()->GetContext()->PSSetShaderResources(0, 1, &pTextureShaderResourceView);
+int GeometryDataManager::FindTextureGroup(int width, int height, EPixelFormat pixelFormat, int mipCount)
+{
+	for (int i = 0; i < aTextureGroups.Num(); i++) {
+		TextureGroup& group = aTextureGroups[i];
+		if (group.width == width && group.height == height && group.pixelFormat == pixelFormat && group.mipCount == mipCount) {
+			return i;
+		}
+	}
+	if (aTextureGroups.Num() == MaxTextureGroups) {
+		return -1;
+	}
 
-	LOG("GeometryDataManager Initialize Success");
-	delete[] textureData;
-	textureData = 0;
-	return true;
+	int groupIndex = aTextureGroups.AddZeroed();
+	TextureGroup& group = aTextureGroups[groupIndex];
+	group.width = width;
+	group.height = height;
+	group.pixelFormat = pixelFormat;
+	group.mipCount = mipCount;
+	if (bInitialized) {
+		if (!CreateGroupTexture(group)) {
+			SAFE_RELEASE(group.pShaderResourceView);
+			SAFE_RELEASE(group.pTexture);
+			aTextureGroups.RemoveAt(groupIndex);
+			return -1;
+		}
+		BindTextures();
+	}
+	return groupIndex;
 }
 
-void GeometryDataManager::Destroy()
+int GeometryDataManager::AddTexture(UTexture2D * inTexture)
 {
-	SAFE_RELEASE(pVertexBuffer);
-	SAFE_RELEASE(pIndexBuffer);
-	SAFE_RELEASE(pTextureShaderResourceView);
-	SAFE_RELEASE(pTextureArray);
-}
-
-void GeometryDataManager::AddGeometryData(FStaticMeshLODResources * resource, class UTexture2D* inTexture)
-{
-#undef UpdateResource
-
-	if (inTexture) {
-		TextureCompressionSettings OldCompressionSettings = inTexture->CompressionSettings;
-		TextureMipGenSettings OldMipGenSettings = inTexture->MipGenSettings;
-		bool OldSRGB = inTexture->SRGB;
-
-		inTexture->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
-		inTexture->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
-		inTexture->SRGB = false;
-		inTexture->UpdateResource();
-
-		if (Cast<UTexture2D>(inTexture)) {
-			auto tex2D = Cast<UTexture2D>(inTexture);
-			if (auto dataPtr = tex2D->PlatformData->Mips[0].BulkData.LockReadOnly()) {
-				int sizeX = tex2D->PlatformData->Mips[0].SizeX;
-				int sizeY = tex2D->PlatformData->Mips[0].SizeY;
-
-				if (mTextureWidth == 0 && mTextureHeight == 0) {
-					mTextureWidth = sizeX;
-					mTextureHeight = sizeY;
-				}
-				else {
-					if (sizeX != mTextureWidth || sizeY != mTextureHeight) {
-						tex2D->PlatformData->Mips[0].BulkData.Unlock();
-						inTexture->CompressionSettings = OldCompressionSettings;
-						inTexture->MipGenSettings = OldMipGenSettings;
-						inTexture->SRGB = OldSRGB;
-						inTexture->UpdateResource();
-						return;
-					}
-				}
-
-				TArray<uint8> aTempPixelData;
-				aTempPixelData.Init(0, sizeX * sizeY * 4);
-				memcpy(aTempPixelData.GetData(), dataPtr, sizeX * sizeY * 4);
-				aTexturePixelData.Append(aTempPixelData);
-				tex2D->PlatformData->Mips[0].BulkData.Unlock();
-				LOG("Add Texture");
+	// The cooked platform data is used as it is, compressed and with its mips
+	FTexturePlatformData* platformData = inTexture->PlatformData;
+	if (!platformData || platformData->Mips.Num() == 0) {
+		return -1;
+	}
+
+	EPixelFormat pixelFormat = platformData->PixelFormat;
+	int width = platformData->Mips[0].SizeX;
+	int height = platformData->Mips[0].SizeY;
+	int mipCount = platformData->Mips.Num();
+	const FPixelFormatInfo& formatInfo = GPixelFormats[pixelFormat];
+	if (GetTextureFormat(pixelFormat) == DXGI_FORMAT_UNKNOWN || width % formatInfo.BlockSizeX != 0 || height % formatInfo.BlockSizeY != 0) {
+		LOG("Unsupported Texture Format");
+		return -1;
+	}
+
+	int groupIndex = FindTextureGroup(width, height, pixelFormat, mipCount);
+	if (groupIndex < 0) {
+		LOG("Texture Group Full");
+		return -1;
+	}
+	TextureGroup& group = aTextureGroups[groupIndex];
+
+	int slice = -1;
+	if (!bInitialized) {
+		slice = group.count++;
+	}
+	else if (group.aFreeSlices.Num() || group.count < group.capacity) {
+		slice = group.aFreeSlices.Num() ? group.aFreeSlices.Pop() : group.count++;
+	}
+	else {
+		LOG("Texture Array Full");
+		return -1;
+	}
+
+	// Loads the mips which are not resident, each one is freed after the copy
+	TArray<void*> aMipData;
+	aMipData.AddZeroed(mipCount);
+	inTexture->GetMipData(0, aMipData.GetData());
+
+	for (int mip = 0; mip < mipCount; mip++) {
+		int mipWidth = FMath::Max(width >> mip, 1);
+		int mipHeight = FMath::Max(height >> mip, 1);
+		uint32 mipBytes = GetMipBytes(pixelFormat, mipWidth, mipHeight);
+		if (!bInitialized) {
+			TArray<uint8>& staged = group.aStagedMips[group.aStagedMips.AddDefaulted()];
+			staged.SetNumZeroed(mipBytes);
+			if (aMipData[mip]) {
+				FMemory::Memcpy(staged.GetData(), aMipData[mip], mipBytes);
 			}
 		}
-		inTexture->CompressionSettings = OldCompressionSettings;
-		inTexture->MipGenSettings = OldMipGenSettings;
-		inTexture->SRGB = OldSRGB;
-		inTexture->UpdateResource();
+		else if (aMipData[mip]) {
+			GetDXManagerInstance()->GetContext()->UpdateSubresource(group.pTexture, D3D11CalcSubresource(mip, slice, mipCount), nullptr,
+				aMipData[mip], GetMipPitch(pixelFormat, mipWidth), mipBytes);
+			FrameStats::AddUploadBytes(mipBytes);
+		}
+		FMemory::Free(aMipData[mip]);
 	}
+	if (bInitialized) {
+		LOG("Stream Texture");
+	}
+	else {
+		LOG("Add Texture");
+	}
+	return (groupIndex << 16) | slice;
+}
+
+int GeometryDataManager::AddGeometryData(FStaticMeshRenderData * renderData, class UTexture2D* inTexture)
+{
+	if (!renderData || renderData->LODResources.Num() == 0) {
+		return -1;
+	}
+
+	int objectIndex = aFreeObjects.Num() ? aFreeObjects.Pop() : aObjectGeometry.Add(-1);
+	aObjectTextureSlice.SetNumZeroed(aObjectGeometry.Num());
+	aObjectOwnsTexture.SetNumZeroed(aObjectGeometry.Num());
+
+	// Objects without a usable texture sample the first slice
+	int slice = inTexture ? AddTexture(inTexture) : -1;
+	aObjectTextureSlice[objectIndex] = slice >= 0 ? slice : 0;
+	aObjectOwnsTexture[objectIndex] = slice >= 0;
 
+	if (int* geometryIndex = mGeometryIndices.Find(renderData)) {
+		aGeometryObjects[*geometryIndex].Add(objectIndex);
+		aObjectGeometry[objectIndex] = *geometryIndex;
+		return objectIndex;
+	}
+
+	// A coarser LOD that doesn't fit is left out, the chain ends at the last one added
+	int firstGeometry = -1;
+	int lastGeometry = -1;
+	for (int lod = 0; lod < renderData->LODResources.Num(); lod++) {
+		int geometryIndex = AddLOD(&renderData->LODResources[lod], renderData->ScreenSize[lod].Default);
+		if (geometryIndex < 0) {
+			break;
+		}
+		if (lastGeometry >= 0) {
+			aMetaData[lastGeometry].nextLOD = geometryIndex;
+		}
+		else {
+			firstGeometry = geometryIndex;
+		}
+		lastGeometry = geometryIndex;
+	}
+	if (firstGeometry < 0) {
+		RemoveObject(objectIndex);
+		return -1;
+	}
+
+	aGeometryObjects[firstGeometry].Add(objectIndex);
+	mGeometryIndices.Add(renderData, firstGeometry);
+	aObjectGeometry[objectIndex] = firstGeometry;
+	return objectIndex;
+}
+
+int GeometryDataManager::AddLOD(FStaticMeshLODResources * resource, float screenSize)
+{
 	uint32 indexCount = resource->IndexBuffer.GetNumIndices();
 	uint32 vertexCount = resource->VertexBuffers.StaticMeshVertexBuffer.GetNumVertices();
 
 	TArray<VertexAttribute> aTempVertex;
 	TArray<uint32> aTempIndex;
 
-	aTempVertex.Init(VertexAttribute(), vertexCount);
+	aTempVertex.SetNumUninitialized(vertexCount);
 	aTempIndex.Init(0, indexCount);
 
-	auto vertexData = &resource->VertexBuffers;
-	for (uint32 i = 0; i < vertexCount; i++) {
-		VertexAttribute* temp = &aTempVertex[i];
-		temp->position.x = vertexData->PositionVertexBuffer.VertexPosition(i).Y / 100.0f;
-		temp->position.y = vertexData->PositionVertexBuffer.VertexPosition(i).Z / 100.0f;
-		temp->position.z = vertexData->PositionVertexBuffer.VertexPosition(i).X / 100.0f;
-		temp->normal.x = vertexData->StaticMeshVertexBuffer.VertexTangentZ(i).Y;
-		temp->normal.y = vertexData->StaticMeshVertexBuffer.VertexTangentZ(i).Z;
-		temp->normal.z = vertexData->StaticMeshVertexBuffer.VertexTangentZ(i).X;
-		temp->binormal.x = vertexData->StaticMeshVertexBuffer.VertexTangentY(i).Y;
-		temp->binormal.y = vertexData->StaticMeshVertexBuffer.VertexTangentY(i).Z;
-		temp->binormal.z = vertexData->StaticMeshVertexBuffer.VertexTangentY(i).X;
-		temp->tanget.x = vertexData->StaticMeshVertexBuffer.VertexTangentX(i).Y;
-		temp->tanget.y = vertexData->StaticMeshVertexBuffer.VertexTangentX(i).Z;
-		temp->tanget.z = vertexData->StaticMeshVertexBuffer.VertexTangentX(i).X;
-		temp->uv.x = vertexData->StaticMeshVertexBuffer.GetVertexUV(i, 0).X;
-		temp->uv.y = vertexData->StaticMeshVertexBuffer.GetVertexUV(i, 0).Y;
-	}
-
-	uint32 lastIndex = aVertexData.Num();
+	ConvertVertices(resource->VertexBuffers, aTempVertex);
+
+	// Indices stay local to the mesh, the draw adds the base vertex
 	for (uint32 i = 0; i < indexCount; i++) {
 		if (i % 3 == 0) {
-			aTempIndex[i] = resource->IndexBuffer.GetIndex(i) + lastIndex;
+			aTempIndex[i] = resource->IndexBuffer.GetIndex(i);
 		}
 		else if (i % 3 == 1) {
-			aTempIndex[i] = resource->IndexBuffer.GetIndex(i + 1) + lastIndex;
+			aTempIndex[i] = resource->IndexBuffer.GetIndex(i + 1);
 		}
 		else {
-			aTempIndex[i] = resource->IndexBuffer.GetIndex(i - 1) + lastIndex;
+			aTempIndex[i] = resource->IndexBuffer.GetIndex(i - 1);
 		}
 	}
 
+	int32 baseVertex = mVertexAllocator.Allocate(vertexCount);
+	if (baseVertex < 0 && GrowBuffer(pVertexBuffer, mVertexAllocator, sizeof(VertexAttribute), vertexCount, D3D11_BIND_VERTEX_BUFFER)) {
+		baseVertex = mVertexAllocator.Allocate(vertexCount);
+	}
+	int32 startIndex = mIndexAllocator.Allocate(indexCount);
+	if (startIndex < 0 && GrowBuffer(pIndexBuffer, mIndexAllocator, sizeof(uint32), indexCount, D3D11_BIND_INDEX_BUFFER)) {
+		startIndex = mIndexAllocator.Allocate(indexCount);
+	}
+
 	GeometryMetaData meta = GeometryMetaData();
 	meta.length = indexCount;
-	meta.startIndex = aIndexData.Num();
-	aMetaData.Add(meta);
+	meta.startIndex = startIndex;
+	meta.baseVertex = baseVertex;
+	meta.vertexCount = vertexCount;
+	meta.nextLOD = -1;
+	meta.screenSize = screenSize;
+	// The sphere around the box of the vertices
+	D3DXVECTOR3 boundsMin(MAX_flt, MAX_flt, MAX_flt);
+	D3DXVECTOR3 boundsMax(-MAX_flt, -MAX_flt, -MAX_flt);
+	for (const VertexAttribute& vertex : aTempVertex) {
+		D3DXVec3Minimize(&boundsMin, &boundsMin, &vertex.position);
+		D3DXVec3Maximize(&boundsMax, &boundsMax, &vertex.position);
+	}
+	D3DXVECTOR3 boundsExtent = boundsMax - boundsMin;
+	meta.boundsCenter = vertexCount ? (boundsMin + boundsMax) * 0.5f : D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	meta.boundsRadius = vertexCount ? D3DXVec3Length(&boundsExtent) * 0.5f : 0.0f;
+	if (baseVertex < 0 || startIndex < 0 || !UploadGeometry(meta, aTempVertex, aTempIndex)) {
+		LOG("Add Geometry Fail");
+		if (baseVertex >= 0) {
+			mVertexAllocator.Free(baseVertex, vertexCount);
+		}
+		if (startIndex >= 0) {
+			mIndexAllocator.Free(startIndex, indexCount);
+		}
+		return -1;
+	}
+
+	int geometryIndex = aFreeGeometries.Num() ? aFreeGeometries.Pop() : aMetaData.AddDefaulted();
+	aGeometryObjects.SetNum(aMetaData.Num());
+	aMetaData[geometryIndex] = meta;
+	return geometryIndex;
+}
+
+void GeometryDataManager::RemoveObject(int objectIndex)
+{
+	if (!aObjectGeometry.IsValidIndex(objectIndex) || aFreeObjects.Contains(objectIndex)) {
+		return;
+	}
+
+	if (aObjectOwnsTexture[objectIndex]) {
+		uint32 slice = aObjectTextureSlice[objectIndex];
+		aTextureGroups[slice >> 16].aFreeSlices.Add(slice & 0xffff);
+		aObjectOwnsTexture[objectIndex] = false;
+	}
+
+	int geometryIndex = aObjectGeometry[objectIndex];
+	aObjectGeometry[objectIndex] = -1;
+	aFreeObjects.Add(objectIndex);
+	if (geometryIndex < 0) {
+		return;
+	}
+
+	aGeometryObjects[geometryIndex].Remove(objectIndex);
+	if (aGeometryObjects[geometryIndex].Num() == 0) {
+		for (auto it = mGeometryIndices.CreateIterator(); it; ++it) {
+			if (it.Value() == geometryIndex) {
+				it.RemoveCurrent();
+				break;
+			}
+		}
+		// The whole LOD chain goes, an evicted geometry draws nothing until its slot is reused
+		for (int lod = geometryIndex; lod >= 0;) {
+			GeometryMetaData& meta = aMetaData[lod];
+			int next = meta.nextLOD;
+			mVertexAllocator.Free(meta.baseVertex, meta.vertexCount);
+			mIndexAllocator.Free(meta.startIndex, meta.length);
+			meta = GeometryMetaData();
+			aFreeGeometries.Add(lod);
+			lod = next;
+		}
+	}
+}
+
+static FORCEINLINE uint32 PackUnorm1010102(float x, float y, float z, float w)
+{
+	uint32 px = FMath::Clamp(FMath::RoundToInt((x * 0.5f + 0.5f) * 1023.0f), 0, 1023);
+	uint32 py = FMath::Clamp(FMath::RoundToInt((y * 0.5f + 0.5f) * 1023.0f), 0, 1023);
+	uint32 pz = FMath::Clamp(FMath::RoundToInt((z * 0.5f + 0.5f) * 1023.0f), 0, 1023);
+	uint32 pw = w < 0.0f ? 0 : 3;
+	return px | (py << 10) | (pz << 20) | (pw << 30);
+}
 
-	aVertexData.Append(aTempVertex);
-	aIndexData.Append(aTempIndex);
+void GeometryDataManager::ConvertVertices(const FStaticMeshVertexBuffers& vertexBuffers, TArray<VertexAttribute>& vertices)
+{
+	static_assert(sizeof(VertexAttribute) == 24, "VertexAttribute has to match the input layout");
+	// Chunks of vertices in parallel, the positions are read straight from the UE buffer
+	const int32 chunkSize = 4096;
+	const int32 vertexCount = vertices.Num();
+	const FVector* positions = (const FVector*)vertexBuffers.PositionVertexBuffer.GetVertexData();
+	const FStaticMeshVertexBuffer& meshBuffer = vertexBuffers.StaticMeshVertexBuffer;
+	VertexAttribute* out = vertices.GetData();
+
+	ParallelFor(FMath::DivideAndRoundUp(vertexCount, chunkSize), [&](int32 chunk) {
+		int32 end = FMath::Min(vertexCount, (chunk + 1) * chunkSize);
+		for (int32 i = chunk * chunkSize; i < end; i++) {
+			VertexAttribute& vertex = out[i];
+			vertex.position.x = positions[i].Y / 100.0f;
+			vertex.position.y = positions[i].Z / 100.0f;
+			vertex.position.z = positions[i].X / 100.0f;
+
+			FVector normal = meshBuffer.VertexTangentZ(i);
+			FVector tangent = meshBuffer.VertexTangentX(i);
+			FVector binormal = meshBuffer.VertexTangentY(i);
+			// The axis swap is a rotation, so the handedness carries over to the DX axes
+			float sign = FVector::DotProduct(FVector::CrossProduct(normal, tangent), binormal) < 0.0f ? -1.0f : 1.0f;
+			vertex.normal = PackUnorm1010102(normal.Y, normal.Z, normal.X, 1.0f);
+			vertex.tangent = PackUnorm1010102(tangent.Y, tangent.Z, tangent.X, sign);
+
+			FVector2D uv = meshBuffer.GetVertexUV(i, 0);
+			vertex.uv[0] = FFloat16(uv.X).Encoded;
+			vertex.uv[1] = FFloat16(uv.Y).Encoded;
+		}
+	});
+}
+
+bool GeometryDataManager::UploadGeometry(const GeometryMetaData& meta, const TArray<VertexAttribute>& vertices, const TArray<uint32>& indices)
+{
+	if (!bInitialized) {
+		int vertexEnd = meta.baseVertex + vertices.Num();
+		int indexEnd = meta.startIndex + indices.Num();
+		if (aVertexData.Num() < vertexEnd) {
+			aVertexData.SetNumZeroed(vertexEnd);
+		}
+		if (aIndexData.Num() < indexEnd) {
+			aIndexData.SetNumZeroed(indexEnd);
+		}
+		FMemory::Memcpy(aVertexData.GetData() + meta.baseVertex, vertices.GetData(), vertices.Num() * sizeof(VertexAttribute));
+		FMemory::Memcpy(aIndexData.GetData() + meta.startIndex, indices.GetData(), indices.Num() * sizeof(uint32));
+		return true;
+	}
+
+	D3D11_BOX box;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+
+	box.left = meta.baseVertex * sizeof(VertexAttribute);
+	box.right = box.left + vertices.Num() * sizeof(VertexAttribute);
+	GetDXManagerInstance()->GetContext()->UpdateSubresource(pVertexBuffer, 0, &box, vertices.GetData(), 0, 0);
+
+	box.left = meta.startIndex * sizeof(uint32);
+	box.right = box.left + indices.Num() * sizeof(uint32);
+	GetDXManagerInstance()->GetContext()->UpdateSubresource(pIndexBuffer, 0, &box, indices.GetData(), 0, 0);
+	FrameStats::AddUploadBytes(vertices.Num() * sizeof(VertexAttribute) + indices.Num() * sizeof(uint32));
+	return true;
+}
+
+bool GeometryDataManager::GrowBuffer(ID3D11Buffer*& buffer, GeometryRangeAllocator& allocator, uint32 stride, uint32 required, UINT bindFlags)
+{
+	uint32 oldCapacity = allocator.GetCapacity();
+	uint32 newCapacity = FMath::Max(oldCapacity * 2, oldCapacity + required);
+	if (!bInitialized) {
+		allocator.Grow(newCapacity);
+		return true;
+	}
+
+	HRESULT result;
+	D3D11_BUFFER_DESC bufferDesc;
+	INIT_MEMORY(bufferDesc);
+	bufferDesc.BindFlags = bindFlags;
+	bufferDesc.ByteWidth = stride * newCapacity;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	ID3D11Buffer* newBuffer = 0;
+	result = GetDXManagerInstance()->GetDevice()->CreateBuffer(&bufferDesc, nullptr, &newBuffer);
+	RETURN_FALSE_IF_ERROR(result, GrowGeometryBuffer);
+
+	// The resident meshes keep their offsets, only the tail is new
+	D3D11_BOX box;
+	box.left = 0;
+	box.right = stride * oldCapacity;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	GetDXManagerInstance()->GetContext()->CopySubresourceRegion(newBuffer, 0, 0, 0, 0, buffer, 0, &box);
+
+	SAFE_RELEASE(buffer);
+	buffer = newBuffer;
+	allocator.Grow(newCapacity);
+	BindBuffers();
+	LOG("Grow Geometry Buffer: %d", newCapacity);
+	return true;
 }
 
 const GeometryMetaData* GeometryDataManager::GetMetaData(int geometryIndex)
@@ -230,3 +668,12 @@ const GeometryMetaData* GeometryDataManager::GetMetaData(int geometryIndex)
 	}
 }
 
+int GeometryDataManager::SelectLOD(int geometryIndex, float screenSize)
+{
+	// The screen sizes fall along the chain, the coarsest LOD whose threshold is still above the object wins
+	int lod = geometryIndex;
+	while (aMetaData[lod].nextLOD >= 0 && screenSize < aMetaData[aMetaData[lod].nextLOD].screenSize) {
+		lod = aMetaData[lod].nextLOD;
+	}
+	return lod;
+}
@@ -0,0 +1,367 @@
+#include "OcclusionCuller.h"
+#include "DXManager.h"
+#include "GeometryDataManager.h"
+#include "Util.h"
+#include "FrameStats.h"
+#include "Misc/Paths.h"
+
+static_assert(sizeof(OcclusionCuller::CullInstance) == 64, "CullInstance must match the structured buffer in occlusion.cs");
+static_assert(sizeof(ShaderManager::InstanceType) == 44, "InstanceType must match the stores in occlusion.cs");
+
+// IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation
+static const int DrawArgsPerBatch = 5;
+static const int HiZGroupSize = 8;
+static const int OcclusionGroupSize = 64;
+
+static bool CreateConstBuffer(uint32 size, ID3D11Buffer*& buffer)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	INIT_MEMORY(bufferDesc);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = size;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HRESULT result = GetDXManagerInstance()->GetDevice()->CreateBuffer(&bufferDesc, NULL, &buffer);
+	RETURN_FALSE_IF_ERROR(result, CreateOcclusionConstBuffer);
+	return true;
+}
+
+static bool UpdateConstBuffer(ID3D11Buffer* buffer, const void* data, uint32 size)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	auto context = GetDXManagerInstance()->GetContext();
+	HRESULT result = context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	RETURN_FALSE_IF_ERROR(result, MapOcclusionConstBuffer);
+	memcpy(mappedResource.pData, data, size);
+	context->Unmap(buffer, 0);
+	FrameStats::AddConstantBufferBytes(size);
+	return true;
+}
+
+bool OcclusionCuller::Initialize(int width, int height, ShaderManager* inShaderManager)
+{
+	HRESULT result;
+	D3D11_TEXTURE2D_DESC textureDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
+	D3D11_UNORDERED_ACCESS_VIEW_DESC unorderedAccessViewDesc;
+	mWidth = width;
+	mHeight = height;
+	pShaderManager = inShaderManager;
+
+	auto device = GetDXManagerInstance()->GetDevice();
+
+	// 0.Load the compute shaders
+	FString hizFileName = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("hiz.cs"));
+	FString occlusionFileName = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("occlusion.cs"));
+	TArray<uint8> copyBytecode, downsampleBytecode, occlusionBytecode;
+	if (!pShaderManager->LoadShaderBytecode(hizFileName, "CopyDepthShader", "cs_5_0", copyBytecode)
+		|| !pShaderManager->LoadShaderBytecode(hizFileName, "DownsampleShader", "cs_5_0", downsampleBytecode)
+		|| !pShaderManager->LoadShaderBytecode(occlusionFileName, "OcclusionShader", "cs_5_0", occlusionBytecode)) {
+		return false;
+	}
+
+	result = device->CreateComputeShader(copyBytecode.GetData(), copyBytecode.Num(), NULL, &pCopyDepthShader);
+	RETURN_FALSE_IF_ERROR(result, CreateCopyDepthShader);
+	result = device->CreateComputeShader(downsampleBytecode.GetData(), downsampleBytecode.Num(), NULL, &pDownsampleShader);
+	RETURN_FALSE_IF_ERROR(result, CreateDownsampleShader);
+	result = device->CreateComputeShader(occlusionBytecode.GetData(), occlusionBytecode.Num(), NULL, &pOcclusionShader);
+	RETURN_FALSE_IF_ERROR(result, CreateOcclusionShader);
+
+	if (!CreateConstBuffer(sizeof(HiZBufferType), pHiZConstBuffer) || !CreateConstBuffer(sizeof(OcclusionBufferType), pOcclusionConstBuffer)) {
+		return false;
+	}
+
+	// 1.Create the pyramid with the full mip chain
+	mMipCount = FMath::FloorLog2(FMath::Max(width, height)) + 1;
+
+	INIT_MEMORY(textureDesc);
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	textureDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = mMipCount;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	result = device->CreateTexture2D(&textureDesc, nullptr, &pHiZTexture);
+	RETURN_FALSE_IF_ERROR(result, CreateHiZTexture);
+
+	INIT_MEMORY(shaderResourceViewDesc);
+	shaderResourceViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
+	shaderResourceViewDesc.Texture2D.MipLevels = mMipCount;
+
+	result = device->CreateShaderResourceView(pHiZTexture, &shaderResourceViewDesc, &pHiZResourceView);
+	RETURN_FALSE_IF_ERROR(result, CreateHiZShaderResourceView);
+
+	INIT_MEMORY(unorderedAccessViewDesc);
+	unorderedAccessViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	unorderedAccessViewDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+
+	aHiZMipUAVs.Init(nullptr, mMipCount);
+	aHiZMipSRVs.Init(nullptr, mMipCount);
+	for (int mip = 0; mip < mMipCount; mip++) {
+		unorderedAccessViewDesc.Texture2D.MipSlice = mip;
+		result = device->CreateUnorderedAccessView(pHiZTexture, &unorderedAccessViewDesc, &aHiZMipUAVs[mip]);
+		RETURN_FALSE_IF_ERROR(result, CreateHiZMipUnorderedAccessView);
+
+		shaderResourceViewDesc.Texture2D.MostDetailedMip = mip;
+		shaderResourceViewDesc.Texture2D.MipLevels = 1;
+		result = device->CreateShaderResourceView(pHiZTexture, &shaderResourceViewDesc, &aHiZMipSRVs[mip]);
+		RETURN_FALSE_IF_ERROR(result, CreateHiZMipShaderResourceView);
+	}
+
+	D3DXMatrixIdentity(&mPrevViewProjection);
+	bHiZValid = false;
+	bInitialized = true;
+	LOG("OcclusionCuller Initialize Success");
+	return true;
+}
+
+void OcclusionCuller::Destroy()
+{
+	for (auto& view : aHiZMipUAVs) {
+		SAFE_RELEASE(view);
+	}
+	for (auto& view : aHiZMipSRVs) {
+		SAFE_RELEASE(view);
+	}
+	aHiZMipUAVs.Reset();
+	aHiZMipSRVs.Reset();
+	SAFE_RELEASE(pHiZResourceView);
+	SAFE_RELEASE(pHiZTexture);
+	SAFE_RELEASE(pCopyDepthShader);
+	SAFE_RELEASE(pDownsampleShader);
+	SAFE_RELEASE(pOcclusionShader);
+	SAFE_RELEASE(pHiZConstBuffer);
+	SAFE_RELEASE(pOcclusionConstBuffer);
+	SAFE_RELEASE(pInputResourceView);
+	SAFE_RELEASE(pInputBuffer);
+	SAFE_RELEASE(pInstanceUAV);
+	SAFE_RELEASE(pInstanceBuffer);
+	SAFE_RELEASE(pArgsUAV);
+	SAFE_RELEASE(pArgsBuffer);
+	mInstanceCapacity = 0;
+	mBatchCapacity = 0;
+	bInitialized = false;
+}
+
+bool OcclusionCuller::GrowBuffers(int instanceCount, int batchCount)
+{
+	HRESULT result;
+	D3D11_BUFFER_DESC bufferDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
+	D3D11_UNORDERED_ACCESS_VIEW_DESC unorderedAccessViewDesc;
+	auto device = GetDXManagerInstance()->GetDevice();
+
+	if (instanceCount > mInstanceCapacity) {
+		SAFE_RELEASE(pInputResourceView);
+		SAFE_RELEASE(pInputBuffer);
+		SAFE_RELEASE(pInstanceUAV);
+		SAFE_RELEASE(pInstanceBuffer);
+		mInstanceCapacity = 0;
+		int capacity = FMath::RoundUpToPowerOfTwo(instanceCount);
+
+		// The instances with their bounds, written by the CPU every frame
+		INIT_MEMORY(bufferDesc);
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.ByteWidth = sizeof(CullInstance) * capacity;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = sizeof(CullInstance);
+
+		result = device->CreateBuffer(&bufferDesc, NULL, &pInputBuffer);
+		RETURN_FALSE_IF_ERROR(result, CreateCullInputBuffer);
+
+		INIT_MEMORY(shaderResourceViewDesc);
+		shaderResourceViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		shaderResourceViewDesc.Buffer.FirstElement = 0;
+		shaderResourceViewDesc.Buffer.NumElements = capacity;
+
+		result = device->CreateShaderResourceView(pInputBuffer, &shaderResourceViewDesc, &pInputResourceView);
+		RETURN_FALSE_IF_ERROR(result, CreateCullInputShaderResourceView);
+
+		// The compacted instances, raw so the compute shader can write them and the input assembler read them
+		INIT_MEMORY(bufferDesc);
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.ByteWidth = sizeof(ShaderManager::InstanceType) * capacity;
+		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+		result = device->CreateBuffer(&bufferDesc, NULL, &pInstanceBuffer);
+		RETURN_FALSE_IF_ERROR(result, CreateCulledInstanceBuffer);
+
+		INIT_MEMORY(unorderedAccessViewDesc);
+		unorderedAccessViewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		unorderedAccessViewDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		unorderedAccessViewDesc.Buffer.FirstElement = 0;
+		unorderedAccessViewDesc.Buffer.NumElements = bufferDesc.ByteWidth / 4;
+		unorderedAccessViewDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+		result = device->CreateUnorderedAccessView(pInstanceBuffer, &unorderedAccessViewDesc, &pInstanceUAV);
+		RETURN_FALSE_IF_ERROR(result, CreateCulledInstanceUnorderedAccessView);
+		mInstanceCapacity = capacity;
+	}
+
+	if (batchCount > mBatchCapacity) {
+		SAFE_RELEASE(pArgsUAV);
+		SAFE_RELEASE(pArgsBuffer);
+		mBatchCapacity = 0;
+		int capacity = FMath::RoundUpToPowerOfTwo(batchCount);
+
+		INIT_MEMORY(bufferDesc);
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.ByteWidth = sizeof(uint32) * DrawArgsPerBatch * capacity;
+		bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+		result = device->CreateBuffer(&bufferDesc, NULL, &pArgsBuffer);
+		RETURN_FALSE_IF_ERROR(result, CreateDrawArgsBuffer);
+
+		INIT_MEMORY(unorderedAccessViewDesc);
+		unorderedAccessViewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		unorderedAccessViewDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		unorderedAccessViewDesc.Buffer.FirstElement = 0;
+		unorderedAccessViewDesc.Buffer.NumElements = DrawArgsPerBatch * capacity;
+		unorderedAccessViewDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+		result = device->CreateUnorderedAccessView(pArgsBuffer, &unorderedAccessViewDesc, &pArgsUAV);
+		RETURN_FALSE_IF_ERROR(result, CreateDrawArgsUnorderedAccessView);
+		mBatchCapacity = capacity;
+	}
+	return true;
+}
+
+bool OcclusionCuller::Cull(const TArray<CullInstance>& instances, const TArray<FIntVector>& batches, GeometryDataManager* geometry)
+{
+	mBatchCount = 0;
+	if (!bInitialized || instances.Num() == 0 || batches.Num() == 0) {
+		return true;
+	}
+	if (!GrowBuffers(instances.Num(), batches.Num())) {
+		return false;
+	}
+	auto context = GetDXManagerInstance()->GetContext();
+
+	// 0.The args start with no instances, the compute shader counts the visible ones in
+	aDrawArgs.SetNumUninitialized(batches.Num() * DrawArgsPerBatch);
+	for (int i = 0; i < batches.Num(); i++) {
+		auto meta = geometry->GetMetaData(batches[i].X);
+		uint32* args = &aDrawArgs[i * DrawArgsPerBatch];
+		args[0] = meta->length;
+		args[1] = 0;
+		args[2] = meta->startIndex;
+		args[3] = meta->baseVertex;
+		args[4] = batches[i].Y;
+	}
+	D3D11_BOX box = { 0, 0, 0, (UINT)(aDrawArgs.Num() * sizeof(uint32)), 1, 1 };
+	context->UpdateSubresource(pArgsBuffer, 0, &box, aDrawArgs.GetData(), 0, 0);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT result = context->Map(pInputBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	RETURN_FALSE_IF_ERROR(result, MapCullInputBuffer);
+	memcpy(mappedResource.pData, instances.GetData(), sizeof(CullInstance) * instances.Num());
+	context->Unmap(pInputBuffer, 0);
+	FrameStats::AddUploadBytes(sizeof(CullInstance) * instances.Num() + aDrawArgs.Num() * sizeof(uint32));
+
+	OcclusionBufferType occlusionBuffer;
+	D3DXMatrixTranspose(&occlusionBuffer.viewProjection, &mPrevViewProjection);
+	occlusionBuffer.hizSize[0] = (float)mWidth;
+	occlusionBuffer.hizSize[1] = (float)mHeight;
+	occlusionBuffer.mipCount = mMipCount;
+	occlusionBuffer.instanceCount = instances.Num();
+	occlusionBuffer.hizValid = bHiZValid ? 1 : 0;
+	if (!UpdateConstBuffer(pOcclusionConstBuffer, &occlusionBuffer, sizeof(occlusionBuffer))) {
+		return false;
+	}
+
+	// 1.Test and compact, last frame's compacted instances are still bound for the input assembler
+	ID3D11Buffer* nullBuffer = nullptr;
+	UINT zero = 0;
+	context->IASetVertexBuffers(1, 1, &nullBuffer, &zero, &zero);
+
+	ID3D11ShaderResourceView* views[2] = { pInputResourceView, pHiZResourceView };
+	ID3D11UnorderedAccessView* uavs[2] = { pArgsUAV, pInstanceUAV };
+	context->CSSetShader(pOcclusionShader, nullptr, 0);
+	context->CSSetConstantBuffers(0, 1, &pOcclusionConstBuffer);
+	context->CSSetShaderResources(0, 2, views);
+	context->CSSetUnorderedAccessViews(0, 2, uavs, nullptr);
+	context->Dispatch(FMath::DivideAndRoundUp(instances.Num(), OcclusionGroupSize), 1, 1);
+
+	ID3D11ShaderResourceView* nullViews[2] = {};
+	ID3D11UnorderedAccessView* nullUAVs[2] = {};
+	context->CSSetShaderResources(0, 2, nullViews);
+	context->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+	context->CSSetShader(nullptr, nullptr, 0);
+
+	mBatchCount = batches.Num();
+	return true;
+}
+
+void OcclusionCuller::RenderBatches()
+{
+	if (mBatchCount == 0) {
+		return;
+	}
+	auto context = GetDXManagerInstance()->GetContext();
+
+	// ShaderManager binds its own instance buffer again with the next UpdateInstanceData
+	uint32 stride = sizeof(ShaderManager::InstanceType);
+	uint32 offset = 0;
+	context->IASetVertexBuffers(1, 1, &pInstanceBuffer, &stride, &offset);
+	for (int i = 0; i < mBatchCount; i++) {
+		context->DrawIndexedInstancedIndirect(pArgsBuffer, i * DrawArgsPerBatch * sizeof(uint32));
+		// How many instances survived is only known on the GPU
+		FrameStats::AddDraw(0);
+	}
+}
+
+void OcclusionCuller::BuildHiZ(const D3DXMATRIX& viewProjection)
+{
+	if (!bInitialized) {
+		return;
+	}
+	auto manager = GetDXManagerInstance();
+	auto context = manager->GetContext();
+
+	// The depth buffer can't be read while it is the depth target
+	ID3D11RenderTargetView* renderTarget = manager->GetRenderTargetView();
+	context->OMSetRenderTargets(1, &renderTarget, nullptr);
+
+	context->CSSetConstantBuffers(0, 1, &pHiZConstBuffer);
+	ID3D11ShaderResourceView* nullView = nullptr;
+	ID3D11UnorderedAccessView* nullUAV = nullptr;
+
+	// With a scaled resolution only the scene viewport holds depth, mip 0 stretches it over the whole pyramid
+	uint32 inputWidth = manager->GetSceneWidth();
+	uint32 inputHeight = manager->GetSceneHeight();
+	for (int mip = 0; mip < mMipCount; mip++) {
+		uint32 outputWidth = mip == 0 ? mWidth : FMath::Max(inputWidth / 2, 1u);
+		uint32 outputHeight = mip == 0 ? mHeight : FMath::Max(inputHeight / 2, 1u);
+
+		HiZBufferType hizBuffer = { { inputWidth, inputHeight }, { outputWidth, outputHeight } };
+		UpdateConstBuffer(pHiZConstBuffer, &hizBuffer, sizeof(hizBuffer));
+
+		ID3D11ShaderResourceView* input = mip == 0 ? manager->GetDepthResourceView() : aHiZMipSRVs[mip - 1];
+		context->CSSetShader(mip == 0 ? pCopyDepthShader : pDownsampleShader, nullptr, 0);
+		context->CSSetShaderResources(0, 1, &input);
+		context->CSSetUnorderedAccessViews(0, 1, &aHiZMipUAVs[mip], nullptr);
+		context->Dispatch(FMath::DivideAndRoundUp(outputWidth, (uint32)HiZGroupSize), FMath::DivideAndRoundUp(outputHeight, (uint32)HiZGroupSize), 1);
+
+		// The next mip reads this one
+		context->CSSetShaderResources(0, 1, &nullView);
+		context->CSSetUnorderedAccessViews(0, 1, &nullUAV, nullptr);
+		inputWidth = outputWidth;
+		inputHeight = outputHeight;
+	}
+	context->CSSetShader(nullptr, nullptr, 0);
+
+	manager->SetRenderTargetView(renderTarget);
+	mPrevViewProjection = viewProjection;
+	bHiZValid = true;
+}
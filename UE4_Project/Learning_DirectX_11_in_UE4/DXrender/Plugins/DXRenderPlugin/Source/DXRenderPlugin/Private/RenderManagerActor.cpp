@@ -11,11 +11,36 @@
 #include "Displayer.h"
 #include "GeometryDataManager.h"
 #include "ShaderManager.h"
+#include "GPUProfiler.h"
+#include "ShadowManager.h"
+#include "BatchCapture.h"
+#include "OcclusionCuller.h"
+#include "ResolutionScaler.h"
+#include "FrameStats.h"
+#include "Engine/Engine.h"
+#include "HAL/PlatformTime.h"
 #include "Engine/World.h"
 #include "GameFramework/PlayerController.h"
 #include "Camera/PlayerCameraManager.h"
 #include "Engine/DirectionalLight.h"
 #include "Components/LightComponent.h"
+#include "DXRenderStats.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visible Objects"), STAT_DXRenderVisibleObjects, STATGROUP_DXRender);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Culled Objects"), STAT_DXRenderCulledObjects, STATGROUP_DXRender);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Draw Calls"), STAT_DXRenderDrawCalls, STATGROUP_DXRender);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("GPU Clear (ms)"), STAT_DXRenderGPUClear, STATGROUP_DXRender);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("GPU Draw (ms)"), STAT_DXRenderGPUDraw, STATGROUP_DXRender);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("GPU Copy (ms)"), STAT_DXRenderGPUCopy, STATGROUP_DXRender);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Resolution Scale"), STAT_DXRenderResolutionScale, STATGROUP_DXRender);
+DECLARE_CYCLE_STAT(TEXT("Tick"), STAT_DXRenderTick, STATGROUP_DXRender);
+DECLARE_CYCLE_STAT(TEXT("Cull And Sort"), STAT_DXRenderCull, STATGROUP_DXRender);
+DECLARE_CYCLE_STAT(TEXT("Submit"), STAT_DXRenderSubmit, STATGROUP_DXRender);
+DECLARE_CYCLE_STAT(TEXT("Display"), STAT_DXRenderDisplay, STATGROUP_DXRender);
+DECLARE_CYCLE_STAT(TEXT("Shadows"), STAT_DXRenderShadows, STATGROUP_DXRender);
+DECLARE_CYCLE_STAT(TEXT("Batch Render"), STAT_DXRenderBatch, STATGROUP_DXRender);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batch Frames Pending"), STAT_DXRenderBatchPending, STATGROUP_DXRender);
 
 // Sets default values
 ARenderManagerActor::ARenderManagerActor()
@@ -32,32 +57,78 @@ void ARenderManagerActor::BeginPlay()
 	FetchRenderableActor();
 	LOG("Renderable Actor Count: %d", aRenderableActor.Num());
 
-	if (pRenderTarget) {
-		int32 width = pRenderTarget->SizeX;
-		int32 height = pRenderTarget->SizeY;
+	if (pRenderTarget || bHeadless) {
+		// Headless renders only offscreen, at its own resolution
+		int32 width = bHeadless ? HeadlessResolution.X : pRenderTarget->SizeX;
+		int32 height = bHeadless ? HeadlessResolution.Y : pRenderTarget->SizeY;
+		mRenderWidth = width;
+		mRenderHeight = height;
 
 		pDXManager = new DXManager();
 		bInitialized = pDXManager->Initialize(width, height) && bInitialized;
 
 		pDisplayer = new Displayer();
-		bInitialized = pDisplayer->Initialize(width, height, pRenderTarget) && bInitialized;
+		bInitialized = pDisplayer->Initialize(width, height, bHeadless ? nullptr : pRenderTarget, ReadbackLatency) && bInitialized;
 		if (bInitialized) {
 			pDXManager->SetRenderTargetView(pDisplayer->GetRenderTargetView());
 		}
 
 		pGeoDataManager = new GeometryDataManager();
-		for (auto actor : aRenderableActor) {
-			pGeoDataManager->AddGeometryData(actor->GetGeometryData(), actor->Texture);
+		auto actors = aRenderableActor;
+		aRenderableActor.Reset();
+		for (auto actor : actors) {
+			RegisterRenderableActor(actor);
 		}
 		bInitialized = pGeoDataManager->Intialize() && bInitialized;
+		spawnHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ARenderManagerActor::OnActorSpawned));
 
 		pShaderManager = new ShaderManager();
 		FString VS = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("color.vs"));
 		FString PS = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("color.ps"));
-		bInitialized = pShaderManager->Initialize(VS, PS) && bInitialized;
+		FString shadowVS = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("shadow.vs"));
+		bInitialized = pShaderManager->Initialize(VS, PS, ShaderDefines, bCastShadows ? shadowVS : FString()) && bInitialized;
 
+		if (bCastShadows && bInitialized) {
+			pShadowManager = new ShadowManager();
+			bInitialized = pShadowManager->Initialize(ShadowMapSize) && bInitialized;
+		}
+
+		if (bOcclusionCulling && !bHeadless && bInitialized) {
+			pOcclusionCuller = new OcclusionCuller();
+			bInitialized = pOcclusionCuller->Initialize(width, height, pShaderManager) && bInitialized;
+		}
+
+		// Profiling is optional, the frame renders without it
+		if ((bProfileGPU || bDynamicResolution) && bInitialized) {
+			pGPUProfiler = new GPUProfiler();
+			if (!pGPUProfiler->Initialize()) {
+				pGPUProfiler->Destroy();
+				delete pGPUProfiler;
+				pGPUProfiler = 0;
+			}
+		}
+
+		// Scaled by the GPU timings, without them the live view stays at full size
+		if (bDynamicResolution && pGPUProfiler && !bHeadless && bInitialized) {
+			pResolutionScaler = new ResolutionScaler();
+			if (!pResolutionScaler->Initialize(width, height, pDisplayer->GetFormat(), pShaderManager)) {
+				pResolutionScaler->Destroy();
+				delete pResolutionScaler;
+				pResolutionScaler = 0;
+				LOG("Resolution Scaler Initialize Failed");
+			}
+		}
+
+
+		if (bInitialized) {
+			pDXManager->EndFrame();
+		}
+		if (bRecordFrameStats && bInitialized) {
+			FrameStats::Enable(FrameStatsHistory);
+		}
 
-		pCameraManager = GetWorld()->GetFirstPlayerController()->PlayerCameraManager;
+		auto controller = GetWorld()->GetFirstPlayerController();
+		pCameraManager = controller ? controller->PlayerCameraManager : nullptr;
 		if (pCameraManager) {
 			bCameraInitialized = true;
 		}
@@ -68,6 +139,19 @@ void ARenderManagerActor::BeginPlay()
 	}
 }
 
+void ARenderManagerActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (spawnHandle.IsValid()) {
+		GetWorld()->RemoveOnActorSpawnedHandler(spawnHandle);
+		spawnHandle.Reset();
+	}
+	if (bRecordFrameStats) {
+		FrameStats::Disable();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void ARenderManagerActor::BeginDestroy()
 {
 	Super::BeginDestroy();
@@ -84,6 +168,21 @@ void ARenderManagerActor::BeginDestroy()
 	if (pShaderManager) {
 		pShaderManager->Destroy();
 	}
+	if (pGPUProfiler) {
+		pGPUProfiler->Destroy();
+	}
+	if (pShadowManager) {
+		pShadowManager->Destroy();
+	}
+	if (pBatchCapture) {
+		pBatchCapture->Destroy();
+	}
+	if (pOcclusionCuller) {
+		pOcclusionCuller->Destroy();
+	}
+	if (pResolutionScaler) {
+		pResolutionScaler->Destroy();
+	}
 }
 
 void ARenderManagerActor::FetchRenderableActor()
@@ -95,6 +194,60 @@ void ARenderManagerActor::FetchRenderableActor()
 	}
 }
 
+bool ARenderManagerActor::RegisterRenderableActor(ARenderableActor * actor)
+{
+	if (!pGeoDataManager || !IsValid(actor) || aRenderableActor.Contains(actor)) {
+		return false;
+	}
+
+	int objectIndex = pGeoDataManager->AddGeometryData(actor->GetGeometryData(), actor->Texture);
+	if (objectIndex < 0) {
+		return false;
+	}
+	if (aRenderableActor.Num() <= objectIndex) {
+		aRenderableActor.SetNum(objectIndex + 1);
+	}
+	aRenderableActor[objectIndex] = actor;
+	return true;
+}
+
+void ARenderManagerActor::UnregisterRenderableActor(ARenderableActor * actor)
+{
+	int objectIndex = aRenderableActor.Find(actor);
+	if (objectIndex != INDEX_NONE) {
+		UnregisterObject(objectIndex);
+	}
+}
+
+void ARenderManagerActor::UnregisterObject(int objectIndex)
+{
+	pGeoDataManager->RemoveObject(objectIndex);
+	aRenderableActor[objectIndex] = nullptr;
+}
+
+void ARenderManagerActor::OnActorSpawned(AActor * actor)
+{
+	// Registered on the next tick, once whoever spawned it had the chance to set its mesh
+	if (auto renderable = Cast<ARenderableActor>(actor)) {
+		aPendingActors.Add(renderable);
+	}
+}
+
+void ARenderManagerActor::UpdateRegisteredActors()
+{
+	for (int i = 0; i < aRenderableActor.Num(); i++) {
+		// Destroyed actors are pending kill, or already nulled by the garbage collector
+		if (!IsValid(aRenderableActor[i]) && pGeoDataManager->IsObjectValid(i)) {
+			UnregisterObject(i);
+		}
+	}
+
+	for (auto actor : aPendingActors) {
+		RegisterRenderableActor(actor);
+	}
+	aPendingActors.Reset();
+}
+
 // Called every frame
 void ARenderManagerActor::Tick(float DeltaTime)
 {
@@ -104,11 +257,113 @@ void ARenderManagerActor::Tick(float DeltaTime)
 		return;
 	}
 
+	SCOPE_CYCLE_COUNTER(STAT_DXRenderTick);
+	pDXManager->BeginFrame();
+	UpdateRegisteredActors();
+
+	if (aBatchQueue.Num() || (pBatchCapture && pBatchCapture->GetPendingCount())) {
+		RenderBatchQueue();
+	}
+	if (!bHeadless && pCameraManager) {
+		RenderLiveView();
+	}
+	pDXManager->EndFrame();
+
+	if (FrameStats::IsEnabled()) {
+		FrameStats::SetTextureBytes(pGeoDataManager->GetTextureBytes());
+		FrameStats::EndFrame();
+		if (bShowFrameStats) {
+			DrawFrameStats();
+		}
+	}
+}
+
+bool ARenderManagerActor::DumpFrameStats(const FString& fileName)
+{
+	return FrameStats::DumpCSV(fileName);
+}
+
+float ARenderManagerActor::GetResolutionScale() const
+{
+	return pResolutionScaler ? pResolutionScaler->GetScale() : 1.0f;
+}
+
+void ARenderManagerActor::DrawFrameStats()
+{
+	const FrameStatsRecord* record = FrameStats::GetLatest();
+	if (!GEngine || !record) {
+		return;
+	}
+
+	// Fixed keys, so every frame replaces the lines of the last one
+	uint64 key = (uint64)GetUniqueID() << 8;
+	const float* cpuMs = record->cpuMs;
+	GEngine->AddOnScreenDebugMessage(key + 0, 0.0f, FColor::Cyan, FString::Printf(TEXT("DXRender frame %llu: %d draws, %d triangles"),
+		record->frame, record->drawCalls, record->triangles));
+	GEngine->AddOnScreenDebugMessage(key + 1, 0.0f, FColor::Cyan, FString::Printf(TEXT("Constant buffers %.1f KB, uploads %.1f KB, readback %.1f KB, textures %.1f MB"),
+		record->constantBufferBytes / 1024.0f, record->uploadBytes / 1024.0f, record->readbackBytes / 1024.0f, record->textureBytes / (1024.0f * 1024.0f)));
+	GEngine->AddOnScreenDebugMessage(key + 2, 0.0f, FColor::Cyan, FString::Printf(TEXT("CPU ms: cull %.2f, shadows %.2f, submit %.2f, display %.2f, batch %.2f"),
+		cpuMs[FrameStatsRecord::CullStage], cpuMs[FrameStatsRecord::ShadowStage], cpuMs[FrameStatsRecord::SubmitStage],
+		cpuMs[FrameStatsRecord::DisplayStage], cpuMs[FrameStatsRecord::BatchStage]));
+	GEngine->AddOnScreenDebugMessage(key + 3, 0.0f, FColor::Cyan, FString::Printf(TEXT("GPU ms: clear %.2f, draw %.2f, copy %.2f"),
+		record->gpuClearMs, record->gpuDrawMs, record->gpuCopyMs));
+}
+
+void ARenderManagerActor::RenderLiveView()
+{
+	if (pGPUProfiler) {
+		pGPUProfiler->BeginFrame();
+	}
+	// Below full size the scene goes into the scaler's texture, the projection keeps the aspect of the whole target
+	bool bScaled = pResolutionScaler && pResolutionScaler->IsScaled();
+	if (bScaled) {
+		pDXManager->SetRenderTargetView(pResolutionScaler->GetRenderTargetView());
+		pDXManager->SetSceneViewport(pResolutionScaler->GetViewportWidth(), pResolutionScaler->GetViewportHeight());
+	}
+	const FMinimalViewInfo& POV = pCameraManager->GetCameraCachePOV();
+	RenderView(POV.Location, POV.Rotation, POV.FOV, true);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DXRenderDisplay);
+		FrameStats::ScopedStage stageTime(FrameStatsRecord::DisplayStage);
+		if (bScaled) {
+			pResolutionScaler->Upscale(pDisplayer->GetRenderTargetView());
+			// The batch queue renders at full size into the displayer's target
+			pDXManager->SetRenderTargetView(pDisplayer->GetRenderTargetView());
+			pDXManager->SetSceneViewport(mRenderWidth, mRenderHeight);
+		}
+		pDisplayer->Display();
+	}
+	if (pGPUProfiler) {
+		pGPUProfiler->Mark(GPUProfiler::CopyEnd);
+		if (pGPUProfiler->EndFrame()) {
+			if (pResolutionScaler) {
+				pResolutionScaler->Update(pGPUProfiler->GetTime(GPUProfiler::ClearEnd) + pGPUProfiler->GetTime(GPUProfiler::DrawEnd),
+					TargetGPUTimeMs, MinResolutionScale);
+				SET_FLOAT_STAT(STAT_DXRenderResolutionScale, pResolutionScaler->GetScale());
+			}
+			SET_FLOAT_STAT(STAT_DXRenderGPUClear, pGPUProfiler->GetTime(GPUProfiler::ClearEnd));
+			SET_FLOAT_STAT(STAT_DXRenderGPUDraw, pGPUProfiler->GetTime(GPUProfiler::DrawEnd));
+			SET_FLOAT_STAT(STAT_DXRenderGPUCopy, pGPUProfiler->GetTime(GPUProfiler::CopyEnd));
+			FrameStats::SetGPUTimes(pGPUProfiler->GetTime(GPUProfiler::ClearEnd), pGPUProfiler->GetTime(GPUProfiler::DrawEnd),
+				pGPUProfiler->GetTime(GPUProfiler::CopyEnd));
+		}
+	}
+}
+
+void ARenderManagerActor::RenderView(const FVector& location, const FRotator& rotation, float fov, bool bLiveView)
+{
+	bool bProfile = bLiveView && pGPUProfiler;
+	// The pyramid holds the live view's last frame, a batch pose has nothing to do with it
+	bool bOcclusion = bLiveView && pOcclusionCuller;
 	pDXManager->InitializeScene(0.2f, 0.2f, 0.2f, 1.0f);
+	if (bProfile) {
+		pGPUProfiler->Mark(GPUProfiler::ClearEnd);
+	}
 
 	D3DXMATRIX viewMatrix, projectionMatrix;
 
-	D3DXMatrixPerspectiveFovLH(&projectionMatrix, pCameraManager->GetCameraCachePOV().FOV * 0.0174532925f, (float)pRenderTarget->SizeX / (float)pRenderTarget->SizeY, 0.1f, 100.0f);
+	D3DXMatrixPerspectiveFovLH(&projectionMatrix, fov * 0.0174532925f, (float)mRenderWidth / (float)mRenderHeight, 0.1f, 100.0f);
 	D3DXVECTOR3 up, position, lookAt;
 	float yaw, pitch, roll;
 	D3DXMATRIX rotationMatrix;
@@ -116,17 +371,17 @@ void ARenderManagerActor::Tick(float DeltaTime)
 	up.y = 1.0f;
 	up.z = 0.0f;
 
-	position.x = pCameraManager->GetCameraCachePOV().Location.Y / 100.0f;
-	position.y = pCameraManager->GetCameraCachePOV().Location.Z / 100.0f;
-	position.z = pCameraManager->GetCameraCachePOV().Location.X / 100.0f;
+	position.x = location.Y / 100.0f;
+	position.y = location.Z / 100.0f;
+	position.z = location.X / 100.0f;
 
 	lookAt.x = 0.0f;
 	lookAt.y = 0.0f;
 	lookAt.z = 1.0f;
 
-	pitch = pCameraManager->GetCameraCachePOV().Rotation.Pitch * -0.0174532925f;
-	yaw = pCameraManager->GetCameraCachePOV().Rotation.Yaw * 0.0174532925f;
-	roll = pCameraManager->GetCameraCachePOV().Rotation.Roll * 0.0174532925f;
+	pitch = rotation.Pitch * -0.0174532925f;
+	yaw = rotation.Yaw * 0.0174532925f;
+	roll = rotation.Roll * 0.0174532925f;
 
 	D3DXMatrixRotationYawPitchRoll(&rotationMatrix, yaw, pitch, roll);
 	D3DXVec3TransformCoord(&lookAt, &lookAt, &rotationMatrix);
@@ -134,6 +389,15 @@ void ARenderManagerActor::Tick(float DeltaTime)
 	lookAt = position + lookAt;
 	D3DXMatrixLookAtLH(&viewMatrix, &position, &lookAt, &up);
 
+	D3DXMATRIX viewProjectionMatrix;
+	D3DXMatrixMultiply(&viewProjectionMatrix, &viewMatrix, &projectionMatrix);
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DXRenderCull);
+		FrameStats::ScopedStage stageTime(FrameStatsRecord::CullStage);
+		CullObjects(viewProjectionMatrix, projectionMatrix, position);
+		SortVisibleObjects(viewMatrix);
+	}
+
 	D3DXMatrixTranspose(&viewMatrix, &viewMatrix);
 	D3DXMatrixTranspose(&projectionMatrix, &projectionMatrix);
 
@@ -142,9 +406,9 @@ void ARenderManagerActor::Tick(float DeltaTime)
 
 	pShaderManager->PSConstBuffer->intensity = 1.0f;
 	pShaderManager->PSConstBuffer->lightDirection = D3DXVECTOR3(1.0f, 0.2f, 0.3f);
-	pShaderManager->VSConstBuffer->viewPosition.x = pCameraManager->GetCameraLocation().Y / 100.0f;
-	pShaderManager->VSConstBuffer->viewPosition.y = pCameraManager->GetCameraLocation().Z / 100.0f;
-	pShaderManager->VSConstBuffer->viewPosition.z = pCameraManager->GetCameraLocation().X / 100.0f;
+	pShaderManager->VSConstBuffer->viewPosition.x = location.Y / 100.0f;
+	pShaderManager->VSConstBuffer->viewPosition.y = location.Z / 100.0f;
+	pShaderManager->VSConstBuffer->viewPosition.z = location.X / 100.0f;
 	pShaderManager->PSConstBuffer->specularPower = 2.5f;
 
 	if (pDirectionalLight) {
@@ -159,41 +423,408 @@ void ARenderManagerActor::Tick(float DeltaTime)
 		}
 	}
 
-	for (int i = 0; i < pGeoDataManager->GetObjectCount(); i++) {
-		D3DXMATRIX worldMatrix;
-		D3DXMATRIX inversedWorldMatrix;
-		float _x = aRenderableActor[i]->GetDXPosition().x;
-		float _y = aRenderableActor[i]->GetDXPosition().y;
-		float _z = aRenderableActor[i]->GetDXPosition().z;
-		D3DXMatrixTranslation(&worldMatrix, _x, _y, _z);
+	PrepareShadows();
 
-		D3DXMATRIX rot;
-		float _yaw = aRenderableActor[i]->GetDXRotation().x;
-		float _pitch = aRenderableActor[i]->GetDXRotation().y;
-		float _roll = aRenderableActor[i]->GetDXRotation().z;
-		D3DXMatrixRotationYawPitchRoll(&rot, _yaw, _pitch, -_roll);
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DXRenderSubmit);
+		FrameStats::ScopedStage stageTime(FrameStatsRecord::SubmitStage);
+		pShaderManager->UpdateShaderParameters();
 
-		D3DXMATRIX scale;
-		float scaleX = aRenderableActor[i]->GetDXScale().x;
-		float scaleY = aRenderableActor[i]->GetDXScale().y;
-		float scaleZ = aRenderableActor[i]->GetDXScale().z;
-		D3DXMatrixScaling(&scale, scaleX, scaleY, scaleZ);
+		pShaderManager->InstanceData.Reset();
+		AppendInstances(aVisibleObjects, aDrawBatches);
+		aStaticShadowBatches.Reset();
+		if (bRebuildStaticShadow) {
+			AppendInstances(aStaticCasters, aStaticShadowBatches);
+		}
+		AppendInstances(aDynamicCasters, aDynamicShadowBatches);
+		pShaderManager->UpdateInstanceData();
 
-		D3DXMatrixMultiply(&rot, &scale, &rot);
-		D3DXMatrixMultiply(&worldMatrix, &rot, &worldMatrix);
-		D3DXMatrixInverse(&inversedWorldMatrix, nullptr, &worldMatrix);
-		D3DXMatrixTranspose(&worldMatrix, &worldMatrix);
-		//D3DXMatrixTranspose(&inversedWorldMatrix, &inversedWorldMatrix);
+		RenderShadows();
 
-		pShaderManager->VSConstBuffer->world = worldMatrix;
-		pShaderManager->VSConstBuffer->inversedWorld = inversedWorldMatrix;
-		pShaderManager->UpdateShaderParameters();
+		if (bOcclusion) {
+			RenderBatchesOccluded();
+		}
+		else if (bDeferredContexts && aDrawBatches.Num() >= 2 * MinDrawsPerContext) {
+			RenderBatchesDeferred();
+		}
+		else {
+			RenderBatches(aDrawBatches, 0, aDrawBatches.Num(), nullptr);
+		}
+		SET_DWORD_STAT(STAT_DXRenderVisibleObjects, mVisibleCount);
+		SET_DWORD_STAT(STAT_DXRenderCulledObjects, mCulledCount);
+		SET_DWORD_STAT(STAT_DXRenderDrawCalls, aDrawBatches.Num());
 
-		uint32 start = pGeoDataManager->GetMetaData(i)->startIndex;
-		uint32 length = pGeoDataManager->GetMetaData(i)->length;
-		pShaderManager->Render(length, start);
+		if (bOcclusion) {
+			pOcclusionCuller->BuildHiZ(viewProjectionMatrix);
+		}
+	}
+	if (bProfile) {
+		pGPUProfiler->Mark(GPUProfiler::DrawEnd);
 	}
+}
 
-	pDisplayer->Display();
+int ARenderManagerActor::QueueBatchRender(const TArray<FTransform>& cameraPoses, float fov, const FString& outputDirectory, TEnumAsByte<EDXRenderImageFormat::Type> format)
+{
+	if (!bInitialized) {
+		return 0;
+	}
+	bool bEXR = format == EDXRenderImageFormat::EXR;
+	for (auto& pose : cameraPoses) {
+		FDXRenderBatchItem item;
+		item.Pose = pose;
+		item.FOV = fov;
+		item.FileName = FPaths::Combine(outputDirectory, FString::Printf(TEXT("Frame_%06d.%s"), mBatchFrameIndex++, bEXR ? TEXT("exr") : TEXT("png")));
+		item.bEXR = bEXR;
+		aBatchQueue.Add(item);
+	}
+	return cameraPoses.Num();
+}
+
+void ARenderManagerActor::RenderBatchQueue()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DXRenderBatch);
+	FrameStats::ScopedStage stageTime(FrameStatsRecord::BatchStage);
+	if (!pBatchCapture) {
+		pBatchCapture = new BatchCapture();
+		if (!pBatchCapture->Initialize(mRenderWidth, mRenderHeight, pDisplayer->GetFormat(), BatchFramesInFlight)) {
+			pBatchCapture->Destroy();
+			delete pBatchCapture;
+			pBatchCapture = 0;
+			aBatchQueue.Reset();
+			LOG("Batch Capture Initialize Failed");
+			return;
+		}
+	}
+
+	// Poses go back to back until the budget is spent, so a frame waits on the GPU and not on the tick
+	double deadline = FPlatformTime::Seconds() + BatchTimeBudgetMs * 0.001;
+	int rendered = 0;
+	while (rendered < aBatchQueue.Num() && FPlatformTime::Seconds() < deadline) {
+		// The writers are behind, leave the rest of the queue for the next tick
+		if (pBatchCapture->GetWritingCount() >= 2 * BatchFramesInFlight) {
+			break;
+		}
+		if (!pBatchCapture->HasFreeSlot()) {
+			pBatchCapture->Poll(true);
+		}
+
+		auto& item = aBatchQueue[rendered];
+		RenderView(item.Pose.GetLocation(), item.Pose.Rotator(), item.FOV, false);
+		pBatchCapture->Capture(pDisplayer->GetRenderTargetTexture(), item.FileName, item.bEXR);
+		pBatchCapture->Poll(false);
+		rendered++;
+	}
+	aBatchQueue.RemoveAt(0, rendered, false);
+
+	// The last frames of a batch still have to come back
+	pBatchCapture->Poll(false);
+	SET_DWORD_STAT(STAT_DXRenderBatchPending, aBatchQueue.Num() + pBatchCapture->GetPendingCount());
+}
+
+
+// Same rotation the vertex shaders apply to the instance poses
+static D3DXVECTOR3 RotateByQuaternion(const D3DXVECTOR3& v, const D3DXQUATERNION& q)
+{
+	D3DXVECTOR3 u(q.x, q.y, q.z);
+	D3DXVECTOR3 t, ut;
+	D3DXVec3Cross(&t, &u, &v);
+	t *= 2.0f;
+	D3DXVec3Cross(&ut, &u, &t);
+	return v + t * q.w + ut;
+}
+
+void ARenderManagerActor::CullObjects(const D3DXMATRIX& viewProjectionMatrix, const D3DXMATRIX& projectionMatrix, const D3DXVECTOR3& viewPosition)
+{
+	aCullObjects.Reset();
+	aCullGeometries.Reset();
+	aCullInstances.Reset();
+	aBoundsX.Reset();
+	aBoundsY.Reset();
+	aBoundsZ.Reset();
+	aBoundsRadius.Reset();
+	// As ComputeBoundsScreenSize, the sphere's projected diameter against the height of the screen
+	float screenMultiple = FMath::Max(0.5f * projectionMatrix._11, 0.5f * projectionMatrix._22);
+
+	for (int geometry = 0; geometry < pGeoDataManager->GetGeometryCount(); geometry++) {
+		auto meta = pGeoDataManager->GetMetaData(geometry);
+		for (int i : pGeoDataManager->GetGeometryObjects(geometry)) {
+			ShaderManager::InstanceType& instance = aCullInstances[aCullInstances.AddUninitialized()];
+			aRenderableActor[i]->GetDXPose(instance.position, instance.rotation, instance.scale);
+			instance.textureSlice = pGeoDataManager->GetTextureSlice(i);
+
+			const D3DXVECTOR3& scale = instance.scale;
+			D3DXVECTOR3 center(meta->boundsCenter.x * scale.x, meta->boundsCenter.y * scale.y, meta->boundsCenter.z * scale.z);
+			center = RotateByQuaternion(center, instance.rotation) + instance.position;
+			float maxScale = FMath::Max3(FMath::Abs(scale.x), FMath::Abs(scale.y), FMath::Abs(scale.z));
+			float radius = meta->boundsRadius * maxScale;
+
+			int lod = geometry;
+			if (bMeshLODs && meta->nextLOD >= 0) {
+				D3DXVECTOR3 offset = center - viewPosition;
+				// 1 cm as UE clamps the distance, the DX units are meters
+				float screenSize = 2.0f * screenMultiple * radius / FMath::Max(D3DXVec3Length(&offset), 0.01f);
+				lod = pGeoDataManager->SelectLOD(geometry, screenSize);
+			}
+
+			aCullObjects.Add(i);
+			aCullGeometries.Add(lod);
+			aBoundsX.Add(center.x);
+			aBoundsY.Add(center.y);
+			aBoundsZ.Add(center.z);
+			aBoundsRadius.Add(radius);
+		}
+	}
+
+	int count = aCullObjects.Num();
+	aVisibleObjects.Reset();
+	if (!bFrustumCulling) {
+		for (int i = 0; i < count; i++) {
+			aVisibleObjects.Add(i);
+		}
+		mVisibleCount = count;
+		mCulledCount = 0;
+		return;
+	}
+
+	// Padding up to a multiple of four, the padded lanes are never read back
+	int paddedCount = Align(count, 4);
+	aBoundsX.SetNumZeroed(paddedCount);
+	aBoundsY.SetNumZeroed(paddedCount);
+	aBoundsZ.SetNumZeroed(paddedCount);
+	aBoundsRadius.SetNumZeroed(paddedCount);
+
+	// Planes of the row vector view projection with D3D depth, the normals point inside
+	const D3DXMATRIX& m = viewProjectionMatrix;
+	D3DXPLANE planes[6] = {
+		D3DXPLANE(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41),
+		D3DXPLANE(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41),
+		D3DXPLANE(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42),
+		D3DXPLANE(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42),
+		D3DXPLANE(m._13, m._23, m._33, m._43),
+		D3DXPLANE(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43),
+	};
+	VectorRegister planeA[6], planeB[6], planeC[6], planeD[6];
+	for (int p = 0; p < 6; p++) {
+		D3DXPlaneNormalize(&planes[p], &planes[p]);
+		planeA[p] = VectorSetFloat1(planes[p].a);
+		planeB[p] = VectorSetFloat1(planes[p].b);
+		planeC[p] = VectorSetFloat1(planes[p].c);
+		planeD[p] = VectorSetFloat1(planes[p].d);
+	}
+
+	// Four spheres per iteration, a sphere is visible while it is not fully behind any plane
+	for (int i = 0; i < paddedCount; i += 4) {
+		VectorRegister x = VectorLoad(&aBoundsX[i]);
+		VectorRegister y = VectorLoad(&aBoundsY[i]);
+		VectorRegister z = VectorLoad(&aBoundsZ[i]);
+		VectorRegister negRadius = VectorNegate(VectorLoad(&aBoundsRadius[i]));
+		VectorRegister inside = VectorCompareEQ(x, x);
+		for (int p = 0; p < 6; p++) {
+			VectorRegister distance = VectorMultiplyAdd(planeA[p], x, VectorMultiplyAdd(planeB[p], y, VectorMultiplyAdd(planeC[p], z, planeD[p])));
+			inside = VectorBitwiseAnd(inside, VectorCompareGE(distance, negRadius));
+		}
+		uint32 mask = VectorMaskBits(inside);
+		for (int lane = 0; lane < 4 && i + lane < count; lane++) {
+			if (mask & (1 << lane)) {
+				aVisibleObjects.Add(i + lane);
+			}
+		}
+	}
+	mVisibleCount = aVisibleObjects.Num();
+	mCulledCount = count - mVisibleCount;
+}
+
+void ARenderManagerActor::SortVisibleObjects(const D3DXMATRIX& viewMatrix)
+{
+	if (!bSortFrontToBack) {
+		return;
+	}
+
+	// View space depth of the sphere centers, a geometry is drawn at the depth of its nearest instance
+	aVisibleDepths.SetNumUninitialized(aCullObjects.Num());
+	aGeometryDepths.Init(MAX_flt, pGeoDataManager->GetGeometryCount());
+	for (int visible : aVisibleObjects) {
+		float depth = aBoundsX[visible] * viewMatrix._13 + aBoundsY[visible] * viewMatrix._23 + aBoundsZ[visible] * viewMatrix._33 + viewMatrix._43;
+		aVisibleDepths[visible] = depth;
+		float& geometryDepth = aGeometryDepths[aCullGeometries[visible]];
+		geometryDepth = FMath::Min(geometryDepth, depth);
+	}
+
+	aVisibleObjects.Sort([this](int a, int b) {
+		int geometryA = aCullGeometries[a];
+		int geometryB = aCullGeometries[b];
+		if (geometryA != geometryB) {
+			float depthA = aGeometryDepths[geometryA];
+			float depthB = aGeometryDepths[geometryB];
+			return depthA != depthB ? depthA < depthB : geometryA < geometryB;
+		}
+		return aVisibleDepths[a] < aVisibleDepths[b];
+	});
+}
+
+void ARenderManagerActor::AppendInstances(const TArray<int>& positions, TArray<FIntVector>& batches)
+{
+	// The positions are grouped by geometry, each run becomes one instanced draw
+	batches.Reset();
+	for (int first = 0; first < positions.Num();) {
+		int geometry = aCullGeometries[positions[first]];
+		int last = first + 1;
+		while (last < positions.Num() && aCullGeometries[positions[last]] == geometry) {
+			last++;
+		}
+		batches.Add(FIntVector(geometry, pShaderManager->InstanceData.Num(), last - first));
+
+		for (int k = first; k < last; k++) {
+			pShaderManager->InstanceData.Add(aCullInstances[positions[k]]);
+		}
+		first = last;
+	}
+}
+
+void ARenderManagerActor::RenderBatches(const TArray<FIntVector>& batches, int first, int last, ID3D11DeviceContext* context)
+{
+	for (int i = first; i < last; i++) {
+		const FIntVector& batch = batches[i];
+		auto meta = pGeoDataManager->GetMetaData(batch.X);
+		pShaderManager->Render(meta->length, meta->startIndex, meta->baseVertex, batch.Z, batch.Y, context);
+	}
+}
+
+void ARenderManagerActor::RenderBatchesDeferred()
+{
+	int contextCount = FMath::Min(DeferredContextCount, aDrawBatches.Num() / MinDrawsPerContext);
+	if (!pDXManager->CreateDeferredContexts(contextCount)) {
+		bDeferredContexts = false;
+		RenderBatches(aDrawBatches, 0, aDrawBatches.Num(), nullptr);
+		return;
+	}
+
+	// The bindings are read here, worker threads may not touch the immediate context
+	DXManager::PipelineState state;
+	pDXManager->CapturePipelineState(state);
+
+	aCommandLists.Init(nullptr, contextCount);
+	ParallelFor(contextCount, [&](int32 index) {
+		ID3D11DeviceContext* context = pDXManager->GetDeferredContext(index);
+		pDXManager->ApplyPipelineState(context, state);
+		int first = aDrawBatches.Num() * index / contextCount;
+		int last = aDrawBatches.Num() * (index + 1) / contextCount;
+		RenderBatches(aDrawBatches, first, last, context);
+		context->FinishCommandList(FALSE, &aCommandLists[index]);
+	});
+
+	// Executed in order, so the front to back sorting holds across the lists
+	for (auto& commandList : aCommandLists) {
+		if (commandList) {
+			pDXManager->GetContext()->ExecuteCommandList(commandList, TRUE);
+		}
+		SAFE_RELEASE(commandList);
+	}
+	pDXManager->ReleasePipelineState(state);
+}
+
+void ARenderManagerActor::RenderBatchesOccluded()
+{
+	// The visible objects were appended first, instance k is aVisibleObjects[k]
+	aOcclusionInstances.Reset();
+	for (int b = 0; b < aDrawBatches.Num(); b++) {
+		const FIntVector& batch = aDrawBatches[b];
+		for (int k = batch.Y; k < batch.Y + batch.Z; k++) {
+			int visible = aVisibleObjects[k];
+			OcclusionCuller::CullInstance& instance = aOcclusionInstances[aOcclusionInstances.AddUninitialized()];
+			instance.instance = aCullInstances[visible];
+			instance.bounds = D3DXVECTOR4(aBoundsX[visible], aBoundsY[visible], aBoundsZ[visible], aBoundsRadius[visible]);
+			instance.batch = b;
+		}
+	}
+
+	if (!pOcclusionCuller->Cull(aOcclusionInstances, aDrawBatches, pGeoDataManager)) {
+		RenderBatches(aDrawBatches, 0, aDrawBatches.Num(), nullptr);
+		return;
+	}
+	pOcclusionCuller->RenderBatches();
+}
+
+void ARenderManagerActor::PrepareShadows()
+{
+	aStaticCasters.Reset();
+	aDynamicCasters.Reset();
+	bRebuildStaticShadow = false;
+	bool bShadows = pShadowManager && pDirectionalLight;
+	pShaderManager->PSConstBuffer->shadowStrength = bShadows ? ShadowStrength : 0.0f;
+	if (!bShadows) {
+		return;
+	}
+
+	// Every object casts, culled or not
+	for (int i = 0; i < aCullObjects.Num(); i++) {
+		USceneComponent* root = aRenderableActor[aCullObjects[i]]->GetRootComponent();
+		if (root && root->Mobility == EComponentMobility::Static) {
+			aStaticCasters.Add(i);
+		}
+		else {
+			aDynamicCasters.Add(i);
+		}
+	}
+
+	// The cached map holds while the light and every static caster stay where they were
+	const D3DXVECTOR3& lightDirection = pShaderManager->PSConstBuffer->lightDirection;
+	bRebuildStaticShadow = !bStaticShadowValid || lightDirection != mShadowLightDirection || aStaticCasters.Num() != aShadowCachedObjects.Num();
+	for (int k = 0; !bRebuildStaticShadow && k < aStaticCasters.Num(); k++) {
+		int position = aStaticCasters[k];
+		bRebuildStaticShadow = aShadowCachedObjects[k] != aCullObjects[position] || aShadowCachedGeometries[k] != aCullGeometries[position]
+			|| FMemory::Memcmp(&aShadowCachedInstances[k], &aCullInstances[position], sizeof(ShaderManager::InstanceType)) != 0;
+	}
+
+	// The light covers the static casters, so it only moves with the cache. Without any it follows the dynamic ones
+	const TArray<int>& boundsCasters = aStaticCasters.Num() ? aStaticCasters : aDynamicCasters;
+	if ((bRebuildStaticShadow || aStaticCasters.Num() == 0) && boundsCasters.Num()) {
+		D3DXVECTOR3 boundsMin(MAX_flt, MAX_flt, MAX_flt);
+		D3DXVECTOR3 boundsMax(-MAX_flt, -MAX_flt, -MAX_flt);
+		for (int position : boundsCasters) {
+			float radius = aBoundsRadius[position];
+			boundsMin = D3DXVECTOR3(FMath::Min(boundsMin.x, aBoundsX[position] - radius), FMath::Min(boundsMin.y, aBoundsY[position] - radius), FMath::Min(boundsMin.z, aBoundsZ[position] - radius));
+			boundsMax = D3DXVECTOR3(FMath::Max(boundsMax.x, aBoundsX[position] + radius), FMath::Max(boundsMax.y, aBoundsY[position] + radius), FMath::Max(boundsMax.z, aBoundsZ[position] + radius));
+		}
+		D3DXVECTOR3 boundsExtent = boundsMax - boundsMin;
+		pShadowManager->SetLight(lightDirection, (boundsMin + boundsMax) * 0.5f, D3DXVec3Length(&boundsExtent) * 0.5f);
+	}
+
+	if (bRebuildStaticShadow) {
+		aShadowCachedObjects.Reset();
+		aShadowCachedGeometries.Reset();
+		aShadowCachedInstances.Reset();
+		for (int position : aStaticCasters) {
+			aShadowCachedObjects.Add(aCullObjects[position]);
+			aShadowCachedGeometries.Add(aCullGeometries[position]);
+			aShadowCachedInstances.Add(aCullInstances[position]);
+		}
+		mShadowLightDirection = lightDirection;
+	}
+
+	D3DXMATRIX lightViewProjection;
+	D3DXMatrixTranspose(&lightViewProjection, &pShadowManager->GetLightViewProjection());
+	pShaderManager->VSConstBuffer->lightViewProjection = lightViewProjection;
 }
 
+void ARenderManagerActor::RenderShadows()
+{
+	if (!pShadowManager || !pDirectionalLight) {
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_DXRenderShadows);
+	FrameStats::ScopedStage stageTime(FrameStatsRecord::ShadowStage);
+	pShaderManager->SetShadowPass(true);
+	if (bRebuildStaticShadow) {
+		pShadowManager->BeginPass(ShadowManager::StaticShadowMap);
+		RenderBatches(aStaticShadowBatches, 0, aStaticShadowBatches.Num(), nullptr);
+		bStaticShadowValid = true;
+		LOG("Rebuild Static Shadow Map");
+	}
+	// Cleared every frame, also when nothing dynamic is left
+	pShadowManager->BeginPass(ShadowManager::DynamicShadowMap);
+	RenderBatches(aDynamicShadowBatches, 0, aDynamicShadowBatches.Num(), nullptr);
+	pShadowManager->EndPass();
+	pShaderManager->SetShadowPass(false);
+}
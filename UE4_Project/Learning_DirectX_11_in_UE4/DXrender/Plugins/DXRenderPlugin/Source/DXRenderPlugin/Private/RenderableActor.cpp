@@ -21,11 +21,11 @@ ARenderableActor::ARenderableActor()
 	RootComponent = StaticMeshComponent;
 }
 
-FStaticMeshLODResources * ARenderableActor::GetGeometryData()
+FStaticMeshRenderData * ARenderableActor::GetGeometryData()
 {
 	if (auto mesh = this->StaticMeshComponent->GetStaticMesh()) {
-		if (mesh->RenderData->LODResources.Num() > 0) {
-			return &mesh->RenderData->LODResources[0];
+		if (mesh->RenderData && mesh->RenderData->LODResources.Num() > 0) {
+			return mesh->RenderData.Get();
 		}
 	}
 
@@ -59,6 +59,14 @@ D3DXVECTOR3 ARenderableActor::GetDXScale()
 	return scale;
 }
 
+void ARenderableActor::GetDXPose(D3DXVECTOR3& position, D3DXQUATERNION& rotation, D3DXVECTOR3& scale)
+{
+	position = GetDXPosition();
+	D3DXVECTOR3 yawPitchRoll = GetDXRotation();
+	D3DXQuaternionRotationYawPitchRoll(&rotation, yawPitchRoll.x, yawPitchRoll.y, -yawPitchRoll.z);
+	scale = GetDXScale();
+}
+
 TArray<uint8> ARenderableActor::GetTextureSourceData()
 {
 	auto data = TArray<uint8>();
@@ -0,0 +1,164 @@
+#include "ResolutionScaler.h"
+#include "DXManager.h"
+#include "ShaderManager.h"
+#include "Util.h"
+#include "FrameStats.h"
+#include "Misc/Paths.h"
+
+// The viewport moves in steps of this many pixels, so a small change of scale keeps the same size
+static const int ViewportGranularity = 8;
+// GPU times this close to the target leave the scale as it is
+static const float TargetTolerance = 0.05f;
+// Share of the correction applied per reading, the timings lag a few frames behind the scale they measure
+static const float ScaleDamping = 0.25f;
+
+bool ResolutionScaler::Initialize(int width, int height, DXGI_FORMAT format, ShaderManager* inShaderManager)
+{
+	HRESULT result;
+	D3D11_TEXTURE2D_DESC textureDesc;
+	D3D11_BUFFER_DESC bufferDesc;
+	D3D11_SAMPLER_DESC samplerStateDesc;
+	auto device = GetDXManagerInstance()->GetDevice();
+	mWidth = width;
+	mHeight = height;
+	mViewportWidth = width;
+	mViewportHeight = height;
+	mScale = 1.0f;
+
+	// 0.Load the shaders
+	FString VS = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("upscale.vs"));
+	FString PS = FPaths::Combine(FPaths::ProjectDir(), FString("Shader"), FString("upscale.ps"));
+	TArray<uint8> vertexShaderBytecode, pixelShaderBytecode;
+	if (!inShaderManager->LoadShaderBytecode(VS, "UpscaleVertexShader", "vs_5_0", vertexShaderBytecode)
+		|| !inShaderManager->LoadShaderBytecode(PS, "UpscalePixelShader", "ps_5_0", pixelShaderBytecode)) {
+		return false;
+	}
+	result = device->CreateVertexShader(vertexShaderBytecode.GetData(), vertexShaderBytecode.Num(), NULL, &pVertexShader);
+	RETURN_FALSE_IF_ERROR(result, CreateUpscaleVertexShader);
+	result = device->CreatePixelShader(pixelShaderBytecode.GetData(), pixelShaderBytecode.Num(), NULL, &pPixelShader);
+	RETURN_FALSE_IF_ERROR(result, CreateUpscalePixelShader);
+
+	// 1.Create the full size scene texture, the same format as the display target
+	INIT_MEMORY(textureDesc);
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.Format = format;
+	textureDesc.Height = height;
+	textureDesc.Width = width;
+	textureDesc.MipLevels = 1;
+	textureDesc.MiscFlags = 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	result = device->CreateTexture2D(&textureDesc, nullptr, &pSceneTexture);
+	RETURN_FALSE_IF_ERROR(result, CreateSceneTexture);
+	result = device->CreateRenderTargetView(pSceneTexture, nullptr, &pSceneTargetView);
+	RETURN_FALSE_IF_ERROR(result, CreateSceneTargetView);
+	result = device->CreateShaderResourceView(pSceneTexture, nullptr, &pSceneResourceView);
+	RETURN_FALSE_IF_ERROR(result, CreateSceneResourceView);
+
+	// 2.Create the constant buffer and a clamped linear sampler
+	INIT_MEMORY(bufferDesc);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(UpscaleBufferType);
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	result = device->CreateBuffer(&bufferDesc, NULL, &pConstBuffer);
+	RETURN_FALSE_IF_ERROR(result, CreateUpscaleConstBuffer);
+
+	INIT_MEMORY(samplerStateDesc);
+	samplerStateDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerStateDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerStateDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerStateDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	samplerStateDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerStateDesc.MaxAnisotropy = 1;
+	samplerStateDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	samplerStateDesc.MinLOD = 0;
+	samplerStateDesc.MipLODBias = 0.0f;
+	result = device->CreateSamplerState(&samplerStateDesc, &pSamplerState);
+	RETURN_FALSE_IF_ERROR(result, CreateUpscaleSamplerState);
+
+	bInitialized = true;
+	LOG("ResolutionScaler Initialize Success");
+	return true;
+}
+
+void ResolutionScaler::Destroy()
+{
+	SAFE_RELEASE(pSceneTexture);
+	SAFE_RELEASE(pSceneTargetView);
+	SAFE_RELEASE(pSceneResourceView);
+	SAFE_RELEASE(pVertexShader);
+	SAFE_RELEASE(pPixelShader);
+	SAFE_RELEASE(pConstBuffer);
+	SAFE_RELEASE(pSamplerState);
+	bInitialized = false;
+}
+
+void ResolutionScaler::Update(float gpuMs, float targetMs, float minScale)
+{
+	if (!bInitialized || gpuMs <= 0.0f || targetMs <= 0.0f) {
+		return;
+	}
+	if (FMath::Abs(gpuMs - targetMs) > targetMs * TargetTolerance) {
+		// The scene's GPU time follows its pixel count, so each side goes with the square root of the time
+		float scale = mScale * FMath::Sqrt(targetMs / gpuMs);
+		mScale = FMath::Clamp(FMath::Lerp(mScale, scale, ScaleDamping), FMath::Clamp(minScale, 0.1f, 1.0f), 1.0f);
+	}
+
+	auto snap = [](int size, float scale) {
+		int scaled = FMath::RoundToInt(size * scale / ViewportGranularity) * ViewportGranularity;
+		return FMath::Clamp(scaled, FMath::Min(ViewportGranularity, size), size);
+	};
+	mViewportWidth = snap(mWidth, mScale);
+	mViewportHeight = snap(mHeight, mScale);
+}
+
+void ResolutionScaler::Upscale(ID3D11RenderTargetView* output)
+{
+	if (!bInitialized) {
+		return;
+	}
+	auto manager = GetDXManagerInstance();
+	auto context = manager->GetContext();
+	DXManager::PipelineState savedState;
+	manager->CapturePipelineState(savedState);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(context->Map(pConstBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource))) {
+		LOG("Map UpscaleConstBuffer Fail");
+		manager->ReleasePipelineState(savedState);
+		return;
+	}
+	UpscaleBufferType* buffer = (UpscaleBufferType*)mappedResource.pData;
+	buffer->uvScale[0] = (float)mViewportWidth / mWidth;
+	buffer->uvScale[1] = (float)mViewportHeight / mHeight;
+	buffer->uvMax[0] = (mViewportWidth - 0.5f) / mWidth;
+	buffer->uvMax[1] = (mViewportHeight - 0.5f) / mHeight;
+	context->Unmap(pConstBuffer, 0);
+	FrameStats::AddConstantBufferBytes(sizeof(UpscaleBufferType));
+
+	// No depth target, the scene texture can't be bound as a target and a resource at once
+	context->OMSetRenderTargets(1, &output, nullptr);
+	manager->SetViewport(mWidth, mHeight);
+	manager->TurnOffAlphaBlend();
+	context->IASetInputLayout(nullptr);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->VSSetShader(pVertexShader, nullptr, 0);
+	context->PSSetShader(pPixelShader, nullptr, 0);
+	context->VSSetConstantBuffers(0, 1, &pConstBuffer);
+	context->PSSetConstantBuffers(0, 1, &pConstBuffer);
+	context->PSSetShaderResources(0, 1, &pSceneResourceView);
+	context->PSSetSamplers(0, 1, &pSamplerState);
+	context->Draw(3, 0);
+	FrameStats::AddDraw(1);
+
+	// The restored views don't include the scene texture, it was only bound as a target before
+	ID3D11ShaderResourceView* nullView = nullptr;
+	context->PSSetShaderResources(0, 1, &nullView);
+	manager->ApplyPipelineState(context, savedState);
+	manager->ReleasePipelineState(savedState);
+}
@@ -2,69 +2,56 @@
 #include "Util.h"
 #include "DXManager.h"
 #include "GeometryDataManager.h"
+#include "FrameStats.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include <D3Dcompiler.h>
 
-bool ShaderManager::Initialize(FString inVSFileName, FString inPSFileName)
+// Bump to drop the cached bytecode, e.g. after changing how it is compiled
+static const int ShaderCacheVersion = 1;
+static const UINT ShaderCompileFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+
+bool ShaderManager::Initialize(FString inVSFileName, FString inPSFileName, const TArray<FString>& inDefines, FString inShadowVSFileName)
 {
 	VSConstBuffer = new VSBufferType();
 	PSConstBuffer = new PSBufferType();
-
-	auto VSFileName = (TEXT("%s"), *inVSFileName);
-	auto PSFileName = (TEXT("%s"), *inPSFileName);
+	mVSFileName = inVSFileName;
+	mPSFileName = inPSFileName;
+	aDefines = inDefines;
 
 	HRESULT result;
-	ID3D10Blob* errorMessage = 0;
-	ID3D10Blob* vertexShaderBuffer = 0;
-	ID3D10Blob* pixelShaderBuffer = 0;
-	D3D11_INPUT_ELEMENT_DESC polygonLayout[5];
+	TArray<uint8> vertexShaderBytecode;
+	TArray<uint8> pixelShaderBytecode;
+	TArray<uint8> shadowShaderBytecode;
+	D3D11_INPUT_ELEMENT_DESC polygonLayout[8];
 	unsigned int numElements;
 	D3D11_BUFFER_DESC VSBufferDesc;
 	D3D11_BUFFER_DESC PSBufferDesc;
 
-	// 0.Compile the vertex and pixel shader code.
-	result = D3DX11CompileFromFile(VSFileName, NULL, NULL, "ColorVertexShader", "vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, NULL,
-		&vertexShaderBuffer, &errorMessage, NULL);
-
-	if (FAILED(result))
-	{
-		// If the shader failed to compile it should have writen something to the error message.
-		if (errorMessage)
-		{
-			OutputShaderErrorMessage(errorMessage, VSFileName);
-		}
-		// If there was nothing in the error message then it simply could not find the shader file itself.
-		else
-		{
-			LOG("Missing Shader File %s", VSFileName);
-		}
+	// 0.Load the vertex and pixel shader bytecode, compiled only when the cache has no matching entry
+	if (!LoadShaderBytecode(mVSFileName, "ColorVertexShader", "vs_5_0", vertexShaderBytecode)
+		|| !LoadShaderBytecode(mPSFileName, "ColorPixelShader", "ps_5_0", pixelShaderBytecode)) {
 		return false;
 	}
-
-	result = D3DX11CompileFromFile(PSFileName, NULL, NULL, "ColorPixelShader", "ps_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, NULL,
-		&pixelShaderBuffer, &errorMessage, NULL);
-	if (FAILED(result))
-	{
-		// If the shader failed to compile it should have writen something to the error message.
-		if (errorMessage)
-		{
-			OutputShaderErrorMessage(errorMessage, PSFileName);
-		}
-		// If there was nothing in the error message then it simply could not find the shader file itself.
-		else
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Missing Shader File %s"), PSFileName);
-		}
+	if (!inShadowVSFileName.IsEmpty() && !LoadShaderBytecode(inShadowVSFileName, "ShadowVertexShader", "vs_5_0", shadowShaderBytecode)) {
 		return false;
 	}
 
-	
 	// 1.Create the vertex and pixel shader from the buffer.
-	result = GetDXManagerInstance()->GetDevice()->CreateVertexShader(vertexShaderBuffer->GetBufferPointer(), vertexShaderBuffer->GetBufferSize(), NULL, &pVertexShader);
+	result = GetDXManagerInstance()->GetDevice()->CreateVertexShader(vertexShaderBytecode.GetData(), vertexShaderBytecode.Num(), NULL, &pVertexShader);
 	RETURN_FALSE_IF_ERROR(result, CreateVertexShader);
 
-	result = GetDXManagerInstance()->GetDevice()->CreatePixelShader(pixelShaderBuffer->GetBufferPointer(), pixelShaderBuffer->GetBufferSize(), NULL, &pPixelShader);
+	result = GetDXManagerInstance()->GetDevice()->CreatePixelShader(pixelShaderBytecode.GetData(), pixelShaderBytecode.Num(), NULL, &pPixelShader);
 	RETURN_FALSE_IF_ERROR(result, CreatePixelShader);
 
+	if (shadowShaderBytecode.Num()) {
+		result = GetDXManagerInstance()->GetDevice()->CreateVertexShader(shadowShaderBytecode.GetData(), shadowShaderBytecode.Num(), NULL, &pShadowVertexShader);
+		RETURN_FALSE_IF_ERROR(result, CreateShadowVertexShader);
+	}
+
 	// 2.Create polygonLayout
+	// Packed vertex, see GeometryDataManager::VertexAttribute
 	polygonLayout[0].SemanticName = "POSITION";
 	polygonLayout[0].SemanticIndex = 0;
 	polygonLayout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
@@ -75,47 +62,73 @@ bool ShaderManager::Initialize(FString inVSFileName, FString inPSFileName)
 
 	polygonLayout[1].SemanticName = "NORMAL";
 	polygonLayout[1].SemanticIndex = 0;
-	polygonLayout[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[1].Format = DXGI_FORMAT_R10G10B10A2_UNORM;
 	polygonLayout[1].InputSlot = 0;
 	polygonLayout[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	polygonLayout[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 	polygonLayout[1].InstanceDataStepRate = 0;
 
-	polygonLayout[2].SemanticName = "BINORMAL";
+	polygonLayout[2].SemanticName = "TANGENT";
 	polygonLayout[2].SemanticIndex = 0;
-	polygonLayout[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[2].Format = DXGI_FORMAT_R10G10B10A2_UNORM;
 	polygonLayout[2].InputSlot = 0;
 	polygonLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	polygonLayout[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 	polygonLayout[2].InstanceDataStepRate = 0;
 
-	polygonLayout[3].SemanticName = "TANGENT";
+	polygonLayout[3].SemanticName = "TEXCOORD";
 	polygonLayout[3].SemanticIndex = 0;
-	polygonLayout[3].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[3].Format = DXGI_FORMAT_R16G16_FLOAT;
 	polygonLayout[3].InputSlot = 0;
 	polygonLayout[3].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	polygonLayout[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 	polygonLayout[3].InstanceDataStepRate = 0;
 
-	polygonLayout[4].SemanticName = "TEXCOORD";
+	// Instance stream, see InstanceType
+	polygonLayout[4].SemanticName = "INSTPOSITION";
 	polygonLayout[4].SemanticIndex = 0;
-	polygonLayout[4].Format = DXGI_FORMAT_R32G32_FLOAT;
-	polygonLayout[4].InputSlot = 0;
-	polygonLayout[4].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
-	polygonLayout[4].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-	polygonLayout[4].InstanceDataStepRate = 0;
+	polygonLayout[4].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[4].InputSlot = 1;
+	polygonLayout[4].AlignedByteOffset = 0;
+	polygonLayout[4].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[4].InstanceDataStepRate = 1;
+
+	polygonLayout[5].SemanticName = "INSTROTATION";
+	polygonLayout[5].SemanticIndex = 0;
+	polygonLayout[5].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	polygonLayout[5].InputSlot = 1;
+	polygonLayout[5].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[5].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[5].InstanceDataStepRate = 1;
+
+	polygonLayout[6].SemanticName = "INSTSCALE";
+	polygonLayout[6].SemanticIndex = 0;
+	polygonLayout[6].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[6].InputSlot = 1;
+	polygonLayout[6].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[6].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[6].InstanceDataStepRate = 1;
+
+	polygonLayout[7].SemanticName = "TEXINDEX";
+	polygonLayout[7].SemanticIndex = 0;
+	polygonLayout[7].Format = DXGI_FORMAT_R32_UINT;
+	polygonLayout[7].InputSlot = 1;
+	polygonLayout[7].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[7].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[7].InstanceDataStepRate = 1;
 
 	numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
 
-	result = GetDXManagerInstance()->GetDevice()->CreateInputLayout(polygonLayout, numElements, vertexShaderBuffer->GetBufferPointer(),
-		vertexShaderBuffer->GetBufferSize(), &pInputLayout);
+	result = GetDXManagerInstance()->GetDevice()->CreateInputLayout(polygonLayout, numElements, vertexShaderBytecode.GetData(),
+		vertexShaderBytecode.Num(), &pInputLayout);
 	RETURN_FALSE_IF_ERROR(result, CreateInputLayout);
 
-	vertexShaderBuffer->Release();
-	vertexShaderBuffer = 0;
-
-	pixelShaderBuffer->Release();
-	pixelShaderBuffer = 0;
+	// The shadow shader reads only the position and the pose, its signature needs its own layout
+	if (pShadowVertexShader) {
+		result = GetDXManagerInstance()->GetDevice()->CreateInputLayout(polygonLayout, numElements, shadowShaderBytecode.GetData(),
+			shadowShaderBytecode.Num(), &pShadowInputLayout);
+		RETURN_FALSE_IF_ERROR(result, CreateShadowInputLayout);
+	}
 
 	// 3.Create VS and PS const buffer
 	VSBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
@@ -140,6 +153,10 @@ bool ShaderManager::Initialize(FString inVSFileName, FString inPSFileName)
 
 	// 4.Config
 	GetDXManagerInstance()->GetContext()->IASetInputLayout(pInputLayout);
+	GetDXManagerInstance()->GetContext()->VSSetConstantBuffers(0, 1, &pVSConstBuffer);
+	GetDXManagerInstance()->GetContext()->PSSetConstantBuffers(0, 1, &pPSConstBuffer);
+	bVSUploaded = false;
+	bPSUploaded = false;
 	GetDXManagerInstance()->GetContext()->VSSetShader(pVertexShader, NULL, 0);
 	GetDXManagerInstance()->GetContext()->PSSetShader(pPixelShader, NULL, 0);
 
@@ -148,6 +165,75 @@ bool ShaderManager::Initialize(FString inVSFileName, FString inPSFileName)
 	return true;
 }
 
+bool ShaderManager::LoadShaderBytecode(const FString& fileName, const char* entryPoint, const char* profile, TArray<uint8>& outBytecode)
+{
+	TArray<uint8> source;
+	if (!FFileHelper::LoadFileToArray(source, *fileName, FILEREAD_Silent)) {
+		LOG("Missing Shader File %s", *fileName);
+		return false;
+	}
+
+	// The key covers the source, the entry point, the profile, the flags and the defines. Includes are not followed
+	FString key = FString::Printf(TEXT("%d|%s|%s|%u|%s"), ShaderCacheVersion, ANSI_TO_TCHAR(entryPoint), ANSI_TO_TCHAR(profile),
+		ShaderCompileFlags, *FString::Join(aDefines, TEXT(";")));
+	FSHA1 sha;
+	sha.Update(source.GetData(), source.Num());
+	sha.UpdateWithString(*key, key.Len());
+	sha.Final();
+	FSHAHash hash;
+	sha.GetHash(hash.Hash);
+
+	FString cacheFileName = FPaths::Combine(FPaths::ProjectSavedDir(), FString("DXRenderShaderCache"),
+		FString::Printf(TEXT("%s_%s_%s.cso"), *FPaths::GetBaseFilename(fileName), ANSI_TO_TCHAR(entryPoint), *hash.ToString()));
+	if (FFileHelper::LoadFileToArray(outBytecode, *cacheFileName, FILEREAD_Silent) && outBytecode.Num() > 0) {
+		return true;
+	}
+
+	// NAME or NAME=VALUE, the strings have to outlive the compile
+	TArray<TArray<ANSICHAR>> aMacroStrings;
+	for (const FString& define : aDefines) {
+		FString name = define;
+		FString value = FString("1");
+		define.Split(TEXT("="), &name, &value);
+		for (const FString& part : { name, value }) {
+			FTCHARToUTF8 converted(*part);
+			TArray<ANSICHAR>& macroString = aMacroStrings[aMacroStrings.AddDefaulted()];
+			macroString.Append(converted.Get(), converted.Length() + 1);
+		}
+	}
+	TArray<D3D_SHADER_MACRO> aMacros;
+	for (int i = 0; i < aMacroStrings.Num(); i += 2) {
+		aMacros.Add(D3D_SHADER_MACRO{ aMacroStrings[i].GetData(), aMacroStrings[i + 1].GetData() });
+	}
+	aMacros.Add(D3D_SHADER_MACRO{ NULL, NULL });
+
+	ID3DBlob* shaderBuffer = 0;
+	ID3DBlob* errorMessage = 0;
+	FTCHARToUTF8 sourceName(*fileName);
+	HRESULT result = D3DCompile(source.GetData(), source.Num(), sourceName.Get(), aMacros.GetData(), NULL, entryPoint, profile,
+		ShaderCompileFlags, 0, &shaderBuffer, &errorMessage);
+	if (FAILED(result)) {
+		if (errorMessage) {
+			OutputShaderErrorMessage(errorMessage, *fileName);
+		}
+		else {
+			LOG("Compile Shader Fail %s", *fileName);
+		}
+		return false;
+	}
+	SAFE_RELEASE(errorMessage);
+
+	outBytecode.SetNumUninitialized(shaderBuffer->GetBufferSize());
+	FMemory::Memcpy(outBytecode.GetData(), shaderBuffer->GetBufferPointer(), shaderBuffer->GetBufferSize());
+	SAFE_RELEASE(shaderBuffer);
+
+	if (!FFileHelper::SaveArrayToFile(outBytecode, *cacheFileName)) {
+		LOG("Save Shader Cache Fail %s", *cacheFileName);
+	}
+	LOG("Compile Shader %s", *cacheFileName);
+	return true;
+}
+
 void ShaderManager::OutputShaderErrorMessage(ID3D10Blob * errorMessage, const WCHAR * shaderFilename)
 {
 	char* compileErrors;
@@ -161,13 +247,33 @@ void ShaderManager::OutputShaderErrorMessage(ID3D10Blob * errorMessage, const WC
 	errorMessage = 0;
 }
 
+void ShaderManager::SetShadowPass(bool bShadow)
+{
+	auto context = GetDXManagerInstance()->GetContext();
+	if (bShadow && pShadowVertexShader) {
+		// Depth only, no pixel shader
+		context->IASetInputLayout(pShadowInputLayout);
+		context->VSSetShader(pShadowVertexShader, NULL, 0);
+		context->PSSetShader(NULL, NULL, 0);
+	}
+	else {
+		context->IASetInputLayout(pInputLayout);
+		context->VSSetShader(pVertexShader, NULL, 0);
+		context->PSSetShader(pPixelShader, NULL, 0);
+	}
+}
+
 void ShaderManager::Destroy()
 {
 	SAFE_RELEASE(pVertexShader);
+	SAFE_RELEASE(pShadowVertexShader);
+	SAFE_RELEASE(pShadowInputLayout);
 	SAFE_RELEASE(pPixelShader);
 	SAFE_RELEASE(pInputLayout);
 	SAFE_RELEASE(pVSConstBuffer);
 	SAFE_RELEASE(pPSConstBuffer);
+	SAFE_RELEASE(pInstanceBuffer);
+	mInstanceCapacity = 0;
 	delete VSConstBuffer;
 	VSConstBuffer = 0;
 	delete PSConstBuffer;
@@ -178,39 +284,82 @@ bool ShaderManager::UpdateShaderParameters()
 {
 	HRESULT result;
 	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	VSBufferType* VSdataPtr;
-	PSBufferType* PSdataPtr;
-	unsigned int bufferNumber;
 
+	// Both buffers stay bound from Initialize, an unchanged buffer needs no work at all
+	if (!bVSUploaded || memcmp(&mUploadedVS, VSConstBuffer, sizeof(VSBufferType)) != 0) {
+		result = GetDXManagerInstance()->GetContext()->Map(pVSConstBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+		RETURN_FALSE_IF_ERROR(result, MapVSBufferFail);
 
-	result = GetDXManagerInstance()->GetContext()->Map(pVSConstBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	RETURN_FALSE_IF_ERROR(result, MapVSBufferFail);
-
-	VSdataPtr = (VSBufferType*)mappedResource.pData;
-	memcpy(VSdataPtr, VSConstBuffer, sizeof(VSBufferType));
+		memcpy(mappedResource.pData, VSConstBuffer, sizeof(VSBufferType));
+		GetDXManagerInstance()->GetContext()->Unmap(pVSConstBuffer, 0);
+		mUploadedVS = *VSConstBuffer;
+		bVSUploaded = true;
+		FrameStats::AddConstantBufferBytes(sizeof(VSBufferType));
+	}
 
-	GetDXManagerInstance()->GetContext()->Unmap(pVSConstBuffer, 0);
+	if (!bPSUploaded || memcmp(&mUploadedPS, PSConstBuffer, sizeof(PSBufferType)) != 0) {
+		result = GetDXManagerInstance()->GetContext()->Map(pPSConstBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+		RETURN_FALSE_IF_ERROR(result, MapPSBufferFail);
 
-	bufferNumber = 0;
+		memcpy(mappedResource.pData, PSConstBuffer, sizeof(PSBufferType));
+		GetDXManagerInstance()->GetContext()->Unmap(pPSConstBuffer, 0);
+		mUploadedPS = *PSConstBuffer;
+		bPSUploaded = true;
+		FrameStats::AddConstantBufferBytes(sizeof(PSBufferType));
+	}
+	return true;
+}
 
-	GetDXManagerInstance()->GetContext()->VSSetConstantBuffers(bufferNumber, 1, &pVSConstBuffer);
+bool ShaderManager::UpdateInstanceData()
+{
+	const TArray<InstanceType>& instances = InstanceData;
+	HRESULT result;
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
 
+	if (instances.Num() == 0) {
+		return true;
+	}
 
-	result = GetDXManagerInstance()->GetContext()->Map(pPSConstBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	RETURN_FALSE_IF_ERROR(result, MapPSBufferFail);
+	if (instances.Num() > mInstanceCapacity) {
+		SAFE_RELEASE(pInstanceBuffer);
+		mInstanceCapacity = FMath::RoundUpToPowerOfTwo(instances.Num());
+
+		D3D11_BUFFER_DESC instanceBufferDesc;
+		INIT_MEMORY(instanceBufferDesc);
+		instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		instanceBufferDesc.ByteWidth = sizeof(InstanceType) * mInstanceCapacity;
+		instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instanceBufferDesc.MiscFlags = 0;
+		instanceBufferDesc.StructureByteStride = 0;
+
+		result = GetDXManagerInstance()->GetDevice()->CreateBuffer(&instanceBufferDesc, NULL, &pInstanceBuffer);
+		if (FAILED(result)) {
+			mInstanceCapacity = 0;
+		}
+		RETURN_FALSE_IF_ERROR(result, CreateInstanceBuffer);
+	}
 
-	PSdataPtr = (PSBufferType*)mappedResource.pData;
-	memcpy(PSdataPtr, PSConstBuffer, sizeof(PSBufferType));
+	// Bound every frame, the occlusion pass draws from its own instance buffer in the same slot
+	uint32 stride = sizeof(InstanceType);
+	uint32 offset = 0;
+	GetDXManagerInstance()->GetContext()->IASetVertexBuffers(1, 1, &pInstanceBuffer, &stride, &offset);
 
-	GetDXManagerInstance()->GetContext()->Unmap(pPSConstBuffer, 0);
+	result = GetDXManagerInstance()->GetContext()->Map(pInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	RETURN_FALSE_IF_ERROR(result, MapInstanceBufferFail);
 
-	bufferNumber = 0;
+	memcpy(mappedResource.pData, instances.GetData(), sizeof(InstanceType) * instances.Num());
+	FrameStats::AddUploadBytes(sizeof(InstanceType) * instances.Num());
 
-	GetDXManagerInstance()->GetContext()->PSSetConstantBuffers(bufferNumber, 1, &pPSConstBuffer);
+	GetDXManagerInstance()->GetContext()->Unmap(pInstanceBuffer, 0);
 	return true;
 }
 
-void ShaderManager::Render(uint32 indexCount, uint32 startIndex)
+void ShaderManager::Render(uint32 indexCount, uint32 startIndex, uint32 baseVertex, uint32 instanceCount, uint32 startInstance, ID3D11DeviceContext* context)
 {
-	GetDXManagerInstance()->GetContext()->DrawIndexed(indexCount, startIndex, 0);
+	if (!context) {
+		context = GetDXManagerInstance()->GetContext();
+	}
+	context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	FrameStats::AddDraw(indexCount / 3 * instanceCount);
 }
\ No newline at end of file
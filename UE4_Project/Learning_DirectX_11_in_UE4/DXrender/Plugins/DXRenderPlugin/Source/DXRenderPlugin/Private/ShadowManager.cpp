@@ -0,0 +1,169 @@
+#include "ShadowManager.h"
+#include "DXManager.h"
+#include "Util.h"
+
+// After the texture groups in t0 - t3
+static const int ShadowMapSlot = 4;
+static const int ShadowSamplerSlot = 1;
+
+bool ShadowManager::Initialize(int size)
+{
+	HRESULT result;
+	D3D11_TEXTURE2D_DESC textureDesc;
+	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
+	D3D11_SAMPLER_DESC samplerStateDesc;
+	D3D11_RASTERIZER_DESC rasterStateDesc;
+	mSize = size;
+
+	auto device = GetDXManagerInstance()->GetDevice();
+
+	// 0.Create the shadow maps, typeless so they can be both depth target and shader resource
+	INIT_MEMORY(textureDesc);
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	textureDesc.Height = size;
+	textureDesc.Width = size;
+	textureDesc.MipLevels = 1;
+	textureDesc.MiscFlags = 0;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	INIT_MEMORY(depthStencilViewDesc);
+	depthStencilViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	depthStencilViewDesc.Texture2D.MipSlice = 0;
+
+	INIT_MEMORY(shaderResourceViewDesc);
+	shaderResourceViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	shaderResourceViewDesc.Texture2D.MipLevels = 1;
+	shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
+
+	for (int i = 0; i < ShadowMapCount; i++) {
+		result = device->CreateTexture2D(&textureDesc, nullptr, &pShadowTextures[i]);
+		RETURN_FALSE_IF_ERROR(result, CreateShadowTexture);
+
+		result = device->CreateDepthStencilView(pShadowTextures[i], &depthStencilViewDesc, &pShadowDepthViews[i]);
+		RETURN_FALSE_IF_ERROR(result, CreateShadowDepthStencilView);
+
+		result = device->CreateShaderResourceView(pShadowTextures[i], &shaderResourceViewDesc, &pShadowResourceViews[i]);
+		RETURN_FALSE_IF_ERROR(result, CreateShadowShaderResourceView);
+
+		// An empty map is fully lit
+		GetDXManagerInstance()->GetContext()->ClearDepthStencilView(pShadowDepthViews[i], D3D11_CLEAR_DEPTH, 1.0f, 0);
+	}
+
+	// 1.Create the comparison sampler, outside the map is lit
+	INIT_MEMORY(samplerStateDesc);
+	samplerStateDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerStateDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerStateDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerStateDesc.BorderColor[0] = 1.0f;
+	samplerStateDesc.BorderColor[1] = 1.0f;
+	samplerStateDesc.BorderColor[2] = 1.0f;
+	samplerStateDesc.BorderColor[3] = 1.0f;
+	samplerStateDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+	samplerStateDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	samplerStateDesc.MaxAnisotropy = 1;
+	samplerStateDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	samplerStateDesc.MinLOD = 0;
+	samplerStateDesc.MipLODBias = 0.0f;
+
+	result = device->CreateSamplerState(&samplerStateDesc, &pComparisonSampler);
+	RETURN_FALSE_IF_ERROR(result, CreateComparisonSampler);
+
+	// 2.Create the RasterizerState of the shadow pass, the bias keeps the surfaces from shadowing themselves
+	INIT_MEMORY(rasterStateDesc);
+	rasterStateDesc.AntialiasedLineEnable = false;
+	rasterStateDesc.CullMode = D3D11_CULL_BACK;
+	rasterStateDesc.DepthBias = 1000;
+	rasterStateDesc.DepthBiasClamp = 0.0f;
+	rasterStateDesc.DepthClipEnable = true;
+	rasterStateDesc.FillMode = D3D11_FILL_SOLID;
+	rasterStateDesc.FrontCounterClockwise = false;
+	rasterStateDesc.MultisampleEnable = false;
+	rasterStateDesc.ScissorEnable = false;
+	rasterStateDesc.SlopeScaledDepthBias = 2.0f;
+
+	result = device->CreateRasterizerState(&rasterStateDesc, &pShadowRasterState);
+	RETURN_FALSE_IF_ERROR(result, CreateShadowRasterizerState);
+
+	D3DXMatrixIdentity(&mLightViewProjection);
+	BindShadowMaps();
+	bInitialized = true;
+	LOG("ShadowManager Initialize Success");
+	return true;
+}
+
+void ShadowManager::Destroy()
+{
+	for (int i = 0; i < ShadowMapCount; i++) {
+		SAFE_RELEASE(pShadowResourceViews[i]);
+		SAFE_RELEASE(pShadowDepthViews[i]);
+		SAFE_RELEASE(pShadowTextures[i]);
+	}
+	SAFE_RELEASE(pComparisonSampler);
+	SAFE_RELEASE(pShadowRasterState);
+	SAFE_RELEASE(pSavedRasterState);
+	bInitialized = false;
+}
+
+void ShadowManager::SetLight(const D3DXVECTOR3& direction, const D3DXVECTOR3& center, float radius)
+{
+	D3DXVECTOR3 forward;
+	D3DXVec3Normalize(&forward, &direction);
+	radius = FMath::Max(radius, 0.01f);
+
+	// Any up vector that isn't parallel to the light
+	D3DXVECTOR3 up = FMath::Abs(forward.y) > 0.99f ? D3DXVECTOR3(0.0f, 0.0f, 1.0f) : D3DXVECTOR3(0.0f, 1.0f, 0.0f);
+	D3DXVECTOR3 position = center - forward * (radius * 2.0f);
+
+	D3DXMATRIX viewMatrix, projectionMatrix;
+	D3DXMatrixLookAtLH(&viewMatrix, &position, &center, &up);
+	D3DXMatrixOrthoLH(&projectionMatrix, radius * 2.0f, radius * 2.0f, radius, radius * 3.0f);
+	D3DXMatrixMultiply(&mLightViewProjection, &viewMatrix, &projectionMatrix);
+}
+
+void ShadowManager::BeginPass(ShadowMap map)
+{
+	if (!bInitialized) {
+		return;
+	}
+	auto context = GetDXManagerInstance()->GetContext();
+
+	// A map can't be read and written at once
+	ID3D11ShaderResourceView* nullViews[ShadowMapCount] = {};
+	context->PSSetShaderResources(ShadowMapSlot, ShadowMapCount, nullViews);
+
+	if (!pSavedRasterState) {
+		context->RSGetState(&pSavedRasterState);
+	}
+	context->RSSetState(pShadowRasterState);
+	context->OMSetRenderTargets(0, nullptr, pShadowDepthViews[map]);
+	context->ClearDepthStencilView(pShadowDepthViews[map], D3D11_CLEAR_DEPTH, 1.0f, 0);
+	GetDXManagerInstance()->SetViewport(mSize, mSize);
+}
+
+void ShadowManager::EndPass()
+{
+	if (!bInitialized) {
+		return;
+	}
+	auto context = GetDXManagerInstance()->GetContext();
+	context->RSSetState(pSavedRasterState);
+	SAFE_RELEASE(pSavedRasterState);
+	GetDXManagerInstance()->SetRenderTargetView(GetDXManagerInstance()->GetRenderTargetView());
+	GetDXManagerInstance()->ResetViewport();
+	BindShadowMaps();
+}
+
+void ShadowManager::BindShadowMaps()
+{
+	auto context = GetDXManagerInstance()->GetContext();
+	context->PSSetShaderResources(ShadowMapSlot, ShadowMapCount, pShadowResourceViews);
+	context->PSSetSamplers(ShadowSamplerSlot, 1, &pComparisonSampler);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Windows/MinWindows.h"
+#include "d3d11.h"
+#include "Async/Future.h"
+
+// Offscreen frames on their way to disk. Each capture is copied into a staging texture, mapped once
+// the GPU has finished it and encoded on the thread pool, so several frames are in flight at once
+class DXRENDERPLUGIN_API BatchCapture
+{
+public:
+	bool Initialize(int width, int height, DXGI_FORMAT format, int framesInFlight);
+	// Waits for every frame still in flight and every file still being written
+	void Destroy();
+	// Returns false when every staging texture is still in flight, Poll first
+	bool Capture(ID3D11Texture2D* source, const FString& fileName, bool bEXR);
+	// Maps the finished copies in order, bWait blocks on the oldest one
+	void Poll(bool bWait);
+	bool HasFreeSlot() { return iPending < aSlots.Num(); }
+	int GetPendingCount() { return iPending; }
+	// Files handed to the thread pool and not written yet
+	int GetWritingCount();
+
+private:
+	struct CaptureSlot
+	{
+		ID3D11Texture2D* pStagingTexture;
+		FString fileName;
+		bool bEXR;
+	};
+
+	void WriteImage(TArray<uint8>&& pixels, const FString& fileName, bool bEXR);
+
+	bool bInitialized = false;
+	int mWidth = 0;
+	int mHeight = 0;
+	bool bBGRA = false;
+	TArray<CaptureSlot> aSlots;
+	int iWrite = 0;
+	int iPending = 0;
+	TArray<TFuture<void>> aWrites;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Windows/MinWindows.h"
+#include "d3d11.h"
+
+// The one D3D11 device of the process. The plugin's DXManager and the DXRender game module's D3DManager
+// both take it from here, so their buffers, textures and shaders live on the same device and can be
+// shared. Every Acquire adds a reference to the device and the context, Release gives it back
+class DXRENDERPLUGIN_API DXDevice
+{
+public:
+	static bool Acquire(ID3D11Device*& outDevice, ID3D11DeviceContext*& outContext);
+	// Releases and clears both pointers, the device goes away with its last user
+	static void Release(ID3D11Device*& device, ID3D11DeviceContext*& context);
+	// More than one user means the immediate context state may have been changed between two frames
+	static int GetUserCount() { return UserCount; }
+
+private:
+	static ID3D11Device* pDevice;
+	static ID3D11DeviceContext* pDeviceContext;
+	static int UserCount;
+};
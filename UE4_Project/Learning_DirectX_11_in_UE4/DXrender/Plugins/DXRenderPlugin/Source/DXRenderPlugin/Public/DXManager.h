@@ -10,28 +10,85 @@
 class DXRENDERPLUGIN_API DXManager
 {
 public:
+	// The immediate context's bindings, taken on the game thread and replayed into deferred contexts,
+	// which start every command list from the default state
+	struct PipelineState
+	{
+		ID3D11Buffer* vertexBuffers[2];
+		UINT strides[2];
+		UINT offsets[2];
+		ID3D11Buffer* indexBuffer;
+		DXGI_FORMAT indexFormat;
+		UINT indexOffset;
+		ID3D11InputLayout* inputLayout;
+		D3D11_PRIMITIVE_TOPOLOGY topology;
+		ID3D11VertexShader* vertexShader;
+		ID3D11PixelShader* pixelShader;
+		ID3D11Buffer* VSConstBuffer;
+		ID3D11Buffer* PSConstBuffer;
+		// The texture groups and the two shadow maps
+		ID3D11ShaderResourceView* shaderResourceViews[6];
+		ID3D11SamplerState* samplerStates[2];
+		ID3D11RasterizerState* rasterState;
+		D3D11_VIEWPORT viewport;
+		ID3D11RenderTargetView* renderTargetView;
+		ID3D11DepthStencilView* depthStencilView;
+		ID3D11DepthStencilState* depthStencilState;
+		UINT stencilRef;
+		ID3D11BlendState* blendState;
+		float blendFactor[4];
+		UINT sampleMask;
+	};
+
 	bool Initialize(int width, int height);
 	void Destroy();
 	void InitializeScene(float r, float g, float b, float a);
+	// EndFrame keeps the immediate context's bindings, BeginFrame restores them when another user shares the device
+	void BeginFrame();
+	void EndFrame();
 	ID3D11Device* GetDevice() { return pDevice; }
 	ID3D11DeviceContext* GetContext() { return pDeviceContext; }
 	ID3D11RenderTargetView* GetRenderTargetView() { return pCurrentRTV; }
 	ID3D11DepthStencilView* GetDepthStencilView() { return pDepthStencilView; }
+	// Only readable while the depth buffer is not bound as the target
+	ID3D11ShaderResourceView* GetDepthResourceView() { return pDepthResourceView; }
+	int GetWidth() { return mWidth; }
+	int GetHeight() { return mHeight; }
 	void SetRenderTargetView(ID3D11RenderTargetView* target);
+	void SetViewport(int width, int height);
+	// The top left part of the render target the scene is drawn into, the whole target unless the resolution is scaled
+	void SetSceneViewport(int width, int height);
+	int GetSceneWidth() { return mSceneWidth; }
+	int GetSceneHeight() { return mSceneHeight; }
+	// Back to the scene viewport
+	void ResetViewport() { SetViewport(mSceneWidth, mSceneHeight); }
 	void TurnOnZBuffer();
 	void TurnOffZBuffer();
 	void TurnOnAlphaBlend();
 	void TurnOffAlphaBlend();
 
+	// Contexts for recording on worker threads, each one may only be used by one thread at a time
+	bool CreateDeferredContexts(int count);
+	int GetDeferredContextCount() { return aDeferredContexts.Num(); }
+	ID3D11DeviceContext* GetDeferredContext(int index) { return aDeferredContexts[index]; }
+	void CapturePipelineState(PipelineState& state);
+	void ApplyPipelineState(ID3D11DeviceContext* context, const PipelineState& state);
+	void ReleasePipelineState(PipelineState& state);
+
 
 private:
 	bool bIntialized = false;
+	int mWidth = 0;
+	int mHeight = 0;
+	int mSceneWidth = 0;
+	int mSceneHeight = 0;
 
 	ID3D11Device* pDevice = 0;
 	ID3D11DeviceContext* pDeviceContext = 0;
 
 	ID3D11Texture2D* pDepthStencilTexture = 0;
 	ID3D11DepthStencilView* pDepthStencilView = 0;
+	ID3D11ShaderResourceView* pDepthResourceView = 0;
 	ID3D11DepthStencilState* pDepthEnableStencilState = 0;
 	ID3D11DepthStencilState* pDepthDisableStencilState = 0;
 	ID3D11BlendState* pAlphaEnableBlendingState;
@@ -40,6 +97,9 @@ private:
 	ID3D11RasterizerState* pRasterState = 0;
 
 	ID3D11RenderTargetView* pCurrentRTV = 0;
+	TArray<ID3D11DeviceContext*> aDeferredContexts;
+	PipelineState mSharedState;
+	bool bSharedStateValid = false;
 };
 
 static DXManager* DXManagerInstance = 0;
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "Stats/Stats.h"
+
+// "stat DXRender" in the console
+DECLARE_STATS_GROUP(TEXT("DXRender"), STATGROUP_DXRender, STATCAT_Advanced);
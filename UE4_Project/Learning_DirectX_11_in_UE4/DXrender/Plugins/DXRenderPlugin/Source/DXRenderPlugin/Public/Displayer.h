@@ -4,14 +4,15 @@
 #include "dxgi.h"
 #include "d3dcommon.h"
 #include "d3d11.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Containers/LockFreeList.h"
+#include "RHI.h"
 
-struct FUpdateTextureRegionsData
+// One frame of pixels on its way to the render thread, handed back to the free list once uploaded
+struct FDisplayerUploadSlot
 {
-	class FTextureRenderTarget2DResource* TextureResource;
-	struct FUpdateTextureRegion2D* Regions;
-	uint32 SrcPitch;
-	uint32 SrcBpp;
-	uint8* SrcData;
+	FUpdateTextureRegion2D Region;
+	TArray<uint8> PixelData;
 };
 
 class UTextureRenderTarget2D;
@@ -20,21 +21,43 @@ class DXRENDERPLUGIN_API Displayer
 {
 
 public:
-	bool Initialize(int width, int height, UTextureRenderTarget2D* inURenderTarget);
+	// readbackLatency is the number of frames the readback may lag behind, 0 waits for the GPU every frame.
+	// Without a UE render target only the DX render target is created, Display does nothing
+	bool Initialize(int width, int height, UTextureRenderTarget2D* inURenderTarget, int readbackLatency = 2);
 	void Destroy();
 	void Display();
 	ID3D11RenderTargetView * GetRenderTargetView() { return this->pRenderTargetView; }
+	ID3D11Texture2D* GetRenderTargetTexture() { return this->pRenderTargetTexture; }
+	DXGI_FORMAT GetFormat() { return this->mFormat; }
 
 private:
-	bool CopyDXResource();
-	void RenderTexture();
+	// pixelData may be null, the finished copies are then consumed without being read
+	bool CopyDXResource(uint8* pixelData);
+	void RenderTexture(FDisplayerUploadSlot* slot);
+	void CopySharedTexture();
 
 	bool bInitialized = false;
 	UTextureRenderTarget2D* pUERenderTarget = 0;
-	TArray<uint8> aPixelData;
-
-	ID3D11Texture2D* pStagingTexture = 0;
+	DXGI_FORMAT mFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	TArray<TUniquePtr<FDisplayerUploadSlot>> aUploadSlots;
+	TLockFreePointerListUnordered<FDisplayerUploadSlot, PLATFORM_CACHE_LINE_SIZE> freeUploadSlots;
+	int iPixelBytes = 0;
+
+	// Ring of readback copies, the oldest pending copies are mapped once the GPU has finished them
+	TArray<ID3D11Texture2D*> aStagingTextures;
+	int iStagingWrite = 0;
+	int iStagingPending = 0;
+	int iReadbackLatency = 0;
+	int iRowBytes = 0;
 	ID3D11Texture2D* pRenderTargetTexture = 0;
 	ID3D11RenderTargetView* pRenderTargetView = 0;
 
+	// The render target texture is shared with UE's D3D11 device and copied on the GPU,
+	// the staging readback is only used when UE runs another RHI or a different format
+	FThreadSafeBool bUseSharedTexture = false;
+	HANDLE hSharedHandle = 0;
+	// Opened on UE's device, only touched on the rendering thread
+	ID3D11Texture2D* pUESharedTexture = 0;
+
 };
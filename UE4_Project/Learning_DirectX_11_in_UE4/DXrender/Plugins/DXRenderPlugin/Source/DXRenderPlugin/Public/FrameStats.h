@@ -0,0 +1,86 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformAtomics.h"
+#include "HAL/PlatformTime.h"
+
+// What one DX frame did, filled while the frame renders
+struct FrameStatsRecord
+{
+	enum Stage
+	{
+		CullStage,
+		ShadowStage,
+		// Includes the shadow stage
+		SubmitStage,
+		DisplayStage,
+		BatchStage,
+		StageCount
+	};
+
+	uint64 frame;
+	int32 drawCalls;
+	int32 triangles;
+	int32 constantBufferBytes;
+	// Instance, geometry and texture data written to the GPU
+	int32 uploadBytes;
+	// Staging textures mapped for the CPU
+	int32 readbackBytes;
+	int64 textureBytes;
+	float cpuMs[StageCount];
+	// GPUProfiler reads its queries back a few frames late, these are the newest it had
+	float gpuClearMs;
+	float gpuDrawMs;
+	float gpuCopyMs;
+};
+
+// Ring of the last frames' records, off until Enable. The counters are atomic since the deferred contexts
+// record their draws on worker threads, everything else is game thread only.
+// "DXRender.DumpFrameStats [file]" in the console writes the ring as CSV
+class DXRENDERPLUGIN_API FrameStats
+{
+public:
+	// Adds the time of the scope to a stage of the current frame
+	struct ScopedStage
+	{
+		ScopedStage(FrameStatsRecord::Stage inStage) : stage(inStage), start(FPlatformTime::Seconds()) {}
+		~ScopedStage() { AddStageTime(stage, (float)((FPlatformTime::Seconds() - start) * 1000.0)); }
+
+		FrameStatsRecord::Stage stage;
+		double start;
+	};
+
+	static void Enable(int history);
+	static void Disable();
+	static bool IsEnabled() { return bEnabled; }
+
+	static void AddDraw(int32 triangles)
+	{
+		if (bEnabled) {
+			FPlatformAtomics::InterlockedIncrement(&Current.drawCalls);
+			FPlatformAtomics::InterlockedAdd(&Current.triangles, triangles);
+		}
+	}
+	static void AddConstantBufferBytes(int32 bytes) { if (bEnabled) { FPlatformAtomics::InterlockedAdd(&Current.constantBufferBytes, bytes); } }
+	static void AddUploadBytes(int32 bytes) { if (bEnabled) { FPlatformAtomics::InterlockedAdd(&Current.uploadBytes, bytes); } }
+	static void AddReadbackBytes(int32 bytes) { if (bEnabled) { FPlatformAtomics::InterlockedAdd(&Current.readbackBytes, bytes); } }
+	static void AddStageTime(FrameStatsRecord::Stage stage, float ms) { if (bEnabled) { Current.cpuMs[stage] += ms; } }
+	static void SetTextureBytes(int64 bytes) { Current.textureBytes = bytes; }
+	static void SetGPUTimes(float clearMs, float drawMs, float copyMs);
+
+	// Closes the current frame into the ring and starts the next one
+	static void EndFrame();
+	// Newest closed frame, null before the first
+	static const FrameStatsRecord* GetLatest();
+	// Closed frames, oldest first
+	static void GetHistory(TArray<FrameStatsRecord>& outRecords);
+	static bool DumpCSV(const FString& fileName);
+
+private:
+	static bool bEnabled;
+	static FrameStatsRecord Current;
+	static TArray<FrameStatsRecord> aHistory;
+	static int iNext;
+	static int Count;
+	static uint64 FrameNumber;
+};
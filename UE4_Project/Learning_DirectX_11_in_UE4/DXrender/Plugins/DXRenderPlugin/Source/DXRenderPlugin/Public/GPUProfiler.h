@@ -0,0 +1,43 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Windows/MinWindows.h"
+#include "d3d11.h"
+
+// Timestamp queries between the stages of a DX frame, read back a few frames later without stalling
+class DXRENDERPLUGIN_API GPUProfiler
+{
+public:
+	enum Marker
+	{
+		FrameBegin,
+		ClearEnd,
+		DrawEnd,
+		CopyEnd,
+		MarkerCount
+	};
+
+	bool Initialize();
+	void Destroy();
+	void BeginFrame();
+	void Mark(Marker marker);
+	// Reads back the oldest finished frame, returns true when new timings are available
+	bool EndFrame();
+	// Milliseconds from the previous marker to this one, in the newest frame read back
+	float GetTime(Marker marker) { return aTimes[marker]; }
+
+private:
+	// Frames in flight, a frame still unfinished when its queries come round again is dropped
+	static const int FrameLatency = 4;
+
+	struct FrameQueries
+	{
+		ID3D11Query* pDisjoint;
+		ID3D11Query* pTimestamps[MarkerCount];
+		bool bIssued;
+	};
+
+	bool bInitialized = false;
+	FrameQueries aFrames[FrameLatency] = {};
+	int iFrame = 0;
+	float aTimes[MarkerCount] = {};
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "CoreMinimal.h"
+#include "PixelFormat.h"
 #include "Windows/MinWindows.h"
 #include <d3d11.h>
 #include <d3dx10math.h>
@@ -8,38 +9,127 @@ struct GeometryMetaData
 {
 	uint32 startIndex;
 	uint32 length;
+	uint32 baseVertex;
+	uint32 vertexCount;
+	// Bounding sphere in mesh space
+	D3DXVECTOR3 boundsCenter;
+	float boundsRadius;
+	// Geometry of the next coarser LOD of the mesh, -1 for the last one. The objects all refer to LOD 0
+	int nextLOD;
+	// UE's screen size of this LOD, it is drawn once the object's screen size drops below it
+	float screenSize;
 };
 
+// First fit sub-allocator of a buffer, freed ranges are merged with their neighbours
+class DXRENDERPLUGIN_API GeometryRangeAllocator
+{
+public:
+	void Reset(uint32 inCapacity);
+	// Returns -1 when no free range is large enough
+	int32 Allocate(uint32 count);
+	void Free(uint32 start, uint32 count);
+	void Grow(uint32 newCapacity);
+	uint32 GetCapacity() { return mCapacity; }
+
+private:
+	struct FreeRange
+	{
+		uint32 start;
+		uint32 count;
+	};
+
+	// Sorted by start
+	TArray<FreeRange> aFreeRanges;
+	uint32 mCapacity = 0;
+};
+
+// One Texture2DArray per texture size and format, the shader binds them to t0 - t3
+static const int MaxTextureGroups = 4;
+
 class DXRENDERPLUGIN_API GeometryDataManager
 {
 private:
+	struct TextureGroup
+	{
+		int width;
+		int height;
+		EPixelFormat pixelFormat;
+		int mipCount;
+		int count;
+		int capacity;
+		TArray<int> aFreeSlices;
+		// Mips of the slices added before Intialize, slice * mipCount + mip
+		TArray<TArray<uint8>> aStagedMips;
+		ID3D11Texture2D* pTexture;
+		ID3D11ShaderResourceView* pShaderResourceView;
+	};
+
+	// 24 bytes, normal and tangent are 10:10:10:2 unorm with the binormal sign in the tangent's w,
+	// the shader derives the binormal from them
 	struct VertexAttribute
 	{
 		D3DXVECTOR3 position;
-		D3DXVECTOR3 normal;
-		D3DXVECTOR3 binormal;
-		D3DXVECTOR3 tanget;
-		D3DXVECTOR2 uv;
+		uint32 normal;
+		uint32 tangent;
+		uint16 uv[2];
 	};
 
 public:
+	GeometryDataManager();
+
 	bool Intialize();
 	void Destroy();
-	void AddGeometryData(struct FStaticMeshLODResources * resource, class UTexture2D* inTexture);
+	// Objects using the same mesh share one geometry, the texture is kept per object. Every LOD of the mesh becomes
+	// a geometry of its own, chained from LOD 0 by nextLOD. Meshes added after Intialize are streamed into the buffers,
+	// returns the object index or -1
+	int AddGeometryData(struct FStaticMeshRenderData * renderData, class UTexture2D* inTexture);
+	// Geometry no object uses any more is evicted and its buffer ranges are reused
+	void RemoveObject(int objectIndex);
 	const GeometryMetaData* GetMetaData(int geometryIndex);
-	int GetObjectCount() { return aMetaData.Num(); }
+	// The geometry in the LOD chain of geometryIndex for an object covering screenSize, as UE picks its static mesh LODs
+	int SelectLOD(int geometryIndex, float screenSize);
+	// Object slots, removed objects leave a slot that the next added object takes
+	int GetObjectCount() { return aObjectGeometry.Num(); }
+	bool IsObjectValid(int objectIndex) { return aObjectGeometry.IsValidIndex(objectIndex) && aObjectGeometry[objectIndex] >= 0; }
+	int GetGeometryCount() { return aMetaData.Num(); }
+	const TArray<int>& GetGeometryObjects(int geometryIndex) { return aGeometryObjects[geometryIndex]; }
+	// The texture group in the high 16 bits, the slice in the group in the low 16 bits
+	uint32 GetTextureSlice(int objectIndex) { return aObjectTextureSlice[objectIndex]; }
+	// Video memory of the texture arrays, spare slices included
+	int64 GetTextureBytes();
 
 private:
-	int mTextureWidth = 0;
-	int mTextureHeight = 0;
+	int AddTexture(class UTexture2D* inTexture);
+	int FindTextureGroup(int width, int height, EPixelFormat pixelFormat, int mipCount);
+	bool CreateGroupTexture(TextureGroup& group);
+	void BindTextures();
+	static void ConvertVertices(const struct FStaticMeshVertexBuffers& vertexBuffers, TArray<VertexAttribute>& vertices);
+	// One LOD in its own buffer ranges, returns the geometry index or -1
+	int AddLOD(struct FStaticMeshLODResources * resource, float screenSize);
+	bool UploadGeometry(const GeometryMetaData& meta, const TArray<VertexAttribute>& vertices, const TArray<uint32>& indices);
+	bool GrowBuffer(ID3D11Buffer*& buffer, GeometryRangeAllocator& allocator, uint32 stride, uint32 required, UINT bindFlags);
+	void BindBuffers();
 
+	bool bInitialized = false;
+
+	// Staging for the geometry added before Intialize, laid out as in the buffers
 	TArray<VertexAttribute> aVertexData;
 	TArray<uint32> aIndexData;
+	GeometryRangeAllocator mVertexAllocator;
+	GeometryRangeAllocator mIndexAllocator;
+
 	TArray<GeometryMetaData> aMetaData;
-	TArray<uint8> aTexturePixelData;
+	TArray<TArray<int>> aGeometryObjects;
+	TMap<struct FStaticMeshRenderData*, int> mGeometryIndices;
+	TArray<int> aFreeGeometries;
+
+	TArray<int> aObjectGeometry;
+	TArray<uint32> aObjectTextureSlice;
+	TArray<bool> aObjectOwnsTexture;
+	TArray<int> aFreeObjects;
+
+	TArray<TextureGroup> aTextureGroups;
 
 	ID3D11Buffer * pVertexBuffer = 0;
 	ID3D11Buffer * pIndexBuffer = 0;
-	ID3D11ShaderResourceView* pTextureShaderResourceView = 0;
-	ID3D11Texture2D* pTextureArray = 0;
 };
@@ -0,0 +1,82 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Windows/MinWindows.h"
+#include <d3d11.h>
+#include <d3dx10math.h>
+#include "ShaderManager.h"
+
+// Hierarchical Z occlusion culling. The depth of the last frame is reduced into a max depth pyramid, a compute pass
+// tests the instances against it and compacts the visible ones, every batch is then drawn from indirect args
+// the compute pass filled in, so occluded instances cost no draw and batches with none left draw nothing
+class DXRENDERPLUGIN_API OcclusionCuller
+{
+public:
+	// 64 bytes, as the compute shader reads it
+	struct CullInstance
+	{
+		ShaderManager::InstanceType instance;
+		// World space bounding sphere
+		D3DXVECTOR4 bounds;
+		uint32 batch;
+	};
+
+	bool Initialize(int width, int height, ShaderManager* inShaderManager);
+	void Destroy();
+	// The instances in the order and the batches as the draws would take them, X is the geometry,
+	// Y the first instance and Z the instance count
+	bool Cull(const TArray<CullInstance>& instances, const TArray<FIntVector>& batches, class GeometryDataManager* geometry);
+	// One indirect draw per batch, with the compacted instances bound in place of the ShaderManager ones
+	void RenderBatches();
+	// After the frame's draws, the depth buffer is unbound while the pyramid is built. Row major as D3DX builds it
+	void BuildHiZ(const D3DXMATRIX& viewProjection);
+
+private:
+	struct HiZBufferType
+	{
+		uint32 inputSize[2];
+		uint32 outputSize[2];
+	};
+
+	struct OcclusionBufferType
+	{
+		D3DXMATRIX viewProjection;
+		float hizSize[2];
+		uint32 mipCount;
+		uint32 instanceCount;
+		uint32 hizValid;
+		uint32 padding[3];
+	};
+
+	bool GrowBuffers(int instanceCount, int batchCount);
+
+	bool bInitialized = false;
+	bool bHiZValid = false;
+	int mWidth = 0;
+	int mHeight = 0;
+	int mMipCount = 0;
+	int mInstanceCapacity = 0;
+	int mBatchCapacity = 0;
+	int mBatchCount = 0;
+	D3DXMATRIX mPrevViewProjection;
+	ShaderManager* pShaderManager = 0;
+	TArray<uint32> aDrawArgs;
+
+	ID3D11Texture2D* pHiZTexture = 0;
+	// One view per mip for the reduction, and one over the whole chain for the test
+	TArray<ID3D11UnorderedAccessView*> aHiZMipUAVs;
+	TArray<ID3D11ShaderResourceView*> aHiZMipSRVs;
+	ID3D11ShaderResourceView* pHiZResourceView = 0;
+
+	ID3D11ComputeShader* pCopyDepthShader = 0;
+	ID3D11ComputeShader* pDownsampleShader = 0;
+	ID3D11ComputeShader* pOcclusionShader = 0;
+	ID3D11Buffer* pHiZConstBuffer = 0;
+	ID3D11Buffer* pOcclusionConstBuffer = 0;
+
+	ID3D11Buffer* pInputBuffer = 0;
+	ID3D11ShaderResourceView* pInputResourceView = 0;
+	ID3D11Buffer* pInstanceBuffer = 0;
+	ID3D11UnorderedAccessView* pInstanceUAV = 0;
+	ID3D11Buffer* pArgsBuffer = 0;
+	ID3D11UnorderedAccessView* pArgsUAV = 0;
+};
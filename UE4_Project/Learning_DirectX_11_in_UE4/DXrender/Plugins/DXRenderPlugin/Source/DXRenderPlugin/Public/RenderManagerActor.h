@@ -4,8 +4,32 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Windows/MinWindows.h"
+#include <d3d11.h>
+#include <d3dx10math.h>
+#include "ShaderManager.h"
+#include "OcclusionCuller.h"
 #include "RenderManagerActor.generated.h"
 
+UENUM(BlueprintType)
+namespace EDXRenderImageFormat
+{
+	enum Type
+	{
+		PNG,
+		// 32 bit float RGBA, converted from the 8 bit render target
+		EXR,
+	};
+}
+
+struct FDXRenderBatchItem
+{
+	FTransform Pose;
+	float FOV;
+	FString FileName;
+	bool bEXR;
+};
+
 UCLASS()
 class DXRENDERPLUGIN_API ARenderManagerActor : public AActor
 {
@@ -18,13 +42,66 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// Streams the actor's mesh and texture in, spawned actors are registered automatically
+	UFUNCTION(BlueprintCallable, Category = "DXRender")
+	bool RegisterRenderableActor(class ARenderableActor* actor);
+
+	// Destroyed actors are removed automatically, a mesh no actor uses any more is evicted
+	UFUNCTION(BlueprintCallable, Category = "DXRender")
+	void UnregisterRenderableActor(class ARenderableActor* actor);
+
+	UFUNCTION(BlueprintPure, Category = "DXRender|Culling")
+	int GetVisibleObjectCount() const { return mVisibleCount; }
+
+	UFUNCTION(BlueprintPure, Category = "DXRender|Culling")
+	int GetCulledObjectCount() const { return mCulledCount; }
+
+	// Renders every pose offscreen over the next ticks and writes Frame_<index>.png or .exr into outputDirectory.
+	// FOV is in degrees, returns the number of poses queued
+	UFUNCTION(BlueprintCallable, Category = "DXRender|Batch")
+	int QueueBatchRender(const TArray<FTransform>& cameraPoses, float fov, const FString& outputDirectory, TEnumAsByte<EDXRenderImageFormat::Type> format);
+
+	// Poses not rendered yet
+	UFUNCTION(BlueprintPure, Category = "DXRender|Batch")
+	int GetBatchRemaining() const { return aBatchQueue.Num(); }
+
+	// The recorded frames oldest first, the same as "DXRender.DumpFrameStats" in the console
+	UFUNCTION(BlueprintCallable, Category = "DXRender|Stats")
+	bool DumpFrameStats(const FString& fileName);
+
+	// Share of the target's width and height the live view is drawn at, 1 without dynamic resolution
+	UFUNCTION(BlueprintPure, Category = "DXRender|Resolution")
+	float GetResolutionScale() const;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void BeginDestroy() override;
 
 	void FetchRenderableActor();
+	void OnActorSpawned(AActor* actor);
+	void UpdateRegisteredActors();
+	void UnregisterObject(int objectIndex);
+	void CullObjects(const D3DXMATRIX& viewProjectionMatrix, const D3DXMATRIX& projectionMatrix, const D3DXVECTOR3& viewPosition);
+	void SortVisibleObjects(const D3DXMATRIX& viewMatrix);
+	void AppendInstances(const TArray<int>& positions, TArray<FIntVector>& batches);
+	void RenderBatches(const TArray<FIntVector>& batches, int first, int last, ID3D11DeviceContext* context);
+	void RenderBatchesDeferred();
+	void RenderBatchesOccluded();
+	void PrepareShadows();
+	void RenderShadows();
+	void RenderLiveView();
+	void RenderView(const FVector& location, const FRotator& rotation, float fov, bool bLiveView);
+	void RenderBatchQueue();
+	void DrawFrameStats();
+
+	// Indexed by geometry object, removed objects leave a null entry
+	UPROPERTY()
 	TArray<class ARenderableActor *> aRenderableActor;
+	UPROPERTY()
+	TArray<class ARenderableActor *> aPendingActors;
+	FDelegateHandle spawnHandle;
 
 	UPROPERTY(EditAnywhere, Category = "DXRender", DisplayName = "Render Target")
 	class UTextureRenderTarget2D* pRenderTarget;
@@ -32,12 +109,145 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "DXRender", DisplayName = "Directional Light")
 	class ADirectionalLight* pDirectionalLight;
 
+	// Frames the CPU readback may lag behind the DX render, 0 waits for every frame. Unused when the texture is shared
+	UPROPERTY(EditAnywhere, Category = "DXRender", meta = (ClampMin = "0", ClampMax = "3"))
+	int ReadbackLatency = 2;
+
+	// Directional light shadows, Static mobility actors are cached until they or the light move. Off by default, it
+	// adds a depth pass over the dynamic actors every frame
+	UPROPERTY(EditAnywhere, Category = "DXRender|Shadow", meta = (EditConditionToggle))
+	bool bCastShadows = false;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Shadow", meta = (editcondition = "bCastShadows", ClampMin = "256", ClampMax = "8192"))
+	int ShadowMapSize = 2048;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Shadow", meta = (editcondition = "bCastShadows", ClampMin = "0", ClampMax = "1"))
+	float ShadowStrength = 1.0f;
+
+	// GPU timings of the clear, the draws and the copy out, shown with "stat DXRender". Off by default, the timestamp
+	// queries cost a readback every frame
+	UPROPERTY(EditAnywhere, Category = "DXRender")
+	bool bProfileGPU = false;
+
+	// Draws the live view into part of the render target, sized so the GPU time of the clear and the draws stays near
+	// TargetGPUTimeMs, and stretches it over the whole target. Turns the GPU timings on, the targets are never recreated
+	UPROPERTY(EditAnywhere, Category = "DXRender|Resolution", meta = (EditConditionToggle))
+	bool bDynamicResolution = false;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Resolution", meta = (editcondition = "bDynamicResolution", ClampMin = "0.5"))
+	float TargetGPUTimeMs = 8.0f;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Resolution", meta = (editcondition = "bDynamicResolution", ClampMin = "0.25", ClampMax = "1"))
+	float MinResolutionScale = 0.5f;
+
+	// Draw calls, triangles, uploads, readbacks and the CPU and GPU time of each stage, per frame for the last FrameStatsHistory frames
+	UPROPERTY(EditAnywhere, Category = "DXRender|Stats", meta = (EditConditionToggle))
+	bool bRecordFrameStats = false;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Stats", meta = (editcondition = "bRecordFrameStats", ClampMin = "1"))
+	int FrameStatsHistory = 600;
+
+	// The newest frame on screen
+	UPROPERTY(EditAnywhere, Category = "DXRender|Stats", meta = (editcondition = "bRecordFrameStats"))
+	bool bShowFrameStats = true;
+
+	// Shader permutation, NAME or NAME=VALUE. Each set is compiled once and then loaded from Saved/DXRenderShaderCache
+	UPROPERTY(EditAnywhere, Category = "DXRender")
+	TArray<FString> ShaderDefines;
+
+	// Objects whose bounding sphere is outside the camera frustum are not drawn
+	UPROPERTY(EditAnywhere, Category = "DXRender|Culling")
+	bool bFrustumCulling = true;
+
+	// Draws each object with the static mesh LOD UE would pick for its screen size, LOD 0 otherwise. Shadows use the same LOD
+	UPROPERTY(EditAnywhere, Category = "DXRender|Culling")
+	bool bMeshLODs = true;
+
+	// Draws the meshes and their instances nearest first, so less of the hidden surfaces gets shaded
+	UPROPERTY(EditAnywhere, Category = "DXRender|Culling")
+	bool bSortFrontToBack = true;
+
+	// Instances hidden behind the depth of the last frame are dropped on the GPU before they are drawn. Only the live view,
+	// the draws go through the immediate context then
+	UPROPERTY(EditAnywhere, Category = "DXRender|Culling")
+	bool bOcclusionCulling = false;
+
+	// Records the draws on worker threads into deferred contexts, the immediate context only executes the command lists
+	UPROPERTY(EditAnywhere, Category = "DXRender|Threading", meta = (EditConditionToggle))
+	bool bDeferredContexts = false;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Threading", meta = (editcondition = "bDeferredContexts", ClampMin = "1", ClampMax = "8"))
+	int DeferredContextCount = 4;
+
+	// Fewer draws than this per context are recorded on the immediate context instead
+	UPROPERTY(EditAnywhere, Category = "DXRender|Threading", meta = (editcondition = "bDeferredContexts", ClampMin = "1"))
+	int MinDrawsPerContext = 16;
+
+	// No render target and no live view, the actor only renders the batch queue
+	UPROPERTY(EditAnywhere, Category = "DXRender|Batch", meta = (EditConditionToggle))
+	bool bHeadless = false;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Batch", meta = (editcondition = "bHeadless"))
+	FIntPoint HeadlessResolution = FIntPoint(1920, 1080);
+
+	// Frames copied out and not mapped yet, more keeps the GPU busy while the CPU waits on older ones
+	UPROPERTY(EditAnywhere, Category = "DXRender|Batch", meta = (ClampMin = "1", ClampMax = "8"))
+	int BatchFramesInFlight = 3;
+
+	// Game thread time a tick may spend on the batch queue
+	UPROPERTY(EditAnywhere, Category = "DXRender|Batch", meta = (ClampMin = "1"))
+	float BatchTimeBudgetMs = 30.0f;
+
 	class APlayerCameraManager* pCameraManager = 0;
 
 	class DXManager * pDXManager = 0;
 	class Displayer * pDisplayer = 0;
 	class GeometryDataManager * pGeoDataManager = 0;
 	class ShaderManager * pShaderManager = 0;
+	class GPUProfiler * pGPUProfiler = 0;
+	class ShadowManager * pShadowManager = 0;
+	class BatchCapture * pBatchCapture = 0;
+	class OcclusionCuller * pOcclusionCuller = 0;
+	class ResolutionScaler * pResolutionScaler = 0;
+
+	TArray<FDXRenderBatchItem> aBatchQueue;
+	int mBatchFrameIndex = 0;
+	int mRenderWidth = 0;
+	int mRenderHeight = 0;
+
+	// Per frame, in gathering order. The geometry is the LOD drawn in this view, the bounds are split by component
+	// for the four wide plane tests
+	TArray<int> aCullObjects;
+	TArray<int> aCullGeometries;
+	TArray<ShaderManager::InstanceType> aCullInstances;
+	TArray<float> aBoundsX;
+	TArray<float> aBoundsY;
+	TArray<float> aBoundsZ;
+	TArray<float> aBoundsRadius;
+	// Positions into the lists above, ordered by geometry and then by depth
+	TArray<int> aVisibleObjects;
+	TArray<float> aVisibleDepths;
+	TArray<float> aGeometryDepths;
+	// One instanced draw each, X is the geometry, Y the first instance and Z the instance count
+	TArray<FIntVector> aDrawBatches;
+	TArray<ID3D11CommandList*> aCommandLists;
+	// The visible instances with their bounds and batch, for the occlusion pass
+	TArray<OcclusionCuller::CullInstance> aOcclusionInstances;
+
+	// Shadow casters as positions into the cull lists, and their draws after the visible instances
+	TArray<int> aStaticCasters;
+	TArray<int> aDynamicCasters;
+	TArray<FIntVector> aStaticShadowBatches;
+	TArray<FIntVector> aDynamicShadowBatches;
+	// What the cached static shadow map was drawn with
+	TArray<int> aShadowCachedObjects;
+	TArray<int> aShadowCachedGeometries;
+	TArray<ShaderManager::InstanceType> aShadowCachedInstances;
+	D3DXVECTOR3 mShadowLightDirection;
+	bool bStaticShadowValid = false;
+	bool bRebuildStaticShadow = false;
+	int mVisibleCount = 0;
+	int mCulledCount = 0;
 
 	bool bInitialized = true;
 	bool bCameraInitialized = false;
@@ -24,7 +24,8 @@ public:
 
 	// Sets default values for this actor's properties
 	ARenderableActor();
-	struct FStaticMeshLODResources* GetGeometryData();
+	// Every LOD of the mesh, the renderer picks one per view
+	struct FStaticMeshRenderData* GetGeometryData();
 	D3DXVECTOR3 GetDXPosition();
 
 	// Return Yaw Pitch Roll
@@ -33,5 +34,9 @@ public:
 	// Return ScaleX ScaleY ScaleZ
 	D3DXVECTOR3 GetDXScale();
 
+	// The pose the renderer uploads per instance, the shaders build the matrices from it.
+	// A subclass driven by a physics body can return the body's state here without going through the actor transform
+	virtual void GetDXPose(D3DXVECTOR3& position, D3DXQUATERNION& rotation, D3DXVECTOR3& scale);
+
 	TArray<uint8> GetTextureSourceData();
 };
@@ -0,0 +1,48 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Windows/MinWindows.h"
+#include <d3d11.h>
+
+class ShaderManager;
+
+// Dynamic resolution for the live view. The scene is drawn into the top left of a full size texture at a scale
+// that follows the GPU time of the frame, and stretched over the display target afterwards. Every resource is
+// created once at the full size, a new scale only changes the viewport
+class DXRENDERPLUGIN_API ResolutionScaler
+{
+public:
+	bool Initialize(int width, int height, DXGI_FORMAT format, ShaderManager* inShaderManager);
+	void Destroy();
+	// Feeds back the GPU milliseconds of a frame drawn at the current scale, scale is kept within [minScale, 1]
+	void Update(float gpuMs, float targetMs, float minScale);
+	// Below full size the scene goes to GetRenderTargetView and Upscale has to run, otherwise it is drawn straight into the display target
+	bool IsScaled() { return mViewportWidth < mWidth || mViewportHeight < mHeight; }
+	ID3D11RenderTargetView* GetRenderTargetView() { return pSceneTargetView; }
+	int GetViewportWidth() { return mViewportWidth; }
+	int GetViewportHeight() { return mViewportHeight; }
+	float GetScale() { return mScale; }
+	// Draws the scene over the whole of output, the immediate context's bindings are put back afterwards
+	void Upscale(ID3D11RenderTargetView* output);
+
+private:
+	struct UpscaleBufferType
+	{
+		float uvScale[2];
+		float uvMax[2];
+	};
+
+	bool bInitialized = false;
+	int mWidth = 0;
+	int mHeight = 0;
+	int mViewportWidth = 0;
+	int mViewportHeight = 0;
+	float mScale = 1.0f;
+
+	ID3D11Texture2D* pSceneTexture = 0;
+	ID3D11RenderTargetView* pSceneTargetView = 0;
+	ID3D11ShaderResourceView* pSceneResourceView = 0;
+	ID3D11VertexShader* pVertexShader = 0;
+	ID3D11PixelShader* pPixelShader = 0;
+	ID3D11Buffer* pConstBuffer = 0;
+	ID3D11SamplerState* pSamplerState = 0;
+};
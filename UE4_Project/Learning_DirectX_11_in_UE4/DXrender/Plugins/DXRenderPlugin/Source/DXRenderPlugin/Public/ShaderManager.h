@@ -3,19 +3,17 @@
 #include "Windows/MinWindows.h"
 #include <d3d11.h>
 #include <d3dx10math.h>
-#include <d3dx11async.h>
 
 class DXRENDERPLUGIN_API ShaderManager
 {
 public:
 	struct VSBufferType
 	{
-		D3DXMATRIX world;
-		D3DXMATRIX inversedWorld;
 		D3DXMATRIX view;
 		D3DXMATRIX projection;
 		D3DXVECTOR3 viewPosition;
 		float padding;
+		D3DXMATRIX lightViewProjection;
 	};
 
 	struct PSBufferType
@@ -23,28 +21,62 @@ public:
 		float intensity;
 		D3DXVECTOR3 lightDirection;
 		float specularPower;
-		D3DXVECTOR3 padding;
+		// 0 leaves every pixel lit, the shadow maps are only sampled when it is above 0
+		float shadowStrength;
+		D3DXVECTOR2 padding;
 	};
 
-	bool Initialize(FString inVSFileName, FString inPSFileName);
+	// Per instance vertex stream, 44 bytes. The vertex shaders scale, rotate and translate with it,
+	// normals are divided by the scale before the rotation, which stands in for the inverse transpose
+	struct InstanceType
+	{
+		D3DXVECTOR3 position;
+		D3DXQUATERNION rotation;
+		D3DXVECTOR3 scale;
+		uint32 textureSlice;
+	};
+
+	// Each define is NAME or NAME=VALUE, every set of defines is a permutation with its own cache entry
+	// The shadow vertex shader is optional, without it SetShadowPass keeps the color shaders
+	bool Initialize(FString inVSFileName, FString inPSFileName, const TArray<FString>& inDefines = TArray<FString>(), FString inShadowVSFileName = FString());
+	// Switches between the depth only shadow shader and the color shaders
+	void SetShadowPass(bool bShadow);
+	// Per frame buffers, only mapped when their contents changed since the last upload
 	bool UpdateShaderParameters();
-	void Render(uint32 indexCount, uint32 startIndex);
+	// Uploads every instance of the frame with a single Map, the buffer grows when needed
+	bool UpdateInstanceData();
+	// Records into the given context, the immediate one when it is null
+	void Render(uint32 indexCount, uint32 startIndex, uint32 baseVertex, uint32 instanceCount, uint32 startInstance, ID3D11DeviceContext* context = nullptr);
 	void Destroy();
+	// Bytecode cached in Saved/DXRenderShaderCache, keyed by a hash of the source and the compile settings.
+	// The other managers load their compute shaders through it as well
+	bool LoadShaderBytecode(const FString& fileName, const char* entryPoint, const char* profile, TArray<uint8>& outBytecode);
 
 	VSBufferType* VSConstBuffer;
 	PSBufferType* PSConstBuffer;
+	// Grouped by geometry, each draw covers a contiguous range
+	TArray<InstanceType> InstanceData;
 
 protected:
 	void OutputShaderErrorMessage(ID3D10Blob* errorMessage, const WCHAR* shaderFilename);
 
 	FString mVSFileName;
 	FString mPSFileName;
+	TArray<FString> aDefines;
 
 	ID3D11VertexShader* pVertexShader = 0;
 	ID3D11PixelShader* pPixelShader = 0;
 	ID3D11InputLayout* pInputLayout = 0;
+	ID3D11VertexShader* pShadowVertexShader = 0;
+	ID3D11InputLayout* pShadowInputLayout = 0;
 	ID3D11Buffer* pVSConstBuffer = 0;
 	ID3D11Buffer*pPSConstBuffer = 0;
+	ID3D11Buffer* pInstanceBuffer = 0;
+	VSBufferType mUploadedVS;
+	PSBufferType mUploadedPS;
+	bool bVSUploaded = false;
+	bool bPSUploaded = false;
+	int mInstanceCapacity = 0;
 
 	bool bIntialized = false;
 };
@@ -0,0 +1,42 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Windows/MinWindows.h"
+#include <d3d11.h>
+#include <d3dx10math.h>
+
+// Directional light shadow maps, the static casters go into a cached map that is only redrawn
+// when the light or the static objects move, the dynamic casters into a second map every frame
+class DXRENDERPLUGIN_API ShadowManager
+{
+public:
+	enum ShadowMap
+	{
+		StaticShadowMap,
+		DynamicShadowMap,
+		ShadowMapCount
+	};
+
+	bool Initialize(int size);
+	void Destroy();
+	// Orthographic light looking along direction, covering the sphere
+	void SetLight(const D3DXVECTOR3& direction, const D3DXVECTOR3& center, float radius);
+	// Row major as D3DX builds it
+	const D3DXMATRIX& GetLightViewProjection() { return mLightViewProjection; }
+	// Clears the map and makes it the only depth target, the color shaders have to be switched by the caller
+	void BeginPass(ShadowMap map);
+	// Back to the render target, with both maps bound for the pixel shader
+	void EndPass();
+	void BindShadowMaps();
+
+private:
+	bool bInitialized = false;
+	int mSize = 0;
+	D3DXMATRIX mLightViewProjection;
+
+	ID3D11Texture2D* pShadowTextures[ShadowMapCount] = {};
+	ID3D11DepthStencilView* pShadowDepthViews[ShadowMapCount] = {};
+	ID3D11ShaderResourceView* pShadowResourceViews[ShadowMapCount] = {};
+	ID3D11SamplerState* pComparisonSampler = 0;
+	ID3D11RasterizerState* pShadowRasterState = 0;
+	ID3D11RasterizerState* pSavedRasterState = 0;
+};
@@ -1,21 +1,30 @@
 cbuffer VSConstBuffer
 {
-    matrix worldMatrix;
-	matrix inversedWorldMatrix;
     matrix viewMatrix;
     matrix projectionMatrix;
 	float4 viewPosition;
+	matrix lightViewProjection;
 };
 
 struct VertexInputType
 {
     float4 pos : POSITION;
-    float3 normal : NORMAL;
-	float3 binormal : BINORMAL;
-	float3 tangent : TANGENT;
+    float4 normal : NORMAL;
+	float4 tangent : TANGENT;
 	float2 tex : TEXCOORD;
+	float3 instancePosition : INSTPOSITION;
+	float4 instanceRotation : INSTROTATION;
+	float3 instanceScale : INSTSCALE;
+	uint texSlice : TEXINDEX;
 };
 
+// Same as RotateByQuaternion in RenderManagerActor.cpp
+float3 RotateByQuaternion(float3 v, float4 q)
+{
+	float3 t = 2.0f * cross(q.xyz, v);
+	return v + q.w * t + cross(q.xyz, t);
+}
+
 struct PixelInputType
 {
     float4 pos : SV_POSITION;
@@ -26,14 +35,17 @@ struct PixelInputType
 	float3 viewDirection : DIRECTION;
 	float fogFactor : FOG;
 	float clip : SV_ClipDistance0;
+	nointerpolation uint texSlice : TEXINDEX;
+	float4 lightPos : LIGHTPOS;
 };
 
 PixelInputType ColorVertexShader(VertexInputType input)
 {
     PixelInputType output;
-    
-    input.pos.w = 1.0f;
-    output.pos = mul(input.pos, worldMatrix);
+
+	float3 worldPosition = RotateByQuaternion(input.pos.xyz * input.instanceScale, input.instanceRotation) + input.instancePosition;
+    output.pos = float4(worldPosition, 1.0f);
+	output.lightPos = mul(output.pos, lightViewProjection);
 	output.viewDirection = normalize(viewPosition.xyz - output.pos);
 	
     output.pos = mul(output.pos, viewMatrix);
@@ -42,11 +54,18 @@ PixelInputType ColorVertexShader(VertexInputType input)
     output.pos = mul(output.pos, projectionMatrix);
    
 	
-	output.normal = normalize(mul(input.normal, inversedWorldMatrix));
-	output.binormal = normalize(mul(input.binormal, worldMatrix));
-	output.tangent = normalize(mul(input.tangent, worldMatrix));
+	// Packed as unorm, the sign of the binormal is in tangent.w
+	float3 normal = input.normal.xyz * 2.0f - 1.0f;
+	float3 tangent = input.tangent.xyz * 2.0f - 1.0f;
+	float3 binormal = cross(normal, tangent) * (input.tangent.w > 0.5f ? 1.0f : -1.0f);
+	
+	// Dividing by the scale before the rotation is the inverse transpose of scale then rotate
+	output.normal = normalize(RotateByQuaternion(normal / input.instanceScale, input.instanceRotation));
+	output.binormal = normalize(RotateByQuaternion(binormal * input.instanceScale, input.instanceRotation));
+	output.tangent = normalize(RotateByQuaternion(tangent * input.instanceScale, input.instanceRotation));
 	
 	output.tex = input.tex;
+	output.texSlice = input.texSlice;
 	output.clip = 1.0f;
 
     return output;
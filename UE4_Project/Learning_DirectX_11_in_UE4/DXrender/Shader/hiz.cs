@@ -0,0 +1,40 @@
+// Max depth pyramid of the depth buffer, mip 0 is a copy stretched from the drawn part of the depth buffer and
+// every further mip the farthest depth of the texels it covers. The last row and column of an odd sized mip are folded into the last texel
+cbuffer HiZBuffer
+{
+	uint2 inputSize;
+	uint2 outputSize;
+};
+
+Texture2D<float> inputDepth : register(t0);
+RWTexture2D<float> outputDepth : register(u0);
+
+[numthreads(8, 8, 1)]
+void CopyDepthShader(uint3 id : SV_DispatchThreadID)
+{
+	if (any(id.xy >= outputSize)) {
+		return;
+	}
+	outputDepth[id.xy] = inputDepth.Load(int3(id.xy * inputSize / outputSize, 0));
+}
+
+[numthreads(8, 8, 1)]
+void DownsampleShader(uint3 id : SV_DispatchThreadID)
+{
+	if (any(id.xy >= outputSize)) {
+		return;
+	}
+
+	uint2 base = id.xy * 2;
+	uint2 last = inputSize - 1;
+	uint xEnd = (id.x == outputSize.x - 1 && (inputSize.x & 1)) ? 2 : 1;
+	uint yEnd = (id.y == outputSize.y - 1 && (inputSize.y & 1)) ? 2 : 1;
+
+	float depth = 0.0f;
+	for (uint y = 0; y <= yEnd; y++) {
+		for (uint x = 0; x <= xEnd; x++) {
+			depth = max(depth, inputDepth.Load(int3(min(base + uint2(x, y), last), 0)));
+		}
+	}
+	outputDepth[id.xy] = depth;
+}
@@ -0,0 +1,95 @@
+// Tests the instances against the Hi-Z pyramid of the previous frame and appends the visible ones to their
+// batch. Each batch owns a range of the output starting at its first instance, the instance count of its
+// indirect args is the append counter
+cbuffer OcclusionBuffer
+{
+	// The view projection the pyramid was drawn with
+	matrix viewProjection;
+	float2 hizSize;
+	uint mipCount;
+	uint instanceCount;
+	uint hizValid;
+	uint3 padding;
+};
+
+// 64 bytes, the instance as in color.vs followed by its world bounding sphere and its batch
+struct CullInstance
+{
+	float3 position;
+	float4 rotation;
+	float3 scale;
+	uint textureSlice;
+	float4 bounds;
+	uint batch;
+};
+
+StructuredBuffer<CullInstance> instances : register(t0);
+Texture2D<float> hiz : register(t1);
+// Five uints per batch: index count, instance count, start index, base vertex, first instance
+RWByteAddressBuffer drawArgs : register(u0);
+// 44 bytes per instance, laid out as the instance vertex buffer
+RWByteAddressBuffer outputInstances : register(u1);
+
+bool IsVisible(float4 sphere)
+{
+	if (!hizValid) {
+		return true;
+	}
+
+	float2 minUV = 1.0f;
+	float2 maxUV = 0.0f;
+	float nearestDepth = 1.0f;
+	[unroll]
+	for (uint i = 0; i < 8; i++) {
+		float3 corner = sphere.xyz + sphere.w * float3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+		float4 clip = mul(float4(corner, 1.0f), viewProjection);
+		// Reaches behind the camera, the projected rectangle is unbounded
+		if (clip.w <= 0.0f) {
+			return true;
+		}
+		float3 ndc = clip.xyz / clip.w;
+		float2 uv = float2(ndc.x * 0.5f + 0.5f, 0.5f - ndc.y * 0.5f);
+		minUV = min(minUV, uv);
+		maxUV = max(maxUV, uv);
+		nearestDepth = min(nearestDepth, ndc.z);
+	}
+	if (nearestDepth <= 0.0f) {
+		return true;
+	}
+
+	minUV = saturate(minUV);
+	maxUV = saturate(maxUV);
+	// The mip where the rectangle covers at most two texels on each axis
+	float2 size = (maxUV - minUV) * hizSize;
+	float mip = min(ceil(log2(max(max(size.x, size.y), 1.0f))), mipCount - 1);
+	float2 mipSize = max(floor(hizSize / exp2(mip)), 1.0f);
+	int2 last = int2(mipSize) - 1;
+	int2 p0 = min(int2(minUV * mipSize), last);
+	int2 p1 = min(int2(maxUV * mipSize), last);
+
+	float farthest = max(max(hiz.Load(int3(p0, mip)), hiz.Load(int3(p1.x, p0.y, mip))),
+		max(hiz.Load(int3(p0.x, p1.y, mip)), hiz.Load(int3(p1, mip))));
+	return nearestDepth <= farthest;
+}
+
+[numthreads(64, 1, 1)]
+void OcclusionShader(uint3 id : SV_DispatchThreadID)
+{
+	if (id.x >= instanceCount) {
+		return;
+	}
+
+	CullInstance instance = instances[id.x];
+	if (!IsVisible(instance.bounds)) {
+		return;
+	}
+
+	uint args = instance.batch * 20;
+	uint slot;
+	drawArgs.InterlockedAdd(args + 4, 1, slot);
+	uint address = (drawArgs.Load(args + 16) + slot) * 44;
+	outputInstances.Store3(address, asuint(instance.position));
+	outputInstances.Store4(address + 12, asuint(instance.rotation));
+	outputInstances.Store3(address + 28, asuint(instance.scale));
+	outputInstances.Store(address + 40, instance.textureSlice);
+}
@@ -0,0 +1,28 @@
+// Same layout as in color.vs, only the light matrix and the instance pose are used
+cbuffer VSConstBuffer
+{
+    matrix viewMatrix;
+    matrix projectionMatrix;
+	float4 viewPosition;
+	matrix lightViewProjection;
+};
+
+struct VertexInputType
+{
+    float4 pos : POSITION;
+	float3 instancePosition : INSTPOSITION;
+	float4 instanceRotation : INSTROTATION;
+	float3 instanceScale : INSTSCALE;
+};
+
+float3 RotateByQuaternion(float3 v, float4 q)
+{
+	float3 t = 2.0f * cross(q.xyz, v);
+	return v + q.w * t + cross(q.xyz, t);
+}
+
+float4 ShadowVertexShader(VertexInputType input) : SV_POSITION
+{
+	float3 worldPosition = RotateByQuaternion(input.pos.xyz * input.instanceScale, input.instanceRotation) + input.instancePosition;
+    return mul(float4(worldPosition, 1.0f), lightViewProjection);
+}
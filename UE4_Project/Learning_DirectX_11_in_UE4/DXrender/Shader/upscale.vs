@@ -0,0 +1,22 @@
+// Fullscreen triangle built from the vertex id, nothing is bound to the input assembler. The scene covers
+// uvScale of the texture, see ResolutionScaler
+cbuffer UpscaleBuffer
+{
+	float2 uvScale;
+	float2 uvMax;
+};
+
+struct PixelInputType
+{
+	float4 pos : SV_POSITION;
+	float2 tex : TEXCOORD;
+};
+
+PixelInputType UpscaleVertexShader(uint id : SV_VertexID)
+{
+	PixelInputType output;
+	float2 uv = float2((id << 1) & 2, id & 2);
+	output.pos = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	output.tex = uv * uvScale;
+	return output;
+}
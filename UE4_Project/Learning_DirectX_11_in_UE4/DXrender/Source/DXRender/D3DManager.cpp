@@ -1,11 +1,11 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 #include "D3DManager.h"
 #include "Dxerr.h"
+#include "DXDevice.h"
 
 bool D3DManager::Initialize(int width, int height)
 {
 	HRESULT result;
-	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
 
 	D3D11_TEXTURE2D_DESC targetTextureDesc;
 	D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc;
@@ -17,16 +17,17 @@ bool D3DManager::Initialize(int width, int height)
 	D3D11_DEPTH_STENCIL_DESC depthDisabledStencilDesc;
 	D3D11_BLEND_DESC blendStateDescription;
 
-	result = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, 0, &featureLevel, 1, D3D11_SDK_VERSION, &m_device, NULL, &m_deviceContext);
-	if (FAILED(result))
+	// The device is shared with DXRenderPlugin
+	if (!DXDevice::Acquire(m_device, m_deviceContext))
 	{
-		FString describ = FString(DXGetErrorDescription(result));
-		UE_LOG(LogTemp, Warning, TEXT("D3D11CreateDevice Fail: %s"), *describ);
+		UE_LOG(LogTemp, Warning, TEXT("D3D11CreateDevice Fail"));
 		return false;
 	}
 	else {
 		UE_LOG(LogTemp, Warning, TEXT("D3D11CreateDevice Success"));
 	}
+	m_width = width;
+	m_height = height;
 
 
 	ZeroMemory(&targetTextureDesc, sizeof(targetTextureDesc));
@@ -262,9 +263,6 @@ bool D3DManager::Initialize(int width, int height)
 
 void D3DManager::Destroy()
 {
-	m_deviceContext->ClearState();
-	SAFE_RELEASE(m_device);
-	SAFE_RELEASE(m_deviceContext);
 	SAFE_RELEASE(m_renderTargetTexture);
 	SAFE_RELEASE(m_renderTargetView);
 	SAFE_RELEASE(m_depthStencilBuffer);
@@ -274,6 +272,7 @@ void D3DManager::Destroy()
 	SAFE_RELEASE(m_alphaEnableBlendingState);
 	SAFE_RELEASE(m_alphaDisableBlendingState);
 	SAFE_RELEASE(m_depthDisabledStencilState);
+	DXDevice::Release(m_device, m_deviceContext);
 }
 
 void D3DManager::DXBeginScene(float time)
@@ -296,6 +295,18 @@ void D3DManager::DXBeginScene(float time)
 void D3DManager::SetRenderToTexture()
 {
 	m_deviceContext->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
+
+	// DXRenderPlugin draws on the same context, so the fixed states are set again every frame
+	D3D11_VIEWPORT viewport;
+	viewport.Width = (float)m_width;
+	viewport.Height = (float)m_height;
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+	viewport.TopLeftX = 0.0f;
+	viewport.TopLeftY = 0.0f;
+	m_deviceContext->RSSetViewports(1, &viewport);
+	m_deviceContext->RSSetState(m_rasterState);
+	m_deviceContext->OMSetDepthStencilState(m_depthStencilState, 1);
 }
 
 void D3DManager::TurnOnZBuffer()
@@ -27,6 +27,8 @@ public:
 
 protected:
 	bool D3DIntializedSuccess = false;
+	int m_width = 0;
+	int m_height = 0;
 	ID3D11Device* m_device = 0;
 	ID3D11DeviceContext* m_deviceContext = 0;
 
@@ -11,7 +11,7 @@ public class DXRender : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] { "RHI", "RenderCore", "MeshDescription", "RawMesh" });
+		PrivateDependencyModuleNames.AddRange(new string[] { "RHI", "RenderCore", "MeshDescription", "RawMesh", "DXRenderPlugin" });
 
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Include"));
         PublicLibraryPaths.Add(Path.Combine(ModuleDirectory, "Lib"));
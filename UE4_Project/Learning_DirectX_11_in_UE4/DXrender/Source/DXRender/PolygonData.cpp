@@ -9,20 +9,188 @@ bool PolygonData::Initialize()
 		return false;
 	}
 	bInitilized = InitializeBuffer(m_D3DManager->GetDevice());
+	if (bInitilized && bDynamic) {
+		bInitilized = InitializeUploadRing(m_D3DManager->GetDevice());
+	}
 	return bInitilized;
 }
 
 void PolygonData::Update()
 {
 	if (bInitilized) {
+		StreamDirtyRanges(m_D3DManager->GetDeviceContext());
 		RenderBuffer(m_D3DManager->GetDeviceContext());
 	}
 }
 
 void PolygonData::Destroy()
 {
+	SAFE_RELEASE(m_uploadRing);
 	SAFE_RELEASE(m_indexBuffer);
 	SAFE_RELEASE(m_vertexBuffer);
+	m_dirtyRanges.Reset();
+}
+
+bool PolygonData::UpdateVertices(int first, int count, const D3DXVECTOR3 * positions, const D3DXVECTOR3 * normals)
+{
+	if (!bInitilized || !bDynamic || !positions || first < 0 || count <= 0 || first + count > m_vectexArr.Num()) {
+		return false;
+	}
+
+	for (int i = 0; i < count; i++) {
+		m_vectexArr[first + i].position = positions[i];
+	}
+	if (normals) {
+		for (int i = 0; i < count; i++) {
+			m_vectexArr[first + i].normal = normals[i];
+		}
+	}
+	else {
+		RebuildNormals(first, count);
+	}
+	MarkDirty(first, count);
+	return true;
+}
+
+bool PolygonData::UpdateVerticesChrono(int first, int count, const double * positions, const double * normals)
+{
+	if (!bInitilized || !bDynamic || !positions || first < 0 || count <= 0 || first + count > m_vectexArr.Num()) {
+		return false;
+	}
+
+	// Chrono is Y up with X and Z from UE's X and Y, the render space takes UE's Y, Z, X
+	for (int i = 0; i < count; i++) {
+		const double* p = positions + i * 3;
+		m_vectexArr[first + i].position = D3DXVECTOR3((float)p[2], (float)p[1], (float)p[0]);
+	}
+	if (normals) {
+		for (int i = 0; i < count; i++) {
+			const double* n = normals + i * 3;
+			m_vectexArr[first + i].normal = D3DXVECTOR3((float)n[2], (float)n[1], (float)n[0]);
+		}
+	}
+	else {
+		RebuildNormals(first, count);
+	}
+	MarkDirty(first, count);
+	return true;
+}
+
+void PolygonData::MarkDirty(int first, int count)
+{
+	m_dirtyRanges.Add({ first, count });
+}
+
+void PolygonData::RebuildNormals(int first, int count)
+{
+	for (int v = first; v < first + count; v++) {
+		D3DXVECTOR3 normal(0.0f, 0.0f, 0.0f);
+		for (int t = m_vertexTriangleStart[v]; t < m_vertexTriangleStart[v + 1]; t++) {
+			int triangle = m_vertexTriangles[t] * 3;
+			const D3DXVECTOR3& p0 = m_vectexArr[m_indexArr[triangle]].position;
+			D3DXVECTOR3 edge1 = m_vectexArr[m_indexArr[triangle + 1]].position - p0;
+			D3DXVECTOR3 edge2 = m_vectexArr[m_indexArr[triangle + 2]].position - p0;
+			D3DXVECTOR3 faceNormal;
+			// Not normalized, larger triangles weigh more
+			D3DXVec3Cross(&faceNormal, &edge1, &edge2);
+			normal += faceNormal;
+		}
+		if (D3DXVec3LengthSq(&normal) > 0.0f) {
+			D3DXVec3Normalize(&m_vectexArr[v].normal, &normal);
+		}
+	}
+}
+
+bool PolygonData::InitializeUploadRing(ID3D11Device * device)
+{
+	D3D11_BUFFER_DESC ringDesc;
+	HRESULT result;
+
+	// Room for every vertex once, a frame that changes all of them wraps the ring with one DISCARD
+	m_uploadRingBytes = sizeof(VertexDataType) * FMath::Max(m_vertexCount, 1);
+	m_uploadRingOffset = m_uploadRingBytes;
+
+	ringDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ringDesc.ByteWidth = m_uploadRingBytes;
+	ringDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	ringDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ringDesc.MiscFlags = 0;
+	ringDesc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&ringDesc, NULL, &m_uploadRing);
+	if (FAILED(result))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Create Upload Ring Fail"));
+		return false;
+	}
+
+	// Vertex to triangle table for the normals
+	m_vertexTriangleStart.Init(0, m_vertexCount + 1);
+	for (int i = 0; i < m_indexCount; i++) {
+		m_vertexTriangleStart[m_indexArr[i] + 1]++;
+	}
+	for (int v = 0; v < m_vertexCount; v++) {
+		m_vertexTriangleStart[v + 1] += m_vertexTriangleStart[v];
+	}
+	TArray<int> fill = m_vertexTriangleStart;
+	m_vertexTriangles.SetNumUninitialized(m_indexCount);
+	for (int i = 0; i < m_indexCount; i++) {
+		m_vertexTriangles[fill[m_indexArr[i]]++] = i / 3;
+	}
+	return true;
+}
+
+void PolygonData::StreamDirtyRanges(ID3D11DeviceContext * deviceContext)
+{
+	if (!m_uploadRing || m_dirtyRanges.Num() == 0) {
+		return;
+	}
+
+	// Overlapping and touching ranges become one copy
+	m_dirtyRanges.Sort([](const DirtyRange& a, const DirtyRange& b) { return a.first < b.first; });
+	int merged = 0;
+	for (int i = 1; i < m_dirtyRanges.Num(); i++) {
+		DirtyRange& last = m_dirtyRanges[merged];
+		const DirtyRange& range = m_dirtyRanges[i];
+		if (range.first <= last.first + last.count) {
+			last.count = FMath::Max(last.first + last.count, range.first + range.count) - last.first;
+		}
+		else {
+			m_dirtyRanges[++merged] = range;
+		}
+	}
+	m_dirtyRanges.SetNum(merged + 1, false);
+
+	for (const DirtyRange& range : m_dirtyRanges) {
+		uint32 bytes = range.count * sizeof(VertexDataType);
+
+		// NO_OVERWRITE appends behind the copies the GPU may still read, only a wrap discards the ring
+		D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+		if (m_uploadRingOffset + bytes > m_uploadRingBytes) {
+			mapType = D3D11_MAP_WRITE_DISCARD;
+			m_uploadRingOffset = 0;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		HRESULT result = deviceContext->Map(m_uploadRing, 0, mapType, 0, &mappedResource);
+		if (FAILED(result)) {
+			UE_LOG(LogTemp, Warning, TEXT("Map Upload Ring Fail"));
+			break;
+		}
+		FMemory::Memcpy((uint8*)mappedResource.pData + m_uploadRingOffset, &m_vectexArr[range.first], bytes);
+		deviceContext->Unmap(m_uploadRing, 0);
+
+		D3D11_BOX box;
+		box.left = m_uploadRingOffset;
+		box.right = m_uploadRingOffset + bytes;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+		deviceContext->CopySubresourceRegion(m_vertexBuffer, 0, range.first * sizeof(VertexDataType), 0, 0, m_uploadRing, 0, &box);
+		m_uploadRingOffset += bytes;
+	}
+	m_dirtyRanges.Reset();
 }
 
 void PolygonData::AddGeometryData(struct FStaticMeshLODResources * resource)
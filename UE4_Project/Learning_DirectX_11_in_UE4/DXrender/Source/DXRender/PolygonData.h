@@ -22,19 +22,56 @@ private:
 		D3DXVECTOR2 uv;
 	};
 
+	struct DirtyRange
+	{
+		int first;
+		int count;
+	};
+
 public:
 	void SetD3DManager(D3DManager* InManager) { m_D3DManager = InManager; }
+	// Call before Initialize. The changed vertices are streamed through a dynamic upload ring,
+	// mapped with NO_OVERWRITE until it wraps, and copied on the GPU into the vertex buffer
+	void SetDynamic(bool bInDynamic) { bDynamic = bInDynamic; }
 	bool Initialize();
+	// Streams the vertices changed since the last frame and binds the buffers
 	void Update();
 	void Destroy();
 	void AddGeometryData(struct FStaticMeshLODResources * resource);
 	int GetIndexCount() { return m_indexCount; }
+	int GetVertexCount() { return m_vectexArr.Num(); }
+
+	// Positions in render space (UE axes swizzled, in meters), normals may be null and are then
+	// rebuilt from the triangles. Only the given range is uploaded on the next Update
+	bool UpdateVertices(int first, int count, const D3DXVECTOR3* positions, const D3DXVECTOR3* normals);
+
+	// Takes packed xyz doubles in Chrono axes and units, e.g. the coordinates of a ChTriangleMeshConnected.
+	// Chrono vertex i becomes vertex first + i, normals may be null
+	bool UpdateVerticesChrono(int first, int count, const double* positions, const double* normals);
+
+	// Works with any mesh offering getCoordsVertices and getCoordsNormals as vectors of ChVector<double>,
+	// the normals are used when there is one per vertex
+	template<typename MeshType>
+	bool UpdateFromTriangleMesh(MeshType& mesh, int first = 0)
+	{
+		auto& vertices = mesh.getCoordsVertices();
+		auto& normals = mesh.getCoordsNormals();
+		if (vertices.empty()) {
+			return false;
+		}
+		const double* normalData = normals.size() == vertices.size() ? &normals[0][0] : nullptr;
+		return UpdateVerticesChrono(first, (int)vertices.size(), &vertices[0][0], normalData);
+	}
 
 private:
 	D3DManager* m_D3DManager = 0;
 
 	bool InitializeBuffer(ID3D11Device * device);
+	bool InitializeUploadRing(ID3D11Device * device);
 	void RenderBuffer(ID3D11DeviceContext * deviceContext);
+	void MarkDirty(int first, int count);
+	void RebuildNormals(int first, int count);
+	void StreamDirtyRanges(ID3D11DeviceContext * deviceContext);
 
 	TArray<VertexDataType> m_vectexArr;
 	TArray<unsigned long> m_indexArr;
@@ -42,4 +79,13 @@ private:
 	ID3D11Buffer *m_vertexBuffer = 0, *m_indexBuffer = 0;
 	int m_vertexCount = 0, m_indexCount = 0;
 	bool bInitilized = false;
+
+	bool bDynamic = false;
+	TArray<DirtyRange> m_dirtyRanges;
+	// Triangles around each vertex, m_vertexTriangleStart[v] to m_vertexTriangleStart[v + 1] in m_vertexTriangles
+	TArray<int> m_vertexTriangleStart;
+	TArray<int> m_vertexTriangles;
+	ID3D11Buffer* m_uploadRing = 0;
+	uint32 m_uploadRingBytes = 0;
+	uint32 m_uploadRingOffset = 0;
 };
@@ -39,6 +39,7 @@ void ARenderManager::BeginPlay()
 
 		bD3DInitialized = m_D3D->Initialize(m_target->SizeX, m_target->SizeY);
 		m_Displayer->SetOutputTarget(m_target);
+		m_Displayer->SetWindowOptions(bWindowOnly, bAllowTearing, WindowSyncInterval);
 
 		if (bD3DInitialized) {
 
@@ -63,6 +64,7 @@ void ARenderManager::BeginPlay()
 				}
 			}
 			m_PolygonData->SetD3DManager(m_D3D);
+			m_PolygonData->SetDynamic(bDynamicGeometry);
 			bPolygonDataInitialzied = m_PolygonData->Initialize();
 
 			if (bPolygonDataInitialzied) {
@@ -122,9 +124,8 @@ void ARenderManager::Tick(float DeltaTime)
 
 	if (EverythingInitialized) {
 
-		D3DXMATRIX viewMatrix, projectionMatrix, worldMatrix;
+		D3DXMATRIX viewMatrix, projectionMatrix;
 		D3DXMatrixPerspectiveFovLH(&projectionMatrix, m_cameraManager->GetCameraCachePOV().FOV * 0.0174532925f, (float)m_target->SizeX /(float)m_target->SizeY, 0.1f, 100.0f);
-		D3DXMatrixIdentity(&worldMatrix);
 
 		D3DXVECTOR3 up, position, lookAt;
 		float yaw, pitch, roll;
@@ -152,17 +153,11 @@ void ARenderManager::Tick(float DeltaTime)
 		D3DXMatrixLookAtLH(&viewMatrix, &position, &lookAt, &up);
 
 
-		D3DXMatrixTranspose(&worldMatrix, &worldMatrix);
 		D3DXMatrixTranspose(&viewMatrix, &viewMatrix);
 		D3DXMatrixTranspose(&projectionMatrix, &projectionMatrix);
 
-		m_D3D->SetRenderToTexture();
-		m_D3D->DXBeginScene(GetGameTimeSinceCreation());
-		m_PolygonData->Update();
-
 		m_ShaderManager->VSConstBuffer->projection = projectionMatrix;
 		m_ShaderManager->VSConstBuffer->view = viewMatrix;
-		m_ShaderManager->VSConstBuffer->world = worldMatrix;
 		//m_ShaderManager->PSConstBuffer->intensity = sin(3.0f * GetGameTimeSinceCreation());
 		m_ShaderManager->PSConstBuffer->intensity = 1.0f;
 		m_ShaderManager->PSConstBuffer->lightDirection = D3DXVECTOR3(1.0f, 0.2f, 0.3f);
@@ -181,50 +176,73 @@ void ARenderManager::Tick(float DeltaTime)
 			}
 		}
 
-		m_ShaderManager->UpdateShaderParameters();
-		m_ShaderManager->Render();
-
-		m_D3D->TurnOnAlphaBlend();
-
-		D3DXMatrixTranslation(&worldMatrix, 0.7f, 1.0f, 0.1f);
-		D3DXMatrixTranspose(&worldMatrix, &worldMatrix);
-		m_ShaderManager->VSConstBuffer->world = worldMatrix;
-		m_ShaderManager->UpdateShaderParameters();
-		m_ShaderManager->Render();
-
-		D3DXMatrixTranslation(&worldMatrix, 0.7f, 1.0f, 3.0f);
-		D3DXMATRIX rot;
-		D3DXMatrixRotationX(&rot, 45);
-		D3DXMatrixMultiply(&worldMatrix, &rot, &worldMatrix);
-		D3DXMatrixTranspose(&worldMatrix, &worldMatrix);
-		m_ShaderManager->VSConstBuffer->world = worldMatrix;
-		m_ShaderManager->UpdateShaderParameters();
-		m_ShaderManager->Render();
+#ifdef RENDER_IN_WINDOW
+		bool bDrawTexture = !bWindowOnly;
+#else
+		bool bDrawTexture = true;
+#endif // RENDER_IN_WINDOW
 
-		m_D3D->TurnOffAlphaBlend();
-		m_Displayer->DisplayOnTexture();
+		if (bDrawTexture) {
+			m_D3D->SetRenderToTexture();
+			m_D3D->DXBeginScene(GetGameTimeSinceCreation());
+			DrawScene();
+			m_Displayer->DisplayOnTexture();
+		}
 
 
 #ifdef RENDER_IN_WINDOW
 
-		m_Displayer->SetRenderToWindow();
+		m_Displayer->ExecuteWindow(DeltaTime);
+
+		// Only when the swap chain has a free back buffer, the window presents at its own rate
+		if (m_Displayer->IsWindowFrameReady()) {
+			m_Displayer->SetRenderToWindow();
 
-		float color[4];
+			float color[4];
 
-		// Setup the color to clear the buffer to.
-		color[2] = 0.5f;
-		color[0] = 0.3f;
-		color[1] = 0.1f;
-		color[3] = 1.0f;
+			// Setup the color to clear the buffer to.
+			color[2] = 0.5f;
+			color[0] = 0.3f;
+			color[1] = 0.1f;
+			color[3] = 1.0f;
 
-		m_D3D->GetDeviceContext()->ClearRenderTargetView(m_Displayer->GetWindowRenderTargetView(), color);
-		m_D3D->GetDeviceContext()->ClearDepthStencilView(m_D3D->GetDepthStencilView(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-		m_PolygonData->Update();
-		m_ShaderManager->Render();
-		m_Displayer->DisplayOnWindow();
+			m_D3D->GetDeviceContext()->ClearRenderTargetView(m_Displayer->GetWindowRenderTargetView(), color);
+			m_D3D->GetDeviceContext()->ClearDepthStencilView(m_D3D->GetDepthStencilView(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+			DrawScene();
+			m_Displayer->DisplayOnWindow();
+		}
 
 #endif // RENDER_IN_WINDOW
 
 	}
 }
 
+void ARenderManager::DrawScene()
+{
+	D3DXMATRIX worldMatrix;
+	D3DXMatrixIdentity(&worldMatrix);
+	m_PolygonData->Update();
+
+	m_ShaderManager->VSConstBuffer->world = worldMatrix;
+	m_ShaderManager->UpdateShaderParameters();
+	m_ShaderManager->Render();
+
+	m_D3D->TurnOnAlphaBlend();
+
+	D3DXMatrixTranslation(&worldMatrix, 0.7f, 1.0f, 0.1f);
+	D3DXMatrixTranspose(&worldMatrix, &worldMatrix);
+	m_ShaderManager->VSConstBuffer->world = worldMatrix;
+	m_ShaderManager->UpdateShaderParameters();
+	m_ShaderManager->Render();
+
+	D3DXMatrixTranslation(&worldMatrix, 0.7f, 1.0f, 3.0f);
+	D3DXMATRIX rot;
+	D3DXMatrixRotationX(&rot, 45);
+	D3DXMatrixMultiply(&worldMatrix, &rot, &worldMatrix);
+	D3DXMatrixTranspose(&worldMatrix, &worldMatrix);
+	m_ShaderManager->VSConstBuffer->world = worldMatrix;
+	m_ShaderManager->UpdateShaderParameters();
+	m_ShaderManager->Render();
+
+	m_D3D->TurnOffAlphaBlend();
+}
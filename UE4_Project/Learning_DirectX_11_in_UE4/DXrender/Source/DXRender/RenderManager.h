@@ -29,7 +29,28 @@ public:
 	UPROPERTY(EditAnywhere, Category = "DXRender", DisplayName = "Texture")
 	class UTexture2D* m_texture;
 
+	// Lets the vertices be changed every frame through GetPolygonData, for deforming meshes
+	UPROPERTY(EditAnywhere, Category = "DXRender")
+	bool bDynamicGeometry = false;
+
+	class PolygonData* GetPolygonData() { return m_PolygonData; }
+
+	// The window options only apply when the module is built with RENDER_IN_WINDOW.
+	// Window only skips the render target and its CPU copy, the scene goes to the window alone
+	UPROPERTY(EditAnywhere, Category = "DXRender|Window")
+	bool bWindowOnly = false;
+
+	// Presents without waiting for vblank when the sync interval is 0 and the display allows it
+	UPROPERTY(EditAnywhere, Category = "DXRender|Window")
+	bool bAllowTearing = true;
+
+	UPROPERTY(EditAnywhere, Category = "DXRender|Window", meta = (ClampMin = "0", ClampMax = "4"))
+	int WindowSyncInterval = 0;
+
 protected:
+	// The draws of one frame into whatever target is bound
+	void DrawScene();
+
 	class D3DManager* m_D3D = 0;
 	class VisualDisplayer* m_Displayer = 0;
 	class ShaderManager* m_ShaderManager = 0;
@@ -5,9 +5,18 @@
 #include "Engine/TextureRenderTarget2D.h"
 
 #ifdef RENDER_IN_WINDOW
+#include <dxgi1_5.h>
+
 VisualDisplayer* VisualDisplayer::DisplayerPtr = 0;
 #endif
 
+void VisualDisplayer::SetWindowOptions(bool inWindowOnly, bool inAllowTearing, int syncInterval)
+{
+	bWindowOnly = inWindowOnly;
+	bAllowTearing = inAllowTearing;
+	m_syncInterval = FMath::Clamp(syncInterval, 0, 4);
+}
+
 bool VisualDisplayer::Initialize()
 {
 	if (!m_D3DManager) {
@@ -19,37 +28,47 @@ bool VisualDisplayer::Initialize()
 
 	ID3D11Device* device = m_D3DManager->GetDevice();
 
-	m_Date.Init(0, m_target->SizeX * m_target->SizeY * 4);
+#ifdef RENDER_IN_WINDOW
+	bool bCreateStaging = !bWindowOnly;
+#else
+	bool bCreateStaging = true;
+#endif // RENDER_IN_WINDOW
 
-	HRESULT result;
-	D3D11_TEXTURE2D_DESC StagingTextureDesc;
-	ZeroMemory(&StagingTextureDesc, sizeof(StagingTextureDesc));
-	StagingTextureDesc.Width = m_target->SizeX;
-	StagingTextureDesc.Height = m_target->SizeY;
-	StagingTextureDesc.MipLevels = 1;
-	StagingTextureDesc.ArraySize = 1;
-	StagingTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	StagingTextureDesc.SampleDesc.Count = 1;
-	StagingTextureDesc.SampleDesc.Quality = 0;
-	StagingTextureDesc.Usage = D3D11_USAGE_STAGING;
-	StagingTextureDesc.BindFlags = 0;
-	StagingTextureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-	StagingTextureDesc.MiscFlags = 0;
-
-	result = device->CreateTexture2D(&StagingTextureDesc, NULL, &m_StagingBuffer);
-	if (FAILED(result))
-	{
-		return false;
+	if (bCreateStaging) {
+		m_Date.Init(0, m_target->SizeX * m_target->SizeY * 4);
+
+		HRESULT result;
+		D3D11_TEXTURE2D_DESC StagingTextureDesc;
+		ZeroMemory(&StagingTextureDesc, sizeof(StagingTextureDesc));
+		StagingTextureDesc.Width = m_target->SizeX;
+		StagingTextureDesc.Height = m_target->SizeY;
+		StagingTextureDesc.MipLevels = 1;
+		StagingTextureDesc.ArraySize = 1;
+		StagingTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		StagingTextureDesc.SampleDesc.Count = 1;
+		StagingTextureDesc.SampleDesc.Quality = 0;
+		StagingTextureDesc.Usage = D3D11_USAGE_STAGING;
+		StagingTextureDesc.BindFlags = 0;
+		StagingTextureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		StagingTextureDesc.MiscFlags = 0;
+
+		result = device->CreateTexture2D(&StagingTextureDesc, NULL, &m_StagingBuffer);
+		if (FAILED(result))
+		{
+			return false;
+		}
+		else {
+			bInitializeSuccess = true;
+		}
 	}
 	else {
 		bInitializeSuccess = true;
 	}
 
-
 #ifdef RENDER_IN_WINDOW
 
 	InitializeWindow(m_target->SizeX, m_target->SizeY);
-	bInitializeSuccess = InitializeSwapChain(m_target->SizeX, m_target->SizeY);
+	bInitializeSuccess = InitializeSwapChain(m_target->SizeX, m_target->SizeY) && bInitializeSuccess;
 	DisplayerPtr = this;
 
 #endif // RENDER_IN_WINDOW
@@ -64,7 +83,7 @@ bool VisualDisplayer::Initialize()
 
 void VisualDisplayer::DisplayOnTexture()
 {
-	if (!bInitializeSuccess) {
+	if (!bInitializeSuccess || !m_StagingBuffer) {
 		return;
 	}
 
@@ -109,7 +128,19 @@ void VisualDisplayer::ExecuteWindow(double DeltaTime)
 
 void VisualDisplayer::DisplayOnWindow()
 {
-	m_swapChain->Present(0, 0);
+	if (!m_swapChain) {
+		return;
+	}
+	UINT flags = m_syncInterval == 0 && bTearingSupported ? DXGI_PRESENT_ALLOW_TEARING : 0;
+	m_swapChain->Present(m_syncInterval, flags);
+}
+
+bool VisualDisplayer::IsWindowFrameReady()
+{
+	if (!m_swapChain || !m_hwnd) {
+		return false;
+	}
+	return !m_frameLatencyWaitable || WaitForSingleObjectEx(m_frameLatencyWaitable, 0, FALSE) == WAIT_OBJECT_0;
 }
 
 LRESULT VisualDisplayer::MessageHandler(HWND hwnd, UINT umsg, WPARAM wparam, LPARAM lparam)
@@ -234,60 +265,76 @@ void VisualDisplayer::InitializeWindow(unsigned int inWidth, unsigned int inHeig
 bool VisualDisplayer::InitializeSwapChain(unsigned int inWidth, unsigned int inHeight)
 {
 	HRESULT result;
-	DXGI_SWAP_CHAIN_DESC swapChainDesc;
+	DXGI_SWAP_CHAIN_DESC1 swapChainDesc;
 	ID3D11Texture2D* backBufferPtr;
 
-	// Initialize the swap chain description.
-	ZeroMemory(&swapChainDesc, sizeof(swapChainDesc));
+	IDXGIDevice * pDXGIDevice = nullptr;
+	m_D3DManager->GetDevice()->QueryInterface(__uuidof(IDXGIDevice), (void **)&pDXGIDevice);
 
-	// Set to a single back buffer.
-	swapChainDesc.BufferCount = 1;
+	IDXGIAdapter * pDXGIAdapter = nullptr;
+	pDXGIDevice->GetAdapter(&pDXGIAdapter);
 
-	// Set the width and height of the back buffer.
-	swapChainDesc.BufferDesc.Width = inWidth;
-	swapChainDesc.BufferDesc.Height = inHeight;
+	// Flip model needs a DXGI 1.2 factory, tearing a 1.5 one
+	IDXGIFactory2 * pIDXGIFactory = nullptr;
+	result = pDXGIAdapter->GetParent(__uuidof(IDXGIFactory2), (void **)&pIDXGIFactory);
+	SAFE_RELEASE(pDXGIAdapter);
+	SAFE_RELEASE(pDXGIDevice);
+	if (FAILED(result)) {
+		UE_LOG(LogTemp, Warning, TEXT("DXGI 1.2 Not Supported"));
+		return false;
+	}
 
-	// Set regular 32-bit surface for the back buffer.
-	swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	//swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	bTearingSupported = false;
+	IDXGIFactory5 * pIDXGIFactory5 = nullptr;
+	if (bAllowTearing && SUCCEEDED(pIDXGIFactory->QueryInterface(__uuidof(IDXGIFactory5), (void **)&pIDXGIFactory5))) {
+		BOOL allowTearing = FALSE;
+		if (SUCCEEDED(pIDXGIFactory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing)))) {
+			bTearingSupported = allowTearing == TRUE;
+		}
+		SAFE_RELEASE(pIDXGIFactory5);
+	}
 
-	// Set the refresh rate of the back buffer.
-	swapChainDesc.BufferDesc.RefreshRate.Numerator = 0;
-	swapChainDesc.BufferDesc.RefreshRate.Denominator = 1;
+	// Initialize the swap chain description.
+	ZeroMemory(&swapChainDesc, sizeof(swapChainDesc));
 
-	// Set the usage of the back buffer.
+	// Flip model presents from two back buffers, the window is composed without a copy
+	swapChainDesc.BufferCount = 2;
+	swapChainDesc.Width = inWidth;
+	swapChainDesc.Height = inHeight;
+	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swapChainDesc.OutputWindow = this->GetWindowHandle();
-
-	// Turn multisampling off.
 	swapChainDesc.SampleDesc.Count = 1;
 	swapChainDesc.SampleDesc.Quality = 0;
-	swapChainDesc.Windowed = true;
-
-	// Set the scan line ordering and scaling to unspecified.
-	swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-	swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-
-	// Discard the back buffer contents after presenting.
-	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-
-	// Don't set the advanced flags.
-	swapChainDesc.Flags = 0;
-
-	IDXGIDevice * pDXGIDevice = nullptr;
-	m_D3DManager->GetDevice()->QueryInterface(__uuidof(IDXGIDevice), (void **)&pDXGIDevice);
-
-	IDXGIAdapter * pDXGIAdapter = nullptr;
-	pDXGIDevice->GetAdapter(&pDXGIAdapter);
+	swapChainDesc.Scaling = DXGI_SCALING_NONE;
+	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	if (bTearingSupported) {
+		swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+	}
 
-	IDXGIFactory * pIDXGIFactory = nullptr;
-	pDXGIAdapter->GetParent(__uuidof(IDXGIFactory), (void **)&pIDXGIFactory);
+	IDXGISwapChain1 * pSwapChain1 = nullptr;
+	result = pIDXGIFactory->CreateSwapChainForHwnd(m_D3DManager->GetDevice(), this->GetWindowHandle(), &swapChainDesc, nullptr, nullptr, &pSwapChain1);
+	if (SUCCEEDED(result)) {
+		// No Alt+Enter, the window stays a borderless popup
+		pIDXGIFactory->MakeWindowAssociation(this->GetWindowHandle(), DXGI_MWA_NO_ALT_ENTER);
+	}
+	SAFE_RELEASE(pIDXGIFactory);
+	if (FAILED(result)) {
+		UE_LOG(LogTemp, Warning, TEXT("Create Flip SwapChain Fail"));
+		return false;
+	}
 
-	result = pIDXGIFactory->CreateSwapChain(m_D3DManager->GetDevice(), &swapChainDesc, &m_swapChain);
+	result = pSwapChain1->QueryInterface(__uuidof(IDXGISwapChain2), (void **)&m_swapChain);
+	SAFE_RELEASE(pSwapChain1);
 	if (FAILED(result)) {
 		return false;
 	}
 
+	// One queued frame, the waitable object is signaled as soon as a back buffer can be drawn
+	m_swapChain->SetMaximumFrameLatency(1);
+	m_frameLatencyWaitable = m_swapChain->GetFrameLatencyWaitableObject();
+
 	// Get the pointer to the back buffer.
 	result = this->m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&backBufferPtr);
 	if (FAILED(result))
@@ -297,19 +344,25 @@ bool VisualDisplayer::InitializeSwapChain(unsigned int inWidth, unsigned int inH
 
 	// Create the render target view with the back buffer pointer.
 	result = m_D3DManager->GetDevice()->CreateRenderTargetView(backBufferPtr, NULL, &m_windowRenderTargetView);
+	backBufferPtr->Release();
+	backBufferPtr = 0;
 	if (FAILED(result))
 	{
 		return false;
 	}
 
-	backBufferPtr->Release();
-	backBufferPtr = 0;
-
 	return true;
 }
 
 void VisualDisplayer::ShutdownWindow()
 {
+	if (m_frameLatencyWaitable) {
+		CloseHandle(m_frameLatencyWaitable);
+		m_frameLatencyWaitable = NULL;
+	}
+	SAFE_RELEASE(m_windowRenderTargetView);
+	SAFE_RELEASE(m_swapChain);
+
 	// Remove the window.
 	DestroyWindow(m_hwnd);
 	m_hwnd = NULL;
@@ -30,6 +30,9 @@ class DXRENDER_API VisualDisplayer
 public:
 	void SetOutputTarget(UTextureRenderTarget2D* InTarget) { m_target = InTarget; }
 	void SetD3DManager(D3DManager* InManager) { m_D3DManager = InManager; }
+	// Only used with RENDER_IN_WINDOW. bWindowOnly leaves out the staging copy to the UE target,
+	// syncInterval 0 presents immediately, with tearing when the display supports it
+	void SetWindowOptions(bool bWindowOnly, bool bAllowTearing, int syncInterval);
 	bool Initialize();
 	void DisplayOnTexture();
 	void Destroy();
@@ -43,6 +46,9 @@ private:
 	D3DManager* m_D3DManager = 0;
 	TArray<uint8> m_Date;
 	struct ID3D11Texture2D* m_StagingBuffer = 0;
+	bool bWindowOnly = false;
+	bool bAllowTearing = true;
+	int m_syncInterval = 0;
 
 
 #ifdef RENDER_IN_WINDOW
@@ -54,6 +60,9 @@ public:
 	static LRESULT CALLBACK MessageHandler(HWND hwnd, UINT umsg, WPARAM wparam, LPARAM lparam);
 	static VisualDisplayer* DisplayerPtr;
 	void SetRenderToWindow();
+	// Polls the swap chain's waitable object, false while both back buffers are still queued.
+	// Skipping the window frame then keeps the UE tick from blocking on the window's present
+	bool IsWindowFrameReady();
 	ID3D11RenderTargetView* GetWindowRenderTargetView() { return m_windowRenderTargetView; }
 protected:
 	void InitializeWindow(unsigned int inWidth, unsigned int inHeight);
@@ -65,8 +74,10 @@ protected:
 	HWND m_hwnd = NULL;
 	MSG m_msg;
 
-	IDXGISwapChain* m_swapChain = 0;
+	struct IDXGISwapChain2* m_swapChain = 0;
 	ID3D11RenderTargetView* m_windowRenderTargetView = 0;
+	HANDLE m_frameLatencyWaitable = NULL;
+	bool bTearingSupported = false;
 
 #endif // RENDER_IN_WINDOW
 
@@ -10,14 +10,12 @@ public class JoyconInputPlugin : ModuleRules
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
 		
         PublicDependencyModuleNames.AddRange(new string[]{ "Core", "CoreUObject", "Engine", "InputCore", "Slate", "SlateCore", "ApplicationCore", "Projects" });
-        PrivateDependencyModuleNames.AddRange(new string[] { "InputDevice" });
+        PrivateDependencyModuleNames.AddRange(new string[] { "InputDevice", "HeadMountedDisplay" });
 
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Include"));
         PublicLibraryPaths.Add(Path.Combine(ModuleDirectory, "Bin"));
         PublicLibraryPaths.Add(Path.Combine(ModuleDirectory, "Lib"));
 
-        PublicAdditionalLibraries.Add("JoyconProject.lib");
-        PublicDelayLoadDLLs.Add("JoyconProject.dll");
         PublicDelayLoadDLLs.Add("hidapi.dll");
 
     }
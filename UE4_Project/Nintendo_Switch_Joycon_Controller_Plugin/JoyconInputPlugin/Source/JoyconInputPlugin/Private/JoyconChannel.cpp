@@ -0,0 +1,117 @@
+#include "JoyconChannel.h"
+#include "HAL/PlatformAtomics.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+
+void FJoyconChannel::Connect()
+{
+	this->fusion.Reset();
+	// A fresh connection is at rest, whatever the game last asked for goes out again
+	this->sentLow = 0.f;
+	this->sentHigh = 0.f;
+	this->rumbleSent = FPlatformAtomics::AtomicRead(&this->rumbleSequence) - 1;
+	this->bConnected = true;
+}
+
+void FJoyconChannel::Disconnect()
+{
+	// Release whatever was held so no key sticks down while the controller is gone
+	FJoyconState released;
+	released.reportCount = this->previous.reportCount;
+	released.timestamp = FPlatformTime::Seconds();
+	TArray<FJoyconImuSample> none;
+	this->OnReport(released, none);
+	this->bConnected = false;
+}
+
+void FJoyconChannel::OnReport(FJoyconState state, const TArray<FJoyconImuSample>& samples)
+{
+	state.reportCount = this->previous.reportCount + 1;
+	uint32 changed = state.buttons ^ this->previous.buttons;
+	if (changed) {
+		this->edges.Enqueue({ state.buttons, changed, state.timestamp });
+	}
+	this->Publish(state);
+	this->previous = state;
+
+	if (samples.Num() == 0) {
+		return;
+	}
+	if (this->bResetFusion) {
+		this->bResetFusion = false;
+		this->fusion.Reset();
+	}
+	for (const FJoyconImuSample& sample : samples) {
+		this->fusion.Update(sample, JoyconImuSamplePeriod);
+	}
+	this->imuSampleCount += samples.Num();
+
+	FJoyconPose newest;
+	newest.orientation = this->fusion.GetOrientation();
+	newest.timestamp = state.timestamp;
+	newest.sampleCount = this->imuSampleCount;
+	this->PublishPose(newest);
+}
+
+void FJoyconChannel::Publish(const FJoyconState& state)
+{
+	this->slots[this->writeSlot] = state;
+	// The exchange is a full barrier, the slot is written before the reader can take it
+	this->writeSlot = FPlatformAtomics::InterlockedExchange(&this->shared, this->writeSlot | FreshBit) & ~FreshBit;
+}
+
+bool FJoyconChannel::GetLatest(FJoyconState& OutState)
+{
+	if (FPlatformAtomics::AtomicRead(&this->shared) & FreshBit) {
+		this->readSlot = FPlatformAtomics::InterlockedExchange(&this->shared, this->readSlot) & ~FreshBit;
+	}
+	OutState = this->slots[this->readSlot];
+	return OutState.reportCount > 0;
+}
+
+void FJoyconChannel::PublishPose(const FJoyconPose& newest)
+{
+	FPlatformAtomics::InterlockedIncrement(&this->poseSequence);
+	this->pose = newest;
+	FPlatformAtomics::InterlockedIncrement(&this->poseSequence);
+}
+
+bool FJoyconChannel::GetPose(FJoyconPose& OutPose) const
+{
+	int32 begin, end;
+	do {
+		begin = FPlatformAtomics::AtomicRead(&this->poseSequence);
+		FPlatformMisc::MemoryBarrier();
+		OutPose = this->pose;
+		FPlatformMisc::MemoryBarrier();
+		end = FPlatformAtomics::AtomicRead(&this->poseSequence);
+	} while ((begin & 1) || begin != end);
+	return OutPose.sampleCount > 0;
+}
+
+void FJoyconChannel::SetRumble(float lowAmplitude, float highAmplitude)
+{
+	FPlatformAtomics::InterlockedExchange(&this->rumbleLow, *(int32*)&lowAmplitude);
+	FPlatformAtomics::InterlockedExchange(&this->rumbleHigh, *(int32*)&highAmplitude);
+	FPlatformAtomics::InterlockedIncrement(&this->rumbleSequence);
+}
+
+bool FJoyconChannel::TakeRumble(float& OutLow, float& OutHigh)
+{
+	int32 sequence = FPlatformAtomics::AtomicRead(&this->rumbleSequence);
+	if (sequence == this->rumbleSent) {
+		return false;
+	}
+	this->rumbleSent = sequence;
+	int32 low = FPlatformAtomics::AtomicRead(&this->rumbleLow);
+	int32 high = FPlatformAtomics::AtomicRead(&this->rumbleHigh);
+	OutLow = *(float*)&low;
+	OutHigh = *(float*)&high;
+	// Force feedback sets the same values every frame, those don't need another report
+	if (OutLow == this->sentLow && OutHigh == this->sentHigh) {
+		return false;
+	}
+	this->sentLow = OutLow;
+	this->sentHigh = OutHigh;
+	return true;
+}
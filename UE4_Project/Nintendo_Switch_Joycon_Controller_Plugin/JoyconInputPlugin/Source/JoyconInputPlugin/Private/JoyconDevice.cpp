@@ -1,73 +1,156 @@
 #include "JoyconDevice.h"
 #include "JoyconInputLibrary.h"
+#include "Features/IModularFeatures.h"
+#include "HAL/IConsoleManager.h"
+
+/** logs every button change, off by default since it runs in the input path **/
+#ifndef JOYCON_LOG_BUTTONS
+#define JOYCON_LOG_BUTTONS 0
+#endif
+
+static TAutoConsoleVariable<int32> CVarJoyconLatencyReport(TEXT("joycon.LatencyReport"), 0, TEXT("Log the Joycon input latency histogram every few seconds"));
+static TAutoConsoleVariable<int32> CVarJoyconPredictAxes(TEXT("joycon.PredictAxes"), 0, TEXT("Extrapolate the sticks by one frame to hide the pipeline delay"));
+
+constexpr const FGamepadKeyNames::Type* FJoyconDevice::LeftJoyconInputKeyNames[JoyconButtonCount];
+constexpr const FGamepadKeyNames::Type* FJoyconDevice::RightJoyconInputKeyNames[JoyconButtonCount];
 
 FJoyconDevice::FJoyconDevice(const TSharedRef<FGenericApplicationMessageHandler>& InMessageHandler)
 	: MessageHandler(InMessageHandler)
 {
-	LeftJoyconData.Push(JoyconData());
-	LeftJoyconData.Push(JoyconData());
-
-	RightJoyconData.Push(JoyconData());
-	RightJoyconData.Push(JoyconData());
+	IModularFeatures::Get().RegisterModularFeature(GetModularFeatureName(), static_cast<IMotionController*>(this));
+	this->Manager.Start();
 }
 
 FJoyconDevice::~FJoyconDevice()
 {
+	IModularFeatures::Get().UnregisterModularFeature(GetModularFeatureName(), static_cast<IMotionController*>(this));
 }
 
 void FJoyconDevice::SendControllerEvents()
 {
-	//CalledCount++;
-	//UE_LOG(LogTemp, Warning, TEXT("FJoyconDevice::SendControllerEvents():%d"), CalledCount);
-
-	/** Poll Left Joycon and send message **/  
-	this->JoyconHandle_L->Poll();
-	LeftJoyconData[1].jc_x = this->JoyconHandle_L->GetStickX();
-	LeftJoyconData[1].jc_y = this->JoyconHandle_L->GetStickY();
-
-	for (auto& item : LeftJoyconData[1].ButtonState) {
-		LeftJoyconData[1].ButtonState[item.Key] = this->JoyconHandle_L->GetButtonState(item.Key);
-		if (LeftJoyconData[0].ButtonState[item.Key] != LeftJoyconData[1].ButtonState[item.Key]) {
-			UE_LOG(LogTemp, Warning, TEXT("Button State Change %s"), UTF8_TO_TCHAR(ButtonEnumToString[item.Key].c_str()));
-			if (LeftJoyconData[1].ButtonState[item.Key]) {
-				this->MessageHandler->OnControllerButtonPressed(ButtonNameToLeftJoyconInputKeyNames[item.Key], 0, false);
+	this->Latency.bReport = CVarJoyconLatencyReport.GetValueOnGameThread() != 0;
+	for (int32 id = 0; id < MaxJoyconControllers; id++) {
+		this->SendJoyconEvents(*this->Manager.GetChannel(id, SIDE::LEFT), id, LeftJoyconInputKeyNames, FJoyconInputKeyNames::Joycon_AxisX_L, FJoyconInputKeyNames::Joycon_AxisY_L);
+		this->SendJoyconEvents(*this->Manager.GetChannel(id, SIDE::RIGHT), id, RightJoyconInputKeyNames, FJoyconInputKeyNames::Joycon_AxisX_R, FJoyconInputKeyNames::Joycon_AxisY_R);
+	}
+}
+
+void FJoyconDevice::SendJoyconEvents(FJoyconChannel& channel, int32 controllerId, const FGamepadKeyNames::Type* const* keyNames, FGamepadKeyNames::Type axisX, FGamepadKeyNames::Type axisY)
+{
+	/** every change since the last frame, in order, the releases of a disconnect included **/
+	FJoyconButtonEdge edge;
+	while (channel.PopEdge(edge)) {
+		this->Latency.OnConsumed(edge.timestamp);
+		for (uint32 changed = edge.changed; changed; changed &= changed - 1) {
+			uint32 button = FMath::CountTrailingZeros(changed);
+#if JOYCON_LOG_BUTTONS
+			UE_LOG(LogTemp, Log, TEXT("Button State Change %s"), UTF8_TO_TCHAR(ButtonEnumToString[(BUTTON_NAME)button].c_str()));
+#endif
+			if (edge.buttons & (1u << button)) {
+				this->MessageHandler->OnControllerButtonPressed(*keyNames[button], controllerId, false);
 			}
 			else {
-				this->MessageHandler->OnControllerButtonReleased(ButtonNameToLeftJoyconInputKeyNames[item.Key], 0, false);
+				this->MessageHandler->OnControllerButtonReleased(*keyNames[button], controllerId, false);
 			}
 		}
 	}
-	LeftJoyconData[0].ButtonState = LeftJoyconData[1].ButtonState;
 
-	this->MessageHandler->OnControllerAnalog(FJoyconInputKeyNames::Joycon_AxisX_L, 0, LeftJoyconData[1].jc_x);
-	this->MessageHandler->OnControllerAnalog(FJoyconInputKeyNames::Joycon_AxisY_L, 0, LeftJoyconData[1].jc_y);
+	FJoyconState state;
+	if (channel.IsConnected() && channel.GetLatest(state)) {
+		int32 index = controllerId * 2 + (keyNames == LeftJoyconInputKeyNames ? SIDE::LEFT : SIDE::RIGHT);
+		FAxisPredictor* predictors = this->Predictors[index];
+		if (state.reportCount != this->ConsumedReport[index]) {
+			this->ConsumedReport[index] = state.reportCount;
+			this->Latency.OnConsumed(state.timestamp);
+			predictors[0].AddSample(state.stickX, state.timestamp);
+			predictors[1].AddSample(state.stickY, state.timestamp);
+		}
 
+		if (CVarJoyconPredictAxes.GetValueOnGameThread() != 0) {
+			// Where the stick will be when this frame is on screen
+			double target = FPlatformTime::Seconds() + this->LastDeltaTime;
+			state.stickX = predictors[0].Predict(target);
+			state.stickY = predictors[1].Predict(target);
+		}
+		this->MessageHandler->OnControllerAnalog(axisX, controllerId, state.stickX);
+		this->MessageHandler->OnControllerAnalog(axisY, controllerId, state.stickY);
+	}
+}
 
-	/** Poll Right Joycon and send message **/
-	this->JoyconHandle_R->Poll();
-	RightJoyconData[1].jc_x = this->JoyconHandle_R->GetStickX();
-	RightJoyconData[1].jc_y = this->JoyconHandle_R->GetStickY();
+void FJoyconDevice::SetChannelValue(int32 ControllerId, FForceFeedbackChannelType ChannelType, float Value)
+{
+	if (ControllerId < 0 || ControllerId >= MaxJoyconControllers) {
+		return;
+	}
+	bool bLeft = ChannelType == FForceFeedbackChannelType::LEFT_LARGE || ChannelType == FForceFeedbackChannelType::LEFT_SMALL;
+	bool bLarge = ChannelType == FForceFeedbackChannelType::LEFT_LARGE || ChannelType == FForceFeedbackChannelType::RIGHT_LARGE;
+	SIDE side = bLeft ? SIDE::LEFT : SIDE::RIGHT;
+	FRumbleValues& values = this->Rumble[ControllerId * 2 + side];
+	(bLarge ? values.low : values.high) = Value;
+	this->SetRumble(ControllerId, side, values.low, values.high);
+}
 
-	for (auto& item : RightJoyconData[1].ButtonState) {
-		RightJoyconData[1].ButtonState[item.Key] = this->JoyconHandle_R->GetButtonState(item.Key);
-		if (RightJoyconData[0].ButtonState[item.Key] != RightJoyconData[1].ButtonState[item.Key]) {
-			UE_LOG(LogTemp, Warning, TEXT("Button State Change %s"), UTF8_TO_TCHAR(ButtonEnumToString[item.Key].c_str()));
-			if (RightJoyconData[1].ButtonState[item.Key]) {
-				this->MessageHandler->OnControllerButtonPressed(ButtonNameToRightJoyconInputKeyNames[item.Key], 0, false);
-			}
-			else {
-				this->MessageHandler->OnControllerButtonReleased(ButtonNameToRightJoyconInputKeyNames[item.Key], 0, false);
-			}
-		}
+void FJoyconDevice::SetChannelValues(int32 ControllerId, const FForceFeedbackValues& Values)
+{
+	this->SetRumble(ControllerId, SIDE::LEFT, Values.LeftLarge, Values.LeftSmall);
+	this->SetRumble(ControllerId, SIDE::RIGHT, Values.RightLarge, Values.RightSmall);
+}
+
+void FJoyconDevice::SetRumble(int32 ControllerId, SIDE Side, float LowAmplitude, float HighAmplitude)
+{
+	FJoyconChannel* channel = this->Manager.GetChannel(ControllerId, Side);
+	if (!channel) {
+		return;
+	}
+	this->Rumble[ControllerId * 2 + Side].low = LowAmplitude;
+	this->Rumble[ControllerId * 2 + Side].high = HighAmplitude;
+	channel->SetRumble(LowAmplitude, HighAmplitude);
+}
+
+FName FJoyconDevice::GetMotionControllerDeviceTypeName() const
+{
+	static const FName DeviceTypeName(TEXT("NintendoJoyconController"));
+	return DeviceTypeName;
+}
+
+const FJoyconChannel* FJoyconDevice::GetChannel(const int32 ControllerIndex, const EControllerHand DeviceHand) const
+{
+	if (DeviceHand == EControllerHand::Left) {
+		return this->Manager.GetChannel(ControllerIndex, SIDE::LEFT);
+	}
+	if (DeviceHand == EControllerHand::Right) {
+		return this->Manager.GetChannel(ControllerIndex, SIDE::RIGHT);
 	}
-	RightJoyconData[0].ButtonState = RightJoyconData[1].ButtonState;
+	return nullptr;
+}
+
+bool FJoyconDevice::GetControllerOrientationAndPosition(const int32 ControllerIndex, const EControllerHand DeviceHand, FRotator& OutOrientation, FVector& OutPosition, float WorldToMetersScale) const
+{
+	FJoyconPose pose;
+	if (!this->GetJoyconPose(ControllerIndex, DeviceHand, pose)) {
+		return false;
+	}
+	OutOrientation = pose.orientation.Rotator();
+	OutPosition = FVector::ZeroVector;
+	return true;
+}
 
-	this->MessageHandler->OnControllerAnalog(FJoyconInputKeyNames::Joycon_AxisX_R, 0, RightJoyconData[1].jc_x);
-	this->MessageHandler->OnControllerAnalog(FJoyconInputKeyNames::Joycon_AxisY_R, 0, RightJoyconData[1].jc_y);
+ETrackingStatus FJoyconDevice::GetControllerTrackingStatus(const int32 ControllerIndex, const EControllerHand DeviceHand) const
+{
+	FJoyconPose pose;
+	return this->GetJoyconPose(ControllerIndex, DeviceHand, pose) ? ETrackingStatus::InertialOnly : ETrackingStatus::NotTracked;
 }
 
-void FJoyconDevice::setJoyconHandle(TSharedPtr<JoyconBase> InJoyconHandle_L, TSharedPtr<JoyconBase> InJoyconHandle_R)
+bool FJoyconDevice::GetJoyconPose(const int32 ControllerIndex, const EControllerHand DeviceHand, FJoyconPose& OutPose) const
 {
-	this->JoyconHandle_L = InJoyconHandle_L;
-	this->JoyconHandle_R = InJoyconHandle_R;
+	const FJoyconChannel* channel = this->GetChannel(ControllerIndex, DeviceHand);
+	return channel && channel->IsConnected() && channel->GetPose(OutPose);
+}
+
+void FJoyconDevice::ResetOrientation()
+{
+	for (int32 id = 0; id < MaxJoyconControllers; id++) {
+		this->Manager.GetChannel(id, SIDE::LEFT)->ResetOrientation();
+		this->Manager.GetChannel(id, SIDE::RIGHT)->ResetOrientation();
+	}
 }
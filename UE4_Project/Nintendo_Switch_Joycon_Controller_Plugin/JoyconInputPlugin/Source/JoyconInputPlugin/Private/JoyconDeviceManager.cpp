@@ -0,0 +1,142 @@
+#include "JoyconDeviceManager.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+FJoyconDeviceManager::~FJoyconDeviceManager()
+{
+	if (this->thread) {
+		this->Stop();
+		this->thread->WaitForCompletion();
+		delete this->thread;
+	}
+	FJoyconHidApi::Unload();
+}
+
+bool FJoyconDeviceManager::Start()
+{
+	if (!FJoyconHidApi::Load()) {
+		UE_LOG(LogTemp, Warning, TEXT("hidapi could not be loaded, no Joycon will connect"));
+		return false;
+	}
+	this->thread = FRunnableThread::Create(this, TEXT("JoyconIO"), 0, TPri_AboveNormal);
+	return this->thread != nullptr;
+}
+
+uint32 FJoyconDeviceManager::Run()
+{
+	double nextEnumerate = 0.0;
+	while (!this->bStop) {
+		double now = FPlatformTime::Seconds();
+		if (now >= nextEnumerate) {
+			this->Enumerate();
+			nextEnumerate = now + EnumerateInterval;
+		}
+
+		bool bAnyReport = false;
+		this->PollAll(bAnyReport);
+		// A report is due about every 15 ms per controller, nothing waiting means nothing to do for a moment
+		if (!bAnyReport) {
+			FPlatformProcess::Sleep(0.001f);
+		}
+	}
+
+	for (int32 i = 0; i < MaxJoyconControllers * 2; i++) {
+		if (this->slots[i].connection.IsOpen()) {
+			this->slots[i].connection.Close();
+			this->channels[i].Disconnect();
+		}
+	}
+	return 0;
+}
+
+void FJoyconDeviceManager::PollAll(bool& bOutAnyReport)
+{
+	for (int32 i = 0; i < MaxJoyconControllers * 2; i++) {
+		FJoyconSlot& slot = this->slots[i];
+		if (!slot.connection.IsOpen()) {
+			continue;
+		}
+
+		int32 result;
+		do {
+			FJoyconState state;
+			this->samples.Reset();
+			result = slot.connection.Read(state, this->samples);
+			if (result > 0) {
+				this->channels[i].OnReport(state, this->samples);
+				bOutAnyReport = true;
+			}
+		} while (result > 0);
+
+		if (result < 0) {
+			UE_LOG(LogTemp, Warning, TEXT("Joycon %s disconnected from controller %d"), *slot.serial, i / 2);
+			slot.connection.Close();
+			slot.path.Empty();
+			this->channels[i].Disconnect();
+			continue;
+		}
+
+		// Only the newest rumble of an output interval is sent, the ones in between are dropped
+		float low, high;
+		if (slot.connection.CanSend(FPlatformTime::Seconds()) && this->channels[i].TakeRumble(low, high)) {
+			slot.connection.SendRumble(low, high);
+		}
+	}
+}
+
+bool FJoyconDeviceManager::IsOpen(const char* path) const
+{
+	for (const FJoyconSlot& slot : this->slots) {
+		if (slot.connection.IsOpen() && slot.path == ANSI_TO_TCHAR(path)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 FJoyconDeviceManager::FindFreeController(const FString& serial, SIDE side) const
+{
+	const int32* known = this->knownSerials.Find(serial);
+	if (known && !this->slots[*known * 2 + side].connection.IsOpen()) {
+		return *known;
+	}
+	for (int32 id = 0; id < MaxJoyconControllers; id++) {
+		if (!this->slots[id * 2 + side].connection.IsOpen()) {
+			return id;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void FJoyconDeviceManager::Enumerate()
+{
+	FHidDeviceInfo* devices = FJoyconHidApi::Enumerate(FJoyconHidApi::NintendoVendorId, 0);
+	for (FHidDeviceInfo* device = devices; device; device = device->next) {
+		if (device->productId != FJoyconHidApi::JoyconLeftProductId && device->productId != FJoyconHidApi::JoyconRightProductId) {
+			continue;
+		}
+		if (!device->path || this->IsOpen(device->path)) {
+			continue;
+		}
+
+		SIDE side = device->productId == FJoyconHidApi::JoyconLeftProductId ? SIDE::LEFT : SIDE::RIGHT;
+		FString serial = device->serialNumber ? FString(WCHAR_TO_TCHAR(device->serialNumber)) : FString(ANSI_TO_TCHAR(device->path));
+		int32 id = this->FindFreeController(serial, side);
+		if (id == INDEX_NONE) {
+			continue;
+		}
+
+		FJoyconSlot& slot = this->slots[id * 2 + side];
+		if (!slot.connection.Open(device->path, side, id)) {
+			UE_LOG(LogTemp, Warning, TEXT("Joycon %s could not be opened"), *serial);
+			continue;
+		}
+		slot.path = ANSI_TO_TCHAR(device->path);
+		slot.serial = serial;
+		this->knownSerials.Add(serial, id);
+		this->channels[id * 2 + side].Connect();
+		UE_LOG(LogTemp, Log, TEXT("Joycon %s %s connected as controller %d"), side == SIDE::LEFT ? TEXT("L") : TEXT("R"), *serial, id);
+	}
+	FJoyconHidApi::FreeEnumeration(devices);
+}
@@ -0,0 +1,249 @@
+#include "JoyconHid.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+void* FJoyconHidApi::dll = nullptr;
+FHidDeviceInfo* (*FJoyconHidApi::Enumerate)(unsigned short, unsigned short) = nullptr;
+void (*FJoyconHidApi::FreeEnumeration)(FHidDeviceInfo*) = nullptr;
+hid_device* (*FJoyconHidApi::OpenPath)(const char*) = nullptr;
+int (*FJoyconHidApi::Write)(hid_device*, const unsigned char*, size_t) = nullptr;
+int (*FJoyconHidApi::ReadTimeout)(hid_device*, unsigned char*, size_t, int) = nullptr;
+void (*FJoyconHidApi::Close)(hid_device*) = nullptr;
+
+bool FJoyconHidApi::Load()
+{
+	if (dll) {
+		return true;
+	}
+	// Already loaded by the module, this only takes another reference
+	dll = FPlatformProcess::GetDllHandle(TEXT("hidapi.dll"));
+	if (!dll) {
+		return false;
+	}
+	Enumerate = (FHidDeviceInfo* (*)(unsigned short, unsigned short))FPlatformProcess::GetDllExport(dll, TEXT("hid_enumerate"));
+	FreeEnumeration = (void (*)(FHidDeviceInfo*))FPlatformProcess::GetDllExport(dll, TEXT("hid_free_enumeration"));
+	OpenPath = (hid_device* (*)(const char*))FPlatformProcess::GetDllExport(dll, TEXT("hid_open_path"));
+	Write = (int (*)(hid_device*, const unsigned char*, size_t))FPlatformProcess::GetDllExport(dll, TEXT("hid_write"));
+	ReadTimeout = (int (*)(hid_device*, unsigned char*, size_t, int))FPlatformProcess::GetDllExport(dll, TEXT("hid_read_timeout"));
+	Close = (void (*)(hid_device*))FPlatformProcess::GetDllExport(dll, TEXT("hid_close"));
+	if (!Enumerate || !FreeEnumeration || !OpenPath || !Write || !ReadTimeout || !Close) {
+		Unload();
+		return false;
+	}
+	return true;
+}
+
+void FJoyconHidApi::Unload()
+{
+	if (dll) {
+		FPlatformProcess::FreeDllHandle(dll);
+		dll = nullptr;
+	}
+}
+
+/** Where each BUTTON_NAME sits in the three button bytes of a report, per side **/
+struct FJoyconButtonBit {
+	uint8 byte;
+	uint8 mask;
+};
+
+static constexpr FJoyconButtonBit LeftButtonBits[JoyconButtonCount] = { { 5, 0x80 }, { 5, 0x40 }, { 4, 0x01 }, { 4, 0x08 }, { 5, 0x02 }, { 5, 0x01 }, { 5, 0x08 }, { 5, 0x04 }, { 4, 0x20 }, { 5, 0x20 }, { 5, 0x10 } };
+static constexpr FJoyconButtonBit RightButtonBits[JoyconButtonCount] = { { 3, 0x80 }, { 3, 0x40 }, { 4, 0x02 }, { 4, 0x04 }, { 3, 0x02 }, { 3, 0x04 }, { 3, 0x01 }, { 3, 0x08 }, { 4, 0x10 }, { 3, 0x20 }, { 3, 0x10 } };
+
+/** Nominal sensitivity, the IMU factory calibration only moves these by a few percent **/
+static const float AccelScale = 0.000244f;
+static const float GyroScale = 0.06103f * PI / 180.f;
+
+static FORCEINLINE int16 ReadInt16(const uint8* data)
+{
+	return (int16)(data[0] | (data[1] << 8));
+}
+
+static FORCEINLINE void ReadUInt12Pair(const uint8* data, uint16& OutFirst, uint16& OutSecond)
+{
+	OutFirst = data[0] | ((data[1] & 0xF) << 8);
+	OutSecond = (data[1] >> 4) | (data[2] << 4);
+}
+
+bool FJoyconConnection::Open(const char* path, SIDE InSide, int32 playerIndex)
+{
+	this->Close();
+	this->side = InSide;
+	this->handle = FJoyconHidApi::OpenPath(path);
+	if (!this->handle) {
+		return false;
+	}
+
+	// The calibration reply comes in the default report mode, so it is read first
+	this->ReadStickCalibration();
+
+	uint8 enable = 0x01;
+	uint8 fullReport = 0x30;
+	// Players 1 to 4 light one LED, 5 to 8 flash it
+	uint8 lights = playerIndex < 4 ? (1 << playerIndex) : (0x10 << (playerIndex % 4));
+	if (!this->SendSubcommand(0x40, &enable, 1) || !this->SendSubcommand(0x03, &fullReport, 1) || !this->SendSubcommand(0x30, &lights, 1)) {
+		this->Close();
+		return false;
+	}
+	return true;
+}
+
+void FJoyconConnection::Close()
+{
+	if (this->handle) {
+		FJoyconHidApi::Close(this->handle);
+		this->handle = nullptr;
+	}
+}
+
+bool FJoyconConnection::SendOutput(uint8* packet, int32 length)
+{
+	packet[1] = this->packetCounter++ & 0xF;
+	FMemory::Memcpy(packet + 2, this->rumble, sizeof(this->rumble));
+	this->lastOutputTime = FPlatformTime::Seconds();
+	return FJoyconHidApi::Write(this->handle, packet, length) >= 0;
+}
+
+bool FJoyconConnection::SendSubcommand(uint8 subcommand, const uint8* data, int32 length)
+{
+	uint8 packet[0x31] = { 0 };
+	packet[0] = 0x01;
+	packet[10] = subcommand;
+	FMemory::Memcpy(packet + 11, data, FMath::Min(length, (int32)sizeof(packet) - 11));
+	return this->SendOutput(packet, sizeof(packet));
+}
+
+bool FJoyconConnection::SendRumble(float lowAmplitude, float highAmplitude)
+{
+	if (!this->handle) {
+		return false;
+	}
+	EncodeRumble(lowAmplitude, highAmplitude, this->rumble);
+	FMemory::Memcpy(this->rumble + 4, this->rumble, 4);
+	// 0x10 carries only the rumble, no subcommand
+	uint8 packet[10] = { 0x10 };
+	return this->SendOutput(packet, sizeof(packet));
+}
+
+static uint8 EncodeRumbleAmplitude(float amplitude)
+{
+	if (amplitude <= 0.f) {
+		return 0;
+	}
+	// Piecewise log curve of the HD rumble amplitude table
+	float encoded;
+	if (amplitude > 0.23f) {
+		encoded = FMath::Log2(amplitude * 8.7f) * 32.f;
+	}
+	else if (amplitude > 0.12f) {
+		encoded = FMath::Log2(amplitude * 17.f) * 16.f;
+	}
+	else {
+		encoded = (FMath::Log2(amplitude) * 32.f - 96.f) / (5.f - amplitude * amplitude) - 1.f;
+	}
+	return (uint8)FMath::Clamp(FMath::RoundToInt(encoded), 0, 200);
+}
+
+void FJoyconConnection::EncodeRumble(float lowAmplitude, float highAmplitude, uint8* OutData)
+{
+	uint8 lowEncoded = EncodeRumbleAmplitude(FMath::Clamp(lowAmplitude, 0.f, 1.f));
+	uint8 highEncoded = EncodeRumbleAmplitude(FMath::Clamp(highAmplitude, 0.f, 1.f));
+	uint8 lowFreq = (uint8)(FMath::RoundToInt(FMath::Log2(RumbleLowFrequency / 10.f) * 32.f) - 0x40);
+	uint16 highFreq = (uint16)((FMath::RoundToInt(FMath::Log2(RumbleHighFrequency / 10.f) * 32.f) - 0x60) * 4);
+	uint8 highAmp = highEncoded * 2;
+	uint16 lowAmp = (lowEncoded / 2 + 64) | ((lowEncoded & 1) ? 0x8000 : 0);
+
+	OutData[0] = highFreq & 0xFF;
+	OutData[1] = highAmp + ((highFreq >> 8) & 0xFF);
+	OutData[2] = lowFreq + ((lowAmp >> 8) & 0xFF);
+	OutData[3] = lowAmp & 0xFF;
+}
+
+bool FJoyconConnection::ReadSpi(uint32 address, uint8* OutData, int32 length)
+{
+	uint8 request[5] = { (uint8)address, (uint8)(address >> 8), (uint8)(address >> 16), (uint8)(address >> 24), (uint8)length };
+	if (!this->SendSubcommand(0x10, request, sizeof(request))) {
+		return false;
+	}
+	// Input reports keep coming while we wait for the 0x21 reply to this read
+	double deadline = FPlatformTime::Seconds() + 0.2;
+	while (FPlatformTime::Seconds() < deadline) {
+		int32 size = FJoyconHidApi::ReadTimeout(this->handle, this->report, sizeof(this->report), 20);
+		if (size < 0) {
+			return false;
+		}
+		if (size >= 20 + length && this->report[0] == 0x21 && this->report[14] == 0x10 && FMemory::Memcmp(this->report + 15, request, 4) == 0) {
+			FMemory::Memcpy(OutData, this->report + 20, length);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FJoyconConnection::ReadStickCalibration()
+{
+	uint8 data[9];
+	if (!this->ReadSpi(this->side == SIDE::LEFT ? 0x603D : 0x6046, data, sizeof(data))) {
+		UE_LOG(LogTemp, Warning, TEXT("Joycon stick calibration could not be read, using nominal values"));
+		return;
+	}
+	uint16 value[6];
+	ReadUInt12Pair(data, value[0], value[1]);
+	ReadUInt12Pair(data + 3, value[2], value[3]);
+	ReadUInt12Pair(data + 6, value[4], value[5]);
+	// The left stick stores above, center, below, the right one center, below, above
+	int32 above = this->side == SIDE::LEFT ? 0 : 4;
+	int32 center = this->side == SIDE::LEFT ? 2 : 0;
+	int32 below = this->side == SIDE::LEFT ? 4 : 2;
+	for (int32 axis = 0; axis < 2; axis++) {
+		this->stickMax[axis] = FMath::Max<uint16>(value[above + axis], 1);
+		this->stickCenter[axis] = value[center + axis];
+		this->stickMin[axis] = FMath::Max<uint16>(value[below + axis], 1);
+	}
+}
+
+float FJoyconConnection::CalibrateAxis(uint16 value, int32 axis) const
+{
+	float offset = (float)value - this->stickCenter[axis];
+	float travel = offset >= 0.f ? this->stickMax[axis] : this->stickMin[axis];
+	return FMath::Clamp(offset / travel, -1.f, 1.f);
+}
+
+int32 FJoyconConnection::Read(FJoyconState& OutState, TArray<FJoyconImuSample>& OutSamples)
+{
+	if (!this->handle) {
+		return -1;
+	}
+	int32 size = FJoyconHidApi::ReadTimeout(this->handle, this->report, sizeof(this->report), 0);
+	if (size <= 0) {
+		return size;
+	}
+	if (this->report[0] != 0x30 || size < 49) {
+		return 0;
+	}
+
+	const FJoyconButtonBit* bits = this->side == SIDE::LEFT ? LeftButtonBits : RightButtonBits;
+	OutState.buttons = 0;
+	for (int32 i = 0; i < JoyconButtonCount; i++) {
+		if (this->report[bits[i].byte] & bits[i].mask) {
+			OutState.buttons |= 1u << i;
+		}
+	}
+
+	uint16 x, y;
+	ReadUInt12Pair(this->report + (this->side == SIDE::LEFT ? 6 : 9), x, y);
+	OutState.stickX = this->CalibrateAxis(x, 0);
+	OutState.stickY = this->CalibrateAxis(y, 1);
+	OutState.timestamp = FPlatformTime::Seconds();
+
+	// Three samples of accel x, y, z and gyro x, y, z from byte 13, oldest first
+	for (int32 i = 0; i < 3; i++) {
+		const uint8* data = this->report + 13 + i * 12;
+		FJoyconImuSample sample;
+		// Sensor axes to UE axes, Y is flipped for the left handed frame, which also flips the sense of the X and Z rates
+		sample.accel = FVector(ReadInt16(data), -ReadInt16(data + 2), ReadInt16(data + 4)) * AccelScale;
+		sample.gyro = FVector(-ReadInt16(data + 6), ReadInt16(data + 8), -ReadInt16(data + 10)) * GyroScale;
+		OutSamples.Add(sample);
+	}
+	return 1;
+}
@@ -0,0 +1,35 @@
+#include "JoyconImu.h"
+
+void FJoyconFusion::Reset()
+{
+	this->orientation = FQuat::Identity;
+	this->integral = FVector::ZeroVector;
+	this->gyroBias = FVector::ZeroVector;
+}
+
+void FJoyconFusion::Update(const FJoyconImuSample& sample, float dt)
+{
+	FVector gyro = sample.gyro - this->gyroBias;
+	float accelSize = sample.accel.Size();
+
+	// Lying still, whatever the gyro still reads is bias
+	if (gyro.Size() < 0.05f && FMath::Abs(accelSize - 1.f) < 0.05f) {
+		this->gyroBias += (sample.gyro - this->gyroBias) * 0.01f;
+	}
+
+	// Only trust the accelerometer as gravity when it is not also measuring a swing
+	if (accelSize > 0.5f && accelSize < 1.5f) {
+		FVector up = this->orientation.UnrotateVector(FVector::UpVector);
+		FVector error = (sample.accel / accelSize) ^ up;
+		this->integral += error * this->ki * dt;
+		gyro += error * this->kp + this->integral;
+	}
+
+	FQuat rate(gyro.X, gyro.Y, gyro.Z, 0.f);
+	FQuat delta = this->orientation * rate;
+	this->orientation.X += delta.X * 0.5f * dt;
+	this->orientation.Y += delta.Y * 0.5f * dt;
+	this->orientation.Z += delta.Z * 0.5f * dt;
+	this->orientation.W += delta.W * 0.5f * dt;
+	this->orientation.Normalize();
+}
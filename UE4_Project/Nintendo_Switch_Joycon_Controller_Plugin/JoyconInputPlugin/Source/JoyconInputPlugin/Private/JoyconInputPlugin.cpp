@@ -78,26 +78,9 @@ void IJoyconInputPlugin::StartupModule()
 	//FString LibraryPath = FPaths::Combine(*BaseDir, TEXT("Plugins/JoyconInputPlugin/Source/JoyconInputPlugin/Bin/hidapi.dll"));
 	HidApiDLLHandle = !LibraryPath.IsEmpty() ? FPlatformProcess::GetDllHandle(*LibraryPath) : nullptr;
 
-	LibraryPath = FPaths::Combine(*PluginBaseDir, TEXT("Source/JoyconInputPlugin/Bin/JoyconProject.dll"));
-	//LibraryPath = FPaths::Combine(*BaseDir, TEXT("Plugins/JoyconInputPlugin/Source/JoyconInputPlugin/Bin/JoyconProject.dll"));
-	JoyconBaseDLLHandle = !LibraryPath.IsEmpty() ? FPlatformProcess::GetDllHandle(*LibraryPath) : nullptr;
-
-	JoyconBase* pt_L = new JoyconBase(SIDE::LEFT);
-	jc_L = MakeShareable(pt_L);
-
-	JoyconBase* pt_R = new JoyconBase(SIDE::RIGHT);
-	jc_R = MakeShareable(pt_R);
-
-	if (HidApiDLLHandle && JoyconBaseDLLHandle) {
+	// The Joycons are found and opened by the device's I/O thread, startup doesn't wait for them
+	if (HidApiDLLHandle) {
 		UE_LOG(LogTemp, Warning, TEXT("DLL Load Success!"));
-		jc_L->Init();
-		jc_R->Init();
-		if (jc_L->IsValid() && jc_R->IsValid()) {
-			UE_LOG(LogTemp, Warning, TEXT("Joycon Init Success!"));
-		}
-		else {
-			UE_LOG(LogTemp, Warning, TEXT("Joycon Init Fail!"));
-		}
 	}
 	else {
 		UE_LOG(LogTemp, Warning, TEXT("DLL Load Fail!"));
@@ -139,9 +122,8 @@ void IJoyconInputPlugin::ShutdownModule()
 	IModularFeatures::Get().UnregisterModularFeature(IInputDeviceModule::GetModularFeatureName(), this);
 
 
+	// The device's manager holds its own reference to hidapi until its I/O thread is joined
 	FPlatformProcess::FreeDllHandle(HidApiDLLHandle);
-	FPlatformProcess::FreeDllHandle(JoyconBaseDLLHandle);
-	JoyconBaseDLLHandle = nullptr;
 	HidApiDLLHandle = nullptr;
 }
 
@@ -149,7 +131,6 @@ TSharedPtr<class IInputDevice> IJoyconInputPlugin::CreateInputDevice(const TShar
 {
 	FJoyconDevice* pt = new FJoyconDevice(InMessageHandler);
 	JoyconInputDevice = MakeShareable(pt);
-	JoyconInputDevice->setJoyconHandle(jc_L, jc_R);
 	return JoyconInputDevice;
 }
 
@@ -0,0 +1,100 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+
+/**
+ * Header only so any input path can use it, FJoyconDevice and the socket joystick's ADrivePawn both do.
+ * Samples carry the time they were read from HID or the socket, the consumer reports that time once it uses them
+ **/
+
+/** 1 ms buckets, the last one collects everything slower **/
+struct FInputLatencyHistogram {
+	static const int32 BucketCount = 64;
+
+	void Add(double seconds) {
+		int32 bucket = FMath::Clamp((int32)(seconds * 1000.0), 0, BucketCount - 1);
+		this->buckets[bucket]++;
+		this->count++;
+		this->total += seconds;
+		this->worst = FMath::Max(this->worst, seconds);
+	}
+
+	/** upper edge of the bucket the percentile falls in, in ms **/
+	int32 PercentileMs(float percentile) const {
+		uint32 target = (uint32)FMath::CeilToInt(this->count * percentile);
+		uint32 seen = 0;
+		for (int32 i = 0; i < BucketCount; i++) {
+			seen += this->buckets[i];
+			if (seen >= target) {
+				return i + 1;
+			}
+		}
+		return BucketCount;
+	}
+
+	double MeanMs() const { return this->count ? this->total / this->count * 1000.0 : 0.0; }
+	void Reset() { *this = FInputLatencyHistogram(); }
+
+	uint32 buckets[BucketCount] = { 0 };
+	uint32 count = 0;
+	double total = 0.0;
+	double worst = 0.0;
+};
+
+/** Time from receipt to the frame that consumed the sample, logged every ReportInterval seconds when enabled **/
+class FInputLatencyTracker {
+public:
+	explicit FInputLatencyTracker(const TCHAR* InName) : name(InName) {}
+
+	void OnConsumed(double receiptTime) {
+		double now = FPlatformTime::Seconds();
+		this->histogram.Add(now - receiptTime);
+		if (this->bReport && now >= this->nextReport) {
+			if (this->histogram.count) {
+				UE_LOG(LogTemp, Log, TEXT("%s input latency over %u samples: mean %.1f ms, p50 %d ms, p95 %d ms, p99 %d ms, worst %.1f ms"),
+					this->name, this->histogram.count, this->histogram.MeanMs(), this->histogram.PercentileMs(0.5f),
+					this->histogram.PercentileMs(0.95f), this->histogram.PercentileMs(0.99f), this->histogram.worst * 1000.0);
+			}
+			this->histogram.Reset();
+			this->nextReport = now + ReportInterval;
+		}
+	}
+
+	const FInputLatencyHistogram& GetHistogram() const { return this->histogram; }
+
+	bool bReport = false;
+	static constexpr double ReportInterval = 5.0;
+
+protected:
+	const TCHAR* name;
+	FInputLatencyHistogram histogram;
+	double nextReport = 0.0;
+};
+
+/**
+ * Extrapolates an axis from its last two samples to the time it will be seen, hiding a frame of pipeline delay.
+ * The horizon is capped so a stale sample doesn't run away, and the result stays in the axis range
+ **/
+struct FAxisPredictor {
+	void AddSample(float value, double time) {
+		if (time <= this->lastTime) {
+			return;
+		}
+		if (this->lastTime > 0.0) {
+			this->velocity = (value - this->lastValue) / (float)(time - this->lastTime);
+		}
+		this->lastValue = value;
+		this->lastTime = time;
+	}
+
+	float Predict(double targetTime) const {
+		float horizon = FMath::Clamp((float)(targetTime - this->lastTime), 0.f, MaxHorizon);
+		return FMath::Clamp(this->lastValue + this->velocity * horizon, -1.f, 1.f);
+	}
+
+	static constexpr float MaxHorizon = 0.05f;
+
+	float lastValue = 0.f;
+	float velocity = 0.f;
+	double lastTime = 0.0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/ThreadSafeBool.h"
+#include "JoyconHid.h"
+#include "JoyconImu.h"
+
+/** The buttons of a report that changed any, queued so presses shorter than a frame still arrive **/
+struct FJoyconButtonEdge {
+	uint32 buttons;
+	uint32 changed;
+	double timestamp;
+};
+
+/** Fused orientation in UE axes, timestamp is when the newest sample in it was read **/
+struct FJoyconPose {
+	FQuat orientation = FQuat::Identity;
+	double timestamp = 0.0;
+	uint32 sampleCount = 0;
+};
+
+/**
+ * Hands one Joycon's reports from the I/O thread to the game thread. The stick state goes through a triple
+ * buffer and the button changes through a queue, so the game thread never locks and never touches HID
+ **/
+class FJoyconChannel {
+public:
+	/** I/O thread **/
+	void Connect();
+	void Disconnect();
+	void OnReport(FJoyconState state, const TArray<FJoyconImuSample>& samples);
+
+	bool IsConnected() const { return this->bConnected; }
+	/** The newest report, false while none came in since the controller connected **/
+	bool GetLatest(FJoyconState& OutState);
+	/** Reports with button changes in report order, game thread only **/
+	bool PopEdge(FJoyconButtonEdge& OutEdge) { return this->edges.Dequeue(OutEdge); }
+	/** The newest orientation, safe from any thread, false until the first IMU sample **/
+	bool GetPose(FJoyconPose& OutPose) const;
+	/** Restart the fusion from identity, the controller's current pose becomes the reference **/
+	void ResetOrientation() { this->bResetFusion = true; }
+
+	/** Any thread, only the newest value is kept until the I/O thread can send it **/
+	void SetRumble(float lowAmplitude, float highAmplitude);
+	/** I/O thread, true when the value changed since the last call that returned true **/
+	bool TakeRumble(float& OutLow, float& OutHigh);
+
+protected:
+	void Publish(const FJoyconState& state);
+	void PublishPose(const FJoyconPose& newest);
+
+	FThreadSafeBool bConnected;
+	FJoyconState previous;
+
+	/** Triple buffer, the writer and the reader each own a slot, the third is handed over through shared **/
+	static const int32 FreshBit = 4;
+	FJoyconState slots[3];
+	int32 writeSlot = 0;
+	int32 readSlot = 1;
+	volatile int32 shared = 2;
+
+	TQueue<FJoyconButtonEdge, EQueueMode::Spsc> edges;
+
+	/** Every 5 ms sample goes through the filter on the I/O thread, not just the last one of a frame **/
+	FJoyconFusion fusion;
+	FThreadSafeBool bResetFusion;
+	uint32 imuSampleCount = 0;
+
+	/** Seqlock, odd while the writer is inside, readers retry until they saw the same even value on both sides **/
+	FJoyconPose pose;
+	volatile int32 poseSequence = 0;
+
+	/** float bits, the sequence moves after both are written **/
+	volatile int32 rumbleLow = 0;
+	volatile int32 rumbleHigh = 0;
+	volatile int32 rumbleSequence = 0;
+	int32 rumbleSent = 0;
+	float sentLow = 0.f;
+	float sentHigh = 0.f;
+};
@@ -1,51 +1,73 @@
 #pragma once
 #include "IInputDevice.h"
+#include "XRMotionControllerBase.h"
 #include "JoyconBase.h"
 #include "GenericPlatform/GenericApplicationMessageHandler.h"
 #include "JoyconInputLibrary.h"
+#include "JoyconDeviceManager.h"
+#include "InputLatency.h"
 
 //class JoyconBase;
 
-class FJoyconDevice : public IInputDevice
+class FJoyconDevice : public IInputDevice, public FXRMotionControllerBase
 {
 public:
 	FJoyconDevice(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler);
 	~FJoyconDevice();
 
 	/** barely override the pure virtual function to implement the class **/
-	virtual void Tick(float DeltaTime) override {}
+	virtual void Tick(float DeltaTime) override { LastDeltaTime = DeltaTime; }
 	virtual void SetMessageHandler(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler) override { MessageHandler = InMessageHandler; }
 	virtual bool Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar) override { return false; }
-	virtual void SetChannelValue(int32 ControllerId, FForceFeedbackChannelType ChannelType, float Value) override {}
-	virtual void SetChannelValues(int32 ControllerId, const FForceFeedbackValues& Values) override {}
+	/** large motors drive the low band of a Joycon's actuator and small motors the high band, sent from the I/O thread **/
+	virtual void SetChannelValue(int32 ControllerId, FForceFeedbackChannelType ChannelType, float Value) override;
+	virtual void SetChannelValues(int32 ControllerId, const FForceFeedbackValues& Values) override;
+	/** for code that drives the rumble directly, as often as it likes, only the newest value per report goes out **/
+	void SetRumble(int32 ControllerId, SIDE Side, float LowAmplitude, float HighAmplitude);
 
-	/** poll the Device and use MessageHandler to fire event **/
+	/** fire the button changes and the newest stick state the poll threads decoded, never touches HID **/
 	virtual void SendControllerEvents() override;
-	void setJoyconHandle(TSharedPtr<JoyconBase> InJoyconHandle_L, TSharedPtr<JoyconBase> InJoyconHandle_R);
+
+	/** the Joycons as orientation only motion controllers, left hand is the left Joycon of the pair **/
+	virtual FName GetMotionControllerDeviceTypeName() const override;
+	virtual bool GetControllerOrientationAndPosition(const int32 ControllerIndex, const EControllerHand DeviceHand, FRotator& OutOrientation, FVector& OutPosition, float WorldToMetersScale) const override;
+	virtual ETrackingStatus GetControllerTrackingStatus(const int32 ControllerIndex, const EControllerHand DeviceHand) const override;
+
+	/** the fused orientation with the time its newest IMU sample was read, for rigs that extrapolate **/
+	bool GetJoyconPose(const int32 ControllerIndex, const EControllerHand DeviceHand, FJoyconPose& OutPose) const;
+	/** take the current pose of every Joycon as identity **/
+	void ResetOrientation();
 
 	//enum DataTarget{CURRENT_FRAME_LEFT, CURRENT_FRAME_RIGHT, LAST_FRAME_LEFT, LAST_FRAME_RIGHT};
 
-	// Map the ButtonName to UE4 Keyname
-	const TMap<BUTTON_NAME, FGamepadKeyNames::Type> ButtonNameToLeftJoyconInputKeyNames { { BUTTON_NAME::ZL_ZR, FJoyconInputKeyNames::Joycon_ZL }, { BUTTON_NAME::L_R, FJoyconInputKeyNames::Joycon_L }, { BUTTON_NAME::MINUS_PLUS, FJoyconInputKeyNames::Joycon_Minus }, { BUTTON_NAME::STICK_BUTTON, FJoyconInputKeyNames::Joycon_Stick_Button_L }, { BUTTON_NAME::UP_X, FJoyconInputKeyNames::Joycon_Up }, { BUTTON_NAME::DOWN_B, FJoyconInputKeyNames::Joycon_Down }, { BUTTON_NAME::LEFT_Y, FJoyconInputKeyNames::Joycon_L }, { BUTTON_NAME::RIGHT_A, FJoyconInputKeyNames::Joycon_Right }, { BUTTON_NAME::CAPTURE_HOME, FJoyconInputKeyNames::Joycon_Capture }, { BUTTON_NAME::SL, FJoyconInputKeyNames::Joycon_SL_L }, { BUTTON_NAME::SR, FJoyconInputKeyNames::Joycon_SR_L } };
-	const TMap<BUTTON_NAME, FGamepadKeyNames::Type> ButtonNameToRightJoyconInputKeyNames { { BUTTON_NAME::ZL_ZR, FJoyconInputKeyNames::Joycon_ZR }, { BUTTON_NAME::L_R, FJoyconInputKeyNames::Joycon_R }, { BUTTON_NAME::MINUS_PLUS, FJoyconInputKeyNames::Joycon_Plus }, { BUTTON_NAME::STICK_BUTTON, FJoyconInputKeyNames::Joycon_Stick_Button_R }, { BUTTON_NAME::UP_X, FJoyconInputKeyNames::Joycon_X }, { BUTTON_NAME::DOWN_B, FJoyconInputKeyNames::Joycon_B }, { BUTTON_NAME::LEFT_Y, FJoyconInputKeyNames::Joycon_Y }, { BUTTON_NAME::RIGHT_A, FJoyconInputKeyNames::Joycon_A }, { BUTTON_NAME::CAPTURE_HOME, FJoyconInputKeyNames::Joycon_Home }, { BUTTON_NAME::SL, FJoyconInputKeyNames::Joycon_SL_R }, { BUTTON_NAME::SR, FJoyconInputKeyNames::Joycon_SR_R } };
+	// Map the ButtonName to UE4 Keyname, indexed by BUTTON_NAME
+	static constexpr const FGamepadKeyNames::Type* LeftJoyconInputKeyNames[JoyconButtonCount] = { &FJoyconInputKeyNames::Joycon_ZL, &FJoyconInputKeyNames::Joycon_L, &FJoyconInputKeyNames::Joycon_Minus, &FJoyconInputKeyNames::Joycon_Stick_Button_L, &FJoyconInputKeyNames::Joycon_Up, &FJoyconInputKeyNames::Joycon_Down, &FJoyconInputKeyNames::Joycon_Left, &FJoyconInputKeyNames::Joycon_Right, &FJoyconInputKeyNames::Joycon_Capture, &FJoyconInputKeyNames::Joycon_SL_L, &FJoyconInputKeyNames::Joycon_SR_L };
+	static constexpr const FGamepadKeyNames::Type* RightJoyconInputKeyNames[JoyconButtonCount] = { &FJoyconInputKeyNames::Joycon_ZR, &FJoyconInputKeyNames::Joycon_R, &FJoyconInputKeyNames::Joycon_Plus, &FJoyconInputKeyNames::Joycon_Stick_Button_R, &FJoyconInputKeyNames::Joycon_X, &FJoyconInputKeyNames::Joycon_B, &FJoyconInputKeyNames::Joycon_Y, &FJoyconInputKeyNames::Joycon_A, &FJoyconInputKeyNames::Joycon_Home, &FJoyconInputKeyNames::Joycon_SL_R, &FJoyconInputKeyNames::Joycon_SR_R };
 
-	struct JoyconData {
-		float jc_x;
-		float jc_y;
+protected:
+	const FJoyconChannel* GetChannel(const int32 ControllerIndex, const EControllerHand DeviceHand) const;
+	void SendJoyconEvents(FJoyconChannel& channel, int32 controllerId, const FGamepadKeyNames::Type* const* keyNames, FGamepadKeyNames::Type axisX, FGamepadKeyNames::Type axisY);
 
-		TMap<BUTTON_NAME, bool> ButtonState { { BUTTON_NAME::ZL_ZR, false }, { BUTTON_NAME::L_R, false }, { BUTTON_NAME::MINUS_PLUS, false }, { BUTTON_NAME::STICK_BUTTON, false }, { BUTTON_NAME::UP_X, false }, { BUTTON_NAME::DOWN_B, false }, { BUTTON_NAME::LEFT_Y, false }, { BUTTON_NAME::RIGHT_A, false }, { BUTTON_NAME::CAPTURE_HOME, false }, { BUTTON_NAME::SL, false }, { BUTTON_NAME::SR, false } };
+	/** the values SetChannelValue changes one at a time, per controller and side **/
+	struct FRumbleValues {
+		float low = 0.f;
+		float high = 0.f;
 	};
+	FRumbleValues Rumble[MaxJoyconControllers * 2];
+
+	/** receipt to consumption of every report and button change, joycon.LatencyReport logs it **/
+	FInputLatencyTracker Latency { TEXT("Joycon") };
+	/** stick x and y per controller and side, used when joycon.PredictAxes is on **/
+	FAxisPredictor Predictors[MaxJoyconControllers * 2][2];
+	uint32 ConsumedReport[MaxJoyconControllers * 2] = { 0 };
+	float LastDeltaTime = 0.f;
 
-protected:
 	/** Handler to send all messages to. */
 	TSharedRef<FGenericApplicationMessageHandler> MessageHandler;
 	//int CalledCount = 0;
 
-	TSharedPtr<JoyconBase> JoyconHandle_L;
-	TSharedPtr<JoyconBase> JoyconHandle_R;
-
-	TArray<JoyconData> LeftJoyconData;
-	TArray<JoyconData> RightJoyconData;
+	/** owns the HID handles and the I/O thread, the device only reads its channels **/
+	FJoyconDeviceManager Manager;
 
 
 };
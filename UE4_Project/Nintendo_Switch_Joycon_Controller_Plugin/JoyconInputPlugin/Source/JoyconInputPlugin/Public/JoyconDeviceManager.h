@@ -0,0 +1,54 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "JoyconHid.h"
+#include "JoyconChannel.h"
+
+class FRunnableThread;
+
+/** A controller id is one left and one right Joycon, the station setups run up to eight pairs **/
+static const int32 MaxJoyconControllers = 8;
+
+/**
+ * Finds, pairs and polls every Joycon from one I/O thread. Controllers that connect later are picked up by a
+ * periodic enumeration, so nothing waits for Bluetooth at startup. All reads are non-blocking
+ **/
+class FJoyconDeviceManager : public FRunnable
+{
+public:
+	~FJoyconDeviceManager();
+
+	/** Starts the I/O thread, false when hidapi.dll is missing **/
+	bool Start();
+
+	FJoyconChannel* GetChannel(int32 ControllerId, SIDE side) { return ControllerId >= 0 && ControllerId < MaxJoyconControllers ? &this->channels[ControllerId * 2 + side] : nullptr; }
+	const FJoyconChannel* GetChannel(int32 ControllerId, SIDE side) const { return ControllerId >= 0 && ControllerId < MaxJoyconControllers ? &this->channels[ControllerId * 2 + side] : nullptr; }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override { this->bStop = true; }
+
+	/** Seconds between two scans for new controllers **/
+	static constexpr double EnumerateInterval = 1.0;
+
+protected:
+	void Enumerate();
+	bool IsOpen(const char* path) const;
+	int32 FindFreeController(const FString& serial, SIDE side) const;
+	void PollAll(bool& bOutAnyReport);
+
+	/** I/O thread only, index is ControllerId * 2 + SIDE like the channels **/
+	struct FJoyconSlot {
+		FJoyconConnection connection;
+		FString path;
+		FString serial;
+	};
+	FJoyconSlot slots[MaxJoyconControllers * 2];
+	FJoyconChannel channels[MaxJoyconControllers * 2];
+	/** a controller that reconnects gets its old id back when that is still free **/
+	TMap<FString, int32> knownSerials;
+	TArray<FJoyconImuSample> samples;
+
+	FRunnableThread* thread = nullptr;
+	FThreadSafeBool bStop;
+};
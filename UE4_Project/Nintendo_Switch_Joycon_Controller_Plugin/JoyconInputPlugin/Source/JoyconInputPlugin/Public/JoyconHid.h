@@ -0,0 +1,101 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "JoyconBase.h"
+#include "JoyconImu.h"
+
+/** BUTTON_NAME runs from ZL_ZR to SR without gaps, so a button is its bit in a uint32 **/
+static const int32 JoyconButtonCount = SR + 1;
+
+/** Mirrors hid_device_info, hidapi.dll ships without its header **/
+struct FHidDeviceInfo {
+	char* path;
+	unsigned short vendorId;
+	unsigned short productId;
+	wchar_t* serialNumber;
+	unsigned short releaseNumber;
+	wchar_t* manufacturerString;
+	wchar_t* productString;
+	unsigned short usagePage;
+	unsigned short usage;
+	int interfaceNumber;
+	FHidDeviceInfo* next;
+};
+
+/** The hidapi entry points, resolved once from the hidapi.dll the module loaded **/
+struct FJoyconHidApi {
+	static bool Load();
+	static void Unload();
+	static bool IsLoaded() { return dll != nullptr; }
+
+	static FHidDeviceInfo* (*Enumerate)(unsigned short, unsigned short);
+	static void (*FreeEnumeration)(FHidDeviceInfo*);
+	static hid_device* (*OpenPath)(const char*);
+	static int (*Write)(hid_device*, const unsigned char*, size_t);
+	static int (*ReadTimeout)(hid_device*, unsigned char*, size_t, int);
+	static void (*Close)(hid_device*);
+
+	static const unsigned short NintendoVendorId = 0x057E;
+	static const unsigned short JoyconLeftProductId = 0x2006;
+	static const unsigned short JoyconRightProductId = 0x2007;
+
+private:
+	static void* dll;
+};
+
+/** One decoded report, buttons are bits indexed by BUTTON_NAME **/
+struct FJoyconState {
+	float stickX = 0.f;
+	float stickY = 0.f;
+	uint32 buttons = 0;
+	uint32 reportCount = 0;
+	double timestamp = 0.0;
+
+	bool IsPressed(BUTTON_NAME button) const { return (buttons & (1u << button)) != 0; }
+};
+
+/**
+ * The HID side of one Joycon. Open reads the factory stick calibration and switches the controller to the full
+ * 0x30 report with the IMU on, after that Read never blocks
+ **/
+class FJoyconConnection {
+public:
+	~FJoyconConnection() { this->Close(); }
+
+	bool Open(const char* path, SIDE InSide, int32 playerIndex);
+	void Close();
+	bool IsOpen() const { return this->handle != nullptr; }
+	SIDE GetSide() const { return this->side; }
+
+	/** The next waiting report, 0 when none is waiting, -1 once the controller went away **/
+	int32 Read(FJoyconState& OutState, TArray<FJoyconImuSample>& OutSamples);
+
+	/** Amplitudes 0 to 1 of the low and the high band, the next subcommand carries them as well **/
+	bool SendRumble(float lowAmplitude, float highAmplitude);
+	/** The link takes about one output report per input report, anything faster queues up in the Bluetooth stack **/
+	bool CanSend(double now) const { return now - this->lastOutputTime >= OutputInterval; }
+
+	static constexpr double OutputInterval = 0.015;
+	static constexpr float RumbleLowFrequency = 160.f;
+	static constexpr float RumbleHighFrequency = 320.f;
+
+protected:
+	bool SendSubcommand(uint8 subcommand, const uint8* data, int32 length);
+	bool SendOutput(uint8* packet, int32 length);
+	static void EncodeRumble(float lowAmplitude, float highAmplitude, uint8* OutData);
+	bool ReadSpi(uint32 address, uint8* OutData, int32 length);
+	void ReadStickCalibration();
+	float CalibrateAxis(uint16 value, int32 axis) const;
+
+	hid_device* handle = nullptr;
+	SIDE side = SIDE::LEFT;
+	uint8 packetCounter = 0;
+	uint8 report[0x41];
+	/** the rumble half of every output report, both actuator halves get the same values **/
+	uint8 rumble[8] = { 0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40 };
+	double lastOutputTime = 0.0;
+
+	/** per axis center and the travel below and above it **/
+	uint16 stickCenter[2] = { 2048, 2048 };
+	uint16 stickMin[2] = { 1400, 1400 };
+	uint16 stickMax[2] = { 1400, 1400 };
+};
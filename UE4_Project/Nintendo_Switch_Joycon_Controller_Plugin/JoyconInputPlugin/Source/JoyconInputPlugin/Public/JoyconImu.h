@@ -0,0 +1,30 @@
+#pragma once
+#include "CoreMinimal.h"
+
+/** One 6-axis sample in UE axes, gyro in rad/s, accel in G **/
+struct FJoyconImuSample {
+	FVector gyro;
+	FVector accel;
+};
+
+/** The controller samples every 5 ms and sends them three to a report **/
+static constexpr float JoyconImuSamplePeriod = 0.005f;
+
+/**
+ * Mahony filter, the accelerometer pulls pitch and roll back onto gravity and the integral term learns the gyro bias.
+ * Without a magnetometer yaw is only held by the bias estimate, which also adapts while the controller lies still
+ **/
+class FJoyconFusion {
+public:
+	void Reset();
+	void Update(const FJoyconImuSample& sample, float dt);
+	const FQuat& GetOrientation() const { return this->orientation; }
+
+	float kp = 2.f;
+	float ki = 0.05f;
+
+protected:
+	FQuat orientation = FQuat::Identity;
+	FVector integral = FVector::ZeroVector;
+	FVector gyroBias = FVector::ZeroVector;
+};
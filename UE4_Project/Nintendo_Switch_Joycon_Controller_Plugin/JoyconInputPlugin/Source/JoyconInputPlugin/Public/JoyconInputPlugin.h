@@ -9,8 +9,6 @@
 #include "InputCoreTypes.h"
 
 
-class JoyconBase;
-
 class IJoyconInputPlugin : public IInputDeviceModule
 {
 public:
@@ -22,13 +20,8 @@ public:
 	virtual TSharedPtr<class IInputDevice > CreateInputDevice(const TSharedRef< FGenericApplicationMessageHandler >& InMessageHandler) override;
 	TSharedPtr<class FJoyconDevice> JoyconInputDevice;
 
-	/** Relevent to the Joycon data **/
-	TSharedPtr<JoyconBase> jc_L;
-	TSharedPtr<JoyconBase> jc_R;
-
-	/** Get DLLhandle before use **/
+	/** Get DLLhandle before use, the device opens the Joycons through it **/
 	void *HidApiDLLHandle;
-	void *JoyconBaseDLLHandle;
 
 };
 
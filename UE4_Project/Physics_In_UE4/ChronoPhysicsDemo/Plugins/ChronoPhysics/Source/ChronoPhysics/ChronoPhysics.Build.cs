@@ -9,8 +9,13 @@ public class ChronoPhysics : ModuleRules
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
 
-        PublicDependencyModuleNames.AddRange(new string[] { "Core" });
-        PrivateDependencyModuleNames.AddRange(new string[] { "CoreUObject", "Engine", "Slate", "SlateCore", "Projects", "RHI", "RenderCore", "ProceduralMeshComponent", "Json", "JsonUtilities" });
+        // RHI and RenderCore are public, ChFluidComponent.h hands its particle buffer to render thread users
+        PublicDependencyModuleNames.AddRange(new string[] { "Core", "ProceduralMeshComponent", "RHI", "RenderCore" });
+        PrivateDependencyModuleNames.AddRange(new string[] { "CoreUObject", "Engine", "Slate", "SlateCore", "Projects", "Json", "JsonUtilities", "Landscape" });
+        // The editor preview stops before Play in Editor duplicates the level
+        if (Target.bBuildEditor) {
+            PrivateDependencyModuleNames.Add("UnrealEd");
+        }
 
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Include"));
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Include", "chrono"));
@@ -26,9 +31,22 @@ public class ChronoPhysics : ModuleRules
         PublicAdditionalLibraries.Add("ChronoEngine_parallel.lib");
         PublicAdditionalLibraries.Add("vcomp.lib");
 
+        // GPU rigid contacts and MPM soil, only when the CUDA toolkit and the nvcc built kernels (Private/*.cu) are there
+        string cudaPath = System.Environment.GetEnvironmentVariable("CUDA_PATH");
+        bool bWithCuda = !string.IsNullOrEmpty(cudaPath) && File.Exists(Path.Combine(ModuleDirectory, "Lib", "ChronoPhysicsCuda.lib"));
+        if (bWithCuda) {
+            PublicLibraryPaths.Add(Path.Combine(cudaPath, "lib", "x64"));
+            // float3 and friends of the chrono_parallel float math, used by host code too
+            PrivateIncludePaths.Add(Path.Combine(cudaPath, "include"));
+            PublicAdditionalLibraries.Add("ChronoPhysicsCuda.lib");
+            PublicAdditionalLibraries.Add("cudart_static.lib");
+        }
+        PrivateDefinitions.Add(bWithCuda ? "WITH_CHRONO_CUDA=1" : "WITH_CHRONO_CUDA=0");
+
         bUseRTTI = true;
         bEnableExceptions = true;
-        PrivateDefinitions.Add("DEBUG_LOG");
+        // CH_TRACE up to EChTraceLevel::LOG, shipping builds compile every trace out
+        PrivateDefinitions.Add(Target.Configuration == UnrealTargetConfiguration.Shipping ? "CHRONO_TRACE_LEVEL=0" : "CHRONO_TRACE_LEVEL=3");
         PrivateDefinitions.Add("NOMINMAX");
     }
 }
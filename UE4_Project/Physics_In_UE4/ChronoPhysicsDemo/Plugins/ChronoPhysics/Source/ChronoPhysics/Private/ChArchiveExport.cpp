@@ -0,0 +1,63 @@
+#include "ChArchiveExport.h"
+#include "chrono/physics/ChSystemNSC.h"
+#include "chrono/physics/ChSystemSMC.h"
+#include "chrono/core/ChStream.h"
+#include "chrono/serialization/ChArchiveBinary.h"
+#include "chrono/serialization/ChArchiveJSON.h"
+#include "chrono/serialization/ChArchiveXML.h"
+#include "Async/Async.h"
+
+bool FChArchiveSnapshot::Capture(chrono::ChSystem* system)
+{
+	auto captured = std::make_shared<std::vector<char>>();
+	try {
+		chrono::ChStreamOutBinaryVector stream(captured.get());
+		chrono::ChArchiveOutBinary archive(stream);
+		archive << CHNVP(*system, "system");
+	}
+	catch (const std::exception& e) {
+		UE_LOG(LogTemp, Warning, TEXT("FChArchiveSnapshot: capture failed, %s"), ANSI_TO_TCHAR(e.what()));
+		return false;
+	}
+	bytes = captured;
+	bSMC = system->GetContactMethod() == chrono::ChMaterialSurface::SMC;
+	return true;
+}
+
+TFuture<bool> FChArchiveSnapshot::ExportAsync(const FString& filePath, EChArchiveFormat format) const
+{
+	return Async(EAsyncExecution::ThreadPool, [source = bytes, bSMC = bSMC, path = FString(filePath), format]() {
+		if (!source) {
+			return false;
+		}
+		std::unique_ptr<chrono::ChSystem> system;
+		if (bSMC) {
+			system.reset(new chrono::ChSystemSMC());
+		}
+		else {
+			system.reset(new chrono::ChSystemNSC());
+		}
+
+		try {
+			// The stream wrapper reads without changing the vector, it only takes a non const pointer
+			chrono::ChStreamInBinaryVector inStream(const_cast<std::vector<char>*>(source.get()));
+			chrono::ChArchiveInBinary inArchive(inStream);
+			inArchive >> CHNVP(*system, "system");
+
+			chrono::ChStreamOutAsciiFile outStream(TCHAR_TO_UTF8(*path));
+			if (format == EChArchiveFormat::JSON) {
+				chrono::ChArchiveOutJSON outArchive(outStream);
+				outArchive << CHNVP(*system, "system");
+			}
+			else {
+				chrono::ChArchiveOutXML outArchive(outStream);
+				outArchive << CHNVP(*system, "system");
+			}
+		}
+		catch (const std::exception& e) {
+			UE_LOG(LogTemp, Warning, TEXT("FChArchiveSnapshot: export to %s failed, %s"), *path, ANSI_TO_TCHAR(e.what()));
+			return false;
+		}
+		return true;
+	});
+}
@@ -0,0 +1,142 @@
+#include "ChBakedTerrain.h"
+#include "chrono/core/ChBezierCurve.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeLock.h"
+
+namespace {
+	FORCEINLINE float Bilinear(const float* samples, int32 index, int32 stride, float alphaX, float alphaY)
+	{
+		float bottom = FMath::Lerp(samples[index], samples[index + 1], alphaX);
+		float top = FMath::Lerp(samples[index + stride], samples[index + stride + 1], alphaX);
+		return FMath::Lerp(bottom, top, alphaY);
+	}
+}
+
+FChBakedTerrain::FChBakedTerrain(std::shared_ptr<chrono::vehicle::ChTerrain> inSource, double inCellSize)
+	: source(inSource), cellSize(FMath::Max(inCellSize, 1e-3)), tileSize(FMath::Max(inCellSize, 1e-3) * TileCells)
+{
+}
+
+TFuture<void> FChBakedTerrain::Bake(const chrono::ChBezierCurve& path, double halfWidth, bool bThreadSafeSource)
+{
+	bBaked = false;
+	tiles.Reset();
+	tileIndices.Reset();
+
+	// Every tile the road's band touches, walking the reference line a cell at a time
+	int32 reach = FMath::CeilToInt(halfWidth / tileSize);
+	for (size_t i = 0; i + 1 < path.getNumPoints(); i++) {
+		double length = (path.getPoint(i + 1) - path.getPoint(i)).Length();
+		int32 steps = FMath::Max(1, FMath::CeilToInt(length / cellSize));
+		for (int32 s = 0; s <= steps; s++) {
+			chrono::ChVector<> point = path.eval(i, (double)s / steps);
+			int32 tileX = (int32)FMath::FloorToDouble(point.x() / tileSize);
+			int32 tileY = (int32)FMath::FloorToDouble(point.y() / tileSize);
+			for (int32 dy = -reach; dy <= reach; dy++) {
+				for (int32 dx = -reach; dx <= reach; dx++) {
+					FIntPoint coordinate(tileX + dx, tileY + dy);
+					if (!tileIndices.Contains(coordinate)) {
+						tileIndices.Add(coordinate, tiles.Num());
+						tiles.AddUninitialized();
+						tiles.Last().Coordinate = coordinate;
+					}
+				}
+			}
+		}
+	}
+
+	return Async<void>(EAsyncExecution::ThreadPool, [this, bThreadSafeSource]() {
+		if (bThreadSafeSource) {
+			ParallelFor(tiles.Num(), [this](int32 i) {
+				BakeTile(tiles[i], false);
+			});
+		}
+		else {
+			for (auto& tile : tiles) {
+				BakeTile(tile, true);
+			}
+		}
+		bBaked = true;
+	});
+}
+
+void FChBakedTerrain::BakeTile(FTile& tile, bool bLock)
+{
+	double originX = tile.Coordinate.X * tileSize;
+	double originY = tile.Coordinate.Y * tileSize;
+	for (int32 row = 0; row < TileSamples; row++) {
+		// A row at a time, so the queries still going to the source don't wait for a whole tile
+		TUniquePtr<FScopeLock> scopeLock = bLock ? MakeUnique<FScopeLock>(&sourceLock) : nullptr;
+		double y = originY + row * cellSize;
+		for (int32 column = 0; column < TileSamples; column++) {
+			double x = originX + column * cellSize;
+			int32 index = row * TileSamples + column;
+			chrono::ChVector<> normal = source->GetNormal(x, y);
+			tile.Height[index] = (float)source->GetHeight(x, y);
+			tile.Normal[0][index] = (float)normal.x();
+			tile.Normal[1][index] = (float)normal.y();
+			tile.Normal[2][index] = (float)normal.z();
+			tile.Friction[index] = source->GetCoefficientFriction(x, y);
+		}
+	}
+}
+
+const FChBakedTerrain::FTile* FChBakedTerrain::FindCell(double x, double y, int32& outIndex, float& outAlphaX, float& outAlphaY) const
+{
+	if (!bBaked) {
+		return nullptr;
+	}
+	double cellX = x / cellSize;
+	double cellY = y / cellSize;
+	int32 column = (int32)FMath::FloorToDouble(cellX);
+	int32 row = (int32)FMath::FloorToDouble(cellY);
+	FIntPoint coordinate(column >= 0 ? column / TileCells : (column + 1) / TileCells - 1, row >= 0 ? row / TileCells : (row + 1) / TileCells - 1);
+	const int32* found = tileIndices.Find(coordinate);
+	if (!found) {
+		return nullptr;
+	}
+	outIndex = (row - coordinate.Y * TileCells) * TileSamples + (column - coordinate.X * TileCells);
+	outAlphaX = (float)(cellX - column);
+	outAlphaY = (float)(cellY - row);
+	return &tiles[*found];
+}
+
+double FChBakedTerrain::GetHeight(double x, double y) const
+{
+	int32 index;
+	float alphaX, alphaY;
+	if (const FTile* tile = FindCell(x, y, index, alphaX, alphaY)) {
+		return Bilinear(tile->Height, index, TileSamples, alphaX, alphaY);
+	}
+	FScopeLock scopeLock(&sourceLock);
+	return source->GetHeight(x, y);
+}
+
+chrono::ChVector<> FChBakedTerrain::GetNormal(double x, double y) const
+{
+	int32 index;
+	float alphaX, alphaY;
+	if (const FTile* tile = FindCell(x, y, index, alphaX, alphaY)) {
+		chrono::ChVector<> normal(Bilinear(tile->Normal[0], index, TileSamples, alphaX, alphaY),
+			Bilinear(tile->Normal[1], index, TileSamples, alphaX, alphaY),
+			Bilinear(tile->Normal[2], index, TileSamples, alphaX, alphaY));
+		return normal.GetNormalized();
+	}
+	FScopeLock scopeLock(&sourceLock);
+	return source->GetNormal(x, y);
+}
+
+float FChBakedTerrain::GetCoefficientFriction(double x, double y) const
+{
+	if (m_friction_fun) {
+		return (*m_friction_fun)(x, y);
+	}
+	int32 index;
+	float alphaX, alphaY;
+	if (const FTile* tile = FindCell(x, y, index, alphaX, alphaY)) {
+		return Bilinear(tile->Friction, index, TileSamples, alphaX, alphaY);
+	}
+	FScopeLock scopeLock(&sourceLock);
+	return source->GetCoefficientFriction(x, y);
+}
@@ -0,0 +1,154 @@
+#include "ChBatchSimulateCommandlet.h"
+#include "ChPhysicsSceneManagerActor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+UChBatchSimulateCommandlet::UChBatchSimulateCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UChBatchSimulateCommandlet::Main(const FString& Params)
+{
+	FString mapName;
+	if (!FParse::Value(*Params, TEXT("Map="), mapName)) {
+		UE_LOG(LogTemp, Error, TEXT("ChBatchSimulate: -Map= is required"));
+		return 1;
+	}
+	float duration = 10.f;
+	float step = 0.01f;
+	FString outputDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ChronoBatch"));
+	FParse::Value(*Params, TEXT("Duration="), duration);
+	FParse::Value(*Params, TEXT("Step="), step);
+	FParse::Value(*Params, TEXT("Output="), outputDir);
+
+	FString sweepFile;
+	TArray<FChSweepVariant> variants;
+	int32 workers = 1;
+	int32 worker = INDEX_NONE;
+	if (FParse::Value(*Params, TEXT("Sweep="), sweepFile)) {
+		if (!ChParameterSweep::LoadVariants(sweepFile, variants) || variants.Num() == 0) {
+			UE_LOG(LogTemp, Error, TEXT("ChBatchSimulate: no variants in %s"), *sweepFile);
+			return 1;
+		}
+		FParse::Value(*Params, TEXT("Workers="), workers);
+		FParse::Value(*Params, TEXT("Worker="), worker);
+		workers = FMath::Clamp(workers, 1, variants.Num());
+		if (workers > 1 && worker == INDEX_NONE) {
+			return SpawnWorkers(Params, workers);
+		}
+		worker = FMath::Max(worker, 0);
+		// Every Nth variant, the expensive ones are usually neighbours in the file
+		TArray<FChSweepVariant> share;
+		for (int32 i = worker; i < variants.Num(); i += workers) {
+			share.Add(variants[i]);
+		}
+		variants = MoveTemp(share);
+	}
+
+	UPackage* package = LoadPackage(nullptr, *mapName, LOAD_None);
+	UWorld* world = package ? UWorld::FindWorldInPackage(package) : nullptr;
+	if (!world) {
+		UE_LOG(LogTemp, Error, TEXT("ChBatchSimulate: could not load %s"), *mapName);
+		return 1;
+	}
+
+	// A game world, so the objects register with FChPhysicsObjectRegistry and the managers find them
+	world->WorldType = EWorldType::Game;
+	world->AddToRoot();
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	worldContext.SetCurrentWorld(world);
+	world->InitWorld();
+	world->UpdateWorldComponents(true, false);
+	world->InitializeActorsForPlay(FURL());
+
+	TArray<AChPhysicsSceneManagerActor*> managers;
+	for (TActorIterator<AChPhysicsSceneManagerActor> itr(world); itr; ++itr) {
+		// Stepping here directly, a worker step or a join tick would have nothing to join it
+		itr->bRecordTelemetry = true;
+		itr->bStepOnWorkerThread = false;
+		itr->bIncrementalConstruction = false;
+		managers.Add(*itr);
+	}
+	if (managers.Num() == 0) {
+		UE_LOG(LogTemp, Error, TEXT("ChBatchSimulate: %s has no scene manager"), *mapName);
+	}
+
+	// Dispatches BeginPlay without a game mode
+	world->GetWorldSettings()->NotifyBeginPlay();
+
+	double startTime = FPlatformTime::Seconds();
+	for (auto manager : managers) {
+		if (sweepFile.IsEmpty()) {
+			manager->RunHeadless(duration, step, FPaths::Combine(outputDir, manager->GetName() + TEXT(".csv")));
+			continue;
+		}
+		TArray<FChSweepResult> results = manager->RunSweep(variants, duration, step, outputDir);
+		WriteSweepSummary(FPaths::Combine(outputDir, FString::Printf(TEXT("%s_Sweep%d.csv"), *manager->GetName(), worker)), results, manager);
+	}
+	UE_LOG(LogTemp, Display, TEXT("ChBatchSimulate: %s, %d scenes, %.2fs"), *mapName, managers.Num(), FPlatformTime::Seconds() - startTime);
+
+	for (TActorIterator<AActor> itr(world); itr; ++itr) {
+		itr->RouteEndPlay(EEndPlayReason::Quit);
+	}
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+	world->RemoveFromRoot();
+	return managers.Num() ? 0 : 1;
+}
+
+int32 UChBatchSimulateCommandlet::SpawnWorkers(const FString& Params, int32 workers)
+{
+	TArray<FProcHandle> processes;
+	for (int32 i = 0; i < workers; i++) {
+		// The whole command line again, project, -run, -Map, -Sweep and -Output included
+		FString args = FString::Printf(TEXT("%s -Workers=%d -Worker=%d"), FCommandLine::Get(), workers, i);
+		FProcHandle process = FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *args, true, true, true, nullptr, 0, nullptr, nullptr);
+		if (!process.IsValid()) {
+			UE_LOG(LogTemp, Error, TEXT("ChBatchSimulate: could not start worker %d"), i);
+			continue;
+		}
+		processes.Add(process);
+	}
+
+	int32 failures = workers - processes.Num();
+	for (auto& process : processes) {
+		FPlatformProcess::WaitForProc(process);
+		int32 returnCode = 0;
+		FPlatformProcess::GetProcReturnCode(process, &returnCode);
+		failures += returnCode != 0 ? 1 : 0;
+		FPlatformProcess::CloseProc(process);
+	}
+	UE_LOG(LogTemp, Display, TEXT("ChBatchSimulate: %d workers done, %d failed"), workers, failures);
+	return failures ? 1 : 0;
+}
+
+bool UChBatchSimulateCommandlet::WriteSweepSummary(const FString& filePath, const TArray<FChSweepResult>& results, const AChPhysicsSceneManagerActor* manager)
+{
+	FString csv = TEXT("Variant,SimulatedTime,WallSeconds");
+	int32 channels = manager->GetTelemetryFrameWidth();
+	for (int32 k = 0; k < channels; k++) {
+		csv += FString::Printf(TEXT(",Final[%d]"), k);
+	}
+	csv += LINE_TERMINATOR;
+	for (auto& result : results) {
+		csv += FString::Printf(TEXT("%s,%s,%s"), *result.Name, *FString::SanitizeFloat(result.SimulatedTime), *FString::SanitizeFloat(result.WallSeconds));
+		for (int32 k = 0; k < channels; k++) {
+			csv += TEXT(",");
+			csv += result.FinalFrame.IsValidIndex(k) ? FString::SanitizeFloat(result.FinalFrame[k]) : FString();
+		}
+		csv += LINE_TERMINATOR;
+	}
+	return FFileHelper::SaveStringToFile(csv, *filePath);
+}
@@ -0,0 +1,468 @@
+#include "ChBenchmark.h"
+#include "chrono/physics/ChSystemNSC.h"
+#include "chrono/physics/ChSystemSMC.h"
+#include "chrono/physics/ChLinkMotorRotationSpeed.h"
+#include "chrono/physics/ChLinkMate.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono/fea/ChMesh.h"
+#include "chrono/fea/ChBuilderBeam.h"
+#include "chrono/fea/ChLinkPointFrame.h"
+#include "chrono/parallel/ChOpenMP.h"
+#include "chrono_parallel/physics/ChSystemParallel.h"
+#include "ChThreadedShurSolver.h"
+#include "ChKinematicBody.h"
+#include "chrono_vehicle/terrain/SCMDeformableTerrain.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "HAL/PlatformTime.h"
+
+namespace {
+	using namespace chrono;
+
+	const TCHAR* BackendNames[] = { TEXT("SERIAL_NSC"), TEXT("SERIAL_SMC"), TEXT("PARALLEL_NSC"), TEXT("PARALLEL_SMC") };
+
+	// NewBody gives the collision model the backend expects
+	std::shared_ptr<ChBody> NewBox(ChSystem* system, const ChVector<>& halfSize, const ChVector<>& position, double density, bool bFixed)
+	{
+		auto body = std::shared_ptr<ChBody>(system->NewBody());
+		double mass = density * 8 * halfSize.x() * halfSize.y() * halfSize.z();
+		body->SetMass(mass);
+		body->SetInertiaXX(ChVector<>(halfSize.y() * halfSize.y() + halfSize.z() * halfSize.z(), halfSize.x() * halfSize.x() + halfSize.z() * halfSize.z(), halfSize.x() * halfSize.x() + halfSize.y() * halfSize.y()) * (mass / 3));
+		body->SetPos(position);
+		body->SetBodyFixed(bFixed);
+		body->SetCollide(true);
+		body->GetCollisionModel()->ClearModel();
+		body->GetCollisionModel()->AddBox(halfSize.x(), halfSize.y(), halfSize.z());
+		body->GetCollisionModel()->BuildModel();
+		system->AddBody(body);
+		return body;
+	}
+
+	std::shared_ptr<ChBody> NewSphere(ChSystem* system, double radius, const ChVector<>& position, double density)
+	{
+		auto body = std::shared_ptr<ChBody>(system->NewBody());
+		double mass = density * 4.0 / 3.0 * CH_C_PI * radius * radius * radius;
+		body->SetMass(mass);
+		body->SetInertiaXX(ChVector<>(0.4 * mass * radius * radius));
+		body->SetPos(position);
+		body->SetCollide(true);
+		body->GetCollisionModel()->ClearModel();
+		body->GetCollisionModel()->AddSphere(radius);
+		body->GetCollisionModel()->BuildModel();
+		system->AddBody(body);
+		return body;
+	}
+
+	// Cylinder axis along Z, the wheel spin axis of the rigs
+	std::shared_ptr<ChBody> NewWheel(ChSystem* system, double radius, double width, const ChVector<>& position, double density)
+	{
+		auto body = std::shared_ptr<ChBody>(system->NewBody());
+		double mass = density * CH_C_PI * radius * radius * width;
+		double radial = mass * (3 * radius * radius + width * width) / 12;
+		body->SetMass(mass);
+		body->SetInertiaXX(ChVector<>(radial, radial, 0.5 * mass * radius * radius));
+		body->SetPos(position);
+		body->SetCollide(true);
+		body->GetCollisionModel()->ClearModel();
+		// AddCylinder is along the local Y axis
+		body->GetCollisionModel()->AddCylinder(radius, radius, width / 2, VNULL, ChMatrix33<>(Q_from_AngX(CH_C_PI_2)));
+		body->GetCollisionModel()->BuildModel();
+		system->AddBody(body);
+		return body;
+	}
+
+	class FBoxStackScene : public FChBenchmarkScene
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("BoxStack"); }
+		virtual void Build(ChSystem* system, bool bSMC) override
+		{
+			NewBox(system, ChVector<>(10, 0.5, 10), ChVector<>(0, -0.5, 0), 1000, true);
+			// 5 x 5 columns of 20 boxes, touching so the contacts are there from the first step
+			for (int x = 0; x < 5; x++) {
+				for (int z = 0; z < 5; z++) {
+					for (int y = 0; y < 20; y++) {
+						NewBox(system, ChVector<>(0.25), ChVector<>(x * 0.6 - 1.2, 0.25 + y * 0.5, z * 0.6 - 1.2), 500, false);
+					}
+				}
+			}
+		}
+	};
+
+	class FGranularPileScene : public FChBenchmarkScene
+	{
+	public:
+		FGranularPileScene(int32 inCount) : count(inCount) {}
+		virtual const TCHAR* GetName() const override { return TEXT("GranularPile"); }
+		virtual void Build(ChSystem* system, bool bSMC) override
+		{
+			const double radius = 0.01;
+			const int32 side = FMath::Max(FMath::CeilToInt(FMath::Pow((float)count / 4, 1.f / 3)), 1);
+			const double spacing = 2.02 * radius;
+			const double extent = side * spacing;
+			// Bin with walls, the pile is a column four times as high as it is wide
+			NewBox(system, ChVector<>(extent, 0.05, extent), ChVector<>(0, -0.05, 0), 1000, true);
+			NewBox(system, ChVector<>(0.05, extent * 4, extent), ChVector<>(-extent / 2 - 0.05, extent * 4, 0), 1000, true);
+			NewBox(system, ChVector<>(0.05, extent * 4, extent), ChVector<>(extent / 2 + 0.05, extent * 4, 0), 1000, true);
+			NewBox(system, ChVector<>(extent, extent * 4, 0.05), ChVector<>(0, extent * 4, -extent / 2 - 0.05), 1000, true);
+			NewBox(system, ChVector<>(extent, extent * 4, 0.05), ChVector<>(0, extent * 4, extent / 2 + 0.05), 1000, true);
+			for (int32 i = 0; i < count; i++) {
+				int32 x = i % side;
+				int32 z = (i / side) % side;
+				int32 y = i / (side * side);
+				// Every other layer shifted, so it collapses instead of standing as a lattice
+				double shift = (y & 1) ? radius * 0.5 : 0;
+				NewSphere(system, radius, ChVector<>((x + 0.5) * spacing - extent / 2 + shift, radius + y * spacing, (z + 0.5) * spacing - extent / 2 + shift), 2500);
+			}
+		}
+		virtual double GetStepSize() const override { return 5e-4; }
+
+	private:
+		int32 count;
+	};
+
+	// Chassis and four speed driven wheels, a stand-in for the vehicle models, which need Chrono's data files
+	class FWheeledRigScene : public FChBenchmarkScene
+	{
+	public:
+		FWheeledRigScene(bool bInSCM) : bSCM(bInSCM) {}
+		virtual const TCHAR* GetName() const override { return bSCM ? TEXT("WheeledRigOnSCM") : TEXT("WheeledRigOnRigid"); }
+		virtual bool SupportsBackend(EChSystemBackend::Type backend) const override
+		{
+			// SCM collides through the serial systems only
+			return !bSCM || backend == EChSystemBackend::SERIAL_NSC || backend == EChSystemBackend::SERIAL_SMC;
+		}
+		virtual void Build(ChSystem* system, bool bSMC) override
+		{
+			if (bSCM) {
+				terrain = std::make_shared<vehicle::SCMDeformableTerrain>(system);
+				terrain->SetSoilParametersSCM(2e6, 0, 1.1, 0, 30, 0.01, 2e8, 3e4);
+				terrain->Initialize(0, 20, 20, 200, 200);
+			}
+			else {
+				NewBox(system, ChVector<>(20, 0.5, 20), ChVector<>(0, -0.5, 0), 1000, true);
+			}
+
+			auto chassis = NewBox(system, ChVector<>(1.5, 0.3, 0.8), ChVector<>(0, 0.8, 0), 300, false);
+			chassis->SetCollide(false);
+			for (int i = 0; i < 4; i++) {
+				ChVector<> position((i & 1) ? 1.2 : -1.2, 0.4, (i & 2) ? 1.0 : -1.0);
+				auto wheel = NewWheel(system, 0.4, 0.3, position, 500);
+				auto motor = std::make_shared<ChLinkMotorRotationSpeed>();
+				motor->Initialize(wheel, chassis, ChFrame<>(position));
+				wheelSpeeds[i] = std::make_shared<ChFunction_Const>(-CH_C_PI);
+				motor->SetSpeedFunction(wheelSpeeds[i]);
+				system->Add(motor);
+			}
+		}
+		virtual double GetStepSize() const override { return 2e-3; }
+
+		// Throttle and steering, skid steered: full steering runs one side a quarter faster and the other a quarter slower
+		virtual void ApplyJoystick(const TArray<double>& axes) override
+		{
+			const double throttle = axes.Num() > 0 ? FMath::Clamp(axes[0], -1.0, 1.0) : 0;
+			const double steer = axes.Num() > 1 ? FMath::Clamp(axes[1], -1.0, 1.0) : 0;
+			for (int i = 0; i < 4; i++) {
+				if (wheelSpeeds[i]) {
+					wheelSpeeds[i]->Set_yconst(-MaxWheelSpeed * throttle * (1 + ((i & 2) ? -0.25 : 0.25) * steer));
+				}
+			}
+		}
+
+	private:
+		// rad/s at full throttle
+		static constexpr double MaxWheelSpeed = 2 * CH_C_PI;
+
+		bool bSCM;
+		std::shared_ptr<ChFunction_Const> wheelSpeeds[4];
+		std::shared_ptr<vehicle::SCMDeformableTerrain> terrain;
+	};
+
+	class FCableScene : public FChBenchmarkScene
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("FEACable"); }
+		virtual bool SupportsBackend(EChSystemBackend::Type backend) const override
+		{
+			return backend == EChSystemBackend::SERIAL_NSC || backend == EChSystemBackend::SERIAL_SMC;
+		}
+		virtual void Build(ChSystem* system, bool bSMC) override
+		{
+			// FEA needs a solver that handles the stiffness matrices
+			system->SetSolverType(ChSolver::Type::MINRES);
+			system->SetMaxItersSolverSpeed(200);
+
+			auto mesh = std::make_shared<fea::ChMesh>();
+			auto section = std::make_shared<fea::ChBeamSectionCable>();
+			section->SetDiameter(0.015);
+			section->SetYoungModulus(1e8);
+			section->SetBeamRaleyghDamping(0.0001);
+
+			fea::ChBuilderBeamANCF builder;
+			builder.BuildBeam(mesh, section, 200, ChVector<>(0, 2, 0), ChVector<>(4, 2, 0));
+			system->Add(mesh);
+
+			auto ground = NewBox(system, ChVector<>(0.1), ChVector<>(0, 2, 0), 1000, true);
+			ground->SetCollide(false);
+			auto anchor = std::make_shared<fea::ChLinkPointFrame>();
+			anchor->Initialize(builder.GetLastBeamNodes().front(), ground);
+			system->Add(anchor);
+		}
+		virtual double GetStepSize() const override { return 2e-3; }
+	};
+
+	class FTrimeshGroundScene : public FChBenchmarkScene
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("TrimeshGround"); }
+		virtual void Build(ChSystem* system, bool bSMC) override
+		{
+			// 256 x 256 cells of rolling ground, 131k triangles
+			const int32 cells = 256;
+			const double size = 40;
+			auto mesh = std::make_shared<geometry::ChTriangleMeshConnected>();
+			auto& vertices = mesh->getCoordsVertices();
+			auto& faces = mesh->getIndicesVertexes();
+			vertices.reserve((cells + 1) * (cells + 1));
+			faces.reserve(cells * cells * 2);
+			for (int32 z = 0; z <= cells; z++) {
+				for (int32 x = 0; x <= cells; x++) {
+					double px = x * size / cells - size / 2;
+					double pz = z * size / cells - size / 2;
+					vertices.push_back(ChVector<>(px, 0.3 * std::sin(px * 0.7) * std::cos(pz * 0.5), pz));
+				}
+			}
+			for (int32 z = 0; z < cells; z++) {
+				for (int32 x = 0; x < cells; x++) {
+					int32 i = z * (cells + 1) + x;
+					faces.push_back(ChVector<int>(i, i + cells + 1, i + 1));
+					faces.push_back(ChVector<int>(i + 1, i + cells + 1, i + cells + 2));
+				}
+			}
+
+			auto ground = std::shared_ptr<ChBody>(system->NewBody());
+			ground->SetBodyFixed(true);
+			ground->SetCollide(true);
+			ground->GetCollisionModel()->ClearModel();
+			ground->GetCollisionModel()->AddTriangleMesh(mesh, true, false);
+			ground->GetCollisionModel()->BuildModel();
+			system->AddBody(ground);
+
+			for (int32 i = 0; i < 1000; i++) {
+				NewSphere(system, 0.2, ChVector<>((i % 32) * 1.1 - 17, 1, (i / 32) * 1.1 - 17), 1000);
+			}
+		}
+		virtual double GetStepSize() const override { return 2e-3; }
+	};
+
+	// A box resting on a kinematic platform that speeds up and cruises, static friction has to carry the box along
+	class FKinematicPlatformScene : public FChBenchmarkScene
+	{
+	public:
+		virtual const TCHAR* GetName() const override { return TEXT("KinematicPlatform"); }
+		virtual bool SupportsBackend(EChSystemBackend::Type backend) const override
+		{
+			// The parallel systems keep kinematic bodies fixed
+			return backend == EChSystemBackend::SERIAL_NSC || backend == EChSystemBackend::SERIAL_SMC;
+		}
+		virtual void Build(ChSystem* system, bool bSMC) override
+		{
+			platform = NewBox(system, ChVector<>(2, 0.1, 2), ChVector<>(0, -0.1, 0), 1000, false);
+			FChKinematicBody::Make(*platform);
+			box = NewBox(system, ChVector<>(0.2), ChVector<>(0, 0.2, 0), 500, false);
+			boxStart = box->GetPos();
+			startTime = system->GetChTime();
+		}
+		virtual void PreStep(ChSystem* system, double stepSize) override
+		{
+			// Pose at the start of the step, the velocity in its middle
+			const double t = system->GetChTime() - startTime;
+			FChKinematicBody::Drive(*platform, ChVector<>(Travel(t), -0.1, 0), QUNIT, ChVector<>(Speed(t + stepSize / 2), 0, 0), VNULL);
+		}
+		virtual bool Check(ChSystem* system, FString& outFailure) const override
+		{
+			const double travel = platform->GetPos().x();
+			const double carried = box->GetPos().x() - boxStart.x();
+			if (travel < MinTravel) {
+				outFailure = FString::Printf(TEXT("the platform only moved %.3f m"), travel);
+				return false;
+			}
+			// A fixed platform leaves the box where it is, a slipping one leaves it behind
+			if (FMath::Abs(carried - travel) > MaxSlip || box->GetPos().y() < 0.1) {
+				outFailure = FString::Printf(TEXT("the platform moved %.3f m, the box %.3f m and ended %.3f m up"), travel, carried, box->GetPos().y());
+				return false;
+			}
+			return true;
+		}
+
+	private:
+		// m/s^2 up to m/s, well within the default static friction of 0.6
+		static constexpr double Acceleration = 2;
+		static constexpr double CruiseSpeed = 1;
+		static constexpr double MinTravel = 0.05;
+		static constexpr double MaxSlip = 0.02;
+
+		static double Speed(double t)
+		{
+			return FMath::Min(Acceleration * t, CruiseSpeed);
+		}
+		static double Travel(double t)
+		{
+			const double rampTime = CruiseSpeed / Acceleration;
+			return t < rampTime ? 0.5 * Acceleration * t * t : 0.5 * CruiseSpeed * rampTime + CruiseSpeed * (t - rampTime);
+		}
+
+		std::shared_ptr<ChBody> platform;
+		std::shared_ptr<ChBody> box;
+		ChVector<> boxStart;
+		double startTime = 0;
+	};
+}
+
+void ChBenchmark::CreateScenes(int32 granularCount, TArray<TUniquePtr<FChBenchmarkScene>>& outScenes)
+{
+	outScenes.Add(MakeUnique<FBoxStackScene>());
+	outScenes.Add(MakeUnique<FGranularPileScene>(granularCount));
+	outScenes.Add(MakeUnique<FWheeledRigScene>(true));
+	outScenes.Add(MakeUnique<FWheeledRigScene>(false));
+	outScenes.Add(MakeUnique<FCableScene>());
+	outScenes.Add(MakeUnique<FTrimeshGroundScene>());
+	outScenes.Add(MakeUnique<FKinematicPlatformScene>());
+}
+
+const TCHAR* ChBenchmark::GetBackendName(EChSystemBackend::Type backend)
+{
+	return backend >= 0 && backend < ARRAY_COUNT(BackendNames) ? BackendNames[backend] : TEXT("UNKNOWN");
+}
+
+bool ChBenchmark::FindBackend(const FString& name, EChSystemBackend::Type& outBackend)
+{
+	for (int32 i = 0; i < ARRAY_COUNT(BackendNames); i++) {
+		if (name.Equals(BackendNames[i], ESearchCase::IgnoreCase)) {
+			outBackend = (EChSystemBackend::Type)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::shared_ptr<chrono::ChSystem> ChBenchmark::CreateSystem(EChSystemBackend::Type backend, int32 threads, bool bThreadedShur)
+{
+	std::shared_ptr<chrono::ChSystem> system;
+	switch (backend) {
+	case EChSystemBackend::SERIAL_SMC:
+		system = std::make_shared<chrono::ChSystemSMC>();
+		break;
+	case EChSystemBackend::PARALLEL_NSC:
+		system = std::make_shared<chrono::ChSystemParallelNSC>();
+		break;
+	case EChSystemBackend::PARALLEL_SMC:
+		system = std::make_shared<chrono::ChSystemParallelSMC>();
+		break;
+	default:
+		system = std::make_shared<chrono::ChSystemNSC>();
+		break;
+	}
+	chrono::CHOMPfunctions::SetNumThreads(threads);
+	system->SetParallelThreadNumber(threads);
+	if (auto parallelSystem = std::dynamic_pointer_cast<chrono::ChSystemParallel>(system)) {
+		auto settings = parallelSystem->GetSettings();
+		settings->min_threads = threads;
+		settings->max_threads = threads;
+		settings->perform_thread_tuning = false;
+	}
+	if (bThreadedShur && backend == EChSystemBackend::PARALLEL_NSC) {
+		FChThreadedShurSolver::Install(system.get());
+	}
+	return system;
+}
+
+FChBenchmarkResult ChBenchmark::Run(FChBenchmarkScene& scene, EChSystemBackend::Type backend, int32 threads, int32 warmupSteps, int32 steps, bool bThreadedShur)
+{
+	FChBenchmarkResult result;
+	result.Scene = scene.GetName();
+	result.Backend = GetBackendName(backend);
+	result.Threads = threads;
+	result.bThreadedShur = bThreadedShur && backend == EChSystemBackend::PARALLEL_NSC;
+
+	auto system = CreateSystem(backend, threads, bThreadedShur);
+	scene.Build(system.get(), backend == EChSystemBackend::SERIAL_SMC || backend == EChSystemBackend::PARALLEL_SMC);
+	result.Bodies = (int32)system->Get_bodylist().size();
+	double stepSize = scene.GetStepSize();
+
+	for (int32 i = 0; i < warmupSteps; i++) {
+		scene.PreStep(system.get(), stepSize);
+		system->DoStepDynamics(stepSize);
+	}
+
+	double startTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < steps; i++) {
+		scene.PreStep(system.get(), stepSize);
+		system->DoStepDynamics(stepSize);
+		AccumulateTimers(*system, result);
+	}
+	result.WallMs = (FPlatformTime::Seconds() - startTime) * 1e3;
+
+	FinishResult(result, steps);
+	if (!scene.Check(system.get(), result.CheckFailure) && result.CheckFailure.IsEmpty()) {
+		result.CheckFailure = TEXT("failed");
+	}
+	return result;
+}
+
+void ChBenchmark::AccumulateTimers(chrono::ChSystem& system, FChBenchmarkResult& result)
+{
+	result.StepMs += system.GetTimerStep();
+	result.CollisionMs += system.GetTimerCollision();
+	result.SolverMs += system.GetTimerSolver();
+	result.SetupMs += system.GetTimerSetup();
+	result.UpdateMs += system.GetTimerUpdate();
+}
+
+void ChBenchmark::FinishResult(FChBenchmarkResult& result, int32 steps)
+{
+	// The Chrono timers are in seconds, WallMs already in milliseconds
+	result.Steps = steps;
+	double perStep = steps > 0 ? 1e3 / steps : 0;
+	result.StepMs *= perStep;
+	result.CollisionMs *= perStep;
+	result.SolverMs *= perStep;
+	result.SetupMs *= perStep;
+	result.UpdateMs *= perStep;
+	result.WallMs = steps > 0 ? result.WallMs / steps : 0;
+}
+
+FString ChBenchmark::ToJson(const TArray<FChBenchmarkResult>& results)
+{
+	TArray<TSharedPtr<FJsonValue>> runs;
+	for (auto& result : results) {
+		TSharedPtr<FJsonObject> run = MakeShared<FJsonObject>();
+		run->SetStringField(TEXT("scene"), result.Scene);
+		run->SetStringField(TEXT("backend"), result.Backend);
+		run->SetNumberField(TEXT("threads"), result.Threads);
+		run->SetBoolField(TEXT("threaded_shur"), result.bThreadedShur);
+		run->SetNumberField(TEXT("steps"), result.Steps);
+		run->SetNumberField(TEXT("bodies"), result.Bodies);
+		run->SetNumberField(TEXT("step_ms"), result.StepMs);
+		run->SetNumberField(TEXT("collision_ms"), result.CollisionMs);
+		run->SetNumberField(TEXT("solver_ms"), result.SolverMs);
+		run->SetNumberField(TEXT("setup_ms"), result.SetupMs);
+		run->SetNumberField(TEXT("update_ms"), result.UpdateMs);
+		run->SetNumberField(TEXT("wall_ms"), result.WallMs);
+		if (!result.CheckFailure.IsEmpty()) {
+			run->SetStringField(TEXT("check_failure"), result.CheckFailure);
+		}
+		runs.Add(MakeShared<FJsonValueObject>(run));
+	}
+
+	TSharedPtr<FJsonObject> root = MakeShared<FJsonObject>();
+	root->SetStringField(TEXT("platform"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	root->SetNumberField(TEXT("logical_cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	root->SetArrayField(TEXT("runs"), runs);
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	FJsonSerializer::Serialize(root.ToSharedRef(), writer);
+	return json;
+}
@@ -0,0 +1,90 @@
+#include "ChBenchmarkCommandlet.h"
+#include "ChBenchmark.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+UChBenchmarkCommandlet::UChBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UChBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString sceneList;
+	FString backendList = TEXT("SERIAL_NSC");
+	FString threadList = FString::FromInt(FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 2));
+	FString shurList = TEXT("0");
+	int32 steps = 500;
+	int32 warmup = 50;
+	int32 granularCount = 100000;
+	FString output = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ChronoBenchmark"), TEXT("Benchmark.json"));
+	FParse::Value(*Params, TEXT("Scenes="), sceneList);
+	FParse::Value(*Params, TEXT("Backends="), backendList);
+	FParse::Value(*Params, TEXT("Threads="), threadList);
+	FParse::Value(*Params, TEXT("ThreadedShur="), shurList);
+	FParse::Value(*Params, TEXT("Steps="), steps);
+	FParse::Value(*Params, TEXT("Warmup="), warmup);
+	FParse::Value(*Params, TEXT("GranularCount="), granularCount);
+	FParse::Value(*Params, TEXT("Output="), output);
+
+	TArray<FString> sceneNames;
+	TArray<FString> backendNames;
+	TArray<FString> threadNames;
+	TArray<FString> shurModes;
+	sceneList.ParseIntoArray(sceneNames, TEXT(","));
+	backendList.ParseIntoArray(backendNames, TEXT(","));
+	threadList.ParseIntoArray(threadNames, TEXT(","));
+	shurList.ParseIntoArray(shurModes, TEXT(","));
+
+	TArray<EChSystemBackend::Type> backends;
+	for (auto& name : backendNames) {
+		EChSystemBackend::Type backend;
+		if (!ChBenchmark::FindBackend(name, backend)) {
+			UE_LOG(LogTemp, Error, TEXT("ChBenchmark: unknown backend %s"), *name);
+			return 1;
+		}
+		backends.Add(backend);
+	}
+
+	TArray<TUniquePtr<FChBenchmarkScene>> scenes;
+	ChBenchmark::CreateScenes(granularCount, scenes);
+
+	TArray<FChBenchmarkResult> results;
+	int32 failedChecks = 0;
+	for (auto& scene : scenes) {
+		if (sceneNames.Num() && !sceneNames.Contains(scene->GetName())) {
+			continue;
+		}
+		for (auto backend : backends) {
+			if (!scene->SupportsBackend(backend)) {
+				continue;
+			}
+			for (auto& threadName : threadNames) {
+				for (auto& shurMode : shurModes) {
+					int32 threads = FMath::Max(FCString::Atoi(*threadName), 1);
+					bool bThreadedShur = FCString::Atoi(*shurMode) != 0;
+					// The Schur product only differs on the parallel NSC backend
+					if (bThreadedShur && backend != EChSystemBackend::PARALLEL_NSC) {
+						continue;
+					}
+					FChBenchmarkResult& result = results.Add_GetRef(ChBenchmark::Run(*scene, backend, threads, warmup, steps, bThreadedShur));
+					UE_LOG(LogTemp, Display, TEXT("%s %s x%d%s: %.3f ms/step (collision %.3f, solver %.3f, setup %.3f, update %.3f)"),
+						*result.Scene, *result.Backend, threads, result.bThreadedShur ? TEXT(" threaded Schur") : TEXT(""), result.StepMs, result.CollisionMs, result.SolverMs, result.SetupMs, result.UpdateMs);
+					if (!result.CheckFailure.IsEmpty()) {
+						UE_LOG(LogTemp, Error, TEXT("ChBenchmark: %s %s x%d check failed: %s"), *result.Scene, *result.Backend, threads, *result.CheckFailure);
+						failedChecks++;
+					}
+				}
+			}
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(ChBenchmark::ToJson(results), *output)) {
+		UE_LOG(LogTemp, Error, TEXT("ChBenchmark: could not write %s"), *output);
+		return 1;
+	}
+	return results.Num() && !failedChecks ? 0 : 1;
+}
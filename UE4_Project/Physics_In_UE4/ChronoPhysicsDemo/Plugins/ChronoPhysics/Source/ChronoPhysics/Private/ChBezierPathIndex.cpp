@@ -0,0 +1,194 @@
+#include "ChBezierPathIndex.h"
+#include "chrono/core/ChBezierCurve.h"
+
+namespace {
+	const int32 MaxIterations = 8;
+	const double ParamTolerance = 1e-6;
+	// Start points tried on a segment the cursor knows nothing about
+	const int32 SegmentSamples = 8;
+	const int32 MaxHops = 4;
+
+	double BoundsDistanceSquared(const chrono::ChVector<>& p, const chrono::ChVector<>& boundsMin, const chrono::ChVector<>& boundsMax)
+	{
+		double distance = 0;
+		for (int32 i = 0; i < 3; i++) {
+			double outside = FMath::Max(FMath::Max(boundsMin[i] - p[i], p[i] - boundsMax[i]), 0.0);
+			distance += outside * outside;
+		}
+		return distance;
+	}
+}
+
+FChBezierPathIndex::FChBezierPathIndex(const chrono::ChBezierCurve& curve, bool bInClosedPath)
+	: bClosedPath(bInClosedPath)
+{
+	int32 num = curve.getNumPoints() > 1 ? (int32)curve.getNumPoints() - 1 : 0;
+	segments.SetNum(num);
+	double longest = 0;
+	for (int32 i = 0; i < num; i++) {
+		// Back from the end points and tangents, B'(0) = 3 (P1 - P0) and B'(1) = 3 (P3 - P2)
+		FSegment& segment = segments[i];
+		segment.P[0] = curve.getPoint(i);
+		segment.P[3] = curve.getPoint(i + 1);
+		segment.P[1] = segment.P[0] + curve.evalD(i, 0) / 3;
+		segment.P[2] = segment.P[3] - curve.evalD(i, 1) / 3;
+		// A Bezier segment is inside the hull of its control points
+		segment.BoundsMin = segment.P[0];
+		segment.BoundsMax = segment.P[0];
+		for (int32 c = 1; c < 4; c++) {
+			for (int32 a = 0; a < 3; a++) {
+				segment.BoundsMin[a] = FMath::Min(segment.BoundsMin[a], segment.P[c][a]);
+				segment.BoundsMax[a] = FMath::Max(segment.BoundsMax[a], segment.P[c][a]);
+			}
+		}
+		longest = FMath::Max(longest, (segment.P[1] - segment.P[0]).Length() + (segment.P[2] - segment.P[1]).Length() + (segment.P[3] - segment.P[2]).Length());
+	}
+	relocationDistance = longest;
+}
+
+double FChBezierPathIndex::Locate(const chrono::ChVector<>& location, FChBezierPathCursor& cursor, chrono::ChVector<>& outPoint) const
+{
+	if (!cursor.IsValid() || !segments.IsValidIndex(cursor.Interval)) {
+		return LocateGlobal(location, cursor, outPoint);
+	}
+
+	int32 interval = cursor.Interval;
+	double t = cursor.Param;
+	double distance = Solve(location, interval, t);
+	// Ran off an end, the path goes on in the neighbour
+	for (int32 hop = 0; hop < MaxHops; hop++) {
+		bool bForward = t >= 1 - ParamTolerance;
+		int32 next = bForward ? GetNext(interval) : t <= ParamTolerance ? GetPrevious(interval) : INDEX_NONE;
+		if (next == INDEX_NONE) {
+			break;
+		}
+		double nextT = bForward ? 0 : 1;
+		double nextDistance = Solve(location, next, nextT);
+		if (nextDistance >= distance) {
+			break;
+		}
+		interval = next;
+		t = nextT;
+		distance = nextDistance;
+	}
+
+	if (distance > relocationDistance * relocationDistance) {
+		return LocateGlobal(location, cursor, outPoint);
+	}
+	cursor.Interval = interval;
+	cursor.Param = t;
+	outPoint = Eval(segments[interval], t);
+	return distance;
+}
+
+double FChBezierPathIndex::LocateGlobal(const chrono::ChVector<>& location, FChBezierPathCursor& outCursor, chrono::ChVector<>& outPoint) const
+{
+	outCursor.Reset();
+	if (segments.Num() == 0) {
+		outPoint = location;
+		return 0;
+	}
+
+	TArray<TPair<double, int32>, TInlineAllocator<64>> order;
+	order.Reserve(segments.Num());
+	for (int32 i = 0; i < segments.Num(); i++) {
+		order.Emplace(BoundsDistanceSquared(location, segments[i].BoundsMin, segments[i].BoundsMax), i);
+	}
+	order.Sort([](const TPair<double, int32>& a, const TPair<double, int32>& b) { return a.Key < b.Key; });
+
+	double best = TNumericLimits<double>::Max();
+	for (auto& candidate : order) {
+		if (candidate.Key >= best) {
+			break;
+		}
+		const FSegment& segment = segments[candidate.Value];
+		double t = 0;
+		double start = TNumericLimits<double>::Max();
+		for (int32 s = 0; s <= SegmentSamples; s++) {
+			double sampleT = (double)s / SegmentSamples;
+			double sample = (Eval(segment, sampleT) - location).Length2();
+			if (sample < start) {
+				start = sample;
+				t = sampleT;
+			}
+		}
+		double distance = Solve(location, candidate.Value, t);
+		if (distance < best) {
+			best = distance;
+			outCursor.Interval = candidate.Value;
+			outCursor.Param = t;
+		}
+	}
+	outPoint = Eval(segments[outCursor.Interval], outCursor.Param);
+	return best;
+}
+
+chrono::ChVector<> FChBezierPathIndex::Eval(const FChBezierPathCursor& cursor) const
+{
+	return cursor.IsValid() ? Eval(segments[cursor.Interval], cursor.Param) : chrono::VNULL;
+}
+
+chrono::ChVector<> FChBezierPathIndex::EvalTangent(const FChBezierPathCursor& cursor) const
+{
+	if (!cursor.IsValid()) {
+		return chrono::VNULL;
+	}
+	chrono::ChVector<> tangent = EvalD(segments[cursor.Interval], cursor.Param);
+	double length = tangent.Length();
+	return length > 0 ? tangent / length : tangent;
+}
+
+chrono::ChVector<> FChBezierPathIndex::Eval(const FSegment& segment, double t) const
+{
+	double u = 1 - t;
+	return segment.P[0] * (u * u * u) + segment.P[1] * (3 * u * u * t) + segment.P[2] * (3 * u * t * t) + segment.P[3] * (t * t * t);
+}
+
+chrono::ChVector<> FChBezierPathIndex::EvalD(const FSegment& segment, double t) const
+{
+	double u = 1 - t;
+	return (segment.P[1] - segment.P[0]) * (3 * u * u) + (segment.P[2] - segment.P[1]) * (6 * u * t) + (segment.P[3] - segment.P[2]) * (3 * t * t);
+}
+
+chrono::ChVector<> FChBezierPathIndex::EvalDD(const FSegment& segment, double t) const
+{
+	double u = 1 - t;
+	return (segment.P[2] - segment.P[1] * 2 + segment.P[0]) * (6 * u) + (segment.P[3] - segment.P[2] * 2 + segment.P[1]) * (6 * t);
+}
+
+double FChBezierPathIndex::Solve(const chrono::ChVector<>& location, int32 segmentIndex, double& t) const
+{
+	const FSegment& segment = segments[segmentIndex];
+	// Root of f(t) = (B(t) - p) . B'(t), clamped to the segment
+	for (int32 i = 0; i < MaxIterations; i++) {
+		chrono::ChVector<> offset = Eval(segment, t) - location;
+		chrono::ChVector<> d = EvalD(segment, t);
+		double tangentSquared = d.Length2();
+		if (tangentSquared < SMALL_NUMBER) {
+			break;
+		}
+		double f = offset.Dot(d);
+		double df = tangentSquared + offset.Dot(EvalDD(segment, t));
+		// Off the convex part Gauss-Newton still goes downhill
+		if (df <= 0) {
+			df = tangentSquared;
+		}
+		double next = FMath::Clamp(t - f / df, 0.0, 1.0);
+		bool bConverged = FMath::Abs(next - t) < ParamTolerance;
+		t = next;
+		if (bConverged) {
+			break;
+		}
+	}
+	return (Eval(segment, t) - location).Length2();
+}
+
+int32 FChBezierPathIndex::GetNext(int32 segment) const
+{
+	return segment + 1 < segments.Num() ? segment + 1 : bClosedPath ? 0 : INDEX_NONE;
+}
+
+int32 FChBezierPathIndex::GetPrevious(int32 segment) const
+{
+	return segment > 0 ? segment - 1 : bClosedPath ? segments.Num() - 1 : INDEX_NONE;
+}
@@ -0,0 +1,94 @@
+#include "ChBodyBatch.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono_parallel/physics/ChSystemParallel.h"
+#include <algorithm>
+
+namespace {
+	// The body list is protected in ChAssembly, AddBody and RemoveBody are the only ways in from outside
+	struct FBodyListAccess : chrono::ChAssembly
+	{
+		static std::vector<std::shared_ptr<chrono::ChBody>>& Get(chrono::ChAssembly& assembly)
+		{
+			return assembly.*(&FBodyListAccess::bodylist);
+		}
+	};
+}
+
+FChBodyBatch* FChBodyBatch::current = nullptr;
+
+FChBodyBatch::FChBodyBatch(std::shared_ptr<chrono::ChSystem> phySystem)
+	: system(phySystem.get())
+{
+	check(IsInGameThread());
+	if (!system || (current && current->system == system) || dynamic_cast<chrono::ChSystemParallel*>(system)) {
+		return;
+	}
+	bOwner = true;
+	previous = current;
+	current = this;
+}
+
+FChBodyBatch::~FChBodyBatch()
+{
+	if (bOwner) {
+		Flush();
+		current = previous;
+	}
+}
+
+void FChBodyBatch::AddBody(std::shared_ptr<chrono::ChSystem> phySystem, std::shared_ptr<chrono::ChBody> body)
+{
+	if (current && current->system == phySystem.get() && IsInGameThread()) {
+		current->added.push_back(std::move(body));
+		return;
+	}
+	phySystem->AddBody(body);
+}
+
+void FChBodyBatch::RemoveBody(std::shared_ptr<chrono::ChSystem> phySystem, std::shared_ptr<chrono::ChBody> body)
+{
+	if (current && current->system == phySystem.get() && IsInGameThread()) {
+		auto queued = std::find(current->added.begin(), current->added.end(), body);
+		if (queued != current->added.end()) {
+			current->added.erase(queued);
+			return;
+		}
+		current->removed.push_back(std::move(body));
+		return;
+	}
+	phySystem->RemoveBody(body);
+}
+
+void FChBodyBatch::Flush()
+{
+	auto& bodies = FBodyListAccess::Get(*system);
+	if (!removed.empty()) {
+		TSet<chrono::ChBody*> removedSet;
+		removedSet.Reserve(removed.size());
+		for (auto& body : removed) {
+			removedSet.Add(body.get());
+		}
+		bodies.erase(std::remove_if(bodies.begin(), bodies.end(), [&removedSet](const std::shared_ptr<chrono::ChBody>& body) {
+			return removedSet.Contains(body.get());
+		}), bodies.end());
+		// Unregisters the collision models, the rest of what RemoveBody does
+		for (auto& body : removed) {
+			if (body->GetSystem() == system) {
+				body->SetSystem(nullptr);
+			}
+		}
+		removed.clear();
+	}
+
+	if (!added.empty()) {
+		bodies.reserve(bodies.size() + added.size());
+		for (auto& body : added) {
+			bodies.push_back(body);
+		}
+		// Registers the collision models, now that the list is complete
+		for (auto& body : added) {
+			body->SetSystem(system);
+		}
+		added.clear();
+	}
+}
@@ -6,6 +6,14 @@
 #include "chrono/physics/ChBody.h"
 #include "chrono/physics/ChSystem.h"
 #include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "ChTelemetry.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "ChStaticMeshCollider.h"
+#include "ChShapeInstances.h"
+#include "ChMaterialLibrary.h"
+#include "ChCollisionEnvelope.h"
+#include "ChBodyBatch.h"
+#include "ChKinematicBody.h"
 #include "util.h"
 
 
@@ -19,8 +27,10 @@ void UChBodyComponent::PhysicsObjectConstruct()
 {
 	//DataOnwnerName = FName(*(GetOwner()->GetName() + GetName()));
 
-	this->ChData = std::make_shared<chrono::ChBody>();
+	this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
 	this->GetOwner()->GetRootComponent()->SetMobility(EComponentMobility::Movable);
+	this->tunedEnvelope = -1;
+	this->tunedMargin = -1;
 
 	//if (!isFixed) {
 	//	this->GetOwner()->GetRootComponent()->SetMobility(EComponentMobility::Movable);
@@ -34,78 +44,323 @@ void UChBodyComponent::PhysicsObjectConstruct()
 	}
 }
 
+bool UChBodyComponent::InstanceCollisionShape(const FString& key, TFunctionRef<void(chrono::collision::ChCollisionModel& model)> build)
+{
+	// The parallel model keeps its shapes in the system's own arrays, nothing to share
+	if (!bShareCollisionShape || isForParallel || !this->ChData) {
+		return false;
+	}
+	if (this->tunedEnvelope < 0) {
+		this->shapeInstance = FChShapeInstances::Find(key, build);
+	}
+	else {
+		// The tuned values are baked into the template's shapes, bodies of one size share them
+		FString tunedKey = FString::Printf(TEXT("%s|%g|%g"), *key, this->tunedEnvelope, this->tunedMargin);
+		this->shapeInstance = FChShapeInstances::Find(tunedKey, [this, &build](chrono::collision::ChCollisionModel& model) {
+			ApplyCollisionEnvelope(model);
+			build(model);
+		});
+	}
+	return FChShapeInstances::Instance(*this->ChData, *this->shapeInstance);
+}
+
+bool UChBodyComponent::SelectCollisionEnvelope(const FVector& size)
+{
+	// Fixed bodies don't travel, only their size counts
+	float speed = (this->isFixed || this->bKinematic) ? 0.f : this->MaxSpeed;
+	if (this->isForParallel || !FChCollisionEnvelope::Select(size, speed, this->tunedEnvelope, this->tunedMargin)) {
+		this->tunedEnvelope = -1;
+		this->tunedMargin = -1;
+		return false;
+	}
+	return true;
+}
+
+void UChBodyComponent::ApplyCollisionEnvelope(chrono::collision::ChCollisionModel& model) const
+{
+	if (this->tunedEnvelope >= 0) {
+		model.SetEnvelope(this->tunedEnvelope);
+		model.SetSafeMargin(this->tunedMargin);
+	}
+}
+
+double UChBodyComponent::GetCCDRadius() const
+{
+	if (!bContinuousCollision || isFixed || bKinematic) {
+		return 0;
+	}
+	if (CCDSweptSphereRadius > 0.f) {
+		return CCDSweptSphereRadius / CHRONO_SCALE;
+	}
+	FChColliderProxy proxy;
+	if (GetColliderProxy(proxy)) {
+		return proxy.Type == FChColliderProxy::Sphere ? proxy.Extent.X : proxy.Extent.GetMin();
+	}
+	USceneComponent* root = GetOwner()->GetRootComponent();
+	return root ? root->Bounds.BoxExtent.GetMin() / CHRONO_SCALE : 0;
+}
+
 void UChBodyComponent::PhysicsObjectInitalize()
 {
 	if (this->ChData && !this->isInitialized) {
-		this->ChData->SetBodyFixed(this->isFixed);
+		// The parallel systems keep kinematic bodies fixed, the pose is still set from outside each substep
+		this->ChData->SetBodyFixed(this->isFixed || this->bKinematic);
 		this->ChData->SetCollide(this->isCollide);
 		this->ChData->SetLimitSpeed(true);
 		this->ChData->SetMaxSpeed(this->MaxSpeed);
 		this->ChData->SetMaxWvel(this->MaxAngularSpeed);
 
+		this->ChData->SetUseSleeping(this->bSceneUseSleeping && this->bAllowSleeping && !this->bKinematic);
+		this->ChData->SetSleepTime(this->bOverrideSleepThreshold ? this->SleepTime : this->sceneSleepTime);
+		this->ChData->SetSleepMinSpeed((this->bOverrideSleepThreshold ? this->SleepMinSpeed : this->sceneSleepMinSpeed) / CHRONO_SCALE);
+		this->ChData->SetSleepMinWvel(this->bOverrideSleepThreshold ? this->SleepMinAngularSpeed : this->sceneSleepMinAngularSpeed);
+		// In the serial solver, so the contacts see the velocity of the motion
+		if (this->bKinematic && !this->isForParallel) {
+			FChKinematicBody::Make(*this->ChData);
+		}
+
 		auto pos = FVECTOR_TO_CHRONO_VEC(GetOwner()->GetRootComponent()->GetComponentLocation());
 		this->ChData->SetPos(pos);
 		auto quat = FQUAT_TO_CHRONO_QUAT(GetOwner()->GetRootComponent()->GetComponentQuat());
 		this->ChData->SetRot(quat);
 
+		this->latchedCustomForce = this->CustomForce;
+		this->cachedLocation = GetOwner()->GetRootComponent()->GetComponentLocation();
+		this->cachedRotation = GetOwner()->GetRootComponent()->GetComponentQuat();
+		this->previousLocation = this->cachedLocation;
+		this->previousRotation = this->cachedRotation;
+		this->lastSyncedTransform = GetOwner()->GetRootComponent()->GetComponentTransform();
+		this->kinematicStartLocation = this->kinematicTargetLocation = this->cachedLocation;
+		this->kinematicStartRotation = this->kinematicTargetRotation = this->cachedRotation;
+		this->kinematicDuration = 0.f;
+
 		if (this->CollisionFamily >= 0 && this->NoCollisionWithFamiliy.Num() > 0) {
 			this->ChData->GetCollisionModel()->SetFamily(this->CollisionFamily);
 			for (int noCollide : this->NoCollisionWithFamiliy) {
 				this->ChData->GetCollisionModel()->SetFamilyMaskNoCollisionWithFamily(noCollide);
 			}
 		}
+		// Read by FChCollisionGroupFilter
+		this->ChData->SetIdentifier(FMath::Max(this->CollisionGroup, 0));
 
-		this->ChData->GetMaterialSurfaceNSC()->SetSfriction(this->StaticFriction);
-		this->ChData->GetMaterialSurfaceNSC()->SetKfriction(this->SlidingFriction);
-		this->ChData->GetMaterialSurfaceNSC()->SetRollingFriction(this->RollingFriction);
-		this->ChData->GetMaterialSurfaceNSC()->SetSpinningFriction(this->SpinningFriction);
-		this->ChData->GetMaterialSurfaceNSC()->SetCohesion(this->Cohension);
-		this->ChData->GetMaterialSurfaceNSC()->SetRestitution(this->Restitution);
-		this->ChData->GetMaterialSurfaceNSC()->SetDampingF(this->DampingF);
-		this->ChData->GetMaterialSurfaceNSC()->SetCompliance(this->Compliance);
-		this->ChData->GetMaterialSurfaceNSC()->SetComplianceT(this->ComplianceT);
-		this->ChData->GetMaterialSurfaceNSC()->SetComplianceRolling(this->ComplianceRoll);
-		this->ChData->GetMaterialSurfaceNSC()->SetComplianceSpinning(this->ComplianceSpin);
+		ApplyMaterialParameter(this->ChData, this->isForSMC);
+
+		if (this->bAddCustomForce) {
+			this->customForceData = std::make_shared<chrono::ChForce>();
+			this->customForceData->SetMode(chrono::ChForce::FORCE);
+			this->customForceData->SetFrame(chrono::ChForce::BODY);
+			this->customForceData->SetAlign(chrono::ChForce::BODY_DIR);
+			this->ChData->AddForce(this->customForceData);
+			this->customForceData->SetVrelpoint(chrono::VNULL);
+			ApplyCustomForce();
+		}
 
 		this->isInitialized = true;
 	}
 }
 
+void UChBodyComponent::ApplyMaterialParameter(std::shared_ptr<chrono::ChBody> body, bool bSMC) const
+{
+	body->SetMaterialSurface(GetSharedMaterial(bSMC));
+}
+
+std::shared_ptr<chrono::ChMaterialSurface> UChBodyComponent::GetSharedMaterial(bool bSMC) const
+{
+	if (this->PhysicalMaterial) {
+		return FChMaterialLibrary::Find(this->PhysicalMaterial, bSMC);
+	}
+	return FChMaterialLibrary::Find(GetMaterialValues(), bSMC);
+}
+
+FChMaterialValues UChBodyComponent::GetMaterialValues() const
+{
+	return { this->StaticFriction, this->SlidingFriction, this->RollingFriction, this->SpinningFriction,
+		this->Cohension, this->Restitution, this->DampingF, this->Compliance, this->ComplianceT,
+		this->ComplianceRoll, this->ComplianceSpin, this->YoungModulus, this->PoissonRatio };
+}
+
 void UChBodyComponent::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
 {
 	if (this->isInitialized) {
-		phySystem->AddBody(this->ChData);
+		FChBodyBatch::AddBody(phySystem, this->ChData);
 	}
 }
 
+void UChBodyComponent::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	if (this->ChData && this->ChData->GetSystem() == phySystem.get()) {
+		FChBodyBatch::RemoveBody(phySystem, this->ChData);
+	}
+}
+
+void UChBodyComponent::SetSleepingParameter(bool bUseSleeping, float sleepTime, float minSpeed, float minAngularSpeed)
+{
+	this->bSceneUseSleeping = bUseSleeping;
+	this->sceneSleepTime = sleepTime;
+	this->sceneSleepMinSpeed = minSpeed;
+	this->sceneSleepMinAngularSpeed = minAngularSpeed;
+}
+
 void UChBodyComponent::UpdatePhysicsState()
 {
-	if (this->isInitialized && this->bUseDrag) {
+	if (this->isInitialized && this->bKinematic) {
+		ApplyKinematicPose();
+		return;
+	}
+	if (this->isInitialized && this->bUseDrag && !this->ChData->GetSleeping()) {
 		this->ChData->Empty_forces_accumulators();
 		ChData->Accumulate_force(this->ChData->GetPos_dt() * -DragCoefTrans, ChData->GetPos(), false);
 		ChData->Accumulate_torque(ChData->GetWvel_par() * -DragCoefRot, false);
-
-		if (this->bAddCustomForce) {
-			ChData->Accumulate_force(FVECTOR_TO_CHRONO_VEC(CustomForce) * 100, 0, true);
-		}
 		//ChData->SetPos_dt(ChData->GetPos_dt()*0.98f);
 		//ChData->SetRot_dt(ChData->GetRot_dt()*0.98f);
 	}
-	else if (this->isInitialized && this->bAddCustomForce) {
-		this->ChData->Empty_forces_accumulators();
-		ChData->Accumulate_force(FVECTOR_TO_CHRONO_VEC(CustomForce) * 100, 0, true);
+}
+
+void UChBodyComponent::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	// Custom forces live in customForceData, only drag needs the per-substep callback
+	if (this->isInitialized && (this->bUseDrag || this->bKinematic)) {
+		objList.Add(this);
+	}
+}
+
+void UChBodyComponent::ApplyCustomForce()
+{
+	auto force = FVECTOR_TO_CHRONO_VEC(latchedCustomForce) * 100;
+	double magnitude = force.Length();
+	if (magnitude > 0) {
+		this->customForceData->SetRelDir(force / magnitude);
 	}
+	this->customForceData->SetMforce(magnitude);
+}
 
+void UChBodyComponent::ApplyKinematicPose()
+{
+	chrono::ChSystem* system = this->ChData->GetSystem();
+	double time = system ? system->GetChTime() : this->kinematicStartTime;
+	float alpha = this->kinematicDuration > 0.f ? FMath::Clamp((float)((time - this->kinematicStartTime) / this->kinematicDuration), 0.f, 1.f) : 1.f;
+	FVector location = FMath::Lerp(this->kinematicStartLocation, this->kinematicTargetLocation, alpha);
+	FQuat rotation = FQuat::Slerp(this->kinematicStartRotation, this->kinematicTargetRotation, alpha);
+
+	// Constant over the frame, and at rest once the target is reached
+	chrono::ChVector<> velocity = chrono::VNULL;
+	chrono::ChVector<> angularVelocity = chrono::VNULL;
+	if (alpha < 1.f) {
+		FVector delta = this->kinematicTargetLocation - this->kinematicStartLocation;
+		velocity = FVECTOR_TO_CHRONO_VEC(delta) / this->kinematicDuration;
+		chrono::ChQuaternion<> turn = FQUAT_TO_CHRONO_QUAT(this->kinematicTargetRotation) * FQUAT_TO_CHRONO_QUAT(this->kinematicStartRotation).GetConjugate();
+		if (turn.e0() < 0) {
+			turn = chrono::ChQuaternion<>(-turn.e0(), -turn.e1(), -turn.e2(), -turn.e3());
+		}
+		double angle;
+		chrono::ChVector<> axis;
+		turn.Q_to_AngAxis(angle, axis);
+		angularVelocity = axis * (angle / this->kinematicDuration);
+	}
+	FChKinematicBody::Drive(*this->ChData, FVECTOR_TO_CHRONO_VEC(location), FQUAT_TO_CHRONO_QUAT(rotation), velocity, angularVelocity);
 }
 
 void UChBodyComponent::UpdateVisualAsset()
 {
-	if (isInitialized && !isFixed) {
-		auto pos = CHRONO_VEC_TO_FVECTOR(this->ChData->GetPos());
-		this->GetOwner()->SetActorLocation(pos);
-		auto quat = CHRONO_QUAT_TO_FQUAT(this->ChData->GetRot());
-		this->GetOwner()->SetActorRotation(quat);
+	if (isInitialized && !isFixed && !bKinematic && !bSleepPoseApplied) {
+		this->GetOwner()->SetActorLocation(this->cachedLocation);
+		this->GetOwner()->SetActorRotation(this->cachedRotation);
+		this->bSleepPoseApplied = bCachedSleeping;
+	}
+}
+
+void UChBodyComponent::InterpolateVisualAsset(float alpha)
+{
+	if (isInitialized && !isFixed && !bKinematic && !bSleepPoseApplied) {
+		if (bCachedSleeping) {
+			UpdateVisualAsset();
+			return;
+		}
+		this->GetOwner()->SetActorLocation(FMath::Lerp(this->previousLocation, this->cachedLocation, alpha));
+		this->GetOwner()->SetActorRotation(FQuat::Slerp(this->previousRotation, this->cachedRotation, alpha));
+	}
+}
+
+void UChBodyComponent::GatherVisualTransforms(TArray<class USceneComponent*>& components, TArray<FTransform>& transforms, float alpha, float tolerance)
+{
+	if (!isInitialized || isFixed || bKinematic || bSleepPoseApplied) {
+		return;
+	}
+	this->bSleepPoseApplied = bCachedSleeping;
+
+	FTransform transform = this->lastSyncedTransform;
+	if (alpha >= 1.f || bCachedSleeping) {
+		transform.SetLocation(this->cachedLocation);
+		transform.SetRotation(this->cachedRotation);
+	}
+	else {
+		transform.SetLocation(FMath::Lerp(this->previousLocation, this->cachedLocation, alpha));
+		transform.SetRotation(FQuat::Slerp(this->previousRotation, this->cachedRotation, alpha));
+	}
+
+	if (!transform.Equals(this->lastSyncedTransform, tolerance)) {
+		this->lastSyncedTransform = transform;
+		components.Add(GetOwner()->GetRootComponent());
+		transforms.Add(transform);
+	}
+}
+
+void UChBodyComponent::LatchPhysicsInput()
+{
+	// A new custom force has to reach a sleeping body
+	if (this->bAddCustomForce && !this->latchedCustomForce.Equals(this->CustomForce)) {
+		this->bWakeRequested = true;
 	}
+	this->latchedCustomForce = this->CustomForce;
+	if (this->customForceData) {
+		ApplyCustomForce();
+	}
+
+	// The motion of the coming step runs from where the body is to where the animation put the owner
+	if (this->isInitialized && this->bKinematic) {
+		this->kinematicStartLocation = CHRONO_VEC_TO_FVECTOR(this->ChData->GetPos());
+		this->kinematicStartRotation = CHRONO_QUAT_TO_FQUAT(this->ChData->GetRot());
+		this->kinematicTargetLocation = GetOwner()->GetRootComponent()->GetComponentLocation();
+		this->kinematicTargetRotation = GetOwner()->GetRootComponent()->GetComponentQuat();
+		chrono::ChSystem* system = this->ChData->GetSystem();
+		this->kinematicStartTime = system ? system->GetChTime() : 0;
+		this->kinematicDuration = GetWorld() ? GetWorld()->GetDeltaSeconds() : 0.f;
+		ApplyKinematicPose();
+	}
+
+	if (this->isInitialized && this->bWakeRequested) {
+		this->ChData->SetSleeping(false);
+		this->bCachedSleeping = false;
+		this->bSleepPoseApplied = false;
+	}
+	this->bWakeRequested = false;
+}
+
+void UChBodyComponent::CacheVisualState()
+{
+	if (isInitialized && !isFixed && !bKinematic) {
+		this->previousLocation = this->cachedLocation;
+		this->previousRotation = this->cachedRotation;
+		this->cachedLocation = CHRONO_VEC_TO_FVECTOR(this->ChData->GetPos());
+		this->cachedRotation = CHRONO_QUAT_TO_FQUAT(this->ChData->GetRot());
+		this->bCachedSleeping = this->ChData->GetSleeping();
+		if (!this->bCachedSleeping) {
+			this->bSleepPoseApplied = false;
+		}
+	}
+}
+
+void UChBodyComponent::ApplyNetPose(const FVector& location, const FQuat& rotation)
+{
+	if (!isInitialized || !this->ChData) {
+		return;
+	}
+	this->ChData->SetPos(FVECTOR_TO_CHRONO_VEC(location));
+	this->ChData->SetRot(FQUAT_TO_CHRONO_QUAT(rotation));
+	this->previousLocation = this->cachedLocation = location;
+	this->previousRotation = this->cachedRotation = rotation;
+	this->bCachedSleeping = false;
+	this->bSleepPoseApplied = false;
 }
 
 FExportData UChBodyComponent::ExportData()
@@ -117,6 +372,9 @@ FExportData UChBodyComponent::ExportData()
 		if (bExportPos) {
 			data.data.Add(FName("Pos"), CHRONO_VEC_TO_FVECTOR((ChData->GetPos())));
 		}
+		if (bExportRot) {
+			data.data.Add(FName("Rot"), CHRONO_QUAT_TO_FQUAT((ChData->GetRot())).Euler());
+		}
 		if (bExportVel) {
 			data.data.Add(FName("Vel"), CHRONO_VEC_TO_FVECTOR((ChData->GetPos_dt())));
 		}
@@ -133,3 +391,64 @@ FExportData UChBodyComponent::ExportData()
 
 	return data;
 }
+
+void UChBodyComponent::RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList)
+{
+	if (!bExportData || !ChData) {
+		return;
+	}
+
+	FString prefix = BodyExportDataOwnerName.ToString();
+	posChannel = bExportPos ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".Pos"))), 3) : INDEX_NONE;
+	rotChannel = bExportRot ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".Rot"))), 4) : INDEX_NONE;
+	velChannel = bExportVel ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".Vel"))), 3) : INDEX_NONE;
+	acceChannel = bExportAcce ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".Acce"))), 3) : INDEX_NONE;
+	angVelChannel = bExportAngVel ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".AngVel"))), 3) : INDEX_NONE;
+	contactForceChannel = bExportContactForce ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".ContactForce"))), 3) : INDEX_NONE;
+
+	if (bExportPos || bExportRot || bExportVel || bExportAcce || bExportAngVel || bExportContactForce) {
+		writerList.Add(this);
+	}
+}
+
+void UChBodyComponent::WriteTelemetry(FChTelemetry& telemetry)
+{
+	if (posChannel != INDEX_NONE) {
+		telemetry.Write(posChannel, CHRONO_VEC_TO_FVECTOR((ChData->GetPos())));
+	}
+	if (rotChannel != INDEX_NONE) {
+		telemetry.Write(rotChannel, CHRONO_QUAT_TO_FQUAT((ChData->GetRot())));
+	}
+	if (velChannel != INDEX_NONE) {
+		telemetry.Write(velChannel, CHRONO_VEC_TO_FVECTOR((ChData->GetPos_dt())));
+	}
+	if (acceChannel != INDEX_NONE) {
+		telemetry.Write(acceChannel, CHRONO_VEC_TO_FVECTOR((ChData->GetPos_dtdt())));
+	}
+	if (angVelChannel != INDEX_NONE) {
+		telemetry.Write(angVelChannel, CHRONO_VEC_TO_FVECTOR((ChData->GetWvel_loc())));
+	}
+	if (contactForceChannel != INDEX_NONE) {
+		telemetry.Write(contactForceChannel, CHRONO_VEC_TO_FVECTOR((ChData->GetContactForce())));
+	}
+}
+
+void UChBodyComponent::OnRegister()
+{
+	Super::OnRegister();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void UChBodyComponent::OnUnregister()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::OnUnregister();
+}
+
+#if WITH_EDITOR
+void UChBodyComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	FChPhysicsObjectRegistry::NotifyEdited(this);
+}
+#endif
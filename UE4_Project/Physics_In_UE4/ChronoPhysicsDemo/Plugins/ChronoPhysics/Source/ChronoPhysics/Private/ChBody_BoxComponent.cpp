@@ -7,6 +7,9 @@
 #include "Engine/StaticMesh.h"
 #include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
 #include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "ChStaticMeshCollider.h"
+#include "ChShapeInstances.h"
+#include "chrono/collision/ChCCollisionModel.h"
 #include "util.h"
 
 void UChBody_BoxComponent::PhysicsObjectConstruct()
@@ -19,7 +22,22 @@ void UChBody_BoxComponent::PhysicsObjectConstruct()
 		auto boxList = rootComp->GetStaticMesh()->BodySetup->AggGeom.BoxElems;
 		if (boxList.Num()) {
 			auto box = boxList[0];
-			this->ChData = std::make_shared<chrono::ChBodyEasyBox>(box.X * scale.X / CHRONO_SCALE, box.Z * scale.Z / CHRONO_SCALE, box.Y * scale.Y / CHRONO_SCALE, Density, isCollide, false);
+			halfExtent = FVector(box.X * scale.X, box.Z * scale.Z, box.Y * scale.Y) / 2.0f / CHRONO_SCALE;
+			FVector size = halfExtent * 2.0f;
+			bool bTuned = SelectCollisionEnvelope(size);
+			if (bShareCollisionShape && !isForParallel) {
+				// Mass and inertia as ChBodyEasyBox has them, the shape comes from the shared template
+				this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
+				double mass = Density * size.X * size.Y * size.Z;
+				this->ChData->SetMass(mass);
+				this->ChData->SetInertiaXX(chrono::ChVector<>(mass / 12.0 * (size.Y * size.Y + size.Z * size.Z), mass / 12.0 * (size.X * size.X + size.Z * size.Z), mass / 12.0 * (size.X * size.X + size.Y * size.Y)));
+				FVector half = halfExtent;
+				InstanceCollisionShape(FChShapeInstances::MakeKey(TEXT("Box"), size), [half](chrono::collision::ChCollisionModel& model) {
+					model.AddBox(half.X, half.Y, half.Z);
+				});
+				return;
+			}
+			this->ChData = std::make_shared<chrono::ChBodyEasyBox>(box.X * scale.X / CHRONO_SCALE, box.Z * scale.Z / CHRONO_SCALE, box.Y * scale.Y / CHRONO_SCALE, Density, isCollide, false, CHRONO_CONTACT_METHOD(isForSMC));
 			if (isForParallel) {
 				this->ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
 				this->ChData->GetCollisionModel()->ClearModel();
@@ -27,7 +45,25 @@ void UChBody_BoxComponent::PhysicsObjectConstruct()
 				this->ChData->GetCollisionModel()->BuildModel();
 				this->ChData->SetCollide(true);
 			}
+			else if (bTuned) {
+				// ChBodyEasyBox added its box with the default envelope already
+				auto model = this->ChData->GetCollisionModel();
+				model->ClearModel();
+				ApplyCollisionEnvelope(*model);
+				model->AddBox(halfExtent.X, halfExtent.Y, halfExtent.Z);
+				model->BuildModel();
+			}
 			return;
 		}
 	}
 }
+
+bool UChBody_BoxComponent::GetColliderProxy(FChColliderProxy& outProxy) const
+{
+	if (halfExtent.IsZero()) {
+		return false;
+	}
+	outProxy.Type = FChColliderProxy::Box;
+	outProxy.Extent = halfExtent;
+	return true;
+}
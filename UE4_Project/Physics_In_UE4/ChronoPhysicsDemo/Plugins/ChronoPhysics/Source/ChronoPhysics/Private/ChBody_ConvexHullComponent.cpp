@@ -7,32 +7,46 @@
 #include "Engine/StaticMesh.h"
 #include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
 #include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "ChShapeCache.h"
+#include "ChBatchConvert.h"
+#include "ChShapeInstances.h"
+#include "ChConvexHullBuilder.h"
+#include "chrono/collision/ChCCollisionModel.h"
 #include "util.h"
 
 void UChBody_ConvexHullComponent::PhysicsObjectConstruct()
 {
 	Super::PhysicsObjectConstruct();
 
+	if (runtimePointSets.Num()) {
+		ConstructRuntimeHulls();
+		return;
+	}
+
 	auto rootComp = Cast<UStaticMeshComponent>(this->GetOwner()->GetRootComponent());
-	auto scale = rootComp->RelativeScale3D;
 	if (rootComp) {
-		auto convexList = rootComp->GetStaticMesh()->BodySetup->AggGeom.ConvexElems;
-		this->ChData = std::make_shared<chrono::ChBody>();
+		auto scale = rootComp->RelativeScale3D;
+		auto staticMesh = rootComp->GetStaticMesh();
+		auto& convexList = staticMesh->BodySetup->AggGeom.ConvexElems;
+		this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
 
-		if (isForParallel) {
-			ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+		this->bLoadedFromCache = false;
+		this->shapeCacheKey = FChShapeCache::MakeKey(staticMesh, scale, TEXT("ConvexHull"));
+		if (bUseShapeCache) {
+			this->bLoadedFromCache = FChShapeCache::LoadHulls(this->shapeCacheKey, hullPointList);
 		}
 
-		this->ChData->GetCollisionModel()->ClearModel();
 		if (convexList.Num()) {
-			for (auto convex : convexList) {
-				std::vector<chrono::ChVector<>> pointlist;
-				for (auto vtx : convex.VertexData) {
-					pointlist.push_back(chrono::ChVector<>(vtx.X * scale.X / CHRONO_SCALE, vtx.Z * scale.Z / CHRONO_SCALE, vtx.Y * scale.Y / CHRONO_SCALE));
+			if (!bLoadedFromCache) {
+				hullPointList.Reset(convexList.Num());
+				for (auto& convex : convexList) {
+					auto& pointlist = hullPointList[hullPointList.AddDefaulted()];
+					pointlist.Reserve(convex.VertexData.Num());
+					for (auto& vtx : convex.VertexData) {
+						pointlist.Add(FVector(vtx.X * scale.X / CHRONO_SCALE, vtx.Z * scale.Z / CHRONO_SCALE, vtx.Y * scale.Y / CHRONO_SCALE));
+					}
 				}
-				this->ChData->GetCollisionModel()->AddConvexHull(pointlist);
 			}
-			this->ChData->GetCollisionModel()->BuildModel();
 
 			auto volume = rootComp->GetStaticMesh()->BodySetup->AggGeom.GetVolume(scale);
 			double mass = volume / CHRONO_SCALE / CHRONO_SCALE / CHRONO_SCALE * Density;
@@ -41,8 +55,104 @@ void UChBody_ConvexHullComponent::PhysicsObjectConstruct()
 			FVector size = box.GetExtent() / CHRONO_SCALE;
 			FVector internia = 1.0 / 12.0 * mass * FVector(pow(size.Y, 2) + pow(size.Z, 2), pow(size.X, 2) + pow(size.Z, 2), pow(size.X, 2) + pow(size.Y, 2));
 			this->ChData->SetInertiaXX(chrono::ChVector<>(internia.X, internia.Z, internia.Y));
-			return;
+			SelectCollisionEnvelope(box.GetSize() * scale / CHRONO_SCALE);
+		}
+	}
+}
+
+void UChBody_ConvexHullComponent::PhysicsObjectBuildGeometry()
+{
+	if (!this->ChData || hullPointList.Num() == 0) {
+		return;
+	}
+
+	if (isForParallel) {
+		ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+	}
+	if (runtimePointSets.Num()) {
+		BuildRuntimeHulls();
+		return;
+	}
+
+	// Same mesh, scale and margin give the same hulls, the first body builds them for all
+	auto addHulls = [this](chrono::collision::ChCollisionModel& model) {
+		std::vector<chrono::ChVector<>> pointlist;
+		for (auto& points : hullPointList) {
+			ChBatchConvert::Widen(points, pointlist);
+			model.AddConvexHull(pointlist);
+		}
+	};
+	if (!InstanceCollisionShape(FChShapeInstances::MakeKey(*shapeCacheKey, FVector::ZeroVector), addHulls)) {
+		this->ChData->GetCollisionModel()->ClearModel();
+		ApplyCollisionEnvelope(*this->ChData->GetCollisionModel());
+		addHulls(*this->ChData->GetCollisionModel());
+		this->ChData->GetCollisionModel()->BuildModel();
+	}
+
+	if (bUseShapeCache && !bLoadedFromCache) {
+		FChShapeCache::SaveHulls(shapeCacheKey, hullPointList);
+	}
+	hullPointList.Empty();
+}
+
+void UChBody_ConvexHullComponent::ConstructRuntimeHulls()
+{
+	auto rootComp = this->GetOwner()->GetRootComponent();
+	FVector scale = rootComp ? rootComp->RelativeScale3D : FVector::OneVector;
+	this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
+	this->bLoadedFromCache = false;
+	this->shapeCacheKey.Empty();
+
+	FBox box(ForceInit);
+	hullPointList.Reset(runtimePointSets.Num());
+	for (auto& points : runtimePointSets) {
+		auto& pointlist = hullPointList[hullPointList.AddDefaulted()];
+		pointlist.Reserve(points.Num());
+		for (auto& vtx : points) {
+			pointlist.Add(FVector(vtx.X * scale.X / CHRONO_SCALE, vtx.Z * scale.Z / CHRONO_SCALE, vtx.Y * scale.Y / CHRONO_SCALE));
+			box += vtx * scale;
 		}
 	}
+	SelectCollisionEnvelope(box.GetSize() / CHRONO_SCALE);
 }
 
+void UChBody_ConvexHullComponent::BuildRuntimeHulls()
+{
+	// Many fragments build at once, each through its own thread's hull arena
+	TArray<FChConvexHull> hulls;
+	FChConvexHullBuilder::BuildHulls(hullPointList, hulls);
+
+	double volume = 0;
+	FBox box(ForceInit);
+	for (int32 i = 0; i < hulls.Num(); i++) {
+		if (hulls[i].bValid) {
+			hullPointList[i] = MoveTemp(hulls[i].Points);
+			volume += hulls[i].Volume;
+		}
+		for (auto& point : hullPointList[i]) {
+			box += point;
+		}
+	}
+	// Flat fragments have no hull volume, their box still gives them a mass
+	if (volume <= 0) {
+		volume = box.GetVolume();
+	}
+
+	// Already in Chrono units and axes
+	double mass = volume * Density;
+	this->ChData->SetMass(mass);
+	FVector size = box.GetExtent();
+	this->ChData->SetInertiaXX(chrono::ChVector<>(1.0 / 12.0 * mass * (pow(size.Y, 2) + pow(size.Z, 2)), 1.0 / 12.0 * mass * (pow(size.X, 2) + pow(size.Z, 2)), 1.0 / 12.0 * mass * (pow(size.X, 2) + pow(size.Y, 2))));
+
+	// Fragments are one of a kind, no shape cache and no instancing
+	auto model = this->ChData->GetCollisionModel();
+	model->ClearModel();
+	ApplyCollisionEnvelope(*model);
+	std::vector<chrono::ChVector<>> pointlist;
+	for (auto& points : hullPointList) {
+		ChBatchConvert::Widen(points, pointlist);
+		model->AddConvexHull(pointlist);
+	}
+	model->BuildModel();
+	hullPointList.Empty();
+}
@@ -7,6 +7,8 @@
 #include "Engine/StaticMesh.h"
 #include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
 #include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "ChShapeInstances.h"
+#include "chrono/collision/ChCCollisionModel.h"
 #include "util.h"
 
 void UChBody_CylinderComponent::PhysicsObjectConstruct()
@@ -19,7 +21,21 @@ void UChBody_CylinderComponent::PhysicsObjectConstruct()
 		auto cylinderList = rootComp->GetStaticMesh()->BodySetup->AggGeom.SphylElems;
 		if (cylinderList.Num()) {
 			auto cylinder = cylinderList[0];
-			this->ChData = std::make_shared<chrono::ChBodyEasyCylinder>(cylinder.Radius * scale.X / CHRONO_SCALE, cylinder.Length * scale.Z / CHRONO_SCALE, Density, isCollide, false);
+			double radius = cylinder.Radius * scale.X / CHRONO_SCALE;
+			double height = cylinder.Length * scale.Z / CHRONO_SCALE;
+			bool bTuned = SelectCollisionEnvelope(FVector(radius * 2.0, height, radius * 2.0));
+			if (bShareCollisionShape && !isForParallel) {
+				// Mass and inertia as ChBodyEasyCylinder has them, the shape comes from the shared template
+				this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
+				double mass = Density * PI * radius * radius * height;
+				this->ChData->SetMass(mass);
+				this->ChData->SetInertiaXX(chrono::ChVector<>(mass / 12.0 * (3 * radius * radius + height * height), 0.5 * mass * radius * radius, mass / 12.0 * (3 * radius * radius + height * height)));
+				InstanceCollisionShape(FChShapeInstances::MakeKey(TEXT("Cylinder"), FVector(radius, height, radius)), [radius, height](chrono::collision::ChCollisionModel& model) {
+					model.AddCylinder(radius, radius, height * 0.5);
+				});
+				return;
+			}
+			this->ChData = std::make_shared<chrono::ChBodyEasyCylinder>(cylinder.Radius * scale.X / CHRONO_SCALE, cylinder.Length * scale.Z / CHRONO_SCALE, Density, isCollide, false, CHRONO_CONTACT_METHOD(isForSMC));
 			if (isForParallel) {
 				this->ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
 				this->ChData->GetCollisionModel()->ClearModel();
@@ -27,6 +43,14 @@ void UChBody_CylinderComponent::PhysicsObjectConstruct()
 				this->ChData->GetCollisionModel()->BuildModel();
 				this->ChData->SetCollide(true);
 			}
+			else if (bTuned) {
+				// ChBodyEasyCylinder added its cylinder with the default envelope already
+				auto model = this->ChData->GetCollisionModel();
+				model->ClearModel();
+				ApplyCollisionEnvelope(*model);
+				model->AddCylinder(radius, radius, height * 0.5);
+				model->BuildModel();
+			}
 			return;
 		}
 	}
@@ -0,0 +1,151 @@
+#include "ChBody_HeightfieldComponent.h"
+#include "ChHeightfieldModel.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "GameFramework/Actor.h"
+#if WITH_EDITOR
+#include "LandscapeProxy.h"
+#include "LandscapeInfo.h"
+#include "LandscapeDataAccess.h"
+#include "LandscapeEdit.h"
+#endif
+#include "util.h"
+
+UChBody_HeightfieldComponent::UChBody_HeightfieldComponent()
+{
+	// Terrain never moves
+	isFixed = true;
+}
+
+void UChBody_HeightfieldComponent::SampleLandscape()
+{
+#if WITH_EDITOR
+	ALandscapeProxy* landscape = Cast<ALandscapeProxy>(GetOwner());
+	ULandscapeInfo* info = landscape ? landscape->GetLandscapeInfo() : nullptr;
+	int32 minX, minY, maxX, maxY;
+	if (!info || !info->GetLandscapeExtent(minX, minY, maxX, maxY)) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: the heightfield component has to be added to a landscape"), *GetOwner()->GetName());
+		return;
+	}
+
+	int32 width = maxX - minX + 1;
+	int32 height = maxY - minY + 1;
+	TArray<uint16> raw;
+	raw.SetNumUninitialized(width * height);
+	FLandscapeEditDataInterface dataInterface(info);
+	dataInterface.GetHeightDataFast(minX, minY, maxX, maxY, raw.GetData(), 0);
+
+	Modify();
+	int32 stride = FMath::Max(SampleStride, 1);
+	GridSize = FIntPoint((width - 1) / stride + 1, (height - 1) / stride + 1);
+	HeightData.SetNumUninitialized(GridSize.X * GridSize.Y);
+	for (int32 y = 0; y < GridSize.Y; y++) {
+		const uint16* row = raw.GetData() + y * stride * width;
+		int16* target = HeightData.GetData() + y * GridSize.X;
+		for (int32 x = 0; x < GridSize.X; x++) {
+			target[x] = (int16)((int32)row[x * stride] - 32768);
+		}
+	}
+
+	// Landscape space is quads, scaled by the actor; the body only takes the owner's location and rotation
+	FVector scale = landscape->GetRootComponent()->RelativeScale3D;
+	GridOrigin = FVector(minX * scale.X, minY * scale.Y, 0.f);
+	GridSpacing = FVector(stride * scale.X, stride * scale.Y, LANDSCAPE_ZSCALE * scale.Z);
+	UE_LOG(LogTemp, Log, TEXT("%s: sampled a %dx%d heightfield, %.1f MB"), *GetOwner()->GetName(), GridSize.X, GridSize.Y, HeightData.Num() * sizeof(int16) / (1024.f * 1024.f));
+#endif
+}
+
+float UChBody_HeightfieldComponent::GetHeightAt(const FVector& worldLocation) const
+{
+	if (GridSize.X < 2 || GridSize.Y < 2 || HeightData.Num() != GridSize.X * GridSize.Y) {
+		return worldLocation.Z;
+	}
+	FTransform frame = GetOwner()->GetActorTransform();
+	frame.SetScale3D(FVector::OneVector);
+	FVector local = frame.InverseTransformPosition(worldLocation);
+
+	float u = FMath::Clamp((local.X - GridOrigin.X) / GridSpacing.X, 0.f, (float)(GridSize.X - 1));
+	float v = FMath::Clamp((local.Y - GridOrigin.Y) / GridSpacing.Y, 0.f, (float)(GridSize.Y - 1));
+	int32 x0 = FMath::Min((int32)u, GridSize.X - 2);
+	int32 y0 = FMath::Min((int32)v, GridSize.Y - 2);
+	const int16* row0 = HeightData.GetData() + y0 * GridSize.X + x0;
+	const int16* row1 = row0 + GridSize.X;
+	float h0 = FMath::Lerp((float)row0[0], (float)row0[1], u - x0);
+	float h1 = FMath::Lerp((float)row1[0], (float)row1[1], u - x0);
+	local.Z = GridOrigin.Z + FMath::Lerp(h0, h1, v - y0) * GridSpacing.Z;
+	return frame.TransformPosition(local).Z;
+}
+
+void UChBody_HeightfieldComponent::PhysicsObjectConstruct()
+{
+	// Not the base construct, a landscape root can't be made movable and the terrain doesn't move anyway
+	isFixed = true;
+	this->heightfield.reset();
+#if WITH_EDITOR
+	if (HeightData.Num() == 0) {
+		SampleLandscape();
+	}
+#endif
+	if (GridSize.X < 2 || GridSize.Y < 2 || HeightData.Num() != GridSize.X * GridSize.Y) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: no heightfield samples, run SampleLandscape"), *GetOwner()->GetName());
+		return;
+	}
+
+	this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
+	if (isForParallel) {
+		ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+	}
+	else {
+		ChData->SetCollisionModel(std::make_shared<FChHeightfieldModel>());
+	}
+
+	// UE X and Y become Chrono X and Z, heights go along Chrono Y
+	auto field = std::make_shared<FChHeightfield>();
+	field->Heights = HeightData;
+	field->SizeX = GridSize.X;
+	field->SizeZ = GridSize.Y;
+	field->SpacingX = GridSpacing.X / CHRONO_SCALE;
+	field->SpacingZ = GridSpacing.Y / CHRONO_SCALE;
+	field->HeightScale = GridSpacing.Z / CHRONO_SCALE;
+	field->Origin = FVECTOR_TO_CHRONO_VEC(GridOrigin);
+	this->heightfield = field;
+}
+
+void UChBody_HeightfieldComponent::PhysicsObjectBuildGeometry()
+{
+	if (!this->ChData || !this->heightfield) {
+		return;
+	}
+
+	auto model = this->ChData->GetCollisionModel();
+	model->ClearModel();
+	if (auto heightfieldModel = std::dynamic_pointer_cast<FChHeightfieldModel>(model)) {
+		heightfieldModel->AddHeightfield(this->heightfield);
+	}
+	else {
+		AddGridTriangles();
+	}
+	model->BuildModel();
+}
+
+void UChBody_HeightfieldComponent::AddGridTriangles()
+{
+	auto model = std::dynamic_pointer_cast<chrono::collision::ChCollisionModelParallel>(this->ChData->GetCollisionModel());
+	if (!model) {
+		return;
+	}
+	const FChHeightfield& field = *this->heightfield;
+	auto sample = [&field](int32 x, int32 z) {
+		return field.Origin + chrono::ChVector<>(x * field.SpacingX, field.GetSample(x, z), z * field.SpacingZ);
+	};
+	for (int32 z = 0; z < field.SizeZ - 1; z++) {
+		for (int32 x = 0; x < field.SizeX - 1; x++) {
+			chrono::ChVector<> a = sample(x, z);
+			chrono::ChVector<> b = sample(x + 1, z);
+			chrono::ChVector<> c = sample(x, z + 1);
+			chrono::ChVector<> d = sample(x + 1, z + 1);
+			model->AddTriangle(a, c, b);
+			model->AddTriangle(b, c, d);
+		}
+	}
+}
@@ -7,6 +7,9 @@
 #include "Engine/StaticMesh.h"
 #include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
 #include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "ChStaticMeshCollider.h"
+#include "ChShapeInstances.h"
+#include "chrono/collision/ChCCollisionModel.h"
 #include "util.h"
 
 void UChBody_SphereComponent::PhysicsObjectConstruct()
@@ -19,7 +22,22 @@ void UChBody_SphereComponent::PhysicsObjectConstruct()
 		auto sphereList = rootComp->GetStaticMesh()->BodySetup->AggGeom.SphereElems;
 		if (sphereList.Num()) {
 			auto sphere = sphereList[0];
-			this->ChData = std::make_shared<chrono::ChBodyEasySphere>(sphere.Radius / CHRONO_SCALE * scale.X, Density, isCollide, false);
+			radius = sphere.Radius / CHRONO_SCALE * scale.X;
+			bool bTuned = SelectCollisionEnvelope(FVector(radius * 2.0f));
+			if (bShareCollisionShape && !isForParallel) {
+				// Mass and inertia as ChBodyEasySphere has them, the shape comes from the shared template
+				this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
+				double mass = Density * (4.0 / 3.0) * PI * radius * radius * radius;
+				double inertia = 0.4 * mass * radius * radius;
+				this->ChData->SetMass(mass);
+				this->ChData->SetInertiaXX(chrono::ChVector<>(inertia, inertia, inertia));
+				float sphereRadius = radius;
+				InstanceCollisionShape(FChShapeInstances::MakeKey(TEXT("Sphere"), FVector(radius)), [sphereRadius](chrono::collision::ChCollisionModel& model) {
+					model.AddSphere(sphereRadius);
+				});
+				return;
+			}
+			this->ChData = std::make_shared<chrono::ChBodyEasySphere>(sphere.Radius / CHRONO_SCALE * scale.X, Density, isCollide, false, CHRONO_CONTACT_METHOD(isForSMC));
 			//this->ChData = std::make_shared<chrono::ChBodyEasyEllipsoid>(FVECTOR_TO_CHRONO_VEC(FVector(sphere.Radius * scale.X, sphere.Radius * scale.Y, sphere.Radius * scale.Z)), Density, isCollide, false);
 			if (isForParallel) {
 				this->ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
@@ -28,7 +46,24 @@ void UChBody_SphereComponent::PhysicsObjectConstruct()
 				this->ChData->GetCollisionModel()->BuildModel();
 				this->ChData->SetCollide(true);
 			}
+			else if (bTuned) {
+				// ChBodyEasySphere added its sphere with the default envelope already
+				auto model = this->ChData->GetCollisionModel();
+				model->ClearModel();
+				ApplyCollisionEnvelope(*model);
+				model->AddSphere(radius);
+				model->BuildModel();
+			}
 		}
 	}
 }
 
+bool UChBody_SphereComponent::GetColliderProxy(FChColliderProxy& outProxy) const
+{
+	if (radius <= 0.f) {
+		return false;
+	}
+	outProxy.Type = FChColliderProxy::Sphere;
+	outProxy.Extent = FVector(radius);
+	return true;
+}
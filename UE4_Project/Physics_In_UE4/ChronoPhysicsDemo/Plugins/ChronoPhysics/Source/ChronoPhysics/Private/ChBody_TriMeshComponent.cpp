@@ -4,12 +4,18 @@
 #include "ChBody_TriMeshComponent.h"
 #include "chrono/physics/ChBody.h"
 #include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono/collision/ChCConvexDecomposition.h"
 #include "Components/StaticMeshComponent.h"
 #include "Engine/StaticMesh.h"
 #include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
 #include "Math/Box.h"
+#include "Engine/World.h"
 #include "chrono_parallel/collision/ChCollisionModelParallel.h"
 #include "Interfaces/Interface_CollisionDataProvider.h"
+#include "ChShapeCache.h"
+#include "ChStaticMeshCollider.h"
+#include "ChDeformableMeshModel.h"
+#include "ChBatchConvert.h"
 #include "util.h"
 
 void UChBody_TriMeshComponent::PhysicsObjectConstruct()
@@ -17,26 +23,33 @@ void UChBody_TriMeshComponent::PhysicsObjectConstruct()
 	Super::PhysicsObjectConstruct();
 
 	auto rootComp = Cast<UStaticMeshComponent>(this->GetOwner()->GetRootComponent());
-	auto scale = rootComp->RelativeScale3D;
 	if (rootComp) {
+		auto scale = rootComp->RelativeScale3D;
 		auto staticMesh = rootComp->GetStaticMesh();
-		FTriMeshCollisionData* triMeshData = new FTriMeshCollisionData();
-		if (staticMesh->GetPhysicsTriMeshData(triMeshData, true)) {
-			this->triMesh = std::make_shared<chrono::geometry::ChTriangleMeshConnected>();
-			this->ChData = std::make_shared<chrono::ChBody>();
-			for (auto index : triMeshData->Indices) {
-				auto vtx0 = chrono::ChVector<>(triMeshData->Vertices[index.v0].X * scale.X / CHRONO_SCALE, triMeshData->Vertices[index.v0].Z * scale.Z / CHRONO_SCALE, triMeshData->Vertices[index.v0].Y * scale.Y / CHRONO_SCALE);
-				auto vtx1 = chrono::ChVector<>(triMeshData->Vertices[index.v1].X * scale.X / CHRONO_SCALE, triMeshData->Vertices[index.v1].Z * scale.Z / CHRONO_SCALE, triMeshData->Vertices[index.v1].Y * scale.Y / CHRONO_SCALE);
-				auto vtx2 = chrono::ChVector<>(triMeshData->Vertices[index.v2].X * scale.X / CHRONO_SCALE, triMeshData->Vertices[index.v2].Z * scale.Z / CHRONO_SCALE, triMeshData->Vertices[index.v2].Y * scale.Y / CHRONO_SCALE);
-				this->triMesh->addTriangle(vtx0, vtx1, vtx2);
-			}
-			this->triMesh->RepairDuplicateVertexes();
-			if (isForParallel) {
-				ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
-			}
-			this->ChData->GetCollisionModel()->ClearModel();
-			this->ChData->GetCollisionModel()->AddTriangleMesh(this->triMesh, isFixed, false);
-			this->ChData->GetCollisionModel()->BuildModel();
+		this->bLoadedFromCache = false;
+		this->bHullsFromCache = false;
+		this->bHullsToSave = false;
+		this->hullPointList.Reset();
+		this->staticBVH.reset();
+		this->triMesh = std::make_shared<chrono::geometry::ChTriangleMeshConnected>();
+		if (ShouldDecompose()) {
+			// The parameters are part of the key, changing them decomposes again
+			FString kind = FString::Printf(TEXT("HACD|%d|%d|%f"), MaxHullCount, MaxHullVertices, Concavity);
+			this->hullCacheKey = FChShapeCache::MakeKey(staticMesh, scale, *kind);
+			this->bHullsFromCache = FChShapeCache::LoadHulls(this->hullCacheKey, this->hullPointList) && this->hullPointList.Num() > 0;
+		}
+		if (bUseShapeCache && !this->bHullsFromCache) {
+			this->shapeCacheKey = FChShapeCache::MakeKey(staticMesh, scale, TEXT("TriMesh"));
+			this->bLoadedFromCache = FChShapeCache::LoadTriMesh(this->shapeCacheKey, *this->triMesh);
+		}
+
+		FTriMeshCollisionData triMeshData;
+		if (this->bHullsFromCache || this->bLoadedFromCache || staticMesh->GetPhysicsTriMeshData(&triMeshData, true)) {
+			this->ChData = std::make_shared<chrono::ChBody>(CHRONO_CONTACT_METHOD(isForSMC));
+
+			meshVertices = MoveTemp(triMeshData.Vertices);
+			meshIndices = MoveTemp(triMeshData.Indices);
+			meshScale = scale / CHRONO_SCALE;
 
 			auto volume = rootComp->GetStaticMesh()->BodySetup->AggGeom.GetVolume(scale);
 			double mass = volume / CHRONO_SCALE / CHRONO_SCALE / CHRONO_SCALE * Density;
@@ -45,7 +58,218 @@ void UChBody_TriMeshComponent::PhysicsObjectConstruct()
 			FVector size = box.GetExtent() / CHRONO_SCALE;
 			FVector internia = 1.0 / 12.0 * mass * FVector(pow(size.Y, 2) + pow(size.Z, 2), pow(size.X, 2) + pow(size.Z, 2), pow(size.X, 2) + pow(size.Y, 2));
 			this->ChData->SetInertiaXX(chrono::ChVector<>(internia.X, internia.Z, internia.Y));
+
+			proxyGeom = rootComp->GetStaticMesh()->BodySetup->AggGeom;
+			proxyBounds = box;
+			SelectCollisionEnvelope(box.GetSize() * scale / CHRONO_SCALE);
+			bUsingCollisionProxy = false;
+		}
+	}
+}
+
+void UChBody_TriMeshComponent::PhysicsObjectBuildGeometry()
+{
+	if (!this->ChData || (!bHullsFromCache && !bLoadedFromCache && meshIndices.Num() == 0)) {
+		return;
+	}
+
+	if (!bHullsFromCache && !bLoadedFromCache) {
+		// Fill the indexed arrays directly, shared vertices stay shared so no weld is needed
+		ChBatchConvert::ToChrono(meshVertices, meshScale, this->triMesh->getCoordsVertices());
+		ChBatchConvert::Faces(meshIndices, this->triMesh->getIndicesVertexes());
+		if (bUseShapeCache) {
+			FChShapeCache::SaveTriMesh(shapeCacheKey, *this->triMesh);
+		}
+	}
+	if (ShouldDecompose() && !bHullsFromCache) {
+		DecomposeMesh();
+	}
+
+	if (isForParallel) {
+		ChData->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+	}
+	else if (IsDeformable()) {
+		auto model = std::make_shared<FChDeformableMeshModel>();
+		model->SetRebuildThreshold(RebuildThreshold);
+		ChData->SetCollisionModel(model);
+	}
+	BuildCollisionModel(false);
+
+	if (bUseStaticMeshCollider && isFixed && !isForParallel && !IsDeformable()) {
+		staticBVH = std::make_shared<FChStaticMeshBVH>();
+		staticBVH->Build(this->triMesh->getCoordsVertices(), this->triMesh->getIndicesVertexes());
+	}
+
+	meshVertices.Empty();
+	meshIndices.Empty();
+}
+
+void UChBody_TriMeshComponent::LatchPhysicsInput()
+{
+	Super::LatchPhysicsInput();
+
+	if (bDeformPending && this->isInitialized) {
+		bDeformPending = false;
+		auto model = std::dynamic_pointer_cast<FChDeformableMeshModel>(this->ChData->GetCollisionModel());
+		auto& vertices = this->triMesh->getCoordsVertices();
+		if (model && deformedVertices.Num() == (int32)vertices.size()) {
+			// The connected mesh follows too, so a collision LOD switch comes back to the deformed shape
+			ChBatchConvert::ToChrono(deformedVertices, meshScale, vertices);
+			if (!bUsingCollisionProxy) {
+				model->Refit(vertices);
+			}
+		}
+		else {
+			UE_LOG(LogTemp, Warning, TEXT("%s: deformed vertices need bDeformable and %d vertices"), *GetOwner()->GetName(), (int32)vertices.size());
+		}
+	}
+
+	// The parallel backend can't remove shapes after the first step, and fixed bodies don't join the narrowphase alone
+	if (!bUseCollisionLOD || !this->isInitialized || isForParallel || isFixed || !GetWorld()) {
+		return;
+	}
+
+	auto& views = GetWorld()->ViewLocationsRenderedLastFrame;
+	if (views.Num() == 0) {
+		return;
+	}
+	FVector location = GetOwner()->GetActorLocation();
+	float distanceSquared = MAX_flt;
+	for (auto& view : views) {
+		distanceSquared = FMath::Min(distanceSquared, FVector::DistSquared(view, location));
+	}
+	float threshold = bUsingCollisionProxy ? CollisionLODDistance * (1.f - CollisionLODHysteresis) : CollisionLODDistance;
+	bool bProxy = distanceSquared > FMath::Square(threshold);
+	if (bProxy == bUsingCollisionProxy) {
+		return;
+	}
+
+	// Leaving and joining the collision system again is the only way to replace the Bullet object
+	bool bCollide = this->ChData->GetCollide();
+	this->ChData->SetCollide(false);
+	BuildCollisionModel(bProxy);
+	if (this->CollisionFamily >= 0 && this->NoCollisionWithFamiliy.Num() > 0) {
+		this->ChData->GetCollisionModel()->SetFamily(this->CollisionFamily);
+		for (int noCollide : this->NoCollisionWithFamiliy) {
+			this->ChData->GetCollisionModel()->SetFamilyMaskNoCollisionWithFamily(noCollide);
 		}
 	}
+	this->ChData->SetCollide(bCollide);
 }
 
+void UChBody_TriMeshComponent::BuildCollisionModel(bool bProxy)
+{
+	this->ChData->GetCollisionModel()->ClearModel();
+	ApplyCollisionEnvelope(*this->ChData->GetCollisionModel());
+	if (bProxy) {
+		AddCollisionProxy();
+	}
+	else if (hullPointList.Num()) {
+		std::vector<chrono::ChVector<double>> points;
+		for (auto& hull : hullPointList) {
+			points.resize(hull.Num());
+			for (int32 i = 0; i < hull.Num(); i++) {
+				points[i] = chrono::ChVector<double>(hull[i].X, hull[i].Y, hull[i].Z);
+			}
+			this->ChData->GetCollisionModel()->AddConvexHull(points);
+		}
+	}
+	else if (auto deformableModel = std::dynamic_pointer_cast<FChDeformableMeshModel>(this->ChData->GetCollisionModel())) {
+		deformableModel->AddDeformableMesh(this->triMesh->getCoordsVertices(), this->triMesh->getIndicesVertexes(), DeformationMargin / CHRONO_SCALE, isFixed);
+	}
+	else {
+		this->ChData->GetCollisionModel()->AddTriangleMesh(this->triMesh, isFixed, false);
+	}
+	this->ChData->GetCollisionModel()->BuildModel();
+	bUsingCollisionProxy = bProxy;
+}
+
+void UChBody_TriMeshComponent::DecomposeMesh()
+{
+	// Runs on the geometry build task, the mesh is already in Chrono units
+	chrono::collision::ChConvexDecompositionHACDv2 decomposition;
+	decomposition.SetParameters(FMath::Max(MaxHullCount, 1), FMath::Max(MaxHullCount, 1), FMath::Clamp(MaxHullVertices, 4, 256), Concavity);
+	decomposition.AddTriangleMesh(*this->triMesh);
+	int hullCount = decomposition.ComputeConvexDecomposition();
+
+	hullPointList.Reset(hullCount);
+	std::vector<chrono::ChVector<double>> points;
+	for (int i = 0; i < hullCount; i++) {
+		points.clear();
+		if (!decomposition.GetConvexHullResult(i, points) || points.size() < 4) {
+			continue;
+		}
+		auto& hull = hullPointList[hullPointList.AddDefaulted()];
+		hull.Reserve(points.size());
+		for (auto& point : points) {
+			hull.Add(FVector(point.x(), point.y(), point.z()));
+		}
+	}
+
+	if (hullPointList.Num() == 0) {
+		// Open or badly wound meshes give nothing, colliding as the triangle mesh still works
+		UE_LOG(LogTemp, Warning, TEXT("%s: convex decomposition gave no hulls, using the triangle mesh"), *GetOwner()->GetName());
+		return;
+	}
+	bHullsToSave = true;
+}
+
+void UChBody_TriMeshComponent::PhysicsObjectInitalize()
+{
+	// After the parallel build, so bodies sharing a mesh don't write its hulls from several tasks
+	if (bHullsToSave) {
+		FChShapeCache::SaveHulls(hullCacheKey, hullPointList);
+		bHullsToSave = false;
+	}
+	Super::PhysicsObjectInitalize();
+}
+
+void UChBody_TriMeshComponent::AddCollisionProxy()
+{
+	auto model = this->ChData->GetCollisionModel();
+	FVector scale = meshScale * CHRONO_SCALE;
+
+	for (auto& box : proxyGeom.BoxElems) {
+		FVector center = box.Center * scale;
+		FQuat rotation = box.Rotation.Quaternion();
+		model->AddBox(box.X * meshScale.X * 0.5f, box.Z * meshScale.Z * 0.5f, box.Y * meshScale.Y * 0.5f, FVECTOR_TO_CHRONO_VEC(center), chrono::ChMatrix33<>(FQUAT_TO_CHRONO_QUAT(rotation)));
+	}
+	for (auto& sphere : proxyGeom.SphereElems) {
+		FVector center = sphere.Center * scale;
+		model->AddSphere(sphere.Radius * meshScale.X, FVECTOR_TO_CHRONO_VEC(center));
+	}
+	for (auto& sphyl : proxyGeom.SphylElems) {
+		// Both capsules run along the up axis
+		FVector center = sphyl.Center * scale;
+		FQuat rotation = sphyl.Rotation.Quaternion();
+		model->AddCapsule(sphyl.Radius * meshScale.X, sphyl.Length * meshScale.Z * 0.5f, FVECTOR_TO_CHRONO_VEC(center), chrono::ChMatrix33<>(FQUAT_TO_CHRONO_QUAT(rotation)));
+	}
+	for (auto& convex : proxyGeom.ConvexElems) {
+		FTransform transform = convex.GetTransform();
+		std::vector<chrono::ChVector<double>> points;
+		points.reserve(convex.VertexData.Num());
+		for (auto& vertex : convex.VertexData) {
+			FVector point = transform.TransformPosition(vertex) * scale;
+			points.push_back(FVECTOR_TO_CHRONO_VEC(point));
+		}
+		model->AddConvexHull(points);
+	}
+
+	if (proxyGeom.GetElementCount() == 0) {
+		FVector center = proxyBounds.GetCenter() * scale;
+		FVector extent = proxyBounds.GetExtent() * meshScale;
+		model->AddBox(extent.X, extent.Z, extent.Y, FVECTOR_TO_CHRONO_VEC(center));
+	}
+}
+
+void UChBody_TriMeshComponent::SetDeformedVertices(const TArray<FVector>& Vertices)
+{
+	deformedVertices = Vertices;
+	bDeformPending = true;
+}
+
+int UChBody_TriMeshComponent::GetTreeRebuildCount() const
+{
+	auto model = this->ChData ? std::dynamic_pointer_cast<FChDeformableMeshModel>(this->ChData->GetCollisionModel()) : nullptr;
+	return model ? model->GetRebuildCount() : 0;
+}
@@ -0,0 +1,80 @@
+#include "ChBreakableLinks.h"
+#include "chrono/physics/ChLink.h"
+#include "util.h"
+
+int32 FChBreakableLinks::Add(std::shared_ptr<chrono::ChLink> link, double breakForce, double breakTorque)
+{
+	check(link);
+	int32 slot;
+	if (freeSlots.Num()) {
+		slot = freeSlots.Pop(false);
+	}
+	else {
+		slot = links.AddDefaulted();
+		forceLimits.AddUninitialized();
+		torqueLimits.AddUninitialized();
+		forces.AddUninitialized();
+		torques.AddUninitialized();
+	}
+	links[slot] = link;
+	forceLimits[slot] = breakForce > 0 ? (float)(breakForce * breakForce) : FLT_MAX;
+	torqueLimits[slot] = breakTorque > 0 ? (float)(breakTorque * breakTorque) : FLT_MAX;
+	linkNum++;
+	return slot;
+}
+
+void FChBreakableLinks::Remove(int32 slot)
+{
+	if (!links.IsValidIndex(slot) || !links[slot]) {
+		return;
+	}
+	links[slot].reset();
+	forceLimits[slot] = FLT_MAX;
+	torqueLimits[slot] = FLT_MAX;
+	freeSlots.Add(slot);
+	linkNum--;
+}
+
+int32 FChBreakableLinks::Check(double time)
+{
+	int32 num = links.Num();
+	// Broken, disabled and free slots read as no reaction
+	for (int32 i = 0; i < num; i++) {
+		chrono::ChLink* link = links[i].get();
+		if (link && link->IsActive()) {
+			forces[i] = (float)link->Get_react_force().Length2();
+			torques[i] = (float)link->Get_react_torque().Length2();
+		}
+		else {
+			forces[i] = 0.f;
+			torques[i] = 0.f;
+		}
+	}
+
+	int32 broken = 0;
+	const float* forceData = forces.GetData();
+	const float* torqueData = torques.GetData();
+	const float* forceLimitData = forceLimits.GetData();
+	const float* torqueLimitData = torqueLimits.GetData();
+	for (int32 i = 0; i < num; i++) {
+		broken += (forceData[i] > forceLimitData[i]) | (torqueData[i] > torqueLimitData[i]);
+	}
+	if (broken == 0) {
+		return 0;
+	}
+
+	for (int32 i = 0; i < num; i++) {
+		if (forceData[i] > forceLimitData[i] || torqueData[i] > torqueLimitData[i]) {
+			chrono::ChLink* link = links[i].get();
+			breaks.Add({ i, time, CHRONO_VEC_TO_FVECTOR(link->Get_react_force()) / CHRONO_SCALE, CHRONO_VEC_TO_FVECTOR(link->Get_react_torque()) / CHRONO_SCALE });
+			link->SetBroken(true);
+		}
+	}
+	return broken;
+}
+
+void FChBreakableLinks::DrainBreaks(TArray<FBreak>& outBreaks)
+{
+	outBreaks.Append(breaks);
+	breaks.Reset();
+}
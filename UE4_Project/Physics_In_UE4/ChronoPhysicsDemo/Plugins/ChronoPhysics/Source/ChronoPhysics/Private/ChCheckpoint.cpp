@@ -0,0 +1,332 @@
+#include "ChCheckpoint.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/timestepper/ChState.h"
+#include "Async/Async.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include <typeinfo>
+
+namespace {
+	const uint32 CheckpointMagic = 0x50434843; // CHCP
+	const uint32 CheckpointVersion = 1;
+
+	enum class ECheckpointCompression : uint32 {
+		None,
+		LZ4,
+		Zlib
+	};
+
+	// 40 bytes, the payload after it starts 8 byte aligned
+	struct FCheckpointHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 Compression;
+		uint32 Pad;
+		int64 RawSize;
+		int64 StoredSize;
+		double Time;
+	};
+
+	struct FCheckpointCounts
+	{
+		int32 NcoordsX;
+		int32 NcoordsV;
+		int32 Nconstr;
+		int32 BodyCount;
+		int32 ClassCount;
+		int32 Pad;
+	};
+
+	int64 Align8(int64 offset)
+	{
+		return (offset + 7) & ~(int64)7;
+	}
+
+	template<typename T>
+	void AppendValue(TArray<uint8>& buffer, const T& value)
+	{
+		buffer.Append(reinterpret_cast<const uint8*>(&value), sizeof(T));
+	}
+
+	void AppendBlock(TArray<uint8>& buffer, const double* values, int32 count)
+	{
+		buffer.Append(reinterpret_cast<const uint8*>(values), count * sizeof(double));
+	}
+
+	// A block of count T at offset, null when it runs past the payload
+	template<typename T>
+	const T* ReadBlock(const uint8* data, int64 size, int64& offset, int32 count)
+	{
+		if (count < 0 || offset + (int64)count * sizeof(T) > size) {
+			return nullptr;
+		}
+		const T* block = reinterpret_cast<const T*>(data + offset);
+		offset += (int64)count * sizeof(T);
+		return block;
+	}
+}
+
+static_assert(sizeof(FCheckpointHeader) == 40, "FCheckpointHeader is stored as is");
+static_assert(sizeof(FChCheckpointBody) == 112, "FChCheckpointBody is stored as is");
+
+FChCheckpoint::~FChCheckpoint()
+{
+	Close();
+}
+
+void FChCheckpoint::Capture(chrono::ChSystem* system)
+{
+	Close();
+
+	chrono::ChState stateX(system->GetNcoords_x(), system);
+	chrono::ChStateDelta stateV(system->GetNcoords_v(), system);
+	chrono::ChStateDelta stateA(system->GetNcoords_v(), system);
+	chrono::ChVectorDynamic<double> stateL(system->GetNconstr());
+	system->StateGather(stateX, stateV, time);
+	system->StateGatherAcceleration(stateA);
+	system->StateGatherReactions(stateL);
+
+	// Class names once, the bodies refer to them by index
+	const auto& bodyList = system->Get_bodylist();
+	TArray<FString> names;
+	TArray<uint32> bodyClasses;
+	bodyClasses.Reserve(bodyList.size());
+	for (const auto& body : bodyList) {
+		FString name(ANSI_TO_TCHAR(typeid(*body).name()));
+		bodyClasses.Add((uint32)names.AddUnique(name));
+	}
+
+	payload.Reset();
+	FCheckpointCounts counts = { stateX.GetRows(), stateV.GetRows(), stateL.GetRows(), (int32)bodyList.size(), names.Num(), 0 };
+	AppendValue(payload, counts);
+	for (const FString& name : names) {
+		FTCHARToUTF8 utf8(*name);
+		AppendValue(payload, utf8.Length());
+		payload.Append(reinterpret_cast<const uint8*>(utf8.Get()), utf8.Length());
+	}
+	payload.AddZeroed(Align8(payload.Num()) - payload.Num());
+
+	payload.Reserve(payload.Num() + bodyList.size() * sizeof(FChCheckpointBody)
+		+ (counts.NcoordsX + 2 * counts.NcoordsV + counts.Nconstr) * sizeof(double));
+	for (int32 i = 0; i < (int32)bodyList.size(); i++) {
+		const auto& body = bodyList[i];
+		const chrono::ChVector<>& pos = body->GetPos();
+		const chrono::ChQuaternion<>& rot = body->GetRot();
+		const chrono::ChVector<>& vel = body->GetPos_dt();
+		const chrono::ChVector<>& wvel = body->GetWvel_loc();
+		FChCheckpointBody record = {
+			{ pos.x(), pos.y(), pos.z() },
+			{ rot.e0(), rot.e1(), rot.e2(), rot.e3() },
+			{ vel.x(), vel.y(), vel.z() },
+			{ wvel.x(), wvel.y(), wvel.z() },
+			bodyClasses[i],
+			(body->GetBodyFixed() ? (uint32)EChCheckpointBodyFlags::Fixed : 0u)
+			| (body->GetSleeping() ? (uint32)EChCheckpointBodyFlags::Sleeping : 0u)
+			| (body->GetCollide() ? (uint32)EChCheckpointBodyFlags::Collide : 0u)
+		};
+		AppendValue(payload, record);
+	}
+	AppendBlock(payload, stateX.GetAddress(), counts.NcoordsX);
+	AppendBlock(payload, stateV.GetAddress(), counts.NcoordsV);
+	AppendBlock(payload, stateA.GetAddress(), counts.NcoordsV);
+	AppendBlock(payload, stateL.GetAddress(), counts.Nconstr);
+
+	ParsePayload(payload.GetData(), payload.Num());
+}
+
+TFuture<bool> FChCheckpoint::SaveAsync(const FString& filePath, bool bCompress)
+{
+	double checkpointTime = time;
+	return Async(EAsyncExecution::ThreadPool, [raw = payload, filePath, bCompress, checkpointTime]() {
+		FCheckpointHeader header = { CheckpointMagic, CheckpointVersion, (uint32)ECheckpointCompression::None, 0, raw.Num(), raw.Num(), checkpointTime };
+		TArray<uint8> compressed;
+		if (bCompress) {
+			// LZ4 is a format plugin on some engine builds, zlib is always there
+			const FName methods[] = { FName(TEXT("LZ4")), NAME_Zlib };
+			const ECheckpointCompression methodIds[] = { ECheckpointCompression::LZ4, ECheckpointCompression::Zlib };
+			for (int32 m = 0; m < 2; m++) {
+				int32 compressedSize = FCompression::CompressMemoryBound(methods[m], raw.Num());
+				compressed.SetNumUninitialized(compressedSize, false);
+				if (FCompression::CompressMemory(methods[m], compressed.GetData(), compressedSize, raw.GetData(), raw.Num())) {
+					header.Compression = (uint32)methodIds[m];
+					header.StoredSize = compressedSize;
+					break;
+				}
+			}
+		}
+
+		IFileHandle* file = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*filePath);
+		if (!file) {
+			return false;
+		}
+		const uint8* stored = header.Compression == (uint32)ECheckpointCompression::None ? raw.GetData() : compressed.GetData();
+		bool bWritten = file->Write(reinterpret_cast<const uint8*>(&header), sizeof(header)) && file->Write(stored, header.StoredSize);
+		delete file;
+		return bWritten;
+	});
+}
+
+bool FChCheckpoint::Load(const FString& filePath)
+{
+	Close();
+
+	TArray<uint8> loadedData;
+	const uint8* data = nullptr;
+	int64 dataSize = 0;
+	mappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filePath);
+	if (mappedFile) {
+		mappedRegion = mappedFile->MapRegion();
+	}
+	if (mappedRegion) {
+		data = mappedRegion->GetMappedPtr();
+		dataSize = mappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(loadedData, *filePath, FILEREAD_Silent)) {
+		data = loadedData.GetData();
+		dataSize = loadedData.Num();
+	}
+	else {
+		Close();
+		return false;
+	}
+
+	FCheckpointHeader header;
+	if (dataSize < (int64)sizeof(header)) {
+		Close();
+		return false;
+	}
+	FMemory::Memcpy(&header, data, sizeof(header));
+	if (header.Magic != CheckpointMagic || header.Version != CheckpointVersion
+		|| header.StoredSize < 0 || header.RawSize < 0 || header.RawSize > MAX_int32 || (int64)sizeof(header) + header.StoredSize > dataSize) {
+		Close();
+		return false;
+	}
+	time = header.Time;
+	const uint8* stored = data + sizeof(header);
+
+	bool bParsed = false;
+	if (header.Compression == (uint32)ECheckpointCompression::None) {
+		// Read in place, the mapping stays open until Close
+		if (!mappedRegion) {
+			payload.Append(stored, header.StoredSize);
+			stored = payload.GetData();
+		}
+		bParsed = ParsePayload(stored, header.StoredSize);
+	}
+	else {
+		FName method = header.Compression == (uint32)ECheckpointCompression::LZ4 ? FName(TEXT("LZ4")) : NAME_Zlib;
+		payload.SetNumUninitialized(header.RawSize);
+		bParsed = FCompression::UncompressMemory(method, payload.GetData(), header.RawSize, stored, header.StoredSize)
+			&& ParsePayload(payload.GetData(), payload.Num());
+		// Nothing points into the file anymore
+		delete mappedRegion;
+		mappedRegion = nullptr;
+		delete mappedFile;
+		mappedFile = nullptr;
+	}
+
+	if (!bParsed) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool FChCheckpoint::ParsePayload(const uint8* data, int64 size)
+{
+	int64 offset = 0;
+	const FCheckpointCounts* counts = ReadBlock<FCheckpointCounts>(data, size, offset, 1);
+	if (!counts || counts->ClassCount < 0) {
+		return false;
+	}
+
+	classNames.Reset(counts->ClassCount);
+	for (int32 c = 0; c < counts->ClassCount; c++) {
+		const int32* nameLength = ReadBlock<int32>(data, size, offset, 1);
+		const ANSICHAR* name = nameLength ? ReadBlock<ANSICHAR>(data, size, offset, *nameLength) : nullptr;
+		if (!name) {
+			return false;
+		}
+		FUTF8ToTCHAR converted(name, *nameLength);
+		classNames.Add(FString(converted.Length(), converted.Get()));
+	}
+	offset = Align8(offset);
+
+	bodies = ReadBlock<FChCheckpointBody>(data, size, offset, counts->BodyCount);
+	x = ReadBlock<double>(data, size, offset, counts->NcoordsX);
+	v = ReadBlock<double>(data, size, offset, counts->NcoordsV);
+	a = ReadBlock<double>(data, size, offset, counts->NcoordsV);
+	L = ReadBlock<double>(data, size, offset, counts->Nconstr);
+	if (!bodies || !x || !v || !a || !L || offset != size) {
+		return false;
+	}
+	for (int32 i = 0; i < counts->BodyCount; i++) {
+		if (bodies[i].ClassIndex >= (uint32)counts->ClassCount) {
+			return false;
+		}
+	}
+
+	ncoordsX = counts->NcoordsX;
+	ncoordsV = counts->NcoordsV;
+	nconstr = counts->Nconstr;
+	bodyCount = counts->BodyCount;
+	return true;
+}
+
+bool FChCheckpoint::Apply(chrono::ChSystem* system) const
+{
+	const auto& bodyList = system->Get_bodylist();
+	if (!bodies || (int32)bodyList.size() != bodyCount
+		|| system->GetNcoords_x() != ncoordsX || system->GetNcoords_v() != ncoordsV || system->GetNconstr() != nconstr) {
+		return false;
+	}
+	for (int32 i = 0; i < bodyCount; i++) {
+		if (classNames[bodies[i].ClassIndex] != ANSI_TO_TCHAR(typeid(*bodyList[i]).name())) {
+			return false;
+		}
+	}
+
+	for (int32 i = 0; i < bodyCount; i++) {
+		const auto& body = bodyList[i];
+		body->SetBodyFixed((bodies[i].Flags & EChCheckpointBodyFlags::Fixed) != 0);
+		body->SetCollide((bodies[i].Flags & EChCheckpointBodyFlags::Collide) != 0);
+		body->SetSleeping((bodies[i].Flags & EChCheckpointBodyFlags::Sleeping) != 0);
+	}
+
+	// The blocks may sit in a read only mapping, Chrono scatters from its own vectors
+	chrono::ChState stateX(ncoordsX, system);
+	chrono::ChStateDelta stateV(ncoordsV, system);
+	chrono::ChStateDelta stateA(ncoordsV, system);
+	chrono::ChVectorDynamic<double> stateL(nconstr);
+	FMemory::Memcpy(stateX.GetAddress(), x, ncoordsX * sizeof(double));
+	FMemory::Memcpy(stateV.GetAddress(), v, ncoordsV * sizeof(double));
+	FMemory::Memcpy(stateA.GetAddress(), a, ncoordsV * sizeof(double));
+	FMemory::Memcpy(stateL.GetAddress(), L, nconstr * sizeof(double));
+	system->StateScatter(stateX, stateV, time);
+	system->StateScatterAcceleration(stateA);
+	system->StateScatterReactions(stateL);
+	return true;
+}
+
+void FChCheckpoint::Close()
+{
+	delete mappedRegion;
+	mappedRegion = nullptr;
+	delete mappedFile;
+	mappedFile = nullptr;
+	payload.Empty();
+
+	ncoordsX = 0;
+	ncoordsV = 0;
+	nconstr = 0;
+	bodyCount = 0;
+	classNames.Empty();
+	bodies = nullptr;
+	x = nullptr;
+	v = nullptr;
+	a = nullptr;
+	L = nullptr;
+}
@@ -0,0 +1,52 @@
+#include "ChCollisionEnvelope.h"
+#include <atomic>
+
+namespace {
+	// Written once per system initialization, read by the geometry builds running in parallel after it
+	FChEnvelopeTuning envelopeTuning;
+	std::atomic<int32> tunedNum(0);
+	// Micrometers, so the sum stays an integer
+	std::atomic<int64> envelopeSum(0);
+}
+
+void FChCollisionEnvelope::SetTuning(const FChEnvelopeTuning& tuning)
+{
+	envelopeTuning = tuning;
+	tunedNum = 0;
+	envelopeSum = 0;
+}
+
+bool FChCollisionEnvelope::IsEnabled()
+{
+	return envelopeTuning.bEnabled;
+}
+
+bool FChCollisionEnvelope::Select(const FVector& size, float maxSpeed, double& outEnvelope, double& outMargin)
+{
+	double smallest = size.GetAbs().GetMin();
+	if (!envelopeTuning.bEnabled || smallest <= 0.0) {
+		return false;
+	}
+
+	// Contacts have to be found one step before the surfaces meet, but beyond half the body's size the
+	// envelope only adds pairs that never touch
+	double travel = FMath::Clamp(maxSpeed, 0.f, envelopeTuning.SpeedLimit) * envelopeTuning.StepLength;
+	double envelope = envelopeTuning.SizeFraction * smallest + travel;
+	outEnvelope = FMath::Clamp(envelope, (double)envelopeTuning.MinEnvelope, FMath::Max(0.5 * smallest, (double)envelopeTuning.MinEnvelope));
+	outMargin = envelopeTuning.MarginFraction * smallest;
+
+	tunedNum++;
+	envelopeSum += (int64)(outEnvelope * 1e6);
+	return true;
+}
+
+int32 FChCollisionEnvelope::GetTunedNum()
+{
+	return tunedNum;
+}
+
+double FChCollisionEnvelope::GetMeanEnvelope()
+{
+	int32 num = tunedNum;
+	return num ? envelopeSum / (double)num * 1e-6 : 0.0;
+}
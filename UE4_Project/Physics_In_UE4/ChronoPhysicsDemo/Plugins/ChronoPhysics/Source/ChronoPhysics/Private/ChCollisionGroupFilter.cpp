@@ -0,0 +1,35 @@
+#include "ChCollisionGroupFilter.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+
+namespace {
+	FORCEINLINE int GetCollisionGroup(const btBroadphaseProxy* proxy)
+	{
+		auto* object = static_cast<const btCollisionObject*>(proxy->m_clientObject);
+		auto* model = object ? static_cast<chrono::collision::ChModelBullet*>(object->getUserPointer()) : nullptr;
+		chrono::ChPhysicsItem* item = model ? model->GetPhysicsItem() : nullptr;
+		return item ? item->GetIdentifier() : 0;
+	}
+}
+
+bool FChCollisionGroupFilter::needBroadphaseCollision(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const
+{
+	// Bullet's own family test, which the filter replaces
+	if (!(proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) || !(proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask)) {
+		return false;
+	}
+	int group = GetCollisionGroup(proxy0);
+	return group == 0 || group != GetCollisionGroup(proxy1);
+}
+
+bool FChCollisionGroupFilter::Install(chrono::ChSystem* system)
+{
+	auto bulletSystem = system ? std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(system->GetCollisionSystem()) : nullptr;
+	if (!bulletSystem) {
+		return false;
+	}
+	bulletSystem->GetBulletCollisionWorld()->getPairCache()->setOverlapFilterCallback(this);
+	return true;
+}
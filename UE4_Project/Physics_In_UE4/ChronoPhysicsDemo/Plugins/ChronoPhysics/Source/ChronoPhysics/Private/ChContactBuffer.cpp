@@ -0,0 +1,152 @@
+#include "ChContactBuffer.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChContactContainer.h"
+#include "ChPackedContactContainerSMC.h"
+#include "ChBatchConvert.h"
+#include "util.h"
+
+namespace {
+	class FillContactBufferCallback : public chrono::ChContactContainer::ReportContactCallback
+	{
+	public:
+		FillContactBufferCallback(FChContactBuffer& inBuffer) : buffer(inBuffer) {}
+
+		virtual bool OnReportContact(const chrono::ChVector<>& pA,
+			const chrono::ChVector<>& pB,
+			const chrono::ChMatrix33<>& plane_coord,
+			const double& distance,
+			const double& eff_Radius,
+			const chrono::ChVector<>& react_forces,
+			const chrono::ChVector<>& react_torques,
+			chrono::ChContactable* modA,
+			chrono::ChContactable* modB) override {
+
+			auto pos = (pA + pB) * 0.5;
+			auto normal = plane_coord.Get_A_Xaxis();
+			auto force = plane_coord * react_forces;
+			buffer.Positions.Add(CHRONO_VEC_TO_FVECTOR(pos));
+			buffer.Normals.Add(FVector(normal.x(), normal.z(), normal.y()));
+			buffer.Forces.Add(FVector(force.x(), force.z(), force.y()));
+			buffer.ItemsA.Add(modA ? modA->GetPhysicsItem() : nullptr);
+			buffer.ItemsB.Add(modB ? modB->GetPhysicsItem() : nullptr);
+			return true;  // to continue scanning contacts
+		}
+
+	private:
+		FChContactBuffer& buffer;
+	};
+
+	int GetItemFamily(chrono::ChPhysicsItem* item)
+	{
+		auto body = dynamic_cast<chrono::ChBody*>(item);
+		return body && body->GetCollisionModel() ? body->GetCollisionModel()->GetFamily() : -1;
+	}
+}
+
+void FChContactBuffer::Refill(chrono::ChSystem* system)
+{
+	// Reset keeps the allocations from the previous step
+	Positions.Reset();
+	Normals.Reset();
+	Forces.Reset();
+	ItemsA.Reset();
+	ItemsB.Reset();
+
+	FillContactBufferCallback callback(*this);
+	auto packed = std::dynamic_pointer_cast<FChPackedContactContainerSMC>(system->GetContactContainer());
+	if (!packed) {
+		system->GetContactContainer()->ReportAllContacts(&callback);
+		return;
+	}
+
+	// The base container's contacts one by one, the packed ones straight from their columns
+	packed->ChContactContainerSMC::ReportAllContacts(&callback);
+	FChContactBatch batch = packed->GetContactBatch();
+	if (batch.Num == 0 || !batch.Force[0]) {
+		return;
+	}
+	int32 offset = Num();
+	int32 total = offset + batch.Num;
+	Positions.SetNumUninitialized(total, false);
+	Normals.SetNumUninitialized(total, false);
+	Forces.SetNumUninitialized(total, false);
+	ItemsA.SetNumUninitialized(total, false);
+	ItemsB.SetNumUninitialized(total, false);
+	ChBatchConvert::ForChunks(batch.Num, [&](int32 begin, int32 end) {
+		for (int32 i = begin; i < end; i++) {
+			int32 slot = offset + i;
+			Positions[slot] = FVector((batch.PointA[0][i] + batch.PointB[0][i]) * 0.5, (batch.PointA[2][i] + batch.PointB[2][i]) * 0.5,
+				(batch.PointA[1][i] + batch.PointB[1][i]) * 0.5) * CHRONO_SCALE;
+			Normals[slot] = FVector(batch.Normal[0][i], batch.Normal[2][i], batch.Normal[1][i]);
+			Forces[slot] = FVector(batch.Force[0][i], batch.Force[2][i], batch.Force[1][i]);
+			ItemsA[slot] = batch.Bodies[batch.BodyA[i]];
+			ItemsB[slot] = batch.Bodies[batch.BodyB[i]];
+		}
+	});
+}
+
+void FChContactBuffer::Empty()
+{
+	Positions.Empty();
+	Normals.Empty();
+	Forces.Empty();
+	ItemsA.Empty();
+	ItemsB.Empty();
+}
+
+int32 FChContactBuffer::QueryItem(const chrono::ChPhysicsItem* item, TArray<FVector>& outPositions, TArray<FVector>& outNormals, TArray<FVector>& outForces) const
+{
+	outPositions.Reset();
+	outNormals.Reset();
+	outForces.Reset();
+
+	for (int32 i = 0; i < Num(); i++) {
+		if (ItemsB[i] == item) {
+			outPositions.Add(Positions[i]);
+			outNormals.Add(Normals[i]);
+			outForces.Add(Forces[i]);
+		}
+		else if (ItemsA[i] == item) {
+			outPositions.Add(Positions[i]);
+			outNormals.Add(-Normals[i]);
+			outForces.Add(-Forces[i]);
+		}
+	}
+	return outPositions.Num();
+}
+
+int32 FChContactBuffer::QueryFamily(int family, TArray<FVector>& outPositions, TArray<FVector>& outNormals, TArray<FVector>& outForces) const
+{
+	outPositions.Reset();
+	outNormals.Reset();
+	outForces.Reset();
+
+	for (int32 i = 0; i < Num(); i++) {
+		if (GetItemFamily(ItemsB[i]) == family) {
+			outPositions.Add(Positions[i]);
+			outNormals.Add(Normals[i]);
+			outForces.Add(Forces[i]);
+		}
+		else if (GetItemFamily(ItemsA[i]) == family) {
+			outPositions.Add(Positions[i]);
+			outNormals.Add(-Normals[i]);
+			outForces.Add(-Forces[i]);
+		}
+	}
+	return outPositions.Num();
+}
+
+FVector FChContactBuffer::SumItemForce(const chrono::ChPhysicsItem* item) const
+{
+	FVector sum = FVector::ZeroVector;
+	for (int32 i = 0; i < Num(); i++) {
+		if (ItemsB[i] == item) {
+			sum += Forces[i];
+		}
+		else if (ItemsA[i] == item) {
+			sum -= Forces[i];
+		}
+	}
+	return sum;
+}
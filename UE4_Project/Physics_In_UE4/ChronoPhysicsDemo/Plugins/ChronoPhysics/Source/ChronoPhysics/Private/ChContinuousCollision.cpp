@@ -0,0 +1,106 @@
+#include "ChContinuousCollision.h"
+#include "ChStaticMeshCollider.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+
+namespace {
+	FORCEINLINE btVector3 ToBullet(const chrono::ChVector<>& v)
+	{
+		return btVector3((btScalar)v.x(), (btScalar)v.y(), (btScalar)v.z());
+	}
+
+	// Closest hit that isn't the swept body itself, with the body's own family filter
+	struct FSweepCallback : public btCollisionWorld::ClosestConvexResultCallback
+	{
+		const btCollisionObject* self;
+
+		FSweepCallback(const btVector3& from, const btVector3& to, const btCollisionObject* inSelf)
+			: ClosestConvexResultCallback(from, to)
+			, self(inSelf)
+		{
+			if (self->getBroadphaseHandle()) {
+				m_collisionFilterGroup = self->getBroadphaseHandle()->m_collisionFilterGroup;
+				m_collisionFilterMask = self->getBroadphaseHandle()->m_collisionFilterMask;
+			}
+		}
+
+		virtual bool needsCollision(btBroadphaseProxy* proxy) const override
+		{
+			return proxy->m_clientObject != self && ClosestConvexResultCallback::needsCollision(proxy);
+		}
+	};
+}
+
+void FChContinuousCollision::Add(std::shared_ptr<chrono::ChBody> body, double radius, double motionThreshold)
+{
+	if (!body || radius <= 0 || Contains(body.get())) {
+		return;
+	}
+	bodies.Add({ body, radius, FMath::Max(motionThreshold, 0.0) });
+}
+
+void FChContinuousCollision::Remove(chrono::ChBody* body)
+{
+	bodies.RemoveAllSwap([body](const FSweptBody& swept) { return swept.Body.get() == body; });
+}
+
+bool FChContinuousCollision::Contains(chrono::ChBody* body) const
+{
+	return bodies.ContainsByPredicate([body](const FSweptBody& swept) { return swept.Body.get() == body; });
+}
+
+int32 FChContinuousCollision::Advance(chrono::ChSystem* system, double stepSize)
+{
+	auto bulletSystem = std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(system->GetCollisionSystem());
+	if (!bulletSystem || bodies.Num() == 0) {
+		return 0;
+	}
+	btCollisionWorld* world = bulletSystem->GetBulletCollisionWorld();
+
+	int32 advanced = 0;
+	for (auto& swept : bodies) {
+		chrono::ChBody* body = swept.Body.get();
+		if (!body->GetCollide() || body->GetBodyFixed() || body->GetSleeping()) {
+			continue;
+		}
+		chrono::ChVector<> motion = body->GetPos_dt() * stepSize;
+		double distance = motion.Length();
+		if (distance <= swept.MotionThreshold * swept.Radius) {
+			continue;
+		}
+		auto model = std::dynamic_pointer_cast<chrono::collision::ChModelBullet>(body->GetCollisionModel());
+		if (!model || !model->GetBulletModel()) {
+			continue;
+		}
+
+		chrono::ChVector<> start = body->GetPos();
+		btTransform from(btQuaternion::getIdentity(), ToBullet(start));
+		btTransform to(btQuaternion::getIdentity(), ToBullet(start + motion));
+		btSphereShape sphere((btScalar)swept.Radius);
+		FSweepCallback callback(from.getOrigin(), to.getOrigin(), model->GetBulletModel());
+		world->convexSweepTest(&sphere, from, to, callback);
+		double fraction = callback.hasHit() ? callback.m_closestHitFraction : 1.0;
+		double meshFraction;
+		if (staticColliders && staticColliders->SweepSphere(start, motion, swept.Radius, meshFraction)) {
+			fraction = FMath::Min(fraction, meshFraction);
+		}
+		// Touching at the start is already a contact of this step
+		if (fraction >= 1 || fraction <= 0) {
+			continue;
+		}
+
+		// Stop inside the envelope so the contact is generated, but not past the surface
+		double skin = FMath::Max((double)model->GetEnvelope() * 0.5, 0.0);
+		double travel = fraction * distance - skin;
+		if (travel <= 0) {
+			continue;
+		}
+		body->SetPos(start + motion * (travel / distance));
+		advanced++;
+	}
+	return advanced;
+}
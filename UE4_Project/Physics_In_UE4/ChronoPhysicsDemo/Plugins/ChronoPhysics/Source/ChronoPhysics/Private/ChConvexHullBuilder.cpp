@@ -0,0 +1,379 @@
+#include "ChConvexHullBuilder.h"
+#include "Async/ParallelFor.h"
+#include <cfloat>
+
+namespace {
+	// Below this many sets a single loop beats the task overhead
+	const int32 ParallelSetCount = 8;
+
+	struct FHullVec
+	{
+		double X, Y, Z;
+
+		FORCEINLINE FHullVec operator-(const FHullVec& b) const { return { X - b.X, Y - b.Y, Z - b.Z }; }
+		FORCEINLINE FHullVec operator+(const FHullVec& b) const { return { X + b.X, Y + b.Y, Z + b.Z }; }
+		FORCEINLINE FHullVec operator*(double s) const { return { X * s, Y * s, Z * s }; }
+		FORCEINLINE double Dot(const FHullVec& b) const { return X * b.X + Y * b.Y + Z * b.Z; }
+		FORCEINLINE FHullVec Cross(const FHullVec& b) const { return { Y * b.Z - Z * b.Y, Z * b.X - X * b.Z, X * b.Y - Y * b.X }; }
+	};
+
+	struct FHullFace
+	{
+		int32 V[3];
+		// Neighbour across the edge V[i] -> V[i + 1]
+		int32 N[3];
+		FHullVec Normal;
+		double Offset;
+		// Head of the outside set, linked through FHullScratch::NextOutside
+		int32 Outside;
+		// Pass that found the face visible
+		int32 Visit;
+		bool bAlive;
+
+		FORCEINLINE double Distance(const FHullVec& p) const { return Normal.Dot(p) - Offset; }
+		FORCEINLINE int32 EdgeFrom(int32 vertex) const { return V[0] == vertex ? 0 : (V[1] == vertex ? 1 : 2); }
+	};
+
+	struct FHorizonEdge
+	{
+		int32 A, B;
+		// Face left in place on the other side, and its index of the edge B -> A
+		int32 Outer, OuterEdge;
+	};
+
+	struct FHorizonFrame
+	{
+		int32 Face, Edge, Left;
+	};
+
+	// Reset, never shrunk, between hulls
+	struct FHullScratch
+	{
+		TArray<FHullVec> Points;
+		TArray<int32> NextOutside;
+		TArray<FHullFace> Faces;
+		TArray<int32> Pending;
+		TArray<int32> Visible;
+		TArray<FHorizonEdge> Horizon;
+		TArray<FHorizonFrame> Stack;
+		TArray<int32> Orphans;
+		TArray<int32> VertexMap;
+		FHullVec Interior;
+		double Tolerance;
+		int32 Pass;
+
+		bool Build(TArrayView<const FVector> points, FChConvexHull& outHull);
+
+	private:
+		bool BuildSimplex();
+		int32 AddFace(int32 a, int32 b, int32 c);
+		void AssignOutside(int32 point, int32 firstFace, int32 lastFace);
+		bool AddPoint(int32 face);
+		void WriteHull(FChConvexHull& outHull);
+	};
+
+	thread_local FHullScratch* threadScratch = nullptr;
+
+	FHullScratch& GetScratch()
+	{
+		// Kept for the thread's lifetime, like the trace rings
+		if (!threadScratch) {
+			threadScratch = new FHullScratch();
+		}
+		return *threadScratch;
+	}
+
+	int32 FHullScratch::AddFace(int32 a, int32 b, int32 c)
+	{
+		FHullFace& face = Faces.AddDefaulted_GetRef();
+		face.V[0] = a;
+		face.V[1] = b;
+		face.V[2] = c;
+		face.N[0] = face.N[1] = face.N[2] = INDEX_NONE;
+		FHullVec normal = (Points[b] - Points[a]).Cross(Points[c] - Points[a]);
+		double length = FMath::Sqrt(normal.Dot(normal));
+		face.Normal = length > 0 ? normal * (1.0 / length) : FHullVec{ 0, 0, 0 };
+		face.Offset = face.Normal.Dot(Points[a]);
+		face.Outside = INDEX_NONE;
+		face.Visit = 0;
+		face.bAlive = true;
+		return Faces.Num() - 1;
+	}
+
+	void FHullScratch::AssignOutside(int32 point, int32 firstFace, int32 lastFace)
+	{
+		int32 best = INDEX_NONE;
+		double bestDistance = Tolerance;
+		for (int32 f = firstFace; f < lastFace; f++) {
+			double distance = Faces[f].Distance(Points[point]);
+			if (distance > bestDistance) {
+				best = f;
+				bestDistance = distance;
+			}
+		}
+		// Inside the hull so far, never a vertex
+		if (best == INDEX_NONE) {
+			return;
+		}
+		if (Faces[best].Outside == INDEX_NONE) {
+			Pending.Add(best);
+		}
+		NextOutside[point] = Faces[best].Outside;
+		Faces[best].Outside = point;
+	}
+
+	bool FHullScratch::BuildSimplex()
+	{
+		const int32 num = Points.Num();
+		int32 extremes[6] = { 0, 0, 0, 0, 0, 0 };
+		double extent = 0;
+		for (int32 i = 0; i < num; i++) {
+			const FHullVec& p = Points[i];
+			const double* c = &p.X;
+			for (int32 axis = 0; axis < 3; axis++) {
+				if (c[axis] < (&Points[extremes[axis * 2]].X)[axis]) {
+					extremes[axis * 2] = i;
+				}
+				if (c[axis] > (&Points[extremes[axis * 2 + 1]].X)[axis]) {
+					extremes[axis * 2 + 1] = i;
+				}
+			}
+		}
+		for (int32 axis = 0; axis < 3; axis++) {
+			extent += FMath::Max(FMath::Abs((&Points[extremes[axis * 2]].X)[axis]), FMath::Abs((&Points[extremes[axis * 2 + 1]].X)[axis]));
+		}
+		Tolerance = 3 * DBL_EPSILON * extent;
+
+		// Farthest pair of extremes, then the point farthest from their line and the one farthest from that plane
+		int32 v0 = 0, v1 = 0;
+		double best = -1;
+		for (int32 i = 0; i < 6; i++) {
+			for (int32 j = i + 1; j < 6; j++) {
+				FHullVec d = Points[extremes[j]] - Points[extremes[i]];
+				if (d.Dot(d) > best) {
+					best = d.Dot(d);
+					v0 = extremes[i];
+					v1 = extremes[j];
+				}
+			}
+		}
+		if (FMath::Sqrt(best) <= Tolerance) {
+			return false;
+		}
+
+		const FHullVec axis = Points[v1] - Points[v0];
+		int32 v2 = INDEX_NONE;
+		best = 0;
+		for (int32 i = 0; i < num; i++) {
+			FHullVec c = axis.Cross(Points[i] - Points[v0]);
+			if (c.Dot(c) > best) {
+				best = c.Dot(c);
+				v2 = i;
+			}
+		}
+		if (v2 == INDEX_NONE || FMath::Sqrt(best) / FMath::Sqrt(axis.Dot(axis)) <= Tolerance) {
+			return false;
+		}
+
+		FHullVec normal = axis.Cross(Points[v2] - Points[v0]);
+		normal = normal * (1.0 / FMath::Sqrt(normal.Dot(normal)));
+		int32 v3 = INDEX_NONE;
+		best = Tolerance;
+		for (int32 i = 0; i < num; i++) {
+			double distance = FMath::Abs(normal.Dot(Points[i] - Points[v0]));
+			if (distance > best) {
+				best = distance;
+				v3 = i;
+			}
+		}
+		if (v3 == INDEX_NONE) {
+			return false;
+		}
+
+		const int32 corners[4] = { v0, v1, v2, v3 };
+		Interior = (Points[v0] + Points[v1] + Points[v2] + Points[v3]) * 0.25;
+		static const int32 faceCorners[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 1, 3, 2 }, { 2, 3, 0 } };
+		for (int32 f = 0; f < 4; f++) {
+			int32 a = corners[faceCorners[f][0]], b = corners[faceCorners[f][1]], c = corners[faceCorners[f][2]];
+			int32 face = AddFace(a, b, c);
+			if (Faces[face].Distance(Interior) > 0) {
+				Faces.Pop(false);
+				AddFace(a, c, b);
+			}
+		}
+		// Every edge A -> B of one face is B -> A of another
+		for (int32 f = 0; f < 4; f++) {
+			for (int32 e = 0; e < 3; e++) {
+				int32 a = Faces[f].V[e], b = Faces[f].V[(e + 1) % 3];
+				for (int32 g = 0; g < 4; g++) {
+					for (int32 k = 0; k < 3; k++) {
+						if (g != f && Faces[g].V[k] == b && Faces[g].V[(k + 1) % 3] == a) {
+							Faces[f].N[e] = g;
+						}
+					}
+				}
+			}
+		}
+
+		for (int32 i = 0; i < num; i++) {
+			if (i != v0 && i != v1 && i != v2 && i != v3) {
+				AssignOutside(i, 0, 4);
+			}
+		}
+		return true;
+	}
+
+	bool FHullScratch::AddPoint(int32 face)
+	{
+		// The farthest point of the set becomes the new vertex
+		int32 eye = INDEX_NONE;
+		double best = -1;
+		for (int32 p = Faces[face].Outside; p != INDEX_NONE; p = NextOutside[p]) {
+			double distance = Faces[face].Distance(Points[p]);
+			if (distance > best) {
+				best = distance;
+				eye = p;
+			}
+		}
+		const FHullVec& eyePoint = Points[eye];
+
+		// Depth first over the faces the eye sees, the horizon comes out as one loop in edge order
+		Pass++;
+		Visible.Reset();
+		Horizon.Reset();
+		Stack.Reset();
+		Faces[face].Visit = Pass;
+		Visible.Add(face);
+		Stack.Add({ face, 0, 3 });
+		while (Stack.Num()) {
+			FHorizonFrame& top = Stack.Last();
+			if (top.Left == 0) {
+				Stack.Pop(false);
+				continue;
+			}
+			const int32 current = top.Face;
+			const int32 edge = top.Edge;
+			top.Edge = (edge + 1) % 3;
+			top.Left--;
+
+			const int32 a = Faces[current].V[edge], b = Faces[current].V[(edge + 1) % 3];
+			const int32 neighbour = Faces[current].N[edge];
+			FHullFace& other = Faces[neighbour];
+			if (other.Visit == Pass) {
+				continue;
+			}
+			const int32 back = other.EdgeFrom(b);
+			if (other.Distance(eyePoint) > Tolerance) {
+				other.Visit = Pass;
+				Visible.Add(neighbour);
+				Stack.Add({ neighbour, (back + 1) % 3, 2 });
+			}
+			else {
+				Horizon.Add({ a, b, neighbour, back });
+			}
+		}
+		for (int32 i = 0; i < Horizon.Num(); i++) {
+			if (Horizon[i].B != Horizon[(i + 1) % Horizon.Num()].A) {
+				return false;
+			}
+		}
+
+		// Cone of new faces from the horizon to the eye
+		Orphans.Reset();
+		for (int32 v : Visible) {
+			Faces[v].bAlive = false;
+			for (int32 p = Faces[v].Outside; p != INDEX_NONE; p = NextOutside[p]) {
+				if (p != eye) {
+					Orphans.Add(p);
+				}
+			}
+			Faces[v].Outside = INDEX_NONE;
+		}
+		const int32 first = Faces.Num();
+		const int32 count = Horizon.Num();
+		for (int32 i = 0; i < count; i++) {
+			const FHorizonEdge edge = Horizon[i];
+			int32 created = AddFace(edge.A, edge.B, eye);
+			Faces[created].N[0] = edge.Outer;
+			Faces[created].N[1] = first + (i + 1) % count;
+			Faces[created].N[2] = first + (i + count - 1) % count;
+			Faces[edge.Outer].N[edge.OuterEdge] = created;
+		}
+		for (int32 p : Orphans) {
+			AssignOutside(p, first, first + count);
+		}
+		return true;
+	}
+
+	void FHullScratch::WriteHull(FChConvexHull& outHull)
+	{
+		outHull.Points.Reset();
+		outHull.Triangles.Reset();
+		double volume = 0;
+		FHullVec centroid = { 0, 0, 0 };
+		for (const FHullFace& face : Faces) {
+			if (!face.bAlive) {
+				continue;
+			}
+			for (int32 v : face.V) {
+				int32& index = VertexMap[v];
+				if (index == INDEX_NONE) {
+					index = outHull.Points.Add(FVector((float)Points[v].X, (float)Points[v].Y, (float)Points[v].Z));
+				}
+				outHull.Triangles.Add(index);
+			}
+			// Tetrahedron from the interior point, positive for outward faces
+			const FHullVec a = Points[face.V[0]] - Interior, b = Points[face.V[1]] - Interior, c = Points[face.V[2]] - Interior;
+			const double tetra = a.Dot(b.Cross(c)) / 6;
+			volume += tetra;
+			centroid = centroid + (a + b + c) * (tetra / 4);
+		}
+		const FHullVec center = volume > 0 ? Interior + centroid * (1.0 / volume) : Interior;
+		outHull.Volume = (float)volume;
+		outHull.Centroid = FVector((float)center.X, (float)center.Y, (float)center.Z);
+		outHull.bValid = true;
+	}
+
+	bool FHullScratch::Build(TArrayView<const FVector> points, FChConvexHull& outHull)
+	{
+		Points.Reset();
+		Faces.Reset();
+		Pending.Reset();
+		Pass = 0;
+		for (const FVector& p : points) {
+			Points.Add({ p.X, p.Y, p.Z });
+		}
+		NextOutside.SetNumUninitialized(Points.Num(), false);
+
+		bool bBuilt = Points.Num() >= 4 && BuildSimplex();
+		while (bBuilt && Pending.Num()) {
+			int32 face = Pending.Pop(false);
+			if (Faces[face].bAlive && Faces[face].Outside != INDEX_NONE) {
+				bBuilt = AddPoint(face);
+			}
+		}
+		if (!bBuilt) {
+			outHull = FChConvexHull();
+			outHull.Points = TArray<FVector>(points.GetData(), points.Num());
+			return false;
+		}
+
+		VertexMap.Reset();
+		VertexMap.Init(INDEX_NONE, Points.Num());
+		WriteHull(outHull);
+		return true;
+	}
+}
+
+bool FChConvexHullBuilder::BuildHull(TArrayView<const FVector> points, FChConvexHull& outHull)
+{
+	return GetScratch().Build(points, outHull);
+}
+
+void FChConvexHullBuilder::BuildHulls(TArrayView<const TArray<FVector>> pointSets, TArray<FChConvexHull>& outHulls)
+{
+	outHulls.SetNum(pointSets.Num());
+	ParallelFor(pointSets.Num(), [&](int32 i) {
+		GetScratch().Build(pointSets[i], outHulls[i]);
+	}, pointSets.Num() < ParallelSetCount);
+}
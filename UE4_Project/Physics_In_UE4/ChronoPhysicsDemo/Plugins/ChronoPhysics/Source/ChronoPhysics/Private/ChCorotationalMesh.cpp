@@ -0,0 +1,166 @@
+#include "ChCorotationalMesh.h"
+#include "Async/ParallelFor.h"
+#include "chrono/fea/ChPolarDecomposition.h"
+
+#ifndef WITH_CHRONO_CUDA
+#define WITH_CHRONO_CUDA 0
+#endif
+
+#if WITH_CHRONO_CUDA
+#include <vector_types.h>
+#include <vector_functions.h>
+#include "chrono_parallel/math/matrixf.cuh"
+#include "chrono_parallel/math/svd.h"
+#endif
+
+namespace {
+	// Matrices per task, enough that a task outweighs its scheduling
+	const int32 RotationChunk = 256;
+
+#if WITH_CHRONO_CUDA
+	// Newton steps of the polar decomposition, R = (R + R^-T) / 2, take the float SVD's rotation back to
+	// orthonormal in double; each step squares the error
+	const int32 OrthonormalizeSteps = 2;
+
+	void Orthonormalize(double* R)
+	{
+		for (int32 step = 0; step < OrthonormalizeSteps; step++) {
+			const double* c0 = R;
+			const double* c1 = R + 3;
+			const double* c2 = R + 6;
+			// Columns of the cofactor matrix, R^-T is it over the determinant
+			double cof[9] = {
+				c1[1] * c2[2] - c1[2] * c2[1], c1[2] * c2[0] - c1[0] * c2[2], c1[0] * c2[1] - c1[1] * c2[0],
+				c2[1] * c0[2] - c2[2] * c0[1], c2[2] * c0[0] - c2[0] * c0[2], c2[0] * c0[1] - c2[1] * c0[0],
+				c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0] };
+			double det = c0[0] * cof[0] + c0[1] * cof[1] + c0[2] * cof[2];
+			double half = 0.5 / det;
+			for (int32 k = 0; k < 9; k++) {
+				R[k] = 0.5 * R[k] + half * cof[k];
+			}
+		}
+	}
+#endif
+
+	void ComputeRotation(const double* F, double* outR, bool& outValid)
+	{
+#if WITH_CHRONO_CUDA
+		chrono::Mat33f A((float)F[0], (float)F[1], (float)F[2], (float)F[3], (float)F[4], (float)F[5], (float)F[6], (float)F[7], (float)F[8]);
+		chrono::Mat33f U, V;
+		float3 sigma;
+		chrono::SVD(A, U, sigma, V);
+		chrono::Mat33f R = chrono::MultTranspose(U, V);
+		outValid = true;
+		for (int32 k = 0; k < 9; k++) {
+			// Normalize of a zero column leaves NaNs
+			if (!FMath::IsFinite(R[k])) {
+				outValid = false;
+				return;
+			}
+		}
+		for (int32 k = 0; k < 9; k++) {
+			outR[k] = R[k];
+		}
+		Orthonormalize(outR);
+#else
+		chrono::ChMatrix33<> M, Q, S;
+		for (int32 c = 0; c < 3; c++) {
+			for (int32 r = 0; r < 3; r++) {
+				M(r, c) = F[c * 3 + r];
+			}
+		}
+		double det = chrono::fea::ChPolarDecomposition<>::Compute(M, Q, S, 1E-6);
+		if (det < 0) {
+			Q.MatrScale(-1.0);
+		}
+		outValid = true;
+		for (int32 c = 0; c < 3; c++) {
+			for (int32 r = 0; r < 3; r++) {
+				outR[c * 3 + r] = Q(r, c);
+			}
+		}
+#endif
+	}
+}
+
+void FChElementTetra4Batched::ComputeDeformationGradient(double* outF) const
+{
+	// F = [p_0 .. p_3] times the upper left block of mM, the row of ones drops out
+	for (int32 c = 0; c < 3; c++) {
+		for (int32 r = 0; r < 3; r++) {
+			double sum = 0;
+			for (int32 n = 0; n < 4; n++) {
+				sum += nodes[n]->pos[r] * mM(n, c);
+			}
+			outF[c * 3 + r] = sum;
+		}
+	}
+}
+
+void FChCorotationalMesh::ComputeRotations(const double* F, double* outR, bool* outValid, int32 num)
+{
+	ParallelFor(FMath::DivideAndRoundUp(num, RotationChunk), [&](int32 chunk) {
+		int32 end = FMath::Min(num, (chunk + 1) * RotationChunk);
+		for (int32 i = chunk * RotationChunk; i < end; i++) {
+			ComputeRotation(F + i * 9, outR + i * 9, outValid[i]);
+		}
+	});
+}
+
+void FChCorotationalMesh::SetupInitial()
+{
+	ChMesh::SetupInitial();
+	GatherBatchedElements();
+}
+
+void FChCorotationalMesh::GatherBatchedElements()
+{
+	for (FChElementTetra4Batched* element : batched) {
+		element->bBatched = false;
+	}
+	batched.Reset();
+	gatheredElementNum = (int32)GetNelements();
+	for (unsigned int i = 0; i < GetNelements(); i++) {
+		if (FChElementTetra4Batched* element = dynamic_cast<FChElementTetra4Batched*>(GetElement(i).get())) {
+			batched.Add(element);
+		}
+	}
+	gradients.SetNumUninitialized(batched.Num() * 9);
+	rotations.SetNumUninitialized(batched.Num() * 9);
+	valid.SetNumUninitialized(batched.Num());
+}
+
+void FChCorotationalMesh::Update(double m_time, bool update_assets)
+{
+	// Elements added or removed after setup
+	if (gatheredElementNum != (int32)GetNelements()) {
+		GatherBatchedElements();
+	}
+
+	const int32 num = batched.Num();
+	if (num > 0) {
+		ParallelFor(FMath::DivideAndRoundUp(num, RotationChunk), [&](int32 chunk) {
+			int32 end = FMath::Min(num, (chunk + 1) * RotationChunk);
+			for (int32 i = chunk * RotationChunk; i < end; i++) {
+				batched[i]->ComputeDeformationGradient(&gradients[i * 9]);
+			}
+		});
+		ComputeRotations(gradients.GetData(), rotations.GetData(), valid.GetData(), num);
+		for (int32 i = 0; i < num; i++) {
+			FChElementTetra4Batched* element = batched[i];
+			// Degenerate ones fall back to the element's own decomposition inside ChMesh::Update
+			element->bBatched = valid[i];
+			if (valid[i]) {
+				chrono::ChMatrix33<>& A = element->Rotation();
+				const double* R = &rotations[i * 9];
+				for (int32 c = 0; c < 3; c++) {
+					for (int32 r = 0; r < 3; r++) {
+						A(r, c) = R[c * 3 + r];
+					}
+				}
+			}
+		}
+	}
+
+	ChMesh::Update(m_time, update_assets);
+}
@@ -0,0 +1,87 @@
+#include "ChCosimChannel.h"
+#include "HAL/PlatformAtomics.h"
+#include "HAL/PlatformMisc.h"
+
+static const uint32 CosimRingMagic = 0x43485247; // CHRG
+
+bool FChCosimChannel::Open(const FString& name, bool bCreate, int32 recordBytes, int32 recordCapacity)
+{
+	Close();
+	if (recordBytes <= 0 || recordCapacity <= 0) {
+		return false;
+	}
+	// Keeps the slot sequence continuous when the counters wrap
+	recordCapacity = FMath::RoundUpToPowerOfTwo(recordCapacity);
+
+	SIZE_T size = sizeof(FRingHeader) + (SIZE_T)recordBytes * recordCapacity;
+	region = FPlatformMemory::MapNamedSharedMemoryRegion(name, bCreate, FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write, size);
+	if (!region) {
+		return false;
+	}
+
+	header = (FRingHeader*)region->GetAddress();
+	records = (uint8*)(header + 1);
+	if (bCreate) {
+		header->RecordBytes = recordBytes;
+		header->RecordCapacity = recordCapacity;
+		header->Pad = 0;
+		header->WriteIndex = 0;
+		header->ReadIndex = 0;
+		FPlatformMisc::MemoryBarrier();
+		header->Magic = CosimRingMagic;
+	}
+	else if (header->Magic != CosimRingMagic || header->RecordBytes != recordBytes || header->RecordCapacity != recordCapacity) {
+		// The other side built a different layout
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FChCosimChannel::Close()
+{
+	if (region) {
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(region);
+	}
+	region = nullptr;
+	header = nullptr;
+	records = nullptr;
+}
+
+bool FChCosimChannel::Push(const void* record)
+{
+	if (!header) {
+		return false;
+	}
+
+	int32 write = header->WriteIndex;
+	int32 read = FPlatformAtomics::AtomicRead(&header->ReadIndex);
+	if ((uint32)write - (uint32)read >= (uint32)header->RecordCapacity) {
+		return false;
+	}
+
+	FMemory::Memcpy(records + (SIZE_T)((uint32)write % (uint32)header->RecordCapacity) * header->RecordBytes, record, header->RecordBytes);
+	// The record has to be visible before the consumer sees the new index
+	FPlatformMisc::MemoryBarrier();
+	FPlatformAtomics::InterlockedExchange(&header->WriteIndex, (int32)((uint32)write + 1));
+	return true;
+}
+
+bool FChCosimChannel::Pop(void* record)
+{
+	if (!header) {
+		return false;
+	}
+
+	int32 read = header->ReadIndex;
+	int32 write = FPlatformAtomics::AtomicRead(&header->WriteIndex);
+	if (write == read) {
+		return false;
+	}
+
+	FPlatformMisc::MemoryBarrier();
+	FMemory::Memcpy(record, records + (SIZE_T)((uint32)read % (uint32)header->RecordCapacity) * header->RecordBytes, header->RecordBytes);
+	FPlatformMisc::MemoryBarrier();
+	FPlatformAtomics::InterlockedExchange(&header->ReadIndex, (int32)((uint32)read + 1));
+	return true;
+}
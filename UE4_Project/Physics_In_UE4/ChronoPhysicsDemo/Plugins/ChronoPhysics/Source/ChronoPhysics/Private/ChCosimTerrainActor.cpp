@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ChCosimTerrainActor.h"
+#include "ChBodyComponent.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChForce.h"
+
+namespace {
+	// World frame load, the force acts at the body's center
+	std::shared_ptr<chrono::ChForce> AddWorldLoad(chrono::ChBody* body, chrono::ChForce::ForceType mode)
+	{
+		auto load = std::make_shared<chrono::ChForce>();
+		load->SetMode(mode);
+		load->SetFrame(chrono::ChForce::BODY);
+		load->SetAlign(chrono::ChForce::WORLD_DIR);
+		body->AddForce(load);
+		load->SetVrelpoint(chrono::VNULL);
+		load->SetMforce(0);
+		return load;
+	}
+
+	void SetWorldLoad(chrono::ChForce& load, const double value[3])
+	{
+		chrono::ChVector<> vector(value[0], value[1], value[2]);
+		double magnitude = vector.Length();
+		if (magnitude > 0) {
+			load.SetDir(vector / magnitude);
+		}
+		load.SetMforce(magnitude);
+	}
+}
+
+AChCosimTerrainActor::AChCosimTerrainActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+}
+
+void AChCosimTerrainActor::PhysicsObjectInitalize()
+{
+	RemoveTerrainForces();
+	wheelBodies.Reset();
+	for (auto actor : WheelActors) {
+		auto comp = actor ? actor->FindComponentByClass<UChBodyComponent>() : nullptr;
+		auto body = comp ? comp->GetChData() : nullptr;
+		wheelBodies.Add(body);
+		terrainForces.Add(body ? AddWorldLoad(body.get(), chrono::ChForce::FORCE) : nullptr);
+		terrainForces.Add(body ? AddWorldLoad(body.get(), chrono::ChForce::TORQUE) : nullptr);
+	}
+	wheelForces.SetNumZeroed(wheelBodies.Num());
+	frame = 0;
+	lastForceFrame = 0;
+
+	stateChannel = MakeUnique<FChCosimChannel>();
+	forceChannel = MakeUnique<FChCosimChannel>();
+	if (!stateChannel->Open(SharedMemoryName + TEXT("_State"), bCreateChannels, sizeof(FChCosimWheelState), RingCapacity)
+		|| !forceChannel->Open(SharedMemoryName + TEXT("_Force"), bCreateChannels, sizeof(FChCosimWheelForce), RingCapacity)) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: can't open the co-simulation rings %s"), *GetName(), *SharedMemoryName);
+		stateChannel.Reset();
+		forceChannel.Reset();
+	}
+}
+
+void AChCosimTerrainActor::UpdatePhysicsState()
+{
+	if (!IsConnected()) {
+		return;
+	}
+
+	frame++;
+	SendWheelStates();
+	ReceiveWheelForces();
+
+	for (int32 i = 0; i < wheelBodies.Num(); i++) {
+		if (!wheelBodies[i]) {
+			continue;
+		}
+		auto& force = wheelForces[i];
+		SetWorldLoad(*terrainForces[2 * i], force.Force);
+		SetWorldLoad(*terrainForces[2 * i + 1], force.Torque);
+	}
+}
+
+void AChCosimTerrainActor::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	RemoveTerrainForces();
+}
+
+void AChCosimTerrainActor::RemoveTerrainForces()
+{
+	for (auto& load : terrainForces) {
+		if (load && load->GetBody()) {
+			load->GetBody()->RemoveForce(load);
+		}
+	}
+	terrainForces.Reset();
+}
+
+void AChCosimTerrainActor::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	if (IsConnected() && wheelBodies.Num() > 0) {
+		objList.Add(this);
+	}
+}
+
+void AChCosimTerrainActor::SendWheelStates()
+{
+	FChCosimWheelState state;
+	for (int32 i = 0; i < wheelBodies.Num(); i++) {
+		auto& body = wheelBodies[i];
+		if (!body) {
+			continue;
+		}
+		auto pos = body->GetPos();
+		auto rot = body->GetRot();
+		auto linVel = body->GetPos_dt();
+		auto angVel = body->GetWvel_par();
+		state.Time = body->GetChTime();
+		state.Index = i;
+		state.Frame = frame;
+		for (int k = 0; k < 3; k++) {
+			state.Pos[k] = pos[k];
+			state.LinVel[k] = linVel[k];
+			state.AngVel[k] = angVel[k];
+		}
+		for (int k = 0; k < 4; k++) {
+			state.Rot[k] = rot[k];
+		}
+		// A full ring means the terrain stopped reading, this substep is dropped
+		if (!stateChannel->Push(&state)) {
+			break;
+		}
+	}
+}
+
+void AChCosimTerrainActor::ReceiveWheelForces()
+{
+	int32 expected = 0;
+	for (auto& body : wheelBodies) {
+		expected += body ? 1 : 0;
+	}
+
+	double deadline = FPlatformTime::Seconds() + LockstepTimeoutMs * 0.001;
+	int32 received = 0;
+	FChCosimWheelForce force;
+	while (true) {
+		while (forceChannel->Pop(&force)) {
+			if (!wheelForces.IsValidIndex(force.Index)) {
+				continue;
+			}
+			wheelForces[force.Index] = force;
+			lastForceFrame = FMath::Max(lastForceFrame, force.Frame);
+			received += force.Frame == frame ? 1 : 0;
+		}
+		if (!bLockstep || received >= expected || FPlatformTime::Seconds() > deadline) {
+			break;
+		}
+		FPlatformProcess::Sleep(0.f);
+	}
+}
+
+void AChCosimTerrainActor::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void AChCosimTerrainActor::PostUnregisterAllComponents()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::PostUnregisterAllComponents();
+}
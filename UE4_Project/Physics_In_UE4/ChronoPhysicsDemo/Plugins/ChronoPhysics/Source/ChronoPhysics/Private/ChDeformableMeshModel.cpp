@@ -0,0 +1,369 @@
+#include "ChDeformableMeshModel.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "chrono/collision/gimpact/GIMPACT/Bullet/btGImpactShape.h"
+#include "Async/ParallelFor.h"
+
+namespace {
+	// Below this many nodes in a level the task overhead outweighs the work
+	const int32 ParallelNodeCount = 256;
+	// Vertices per task of the copy and bounds pass
+	const int32 VertexChunkSize = 4096;
+	// Same minimum leaf size as Bullet's own build, flat triangles still get a volume
+	const btScalar MinLeafHalfSize = btScalar(0.001);
+	// What btGImpactQuantizedBvh::buildSet pads its quantization bounds by
+	const btScalar GImpactBoundMargin = btScalar(1.0);
+
+	double GetBoxArea(const btVector3& min, const btVector3& max)
+	{
+		btVector3 size = max - min;
+		return 2.0 * (size.x() * size.y() + size.y() * size.z() + size.z() * size.x());
+	}
+}
+
+/**
+ * Quantized Bullet BVH that can be refit in parallel. Bullet lays the nodes out depth first with the left child
+ * right after its parent, so the levels collected after a build are enough to refit every level in one pass
+ */
+class FChRefitOptimizedBvh : public btOptimizedBvh
+{
+public:
+	void Build(btStridingMeshInterface* mesh, const btVector3& aabbMin, const btVector3& aabbMax)
+	{
+		// build() appends to these, a second build would keep the first one's entries
+		m_SubtreeHeaders.clear();
+		m_quantizedLeafNodes.clear();
+		m_quantizedContiguousNodes.clear();
+		build(mesh, true, aabbMin, aabbMax);
+		CollectLevels();
+	}
+
+	FORCEINLINE bool Contains(const btVector3& aabbMin, const btVector3& aabbMax) const
+	{
+		return aabbMin.x() >= m_bvhAabbMin.x() && aabbMin.y() >= m_bvhAabbMin.y() && aabbMin.z() >= m_bvhAabbMin.z() &&
+			aabbMax.x() <= m_bvhAabbMax.x() && aabbMax.y() <= m_bvhAabbMax.y() && aabbMax.z() <= m_bvhAabbMax.z();
+	}
+
+	// The whole mesh, from the root
+	void GetBounds(btVector3& outMin, btVector3& outMax) const
+	{
+		outMin = unQuantize(m_quantizedContiguousNodes[0].m_quantizedAabbMin);
+		outMax = unQuantize(m_quantizedContiguousNodes[0].m_quantizedAabbMax);
+	}
+
+	void Refit(const double* vertices, const int32* indices)
+	{
+		ParallelFor(leaves.Num(), [&](int32 i) {
+			btQuantizedBvhNode& node = m_quantizedContiguousNodes[leaves[i]];
+			const int32* face = indices + node.getTriangleIndex() * 3;
+			btVector3 aabbMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+			btVector3 aabbMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+			for (int32 k = 0; k < 3; k++) {
+				const double* vertex = vertices + face[k] * 3;
+				btVector3 point((btScalar)vertex[0], (btScalar)vertex[1], (btScalar)vertex[2]);
+				aabbMin.setMin(point);
+				aabbMax.setMax(point);
+			}
+			for (int32 axis = 0; axis < 3; axis++) {
+				if (aabbMax[axis] - aabbMin[axis] < 2 * MinLeafHalfSize) {
+					aabbMax[axis] += MinLeafHalfSize;
+					aabbMin[axis] -= MinLeafHalfSize;
+				}
+			}
+			quantizeWithClamp(node.m_quantizedAabbMin, aabbMin, 0);
+			quantizeWithClamp(node.m_quantizedAabbMax, aabbMax, 1);
+		}, leaves.Num() < ParallelNodeCount);
+
+		// Children sit one level deeper, or are leaves, so each level only reads finished nodes
+		for (int32 depth = levels.Num() - 1; depth >= 0; depth--) {
+			const TArray<int32>& level = levels[depth];
+			ParallelFor(level.Num(), [&](int32 i) {
+				int32 index = level[i];
+				btQuantizedBvhNode& node = m_quantizedContiguousNodes[index];
+				const btQuantizedBvhNode& left = m_quantizedContiguousNodes[index + 1];
+				const btQuantizedBvhNode& right = m_quantizedContiguousNodes[GetRightChild(index)];
+				for (int32 axis = 0; axis < 3; axis++) {
+					node.m_quantizedAabbMin[axis] = FMath::Min(left.m_quantizedAabbMin[axis], right.m_quantizedAabbMin[axis]);
+					node.m_quantizedAabbMax[axis] = FMath::Max(left.m_quantizedAabbMax[axis], right.m_quantizedAabbMax[axis]);
+				}
+			}, level.Num() < ParallelNodeCount);
+		}
+
+		// The cache friendly traversal culls with the subtree headers first
+		ParallelFor(m_SubtreeHeaders.size(), [&](int32 i) {
+			m_SubtreeHeaders[i].setAabbFromQuantizeNode(m_quantizedContiguousNodes[m_SubtreeHeaders[i].m_rootNodeIndex]);
+		}, m_SubtreeHeaders.size() < ParallelNodeCount);
+	}
+
+	// Summed area of the inner nodes, how much a query has to visit
+	double GetCost() const
+	{
+		double cost = 0;
+		for (const TArray<int32>& level : levels) {
+			for (int32 index : level) {
+				const btQuantizedBvhNode& node = m_quantizedContiguousNodes[index];
+				cost += GetBoxArea(unQuantize(node.m_quantizedAabbMin), unQuantize(node.m_quantizedAabbMax));
+			}
+		}
+		return cost;
+	}
+
+private:
+	FORCEINLINE int32 GetRightChild(int32 index) const
+	{
+		const btQuantizedBvhNode& left = m_quantizedContiguousNodes[index + 1];
+		return left.isLeafNode() ? index + 2 : index + 1 + left.getEscapeIndex();
+	}
+
+	void CollectLevels()
+	{
+		leaves.Reset();
+		levels.Reset();
+		if (m_curNodeIndex == 0) {
+			return;
+		}
+		TArray<TPair<int32, int32>> stack;
+		stack.Emplace(0, 0);
+		while (stack.Num()) {
+			TPair<int32, int32> entry = stack.Pop(false);
+			int32 index = entry.Key;
+			if (m_quantizedContiguousNodes[index].isLeafNode()) {
+				leaves.Add(index);
+				continue;
+			}
+			if (levels.Num() <= entry.Value) {
+				levels.SetNum(entry.Value + 1);
+			}
+			levels[entry.Value].Add(index);
+			stack.Emplace(index + 1, entry.Value + 1);
+			stack.Emplace(GetRightChild(index), entry.Value + 1);
+		}
+	}
+
+	TArray<int32> leaves;
+	// Inner nodes per depth
+	TArray<TArray<int32>> levels;
+};
+
+// Bounds straight from the tree, the base class would walk every triangle six times to find them
+class FChRefitTriangleMeshShape : public btBvhTriangleMeshShape
+{
+public:
+	FChRefitTriangleMeshShape(btStridingMeshInterface* mesh) : btBvhTriangleMeshShape(mesh, true, false) {}
+
+	void SetLocalBounds(const btVector3& aabbMin, const btVector3& aabbMax)
+	{
+		m_localAabbMin = aabbMin;
+		m_localAabbMax = aabbMax;
+	}
+};
+
+FChDeformableMeshModel::FChDeformableMeshModel()
+{
+}
+
+// The tree and the mesh interface are only complete types here
+FChDeformableMeshModel::~FChDeformableMeshModel()
+{
+}
+
+int FChDeformableMeshModel::ClearModel()
+{
+	int result = ChModelBullet::ClearModel();
+	shape.reset();
+	gimpactShape.reset();
+	tree.Reset();
+	meshInterface.Reset();
+	vertexData.Empty();
+	indexData.Empty();
+	return result;
+}
+
+bool FChDeformableMeshModel::AddDeformableMesh(const std::vector<chrono::ChVector<>>& vertices, const std::vector<chrono::ChVector<int>>& faces, double inGrowth, bool bStatic)
+{
+	if (vertices.empty() || faces.empty() || shapes.size() > 0) {
+		return false;
+	}
+	int32 vertexNum = (int32)vertices.size();
+	int32 faceNum = (int32)faces.size();
+	for (auto& face : faces) {
+		if (face.x() < 0 || face.y() < 0 || face.z() < 0 || face.x() >= vertexNum || face.y() >= vertexNum || face.z() >= vertexNum) {
+			return false;
+		}
+	}
+
+	vertexData.SetNumUninitialized(vertexNum * 3);
+	FMemory::Memcpy(vertexData.GetData(), vertices.data(), vertexData.Num() * sizeof(double));
+	indexData.SetNumUninitialized(faceNum * 3);
+	FMemory::Memcpy(indexData.GetData(), faces.data(), indexData.Num() * sizeof(int32));
+	growth = FMath::Max(inGrowth, 0.0);
+
+	// Doubles whatever precision Bullet was built with, the vertices are written without a conversion
+	btIndexedMesh part;
+	part.m_numTriangles = faceNum;
+	part.m_triangleIndexBase = (const unsigned char*)indexData.GetData();
+	part.m_triangleIndexStride = 3 * sizeof(int32);
+	part.m_numVertices = vertexNum;
+	part.m_vertexBase = (const unsigned char*)vertexData.GetData();
+	part.m_vertexStride = 3 * sizeof(double);
+	part.m_vertexType = PHY_DOUBLE;
+	meshInterface = MakeUnique<btTriangleIndexVertexArray>();
+	meshInterface->addIndexedMesh(part, PHY_INTEGER);
+	rebuildCount = 0;
+	refitCount = 0;
+
+	if (!bStatic) {
+		gimpactShape = std::shared_ptr<btGImpactMeshShape>(new btGImpactMeshShape(meshInterface.Get()));
+		gimpactShape->setMargin((btScalar)GetSuggestedFullMargin());
+		UpdateGImpact(true);
+		rebuildCount = 0;
+		shapes.push_back(gimpactShape);
+		bt_collision_object->setCollisionShape(gimpactShape.get());
+		return true;
+	}
+
+	// Through new like the other Bullet shapes, their operator new keeps the SIMD alignment
+	shape = std::shared_ptr<FChRefitTriangleMeshShape>(new FChRefitTriangleMeshShape(meshInterface.Get()));
+	tree = MakeUnique<FChRefitOptimizedBvh>();
+	shape->setOptimizedBvh(tree.Get());
+	shape->setMargin((btScalar)GetSuggestedFullMargin());
+	RebuildTree();
+	rebuildCount = 0;
+
+	shapes.push_back(shape);
+	bt_collision_object->setCollisionShape(shape.get());
+	return true;
+}
+
+bool FChDeformableMeshModel::Refit(const std::vector<chrono::ChVector<>>& vertices)
+{
+	if ((!tree && !gimpactShape) || (int32)vertices.size() * 3 != vertexData.Num()) {
+		return false;
+	}
+
+	// Copy and bounds in one pass, one partial box per chunk
+	int32 vertexNum = (int32)vertices.size();
+	int32 chunkNum = FMath::DivideAndRoundUp(vertexNum, VertexChunkSize);
+	TArray<btVector3, TInlineAllocator<16>> chunkMin;
+	TArray<btVector3, TInlineAllocator<16>> chunkMax;
+	chunkMin.SetNumUninitialized(chunkNum);
+	chunkMax.SetNumUninitialized(chunkNum);
+	ParallelFor(chunkNum, [&](int32 chunk) {
+		int32 begin = chunk * VertexChunkSize;
+		int32 end = FMath::Min(begin + VertexChunkSize, vertexNum);
+		btVector3 aabbMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+		btVector3 aabbMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+		double* out = vertexData.GetData() + begin * 3;
+		for (int32 i = begin; i < end; i++, out += 3) {
+			const chrono::ChVector<>& vertex = vertices[i];
+			out[0] = vertex.x();
+			out[1] = vertex.y();
+			out[2] = vertex.z();
+			btVector3 point((btScalar)vertex.x(), (btScalar)vertex.y(), (btScalar)vertex.z());
+			aabbMin.setMin(point);
+			aabbMax.setMax(point);
+		}
+		chunkMin[chunk] = aabbMin;
+		chunkMax[chunk] = aabbMax;
+	}, chunkNum == 1);
+	btVector3 aabbMin = chunkMin[0];
+	btVector3 aabbMax = chunkMax[0];
+	for (int32 chunk = 1; chunk < chunkNum; chunk++) {
+		aabbMin.setMin(chunkMin[chunk]);
+		aabbMax.setMax(chunkMax[chunk]);
+	}
+
+	if (gimpactShape) {
+		// GImpact clamps to its quantization bounds the same way, they are the triangle boxes padded by a unit
+		const btVector3 slack(GImpactBoundMargin, GImpactBoundMargin, GImpactBoundMargin);
+		const btVector3 boundsMin = gimpactMin - slack;
+		const btVector3 boundsMax = gimpactMax + slack;
+		const bool bInside = aabbMin.x() >= boundsMin.x() && aabbMin.y() >= boundsMin.y() && aabbMin.z() >= boundsMin.z() &&
+			aabbMax.x() <= boundsMax.x() && aabbMax.y() <= boundsMax.y() && aabbMax.z() <= boundsMax.z();
+		UpdateGImpact(!bInside);
+		return true;
+	}
+
+	// Clamped leaves past the quantization bounds would miss contacts
+	if (!tree->Contains(aabbMin, aabbMax)) {
+		RebuildTree();
+		return true;
+	}
+	tree->Refit(vertexData.GetData(), indexData.GetData());
+	refitCount++;
+	if (tree->GetCost() > builtCost * rebuildThreshold) {
+		RebuildTree();
+		return true;
+	}
+
+	btVector3 boundsMin, boundsMax;
+	tree->GetBounds(boundsMin, boundsMax);
+	shape->SetLocalBounds(boundsMin, boundsMax);
+	return true;
+}
+
+void FChDeformableMeshModel::RebuildTree()
+{
+	btVector3 aabbMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+	btVector3 aabbMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+	for (int32 i = 0; i < vertexData.Num(); i += 3) {
+		btVector3 point((btScalar)vertexData[i], (btScalar)vertexData[i + 1], (btScalar)vertexData[i + 2]);
+		aabbMin.setMin(point);
+		aabbMax.setMax(point);
+	}
+	btVector3 margin((btScalar)growth, (btScalar)growth, (btScalar)growth);
+	tree->Build(meshInterface.Get(), aabbMin - margin, aabbMax + margin);
+	builtCost = tree->GetCost();
+	rebuildCount++;
+
+	btVector3 boundsMin, boundsMax;
+	tree->GetBounds(boundsMin, boundsMax);
+	shape->SetLocalBounds(boundsMin, boundsMax);
+}
+
+void FChDeformableMeshModel::UpdateGImpact(bool bRebuild)
+{
+	if (bRebuild) {
+		for (int32 i = 0; i < gimpactShape->getMeshPartCount(); i++) {
+			btGImpactMeshShapePart* part = gimpactShape->getMeshPart(i);
+			part->lockChildShapes();
+			part->getBoxSet()->buildSet();
+			part->unlockChildShapes();
+		}
+	}
+	// Refits every part's box set bottom up from the vertex arrays and merges them into the shape's bounds
+	gimpactShape->postUpdate();
+	gimpactShape->updateBound();
+
+	// The same cost check as the static tree
+	double cost = 0;
+	for (int32 i = 0; i < gimpactShape->getMeshPartCount(); i++) {
+		const btGImpactBoxSet* boxSet = gimpactShape->getMeshPart(i)->getBoxSet();
+		for (int32 node = 0; node < boxSet->getNodeCount(); node++) {
+			if (!boxSet->isLeafNode(node)) {
+				btAABB box;
+				boxSet->getNodeBound(node, box);
+				cost += GetBoxArea(box.m_min, box.m_max);
+			}
+		}
+	}
+	if (!bRebuild) {
+		refitCount++;
+		if (cost > builtCost * rebuildThreshold) {
+			UpdateGImpact(true);
+		}
+		return;
+	}
+
+	gimpactMin = btVector3(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+	gimpactMax = btVector3(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+	for (int32 i = 0; i < vertexData.Num(); i += 3) {
+		btVector3 point((btScalar)vertexData[i], (btScalar)vertexData[i + 1], (btScalar)vertexData[i + 2]);
+		gimpactMin.setMin(point);
+		gimpactMax.setMax(point);
+	}
+	builtCost = cost;
+	rebuildCount++;
+}
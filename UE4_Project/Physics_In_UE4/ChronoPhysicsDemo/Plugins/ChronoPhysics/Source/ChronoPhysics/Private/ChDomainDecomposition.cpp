@@ -0,0 +1,367 @@
+#include "ChDomainDecomposition.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChLink.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "chrono/collision/gimpact/GIMPACT/Bullet/btGImpactShape.h"
+#include "Async/ParallelFor.h"
+#include "ChKinematicBody.h"
+
+namespace {
+	TSet<chrono::ChBody*> LinkedBodies(chrono::ChSystem& system)
+	{
+		TSet<chrono::ChBody*> linked;
+		for (auto& link : system.Get_linklist()) {
+			if (auto body = dynamic_cast<chrono::ChBody*>(link->GetBody1())) {
+				linked.Add(body);
+			}
+			if (auto body = dynamic_cast<chrono::ChBody*>(link->GetBody2())) {
+				linked.Add(body);
+			}
+		}
+		return linked;
+	}
+
+	bool HasBulletModel(chrono::ChBody& body)
+	{
+		return body.GetCollide() && dynamic_cast<chrono::collision::ChModelBullet*>(body.GetCollisionModel().get()) != nullptr;
+	}
+
+	// GImpact meshes lock their parts and update their box sets while they collide, the other shapes are only read
+	FORCEINLINE bool IsGImpactMesh(btCollisionShape* shape)
+	{
+		return shape->getShapeType() == GIMPACT_SHAPE_PROXYTYPE && static_cast<btGImpactShapeInterface*>(shape)->getGImpactShapeType() == CONST_GIMPACT_TRIMESH_SHAPE;
+	}
+
+	FORCEINLINE void CopyState(chrono::ChBody& target, chrono::ChBody& source)
+	{
+		target.SetPos(source.GetPos());
+		target.SetRot(source.GetRot());
+		target.SetPos_dt(source.GetPos_dt());
+		target.SetRot_dt(source.GetRot_dt());
+	}
+}
+
+void FChDomainDecomposition::Setup(std::shared_ptr<chrono::ChSystem> main, int32 domainNum, int32 inAxis, double inGhostWidth,
+	TFunctionRef<std::shared_ptr<chrono::ChSystem>()> factory, const TSet<chrono::ChBody*>& excluded)
+{
+	Reset();
+	systems.push_back(main);
+	axis = FMath::Clamp(inAxis, 0, 2);
+	ghostWidth = FMath::Max(inGhostWidth, 0.0);
+
+	TSet<chrono::ChBody*> linked = LinkedBodies(*main);
+	TArray<double> coordinates;
+	for (auto& body : main->Get_bodylist()) {
+		if (!body->GetBodyFixed() && HasBulletModel(*body) && !excluded.Contains(body.get()) && !linked.Contains(body.get())) {
+			coordinates.Add(body->GetPos()[axis]);
+		}
+	}
+	domainNum = FMath::Clamp(domainNum, 1, FMath::Min(MaxDomains, coordinates.Num()));
+	if (domainNum < 2) {
+		return;
+	}
+
+	coordinates.Sort();
+	for (int32 i = 1; i < domainNum; i++) {
+		boundaries.Add(coordinates[coordinates.Num() * i / domainNum]);
+		systems.push_back(factory());
+	}
+	Refresh(excluded);
+}
+
+void FChDomainDecomposition::Refresh(const TSet<chrono::ChBody*>& excluded)
+{
+	if (systems.size() < 2) {
+		return;
+	}
+	TSet<chrono::ChBody*> linked = LinkedBodies(*systems[0]);
+
+	// A body that got a link since has to be where the link is
+	for (int32 i = owned.Num() - 1; i >= 0; i--) {
+		if (linked.Contains(owned[i].Body.get()) || excluded.Contains(owned[i].Body.get())) {
+			Reclaim(owned[i].Body.get());
+		}
+	}
+
+	// Dealing removes bodies from main, walk a copy
+	std::vector<std::shared_ptr<chrono::ChBody>> bodies = systems[0]->Get_bodylist();
+	for (auto& body : bodies) {
+		bool bKnown = false;
+		known.Add(body.get(), &bKnown);
+		if (!bKnown) {
+			Deal(body, excluded, linked);
+		}
+	}
+}
+
+void FChDomainDecomposition::Deal(const std::shared_ptr<chrono::ChBody>& body, const TSet<chrono::ChBody*>& excluded, const TSet<chrono::ChBody*>& linked)
+{
+	if (!HasBulletModel(*body)) {
+		return;
+	}
+	if (body->GetBodyFixed() || excluded.Contains(body.get()) || linked.Contains(body.get())) {
+		FMirror& mirror = mirrors[mirrors.AddDefaulted()];
+		mirror.Source = body;
+		bool bKinematic = FChKinematicBody::IsKinematic(*body);
+		for (size_t d = 1; d < systems.size(); d++) {
+			auto clone = Clone(*body, !bKinematic, (int32)d);
+			if (bKinematic) {
+				FChKinematicBody::Make(*clone);
+			}
+			systems[d]->AddBody(clone);
+			mirror.Clones.Add(clone);
+		}
+		return;
+	}
+
+	FOwned& entry = owned[owned.AddDefaulted()];
+	entry.Body = body;
+	entry.Domain = FindDomain(body->GetPos()[axis]);
+	ownedIndices.Add(body.get(), owned.Num() - 1);
+	if (entry.Domain != 0) {
+		systems[0]->RemoveBody(body);
+		AssignShapes(*body, entry.Domain);
+		systems[entry.Domain]->AddBody(body);
+	}
+}
+
+void FChDomainDecomposition::Reclaim(chrono::ChBody* body)
+{
+	known.Remove(body);
+	if (int32* found = ownedIndices.Find(body)) {
+		int32 index = *found;
+		FOwned& entry = owned[index];
+		RemoveGhosts(entry);
+		if (entry.Domain != 0) {
+			systems[entry.Domain]->RemoveBody(entry.Body);
+			AssignShapes(*entry.Body, 0);
+			systems[0]->AddBody(entry.Body);
+		}
+		ownedIndices.Remove(body);
+		owned.RemoveAtSwap(index);
+		if (index < owned.Num()) {
+			ownedIndices.Add(owned[index].Body.get(), index);
+		}
+		return;
+	}
+
+	for (int32 i = 0; i < mirrors.Num(); i++) {
+		if (mirrors[i].Source.get() == body) {
+			for (int32 d = 0; d < mirrors[i].Clones.Num(); d++) {
+				systems[d + 1]->RemoveBody(mirrors[i].Clones[d]);
+			}
+			mirrors.RemoveAtSwap(i);
+			return;
+		}
+	}
+}
+
+void FChDomainDecomposition::Reset()
+{
+	if (systems.size() > 1) {
+		for (auto& entry : owned) {
+			RemoveGhosts(entry);
+			if (entry.Domain != 0) {
+				systems[entry.Domain]->RemoveBody(entry.Body);
+				AssignShapes(*entry.Body, 0);
+				systems[0]->AddBody(entry.Body);
+			}
+		}
+	}
+	// The other systems go with their mirrors
+	systems.clear();
+	boundaries.Reset();
+	owned.Reset();
+	ownedIndices.Reset();
+	mirrors.Reset();
+	known.Reset();
+	domainShapes.Reset();
+	shapeSources.Reset();
+	ghostNum = 0;
+	lastMigrationNum = 0;
+}
+
+void FChDomainDecomposition::Step(double stepSize)
+{
+	if (systems.size() < 2) {
+		if (systems.size() == 1) {
+			systems[0]->DoStepDynamics(stepSize);
+		}
+		return;
+	}
+	Migrate();
+	UpdateGhosts();
+	SyncMirrors();
+	ParallelFor((int32)systems.size(), [this, stepSize](int32 i) {
+		systems[i]->DoStepDynamics(stepSize);
+	});
+}
+
+void FChDomainDecomposition::Migrate()
+{
+	lastMigrationNum = 0;
+	for (auto& entry : owned) {
+		int32 domain = FindDomain(entry.Body->GetPos()[axis]);
+		if (domain == entry.Domain) {
+			continue;
+		}
+		// Its ghost in the new domain would overlap it
+		for (int32 g = 0; g < entry.Ghosts.Num(); g++) {
+			if (entry.Ghosts[g].Domain == domain) {
+				systems[domain]->RemoveBody(entry.Ghosts[g].Body);
+				entry.Ghosts.RemoveAtSwap(g);
+				ghostNum--;
+				break;
+			}
+		}
+		systems[entry.Domain]->RemoveBody(entry.Body);
+		AssignShapes(*entry.Body, domain);
+		systems[domain]->AddBody(entry.Body);
+		entry.Domain = domain;
+		lastMigrationNum++;
+	}
+}
+
+void FChDomainDecomposition::UpdateGhosts()
+{
+	for (auto& entry : owned) {
+		chrono::ChBody& body = *entry.Body;
+		chrono::ChVector<> aabbMin, aabbMax;
+		body.GetCollisionModel()->GetAABB(aabbMin, aabbMax);
+		// The AABB is of the last collision pass, a body added since has none yet
+		double center = body.GetPos()[axis];
+		int32 first = FindDomain(FMath::Min(aabbMin[axis], center) - ghostWidth);
+		int32 last = FindDomain(FMath::Max(aabbMax[axis], center) + ghostWidth);
+
+		for (int32 g = entry.Ghosts.Num() - 1; g >= 0; g--) {
+			int32 domain = entry.Ghosts[g].Domain;
+			if (domain < first || domain > last) {
+				systems[domain]->RemoveBody(entry.Ghosts[g].Body);
+				entry.Ghosts.RemoveAtSwap(g);
+				ghostNum--;
+			}
+		}
+		for (int32 domain = first; domain <= last; domain++) {
+			if (domain == entry.Domain || entry.Ghosts.ContainsByPredicate([domain](const FGhost& ghost) { return ghost.Domain == domain; })) {
+				continue;
+			}
+			FGhost ghost = { domain, Clone(body, false, domain) };
+			systems[domain]->AddBody(ghost.Body);
+			entry.Ghosts.Add(ghost);
+			ghostNum++;
+		}
+
+		// Whatever the ghost did last step is dropped, its owner's result counts
+		for (auto& ghost : entry.Ghosts) {
+			CopyState(*ghost.Body, body);
+		}
+	}
+}
+
+void FChDomainDecomposition::SyncMirrors()
+{
+	for (auto& mirror : mirrors) {
+		for (auto& clone : mirror.Clones) {
+			if (FChKinematicBody::IsKinematic(*clone)) {
+				FChKinematicBody::Drive(*clone, mirror.Source->GetPos(), mirror.Source->GetRot(), mirror.Source->GetPos_dt(), mirror.Source->GetWvel_par());
+			}
+			else {
+				CopyState(*clone, *mirror.Source);
+			}
+		}
+	}
+}
+
+int32 FChDomainDecomposition::FindDomain(double coordinate) const
+{
+	int32 domain = 0;
+	while (domain < boundaries.Num() && coordinate >= boundaries[domain]) {
+		domain++;
+	}
+	return domain;
+}
+
+std::shared_ptr<chrono::ChBody> FChDomainDecomposition::Clone(chrono::ChBody& source, bool bFixed, int32 domain)
+{
+	auto clone = std::make_shared<chrono::ChBody>(source.GetContactMethod());
+	clone->SetMass(source.GetMass());
+	clone->SetInertia(source.GetInertia());
+	clone->SetMaterialSurface(source.GetMaterialSurfaceBase());
+	clone->SetIdentifier(source.GetIdentifier());
+	clone->SetBodyFixed(bFixed);
+	// Its state is overwritten every step, it must never stop being simulated
+	clone->SetUseSleeping(false);
+
+	// Same Bullet shapes, by reference, except for those the domain needs its own copy of
+	auto sourceModel = source.GetCollisionModel();
+	auto model = clone->GetCollisionModel();
+	model->ClearModel();
+	model->AddCopyOfAnotherModel(sourceModel.get());
+	model->BuildModel();
+	model->SetFamilyGroup(sourceModel->GetFamilyGroup());
+	model->SetFamilyMask(sourceModel->GetFamilyMask());
+	AssignShapes(*clone, domain);
+	clone->SetCollide(true);
+	CopyState(*clone, source);
+	return clone;
+}
+
+btCollisionShape* FChDomainDecomposition::DomainShape(btCollisionShape* shape, int32 domain)
+{
+	// Back to the shape a copy was made from, then to the copy of the domain
+	if (btCollisionShape** source = shapeSources.Find(shape)) {
+		shape = *source;
+	}
+	if (domain == 0 || !IsGImpactMesh(shape)) {
+		return shape;
+	}
+	std::shared_ptr<btCollisionShape>& copy = domainShapes.FindOrAdd(TPair<btCollisionShape*, int32>(shape, domain));
+	if (!copy) {
+		// The mesh data itself is only read, the copy has its own parts and box set over it
+		auto mesh = static_cast<btGImpactMeshShape*>(shape);
+		auto gimpact = std::make_shared<btGImpactMeshShape>(mesh->getMeshInterface());
+		gimpact->setLocalScaling(mesh->getLocalScaling());
+		gimpact->setMargin(mesh->getMargin());
+		gimpact->updateBound();
+		copy = gimpact;
+		shapeSources.Add(copy.get(), shape);
+	}
+	return copy.get();
+}
+
+void FChDomainDecomposition::AssignShapes(chrono::ChBody& body, int32 domain)
+{
+	auto model = dynamic_cast<chrono::collision::ChModelBullet*>(body.GetCollisionModel().get());
+	btCollisionObject* object = model ? model->GetBulletModel() : nullptr;
+	btCollisionShape* root = object ? object->getCollisionShape() : nullptr;
+	if (!root) {
+		return;
+	}
+	if (root->getShapeType() != COMPOUND_SHAPE_PROXYTYPE) {
+		btCollisionShape* shape = DomainShape(root, domain);
+		if (shape != root) {
+			object->setCollisionShape(shape);
+		}
+		return;
+	}
+
+	// BuildModel made this compound for the body alone, its children can be swapped in place. The copies
+	// have the same bounds, so the compound's own tree stays valid
+	auto compound = static_cast<btCompoundShape*>(root);
+	btCompoundShapeChild* children = compound->getChildList();
+	for (int i = 0; i < compound->getNumChildShapes(); i++) {
+		children[i].m_childShape = DomainShape(children[i].m_childShape, domain);
+	}
+}
+
+void FChDomainDecomposition::RemoveGhosts(FOwned& entry)
+{
+	for (auto& ghost : entry.Ghosts) {
+		systems[ghost.Domain]->RemoveBody(ghost.Body);
+		ghostNum--;
+	}
+	entry.Ghosts.Reset();
+}
@@ -0,0 +1,287 @@
+#include "ChElementHexa8Tabled.h"
+
+namespace {
+	const double Corners[8][3] = {
+		{ -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+		{ -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 }
+	};
+
+	FChHexa8ShapeTable BuildHexa8ShapeTable()
+	{
+		FChHexa8ShapeTable table;
+		const double gauss = 1 / FMath::Sqrt(3.0);
+		for (int32 p = 0; p < 8; p++) {
+			// The Gauss points sit at the corners scaled in
+			double xi[3] = { Corners[p][0] * gauss, Corners[p][1] * gauss, Corners[p][2] * gauss };
+			table.Weight[p] = 1;
+			for (int32 a = 0; a < 8; a++) {
+				double f[3];
+				for (int32 d = 0; d < 3; d++) {
+					f[d] = 1 + Corners[a][d] * xi[d];
+				}
+				table.N[p][a] = f[0] * f[1] * f[2] / 8;
+				table.DN[p][a][0] = Corners[a][0] * f[1] * f[2] / 8;
+				table.DN[p][a][1] = f[0] * Corners[a][1] * f[2] / 8;
+				table.DN[p][a][2] = f[0] * f[1] * Corners[a][2] / 8;
+			}
+		}
+		return table;
+	}
+
+	FORCEINLINE double Determinant(const double (&m)[3][3])
+	{
+		return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+			- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	}
+
+	// Returns the determinant, out untouched when it is zero
+	double Invert(const double (&m)[3][3], double (&out)[3][3])
+	{
+		double det = Determinant(m);
+		if (det == 0) {
+			return 0;
+		}
+		double inv = 1 / det;
+		out[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+		out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+		out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+		out[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+		out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+		out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+		out[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+		out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+		out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+		return det;
+	}
+}
+
+const FChHexa8ShapeTable& GetHexa8ShapeTable()
+{
+	static const FChHexa8ShapeTable table = BuildHexa8ShapeTable();
+	return table;
+}
+
+void FChElementHexa8Tabled::SetNodes(const std::shared_ptr<chrono::fea::ChNodeFEAxyz> (&inNodes)[NodeNum])
+{
+	std::vector<chrono::ChVariables*> variables;
+	for (int32 a = 0; a < NodeNum; a++) {
+		nodes[a] = inNodes[a];
+		variables.push_back(&nodes[a]->Variables());
+	}
+	Kmatr.SetVariables(variables);
+}
+
+void FChElementHexa8Tabled::GetStateBlock(chrono::ChMatrixDynamic<>& mD)
+{
+	mD.Reset(DofNum, 1);
+	for (int32 a = 0; a < NodeNum; a++) {
+		mD.PasteVector(nodes[a]->GetPos() - nodes[a]->GetX0(), a * 3, 0);
+	}
+}
+
+void FChElementHexa8Tabled::SetupInitial(chrono::ChSystem* system)
+{
+	const FChHexa8ShapeTable& table = GetHexa8ShapeTable();
+	volume = 0;
+	for (int32 p = 0; p < PointNum; p++) {
+		// J0_ij = sum X_a,i dN_a / dxi_j
+		double J[3][3] = {};
+		for (int32 a = 0; a < NodeNum; a++) {
+			chrono::ChVector<> X = nodes[a]->GetX0();
+			for (int32 i = 0; i < 3; i++) {
+				for (int32 j = 0; j < 3; j++) {
+					J[i][j] += X[i] * table.DN[p][a][j];
+				}
+			}
+		}
+		double invJ[3][3] = {};
+		double det = Invert(J, invJ);
+		pointVolume[p] = det * table.Weight[p];
+		volume += pointVolume[p];
+		for (int32 a = 0; a < NodeNum; a++) {
+			for (int32 k = 0; k < 3; k++) {
+				dNdX[p][a][k] = table.DN[p][a][0] * invJ[0][k] + table.DN[p][a][1] * invJ[1][k] + table.DN[p][a][2] * invJ[2][k];
+			}
+		}
+	}
+
+	double density = material ? material->Get_density() : 0;
+	for (int32 a = 0; a < NodeNum; a++) {
+		for (int32 b = 0; b < NodeNum; b++) {
+			double m = 0;
+			for (int32 p = 0; p < PointNum; p++) {
+				m += table.N[p][a] * table.N[p][b] * pointVolume[p];
+			}
+			mass[a][b] = density * m;
+		}
+	}
+}
+
+void FChElementHexa8Tabled::ComputeNodalMass()
+{
+	// Row sums of the consistent mass
+	for (int32 a = 0; a < NodeNum; a++) {
+		double lumped = 0;
+		for (int32 b = 0; b < NodeNum; b++) {
+			lumped += mass[a][b];
+		}
+		nodes[a]->m_TotalMass += lumped;
+	}
+}
+
+void FChElementHexa8Tabled::ComputeGradients(int32 point, double (&F)[3][3], double (&Fdot)[3][3]) const
+{
+	FMemory::Memzero(F);
+	FMemory::Memzero(Fdot);
+	for (int32 a = 0; a < NodeNum; a++) {
+		const chrono::ChVector<>& x = nodes[a]->GetPos();
+		const chrono::ChVector<>& v = nodes[a]->GetPos_dt();
+		const double* g = dNdX[point][a];
+		for (int32 i = 0; i < 3; i++) {
+			for (int32 j = 0; j < 3; j++) {
+				F[i][j] += x[i] * g[j];
+				Fdot[i][j] += v[i] * g[j];
+			}
+		}
+	}
+}
+
+void FChElementHexa8Tabled::ComputeStress(const double (&E)[3][3], double (&S)[3][3]) const
+{
+	double lambda = material->Get_l();
+	double mu = material->Get_G();
+	double trace = E[0][0] + E[1][1] + E[2][2];
+	for (int32 i = 0; i < 3; i++) {
+		for (int32 j = 0; j < 3; j++) {
+			S[i][j] = 2 * mu * E[i][j] + (i == j ? lambda * trace : 0);
+		}
+	}
+}
+
+void FChElementHexa8Tabled::ComputeInternalForces(chrono::ChMatrixDynamic<>& Fi)
+{
+	Fi.Reset(DofNum, 1);
+	if (!material) {
+		return;
+	}
+	for (int32 p = 0; p < PointNum; p++) {
+		double F[3][3], Fdot[3][3];
+		ComputeGradients(p, F, Fdot);
+
+		// E = (F'F - I) / 2, its rate sym(F' Fdot)
+		double E[3][3], Edot[3][3];
+		for (int32 i = 0; i < 3; i++) {
+			for (int32 j = 0; j < 3; j++) {
+				double ftf = 0;
+				double ftfdot = 0;
+				for (int32 k = 0; k < 3; k++) {
+					ftf += F[k][i] * F[k][j];
+					ftfdot += F[k][i] * Fdot[k][j] + Fdot[k][i] * F[k][j];
+				}
+				E[i][j] = 0.5 * (ftf - (i == j ? 1 : 0));
+				Edot[i][j] = 0.5 * ftfdot;
+			}
+		}
+		double S[3][3], Sdamp[3][3];
+		ComputeStress(E, S);
+		ComputeStress(Edot, Sdamp);
+
+		// First Piola P = F S, the nodes get -P dN/dX
+		double P[3][3];
+		for (int32 i = 0; i < 3; i++) {
+			for (int32 j = 0; j < 3; j++) {
+				double sum = 0;
+				for (int32 k = 0; k < 3; k++) {
+					sum += F[i][k] * (S[k][j] + alphaDamp * Sdamp[k][j]);
+				}
+				P[i][j] = sum * pointVolume[p];
+			}
+		}
+		for (int32 a = 0; a < NodeNum; a++) {
+			const double* g = dNdX[p][a];
+			for (int32 i = 0; i < 3; i++) {
+				Fi(a * 3 + i, 0) -= P[i][0] * g[0] + P[i][1] * g[1] + P[i][2] * g[2];
+			}
+		}
+	}
+}
+
+void FChElementHexa8Tabled::ComputeKRMmatricesGlobal(chrono::ChMatrix<>& H, double Kfactor, double Rfactor, double Mfactor)
+{
+	H.Reset(DofNum, DofNum);
+	if (!material) {
+		return;
+	}
+	double lambda = material->Get_l();
+	double mu = material->Get_G();
+	// Material part takes the damping, geometric part only the stiffness factor
+	double materialFactor = Kfactor + Rfactor * alphaDamp;
+
+	for (int32 p = 0; p < PointNum; p++) {
+		double F[3][3], Fdot[3][3];
+		ComputeGradients(p, F, Fdot);
+		double E[3][3];
+		for (int32 i = 0; i < 3; i++) {
+			for (int32 j = 0; j < 3; j++) {
+				E[i][j] = 0.5 * (F[0][i] * F[0][j] + F[1][i] * F[1][j] + F[2][i] * F[2][j] - (i == j ? 1 : 0));
+			}
+		}
+		double S[3][3];
+		ComputeStress(E, S);
+
+		// dE for a unit move of dof (a, i): sym(F' (e_i x dN_a/dX)), and C : dE
+		double B[DofNum][3][3];
+		double CB[DofNum][3][3];
+		for (int32 a = 0; a < NodeNum; a++) {
+			const double* g = dNdX[p][a];
+			for (int32 i = 0; i < 3; i++) {
+				double (&b)[3][3] = B[a * 3 + i];
+				for (int32 k = 0; k < 3; k++) {
+					for (int32 l = 0; l < 3; l++) {
+						b[k][l] = 0.5 * (F[i][k] * g[l] + F[i][l] * g[k]);
+					}
+				}
+				double trace = b[0][0] + b[1][1] + b[2][2];
+				for (int32 k = 0; k < 3; k++) {
+					for (int32 l = 0; l < 3; l++) {
+						CB[a * 3 + i][k][l] = 2 * mu * b[k][l] + (k == l ? lambda * trace : 0);
+					}
+				}
+			}
+		}
+
+		for (int32 r = 0; r < DofNum; r++) {
+			for (int32 c = 0; c < DofNum; c++) {
+				double sum = 0;
+				for (int32 k = 0; k < 3; k++) {
+					sum += B[r][k][0] * CB[c][k][0] + B[r][k][1] * CB[c][k][1] + B[r][k][2] * CB[c][k][2];
+				}
+				H(r, c) += materialFactor * sum * pointVolume[p];
+			}
+		}
+		// Geometric stiffness, dN_a . S . dN_b on the diagonal of each 3 x 3 block
+		for (int32 a = 0; a < NodeNum; a++) {
+			const double* ga = dNdX[p][a];
+			double sga[3];
+			for (int32 l = 0; l < 3; l++) {
+				sga[l] = ga[0] * S[0][l] + ga[1] * S[1][l] + ga[2] * S[2][l];
+			}
+			for (int32 b = 0; b < NodeNum; b++) {
+				const double* gb = dNdX[p][b];
+				double geometric = Kfactor * (sga[0] * gb[0] + sga[1] * gb[1] + sga[2] * gb[2]) * pointVolume[p];
+				for (int32 i = 0; i < 3; i++) {
+					H(a * 3 + i, b * 3 + i) += geometric;
+				}
+			}
+		}
+	}
+
+	for (int32 a = 0; a < NodeNum; a++) {
+		for (int32 b = 0; b < NodeNum; b++) {
+			for (int32 i = 0; i < 3; i++) {
+				H(a * 3 + i, b * 3 + i) += Mfactor * mass[a][b];
+			}
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#include "ChEngineTorqueFunction.h"
+#include "chrono/physics/ChLinkEngine.h"
+
+void FChEngineTorqueFunction::SetTable(std::vector<double>&& samples, double minSpeed, double maxSpeed)
+{
+	table = MoveTemp(samples);
+	tableMin = minSpeed;
+	invSpacing = table.size() > 1 && maxSpeed > minSpeed ? (table.size() - 1) / (maxSpeed - minSpeed) : 0;
+}
+
+double FChEngineTorqueFunction::Lookup(double speed) const
+{
+	if (table.empty()) {
+		return 0;
+	}
+	double position = (speed - tableMin) * invSpacing;
+	if (position <= 0) {
+		return table.front();
+	}
+	size_t index = (size_t)position;
+	if (index >= table.size() - 1) {
+		return table.back();
+	}
+	double alpha = position - index;
+	return table[index] + (table[index + 1] - table[index]) * alpha;
+}
+
+double FChEngineTorqueFunction::Get_y(double x) const
+{
+	return throttle * scale * Lookup(FMath::Abs(engine->Get_mot_rot_dt()));
+}
@@ -0,0 +1,537 @@
+#include "ChFEAContactSurface.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChContactContainer.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "chrono/fea/ChContactSurfaceMesh.h"
+#include "chrono/fea/ChContactSurfaceNodeCloud.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+
+namespace {
+	// Below this many proxies the collision pass stays on the stepping thread
+	const int32 ParallelProxyCount = 64;
+	// Below this many nodes a refit level stays on the stepping thread
+	const int32 ParallelNodeCount = 256;
+	// Points per task of the position gather
+	const int32 PointChunk = 1024;
+
+	FORCEINLINE FVector ToVector(const chrono::ChVector<>& v)
+	{
+		return FVector(v.x(), v.y(), v.z());
+	}
+
+	FORCEINLINE chrono::ChVector<> ToChVector(const FVector& v)
+	{
+		return chrono::ChVector<>(v.X, v.Y, v.Z);
+	}
+
+	FORCEINLINE bool IsInsideTriangle(const FVector& point, const FVector& a, const FVector& b, const FVector& c)
+	{
+		FVector barycentric = FMath::ComputeBaryCentric2D(point, a, b, c);
+		return barycentric.X >= -KINDA_SMALL_NUMBER && barycentric.Y >= -KINDA_SMALL_NUMBER && barycentric.Z >= -KINDA_SMALL_NUMBER;
+	}
+
+	// A point of the given radius against a box proxy, false out of reach. The normal points from the point to the box
+	bool CollidePointWithBox(chrono::ChBody* body, const FVector& extent, const chrono::ChVector<>& point, double radius, double reach,
+		chrono::ChVector<>& normal, chrono::ChVector<>& pointB, double& distance)
+	{
+		chrono::ChVector<> local = body->TransformPointParentToLocal(point);
+		chrono::ChVector<> clamped(FMath::Clamp(local.x(), -(double)extent.X, (double)extent.X),
+			FMath::Clamp(local.y(), -(double)extent.Y, (double)extent.Y),
+			FMath::Clamp(local.z(), -(double)extent.Z, (double)extent.Z));
+		chrono::ChVector<> offset = clamped - local;
+		double length = offset.Length();
+		if (length > KINDA_SMALL_NUMBER) {
+			distance = length - radius;
+			if (distance >= reach) {
+				return false;
+			}
+			normal = body->TransformDirectionLocalToParent(offset / length);
+			pointB = body->TransformPointLocalToParent(clamped);
+			return true;
+		}
+
+		// Inside, out through the nearest face; the box is pushed the other way
+		int32 axis = 0;
+		double depth = extent.X - FMath::Abs(local.x());
+		for (int32 k = 1; k < 3; k++) {
+			double axisDepth = extent[k] - FMath::Abs(local[k]);
+			if (axisDepth < depth) {
+				depth = axisDepth;
+				axis = k;
+			}
+		}
+		chrono::ChVector<> face = chrono::VNULL;
+		face[axis] = local[axis] >= 0 ? 1 : -1;
+		chrono::ChVector<> onFace = local;
+		onFace[axis] = face[axis] * extent[axis];
+		normal = body->TransformDirectionLocalToParent(-face);
+		pointB = body->TransformPointLocalToParent(onFace);
+		distance = -(depth + radius);
+		return true;
+	}
+}
+
+void FChRefitBVH::Build(const TArray<FIntVector>& primitives, const TArray<FVector>& points)
+{
+	nodes.Reset();
+	leaves.Reset();
+	levels.Reset();
+	primitiveList = primitives;
+	const int32 num = primitives.Num();
+	if (num == 0) {
+		return;
+	}
+
+	TArray<FVector> centroids;
+	centroids.SetNumUninitialized(num);
+	order.SetNumUninitialized(num);
+	for (int32 i = 0; i < num; i++) {
+		const FIntVector& primitive = primitives[i];
+		centroids[i] = (points[primitive.X] + points[primitive.Y] + points[primitive.Z]) / 3;
+		order[i] = i;
+	}
+	nodes.Reserve(2 * FMath::DivideAndRoundUp(num, LeafSize));
+	BuildNode(0, num, 0, centroids);
+	Refit(points, 0.f);
+}
+
+int32 FChRefitBVH::BuildNode(int32 begin, int32 end, int32 depth, const TArray<FVector>& centroids)
+{
+	int32 index = nodes.AddDefaulted();
+	if (end - begin <= LeafSize) {
+		nodes[index].Data = begin;
+		nodes[index].Count = end - begin;
+		leaves.Add(index);
+		return index;
+	}
+
+	// Median of the centroids along the widest axis, the topology decides the tree, not the motion
+	FBox bounds(ForceInit);
+	for (int32 i = begin; i < end; i++) {
+		bounds += centroids[order[i]];
+	}
+	FVector size = bounds.GetSize();
+	int32 axis = size.X >= size.Y && size.X >= size.Z ? 0 : (size.Y >= size.Z ? 1 : 2);
+	int32 mid = (begin + end) / 2;
+	std::nth_element(order.GetData() + begin, order.GetData() + mid, order.GetData() + end, [&centroids, axis](int32 a, int32 b) {
+		return centroids[a][axis] < centroids[b][axis];
+	});
+
+	if (levels.Num() <= depth) {
+		levels.SetNum(depth + 1);
+	}
+	levels[depth].Add(index);
+	nodes[index].Count = 0;
+	BuildNode(begin, mid, depth + 1, centroids);
+	int32 right = BuildNode(mid, end, depth + 1, centroids);
+	nodes[index].Data = right;
+	return index;
+}
+
+void FChRefitBVH::Refit(const TArray<FVector>& points, float inflate)
+{
+	ParallelFor(leaves.Num(), [&](int32 i) {
+		FNode& node = nodes[leaves[i]];
+		FBox box(ForceInit);
+		for (int32 slot = node.Data; slot < node.Data + node.Count; slot++) {
+			const FIntVector& primitive = primitiveList[order[slot]];
+			box += points[primitive.X];
+			box += points[primitive.Y];
+			box += points[primitive.Z];
+		}
+		box = box.ExpandBy(inflate);
+		for (int32 k = 0; k < 3; k++) {
+			node.Min[k] = box.Min[k];
+			node.Max[k] = box.Max[k];
+		}
+	}, leaves.Num() < ParallelNodeCount);
+
+	// Children sit one level deeper, or are leaves, so each level only reads finished nodes
+	for (int32 depth = levels.Num() - 1; depth >= 0; depth--) {
+		const TArray<int32>& level = levels[depth];
+		ParallelFor(level.Num(), [&](int32 i) {
+			FNode& node = nodes[level[i]];
+			const FNode& left = nodes[level[i] + 1];
+			const FNode& right = nodes[node.Data];
+			for (int32 k = 0; k < 3; k++) {
+				node.Min[k] = FMath::Min(left.Min[k], right.Min[k]);
+				node.Max[k] = FMath::Max(left.Max[k], right.Max[k]);
+			}
+		}, level.Num() < ParallelNodeCount);
+	}
+}
+
+void FChRefitBVH::Query(const FBox& box, TArray<int32>& outPrimitives) const
+{
+	outPrimitives.Reset();
+	if (nodes.Num() == 0) {
+		return;
+	}
+	TArray<int32, TInlineAllocator<64>> stack;
+	stack.Add(0);
+	while (stack.Num()) {
+		int32 index = stack.Pop(false);
+		const FNode& node = nodes[index];
+		if (node.Min[0] > box.Max.X || node.Max[0] < box.Min.X ||
+			node.Min[1] > box.Max.Y || node.Max[1] < box.Min.Y ||
+			node.Min[2] > box.Max.Z || node.Max[2] < box.Min.Z) {
+			continue;
+		}
+		if (node.Count > 0) {
+			for (int32 slot = node.Data; slot < node.Data + node.Count; slot++) {
+				outPrimitives.Add(order[slot]);
+			}
+		}
+		else {
+			stack.Add(node.Data);
+			stack.Add(index + 1);
+		}
+	}
+}
+
+void FChFEAContactSet::AddSurface(std::shared_ptr<chrono::fea::ChContactSurfaceMesh> surface, double sphereSwept)
+{
+	if (!surface || ContainsSurface(surface.get())) {
+		return;
+	}
+	FSurface entry;
+	entry.Owner = surface;
+	entry.Radius = sphereSwept;
+	TMap<chrono::fea::ChNodeFEAxyz*, int32> pointOfNode;
+	auto pointIndex = [&](const std::shared_ptr<chrono::fea::ChNodeFEAxyz>& node) {
+		if (const int32* found = pointOfNode.Find(node.get())) {
+			return *found;
+		}
+		int32 index = entry.Points.Add(node.get());
+		pointOfNode.Add(node.get(), index);
+		return index;
+	};
+	// Rotational node triangles would need the frame nodes' contactables, they stay with Bullet
+	for (auto& triangle : surface->GetTriangleList()) {
+		entry.Primitives.Add(FIntVector(pointIndex(triangle->GetNode1()), pointIndex(triangle->GetNode2()), pointIndex(triangle->GetNode3())));
+		entry.Models.Add(triangle->GetCollisionModel());
+	}
+	if (entry.Primitives.Num() == 0) {
+		return;
+	}
+	entry.Envelope = entry.Models[0]->GetEnvelope();
+	GatherPositions(entry);
+	entry.BVH.Build(entry.Primitives, entry.Positions);
+	surfaces.Add(MoveTemp(entry));
+}
+
+void FChFEAContactSet::AddNodeCloud(std::shared_ptr<chrono::fea::ChContactSurfaceNodeCloud> cloud, double radius)
+{
+	if (!cloud || ContainsSurface(cloud.get()) || cloud->GetNnodes() == 0) {
+		return;
+	}
+	FSurface entry;
+	entry.Owner = cloud;
+	entry.bNodes = true;
+	entry.Radius = radius;
+	for (unsigned int n = 0; n < cloud->GetNnodes(); n++) {
+		auto contact = cloud->GetNode(n);
+		int32 index = entry.Points.Add(contact->GetNode());
+		entry.Primitives.Add(FIntVector(index));
+		entry.Models.Add(contact->GetCollisionModel());
+	}
+	entry.Envelope = entry.Models[0]->GetEnvelope();
+	GatherPositions(entry);
+	entry.BVH.Build(entry.Primitives, entry.Positions);
+	surfaces.Add(MoveTemp(entry));
+}
+
+void FChFEAContactSet::RemoveSurface(chrono::fea::ChContactSurface* surface)
+{
+	surfaces.RemoveAll([surface](const FSurface& entry) { return entry.Owner.get() == surface; });
+}
+
+bool FChFEAContactSet::ContainsSurface(chrono::fea::ChContactSurface* surface) const
+{
+	return surfaces.ContainsByPredicate([surface](const FSurface& entry) { return entry.Owner.get() == surface; });
+}
+
+void FChFEAContactSet::AddProxy(std::shared_ptr<chrono::ChBody> body, const FChColliderProxy& proxy)
+{
+	if (!body || ContainsProxy(body.get())) {
+		return;
+	}
+	FProxyState& state = proxies.AddDefaulted_GetRef();
+	state.Body = body;
+	state.Shape = proxy;
+}
+
+void FChFEAContactSet::RemoveProxy(chrono::ChBody* body)
+{
+	proxies.RemoveAllSwap([body](const FProxyState& proxy) { return proxy.Body.get() == body; });
+}
+
+bool FChFEAContactSet::ContainsProxy(chrono::ChBody* body) const
+{
+	return proxies.ContainsByPredicate([body](const FProxyState& proxy) { return proxy.Body.get() == body; });
+}
+
+void FChFEAContactSet::OnCustomCollision(chrono::ChSystem* system)
+{
+	if (surfaces.Num() == 0 || proxies.Num() == 0) {
+		lastContactCount = 0;
+		return;
+	}
+
+	for (FSurface& surface : surfaces) {
+		GatherPositions(surface);
+		surface.BVH.Refit(surface.Positions, surface.Radius + surface.Envelope);
+	}
+
+	// Proxies only write their own state, the contacts go into the container afterwards in proxy order
+	ParallelFor(proxies.Num(), [this](int32 i) {
+		CollideProxy(proxies[i]);
+	}, proxies.Num() < ParallelProxyCount);
+
+	auto container = system->GetContactContainer();
+	lastContactCount = 0;
+	for (auto& proxy : proxies) {
+		for (auto& contact : proxy.Contacts) {
+			container->AddContact(contact);
+		}
+		lastContactCount += proxy.Contacts.Num();
+	}
+}
+
+void FChFEAContactSet::GatherPositions(FSurface& surface)
+{
+	const int32 num = surface.Points.Num();
+	surface.Positions.SetNumUninitialized(num, false);
+	ParallelFor(FMath::DivideAndRoundUp(num, PointChunk), [&surface, num](int32 chunk) {
+		int32 end = FMath::Min(num, (chunk + 1) * PointChunk);
+		for (int32 i = chunk * PointChunk; i < end; i++) {
+			surface.Positions[i] = ToVector(surface.Points[i]->GetPos());
+		}
+	});
+}
+
+void FChFEAContactSet::CollideProxy(FProxyState& proxy)
+{
+	proxy.Contacts.Reset();
+	chrono::ChBody* body = proxy.Body.get();
+	if (!body->GetCollide() || body->GetSleeping() || !body->GetSystem()) {
+		return;
+	}
+	double envelope = body->GetCollisionModel()->GetEnvelope();
+
+	FVector corners[8];
+	FBox query(ForceInit);
+	if (proxy.Shape.Type == FChColliderProxy::Sphere) {
+		query = FBox::BuildAABB(ToVector(body->GetPos()), FVector(proxy.Shape.Extent.X + envelope));
+	}
+	else {
+		const FVector& extent = proxy.Shape.Extent;
+		for (int32 k = 0; k < 8; k++) {
+			chrono::ChVector<> corner((k & 1) ? extent.X : -extent.X, (k & 2) ? extent.Y : -extent.Y, (k & 4) ? extent.Z : -extent.Z);
+			corners[k] = ToVector(body->TransformPointLocalToParent(corner));
+			query += corners[k];
+		}
+		query = query.ExpandBy(envelope);
+	}
+
+	for (const FSurface& surface : surfaces) {
+		surface.BVH.Query(query, proxy.Candidates);
+		if (proxy.Candidates.Num() == 0) {
+			continue;
+		}
+		if (surface.bNodes) {
+			CollideNodes(proxy, surface, envelope);
+		}
+		else {
+			CollideTriangles(proxy, surface, corners, envelope);
+		}
+	}
+}
+
+void FChFEAContactSet::CollideTriangles(FProxyState& proxy, const FSurface& surface, const FVector corners[8], double proxyEnvelope)
+{
+	const float reach = proxyEnvelope + surface.Envelope;
+	const float swept = surface.Radius;
+	chrono::collision::ChCollisionModel* bodyModel = proxy.Body->GetCollisionModel().get();
+
+	if (proxy.Shape.Type == FChColliderProxy::Sphere) {
+		// The closest triangle only, like the static meshes
+		const float radius = proxy.Shape.Extent.X;
+		const FVector center = ToVector(proxy.Body->GetPos());
+		float bestDistance = MAX_flt;
+		int32 bestPrimitive = INDEX_NONE;
+		FVector bestPoint;
+		FVector bestNormal;
+		for (int32 index : proxy.Candidates) {
+			const FIntVector& primitive = surface.Primitives[index];
+			const FVector& a = surface.Positions[primitive.X];
+			const FVector& b = surface.Positions[primitive.Y];
+			const FVector& c = surface.Positions[primitive.Z];
+			FVector point = FMath::ClosestPointOnTriangleToPoint(center, a, b, c);
+			FVector offset = center - point;
+			float distance = offset.Size();
+			float gap = distance - radius - swept;
+			if (gap >= reach || gap >= bestDistance) {
+				continue;
+			}
+			FVector normal;
+			if (distance > KINDA_SMALL_NUMBER) {
+				normal = offset / distance;
+			}
+			else {
+				normal = ((b - a) ^ (c - a)).GetSafeNormal();
+				if (normal.IsZero()) {
+					continue;
+				}
+			}
+			bestDistance = gap;
+			bestPrimitive = index;
+			bestPoint = point;
+			bestNormal = normal;
+		}
+		if (bestPrimitive == INDEX_NONE) {
+			return;
+		}
+
+		// A is the FEA surface, B the proxy body; the normal points from the surface to the body
+		chrono::collision::ChCollisionInfo& contact = proxy.Contacts.AddDefaulted_GetRef();
+		contact.modelA = surface.Models[bestPrimitive];
+		contact.modelB = bodyModel;
+		contact.vN = ToChVector(bestNormal);
+		contact.vpA = ToChVector(bestPoint + bestNormal * swept);
+		contact.vpB = ToChVector(center - bestNormal * radius);
+		contact.distance = bestDistance;
+		contact.eff_radius = radius;
+		contact.reaction_cache = nullptr;
+		return;
+	}
+
+	// Corners deeper than the thinnest half extent came through from the other side
+	const float maxDepth = proxy.Shape.Extent.GetMin();
+	const FVector center = ToVector(proxy.Body->GetPos());
+	float bestDistance[8];
+	int32 bestPrimitive[8];
+	FVector bestPoint[8];
+	FVector bestNormal[8];
+	for (int32 k = 0; k < 8; k++) {
+		bestDistance[k] = MAX_flt;
+		bestPrimitive[k] = INDEX_NONE;
+	}
+	for (int32 index : proxy.Candidates) {
+		const FIntVector& primitive = surface.Primitives[index];
+		const FVector& a = surface.Positions[primitive.X];
+		const FVector& b = surface.Positions[primitive.Y];
+		const FVector& c = surface.Positions[primitive.Z];
+		FVector normal = ((b - a) ^ (c - a)).GetSafeNormal();
+		if (normal.IsZero()) {
+			continue;
+		}
+		// Surfaces are two sided, each triangle pushes towards the side the box center is on
+		if ((normal | (center - a)) < 0) {
+			normal = -normal;
+		}
+		for (int32 k = 0; k < 8; k++) {
+			float distance = (normal | (corners[k] - a)) - swept;
+			if (distance >= reach || distance <= -maxDepth || distance >= bestDistance[k]) {
+				continue;
+			}
+			FVector projected = corners[k] - normal * (distance + swept);
+			if (!IsInsideTriangle(projected, a, b, c)) {
+				continue;
+			}
+			bestDistance[k] = distance;
+			bestPrimitive[k] = index;
+			bestPoint[k] = projected + normal * swept;
+			bestNormal[k] = normal;
+		}
+	}
+	for (int32 k = 0; k < 8; k++) {
+		if (bestPrimitive[k] == INDEX_NONE) {
+			continue;
+		}
+		chrono::collision::ChCollisionInfo& contact = proxy.Contacts.AddDefaulted_GetRef();
+		contact.modelA = surface.Models[bestPrimitive[k]];
+		contact.modelB = bodyModel;
+		contact.vN = ToChVector(bestNormal[k]);
+		contact.vpA = ToChVector(bestPoint[k]);
+		contact.vpB = ToChVector(corners[k]);
+		contact.distance = bestDistance[k];
+		contact.reaction_cache = nullptr;
+	}
+
+	// The corners miss a box larger than the triangles, such as the ground, so the surface vertices are
+	// tested against the box too, each once with one of the candidate triangles it belongs to
+	proxy.Vertices.Reset();
+	for (int32 index : proxy.Candidates) {
+		const FIntVector& primitive = surface.Primitives[index];
+		proxy.Vertices.Add(FIntPoint(primitive.X, index));
+		proxy.Vertices.Add(FIntPoint(primitive.Y, index));
+		proxy.Vertices.Add(FIntPoint(primitive.Z, index));
+	}
+	proxy.Vertices.Sort([](const FIntPoint& a, const FIntPoint& b) { return a.X < b.X; });
+	for (int32 i = 0; i < proxy.Vertices.Num(); i++) {
+		if (i > 0 && proxy.Vertices[i].X == proxy.Vertices[i - 1].X) {
+			continue;
+		}
+		const chrono::ChVector<>& vertex = surface.Points[proxy.Vertices[i].X]->GetPos();
+		chrono::ChVector<> normal;
+		chrono::ChVector<> pointB;
+		double distance;
+		if (!CollidePointWithBox(proxy.Body.get(), proxy.Shape.Extent, vertex, swept, reach, normal, pointB, distance)) {
+			continue;
+		}
+		chrono::collision::ChCollisionInfo& contact = proxy.Contacts.AddDefaulted_GetRef();
+		contact.modelA = surface.Models[proxy.Vertices[i].Y];
+		contact.modelB = bodyModel;
+		contact.vN = normal;
+		contact.vpA = vertex + normal * swept;
+		contact.vpB = pointB;
+		contact.distance = distance;
+		contact.reaction_cache = nullptr;
+	}
+}
+
+void FChFEAContactSet::CollideNodes(FProxyState& proxy, const FSurface& surface, double proxyEnvelope)
+{
+	const double reach = proxyEnvelope + surface.Envelope;
+	const double radius = surface.Radius;
+	chrono::ChBody* body = proxy.Body.get();
+	chrono::collision::ChCollisionModel* bodyModel = body->GetCollisionModel().get();
+	const FVector& extent = proxy.Shape.Extent;
+
+	// Every node in reach gets its own contact
+	for (int32 index : proxy.Candidates) {
+		const chrono::ChVector<>& node = surface.Points[surface.Primitives[index].X]->GetPos();
+		chrono::ChVector<> normal;
+		chrono::ChVector<> pointB;
+		double distance;
+		double effRadius = radius;
+
+		if (proxy.Shape.Type == FChColliderProxy::Sphere) {
+			double bodyRadius = extent.X;
+			chrono::ChVector<> offset = body->GetPos() - node;
+			double length = offset.Length();
+			distance = length - radius - bodyRadius;
+			if (distance >= reach) {
+				continue;
+			}
+			normal = length > KINDA_SMALL_NUMBER ? offset / length : chrono::VECT_Y;
+			pointB = body->GetPos() - normal * bodyRadius;
+			effRadius = radius * bodyRadius / (radius + bodyRadius);
+		}
+		else if (!CollidePointWithBox(body, extent, node, radius, reach, normal, pointB, distance)) {
+			continue;
+		}
+
+		chrono::collision::ChCollisionInfo& contact = proxy.Contacts.AddDefaulted_GetRef();
+		contact.modelA = surface.Models[index];
+		contact.modelB = bodyModel;
+		contact.vN = normal;
+		contact.vpA = node + normal * radius;
+		contact.vpB = pointB;
+		contact.distance = distance;
+		contact.eff_radius = effRadius;
+		contact.reaction_cache = nullptr;
+	}
+}
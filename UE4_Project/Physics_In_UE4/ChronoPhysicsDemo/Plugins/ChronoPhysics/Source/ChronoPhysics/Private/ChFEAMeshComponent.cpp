@@ -0,0 +1,549 @@
+#include "ChFEAMeshComponent.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+#include "StaticMeshResources.h"
+#include "DynamicMeshBuilder.h"
+#include "LocalVertexFactory.h"
+#include "Materials/Material.h"
+#include "RenderingThread.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/fea/ChMesh.h"
+#include "chrono/fea/ChNodeFEAxyz.h"
+#include "chrono/fea/ChNodeFEAxyzrot.h"
+#include "chrono/fea/ChElementBeam.h"
+#include "chrono/fea/ChElementShell.h"
+#include "chrono/fea/ChElementTetrahedron.h"
+#include "chrono/fea/ChContactSurfaceMesh.h"
+#include "chrono/fea/ChContactSurfaceNodeCloud.h"
+#include "chrono/physics/ChMaterialSurfaceNSC.h"
+#include "chrono/physics/ChMaterialSurfaceSMC.h"
+#include "util.h"
+
+namespace {
+	// Vertices per task of the per frame copies
+	const int32 VertexChunk = 1024;
+
+	const int32 TetraFaces[4][3] = { { 0, 1, 2 }, { 0, 1, 3 }, { 0, 2, 3 }, { 1, 2, 3 } };
+	const int32 HexaFaces[6][4] = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 1, 5, 4 }, { 1, 2, 6, 5 }, { 2, 3, 7, 6 }, { 3, 0, 4, 7 } };
+
+	// A face of a volume element, kept when no other element shares it
+	struct FVolumeFace
+	{
+		int32 Corners[4];
+		int32 CornerNum;
+		FVector Inside;
+		int32 Count;
+	};
+
+	typedef TTuple<int32, int32, int32, int32> FFaceKey;
+
+	FFaceKey MakeFaceKey(const int32* corners, int32 cornerNum)
+	{
+		int32 sorted[4] = { corners[0], corners[1], corners[2], cornerNum > 3 ? corners[3] : INDEX_NONE };
+		Algo::Sort(sorted);
+		return FFaceKey(sorted[0], sorted[1], sorted[2], sorted[3]);
+	}
+
+	// Also the front face of the triangle, the convention of UKismetProceduralMeshLibrary
+	FORCEINLINE FVector TriangleNormal(const FVector& p0, const FVector& p1, const FVector& p2)
+	{
+		return (p1 - p2) ^ (p0 - p2);
+	}
+
+	class FChFEAMeshSceneProxy final : public FPrimitiveSceneProxy
+	{
+	public:
+		FChFEAMeshSceneProxy(UChFEAMeshComponent* component, const TArray<FVector>& positions, const TArray<FPackedNormal>& tangents,
+			const TArray<uint32>& triangles, const TArray<uint32>& lines)
+			: FPrimitiveSceneProxy(component)
+			, vertexFactory(GetScene().GetFeatureLevel(), "FChFEAMeshSceneProxy")
+			, materialRelevance(component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+		{
+			material = component->GetMaterial(0);
+			if (!material) {
+				material = UMaterial::GetDefaultMaterial(MD_Surface);
+			}
+
+			const int32 num = positions.Num();
+			vertexBuffers.PositionVertexBuffer.Init(num);
+			vertexBuffers.StaticMeshVertexBuffer.SetUseFullPrecisionUVs(true);
+			vertexBuffers.StaticMeshVertexBuffer.Init(num, 2);
+			vertexBuffers.ColorVertexBuffer.InitFromSingleColor(FColor::White, num);
+			for (int32 i = 0; i < num; i++) {
+				vertexBuffers.PositionVertexBuffer.VertexPosition(i) = positions[i];
+				FVector tangentX = tangents[i * 2].ToFVector();
+				FVector tangentZ = tangents[i * 2 + 1].ToFVector();
+				vertexBuffers.StaticMeshVertexBuffer.SetVertexTangents(i, tangentX, tangentZ ^ tangentX, tangentZ);
+				vertexBuffers.StaticMeshVertexBuffer.SetVertexUV(i, 0, FVector2D::ZeroVector);
+				vertexBuffers.StaticMeshVertexBuffer.SetVertexUV(i, 1, FVector2D::ZeroVector);
+			}
+			triangleBuffer.Indices = triangles;
+			lineBuffer.Indices = lines;
+
+			ENQUEUE_RENDER_COMMAND(ChFEAMeshInitProxy)([this](FRHICommandListImmediate& RHICmdList) {
+				vertexBuffers.PositionVertexBuffer.InitResource();
+				vertexBuffers.StaticMeshVertexBuffer.InitResource();
+				vertexBuffers.ColorVertexBuffer.InitResource();
+
+				FLocalVertexFactory::FDataType data;
+				vertexBuffers.PositionVertexBuffer.BindPositionVertexBuffer(&vertexFactory, data);
+				vertexBuffers.StaticMeshVertexBuffer.BindTangentVertexBuffer(&vertexFactory, data);
+				vertexBuffers.StaticMeshVertexBuffer.BindPackedTexCoordVertexBuffer(&vertexFactory, data);
+				vertexBuffers.ColorVertexBuffer.BindColorVertexBuffer(&vertexFactory, data);
+				vertexFactory.SetData(data);
+				vertexFactory.InitResource();
+
+				if (triangleBuffer.Indices.Num() > 0) {
+					triangleBuffer.InitResource();
+				}
+				if (lineBuffer.Indices.Num() > 0) {
+					lineBuffer.InitResource();
+				}
+			});
+		}
+
+		virtual ~FChFEAMeshSceneProxy()
+		{
+			vertexBuffers.PositionVertexBuffer.ReleaseResource();
+			vertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+			vertexBuffers.ColorVertexBuffer.ReleaseResource();
+			triangleBuffer.ReleaseResource();
+			lineBuffer.ReleaseResource();
+			vertexFactory.ReleaseResource();
+		}
+
+		// Render thread, straight copies into the vertex buffers; empty arrays keep what is there
+		void Upload(const TArray<FVector>& positions, const TArray<FPackedNormal>& tangents, const TArray<FVector2D>& uvs)
+		{
+			check(IsInRenderingThread());
+			const int32 num = positions.Num();
+			if (num == 0 || num != (int32)vertexBuffers.PositionVertexBuffer.GetNumVertices()) {
+				return;
+			}
+			FVertexBufferRHIRef& positionRHI = vertexBuffers.PositionVertexBuffer.VertexBufferRHI;
+			void* data = RHILockVertexBuffer(positionRHI, 0, num * sizeof(FVector), RLM_WriteOnly);
+			FMemory::Memcpy(data, positions.GetData(), num * sizeof(FVector));
+			RHIUnlockVertexBuffer(positionRHI);
+
+			if (tangents.Num() == num * 2) {
+				FVertexBufferRHIRef& tangentRHI = vertexBuffers.StaticMeshVertexBuffer.TangentsVertexBuffer.VertexBufferRHI;
+				data = RHILockVertexBuffer(tangentRHI, 0, tangents.Num() * sizeof(FPackedNormal), RLM_WriteOnly);
+				FMemory::Memcpy(data, tangents.GetData(), tangents.Num() * sizeof(FPackedNormal));
+				RHIUnlockVertexBuffer(tangentRHI);
+			}
+			if (uvs.Num() == num * 2) {
+				FVertexBufferRHIRef& uvRHI = vertexBuffers.StaticMeshVertexBuffer.TexCoordVertexBuffer.VertexBufferRHI;
+				data = RHILockVertexBuffer(uvRHI, 0, uvs.Num() * sizeof(FVector2D), RLM_WriteOnly);
+				FMemory::Memcpy(data, uvs.GetData(), uvs.Num() * sizeof(FVector2D));
+				RHIUnlockVertexBuffer(uvRHI);
+			}
+		}
+
+		virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+		{
+			const FMaterialRenderProxy* materialProxy = material->GetRenderProxy();
+			for (int32 viewIndex = 0; viewIndex < Views.Num(); viewIndex++) {
+				if (!(VisibilityMap & (1 << viewIndex))) {
+					continue;
+				}
+				if (triangleBuffer.Indices.Num() > 0) {
+					AddMesh(Collector, viewIndex, materialProxy, triangleBuffer, PT_TriangleList, triangleBuffer.Indices.Num() / 3);
+				}
+				if (lineBuffer.Indices.Num() > 0) {
+					AddMesh(Collector, viewIndex, materialProxy, lineBuffer, PT_LineList, lineBuffer.Indices.Num() / 2);
+				}
+			}
+		}
+
+		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+		{
+			FPrimitiveViewRelevance result;
+			result.bDrawRelevance = IsShown(View);
+			result.bShadowRelevance = IsShadowCast(View);
+			result.bDynamicRelevance = true;
+			result.bRenderInMainPass = ShouldRenderInMainPass();
+			result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+			result.bRenderCustomDepth = ShouldRenderCustomDepth();
+			materialRelevance.SetPrimitiveViewRelevance(result);
+			result.bVelocityRelevance = IsMovable() && result.bOpaqueRelevance && result.bRenderInMainPass;
+			return result;
+		}
+
+		virtual bool CanBeOccluded() const override { return !materialRelevance.bDisableDepthTest; }
+		virtual uint32 GetMemoryFootprint() const override { return sizeof(*this) + GetAllocatedSize(); }
+
+		virtual SIZE_T GetTypeHash() const override
+		{
+			static size_t uniquePointer;
+			return reinterpret_cast<size_t>(&uniquePointer);
+		}
+
+	private:
+		void AddMesh(FMeshElementCollector& collector, int32 viewIndex, const FMaterialRenderProxy* materialProxy,
+			const FDynamicMeshIndexBuffer32& indexBuffer, EPrimitiveType type, int32 primitiveNum) const
+		{
+			FMeshBatch& mesh = collector.AllocateMesh();
+			mesh.VertexFactory = &vertexFactory;
+			mesh.MaterialRenderProxy = materialProxy;
+			mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+			mesh.Type = type;
+			mesh.DepthPriorityGroup = SDPG_World;
+			mesh.bCanApplyViewModeOverrides = false;
+
+			bool bHasPrecomputedVolumetricLightmap;
+			FMatrix previousLocalToWorld;
+			int32 singleCaptureIndex;
+			bool bOutputVelocity;
+			GetScene().GetPrimitiveUniformShaderParameters_RenderThread(GetPrimitiveSceneInfo(), bHasPrecomputedVolumetricLightmap, previousLocalToWorld, singleCaptureIndex, bOutputVelocity);
+			FDynamicPrimitiveUniformBuffer& uniformBuffer = collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
+			uniformBuffer.Set(GetLocalToWorld(), previousLocalToWorld, GetBounds(), GetLocalBounds(), true, bHasPrecomputedVolumetricLightmap, DrawsVelocity(), bOutputVelocity);
+
+			FMeshBatchElement& element = mesh.Elements[0];
+			element.IndexBuffer = &indexBuffer;
+			element.PrimitiveUniformBufferResource = &uniformBuffer.UniformBuffer;
+			element.FirstIndex = 0;
+			element.NumPrimitives = primitiveNum;
+			element.MinVertexIndex = 0;
+			element.MaxVertexIndex = vertexBuffers.PositionVertexBuffer.GetNumVertices() - 1;
+			collector.AddMesh(viewIndex, mesh);
+		}
+
+		FStaticMeshVertexBuffers vertexBuffers;
+		FDynamicMeshIndexBuffer32 triangleBuffer;
+		FDynamicMeshIndexBuffer32 lineBuffer;
+		FLocalVertexFactory vertexFactory;
+		UMaterialInterface* material = nullptr;
+		FMaterialRelevance materialRelevance;
+	};
+}
+
+UChFEAMeshComponent::UChFEAMeshComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UChFEAMeshComponent::OnRegister()
+{
+	Super::OnRegister();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void UChFEAMeshComponent::OnUnregister()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::OnUnregister();
+}
+
+void UChFEAMeshComponent::SetMesh(std::shared_ptr<chrono::fea::ChMesh> inMesh)
+{
+	mesh = inMesh;
+	bulkSurface.reset();
+	componentTransform = GetComponentTransform();
+	BuildTopology();
+	UpdateBounds();
+	MarkRenderStateDirty();
+}
+
+void UChFEAMeshComponent::BuildTopology()
+{
+	vertexPoints.Reset();
+	vertexFrames.Reset();
+	triangleIndices.Reset();
+	lineIndices.Reset();
+	restPositions.Reset();
+	restTangents.Reset();
+	localBounds.Init();
+	if (!mesh) {
+		return;
+	}
+
+	// Every node with a position is a vertex, whether or not an element draws it
+	TMap<chrono::fea::ChNodeFEAbase*, int32> vertexOfNode;
+	for (unsigned int i = 0; i < mesh->GetNnodes(); i++) {
+		std::shared_ptr<chrono::fea::ChNodeFEAbase> node = mesh->GetNode(i);
+		chrono::fea::ChNodeFEAxyz* point = dynamic_cast<chrono::fea::ChNodeFEAxyz*>(node.get());
+		chrono::fea::ChNodeFEAxyzrot* frame = point ? nullptr : dynamic_cast<chrono::fea::ChNodeFEAxyzrot*>(node.get());
+		if (!point && !frame) {
+			continue;
+		}
+		vertexOfNode.Add(node.get(), vertexPoints.Num());
+		vertexPoints.Add(point);
+		vertexFrames.Add(frame);
+		chrono::ChVector<> position = point ? point->GetPos() : frame->GetPos();
+		restPositions.Add(componentTransform.InverseTransformPosition(CHRONO_VEC_TO_FVECTOR(position)));
+	}
+
+	TArray<FVolumeFace> faces;
+	TMap<FFaceKey, int32> faceOfKey;
+	auto addFace = [&](const int32* corners, int32 cornerNum, const FVector& inside) {
+		FFaceKey key = MakeFaceKey(corners, cornerNum);
+		if (int32* existing = faceOfKey.Find(key)) {
+			faces[*existing].Count++;
+			return;
+		}
+		FVolumeFace face;
+		FMemory::Memcpy(face.Corners, corners, cornerNum * sizeof(int32));
+		face.CornerNum = cornerNum;
+		face.Inside = inside;
+		face.Count = 1;
+		faceOfKey.Add(key, faces.Add(face));
+	};
+
+	for (unsigned int e = 0; e < mesh->GetNelements(); e++) {
+		std::shared_ptr<chrono::fea::ChElementBase> element = mesh->GetElement(e);
+		const int32 nodeNum = element->GetNnodes();
+		int32 corners[8];
+		int32 cornerNum = 0;
+		for (int32 n = 0; n < nodeNum && cornerNum < 8; n++) {
+			const int32* vertex = vertexOfNode.Find(element->GetNodeN(n).get());
+			corners[cornerNum++] = vertex ? *vertex : INDEX_NONE;
+		}
+		auto cornersValid = [&](int32 count) {
+			if (cornerNum < count) {
+				return false;
+			}
+			for (int32 c = 0; c < count; c++) {
+				if (corners[c] == INDEX_NONE) {
+					return false;
+				}
+			}
+			return true;
+		};
+		auto centroid = [&](int32 count) {
+			FVector sum = FVector::ZeroVector;
+			for (int32 c = 0; c < count; c++) {
+				sum += restPositions[corners[c]];
+			}
+			return sum / count;
+		};
+
+		if (dynamic_cast<chrono::fea::ChElementBeam*>(element.get()) || nodeNum == 2) {
+			// Cables, beams and springs, one segment between consecutive nodes
+			for (int32 c = 0; c + 1 < cornerNum; c++) {
+				if (corners[c] != INDEX_NONE && corners[c + 1] != INDEX_NONE) {
+					lineIndices.Add(corners[c]);
+					lineIndices.Add(corners[c + 1]);
+				}
+			}
+		}
+		else if (dynamic_cast<chrono::fea::ChElementShell*>(element.get())) {
+			if (cornersValid(4)) {
+				triangleIndices.Append({ (uint32)corners[0], (uint32)corners[1], (uint32)corners[2] });
+				triangleIndices.Append({ (uint32)corners[0], (uint32)corners[2], (uint32)corners[3] });
+			}
+		}
+		else if (dynamic_cast<chrono::fea::ChElementTetrahedron*>(element.get())) {
+			// Higher order tetrahedra list their corners first
+			if (cornersValid(4)) {
+				FVector inside = centroid(4);
+				for (const int32 (&face)[3] : TetraFaces) {
+					int32 faceCorners[3] = { corners[face[0]], corners[face[1]], corners[face[2]] };
+					addFace(faceCorners, 3, inside);
+				}
+			}
+		}
+		else if (cornersValid(8)) {
+			// Bricks and hexahedra, corners first in the usual order
+			FVector inside = centroid(8);
+			for (const int32 (&face)[4] : HexaFaces) {
+				int32 faceCorners[4] = { corners[face[0]], corners[face[1]], corners[face[2]], corners[face[3]] };
+				addFace(faceCorners, 4, inside);
+			}
+		}
+	}
+
+	// Boundary faces, turned away from their element
+	for (const FVolumeFace& face : faces) {
+		if (face.Count != 1) {
+			continue;
+		}
+		for (int32 t = 0; t < face.CornerNum - 2; t++) {
+			int32 a = face.Corners[0];
+			int32 b = face.Corners[t + 1];
+			int32 c = face.Corners[t + 2];
+			FVector center = (restPositions[a] + restPositions[b] + restPositions[c]) / 3;
+			if ((TriangleNormal(restPositions[a], restPositions[b], restPositions[c]) | (center - face.Inside)) < 0) {
+				Swap(b, c);
+			}
+			triangleIndices.Append({ (uint32)a, (uint32)b, (uint32)c });
+		}
+	}
+
+	const int32 vertexNum = vertexPoints.Num();
+	vertexTriangleStart.Init(0, vertexNum + 1);
+	for (uint32 index : triangleIndices) {
+		vertexTriangleStart[index + 1]++;
+	}
+	for (int32 i = 0; i < vertexNum; i++) {
+		vertexTriangleStart[i + 1] += vertexTriangleStart[i];
+	}
+	vertexTriangles.SetNumUninitialized(triangleIndices.Num());
+	TArray<int32> fill(vertexTriangleStart.GetData(), vertexNum);
+	for (int32 i = 0; i < triangleIndices.Num(); i++) {
+		vertexTriangles[fill[triangleIndices[i]]++] = i / 3;
+	}
+
+	ComputeNormals(restPositions, restTangents);
+	localBounds = FBox(restPositions);
+}
+
+void UChFEAMeshComponent::ComputeNormals(const TArray<FVector>& positions, TArray<FPackedNormal>& outTangents) const
+{
+	const int32 num = positions.Num();
+	outTangents.SetNumUninitialized(num * 2);
+	ParallelFor(FMath::DivideAndRoundUp(num, VertexChunk), [&](int32 chunk) {
+		int32 end = FMath::Min(num, (chunk + 1) * VertexChunk);
+		for (int32 i = chunk * VertexChunk; i < end; i++) {
+			FVector normal = FVector::ZeroVector;
+			for (int32 k = vertexTriangleStart[i]; k < vertexTriangleStart[i + 1]; k++) {
+				const uint32* triangle = &triangleIndices[vertexTriangles[k] * 3];
+				normal += TriangleNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+			}
+			// Line only vertices face up
+			normal = normal.GetSafeNormal();
+			if (normal.IsZero()) {
+				normal = FVector::UpVector;
+			}
+			FVector tangentX, tangentY;
+			normal.FindBestAxisVectors(tangentX, tangentY);
+			outTangents[i * 2] = FPackedNormal(tangentX);
+			outTangents[i * 2 + 1] = FPackedNormal(FVector4(normal, 1.f));
+		}
+	});
+}
+
+std::shared_ptr<chrono::fea::ChContactSurface> UChFEAMeshComponent::GetBulkContactSurface(bool bSMC)
+{
+	if (bulkSurface || !mesh) {
+		return bulkSurface;
+	}
+	double radius = ContactRadius / CHRONO_SCALE;
+	if (ContactType == EChFEAContactType::NODE_CLOUD) {
+		auto cloud = std::make_shared<chrono::fea::ChContactSurfaceNodeCloud>(mesh.get());
+		cloud->AddAllNodes(radius);
+		bulkSurface = cloud;
+	}
+	else {
+		auto surface = std::make_shared<chrono::fea::ChContactSurfaceMesh>(mesh.get());
+		surface->AddFacesFromBoundary(radius);
+		bulkSurface = surface;
+	}
+	if (bSMC) {
+		bulkSurface->SetMaterialSurface(std::make_shared<chrono::ChMaterialSurfaceSMC>());
+	}
+	else {
+		bulkSurface->SetMaterialSurface(std::make_shared<chrono::ChMaterialSurfaceNSC>());
+	}
+	return bulkSurface;
+}
+
+FPrimitiveSceneProxy* UChFEAMeshComponent::CreateSceneProxy()
+{
+	if (restPositions.Num() == 0 || (triangleIndices.Num() == 0 && lineIndices.Num() == 0)) {
+		return nullptr;
+	}
+	return new FChFEAMeshSceneProxy(this, restPositions, restTangents, triangleIndices, lineIndices);
+}
+
+FBoxSphereBounds UChFEAMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!localBounds.IsValid) {
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.f);
+	}
+	return FBoxSphereBounds(localBounds).TransformBy(LocalToWorld);
+}
+
+void UChFEAMeshComponent::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	// Meshes built by other code may be in the system already
+	if (mesh && !mesh->GetSystem()) {
+		phySystem->Add(mesh);
+	}
+}
+
+void UChFEAMeshComponent::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	if (mesh && mesh->GetSystem() == phySystem.get()) {
+		phySystem->RemoveMesh(mesh);
+	}
+}
+
+void UChFEAMeshComponent::LatchPhysicsInput()
+{
+	componentTransform = GetComponentTransform();
+}
+
+void UChFEAMeshComponent::CacheVisualState()
+{
+	const int32 num = vertexPoints.Num();
+	if (!mesh || num == 0) {
+		return;
+	}
+	const bool bScalar = ScalarField != EChFEAScalarField::NONE;
+	cachedPositions.SetNumUninitialized(num, false);
+	if (bScalar) {
+		cachedUVs.SetNumZeroed(num * 2, false);
+	}
+	else {
+		cachedUVs.Reset();
+	}
+
+	const int32 chunkNum = FMath::DivideAndRoundUp(num, VertexChunk);
+	TArray<FBox> chunkBounds;
+	chunkBounds.Init(FBox(ForceInit), chunkNum);
+	ParallelFor(chunkNum, [&](int32 chunk) {
+		int32 end = FMath::Min(num, (chunk + 1) * VertexChunk);
+		for (int32 i = chunk * VertexChunk; i < end; i++) {
+			chrono::fea::ChNodeFEAxyz* point = vertexPoints[i];
+			chrono::fea::ChNodeFEAxyzrot* frame = vertexFrames[i];
+			chrono::ChVector<> position = point ? point->GetPos() : frame->GetPos();
+			cachedPositions[i] = componentTransform.InverseTransformPosition(CHRONO_VEC_TO_FVECTOR(position));
+			chunkBounds[chunk] += cachedPositions[i];
+			if (!bScalar) {
+				continue;
+			}
+			double value = 0;
+			if (ScalarField == EChFEAScalarField::SPEED) {
+				value = (point ? point->GetPos_dt() : frame->GetPos_dt()).Length();
+			}
+			else {
+				value = (position - (point ? point->GetX0() : frame->GetX0().GetPos())).Length();
+			}
+			cachedUVs[i * 2 + 1].X = (float)value;
+		}
+	});
+	cachedBounds.Init();
+	for (const FBox& box : chunkBounds) {
+		cachedBounds += box;
+	}
+
+	if (bRecomputeNormals) {
+		ComputeNormals(cachedPositions, cachedTangents);
+	}
+	else {
+		cachedTangents.Reset();
+	}
+	bVisualDirty = true;
+}
+
+void UChFEAMeshComponent::UpdateVisualAsset()
+{
+	if (!bVisualDirty) {
+		return;
+	}
+	bVisualDirty = false;
+	localBounds = cachedBounds;
+	UpdateBounds();
+	MarkRenderTransformDirty();
+
+	if (!SceneProxy) {
+		return;
+	}
+	FChFEAMeshSceneProxy* proxy = static_cast<FChFEAMeshSceneProxy*>(SceneProxy);
+	ENQUEUE_RENDER_COMMAND(ChFEAMeshUpload)([proxy, positions = MoveTemp(cachedPositions), tangents = MoveTemp(cachedTangents), uvs = MoveTemp(cachedUVs)](FRHICommandListImmediate& RHICmdList) {
+		proxy->Upload(positions, tangents, uvs);
+	});
+}
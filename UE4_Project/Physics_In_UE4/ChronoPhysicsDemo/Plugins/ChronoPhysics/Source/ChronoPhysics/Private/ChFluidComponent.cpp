@@ -0,0 +1,177 @@
+#include "ChFluidComponent.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "RenderingThread.h"
+#include "chrono_parallel/physics/ChSystemParallel.h"
+#include "chrono_parallel/physics/Ch3DOFContainer.h"
+#include "chrono_parallel/ChDataManager.h"
+#include "util.h"
+
+static_assert(sizeof(chrono::real3) == FChFluidParticleBuffer::Stride, "The particle buffer takes the real3 array as is");
+
+void FChFluidParticleBuffer::Upload(const TArray<uint8>& inPositions, int32 count)
+{
+	check(IsInRenderingThread());
+	particleCount = count;
+	if (count <= 0) {
+		return;
+	}
+	if (count > capacity) {
+		FRHIResourceCreateInfo createInfo;
+		positions = RHICreateStructuredBuffer(Stride, Stride * count, BUF_ShaderResource | BUF_Dynamic, createInfo);
+		positionsSRV = RHICreateShaderResourceView(positions);
+		capacity = count;
+	}
+	void* data = RHILockStructuredBuffer(positions, 0, Stride * count, RLM_WriteOnly);
+	FMemory::Memcpy(data, inPositions.GetData(), Stride * count);
+	RHIUnlockStructuredBuffer(positions);
+}
+
+void FChFluidParticleBuffer::ReleaseRHI()
+{
+	positionsSRV.SafeRelease();
+	positions.SafeRelease();
+	capacity = 0;
+	particleCount = 0;
+}
+
+UChFluidComponent::UChFluidComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UChFluidComponent::PhysicsObjectConstruct()
+{
+	// Lattice at twice the radius, the spacing the kernel radius is tuned for
+	seedPositions.Reset();
+	FTransform transform = GetComponentTransform();
+	float spacing = 2.f * ParticleRadius;
+	FVector half = Shape == EChFluidShape::SPHERE ? FVector(Extent.X) : Extent;
+	FIntVector counts(FMath::FloorToInt(2.f * half.X / spacing), FMath::FloorToInt(2.f * half.Y / spacing), FMath::FloorToInt(2.f * half.Z / spacing));
+	for (int32 z = 0; z < counts.Z; z++) {
+		for (int32 y = 0; y < counts.Y; y++) {
+			for (int32 x = 0; x < counts.X; x++) {
+				FVector local = -half + (FVector(x, y, z) + 0.5f) * spacing;
+				if (Shape == EChFluidShape::SPHERE && local.SizeSquared() > FMath::Square(Extent.X)) {
+					continue;
+				}
+				seedPositions.Add(transform.TransformPosition(local));
+			}
+		}
+	}
+}
+
+void UChFluidComponent::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	auto parallelSystem = std::dynamic_pointer_cast<chrono::ChSystemParallelNSC>(phySystem);
+	if (!parallelSystem) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: the fluid container needs the parallel NSC backend"), *GetName());
+		return;
+	}
+	// The system starts with a placeholder Ch3DOFContainer, only a fluid or particle container is taken
+	auto existing = parallelSystem->data_manager->node_container;
+	if (std::dynamic_pointer_cast<chrono::ChFluidContainer>(existing) || std::dynamic_pointer_cast<chrono::ChParticleContainer>(existing)) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: the system already has a 3DOF container"), *GetName());
+		return;
+	}
+
+	ChDataFluid = std::make_shared<chrono::ChFluidContainer>();
+	parallelSystem->Add3DOFContainer(ChDataFluid);
+	system = phySystem.get();
+	dataManager = parallelSystem->data_manager;
+
+	double radius = ParticleRadius / CHRONO_SCALE;
+	double kernelRadius = 2.0 * radius;
+	ChDataFluid->kernel_radius = kernelRadius;
+	ChDataFluid->rho = Density;
+	ChDataFluid->mass = Density * kernelRadius * kernelRadius * kernelRadius;
+	ChDataFluid->enable_viscosity = bEnableViscosity;
+	ChDataFluid->viscosity = Viscosity;
+	ChDataFluid->yield_stress = 0;
+	ChDataFluid->epsilon = Epsilon;
+	ChDataFluid->tau = RelaxationSteps * phySystem->GetStep();
+	ChDataFluid->contact_mu = 0;
+	ChDataFluid->contact_compliance = Compliance;
+	ChDataFluid->collision_envelope = kernelRadius * 0.05;
+	ChDataFluid->contact_recovery_speed = ContactRecoverySpeed / CHRONO_SCALE;
+	ChDataFluid->max_velocity = MaxSpeed / CHRONO_SCALE;
+	ChDataFluid->artificial_pressure = bArtificialPressure;
+	ChDataFluid->artificial_pressure_k = 0.01;
+	ChDataFluid->artificial_pressure_dq = 0.2 * kernelRadius;
+	ChDataFluid->artificial_pressure_n = 4;
+
+	std::vector<chrono::real3> positions;
+	positions.reserve(seedPositions.Num());
+	for (const FVector& position : seedPositions) {
+		chrono::ChVector<> chPosition = FVECTOR_TO_CHRONO_VEC(position);
+		positions.emplace_back(chPosition.x(), chPosition.y(), chPosition.z());
+	}
+	chrono::ChVector<> velocity = FVECTOR_TO_CHRONO_VEC(InitialVelocity);
+	std::vector<chrono::real3> velocities(positions.size(), chrono::real3(velocity.x(), velocity.y(), velocity.z()));
+	ChDataFluid->AddBodies(positions, velocities);
+}
+
+void UChFluidComponent::UpdatePhysicsState()
+{
+	// The relaxation time follows the step, which the scene may change between substeps
+	if (ChDataFluid && system) {
+		ChDataFluid->tau = RelaxationSteps * system->GetStep();
+	}
+}
+
+void UChFluidComponent::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	if (ChDataFluid) {
+		objList.Add(this);
+	}
+}
+
+void UChFluidComponent::CacheVisualState()
+{
+	if (!dataManager) {
+		return;
+	}
+	// Unsorted order, the index of a particle never changes
+	const auto& positions = dataManager->host_data.pos_3dof;
+	cachedCount = (int32)positions.size();
+	cachedPositions.SetNumUninitialized(cachedCount * FChFluidParticleBuffer::Stride, false);
+	FMemory::Memcpy(cachedPositions.GetData(), positions.data(), cachedCount * FChFluidParticleBuffer::Stride);
+	bPositionsDirty = true;
+}
+
+void UChFluidComponent::UpdateVisualAsset()
+{
+	if (!bPositionsDirty || !particleBuffer) {
+		return;
+	}
+	bPositionsDirty = false;
+	FChFluidParticleBuffer* buffer = particleBuffer;
+	int32 count = cachedCount;
+	ENQUEUE_RENDER_COMMAND(ChFluidUploadPositions)([buffer, positions = MoveTemp(cachedPositions), count](FRHICommandListImmediate& RHICmdList) {
+		buffer->Upload(positions, count);
+	});
+}
+
+void UChFluidComponent::OnRegister()
+{
+	Super::OnRegister();
+	FChPhysicsObjectRegistry::Register(this);
+	if (!particleBuffer) {
+		particleBuffer = new FChFluidParticleBuffer();
+		BeginInitResource(particleBuffer);
+	}
+}
+
+void UChFluidComponent::OnUnregister()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	if (particleBuffer) {
+		// Queued after the last upload, the buffer goes once the render thread is done with it
+		FChFluidParticleBuffer* buffer = particleBuffer;
+		BeginReleaseResource(buffer);
+		ENQUEUE_RENDER_COMMAND(ChFluidDeleteBuffer)([buffer](FRHICommandListImmediate& RHICmdList) {
+			delete buffer;
+		});
+		particleBuffer = nullptr;
+	}
+	Super::OnUnregister();
+}
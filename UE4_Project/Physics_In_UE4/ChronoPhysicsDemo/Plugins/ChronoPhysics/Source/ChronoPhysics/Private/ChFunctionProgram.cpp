@@ -0,0 +1,244 @@
+#include "ChFunctionProgram.h"
+#include "chrono/motion_functions/ChFunction_Const.h"
+#include "chrono/motion_functions/ChFunction_Ramp.h"
+#include "chrono/motion_functions/ChFunction_Sine.h"
+#include "chrono/motion_functions/ChFunction_Poly.h"
+#include "chrono/motion_functions/ChFunction_Operation.h"
+#include "Async/ParallelFor.h"
+
+namespace {
+	// Below this many drivers the batch is evaluated on the calling thread
+	const int32 ParallelDriverCount = 512;
+}
+
+void FChFunctionProgram::Compile(std::shared_ptr<chrono::ChFunction> function)
+{
+	instructions.Reset();
+	constants.Reset();
+	opaque.Reset();
+	subprograms.Reset();
+	if (function) {
+		Emit(function);
+	}
+	stackDepth = MaxStackDepth();
+}
+
+void FChFunctionProgram::Emit(const std::shared_ptr<chrono::ChFunction>& function)
+{
+	// Postorder, the operands are on the stack when their operation runs
+	switch (function->Get_Type()) {
+	case chrono::ChFunction::FUNCT_CONST:
+		instructions.Add({ EOp::Const, 0, std::static_pointer_cast<chrono::ChFunction_Const>(function)->Get_yconst(), 0, 0 });
+		return;
+	case chrono::ChFunction::FUNCT_RAMP: {
+		auto ramp = std::static_pointer_cast<chrono::ChFunction_Ramp>(function);
+		instructions.Add({ EOp::Ramp, 0, ramp->Get_y0(), ramp->Get_ang(), 0 });
+		return;
+	}
+	case chrono::ChFunction::FUNCT_SINE: {
+		auto sine = std::static_pointer_cast<chrono::ChFunction_Sine>(function);
+		instructions.Add({ EOp::Sine, 0, sine->Get_amp(), sine->Get_w(), sine->Get_phase() });
+		return;
+	}
+	case chrono::ChFunction::FUNCT_POLY: {
+		auto poly = std::static_pointer_cast<chrono::ChFunction_Poly>(function);
+		int32 offset = constants.Num();
+		for (int i = 0; i <= poly->Get_order(); i++) {
+			constants.Add(poly->Get_coeff(i));
+		}
+		instructions.Add({ EOp::Poly, offset, (double)poly->Get_order(), 0, 0 });
+		return;
+	}
+	case chrono::ChFunction::FUNCT_OPERATION: {
+		auto operation = std::static_pointer_cast<chrono::ChFunction_Operation>(function);
+		auto fa = operation->Get_fa();
+		auto fb = operation->Get_fb();
+		EOp op;
+		bool bBinary = true;
+		switch (operation->Get_optype()) {
+		case chrono::ChOP_ADD: op = EOp::Add; break;
+		case chrono::ChOP_SUB: op = EOp::Sub; break;
+		case chrono::ChOP_MUL: op = EOp::Mul; break;
+		case chrono::ChOP_DIV: op = EOp::Div; break;
+		case chrono::ChOP_MAX: op = EOp::Max; break;
+		case chrono::ChOP_MIN: op = EOp::Min; break;
+		case chrono::ChOP_FABS: op = EOp::Abs; bBinary = false; break;
+		case chrono::ChOP_FUNCT: op = EOp::Compose; break;
+		default:
+			// Pow and modulo stay with Chrono
+			op = EOp::Opaque;
+			break;
+		}
+		if (op == EOp::Opaque || !fa || (bBinary && !fb)) {
+			break;
+		}
+		if (op == EOp::Compose) {
+			// fa(fb(x)): fb goes on the stack, fa runs on its value
+			Emit(fb);
+			FChFunctionProgram& inner = subprograms.AddDefaulted_GetRef();
+			inner.Compile(fa);
+			instructions.Add({ EOp::Compose, subprograms.Num() - 1, 0, 0, 0 });
+			return;
+		}
+		Emit(fa);
+		if (bBinary) {
+			Emit(fb);
+		}
+		instructions.Add({ op, 0, 0, 0, 0 });
+		return;
+	}
+	default:
+		break;
+	}
+	opaque.Add(function);
+	instructions.Add({ EOp::Opaque, opaque.Num() - 1, 0, 0, 0 });
+}
+
+int32 FChFunctionProgram::MaxStackDepth() const
+{
+	int32 depth = 0;
+	int32 maxDepth = 0;
+	for (auto& instruction : instructions) {
+		switch (instruction.Op) {
+		case EOp::Add: case EOp::Sub: case EOp::Mul: case EOp::Div: case EOp::Max: case EOp::Min:
+			depth--;
+			break;
+		case EOp::Abs: case EOp::Compose:
+			break;
+		default:
+			depth++;
+			break;
+		}
+		maxDepth = FMath::Max(maxDepth, depth);
+	}
+	return maxDepth;
+}
+
+FChFunctionValue FChFunctionProgram::Evaluate(double x) const
+{
+	TArray<FChFunctionValue, TInlineAllocator<16>> stack;
+	stack.Reserve(stackDepth);
+	for (auto& instruction : instructions) {
+		switch (instruction.Op) {
+		case EOp::Const:
+			stack.Add({ instruction.A, 0, 0 });
+			break;
+		case EOp::Ramp:
+			stack.Add({ instruction.A + instruction.B * x, instruction.B, 0 });
+			break;
+		case EOp::Sine: {
+			// amp sin(w x + phase)
+			double angle = instruction.B * x + instruction.C;
+			double s = FMath::Sin(angle);
+			double c = FMath::Cos(angle);
+			stack.Add({ instruction.A * s, instruction.A * instruction.B * c, -instruction.A * instruction.B * instruction.B * s });
+			break;
+		}
+		case EOp::Poly: {
+			// Horner for the value and both derivatives at once
+			const double* coeff = constants.GetData() + instruction.Operand;
+			int32 order = (int32)instruction.A;
+			FChFunctionValue value;
+			for (int32 i = order; i >= 0; i--) {
+				value.Ddy = value.Ddy * x + 2 * value.Dy;
+				value.Dy = value.Dy * x + value.Y;
+				value.Y = value.Y * x + coeff[i];
+			}
+			stack.Add(value);
+			break;
+		}
+		case EOp::Opaque: {
+			const chrono::ChFunction& function = *opaque[instruction.Operand];
+			stack.Add({ function.Get_y(x), function.Get_y_dx(x), function.Get_y_dxdx(x) });
+			break;
+		}
+		case EOp::Abs: {
+			FChFunctionValue& a = stack.Last();
+			if (a.Y < 0) {
+				a = { -a.Y, -a.Dy, -a.Ddy };
+			}
+			break;
+		}
+		case EOp::Compose: {
+			// g(u(x)): g' = g'(u) u', g'' = g''(u) u'^2 + g'(u) u''
+			FChFunctionValue& u = stack.Last();
+			FChFunctionValue g = subprograms[instruction.Operand].Evaluate(u.Y);
+			u = { g.Y, g.Dy * u.Dy, g.Ddy * u.Dy * u.Dy + g.Dy * u.Ddy };
+			break;
+		}
+		default: {
+			FChFunctionValue b = stack.Pop(false);
+			FChFunctionValue& a = stack.Last();
+			switch (instruction.Op) {
+			case EOp::Add:
+				a = { a.Y + b.Y, a.Dy + b.Dy, a.Ddy + b.Ddy };
+				break;
+			case EOp::Sub:
+				a = { a.Y - b.Y, a.Dy - b.Dy, a.Ddy - b.Ddy };
+				break;
+			case EOp::Mul:
+				a = { a.Y * b.Y, a.Dy * b.Y + a.Y * b.Dy, a.Ddy * b.Y + 2 * a.Dy * b.Dy + a.Y * b.Ddy };
+				break;
+			case EOp::Div: {
+				double q = a.Y / b.Y;
+				double dq = (a.Dy - q * b.Dy) / b.Y;
+				a = { q, dq, (a.Ddy - 2 * dq * b.Dy - q * b.Ddy) / b.Y };
+				break;
+			}
+			case EOp::Max:
+				a = a.Y >= b.Y ? a : b;
+				break;
+			case EOp::Min:
+				a = a.Y <= b.Y ? a : b;
+				break;
+			default:
+				break;
+			}
+			break;
+		}
+		}
+	}
+	return stack.Num() ? stack.Last() : FChFunctionValue();
+}
+
+int32 FChFunctionBatch::Add(std::shared_ptr<chrono::ChFunction> function)
+{
+	programs.AddDefaulted_GetRef().Compile(function);
+	FChFunctionValue value = programs.Last().Evaluate(currentX);
+	current.Add(value);
+	previous.Add(value);
+	return programs.Num() - 1;
+}
+
+void FChFunctionBatch::Reset()
+{
+	programs.Reset();
+	current.Reset();
+	previous.Reset();
+	currentX = TNumericLimits<double>::Lowest();
+	previousX = TNumericLimits<double>::Lowest();
+}
+
+void FChFunctionBatch::Advance(double x)
+{
+	if (x == currentX) {
+		return;
+	}
+	Swap(current, previous);
+	previousX = currentX;
+	currentX = x;
+	ParallelFor(programs.Num(), [this, x](int32 i) {
+		current[i] = programs[i].Evaluate(x);
+	}, programs.Num() < ParallelDriverCount);
+}
+
+FChFunctionValue FChFunctionBatch::Get(int32 slot, double x) const
+{
+	if (x == currentX) {
+		return current[slot];
+	}
+	if (x == previousX) {
+		return previous[slot];
+	}
+	return programs[slot].Evaluate(x);
+}
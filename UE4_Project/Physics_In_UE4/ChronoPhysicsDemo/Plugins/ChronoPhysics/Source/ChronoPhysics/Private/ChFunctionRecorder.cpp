@@ -0,0 +1,111 @@
+#include "ChFunctionRecorder.h"
+#include <algorithm>
+
+namespace {
+	// Chrono's recorder treats arguments this close as the same point
+	const double SameArgument = 1e-9;
+}
+
+FChFunctionRecorder::FChFunctionRecorder(const FChFunctionRecorder& other)
+	: ChFunction(other)
+	, points(other.points)
+{
+}
+
+void FChFunctionRecorder::AddPoint(double x, double y, double w)
+{
+	if (points.empty() || x > points.back().x + SameArgument) {
+		points.emplace_back(x, y, w);
+		return;
+	}
+	auto it = std::lower_bound(points.begin(), points.end(), x - SameArgument, [](const chrono::ChRecPoint& point, double value) {
+		return point.x < value;
+	});
+	if (it != points.end() && FMath::Abs(it->x - x) <= SameArgument) {
+		*it = chrono::ChRecPoint(x, y, w);
+	}
+	else {
+		points.insert(it, chrono::ChRecPoint(x, y, w));
+	}
+	lastInterval = 0;
+}
+
+void FChFunctionRecorder::Reset()
+{
+	points.clear();
+	lastInterval = 0;
+}
+
+size_t FChFunctionRecorder::FindInterval(double x) const
+{
+	size_t last = points.size() - 2;
+	size_t i = FMath::Min(lastInterval, last);
+	if (points[i].x <= x && x < points[i + 1].x) {
+		return i;
+	}
+	// Monotonic queries mostly land in the next interval
+	if (i < last && points[i + 1].x <= x && x < points[i + 2].x) {
+		return lastInterval = i + 1;
+	}
+	auto it = std::upper_bound(points.begin(), points.end(), x, [](double value, const chrono::ChRecPoint& point) {
+		return value < point.x;
+	});
+	size_t found = (size_t)(it - points.begin());
+	lastInterval = found > 0 ? FMath::Min(found - 1, last) : 0;
+	return lastInterval;
+}
+
+double FChFunctionRecorder::Get_y(double x) const
+{
+	if (points.empty()) {
+		return 0;
+	}
+	if (x <= points.front().x) {
+		return points.front().y;
+	}
+	if (x >= points.back().x) {
+		return points.back().y;
+	}
+	size_t i = FindInterval(x);
+	const chrono::ChRecPoint& a = points[i];
+	const chrono::ChRecPoint& b = points[i + 1];
+	return a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x);
+}
+
+double FChFunctionRecorder::Get_y_dx(double x) const
+{
+	if (points.size() < 2 || x < points.front().x || x >= points.back().x) {
+		return 0;
+	}
+	size_t i = FindInterval(x);
+	const chrono::ChRecPoint& a = points[i];
+	const chrono::ChRecPoint& b = points[i + 1];
+	return (b.y - a.y) / (b.x - a.x);
+}
+
+void FChFunctionRecorder::Estimate_x_range(double& xmin, double& xmax) const
+{
+	if (points.empty()) {
+		xmin = 0.0;
+		xmax = 1.2;
+		return;
+	}
+	xmin = points.front().x;
+	xmax = points.back().x;
+	if (xmin == xmax) {
+		xmax = xmin + 0.5;
+	}
+}
+
+void FChFunctionRecorder::ArchiveOUT(chrono::ChArchiveOut& marchive)
+{
+	ChFunction::ArchiveOUT(marchive);
+	marchive << chrono::make_ChNameValue("points", points);
+}
+
+void FChFunctionRecorder::ArchiveIN(chrono::ChArchiveIn& marchive)
+{
+	ChFunction::ArchiveIN(marchive);
+	marchive >> chrono::make_ChNameValue("points", points);
+	lastInterval = 0;
+}
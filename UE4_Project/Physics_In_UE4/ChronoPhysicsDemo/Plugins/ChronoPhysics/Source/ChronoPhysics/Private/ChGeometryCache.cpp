@@ -0,0 +1,266 @@
+#include "ChGeometryCache.h"
+#include "ChBatchConvert.h"
+#include "ProceduralMeshComponent.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+
+namespace {
+	const uint32 GeometryCacheMagic = 0x4F454748;
+	const uint32 GeometryCacheVersion = 1;
+	const uint8 BlockTypeFloat = 0;
+	const uint8 BlockTypeInt = 1;
+	const uint8 CompressionZlib = 1;
+	const int32 BlockNameSize = 16;
+
+	template<typename T>
+	bool ReadValue(const uint8* data, int64 dataSize, int64& offset, T& value)
+	{
+		if (offset + (int64)sizeof(T) > dataSize) {
+			return false;
+		}
+		FMemory::Memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+}
+
+FChGeometryCacheReader::~FChGeometryCacheReader()
+{
+	Close();
+}
+
+bool FChGeometryCacheReader::Open(const FString& filePath)
+{
+	Close();
+
+	mappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filePath);
+	if (mappedFile) {
+		mappedRegion = mappedFile->MapRegion();
+	}
+	if (mappedRegion) {
+		data = mappedRegion->GetMappedPtr();
+		dataSize = mappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(loadedData, *filePath, FILEREAD_Silent)) {
+		data = loadedData.GetData();
+		dataSize = loadedData.Num();
+	}
+	else {
+		Close();
+		return false;
+	}
+	return Parse();
+}
+
+bool FChGeometryCacheReader::OpenMemory(TArray<uint8>&& fileData)
+{
+	Close();
+	loadedData = MoveTemp(fileData);
+	data = loadedData.GetData();
+	dataSize = loadedData.Num();
+	return Parse();
+}
+
+void FChGeometryCacheReader::Close()
+{
+	delete mappedRegion;
+	mappedRegion = nullptr;
+	delete mappedFile;
+	mappedFile = nullptr;
+	loadedData.Empty();
+	data = nullptr;
+	dataSize = 0;
+
+	frame = 0.f;
+	pointCount = 0;
+	indexCount = 0;
+	blocks.Empty();
+	indicesInRange.Reset();
+}
+
+bool FChGeometryCacheReader::Parse()
+{
+	int64 offset = 0;
+	uint32 magic, version;
+	int32 blockCount;
+	if (!ReadValue(data, dataSize, offset, magic) ||
+		!ReadValue(data, dataSize, offset, version) ||
+		!ReadValue(data, dataSize, offset, frame) ||
+		!ReadValue(data, dataSize, offset, pointCount) ||
+		!ReadValue(data, dataSize, offset, indexCount) ||
+		!ReadValue(data, dataSize, offset, blockCount) ||
+		magic != GeometryCacheMagic || version != GeometryCacheVersion ||
+		pointCount < 0 || indexCount < 0 || blockCount < 0) {
+		Close();
+		return false;
+	}
+
+	blocks.SetNum(blockCount);
+	for (FBlock& block : blocks) {
+		ANSICHAR name[BlockNameSize + 1] = { 0 };
+		uint8 pad8;
+		uint32 pad32;
+		if (offset + BlockNameSize > dataSize) {
+			Close();
+			return false;
+		}
+		FMemory::Memcpy(name, data + offset, BlockNameSize);
+		offset += BlockNameSize;
+		if (!ReadValue(data, dataSize, offset, block.type) ||
+			!ReadValue(data, dataSize, offset, block.width) ||
+			!ReadValue(data, dataSize, offset, block.compression) ||
+			!ReadValue(data, dataSize, offset, pad8) ||
+			!ReadValue(data, dataSize, offset, pad32) ||
+			!ReadValue(data, dataSize, offset, block.offset) ||
+			!ReadValue(data, dataSize, offset, block.storedSize) ||
+			!ReadValue(data, dataSize, offset, block.rawSize) ||
+			block.offset < 0 || block.storedSize < 0 || block.offset + block.storedSize > dataSize) {
+			Close();
+			return false;
+		}
+		block.name = FName(ANSI_TO_TCHAR(name));
+	}
+	return true;
+}
+
+const uint8* FChGeometryCacheReader::Decode(FBlock& block)
+{
+	if (block.compression != CompressionZlib) {
+		return block.rawSize == block.storedSize ? data + block.offset : nullptr;
+	}
+	if (block.decoded.Num() != block.rawSize) {
+		block.decoded.SetNumUninitialized(block.rawSize, false);
+		if (!FCompression::UncompressMemory(NAME_Zlib, block.decoded.GetData(), block.rawSize, data + block.offset, block.storedSize)) {
+			block.decoded.Empty();
+			return nullptr;
+		}
+	}
+	return block.decoded.GetData();
+}
+
+const uint8* FChGeometryCacheReader::GetBlock(FName name, uint8 type, int32 width, int64 count)
+{
+	for (FBlock& block : blocks) {
+		if (block.name == name) {
+			if (block.type != type || block.width != width || block.rawSize != count * width * 4) {
+				return nullptr;
+			}
+			return Decode(block);
+		}
+	}
+	return nullptr;
+}
+
+const float* FChGeometryCacheReader::GetFloatAttribute(FName name, int32 width)
+{
+	return reinterpret_cast<const float*>(GetBlock(name, BlockTypeFloat, width, pointCount));
+}
+
+const int32* FChGeometryCacheReader::GetIntAttribute(FName name, int32 width)
+{
+	return reinterpret_cast<const int32*>(GetBlock(name, BlockTypeInt, width, pointCount));
+}
+
+const int32* FChGeometryCacheReader::GetIndices()
+{
+	static const FName IndexName(TEXT("__index"));
+	const int32* indices = reinterpret_cast<const int32*>(GetBlock(IndexName, BlockTypeInt, 1, indexCount));
+	if (indices && !indicesInRange.IsSet()) {
+		// A truncated or foreign file would otherwise index past the vertex arrays of the mesh it is copied into
+		bool bInRange = true;
+		for (int32 i = 0; i < indexCount && bInRange; i++) {
+			bInRange = (uint32)indices[i] < (uint32)pointCount;
+		}
+		indicesInRange = bInRange;
+	}
+	return indices && indicesInRange.GetValue() ? indices : nullptr;
+}
+
+bool FChGeometryCacheReader::DecodeAll()
+{
+	for (FBlock& block : blocks) {
+		if (!Decode(block)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FChGeometryCacheReader::ConvertToMesh(FChGeometryCacheMesh& outMesh)
+{
+	const float* positions = GetFloatAttribute(TEXT("P"), 3);
+	const int32* indices = GetIndices();
+	if (!positions || !indices) {
+		return false;
+	}
+	const float* normals = GetFloatAttribute(TEXT("N"), 3);
+	const float* colors = GetFloatAttribute(TEXT("Cd"), 3);
+	outMesh.Frame = frame;
+
+	// Same swap as between UE and Chrono, Houdini's Y up is UE's Z
+	outMesh.Vertices.SetNumUninitialized(pointCount, false);
+	FVector* vertices = outMesh.Vertices.GetData();
+	ChBatchConvert::ForChunks(pointCount, [=](int32 begin, int32 end) {
+		for (int32 i = begin; i < end; i++) {
+			vertices[i] = FVector(positions[i * 3 + 0], positions[i * 3 + 2], positions[i * 3 + 1]) * CHRONO_SCALE;
+		}
+	});
+
+	outMesh.Normals.SetNumUninitialized(normals ? pointCount : 0, false);
+	for (int32 i = 0; i < outMesh.Normals.Num(); i++) {
+		outMesh.Normals[i] = FVector(normals[i * 3 + 0], normals[i * 3 + 2], normals[i * 3 + 1]);
+	}
+
+	outMesh.Colors.SetNumUninitialized(colors ? pointCount : 0, false);
+	for (int32 i = 0; i < outMesh.Colors.Num(); i++) {
+		outMesh.Colors[i] = FLinearColor(colors[i * 3 + 0], colors[i * 3 + 1], colors[i * 3 + 2]);
+	}
+
+	// Mirroring the axes turns Houdini's clockwise front faces counter clockwise, the swap restores UE's
+	outMesh.Triangles.SetNumUninitialized(indexCount - indexCount % 3, false);
+	for (int32 i = 0; i < outMesh.Triangles.Num(); i += 3) {
+		outMesh.Triangles[i + 0] = indices[i + 0];
+		outMesh.Triangles[i + 1] = indices[i + 2];
+		outMesh.Triangles[i + 2] = indices[i + 1];
+	}
+	return true;
+}
+
+bool FChGeometryCacheReader::CopyToProceduralMesh(UProceduralMeshComponent* mesh, int32 section, bool bCreateCollision)
+{
+	FChGeometryCacheMesh converted;
+	if (!mesh || !ConvertToMesh(converted)) {
+		return false;
+	}
+	mesh->CreateMeshSection_LinearColor(section, converted.Vertices, converted.Triangles, converted.Normals, TArray<FVector2D>(), converted.Colors, TArray<FProcMeshTangent>(), bCreateCollision);
+	return true;
+}
+
+bool FChGeometryCacheReader::CopyToChronoMesh(chrono::geometry::ChTriangleMeshConnected& mesh)
+{
+	const float* positions = GetFloatAttribute(TEXT("P"), 3);
+	const int32* indices = GetIndices();
+	if (!positions || !indices) {
+		return false;
+	}
+
+	auto& vertices = mesh.getCoordsVertices();
+	vertices.resize(pointCount);
+	double* out = pointCount ? &vertices[0][0] : nullptr;
+	ChBatchConvert::ForChunks(pointCount * 3, [=](int32 begin, int32 end) {
+		for (int32 i = begin; i < end; i++) {
+			out[i] = positions[i];
+		}
+	});
+
+	// Chrono's front faces are counter clockwise in the same right handed frame
+	auto& faces = mesh.getIndicesVertexes();
+	faces.resize(indexCount / 3);
+	for (int32 i = 0; i < (int32)faces.size(); i++) {
+		faces[i] = chrono::ChVector<int>(indices[i * 3 + 0], indices[i * 3 + 2], indices[i * 3 + 1]);
+	}
+	return true;
+}
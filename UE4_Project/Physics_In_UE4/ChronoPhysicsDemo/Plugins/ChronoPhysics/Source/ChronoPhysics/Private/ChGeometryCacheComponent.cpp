@@ -0,0 +1,81 @@
+#include "ChGeometryCacheComponent.h"
+#include "ChGeometryCacheStream.h"
+#include "Misc/Paths.h"
+
+UChGeometryCacheComponent::UChGeometryCacheComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void UChGeometryCacheComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FString pattern = FPaths::IsRelative(FilePattern) ? FPaths::Combine(FPaths::ProjectDir(), FilePattern) : FilePattern;
+	stream = MakeUnique<FChGeometryCacheStream>(pattern, FramePadding, StartFrame, EndFrame, ReadAhead);
+	playbackTime = 0.f;
+	currentFrame = INDEX_NONE;
+	stalls = 0;
+	stream->SetPlayhead(StartFrame, bLoop);
+}
+
+void UChGeometryCacheComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	stream.Reset();
+	shownMesh.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void UChGeometryCacheComponent::SetPlaybackTime(float seconds)
+{
+	playbackTime = FMath::Max(seconds, 0.f);
+}
+
+int32 UChGeometryCacheComponent::GetFrameAt(float seconds) const
+{
+	int32 frameCount = FMath::Max(EndFrame - StartFrame + 1, 1);
+	int32 offset = FMath::FloorToInt(seconds * FrameRate);
+	offset = bLoop ? offset % frameCount : FMath::Min(offset, frameCount - 1);
+	return StartFrame + offset;
+}
+
+void UChGeometryCacheComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (!stream) {
+		return;
+	}
+
+	if (bPlaying) {
+		playbackTime += DeltaTime;
+	}
+	int32 frame = GetFrameAt(playbackTime);
+	stream->SetPlayhead(frame, bLoop);
+	if (frame == currentFrame) {
+		return;
+	}
+
+	if (TUniquePtr<FChGeometryCacheMesh> mesh = stream->Take(frame)) {
+		currentFrame = frame;
+		ShowFrame(MoveTemp(mesh));
+	}
+	else {
+		stalls++;
+	}
+}
+
+void UChGeometryCacheComponent::ShowFrame(TUniquePtr<FChGeometryCacheMesh> mesh)
+{
+	// Same topology only moves the vertices, the index buffer and collision setup stay
+	bool bSameTopology = shownMesh && GetNumSections() > 0
+		&& shownMesh->Vertices.Num() == mesh->Vertices.Num() && shownMesh->Triangles == mesh->Triangles;
+	if (bSameTopology) {
+		UpdateMeshSection_LinearColor(0, mesh->Vertices, mesh->Normals, TArray<FVector2D>(), mesh->Colors, TArray<FProcMeshTangent>());
+	}
+	else {
+		CreateMeshSection_LinearColor(0, mesh->Vertices, mesh->Triangles, mesh->Normals, TArray<FVector2D>(), mesh->Colors, TArray<FProcMeshTangent>(), bCreateCollision);
+	}
+
+	stream->Recycle(MoveTemp(shownMesh));
+	shownMesh = MoveTemp(mesh);
+}
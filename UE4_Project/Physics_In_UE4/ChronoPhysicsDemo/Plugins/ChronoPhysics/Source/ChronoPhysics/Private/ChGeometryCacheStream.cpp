@@ -0,0 +1,208 @@
+#include "ChGeometryCacheStream.h"
+#include "Async/Async.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
+
+namespace {
+	// Seconds before a frame that failed is read again
+	const double FailedFrameRetryDelay = 0.5;
+}
+
+FChGeometryCacheStream::FChGeometryCacheStream(const FString& inFilePattern, int32 inFramePadding, int32 inFirstFrame, int32 inLastFrame, int32 inReadAhead)
+	: filePattern(inFilePattern)
+	, framePadding(FMath::Max(inFramePadding, 0))
+	, firstFrame(inFirstFrame)
+	, lastFrame(FMath::Max(inFirstFrame, inLastFrame))
+	, readAhead(FMath::Clamp(inReadAhead, 1, lastFrame - firstFrame + 1))
+	, playhead(inFirstFrame)
+{
+	wakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	thread = FRunnableThread::Create(this, TEXT("ChGeometryCacheIO"), 0, TPri_BelowNormal);
+}
+
+FChGeometryCacheStream::~FChGeometryCacheStream()
+{
+	if (thread) {
+		thread->Kill(true);
+		delete thread;
+	}
+	// The decode tasks write into this object
+	while (pendingTasks.GetValue() > 0) {
+		FPlatformProcess::Sleep(0.001f);
+	}
+	FPlatformProcess::ReturnSynchEventToPool(wakeEvent);
+}
+
+FString FChGeometryCacheStream::GetFramePath(int32 frame) const
+{
+	FString number = FString::FromInt(frame);
+	if (number.Len() < framePadding) {
+		number = FString::ChrN(framePadding - number.Len(), TEXT('0')) + number;
+	}
+	return filePattern.Replace(TEXT("{frame}"), *number);
+}
+
+void FChGeometryCacheStream::SetPlayhead(int32 frame, bool bLoop)
+{
+	{
+		FScopeLock scopeLock(&lock);
+		frame = FMath::Clamp(frame, firstFrame, lastFrame);
+		if (frame == playhead && bLoop == bLooping) {
+			return;
+		}
+		playhead = frame;
+		bLooping = bLoop;
+	}
+	wakeEvent->Trigger();
+}
+
+TUniquePtr<FChGeometryCacheMesh> FChGeometryCacheStream::Take(int32 frame)
+{
+	TUniquePtr<FChGeometryCacheMesh> mesh;
+	{
+		FScopeLock scopeLock(&lock);
+		TUniquePtr<FChGeometryCacheMesh>* found = ready.Find(frame);
+		if (!found) {
+			return nullptr;
+		}
+		mesh = MoveTemp(*found);
+		ready.Remove(frame);
+		taken = frame;
+	}
+	// A slot of the window opened up
+	wakeEvent->Trigger();
+	return mesh;
+}
+
+void FChGeometryCacheStream::Recycle(TUniquePtr<FChGeometryCacheMesh> mesh)
+{
+	if (mesh) {
+		FScopeLock scopeLock(&lock);
+		pool.Add(MoveTemp(mesh));
+	}
+}
+
+void FChGeometryCacheStream::GetWantedFrames(TArray<int32>& outFrames) const
+{
+	outFrames.Reset();
+	for (int32 i = 0; i < readAhead; i++) {
+		int32 frame = playhead + i;
+		if (frame > lastFrame) {
+			if (!bLooping) {
+				break;
+			}
+			frame -= lastFrame - firstFrame + 1;
+		}
+		outFrames.Add(frame);
+	}
+}
+
+bool FChGeometryCacheStream::IsWanted(int32 frame) const
+{
+	int32 distance = frame - playhead;
+	if (distance < 0 && bLooping) {
+		distance += lastFrame - firstFrame + 1;
+	}
+	return distance >= 0 && distance < readAhead;
+}
+
+uint32 FChGeometryCacheStream::Run()
+{
+	TArray<int32> wanted;
+	TArray<int32> evicted;
+	while (stopping.GetValue() == 0) {
+		int32 next = INDEX_NONE;
+		{
+			FScopeLock scopeLock(&lock);
+			// Frames behind the playhead or past the window after a seek are not shown any more
+			evicted.Reset();
+			for (auto& pair : ready) {
+				if (!IsWanted(pair.Key)) {
+					evicted.Add(pair.Key);
+				}
+			}
+			for (int32 frame : evicted) {
+				pool.Add(MoveTemp(ready[frame]));
+				ready.Remove(frame);
+			}
+
+			// Nearest first, so a seek shows something as soon as possible
+			GetWantedFrames(wanted);
+			const double now = FPlatformTime::Seconds();
+			for (int32 frame : wanted) {
+				const double* retryTime = failed.Find(frame);
+				if (retryTime && *retryTime > now) {
+					continue;
+				}
+				if (!ready.Contains(frame) && !inFlight.Contains(frame) && frame != taken) {
+					next = frame;
+					inFlight.Add(frame);
+					failed.Remove(frame);
+					break;
+				}
+			}
+		}
+
+		if (next == INDEX_NONE) {
+			wakeEvent->Wait(100);
+			continue;
+		}
+
+		TArray<uint8> fileData;
+		if (!FFileHelper::LoadFileToArray(fileData, *GetFramePath(next), FILEREAD_Silent)) {
+			FScopeLock scopeLock(&lock);
+			inFlight.Remove(next);
+			MarkFailed(next);
+			continue;
+		}
+
+		pendingTasks.Increment();
+		Async<void>(EAsyncExecution::ThreadPool, [this, next, fileData = MoveTemp(fileData)]() mutable {
+			Decode(next, MoveTemp(fileData));
+			pendingTasks.Decrement();
+		});
+	}
+	return 0;
+}
+
+void FChGeometryCacheStream::Stop()
+{
+	stopping.Set(1);
+	wakeEvent->Trigger();
+}
+
+void FChGeometryCacheStream::Decode(int32 frame, TArray<uint8>&& fileData)
+{
+	TUniquePtr<FChGeometryCacheMesh> mesh;
+	{
+		FScopeLock scopeLock(&lock);
+		mesh = pool.Num() ? pool.Pop(false) : MakeUnique<FChGeometryCacheMesh>();
+	}
+
+	FChGeometryCacheReader reader;
+	bool bConverted = reader.OpenMemory(MoveTemp(fileData)) && reader.ConvertToMesh(*mesh);
+
+	FScopeLock scopeLock(&lock);
+	inFlight.Remove(frame);
+	if (!bConverted) {
+		MarkFailed(frame);
+		pool.Add(MoveTemp(mesh));
+	}
+	else if (IsWanted(frame)) {
+		ready.Add(frame, MoveTemp(mesh));
+	}
+	else {
+		// The playhead moved on while the frame was being decoded
+		pool.Add(MoveTemp(mesh));
+	}
+	wakeEvent->Trigger();
+}
+
+void FChGeometryCacheStream::MarkFailed(int32 frame)
+{
+	failedFrames.Increment();
+	failed.Add(frame, FPlatformTime::Seconds() + FailedFrameRetryDelay);
+}
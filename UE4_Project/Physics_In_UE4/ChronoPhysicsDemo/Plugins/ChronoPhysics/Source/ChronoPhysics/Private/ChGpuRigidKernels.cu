@@ -0,0 +1,897 @@
+// UBT doesn't compile .cu files, nvcc builds this into Lib/ChronoPhysicsCuda.lib:
+//   nvcc -c -O3 -Xcompiler /MD -I../Include -o ChGpuRigidKernels.obj ChGpuRigidKernels.cu
+//   lib /OUT:../Lib/ChronoPhysicsCuda.lib ChGpuRigidKernels.obj
+// ChronoPhysics.Build.cs links it with cudart when CUDA_PATH is set and the library exists
+
+#include "ChGpuRigidKernels.h"
+#include "chrono_parallel/ChCudaDefines.h"
+#include "chrono_parallel/ChCudaHelper.cuh"
+#include "chrono_parallel/ChGPUVector.cuh"
+#include <thrust/sort.h>
+#include <thrust/execution_policy.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using chrono::gpu_vector;
+
+namespace ChGpuRigid {
+
+namespace {
+	const int32_t PowerIterations = 8;
+	// Bodies larger than this many median radii skip the grid and are tested against every body
+	const float LargeRadiusFactor = 4.f;
+
+	struct FScalars
+	{
+		int32_t ContactCount;
+		int32_t Dropped;
+		float Theta;
+		float Beta;
+		// g . (x_next - x) of the iteration, positive restarts the momentum
+		float Dot;
+		float Norm;
+		float InvLipschitz;
+	};
+
+	// Pos.w is the inverse mass, Vel.w the friction, Extent.w the bounding radius
+	struct FBodyView
+	{
+		float4* Pos;
+		float4* Rot;
+		float4* Vel;
+		float4* AngVel;
+		const float4* InvInertia;
+		const float4* Extent;
+		// Shape, group | mask << 16
+		const int2* Filter;
+		const float2* Limits;
+		float3* DeltaV;
+		float3* DeltaW;
+	};
+
+	// Points are world positions until PrepareContacts turns them into offsets from the body centers
+	struct FContactView
+	{
+		int2* Bodies;
+		// w is the signed distance
+		float4* Normal;
+		// PointA.w is the friction
+		float4* PointA;
+		float4* PointB;
+		float4* U;
+		float4* V;
+		FScalars* Scalars;
+		int32_t Capacity;
+	};
+
+	CUDA_HOST_DEVICE inline float3 operator+(const float3& a, const float3& b) { return make_float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	CUDA_HOST_DEVICE inline float3 operator-(const float3& a, const float3& b) { return make_float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	CUDA_HOST_DEVICE inline float3 operator-(const float3& a) { return make_float3(-a.x, -a.y, -a.z); }
+	CUDA_HOST_DEVICE inline float3 operator*(const float3& a, float s) { return make_float3(a.x * s, a.y * s, a.z * s); }
+	CUDA_HOST_DEVICE inline float3 operator*(float s, const float3& a) { return a * s; }
+	CUDA_HOST_DEVICE inline float3 Mul(const float3& a, const float3& b) { return make_float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+	CUDA_HOST_DEVICE inline float Dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	CUDA_HOST_DEVICE inline float3 Cross(const float3& a, const float3& b) { return make_float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	CUDA_HOST_DEVICE inline float Length(const float3& a) { return sqrtf(Dot(a, a)); }
+	CUDA_HOST_DEVICE inline float3 Xyz(const float4& a) { return make_float3(a.x, a.y, a.z); }
+	CUDA_HOST_DEVICE inline float4 Make4(const float3& a, float w) { return make_float4(a.x, a.y, a.z, w); }
+	CUDA_HOST_DEVICE inline float Get(const float3& a, int i) { return i == 0 ? a.x : (i == 1 ? a.y : a.z); }
+	CUDA_HOST_DEVICE inline void Set(float3& a, int i, float value) { if (i == 0) a.x = value; else if (i == 1) a.y = value; else a.z = value; }
+
+	// Quaternions keep the vector part in xyz and the scalar in w
+	CUDA_HOST_DEVICE inline float3 Rotate(const float4& q, const float3& v)
+	{
+		float3 u = Xyz(q);
+		float3 t = 2.f * Cross(u, v);
+		return v + q.w * t + Cross(u, t);
+	}
+
+	CUDA_HOST_DEVICE inline float3 RotateInverse(const float4& q, const float3& v)
+	{
+		return Rotate(make_float4(-q.x, -q.y, -q.z, q.w), v);
+	}
+
+	CUDA_DEVICE inline float3 ApplyInvInertia(const float4& q, const float4& invInertia, const float3& torque)
+	{
+		return Rotate(q, Mul(Xyz(invInertia), RotateInverse(q, torque)));
+	}
+
+	CUDA_DEVICE inline int3 CellOf(const float3& p, float cellSize)
+	{
+		return make_int3((int)floorf(p.x / cellSize), (int)floorf(p.y / cellSize), (int)floorf(p.z / cellSize));
+	}
+
+	CUDA_DEVICE inline uint32_t HashCell(const int3& cell, uint32_t mask)
+	{
+		return ((uint32_t)cell.x * 73856093u ^ (uint32_t)cell.y * 19349663u ^ (uint32_t)cell.z * 83492791u) & mask;
+	}
+
+	CUDA_DEVICE inline int32_t ContactCount(const FContactView& contacts)
+	{
+		return min(contacts.Scalars->ContactCount, contacts.Capacity);
+	}
+
+	// Every thread of the block has to call it, threads without a value pass zero
+	CUDA_DEVICE void BlockSum(float value, float* target)
+	{
+		CUDA_SHARED float warpSums[num_threads_per_block / 32];
+		for (int offset = 16; offset > 0; offset >>= 1) {
+			value += __shfl_down_sync(0xffffffff, value, offset);
+		}
+		int lane = threadIdx.x & 31;
+		int warp = threadIdx.x >> 5;
+		if (lane == 0) {
+			warpSums[warp] = value;
+		}
+		__syncthreads();
+		if (warp == 0) {
+			value = lane < num_threads_per_block / 32 ? warpSums[lane] : 0.f;
+			for (int offset = 16; offset > 0; offset >>= 1) {
+				value += __shfl_down_sync(0xffffffff, value, offset);
+			}
+			if (lane == 0) {
+				atomicAdd(target, value);
+			}
+		}
+	}
+
+	// normal points from a to b, distance is negative when they overlap
+	CUDA_DEVICE void AddContact(const FContactView& contacts, int32_t a, int32_t b, const float3& normal, float distance, const float3& pointA, const float3& pointB)
+	{
+		int32_t slot = atomicAdd(&contacts.Scalars->ContactCount, 1);
+		if (slot >= contacts.Capacity) {
+			atomicAdd(&contacts.Scalars->Dropped, 1);
+			return;
+		}
+		contacts.Bodies[slot] = make_int2(a, b);
+		contacts.Normal[slot] = Make4(normal, distance);
+		contacts.PointA[slot] = Make4(pointA, 0.f);
+		contacts.PointB[slot] = Make4(pointB, 0.f);
+	}
+
+	CUDA_DEVICE void CollideSphereSphere(const FBodyView& bodies, const FContactView& contacts, int32_t a, int32_t b, float envelope)
+	{
+		float3 ca = Xyz(bodies.Pos[a]);
+		float3 cb = Xyz(bodies.Pos[b]);
+		float ra = bodies.Extent[a].x;
+		float rb = bodies.Extent[b].x;
+		float3 delta = cb - ca;
+		float length = Length(delta);
+		float distance = length - ra - rb;
+		if (distance > envelope) {
+			return;
+		}
+		float3 normal = length > 1e-6f ? delta * (1.f / length) : make_float3(0.f, 1.f, 0.f);
+		AddContact(contacts, a, b, normal, distance, ca + normal * ra, cb - normal * rb);
+	}
+
+	// Sphere s against box x, in the caller's a, b order
+	CUDA_DEVICE void CollideSphereBox(const FBodyView& bodies, const FContactView& contacts, int32_t s, int32_t x, bool bSphereFirst, float envelope)
+	{
+		float3 cs = Xyz(bodies.Pos[s]);
+		float3 cx = Xyz(bodies.Pos[x]);
+		float4 qx = bodies.Rot[x];
+		float radius = bodies.Extent[s].x;
+		float3 half = Xyz(bodies.Extent[x]);
+
+		float3 p = RotateInverse(qx, cs - cx);
+		float3 q = make_float3(fminf(fmaxf(p.x, -half.x), half.x), fminf(fmaxf(p.y, -half.y), half.y), fminf(fmaxf(p.z, -half.z), half.z));
+		float3 delta = p - q;
+		float length = Length(delta);
+		float3 normalLocal;
+		float distance;
+		float3 surface = q;
+		if (length > 1e-6f) {
+			normalLocal = delta * (1.f / length);
+			distance = length - radius;
+		}
+		else {
+			// Center inside the box, out through the nearest face
+			float3 gap = make_float3(half.x - fabsf(p.x), half.y - fabsf(p.y), half.z - fabsf(p.z));
+			int axis = gap.x < gap.y ? (gap.x < gap.z ? 0 : 2) : (gap.y < gap.z ? 1 : 2);
+			float sign = Get(p, axis) >= 0.f ? 1.f : -1.f;
+			normalLocal = make_float3(0.f, 0.f, 0.f);
+			Set(normalLocal, axis, sign);
+			Set(surface, axis, sign * Get(half, axis));
+			distance = -Get(gap, axis) - radius;
+		}
+		if (distance > envelope) {
+			return;
+		}
+
+		// From the box towards the sphere
+		float3 normal = Rotate(qx, normalLocal);
+		float3 onBox = cx + Rotate(qx, surface);
+		float3 onSphere = cs - normal * radius;
+		if (bSphereFirst) {
+			AddContact(contacts, s, x, -normal, distance, onSphere, onBox);
+		}
+		else {
+			AddContact(contacts, x, s, normal, distance, onBox, onSphere);
+		}
+	}
+
+	// Corners of box v against the faces of box f. Vertex-face only, edge-edge crossings go undetected
+	CUDA_DEVICE void CollideBoxCorners(const FBodyView& bodies, const FContactView& contacts, int32_t v, int32_t f, bool bCornersFirst, float envelope)
+	{
+		float3 cv = Xyz(bodies.Pos[v]);
+		float3 cf = Xyz(bodies.Pos[f]);
+		float4 qv = bodies.Rot[v];
+		float4 qf = bodies.Rot[f];
+		float3 halfV = Xyz(bodies.Extent[v]);
+		float3 halfF = Xyz(bodies.Extent[f]);
+
+		for (int i = 0; i < 8; i++) {
+			float3 corner = make_float3(i & 1 ? halfV.x : -halfV.x, i & 2 ? halfV.y : -halfV.y, i & 4 ? halfV.z : -halfV.z);
+			float3 world = cv + Rotate(qv, corner);
+			float3 p = RotateInverse(qf, world - cf);
+			float3 gap = make_float3(halfF.x - fabsf(p.x), halfF.y - fabsf(p.y), halfF.z - fabsf(p.z));
+			int axis = gap.x < gap.y ? (gap.x < gap.z ? 0 : 2) : (gap.y < gap.z ? 1 : 2);
+			// Only the face axis may be outside, and not further than the envelope
+			if (Get(gap, axis) < -envelope || Get(gap, (axis + 1) % 3) < 0.f || Get(gap, (axis + 2) % 3) < 0.f) {
+				continue;
+			}
+			float sign = Get(p, axis) >= 0.f ? 1.f : -1.f;
+			float3 normalLocal = make_float3(0.f, 0.f, 0.f);
+			Set(normalLocal, axis, sign);
+			float3 surface = p;
+			Set(surface, axis, sign * Get(halfF, axis));
+
+			// Out of f towards the corner
+			float3 normal = Rotate(qf, normalLocal);
+			float3 onFace = cf + Rotate(qf, surface);
+			float distance = -Get(gap, axis);
+			if (bCornersFirst) {
+				AddContact(contacts, v, f, -normal, distance, world, onFace);
+			}
+			else {
+				AddContact(contacts, f, v, normal, distance, onFace, world);
+			}
+		}
+	}
+
+	CUDA_DEVICE void CollidePair(const FBodyView& bodies, const FContactView& contacts, int32_t a, int32_t b, float envelope)
+	{
+		float4 pa = bodies.Pos[a];
+		float4 pb = bodies.Pos[b];
+		if (pa.w == 0.f && pb.w == 0.f) {
+			return;
+		}
+		int2 fa = bodies.Filter[a];
+		int2 fb = bodies.Filter[b];
+		int groupA = fa.y & 0xffff, maskA = (fa.y >> 16) & 0xffff;
+		int groupB = fb.y & 0xffff, maskB = (fb.y >> 16) & 0xffff;
+		if (!(groupA & maskB) || !(groupB & maskA)) {
+			return;
+		}
+		float reach = bodies.Extent[a].w + bodies.Extent[b].w + envelope;
+		float3 delta = Xyz(pb) - Xyz(pa);
+		if (Dot(delta, delta) > reach * reach) {
+			return;
+		}
+
+		if (fa.x == Sphere && fb.x == Sphere) {
+			CollideSphereSphere(bodies, contacts, a, b, envelope);
+		}
+		else if (fa.x == Sphere) {
+			CollideSphereBox(bodies, contacts, a, b, true, envelope);
+		}
+		else if (fb.x == Sphere) {
+			CollideSphereBox(bodies, contacts, b, a, false, envelope);
+		}
+		else {
+			CollideBoxCorners(bodies, contacts, a, b, true, envelope);
+			CollideBoxCorners(bodies, contacts, b, a, false, envelope);
+		}
+	}
+
+	CUDA_DEVICE inline float3 ProjectCone(float3 gamma, float mu)
+	{
+		if (mu <= 0.f) {
+			return make_float3(fmaxf(gamma.x, 0.f), 0.f, 0.f);
+		}
+		float tangent = sqrtf(gamma.y * gamma.y + gamma.z * gamma.z);
+		if (tangent <= mu * gamma.x) {
+			return gamma;
+		}
+		if (mu * tangent <= -gamma.x) {
+			return make_float3(0.f, 0.f, 0.f);
+		}
+		float normal = (tangent * mu + gamma.x) / (mu * mu + 1.f);
+		float scale = normal * mu / tangent;
+		return make_float3(normal, gamma.y * scale, gamma.z * scale);
+	}
+
+	CUDA_GLOBAL void BeginStep(FScalars* scalars)
+	{
+		scalars->ContactCount = 0;
+		scalars->Dropped = 0;
+		scalars->Theta = 1.f;
+		scalars->Beta = 0.f;
+		scalars->Dot = 0.f;
+		scalars->Norm = 0.f;
+	}
+
+	CUDA_GLOBAL void IntegrateForces(FBodyView bodies, int32_t count, float3 gravity, float stepSize)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= count || bodies.Pos[i].w == 0.f) {
+			return;
+		}
+		float4 vel = bodies.Vel[i];
+		bodies.Vel[i] = Make4(Xyz(vel) + gravity * stepSize, vel.w);
+	}
+
+	CUDA_GLOBAL void HashCells(FBodyView bodies, const int32_t* smallBodies, int32_t count, float cellSize, uint32_t mask, uint32_t* keys, int32_t* values)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= count) {
+			return;
+		}
+		int32_t body = smallBodies[i];
+		keys[i] = HashCell(CellOf(Xyz(bodies.Pos[body]), cellSize), mask);
+		values[i] = body;
+	}
+
+	CUDA_GLOBAL void FindCellRanges(const uint32_t* keys, int32_t count, int32_t* cellStart, int32_t* cellEnd)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= count) {
+			return;
+		}
+		uint32_t key = keys[i];
+		if (i == 0 || keys[i - 1] != key) {
+			cellStart[key] = i;
+		}
+		if (i == count - 1 || keys[i + 1] != key) {
+			cellEnd[key] = i + 1;
+		}
+	}
+
+	CUDA_GLOBAL void CollideGrid(FBodyView bodies, FContactView contacts, const int32_t* cellBodies, const int32_t* cellStart, const int32_t* cellEnd,
+		int32_t count, float cellSize, uint32_t mask, float envelope)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= count) {
+			return;
+		}
+		int32_t a = cellBodies[i];
+		int3 cell = CellOf(Xyz(bodies.Pos[a]), cellSize);
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					int3 neighbour = make_int3(cell.x + dx, cell.y + dy, cell.z + dz);
+					uint32_t key = HashCell(neighbour, mask);
+					int32_t start = cellStart[key];
+					if (start < 0) {
+						continue;
+					}
+					int32_t end = cellEnd[key];
+					for (int32_t j = start; j < end; j++) {
+						int32_t b = cellBodies[j];
+						if (b <= a) {
+							continue;
+						}
+						// Cells sharing a bucket would test the pair more than once
+						int3 other = CellOf(Xyz(bodies.Pos[b]), cellSize);
+						if (other.x != neighbour.x || other.y != neighbour.y || other.z != neighbour.z) {
+							continue;
+						}
+						CollidePair(bodies, contacts, a, b, envelope);
+					}
+				}
+			}
+		}
+	}
+
+	CUDA_GLOBAL void CollideLarge(FBodyView bodies, FContactView contacts, const int32_t* smallBodies, int32_t smallCount, const int32_t* largeBodies, int32_t largeCount, float envelope)
+	{
+		int64_t i = (int64_t)blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= (int64_t)smallCount * largeCount) {
+			return;
+		}
+		CollidePair(bodies, contacts, smallBodies[i / largeCount], largeBodies[i % largeCount], envelope);
+	}
+
+	CUDA_GLOBAL void CollideLargePairs(FBodyView bodies, FContactView contacts, const int32_t* largeBodies, int32_t largeCount, float envelope)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= largeCount * largeCount) {
+			return;
+		}
+		int32_t first = i / largeCount;
+		int32_t second = i % largeCount;
+		if (first < second) {
+			CollidePair(bodies, contacts, largeBodies[first], largeBodies[second], envelope);
+		}
+	}
+
+	// Offsets, tangents and the right hand side D v + b of the free velocities, starts the unit power vector
+	CUDA_GLOBAL void PrepareContacts(FBodyView bodies, FContactView contacts, float4* rhs, float4* gamma, float4* momentum, float4* power, float stepSize, float recoverySpeed)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		int32_t count = ContactCount(contacts);
+		if (c >= count) {
+			return;
+		}
+		int2 ab = contacts.Bodies[c];
+		float4 normal4 = contacts.Normal[c];
+		float3 n = Xyz(normal4);
+		float3 rA = Xyz(contacts.PointA[c]) - Xyz(bodies.Pos[ab.x]);
+		float3 rB = Xyz(contacts.PointB[c]) - Xyz(bodies.Pos[ab.y]);
+		float3 u = fabsf(n.x) < 0.57f ? Cross(n, make_float3(1.f, 0.f, 0.f)) : Cross(n, make_float3(0.f, 1.f, 0.f));
+		u = u * (1.f / Length(u));
+		float3 v = Cross(n, u);
+		float mu = fminf(bodies.Vel[ab.x].w, bodies.Vel[ab.y].w);
+		contacts.PointA[c] = Make4(rA, mu);
+		contacts.PointB[c] = Make4(rB, 0.f);
+		contacts.U[c] = Make4(u, 0.f);
+		contacts.V[c] = Make4(v, 0.f);
+
+		float3 relative = (Xyz(bodies.Vel[ab.y]) + Cross(Xyz(bodies.AngVel[ab.y]), rB)) - (Xyz(bodies.Vel[ab.x]) + Cross(Xyz(bodies.AngVel[ab.x]), rA));
+		float bias = fmaxf(normal4.w / stepSize, -recoverySpeed);
+		rhs[c] = make_float4(Dot(n, relative) + bias, Dot(u, relative), Dot(v, relative), 0.f);
+		gamma[c] = make_float4(0.f, 0.f, 0.f, 0.f);
+		momentum[c] = make_float4(0.f, 0.f, 0.f, 0.f);
+		float unit = rsqrtf(3.f * count);
+		power[c] = make_float4(unit, unit, unit, 0.f);
+	}
+
+	// M^-1 D^T impulses into the body deltas, fixed bodies are skipped
+	CUDA_GLOBAL void ScatterImpulses(FBodyView bodies, FContactView contacts, const float4* impulses)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		if (c >= ContactCount(contacts)) {
+			return;
+		}
+		int2 ab = contacts.Bodies[c];
+		float4 impulse = impulses[c];
+		float3 p = Xyz(contacts.Normal[c]) * impulse.x + Xyz(contacts.U[c]) * impulse.y + Xyz(contacts.V[c]) * impulse.z;
+		float invMassA = bodies.Pos[ab.x].w;
+		float invMassB = bodies.Pos[ab.y].w;
+		if (invMassA > 0.f) {
+			chrono::AtomicAdd(&bodies.DeltaV[ab.x], p * -invMassA);
+			chrono::AtomicAdd(&bodies.DeltaW[ab.x], -ApplyInvInertia(bodies.Rot[ab.x], bodies.InvInertia[ab.x], Cross(Xyz(contacts.PointA[c]), p)));
+		}
+		if (invMassB > 0.f) {
+			chrono::AtomicAdd(&bodies.DeltaV[ab.y], p * invMassB);
+			chrono::AtomicAdd(&bodies.DeltaW[ab.y], ApplyInvInertia(bodies.Rot[ab.y], bodies.InvInertia[ab.y], Cross(Xyz(contacts.PointB[c]), p)));
+		}
+	}
+
+	// D of the body deltas, with the scatter before it one product with N = D M^-1 D^T
+	CUDA_GLOBAL void GatherVelocities(FBodyView bodies, FContactView contacts, float4* out)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		if (c >= ContactCount(contacts)) {
+			return;
+		}
+		int2 ab = contacts.Bodies[c];
+		float3 relative = (bodies.DeltaV[ab.y] + Cross(bodies.DeltaW[ab.y], Xyz(contacts.PointB[c])))
+			- (bodies.DeltaV[ab.x] + Cross(bodies.DeltaW[ab.x], Xyz(contacts.PointA[c])));
+		out[c] = make_float4(Dot(Xyz(contacts.Normal[c]), relative), Dot(Xyz(contacts.U[c]), relative), Dot(Xyz(contacts.V[c]), relative), 0.f);
+	}
+
+	CUDA_GLOBAL void SumSquares(FContactView contacts, const float4* values)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		float4 value = c < ContactCount(contacts) ? values[c] : make_float4(0.f, 0.f, 0.f, 0.f);
+		BlockSum(value.x * value.x + value.y * value.y + value.z * value.z, &contacts.Scalars->Norm);
+	}
+
+	CUDA_GLOBAL void NormalizePower(FContactView contacts, const float4* product, float4* power)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		float norm = contacts.Scalars->Norm;
+		if (c >= ContactCount(contacts) || norm <= 0.f) {
+			return;
+		}
+		float scale = rsqrtf(norm);
+		power[c] = make_float4(product[c].x * scale, product[c].y * scale, product[c].z * scale, 0.f);
+	}
+
+	CUDA_GLOBAL void ResetNorm(FScalars* scalars)
+	{
+		scalars->Norm = 0.f;
+	}
+
+	// |N p| of the unit power vector estimates the largest eigenvalue, with a margin for the few iterations
+	CUDA_GLOBAL void SetLipschitz(FScalars* scalars)
+	{
+		float eigenvalue = sqrtf(scalars->Norm);
+		scalars->InvLipschitz = eigenvalue > 0.f ? 1.f / (1.1f * eigenvalue) : 0.f;
+	}
+
+	CUDA_GLOBAL void ApgdStep(FContactView contacts, const float4* rhs, const float4* momentum, const float4* product, const float4* gamma, float4* gammaNext)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		float dot = 0.f;
+		if (c < ContactCount(contacts)) {
+			float4 r = rhs[c], y = momentum[c], ny = product[c], x = gamma[c];
+			float3 gradient = make_float3(ny.x + r.x, ny.y + r.y, ny.z + r.z);
+			float step = contacts.Scalars->InvLipschitz;
+			float3 next = ProjectCone(Xyz(y) - gradient * step, contacts.PointA[c].w);
+			gammaNext[c] = Make4(next, 0.f);
+			dot = Dot(gradient, next - Xyz(x));
+		}
+		BlockSum(dot, &contacts.Scalars->Dot);
+	}
+
+	// Nesterov momentum, restarted when the step went against the gradient
+	CUDA_GLOBAL void ApgdScalars(FScalars* scalars)
+	{
+		float theta = scalars->Theta;
+		if (scalars->Dot > 0.f) {
+			scalars->Theta = 1.f;
+			scalars->Beta = 0.f;
+		}
+		else {
+			float next = 0.5f * (-theta * theta + theta * sqrtf(theta * theta + 4.f));
+			scalars->Beta = theta * (1.f - theta) / (theta * theta + next);
+			scalars->Theta = next;
+		}
+		scalars->Dot = 0.f;
+	}
+
+	CUDA_GLOBAL void ApgdMomentum(FContactView contacts, float4* momentum, float4* gamma, const float4* gammaNext)
+	{
+		int32_t c = blockIdx.x * blockDim.x + threadIdx.x;
+		if (c >= ContactCount(contacts)) {
+			return;
+		}
+		float beta = contacts.Scalars->Beta;
+		float3 next = Xyz(gammaNext[c]);
+		momentum[c] = Make4(next + (next - Xyz(gamma[c])) * beta, 0.f);
+		gamma[c] = gammaNext[c];
+	}
+
+	CUDA_GLOBAL void IntegratePositions(FBodyView bodies, int32_t count, float stepSize, FPose* poses)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= count) {
+			return;
+		}
+		float4 pos = bodies.Pos[i];
+		float4 rot = bodies.Rot[i];
+		if (pos.w > 0.f) {
+			float4 vel4 = bodies.Vel[i];
+			float3 vel = Xyz(vel4) + bodies.DeltaV[i];
+			float3 angVel = Xyz(bodies.AngVel[i]) + bodies.DeltaW[i];
+			float2 limits = bodies.Limits[i];
+			float speed = Length(vel);
+			if (limits.x > 0.f && speed > limits.x) {
+				vel = vel * (limits.x / speed);
+			}
+			float angularSpeed = Length(angVel);
+			if (limits.y > 0.f && angularSpeed > limits.y) {
+				angVel = angVel * (limits.y / angularSpeed);
+				angularSpeed = limits.y;
+			}
+			bodies.Vel[i] = Make4(vel, vel4.w);
+			bodies.AngVel[i] = Make4(angVel, 0.f);
+
+			pos = Make4(Xyz(pos) + vel * stepSize, pos.w);
+			float angle = angularSpeed * stepSize;
+			if (angle > 1e-9f) {
+				float3 axis = angVel * (sinf(0.5f * angle) / angularSpeed);
+				float4 turn = Make4(axis, cosf(0.5f * angle));
+				// turn * rot, the angular velocity is in the world frame
+				float3 turnXyz = Xyz(turn), rotXyz = Xyz(rot);
+				float3 xyz = rotXyz * turn.w + turnXyz * rot.w + Cross(turnXyz, rotXyz);
+				rot = Make4(xyz, turn.w * rot.w - Dot(turnXyz, rotXyz));
+				float norm = rsqrtf(rot.x * rot.x + rot.y * rot.y + rot.z * rot.z + rot.w * rot.w);
+				rot = make_float4(rot.x * norm, rot.y * norm, rot.z * norm, rot.w * norm);
+			}
+			bodies.Pos[i] = pos;
+			bodies.Rot[i] = rot;
+		}
+		FPose pose;
+		pose.Pos[0] = pos.x;
+		pose.Pos[1] = pos.y;
+		pose.Pos[2] = pos.z;
+		pose.Rot[0] = rot.w;
+		pose.Rot[1] = rot.x;
+		pose.Rot[2] = rot.y;
+		pose.Rot[3] = rot.z;
+		poses[i] = pose;
+	}
+
+	uint32_t NextPowerOfTwo(uint32_t value)
+	{
+		uint32_t result = 64;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+}
+
+struct FWorld
+{
+	cudaStream_t Stream = nullptr;
+	cudaEvent_t Done = nullptr;
+	FSettings Settings;
+	int32_t BodyCount = 0;
+	int32_t SmallCount = 0;
+	int32_t LargeCount = 0;
+	float CellSize = 1.f;
+	uint32_t TableMask = 0;
+
+	gpu_vector<float4> Pos, Rot, Vel, AngVel, InvInertia, Extent;
+	gpu_vector<int2> Filter;
+	gpu_vector<float2> Limits;
+	gpu_vector<float3> DeltaV, DeltaW;
+	gpu_vector<int32_t> SmallBodies, LargeBodies;
+	gpu_vector<uint32_t> CellKeys;
+	gpu_vector<int32_t> CellBodies, CellStart, CellEnd;
+
+	gpu_vector<int2> ContactBodies;
+	gpu_vector<float4> ContactNormal, ContactPointA, ContactPointB, ContactU, ContactV;
+	gpu_vector<float4> Rhs, Gamma, GammaNext, Momentum, Product;
+	gpu_vector<FScalars> Scalars;
+	gpu_vector<FPose> Poses;
+
+	// Pinned, written by the copies at the end of each step
+	FPose* HostPoses = nullptr;
+	FScalars* HostScalars = nullptr;
+	FScalars LastScalars = {};
+
+	FBodyView Bodies()
+	{
+		return { Pos(), Rot(), Vel(), AngVel(), InvInertia(), Extent(), Filter(), Limits(), DeltaV(), DeltaW() };
+	}
+
+	FContactView Contacts()
+	{
+		return { ContactBodies(), ContactNormal(), ContactPointA(), ContactPointB(), ContactU(), ContactV(), Scalars(), Settings.MaxContacts };
+	}
+
+	void MultiplyN(const float4* vector, float4* out)
+	{
+		FBodyView bodies = Bodies();
+		FContactView contacts = Contacts();
+		cudaMemsetAsync(DeltaV(), 0, sizeof(float3) * BodyCount, Stream);
+		cudaMemsetAsync(DeltaW(), 0, sizeof(float3) * BodyCount, Stream);
+		ScatterImpulses<<<CONFIG(Settings.MaxContacts), 0, Stream>>>(bodies, contacts, vector);
+		GatherVelocities<<<CONFIG(Settings.MaxContacts), 0, Stream>>>(bodies, contacts, out);
+	}
+};
+
+bool IsDeviceAvailable()
+{
+	int count = 0;
+	return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+FWorld* Create(const FBodyDesc* bodies, int32_t count, const FSettings& settings)
+{
+	if (count <= 0 || settings.MaxContacts <= 0 || !IsDeviceAvailable()) {
+		return nullptr;
+	}
+
+	FWorld* world = new FWorld();
+	world->Settings = settings;
+	world->BodyCount = count;
+
+	std::vector<float> dynamicRadii;
+	auto& pos = world->Pos.getHost();
+	auto& rot = world->Rot.getHost();
+	auto& vel = world->Vel.getHost();
+	auto& angVel = world->AngVel.getHost();
+	auto& invInertia = world->InvInertia.getHost();
+	auto& extent = world->Extent.getHost();
+	auto& filter = world->Filter.getHost();
+	auto& limits = world->Limits.getHost();
+	for (int32_t i = 0; i < count; i++) {
+		const FBodyDesc& body = bodies[i];
+		float radius = body.Shape == Sphere ? body.HalfExtent[0]
+			: sqrtf(body.HalfExtent[0] * body.HalfExtent[0] + body.HalfExtent[1] * body.HalfExtent[1] + body.HalfExtent[2] * body.HalfExtent[2]);
+		pos.push_back(make_float4(body.Pos[0], body.Pos[1], body.Pos[2], body.InvMass));
+		rot.push_back(make_float4(body.Rot[1], body.Rot[2], body.Rot[3], body.Rot[0]));
+		vel.push_back(make_float4(body.Vel[0], body.Vel[1], body.Vel[2], body.Friction));
+		angVel.push_back(make_float4(body.AngVel[0], body.AngVel[1], body.AngVel[2], 0.f));
+		invInertia.push_back(make_float4(body.InvInertia[0], body.InvInertia[1], body.InvInertia[2], 0.f));
+		extent.push_back(make_float4(body.HalfExtent[0], body.HalfExtent[1], body.HalfExtent[2], radius));
+		filter.push_back(make_int2(body.Shape, (int32_t)body.FamilyGroup | ((int32_t)body.FamilyMask << 16)));
+		limits.push_back(make_float2(body.MaxSpeed, body.MaxAngularSpeed));
+		if (body.InvMass > 0.f) {
+			dynamicRadii.push_back(radius);
+		}
+	}
+	if (dynamicRadii.empty()) {
+		delete world;
+		return nullptr;
+	}
+
+	// The grid is sized for the common bodies, floors and walls would make its cells useless
+	std::nth_element(dynamicRadii.begin(), dynamicRadii.begin() + dynamicRadii.size() / 2, dynamicRadii.end());
+	float largeRadius = LargeRadiusFactor * dynamicRadii[dynamicRadii.size() / 2];
+	float smallRadius = 0.f;
+	auto& smallBodies = world->SmallBodies.getHost();
+	auto& largeBodies = world->LargeBodies.getHost();
+	for (int32_t i = 0; i < count; i++) {
+		if (extent[i].w <= largeRadius) {
+			smallBodies.push_back(i);
+			smallRadius = std::max(smallRadius, extent[i].w);
+		}
+		else {
+			largeBodies.push_back(i);
+		}
+	}
+	world->SmallCount = (int32_t)smallBodies.size();
+	world->LargeCount = (int32_t)largeBodies.size();
+	// Two touching small bodies are never more than one cell apart
+	world->CellSize = 2.f * smallRadius + settings.Envelope;
+	uint32_t tableSize = NextPowerOfTwo(2 * (uint32_t)world->SmallCount);
+	world->TableMask = tableSize - 1;
+
+	world->Pos.copyHostToDevice();
+	world->Rot.copyHostToDevice();
+	world->Vel.copyHostToDevice();
+	world->AngVel.copyHostToDevice();
+	world->InvInertia.copyHostToDevice();
+	world->Extent.copyHostToDevice();
+	world->Filter.copyHostToDevice();
+	world->Limits.copyHostToDevice();
+	world->SmallBodies.copyHostToDevice();
+	world->LargeBodies.copyHostToDevice();
+	world->DeltaV.allocate(count);
+	world->DeltaW.allocate(count);
+	world->CellKeys.allocate(std::max(world->SmallCount, 1));
+	world->CellBodies.allocate(std::max(world->SmallCount, 1));
+	world->CellStart.allocate(tableSize);
+	world->CellEnd.allocate(tableSize);
+
+	int32_t capacity = settings.MaxContacts;
+	world->ContactBodies.allocate(capacity);
+	world->ContactNormal.allocate(capacity);
+	world->ContactPointA.allocate(capacity);
+	world->ContactPointB.allocate(capacity);
+	world->ContactU.allocate(capacity);
+	world->ContactV.allocate(capacity);
+	world->Rhs.allocate(capacity);
+	world->Gamma.allocate(capacity);
+	world->GammaNext.allocate(capacity);
+	world->Momentum.allocate(capacity);
+	world->Product.allocate(capacity);
+	world->Scalars.allocate(1);
+	world->Poses.allocate(count);
+
+	cudaStreamCreateWithFlags(&world->Stream, cudaStreamNonBlocking);
+	cudaEventCreateWithFlags(&world->Done, cudaEventDisableTiming);
+	cudaMallocHost(&world->HostPoses, sizeof(FPose) * count);
+	cudaMallocHost(&world->HostScalars, sizeof(FScalars));
+	if (cudaGetLastError() != cudaSuccess || !world->HostPoses || !world->HostScalars) {
+		Destroy(world);
+		return nullptr;
+	}
+	for (int32_t i = 0; i < count; i++) {
+		FPose& pose = world->HostPoses[i];
+		std::copy(bodies[i].Pos, bodies[i].Pos + 3, pose.Pos);
+		std::copy(bodies[i].Rot, bodies[i].Rot + 4, pose.Rot);
+	}
+	*world->HostScalars = {};
+	cudaEventRecord(world->Done, world->Stream);
+	return world;
+}
+
+void Destroy(FWorld* world)
+{
+	if (!world) {
+		return;
+	}
+	if (world->Stream) {
+		cudaStreamSynchronize(world->Stream);
+		cudaStreamDestroy(world->Stream);
+	}
+	if (world->Done) {
+		cudaEventDestroy(world->Done);
+	}
+	cudaFreeHost(world->HostPoses);
+	cudaFreeHost(world->HostScalars);
+	delete world;
+}
+
+void Step(FWorld* world, float stepSize)
+{
+	if (!world || stepSize <= 0.f) {
+		return;
+	}
+	cudaStream_t stream = world->Stream;
+	FBodyView bodies = world->Bodies();
+	FContactView contacts = world->Contacts();
+	const FSettings& settings = world->Settings;
+	int32_t capacity = settings.MaxContacts;
+
+	BeginStep<<<1, 1, 0, stream>>>(world->Scalars());
+	IntegrateForces<<<CONFIG(world->BodyCount), 0, stream>>>(bodies, world->BodyCount, make_float3(settings.Gravity[0], settings.Gravity[1], settings.Gravity[2]), stepSize);
+
+	// Broadphase: hashed grid for the small bodies, the large ones against everything
+	if (world->SmallCount > 0) {
+		HashCells<<<CONFIG(world->SmallCount), 0, stream>>>(bodies, world->SmallBodies(), world->SmallCount, world->CellSize, world->TableMask, world->CellKeys(), world->CellBodies());
+		thrust::sort_by_key(thrust::cuda::par.on(stream), world->CellKeys(), world->CellKeys() + world->SmallCount, world->CellBodies());
+		cudaMemsetAsync(world->CellStart(), 0xff, sizeof(int32_t) * (world->TableMask + 1), stream);
+		FindCellRanges<<<CONFIG(world->SmallCount), 0, stream>>>(world->CellKeys(), world->SmallCount, world->CellStart(), world->CellEnd());
+		CollideGrid<<<CONFIG(world->SmallCount), 0, stream>>>(bodies, contacts, world->CellBodies(), world->CellStart(), world->CellEnd(),
+			world->SmallCount, world->CellSize, world->TableMask, settings.Envelope);
+	}
+	if (world->LargeCount > 0) {
+		int64_t pairs = (int64_t)world->SmallCount * world->LargeCount;
+		if (pairs > 0) {
+			CollideLarge<<<(unsigned int)((pairs + num_threads_per_block - 1) / num_threads_per_block), num_threads_per_block, 0, stream>>>(
+				bodies, contacts, world->SmallBodies(), world->SmallCount, world->LargeBodies(), world->LargeCount, settings.Envelope);
+		}
+		CollideLargePairs<<<CONFIG(world->LargeCount * world->LargeCount), 0, stream>>>(bodies, contacts, world->LargeBodies(), world->LargeCount, settings.Envelope);
+	}
+
+	// APGD with a fixed step from a power iteration estimate of N's largest eigenvalue
+	PrepareContacts<<<CONFIG(capacity), 0, stream>>>(bodies, contacts, world->Rhs(), world->Gamma(), world->Momentum(), world->GammaNext(), stepSize, settings.RecoverySpeed);
+	for (int32_t i = 0; i < PowerIterations; i++) {
+		world->MultiplyN(world->GammaNext(), world->Product());
+		ResetNorm<<<1, 1, 0, stream>>>(world->Scalars());
+		SumSquares<<<CONFIG(capacity), 0, stream>>>(contacts, world->Product());
+		if (i + 1 < PowerIterations) {
+			NormalizePower<<<CONFIG(capacity), 0, stream>>>(contacts, world->Product(), world->GammaNext());
+		}
+	}
+	SetLipschitz<<<1, 1, 0, stream>>>(world->Scalars());
+
+	for (int32_t i = 0; i < settings.Iterations; i++) {
+		world->MultiplyN(world->Momentum(), world->Product());
+		ApgdStep<<<CONFIG(capacity), 0, stream>>>(contacts, world->Rhs(), world->Momentum(), world->Product(), world->Gamma(), world->GammaNext());
+		ApgdScalars<<<1, 1, 0, stream>>>(world->Scalars());
+		ApgdMomentum<<<CONFIG(capacity), 0, stream>>>(contacts, world->Momentum(), world->Gamma(), world->GammaNext());
+	}
+
+	// Impulses into the velocities, then the positions; only the poses go back to the host
+	cudaMemsetAsync(world->DeltaV(), 0, sizeof(float3) * world->BodyCount, stream);
+	cudaMemsetAsync(world->DeltaW(), 0, sizeof(float3) * world->BodyCount, stream);
+	ScatterImpulses<<<CONFIG(capacity), 0, stream>>>(bodies, contacts, world->Gamma());
+	IntegratePositions<<<CONFIG(world->BodyCount), 0, stream>>>(bodies, world->BodyCount, stepSize, world->Poses());
+	cudaMemcpyAsync(world->HostPoses, world->Poses(), sizeof(FPose) * world->BodyCount, cudaMemcpyDeviceToHost, stream);
+	cudaMemcpyAsync(world->HostScalars, world->Scalars(), sizeof(FScalars), cudaMemcpyDeviceToHost, stream);
+	cudaEventRecord(world->Done, stream);
+}
+
+const FPose* WaitForPoses(FWorld* world)
+{
+	if (!world) {
+		return nullptr;
+	}
+	cudaEventSynchronize(world->Done);
+	world->LastScalars = *world->HostScalars;
+	return world->HostPoses;
+}
+
+void ReadVelocities(FWorld* world, float* vel, float* angVel)
+{
+	if (!world) {
+		return;
+	}
+	cudaStreamSynchronize(world->Stream);
+	world->Vel.copyDeviceToHost();
+	world->AngVel.copyDeviceToHost();
+	const auto& linear = world->Vel.getHost();
+	const auto& angular = world->AngVel.getHost();
+	for (int32_t i = 0; i < world->BodyCount; i++) {
+		vel[3 * i] = linear[i].x;
+		vel[3 * i + 1] = linear[i].y;
+		vel[3 * i + 2] = linear[i].z;
+		angVel[3 * i] = angular[i].x;
+		angVel[3 * i + 1] = angular[i].y;
+		angVel[3 * i + 2] = angular[i].z;
+	}
+}
+
+int32_t GetContactCount(const FWorld* world)
+{
+	return world ? std::min(world->LastScalars.ContactCount, world->Settings.MaxContacts) : 0;
+}
+
+int32_t GetDroppedContactCount(const FWorld* world)
+{
+	return world ? world->LastScalars.Dropped : 0;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+// Shared by ChGpuRigidWorld.cpp and ChGpuRigidKernels.cu, which nvcc builds without the engine headers
+#include <cstdint>
+
+namespace ChGpuRigid {
+	enum EShape : uint8_t {
+		Sphere,
+		Box
+	};
+
+	// Chrono units and frame, rotations are (w, x, y, z)
+	struct FBodyDesc
+	{
+		float Pos[3];
+		float Rot[4];
+		float Vel[3];
+		// World frame
+		float AngVel[3];
+		// Zero for fixed bodies
+		float InvMass;
+		float InvInertia[3];
+		// Radius in the first component for spheres
+		float HalfExtent[3];
+		float Friction;
+		// Zero leaves the speed unlimited
+		float MaxSpeed;
+		float MaxAngularSpeed;
+		// Bits of Chrono's short family group and mask, unsigned so family 15 doesn't sign extend
+		uint16_t FamilyGroup;
+		uint16_t FamilyMask;
+		uint8_t Shape;
+	};
+
+	struct FSettings
+	{
+		float Gravity[3];
+		float Envelope;
+		float RecoverySpeed;
+		int32_t Iterations;
+		// Contact capacity, allocated once
+		int32_t MaxContacts;
+	};
+
+	struct FPose
+	{
+		float Pos[3];
+		float Rot[4];
+	};
+
+	struct FWorld;
+
+	bool IsDeviceAvailable();
+	// Copies the bodies to the device once, nullptr when the device can't hold them
+	FWorld* Create(const FBodyDesc* bodies, int32_t count, const FSettings& settings);
+	void Destroy(FWorld* world);
+	// Queued on the world's stream and returns right away, the poses are copied back at the end
+	void Step(FWorld* world, float stepSize);
+	// Blocks until the last step finished, the poses stay valid until the next step
+	const FPose* WaitForPoses(FWorld* world);
+	// Blocking, three floats per body into each array, the angular ones in the world frame
+	void ReadVelocities(FWorld* world, float* vel, float* angVel);
+	// Of the last waited step
+	int32_t GetContactCount(const FWorld* world);
+	int32_t GetDroppedContactCount(const FWorld* world);
+}
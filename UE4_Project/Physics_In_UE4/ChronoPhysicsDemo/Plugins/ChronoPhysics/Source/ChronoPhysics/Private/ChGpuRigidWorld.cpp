@@ -0,0 +1,183 @@
+#include "ChGpuRigidWorld.h"
+#include "ChGpuRigidKernels.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChMaterialSurfaceNSC.h"
+#include "chrono/collision/ChCCollisionModel.h"
+
+#ifndef WITH_CHRONO_CUDA
+#define WITH_CHRONO_CUDA 0
+#endif
+
+FChGpuRigidWorld::~FChGpuRigidWorld()
+{
+#if WITH_CHRONO_CUDA
+	ChGpuRigid::Destroy(world);
+#endif
+	world = nullptr;
+}
+
+void FChGpuRigidWorld::Release()
+{
+#if WITH_CHRONO_CUDA
+	if (world) {
+		ApplyPoses();
+		TArray<float> vel, angVel;
+		vel.SetNumZeroed(3 * deviceBodyNum);
+		angVel.SetNumZeroed(3 * deviceBodyNum);
+		ChGpuRigid::ReadVelocities(world, vel.GetData(), angVel.GetData());
+		for (auto& device : bodies) {
+			const float* v = &vel[3 * device.DeviceIndex];
+			const float* w = &angVel[3 * device.DeviceIndex];
+			device.Body->SetBodyFixed(false);
+			device.Body->SetCollide(true);
+			device.Body->SetPos_dt(chrono::ChVector<>(v[0], v[1], v[2]));
+			device.Body->SetWvel_par(chrono::ChVector<>(w[0], w[1], w[2]));
+		}
+		ChGpuRigid::Destroy(world);
+	}
+#endif
+	world = nullptr;
+	bStepQueued = false;
+	deviceBodyNum = 0;
+	bodies.Reset();
+}
+
+bool FChGpuRigidWorld::IsAvailable()
+{
+#if WITH_CHRONO_CUDA
+	return ChGpuRigid::IsDeviceAvailable();
+#else
+	return false;
+#endif
+}
+
+void FChGpuRigidWorld::Add(std::shared_ptr<chrono::ChBody> body, const FChColliderProxy& proxy)
+{
+	if (!body || world || Contains(body.get())) {
+		return;
+	}
+	bodies.Add({ body, proxy, bodies.Num() });
+}
+
+bool FChGpuRigidWorld::Contains(chrono::ChBody* body) const
+{
+	return bodies.ContainsByPredicate([body](const FDeviceBody& device) { return device.Body.get() == body; });
+}
+
+bool FChGpuRigidWorld::Create(chrono::ChSystem* system, float envelope, float recoverySpeed, int32 iterations, int32 maxContacts)
+{
+#if WITH_CHRONO_CUDA
+	if (world || !system || bodies.Num() == 0) {
+		return world != nullptr;
+	}
+
+	TArray<ChGpuRigid::FBodyDesc> descs;
+	descs.SetNumZeroed(bodies.Num());
+	for (int32 i = 0; i < bodies.Num(); i++) {
+		auto& body = bodies[i].Body;
+		const FChColliderProxy& proxy = bodies[i].Proxy;
+		ChGpuRigid::FBodyDesc& desc = descs[i];
+		const chrono::ChVector<>& pos = body->GetPos();
+		const chrono::ChQuaternion<>& rot = body->GetRot();
+		const chrono::ChVector<>& vel = body->GetPos_dt();
+		chrono::ChVector<> angVel = body->GetWvel_par();
+		for (int32 k = 0; k < 3; k++) {
+			desc.Pos[k] = pos[k];
+			desc.Vel[k] = vel[k];
+			desc.AngVel[k] = angVel[k];
+		}
+		desc.Rot[0] = rot.e0();
+		desc.Rot[1] = rot.e1();
+		desc.Rot[2] = rot.e2();
+		desc.Rot[3] = rot.e3();
+
+		if (!body->GetBodyFixed()) {
+			chrono::ChVector<> inertia = body->GetInertiaXX();
+			desc.InvMass = 1.0 / body->GetMass();
+			for (int32 k = 0; k < 3; k++) {
+				desc.InvInertia[k] = inertia[k] > 0 ? 1.0 / inertia[k] : 0.0;
+			}
+		}
+		desc.Shape = proxy.Type == FChColliderProxy::Box ? ChGpuRigid::Box : ChGpuRigid::Sphere;
+		desc.HalfExtent[0] = proxy.Extent.X;
+		desc.HalfExtent[1] = proxy.Extent.Y;
+		desc.HalfExtent[2] = proxy.Extent.Z;
+		desc.Friction = body->GetMaterialSurfaceNSC() ? body->GetMaterialSurfaceNSC()->GetSfriction() : 0.f;
+		desc.MaxSpeed = body->GetLimitSpeed() ? body->GetMaxSpeed() : 0.f;
+		desc.MaxAngularSpeed = body->GetLimitSpeed() ? body->GetMaxWvel() : 0.f;
+		auto model = body->GetCollisionModel();
+		desc.FamilyGroup = model ? (uint16_t)model->GetFamilyGroup() : 1;
+		desc.FamilyMask = model ? (uint16_t)model->GetFamilyMask() : 0xffff;
+	}
+
+	ChGpuRigid::FSettings settings;
+	const chrono::ChVector<>& gravity = system->Get_G_acc();
+	for (int32 k = 0; k < 3; k++) {
+		settings.Gravity[k] = gravity[k];
+	}
+	settings.Envelope = envelope;
+	settings.RecoverySpeed = recoverySpeed;
+	settings.Iterations = FMath::Max(iterations, 1);
+	settings.MaxContacts = FMath::Max(maxContacts, 1);
+	world = ChGpuRigid::Create(descs.GetData(), descs.Num(), settings);
+	if (!world) {
+		return false;
+	}
+	deviceBodyNum = bodies.Num();
+
+	// Chrono keeps the bodies for the visuals and the fixed ones as obstacles for its own bodies,
+	// only the dynamic ones are left here to take the poses
+	bodies.RemoveAll([](const FDeviceBody& device) { return device.Body->GetBodyFixed(); });
+	for (auto& device : bodies) {
+		device.Body->SetBodyFixed(true);
+		device.Body->SetCollide(false);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FChGpuRigidWorld::Step(double stepSize)
+{
+#if WITH_CHRONO_CUDA
+	if (world) {
+		ChGpuRigid::Step(world, (float)stepSize);
+		bStepQueued = true;
+	}
+#endif
+}
+
+void FChGpuRigidWorld::ApplyPoses()
+{
+#if WITH_CHRONO_CUDA
+	if (!world || !bStepQueued) {
+		return;
+	}
+	bStepQueued = false;
+	const ChGpuRigid::FPose* poses = ChGpuRigid::WaitForPoses(world);
+	for (auto& device : bodies) {
+		const ChGpuRigid::FPose& pose = poses[device.DeviceIndex];
+		device.Body->SetCoord(chrono::ChVector<>(pose.Pos[0], pose.Pos[1], pose.Pos[2]), chrono::ChQuaternion<>(pose.Rot[0], pose.Rot[1], pose.Rot[2], pose.Rot[3]));
+	}
+#endif
+}
+
+int32 FChGpuRigidWorld::GetContactCount() const
+{
+#if WITH_CHRONO_CUDA
+	return ChGpuRigid::GetContactCount(world);
+#else
+	return 0;
+#endif
+}
+
+int32 FChGpuRigidWorld::GetDroppedContactCount() const
+{
+#if WITH_CHRONO_CUDA
+	return ChGpuRigid::GetDroppedContactCount(world);
+#else
+	return 0;
+#endif
+}
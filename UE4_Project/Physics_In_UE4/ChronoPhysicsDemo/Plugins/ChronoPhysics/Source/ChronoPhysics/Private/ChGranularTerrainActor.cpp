@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ChGranularTerrainActor.h"
+#include "Engine/StaticMesh.h"
+#include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
+#include "Math/RandomStream.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "util.h"
+
+AChGranularTerrainActor::AChGranularTerrainActor()
+{
+	bUseInstancedRendering = true;
+}
+
+void AChGranularTerrainActor::PhysicsObjectConstruct()
+{
+	if (!sphereMesh->BodySetup->AggGeom.SphereElems.Num()) {
+		return;
+	}
+
+	FVector origin = GetActorLocation();
+	float spacing = ParticleRadius * 2.02f;
+	int countX = FMath::Max(1, FMath::FloorToInt(PatchLength / spacing));
+	int countY = FMath::Max(1, FMath::FloorToInt(PatchWidth / spacing));
+	float height = NumLayers * spacing + ParticleRadius * 4.f;
+	patchRear = origin.X;
+
+	// Floor top sits at the actor location, side walls run along the whole patch
+	NewContainerBox(origin + FVector(PatchLength * 0.5f, 0.f, -WallThickness * 0.5f), FVector(PatchLength, PatchWidth + WallThickness * 2.f, WallThickness));
+	NewContainerBox(origin + FVector(PatchLength * 0.5f, (PatchWidth + WallThickness) * 0.5f, height * 0.5f), FVector(PatchLength, WallThickness, height));
+	NewContainerBox(origin + FVector(PatchLength * 0.5f, -(PatchWidth + WallThickness) * 0.5f, height * 0.5f), FVector(PatchLength, WallThickness, height));
+
+	FRandomStream random(RandomSeed);
+	float jitter = ParticleRadius * PositionJitter;
+	float scale = ParticleRadius / sphereMesh->BodySetup->AggGeom.SphereElems[0].Radius;
+	FVector start = origin + FVector(spacing * 0.5f, -(countY - 1) * spacing * 0.5f, ParticleRadius * 1.01f);
+
+	ParticleList.Reserve(countX * countY * NumLayers);
+	for (int layer = 0; layer < NumLayers; layer++) {
+		for (int x = 0; x < countX; x++) {
+			for (int y = 0; y < countY; y++) {
+				FVector location = start + FVector(x, y, layer) * spacing + FVector(random.FRandRange(-jitter, jitter), random.FRandRange(-jitter, jitter), 0.f);
+				int particle = NewChBodyInstance(EShapeType::Sphere, FTransform(FQuat::Identity, location, FVector(scale)), ParticleDensity, false);
+				if (particle != INDEX_NONE) {
+					ParticleList.Add(particle);
+				}
+			}
+		}
+	}
+}
+
+void AChGranularTerrainActor::PhysicsObjectInitalize()
+{
+	Super::PhysicsObjectInitalize();
+
+	trackedBody = nullptr;
+	if (bMovingPatch && TrackedActor) {
+		auto comp = TrackedActor->FindComponentByClass<UChBodyComponent>();
+		trackedBody = comp ? comp->GetChData() : nullptr;
+	}
+}
+
+void AChGranularTerrainActor::UpdatePhysicsState()
+{
+	Super::UpdatePhysicsState();
+
+	if (!trackedBody) {
+		return;
+	}
+	float trackedX = CHRONO_VEC_TO_FVECTOR(trackedBody->GetPos()).X;
+	if (trackedX > patchRear + PatchLength - BufferDistance) {
+		ShiftPatch();
+	}
+}
+
+void AChGranularTerrainActor::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	Super::CollectPhysicsStateUpdate(objList);
+	if (bMovingPatch) {
+		objList.Add(this);
+	}
+}
+
+void AChGranularTerrainActor::CacheVisualState()
+{
+	Super::CacheVisualState();
+
+	// Fixed instances are not refreshed by the generator, but the container moves with the patch
+	if (!bMovingPatch) {
+		return;
+	}
+	for (int index : ContainerList) {
+		auto& instance = InstancedBodyList[index];
+		instance.CachedTransform.SetLocation(CHRONO_VEC_TO_FVECTOR(instance.ChData->GetPos()));
+		instance.PreviousTransform = instance.CachedTransform;
+	}
+}
+
+int AChGranularTerrainActor::NewContainerBox(const FVector& center, const FVector& size)
+{
+	if (!boxMesh->BodySetup->AggGeom.BoxElems.Num()) {
+		return INDEX_NONE;
+	}
+	auto box = boxMesh->BodySetup->AggGeom.BoxElems[0];
+	FVector scale = size / FVector(box.X, box.Y, box.Z);
+	int index = NewChBodyInstance(EShapeType::Box, FTransform(FQuat::Identity, center, scale), ParticleDensity, true);
+	if (index != INDEX_NONE) {
+		ContainerList.Add(index);
+	}
+	return index;
+}
+
+void AChGranularTerrainActor::ShiftPatch()
+{
+	// The band behind the rear wraps into the empty band ahead of the front, heights are kept
+	float bandEnd = patchRear + ShiftDistance;
+	for (int index : ParticleList) {
+		auto body = InstancedBodyList[index].ChData;
+		FVector location = CHRONO_VEC_TO_FVECTOR(body->GetPos());
+		if (location.X >= bandEnd) {
+			continue;
+		}
+		location.X += PatchLength;
+		body->SetPos(FVECTOR_TO_CHRONO_VEC(location));
+		body->SetPos_dt(chrono::VNULL);
+		body->SetWvel_loc(chrono::VNULL);
+		body->SetSleeping(false);
+		// Skip the interpolation across the whole patch on the next frame
+		InstancedBodyList[index].CachedTransform.SetLocation(location);
+	}
+
+	auto bulletSystem = ContainerList.Num() ? std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(InstancedBodyList[ContainerList[0]].ChData->GetSystem()->GetCollisionSystem()) : nullptr;
+	for (int index : ContainerList) {
+		auto body = InstancedBodyList[index].ChData;
+		FVector location = CHRONO_VEC_TO_FVECTOR(body->GetPos()) + FVector(ShiftDistance, 0.f, 0.f);
+		body->SetPos(FVECTOR_TO_CHRONO_VEC(location));
+		body->GetCollisionModel()->SyncPosition();
+
+		// Static objects keep their cached AABB under the incremental broadphase
+		auto model = std::dynamic_pointer_cast<chrono::collision::ChModelBullet>(body->GetCollisionModel());
+		if (bulletSystem && model && model->GetBulletModel()) {
+			bulletSystem->GetBulletCollisionWorld()->updateSingleAabb(model->GetBulletModel());
+		}
+	}
+	patchRear += ShiftDistance;
+}
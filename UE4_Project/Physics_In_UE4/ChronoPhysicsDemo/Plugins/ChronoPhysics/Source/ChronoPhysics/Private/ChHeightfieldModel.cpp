@@ -0,0 +1,70 @@
+#include "ChHeightfieldModel.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+
+double FChHeightfield::GetHeight(double x, double z) const
+{
+	double u = FMath::Clamp(x / SpacingX, 0.0, (double)(SizeX - 1));
+	double v = FMath::Clamp(z / SpacingZ, 0.0, (double)(SizeZ - 1));
+	int32 x0 = FMath::Min((int32)u, SizeX - 2);
+	int32 z0 = FMath::Min((int32)v, SizeZ - 2);
+	double fu = u - x0;
+	double fv = v - z0;
+	double h0 = FMath::Lerp(GetSample(x0, z0), GetSample(x0 + 1, z0), fu);
+	double h1 = FMath::Lerp(GetSample(x0, z0 + 1), GetSample(x0 + 1, z0 + 1), fu);
+	return FMath::Lerp(h0, h1, fv);
+}
+
+void FChHeightfield::GetHeightRange(double& outMin, double& outMax) const
+{
+	int16 low = MAX_int16;
+	int16 high = MIN_int16;
+	for (int16 height : Heights) {
+		low = FMath::Min(low, height);
+		high = FMath::Max(high, height);
+	}
+	outMin = FMath::Min(low * HeightScale, high * HeightScale);
+	outMax = FMath::Max(low * HeightScale, high * HeightScale);
+}
+
+int FChHeightfieldModel::ClearModel()
+{
+	int result = ChModelBullet::ClearModel();
+	heightfield.reset();
+	return result;
+}
+
+bool FChHeightfieldModel::AddHeightfield(std::shared_ptr<const FChHeightfield> inHeightfield)
+{
+	if (!inHeightfield || !inHeightfield->IsValid() || shapes.size() > 0) {
+		return false;
+	}
+	heightfield = inHeightfield;
+
+	double minHeight, maxHeight;
+	heightfield->GetHeightRange(minHeight, maxHeight);
+	// Bullet never writes the samples, the const cast is for its interface only
+	// Through new like the other Bullet shapes, their operator new keeps the SIMD alignment
+	std::shared_ptr<btHeightfieldTerrainShape> shape(new btHeightfieldTerrainShape(heightfield->SizeX, heightfield->SizeZ,
+		const_cast<int16*>(heightfield->Heights.GetData()), (btScalar)heightfield->HeightScale,
+		(btScalar)minHeight, (btScalar)maxHeight, 1, PHY_SHORT, false));
+	shape->setLocalScaling(btVector3((btScalar)heightfield->SpacingX, 1, (btScalar)heightfield->SpacingZ));
+	shape->setMargin((btScalar)GetSuggestedFullMargin());
+
+	// Bullet centers the grid and its height range on the shape origin, the compound puts sample (0, 0) back at Origin
+	btTransform offset;
+	offset.setIdentity();
+	offset.setOrigin(btVector3(
+		(btScalar)(heightfield->Origin.x() + (heightfield->SizeX - 1) * heightfield->SpacingX * 0.5),
+		(btScalar)(heightfield->Origin.y() + (minHeight + maxHeight) * 0.5),
+		(btScalar)(heightfield->Origin.z() + (heightfield->SizeZ - 1) * heightfield->SpacingZ * 0.5)));
+	std::shared_ptr<btCompoundShape> compound(new btCompoundShape(false));
+	compound->addChildShape(offset, shape.get());
+	compound->setMargin((btScalar)GetSuggestedFullMargin());
+
+	shapes.push_back(shape);
+	shapes.push_back(compound);
+	bt_collision_object->setCollisionShape(compound.get());
+	return true;
+}
@@ -0,0 +1,56 @@
+#include "ChIndexedPathFollower.h"
+
+void FChIndexedPathSteeringController::Reset(const chrono::vehicle::ChVehicle& vehicle)
+{
+	ChSteeringController::Reset(vehicle);
+	// The vehicle may have been put anywhere
+	cursor.Reset();
+}
+
+void FChIndexedPathSteeringController::CalcTargetLocation()
+{
+	pathIndex->Locate(m_sentinel, cursor, m_target);
+}
+
+FChIndexedPathFollowerDriver::FChIndexedPathFollowerDriver(chrono::vehicle::ChVehicle& vehicle, std::shared_ptr<const FChBezierPathIndex> index, double inTargetSpeed)
+	: ChDriver(vehicle), steeringPID(index), targetSpeed(inTargetSpeed)
+{
+	Reset();
+}
+
+void FChIndexedPathFollowerDriver::SetFollowing(double inFollowingTime, double inMinDistance)
+{
+	bAdaptiveCruise = true;
+	followingTime = inFollowingTime;
+	minDistance = inMinDistance;
+}
+
+void FChIndexedPathFollowerDriver::Reset()
+{
+	steeringPID.Reset(m_vehicle);
+	speedPID.Reset(m_vehicle);
+	adaptiveSpeedPID.Reset(m_vehicle);
+}
+
+void FChIndexedPathFollowerDriver::Advance(double step)
+{
+	double outSpeed = bAdaptiveCruise
+		? adaptiveSpeedPID.Advance(m_vehicle, targetSpeed, followingTime, minDistance, currentDistance, step)
+		: speedPID.Advance(m_vehicle, targetSpeed, step);
+	outSpeed = FMath::Clamp(outSpeed, -1.0, 1.0);
+	if (outSpeed > 0) {
+		// Too slow
+		m_braking = 0;
+		m_throttle = outSpeed;
+	}
+	else if (m_throttle > throttleThreshold) {
+		// Too fast, off the throttle first
+		m_braking = 0;
+		m_throttle = 1 + outSpeed;
+	}
+	else {
+		m_braking = -outSpeed;
+		m_throttle = 0;
+	}
+	m_steering = FMath::Clamp(steeringPID.Advance(m_vehicle, step), -1.0, 1.0);
+}
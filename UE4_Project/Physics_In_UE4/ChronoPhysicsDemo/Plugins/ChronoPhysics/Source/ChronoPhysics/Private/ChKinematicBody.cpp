@@ -0,0 +1,35 @@
+#include "ChKinematicBody.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChSystem.h"
+
+void FChKinematicBody::Make(chrono::ChBody& body)
+{
+	body.SetBodyFixed(false);
+	body.SetMass(Mass);
+	// Isotropic, the gyroscopic torque would be zero anyway
+	body.SetInertiaXX(chrono::ChVector<>(Mass));
+	body.SetNoGyroTorque(true);
+	// The path sets the speed, and it must never stop being simulated
+	body.SetLimitSpeed(false);
+	body.SetUseSleeping(false);
+	body.SetSleeping(false);
+}
+
+bool FChKinematicBody::IsKinematic(const chrono::ChBody& body)
+{
+	return !body.GetBodyFixed() && body.GetMass() >= Mass;
+}
+
+void FChKinematicBody::Drive(chrono::ChBody& body, const chrono::ChVector<>& position, const chrono::ChQuaternion<>& rotation,
+	const chrono::ChVector<>& velocity, const chrono::ChVector<>& angularVelocity)
+{
+	body.SetPos(position);
+	body.SetRot(rotation);
+	body.SetPos_dt(velocity);
+	body.SetWvel_par(angularVelocity);
+	// The same product the body adds for gravity, the two cancel exactly
+	body.Empty_forces_accumulators();
+	if (chrono::ChSystem* system = body.GetSystem()) {
+		body.Accumulate_force(-(system->Get_G_acc() * body.GetMass()), position, false);
+	}
+}
@@ -7,6 +7,9 @@
 #include "ChBodyComponent.h"
 #include "chrono/physics/ChLink.h"
 #include "chrono/physics/ChSystem.h"
+#include "ChTelemetry.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "ChPhysicsSceneManagerActor.h"
 #include "util.h"
 
 AChLinkActor::AChLinkActor()
@@ -41,6 +44,25 @@ void AChLinkActor::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
 	if (this->isInitialized) {
 		phySystem->AddLink(this->ChData);
 	}
+	if (!bBreakable || !this->isInitialized || (BreakForce <= 0.f && BreakTorque <= 0.f)) {
+		return;
+	}
+	auto registry = FChPhysicsObjectRegistry::Get(GetWorld());
+	AChPhysicsSceneManagerActor* scene = registry ? registry->FindScene(this) : nullptr;
+	breakSlot = scene ? scene->AddBreakableLink(this, BreakForce, BreakTorque) : INDEX_NONE;
+	breakScene = breakSlot != INDEX_NONE ? scene : nullptr;
+}
+
+void AChLinkActor::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	if (breakScene) {
+		breakScene->RemoveBreakableLink(breakSlot);
+		breakScene = nullptr;
+		breakSlot = INDEX_NONE;
+	}
+	if (this->ChData && this->ChData->GetSystem() == phySystem.get()) {
+		phySystem->RemoveLink(this->ChData);
+	}
 }
 
 FExportData AChLinkActor::ExportData()
@@ -60,8 +82,41 @@ FExportData AChLinkActor::ExportData()
 	return data;
 }
 
+void AChLinkActor::RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList)
+{
+	if (!bExportData || !ChData) {
+		return;
+	}
+
+	FString prefix = LinkExportDataOwnerName.ToString();
+	reactForceChannel = bExportReactForce ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".ReactForce"))), 3) : INDEX_NONE;
+	reactTorqueChannel = bExportReactTorque ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".ReactTorque"))), 3) : INDEX_NONE;
+
+	if (bExportReactForce || bExportReactTorque) {
+		writerList.AddUnique(this);
+	}
+}
+
+void AChLinkActor::WriteTelemetry(FChTelemetry& telemetry)
+{
+	if (reactForceChannel != INDEX_NONE) {
+		telemetry.Write(reactForceChannel, CHRONO_VEC_TO_FVECTOR((ChData->Get_react_force())) / 100.0f);
+	}
+	if (reactTorqueChannel != INDEX_NONE) {
+		telemetry.Write(reactTorqueChannel, CHRONO_VEC_TO_FVECTOR((ChData->Get_react_torque())) / 100.0f);
+	}
+}
+
+bool AChLinkActor::IsBroken() const
+{
+	return ChData && ChData->IsBroken();
+}
+
 bool AChLinkActor::IsReadyForInitialize()
 {
+	if (targetBody1 && targetBody2 && ChData) {
+		return true;
+	}
 	if (target1 && target2 && ChData) {
 		auto comp1 = Cast<UChBodyComponent>(this->target1->FindComponentByClass(UChBodyComponent::StaticClass()));
 		auto comp2 = Cast<UChBodyComponent>(this->target2->FindComponentByClass(UChBodyComponent::StaticClass()));
@@ -73,3 +128,47 @@ bool AChLinkActor::IsReadyForInitialize()
 	}
 	return false;
 }
+
+void AChLinkActor::SetTargetBodies(std::shared_ptr<chrono::ChBody> body1, std::shared_ptr<chrono::ChBody> body2)
+{
+	this->targetBody1 = body1;
+	this->targetBody2 = body2;
+}
+
+std::shared_ptr<chrono::ChBody> AChLinkActor::GetTargetBody1()
+{
+	if (targetBody1) {
+		return targetBody1;
+	}
+	auto comp = target1 ? Cast<UChBodyComponent>(this->target1->FindComponentByClass(UChBodyComponent::StaticClass())) : nullptr;
+	return comp ? comp->GetChData() : nullptr;
+}
+
+std::shared_ptr<chrono::ChBody> AChLinkActor::GetTargetBody2()
+{
+	if (targetBody2) {
+		return targetBody2;
+	}
+	auto comp = target2 ? Cast<UChBodyComponent>(this->target2->FindComponentByClass(UChBodyComponent::StaticClass())) : nullptr;
+	return comp ? comp->GetChData() : nullptr;
+}
+
+void AChLinkActor::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void AChLinkActor::PostUnregisterAllComponents()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::PostUnregisterAllComponents();
+}
+
+#if WITH_EDITOR
+void AChLinkActor::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	FChPhysicsObjectRegistry::NotifyEdited(this);
+}
+#endif
@@ -0,0 +1,23 @@
+#include "ChLinkFixed.h"
+
+void FChLinkFixedBase::Initialize(std::shared_ptr<chrono::ChBodyFrame> body1, std::shared_ptr<chrono::ChBodyFrame> body2, const chrono::ChFrame<>& absFrame)
+{
+	Body1 = body1.get();
+	Body2 = body2.get();
+	static_cast<chrono::ChFrame<>*>(Body1)->TransformParentToLocal(absFrame, frame1);
+	static_cast<chrono::ChFrame<>*>(Body2)->TransformParentToLocal(absFrame, frame2);
+}
+
+void FChLinkFixedBase::ArchiveOUT(chrono::ChArchiveOut& marchive)
+{
+	ChLinkMate::ArchiveOUT(marchive);
+	marchive << chrono::make_ChNameValue("frame1", frame1);
+	marchive << chrono::make_ChNameValue("frame2", frame2);
+}
+
+void FChLinkFixedBase::ArchiveIN(chrono::ChArchiveIn& marchive)
+{
+	ChLinkMate::ArchiveIN(marchive);
+	marchive >> chrono::make_ChNameValue("frame1", frame1);
+	marchive >> chrono::make_ChNameValue("frame2", frame2);
+}
@@ -3,6 +3,7 @@
 
 #include "ChLinkLockActor.h"
 #include "chrono/physics/ChLinkLock.h"
+#include "ChLinkFixed.h"
 #include "ChBodyComponent.h"
 #include "util.h"
 
@@ -10,6 +11,11 @@
 
 void AChLinkLockActor::PhysicsObjectConstruct()
 {
+	if (auto fixed = NewFixedLink()) {
+		this->ChData = fixed;
+		return;
+	}
+
 	auto linkptr = std::make_shared<chrono::ChLinkLock>();
 
 	switch (LinkLockType) {
@@ -63,8 +69,41 @@ void AChLinkLockActor::PhysicsObjectConstruct()
 	this->ChData = linkptr;
 }
 
+std::shared_ptr<FChLinkFixedBase> AChLinkLockActor::NewFixedLink() const
+{
+	if (!bUseMarkerFreeLink || bUseLimitX || bUseLimitY || bUseLimitZ || bUseLimitRx || bUseLimitRy || bUseLimitRz) {
+		return nullptr;
+	}
+
+	// Same constrained coordinates as ChLinkLock: revolute, cylindrical and prismatic links keep Z free,
+	// the point on line keeps X free and constrains Y and Z
+	switch (LinkLockType) {
+	case ELinkLockType::LOCK: return std::make_shared<FChLinkFixedLock>();
+	case ELinkLockType::SPHERICAL: return std::make_shared<FChLinkFixedSpherical>();
+	case ELinkLockType::POINTPLANE: return std::make_shared<FChLinkFixedPointPlane>();
+	case ELinkLockType::POINTLINE: return std::make_shared<FChLinkFixedPointLine>();
+	case ELinkLockType::CYLINDRICAL: return std::make_shared<FChLinkFixedCylindrical>();
+	case ELinkLockType::PRISMATIC: return std::make_shared<FChLinkFixedPrismatic>();
+	case ELinkLockType::PLANEPLANE: return std::make_shared<FChLinkFixedPlanePlane>();
+	case ELinkLockType::REVOLUTE: return std::make_shared<FChLinkFixedRevolute>();
+	default: return nullptr;
+	}
+}
+
 void AChLinkLockActor::ChLinkInitialize()
 {
+	if (auto fixed = std::dynamic_pointer_cast<FChLinkFixedBase>(ChData)) {
+		auto body1 = GetTargetBody1();
+		auto body2 = GetTargetBody2();
+		if (body1 && body2) {
+			auto pos = FVECTOR_TO_CHRONO_VEC(this->GetActorLocation());
+			auto rot = FQUAT_TO_CHRONO_QUAT(FQuat(this->GetActorRotation()));
+			fixed->Initialize(body1, body2, chrono::ChFrame<>(pos, rot));
+			this->isInitialized = true;
+		}
+		return;
+	}
+
 	Super::ChLinkInitialize();
 	if (this->isInitialized) {
 		this->isInitialized = false;
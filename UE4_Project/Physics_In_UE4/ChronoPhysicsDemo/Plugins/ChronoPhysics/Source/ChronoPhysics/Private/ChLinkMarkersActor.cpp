@@ -17,8 +17,8 @@ void AChLinkMarkersActor::ChLinkInitialize()
 	Super::ChLinkInitialize();
 
 	if (std::dynamic_pointer_cast<chrono::ChLinkMarkers>(this->ChData)) {
-		auto body1 = Cast<UChBodyComponent>(this->target1->FindComponentByClass(UChBodyComponent::StaticClass()))->GetChData();
-		auto body2 = Cast<UChBodyComponent>(this->target2->FindComponentByClass(UChBodyComponent::StaticClass()))->GetChData();
+		auto body1 = GetTargetBody1();
+		auto body2 = GetTargetBody2();
 		auto pos = FVECTOR_TO_CHRONO_VEC(this->GetActorLocation());
 		auto rot = FQUAT_TO_CHRONO_QUAT(FQuat(this->GetActorRotation()));
 		if (body1 && body2 && std::dynamic_pointer_cast<chrono::ChLinkMarkers>(this->ChData)) {
@@ -5,6 +5,9 @@
 #include "chrono/physics/ChLinkEngine.h"
 #include "UObject/ConstructorHelpers.h"
 #include "Curves/CurveFloat.h"
+#include "ChTelemetry.h"
+#include "ChFunctionRecorder.h"
+#include "ChEngineTorqueFunction.h"
 #include "util.h"
 
 AChLink_EngineActor::AChLink_EngineActor()
@@ -32,42 +35,75 @@ void AChLink_EngineActor::PhysicsObjectConstruct()
 	}
 
 	this->ChData = linkptr;
+	engineLink = linkptr;
+	switch (EngineType) {
+	case EEngineMode::ENG_MODE_ROTATION:
+		motionFunction = std::dynamic_pointer_cast<chrono::ChFunction_Const>(linkptr->Get_rot_funct());
+		break;
+	case EEngineMode::ENG_MODE_SPEED:
+		motionFunction = std::dynamic_pointer_cast<chrono::ChFunction_Const>(linkptr->Get_spe_funct());
+		break;
+	default:
+		motionFunction = std::dynamic_pointer_cast<chrono::ChFunction_Const>(linkptr->Get_tor_funct());
+		break;
+	}
+
+	torqueCurveData.reset();
+	solverTorqueFunction.reset();
+	if (bUseEngineCurve && Curve && bEvaluateCurveInSolver && EngineType == EEngineMode::ENG_MODE_TORQUE) {
+		float minTime, maxTime;
+		Curve->GetTimeRange(minTime, maxTime);
+		int32 samples = FMath::Max(CurveSamples, 2);
+		std::vector<double> table(samples);
+		for (int32 i = 0; i < samples; i++) {
+			table[i] = Curve->GetFloatValue(FMath::Lerp(minTime, maxTime, i / (float)(samples - 1)));
+		}
+		solverTorqueFunction = std::make_shared<FChEngineTorqueFunction>(linkptr.get());
+		solverTorqueFunction->SetTable(MoveTemp(table), minTime, maxTime);
+		solverTorqueFunction->SetScale(CurveScale);
+		linkptr->Set_tor_funct(solverTorqueFunction);
+		motionFunction.reset();
+	}
+	else if (bUseEngineCurve && Curve) {
+		float minTime, maxTime;
+		Curve->GetTimeRange(minTime, maxTime);
+		int32 samples = FMath::Max(CurveSamples, 2);
+		torqueCurveData = std::make_shared<FChFunctionRecorder>();
+		torqueCurveData->Reserve(samples + Curve->FloatCurve.GetNumKeys());
+		for (int32 i = 0; i < samples; i++) {
+			float time = FMath::Lerp(minTime, maxTime, i / (float)(samples - 1));
+			torqueCurveData->AddPoint(time, Curve->GetFloatValue(time));
+		}
+		// The keys themselves stay exact
+		for (auto it = Curve->FloatCurve.GetKeyIterator(); it; ++it) {
+			torqueCurveData->AddPoint(it->Time, it->Value);
+		}
+	}
 }
 
 void AChLink_EngineActor::UpdatePhysicsState()
 {
-	if (EngineType == EEngineMode::ENG_MODE_ROTATION) {
-		auto engine = std::dynamic_pointer_cast<chrono::ChLinkEngine>(this->ChData);
-		if (auto mfun = std::dynamic_pointer_cast<chrono::ChFunction_Const>(engine->Get_rot_funct()))
-			mfun->Set_yconst(motion);
-	}
-	else if (EngineType == EEngineMode::ENG_MODE_SPEED) {
-		auto engine = std::dynamic_pointer_cast<chrono::ChLinkEngine>(this->ChData);
-		if (auto mfun = std::dynamic_pointer_cast<chrono::ChFunction_Const>(engine->Get_spe_funct()))
-			mfun->Set_yconst(motion);
+	if (EngineType == EEngineMode::ENG_MODE_ROTATION || EngineType == EEngineMode::ENG_MODE_SPEED) {
+		if (motionFunction)
+			motionFunction->Set_yconst(latchedMotion);
 	}
 	else if (EngineType == EEngineMode::ENG_MODE_TORQUE) {
-		//UE_LOG(LogTemp, Warning, TEXT("ENG_MODE_TORQUE"));
-		//UE_LOG(LogTemp, Warning, TEXT("bUseEngineCurve %d"), bUseEngineCurve);
-
-		if (bUseEngineCurve && Curve) {
-			auto engine = std::dynamic_pointer_cast<chrono::ChLinkEngine>(this->ChData);
-			float angularSpeed = abs(engine->Get_mot_rot_dt());
-			auto torqueCurve = Curve->GetFloatValue(angularSpeed);
-			//UE_LOG(LogTemp, Warning, TEXT("AngularSpeed %f"), engine->Get_mot_rot_dt());
-			//UE_LOG(LogTemp, Warning, TEXT("Torque %f"), torqueCurve);
-			//UE_LOG(LogTemp, Warning, TEXT("Motion %f"), this->motion);
-			if (auto mfun = std::dynamic_pointer_cast<chrono::ChFunction_Const>(engine->Get_tor_funct()))
-				mfun->Set_yconst(this->motion * torqueCurve);
-			//UE_LOG(LogTemp, Warning, TEXT("Torque %f"), this->motion * torqueCurve);
-			engineTorque = this->motion * torqueCurve;
+		if (solverTorqueFunction) {
+			// Chrono evaluates the curve itself, the torque here is only the one exported
+			solverTorqueFunction->SetThrottle(latchedMotion);
+			engineTorque = latchedMotion * CurveScale * solverTorqueFunction->Lookup(FMath::Abs(engineLink->Get_mot_rot_dt()));
+		}
+		else if (bUseEngineCurve && torqueCurveData) {
+			float angularSpeed = abs(engineLink->Get_mot_rot_dt());
+			auto torqueCurve = torqueCurveData->Get_y(angularSpeed) * CurveScale;
+			if (motionFunction)
+				motionFunction->Set_yconst(this->latchedMotion * torqueCurve);
+			engineTorque = this->latchedMotion * torqueCurve;
 		}
 		else {
-			//UE_LOG(LogTemp, Warning, TEXT("No Curve Mode"));
-			auto engine = std::dynamic_pointer_cast<chrono::ChLinkEngine>(this->ChData);
-			if (auto mfun = std::dynamic_pointer_cast<chrono::ChFunction_Const>(engine->Get_tor_funct()))
-				mfun->Set_yconst(this->motion);
-			engineTorque = motion;
+			if (motionFunction)
+				motionFunction->Set_yconst(this->latchedMotion);
+			engineTorque = latchedMotion;
 		}
 	}
 
@@ -102,6 +138,33 @@ FExportData AChLink_EngineActor::ExportData()
 	return data;
 }
 
+void AChLink_EngineActor::RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList)
+{
+	Super::RegisterTelemetry(telemetry, writerList);
+	if (!bExportData || !ChData) {
+		return;
+	}
+
+	FString prefix = LinkExportDataOwnerName.ToString();
+	engineSpeedChannel = bExportEngineSpeed ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".EngineSpeed"))), 1) : INDEX_NONE;
+	engineTorqueChannel = bExportEngineTorque ? telemetry.RegisterChannel(FName(*(prefix + TEXT(".EngineTorque"))), 1) : INDEX_NONE;
+
+	if (bExportEngineSpeed || bExportEngineTorque) {
+		writerList.AddUnique(this);
+	}
+}
+
+void AChLink_EngineActor::WriteTelemetry(FChTelemetry& telemetry)
+{
+	Super::WriteTelemetry(telemetry);
+	if (engineSpeedChannel != INDEX_NONE) {
+		telemetry.Write(engineSpeedChannel, (float)std::static_pointer_cast<chrono::ChLinkEngine>(this->ChData)->Get_mot_rot_dt());
+	}
+	if (engineTorqueChannel != INDEX_NONE) {
+		telemetry.Write(engineTorqueChannel, this->engineTorque);
+	}
+}
+
 void AChLink_EngineActor::ShowDebugMessage()
 {
 	UE_LOG(LogTemp, Warning, TEXT("AChLink_EngineActor::ShowDebugMessage()"));
@@ -2,6 +2,8 @@
 
 
 #include "ChLink_SpringActor.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "ChPhysicsSceneManagerActor.h"
 #include "chrono/physics/ChLinkSpring.h"
 
 void AChLink_SpringActor::PhysicsObjectConstruct()
@@ -18,3 +20,26 @@ void AChLink_SpringActor::ChLinkInitialize()
 		this->isInitialized = true;
 	}
 }
+
+void AChLink_SpringActor::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	Super::AddToSystem(phySystem);
+	auto spring = std::dynamic_pointer_cast<chrono::ChLinkSpring>(ChData);
+	if (!bMultirate || !this->isInitialized || !spring) {
+		return;
+	}
+	auto registry = FChPhysicsObjectRegistry::Get(GetWorld());
+	AChPhysicsSceneManagerActor* scene = registry ? registry->FindScene(this) : nullptr;
+	if (scene && scene->AddMultirateSpring(spring, SpringCoef, DampCoef)) {
+		multirateScene = scene;
+	}
+}
+
+void AChLink_SpringActor::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	if (multirateScene) {
+		multirateScene->RemoveMultirateSpring(static_cast<chrono::ChLinkSpring*>(ChData.get()));
+		multirateScene = nullptr;
+	}
+	Super::RemoveFromSystem(phySystem);
+}
@@ -7,6 +7,7 @@
 #include "chrono/physics/ChSystem.h"
 #include "chrono/physics/ChLinkUniversal.h"
 #include "ChBodyComponent.h"
+#include "ChPhysicsObjectRegistry.h"
 #include "util.h"
 
 // Sets default values
@@ -67,3 +68,24 @@ void AChLink_UniversalSpringActor::AddToSystem(std::shared_ptr<chrono::ChSystem>
 		phySystem->AddLink(ChLinkRot2);
 	}
 }
+
+void AChLink_UniversalSpringActor::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	for (auto& link : { ChLinkUniversal, ChLinkRot1, ChLinkRot2 }) {
+		if (link && link->GetSystem() == phySystem.get()) {
+			phySystem->RemoveLink(link);
+		}
+	}
+}
+
+void AChLink_UniversalSpringActor::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void AChLink_UniversalSpringActor::PostUnregisterAllComponents()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::PostUnregisterAllComponents();
+}
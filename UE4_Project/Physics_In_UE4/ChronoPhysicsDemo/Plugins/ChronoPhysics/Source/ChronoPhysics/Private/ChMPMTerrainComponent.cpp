@@ -0,0 +1,341 @@
+#include "ChMPMTerrainComponent.h"
+#include "ChMPMTerrainKernels.h"
+#include "ChBodyComponent.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "GameFramework/Volume.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "DynamicRHI.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChForce.h"
+#include "util.h"
+
+#ifndef WITH_CHRONO_CUDA
+#define WITH_CHRONO_CUDA 0
+#endif
+
+namespace {
+	// Texels per row of the position texture
+	const int32 PositionTextureWidth = 1024;
+	// Fraction of a cell the elastic wave may cross in one substep
+	const float MPMCflNumber = 0.3f;
+	// Particles per cell along each axis
+	const int32 ParticlesPerCell = 2;
+
+	// World frame load, the force acts at the body's center
+	std::shared_ptr<chrono::ChForce> AddWorldLoad(chrono::ChBody* body, chrono::ChForce::ForceType mode)
+	{
+		auto load = std::make_shared<chrono::ChForce>();
+		load->SetMode(mode);
+		load->SetFrame(chrono::ChForce::BODY);
+		load->SetAlign(chrono::ChForce::WORLD_DIR);
+		body->AddForce(load);
+		load->SetVrelpoint(chrono::VNULL);
+		load->SetMforce(0);
+		return load;
+	}
+
+	void SetWorldLoad(chrono::ChForce& load, const float value[3])
+	{
+		chrono::ChVector<> vector(value[0], value[1], value[2]);
+		double magnitude = vector.Length();
+		if (magnitude > 0) {
+			load.SetDir(vector / magnitude);
+		}
+		load.SetMforce(magnitude);
+	}
+}
+
+UChMPMTerrainComponent::UChMPMTerrainComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	CastShadow = false;
+}
+
+void UChMPMTerrainComponent::PhysicsObjectConstruct()
+{
+	FillVolume();
+	BuildParticleQuads();
+}
+
+void UChMPMTerrainComponent::FillVolume()
+{
+	particlePositions.Reset();
+	gridBounds = FBox(ForceInit);
+	if (!SoilVolume) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: no soil volume"), *GetName());
+		return;
+	}
+
+	FBox bounds = SoilVolume->GetComponentsBoundingBox(true);
+	FVector size = bounds.GetSize();
+	FIntVector counts(FMath::FloorToInt(size.X / ParticleSpacing), FMath::FloorToInt(size.Y / ParticleSpacing), FMath::FloorToInt(size.Z / ParticleSpacing));
+	for (int32 z = 0; z < counts.Z; z++) {
+		for (int32 y = 0; y < counts.Y; y++) {
+			for (int32 x = 0; x < counts.X; x++) {
+				FVector position = bounds.Min + (FVector(x, y, z) + 0.5f) * ParticleSpacing;
+				if (!SoilVolume->EncompassesPoint(position)) {
+					continue;
+				}
+				chrono::ChVector<> chPosition = FVECTOR_TO_CHRONO_VEC(position);
+				particlePositions.Add(chPosition.x());
+				particlePositions.Add(chPosition.y());
+				particlePositions.Add(chPosition.z());
+			}
+		}
+	}
+
+	// Chrono is Y up, the grid box swaps the UE axes the same way
+	gridBounds = bounds.ExpandBy(GridPadding);
+	float cell = ParticlesPerCell * ParticleSpacing;
+	FVector gridSize = gridBounds.GetSize();
+	gridBins = FIntVector(FMath::CeilToInt(gridSize.X / cell) + 1, FMath::CeilToInt(gridSize.Z / cell) + 1, FMath::CeilToInt(gridSize.Y / cell) + 1);
+	gridMin = FVector(gridBounds.Min.X, gridBounds.Min.Z, gridBounds.Min.Y) / CHRONO_SCALE;
+	UpdateBounds();
+}
+
+void UChMPMTerrainComponent::BuildParticleQuads()
+{
+	// One quad per particle around the component origin, the material moves each to its texel's position
+	int32 particleNum = GetParticleCount();
+	int32 rows = FMath::DivideAndRoundUp(particleNum, PositionTextureWidth);
+	TArray<FVector> vertices;
+	TArray<int32> triangles;
+	TArray<FVector> normals;
+	TArray<FVector2D> uvs;
+	vertices.Reserve(particleNum * 4);
+	triangles.Reserve(particleNum * 6);
+	normals.Init(FVector::UpVector, particleNum * 4);
+	uvs.Reserve(particleNum * 4);
+
+	FTransform transform = GetComponentTransform();
+	float half = ParticleSpacing * 0.5f;
+	const FVector corners[4] = { FVector(-half, -half, 0.f), FVector(half, -half, 0.f), FVector(half, half, 0.f), FVector(-half, half, 0.f) };
+	for (int32 i = 0; i < particleNum; i++) {
+		FVector2D texel((i % PositionTextureWidth + 0.5f) / PositionTextureWidth, (i / PositionTextureWidth + 0.5f) / rows);
+		int32 first = vertices.Num();
+		for (const FVector& corner : corners) {
+			vertices.Add(transform.InverseTransformVectorNoScale(corner));
+			uvs.Add(texel);
+		}
+		triangles.Append({ first, first + 2, first + 1, first, first + 3, first + 2 });
+	}
+	ClearAllMeshSections();
+	if (particleNum > 0) {
+		CreateMeshSection(0, vertices, triangles, normals, uvs, TArray<FColor>(), TArray<FProcMeshTangent>(), false);
+	}
+}
+
+void UChMPMTerrainComponent::PhysicsObjectInitalize()
+{
+	RemoveSoilForces();
+	coupledBodies.clear();
+	coupledProxies.Reset();
+	for (AActor* actor : CoupledActors) {
+		auto comp = actor ? actor->FindComponentByClass<UChBodyComponent>() : nullptr;
+		FChColliderProxy proxy;
+		if (!comp || !comp->GetChData() || !comp->GetColliderProxy(proxy)) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: %s has no sphere or box Chrono body to couple"), *GetName(), actor ? *actor->GetName() : TEXT("None"));
+			continue;
+		}
+		coupledBodies.push_back(comp->GetChData());
+		coupledProxies.Add(proxy);
+		soilForces.push_back(AddWorldLoad(comp->GetChData().get(), chrono::ChForce::FORCE));
+		soilForces.push_back(AddWorldLoad(comp->GetChData().get(), chrono::ChForce::TORQUE));
+	}
+}
+
+void UChMPMTerrainComponent::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	ReleaseTerrain();
+	system = phySystem.get();
+	if (GetParticleCount() == 0) {
+		return;
+	}
+#if WITH_CHRONO_CUDA
+	float lameMu = YoungModulus / (2.f * (1.f + PoissonRatio));
+	float lameLambda = YoungModulus * PoissonRatio / ((1.f + PoissonRatio) * (1.f - 2.f * PoissonRatio));
+	float spacing = ParticleSpacing / CHRONO_SCALE;
+	float cell = ParticlesPerCell * spacing;
+	float waveSpeed = FMath::Sqrt((lameLambda + 2.f * lameMu) / Density);
+
+	ChMPMTerrain::FSettings settings = {};
+	chrono::MPM_Settings& mpm = settings.Mpm;
+	mpm.dt = MPMCflNumber * cell / waveSpeed;
+	mpm.bin_edge = cell;
+	mpm.inv_bin_edge = 1.f / cell;
+	mpm.max_velocity = cell / mpm.dt;
+	mpm.youngs_modulus = YoungModulus;
+	mpm.poissons_ratio = PoissonRatio;
+	mpm.mu = lameMu;
+	mpm.lambda = lameLambda;
+	mpm.num_mpm_markers = GetParticleCount();
+	mpm.num_mpm_nodes = gridBins.X * gridBins.Y * gridBins.Z;
+	mpm.bins_per_axis_x = gridBins.X;
+	mpm.bins_per_axis_y = gridBins.Y;
+	mpm.bins_per_axis_z = gridBins.Z;
+	settings.ParticleVolume = spacing * spacing * spacing;
+	mpm.mass = Density * settings.ParticleVolume;
+	const chrono::ChVector<>& gravity = phySystem->Get_G_acc();
+	for (int32 k = 0; k < 3; k++) {
+		settings.GridMin[k] = gridMin[k];
+		settings.Gravity[k] = gravity[k];
+	}
+	settings.FrictionAngle = FMath::DegreesToRadians(FrictionAngle);
+	settings.BodyFriction = BodyFriction;
+	settings.Material = SoilMaterial == EChMPMSoilMaterial::SAND ? ChMPMTerrain::Sand : ChMPMTerrain::Elastic;
+
+	terrain = ChMPMTerrain::Create(particlePositions.GetData(), GetParticleCount(), (int32)coupledBodies.size(), settings);
+	if (!terrain) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: the CUDA device can't hold %d particles on a %dx%dx%d grid"), *GetName(), GetParticleCount(), gridBins.X, gridBins.Y, gridBins.Z);
+		return;
+	}
+	CreatePositionTarget();
+#else
+	UE_LOG(LogTemp, Warning, TEXT("%s: MPM soil needs the CUDA kernels, see ChronoPhysics.Build.cs"), *GetName());
+#endif
+}
+
+void UChMPMTerrainComponent::CreatePositionTarget()
+{
+#if WITH_CHRONO_CUDA
+	int32 rows = FMath::DivideAndRoundUp(GetParticleCount(), PositionTextureWidth);
+	PositionTarget = NewObject<UTextureRenderTarget2D>(this);
+	PositionTarget->RenderTargetFormat = RTF_RGBA32f;
+	PositionTarget->InitCustomFormat(PositionTextureWidth, rows, PF_A32B32G32R32F, true);
+	PositionTarget->UpdateResourceImmediate(true);
+
+	if (ParticleMaterial) {
+		particleMaterialInstance = UMaterialInstanceDynamic::Create(ParticleMaterial, this);
+		particleMaterialInstance->SetTextureParameterValue(PositionTextureParameter, PositionTarget);
+		SetMaterial(0, particleMaterialInstance);
+	}
+
+	// The interop only knows D3D11 textures, other RHIs keep the quads where they were built
+	ChMPMTerrain::FTerrain* deviceTerrain = terrain;
+	FTextureRenderTargetResource* resource = PositionTarget->GameThread_GetRenderTargetResource();
+	FString name = GetName();
+	ENQUEUE_RENDER_COMMAND(ChMPMRegisterPositionTarget)([deviceTerrain, resource, rows, name](FRHICommandListImmediate& RHICmdList) {
+		bool bRegistered = FCString::Strcmp(GDynamicRHI->GetName(), TEXT("D3D11")) == 0
+			&& ChMPMTerrain::RegisterRenderTarget(deviceTerrain, resource->GetRenderTargetTexture()->GetNativeResource(), PositionTextureWidth, rows);
+		if (!bRegistered) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: can't share the position texture with CUDA"), *name);
+		}
+	});
+#endif
+}
+
+void UChMPMTerrainComponent::UpdatePhysicsState()
+{
+#if WITH_CHRONO_CUDA
+	if (!terrain || !system) {
+		return;
+	}
+
+	// The soil's forces of the step that ran next to the last Chrono step, one step behind
+	if (bStepQueued) {
+		const ChMPMTerrain::FBodyForce* forces = ChMPMTerrain::WaitForForces(terrain);
+		for (size_t i = 0; i < coupledBodies.size(); i++) {
+			const ChMPMTerrain::FBodyForce& force = forces[i];
+			SetWorldLoad(*soilForces[2 * i], force.Force);
+			SetWorldLoad(*soilForces[2 * i + 1], force.Torque);
+		}
+	}
+
+	TArray<ChMPMTerrain::FBodyState> states;
+	states.SetNumZeroed(coupledBodies.size());
+	for (int32 i = 0; i < states.Num(); i++) {
+		auto& body = coupledBodies[i];
+		ChMPMTerrain::FBodyState& state = states[i];
+		const chrono::ChVector<>& pos = body->GetPos();
+		const chrono::ChQuaternion<>& rot = body->GetRot();
+		const chrono::ChVector<>& vel = body->GetPos_dt();
+		chrono::ChVector<> angVel = body->GetWvel_par();
+		for (int32 k = 0; k < 3; k++) {
+			state.Pos[k] = pos[k];
+			state.Vel[k] = vel[k];
+			state.AngVel[k] = angVel[k];
+		}
+		state.Rot[0] = rot.e0();
+		state.Rot[1] = rot.e1();
+		state.Rot[2] = rot.e2();
+		state.Rot[3] = rot.e3();
+		const FChColliderProxy& proxy = coupledProxies[i];
+		state.Shape = proxy.Type == FChColliderProxy::Box ? ChMPMTerrain::Box : ChMPMTerrain::Sphere;
+		state.HalfExtent[0] = proxy.Extent.X;
+		state.HalfExtent[1] = proxy.Extent.Y;
+		state.HalfExtent[2] = proxy.Extent.Z;
+	}
+	ChMPMTerrain::Step(terrain, states.GetData(), states.Num(), (float)system->GetStep());
+	bStepQueued = true;
+#endif
+}
+
+void UChMPMTerrainComponent::UpdateVisualAsset()
+{
+#if WITH_CHRONO_CUDA
+	if (!terrain) {
+		return;
+	}
+	ChMPMTerrain::FTerrain* deviceTerrain = terrain;
+	ENQUEUE_RENDER_COMMAND(ChMPMCopyPositions)([deviceTerrain](FRHICommandListImmediate& RHICmdList) {
+		ChMPMTerrain::CopyPositionsToRenderTarget(deviceTerrain);
+	});
+#endif
+}
+
+FBoxSphereBounds UChMPMTerrainComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	// The quads sit at the origin until the material moves them, the grid bounds every particle
+	if (gridBounds.IsValid) {
+		return FBoxSphereBounds(gridBounds);
+	}
+	return Super::CalcBounds(LocalToWorld);
+}
+
+void UChMPMTerrainComponent::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	ReleaseTerrain();
+	RemoveSoilForces();
+	system = nullptr;
+}
+
+void UChMPMTerrainComponent::RemoveSoilForces()
+{
+	for (auto& load : soilForces) {
+		if (load->GetBody()) {
+			load->GetBody()->RemoveForce(load);
+		}
+	}
+	soilForces.clear();
+}
+
+void UChMPMTerrainComponent::ReleaseTerrain()
+{
+#if WITH_CHRONO_CUDA
+	if (terrain) {
+		// Queued copies still point at the terrain
+		FlushRenderingCommands();
+		ChMPMTerrain::Destroy(terrain);
+	}
+#endif
+	terrain = nullptr;
+	bStepQueued = false;
+}
+
+void UChMPMTerrainComponent::OnRegister()
+{
+	Super::OnRegister();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void UChMPMTerrainComponent::OnUnregister()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	ReleaseTerrain();
+	Super::OnUnregister();
+}
@@ -0,0 +1,542 @@
+// UBT doesn't compile .cu files, nvcc builds this with ChGpuRigidKernels.cu into Lib/ChronoPhysicsCuda.lib:
+//   nvcc -c -O3 -Xcompiler /MD -I../Include -o ChMPMTerrainKernels.obj ChMPMTerrainKernels.cu
+//   lib /OUT:../Lib/ChronoPhysicsCuda.lib ChGpuRigidKernels.obj ChMPMTerrainKernels.obj
+// The render target interop needs the D3D11 headers of the Windows SDK
+
+#include "ChMPMTerrainKernels.h"
+#include "chrono_parallel/ChCudaDefines.h"
+#include "chrono_parallel/ChCudaHelper.cuh"
+#include "chrono_parallel/ChGPUVector.cuh"
+#include "chrono_parallel/math/matrixf.cuh"
+#include "chrono_parallel/math/svd.h"
+#include <d3d11.h>
+#include <cuda_d3d11_interop.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace chrono;
+
+namespace ChMPMTerrain {
+
+namespace {
+	// Nodes this close to the grid border are slip walls, the particles' 3x3x3 stencil never leaves the grid
+	const int32_t WallNodes = 2;
+	const float MinSingularValue = 1e-4f;
+	// CHRONO_SCALE of util.h, the render target is in UE units
+	const float ChronoScale = 100.f;
+
+	struct FGrid
+	{
+		// Momentum in xyz until UpdateGrid turns it into the velocity, mass in w
+		float4* Nodes;
+		int3 Bins;
+		float3 Min;
+		float Dx;
+		float InvDx;
+	};
+
+	struct FParticles
+	{
+		float4* Pos;
+		float4* Vel;
+		// APIC affine velocity
+		Mat33f* C;
+		// Elastic part of the deformation gradient
+		Mat33f* F;
+		int32_t Count;
+	};
+
+	struct FMaterial
+	{
+		float Mass;
+		float Volume;
+		float Mu;
+		float Lambda;
+		// Drucker-Prager cone of the friction angle
+		float Alpha;
+		float MaxSpeed;
+		uint8_t Type;
+	};
+
+	struct FBodies
+	{
+		const FBodyState* States;
+		FBodyForce* Forces;
+		int32_t Count;
+		float Friction;
+	};
+
+	__device__ inline float3 Xyz(const float4& v) { return make_float3(v.x, v.y, v.z); }
+	__device__ inline float3 ToFloat3(const float* v) { return make_float3(v[0], v[1], v[2]); }
+	__device__ inline float3 Scale(const float3& a, const float3& b) { return make_float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+
+	// Sign -1 rotates by the inverse of q, which is (w, x, y, z)
+	__device__ inline float3 Rotate(const float* q, const float3& v, float sign)
+	{
+		float3 u = make_float3(q[1], q[2], q[3]) * sign;
+		float3 t = Cross(u, v) * 2.f;
+		return v + t * q[0] + Cross(u, t);
+	}
+
+	// Signed distance to the surface and the outward normal, both in the body frame
+	__device__ float BodyDistance(const FBodyState& body, const float3& local, float3& outNormal)
+	{
+		if (body.Shape == Sphere) {
+			float length = Length(local);
+			outNormal = length > 0.f ? local / length : make_float3(0.f, 1.f, 0.f);
+			return length - body.HalfExtent[0];
+		}
+		float3 sign = make_float3(local.x < 0.f ? -1.f : 1.f, local.y < 0.f ? -1.f : 1.f, local.z < 0.f ? -1.f : 1.f);
+		float3 q = make_float3(fabsf(local.x) - body.HalfExtent[0], fabsf(local.y) - body.HalfExtent[1], fabsf(local.z) - body.HalfExtent[2]);
+		float3 outside = Max(q, 0.f);
+		float outsideLength = Length(outside);
+		if (outsideLength > 0.f) {
+			outNormal = Scale(outside, sign) / outsideLength;
+			return outsideLength;
+		}
+		// Inside, out through the nearest face
+		if (q.x >= q.y && q.x >= q.z) {
+			outNormal = make_float3(sign.x, 0.f, 0.f);
+			return q.x;
+		}
+		if (q.y >= q.z) {
+			outNormal = make_float3(0.f, sign.y, 0.f);
+			return q.y;
+		}
+		outNormal = make_float3(0.f, 0.f, sign.z);
+		return q.z;
+	}
+
+	// Quadratic B-spline weights of the three nodes from base along each axis, fx in cells from base
+	__device__ inline void Weights(const float3& fx, float3 (&w)[3])
+	{
+		w[0] = make_float3(0.5f * Sqr(1.5f - fx.x), 0.5f * Sqr(1.5f - fx.y), 0.5f * Sqr(1.5f - fx.z));
+		w[1] = make_float3(0.75f - Sqr(fx.x - 1.f), 0.75f - Sqr(fx.y - 1.f), 0.75f - Sqr(fx.z - 1.f));
+		w[2] = make_float3(0.5f * Sqr(fx.x - 0.5f), 0.5f * Sqr(fx.y - 0.5f), 0.5f * Sqr(fx.z - 0.5f));
+	}
+
+	__device__ inline int3 StencilBase(const FGrid& grid, const float3& position, float3& outFx)
+	{
+		float3 x = (position - grid.Min) * grid.InvDx;
+		int3 base = make_int3((int)floorf(x.x - 0.5f), (int)floorf(x.y - 0.5f), (int)floorf(x.z - 0.5f));
+		outFx = x - make_float3((float)base.x, (float)base.y, (float)base.z);
+		return base;
+	}
+
+	__device__ inline int32_t NodeIndex(const FGrid& grid, int x, int y, int z)
+	{
+		return (z * grid.Bins.y + y) * grid.Bins.x + x;
+	}
+
+	__device__ inline float3 LogSingularValues(const float3& sigma)
+	{
+		return make_float3(logf(fmaxf(sigma.x, MinSingularValue)), logf(fmaxf(sigma.y, MinSingularValue)), logf(fmaxf(sigma.z, MinSingularValue)));
+	}
+
+	__device__ Mat33f KirchhoffStress(const Mat33f& F, const FMaterial& material)
+	{
+		Mat33f U, V;
+		float3 sigma;
+		SVD(F, U, sigma, V);
+		if (material.Type == Sand) {
+			// Hencky strain, ProjectSand already put it inside the cone
+			float3 eps = LogSingularValues(sigma);
+			float3 tau = eps * (2.f * material.Mu) + (eps.x + eps.y + eps.z) * material.Lambda;
+			return MultTranspose(U * Mat33f(tau), U);
+		}
+		// Fixed corotated
+		Mat33f R = MultTranspose(U, V);
+		float J = sigma.x * sigma.y * sigma.z;
+		return MultTranspose(F - R, F) * (2.f * material.Mu) + Mat33f(material.Lambda * (J - 1.f) * J);
+	}
+
+	// Klar et al. 2016: the Hencky strain is returned onto the Drucker-Prager cone, expansion leaves no stress
+	__device__ Mat33f ProjectSand(const Mat33f& F, const FMaterial& material)
+	{
+		Mat33f U, V;
+		float3 sigma;
+		SVD(F, U, sigma, V);
+		float3 eps = LogSingularValues(sigma);
+		float trace = eps.x + eps.y + eps.z;
+		if (trace >= 0.f) {
+			return MultTranspose(U, V);
+		}
+		float3 deviator = eps - trace / 3.f;
+		float deviatorNorm = Length(deviator);
+		float yield = deviatorNorm + (3.f * material.Lambda + 2.f * material.Mu) / (2.f * material.Mu) * trace * material.Alpha;
+		if (yield <= 0.f || deviatorNorm <= 0.f) {
+			return F;
+		}
+		float3 h = eps - deviator * (yield / deviatorNorm);
+		return MultTranspose(U * Mat33f(make_float3(expf(h.x), expf(h.y), expf(h.z))), V);
+	}
+
+	// MLS-MPM transfer, the stress goes into the affine momentum
+	__global__ void ParticlesToGrid(FParticles particles, FGrid grid, FMaterial material, float dt)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= particles.Count) {
+			return;
+		}
+		float3 fx;
+		int3 base = StencilBase(grid, Xyz(particles.Pos[i]), fx);
+		float3 w[3];
+		Weights(fx, w);
+
+		Mat33f stress = KirchhoffStress(particles.F[i], material) * (-dt * material.Volume * 4.f * grid.InvDx * grid.InvDx);
+		Mat33f affine = stress + particles.C[i] * material.Mass;
+		float3 momentum = Xyz(particles.Vel[i]) * material.Mass;
+		for (int a = 0; a < 3; a++) {
+			for (int b = 0; b < 3; b++) {
+				for (int c = 0; c < 3; c++) {
+					float weight = w[a].x * w[b].y * w[c].z;
+					float3 dpos = (make_float3((float)a, (float)b, (float)c) - fx) * grid.Dx;
+					float3 nodeMomentum = (momentum + affine * dpos) * weight;
+					float4* node = grid.Nodes + NodeIndex(grid, base.x + a, base.y + b, base.z + c);
+					atomicAdd(&node->x, nodeMomentum.x);
+					atomicAdd(&node->y, nodeMomentum.y);
+					atomicAdd(&node->z, nodeMomentum.z);
+					atomicAdd(&node->w, weight * material.Mass);
+				}
+			}
+		}
+	}
+
+	// Gravity, the coupled bodies as moving boundaries and the grid border as slip walls.
+	// What a body takes from a node's momentum is the soil's force on it
+	__global__ void UpdateGrid(FGrid grid, FBodies bodies, float3 gravity, float dt, float invStepSize)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= grid.Bins.x * grid.Bins.y * grid.Bins.z) {
+			return;
+		}
+		float4 node = grid.Nodes[i];
+		if (node.w <= 0.f) {
+			return;
+		}
+		float3 v = Xyz(node) / node.w + gravity * dt;
+		int x = i % grid.Bins.x;
+		int y = (i / grid.Bins.x) % grid.Bins.y;
+		int z = i / (grid.Bins.x * grid.Bins.y);
+		float3 position = grid.Min + make_float3((float)x, (float)y, (float)z) * grid.Dx;
+
+		for (int32_t b = 0; b < bodies.Count; b++) {
+			const FBodyState& body = bodies.States[b];
+			float3 arm = position - ToFloat3(body.Pos);
+			float3 normal;
+			// Half a cell of margin, a thin body still catches the nodes next to it
+			if (BodyDistance(body, Rotate(body.Rot, arm, -1.f), normal) >= 0.5f * grid.Dx) {
+				continue;
+			}
+			normal = Rotate(body.Rot, normal, 1.f);
+			float3 bodyVel = ToFloat3(body.Vel) + Cross(ToFloat3(body.AngVel), arm);
+			float3 relative = v - bodyVel;
+			float normalSpeed = Dot(relative, normal);
+			if (normalSpeed >= 0.f) {
+				continue;
+			}
+			// Coulomb, the normal impulse bounds the tangential one
+			float3 tangent = relative - normal * normalSpeed;
+			float tangentSpeed = Length(tangent);
+			float keep = tangentSpeed > 0.f ? fmaxf(0.f, 1.f + bodies.Friction * normalSpeed / tangentSpeed) : 0.f;
+			float3 next = bodyVel + tangent * keep;
+			float3 force = (v - next) * (node.w * invStepSize);
+			AtomicAdd(reinterpret_cast<float3*>(bodies.Forces[b].Force), force);
+			AtomicAdd(reinterpret_cast<float3*>(bodies.Forces[b].Torque), Cross(arm, force));
+			v = next;
+		}
+
+		if ((x < WallNodes && v.x < 0.f) || (x >= grid.Bins.x - WallNodes && v.x > 0.f)) {
+			v.x = 0.f;
+		}
+		if ((y < WallNodes && v.y < 0.f) || (y >= grid.Bins.y - WallNodes && v.y > 0.f)) {
+			v.y = 0.f;
+		}
+		if ((z < WallNodes && v.z < 0.f) || (z >= grid.Bins.z - WallNodes && v.z > 0.f)) {
+			v.z = 0.f;
+		}
+		grid.Nodes[i] = make_float4(v.x, v.y, v.z, node.w);
+	}
+
+	__global__ void GridToParticles(FParticles particles, FGrid grid, FMaterial material, float dt)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= particles.Count) {
+			return;
+		}
+		float3 position = Xyz(particles.Pos[i]);
+		float3 fx;
+		int3 base = StencilBase(grid, position, fx);
+		float3 w[3];
+		Weights(fx, w);
+
+		float3 v = make_float3(0.f, 0.f, 0.f);
+		Mat33f B(0.f);
+		for (int a = 0; a < 3; a++) {
+			for (int b = 0; b < 3; b++) {
+				for (int c = 0; c < 3; c++) {
+					float weight = w[a].x * w[b].y * w[c].z;
+					float3 dpos = (make_float3((float)a, (float)b, (float)c) - fx) * grid.Dx;
+					float3 nodeVel = Xyz(grid.Nodes[NodeIndex(grid, base.x + a, base.y + b, base.z + c)]) * weight;
+					v = v + nodeVel;
+					B = B + OuterProduct(nodeVel, dpos);
+				}
+			}
+		}
+		Mat33f C = B * (4.f * grid.InvDx * grid.InvDx);
+		float speed = Length(v);
+		if (speed > material.MaxSpeed) {
+			v = v * (material.MaxSpeed / speed);
+		}
+
+		// One cell inside the grid, the stencil of the next substep stays on it
+		float3 low = grid.Min + grid.Dx;
+		float3 high = grid.Min + make_float3((float)(grid.Bins.x - 2), (float)(grid.Bins.y - 2), (float)(grid.Bins.z - 2)) * grid.Dx;
+		position = Min(Max(position + v * dt, low), high);
+
+		Mat33f F = (Mat33f(1.f) + C * dt) * particles.F[i];
+		if (material.Type == Sand) {
+			F = ProjectSand(F, material);
+		}
+		particles.Pos[i] = make_float4(position.x, position.y, position.z, 1.f);
+		particles.Vel[i] = make_float4(v.x, v.y, v.z, 0.f);
+		particles.C[i] = C;
+		particles.F[i] = F;
+	}
+
+	// Chrono to UE as CHRONO_VEC_TO_FVECTOR, Y up to Z up and m to cm
+	__global__ void WritePositions(const float4* positions, int32_t count, int32_t width, cudaSurfaceObject_t surface)
+	{
+		int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+		if (i >= count) {
+			return;
+		}
+		float4 p = positions[i];
+		surf2Dwrite(make_float4(p.x * ChronoScale, p.z * ChronoScale, p.y * ChronoScale, 1.f), surface, (i % width) * (int)sizeof(float4), i / width);
+	}
+}
+
+struct FTerrain
+{
+	cudaStream_t Stream = nullptr;
+	cudaEvent_t Done = nullptr;
+	FSettings Settings;
+	FMaterial Material;
+	int32_t ParticleCount = 0;
+	int32_t NodeCount = 0;
+	int32_t MaxBodies = 0;
+	int32_t BodyCount = 0;
+
+	gpu_vector<float4> Pos, Vel, Nodes;
+	gpu_vector<Mat33f> C, F;
+	gpu_vector<FBodyState> Bodies;
+	gpu_vector<FBodyForce> Forces;
+
+	// Pinned, the states are copied up at the start of each step and the forces back at the end
+	FBodyState* HostBodies = nullptr;
+	FBodyForce* HostForces = nullptr;
+
+	cudaGraphicsResource* Target = nullptr;
+	int32_t TargetWidth = 0;
+	// Of the last copy, destroyed by the next one once the copy had a frame to finish
+	cudaSurfaceObject_t Surface = 0;
+
+	FGrid Grid()
+	{
+		const MPM_Settings& mpm = Settings.Mpm;
+		return { Nodes(), make_int3(mpm.bins_per_axis_x, mpm.bins_per_axis_y, mpm.bins_per_axis_z),
+			make_float3(Settings.GridMin[0], Settings.GridMin[1], Settings.GridMin[2]), mpm.bin_edge, mpm.inv_bin_edge };
+	}
+
+	FParticles Particles()
+	{
+		return { Pos(), Vel(), C(), F(), ParticleCount };
+	}
+};
+
+bool IsDeviceAvailable()
+{
+	int count = 0;
+	return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+FTerrain* Create(const float* positions, int32_t count, int32_t maxBodies, const FSettings& settings)
+{
+	const MPM_Settings& mpm = settings.Mpm;
+	int64_t nodeCount = (int64_t)mpm.bins_per_axis_x * mpm.bins_per_axis_y * mpm.bins_per_axis_z;
+	if (count <= 0 || mpm.bin_edge <= 0.f || mpm.dt <= 0.f || nodeCount <= 0 || nodeCount > INT32_MAX
+		|| std::min(std::min(mpm.bins_per_axis_x, mpm.bins_per_axis_y), mpm.bins_per_axis_z) <= 2 * WallNodes || !IsDeviceAvailable()) {
+		return nullptr;
+	}
+
+	FTerrain* terrain = new FTerrain();
+	terrain->Settings = settings;
+	terrain->Settings.Mpm.inv_bin_edge = 1.f / mpm.bin_edge;
+	terrain->ParticleCount = count;
+	terrain->NodeCount = (int32_t)nodeCount;
+	terrain->MaxBodies = std::max(maxBodies, 1);
+
+	FMaterial& material = terrain->Material;
+	material.Mass = mpm.mass;
+	material.Volume = settings.ParticleVolume;
+	material.Mu = mpm.mu;
+	material.Lambda = mpm.lambda;
+	float sinFriction = sinf(settings.FrictionAngle);
+	material.Alpha = sqrtf(2.f / 3.f) * 2.f * sinFriction / (3.f - sinFriction);
+	material.MaxSpeed = mpm.max_velocity > 0.f ? mpm.max_velocity : mpm.bin_edge / mpm.dt;
+	material.Type = settings.Material;
+
+	auto& pos = terrain->Pos.getHost();
+	auto& vel = terrain->Vel.getHost();
+	auto& affine = terrain->C.getHost();
+	auto& deformation = terrain->F.getHost();
+	pos.reserve(count);
+	for (int32_t i = 0; i < count; i++) {
+		pos.push_back(make_float4(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2], 1.f));
+	}
+	vel.assign(count, make_float4(0.f, 0.f, 0.f, 0.f));
+	affine.assign(count, Mat33f(0.f));
+	deformation.assign(count, Mat33f(1.f));
+	terrain->Pos.copyHostToDevice();
+	terrain->Vel.copyHostToDevice();
+	terrain->C.copyHostToDevice();
+	terrain->F.copyHostToDevice();
+	// Nothing reads the particles on the host again
+	pos = std::vector<float4>();
+	vel = std::vector<float4>();
+	affine = std::vector<Mat33f>();
+	deformation = std::vector<Mat33f>();
+
+	terrain->Nodes.allocate(terrain->NodeCount);
+	terrain->Bodies.allocate(terrain->MaxBodies);
+	terrain->Forces.allocate(terrain->MaxBodies);
+
+	cudaStreamCreateWithFlags(&terrain->Stream, cudaStreamNonBlocking);
+	cudaEventCreateWithFlags(&terrain->Done, cudaEventDisableTiming);
+	cudaMallocHost(&terrain->HostBodies, sizeof(FBodyState) * terrain->MaxBodies);
+	cudaMallocHost(&terrain->HostForces, sizeof(FBodyForce) * terrain->MaxBodies);
+	if (cudaGetLastError() != cudaSuccess || !terrain->HostBodies || !terrain->HostForces) {
+		Destroy(terrain);
+		return nullptr;
+	}
+	std::fill(terrain->HostForces, terrain->HostForces + terrain->MaxBodies, FBodyForce{});
+	cudaEventRecord(terrain->Done, terrain->Stream);
+	return terrain;
+}
+
+void Destroy(FTerrain* terrain)
+{
+	if (!terrain) {
+		return;
+	}
+	if (terrain->Stream) {
+		cudaStreamSynchronize(terrain->Stream);
+		cudaStreamDestroy(terrain->Stream);
+	}
+	if (terrain->Surface) {
+		cudaDestroySurfaceObject(terrain->Surface);
+	}
+	if (terrain->Target) {
+		cudaGraphicsUnregisterResource(terrain->Target);
+	}
+	if (terrain->Done) {
+		cudaEventDestroy(terrain->Done);
+	}
+	cudaFreeHost(terrain->HostBodies);
+	cudaFreeHost(terrain->HostForces);
+	delete terrain;
+}
+
+void Step(FTerrain* terrain, const FBodyState* bodies, int32_t bodyCount, float stepSize)
+{
+	if (!terrain || stepSize <= 0.f) {
+		return;
+	}
+	// The pinned states may still be read by the last step's copy
+	cudaEventSynchronize(terrain->Done);
+	cudaStream_t stream = terrain->Stream;
+	terrain->BodyCount = std::min(std::max(bodyCount, 0), terrain->MaxBodies);
+	if (terrain->BodyCount > 0) {
+		std::copy(bodies, bodies + terrain->BodyCount, terrain->HostBodies);
+		cudaMemcpyAsync(terrain->Bodies(), terrain->HostBodies, sizeof(FBodyState) * terrain->BodyCount, cudaMemcpyHostToDevice, stream);
+		cudaMemsetAsync(terrain->Forces(), 0, sizeof(FBodyForce) * terrain->BodyCount, stream);
+	}
+
+	const FSettings& settings = terrain->Settings;
+	int32_t substeps = std::max(1, (int32_t)ceilf(stepSize / settings.Mpm.dt));
+	float dt = stepSize / substeps;
+	FGrid grid = terrain->Grid();
+	FParticles particles = terrain->Particles();
+	FBodies coupled = { terrain->Bodies(), terrain->Forces(), terrain->BodyCount, settings.BodyFriction };
+	float3 gravity = make_float3(settings.Gravity[0], settings.Gravity[1], settings.Gravity[2]);
+	for (int32_t i = 0; i < substeps; i++) {
+		cudaMemsetAsync(terrain->Nodes(), 0, sizeof(float4) * terrain->NodeCount, stream);
+		ParticlesToGrid<<<CONFIG(terrain->ParticleCount), 0, stream>>>(particles, grid, terrain->Material, dt);
+		UpdateGrid<<<CONFIG(terrain->NodeCount), 0, stream>>>(grid, coupled, gravity, dt, 1.f / stepSize);
+		GridToParticles<<<CONFIG(terrain->ParticleCount), 0, stream>>>(particles, grid, terrain->Material, dt);
+	}
+
+	if (terrain->BodyCount > 0) {
+		cudaMemcpyAsync(terrain->HostForces, terrain->Forces(), sizeof(FBodyForce) * terrain->BodyCount, cudaMemcpyDeviceToHost, stream);
+	}
+	cudaEventRecord(terrain->Done, stream);
+}
+
+const FBodyForce* WaitForForces(FTerrain* terrain)
+{
+	if (!terrain) {
+		return nullptr;
+	}
+	cudaEventSynchronize(terrain->Done);
+	return terrain->HostForces;
+}
+
+int32_t GetParticleCount(const FTerrain* terrain)
+{
+	return terrain ? terrain->ParticleCount : 0;
+}
+
+bool RegisterRenderTarget(FTerrain* terrain, void* d3d11Texture, int32_t width, int32_t height)
+{
+	if (!terrain || !d3d11Texture || width <= 0 || (int64_t)width * height < terrain->ParticleCount) {
+		return false;
+	}
+	if (terrain->Target) {
+		cudaGraphicsUnregisterResource(terrain->Target);
+		terrain->Target = nullptr;
+	}
+	if (cudaGraphicsD3D11RegisterResource(&terrain->Target, static_cast<ID3D11Resource*>(d3d11Texture), cudaGraphicsRegisterFlagsSurfaceLoadStore) != cudaSuccess) {
+		terrain->Target = nullptr;
+		return false;
+	}
+	cudaGraphicsResourceSetMapFlags(terrain->Target, cudaGraphicsMapFlagsWriteDiscard);
+	terrain->TargetWidth = width;
+	return true;
+}
+
+void CopyPositionsToRenderTarget(FTerrain* terrain)
+{
+	if (!terrain || !terrain->Target) {
+		return;
+	}
+	// On the terrain's stream, so after the steps queued so far and without waiting for them here
+	cudaStream_t stream = terrain->Stream;
+	if (cudaGraphicsMapResources(1, &terrain->Target, stream) != cudaSuccess) {
+		return;
+	}
+	cudaArray_t array = nullptr;
+	cudaGraphicsSubResourceGetMappedArray(&array, terrain->Target, 0, 0);
+	cudaResourceDesc desc = {};
+	desc.resType = cudaResourceTypeArray;
+	desc.res.array.array = array;
+	if (terrain->Surface) {
+		cudaDestroySurfaceObject(terrain->Surface);
+		terrain->Surface = 0;
+	}
+	if (array && cudaCreateSurfaceObject(&terrain->Surface, &desc) == cudaSuccess) {
+		WritePositions<<<CONFIG(terrain->ParticleCount), 0, stream>>>(terrain->Pos(), terrain->ParticleCount, terrain->TargetWidth, terrain->Surface);
+	}
+	cudaGraphicsUnmapResources(1, &terrain->Target, stream);
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+// Shared by ChMPMTerrainComponent.cpp and ChMPMTerrainKernels.cu, which nvcc builds without the engine headers
+#include <cstdint>
+#include "chrono_parallel/physics/ChMPMSettings.h"
+
+namespace ChMPMTerrain {
+	enum EShape : uint8_t {
+		Sphere,
+		Box
+	};
+
+	enum EMaterial : uint8_t {
+		// Drucker-Prager plasticity, cohesionless
+		Sand,
+		// Fixed corotated, no plasticity
+		Elastic
+	};
+
+	// Chrono units and frame
+	struct FSettings
+	{
+		// dt is the largest substep, bin_edge the grid spacing, mass the particle mass, mu and lambda the Lame
+		// parameters, max_velocity the particle speed clamp and bins_per_axis the grid size. The rest is unused
+		chrono::MPM_Settings Mpm;
+		float ParticleVolume;
+		float GridMin[3];
+		float Gravity[3];
+		// Radians
+		float FrictionAngle;
+		// Coulomb friction between the soil and the coupled bodies
+		float BodyFriction;
+		uint8_t Material;
+	};
+
+	// Uploaded with every step, rotations are (w, x, y, z)
+	struct FBodyState
+	{
+		float Pos[3];
+		float Rot[4];
+		float Vel[3];
+		// World frame
+		float AngVel[3];
+		// Radius in the first component for spheres
+		float HalfExtent[3];
+		uint8_t Shape;
+	};
+
+	// Soil on the body averaged over the step, world frame, torque about the body center
+	struct FBodyForce
+	{
+		float Force[3];
+		float Torque[3];
+	};
+
+	struct FTerrain;
+
+	bool IsDeviceAvailable();
+	// Copies the particles to the device once, nullptr when the device can't hold them or the grid
+	FTerrain* Create(const float* positions, int32_t count, int32_t maxBodies, const FSettings& settings);
+	void Destroy(FTerrain* terrain);
+	// Queued on the terrain's stream and returns right away, as many substeps as the settings' dt needs.
+	// The forces on the bodies are copied back at the end
+	void Step(FTerrain* terrain, const FBodyState* bodies, int32_t bodyCount, float stepSize);
+	// Blocks until the last step finished, one force per body given to it
+	const FBodyForce* WaitForForces(FTerrain* terrain);
+	int32_t GetParticleCount(const FTerrain* terrain);
+
+	// Render thread only. The texture is an ID3D11Texture2D of 32 bit float RGBA, one texel per particle row by row
+	bool RegisterRenderTarget(FTerrain* terrain, void* d3d11Texture, int32_t width, int32_t height);
+	// Render thread only. Writes the particles in UE world space into the texture after the queued steps, on the device
+	void CopyPositionsToRenderTarget(FTerrain* terrain);
+}
@@ -0,0 +1,286 @@
+#include "ChMaterialLibrary.h"
+#include "chrono/physics/ChMaterialSurfaceNSC.h"
+#include "chrono/physics/ChMaterialSurfaceSMC.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChContactContainer.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "chrono_parallel/physics/ChSystemParallel.h"
+#include "Misc/ScopeLock.h"
+
+namespace {
+	struct FMaterialEntry {
+		FChMaterialValues Values;
+		std::weak_ptr<chrono::ChMaterialSurface> Material;
+		// Set for the materials built from an asset, those are shared per asset
+		TWeakObjectPtr<const UChPhysicalMaterial> Asset;
+	};
+
+	// Negative keeps the combined value
+	struct FPairOverride {
+		float Friction = -1.f;
+		float Restitution = -1.f;
+	};
+
+	typedef TPair<const void*, const void*> FPairKey;
+
+	FORCEINLINE FPairKey MakePairKey(const void* a, const void* b)
+	{
+		return b < a ? FPairKey(b, a) : FPairKey(a, b);
+	}
+
+	// The explicit overrides only, every other pair combines by Chrono's min() laws
+	struct FPairTable {
+		// Keyed by the two assets
+		TMap<FPairKey, FPairOverride> Overrides;
+		// Live materials of the assets in Overrides
+		TMap<const chrono::ChMaterialSurface*, const UChPhysicalMaterial*> Assets;
+		// The parallel systems only hand the coefficients to the strategy, so there the overrides are keyed by
+		// the two coefficients, smaller first, and materials sharing one share its overrides
+		TMap<uint64, float> ValueFriction;
+		TMap<uint64, float> ValueRestitution;
+	};
+
+	FCriticalSection libraryLock;
+	// Weak, so a material is freed with the last body holding it
+	TMap<FString, FMaterialEntry> materials;
+	// Assets whose pairs go into the table
+	TArray<TWeakObjectPtr<const UChPhysicalMaterial>> pairAssets;
+	uint32 revision = 0;
+
+	FORCEINLINE uint64 ValueKey(float a, float b)
+	{
+		if (b < a) {
+			Swap(a, b);
+		}
+		uint32 bitsA, bitsB;
+		FMemory::Memcpy(&bitsA, &a, sizeof(float));
+		FMemory::Memcpy(&bitsB, &b, sizeof(float));
+		return ((uint64)bitsA << 32) | bitsB;
+	}
+
+	FString MakeKey(const FChMaterialValues& v, bool bSMC)
+	{
+		return FString::Printf(TEXT("%d|%g|%g|%g|%g|%g|%g|%g|%g|%g|%g|%g|%g|%g"), bSMC ? 1 : 0,
+			v.StaticFriction, v.SlidingFriction, v.RollingFriction, v.SpinningFriction, v.Cohension, v.Restitution,
+			v.DampingF, v.Compliance, v.ComplianceT, v.ComplianceRoll, v.ComplianceSpin, v.YoungModulus, v.PoissonRatio);
+	}
+
+	// Serial systems: overrides the composite of the contacts between two assets with an entry
+	class FChPairOverrideCallback : public chrono::ChContactContainer::AddContactCallback {
+	public:
+		FChPairOverrideCallback(std::shared_ptr<const FPairTable> inTable, bool bInSMC) : table(inTable), bSMC(bInSMC) {}
+
+		virtual void OnAddContact(const chrono::collision::ChCollisionInfo& contactinfo, chrono::ChMaterialComposite* const material) override
+		{
+			const UChPhysicalMaterial* const* assetA = table->Assets.Find(GetSurface(contactinfo.modelA));
+			const UChPhysicalMaterial* const* assetB = assetA ? table->Assets.Find(GetSurface(contactinfo.modelB)) : nullptr;
+			if (!assetB) {
+				return;
+			}
+			const FPairOverride* found = table->Overrides.Find(MakePairKey(*assetA, *assetB));
+			if (!found) {
+				return;
+			}
+			if (bSMC) {
+				auto smc = static_cast<chrono::ChMaterialCompositeSMC*>(material);
+				smc->mu_eff = found->Friction >= 0.f ? found->Friction : smc->mu_eff;
+				smc->cr_eff = found->Restitution >= 0.f ? found->Restitution : smc->cr_eff;
+			}
+			else {
+				auto nsc = static_cast<chrono::ChMaterialCompositeNSC*>(material);
+				if (found->Friction >= 0.f) {
+					nsc->static_friction = found->Friction;
+					nsc->sliding_friction = found->Friction;
+				}
+				nsc->restitution = found->Restitution >= 0.f ? found->Restitution : nsc->restitution;
+			}
+		}
+
+	private:
+		FORCEINLINE static const chrono::ChMaterialSurface* GetSurface(chrono::collision::ChCollisionModel* model)
+		{
+			return model && model->GetContactable() ? model->GetContactable()->GetMaterialSurfaceBase().get() : nullptr;
+		}
+
+		// Read only once built
+		std::shared_ptr<const FPairTable> table;
+		bool bSMC;
+	};
+
+	// Combines by min() like Chrono's own; on the serial systems it only owns the contact callback, the system
+	// keeps strategies alive but callbacks as plain pointers
+	template <typename T>
+	class FChPairTableStrategy : public chrono::ChMaterialCompositionStrategy<T> {
+	public:
+		FChPairTableStrategy(std::shared_ptr<const FPairTable> inTable, bool bSMC) : table(inTable), callback(inTable, bSMC) {}
+
+		virtual T CombineFriction(T a1, T a2) const override
+		{
+			const float* found = table->ValueFriction.Num() ? table->ValueFriction.Find(ValueKey((float)a1, (float)a2)) : nullptr;
+			return found ? (T)*found : std::min<T>(a1, a2);
+		}
+
+		virtual T CombineRestitution(T a1, T a2) const override
+		{
+			const float* found = table->ValueRestitution.Num() ? table->ValueRestitution.Find(ValueKey((float)a1, (float)a2)) : nullptr;
+			return found ? (T)*found : std::min<T>(a1, a2);
+		}
+
+		FORCEINLINE FChPairOverrideCallback* GetCallback() { return &callback; }
+
+	private:
+		// Read only once built, the parallel system combines from several threads
+		std::shared_ptr<const FPairTable> table;
+		FChPairOverrideCallback callback;
+	};
+
+	std::shared_ptr<FPairTable> BuildPairTable(bool bByValue)
+	{
+		auto table = std::make_shared<FPairTable>();
+		TSet<const UChPhysicalMaterial*> overridden;
+		for (const TWeakObjectPtr<const UChPhysicalMaterial>& asset : pairAssets) {
+			if (!asset.IsValid()) {
+				continue;
+			}
+			FChMaterialValues a = FChMaterialValues::FromAsset(*asset);
+			for (const FChMaterialPair& pair : asset->Pairs) {
+				if (!pair.Other || (pair.Friction < 0.f && pair.Restitution < 0.f)) {
+					continue;
+				}
+				if (bByValue) {
+					FChMaterialValues b = FChMaterialValues::FromAsset(*pair.Other);
+					if (pair.Friction >= 0.f) {
+						table->ValueFriction.Add(ValueKey(a.StaticFriction, b.StaticFriction), pair.Friction);
+						table->ValueFriction.Add(ValueKey(a.SlidingFriction, b.SlidingFriction), pair.Friction);
+					}
+					if (pair.Restitution >= 0.f) {
+						table->ValueRestitution.Add(ValueKey(a.Restitution, b.Restitution), pair.Restitution);
+					}
+					continue;
+				}
+				FPairOverride& entry = table->Overrides.FindOrAdd(MakePairKey(asset.Get(), pair.Other));
+				entry.Friction = pair.Friction >= 0.f ? pair.Friction : entry.Friction;
+				entry.Restitution = pair.Restitution >= 0.f ? pair.Restitution : entry.Restitution;
+				overridden.Add(asset.Get());
+				overridden.Add(pair.Other);
+			}
+		}
+		for (auto& pair : materials) {
+			std::shared_ptr<chrono::ChMaterialSurface> material = pair.Value.Material.lock();
+			if (material && overridden.Contains(pair.Value.Asset.Get())) {
+				table->Assets.Add(material.get(), pair.Value.Asset.Get());
+			}
+		}
+		return table;
+	}
+}
+
+FChMaterialValues FChMaterialValues::FromAsset(const UChPhysicalMaterial& material)
+{
+	return { material.StaticFriction, material.SlidingFriction, material.RollingFriction, material.SpinningFriction,
+		material.Cohension, material.Restitution, material.DampingF, material.Compliance, material.ComplianceT,
+		material.ComplianceRoll, material.ComplianceSpin, material.YoungModulus, material.PoissonRatio };
+}
+
+std::shared_ptr<chrono::ChMaterialSurface> FChMaterialLibrary::Find(const FChMaterialValues& values, bool bSMC)
+{
+	FScopeLock scopeLock(&libraryLock);
+	return FindLocked(MakeKey(values, bSMC), values, bSMC, nullptr);
+}
+
+std::shared_ptr<chrono::ChMaterialSurface> FChMaterialLibrary::FindLocked(const FString& key, const FChMaterialValues& values, bool bSMC, const UChPhysicalMaterial* asset)
+{
+	if (FMaterialEntry* found = materials.Find(key)) {
+		if (std::shared_ptr<chrono::ChMaterialSurface> material = found->Material.lock()) {
+			return material;
+		}
+	}
+
+	std::shared_ptr<chrono::ChMaterialSurface> material;
+	if (bSMC) {
+		auto smc = std::make_shared<chrono::ChMaterialSurfaceSMC>();
+		smc->SetSfriction(values.StaticFriction);
+		smc->SetKfriction(values.SlidingFriction);
+		smc->SetRestitution(values.Restitution);
+		smc->SetAdhesion(values.Cohension);
+		smc->SetYoungModulus(values.YoungModulus);
+		smc->SetPoissonRatio(values.PoissonRatio);
+		material = smc;
+	}
+	else {
+		auto nsc = std::make_shared<chrono::ChMaterialSurfaceNSC>();
+		nsc->SetSfriction(values.StaticFriction);
+		nsc->SetKfriction(values.SlidingFriction);
+		nsc->SetRollingFriction(values.RollingFriction);
+		nsc->SetSpinningFriction(values.SpinningFriction);
+		nsc->SetCohesion(values.Cohension);
+		nsc->SetRestitution(values.Restitution);
+		nsc->SetDampingF(values.DampingF);
+		nsc->SetCompliance(values.Compliance);
+		nsc->SetComplianceT(values.ComplianceT);
+		nsc->SetComplianceRolling(values.ComplianceRoll);
+		nsc->SetComplianceSpinning(values.ComplianceSpin);
+		material = nsc;
+	}
+
+	for (auto it = materials.CreateIterator(); it; ++it) {
+		if (it->Value.Material.expired()) {
+			it.RemoveCurrent();
+		}
+	}
+	materials.Add(key, { values, material, asset });
+	revision++;
+	return material;
+}
+
+std::shared_ptr<chrono::ChMaterialSurface> FChMaterialLibrary::Find(const UChPhysicalMaterial* material, bool bSMC)
+{
+	check(material);
+	FScopeLock scopeLock(&libraryLock);
+	if (material->Pairs.Num() && !pairAssets.Contains(material)) {
+		pairAssets.RemoveAll([](const TWeakObjectPtr<const UChPhysicalMaterial>& asset) { return !asset.IsValid(); });
+		pairAssets.Add(material);
+		revision++;
+	}
+	// One material per asset, so the contact callback can tell the assets apart
+	FString key = FString::Printf(TEXT("%d|%s"), bSMC ? 1 : 0, *material->GetPathName());
+	return FindLocked(key, FChMaterialValues::FromAsset(*material), bSMC, material);
+}
+
+uint32 FChMaterialLibrary::GetRevision()
+{
+	FScopeLock scopeLock(&libraryLock);
+	return revision;
+}
+
+void FChMaterialLibrary::ApplyComposition(chrono::ChSystem* system)
+{
+	if (!system) {
+		return;
+	}
+	// The parallel systems keep a strategy of their own precision next to the base one and no contact callback
+	auto parallelSystem = dynamic_cast<chrono::ChSystemParallel*>(system);
+	std::shared_ptr<const FPairTable> table;
+	{
+		FScopeLock scopeLock(&libraryLock);
+		table = BuildPairTable(parallelSystem != nullptr);
+	}
+	bool bSMC = system->GetContactMethod() == chrono::ChMaterialSurface::SMC;
+	if (parallelSystem) {
+		parallelSystem->SetMaterialCompositionStrategy(std::unique_ptr<chrono::ChMaterialCompositionStrategy<chrono::real>>(new FChPairTableStrategy<chrono::real>(table, bSMC)));
+		return;
+	}
+	auto strategy = new FChPairTableStrategy<float>(table, bSMC);
+	system->GetContactContainer()->RegisterAddContactCallback(table->Overrides.Num() ? strategy->GetCallback() : nullptr);
+	system->SetMaterialCompositionStrategy(std::unique_ptr<chrono::ChMaterialCompositionStrategy<float>>(strategy));
+}
+
+int32 FChMaterialLibrary::GetMaterialNum()
+{
+	FScopeLock scopeLock(&libraryLock);
+	int32 count = 0;
+	for (auto& pair : materials) {
+		count += pair.Value.Material.expired() ? 0 : 1;
+	}
+	return count;
+}
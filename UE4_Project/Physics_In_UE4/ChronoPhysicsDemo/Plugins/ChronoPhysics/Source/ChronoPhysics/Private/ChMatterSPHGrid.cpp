@@ -0,0 +1,219 @@
+#include "ChMatterSPHGrid.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include <cmath>
+
+namespace {
+	// Below this many particles the passes run on the calling thread
+	const int32 ParallelParticleCount = 1024;
+
+	FORCEINLINE uint32 HashCell(int32 x, int32 y, int32 z, uint32 cellMask)
+	{
+		return ((uint32)x * 73856093u ^ (uint32)y * 19349663u ^ (uint32)z * 83492791u) & cellMask;
+	}
+
+	FORCEINLINE int32 CellOf(double coordinate, double invCell)
+	{
+		return (int32)FMath::FloorToDouble(coordinate * invCell);
+	}
+
+	// Visits every particle in the 27 cells around cell (x, y, z), hash collisions bring extra candidates
+	// that the distance test drops
+	template <typename F>
+	FORCEINLINE void ForEachCandidate(const std::vector<int32>& cellStart, const std::vector<int32>& sortedParticles, uint32 cellMask, const int32 cell[3], F&& visit)
+	{
+		uint32 visited[27];
+		int32 visitedNum = 0;
+		for (int32 dz = -1; dz <= 1; dz++) {
+			for (int32 dy = -1; dy <= 1; dy++) {
+				for (int32 dx = -1; dx <= 1; dx++) {
+					uint32 bucket = HashCell(cell[0] + dx, cell[1] + dy, cell[2] + dz, cellMask);
+					// Two neighbour cells in one bucket would count its particles twice
+					bool bSeen = false;
+					for (int32 i = 0; i < visitedNum; i++) {
+						bSeen |= visited[i] == bucket;
+					}
+					if (bSeen) {
+						continue;
+					}
+					visited[visitedNum++] = bucket;
+					for (int32 k = cellStart[bucket]; k < cellStart[bucket + 1]; k++) {
+						visit(sortedParticles[k]);
+					}
+				}
+			}
+		}
+	}
+}
+
+FChMatterSPHGrid::FChMatterSPHGrid()
+{
+	SetCollide(true);
+}
+
+void FChMatterSPHGrid::AddCollisionModelsToSystem()
+{
+	// Only the broadphase pairs between nodes go, the contacts with bodies stay
+	for (unsigned int i = 0; i < GetNnodes(); i++) {
+		auto model = static_cast<chrono::ChNodeSPH*>(GetNode(i).get())->collision_model;
+		if (model) {
+			model->SetFamily(nodeFamily);
+			model->SetFamilyMaskNoCollisionWithFamily(nodeFamily);
+		}
+	}
+	chrono::ChMatterSPH::AddCollisionModelsToSystem();
+}
+
+void FChMatterSPHGrid::GatherState()
+{
+	int32 count = GetNnodes();
+	if ((int32)nodeList.size() != count) {
+		nodeList.resize(count);
+		for (int32 i = 0; i < count; i++) {
+			nodeList[i] = static_cast<chrono::ChNodeSPH*>(GetNode(i).get());
+		}
+		for (auto* array : { &posX, &posY, &posZ, &velX, &velY, &velZ, &mass, &density, &pressure, &forceX, &forceY, &forceZ }) {
+			array->resize(count);
+		}
+		particleCell.resize(count);
+		sortedParticles.resize(count);
+	}
+	kernelRadius = 0;
+	for (int32 i = 0; i < count; i++) {
+		const chrono::ChNodeSPH* node = nodeList[i];
+		posX[i] = node->pos.x();
+		posY[i] = node->pos.y();
+		posZ[i] = node->pos.z();
+		velX[i] = node->pos_dt.x();
+		velY[i] = node->pos_dt.y();
+		velZ[i] = node->pos_dt.z();
+		mass[i] = node->GetMass();
+		kernelRadius = FMath::Max(kernelRadius, node->GetKernelRadius());
+	}
+}
+
+void FChMatterSPHGrid::BuildGrid()
+{
+	int32 count = (int32)nodeList.size();
+	// Twice as many buckets as particles keeps the collisions rare
+	uint32 buckets = FMath::RoundUpToPowerOfTwo(FMath::Max(count * 2, 64));
+	cellMask = buckets - 1;
+	cellStart.assign(buckets + 1, 0);
+
+	double invCell = 1.0 / kernelRadius;
+	for (int32 i = 0; i < count; i++) {
+		uint32 bucket = HashCell(CellOf(posX[i], invCell), CellOf(posY[i], invCell), CellOf(posZ[i], invCell), cellMask);
+		particleCell[i] = bucket;
+		cellStart[bucket + 1]++;
+	}
+	for (uint32 b = 0; b < buckets; b++) {
+		cellStart[b + 1] += cellStart[b];
+	}
+	// Stable scatter, a bucket lists its particles in index order
+	std::vector<int32> cursor(cellStart.begin(), cellStart.end() - 1);
+	for (int32 i = 0; i < count; i++) {
+		sortedParticles[cursor[particleCell[i]]++] = i;
+	}
+}
+
+void FChMatterSPHGrid::ComputeForces()
+{
+	GatherState();
+	int32 count = (int32)nodeList.size();
+	if (!count || kernelRadius <= 0) {
+		lastNeighborCount = 0;
+		return;
+	}
+	BuildGrid();
+
+	const double h = kernelRadius;
+	const double h2 = h * h;
+	const double invCell = 1.0 / h;
+	// Poly6 for density, spiky gradient for pressure, viscosity laplacian, as in ChProximityContainerSPH
+	const double h6 = h2 * h2 * h2;
+	const double poly6 = 315.0 / (64.0 * PI * h6 * h * h * h);
+	const double spiky = -45.0 / (PI * h6);
+	const double viscLaplacian = 45.0 / (PI * h6);
+	const double restDensity = GetMaterial().Get_density();
+	const double stiffness = GetMaterial().Get_pressure_stiffness();
+	const double viscosity = GetMaterial().Get_viscosity();
+	bool bSerial = count < ParallelParticleCount;
+	FThreadSafeCounter64 neighbors;
+
+	ParallelFor(count, [&](int32 i) {
+		int32 cell[3] = { CellOf(posX[i], invCell), CellOf(posY[i], invCell), CellOf(posZ[i], invCell) };
+		double rho = 0;
+		ForEachCandidate(cellStart, sortedParticles, cellMask, cell, [&](int32 j) {
+			double dx = posX[i] - posX[j], dy = posY[i] - posY[j], dz = posZ[i] - posZ[j];
+			double r2 = dx * dx + dy * dy + dz * dz;
+			if (r2 < h2) {
+				double w = h2 - r2;
+				rho += mass[j] * poly6 * w * w * w;
+			}
+		});
+		density[i] = rho;
+		pressure[i] = stiffness * (rho - restDensity);
+	}, bSerial);
+
+	ParallelFor(count, [&](int32 i) {
+		int32 cell[3] = { CellOf(posX[i], invCell), CellOf(posY[i], invCell), CellOf(posZ[i], invCell) };
+		double fx = 0, fy = 0, fz = 0;
+		int64 pairs = 0;
+		ForEachCandidate(cellStart, sortedParticles, cellMask, cell, [&](int32 j) {
+			if (j == i) {
+				return;
+			}
+			double dx = posX[i] - posX[j], dy = posY[i] - posY[j], dz = posZ[i] - posZ[j];
+			double r2 = dx * dx + dy * dy + dz * dz;
+			if (r2 >= h2 || r2 <= 0 || density[j] <= 0) {
+				return;
+			}
+			pairs++;
+			double r = std::sqrt(r2);
+			double q = h - r;
+			// Symmetric pressure term, each particle computes its own side of the pair
+			double pressureScale = -mass[j] * (pressure[i] + pressure[j]) / (2 * density[j]) * spiky * q * q / r;
+			double viscScale = viscosity * mass[j] / density[j] * viscLaplacian * q;
+			fx += pressureScale * dx + viscScale * (velX[j] - velX[i]);
+			fy += pressureScale * dy + viscScale * (velY[j] - velY[i]);
+			fz += pressureScale * dz + viscScale * (velZ[j] - velZ[i]);
+		});
+		// The kernels give force per volume, the particle's volume is mass over density
+		double volume = density[i] > 0 ? mass[i] / density[i] : 0;
+		const chrono::ChVector<>& user = nodeList[i]->UserForce;
+		forceX[i] = fx * volume + user.x();
+		forceY[i] = fy * volume + user.y();
+		forceZ[i] = fz * volume + user.z();
+		neighbors.Add(pairs);
+	}, bSerial);
+
+	// Written back so the node getters show the fluid state
+	for (int32 i = 0; i < count; i++) {
+		nodeList[i]->density = density[i];
+		nodeList[i]->pressure = pressure[i];
+		nodeList[i]->volume = density[i] > 0 ? mass[i] / density[i] : 0;
+	}
+	lastNeighborCount = neighbors.GetValue();
+}
+
+void FChMatterSPHGrid::IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c)
+{
+	ComputeForces();
+	chrono::ChVector<> gravity = GetSystem() ? GetSystem()->Get_G_acc() : chrono::VNULL;
+	for (int32 i = 0; i < (int32)nodeList.size(); i++) {
+		chrono::ChVector<> force(forceX[i], forceY[i], forceZ[i]);
+		R.PasteSumVector((force + gravity * mass[i]) * c, off + 3 * i, 0);
+	}
+}
+
+void FChMatterSPHGrid::VariablesFbLoadForces(double factor)
+{
+	ComputeForces();
+	chrono::ChVector<> gravity = GetSystem() ? GetSystem()->Get_G_acc() : chrono::VNULL;
+	for (int32 i = 0; i < (int32)nodeList.size(); i++) {
+		chrono::ChVector<> force(forceX[i], forceY[i], forceZ[i]);
+		nodeList[i]->Variables().Get_fb().PasteSumVector((force + gravity * mass[i]) * factor, 0, 0);
+	}
+}
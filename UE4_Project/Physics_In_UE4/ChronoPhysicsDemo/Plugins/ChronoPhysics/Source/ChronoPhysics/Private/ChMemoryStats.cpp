@@ -0,0 +1,225 @@
+#include "ChMemoryStats.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChContactContainerNSC.h"
+#include "chrono/physics/ChContactContainerSMC.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono_parallel/physics/ChSystemParallel.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "chrono/collision/gimpact/GIMPACT/Bullet/btGImpactShape.h"
+#include "ChPackedContactContainerSMC.h"
+
+namespace {
+	template <typename T>
+	SIZE_T VectorBytes(const std::vector<T>& vector)
+	{
+		return vector.capacity() * sizeof(T);
+	}
+
+	template <typename T>
+	SIZE_T MatrixBytes(const blaze::CompressedMatrix<T>& matrix)
+	{
+		// Values with their column index, and the row starts
+		return matrix.capacity() * (sizeof(T) + sizeof(size_t)) + (matrix.rows() + 1) * sizeof(void*);
+	}
+
+	template <typename T>
+	SIZE_T DenseBytes(const blaze::DynamicVector<T>& vector)
+	{
+		return vector.capacity() * sizeof(T);
+	}
+
+	SIZE_T MeshBytes(const btStridingMeshInterface* mesh)
+	{
+		SIZE_T total = 0;
+		for (int part = 0; part < mesh->getNumSubParts(); part++) {
+			const unsigned char* vertices;
+			const unsigned char* indices;
+			int vertexNum, vertexStride, indexStride, faceNum;
+			PHY_ScalarType vertexType, indexType;
+			mesh->getLockedReadOnlyVertexIndexBase(&vertices, vertexNum, vertexType, vertexStride, &indices, indexStride, faceNum, indexType, part);
+			total += (SIZE_T)vertexNum * vertexStride + (SIZE_T)faceNum * indexStride;
+			mesh->unLockReadOnlyVertexBase(part);
+		}
+		return total;
+	}
+
+	SIZE_T ShapeBytes(const btCollisionShape* shape, TSet<const btCollisionShape*>& visited)
+	{
+		bool bVisited = false;
+		visited.Add(shape, &bVisited);
+		if (bVisited) {
+			return 0;
+		}
+
+		switch (shape->getShapeType()) {
+		case COMPOUND_SHAPE_PROXYTYPE: {
+			auto compound = static_cast<const btCompoundShape*>(shape);
+			SIZE_T total = sizeof(btCompoundShape) + compound->getNumChildShapes() * sizeof(btCompoundShapeChild);
+			for (int i = 0; i < compound->getNumChildShapes(); i++) {
+				total += ShapeBytes(compound->getChildShape(i), visited);
+			}
+			return total;
+		}
+		case CONVEX_HULL_SHAPE_PROXYTYPE:
+			return sizeof(btConvexHullShape) + static_cast<const btConvexHullShape*>(shape)->getNumPoints() * sizeof(btVector3);
+		case TRIANGLE_MESH_SHAPE_PROXYTYPE: {
+			auto mesh = static_cast<const btBvhTriangleMeshShape*>(shape);
+			SIZE_T total = sizeof(btBvhTriangleMeshShape) + MeshBytes(mesh->getMeshInterface());
+			if (auto bvh = const_cast<btBvhTriangleMeshShape*>(mesh)->getOptimizedBvh()) {
+				total += bvh->calculateSerializeBufferSize();
+			}
+			return total;
+		}
+		case GIMPACT_SHAPE_PROXYTYPE: {
+			auto gimpact = static_cast<const btGImpactShapeInterface*>(shape);
+			if (gimpact->getGImpactShapeType() == CONST_GIMPACT_TRIMESH_SHAPE) {
+				auto mesh = static_cast<const btGImpactMeshShape*>(shape);
+				// One part shape per sub part, each with its box set
+				return sizeof(btGImpactMeshShape) + MeshBytes(mesh->getMeshInterface()) + mesh->getMeshPartCount() * sizeof(btGImpactMeshShapePart);
+			}
+			return sizeof(btGImpactShapeInterface);
+		}
+		default:
+			// Primitives, a few scalars each
+			return sizeof(btConvexInternalShape);
+		}
+	}
+
+	SIZE_T ParallelBytes(const chrono::host_container& host, const chrono::shape_container& shapes)
+	{
+		SIZE_T total = 0;
+		total += VectorBytes(host.aabb_min) + VectorBytes(host.aabb_max) + VectorBytes(host.aabb_min_tet) + VectorBytes(host.aabb_max_tet);
+		total += VectorBytes(host.contact_pairs);
+		total += VectorBytes(host.norm_rigid_rigid) + VectorBytes(host.cpta_rigid_rigid) + VectorBytes(host.cptb_rigid_rigid);
+		total += VectorBytes(host.dpth_rigid_rigid) + VectorBytes(host.erad_rigid_rigid) + VectorBytes(host.bids_rigid_rigid);
+		total += VectorBytes(host.norm_rigid_fluid) + VectorBytes(host.cpta_rigid_fluid) + VectorBytes(host.dpth_rigid_fluid);
+		total += VectorBytes(host.neighbor_rigid_fluid) + VectorBytes(host.c_counts_rigid_fluid);
+		total += VectorBytes(host.neighbor_3dof_3dof) + VectorBytes(host.c_counts_3dof_3dof);
+		total += VectorBytes(host.particle_indices_3dof) + VectorBytes(host.reverse_mapping_3dof);
+		total += VectorBytes(host.ct_body_force) + VectorBytes(host.ct_body_torque) + VectorBytes(host.ct_body_map);
+		total += VectorBytes(host.shear_neigh) + VectorBytes(host.shear_disp);
+		total += VectorBytes(host.fric_rigid_rigid) + VectorBytes(host.coh_rigid_rigid) + VectorBytes(host.compliance_rigid_rigid);
+		total += VectorBytes(host.pos_rigid) + VectorBytes(host.rot_rigid) + VectorBytes(host.active_rigid);
+		total += VectorBytes(host.collide_rigid) + VectorBytes(host.mass_rigid);
+		total += VectorBytes(host.pos_3dof) + VectorBytes(host.sorted_pos_3dof) + VectorBytes(host.vel_3dof) + VectorBytes(host.sorted_vel_3dof);
+		total += VectorBytes(host.bilateral_type) + VectorBytes(host.bilateral_mapping);
+		total += VectorBytes(host.fric_data) + VectorBytes(host.cohesion_data) + VectorBytes(host.compliance_data);
+		total += VectorBytes(host.elastic_moduli) + VectorBytes(host.mu) + VectorBytes(host.cr);
+		total += VectorBytes(host.smc_coeffs) + VectorBytes(host.adhesionMultDMT_data);
+		total += MatrixBytes(host.Nshur) + MatrixBytes(host.D) + MatrixBytes(host.D_T);
+		total += MatrixBytes(host.M_inv) + MatrixBytes(host.M) + MatrixBytes(host.M_invD);
+		total += DenseBytes(host.R_full) + DenseBytes(host.R) + DenseBytes(host.b) + DenseBytes(host.s) + DenseBytes(host.M_invk);
+		total += DenseBytes(host.gamma) + DenseBytes(host.v) + DenseBytes(host.hf) + DenseBytes(host.E) + DenseBytes(host.Fc);
+		total += VectorBytes(host.bin_intersections) + VectorBytes(host.bin_number) + VectorBytes(host.bin_number_out);
+		total += VectorBytes(host.bin_aabb_number) + VectorBytes(host.bin_start_index) + VectorBytes(host.bin_num_contact);
+
+		total += VectorBytes(shapes.fam_rigid) + VectorBytes(shapes.id_rigid) + VectorBytes(shapes.typ_rigid);
+		total += VectorBytes(shapes.start_rigid) + VectorBytes(shapes.length_rigid) + VectorBytes(shapes.ObR_rigid) + VectorBytes(shapes.ObA_rigid);
+		total += VectorBytes(shapes.sphere_rigid) + VectorBytes(shapes.box_like_rigid) + VectorBytes(shapes.triangle_rigid);
+		total += VectorBytes(shapes.capsule_rigid) + VectorBytes(shapes.rbox_like_rigid) + VectorBytes(shapes.convex_rigid);
+		total += VectorBytes(shapes.tetrahedron_rigid) + VectorBytes(shapes.triangle_global);
+		total += VectorBytes(shapes.obj_data_A_global) + VectorBytes(shapes.obj_data_R_global);
+		return total;
+	}
+}
+
+void FChMemoryStats::Measure(chrono::ChSystem& system, bool bFull)
+{
+	auto& bodies = system.Get_bodylist();
+	int32 bodyNum = (int32)bodies.size();
+	auto parallelSystem = dynamic_cast<chrono::ChSystemParallel*>(&system);
+
+	bytes[EChMemoryCategory::Bodies] = VectorBytes(bodies) + bodyNum * (sizeof(chrono::ChBody) + sizeof(chrono::collision::ChModelBullet) + sizeof(btCollisionObject));
+
+	// Contact objects are recycled, the container keeps what the busiest step allocated
+	int32 contactNum = system.GetNcontacts();
+	SIZE_T contactBytes = 0;
+	if (auto packed = std::dynamic_pointer_cast<FChPackedContactContainerSMC>(system.GetContactContainer())) {
+		contactBytes = packed->GetAllocatedSize() + (contactNum - packed->GetPackedContactNum()) * sizeof(chrono::ChContactContainerSMC::ChContactSMC_6_6);
+	}
+	else if (system.GetContactMethod() == chrono::ChMaterialSurface::SMC) {
+		contactBytes = contactNum * sizeof(chrono::ChContactContainerSMC::ChContactSMC_6_6);
+	}
+	else {
+		contactBytes = contactNum * sizeof(chrono::ChContactContainerNSC::ChContactNSC_6_6);
+	}
+	auto bulletSystem = std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(system.GetCollisionSystem());
+	if (bulletSystem && bulletSystem->GetBulletCollisionWorld()) {
+		contactBytes += bulletSystem->GetBulletCollisionWorld()->getDispatcher()->getNumManifolds() * sizeof(btPersistentManifold);
+	}
+	bytes[EChMemoryCategory::Contacts] = contactBytes;
+
+	if (bFull || bodyNum != measuredBodyNum) {
+		TSet<const btCollisionShape*> visited;
+		SIZE_T shapeBytes = 0;
+		for (auto& body : bodies) {
+			auto model = std::dynamic_pointer_cast<chrono::collision::ChModelBullet>(body->GetCollisionModel());
+			if (model && model->GetBulletModel() && model->GetBulletModel()->getCollisionShape()) {
+				shapeBytes += ShapeBytes(model->GetBulletModel()->getCollisionShape(), visited);
+			}
+		}
+		bytes[EChMemoryCategory::CollisionShapes] = shapeBytes;
+		measuredBodyNum = bodyNum;
+	}
+
+	// The lists, and the state, speed, acceleration, reaction and residual vectors the timestepper sizes to them
+	auto descriptor = system.GetSystemDescriptor();
+	SIZE_T descriptorBytes = 0;
+	if (descriptor) {
+		descriptorBytes += VectorBytes(descriptor->GetConstraintsList()) + VectorBytes(descriptor->GetVariablesList()) + VectorBytes(descriptor->GetKblocksList());
+	}
+	descriptorBytes += ((SIZE_T)system.GetNcoords() * 2 + (SIZE_T)system.GetNcoords_w() * 4 + (SIZE_T)system.GetNconstr() * 3) * sizeof(double);
+	bytes[EChMemoryCategory::Descriptor] = descriptorBytes;
+
+	bytes[EChMemoryCategory::ParallelData] = parallelSystem ? ParallelBytes(parallelSystem->data_manager->host_data, parallelSystem->data_manager->shape_data) : 0;
+
+	for (int32 i = 0; i < EChMemoryCategory::Num; i++) {
+		peakBytes[i] = FMath::Max(peakBytes[i], bytes[i]);
+	}
+}
+
+void FChMemoryStats::Reset()
+{
+	for (int32 i = 0; i < EChMemoryCategory::Num; i++) {
+		bytes[i] = 0;
+		peakBytes[i] = 0;
+	}
+	measuredBodyNum = INDEX_NONE;
+}
+
+SIZE_T FChMemoryStats::GetTotalBytes() const
+{
+	SIZE_T total = 0;
+	for (int32 i = 0; i < EChMemoryCategory::Num; i++) {
+		total += bytes[i];
+	}
+	return total;
+}
+
+const TCHAR* FChMemoryStats::GetCategoryName(EChMemoryCategory::Type category)
+{
+	switch (category) {
+	case EChMemoryCategory::Bodies: return TEXT("Bodies");
+	case EChMemoryCategory::Contacts: return TEXT("Contacts");
+	case EChMemoryCategory::CollisionShapes: return TEXT("Collision shapes");
+	case EChMemoryCategory::Descriptor: return TEXT("Descriptor");
+	case EChMemoryCategory::ParallelData: return TEXT("Parallel data");
+	default: return TEXT("");
+	}
+}
+
+void FChMemoryStats::Log(const FString& owner) const
+{
+	UE_LOG(LogTemp, Log, TEXT("%s: Chrono memory %.2f MB"), *owner, GetTotalBytes() / (1024.0 * 1024.0));
+	for (int32 i = 0; i < EChMemoryCategory::Num; i++) {
+		auto category = (EChMemoryCategory::Type)i;
+		UE_LOG(LogTemp, Log, TEXT("  %-18s %10.2f MB, peak %10.2f MB"), GetCategoryName(category), bytes[i] / (1024.0 * 1024.0), peakBytes[i] / (1024.0 * 1024.0));
+	}
+}
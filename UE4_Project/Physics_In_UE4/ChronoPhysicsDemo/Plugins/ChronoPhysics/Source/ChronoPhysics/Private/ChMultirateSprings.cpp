@@ -0,0 +1,173 @@
+#include "ChMultirateSprings.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChLinkSpring.h"
+
+int32 FChMultirateSprings::FindOrAddBody(chrono::ChBody* body)
+{
+	for (int32 i = 0; i < (int32)bodies.size(); i++) {
+		if (bodies[i].Body == body) {
+			bodies[i].SpringCount++;
+			return i;
+		}
+	}
+	bodies.push_back({ body, 1, chrono::VNULL, chrono::VNULL, false, chrono::VNULL, chrono::VNULL });
+	return (int32)bodies.size() - 1;
+}
+
+void FChMultirateSprings::AddSpring(std::shared_ptr<chrono::ChLinkSpring> link, double stiffness, double damping)
+{
+	auto body1 = dynamic_cast<chrono::ChBody*>(link->GetBody1());
+	auto body2 = dynamic_cast<chrono::ChBody*>(link->GetBody2());
+	if (!body1 || !body2) {
+		return;
+	}
+
+	FSpring spring;
+	spring.Link = link;
+	spring.Body1 = FindOrAddBody(body1);
+	spring.Body2 = FindOrAddBody(body2);
+	spring.Point1 = body1->TransformPointParentToLocal(link->GetMarker1()->GetAbsCoord().pos);
+	spring.Point2 = body2->TransformPointParentToLocal(link->GetMarker2()->GetAbsCoord().pos);
+	spring.RestLength = link->Get_SpringRestLength();
+	spring.Stiffness = stiffness;
+	spring.Damping = damping;
+	springs.push_back(spring);
+
+	// The link keeps its markers and reactions, the force comes from here
+	link->Set_SpringK(0);
+	link->Set_SpringR(0);
+}
+
+void FChMultirateSprings::RemoveSpring(chrono::ChLinkSpring* link)
+{
+	for (int32 s = (int32)springs.size() - 1; s >= 0; s--) {
+		if (springs[s].Link.get() == link) {
+			bodies[springs[s].Body1].SpringCount--;
+			bodies[springs[s].Body2].SpringCount--;
+			springs.erase(springs.begin() + s);
+		}
+	}
+
+	// Compact the bodies no spring uses any more and renumber the rest
+	std::vector<int32> remap(bodies.size(), INDEX_NONE);
+	int32 kept = 0;
+	for (int32 i = 0; i < (int32)bodies.size(); i++) {
+		if (bodies[i].SpringCount > 0) {
+			remap[i] = kept;
+			bodies[kept++] = bodies[i];
+		}
+	}
+	bodies.resize(kept);
+	for (auto& spring : springs) {
+		spring.Body1 = remap[spring.Body1];
+		spring.Body2 = remap[spring.Body2];
+	}
+}
+
+void FChMultirateSprings::Advance(double stepSize)
+{
+	int32 bodyNum = (int32)bodies.size();
+	if (bodyNum == 0 || stepSize <= 0) {
+		return;
+	}
+	positions.resize(bodyNum);
+	velocities.resize(bodyNum);
+	forces.resize(bodyNum);
+
+	std::vector<double> invMass(bodyNum);
+	for (int32 i = 0; i < bodyNum; i++) {
+		FSpringBody& body = bodies[i];
+		chrono::ChBody* chBody = body.Body;
+		bool bMoving = !chBody->GetBodyFixed() && !chBody->GetSleeping();
+		invMass[i] = bMoving ? 1.0 / chBody->GetMass() : 0.0;
+
+		// The last step's acceleration minus what these springs added to it
+		chrono::ChVector<> coupling = bMoving ? chBody->GetPos_dtdt() - body.Force * invMass[i] : chrono::VNULL;
+		body.LastCouplingAcceleration = body.bHasCoupling ? body.CouplingAcceleration : coupling;
+		body.CouplingAcceleration = coupling;
+		body.bHasCoupling = true;
+
+		positions[i] = chBody->GetPos();
+		velocities[i] = chBody->GetPos_dt();
+		body.Force = chrono::VNULL;
+		body.Torque = chrono::VNULL;
+	}
+
+	// The attachment points turn with the bodies at the system step only
+	std::vector<chrono::ChVector<>> offsets1(springs.size());
+	std::vector<chrono::ChVector<>> offsets2(springs.size());
+	std::vector<chrono::ChVector<>> spin1(springs.size());
+	std::vector<chrono::ChVector<>> spin2(springs.size());
+	for (int32 s = 0; s < (int32)springs.size(); s++) {
+		const FSpring& spring = springs[s];
+		chrono::ChBody* body1 = bodies[spring.Body1].Body;
+		chrono::ChBody* body2 = bodies[spring.Body2].Body;
+		offsets1[s] = body1->TransformDirectionLocalToParent(spring.Point1);
+		offsets2[s] = body2->TransformDirectionLocalToParent(spring.Point2);
+		spin1[s] = body1->GetWvel_par() % offsets1[s];
+		spin2[s] = body2->GetWvel_par() % offsets2[s];
+	}
+
+	double h = stepSize / substeps;
+	double weight = 1.0 / substeps;
+	for (int32 k = 0; k < substeps; k++) {
+		for (auto& force : forces) {
+			force = chrono::VNULL;
+		}
+		for (int32 s = 0; s < (int32)springs.size(); s++) {
+			const FSpring& spring = springs[s];
+			chrono::ChVector<> delta = positions[spring.Body2] + offsets2[s] - positions[spring.Body1] - offsets1[s];
+			double length = delta.Length();
+			if (length < 1e-12) {
+				continue;
+			}
+			chrono::ChVector<> direction = delta / length;
+			chrono::ChVector<> relativeVelocity = velocities[spring.Body2] + spin2[s] - velocities[spring.Body1] - spin1[s];
+			// Same law as ChLinkSpring, positive pulls the ends together
+			double tension = spring.Stiffness * (length - spring.RestLength) + spring.Damping * (relativeVelocity ^ direction);
+			chrono::ChVector<> force = direction * tension;
+			forces[spring.Body1] += force;
+			forces[spring.Body2] -= force;
+			bodies[spring.Body1].Torque += (offsets1[s] % force) * weight;
+			bodies[spring.Body2].Torque -= (offsets2[s] % force) * weight;
+		}
+
+		// Linear in the step from the last two coupling accelerations, sampled mid substep
+		double blend = 1.0 + (k + 0.5) / substeps;
+		for (int32 i = 0; i < bodyNum; i++) {
+			FSpringBody& body = bodies[i];
+			body.Force += forces[i] * weight;
+			if (invMass[i] == 0) {
+				continue;
+			}
+			chrono::ChVector<> coupling = body.LastCouplingAcceleration + (body.CouplingAcceleration - body.LastCouplingAcceleration) * blend;
+			velocities[i] += (coupling + forces[i] * invMass[i]) * h;
+			positions[i] += velocities[i] * h;
+		}
+	}
+}
+
+void FChMultirateSprings::IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c)
+{
+	for (const FSpringBody& body : bodies) {
+		chrono::ChBody* chBody = body.Body;
+		if (chBody->GetBodyFixed() || chBody->GetSleeping()) {
+			continue;
+		}
+		// Bodies take their torques in the body frame
+		R.PasteSumVector(body.Force * c, chBody->GetOffset_w(), 0);
+		R.PasteSumVector(chBody->TransformDirectionParentToLocal(body.Torque) * c, chBody->GetOffset_w() + 3, 0);
+	}
+}
+
+void FChMultirateSprings::VariablesFbLoadForces(double factor)
+{
+	for (const FSpringBody& body : bodies) {
+		chrono::ChBody* chBody = body.Body;
+		if (chBody->GetBodyFixed() || chBody->GetSleeping()) {
+			continue;
+		}
+		chBody->Variables().Get_fb().PasteSumVector(body.Force * factor, 0, 0);
+		chBody->Variables().Get_fb().PasteSumVector(chBody->TransformDirectionParentToLocal(body.Torque) * factor, 3, 0);
+	}
+}
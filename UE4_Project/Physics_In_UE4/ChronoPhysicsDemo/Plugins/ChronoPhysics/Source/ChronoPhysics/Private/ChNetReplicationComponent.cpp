@@ -0,0 +1,38 @@
+#include "ChNetReplicationComponent.h"
+#include "ChPhysicsSceneManagerActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+UChNetReplicationComponent::UChNetReplicationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	bReplicates = true;
+}
+
+void UChNetReplicationComponent::ClientReceiveSnapshot_Implementation(const TArray<uint8>& data)
+{
+	// The client's copy of the component doesn't know its scene until the first snapshot
+	if (!Scene.IsValid()) {
+		for (TActorIterator<AChPhysicsSceneManagerActor> it(GetWorld()); it; ++it) {
+			if (it->bReplicateSimulation) {
+				Scene = *it;
+				break;
+			}
+		}
+	}
+	int32 sequence = INDEX_NONE;
+	if (Scene.IsValid() && Scene->ReceiveNetSnapshot(data, sequence)) {
+		ServerAckSnapshot(sequence);
+	}
+}
+
+bool UChNetReplicationComponent::ServerAckSnapshot_Validate(int32 sequence)
+{
+	return sequence >= 0;
+}
+
+void UChNetReplicationComponent::ServerAckSnapshot_Implementation(int32 sequence)
+{
+	// Unreliable, an older acknowledgement can arrive after a newer one
+	ackedSequence = FMath::Max(ackedSequence, sequence);
+}
@@ -0,0 +1,327 @@
+#include "ChNetSnapshot.h"
+#include "ChBodyComponent.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/Crc.h"
+
+namespace {
+	const float RotationRange = 1023.f;
+	const float Sqrt2 = 1.41421356f;
+
+	FORCEINLINE uint32 ZigZag(int32 value)
+	{
+		return ((uint32)value << 1) ^ (uint32)(value >> 31);
+	}
+
+	FORCEINLINE int32 UnZigZag(uint32 value)
+	{
+		return (int32)(value >> 1) ^ -(int32)(value & 1);
+	}
+
+	const FChNetPose& IdentityPose()
+	{
+		static FChNetPose pose = []() {
+			FChNetPose identity;
+			identity.Rotation = FChNetSnapshotCodec::PackRotation(FQuat::Identity);
+			return identity;
+		}();
+		return pose;
+	}
+}
+
+FChNetPose FChNetSnapshotCodec::Quantize(const FVector& location, const FQuat& rotation, float resolution)
+{
+	FChNetPose pose;
+	for (int32 i = 0; i < 3; i++) {
+		pose.Position[i] = FMath::RoundToInt(location[i] / resolution);
+	}
+	pose.Rotation = PackRotation(rotation);
+	return pose;
+}
+
+void FChNetSnapshotCodec::Dequantize(const FChNetPose& pose, float resolution, FVector& outLocation, FQuat& outRotation)
+{
+	outLocation = FVector(pose.Position[0], pose.Position[1], pose.Position[2]) * resolution;
+	outRotation = UnpackRotation(pose.Rotation);
+}
+
+uint32 FChNetSnapshotCodec::PackRotation(const FQuat& rotation)
+{
+	FQuat q = rotation.GetNormalized();
+	float components[4] = { q.X, q.Y, q.Z, q.W };
+	int32 largest = 0;
+	for (int32 i = 1; i < 4; i++) {
+		if (FMath::Abs(components[i]) > FMath::Abs(components[largest])) {
+			largest = i;
+		}
+	}
+	// q and -q are the same rotation, the largest is made positive and left out
+	float sign = components[largest] < 0 ? -1.f : 1.f;
+	uint32 packed = (uint32)largest;
+	for (int32 i = 0; i < 4; i++) {
+		if (i != largest) {
+			// The others are within +-1/sqrt(2)
+			float unit = components[i] * sign * Sqrt2 * 0.5f + 0.5f;
+			packed = (packed << 10) | (uint32)FMath::Clamp(FMath::RoundToInt(unit * RotationRange), 0, 1023);
+		}
+	}
+	return packed;
+}
+
+FQuat FChNetSnapshotCodec::UnpackRotation(uint32 packed)
+{
+	int32 largest = (int32)(packed >> 30);
+	float components[4];
+	float sum = 0;
+	for (int32 i = 3; i >= 0; i--) {
+		if (i == largest) {
+			continue;
+		}
+		float unit = (packed & 1023) / RotationRange;
+		packed >>= 10;
+		components[i] = (unit - 0.5f) * Sqrt2;
+		sum += components[i] * components[i];
+	}
+	components[largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - sum));
+	return FQuat(components[0], components[1], components[2], components[3]).GetNormalized();
+}
+
+void FChNetSnapshotCodec::Encode(const FChNetFrame& frame, const FChNetFrame* baseline, uint32 layoutHash, TArray<uint8>& outData)
+{
+	if (baseline && baseline->Poses.Num() != frame.Poses.Num()) {
+		baseline = nullptr;
+	}
+	TArray<int32, TInlineAllocator<256>> changed;
+	for (int32 i = 0; i < frame.Poses.Num(); i++) {
+		if (frame.Poses[i] != (baseline ? baseline->Poses[i] : IdentityPose())) {
+			changed.Add(i);
+		}
+	}
+
+	outData.Reset();
+	FMemoryWriter writer(outData);
+	int32 sequence = frame.Sequence;
+	int32 baselineSequence = baseline ? baseline->Sequence : INDEX_NONE;
+	double time = frame.Time;
+	uint32 bodyNum = frame.Poses.Num();
+	uint32 changedNum = changed.Num();
+	writer << layoutHash << sequence << baselineSequence << time;
+	writer.SerializeIntPacked(bodyNum);
+	writer.SerializeIntPacked(changedNum);
+
+	// Index gaps and position deltas are small, both go as packed integers
+	int32 previous = INDEX_NONE;
+	for (int32 index : changed) {
+		const FChNetPose& pose = frame.Poses[index];
+		const FChNetPose& base = baseline ? baseline->Poses[index] : IdentityPose();
+		uint32 gap = index - previous - 1;
+		writer.SerializeIntPacked(gap);
+		for (int32 i = 0; i < 3; i++) {
+			uint32 delta = ZigZag(pose.Position[i] - base.Position[i]);
+			writer.SerializeIntPacked(delta);
+		}
+		uint32 rotation = pose.Rotation;
+		writer << rotation;
+		previous = index;
+	}
+}
+
+bool FChNetSnapshotCodec::Decode(const TArray<uint8>& data, uint32 layoutHash, int32 bodyNum, TFunctionRef<const FChNetFrame*(int32)> findBaseline, FChNetFrame& outFrame)
+{
+	FMemoryReader reader(data);
+	uint32 hash = 0;
+	int32 sequence = INDEX_NONE;
+	int32 baselineSequence = INDEX_NONE;
+	double time = 0;
+	uint32 frameBodyNum = 0;
+	uint32 changedNum = 0;
+	reader << hash << sequence << baselineSequence << time;
+	reader.SerializeIntPacked(frameBodyNum);
+	reader.SerializeIntPacked(changedNum);
+	if (reader.IsError() || hash != layoutHash || (int32)frameBodyNum != bodyNum || changedNum > frameBodyNum) {
+		return false;
+	}
+
+	const FChNetFrame* baseline = nullptr;
+	if (baselineSequence != INDEX_NONE) {
+		baseline = findBaseline(baselineSequence);
+		if (!baseline || baseline->Poses.Num() != bodyNum) {
+			return false;
+		}
+	}
+	if (baseline) {
+		outFrame.Poses = baseline->Poses;
+	}
+	else {
+		outFrame.Poses.Init(IdentityPose(), bodyNum);
+	}
+
+	int32 previous = INDEX_NONE;
+	for (uint32 n = 0; n < changedNum; n++) {
+		uint32 gap = 0;
+		reader.SerializeIntPacked(gap);
+		int32 index = previous + 1 + (int32)gap;
+		if (reader.IsError() || index < 0 || index >= bodyNum) {
+			return false;
+		}
+		FChNetPose& pose = outFrame.Poses[index];
+		for (int32 i = 0; i < 3; i++) {
+			uint32 delta = 0;
+			reader.SerializeIntPacked(delta);
+			pose.Position[i] += UnZigZag(delta);
+		}
+		reader << pose.Rotation;
+		previous = index;
+	}
+	if (reader.IsError()) {
+		return false;
+	}
+	outFrame.Sequence = sequence;
+	outFrame.Time = time;
+	return true;
+}
+
+void FChNetReplicator::SetBodies(const TArray<UChBodyComponent*>& allBodies)
+{
+	bodies.Reset();
+	for (auto body : allBodies) {
+		if (body && body->GetChData() && !body->isFixed && !body->bKinematic) {
+			bodies.Add(body);
+		}
+	}
+	// Registration order differs between machines, path names don't
+	TArray<FString> names;
+	names.Reserve(bodies.Num());
+	for (auto body : bodies) {
+		names.Add(body->GetPathName());
+	}
+	TArray<int32> order;
+	order.Reserve(bodies.Num());
+	for (int32 i = 0; i < bodies.Num(); i++) {
+		order.Add(i);
+	}
+	order.Sort([&names](int32 a, int32 b) { return names[a] < names[b]; });
+
+	TArray<UChBodyComponent*> sorted;
+	sorted.Reserve(bodies.Num());
+	layoutHash = 0;
+	for (int32 i : order) {
+		sorted.Add(bodies[i]);
+		layoutHash = FCrc::StrCrc32(*names[i], layoutHash);
+	}
+	bodies = MoveTemp(sorted);
+
+	// Old frames have the old layout
+	for (auto& frame : history) {
+		frame = FChNetFrame();
+	}
+	historyHead = INDEX_NONE;
+	renderTime = -1;
+	appliedPoses.SetNum(bodies.Num());
+	appliedValid.Init(false, bodies.Num());
+}
+
+const FChNetFrame* FChNetReplicator::FindFrame(int32 sequence) const
+{
+	for (auto& frame : history) {
+		if (frame.Sequence == sequence && sequence != INDEX_NONE) {
+			return &frame;
+		}
+	}
+	return nullptr;
+}
+
+FChNetFrame& FChNetReplicator::AddFrame()
+{
+	historyHead = (historyHead + 1) % HistorySize;
+	return history[historyHead];
+}
+
+void FChNetReplicator::Capture(double time, float resolution)
+{
+	FChNetFrame& frame = AddFrame();
+	frame.Sequence = nextSequence++;
+	frame.Time = time;
+	frame.Poses.SetNum(bodies.Num(), false);
+	for (int32 i = 0; i < bodies.Num(); i++) {
+		FVector location;
+		FQuat rotation;
+		bodies[i]->GetNetPose(location, rotation);
+		frame.Poses[i] = FChNetSnapshotCodec::Quantize(location, rotation, resolution);
+	}
+}
+
+bool FChNetReplicator::EncodeLatest(int32 ackedSequence, TArray<uint8>& outData) const
+{
+	if (historyHead == INDEX_NONE) {
+		return false;
+	}
+	// A baseline that fell out of the history is replaced by a full snapshot
+	FChNetSnapshotCodec::Encode(history[historyHead], FindFrame(ackedSequence), layoutHash, outData);
+	return true;
+}
+
+bool FChNetReplicator::Receive(const TArray<uint8>& data, int32& outSequence)
+{
+	FChNetFrame frame;
+	if (!FChNetSnapshotCodec::Decode(data, layoutHash, bodies.Num(), [this](int32 sequence) { return FindFrame(sequence); }, frame)) {
+		return false;
+	}
+	if (historyHead != INDEX_NONE && frame.Sequence <= history[historyHead].Sequence) {
+		return false;
+	}
+	AddFrame() = MoveTemp(frame);
+	outSequence = history[historyHead].Sequence;
+	return true;
+}
+
+void FChNetReplicator::Apply(float deltaTime, float delay, float resolution)
+{
+	if (historyHead == INDEX_NONE) {
+		return;
+	}
+	// The clock runs locally and is pulled back into a window behind the newest snapshot
+	double newest = history[historyHead].Time;
+	renderTime = renderTime < 0 ? newest - delay : renderTime + deltaTime;
+	renderTime = FMath::Clamp(renderTime, newest - 2.0 * delay, newest);
+
+	const FChNetFrame* from = nullptr;
+	const FChNetFrame* to = nullptr;
+	for (auto& frame : history) {
+		if (frame.Sequence == INDEX_NONE || frame.Poses.Num() != bodies.Num()) {
+			continue;
+		}
+		if (frame.Time <= renderTime && (!from || frame.Time > from->Time)) {
+			from = &frame;
+		}
+		if (frame.Time > renderTime && (!to || frame.Time < to->Time)) {
+			to = &frame;
+		}
+	}
+	if (!from) {
+		from = to;
+	}
+	if (!from) {
+		return;
+	}
+	float alpha = to && to != from ? (float)((renderTime - from->Time) / (to->Time - from->Time)) : 0.f;
+	if (!to) {
+		to = from;
+	}
+
+	for (int32 i = 0; i < bodies.Num(); i++) {
+		const FChNetPose& a = from->Poses[i];
+		const FChNetPose& b = to->Poses[i];
+		if (a == b && appliedValid[i] && appliedPoses[i] == a) {
+			continue;
+		}
+		FVector locationA, locationB;
+		FQuat rotationA, rotationB;
+		FChNetSnapshotCodec::Dequantize(a, resolution, locationA, rotationA);
+		FChNetSnapshotCodec::Dequantize(b, resolution, locationB, rotationB);
+		bodies[i]->ApplyNetPose(FMath::Lerp(locationA, locationB, alpha), FQuat::Slerp(rotationA, rotationB, alpha));
+		appliedPoses[i] = a;
+		// Between two different poses the body has to be moved again next frame
+		appliedValid[i] = a == b;
+	}
+}
@@ -0,0 +1,92 @@
+#include "ChOutputPipeline.h"
+#include "ChTelemetry.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+FChOutputPipeline::FChOutputPipeline(const FString& filePath, const FChTelemetry& layout, int32 framesPerChunk, int32 ringFrames, int32 inDecimation)
+	: frameWidth(layout.GetFrameWidth())
+	, capacity(FMath::Max(ringFrames, 1))
+	, decimation(FMath::Max(inDecimation, 1))
+{
+	if (frameWidth == 0 || !writer.Open(filePath, layout, framesPerChunk)) {
+		return;
+	}
+	ring.SetNumZeroed(capacity * frameWidth);
+	ringTimes.SetNumZeroed(capacity);
+	wakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	thread = FRunnableThread::Create(this, TEXT("ChOutputWriter"), 0, TPri_BelowNormal);
+}
+
+FChOutputPipeline::~FChOutputPipeline()
+{
+	if (thread) {
+		// Stop lets Run write out the rest of the ring before it returns
+		thread->Kill(true);
+		delete thread;
+	}
+	writer.Close();
+	if (wakeEvent) {
+		FPlatformProcess::ReturnSynchEventToPool(wakeEvent);
+	}
+}
+
+void FChOutputPipeline::Push(float time, const float* frame)
+{
+	if (!thread || !frame || stepCount++ % decimation != 0) {
+		return;
+	}
+
+	int32 head = pushed.GetValue();
+	int32 used = head - popped.GetValue();
+	if (used >= capacity) {
+		droppedFrames.Increment();
+		return;
+	}
+	int32 slot = head % capacity;
+	FMemory::Memcpy(ring.GetData() + slot * frameWidth, frame, frameWidth * sizeof(float));
+	ringTimes[slot] = time;
+	// Interlocked, the slot is written before the writer can see it
+	pushed.Increment();
+	if (used + 1 >= capacity / 2) {
+		wakeEvent->Trigger();
+	}
+}
+
+void FChOutputPipeline::DrainRing()
+{
+	int32 tail = popped.GetValue();
+	int32 count = pushed.GetValue() - tail;
+	if (count <= 0) {
+		return;
+	}
+
+	// The slots stay the producer's until popped moves, so copy out before the slow write
+	drainFrames.SetNumUninitialized(count * frameWidth, false);
+	drainTimes.SetNumUninitialized(count, false);
+	for (int32 i = 0; i < count; i++) {
+		int32 slot = (tail + i) % capacity;
+		FMemory::Memcpy(drainFrames.GetData() + i * frameWidth, ring.GetData() + slot * frameWidth, frameWidth * sizeof(float));
+		drainTimes[i] = ringTimes[slot];
+	}
+	popped.Add(count);
+
+	writer.AppendFrames(drainFrames, drainTimes, count);
+	writtenFrames.Add(count);
+}
+
+uint32 FChOutputPipeline::Run()
+{
+	while (stopping.GetValue() == 0) {
+		wakeEvent->Wait(10);
+		DrainRing();
+	}
+	DrainRing();
+	return 0;
+}
+
+void FChOutputPipeline::Stop()
+{
+	stopping.Set(1);
+	wakeEvent->Trigger();
+}
@@ -0,0 +1,400 @@
+#include "ChPackedContactContainerSMC.h"
+#include "chrono/physics/ChSystemSMC.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChMaterialSurfaceSMC.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "Async/ParallelFor.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+	// Contacts per task of the force pass, bodies per task of the reduction
+	const int32 ContactChunkSize = 512;
+	const int32 BodyChunkSize = 256;
+
+	// Chrono's laws, for systems the material library hasn't composed yet
+	chrono::ChMaterialCompositionStrategy<float> defaultStrategy;
+
+	template <typename T>
+	FORCEINLINE void ResetAll(TArray<T>* arrays, int32 count)
+	{
+		for (int32 i = 0; i < count; i++) {
+			arrays[i].Reset();
+		}
+	}
+
+	FORCEINLINE void ParallelChunks(int32 num, int32 chunkSize, TFunctionRef<void(int32, int32)> body)
+	{
+		int32 chunks = (num + chunkSize - 1) / chunkSize;
+		ParallelFor(chunks, [&](int32 chunk) {
+			body(chunk * chunkSize, FMath::Min(num, (chunk + 1) * chunkSize));
+		}, chunks < 2);
+	}
+}
+
+SIZE_T FChPackedContactContainerSMC::GetAllocatedSize() const
+{
+	SIZE_T total = bodyA.GetAllocatedSize() + bodyB.GetAllocatedSize() + overlap.GetAllocatedSize() + effRadius.GetAllocatedSize() + effMass.GetAllocatedSize();
+	for (int32 i = 0; i < 3; i++) {
+		total += pointA[i].GetAllocatedSize() + pointB[i].GetAllocatedSize() + normal[i].GetAllocatedSize() + force[i].GetAllocatedSize();
+	}
+	total += youngModulus.GetAllocatedSize() + shearModulus.GetAllocatedSize() + friction.GetAllocatedSize() + restitution.GetAllocatedSize() + adhesion.GetAllocatedSize();
+	total += stiffnessN.GetAllocatedSize() + stiffnessT.GetAllocatedSize() + dampingN.GetAllocatedSize() + dampingT.GetAllocatedSize();
+	total += bodies.GetAllocatedSize() + bodyIndices.GetAllocatedSize() + bodyForces.GetAllocatedSize() + bodyTorques.GetAllocatedSize();
+	total += bodySegments.GetAllocatedSize() + sortedEnds.GetAllocatedSize();
+	return total;
+}
+
+void FChPackedContactContainerSMC::RemoveAllContacts()
+{
+	ChContactContainerSMC::RemoveAllContacts();
+	contactNum = 0;
+	bodies.Reset();
+	bodyIndices.Reset();
+}
+
+void FChPackedContactContainerSMC::BeginAddContact()
+{
+	ChContactContainerSMC::BeginAddContact();
+	contactNum = 0;
+	bodyA.Reset();
+	bodyB.Reset();
+	ResetAll(pointA, 3);
+	ResetAll(pointB, 3);
+	ResetAll(normal, 3);
+	overlap.Reset();
+	effRadius.Reset();
+	effMass.Reset();
+	youngModulus.Reset();
+	shearModulus.Reset();
+	friction.Reset();
+	restitution.Reset();
+	adhesion.Reset();
+	stiffnessN.Reset();
+	stiffnessT.Reset();
+	dampingN.Reset();
+	dampingT.Reset();
+	bodies.Reset();
+	bodyIndices.Reset();
+}
+
+int32 FChPackedContactContainerSMC::FindOrAddBody(chrono::ChBody* body)
+{
+	if (int32* found = bodyIndices.Find(body)) {
+		return *found;
+	}
+	return bodyIndices.Add(body, bodies.Add(body));
+}
+
+void FChPackedContactContainerSMC::AddContact(const chrono::collision::ChCollisionInfo& mcontact)
+{
+	auto system = static_cast<chrono::ChSystemSMC*>(GetSystem());
+	auto rigidA = dynamic_cast<chrono::ChBody*>(mcontact.modelA->GetContactable());
+	auto rigidB = dynamic_cast<chrono::ChBody*>(mcontact.modelB->GetContactable());
+	if (!rigidA || !rigidB || system->GetStiffContact()) {
+		ChContactContainerSMC::AddContact(mcontact);
+		return;
+	}
+	if (mcontact.distance >= 0 || (!rigidA->IsContactActive() && !rigidB->IsContactActive())) {
+		return;
+	}
+
+	chrono::ChMaterialCompositeSMC mat(compositionStrategy ? compositionStrategy.get() : &defaultStrategy,
+		std::static_pointer_cast<chrono::ChMaterialSurfaceSMC>(rigidA->GetMaterialSurfaceBase()),
+		std::static_pointer_cast<chrono::ChMaterialSurfaceSMC>(rigidB->GetMaterialSurfaceBase()));
+	if (add_contact_callback) {
+		add_contact_callback->OnAddContact(mcontact, &mat);
+	}
+
+	bodyA.Add(FindOrAddBody(rigidA));
+	bodyB.Add(FindOrAddBody(rigidB));
+	for (int32 k = 0; k < 3; k++) {
+		pointA[k].Add(mcontact.vpA[k]);
+		pointB[k].Add(mcontact.vpB[k]);
+		normal[k].Add(mcontact.vN[k]);
+	}
+	overlap.Add(-mcontact.distance);
+	effRadius.Add(mcontact.eff_radius);
+	double massA = rigidA->GetContactableMass();
+	double massB = rigidB->GetContactableMass();
+	effMass.Add(massA * massB / (massA + massB));
+	youngModulus.Add(mat.E_eff);
+	shearModulus.Add(mat.G_eff);
+	friction.Add(mat.mu_eff);
+	restitution.Add(mat.cr_eff);
+	adhesion.Add(system->GetAdhesionForceModel() == chrono::ChSystemSMC::DMT ? mat.adhesionMultDMT_eff * (float)std::sqrt(mcontact.eff_radius) : mat.adhesion_eff);
+	stiffnessN.Add(mat.kn);
+	stiffnessT.Add(mat.kt);
+	dampingN.Add(mat.gn);
+	dampingT.Add(mat.gt);
+	contactNum++;
+}
+
+FChContactBatch FChPackedContactContainerSMC::MakeBatch(bool bWithForces)
+{
+	FChContactBatch batch;
+	batch.Num = contactNum;
+	batch.BodyNum = bodies.Num();
+	batch.Bodies = bodies.GetData();
+	batch.BodyA = bodyA.GetData();
+	batch.BodyB = bodyB.GetData();
+	for (int32 k = 0; k < 3; k++) {
+		batch.PointA[k] = pointA[k].GetData();
+		batch.PointB[k] = pointB[k].GetData();
+		batch.Normal[k] = normal[k].GetData();
+		batch.Force[k] = bWithForces ? force[k].GetData() : nullptr;
+	}
+	batch.Overlap = overlap.GetData();
+	batch.EffRadius = effRadius.GetData();
+	batch.YoungModulus = youngModulus.GetData();
+	batch.ShearModulus = shearModulus.GetData();
+	batch.Friction = friction.GetData();
+	batch.Restitution = restitution.GetData();
+	batch.Adhesion = adhesion.GetData();
+	batch.StiffnessN = stiffnessN.GetData();
+	batch.StiffnessT = stiffnessT.GetData();
+	batch.DampingN = dampingN.GetData();
+	batch.DampingT = dampingT.GetData();
+	return batch;
+}
+
+FChContactBatch FChPackedContactContainerSMC::GetContactBatch()
+{
+	return MakeBatch(force[0].Num() == contactNum);
+}
+
+void FChPackedContactContainerSMC::EndAddContact()
+{
+	ChContactContainerSMC::EndAddContact();
+	if (batchCallback && contactNum > 0) {
+		FChContactBatch batch = MakeBatch(false);
+		batchCallback->OnContactBatch(batch);
+	}
+	ComputeForces();
+	ReduceForces();
+}
+
+void FChPackedContactContainerSMC::ComputeForces()
+{
+	for (int32 k = 0; k < 3; k++) {
+		force[k].SetNumUninitialized(contactNum, false);
+	}
+	if (contactNum == 0) {
+		return;
+	}
+
+	// Body state at the start of the step, as ChContactSMC reads it when the contact is added
+	int32 bodyNum = bodies.Num();
+	TArray<chrono::ChVector<>> positions, velocities, angularVelocities;
+	positions.SetNumUninitialized(bodyNum);
+	velocities.SetNumUninitialized(bodyNum);
+	angularVelocities.SetNumUninitialized(bodyNum);
+	for (int32 i = 0; i < bodyNum; i++) {
+		positions[i] = bodies[i]->GetPos();
+		velocities[i] = bodies[i]->GetPos_dt();
+		angularVelocities[i] = bodies[i]->GetWvel_par();
+	}
+
+	auto system = static_cast<chrono::ChSystemSMC*>(GetSystem());
+	const double dT = system->GetStep();
+	const bool bMatProps = system->UsingMaterialProperties();
+	const chrono::ChSystemSMC::ContactForceModel model = system->GetContactForceModel();
+	const bool bTangentDisplacement = system->GetTangentialDisplacementModel() != chrono::ChSystemSMC::None;
+	const double slipThreshold = system->GetSlipVelocityThreshold();
+	const double v2 = system->GetCharacteristicImpactVelocity() * system->GetCharacteristicImpactVelocity();
+	const double eps = std::numeric_limits<double>::epsilon();
+
+	ParallelChunks(contactNum, ContactChunkSize, [&](int32 begin, int32 end) {
+		for (int32 i = begin; i < end; i++) {
+			int32 a = bodyA[i];
+			int32 b = bodyB[i];
+			chrono::ChVector<> n(normal[0][i], normal[1][i], normal[2][i]);
+			chrono::ChVector<> pA(pointA[0][i], pointA[1][i], pointA[2][i]);
+			chrono::ChVector<> pB(pointB[0][i], pointB[1][i], pointB[2][i]);
+			chrono::ChVector<> relvel = velocities[b] + angularVelocities[b].Cross(pB - positions[b])
+				- velocities[a] - angularVelocities[a].Cross(pA - positions[a]);
+			double vn = relvel.Dot(n);
+			chrono::ChVector<> relvelT = relvel - vn * n;
+			double vt = relvelT.Length();
+
+			double delta = overlap[i];
+			double mass = effMass[i];
+			double radius = effRadius[i];
+			double loge = std::log(FMath::Clamp((double)restitution[i], eps, 1 - eps));
+			double kn, kt, gn, gt;
+			switch (model) {
+			case chrono::ChSystemSMC::Hooke:
+				if (bMatProps) {
+					double k = (16.0 / 15) * std::sqrt(radius) * youngModulus[i];
+					kn = k * std::pow(mass * v2 / k, 1.0 / 5);
+					kt = kn;
+					gn = std::sqrt(4 * mass * kn / (1 + (PI / loge) * (PI / loge)));
+					gt = gn;
+				}
+				else {
+					kn = stiffnessN[i];
+					kt = stiffnessT[i];
+					gn = mass * dampingN[i];
+					gt = mass * dampingT[i];
+				}
+				break;
+			case chrono::ChSystemSMC::Hertz:
+				if (bMatProps) {
+					double sqrtRd = std::sqrt(radius * delta);
+					double sn = 2 * youngModulus[i] * sqrtRd;
+					double st = 8 * shearModulus[i] * sqrtRd;
+					double beta = loge / std::sqrt(loge * loge + PI * PI);
+					kn = (2.0 / 3) * sn;
+					kt = st;
+					gn = -2 * std::sqrt(5.0 / 6) * beta * std::sqrt(sn * mass);
+					gt = -2 * std::sqrt(5.0 / 6) * beta * std::sqrt(st * mass);
+				}
+				else {
+					double t = radius * std::sqrt(delta);
+					kn = t * stiffnessN[i];
+					kt = t * stiffnessT[i];
+					gn = t * mass * dampingN[i];
+					gt = t * mass * dampingT[i];
+				}
+				break;
+			default:
+				if (bMatProps) {
+					double sn = 2 * youngModulus[i] * std::sqrt(delta);
+					kn = (2.0 / 3) * sn;
+					gn = -2 * std::sqrt(5.0 / 6) * (loge / std::sqrt(loge * loge + PI * PI)) * std::sqrt(sn * mass);
+				}
+				else {
+					kn = std::sqrt(delta) * stiffnessN[i];
+					gn = std::sqrt(delta) * dampingN[i];
+				}
+				kt = 0;
+				gt = 0;
+				break;
+			}
+
+			double forceN = FMath::Max(kn * delta - gn * vn, 0.0);
+			double forceT;
+			if (model == chrono::ChSystemSMC::PlainCoulomb) {
+				forceT = friction[i] * std::tanh(5.0 * vt) * forceN;
+				forceN -= adhesion[i];
+			}
+			else {
+				forceT = forceN > 0 ? kt * (bTangentDisplacement ? vt * dT : 0.0) + gt * vt : 0.0;
+				forceN -= adhesion[i];
+				forceT = FMath::Min(forceT, friction[i] * std::fabs(forceN));
+			}
+			chrono::ChVector<> f = forceN * n;
+			if (vt >= slipThreshold) {
+				f -= (forceT / vt) * relvelT;
+			}
+			force[0][i] = f.x();
+			force[1][i] = f.y();
+			force[2][i] = f.z();
+		}
+	});
+}
+
+void FChPackedContactContainerSMC::ReduceForces()
+{
+	int32 bodyNum = bodies.Num();
+	bodyForces.SetNumUninitialized(bodyNum, false);
+	bodyTorques.SetNumUninitialized(bodyNum, false);
+	if (bodyNum == 0) {
+		return;
+	}
+
+	// Counting sort of the contact ends by body, ends keep their contact order inside a segment
+	bodySegments.Reset(bodyNum + 1);
+	bodySegments.AddZeroed(bodyNum + 1);
+	for (int32 i = 0; i < contactNum; i++) {
+		bodySegments[bodyA[i] + 1]++;
+		bodySegments[bodyB[i] + 1]++;
+	}
+	for (int32 i = 0; i < bodyNum; i++) {
+		bodySegments[i + 1] += bodySegments[i];
+	}
+	sortedEnds.SetNumUninitialized(contactNum * 2, false);
+	TArray<int32> cursors(bodySegments.GetData(), bodyNum);
+	for (int32 i = 0; i < contactNum; i++) {
+		sortedEnds[cursors[bodyA[i]]++] = i * 2;
+		sortedEnds[cursors[bodyB[i]]++] = i * 2 + 1;
+	}
+
+	ParallelChunks(bodyNum, BodyChunkSize, [&](int32 begin, int32 end) {
+		for (int32 b = begin; b < end; b++) {
+			chrono::ChVector<> position = bodies[b]->GetPos();
+			chrono::ChVector<> sumF(0), sumT(0);
+			for (int32 s = bodySegments[b]; s < bodySegments[b + 1]; s++) {
+				int32 i = sortedEnds[s] >> 1;
+				bool bSideB = sortedEnds[s] & 1;
+				const TArray<double>* points = bSideB ? pointB : pointA;
+				double sign = bSideB ? 1.0 : -1.0;
+				chrono::ChVector<> f(sign * force[0][i], sign * force[1][i], sign * force[2][i]);
+				chrono::ChVector<> p(points[0][i], points[1][i], points[2][i]);
+				sumF += f;
+				sumT += (p - position).Cross(f);
+			}
+			bodyForces[b] = sumF;
+			bodyTorques[b] = sumT;
+		}
+	});
+}
+
+void FChPackedContactContainerSMC::IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c)
+{
+	ChContactContainerSMC::IntLoadResidual_F(off, R, c);
+	// Every body owns its rows, one add each
+	ParallelChunks(bodies.Num(), BodyChunkSize, [&](int32 begin, int32 end) {
+		for (int32 b = begin; b < end; b++) {
+			chrono::ChBody* body = bodies[b];
+			if (body->IsContactActive()) {
+				R.PasteSumVector(bodyForces[b] * c, body->GetOffset_w(), 0);
+				R.PasteSumVector(body->TransformDirectionParentToLocal(bodyTorques[b]) * c, body->GetOffset_w() + 3, 0);
+			}
+		}
+	});
+}
+
+void FChPackedContactContainerSMC::ConstraintsFbLoadForces(double factor)
+{
+	ChContactContainerSMC::ConstraintsFbLoadForces(factor);
+	for (int32 b = 0; b < bodies.Num(); b++) {
+		chrono::ChBody* body = bodies[b];
+		if (body->IsContactActive()) {
+			body->Variables().Get_fb().PasteSumVector(bodyForces[b] * factor, 0, 0);
+			body->Variables().Get_fb().PasteSumVector(body->TransformDirectionParentToLocal(bodyTorques[b]) * factor, 3, 0);
+		}
+	}
+}
+
+void FChPackedContactContainerSMC::ComputeContactForces()
+{
+	ChContactContainerSMC::ComputeContactForces();
+	for (int32 b = 0; b < bodies.Num(); b++) {
+		ForceTorque& entry = contact_forces[bodies[b]];
+		entry.force += bodyForces[b];
+		entry.torque += bodyTorques[b];
+	}
+}
+
+void FChPackedContactContainerSMC::ReportAllContacts(ReportContactCallback* mcallback)
+{
+	ChContactContainerSMC::ReportAllContacts(mcallback);
+	if (!mcallback) {
+		return;
+	}
+	for (int32 i = 0; i < contactNum; i++) {
+		chrono::ChVector<> n(normal[0][i], normal[1][i], normal[2][i]);
+		chrono::ChVector<> vx, vy, vz;
+		chrono::XdirToDxDyDz(n, chrono::VECT_Y, vx, vy, vz);
+		chrono::ChMatrix33<> plane;
+		plane.Set_A_axis(vx, vy, vz);
+		chrono::ChVector<> f(force[0][i], force[1][i], force[2][i]);
+		bool bContinue = mcallback->OnReportContact(chrono::ChVector<>(pointA[0][i], pointA[1][i], pointA[2][i]),
+			chrono::ChVector<>(pointB[0][i], pointB[1][i], pointB[2][i]), plane, -overlap[i], effRadius[i],
+			plane.MatrT_x_Vect(f), chrono::VNULL, bodies[bodyA[i]], bodies[bodyB[i]]);
+		if (!bContinue) {
+			break;
+		}
+	}
+}
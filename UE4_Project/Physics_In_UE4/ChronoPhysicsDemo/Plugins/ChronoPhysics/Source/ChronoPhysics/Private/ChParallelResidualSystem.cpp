@@ -0,0 +1,147 @@
+#include "ChParallelResidualSystem.h"
+#include "chrono/physics/ChSystemNSC.h"
+#include "chrono/physics/ChSystemSMC.h"
+#include "chrono/physics/ChContactContainer.h"
+#include "chrono/fea/ChMesh.h"
+#include "Async/ParallelFor.h"
+
+namespace {
+	// Below this many items the loads run serially, one pass over them is cheaper than the task overhead
+	const int32 ParallelItemCount = 256;
+	// Rows summed per task when the partial vectors are reduced
+	const int32 ReduceRowBlock = 4096;
+}
+
+template <class TSystem>
+bool TChParallelResidualSystem<TSystem>::IsWorthParallel() const
+{
+	return (int32)(this->bodylist.size() + this->linklist.size() + this->meshlist.size() + this->otherphysicslist.size()) >= ParallelItemCount;
+}
+
+template <class TSystem>
+void TChParallelResidualSystem<TSystem>::GatherCouplingItems()
+{
+	couplingItems.clear();
+	for (auto& link : this->linklist) {
+		if (link->IsActive()) {
+			couplingItems.push_back(link.get());
+		}
+	}
+	for (auto& mesh : this->meshlist) {
+		if (mesh->IsActive()) {
+			couplingItems.push_back(mesh.get());
+		}
+	}
+	for (auto& item : this->otherphysicslist) {
+		if (item->IsActive()) {
+			couplingItems.push_back(item.get());
+		}
+	}
+}
+
+template <class TSystem>
+void TChParallelResidualSystem<TSystem>::IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c)
+{
+	if (!IsWorthParallel()) {
+		TSystem::IntLoadResidual_F(off, R, c);
+		return;
+	}
+	unsigned int displ_v = off - this->offset_w;
+
+	// A body writes only its own six rows
+	auto& bodies = this->bodylist;
+	ParallelFor((int32)bodies.size(), [&](int32 i) {
+		chrono::ChBody* body = bodies[i].get();
+		if (body->IsActive()) {
+			body->IntLoadResidual_F(displ_v + body->GetOffset_w(), R, c);
+		}
+	});
+
+	GatherCouplingItems();
+	int32 itemNum = (int32)couplingItems.size();
+	int32 chunks = FMath::Min(partialCount, itemNum);
+	if (chunks > 1) {
+		if ((int32)partials.size() < chunks) {
+			partials.resize(chunks);
+		}
+		int32 rows = R.GetRows();
+		ParallelFor(chunks, [&](int32 chunk) {
+			// Reset only reallocates when the size changes, it always zeroes
+			chrono::ChVectorDynamic<>& partial = partials[chunk];
+			partial.Reset(rows);
+			int32 begin = itemNum * chunk / chunks;
+			int32 end = itemNum * (chunk + 1) / chunks;
+			for (int32 i = begin; i < end; i++) {
+				couplingItems[i]->IntLoadResidual_F(displ_v + couplingItems[i]->GetOffset_w(), partial, c);
+			}
+		});
+		ParallelFor((rows + ReduceRowBlock - 1) / ReduceRowBlock, [&](int32 block) {
+			int32 end = FMath::Min((block + 1) * ReduceRowBlock, rows);
+			for (int32 row = block * ReduceRowBlock; row < end; row++) {
+				double sum = 0;
+				for (int32 chunk = 0; chunk < chunks; chunk++) {
+					sum += partials[chunk].ElementN(row);
+				}
+				R.ElementN(row) += sum;
+			}
+		});
+	}
+	else {
+		for (auto item : couplingItems) {
+			item->IntLoadResidual_F(displ_v + item->GetOffset_w(), R, c);
+		}
+	}
+
+	this->contact_container->IntLoadResidual_F(displ_v + this->contact_container->GetOffset_w(), R, c);
+}
+
+template <class TSystem>
+void TChParallelResidualSystem<TSystem>::IntLoadResidual_Mv(const unsigned int off, chrono::ChVectorDynamic<>& R, const chrono::ChVectorDynamic<>& w, const double c)
+{
+	if (!IsWorthParallel()) {
+		TSystem::IntLoadResidual_Mv(off, R, w, c);
+		return;
+	}
+	unsigned int displ_v = off - this->offset_w;
+
+	// The mass only couples an item's own rows
+	auto& bodies = this->bodylist;
+	ParallelFor((int32)bodies.size(), [&](int32 i) {
+		chrono::ChBody* body = bodies[i].get();
+		if (body->IsActive()) {
+			body->IntLoadResidual_Mv(displ_v + body->GetOffset_w(), R, w, c);
+		}
+	});
+	GatherCouplingItems();
+	ParallelFor((int32)couplingItems.size(), [&](int32 i) {
+		couplingItems[i]->IntLoadResidual_Mv(displ_v + couplingItems[i]->GetOffset_w(), R, w, c);
+	});
+	this->contact_container->IntLoadResidual_Mv(displ_v + this->contact_container->GetOffset_w(), R, w, c);
+}
+
+template <class TSystem>
+void TChParallelResidualSystem<TSystem>::IntLoadConstraint_C(const unsigned int off, chrono::ChVectorDynamic<>& Qc, const double c, bool do_clamp, double recovery_clamp)
+{
+	if (!IsWorthParallel()) {
+		TSystem::IntLoadConstraint_C(off, Qc, c, do_clamp, recovery_clamp);
+		return;
+	}
+	unsigned int displ_L = off - this->offset_L;
+
+	// Every item fills only its own constraint rows
+	auto& bodies = this->bodylist;
+	ParallelFor((int32)bodies.size(), [&](int32 i) {
+		chrono::ChBody* body = bodies[i].get();
+		if (body->IsActive()) {
+			body->IntLoadConstraint_C(displ_L + body->GetOffset_L(), Qc, c, do_clamp, recovery_clamp);
+		}
+	});
+	GatherCouplingItems();
+	ParallelFor((int32)couplingItems.size(), [&](int32 i) {
+		couplingItems[i]->IntLoadConstraint_C(displ_L + couplingItems[i]->GetOffset_L(), Qc, c, do_clamp, recovery_clamp);
+	});
+	this->contact_container->IntLoadConstraint_C(displ_L + this->contact_container->GetOffset_L(), Qc, c, do_clamp, recovery_clamp);
+}
+
+template class TChParallelResidualSystem<chrono::ChSystemNSC>;
+template class TChParallelResidualSystem<chrono::ChSystemSMC>;
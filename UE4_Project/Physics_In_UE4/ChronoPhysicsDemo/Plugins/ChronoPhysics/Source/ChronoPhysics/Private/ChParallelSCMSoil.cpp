@@ -0,0 +1,501 @@
+#include "ChParallelSCMSoil.h"
+#include "ChPhysicsStats.h"
+#include "Async/ParallelFor.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChForce.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "chrono/collision/gimpact/GIMPACT/Bullet/btGImpactShape.h"
+#include <cmath>
+
+DECLARE_CYCLE_STAT(TEXT("SCM Soil"), STAT_ChronoSCMSoil, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("SCM Touched Vertices"), STAT_ChronoSCMTouchedVertices, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("SCM Active Cells"), STAT_ChronoSCMActiveCells, STATGROUP_ChronoPhysics);
+
+namespace {
+	// Below the rest level the ray starts from, as SCMDeformableSoil's test_low_offset
+	constexpr double TestLowOffset = 0.5;
+	// Cells per task, fixed so the reduction order doesn't depend on the thread count
+	constexpr int32 CellsPerTask = 4;
+
+	FORCEINLINE void ToArray(const btTransform& transform, double outTransform[12])
+	{
+		const btMatrix3x3& basis = transform.getBasis();
+		for (int32 row = 0; row < 3; row++) {
+			outTransform[4 * row] = basis[row].x();
+			outTransform[4 * row + 1] = basis[row].y();
+			outTransform[4 * row + 2] = basis[row].z();
+			outTransform[4 * row + 3] = transform.getOrigin()[row];
+		}
+	}
+
+	FORCEINLINE btTransform FromArray(const double transform[12])
+	{
+		return btTransform(
+			btMatrix3x3(
+				(btScalar)transform[0], (btScalar)transform[1], (btScalar)transform[2],
+				(btScalar)transform[4], (btScalar)transform[5], (btScalar)transform[6],
+				(btScalar)transform[8], (btScalar)transform[9], (btScalar)transform[10]),
+			btVector3((btScalar)transform[3], (btScalar)transform[7], (btScalar)transform[11]));
+	}
+
+	FORCEINLINE bool IsGImpactShape(const btCollisionShape* shape)
+	{
+		return shape->getShapeType() == GIMPACT_SHAPE_PROXYTYPE;
+	}
+
+	std::shared_ptr<chrono::ChForce> AddWorldLoad(chrono::ChBody* body, chrono::ChForce::ForceType mode)
+	{
+		auto load = std::make_shared<chrono::ChForce>();
+		load->SetMode(mode);
+		load->SetFrame(chrono::ChForce::BODY);
+		load->SetAlign(chrono::ChForce::WORLD_DIR);
+		body->AddForce(load);
+		load->SetVrelpoint(chrono::VNULL);
+		load->SetMforce(0);
+		return load;
+	}
+
+	void SetWorldLoad(chrono::ChForce& load, const chrono::ChVector<>& vector)
+	{
+		double magnitude = vector.Length();
+		if (magnitude > 0) {
+			load.SetDir(vector / magnitude);
+		}
+		load.SetMforce(magnitude);
+	}
+}
+
+FChParallelSCMSoil::~FChParallelSCMSoil()
+{
+	Release();
+}
+
+void FChParallelSCMSoil::Initialize(const std::vector<chrono::ChVector<>>& inVertices, const std::vector<chrono::ChVector<int>>& faces, int32 divX, int32 divY,
+	const FChSCMSoilParameters& parameters)
+{
+	Release();
+	params = parameters;
+	vertexX = divX + 1;
+	vertexY = divY + 1;
+	check(vertexX >= 2 && vertexY >= 2 && (int32)inVertices.size() == vertexX * vertexY);
+	cellX = FMath::DivideAndRoundUp(vertexX, CellVertices);
+	cellY = FMath::DivideAndRoundUp(vertexY, CellVertices);
+
+	vertices = inVertices;
+	int32 vertexNum = (int32)vertices.size();
+	levelInitial.resize(vertexNum);
+	minX = maxX = vertices[0].x();
+	minZ = maxZ = vertices[0].z();
+	maxLevel = vertices[0].y();
+	for (int32 i = 0; i < vertexNum; i++) {
+		const chrono::ChVector<>& vertex = vertices[i];
+		levelInitial[i] = vertex.y();
+		minX = FMath::Min(minX, vertex.x());
+		maxX = FMath::Max(maxX, vertex.x());
+		minZ = FMath::Min(minZ, vertex.z());
+		maxZ = FMath::Max(maxZ, vertex.z());
+		maxLevel = FMath::Max(maxLevel, vertex.y());
+	}
+
+	// Grid coordinates of a point are the inverse of the two steps applied to its offset from vertex 0
+	originX = vertices[0].x();
+	originZ = vertices[0].z();
+	double stepIX = vertices[1].x() - originX;
+	double stepIZ = vertices[1].z() - originZ;
+	double stepJX = vertices[vertexX].x() - originX;
+	double stepJZ = vertices[vertexX].z() - originZ;
+	double determinant = stepIX * stepJZ - stepJX * stepIZ;
+	check(determinant != 0);
+	inverse[0] = stepJZ / determinant;
+	inverse[1] = -stepJX / determinant;
+	inverse[2] = -stepIZ / determinant;
+	inverse[3] = stepIX / determinant;
+
+	// A third of the projected area of each face around the vertex
+	area.assign(vertexNum, 0.0);
+	for (const chrono::ChVector<int>& face : faces) {
+		const chrono::ChVector<>& a = vertices[face.x()];
+		chrono::ChVector<> ab = vertices[face.y()] - a;
+		chrono::ChVector<> ac = vertices[face.z()] - a;
+		double third = std::fabs(ab.z() * ac.x() - ab.x() * ac.z()) / 6.0;
+		area[face.x()] += third;
+		area[face.y()] += third;
+		area[face.z()] += third;
+	}
+
+	sinkagePlastic.assign(vertexNum, 0.0);
+	kShear.assign(vertexNum, 0.0);
+	touched.assign(vertexNum, 0);
+	hitCandidate.assign(vertexNum, INDEX_NONE);
+	hitLevel.assign(vertexNum, 0.0);
+	cellCandidates.Reset();
+	cellCandidates.SetNum(cellX * cellY);
+	cellTouched.assign(cellX * cellY, 0);
+	activeCells.Reset();
+	leafCache.Reset();
+	touchedNum = 0;
+}
+
+void FChParallelSCMSoil::Release()
+{
+	for (const FLoad& load : loads) {
+		load.Body->RemoveForce(load.Force);
+		load.Body->RemoveForce(load.Torque);
+	}
+	loads.Reset();
+	loadIndices.Reset();
+	candidates.Reset();
+	leafPoses.Reset();
+}
+
+int32 FChParallelSCMSoil::FindLoad(const std::shared_ptr<chrono::ChBody>& body)
+{
+	if (int32* index = loadIndices.Find(body.get())) {
+		return *index;
+	}
+	int32 index = loads.Add({ body, AddWorldLoad(body.get(), chrono::ChForce::FORCE), AddWorldLoad(body.get(), chrono::ChForce::TORQUE) });
+	loadIndices.Add(body.get(), index);
+	return index;
+}
+
+const TArray<FChParallelSCMSoil::FLeaf>& FChParallelSCMSoil::FindLeaves(const btCollisionShape* root)
+{
+	if (const TArray<FLeaf>* cached = leafCache.Find(root)) {
+		return *cached;
+	}
+	TArray<FLeaf>& leaves = leafCache.Add(root);
+	// rayTestSingle swaps the object's shape while it walks a compound, so the children are tested one by one instead
+	TArray<TPair<const btCollisionShape*, btTransform>> pending;
+	pending.Add(TPair<const btCollisionShape*, btTransform>(root, btTransform::getIdentity()));
+	while (pending.Num() > 0) {
+		TPair<const btCollisionShape*, btTransform> entry = pending.Pop(false);
+		if (entry.Key->getShapeType() == COMPOUND_SHAPE_PROXYTYPE) {
+			auto compound = static_cast<const btCompoundShape*>(entry.Key);
+			for (int32 i = compound->getNumChildShapes() - 1; i >= 0; i--) {
+				pending.Add(TPair<const btCollisionShape*, btTransform>(compound->getChildShape(i), entry.Value * compound->getChildTransform(i)));
+			}
+		}
+		// Its ray test writes to the shape's own box set
+		else if (!IsGImpactShape(entry.Key)) {
+			FLeaf leaf;
+			leaf.Shape = entry.Key;
+			ToArray(entry.Value, leaf.Transform);
+			leaves.Add(leaf);
+		}
+	}
+	return leaves;
+}
+
+void FChParallelSCMSoil::GatherCandidates(chrono::ChSystem* system)
+{
+	candidates.Reset();
+	leafPoses.Reset();
+	for (auto& body : system->Get_bodylist()) {
+		if (!body->GetCollide() || body->GetBodyFixed()) {
+			continue;
+		}
+		auto model = dynamic_cast<chrono::collision::ChModelBullet*>(body->GetCollisionModel().get());
+		btCollisionObject* object = model ? model->GetBulletModel() : nullptr;
+		if (!object || !object->getCollisionShape()) {
+			continue;
+		}
+
+		// The collision model sits on the reference frame
+		const chrono::ChFrameMoving<>& frame = body->GetFrame_REF_to_abs();
+		const chrono::ChVector<>& pos = frame.GetPos();
+		const chrono::ChQuaternion<>& rot = frame.GetRot();
+		btTransform world(btQuaternion((btScalar)rot.e1(), (btScalar)rot.e2(), (btScalar)rot.e3(), (btScalar)rot.e0()),
+			btVector3((btScalar)pos.x(), (btScalar)pos.y(), (btScalar)pos.z()));
+		const btCollisionShape* root = object->getCollisionShape();
+		btVector3 rootMin, rootMax;
+		root->getAabb(world, rootMin, rootMax);
+		if (rootMax.x() < minX || rootMin.x() > maxX || rootMax.z() < minZ || rootMin.z() > maxZ
+			|| rootMin.y() > maxLevel + params.TestHighOffset) {
+			continue;
+		}
+		const TArray<FLeaf>& leaves = FindLeaves(root);
+		if (leaves.Num() == 0) {
+			continue;
+		}
+
+		FCandidate candidate;
+		candidate.Body = body.get();
+		candidate.Object = object;
+		candidate.FirstLeaf = leafPoses.Num();
+		candidate.LeafNum = leaves.Num();
+		candidate.Load = FindLoad(body);
+		for (const FLeaf& leaf : leaves) {
+			FLeafPose& pose = leafPoses.AddDefaulted_GetRef();
+			btTransform leafWorld = world * FromArray(leaf.Transform);
+			pose.Shape = leaf.Shape;
+			ToArray(leafWorld, pose.Transform);
+			btVector3 leafMin, leafMax;
+			leaf.Shape->getAabb(leafWorld, leafMin, leafMax);
+			for (int32 k = 0; k < 3; k++) {
+				pose.Min[k] = leafMin[k];
+				pose.Max[k] = leafMax[k];
+			}
+		}
+		candidates.Add(candidate);
+	}
+}
+
+bool FChParallelSCMSoil::GridRange(double boxMinX, double boxMinZ, double boxMaxX, double boxMaxZ, int32& outCellX0, int32& outCellY0, int32& outCellX1, int32& outCellY1) const
+{
+	// The grid may be turned, so all four corners go through the inverse
+	double minI = DBL_MAX, minJ = DBL_MAX, maxI = -DBL_MAX, maxJ = -DBL_MAX;
+	const double cornerX[4] = { boxMinX, boxMaxX, boxMinX, boxMaxX };
+	const double cornerZ[4] = { boxMinZ, boxMinZ, boxMaxZ, boxMaxZ };
+	for (int32 k = 0; k < 4; k++) {
+		double dx = cornerX[k] - originX;
+		double dz = cornerZ[k] - originZ;
+		double i = inverse[0] * dx + inverse[1] * dz;
+		double j = inverse[2] * dx + inverse[3] * dz;
+		minI = FMath::Min(minI, i);
+		maxI = FMath::Max(maxI, i);
+		minJ = FMath::Min(minJ, j);
+		maxJ = FMath::Max(maxJ, j);
+	}
+	if (maxI < 0 || maxJ < 0 || minI > vertexX - 1 || minJ > vertexY - 1) {
+		return false;
+	}
+	outCellX0 = FMath::Clamp((int32)FMath::FloorToDouble(minI), 0, vertexX - 1) / CellVertices;
+	outCellX1 = FMath::Clamp((int32)FMath::CeilToDouble(maxI), 0, vertexX - 1) / CellVertices;
+	outCellY0 = FMath::Clamp((int32)FMath::FloorToDouble(minJ), 0, vertexY - 1) / CellVertices;
+	outCellY1 = FMath::Clamp((int32)FMath::CeilToDouble(maxJ), 0, vertexY - 1) / CellVertices;
+	return true;
+}
+
+void FChParallelSCMSoil::BinCandidates()
+{
+	for (TArray<int32>& list : cellCandidates) {
+		list.Reset();
+	}
+	for (int32 c = 0; c < candidates.Num(); c++) {
+		const FCandidate& candidate = candidates[c];
+		double boxMinX = DBL_MAX, boxMinZ = DBL_MAX, boxMaxX = -DBL_MAX, boxMaxZ = -DBL_MAX;
+		for (int32 l = candidate.FirstLeaf; l < candidate.FirstLeaf + candidate.LeafNum; l++) {
+			boxMinX = FMath::Min(boxMinX, leafPoses[l].Min[0]);
+			boxMinZ = FMath::Min(boxMinZ, leafPoses[l].Min[2]);
+			boxMaxX = FMath::Max(boxMaxX, leafPoses[l].Max[0]);
+			boxMaxZ = FMath::Max(boxMaxZ, leafPoses[l].Max[2]);
+		}
+		int32 x0, y0, x1, y1;
+		if (!GridRange(boxMinX, boxMinZ, boxMaxX, boxMaxZ, x0, y0, x1, y1)) {
+			continue;
+		}
+		for (int32 y = y0; y <= y1; y++) {
+			for (int32 x = x0; x <= x1; x++) {
+				cellCandidates[y * cellX + x].Add(c);
+			}
+		}
+	}
+
+	// Cells touched last step stay active so their vertices can spring back
+	activeCells.Reset();
+	for (int32 cell = 0; cell < cellCandidates.Num(); cell++) {
+		if (cellCandidates[cell].Num() > 0 || cellTouched[cell]) {
+			activeCells.Add(cell);
+		}
+	}
+}
+
+int32 FChParallelSCMSoil::CastVertex(int32 vertex, const TArray<int32>& cellList, double& outHitLevel) const
+{
+	double x = vertices[vertex].x();
+	double z = vertices[vertex].z();
+	double rest = levelInitial[vertex] - sinkagePlastic[vertex];
+	double fromY = rest - TestLowOffset;
+	double toY = rest + params.TestHighOffset;
+	btVector3 from((btScalar)x, (btScalar)fromY, (btScalar)z);
+	btVector3 to((btScalar)x, (btScalar)toY, (btScalar)z);
+	btTransform fromTransform(btQuaternion::getIdentity(), from);
+	btTransform toTransform(btQuaternion::getIdentity(), to);
+
+	int32 best = INDEX_NONE;
+	outHitLevel = toY;
+	for (int32 c : cellList) {
+		const FCandidate& candidate = candidates[c];
+		for (int32 l = candidate.FirstLeaf; l < candidate.FirstLeaf + candidate.LeafNum; l++) {
+			const FLeafPose& pose = leafPoses[l];
+			if (x < pose.Min[0] || x > pose.Max[0] || z < pose.Min[2] || z > pose.Max[2]
+				|| pose.Max[1] < fromY || pose.Min[1] > outHitLevel) {
+				continue;
+			}
+			btCollisionWorld::ClosestRayResultCallback result(from, to);
+			btCollisionWorld::rayTestSingle(fromTransform, toTransform, candidate.Object, pose.Shape, FromArray(pose.Transform), result);
+			if (result.hasHit()) {
+				double level = fromY + result.m_closestHitFraction * (toY - fromY);
+				if (level < outHitLevel) {
+					outHitLevel = level;
+					best = c;
+				}
+			}
+		}
+	}
+	return best;
+}
+
+void FChParallelSCMSoil::SolveVertex(int32 vertex, int32 candidate, double level, double stepSize, const TArray<double>& bekkerWidths, FAccumulator* taskAccumulators)
+{
+	// A body above the level the soil springs back to leaves it
+	double rest = levelInitial[vertex] - sinkagePlastic[vertex];
+	if (candidate == INDEX_NONE || level >= rest) {
+		if (touched[vertex]) {
+			vertices[vertex].y() = rest;
+			kShear[vertex] = 0;
+			touched[vertex] = 0;
+		}
+		return;
+	}
+
+	const FCandidate& hit = candidates[candidate];
+	chrono::ChVector<> point(vertices[vertex].x(), level, vertices[vertex].z());
+	vertices[vertex].y() = level;
+	touched[vertex] = 1;
+
+	chrono::ChVector<> speed = hit.Body->GetContactPointSpeed(point);
+	chrono::ChVector<> tangent(speed.x(), 0, speed.z());
+	double tangentSpeed = tangent.Length();
+	kShear[vertex] += tangentSpeed * stepSize;
+
+	// Elastic up to the Bekker curve, plastic along it
+	double sinkage = levelInitial[vertex] - level;
+	double width = FMath::Max(bekkerWidths[candidate], 1e-6);
+	double bekker = (params.BekkerKc / width + params.BekkerKphi) * std::pow(sinkage, params.BekkerN);
+	double sigma = params.ElasticK * (sinkage - sinkagePlastic[vertex]);
+	if (sigma > bekker) {
+		sigma = bekker;
+		sinkagePlastic[vertex] = sinkage - sigma / params.ElasticK;
+	}
+	sigma = FMath::Max(0.0, sigma - speed.y() * params.DampingR);
+
+	double tauMax = params.MohrCohesion + sigma * std::tan(FMath::DegreesToRadians(params.MohrFriction));
+	double tau = params.JanosiShear > 0 ? tauMax * (1.0 - std::exp(-kShear[vertex] / params.JanosiShear)) : tauMax;
+
+	chrono::ChVector<> force(0, sigma * area[vertex], 0);
+	if (tangentSpeed > 1e-9) {
+		force -= tangent * (tau * area[vertex] / tangentSpeed);
+	}
+	FAccumulator& accumulator = taskAccumulators[candidate];
+	accumulator.Force += force;
+	accumulator.Torque += (point - hit.Body->GetPos()) % force;
+}
+
+void FChParallelSCMSoil::Step(chrono::ChSystem* system, double stepSize)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChronoSCMSoil);
+	if (!system || stepSize <= 0 || vertices.empty()) {
+		return;
+	}
+
+	// Bodies gone from the system let go of their loads
+	for (int32 i = loads.Num() - 1; i >= 0; i--) {
+		if (loads[i].Body->GetSystem() != system) {
+			loads[i].Body->RemoveForce(loads[i].Force);
+			loads[i].Body->RemoveForce(loads[i].Torque);
+			loads.RemoveAtSwap(i, 1, false);
+		}
+	}
+	loadIndices.Reset();
+	for (int32 i = 0; i < loads.Num(); i++) {
+		loadIndices.Add(loads[i].Body.get(), i);
+	}
+
+	GatherCandidates(system);
+	BinCandidates();
+
+	int32 candidateNum = candidates.Num();
+	int32 taskNum = FMath::DivideAndRoundUp(activeCells.Num(), CellsPerTask);
+	accumulators.Reset();
+	accumulators.SetNum(taskNum * candidateNum);
+	TArray<int32> taskTouched;
+	taskTouched.SetNumZeroed(taskNum);
+
+	auto forTaskVertices = [this](int32 task, auto&& visit) {
+		int32 last = FMath::Min((task + 1) * CellsPerTask, activeCells.Num());
+		for (int32 a = task * CellsPerTask; a < last; a++) {
+			int32 cell = activeCells[a];
+			int32 x0 = (cell % cellX) * CellVertices;
+			int32 y0 = (cell / cellX) * CellVertices;
+			int32 x1 = FMath::Min(x0 + CellVertices, vertexX);
+			int32 y1 = FMath::Min(y0 + CellVertices, vertexY);
+			for (int32 y = y0; y < y1; y++) {
+				for (int32 x = x0; x < x1; x++) {
+					visit(cell, y * vertexX + x);
+				}
+			}
+		}
+	};
+
+	// First pass finds the hits and the contact area of each body, which the Bekker width needs
+	ParallelFor(taskNum, [&](int32 task) {
+		FAccumulator* taskAccumulators = accumulators.GetData() + task * candidateNum;
+		const TArray<int32>* cellList = nullptr;
+		int32 listCell = INDEX_NONE;
+		forTaskVertices(task, [&](int32 cell, int32 vertex) {
+			if (cell != listCell) {
+				cellList = &cellCandidates[cell];
+				listCell = cell;
+			}
+			int32 candidate = cellList->Num() > 0 ? CastVertex(vertex, *cellList, hitLevel[vertex]) : INDEX_NONE;
+			hitCandidate[vertex] = candidate;
+			if (candidate != INDEX_NONE && hitLevel[vertex] < levelInitial[vertex] - sinkagePlastic[vertex]) {
+				taskAccumulators[candidate].Area += area[vertex];
+			}
+		});
+	}, taskNum < 2);
+
+	TArray<double> bekkerWidths;
+	bekkerWidths.SetNumZeroed(candidateNum);
+	for (int32 task = 0; task < taskNum; task++) {
+		for (int32 c = 0; c < candidateNum; c++) {
+			bekkerWidths[c] += accumulators[task * candidateNum + c].Area;
+		}
+	}
+	for (double& width : bekkerWidths) {
+		width = 0.5 * std::sqrt(width);
+	}
+
+	// Each cell belongs to one task, so the vertex and cell writes don't overlap
+	ParallelFor(taskNum, [&](int32 task) {
+		FAccumulator* taskAccumulators = accumulators.GetData() + task * candidateNum;
+		int32 touchedCell = INDEX_NONE;
+		forTaskVertices(task, [&](int32 cell, int32 vertex) {
+			if (cell != touchedCell) {
+				cellTouched[cell] = 0;
+				touchedCell = cell;
+			}
+			SolveVertex(vertex, hitCandidate[vertex], hitLevel[vertex], stepSize, bekkerWidths, taskAccumulators);
+			if (touched[vertex]) {
+				cellTouched[cell] = 1;
+				taskTouched[task]++;
+			}
+		});
+	}, taskNum < 2);
+
+	// Loads of bodies off the soil this step go to zero
+	TArray<chrono::ChVector<>> loadForces;
+	TArray<chrono::ChVector<>> loadTorques;
+	loadForces.SetNum(loads.Num());
+	loadTorques.SetNum(loads.Num());
+	touchedNum = 0;
+	for (int32 task = 0; task < taskNum; task++) {
+		touchedNum += taskTouched[task];
+		for (int32 c = 0; c < candidateNum; c++) {
+			const FAccumulator& accumulator = accumulators[task * candidateNum + c];
+			loadForces[candidates[c].Load] += accumulator.Force;
+			loadTorques[candidates[c].Load] += accumulator.Torque;
+		}
+	}
+	for (int32 i = 0; i < loads.Num(); i++) {
+		SetWorldLoad(*loads[i].Force, loadForces[i]);
+		SetWorldLoad(*loads[i].Torque, loadTorques[i]);
+	}
+
+	SET_DWORD_STAT(STAT_ChronoSCMTouchedVertices, touchedNum);
+	SET_DWORD_STAT(STAT_ChronoSCMActiveCells, activeCells.Num());
+}
@@ -0,0 +1,21 @@
+#include "ChParameterSweep.h"
+#include "JsonObjectConverter.h"
+#include "Misc/FileHelper.h"
+
+bool ChParameterSweep::LoadVariants(const FString& filePath, TArray<FChSweepVariant>& outVariants)
+{
+	outVariants.Reset();
+	FString jsonData;
+	if (!FFileHelper::LoadFileToString(jsonData, *filePath)) {
+		return false;
+	}
+	if (!FJsonObjectConverter::JsonArrayStringToUStruct(jsonData, &outVariants, 0, 0)) {
+		return false;
+	}
+	for (int32 i = 0; i < outVariants.Num(); i++) {
+		if (outVariants[i].Name.IsEmpty()) {
+			outVariants[i].Name = FString::Printf(TEXT("Variant%d"), i);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,556 @@
+#include "ChParticleCloud.h"
+#include "chrono/physics/ChMaterialSurfaceNSC.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+#include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "Async/ParallelFor.h"
+#include <cmath>
+
+namespace {
+	// Grains per task of the pair search
+	const int32 PairChunkSize = 4096;
+
+	FORCEINLINE uint32 HashCell(int32 x, int32 y, int32 z, uint32 cellMask)
+	{
+		return ((uint32)x * 73856093u ^ (uint32)y * 19349663u ^ (uint32)z * 83492791u) & cellMask;
+	}
+
+	FORCEINLINE int32 CellOf(double coordinate, double invCell)
+	{
+		return (int32)FMath::FloorToDouble(coordinate * invCell);
+	}
+
+	FORCEINLINE chrono::ChVector<> ToChVector(const btVector3& v)
+	{
+		return chrono::ChVector<>(v.x(), v.y(), v.z());
+	}
+
+	// Every manifold point between the query sphere and the world, the points are on the inflated shapes
+	struct FWorldContactCallback : public btCollisionWorld::ContactResultCallback
+	{
+		const btCollisionObject* query;
+		chrono::collision::ChCollisionModel* grainModel;
+		chrono::ChVector<> center;
+		double radius;
+		double envelope;
+		std::vector<chrono::collision::ChCollisionInfo>* contacts;
+
+		virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObject* colObj0, int partId0, int index0, const btCollisionObject* colObj1, int partId1, int index1) override
+		{
+			bool bQueryFirst = colObj0 == query;
+			const btCollisionObject* other = bQueryFirst ? colObj1 : colObj0;
+			auto* otherModel = static_cast<chrono::collision::ChModelBullet*>(other->getUserPointer());
+			if (!otherModel || !otherModel->GetContactable()) {
+				return 0;
+			}
+			// The world shape is A, the normal points from it to the grain
+			chrono::ChVector<> normal = ToChVector(cp.m_normalWorldOnB);
+			if (!bQueryFirst) {
+				normal = -normal;
+			}
+			chrono::ChVector<> otherPoint = ToChVector(bQueryFirst ? cp.getPositionWorldOnB() : cp.getPositionWorldOnA());
+			double otherEnvelope = otherModel->GetEnvelope();
+
+			chrono::collision::ChCollisionInfo contact;
+			contact.modelA = otherModel;
+			contact.modelB = grainModel;
+			contact.vN = normal;
+			contact.vpA = otherPoint - normal * otherEnvelope;
+			contact.vpB = center - normal * radius;
+			contact.distance = cp.getDistance() + otherEnvelope + envelope;
+			contact.eff_radius = radius;
+			contact.reaction_cache = nullptr;
+			contacts->push_back(contact);
+			return 0;
+		}
+	};
+}
+
+void FChCloudCollisionModel::GetAABB(chrono::ChVector<>& bbmin, chrono::ChVector<>& bbmax) const
+{
+	chrono::ChVector<> reach(Cloud->radius + Cloud->envelope);
+	bbmin = Cloud->positions[Index] - reach;
+	bbmax = Cloud->positions[Index] + reach;
+}
+
+chrono::ChPhysicsItem* FChCloudCollisionModel::GetPhysicsItem()
+{
+	return Cloud;
+}
+
+chrono::ChVariables* FChCloudParticle::GetVariables1()
+{
+	return &Cloud->variables[Index];
+}
+
+void FChCloudParticle::ContactableGetStateBlock_x(chrono::ChState& x)
+{
+	x.PasteVector(Cloud->positions[Index], 0, 0);
+	x.PasteQuaternion(Cloud->rotations[Index], 3, 0);
+}
+
+void FChCloudParticle::ContactableGetStateBlock_w(chrono::ChStateDelta& w)
+{
+	w.PasteVector(Cloud->velocities[Index], 0, 0);
+	w.PasteVector(Cloud->angularVelocities[Index], 3, 0);
+}
+
+void FChCloudParticle::ContactableIncrementState(const chrono::ChState& x, const chrono::ChStateDelta& dw, chrono::ChState& x_new)
+{
+	x_new.PasteVector(x.ClipVector(0, 0) + dw.ClipVector(0, 0), 0, 0);
+	x_new.PasteQuaternion(FChParticleCloud::IncrementRotation(x.ClipQuaternion(3, 0), dw.ClipVector(3, 0)), 3, 0);
+}
+
+std::shared_ptr<chrono::ChMaterialSurface>& FChCloudParticle::GetMaterialSurfaceBase()
+{
+	return Cloud->material;
+}
+
+chrono::ChVector<> FChCloudParticle::GetContactPoint(const chrono::ChVector<>& loc_point, const chrono::ChState& state_x)
+{
+	chrono::ChCoordsys<> csys = state_x.ClipCoordsys(0, 0);
+	return csys.TransformPointLocalToParent(loc_point);
+}
+
+chrono::ChVector<> FChCloudParticle::GetContactPointSpeed(const chrono::ChVector<>& loc_point, const chrono::ChState& state_x, const chrono::ChStateDelta& state_w)
+{
+	chrono::ChCoordsys<> csys = state_x.ClipCoordsys(0, 0);
+	return state_w.ClipVector(0, 0) + csys.rot.Rotate(chrono::Vcross(state_w.ClipVector(3, 0), loc_point));
+}
+
+chrono::ChVector<> FChCloudParticle::GetContactPointSpeed(const chrono::ChVector<>& abs_point)
+{
+	const chrono::ChQuaternion<>& rotation = Cloud->rotations[Index];
+	chrono::ChVector<> local = rotation.RotateBack(abs_point - Cloud->positions[Index]);
+	return Cloud->velocities[Index] + rotation.Rotate(chrono::Vcross(Cloud->angularVelocities[Index], local));
+}
+
+chrono::ChCoordsys<> FChCloudParticle::GetCsysForCollisionModel()
+{
+	return chrono::ChCoordsys<>(Cloud->positions[Index], Cloud->rotations[Index]);
+}
+
+void FChCloudParticle::ContactForceLoadResidual_F(const chrono::ChVector<>& F, const chrono::ChVector<>& abs_point, chrono::ChVectorDynamic<>& R)
+{
+	const chrono::ChQuaternion<>& rotation = Cloud->rotations[Index];
+	chrono::ChVector<> local = rotation.RotateBack(abs_point - Cloud->positions[Index]);
+	chrono::ChVector<> torque = chrono::Vcross(local, rotation.RotateBack(F));
+	int offset = Cloud->variables[Index].GetOffset();
+	R.PasteSumVector(F, offset, 0);
+	R.PasteSumVector(torque, offset + 3, 0);
+}
+
+void FChCloudParticle::ContactForceLoadQ(const chrono::ChVector<>& F, const chrono::ChVector<>& point, const chrono::ChState& state_x, chrono::ChVectorDynamic<>& Q, int offset)
+{
+	chrono::ChCoordsys<> csys = state_x.ClipCoordsys(0, 0);
+	chrono::ChVector<> local = csys.TransformPointParentToLocal(point);
+	chrono::ChVector<> torque = chrono::Vcross(local, csys.TransformDirectionParentToLocal(F));
+	Q.PasteVector(F, offset, 0);
+	Q.PasteVector(torque, offset + 3, 0);
+}
+
+void FChCloudParticle::ComputeJacobianForContactPart(const chrono::ChVector<>& abs_point, chrono::ChMatrix33<>& contact_plane,
+	type_constraint_tuple& jacobian_tuple_N, type_constraint_tuple& jacobian_tuple_U, type_constraint_tuple& jacobian_tuple_V, bool second)
+{
+	// Same rows as ChBody, translation by the contact plane and rotation through the lever in the grain frame
+	const chrono::ChQuaternion<>& rotation = Cloud->rotations[Index];
+	chrono::ChVector<> local = rotation.RotateBack(abs_point - Cloud->positions[Index]);
+	chrono::ChMatrix33<> Jx1, Jr1, Ps1, Jtemp;
+	Ps1.Set_X_matrix(local);
+	Jx1.CopyFromMatrixT(contact_plane);
+	if (!second) {
+		Jx1.MatrNeg();
+	}
+	Jtemp.MatrMultiply(chrono::ChMatrix33<>(rotation), Ps1);
+	Jr1.MatrTMultiply(contact_plane, Jtemp);
+	if (second) {
+		Jr1.MatrNeg();
+	}
+	jacobian_tuple_N.Get_Cq()->PasteClippedMatrix(Jx1, 0, 0, 1, 3, 0, 0);
+	jacobian_tuple_U.Get_Cq()->PasteClippedMatrix(Jx1, 1, 0, 1, 3, 0, 0);
+	jacobian_tuple_V.Get_Cq()->PasteClippedMatrix(Jx1, 2, 0, 1, 3, 0, 0);
+	jacobian_tuple_N.Get_Cq()->PasteClippedMatrix(Jr1, 0, 0, 1, 3, 0, 3);
+	jacobian_tuple_U.Get_Cq()->PasteClippedMatrix(Jr1, 1, 0, 1, 3, 0, 3);
+	jacobian_tuple_V.Get_Cq()->PasteClippedMatrix(Jr1, 2, 0, 1, 3, 0, 3);
+}
+
+double FChCloudParticle::GetContactableMass()
+{
+	return Cloud->sharedMass.GetBodyMass();
+}
+
+chrono::ChPhysicsItem* FChCloudParticle::GetPhysicsItem()
+{
+	return Cloud;
+}
+
+FChParticleCloud::FChParticleCloud()
+	: material(std::make_shared<chrono::ChMaterialSurfaceNSC>())
+{
+	SetDensity(1000);
+}
+
+FChParticleCloud::FChParticleCloud(const FChParticleCloud& other)
+	: chrono::ChPhysicsItem(other)
+	, positions(other.positions)
+	, rotations(other.rotations)
+	, velocities(other.velocities)
+	, angularVelocities(other.angularVelocities)
+	, accelerations(other.accelerations)
+	, angularAccelerations(other.angularAccelerations)
+	, sharedMass(other.sharedMass)
+	, variables(other.positions.size())
+	, contactables(other.positions.size())
+	, models(other.positions.size())
+	, material(other.material)
+	, radius(other.radius)
+	, density(other.density)
+	, envelope(other.envelope)
+	, family(other.family)
+	, bCollideWithWorld(other.bCollideWithWorld)
+{
+	BindElements();
+}
+
+void FChParticleCloud::SetParticles(const std::vector<chrono::ChVector<>>& inPositions)
+{
+	size_t count = inPositions.size();
+	positions = inPositions;
+	rotations.assign(count, chrono::QUNIT);
+	velocities.assign(count, chrono::VNULL);
+	angularVelocities.assign(count, chrono::VNULL);
+	accelerations.assign(count, chrono::VNULL);
+	angularAccelerations.assign(count, chrono::VNULL);
+	// Built in place, a resize would copy the variables
+	variables = std::vector<chrono::ChVariablesBodySharedMass>(count);
+	contactables = std::vector<FChCloudParticle>(count);
+	models = std::vector<FChCloudCollisionModel>(count);
+	BindElements();
+}
+
+void FChParticleCloud::BindElements()
+{
+	for (size_t i = 0; i < positions.size(); i++) {
+		variables[i].SetSharedMass(&sharedMass);
+		contactables[i].Cloud = this;
+		contactables[i].Index = (int32)i;
+		models[i].Cloud = this;
+		models[i].Index = (int32)i;
+		models[i].SetContactable(&contactables[i]);
+	}
+}
+
+void FChParticleCloud::SetRadius(double inRadius)
+{
+	radius = inRadius;
+	SetDensity(density);
+}
+
+void FChParticleCloud::SetDensity(double inDensity)
+{
+	density = inDensity;
+	double mass = density * 4.0 / 3.0 * PI * radius * radius * radius;
+	double inertia = 0.4 * mass * radius * radius;
+	sharedMass.SetBodyMass(mass);
+	sharedMass.SetBodyInertia(chrono::ChMatrix33<>(chrono::ChVector<>(inertia, inertia, inertia)));
+}
+
+chrono::ChQuaternion<> FChParticleCloud::IncrementRotation(const chrono::ChQuaternion<>& rotation, const chrono::ChVector<>& localRotation)
+{
+	chrono::ChVector<> absolute = rotation.Rotate(localRotation);
+	double angle = absolute.Length();
+	if (angle < 1e-30) {
+		return rotation;
+	}
+	chrono::ChQuaternion<> delta;
+	delta.Q_from_AngAxis(angle, absolute / angle);
+	chrono::ChQuaternion<> result = delta % rotation;
+	result.Normalize();
+	return result;
+}
+
+void FChParticleCloud::GetForces(int32 i, chrono::ChVector<>& outForce, chrono::ChVector<>& outTorque) const
+{
+	chrono::ChVector<> gravity = GetSystem() ? GetSystem()->Get_G_acc() : chrono::VNULL;
+	outForce = gravity * sharedMass.GetBodyMass();
+	const chrono::ChVector<>& w = angularVelocities[i];
+	outTorque = -chrono::Vcross(w, sharedMass.GetBodyInertia() * w);
+}
+
+void FChParticleCloud::IntStateGather(const unsigned int off_x, chrono::ChState& x, const unsigned int off_v, chrono::ChStateDelta& v, double& T)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		x.PasteVector(positions[i], off_x + 7 * i, 0);
+		x.PasteQuaternion(rotations[i], off_x + 7 * i + 3, 0);
+		v.PasteVector(velocities[i], off_v + 6 * i, 0);
+		v.PasteVector(angularVelocities[i], off_v + 6 * i + 3, 0);
+	}
+	T = GetChTime();
+}
+
+void FChParticleCloud::IntStateScatter(const unsigned int off_x, const chrono::ChState& x, const unsigned int off_v, const chrono::ChStateDelta& v, const double T)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		positions[i] = x.ClipVector(off_x + 7 * i, 0);
+		rotations[i] = x.ClipQuaternion(off_x + 7 * i + 3, 0);
+		velocities[i] = v.ClipVector(off_v + 6 * i, 0);
+		angularVelocities[i] = v.ClipVector(off_v + 6 * i + 3, 0);
+	}
+	SetChTime(T);
+	Update(T);
+}
+
+void FChParticleCloud::IntStateGatherAcceleration(const unsigned int off_a, chrono::ChStateDelta& a)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		a.PasteVector(accelerations[i], off_a + 6 * i, 0);
+		a.PasteVector(angularAccelerations[i], off_a + 6 * i + 3, 0);
+	}
+}
+
+void FChParticleCloud::IntStateScatterAcceleration(const unsigned int off_a, const chrono::ChStateDelta& a)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		accelerations[i] = a.ClipVector(off_a + 6 * i, 0);
+		angularAccelerations[i] = a.ClipVector(off_a + 6 * i + 3, 0);
+	}
+}
+
+void FChParticleCloud::IntStateIncrement(const unsigned int off_x, chrono::ChState& x_new, const chrono::ChState& x, const unsigned int off_v, const chrono::ChStateDelta& Dv)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		unsigned int px = off_x + 7 * i;
+		unsigned int pv = off_v + 6 * i;
+		x_new.PasteVector(x.ClipVector(px, 0) + Dv.ClipVector(pv, 0), px, 0);
+		x_new.PasteQuaternion(IncrementRotation(x.ClipQuaternion(px + 3, 0), Dv.ClipVector(pv + 3, 0)), px + 3, 0);
+	}
+}
+
+void FChParticleCloud::IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		chrono::ChVector<> force, torque;
+		GetForces(i, force, torque);
+		R.PasteSumVector(force * c, off + 6 * i, 0);
+		R.PasteSumVector(torque * c, off + 6 * i + 3, 0);
+	}
+}
+
+void FChParticleCloud::IntLoadResidual_Mv(const unsigned int off, chrono::ChVectorDynamic<>& R, const chrono::ChVectorDynamic<>& w, const double c)
+{
+	double mass = sharedMass.GetBodyMass();
+	const chrono::ChMatrix33<>& inertia = sharedMass.GetBodyInertia();
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		R.PasteSumVector(w.ClipVector(off + 6 * i, 0) * (mass * c), off + 6 * i, 0);
+		R.PasteSumVector((inertia * w.ClipVector(off + 6 * i + 3, 0)) * c, off + 6 * i + 3, 0);
+	}
+}
+
+void FChParticleCloud::IntToDescriptor(const unsigned int off_v, const chrono::ChStateDelta& v, const chrono::ChVectorDynamic<>& R,
+	const unsigned int off_L, const chrono::ChVectorDynamic<>& L, const chrono::ChVectorDynamic<>& Qc)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		variables[i].Get_qb().PasteClippedMatrix(v, off_v + 6 * i, 0, 6, 1, 0, 0);
+		variables[i].Get_fb().PasteClippedMatrix(R, off_v + 6 * i, 0, 6, 1, 0, 0);
+	}
+}
+
+void FChParticleCloud::IntFromDescriptor(const unsigned int off_v, chrono::ChStateDelta& v, const unsigned int off_L, chrono::ChVectorDynamic<>& L)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		v.PasteMatrix(variables[i].Get_qb(), off_v + 6 * i, 0);
+	}
+}
+
+void FChParticleCloud::InjectVariables(chrono::ChSystemDescriptor& descriptor)
+{
+	for (auto& grainVariables : variables) {
+		grainVariables.SetDisabled(false);
+		descriptor.InsertVariables(&grainVariables);
+	}
+}
+
+void FChParticleCloud::VariablesFbReset()
+{
+	for (auto& grainVariables : variables) {
+		grainVariables.Get_fb().FillElem(0);
+	}
+}
+
+void FChParticleCloud::VariablesFbLoadForces(double factor)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		chrono::ChVector<> force, torque;
+		GetForces(i, force, torque);
+		variables[i].Get_fb().PasteSumVector(force * factor, 0, 0);
+		variables[i].Get_fb().PasteSumVector(torque * factor, 3, 0);
+	}
+}
+
+void FChParticleCloud::VariablesQbLoadSpeed()
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		variables[i].Get_qb().PasteVector(velocities[i], 0, 0);
+		variables[i].Get_qb().PasteVector(angularVelocities[i], 3, 0);
+	}
+}
+
+void FChParticleCloud::VariablesFbIncrementMq()
+{
+	for (auto& grainVariables : variables) {
+		grainVariables.Compute_inc_Mb_v(grainVariables.Get_fb(), grainVariables.Get_qb());
+	}
+}
+
+void FChParticleCloud::VariablesQbSetSpeed(double step)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		chrono::ChVector<> oldVelocity = velocities[i];
+		chrono::ChVector<> oldAngularVelocity = angularVelocities[i];
+		velocities[i] = variables[i].Get_qb().ClipVector(0, 0);
+		angularVelocities[i] = variables[i].Get_qb().ClipVector(3, 0);
+		if (step) {
+			accelerations[i] = (velocities[i] - oldVelocity) / step;
+			angularAccelerations[i] = (angularVelocities[i] - oldAngularVelocity) / step;
+		}
+	}
+}
+
+void FChParticleCloud::VariablesQbIncrementPosition(double step)
+{
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		positions[i] += variables[i].Get_qb().ClipVector(0, 0) * step;
+		rotations[i] = IncrementRotation(rotations[i], variables[i].Get_qb().ClipVector(3, 0) * step);
+	}
+}
+
+void FChParticleCloud::OnCustomCollision(chrono::ChSystem* system)
+{
+	std::vector<chrono::collision::ChCollisionInfo> contacts;
+	if (GetParticleNum() > 0) {
+		CollidePairs(contacts);
+		if (bCollideWithWorld) {
+			CollideWorld(system, contacts);
+		}
+	}
+
+	auto container = system->GetContactContainer();
+	for (auto& contact : contacts) {
+		container->AddContact(contact);
+	}
+	lastContactCount = (int32)contacts.size();
+}
+
+void FChParticleCloud::CollidePairs(std::vector<chrono::collision::ChCollisionInfo>& outContacts)
+{
+	int32 count = GetParticleNum();
+	double reach = 2 * (radius + envelope);
+	double invCell = 1.0 / reach;
+
+	// Counting sort into twice as many buckets as grains, cells one contact reach wide
+	uint32 buckets = FMath::RoundUpToPowerOfTwo(FMath::Max(count * 2, 64));
+	uint32 cellMask = buckets - 1;
+	grainCell.resize(count);
+	sortedGrains.resize(count);
+	cellStart.assign(buckets + 1, 0);
+	for (int32 i = 0; i < count; i++) {
+		grainCell[i] = HashCell(CellOf(positions[i].x(), invCell), CellOf(positions[i].y(), invCell), CellOf(positions[i].z(), invCell), cellMask);
+		cellStart[grainCell[i] + 1]++;
+	}
+	for (uint32 b = 0; b < buckets; b++) {
+		cellStart[b + 1] += cellStart[b];
+	}
+	std::vector<int32> cursor(cellStart.begin(), cellStart.end() - 1);
+	for (int32 i = 0; i < count; i++) {
+		sortedGrains[cursor[grainCell[i]]++] = i;
+	}
+
+	// Each chunk collects the pairs of its grains with higher indices, appended in chunk order
+	int32 chunkNum = (count + PairChunkSize - 1) / PairChunkSize;
+	std::vector<std::vector<chrono::collision::ChCollisionInfo>> chunkContacts(chunkNum);
+	ParallelFor(chunkNum, [&](int32 chunk) {
+		auto& contacts = chunkContacts[chunk];
+		int32 end = FMath::Min((chunk + 1) * PairChunkSize, count);
+		for (int32 i = chunk * PairChunkSize; i < end; i++) {
+			const chrono::ChVector<>& center = positions[i];
+			int32 cx = CellOf(center.x(), invCell), cy = CellOf(center.y(), invCell), cz = CellOf(center.z(), invCell);
+			uint32 visited[27];
+			int32 visitedNum = 0;
+			for (int32 dz = -1; dz <= 1; dz++) {
+				for (int32 dy = -1; dy <= 1; dy++) {
+					for (int32 dx = -1; dx <= 1; dx++) {
+						uint32 bucket = HashCell(cx + dx, cy + dy, cz + dz, cellMask);
+						// Two neighbour cells in one bucket would report its pairs twice
+						bool bSeen = false;
+						for (int32 v = 0; v < visitedNum; v++) {
+							bSeen |= visited[v] == bucket;
+						}
+						if (bSeen) {
+							continue;
+						}
+						visited[visitedNum++] = bucket;
+						for (int32 k = cellStart[bucket]; k < cellStart[bucket + 1]; k++) {
+							int32 j = sortedGrains[k];
+							if (j <= i) {
+								continue;
+							}
+							chrono::ChVector<> offset = positions[j] - center;
+							double distance2 = offset.Length2();
+							if (distance2 >= reach * reach || distance2 <= 0) {
+								continue;
+							}
+							double distance = std::sqrt(distance2);
+							chrono::ChVector<> normal = offset / distance;
+							chrono::collision::ChCollisionInfo contact;
+							contact.modelA = &models[i];
+							contact.modelB = &models[j];
+							contact.vN = normal;
+							contact.vpA = center + normal * radius;
+							contact.vpB = positions[j] - normal * radius;
+							contact.distance = distance - 2 * radius;
+							contact.eff_radius = radius * 0.5;
+							contact.reaction_cache = nullptr;
+							contacts.push_back(contact);
+						}
+					}
+				}
+			}
+		}
+	}, chunkNum < 2);
+
+	for (auto& contacts : chunkContacts) {
+		outContacts.insert(outContacts.end(), contacts.begin(), contacts.end());
+	}
+}
+
+void FChParticleCloud::CollideWorld(chrono::ChSystem* system, std::vector<chrono::collision::ChCollisionInfo>& outContacts)
+{
+	auto bulletSystem = std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(system->GetCollisionSystem());
+	if (!bulletSystem) {
+		return;
+	}
+	btCollisionWorld* world = bulletSystem->GetBulletCollisionWorld();
+
+	// One sphere inflated by the envelope, moved to every grain in turn; the world's queries aren't thread safe
+	btSphereShape sphere((btScalar)(radius + envelope));
+	btCollisionObject query;
+	query.setCollisionShape(&sphere);
+
+	FWorldContactCallback callback;
+	callback.query = &query;
+	callback.radius = radius;
+	callback.envelope = envelope;
+	callback.contacts = &outContacts;
+	// Bullet's filters are shorts holding 16 mask bits, family 15 is the sign bit
+	callback.m_collisionFilterGroup = (short)(uint16)(1u << family);
+	callback.m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+	for (int32 i = 0; i < GetParticleNum(); i++) {
+		const chrono::ChVector<>& center = positions[i];
+		query.setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3((btScalar)center.x(), (btScalar)center.y(), (btScalar)center.z())));
+		callback.grainModel = &models[i];
+		callback.center = center;
+		world->contactTest(&query, callback);
+	}
+}
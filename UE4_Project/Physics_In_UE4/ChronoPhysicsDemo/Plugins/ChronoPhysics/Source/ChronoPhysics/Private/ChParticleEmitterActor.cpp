@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ChParticleEmitterActor.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChSystem.h"
+#include "util.h"
+
+AChParticleEmitterActor::AChParticleEmitterActor()
+{
+	bUseInstancedRendering = true;
+}
+
+void AChParticleEmitterActor::PhysicsObjectConstruct()
+{
+	emitTransform = GetActorTransform();
+	FTransform parking(FQuat::Identity, emitTransform.GetLocation(), ParticleScale);
+
+	PoolList.Reserve(PoolSize);
+	for (int i = 0; i < PoolSize; i++) {
+		int index = NewChBodyInstance(ParticleShape, parking, ParticleDensity, false);
+		if (index == INDEX_NONE) {
+			break;
+		}
+		// The collision model is built once here, parking only takes it out of the broadphase
+		auto body = InstancedBodyList[index].ChData;
+		body->SetBodyFixed(true);
+		body->SetCollide(false);
+		PoolList.Add(index);
+	}
+}
+
+void AChParticleEmitterActor::PhysicsObjectInitalize()
+{
+	Super::PhysicsObjectInitalize();
+
+	random.Initialize(RandomSeed);
+	ActiveList.Reset();
+	FreeList.Reset();
+	// Popped from the back, so the first slots are emitted first
+	for (int slot = PoolList.Num() - 1; slot >= 0; slot--) {
+		FreeList.Add(slot);
+	}
+	SpawnTime.SetNumZeroed(PoolList.Num());
+	lastTime = 0.0;
+	emitCredit = 0.0;
+}
+
+void AChParticleEmitterActor::UpdatePhysicsState()
+{
+	Super::UpdatePhysicsState();
+
+	if (PoolList.Num() == 0) {
+		return;
+	}
+	auto system = InstancedBodyList[PoolList[0]].ChData->GetSystem();
+	if (!system) {
+		return;
+	}
+	double time = system->GetChTime();
+	double dt = FMath::Max(time - lastTime, 0.0);
+	lastTime = time;
+
+	for (int i = ActiveList.Num() - 1; i >= 0; i--) {
+		int slot = ActiveList[i];
+		auto& body = InstancedBodyList[PoolList[slot]].ChData;
+		bool expired = bUseLifeTime && time - SpawnTime[slot] > LifeTime;
+		bool fallen = bUseRemoveHeight && body->GetPos().y() * CHRONO_SCALE < RemoveHeight;
+		if (expired || fallen) {
+			ParkParticle(slot);
+			ActiveList.RemoveAtSwap(i, 1, false);
+			FreeList.Add(slot);
+		}
+	}
+
+	emitCredit += dt * ParticlesPerSecond;
+	int wanted = FMath::FloorToInt(emitCredit);
+	int count = FMath::Min(wanted, FreeList.Num());
+	// Credit for particles the pool can't serve is dropped rather than emitted in a burst later
+	emitCredit = count < wanted ? 0.0 : emitCredit - count;
+	for (int i = 0; i < count; i++) {
+		int slot = FreeList.Pop(false);
+		EmitParticle(slot, time);
+		ActiveList.Add(slot);
+	}
+}
+
+void AChParticleEmitterActor::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	Super::CollectPhysicsStateUpdate(objList);
+	if (PoolList.Num()) {
+		objList.Add(this);
+	}
+}
+
+void AChParticleEmitterActor::CacheVisualState()
+{
+	Super::CacheVisualState();
+
+	// Parked particles stay in the instancer, collapsed so they draw nothing
+	for (int slot : FreeList) {
+		auto& instance = InstancedBodyList[PoolList[slot]];
+		instance.CachedTransform.SetScale3D(FVector::ZeroVector);
+		instance.PreviousTransform = instance.CachedTransform;
+	}
+}
+
+void AChParticleEmitterActor::ParkParticle(int slot)
+{
+	auto& body = InstancedBodyList[PoolList[slot]].ChData;
+	body->SetCollide(false);
+	body->SetBodyFixed(true);
+	body->SetPos_dt(chrono::VNULL);
+	body->SetWvel_loc(chrono::VNULL);
+}
+
+void AChParticleEmitterActor::EmitParticle(int slot, double time)
+{
+	auto& instance = InstancedBodyList[PoolList[slot]];
+	auto& body = instance.ChData;
+
+	FVector local(random.FRandRange(-EmitExtent.X, EmitExtent.X), random.FRandRange(-EmitExtent.Y, EmitExtent.Y), random.FRandRange(-EmitExtent.Z, EmitExtent.Z));
+	FVector location = emitTransform.TransformPosition(local);
+	FQuat rotation = FRotator(random.FRandRange(-180.f, 180.f), random.FRandRange(-180.f, 180.f), random.FRandRange(-180.f, 180.f)).Quaternion();
+	FVector velocity = emitTransform.GetUnitAxis(EAxis::X) * EmitSpeed * (1.f + random.FRandRange(-SpeedSpread, SpeedSpread));
+
+	body->SetPos(FVECTOR_TO_CHRONO_VEC(location));
+	body->SetRot(FQUAT_TO_CHRONO_QUAT(rotation));
+	body->SetPos_dt(FVECTOR_TO_CHRONO_VEC(velocity));
+	body->SetWvel_loc(chrono::VNULL);
+	body->SetBodyFixed(false);
+	body->SetCollide(true);
+	body->SetSleeping(false);
+	SpawnTime[slot] = time;
+
+	// Start the interpolation at the spawn point instead of the parking spot
+	instance.CachedTransform = FTransform(rotation, location, instance.Scale);
+	instance.PreviousTransform = instance.CachedTransform;
+}
@@ -0,0 +1,144 @@
+#include "ChPersistentContactContainerNSC.h"
+#include "ChPhysicsStats.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "chrono/physics/ChContactable.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Persistent Contacts"), STAT_ChronoPersistentContacts, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Contact Manifolds"), STAT_ChronoContactManifolds, STATGROUP_ChronoPhysics);
+
+void FChPersistentContactContainerNSC::RemoveAllContacts()
+{
+	FChPooledContactContainerNSC::RemoveAllContacts();
+	manifolds.Reset();
+	persistentNum = 0;
+}
+
+void FChPersistentContactContainerNSC::BeginAddContact()
+{
+	FChPooledContactContainerNSC::BeginAddContact();
+	step++;
+	persistentNum = 0;
+}
+
+void FChPersistentContactContainerNSC::AddContact(const chrono::collision::ChCollisionInfo& mcontact)
+{
+	// Dropped by the pool, no manifold point for it either
+	if (IsImmovablePair(mcontact)) {
+		return;
+	}
+	if (mcontact.reaction_cache) {
+		// Matched by the collision system's own manifold, a contact it just found has zero multipliers
+		if (mcontact.reaction_cache[0] != 0) {
+			persistentNum++;
+		}
+		FChPooledContactContainerNSC::AddContact(mcontact);
+		return;
+	}
+
+	bool bPersistent = false;
+	chrono::collision::ChCollisionInfo cinfo(mcontact);
+	cinfo.reaction_cache = FindReactionCache(mcontact, bPersistent);
+	if (bPersistent) {
+		persistentNum++;
+	}
+	FChPooledContactContainerNSC::AddContact(cinfo);
+}
+
+void FChPersistentContactContainerNSC::EndAddContact()
+{
+	FChPooledContactContainerNSC::EndAddContact();
+
+	// Pairs without a contact this step have separated, their points don't carry over a gap
+	for (auto it = manifolds.CreateIterator(); it; ++it) {
+		FManifold& manifold = *it.Value();
+		if (manifold.Step != step) {
+			it.RemoveCurrent();
+			continue;
+		}
+		// Freed in place, the contacts of this step point into the slots
+		for (int32 i = 0; i < manifold.Num; i++) {
+			if (manifold.Points[i].Step != step) {
+				manifold.Points[i].Step = INDEX_NONE;
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ChronoPersistentContacts, persistentNum);
+	SET_DWORD_STAT(STAT_ChronoContactManifolds, manifolds.Num());
+}
+
+int32 FChPersistentContactContainerNSC::AllocatePoint(FManifold& manifold) const
+{
+	for (int32 i = 0; i < manifold.Num; i++) {
+		if (manifold.Points[i].Step == INDEX_NONE) {
+			return i;
+		}
+	}
+	if (manifold.Num < ManifoldPoints) {
+		return manifold.Num++;
+	}
+	// Full, the weakest point of the last step gives way; the ones of this step keep their caches
+	int32 weakest = INDEX_NONE;
+	for (int32 i = 0; i < manifold.Num; i++) {
+		const FManifoldPoint& point = manifold.Points[i];
+		if (point.Step != step && (weakest == INDEX_NONE || FMath::Abs(point.Reactions[0]) < FMath::Abs(manifold.Points[weakest].Reactions[0]))) {
+			weakest = i;
+		}
+	}
+	return weakest;
+}
+
+float* FChPersistentContactContainerNSC::FindReactionCache(const chrono::collision::ChCollisionInfo& mcontact, bool& bOutPersistent)
+{
+	bOutPersistent = false;
+	chrono::ChContactable* contactableA = mcontact.modelA->GetContactable();
+	chrono::ChContactable* contactableB = mcontact.modelB->GetContactable();
+	if (!contactableA || !contactableB) {
+		return nullptr;
+	}
+
+	TUniquePtr<FManifold>& slot = manifolds.FindOrAdd(MakeTuple(mcontact.modelA, mcontact.modelB));
+	if (!slot) {
+		slot = MakeUnique<FManifold>();
+	}
+	FManifold& manifold = *slot;
+	manifold.Step = step;
+
+	const chrono::ChVector<> localA = contactableA->GetCsysForCollisionModel().TransformParentToLocal(mcontact.vpA);
+	const chrono::ChVector<> localB = contactableB->GetCsysForCollisionModel().TransformParentToLocal(mcontact.vpB);
+
+	// The closest point on both models not yet taken this step
+	const double matchDistance2 = matchDistance * matchDistance;
+	int32 match = INDEX_NONE;
+	double matchScore = DBL_MAX;
+	for (int32 i = 0; i < manifold.Num; i++) {
+		const FManifoldPoint& point = manifold.Points[i];
+		if (point.Step == step || point.Step == INDEX_NONE) {
+			continue;
+		}
+		const double distanceA2 = (point.LocalA - localA).Length2();
+		const double distanceB2 = (point.LocalB - localB).Length2();
+		if (distanceA2 <= matchDistance2 && distanceB2 <= matchDistance2 && distanceA2 + distanceB2 < matchScore) {
+			match = i;
+			matchScore = distanceA2 + distanceB2;
+		}
+	}
+
+	if (match != INDEX_NONE) {
+		bOutPersistent = true;
+	}
+	else {
+		match = AllocatePoint(manifold);
+		if (match == INDEX_NONE) {
+			// More contacts of the pair in one step than a manifold holds, the rest start cold
+			return nullptr;
+		}
+		FMemory::Memzero(manifold.Points[match].Reactions);
+	}
+
+	FManifoldPoint& point = manifold.Points[match];
+	point.LocalA = localA;
+	point.LocalB = localB;
+	point.Step = step;
+	return point.Reactions;
+}
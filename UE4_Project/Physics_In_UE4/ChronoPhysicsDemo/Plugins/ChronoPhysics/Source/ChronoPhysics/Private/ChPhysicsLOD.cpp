@@ -0,0 +1,210 @@
+#include "ChPhysicsLOD.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChContactContainer.h"
+
+namespace {
+	class WakeTouchedCallback : public chrono::ChContactContainer::ReportContactCallback
+	{
+	public:
+		WakeTouchedCallback(TArray<chrono::ChBody*>& inTouched) : touched(inTouched) {}
+
+		virtual bool OnReportContact(const chrono::ChVector<>& pA,
+			const chrono::ChVector<>& pB,
+			const chrono::ChMatrix33<>& plane_coord,
+			const double& distance,
+			const double& eff_Radius,
+			const chrono::ChVector<>& react_forces,
+			const chrono::ChVector<>& react_torques,
+			chrono::ChContactable* modA,
+			chrono::ChContactable* modB) override {
+
+			auto bodyA = modA ? dynamic_cast<chrono::ChBody*>(modA->GetPhysicsItem()) : nullptr;
+			auto bodyB = modB ? dynamic_cast<chrono::ChBody*>(modB->GetPhysicsItem()) : nullptr;
+			if (bodyA && bodyB) {
+				// Only a body that moves wakes the other one
+				if (bodyA->GetSleeping() && !bodyB->GetSleeping() && !bodyB->GetBodyFixed()) {
+					touched.Add(bodyA);
+				}
+				else if (bodyB->GetSleeping() && !bodyA->GetSleeping() && !bodyA->GetBodyFixed()) {
+					touched.Add(bodyB);
+				}
+			}
+			return true;
+		}
+
+	private:
+		TArray<chrono::ChBody*>& touched;
+	};
+}
+
+void FChPhysicsLOD::SetBodies(const TArray<std::shared_ptr<chrono::ChBody>>& bodies)
+{
+	TArray<FEntry> previous = MoveTemp(entries);
+	TMap<chrono::ChBody*, int32> previousIndices = MoveTemp(entryIndices);
+	entries.Reset(bodies.Num());
+	entryIndices.Reset();
+	for (auto& body : bodies) {
+		if (!body || entryIndices.Contains(body.get())) {
+			continue;
+		}
+		entryIndices.Add(body.get(), entries.Num());
+		int32* found = previousIndices.Find(body.get());
+		if (found) {
+			entries.Add(previous[*found]);
+			previous[*found].Body.reset();
+		}
+		else {
+			FEntry& entry = entries[entries.AddDefaulted()];
+			entry.Body = body;
+		}
+	}
+	// Removed from the scene, but whoever holds on to them gets them moving
+	for (auto& entry : previous) {
+		if (entry.Body && entry.bFrozen) {
+			Thaw(entry);
+		}
+	}
+
+	FMemory::Memzero(tierNums);
+	frozenNum = 0;
+	for (auto& entry : entries) {
+		tierNums[entry.Tier]++;
+		frozenNum += entry.bFrozen ? 1 : 0;
+	}
+}
+
+void FChPhysicsLOD::Update(const TArray<chrono::ChVector<>>& focus, double elapsed, const TArray<chrono::ChSystem*>& systems)
+{
+	if (focus.Num() == 0) {
+		return;
+	}
+	if (frozenNum > 0) {
+		WakeTouched(systems);
+	}
+
+	FMemory::Memzero(tierNums);
+	frozenNum = 0;
+	for (auto& entry : entries) {
+		chrono::ChBody& body = *entry.Body;
+		if (body.GetBodyFixed()) {
+			continue;
+		}
+		// Woken by the system's own sleeping management
+		if (entry.bFrozen && !body.GetSleeping()) {
+			body.SetPos_dt(body.GetPos_dt() + entry.Velocity);
+			body.SetWvel_par(body.GetWvel_par() + entry.AngularVelocity);
+			entry.bFrozen = false;
+			entry.RestTime = 0;
+		}
+
+		double distanceSquared = TNumericLimits<double>::Max();
+		for (auto& point : focus) {
+			distanceSquared = FMath::Min(distanceSquared, (body.GetPos() - point).Length2());
+		}
+		entry.Tier = SelectTier(entry, distanceSquared);
+
+		switch (entry.Tier) {
+		case EChLODTier::FROZEN:
+			if (entry.WakeTime > 0) {
+				entry.WakeTime -= elapsed;
+			}
+			else if (!entry.bFrozen) {
+				Freeze(entry, false);
+			}
+			break;
+		case EChLODTier::REDUCED:
+			if (entry.bFrozen) {
+				if (!entry.bRested) {
+					Thaw(entry);
+				}
+			}
+			else if (body.GetPos_dt().Length() < settings.RestSpeed && body.GetWvel_par().Length() < settings.RestSpeed) {
+				entry.RestTime += elapsed;
+				if (entry.RestTime >= settings.RestTime) {
+					Freeze(entry, true);
+				}
+			}
+			else {
+				entry.RestTime = 0;
+			}
+			break;
+		default:
+			if (entry.bFrozen) {
+				Thaw(entry);
+			}
+			entry.RestTime = 0;
+			break;
+		}
+		tierNums[entry.Tier]++;
+		frozenNum += entry.bFrozen ? 1 : 0;
+	}
+}
+
+void FChPhysicsLOD::Reset()
+{
+	for (auto& entry : entries) {
+		if (entry.bFrozen) {
+			Thaw(entry);
+		}
+	}
+	entries.Reset();
+	entryIndices.Reset();
+	FMemory::Memzero(tierNums);
+	frozenNum = 0;
+}
+
+EChLODTier::Type FChPhysicsLOD::SelectTier(const FEntry& entry, double distanceSquared) const
+{
+	// A body has to come back further in than it left, so one at the edge doesn't flip every update
+	double frozen = settings.FrozenDistance * (entry.Tier == EChLODTier::FROZEN ? 1 - settings.Hysteresis : 1);
+	double reduced = settings.ReducedDistance * (entry.Tier != EChLODTier::FULL ? 1 - settings.Hysteresis : 1);
+	if (distanceSquared > frozen * frozen) {
+		return EChLODTier::FROZEN;
+	}
+	return distanceSquared > reduced * reduced ? EChLODTier::REDUCED : EChLODTier::FULL;
+}
+
+void FChPhysicsLOD::Freeze(FEntry& entry, bool bRested)
+{
+	chrono::ChBody& body = *entry.Body;
+	entry.Velocity = body.GetPos_dt();
+	entry.AngularVelocity = body.GetWvel_par();
+	// A sleeping body is out of the solve, but its state would still be integrated with the velocity it has
+	body.SetPos_dt(chrono::VNULL);
+	body.SetWvel_par(chrono::VNULL);
+	body.SetSleeping(true);
+	entry.bFrozen = true;
+	entry.bRested = bRested;
+	entry.RestTime = 0;
+}
+
+void FChPhysicsLOD::Thaw(FEntry& entry)
+{
+	chrono::ChBody& body = *entry.Body;
+	body.SetSleeping(false);
+	body.SetPos_dt(entry.Velocity);
+	body.SetWvel_par(entry.AngularVelocity);
+	entry.Velocity = chrono::VNULL;
+	entry.AngularVelocity = chrono::VNULL;
+	entry.bFrozen = false;
+	entry.bRested = false;
+	entry.RestTime = 0;
+}
+
+void FChPhysicsLOD::WakeTouched(const TArray<chrono::ChSystem*>& systems)
+{
+	TArray<chrono::ChBody*> touched;
+	WakeTouchedCallback callback(touched);
+	for (auto system : systems) {
+		system->GetContactContainer()->ReportAllContacts(&callback);
+	}
+	for (auto body : touched) {
+		int32* index = entryIndices.Find(body);
+		if (index && entries[*index].bFrozen) {
+			Thaw(entries[*index]);
+			// Stays awake for a full rest period, even out in the frozen tier
+			entries[*index].WakeTime = settings.RestTime;
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include "ChPhysicsObjectRegistry.h"
+#include "ChPhysicsObjectInterface.h"
+#include "ChPhysicsSceneManagerActor.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Components/ActorComponent.h"
+
+namespace {
+	TMap<UWorld*, TUniquePtr<FChPhysicsObjectRegistry>> Registries;
+	FDelegateHandle WorldCleanupHandle;
+	FChPhysicsObjectRegistry::FOnPhysicsObjectChanged ObjectEdited;
+
+	AActor* GetObjectActor(UObject* object)
+	{
+		if (auto actor = Cast<AActor>(object)) {
+			return actor;
+		}
+		auto component = Cast<UActorComponent>(object);
+		return component ? component->GetOwner() : nullptr;
+	}
+
+	bool IsOwnedByPhysicsObject(UObject* object)
+	{
+		AActor* actor = GetObjectActor(object);
+		AActor* owner = actor ? actor->GetOwner() : nullptr;
+		return owner && Cast<IChPhysicsObjectInterface>(owner);
+	}
+}
+
+FChPhysicsObjectRegistry* FChPhysicsObjectRegistry::Get(UWorld* world)
+{
+	if (!world || !world->IsGameWorld()) {
+		return nullptr;
+	}
+	if (!WorldCleanupHandle.IsValid()) {
+		WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* cleanedWorld, bool bSessionEnded, bool bCleanupResources) {
+			Registries.Remove(cleanedWorld);
+		});
+	}
+	auto& registry = Registries.FindOrAdd(world);
+	if (!registry) {
+		registry = MakeUnique<FChPhysicsObjectRegistry>();
+	}
+	return registry.Get();
+}
+
+void FChPhysicsObjectRegistry::Register(UObject* object)
+{
+	if (!object || !Cast<IChPhysicsObjectInterface>(object) || object->IsTemplate() || IsOwnedByPhysicsObject(object)) {
+		return;
+	}
+	if (auto registry = Get(object->GetWorld())) {
+		registry->Add(object);
+	}
+}
+
+void FChPhysicsObjectRegistry::Unregister(UObject* object)
+{
+	auto world = object ? object->GetWorld() : nullptr;
+	auto found = world ? Registries.Find(world) : nullptr;
+	if (found) {
+		(*found)->Remove(object);
+	}
+}
+
+FChPhysicsObjectRegistry::FOnPhysicsObjectChanged& FChPhysicsObjectRegistry::OnObjectEdited()
+{
+	return ObjectEdited;
+}
+
+void FChPhysicsObjectRegistry::NotifyEdited(UObject* object)
+{
+	if (object && !object->IsTemplate()) {
+		ObjectEdited.Broadcast(object);
+	}
+}
+
+void FChPhysicsObjectRegistry::Add(UObject* object)
+{
+	if (indices.Contains(object)) {
+		return;
+	}
+	indices.Add(object, objects.Add(object));
+	OnAdded.Broadcast(object);
+}
+
+void FChPhysicsObjectRegistry::Remove(UObject* object)
+{
+	int32 index;
+	if (!indices.RemoveAndCopyValue(object, index)) {
+		return;
+	}
+	objects.RemoveAtSwap(index, 1, false);
+	if (index < objects.Num()) {
+		indices[objects[index]] = index;
+	}
+	OnRemoved.Broadcast(object);
+}
+
+void FChPhysicsObjectRegistry::AddScene(AChPhysicsSceneManagerActor* scene)
+{
+	scenes.AddUnique(scene);
+}
+
+void FChPhysicsObjectRegistry::RemoveScene(AChPhysicsSceneManagerActor* scene)
+{
+	scenes.Remove(scene);
+}
+
+AChPhysicsSceneManagerActor* FChPhysicsObjectRegistry::FindScene(UObject* object) const
+{
+	AActor* actor = GetObjectActor(object);
+	AChPhysicsSceneManagerActor* untagged = nullptr;
+	for (auto scene : scenes) {
+		if (scene->SceneTag.IsNone()) {
+			untagged = untagged ? untagged : scene;
+		}
+		else if (actor && actor->ActorHasTag(scene->SceneTag)) {
+			return scene;
+		}
+	}
+	return untagged;
+}
@@ -3,16 +3,122 @@
 
 #include "ChPhysicsSceneManagerActor.h"
 #include "chrono/physics/ChSystemNSC.h"
+#include "chrono/physics/ChSystemSMC.h"
+#include "chrono_parallel/physics/ChSystemParallel.h"
+#include "chrono/parallel/ChOpenMP.h"
 #include "Engine/World.h"
 #include "EngineUtils.h"
 #include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono/collision/ChCModelBullet.h"
 #include "ChPhysicsObjectInterface.h"
+#include "ChPhysicsObjectRegistry.h"
 #include "ChBodyComponent.h"
-#include "chrono/physics/ChContactContainer.h"
+#include "ChBody_TriMeshComponent.h"
+#include "ChStaticMeshCollider.h"
+#include "ChFEAContactSurface.h"
+#include "ChFEAMeshComponent.h"
+#include "chrono/fea/ChContactSurfaceMesh.h"
+#include "chrono/fea/ChContactSurfaceNodeCloud.h"
+#include "ChContinuousCollision.h"
+#include "ChParticleCloud.h"
+#include "ChMultirateSprings.h"
+#include "ChParallelResidualSystem.h"
+#include "ChSolverAPGDPreconditioned.h"
+#include "ChSolverColoredSOR.h"
+#include "ChSolverArticulated.h"
+#include "ChSolverIslands.h"
+#include "ChBodyBatch.h"
+#include "ChGpuRigidWorld.h"
+#include "ChDomainDecomposition.h"
+#include "ChMaterialLibrary.h"
+#include "ChCollisionGroupFilter.h"
+#include "ChPackedContactContainerSMC.h"
+#include "ChSortedAABBCollisionSystem.h"
+#include "ChThreadedShurSolver.h"
+#include "ChLinkActor.h"
+#include "chrono/physics/ChLink.h"
+#include "chrono/timestepper/ChTimestepperHHT.h"
 #include "DrawDebugHelpers.h"
+#include "ChPhysicsStats.h"
+#include "ChPersistentContactContainerNSC.h"
+#include "ChKinematicBody.h"
+#include "ChMortonOrder.h"
+#include "ChCollisionEnvelope.h"
+#include "ChNetReplicationComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "chrono/solver/ChIterativeSolver.h"
 #include "util.h"
 #include "chrono_vehicle/terrain/SCMDeformableTerrain.h"
 #include "ChBody_GeneratedActor.h"
+#include "ChLink_EngineActor.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/IConsoleManager.h"
+#include "ChTrace.h"
+#if WITH_EDITOR
+#include "Engine/Engine.h"
+#include "Editor.h"
+#include "PhysicsObjectGeneratorBasis.h"
+#endif
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Solver Iterations"), STAT_ChronoSolverIterations, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Solver Residual"), STAT_ChronoSolverResidual, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Broadphase Bins X"), STAT_ChronoBinsX, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Broadphase Bins Y"), STAT_ChronoBinsY, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Broadphase Bins Z"), STAT_ChronoBinsZ, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Contacts"), STAT_ChronoContacts, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Contacts High Water"), STAT_ChronoContactHighWater, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tuned Envelopes"), STAT_ChronoTunedEnvelopes, STATGROUP_ChronoPhysics);
+DECLARE_MEMORY_STAT(TEXT("Chrono Bodies"), STAT_ChronoMemoryBodies, STATGROUP_ChronoPhysics);
+DECLARE_MEMORY_STAT(TEXT("Chrono Contacts"), STAT_ChronoMemoryContacts, STATGROUP_ChronoPhysics);
+DECLARE_MEMORY_STAT(TEXT("Chrono Collision Shapes"), STAT_ChronoMemoryShapes, STATGROUP_ChronoPhysics);
+DECLARE_MEMORY_STAT(TEXT("Chrono Descriptor"), STAT_ChronoMemoryDescriptor, STATGROUP_ChronoPhysics);
+DECLARE_MEMORY_STAT(TEXT("Chrono Parallel Data"), STAT_ChronoMemoryParallel, STATGROUP_ChronoPhysics);
+DECLARE_MEMORY_STAT(TEXT("Chrono Peak Total"), STAT_ChronoMemoryPeak, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Mean Tuned Envelope (mm)"), STAT_ChronoMeanEnvelope, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Constraints"), STAT_ChronoConstraints, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bodies"), STAT_ChronoBodies, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("CCD Advanced Bodies"), STAT_ChronoCCDAdvanced, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("GPU Dropped Contacts"), STAT_ChronoGpuDroppedContacts, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Domain Ghosts"), STAT_ChronoDomainGhosts, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Domain Migrations"), STAT_ChronoDomainMigrations, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Reduced Bodies"), STAT_ChronoLODReduced, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOD Frozen Bodies"), STAT_ChronoLODFrozen, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FEA Bulk Contacts"), STAT_ChronoFEAContacts, STATGROUP_ChronoPhysics);
+
+// Chrono's own step timers, summed over the substeps and scene managers of a frame
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chrono Step (ms)"), STAT_ChronoTimerStep, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chrono Collision (ms)"), STAT_ChronoTimerCollision, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chrono Setup (ms)"), STAT_ChronoTimerSetup, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chrono Jacobian (ms)"), STAT_ChronoTimerJacobian, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chrono Solver (ms)"), STAT_ChronoTimerSolver, STATGROUP_ChronoPhysics);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Chrono Update (ms)"), STAT_ChronoTimerUpdate, STATGROUP_ChronoPhysics);
+
+// Scopes of the manager's own phases around the Chrono step
+DECLARE_CYCLE_STAT(TEXT("Step Physics"), STAT_ChronoStepPhysics, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("DoStepDynamics"), STAT_ChronoDoStepDynamics, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Update Physics State"), STAT_ChronoUpdatePhysicsState, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Cache Visual State"), STAT_ChronoCacheVisualState, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Record Step Output"), STAT_ChronoRecordStepOutput, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Update Visual Asset"), STAT_ChronoUpdateVisualAsset, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Wait For Physics Step"), STAT_ChronoWaitForStep, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Construction"), STAT_ChronoConstruction, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Flush Pending Objects"), STAT_ChronoFlushPending, STATGROUP_ChronoPhysics);
+DECLARE_CYCLE_STAT(TEXT("Trace Rays"), STAT_ChronoTraceRays, STATGROUP_ChronoPhysics);
+
+static FAutoConsoleCommandWithWorld DumpMemoryCommand(
+	TEXT("Chrono.DumpMemory"),
+	TEXT("Logs the estimated Chrono memory of every scene manager, per category with its high water mark"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* world) {
+		for (TActorIterator<AChPhysicsSceneManagerActor> it(world); it; ++it) {
+			it->DumpChronoMemory();
+		}
+	}));
 
 AChPhysicsSceneManagerActor::AChPhysicsSceneManagerActor()
 {
@@ -27,8 +133,52 @@ void AChPhysicsSceneManagerActor::BeginPlay()
 
 	SystemInitialize();
 	FetchPhysicsObject();
+
+	if (bStepOnWorkerThread && bJoinStepInFrame) {
+		joinTick.Target = this;
+		joinTick.TickGroup = JoinTickGroup;
+		joinTick.bCanEverTick = true;
+		joinTick.AddPrerequisite(this, PrimaryActorTick);
+		joinTick.RegisterTickFunction(GetLevel());
+	}
+	if (bIncrementalConstruction) {
+		constructionPhase = EChConstructionPhase::CONSTRUCT;
+		constructionCursor = 0;
+		return;
+	}
+
 	InitPhysicsObject();
 	AddObjectToSystem();
+	FinishConstruction();
+	constructionPhase = EChConstructionPhase::READY;
+}
+
+void AChPhysicsSceneManagerActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (joinTick.IsTickFunctionRegistered()) {
+		joinTick.UnRegisterTickFunction();
+	}
+	realtimeStepper.Reset();
+	WaitForPhysicsStep();
+	if (geometryTask.IsValid()) {
+		geometryTask.Wait();
+	}
+	if (checkpointTask.IsValid()) {
+		checkpointTask.Wait();
+	}
+	for (auto& task : archiveTasks) {
+		task.Wait();
+	}
+	archiveTasks.Reset();
+	outputPipeline.Reset();
+	if (auto registry = FChPhysicsObjectRegistry::Get(GetWorld())) {
+		registry->OnAdded.Remove(registryAddedHandle);
+		registry->OnRemoved.Remove(registryRemovedHandle);
+	}
+	FWorldDelegates::LevelAddedToWorld.Remove(levelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(levelRemovedHandle);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -36,25 +186,384 @@ void AChPhysicsSceneManagerActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	StepPhysics(DeltaTime);
+#if WITH_EDITOR
+	if (GetWorld()->WorldType == EWorldType::Editor) {
+		TickEditorPreview(DeltaTime);
+		return;
+	}
+#endif
+	if (constructionPhase != EChConstructionPhase::READY) {
+		AdvanceConstruction(ConstructionBudgetMs);
+		return;
+	}
+	// A level being made visible registers its objects over several frames, they go in as one batch on LevelAddedToWorld
+	if (!GetWorld()->GetCurrentLevelPendingVisibility() && !GetWorld()->GetCurrentLevelPendingInvisibility()) {
+		FlushPendingObjects();
+	}
+
+	if (IsNetReplica()) {
+		// The server simulates, this copy only shows its snapshots
+		netReplicator.Apply(DeltaTime, NetInterpolationDelay, NetPositionResolution);
+		interpolationAlpha = 1;
+		UpdateVisualAsset();
+		return;
+	}
 
-	for (auto body : this->PhysicsObjectList) {
-		body->UpdateVisualAsset();
+	if (bRealtimePacing) {
+		TickRealtime();
+		return;
+	}
+
+	if (bStepOnWorkerThread) {
+		// The worker owns the Chrono system until its step is joined
+		WaitForPhysicsStep();
+		SendNetSnapshots(DeltaTime);
+
+		if (!joinTick.IsTickFunctionRegistered()) {
+			UpdateVisualAsset();
+		}
+		for (auto body : this->PhysicsObjectList) {
+			body->LatchPhysicsInput();
+		}
+		GatherLODFocus();
+
+		PhysicsStepTask = Async<void>(EAsyncExecution::ThreadPool, [this, DeltaTime]() {
+			StepPhysics(DeltaTime);
+		});
+	}
+	else {
+		for (auto body : this->PhysicsObjectList) {
+			body->LatchPhysicsInput();
+		}
+		GatherLODFocus();
+
+		StepPhysics(DeltaTime);
+		UpdateVisualAsset();
+		SendNetSnapshots(DeltaTime);
+	}
+}
+
+void AChPhysicsSceneManagerActor::SendNetSnapshots(float deltaTime)
+{
+	ENetMode netMode = GetNetMode();
+	if (!bReplicateSimulation || (netMode != NM_DedicatedServer && netMode != NM_ListenServer)) {
+		return;
+	}
+	netSendAccumulator += deltaTime;
+	float interval = 1.f / FMath::Max(NetSendRate, 1.f);
+	if (netSendAccumulator < interval) {
+		return;
+	}
+	netSendAccumulator = FMath::Fmod(netSendAccumulator, interval);
+
+	netReplicator.Capture(GetWorld()->GetTimeSeconds(), NetPositionResolution);
+	for (auto it = GetWorld()->GetPlayerControllerIterator(); it; ++it) {
+		APlayerController* controller = it->Get();
+		if (!controller || controller->IsLocalController()) {
+			continue;
+		}
+		auto channel = controller->FindComponentByClass<UChNetReplicationComponent>();
+		if (!channel) {
+			// Replicates to the owning client with its controller
+			channel = NewObject<UChNetReplicationComponent>(controller);
+			channel->RegisterComponent();
+		}
+		channel->Scene = this;
+		if (netReplicator.EncodeLatest(channel->GetAckedSequence(), netSnapshotData)) {
+			channel->ClientReceiveSnapshot(netSnapshotData);
+		}
+	}
+}
+
+bool AChPhysicsSceneManagerActor::ReceiveNetSnapshot(const TArray<uint8>& data, int32& outSequence)
+{
+	return IsNetReplica() && constructionPhase == EChConstructionPhase::READY && netReplicator.Receive(data, outSequence);
+}
+
+void AChPhysicsSceneManagerActor::RebuildNetBodies()
+{
+	if (!bReplicateSimulation) {
+		return;
+	}
+	TArray<UChBodyComponent*> bodies;
+	for (auto& obj : PhysicsObjectList) {
+		if (auto body = Cast<UChBodyComponent>(obj.GetObject())) {
+			bodies.Add(body);
+		}
+	}
+	netReplicator.SetBodies(bodies);
+}
+
+void AChPhysicsSceneManagerActor::GatherLODFocus()
+{
+	lodFocus.Reset();
+	if (!bPhysicsLOD) {
+		return;
+	}
+	for (auto it = GetWorld()->GetPlayerControllerIterator(); it; ++it) {
+		if (APlayerController* controller = it->Get()) {
+			FVector location;
+			FRotator rotation;
+			controller->GetPlayerViewPoint(location, rotation);
+			lodFocus.Add(FVECTOR_TO_CHRONO_VEC(location));
+		}
+	}
+	for (auto actor : LODFocusActors) {
+		if (actor) {
+			lodFocus.Add(FVECTOR_TO_CHRONO_VEC(actor->GetActorLocation()));
+		}
+	}
+}
+
+void AChPhysicsSceneManagerActor::RebuildLODBodies()
+{
+	if (!bPhysicsLOD) {
+		return;
+	}
+	TArray<std::shared_ptr<chrono::ChBody>> bodies;
+	for (auto& obj : PhysicsObjectList) {
+		auto body = Cast<UChBodyComponent>(obj.GetObject());
+		// Freezing would put a kinematic body to sleep, off its path
+		if (body && body->GetChData() && !body->bKinematic) {
+			bodies.Add(body->GetChData());
+		}
+	}
+	physicsLOD.SetBodies(bodies);
+}
+
+void AChPhysicsSceneManagerActor::UpdatePhysicsLOD(double stepSize)
+{
+	if (!bPhysicsLOD) {
+		return;
+	}
+	lodElapsed += stepSize;
+	if (++lodStepCounter < LODUpdateInterval) {
+		return;
+	}
+	TArray<chrono::ChSystem*> systems;
+	systems.Add(this->phySystem.get());
+	if (domains) {
+		for (size_t d = 1; d < domains->GetSystems().size(); d++) {
+			systems.Add(domains->GetSystems()[d].get());
+		}
+	}
+	physicsLOD.Update(lodFocus, lodElapsed, systems);
+	lodStepCounter = 0;
+	lodElapsed = 0;
+	SET_DWORD_STAT(STAT_ChronoLODReduced, physicsLOD.GetTierNum(EChLODTier::REDUCED));
+	SET_DWORD_STAT(STAT_ChronoLODFrozen, physicsLOD.GetFrozenNum());
+}
+
+void AChPhysicsSceneManagerActor::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+	if (auto registry = FChPhysicsObjectRegistry::Get(GetWorld())) {
+		registry->AddScene(this);
+	}
+}
+
+void AChPhysicsSceneManagerActor::PostUnregisterAllComponents()
+{
+	if (auto registry = FChPhysicsObjectRegistry::Get(GetWorld())) {
+		registry->RemoveScene(this);
+	}
+	Super::PostUnregisterAllComponents();
+}
+
+bool AChPhysicsSceneManagerActor::ShouldTickIfViewportsOnly() const
+{
+	// The editor world ticks the manager only for the preview
+	return bEditorPreview && GetWorld() && GetWorld()->WorldType == EWorldType::Editor;
+}
+
+void AChPhysicsSceneManagerActor::JoinStep()
+{
+	if (PhysicsStepTask.IsValid()) {
+		WaitForPhysicsStep();
+		UpdateVisualAsset();
+	}
+}
+
+void FChSceneJoinTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && !Target->IsPendingKill()) {
+		Target->JoinStep();
+	}
+}
+
+FString FChSceneJoinTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[JoinStep]") : TEXT("<none>[JoinStep]");
+}
+
+void AChPhysicsSceneManagerActor::UpdateVisualAsset()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChronoUpdateVisualAsset);
+	if (bBatchTransformSync) {
+		float alpha = bUseFixedTimestep ? interpolationAlpha : 1.f;
+		syncComponents.Reset();
+		syncTransforms.Reset();
+
+		for (auto body : this->PhysicsObjectList) {
+			body->GatherVisualTransforms(syncComponents, syncTransforms, alpha, TransformSyncTolerance);
+		}
+
+		for (int i = 0; i < syncComponents.Num(); i++) {
+			syncComponents[i]->SetWorldTransform(syncTransforms[i], false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+	else if (bUseFixedTimestep) {
+		for (auto body : this->PhysicsObjectList) {
+			body->InterpolateVisualAsset(interpolationAlpha);
+		}
+	}
+	else {
+		for (auto body : this->PhysicsObjectList) {
+			body->UpdateVisualAsset();
+		}
 	}
+	BroadcastLinkBreaks();
+}
+
+void AChPhysicsSceneManagerActor::BroadcastLinkBreaks()
+{
+	if (!breakableLinks) {
+		return;
+	}
+	pendingBreaks.Reset();
+	breakableLinks->DrainBreaks(pendingBreaks);
+	if (pendingBreaks.Num() == 0) {
+		return;
+	}
+	linkBreaks.Reset(pendingBreaks.Num());
+	for (const FChBreakableLinks::FBreak& brk : pendingBreaks) {
+		FChLinkBreak& linkBreak = linkBreaks.AddDefaulted_GetRef();
+		linkBreak.Link = breakableActors.IsValidIndex(brk.Slot) ? breakableActors[brk.Slot] : nullptr;
+		linkBreak.Time = (float)brk.Time;
+		linkBreak.Force = brk.Force;
+		linkBreak.Torque = brk.Torque;
+	}
+	OnLinksBroken.Broadcast(linkBreaks);
 }
 
 void AChPhysicsSceneManagerActor::SystemInitialize()
 {
-	this->phySystem = std::make_shared<chrono::ChSystemNSC>();
-	//phySystem->SetSolverType(chrono::ChSolver::Type::SOR);
-	//phySystem->SetMaxItersSolverSpeed(100);
-	//phySystem->SetSolverType(chrono::ChSolver::Type::APGD);
-	//phySystem->SetSolverType(chrono::ChSolver::Type::BARZILAIBORWEIN);
-	//phySystem->SetSolverType(chrono::ChSolver::Type::JACOBI);
-	//phySystem->SetTimestepperType(chrono::ChTimestepper::Type::EULER_IMPLICIT_PROJECTED);
+	switch (SystemBackend) {
+	case EChSystemBackend::SERIAL_SMC:
+		if (bParallelResidual) {
+			this->phySystem = std::make_shared<FChParallelResidualSystemSMC>();
+		}
+		else {
+			this->phySystem = std::make_shared<chrono::ChSystemSMC>();
+		}
+		if (bPackedSMCContacts) {
+			this->phySystem->SetContactContainer(std::make_shared<FChPackedContactContainerSMC>());
+		}
+		break;
+	case EChSystemBackend::PARALLEL_NSC:
+		this->phySystem = std::make_shared<chrono::ChSystemParallelNSC>();
+		break;
+	case EChSystemBackend::PARALLEL_SMC:
+		this->phySystem = std::make_shared<chrono::ChSystemParallelSMC>();
+		break;
+	default:
+		if (bParallelResidual) {
+			this->phySystem = std::make_shared<FChParallelResidualSystemNSC>();
+		}
+		else {
+			this->phySystem = std::make_shared<chrono::ChSystemNSC>();
+		}
+		break;
+	}
+	// OpenMP loops inside Chrono, serial backends included, stay within the budget
+	ompThreadCount = ParallelThreadCount > 0 ? ParallelThreadCount : GetChronoThreadBudget();
+	chrono::CHOMPfunctions::SetNumThreads(ompThreadCount);
+	if (auto residualSystem = std::dynamic_pointer_cast<FChParallelResidualSystemNSC>(phySystem)) {
+		residualSystem->SetPartialCount(ompThreadCount);
+	}
+	else if (auto residualSMC = std::dynamic_pointer_cast<FChParallelResidualSystemSMC>(phySystem)) {
+		residualSMC->SetPartialCount(ompThreadCount);
+	}
+
+	if (SystemBackend == EChSystemBackend::SERIAL_NSC) {
+		switch (SerialSolverType) {
+		case EChSerialSolver::ISLANDS:
+			// Stabilization too, it has the same islands
+			phySystem->SetSolver(std::make_shared<FChSolverIslands>());
+			phySystem->SetStabSolver(std::make_shared<FChSolverIslands>());
+			break;
+		case EChSerialSolver::SYMMSOR:
+			phySystem->SetSolverType(chrono::ChSolver::Type::SYMMSOR);
+			break;
+		case EChSerialSolver::JACOBI:
+			phySystem->SetSolverType(chrono::ChSolver::Type::JACOBI);
+			break;
+		case EChSerialSolver::APGD:
+			phySystem->SetSolverType(chrono::ChSolver::Type::APGD);
+			if (bPreconditionSolver) {
+				// Speed solve only, the stabilization solver stays Chrono's
+				phySystem->SetSolver(std::make_shared<FChSolverAPGDPreconditioned>());
+			}
+			break;
+		case EChSerialSolver::BARZILAIBORWEIN:
+			phySystem->SetSolverType(chrono::ChSolver::Type::BARZILAIBORWEIN);
+			break;
+		case EChSerialSolver::SOR_COLORED:
+			// Plain SOR stays the stabilization solver
+			phySystem->SetSolver(std::make_shared<FChSolverColoredSOR>());
+			break;
+		case EChSerialSolver::ARTICULATED:
+			// Both, so the chains don't drift apart under stabilization
+			phySystem->SetSolver(std::make_shared<FChSolverArticulated>());
+			phySystem->SetStabSolver(std::make_shared<FChSolverArticulated>());
+			break;
+		default:
+			break;
+		}
+	}
+	if (SystemBackend == EChSystemBackend::SERIAL_NSC || SystemBackend == EChSystemBackend::SERIAL_SMC) {
+		switch (Timestepper) {
+		case EChTimestepper::EULER_IMPLICIT_PROJECTED:
+			phySystem->SetTimestepperType(chrono::ChTimestepper::Type::EULER_IMPLICIT_PROJECTED);
+			break;
+		case EChTimestepper::EULER_IMPLICIT:
+			phySystem->SetTimestepperType(chrono::ChTimestepper::Type::EULER_IMPLICIT);
+			break;
+		case EChTimestepper::HHT:
+			phySystem->SetTimestepperType(chrono::ChTimestepper::Type::HHT);
+			break;
+		default:
+			break;
+		}
+		if (auto hht = std::dynamic_pointer_cast<chrono::ChTimestepperHHT>(phySystem->GetTimestepper())) {
+			hht->SetModifiedNewton(bReuseJacobian);
+		}
+	}
 
 	phySystem->SetMaxItersSolverSpeed(MaxItersSolverSpeed);
 	phySystem->SetMaxItersSolverStab(MaxItersSolverStab);
+	if (SystemBackend == EChSystemBackend::SERIAL_NSC) {
+		phySystem->SetSolverWarmStarting(bSolverWarmStarting);
+		if (bPersistentContacts) {
+			auto contacts = std::make_shared<FChPersistentContactContainerNSC>();
+			contacts->SetMatchDistance(PersistentContactMatchDistance);
+			phySystem->SetContactContainer(contacts);
+		}
+		else {
+			phySystem->SetContactContainer(std::make_shared<FChPooledContactContainerNSC>());
+		}
+	}
+	phySystem->SetUseSleeping(bUseSleeping);
+
+	if (auto iterativeSolver = std::dynamic_pointer_cast<chrono::ChIterativeSolver>(phySystem->GetSolver())) {
+		// The violation history is what AdaptSolverIterations reads the residual from, off it isn't written
+		// every iteration
+		iterativeSolver->SetRecordViolation(bAdaptiveSolverIterations || bRecordSolverResidual);
+		if (bAdaptiveSolverIterations) {
+			phySystem->SetTolForce(SolverForceTolerance);
+			phySystem->SetMaxItersSolverSpeed(FMath::Clamp(MinItersSolverSpeed, 1, MaxItersSolverSpeed));
+		}
+	}
 
 	if (bSetDefaultCollisionParameter) {
 		chrono::collision::ChCollisionModel::SetDefaultSuggestedEnvelope(DefaultSuggestedEnvelope);
@@ -62,36 +571,343 @@ void AChPhysicsSceneManagerActor::SystemInitialize()
 		chrono::collision::ChCollisionSystemBullet::SetContactBreakingThreshold(SetContactBreakingThreshold);
 	}
 
+	// Read by the bodies while they build their shapes, which comes after this
+	FChEnvelopeTuning envelopeTuning;
+	envelopeTuning.bEnabled = bAutoCollisionEnvelope && SystemBackend != EChSystemBackend::PARALLEL_NSC && SystemBackend != EChSystemBackend::PARALLEL_SMC;
+	envelopeTuning.SizeFraction = EnvelopeSizeFraction;
+	envelopeTuning.MarginFraction = MarginSizeFraction;
+	envelopeTuning.MinEnvelope = MinCollisionEnvelope;
+	envelopeTuning.SpeedLimit = EnvelopeSpeedLimit;
+	envelopeTuning.StepLength = (bUseFixedTimestep ? FixedStepLengthms : MaxStepLengthms) / 1000;
+	FChCollisionEnvelope::SetTuning(envelopeTuning);
+	memoryStats.Reset();
+	FChLODSettings lodSettings;
+	lodSettings.ReducedDistance = LODReducedDistance / CHRONO_SCALE;
+	lodSettings.FrozenDistance = FMath::Max(LODFrozenDistance, LODReducedDistance) / CHRONO_SCALE;
+	lodSettings.Hysteresis = LODHysteresis;
+	lodSettings.RestSpeed = LODRestSpeed / CHRONO_SCALE;
+	lodSettings.RestTime = LODRestTime;
+	physicsLOD.Reset();
+	physicsLOD.SetSettings(lodSettings);
+	lodStepCounter = 0;
+	lodElapsed = 0;
+
+	if (SystemBackend == EChSystemBackend::PARALLEL_NSC || SystemBackend == EChSystemBackend::PARALLEL_SMC) {
+		ParallelSystemInitialize();
+		staticColliders.reset();
+		feaContacts.reset();
+		continuousCollision.reset();
+		collisionGroupFilter.reset();
+	}
+	else {
+		// The parallel systems run their own narrowphase and never call the callback
+		staticColliders = std::make_shared<FChStaticColliderSet>();
+		phySystem->RegisterCustomCollisionCallback(staticColliders.get());
+		feaContacts = std::make_shared<FChFEAContactSet>();
+		phySystem->RegisterCustomCollisionCallback(feaContacts.get());
+		continuousCollision = std::make_shared<FChContinuousCollision>();
+		continuousCollision->SetStaticColliders(staticColliders.get());
+		collisionGroupFilter = std::make_shared<FChCollisionGroupFilter>();
+		collisionGroupFilter->Install(phySystem.get());
+	}
+	multirateSprings.reset();
+	gpuWorld.reset();
+	domains.reset();
+	breakableLinks.reset();
+	breakableActors.Reset();
+	pendingBreaks.Reset();
+	materialRevision = 0;
+}
+
+void AChPhysicsSceneManagerActor::ParallelSystemInitialize()
+{
+	auto parallelSystem = std::dynamic_pointer_cast<chrono::ChSystemParallel>(this->phySystem);
+	if (!parallelSystem) {
+		return;
+	}
+
+	int threads = ParallelThreadCount > 0 ? ParallelThreadCount : GetChronoThreadBudget();
+	parallelSystem->SetParallelThreadNumber(threads);
+
+	// Only before the first body, the collision system then holds the models
+	const bool bBatchedNarrowphase = NarrowphaseAlgorithm == EChNarrowphase::BATCHED;
+	if ((bSortedAABBPass || bBatchedNarrowphase) && parallelSystem->data_manager->num_rigid_bodies == 0) {
+		auto collisionSystem = std::make_shared<FChSortedAABBCollisionSystem>(parallelSystem->data_manager);
+		collisionSystem->SetSortedAABB(bSortedAABBPass);
+		collisionSystem->SetBatchedNarrowphase(bBatchedNarrowphase);
+		parallelSystem->SetCollisionSystem(collisionSystem);
+	}
+
+	auto settings = parallelSystem->GetSettings();
+	settings->min_threads = threads;
+	settings->max_threads = threads;
+	settings->perform_thread_tuning = false;
+	settings->solver.precondition = bPreconditionSolver;
+
+	settings->collision.bins_per_axis = chrono::vec3(BinsPerAxis.X, BinsPerAxis.Y, BinsPerAxis.Z);
+	settings->collision.fixed_bins = bFixedBins || bAdaptiveBins;
+	currentBins = BinsPerAxis;
+	switch (NarrowphaseAlgorithm) {
+	case EChNarrowphase::ANALYTIC:
+		settings->collision.narrowphase_algorithm = chrono::NarrowPhaseType::NARROWPHASE_R;
+		break;
+	case EChNarrowphase::MPR:
+		settings->collision.narrowphase_algorithm = chrono::NarrowPhaseType::NARROWPHASE_MPR;
+		break;
+	default:
+		// BATCHED too, for the scenes that go through the stock pass
+		settings->collision.narrowphase_algorithm = chrono::NarrowPhaseType::NARROWPHASE_HYBRID_MPR;
+		break;
+	}
+	if (bSetDefaultCollisionParameter) {
+		settings->collision.collision_envelope = DefaultSuggestedEnvelope;
+	}
+
+	settings->collision.use_aabb_active = bUseFreezeBox;
+	if (bUseFreezeBox) {
+		auto boxMin = FVECTOR_TO_CHRONO_VEC(FreezeBoxMin);
+		auto boxMax = FVECTOR_TO_CHRONO_VEC(FreezeBoxMax);
+		settings->collision.aabb_min = chrono::real3(FMath::Min(boxMin.x(), boxMax.x()), FMath::Min(boxMin.y(), boxMax.y()), FMath::Min(boxMin.z(), boxMax.z()));
+		settings->collision.aabb_max = chrono::real3(FMath::Max(boxMin.x(), boxMax.x()), FMath::Max(boxMin.y(), boxMax.y()), FMath::Max(boxMin.z(), boxMax.z()));
+	}
+
+	settings->solver.tolerance = ParallelSolverTolerance;
+	settings->solver.contact_recovery_speed = ContactRecoverySpeed;
+	settings->solver.max_iteration_bilateral = MaxItersSolverSpeed;
+	// The solver applies D^T (M^-1 D x) as two products; assembling N would build the dense contact coupling
+	settings->solver.compute_N = false;
+	settings->solver.use_full_inertia_tensor = !bParallelDiagonalInertia;
+
+	if (SystemBackend == EChSystemBackend::PARALLEL_NSC) {
+		settings->solver.solver_mode = chrono::SolverMode::SLIDING;
+		settings->solver.max_iteration_normal = FMath::Max(ParallelNormalPrepassIterations, 0);
+		settings->solver.max_iteration_sliding = MaxItersSolverSpeed;
+		settings->solver.max_iteration_spinning = 0;
+		std::static_pointer_cast<chrono::ChSystemParallelNSC>(parallelSystem)->ChangeSolverType(chrono::SolverType::APGD);
+		if (bThreadedShurProduct) {
+			FChThreadedShurSolver::Install(parallelSystem.get(), ThreadedShurMinRows);
+		}
+	}
+	else {
+		settings->solver.contact_force_model = chrono::ChSystemSMC::Hertz;
+		settings->solver.tangential_displ_mode = chrono::ChSystemSMC::OneStep;
+		settings->solver.use_material_properties = true;
+	}
+
 
 }
 
 void AChPhysicsSceneManagerActor::FetchPhysicsObject()
 {
-	TActorIterator<AActor> actorItr = TActorIterator<AActor>(GetWorld());
+	auto registry = FChPhysicsObjectRegistry::Get(GetWorld());
+	if (registry) {
+		this->PhysicsObjectList.Reserve(registry->GetObjects().Num());
+		for (auto object : registry->GetObjects()) {
+			if (registry->FindScene(object) == this) {
+				this->PhysicsObjectList.Add(object);
+			}
+		}
+		registryAddedHandle = registry->OnAdded.AddUObject(this, &AChPhysicsSceneManagerActor::OnObjectRegistered);
+		registryRemovedHandle = registry->OnRemoved.AddUObject(this, &AChPhysicsSceneManagerActor::OnObjectUnregistered);
+		levelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &AChPhysicsSceneManagerActor::OnLevelStreamingChanged);
+		levelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &AChPhysicsSceneManagerActor::OnLevelStreamingChanged);
+	}
 
-	for (actorItr; actorItr; ++actorItr) {
-		IChPhysicsObjectInterface* phyObject = Cast<IChPhysicsObjectInterface>(*actorItr);
-		if (phyObject) {
-			this->PhysicsObjectList.Add(*actorItr);
+	// Editor worlds have no registry, the editor preview finds its objects this way
+	if (bScanWorldForObjects || !registry) {
+		TActorIterator<AActor> actorItr = TActorIterator<AActor>(GetWorld());
+
+		for (actorItr; actorItr; ++actorItr) {
+			IChPhysicsObjectInterface* phyObject = Cast<IChPhysicsObjectInterface>(*actorItr);
+			if (phyObject) {
+				if (!registry || (!registry->Contains(*actorItr) && registry->FindScene(*actorItr) == this)) {
+					this->PhysicsObjectList.Add(*actorItr);
+				}
+			}
+			else {
+				for (auto compPtr : actorItr->GetComponents()) {
+					IChPhysicsObjectInterface* phyObject = Cast<IChPhysicsObjectInterface>(compPtr);
+					if (phyObject && (!registry || (!registry->Contains(compPtr) && registry->FindScene(compPtr) == this))) {
+						this->PhysicsObjectList.Add(compPtr);
+					}
+				}
+			}
 		}
-		else {
-			for (auto compPtr : actorItr->GetComponents()) {
-				IChPhysicsObjectInterface* phyObject = Cast<IChPhysicsObjectInterface>(compPtr);
-				if (phyObject) {
-					this->PhysicsObjectList.Add(compPtr);
+	}
+	RebuildObjectIndices();
+}
+
+void AChPhysicsSceneManagerActor::RebuildObjectIndices()
+{
+	objectIndices.Reset();
+	objectIndices.Reserve(PhysicsObjectList.Num());
+	for (int32 i = 0; i < PhysicsObjectList.Num(); i++) {
+		objectIndices.Add(PhysicsObjectList[i].GetObject(), i);
+	}
+}
+
+void AChPhysicsSceneManagerActor::OnObjectRegistered(UObject* object)
+{
+	auto registry = FChPhysicsObjectRegistry::Get(GetWorld());
+	if (registry && registry->FindScene(object) == this) {
+		pendingObjects.Add(object);
+	}
+}
+
+void AChPhysicsSceneManagerActor::OnObjectUnregistered(UObject* object)
+{
+	int32 pendingIndex = pendingObjects.IndexOfByPredicate([object](const TScriptInterface<IChPhysicsObjectInterface>& pending) {
+		return pending.GetObject() == object;
+	});
+	if (pendingIndex != INDEX_NONE) {
+		pendingObjects.RemoveAtSwap(pendingIndex);
+		return;
+	}
+	if (objectIndices.Contains(object)) {
+		pendingRemovals.Add(object);
+	}
+}
+
+void AChPhysicsSceneManagerActor::AddPendingObjects()
+{
+	bool bParallel = SystemBackend == EChSystemBackend::PARALLEL_NSC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+	bool bSMC = SystemBackend == EChSystemBackend::SERIAL_SMC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+	TArray<TScriptInterface<IChPhysicsObjectInterface>> batch = MoveTemp(pendingObjects);
+	pendingObjects.Reset();
+
+	for (auto& Obj : batch) {
+		Obj->GetIsForParallel() = bParallel;
+		Obj->GetIsForSMC() = bSMC;
+		Obj->SetSleepingParameter(bUseSleeping, SleepTime, SleepMinSpeed, SleepMinAngularSpeed);
+		Obj->PhysicsObjectConstruct();
+	}
+	ParallelFor(batch.Num(), [&batch](int32 i) {
+		batch[i]->PhysicsObjectBuildGeometry();
+	});
+	for (auto& Obj : batch) {
+		Obj->PhysicsObjectInitalize();
+	}
+
+	// Telemetry keeps the channel layout it was allocated with, objects added now don't record
+	{
+		// The syncs below read the body list, it is complete when the scope closes
+		FChBodyBatch bodyBatch(this->phySystem);
+		for (auto& Obj : batch) {
+			Obj->AddToSystem(this->phySystem);
+			Obj->AddToSystem(this->PhysicsObjectList);
+			Obj->CollectPhysicsStateUpdate(PreStepObjectList);
+			objectIndices.Add(Obj.GetObject(), PhysicsObjectList.Add(Obj));
+		}
+	}
+	SyncGpuRigidWorld();
+	SyncColliderProxies();
+	SyncFEAContacts();
+	SyncContinuousCollision();
+	RefreshStaticCollision();
+}
+
+void AChPhysicsSceneManagerActor::RemovePendingObjects()
+{
+	TSet<IChPhysicsObjectInterface*> removed;
+	removed.Reserve(pendingRemovals.Num());
+	{
+		// A streamed out level takes its bodies out in one pass over the body list
+		FChBodyBatch bodyBatch(this->phySystem);
+		for (auto object : pendingRemovals) {
+			int32* index = objectIndices.Find(object);
+			if (index) {
+				IChPhysicsObjectInterface* phyObject = PhysicsObjectList[*index].GetInterface();
+				auto body = Cast<UChBodyComponent>(object);
+				if (domains && body && body->GetChData()) {
+					// Back into phySystem, where the object removes it from
+					domains->Reclaim(body->GetChData().get());
+				}
+				phyObject->RemoveFromSystem(this->phySystem);
+				removed.Add(phyObject);
+				if (staticColliders && body && body->GetChData()) {
+					staticColliders->RemoveMesh(body->GetChData().get());
+					staticColliders->RemoveProxy(body->GetChData().get());
+				}
+				if (feaContacts && body && body->GetChData()) {
+					feaContacts->RemoveProxy(body->GetChData().get());
+				}
+				auto feaMesh = Cast<UChFEAMeshComponent>(object);
+				if (feaContacts && feaMesh && feaMesh->bBulkContact) {
+					feaContacts->RemoveSurface(feaMesh->GetBulkContactSurface(SystemBackend == EChSystemBackend::SERIAL_SMC).get());
+				}
+				if (continuousCollision && body && body->GetChData()) {
+					continuousCollision->Remove(body->GetChData().get());
 				}
 			}
 		}
 	}
+	pendingRemovals.Reset();
+	if (removed.Num() == 0) {
+		return;
+	}
+
+	// One compaction pass per list, however many objects the level took with it
+	PhysicsObjectList.RemoveAll([&removed](const TScriptInterface<IChPhysicsObjectInterface>& obj) {
+		return removed.Contains(obj.GetInterface());
+	});
+	PreStepObjectList.RemoveAll([&removed](IChPhysicsObjectInterface* obj) {
+		return removed.Contains(obj);
+	});
+	TelemetryWriterList.RemoveAll([&removed](IChPhysicsObjectInterface* obj) {
+		return removed.Contains(obj);
+	});
+	RebuildObjectIndices();
+	SyncGpuRigidWorld();
+	RefreshStaticCollision();
+}
+
+void AChPhysicsSceneManagerActor::FlushPendingObjects()
+{
+	if (constructionPhase != EChConstructionPhase::READY || (pendingObjects.Num() == 0 && pendingRemovals.Num() == 0)) {
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_ChronoFlushPending);
+	WaitForPhysicsStep();
+	int32 added = pendingObjects.Num();
+	int32 removed = pendingRemovals.Num();
+	RemovePendingObjects();
+	if (pendingObjects.Num()) {
+		AddPendingObjects();
+		if (domains) {
+			domains->Refresh(GetDomainExcludedBodies());
+		}
+	}
+	CH_TRACE(SCENE, LOG, GetFName(), "%d objects added, %d removed, %d bodies in the system", added, removed, (int32)phySystem->Get_bodylist().size());
+	RebuildNetBodies();
+	RebuildLODBodies();
+}
+
+void AChPhysicsSceneManagerActor::OnLevelStreamingChanged(ULevel* level, UWorld* world)
+{
+	if (world == GetWorld()) {
+		FlushPendingObjects();
+	}
 }
 
 void AChPhysicsSceneManagerActor::InitPhysicsObject()
 {
+	bool bParallel = SystemBackend == EChSystemBackend::PARALLEL_NSC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+	bool bSMC = SystemBackend == EChSystemBackend::SERIAL_SMC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+
 	for (auto Obj : this->PhysicsObjectList) {
+		// Collision models and materials have to match the system backend
+		Obj->GetIsForParallel() = bParallel;
+		Obj->GetIsForSMC() = bSMC;
+		Obj->SetSleepingParameter(bUseSleeping, SleepTime, SleepMinSpeed, SleepMinAngularSpeed);
 		Obj->PhysicsObjectConstruct();
 		//Obj->PhysicsObjectInitalize();
 	}
 
+	// Mesh conversion and collision shape building don't need the game thread
+	ParallelFor(this->PhysicsObjectList.Num(), [this](int32 i) {
+		this->PhysicsObjectList[i]->PhysicsObjectBuildGeometry();
+	});
+
 	for (auto Obj : this->PhysicsObjectList) {
 		//Obj->PhysicsObjectConstruct();
 		Obj->PhysicsObjectInitalize();
@@ -108,153 +924,1453 @@ void AChPhysicsSceneManagerActor::InitPhysicsObject()
 	//}
 }
 
-void AChPhysicsSceneManagerActor::AddObjectToSystem()
+void AChPhysicsSceneManagerActor::BuildAddOrder()
 {
 	int size = PhysicsObjectList.Num();
-	
-	for (int i = 0; i < size; i++) {
-		PhysicsObjectList[i]->AddToSystem(this->phySystem);
-		PhysicsObjectList[i]->AddToSystem(this->PhysicsObjectList);
-	}
 
-	float mass = 0;
-	for (auto obj : phySystem->Get_bodylist()) {
-		if (!obj->GetBodyFixed()) {
-			mass += obj->GetMass();
+	addOrder.Reset();
+	if (bSpatialBodyOrder) {
+		TArray<FVector> locations;
+		locations.Reserve(size);
+		for (auto& obj : PhysicsObjectList) {
+			auto actor = Cast<AActor>(obj.GetObject());
+			auto component = Cast<UActorComponent>(obj.GetObject());
+			if (!actor && component) {
+				actor = component->GetOwner();
+			}
+			locations.Add(actor ? actor->GetActorLocation() : FVector::ZeroVector);
 		}
+		addOrder = ChMortonOrder::SortedIndices(locations);
+		return;
+	}
+	addOrder.SetNumUninitialized(size);
+	for (int i = 0; i < size; i++) {
+		addOrder[i] = i;
 	}
-
-	UE_LOG(LogTemp, Warning, TEXT("Total Mass: %f"), mass);
 }
 
-void AChPhysicsSceneManagerActor::StepPhysics(float deltaTime)
+void AChPhysicsSceneManagerActor::AddObjectToSystemAt(int32 orderIndex)
 {
-	for (int i = 0; i < Substep; i++) {
-		this->phySystem->DoStepDynamics(deltaTime / Substep <= MaxStepLengthms / 1000 ? deltaTime / Substep : MaxStepLengthms / 1000);
+	int index = addOrder[orderIndex];
+	FChBodyBatch batch(this->phySystem);
+	PhysicsObjectList[index]->AddToSystem(this->phySystem);
+	PhysicsObjectList[index]->AddToSystem(this->PhysicsObjectList);
+}
 
-		for (auto body : this->PhysicsObjectList) {
-			body->UpdatePhysicsState();
-		}
+void AChPhysicsSceneManagerActor::AddObjectToSystem()
+{
+	BuildAddOrder();
+	// The per object batches join this one
+	FChBodyBatch batch(this->phySystem);
+	for (int i = 0; i < addOrder.Num(); i++) {
+		AddObjectToSystemAt(i);
 	}
 }
 
-const TMap<FName, FExportData> AChPhysicsSceneManagerActor::ExportData()
+void AChPhysicsSceneManagerActor::FinishConstruction()
 {
-	TMap<FName, FExportData> data;
-
+	PreStepObjectList.Reset();
 	for (auto obj : PhysicsObjectList) {
-		if (obj->GetIsExportData()) {
-			data.Add(obj->GetExportDataOwnerName(), obj->ExportData());
+		obj->CollectPhysicsStateUpdate(PreStepObjectList);
+	}
+
+	telemetry.Reset();
+	TelemetryWriterList.Reset();
+	if (bRecordTelemetry) {
+		for (auto obj : PhysicsObjectList) {
+			obj->RegisterTelemetry(telemetry, TelemetryWriterList);
 		}
+		telemetry.Allocate(TelemetryFrameCapacity);
 	}
 
-	return data;
+	if (CH_TRACE_ACTIVE(SCENE, LOG)) {
+		double mass = 0;
+		for (auto obj : phySystem->Get_bodylist()) {
+			if (!obj->GetBodyFixed() && !FChKinematicBody::IsKinematic(*obj)) {
+				mass += obj->GetMass();
+			}
+		}
+		CH_TRACE(SCENE, LOG, GetFName(), "total mass %.3f kg", mass);
+	}
+
+	SyncGpuRigidWorld();
+	SyncColliderProxies();
+	SyncFEAContacts();
+	SyncContinuousCollision();
+	RefreshStaticCollision();
+
+	snapshots.Reset();
+	for (int i = 0; i < SnapshotSlotCount; i++) {
+		snapshots.Add(MakeUnique<FChSceneSnapshot>());
+		snapshots.Last()->Allocate(this->phySystem.get());
+	}
+	SetupDomains();
+	RebuildNetBodies();
+	RebuildLODBodies();
 }
 
-class saveContactDataCallback : public chrono::ChContactContainer::ReportContactCallback
-{
-public:
-	std::vector<chrono::ChVector<>> forceList;
-	std::vector<chrono::ChVector<>> forcePosList;
-	std::vector<chrono::ChMatrix33<>> forceRotList;
-	std::vector<chrono::ChContactable*> contactObjList;
-
-public:
-	virtual bool OnReportContact(const chrono::ChVector<>& pA,
-		const chrono::ChVector<>& pB,
-		const chrono::ChMatrix33<>& plane_coord,
-		const double& distance,
-		const double& eff_Radius,
-		const chrono::ChVector<>& react_forces,
-		const chrono::ChVector<>& react_torques,
-		chrono::ChContactable* modA,
-		chrono::ChContactable* modB) override {
-
-		forcePosList.push_back((pA + pB) / 2.0f);
-		forceList.push_back(react_forces);
-		forceRotList.push_back(plane_coord);
-		contactObjList.push_back(modA);
-		contactObjList.push_back(modB);
-		return true;  // to continue scanning contacts
-	}
-
-	virtual void clearAllData() {
-		forceList.clear();
-		forcePosList.clear();
-		contactObjList.clear();
-	}
-};
-
-//TArray<FVector> AChPhysicsSceneManagerActor::ReportContactDataWithSpecifyBody(AActor * specifyBody, ATrackActor * vehicle)
-//{
-//	saveContactDataCallback contactData;
-//	contactData.clearAllData();
-//	TArray<FVector> trackPos;
-//	TArray<float> distance;
-//	distance.Init(0, 4);
-//	TArray<FVector> trackForce;
-//	trackForce.Init(FVector(0, 0, 0), 4);
-//	for (auto track : vehicle->Tracks) {
-//		trackPos.Add(CHRONO_VEC_TO_FVECTOR(track->Truss->ChComp->GetChData()->GetPos()));
-//	}
-//
-//	UChBodyComponent* comp = Cast<UChBodyComponent>(specifyBody->GetComponentByClass(UChBodyComponent::StaticClass()));
-//	if (!comp) {
-//		return trackForce;
-//	}
-//
-//	phySystem->GetContactContainer()->ReportAllContacts(&contactData);
-//	int num = 0;
-//	auto bodyPtr = comp->GetChData();
-//
-//	FVector forceSum;
-//	for (int i = 0; i < contactData.forcePosList.size(); i++) {
-//		if (std::dynamic_pointer_cast<chrono::ChContactable>(bodyPtr).get() == contactData.contactObjList[2 * i] || std::dynamic_pointer_cast<chrono::ChContactable>(bodyPtr).get() == contactData.contactObjList[2 * i + 1]) {
-//			num++;
-//			FVector start = CHRONO_VEC_TO_FVECTOR((contactData.forcePosList[i]));
-//			FVector force_original = CHRONO_VEC_TO_FVECTOR((contactData.forceList[i])) / 100.0f;
-//			
-//			if (force_original.Size() >= 0.5) {
-//				FVector force = CHRONO_VEC_TO_FVECTOR((contactData.forceRotList[i].Get_A_quaternion().Rotate(contactData.forceList[i]))) / 100.0f;
-//				if (force.Z <= 0) {
-//					force *= -1;
-//				}
-//				//force.RotateAngleAxis(-90, FVector(0, 1, 0));
-//				//UE_LOG(LogTemp, Warning, TEXT("Force_Original %s"), *force_original.ToString());
-//				//UE_LOG(LogTemp, Warning, TEXT("Force %s"), *force.ToString());
-//				FVector end = start + force;
-//				//FVector end = start + FVector(0, 0, 100);
-//				DrawDebugLine(GetWorld(), start, end, FColor::Red, false, -1.0f, 0, 1.0f);
-//				forceSum += force;
-//
-//				for (int i = 0; i < 4; i++) {
-//					distance[i] = (trackPos[i] - start).Size();
-//				}
-//				for (int i = 0; i < 4; i++) {
-//					bool isMinimum = true;
-//
-//					for (int j = 1; j < 4; j++) {
-//						if (distance[i] > distance[(i + j) % 4]) {
-//							isMinimum = false;
-//							break;
-//						}
-//					}
-//					if (isMinimum) {
-//						trackForce[i] += force;
-//					}
-//				}
-//			}
-//		}
-//	}
-//
-//
-//	//UE_LOG(LogTemp, Warning, TEXT("Sum Force%s"), *forceSum.ToString());
-//
-//	return trackForce;
-//	//else if (Cast<UChBody_SCMTerrainComponent>(specifyBody->GetComponentByClass(UChBody_SCMTerrainComponent::StaticClass()))) {
-//	//	//UE_LOG(LogTemp, Warning, TEXT("SCM Terrain"));
-//	//	auto terrain = Cast<UChBody_SCMTerrainComponent>(specifyBody->GetComponentByClass(UChBody_SCMTerrainComponent::StaticClass()))->ChDataTerrain;
-//	//	FVector forcePoint = CHRONO_VEC_TO_FVECTOR((terrain->GetContactForce(phySystem->Get_bodylist()[15]).force));
-//	//	UE_LOG(LogTemp, Warning, TEXT("SCM Force Point:%s"), *forcePoint.ToString());
-//	//}
-//}
+void AChPhysicsSceneManagerActor::SetupDomains()
+{
+	domains.reset();
+	if (!bDomainDecomposition || gpuWorld || (SystemBackend != EChSystemBackend::SERIAL_NSC && SystemBackend != EChSystemBackend::SERIAL_SMC)) {
+		return;
+	}
+	// Chrono is Y up
+	int32 axis = DomainAxis == EAxis::Y ? 2 : DomainAxis == EAxis::Z ? 1 : 0;
+	domains = std::make_shared<FChDomainDecomposition>();
+	domains->Setup(this->phySystem, DomainCount, axis, DomainGhostWidth / CHRONO_SCALE,
+		[this]() { return CreateDomainSystem(); }, GetDomainExcludedBodies());
+	if (domains->GetDomainNum() < 2) {
+		domains.reset();
+		return;
+	}
+	UE_LOG(LogTemp, Log, TEXT("%s: free bodies split over %d domains"), *GetName(), domains->GetDomainNum());
+}
+
+std::shared_ptr<chrono::ChSystem> AChPhysicsSceneManagerActor::CreateDomainSystem() const
+{
+	std::shared_ptr<chrono::ChSystem> system;
+	if (SystemBackend == EChSystemBackend::SERIAL_SMC) {
+		system = std::make_shared<chrono::ChSystemSMC>();
+		if (bPackedSMCContacts) {
+			system->SetContactContainer(std::make_shared<FChPackedContactContainerSMC>());
+		}
+	}
+	else {
+		system = std::make_shared<chrono::ChSystemNSC>();
+		system->SetContactContainer(std::make_shared<FChPooledContactContainerNSC>());
+		system->SetSolverType(phySystem->GetSolverType());
+		system->SetSolverWarmStarting(phySystem->GetSolverWarmStarting());
+	}
+	system->SetTimestepperType(phySystem->GetTimestepperType());
+	system->Set_G_acc(phySystem->Get_G_acc());
+	system->SetMaxItersSolverSpeed(phySystem->GetMaxItersSolverSpeed());
+	system->SetMaxItersSolverStab(phySystem->GetMaxItersSolverStab());
+	system->SetTolForce(phySystem->GetTolForce());
+	system->SetMinBounceSpeed(phySystem->GetMinBounceSpeed());
+	system->SetMaxPenetrationRecoverySpeed(phySystem->GetMaxPenetrationRecoverySpeed());
+	system->SetUseSleeping(phySystem->GetUseSleeping());
+	system->SetChTime(phySystem->GetChTime());
+	return system;
+}
+
+TSet<chrono::ChBody*> AChPhysicsSceneManagerActor::GetDomainExcludedBodies() const
+{
+	// Continuous collision sweeps against phySystem only, and the static collider and FEA contact sets are
+	// custom collision callbacks of phySystem, the proxies they collide have to stay in it. Kinematic bodies
+	// are driven in phySystem, the domains see them through their mirrors
+	TSet<chrono::ChBody*> excluded;
+	for (auto& obj : PhysicsObjectList) {
+		auto body = Cast<UChBodyComponent>(obj.GetObject());
+		chrono::ChBody* chBody = body ? body->GetChData().get() : nullptr;
+		if (!chBody) {
+			continue;
+		}
+		if (body->bKinematic || body->GetCCDRadius() > 0 || (staticColliders && staticColliders->ContainsProxy(chBody)) || (feaContacts && feaContacts->ContainsProxy(chBody))) {
+			excluded.Add(chBody);
+		}
+	}
+	return excluded;
+}
+
+bool AChPhysicsSceneManagerActor::AdvanceConstruction(float budgetMs)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChronoConstruction);
+	bool bParallel = SystemBackend == EChSystemBackend::PARALLEL_NSC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+	bool bSMC = SystemBackend == EChSystemBackend::SERIAL_SMC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+	double deadline = FPlatformTime::Seconds() + budgetMs * 0.001;
+
+	// Same order of calls as InitPhysicsObject and AddObjectToSystem, one object at a time
+	while (constructionPhase != EChConstructionPhase::READY) {
+		switch (constructionPhase) {
+		case EChConstructionPhase::CONSTRUCT:
+			if (constructionCursor < PhysicsObjectList.Num()) {
+				auto& Obj = PhysicsObjectList[constructionCursor++];
+				Obj->GetIsForParallel() = bParallel;
+				Obj->GetIsForSMC() = bSMC;
+				Obj->SetSleepingParameter(bUseSleeping, SleepTime, SleepMinSpeed, SleepMinAngularSpeed);
+				Obj->PhysicsObjectConstruct();
+			}
+			else {
+				// Doesn't need the game thread at all, the frames go on while it runs
+				geometryTask = Async<void>(EAsyncExecution::ThreadPool, [this]() {
+					ParallelFor(this->PhysicsObjectList.Num(), [this](int32 i) {
+						this->PhysicsObjectList[i]->PhysicsObjectBuildGeometry();
+					});
+				});
+				constructionPhase = EChConstructionPhase::BUILD_GEOMETRY;
+			}
+			break;
+		case EChConstructionPhase::BUILD_GEOMETRY:
+			if (!geometryTask.IsReady()) {
+				return false;
+			}
+			geometryTask.Reset();
+			constructionCursor = 0;
+			constructionPhase = EChConstructionPhase::INITIALIZE;
+			break;
+		case EChConstructionPhase::INITIALIZE:
+			if (constructionCursor < PhysicsObjectList.Num()) {
+				PhysicsObjectList[constructionCursor++]->PhysicsObjectInitalize();
+			}
+			else {
+				BuildAddOrder();
+				constructionCursor = 0;
+				constructionPhase = EChConstructionPhase::ADD_TO_SYSTEM;
+			}
+			break;
+		case EChConstructionPhase::ADD_TO_SYSTEM:
+			if (constructionCursor < addOrder.Num()) {
+				AddObjectToSystemAt(constructionCursor++);
+			}
+			else {
+				FinishConstruction();
+				constructionPhase = EChConstructionPhase::READY;
+				UE_LOG(LogTemp, Log, TEXT("%s: scene ready, %d objects"), *GetName(), PhysicsObjectList.Num());
+			}
+			break;
+		default:
+			constructionPhase = EChConstructionPhase::READY;
+			break;
+		}
+
+		if (FPlatformTime::Seconds() > deadline) {
+			break;
+		}
+	}
+	return constructionPhase == EChConstructionPhase::READY;
+}
+
+float AChPhysicsSceneManagerActor::GetConstructionProgress() const
+{
+	if (constructionPhase == EChConstructionPhase::READY) {
+		return 1.f;
+	}
+	// The geometry phase has no cursor, it counts as half done while it runs
+	float phaseProgress = constructionPhase == EChConstructionPhase::BUILD_GEOMETRY ? 0.5f
+		: (PhysicsObjectList.Num() ? (float)constructionCursor / PhysicsObjectList.Num() : 1.f);
+	return ((int32)constructionPhase + phaseProgress) / (float)EChConstructionPhase::READY;
+}
+
+void AChPhysicsSceneManagerActor::StepPhysics(float deltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChronoStepPhysics);
+	chrono::CHOMPfunctions::SetNumThreads(ompThreadCount);
+	if (bUseFixedTimestep) {
+		StepPhysicsFixed(deltaTime);
+		return;
+	}
+
+	for (int i = 0; i < Substep; i++) {
+		DoChronoStep(deltaTime / Substep <= MaxStepLengthms / 1000 ? deltaTime / Substep : MaxStepLengthms / 1000);
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ChronoCacheVisualState);
+		for (auto body : this->PhysicsObjectList) {
+			body->CacheVisualState();
+		}
+	}
+
+	AdaptBroadphaseBins();
+	RecordStepOutput();
+}
+
+void AChPhysicsSceneManagerActor::StepPhysicsFixed(float deltaTime)
+{
+	float fixedStep = FixedStepLengthms / 1000;
+	stepAccumulator += deltaTime;
+
+	int steps = FMath::FloorToInt(stepAccumulator / fixedStep);
+	bool bOverBudget = steps > MaxCatchUpSteps;
+	steps = FMath::Min(steps, MaxCatchUpSteps);
+
+	for (int i = 0; i < steps; i++) {
+		DoChronoStep(fixedStep);
+
+		// Interpolation only needs the states around the last step
+		if (i >= steps - 2) {
+			SCOPE_CYCLE_COUNTER(STAT_ChronoCacheVisualState);
+			for (auto body : this->PhysicsObjectList) {
+				body->CacheVisualState();
+			}
+		}
+	}
+
+	if (steps > 0) {
+		AdaptBroadphaseBins();
+		RecordStepOutput();
+	}
+
+	stepAccumulator -= steps * fixedStep;
+	if (bOverBudget) {
+		stepAccumulator = FMath::Fmod(stepAccumulator, fixedStep);
+	}
+	interpolationAlpha = FMath::Clamp(stepAccumulator / fixedStep, 0.f, 1.f);
+}
+
+void AChPhysicsSceneManagerActor::DoChronoStep(double stepSize)
+{
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ChronoDoStepDynamics);
+		UpdatePhysicsLOD(stepSize);
+		if (continuousCollision) {
+			int32 advanced = continuousCollision->Advance(this->phySystem.get(), stepSize);
+			INC_DWORD_STAT_BY(STAT_ChronoCCDAdvanced, advanced);
+		}
+		if (multirateSprings) {
+			multirateSprings->Advance(stepSize);
+		}
+		// The device steps its bodies while Chrono steps the rest
+		if (gpuWorld) {
+			gpuWorld->Step(stepSize);
+		}
+		// Materials of bodies added since the last step join the pair table
+		uint32 revision = FChMaterialLibrary::GetRevision();
+		if (revision != materialRevision) {
+			FChMaterialLibrary::ApplyComposition(this->phySystem.get());
+			if (domains) {
+				for (size_t d = 1; d < domains->GetSystems().size(); d++) {
+					FChMaterialLibrary::ApplyComposition(domains->GetSystems()[d].get());
+				}
+			}
+			materialRevision = revision;
+		}
+		if (domains) {
+			domains->Step(stepSize);
+			SET_DWORD_STAT(STAT_ChronoDomainGhosts, domains->GetGhostNum());
+			SET_DWORD_STAT(STAT_ChronoDomainMigrations, domains->GetLastMigrationNum());
+		}
+		else {
+			this->phySystem->DoStepDynamics(stepSize);
+		}
+		// Before the next substep, so a broken link no longer holds in it
+		if (breakableLinks && breakableLinks->GetLinkNum()) {
+			breakableLinks->Check(this->phySystem->GetChTime());
+		}
+		if (gpuWorld) {
+			gpuWorld->ApplyPoses();
+			SET_DWORD_STAT(STAT_ChronoGpuDroppedContacts, gpuWorld->GetDroppedContactCount());
+		}
+	}
+	if (feaContacts) {
+		SET_DWORD_STAT(STAT_ChronoFEAContacts, feaContacts->GetLastContactCount());
+	}
+	PublishStepStats();
+	AdaptSolverIterations();
+	TrackContactCount();
+	TrackMemory();
+
+	SCOPE_CYCLE_COUNTER(STAT_ChronoUpdatePhysicsState);
+	for (auto obj : this->PreStepObjectList) {
+		obj->UpdatePhysicsState();
+	}
+}
+
+void AChPhysicsSceneManagerActor::PublishStepStats()
+{
+#if STATS
+	INC_FLOAT_STAT_BY(STAT_ChronoTimerStep, phySystem->GetTimerStep() * 1000);
+	INC_FLOAT_STAT_BY(STAT_ChronoTimerCollision, phySystem->GetTimerCollision() * 1000);
+	INC_FLOAT_STAT_BY(STAT_ChronoTimerSetup, phySystem->GetTimerSetup() * 1000);
+	INC_FLOAT_STAT_BY(STAT_ChronoTimerJacobian, phySystem->GetTimerJacobian() * 1000);
+	INC_FLOAT_STAT_BY(STAT_ChronoTimerSolver, phySystem->GetTimerSolver() * 1000);
+	INC_FLOAT_STAT_BY(STAT_ChronoTimerUpdate, phySystem->GetTimerUpdate() * 1000);
+	SET_DWORD_STAT(STAT_ChronoConstraints, phySystem->GetNconstr());
+	SET_DWORD_STAT(STAT_ChronoBodies, phySystem->GetNbodies());
+#endif
+}
+
+void AChPhysicsSceneManagerActor::AdaptSolverIterations()
+{
+	auto solver = std::dynamic_pointer_cast<chrono::ChIterativeSolver>(this->phySystem->GetSolver());
+	if (!solver) {
+		return;
+	}
+
+	auto& history = solver->GetViolationHistory();
+	lastSolverIterations = solver->GetTotalIterations();
+	lastSolverResidual = history.empty() ? 0.f : history.back();
+	SET_DWORD_STAT(STAT_ChronoSolverIterations, lastSolverIterations);
+	SET_FLOAT_STAT(STAT_ChronoSolverResidual, lastSolverResidual);
+
+	if (!bAdaptiveSolverIterations) {
+		return;
+	}
+
+	int minIters = FMath::Clamp(MinItersSolverSpeed, 1, MaxItersSolverSpeed);
+	int cap = this->phySystem->GetMaxItersSolverSpeed();
+	if (lastSolverIterations >= cap) {
+		// Hit the cap without converging: more iterations only help while the residual still drops
+		bool bStalled = history.size() >= 5 && history.back() > 0.9 * history[history.size() - 5];
+		cap = bStalled ? FMath::Max(minIters, cap - cap / 4) : FMath::Min(MaxItersSolverSpeed, cap + cap / 2 + 1);
+	}
+	else if (lastSolverIterations < cap / 2) {
+		// Calm step, let the cap decay back
+		cap = FMath::Max(minIters, cap - 1);
+	}
+	this->phySystem->SetMaxItersSolverSpeed(cap);
+}
+
+void AChPhysicsSceneManagerActor::AdaptBroadphaseBins()
+{
+	if (!bAdaptiveBins) {
+		return;
+	}
+	auto parallelSystem = std::dynamic_pointer_cast<chrono::ChSystemParallel>(this->phySystem);
+	if (!parallelSystem) {
+		return;
+	}
+
+	auto dataManager = parallelSystem->data_manager;
+	auto& measures = dataManager->measures.collision;
+	chrono::real3 diagonal = measures.max_bounding_point - measures.min_bounding_point;
+	double volume = diagonal[0] * diagonal[1] * diagonal[2];
+	if (dataManager->num_rigid_shapes == 0 || volume <= 0) {
+		return;
+	}
+
+	// Bins per unit length so that each bin holds TargetShapesPerBin shapes on average
+	double binsPerLength = FMath::Pow(dataManager->num_rigid_shapes / FMath::Max(TargetShapesPerBin, 0.1f) / volume, 1.0 / 3.0);
+	FIntVector target(
+		FMath::Clamp(FMath::CeilToInt(diagonal[0] * binsPerLength), 1, 512),
+		FMath::Clamp(FMath::CeilToInt(diagonal[1] * binsPerLength), 1, 512),
+		FMath::Clamp(FMath::CeilToInt(diagonal[2] * binsPerLength), 1, 512));
+
+	bool bChanged = false;
+	for (int i = 0; i < 3; i++) {
+		if (FMath::Abs(target[i] - currentBins[i]) > BinHysteresis * currentBins[i]) {
+			bChanged = true;
+		}
+	}
+	if (bChanged) {
+		currentBins = target;
+		dataManager->settings.collision.bins_per_axis = chrono::vec3(currentBins.X, currentBins.Y, currentBins.Z);
+	}
+
+	SET_DWORD_STAT(STAT_ChronoBinsX, currentBins.X);
+	SET_DWORD_STAT(STAT_ChronoBinsY, currentBins.Y);
+	SET_DWORD_STAT(STAT_ChronoBinsZ, currentBins.Z);
+}
+
+void AChPhysicsSceneManagerActor::TrackContactCount()
+{
+	lastContactCount = this->phySystem->GetNcontacts() + (gpuWorld ? gpuWorld->GetContactCount() : 0);
+	if (domains) {
+		for (size_t d = 1; d < domains->GetSystems().size(); d++) {
+			lastContactCount += domains->GetSystems()[d]->GetNcontacts();
+		}
+	}
+	contactHighWater = FMath::Max(contactHighWater, lastContactCount);
+	// Serial NSC: the pools saw every collision pass, substeps included, and only allocate above their marks
+	pooledContactHighWater = 0;
+	pooledContactCount = 0;
+	auto addPool = [this](const std::shared_ptr<chrono::ChSystem>& system) {
+		if (auto pool = std::dynamic_pointer_cast<FChPooledContactContainerNSC>(system->GetContactContainer())) {
+			pooledContactHighWater += pool->GetContactHighWater();
+			pooledContactCount += pool->GetPooledContactNum();
+		}
+	};
+	addPool(this->phySystem);
+	if (domains) {
+		for (size_t d = 1; d < domains->GetSystems().size(); d++) {
+			addPool(domains->GetSystems()[d]);
+		}
+	}
+	contactHighWater = FMath::Max(contactHighWater, pooledContactHighWater);
+	SET_DWORD_STAT(STAT_ChronoContacts, lastContactCount);
+	SET_DWORD_STAT(STAT_ChronoContactHighWater, contactHighWater);
+	SET_DWORD_STAT(STAT_ChronoTunedEnvelopes, FChCollisionEnvelope::GetTunedNum());
+	SET_FLOAT_STAT(STAT_ChronoMeanEnvelope, FChCollisionEnvelope::GetMeanEnvelope() * 1000);
+}
+
+void AChPhysicsSceneManagerActor::TrackMemory()
+{
+#if STATS
+	// Shapes are walked again only when bodies came or went, the rest is read from counts and capacities
+	memoryStats.Measure(*this->phySystem, false);
+	SET_MEMORY_STAT(STAT_ChronoMemoryBodies, memoryStats.GetBytes(EChMemoryCategory::Bodies));
+	SET_MEMORY_STAT(STAT_ChronoMemoryContacts, memoryStats.GetBytes(EChMemoryCategory::Contacts));
+	SET_MEMORY_STAT(STAT_ChronoMemoryShapes, memoryStats.GetBytes(EChMemoryCategory::CollisionShapes));
+	SET_MEMORY_STAT(STAT_ChronoMemoryDescriptor, memoryStats.GetBytes(EChMemoryCategory::Descriptor));
+	SET_MEMORY_STAT(STAT_ChronoMemoryParallel, memoryStats.GetBytes(EChMemoryCategory::ParallelData));
+	SIZE_T peak = 0;
+	for (int32 i = 0; i < EChMemoryCategory::Num; i++) {
+		peak += memoryStats.GetPeakBytes((EChMemoryCategory::Type)i);
+	}
+	SET_MEMORY_STAT(STAT_ChronoMemoryPeak, peak);
+#endif
+}
+
+void AChPhysicsSceneManagerActor::DumpChronoMemory()
+{
+	if (!this->phySystem) {
+		return;
+	}
+	// The step task is the only other user of the system
+	WaitForPhysicsStep();
+	memoryStats.Measure(*this->phySystem, true);
+	memoryStats.Log(GetName());
+}
+
+void AChPhysicsSceneManagerActor::RecordStepOutput()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChronoRecordStepOutput);
+	if (bCollectContacts) {
+		contactBuffer.Refill(this->phySystem.get());
+	}
+
+	if (bRecordTelemetry && TelemetryWriterList.Num()) {
+		telemetry.BeginFrame(this->phySystem->GetChTime());
+		for (auto obj : TelemetryWriterList) {
+			obj->WriteTelemetry(telemetry);
+		}
+		if (outputPipeline) {
+			outputPipeline->Push(this->phySystem->GetChTime(), telemetry.GetCurrentFrame());
+		}
+	}
+}
+
+void AChPhysicsSceneManagerActor::RefreshStaticCollision()
+{
+	auto bulletSystem = std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(this->phySystem->GetCollisionSystem());
+	if (!bulletSystem) {
+		return;
+	}
+
+	WaitForPhysicsStep();
+	auto world = bulletSystem->GetBulletCollisionWorld();
+	world->setForceUpdateAllAabbs(!bIncrementalBroadphase);
+
+	for (auto body : this->phySystem->Get_bodylist()) {
+		auto model = std::dynamic_pointer_cast<chrono::collision::ChModelBullet>(body->GetCollisionModel());
+		if (!model || !model->GetBulletModel()) {
+			continue;
+		}
+
+		auto object = model->GetBulletModel();
+		if (bIncrementalBroadphase && body->GetBodyFixed()) {
+			// Inactive objects are skipped by updateAabbs, and pairs of two inactive objects are never tested
+			world->updateSingleAabb(object);
+			object->setActivationState(ISLAND_SLEEPING);
+		}
+		else {
+			object->forceActivationState(ACTIVE_TAG);
+		}
+	}
+}
+
+void AChPhysicsSceneManagerActor::SyncColliderProxies()
+{
+	if (!staticColliders) {
+		return;
+	}
+
+	for (auto& obj : PhysicsObjectList) {
+		auto triMesh = Cast<UChBody_TriMeshComponent>(obj.GetObject());
+		if (triMesh && triMesh->GetStaticBVH() && triMesh->GetChData() && !staticColliders->ContainsMesh(triMesh->GetChData().get())) {
+			staticColliders->AddMesh(triMesh->GetChData(), triMesh->GetStaticBVH());
+			triMesh->GetChData()->GetCollisionModel()->SetFamily(StaticColliderFamily);
+		}
+	}
+	if (!staticColliders->HasMeshes()) {
+		return;
+	}
+
+	FChColliderProxy proxy;
+	for (auto& obj : PhysicsObjectList) {
+		auto body = Cast<UChBodyComponent>(obj.GetObject());
+		if (!body || !body->GetChData() || body->isFixed || body->bKinematic || !body->GetColliderProxy(proxy) || staticColliders->ContainsProxy(body->GetChData().get())
+			|| (gpuWorld && gpuWorld->Contains(body->GetChData().get()))) {
+			continue;
+		}
+		staticColliders->AddProxy(body->GetChData(), proxy);
+		// Bullet still has the mesh, the pair is left to the BVH
+		body->GetChData()->GetCollisionModel()->SetFamilyMaskNoCollisionWithFamily(StaticColliderFamily);
+	}
+}
+
+void AChPhysicsSceneManagerActor::SyncFEAContacts()
+{
+	if (!feaContacts) {
+		return;
+	}
+
+	bool bSMC = SystemBackend == EChSystemBackend::SERIAL_SMC;
+	for (auto& obj : PhysicsObjectList) {
+		auto feaMesh = Cast<UChFEAMeshComponent>(obj.GetObject());
+		if (!feaMesh || !feaMesh->bBulkContact || !feaMesh->GetMesh()) {
+			continue;
+		}
+		auto surface = feaMesh->GetBulkContactSurface(bSMC);
+		if (!surface || feaContacts->ContainsSurface(surface.get())) {
+			continue;
+		}
+		double radius = feaMesh->ContactRadius / CHRONO_SCALE;
+		if (auto cloud = std::dynamic_pointer_cast<chrono::fea::ChContactSurfaceNodeCloud>(surface)) {
+			feaContacts->AddNodeCloud(cloud, radius);
+		}
+		else if (auto triangles = std::dynamic_pointer_cast<chrono::fea::ChContactSurfaceMesh>(surface)) {
+			feaContacts->AddSurface(triangles, radius);
+		}
+	}
+	if (!feaContacts->HasSurfaces()) {
+		return;
+	}
+
+	// Fixed bodies too, Bullet never sees the surfaces
+	FChColliderProxy proxy;
+	for (auto& obj : PhysicsObjectList) {
+		auto body = Cast<UChBodyComponent>(obj.GetObject());
+		if (!body || !body->GetChData() || !body->GetColliderProxy(proxy) || feaContacts->ContainsProxy(body->GetChData().get())
+			|| (gpuWorld && gpuWorld->Contains(body->GetChData().get()))) {
+			continue;
+		}
+		feaContacts->AddProxy(body->GetChData(), proxy);
+	}
+}
+
+int AChPhysicsSceneManagerActor::GetFEAContactCount() const
+{
+	return feaContacts ? feaContacts->GetLastContactCount() : 0;
+}
+
+void AChPhysicsSceneManagerActor::SyncContinuousCollision()
+{
+	if (!continuousCollision) {
+		return;
+	}
+	for (auto& obj : PhysicsObjectList) {
+		auto body = Cast<UChBodyComponent>(obj.GetObject());
+		double radius = body ? body->GetCCDRadius() : 0;
+		if (radius > 0 && body->GetChData() && !continuousCollision->Contains(body->GetChData().get())) {
+			continuousCollision->Add(body->GetChData(), radius, body->CCDMotionThreshold);
+		}
+	}
+}
+
+void AChPhysicsSceneManagerActor::SyncGpuRigidWorld()
+{
+	bool bNSC = SystemBackend == EChSystemBackend::SERIAL_NSC || SystemBackend == EChSystemBackend::PARALLEL_NSC;
+	if (!bGpuRigidContacts || !bNSC || domains || !FChGpuRigidWorld::IsAvailable()) {
+		return;
+	}
+	// The device can't take bodies once created, the current ones come back to Chrono and it's built anew
+	if (gpuWorld) {
+		gpuWorld->Release();
+		gpuWorld.reset();
+	}
+
+	// Links and sweeps would act on a body Chrono no longer moves
+	TSet<chrono::ChBodyFrame*> linkedBodies;
+	for (auto& link : phySystem->Get_linklist()) {
+		linkedBodies.Add(link->GetBody1());
+		linkedBodies.Add(link->GetBody2());
+	}
+
+	auto world = std::make_shared<FChGpuRigidWorld>();
+	TSet<chrono::ChBody*> obstacles;
+	FChColliderProxy proxy;
+	for (auto& obj : PhysicsObjectList) {
+		auto body = Cast<UChBodyComponent>(obj.GetObject());
+		// Kinematic poses are pushed into the Chrono body, the device wouldn't see them
+		if (!body || !body->GetChData() || !body->isCollide || body->bKinematic || !body->GetColliderProxy(proxy)) {
+			continue;
+		}
+		chrono::ChBody* chBody = body->GetChData().get();
+		// Chrono forces wouldn't move them, and the proxies already colliding on the CPU side stay there
+		if (!body->isFixed && (linkedBodies.Contains(chBody) || body->GetCCDRadius() > 0 || !chBody->GetForceList().empty()
+			|| (staticColliders && staticColliders->ContainsProxy(chBody)) || (feaContacts && feaContacts->ContainsProxy(chBody)))) {
+			continue;
+		}
+		world->Add(body->GetChData(), proxy);
+		if (body->isFixed) {
+			obstacles.Add(chBody);
+		}
+	}
+
+	float envelope = bSetDefaultCollisionParameter ? DefaultSuggestedEnvelope : chrono::collision::ChCollisionModel::GetDefaultSuggestedEnvelope();
+	if (world->GetBodyNum() && world->Create(phySystem.get(), envelope, ContactRecoverySpeed, MaxItersSolverSpeed, GpuContactCapacity)) {
+		gpuWorld = world;
+		UE_LOG(LogTemp, Log, TEXT("%s: %d bodies stepped on the GPU"), *GetName(), gpuWorld->GetBodyNum());
+		int32 unseen = 0;
+		for (auto& obj : phySystem->Get_bodylist()) {
+			if ((obj->GetBodyFixed() || FChKinematicBody::IsKinematic(*obj)) && obj->GetCollide() && !obstacles.Contains(obj.get())) {
+				unseen++;
+			}
+		}
+		if (unseen) {
+			CH_TRACE(SCENE, WARNING, GetFName(), "%d fixed or kinematic colliding bodies aren't sphere or box proxies, the GPU bodies pass through them", unseen);
+		}
+	}
+}
+
+int AChPhysicsSceneManagerActor::GetStaticColliderContactCount() const
+{
+	return staticColliders ? staticColliders->GetLastContactCount() : 0;
+}
+
+bool AChPhysicsSceneManagerActor::AddParticleCloud(std::shared_ptr<FChParticleCloud> cloud)
+{
+	// The parallel systems never call the collision callbacks, the grains would fall through everything
+	if (!cloud || !phySystem || SystemBackend == EChSystemBackend::PARALLEL_NSC || SystemBackend == EChSystemBackend::PARALLEL_SMC) {
+		return false;
+	}
+	phySystem->AddOtherPhysicsItem(cloud);
+	phySystem->RegisterCustomCollisionCallback(cloud.get());
+	particleClouds.Add(cloud);
+	return true;
+}
+
+bool AChPhysicsSceneManagerActor::AddMultirateSpring(std::shared_ptr<chrono::ChLinkSpring> link, double stiffness, double damping)
+{
+	// The parallel systems don't load the forces of other physics items
+	if (!link || !phySystem || SystemBackend == EChSystemBackend::PARALLEL_NSC || SystemBackend == EChSystemBackend::PARALLEL_SMC) {
+		return false;
+	}
+	if (!multirateSprings) {
+		multirateSprings = std::make_shared<FChMultirateSprings>();
+		phySystem->AddOtherPhysicsItem(multirateSprings);
+	}
+	multirateSprings->SetSubsteps(MultirateSubsteps);
+	multirateSprings->AddSpring(link, stiffness, damping);
+	return true;
+}
+
+void AChPhysicsSceneManagerActor::RemoveMultirateSpring(chrono::ChLinkSpring* link)
+{
+	if (multirateSprings) {
+		multirateSprings->RemoveSpring(link);
+	}
+}
+
+int32 AChPhysicsSceneManagerActor::AddBreakableLink(AChLinkActor* link, double breakForce, double breakTorque)
+{
+	if (!link || !link->ChData || !phySystem) {
+		return INDEX_NONE;
+	}
+	if (!breakableLinks) {
+		breakableLinks = std::make_shared<FChBreakableLinks>();
+	}
+	int32 slot = breakableLinks->Add(link->ChData, breakForce, breakTorque);
+	if (slot >= breakableActors.Num()) {
+		breakableActors.SetNumZeroed(slot + 1);
+	}
+	breakableActors[slot] = link;
+	return slot;
+}
+
+void AChPhysicsSceneManagerActor::RemoveBreakableLink(int32 slot)
+{
+	if (breakableLinks && breakableActors.IsValidIndex(slot)) {
+		breakableLinks->Remove(slot);
+		breakableActors[slot] = nullptr;
+	}
+}
+
+int AChPhysicsSceneManagerActor::GetChronoThreadBudget() const
+{
+	int cores = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+	auto registry = FChPhysicsObjectRegistry::Get(GetWorld());
+	int scenes = registry ? FMath::Max(registry->GetSceneCount(), 1) : 1;
+	return FMath::Max(1, (cores - ReservedEngineThreads) / scenes);
+}
+
+void AChPhysicsSceneManagerActor::WaitForPhysicsStep()
+{
+	if (realtimeStepper && !realtimeStepper->IsPaused()) {
+		SCOPE_CYCLE_COUNTER(STAT_ChronoWaitForStep);
+		realtimeStepper->Pause();
+	}
+	if (PhysicsStepTask.IsValid()) {
+		SCOPE_CYCLE_COUNTER(STAT_ChronoWaitForStep);
+		PhysicsStepTask.Wait();
+		PhysicsStepTask.Reset();
+	}
+}
+
+void AChPhysicsSceneManagerActor::TickRealtime()
+{
+	if (!realtimeStepper) {
+		FChRealtimeSettings settings;
+		settings.StepSeconds = FixedStepLengthms / 1000.0;
+		settings.Core = RealtimeCore;
+		settings.SpinSeconds = RealtimeSpinMicroseconds * 1e-6;
+		settings.MaxCatchUpSteps = RealtimeMaxCatchUpSteps;
+		realtimeStepper = MakeUnique<FChRealtimeStepper>(settings, [this](double stepSeconds) { StepRealtime(stepSeconds); });
+	}
+
+	// Components are only read and written while the thread waits at a step boundary, which is at most one step away
+	realtimeStepper->Pause();
+	for (auto body : this->PhysicsObjectList) {
+		body->LatchPhysicsInput();
+	}
+	realtimeInput.GetWriteBuffer() = realtimeInputValues;
+	realtimeInput.Publish();
+
+	// Every object's visuals, and the link breaks, follow the steps taken since the last tick
+	const int32 steps = realtimeStepper->GetStepCount();
+	if (steps != realtimeVisualStep) {
+		realtimeVisualStep = steps;
+		interpolationAlpha = 1;
+		UpdateVisualAsset();
+	}
+	realtimeStepper->Resume();
+}
+
+void AChPhysicsSceneManagerActor::StepRealtime(double stepSeconds)
+{
+	realtimeInput.Update();
+	if (RealtimeInputHandler) {
+		RealtimeInputHandler(realtimeInput.GetReadBuffer());
+	}
+	// One fixed step per call, as RunHeadless does
+	StepPhysics((float)stepSeconds);
+}
+
+void AChPhysicsSceneManagerActor::SetRealtimeInput(int channel, float value)
+{
+	if (channel < 0) {
+		return;
+	}
+	if (channel >= realtimeInputValues.Num()) {
+		realtimeInputValues.SetNumZeroed(channel + 1);
+	}
+	realtimeInputValues[channel] = value;
+}
+
+FChRealtimeStats AChPhysicsSceneManagerActor::GetRealtimeStats() const
+{
+	FChRealtimeStats stats;
+	if (realtimeStepper) {
+		realtimeStepper->GetStats(stats);
+	}
+	return stats;
+}
+
+void AChPhysicsSceneManagerActor::RestartEditorPreview()
+{
+#if WITH_EDITOR
+	if (!previewSnapshot || !previewSnapshot->Restore(phySystem.get())) {
+		return;
+	}
+	for (auto body : phySystem->Get_bodylist()) {
+		body->SetSleeping(false);
+	}
+	ResetVisualsAfterRestore();
+#endif
+}
+
+#if WITH_EDITOR
+namespace {
+	AActor* GetPhysicsObjectActor(UObject* object)
+	{
+		if (auto actor = Cast<AActor>(object)) {
+			return actor;
+		}
+		auto component = Cast<UActorComponent>(object);
+		return component ? component->GetOwner() : nullptr;
+	}
+
+	// Generators spawn their bodies and links as actors of the level while they are built, rebuilding them
+	// in the editor world would leave those actors behind in the level each time
+	bool IsEditorPreviewObject(UObject* object)
+	{
+		return !Cast<APhysicsObjectGeneratorBasis>(object);
+	}
+}
+
+void AChPhysicsSceneManagerActor::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	// Any system setting can change what the preview builds, it starts over from the level on the next tick
+	StopEditorPreview();
+}
+
+void AChPhysicsSceneManagerActor::PreSave(const ITargetPlatform* TargetPlatform)
+{
+	// Saved with the authored poses, the preview builds again on the next tick
+	StopEditorPreview();
+	Super::PreSave(TargetPlatform);
+}
+
+void AChPhysicsSceneManagerActor::Destroyed()
+{
+	StopEditorPreview();
+	Super::Destroyed();
+}
+
+void AChPhysicsSceneManagerActor::TickEditorPreview(float deltaTime)
+{
+	if (GEditor && GEditor->PlayWorld) {
+		return;
+	}
+	if (!previewSnapshot) {
+		StartEditorPreview();
+	}
+	if (previewEdited.Num() || previewMoved.Num()) {
+		ApplyEditorPreviewEdits();
+	}
+	if (phySystem->GetChTime() >= EditorPreviewSeconds) {
+		RestartEditorPreview();
+	}
+
+	for (auto body : this->PhysicsObjectList) {
+		body->LatchPhysicsInput();
+	}
+	// An editor hitch, a shader compile or a modal dialog, doesn't become one long step
+	StepPhysics(FMath::Min(deltaTime, 0.1f));
+	UpdateVisualAsset();
+}
+
+void AChPhysicsSceneManagerActor::StartEditorPreview()
+{
+	double startTime = FPlatformTime::Seconds();
+	SystemInitialize();
+	FetchPhysicsObject();
+	int32 generatorCount = PhysicsObjectList.RemoveAll([](const TScriptInterface<IChPhysicsObjectInterface>& obj) {
+		return !IsEditorPreviewObject(obj.GetObject());
+	});
+	if (generatorCount) {
+		UE_LOG(LogTemp, Log, TEXT("%s: editor preview leaves out %d generators, they only run in Play"), *GetName(), generatorCount);
+	}
+	for (auto& obj : PhysicsObjectList) {
+		CaptureEditorPreviewPose(obj.GetObject());
+	}
+	InitPhysicsObject();
+	AddObjectToSystem();
+	FinishConstruction();
+	constructionPhase = EChConstructionPhase::READY;
+
+	previewSnapshot = MakeUnique<FChSceneSnapshot>();
+	previewSnapshot->Allocate(phySystem.get());
+	previewSnapshot->Save(phySystem.get());
+	previewEditedHandle = FChPhysicsObjectRegistry::OnObjectEdited().AddUObject(this, &AChPhysicsSceneManagerActor::OnEditorPreviewObjectEdited);
+	if (GEngine) {
+		previewMovedHandle = GEngine->OnActorMoved().AddUObject(this, &AChPhysicsSceneManagerActor::OnEditorPreviewActorMoved);
+	}
+	previewPIEHandle = FEditorDelegates::PreBeginPIE.AddUObject(this, &AChPhysicsSceneManagerActor::OnEditorPreviewPreBeginPIE);
+	UE_LOG(LogTemp, Log, TEXT("%s: editor preview of %d objects built in %.1f ms"), *GetName(), PhysicsObjectList.Num(), (FPlatformTime::Seconds() - startTime) * 1e3);
+}
+
+void AChPhysicsSceneManagerActor::StopEditorPreview()
+{
+	if (!previewSnapshot) {
+		return;
+	}
+	FChPhysicsObjectRegistry::OnObjectEdited().Remove(previewEditedHandle);
+	if (GEngine) {
+		GEngine->OnActorMoved().Remove(previewMovedHandle);
+	}
+	FEditorDelegates::PreBeginPIE.Remove(previewPIEHandle);
+	RestoreEditorPreviewPoses(true);
+
+	// Built again from their properties by the next preview or Play
+	for (auto& obj : PhysicsObjectList) {
+		if (obj.GetInterface()) {
+			obj->ResetPhysicsObject();
+		}
+	}
+	PhysicsObjectList.Reset();
+	PreStepObjectList.Reset();
+	TelemetryWriterList.Reset();
+	objectIndices.Reset();
+	pendingObjects.Reset();
+	pendingRemovals.Reset();
+	snapshots.Reset();
+	previewSnapshot.Reset();
+	previewPoses.Reset();
+	previewEdited.Reset();
+	previewMoved.Reset();
+	phySystem.reset();
+}
+
+void AChPhysicsSceneManagerActor::ApplyEditorPreviewEdits()
+{
+	double startTime = FPlatformTime::Seconds();
+	// The snapshot only fits the scene it was saved from, everything goes back to the start before the scene changes
+	previewSnapshot->Restore(phySystem.get());
+	for (auto& moved : previewMoved) {
+		AActor* actor = moved.Get();
+		if (FEditorPreviewPose* pose = actor && actor->GetRootComponent() ? previewPoses.Find(actor) : nullptr) {
+			// Starts from where it was dropped
+			pose->Transform = actor->GetRootComponent()->GetComponentTransform();
+		}
+	}
+	RestoreEditorPreviewPoses(false);
+
+	TSet<UObject*> rebuilt;
+	TSet<AActor*> rebuiltActors;
+	auto rebuild = [&](UObject* object) {
+		if (object && objectIndices.Contains(object) && !rebuilt.Contains(object)) {
+			rebuilt.Add(object);
+			rebuiltActors.Add(GetPhysicsObjectActor(object));
+		}
+	};
+	for (auto& edited : previewEdited) {
+		rebuild(edited.Get());
+	}
+	for (auto& moved : previewMoved) {
+		if (AActor* actor = moved.Get()) {
+			rebuild(actor);
+			for (auto component : actor->GetComponents()) {
+				rebuild(component);
+			}
+		}
+	}
+	previewEdited.Reset();
+	previewMoved.Reset();
+
+	// Links hold the Chrono bodies of their targets, a rebuilt body takes its links along
+	for (auto& obj : PhysicsObjectList) {
+		auto link = Cast<AChLinkActor>(obj.GetObject());
+		if (link && (rebuiltActors.Contains(link->target1) || rebuiltActors.Contains(link->target2))) {
+			rebuild(link);
+		}
+	}
+
+	// Editing a blueprint actor runs its construction script again, which replaces its components
+	for (auto& obj : PhysicsObjectList) {
+		UObject* object = obj.GetObject();
+		auto component = Cast<UActorComponent>(object);
+		if (!object || object->IsPendingKill() || (component && !component->IsRegistered())) {
+			pendingRemovals.Add(object);
+		}
+	}
+	for (UObject* object : rebuilt) {
+		if (!pendingRemovals.Contains(object)) {
+			pendingRemovals.Add(object);
+			Cast<IChPhysicsObjectInterface>(object)->ResetPhysicsObject();
+			pendingObjects.Add(object);
+		}
+	}
+	for (TActorIterator<AActor> it(GetWorld()); it; ++it) {
+		auto addNew = [this](UObject* object) {
+			if (Cast<IChPhysicsObjectInterface>(object) && IsEditorPreviewObject(object) && !objectIndices.Contains(object) && !object->IsPendingKill()) {
+				CaptureEditorPreviewPose(object);
+				pendingObjects.Add(object);
+			}
+		};
+		if (Cast<IChPhysicsObjectInterface>(*it)) {
+			addNew(*it);
+		}
+		else {
+			for (auto component : it->GetComponents()) {
+				addNew(component);
+			}
+		}
+	}
+
+	int32 objectCount = pendingObjects.Num();
+	FlushPendingObjects();
+	previewSnapshot = MakeUnique<FChSceneSnapshot>();
+	previewSnapshot->Allocate(phySystem.get());
+	previewSnapshot->Save(phySystem.get());
+	ResetVisualsAfterRestore();
+	UE_LOG(LogTemp, Log, TEXT("%s: editor preview rebuilt %d objects in %.1f ms"), *GetName(), objectCount, (FPlatformTime::Seconds() - startTime) * 1e3);
+}
+
+void AChPhysicsSceneManagerActor::CaptureEditorPreviewPose(UObject* object)
+{
+	AActor* actor = GetPhysicsObjectActor(object);
+	USceneComponent* root = actor ? actor->GetRootComponent() : nullptr;
+	if (root && !previewPoses.Contains(actor)) {
+		previewPoses.Add(actor, { root->GetComponentTransform(), root->Mobility });
+	}
+}
+
+void AChPhysicsSceneManagerActor::RestoreEditorPreviewPoses(bool bMobility)
+{
+	for (auto& pair : previewPoses) {
+		AActor* actor = pair.Key.Get();
+		USceneComponent* root = actor ? actor->GetRootComponent() : nullptr;
+		if (!root) {
+			continue;
+		}
+		root->SetWorldTransform(pair.Value.Transform, false, nullptr, ETeleportType::TeleportPhysics);
+		if (bMobility) {
+			root->SetMobility(pair.Value.Mobility);
+		}
+	}
+}
+
+void AChPhysicsSceneManagerActor::OnEditorPreviewObjectEdited(UObject* object)
+{
+	if (object && object->GetWorld() == GetWorld()) {
+		previewEdited.Add(object);
+	}
+}
+
+void AChPhysicsSceneManagerActor::OnEditorPreviewActorMoved(AActor* actor)
+{
+	if (actor && actor != this && actor->GetWorld() == GetWorld()) {
+		previewMoved.Add(actor);
+	}
+}
+
+void AChPhysicsSceneManagerActor::OnEditorPreviewPreBeginPIE(bool bIsSimulating)
+{
+	// Play duplicates the editor level, it has to start from the authored poses and mobility
+	StopEditorPreview();
+}
+#endif
+
+const TMap<FName, FExportData> AChPhysicsSceneManagerActor::ExportData()
+{
+	TMap<FName, FExportData> data;
+
+	WaitForPhysicsStep();
+
+	for (auto obj : PhysicsObjectList) {
+		if (obj->GetIsExportData()) {
+			data.Add(obj->GetExportDataOwnerName(), obj->ExportData());
+		}
+	}
+
+	return data;
+}
+
+bool AChPhysicsSceneManagerActor::SaveSnapshot(int slot)
+{
+	WaitForPhysicsStep();
+	if (!snapshots.IsValidIndex(slot)) {
+		return false;
+	}
+	return snapshots[slot]->Save(this->phySystem.get());
+}
+
+bool AChPhysicsSceneManagerActor::RestoreSnapshot(int slot)
+{
+	WaitForPhysicsStep();
+	if (!snapshots.IsValidIndex(slot) || !snapshots[slot]->Restore(this->phySystem.get())) {
+		return false;
+	}
+
+	// Sleeping is not part of the state, let everything settle again from the restored pose
+	for (auto body : this->phySystem->Get_bodylist()) {
+		body->SetSleeping(false);
+	}
+	ResetVisualsAfterRestore();
+	return true;
+}
+
+void AChPhysicsSceneManagerActor::ResetVisualsAfterRestore()
+{
+	stepAccumulator = 0;
+	interpolationAlpha = 1;
+
+	// Twice so the interpolated pose does not blend from before the restore
+	for (auto obj : this->PhysicsObjectList) {
+		obj->CacheVisualState();
+		obj->CacheVisualState();
+	}
+	UpdateVisualAsset();
+}
+
+float AChPhysicsSceneManagerActor::GetSnapshotTime(int slot) const
+{
+	return snapshots.IsValidIndex(slot) && snapshots[slot]->IsValid() ? snapshots[slot]->GetTime() : -1.f;
+}
+
+bool AChPhysicsSceneManagerActor::SaveCheckpoint(const FString& filePath, bool bCompress)
+{
+	WaitForPhysicsStep();
+	if (!this->phySystem) {
+		return false;
+	}
+	// One write at a time, two saves to the same path would interleave
+	if (checkpointTask.IsValid()) {
+		checkpointTask.Wait();
+	}
+	checkpoint.Capture(this->phySystem.get());
+	checkpointTask = checkpoint.SaveAsync(filePath, bCompress);
+	return true;
+}
+
+bool AChPhysicsSceneManagerActor::LoadCheckpoint(const FString& filePath)
+{
+	WaitForPhysicsStep();
+	if (!this->phySystem) {
+		return false;
+	}
+	// Its own instance, the mapping closes when it goes out of scope
+	FChCheckpoint loaded;
+	if (!loaded.Load(filePath) || !loaded.Apply(this->phySystem.get())) {
+		return false;
+	}
+	ResetVisualsAfterRestore();
+	return true;
+}
+
+bool AChPhysicsSceneManagerActor::ExportArchive(const FString& jsonPath, const FString& xmlPath)
+{
+	WaitForPhysicsStep();
+	if (!this->phySystem) {
+		return false;
+	}
+	archiveTasks.RemoveAll([](const TFuture<bool>& task) { return task.IsReady(); });
+
+	FChArchiveSnapshot archive;
+	if (!archive.Capture(this->phySystem.get())) {
+		return false;
+	}
+	if (!jsonPath.IsEmpty()) {
+		archiveTasks.Add(archive.ExportAsync(jsonPath, EChArchiveFormat::JSON));
+	}
+	if (!xmlPath.IsEmpty()) {
+		archiveTasks.Add(archive.ExportAsync(xmlPath, EChArchiveFormat::XML));
+	}
+	return true;
+}
+
+int AChPhysicsSceneManagerActor::DrainTelemetry(TArray<float>& frames, TArray<float>& times)
+{
+	WaitForPhysicsStep();
+	return telemetry.Drain(frames, times);
+}
+
+bool AChPhysicsSceneManagerActor::StartOutputStream(const FString& filePath, int decimation, int ringFrames)
+{
+	// The step pushes into the pipeline, swap it only while no step runs
+	WaitForPhysicsStep();
+	outputPipeline.Reset();
+	if (!bRecordTelemetry || telemetry.GetFrameWidth() == 0) {
+		UE_LOG(LogTemp, Warning, TEXT("AChPhysicsSceneManagerActor: output stream needs bRecordTelemetry and bodies with telemetry channels"));
+		return false;
+	}
+
+	FString path = FPaths::IsRelative(filePath) ? FPaths::Combine(FPaths::ProjectSavedDir(), FString("ChronoRecordings"), filePath) : filePath;
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(path), true);
+	outputPipeline = MakeUnique<FChOutputPipeline>(path, telemetry, 64, ringFrames, decimation);
+	if (!outputPipeline->IsOpen()) {
+		outputPipeline.Reset();
+		return false;
+	}
+	return true;
+}
+
+void AChPhysicsSceneManagerActor::StopOutputStream()
+{
+	WaitForPhysicsStep();
+	outputPipeline.Reset();
+}
+
+int AChPhysicsSceneManagerActor::RunHeadless(float simulatedSeconds, float stepSeconds, const FString& telemetryPath)
+{
+	WaitForPhysicsStep();
+	while (!AdvanceConstruction(FLT_MAX)) {
+	}
+	FlushPendingObjects();
+
+	// The fixed step path would only accumulate, it gets exactly one step per call instead
+	float step = bUseFixedTimestep ? FixedStepLengthms / 1000 : stepSeconds;
+	if (step <= 0) {
+		return 0;
+	}
+	bool bTelemetry = bRecordTelemetry && !telemetryPath.IsEmpty();
+	// Drained before the ring buffer wraps, one frame is recorded per step
+	int drainInterval = FMath::Max(TelemetryFrameCapacity / 2, 1);
+	int steps = FMath::CeilToInt(simulatedSeconds / step);
+	double startTime = FPlatformTime::Seconds();
+
+	for (int i = 0; i < steps; i++) {
+		for (auto body : this->PhysicsObjectList) {
+			body->LatchPhysicsInput();
+		}
+		StepPhysics(step);
+		if (bTelemetry && (i + 1) % drainInterval == 0) {
+			AppendTelemetryToCSV(telemetryPath);
+		}
+	}
+	if (bTelemetry) {
+		AppendTelemetryToCSV(telemetryPath);
+	}
+
+	double wallTime = FPlatformTime::Seconds() - startTime;
+	UE_LOG(LogTemp, Log, TEXT("%s: %d steps, %.2fs simulated in %.2fs (%.1fx real time)"), *GetName(), steps, (float)phySystem->GetChTime(), wallTime, wallTime > 0 ? steps * step / wallTime : 0.0);
+	return steps;
+}
+
+int AChPhysicsSceneManagerActor::TraceRays(const FChRayBatch& batch, FChRayHits& outHits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ChronoTraceRays);
+	WaitForPhysicsStep();
+	return FChRayQuery::Trace(phySystem.get(), batch, outHits);
+}
+
+TArray<FChSweepResult> AChPhysicsSceneManagerActor::RunSweep(const TArray<FChSweepVariant>& variants, float simulatedSeconds, float stepSeconds, const FString& outputDir)
+{
+	TArray<FChSweepResult> results;
+	WaitForPhysicsStep();
+	while (!AdvanceConstruction(FLT_MAX)) {
+	}
+	FlushPendingObjects();
+
+	// Separate from the user slots, the layout is fixed for the whole sweep
+	FChSceneSnapshot base;
+	base.Allocate(phySystem.get());
+	if (!base.Save(phySystem.get())) {
+		return results;
+	}
+
+	struct FMaterialValues {
+		float StaticFriction;
+		float SlidingFriction;
+		float Restitution;
+	};
+	bool bSMC = SystemBackend == EChSystemBackend::SERIAL_SMC || SystemBackend == EChSystemBackend::PARALLEL_SMC;
+	auto readMaterial = [bSMC](chrono::ChBody* body) -> FMaterialValues {
+		if (bSMC) {
+			auto material = body->GetMaterialSurfaceSMC();
+			return { material->GetSfriction(), material->GetKfriction(), material->GetRestitution() };
+		}
+		auto material = body->GetMaterialSurfaceNSC();
+		return { material->GetSfriction(), material->GetKfriction(), material->GetRestitution() };
+	};
+	auto writeMaterial = [bSMC](chrono::ChBody* body, const FMaterialValues& values) {
+		if (bSMC) {
+			auto material = body->GetMaterialSurfaceSMC();
+			material->SetSfriction(values.StaticFriction);
+			material->SetKfriction(values.SlidingFriction);
+			material->SetRestitution(values.Restitution);
+		}
+		else {
+			auto material = body->GetMaterialSurfaceNSC();
+			material->SetSfriction(values.StaticFriction);
+			material->SetKfriction(values.SlidingFriction);
+			material->SetRestitution(values.Restitution);
+		}
+	};
+
+	// Bodies that share a material are written more than once with the same value, which is harmless
+	const auto& bodies = phySystem->Get_bodylist();
+	TArray<FMaterialValues> originalMaterials;
+	originalMaterials.Reserve(bodies.size());
+	for (auto& body : bodies) {
+		originalMaterials.Add(readMaterial(body.get()));
+	}
+	TArray<AChLink_EngineActor*> engines;
+	TArray<float> originalCurveScales;
+	for (auto& obj : this->PhysicsObjectList) {
+		if (auto engine = Cast<AChLink_EngineActor>(obj.GetObject())) {
+			engines.Add(engine);
+			originalCurveScales.Add(engine->CurveScale);
+		}
+	}
+
+	results.Reserve(variants.Num());
+	for (auto& variant : variants) {
+		base.Restore(phySystem.get());
+		for (auto& body : bodies) {
+			body->SetSleeping(false);
+		}
+		for (int32 i = 0; i < (int32)bodies.size(); i++) {
+			FMaterialValues values = originalMaterials[i];
+			values.StaticFriction = variant.bOverrideStaticFriction ? variant.StaticFriction : values.StaticFriction;
+			values.SlidingFriction = variant.bOverrideSlidingFriction ? variant.SlidingFriction : values.SlidingFriction;
+			values.Restitution = variant.bOverrideRestitution ? variant.Restitution : values.Restitution;
+			writeMaterial(bodies[i].get(), values);
+		}
+		for (int32 i = 0; i < engines.Num(); i++) {
+			engines[i]->CurveScale = originalCurveScales[i] * variant.EngineCurveScale;
+		}
+		// Frames of the previous variant
+		telemetry.Drain(telemetryFrames, telemetryTimes);
+		lastTelemetryFrame.Reset();
+		stepAccumulator = 0;
+
+		FString telemetryPath = outputDir.IsEmpty() ? FString() : FPaths::Combine(outputDir, FString::Printf(TEXT("%s_%s.csv"), *GetName(), *variant.Name));
+		double startTime = FPlatformTime::Seconds();
+		RunHeadless(simulatedSeconds, stepSeconds, telemetryPath);
+		if (telemetryPath.IsEmpty() && telemetry.Drain(telemetryFrames, telemetryTimes) > 0) {
+			lastTelemetryFrame.Append(telemetryFrames.GetData() + telemetryFrames.Num() - telemetry.GetFrameWidth(), telemetry.GetFrameWidth());
+		}
+
+		FChSweepResult& result = results.AddDefaulted_GetRef();
+		result.Name = variant.Name;
+		result.SimulatedTime = phySystem->GetChTime() - base.GetTime();
+		result.WallSeconds = FPlatformTime::Seconds() - startTime;
+		result.FinalFrame = lastTelemetryFrame;
+	}
+
+	// Leave the scene as it was built
+	base.Restore(phySystem.get());
+	for (int32 i = 0; i < (int32)bodies.size(); i++) {
+		writeMaterial(bodies[i].get(), originalMaterials[i]);
+	}
+	for (int32 i = 0; i < engines.Num(); i++) {
+		engines[i]->CurveScale = originalCurveScales[i];
+	}
+	return results;
+}
+
+bool AChPhysicsSceneManagerActor::AppendTelemetryToCSV(const FString& filePath)
+{
+	WaitForPhysicsStep();
+
+	int count = telemetry.Drain(telemetryFrames, telemetryTimes);
+	int width = telemetry.GetFrameWidth();
+	if (count > 0) {
+		lastTelemetryFrame.SetNumUninitialized(width, false);
+		FMemory::Memcpy(lastTelemetryFrame.GetData(), telemetryFrames.GetData() + (count - 1) * width, width * sizeof(float));
+	}
+	bool bNewFile = !FPlatformFileManager::Get().GetPlatformFile().FileExists(*filePath);
+	if (count == 0 && !bNewFile) {
+		return true;
+	}
+
+	// The string buffer is reused between calls
+	telemetryCSV.Reset();
+	if (bNewFile) {
+		telemetryCSV += TEXT("Time");
+		for (int c = 0; c < telemetry.GetChannelNum(); c++) {
+			for (int k = 0; k < telemetry.GetChannelWidth(c); k++) {
+				telemetryCSV += FString::Printf(TEXT(",%s[%d]"), *telemetry.GetChannelName(c).ToString(), k);
+			}
+		}
+		telemetryCSV += LINE_TERMINATOR;
+	}
+	for (int i = 0; i < count; i++) {
+		telemetryCSV += FString::SanitizeFloat(telemetryTimes[i]);
+		for (int k = 0; k < width; k++) {
+			telemetryCSV += TEXT(",");
+			telemetryCSV += FString::SanitizeFloat(telemetryFrames[i * width + k]);
+		}
+		telemetryCSV += LINE_TERMINATOR;
+	}
+
+	return FFileHelper::SaveStringToFile(telemetryCSV, *filePath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+int AChPhysicsSceneManagerActor::GetContactCount()
+{
+	WaitForPhysicsStep();
+	return contactBuffer.Num();
+}
+
+int AChPhysicsSceneManagerActor::QueryBodyContacts(UChBodyComponent* body, TArray<FVector>& positions, TArray<FVector>& normals, TArray<FVector>& forces)
+{
+	WaitForPhysicsStep();
+	if (!body || !body->GetChData()) {
+		positions.Reset();
+		normals.Reset();
+		forces.Reset();
+		return 0;
+	}
+	return contactBuffer.QueryItem(body->GetChData().get(), positions, normals, forces);
+}
+
+int AChPhysicsSceneManagerActor::QueryFamilyContacts(int family, TArray<FVector>& positions, TArray<FVector>& normals, TArray<FVector>& forces)
+{
+	WaitForPhysicsStep();
+	return contactBuffer.QueryFamily(family, positions, normals, forces);
+}
+
+FVector AChPhysicsSceneManagerActor::GetBodyContactForce(UChBodyComponent* body)
+{
+	WaitForPhysicsStep();
+	if (!body || !body->GetChData()) {
+		return FVector::ZeroVector;
+	}
+	return contactBuffer.SumItemForce(body->GetChData().get());
+}
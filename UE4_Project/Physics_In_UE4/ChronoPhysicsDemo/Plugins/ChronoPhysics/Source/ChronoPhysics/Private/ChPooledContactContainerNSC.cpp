@@ -0,0 +1,144 @@
+#include "ChPooledContactContainerNSC.h"
+#include "ChPhysicsStats.h"
+#include "ChKinematicBody.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "chrono/physics/ChBody.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pooled Contacts"), STAT_ChronoPooledContacts, STATGROUP_ChronoPhysics);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pooled Contacts High Water"), STAT_ChronoPooledContactHighWater, STATGROUP_ChronoPhysics);
+
+namespace {
+	// Moves the contacts from first on to the parked list, first then points past the active ones
+	template <class T>
+	void Park(std::list<T*>& active, typename std::list<T*>::iterator& first, std::list<T*>& parked)
+	{
+		parked.splice(parked.end(), active, first, active.end());
+		first = active.end();
+	}
+
+	// Behind the contacts of the last step, the pass reuses them in order before it allocates
+	template <class T>
+	void Unpark(std::list<T*>& active, std::list<T*>& parked)
+	{
+		active.splice(active.end(), parked);
+	}
+
+	bool IsImmovable(chrono::collision::ChCollisionModel* model)
+	{
+		auto body = model ? dynamic_cast<chrono::ChBody*>(model->GetContactable()) : nullptr;
+		return body && (body->GetBodyFixed() || FChKinematicBody::IsKinematic(*body));
+	}
+
+	template <class T>
+	void DeleteAll(std::list<T*>& list)
+	{
+		for (T* contact : list) {
+			delete contact;
+		}
+		list.clear();
+	}
+}
+
+FChPooledContactContainerNSC::~FChPooledContactContainerNSC()
+{
+	// The active lists go with ChContactContainerNSC
+	DeleteAll(parked_6_6);
+	DeleteAll(parked_6_3);
+	DeleteAll(parked_3_3);
+	DeleteAll(parked_333_3);
+	DeleteAll(parked_333_6);
+	DeleteAll(parked_333_333);
+	DeleteAll(parked_666_3);
+	DeleteAll(parked_666_6);
+	DeleteAll(parked_666_333);
+	DeleteAll(parked_666_666);
+	DeleteAll(parked_6_6_rolling);
+}
+
+int32 FChPooledContactContainerNSC::GetPooledContactNum() const
+{
+	return (int32)(contactlist_6_6.size() + parked_6_6.size() + contactlist_6_3.size() + parked_6_3.size()
+		+ contactlist_3_3.size() + parked_3_3.size() + contactlist_333_3.size() + parked_333_3.size()
+		+ contactlist_333_6.size() + parked_333_6.size() + contactlist_333_333.size() + parked_333_333.size()
+		+ contactlist_666_3.size() + parked_666_3.size() + contactlist_666_6.size() + parked_666_6.size()
+		+ contactlist_666_333.size() + parked_666_333.size() + contactlist_666_666.size() + parked_666_666.size()
+		+ contactlist_6_6_rolling.size() + parked_6_6_rolling.size());
+}
+
+void FChPooledContactContainerNSC::RemoveAllContacts()
+{
+	auto first_6_6 = contactlist_6_6.begin();
+	auto first_6_3 = contactlist_6_3.begin();
+	auto first_3_3 = contactlist_3_3.begin();
+	auto first_333_3 = contactlist_333_3.begin();
+	auto first_333_6 = contactlist_333_6.begin();
+	auto first_333_333 = contactlist_333_333.begin();
+	auto first_666_3 = contactlist_666_3.begin();
+	auto first_666_6 = contactlist_666_6.begin();
+	auto first_666_333 = contactlist_666_333.begin();
+	auto first_666_666 = contactlist_666_666.begin();
+	auto first_6_6_rolling = contactlist_6_6_rolling.begin();
+	Park(contactlist_6_6, first_6_6, parked_6_6);
+	Park(contactlist_6_3, first_6_3, parked_6_3);
+	Park(contactlist_3_3, first_3_3, parked_3_3);
+	Park(contactlist_333_3, first_333_3, parked_333_3);
+	Park(contactlist_333_6, first_333_6, parked_333_6);
+	Park(contactlist_333_333, first_333_333, parked_333_333);
+	Park(contactlist_666_3, first_666_3, parked_666_3);
+	Park(contactlist_666_6, first_666_6, parked_666_6);
+	Park(contactlist_666_333, first_666_333, parked_666_333);
+	Park(contactlist_666_666, first_666_666, parked_666_666);
+	Park(contactlist_6_6_rolling, first_6_6_rolling, parked_6_6_rolling);
+	// Nothing left to delete, it resets the counts and iterators
+	ChContactContainerNSC::RemoveAllContacts();
+}
+
+void FChPooledContactContainerNSC::BeginAddContact()
+{
+	// Before the base, it points the iterators at the front of the lists
+	Unpark(contactlist_6_6, parked_6_6);
+	Unpark(contactlist_6_3, parked_6_3);
+	Unpark(contactlist_3_3, parked_3_3);
+	Unpark(contactlist_333_3, parked_333_3);
+	Unpark(contactlist_333_6, parked_333_6);
+	Unpark(contactlist_333_333, parked_333_333);
+	Unpark(contactlist_666_3, parked_666_3);
+	Unpark(contactlist_666_6, parked_666_6);
+	Unpark(contactlist_666_333, parked_666_333);
+	Unpark(contactlist_666_666, parked_666_666);
+	Unpark(contactlist_6_6_rolling, parked_6_6_rolling);
+	ChContactContainerNSC::BeginAddContact();
+}
+
+bool FChPooledContactContainerNSC::IsImmovablePair(const chrono::collision::ChCollisionInfo& mcontact)
+{
+	return IsImmovable(mcontact.modelA) && IsImmovable(mcontact.modelB);
+}
+
+void FChPooledContactContainerNSC::AddContact(const chrono::collision::ChCollisionInfo& mcontact)
+{
+	if (!IsImmovablePair(mcontact)) {
+		ChContactContainerNSC::AddContact(mcontact);
+	}
+}
+
+void FChPooledContactContainerNSC::EndAddContact()
+{
+	// The iterators stop right after the last contact added this pass, the rest waits for the next one
+	Park(contactlist_6_6, lastcontact_6_6, parked_6_6);
+	Park(contactlist_6_3, lastcontact_6_3, parked_6_3);
+	Park(contactlist_3_3, lastcontact_3_3, parked_3_3);
+	Park(contactlist_333_3, lastcontact_333_3, parked_333_3);
+	Park(contactlist_333_6, lastcontact_333_6, parked_333_6);
+	Park(contactlist_333_333, lastcontact_333_333, parked_333_333);
+	Park(contactlist_666_3, lastcontact_666_3, parked_666_3);
+	Park(contactlist_666_6, lastcontact_666_6, parked_666_6);
+	Park(contactlist_666_333, lastcontact_666_333, parked_666_333);
+	Park(contactlist_666_666, lastcontact_666_666, parked_666_666);
+	Park(contactlist_6_6_rolling, lastcontact_6_6_rolling, parked_6_6_rolling);
+	ChContactContainerNSC::EndAddContact();
+
+	highWater = FMath::Max(highWater, GetNcontacts());
+	SET_DWORD_STAT(STAT_ChronoPooledContacts, GetPooledContactNum());
+	SET_DWORD_STAT(STAT_ChronoPooledContactHighWater, highWater);
+}
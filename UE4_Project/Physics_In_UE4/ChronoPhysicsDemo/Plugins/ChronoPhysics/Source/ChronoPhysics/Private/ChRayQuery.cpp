@@ -0,0 +1,132 @@
+#include "ChRayQuery.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/collision/ChCCollisionSystemBullet.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "Async/ParallelFor.h"
+#include "util.h"
+
+namespace {
+	// Segments per task, one tree walk is too short to schedule alone
+	const int32 RayChunkSize = 256;
+
+	FORCEINLINE btVector3 ToBullet(const FVector& v)
+	{
+		return btVector3((btScalar)(v.X / CHRONO_SCALE), (btScalar)(v.Z / CHRONO_SCALE), (btScalar)(v.Y / CHRONO_SCALE));
+	}
+
+	FORCEINLINE FVector FromBullet(const btVector3& v, float scale)
+	{
+		return FVector(v.x() * scale, v.z() * scale, v.y() * scale);
+	}
+
+	// Collision objects of the leaves a traversal reaches
+	struct FLeafCollector : public btDbvt::ICollide
+	{
+		TArray<btCollisionObject*, TInlineAllocator<64>> Objects;
+
+		virtual void Process(const btDbvtNode* leaf) override
+		{
+			Objects.Add(static_cast<btCollisionObject*>(static_cast<btDbvtProxy*>(leaf->data)->m_clientObject));
+		}
+	};
+}
+
+void FChRayHits::SetNum(int32 num)
+{
+	bHit.SetNumUninitialized(num, false);
+	Distance.SetNumUninitialized(num, false);
+	Point.SetNumUninitialized(num, false);
+	Normal.SetNumUninitialized(num, false);
+	Item.SetNumUninitialized(num, false);
+}
+
+int32 FChRayQuery::Trace(chrono::ChSystem* system, const FChRayBatch& batch, FChRayHits& outHits)
+{
+	int32 count = FMath::Min(batch.Starts.Num(), batch.Ends.Num());
+	outHits.SetNum(count);
+	auto bulletSystem = system ? std::dynamic_pointer_cast<chrono::collision::ChCollisionSystemBullet>(system->GetCollisionSystem()) : nullptr;
+	btDbvtBroadphase* broadphase = bulletSystem ? dynamic_cast<btDbvtBroadphase*>(bulletSystem->GetBulletCollisionWorld()->getBroadphase()) : nullptr;
+	if (!broadphase) {
+		if (count > 0) {
+			FMemory::Memzero(outHits.bHit.GetData(), count * sizeof(bool));
+		}
+		return 0;
+	}
+
+	btScalar radius = (btScalar)FMath::Max(batch.SweepRadius / CHRONO_SCALE, 0.f);
+	// Only read by the casts, shared by every task
+	btSphereShape sphere(radius > 0 ? radius : (btScalar)1);
+	int32 chunkNum = (count + RayChunkSize - 1) / RayChunkSize;
+	TArray<int32> chunkHits;
+	chunkHits.SetNumZeroed(chunkNum);
+
+	ParallelFor(chunkNum, [&](int32 chunk) {
+		FLeafCollector collector;
+		int32 end = FMath::Min((chunk + 1) * RayChunkSize, count);
+		for (int32 i = chunk * RayChunkSize; i < end; i++) {
+			btVector3 from = ToBullet(batch.Starts[i]);
+			btVector3 to = ToBullet(batch.Ends[i]);
+			btTransform fromTransform(btQuaternion::getIdentity(), from);
+			btTransform toTransform(btQuaternion::getIdentity(), to);
+			collector.Objects.Reset();
+
+			bool bHit = false;
+			btScalar fraction = 1;
+			btVector3 point, normal;
+			btCollisionObject* object = nullptr;
+			if (radius > 0) {
+				btVector3 margin(radius, radius, radius);
+				btVector3 low = from, high = from;
+				low.setMin(to);
+				high.setMax(to);
+				btDbvtVolume volume = btDbvtVolume::FromMM(low - margin, high + margin);
+				for (btDbvt& tree : broadphase->m_sets) {
+					tree.collideTV(tree.m_root, volume, collector);
+				}
+				btCollisionWorld::ClosestConvexResultCallback callback(from, to);
+				for (btCollisionObject* candidate : collector.Objects) {
+					btCollisionWorld::objectQuerySingle(&sphere, fromTransform, toTransform, candidate, candidate->getCollisionShape(), candidate->getWorldTransform(), callback, 0);
+				}
+				bHit = callback.hasHit();
+				fraction = callback.m_closestHitFraction;
+				point = callback.m_hitPointWorld;
+				normal = callback.m_hitNormalWorld;
+				object = callback.m_hitCollisionObject;
+			}
+			else {
+				for (btDbvt& tree : broadphase->m_sets) {
+					btDbvt::rayTest(tree.m_root, from, to, collector);
+				}
+				btCollisionWorld::ClosestRayResultCallback callback(from, to);
+				for (btCollisionObject* candidate : collector.Objects) {
+					btCollisionWorld::rayTestSingle(fromTransform, toTransform, candidate, candidate->getCollisionShape(), candidate->getWorldTransform(), callback);
+				}
+				bHit = callback.hasHit();
+				fraction = callback.m_closestHitFraction;
+				point = callback.m_hitPointWorld;
+				normal = callback.m_hitNormalWorld;
+				object = callback.m_collisionObject;
+			}
+
+			outHits.bHit[i] = bHit;
+			if (!bHit) {
+				continue;
+			}
+			chunkHits[chunk]++;
+			outHits.Distance[i] = fraction * FVector::Dist(batch.Starts[i], batch.Ends[i]);
+			outHits.Point[i] = FromBullet(point, CHRONO_SCALE);
+			outHits.Normal[i] = FromBullet(normal.normalized(), 1.f);
+			auto* model = static_cast<chrono::collision::ChModelBullet*>(object->getUserPointer());
+			outHits.Item[i] = model ? model->GetPhysicsItem() : nullptr;
+		}
+	});
+
+	int32 hits = 0;
+	for (int32 chunkHit : chunkHits) {
+		hits += chunkHit;
+	}
+	return hits;
+}
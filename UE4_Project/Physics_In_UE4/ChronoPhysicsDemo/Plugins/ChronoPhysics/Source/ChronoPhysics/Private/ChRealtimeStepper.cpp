@@ -0,0 +1,150 @@
+#include "ChRealtimeStepper.h"
+#include "ChTrace.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "chrono/core/ChRealtimeStep.h"
+
+FChRealtimeStepper::FChRealtimeStepper(const FChRealtimeSettings& inSettings, TFunction<void(double)> inStepFunction)
+	: settings(inSettings)
+	, stepFunction(MoveTemp(inStepFunction))
+{
+	settings.StepSeconds = FMath::Max(settings.StepSeconds, 1e-5);
+	settings.SpinSeconds = FMath::Max(settings.SpinSeconds, 0.0);
+	settings.MaxCatchUpSteps = FMath::Max(settings.MaxCatchUpSteps, 1);
+	pausedEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	resumeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	const uint64 affinity = settings.Core >= 0 && settings.Core < 64 ? (uint64(1) << settings.Core) : FPlatformAffinity::GetNoAffinityMask();
+	thread = FRunnableThread::Create(this, TEXT("ChRealtimeStep"), 0, TPri_TimeCritical, affinity);
+}
+
+FChRealtimeStepper::~FChRealtimeStepper()
+{
+	if (thread) {
+		thread->Kill(true);
+		delete thread;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(pausedEvent);
+	FPlatformProcess::ReturnSynchEventToPool(resumeEvent);
+}
+
+void FChRealtimeStepper::Pause()
+{
+	if (bHeld || !thread) {
+		return;
+	}
+	pauseRequested.Set(1);
+	// A thread that has left Run won't trigger the event, so the wait checks on it now and then
+	while (!pausedEvent->Wait(PauseCheckMs)) {
+		if (exited.GetValue()) {
+			break;
+		}
+		CH_TRACE(SCENE, WARNING, NAME_None, "Realtime step still running after %d ms of waiting for the pause", PauseCheckMs);
+	}
+	bHeld = true;
+}
+
+void FChRealtimeStepper::Resume()
+{
+	if (!bHeld) {
+		return;
+	}
+	bHeld = false;
+	pauseRequested.Set(0);
+	resumeEvent->Trigger();
+}
+
+void FChRealtimeStepper::Stop()
+{
+	stopping.Set(1);
+	pauseRequested.Set(0);
+	resumeEvent->Trigger();
+}
+
+uint32 FChRealtimeStepper::Run()
+{
+	const double step = settings.StepSeconds;
+	chrono::ChRealtimeStepTimer periodTimer;
+	double deadline = FPlatformTime::Seconds();
+	bool bPeriodValid = false;
+
+	while (stopping.GetValue() == 0) {
+		if (pauseRequested.GetValue()) {
+			pausedEvent->Trigger();
+			resumeEvent->Wait();
+			deadline = FPlatformTime::Seconds();
+			bPeriodValid = false;
+			continue;
+		}
+
+		WaitUntil(deadline);
+		RecordLateness(FPlatformTime::Seconds() - deadline);
+		// The period from the last step start to this one, the first after a (re)start has none
+		const double period = periodTimer.SuggestSimulationStep(DBL_MAX, 0);
+		if (bPeriodValid) {
+			periodMicroseconds.Add(FMath::RoundToInt(period * 1e6));
+			periodCount.Increment();
+			const int32 error = FMath::RoundToInt(FMath::Abs(period - step) * 1e6);
+			if (error > maxPeriodErrorMicroseconds.GetValue()) {
+				maxPeriodErrorMicroseconds.Set(error);
+			}
+		}
+		bPeriodValid = true;
+
+		stepFunction(step);
+		steps.Increment();
+
+		deadline += step;
+		const double behind = FPlatformTime::Seconds() - deadline;
+		if (behind > 0) {
+			missedDeadlines.Increment();
+			CH_TRACE(SCENE, VERBOSE, NAME_None, "Realtime step %d ended %.3f ms past its deadline", steps.GetValue(), behind * 1000);
+			// Too far behind to catch up by stepping back to back, the lost steps are dropped
+			if (behind > step * settings.MaxCatchUpSteps) {
+				const int32 dropped = FMath::FloorToInt(behind / step);
+				droppedSteps.Add(dropped);
+				deadline += dropped * step;
+				CH_TRACE(SCENE, WARNING, NAME_None, "Realtime schedule fell %.3f ms behind, %d steps dropped", behind * 1000, dropped);
+			}
+		}
+	}
+	exited.Set(1);
+	return 0;
+}
+
+void FChRealtimeStepper::WaitUntil(double deadline) const
+{
+	double remaining = deadline - FPlatformTime::Seconds();
+	if (remaining > settings.SpinSeconds) {
+		FPlatformProcess::SleepNoStats((float)(remaining - settings.SpinSeconds));
+	}
+	// The sleep can wake late too, the spin is only what is left of it
+	while (FPlatformTime::Seconds() < deadline) {
+	}
+}
+
+void FChRealtimeStepper::RecordLateness(double lateness)
+{
+	const int32 microseconds = FMath::Max(FMath::RoundToInt(lateness * 1e6), 0);
+	histogram[FMath::Min(microseconds / HistogramBinMicroseconds, HistogramBins - 1)].Increment();
+	if (microseconds > maxLatenessMicroseconds.GetValue()) {
+		maxLatenessMicroseconds.Set(microseconds);
+	}
+}
+
+void FChRealtimeStepper::GetStats(FChRealtimeStats& outStats) const
+{
+	outStats.Steps = steps.GetValue();
+	outStats.MissedDeadlines = missedDeadlines.GetValue();
+	outStats.DroppedSteps = droppedSteps.GetValue();
+	const int32 periods = periodCount.GetValue();
+	outStats.MeanPeriodMs = periods ? (float)(periodMicroseconds.GetValue() / 1000.0 / periods) : 0.f;
+	outStats.MaxPeriodErrorMs = maxPeriodErrorMicroseconds.GetValue() / 1000.f;
+	outStats.MaxLatenessMs = maxLatenessMicroseconds.GetValue() / 1000.f;
+	outStats.HistogramBinMs = HistogramBinMicroseconds / 1000.f;
+	outStats.LatenessHistogram.SetNumUninitialized(HistogramBins);
+	for (int32 bin = 0; bin < HistogramBins; bin++) {
+		outStats.LatenessHistogram[bin] = histogram[bin].GetValue();
+	}
+}
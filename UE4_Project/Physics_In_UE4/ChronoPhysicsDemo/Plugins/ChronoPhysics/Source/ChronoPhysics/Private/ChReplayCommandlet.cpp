@@ -0,0 +1,107 @@
+#include "ChReplayCommandlet.h"
+#include "ChReplayHarness.h"
+#include "Misc/FileHelper.h"
+
+UChReplayCommandlet::UChReplayCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UChReplayCommandlet::Main(const FString& Params)
+{
+	FString sceneName = TEXT("BoxStack");
+	FString backendName = TEXT("SERIAL_NSC");
+	FString inputPath;
+	FString goldenPath;
+	int32 threads = 1;
+	int32 warmup = 50;
+	int32 steps = 0;
+	int32 granularCount = 100000;
+	double hashResolution = 0;
+	FChReplayThresholds thresholds;
+	FParse::Value(*Params, TEXT("Scene="), sceneName);
+	FParse::Value(*Params, TEXT("Backend="), backendName);
+	FParse::Value(*Params, TEXT("Input="), inputPath);
+	FParse::Value(*Params, TEXT("Golden="), goldenPath);
+	FParse::Value(*Params, TEXT("Threads="), threads);
+	FParse::Value(*Params, TEXT("Warmup="), warmup);
+	FParse::Value(*Params, TEXT("Steps="), steps);
+	FParse::Value(*Params, TEXT("GranularCount="), granularCount);
+	FParse::Value(*Params, TEXT("HashResolution="), hashResolution);
+	FParse::Value(*Params, TEXT("MaxHashMismatches="), thresholds.MaxHashMismatches);
+	FParse::Value(*Params, TEXT("PerfTolerance="), thresholds.PerfTolerance);
+	FParse::Value(*Params, TEXT("PerfFloorMs="), thresholds.PerfFloorMs);
+	const bool bRecord = FParse::Param(*Params, TEXT("Record"));
+	const bool bThreadedShur = FParse::Param(*Params, TEXT("ThreadedShur"));
+
+	if (goldenPath.IsEmpty()) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: no -Golden file"));
+		return 1;
+	}
+	EChSystemBackend::Type backend;
+	if (!ChBenchmark::FindBackend(backendName, backend)) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: unknown backend %s"), *backendName);
+		return 1;
+	}
+
+	TArray<TUniquePtr<FChBenchmarkScene>> scenes;
+	ChBenchmark::CreateScenes(granularCount, scenes);
+	FChBenchmarkScene* scene = nullptr;
+	for (auto& candidate : scenes) {
+		if (sceneName.Equals(candidate->GetName(), ESearchCase::IgnoreCase)) {
+			scene = candidate.Get();
+		}
+	}
+	if (!scene || !scene->SupportsBackend(backend)) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: no scene %s on %s"), *sceneName, *backendName);
+		return 1;
+	}
+
+	FString error;
+	FChReplayInput input;
+	if (!inputPath.IsEmpty() && !input.LoadCSV(inputPath, error)) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: %s"), *error);
+		return 1;
+	}
+	if (steps <= 0) {
+		steps = inputPath.IsEmpty() ? 1000 : FMath::Max(FMath::CeilToInt(input.GetDuration() / scene->GetStepSize()), 1);
+	}
+
+	FChReplayRun run;
+	if (!ChReplay::Run(*scene, backend, FMath::Max(threads, 1), warmup, steps, input, hashResolution, bThreadedShur, run, error)) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: %s"), *error);
+		return 1;
+	}
+	const FChBenchmarkResult& timing = run.Timing;
+	UE_LOG(LogTemp, Display, TEXT("%s %s x%d: %d steps, %d input columns, %.3f ms/step (collision %.3f, solver %.3f, setup %.3f, update %.3f)"),
+		*timing.Scene, *timing.Backend, timing.Threads, timing.Steps, input.GetColumnNum(), timing.StepMs, timing.CollisionMs, timing.SolverMs, timing.SetupMs, timing.UpdateMs);
+
+	if (bRecord) {
+		if (!FFileHelper::SaveStringToFile(ChReplay::ToJson(run), *goldenPath)) {
+			UE_LOG(LogTemp, Error, TEXT("ChReplay: could not write %s"), *goldenPath);
+			return 1;
+		}
+		return 0;
+	}
+
+	FString json;
+	FChReplayRun golden;
+	if (!FFileHelper::LoadFileToString(json, *goldenPath) || !ChReplay::FromJson(json, golden)) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: could not read the golden file %s"), *goldenPath);
+		return 1;
+	}
+	FChReplayVerdict verdict = ChReplay::Compare(run, golden, thresholds);
+	for (auto& failure : verdict.Failures) {
+		UE_LOG(LogTemp, Error, TEXT("ChReplay: %s"), *failure);
+	}
+	for (auto& warning : verdict.Warnings) {
+		UE_LOG(LogTemp, Warning, TEXT("ChReplay: %s"), *warning);
+	}
+	if (verdict.bPassed) {
+		UE_LOG(LogTemp, Display, TEXT("ChReplay: matches %s, %d differing hashes"), *goldenPath, verdict.HashMismatches);
+	}
+	return verdict.bPassed ? 0 : 1;
+}
@@ -0,0 +1,406 @@
+#include "ChReplayHarness.h"
+#include "ChFunctionRecorder.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChLinkMotor.h"
+#include "chrono/fea/ChMesh.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Misc/FileHelper.h"
+#include "HAL/PlatformTime.h"
+#include <cmath>
+
+namespace {
+	// FNV-1a over 64 bit words of the state
+	struct FStateHash
+	{
+		uint64 Value = 14695981039346656037ull;
+		double Resolution = 0;
+
+		FORCEINLINE void Add(double value)
+		{
+			uint64 bits;
+			if (!FMath::IsFinite(value)) {
+				bits = 0x7ff8000000000000ull;
+			}
+			else if (Resolution > 0) {
+				bits = (uint64)(int64)std::llround(value / Resolution);
+			}
+			else {
+				// -0 and 0 are the same state
+				value = value == 0 ? 0 : value;
+				FMemory::Memcpy(&bits, &value, sizeof(bits));
+			}
+			for (int32 i = 0; i < 8; i++) {
+				Value ^= (bits >> (i * 8)) & 0xff;
+				Value *= 1099511628211ull;
+			}
+		}
+		FORCEINLINE void Add(const chrono::ChVector<>& v) { Add(v.x()); Add(v.y()); Add(v.z()); }
+		FORCEINLINE void Add(const chrono::ChQuaternion<>& q) { Add(q.e0()); Add(q.e1()); Add(q.e2()); Add(q.e3()); }
+	};
+
+	// Motor3, Force12 and the like, false when name isn't prefix followed by an index
+	bool ParseIndexedName(const FString& name, const TCHAR* prefix, int32& outIndex)
+	{
+		const int32 length = FCString::Strlen(prefix);
+		if (name.Len() <= length || !name.StartsWith(prefix)) {
+			return false;
+		}
+		for (int32 i = length; i < name.Len(); i++) {
+			if (!FChar::IsDigit(name[i])) {
+				return false;
+			}
+		}
+		outIndex = FCString::Atoi(*name + length);
+		return true;
+	}
+
+	TArray<std::shared_ptr<chrono::ChLinkMotor>> GetMotors(chrono::ChSystem* system)
+	{
+		TArray<std::shared_ptr<chrono::ChLinkMotor>> motors;
+		for (auto& link : system->Get_linklist()) {
+			if (auto motor = std::dynamic_pointer_cast<chrono::ChLinkMotor>(link)) {
+				motors.Add(motor);
+			}
+		}
+		return motors;
+	}
+}
+
+bool FChReplayInput::LoadCSV(const FString& filePath, FString& outError)
+{
+	columns.Reset();
+	joystickAxes = 0;
+	duration = 0;
+
+	TArray<FString> lines;
+	if (!FFileHelper::LoadFileToStringArray(lines, *filePath) || lines.Num() == 0) {
+		outError = FString::Printf(TEXT("could not read %s"), *filePath);
+		return false;
+	}
+	TArray<FString> names;
+	lines[0].ParseIntoArray(names, TEXT(","), false);
+	if (names.Num() == 0 || !names[0].TrimStartAndEnd().Equals(TEXT("Time"), ESearchCase::IgnoreCase)) {
+		outError = FString::Printf(TEXT("%s doesn't start with a Time column"), *filePath);
+		return false;
+	}
+
+	// Column of the file to input column, INDEX_NONE for the ones ignored
+	TArray<int32> columnOf;
+	columnOf.Init(INDEX_NONE, names.Num());
+	for (int32 c = 1; c < names.Num(); c++) {
+		FString name = names[c].TrimStartAndEnd();
+		int32 component = 0;
+		int32 bracket;
+		if (name.FindChar(TEXT('['), bracket) && name.EndsWith(TEXT("]"))) {
+			component = FCString::Atoi(*name.Mid(bracket + 1, name.Len() - bracket - 2));
+			name = name.Left(bracket);
+		}
+
+		FColumn column;
+		column.Component = component;
+		column.Index = 0;
+		if (ParseIndexedName(name, TEXT("Motor"), column.Index) && component == 0) {
+			column.Channel = MOTOR;
+		}
+		else if (ParseIndexedName(name, TEXT("Force"), column.Index) && component >= 0 && component < 3) {
+			column.Channel = FORCE;
+		}
+		else if (ParseIndexedName(name, TEXT("Torque"), column.Index) && component >= 0 && component < 3) {
+			column.Channel = TORQUE;
+		}
+		else if (name.Equals(TEXT("Joystick"), ESearchCase::IgnoreCase) && component >= 0) {
+			column.Channel = JOYSTICK;
+			joystickAxes = FMath::Max(joystickAxes, component + 1);
+		}
+		else {
+			continue;
+		}
+		column.Samples = std::make_shared<FChFunctionRecorder>();
+		column.Samples->Reserve(lines.Num() - 1);
+		columnOf[c] = columns.Add(column);
+	}
+
+	TArray<FString> values;
+	for (int32 l = 1; l < lines.Num(); l++) {
+		lines[l].ParseIntoArray(values, TEXT(","), false);
+		if (values.Num() == 0 || values[0].TrimStartAndEnd().IsEmpty()) {
+			continue;
+		}
+		const double time = FCString::Atod(*values[0]);
+		duration = FMath::Max(duration, time);
+		for (int32 c = 1; c < FMath::Min(values.Num(), columnOf.Num()); c++) {
+			if (columnOf[c] != INDEX_NONE && !values[c].TrimStartAndEnd().IsEmpty()) {
+				columns[columnOf[c]].Samples->AddPoint(time, FCString::Atod(*values[c]));
+			}
+		}
+	}
+	return true;
+}
+
+bool FChReplayInput::Bind(chrono::ChSystem* system, FString& outError) const
+{
+	auto motors = GetMotors(system);
+	const int32 bodies = (int32)system->Get_bodylist().size();
+	for (const FColumn& column : columns) {
+		if (column.Channel == MOTOR) {
+			if (column.Index >= motors.Num()) {
+				outError = FString::Printf(TEXT("Motor%d, the system has %d motors"), column.Index, motors.Num());
+				return false;
+			}
+			motors[column.Index]->SetMotorFunction(column.Samples);
+		}
+		else if ((column.Channel == FORCE || column.Channel == TORQUE) && column.Index >= bodies) {
+			outError = FString::Printf(TEXT("%s%d, the system has %d bodies"), column.Channel == FORCE ? TEXT("Force") : TEXT("Torque"), column.Index, bodies);
+			return false;
+		}
+	}
+	return true;
+}
+
+void FChReplayInput::Apply(chrono::ChSystem* system, FChBenchmarkScene& scene) const
+{
+	const double time = system->GetChTime();
+	auto& bodies = system->Get_bodylist();
+	for (const FColumn& column : columns) {
+		if (column.Channel == FORCE || column.Channel == TORQUE) {
+			bodies[column.Index]->Empty_forces_accumulators();
+		}
+	}
+
+	axes.SetNumZeroed(joystickAxes, false);
+	for (const FColumn& column : columns) {
+		const double value = column.Samples->Get_y(time);
+		chrono::ChVector<> vector(0);
+		if (column.Channel == FORCE || column.Channel == TORQUE) {
+			vector[column.Component] = value;
+		}
+		switch (column.Channel) {
+		case FORCE:
+			bodies[column.Index]->Accumulate_force(vector, bodies[column.Index]->GetPos(), false);
+			break;
+		case TORQUE:
+			bodies[column.Index]->Accumulate_torque(vector, false);
+			break;
+		case JOYSTICK:
+			axes[column.Component] = value;
+			break;
+		default:
+			break;
+		}
+	}
+	if (joystickAxes > 0) {
+		scene.ApplyJoystick(axes);
+	}
+}
+
+uint64 ChReplay::HashState(chrono::ChSystem& system, double resolution)
+{
+	FStateHash hash;
+	hash.Resolution = resolution;
+	for (auto& body : system.Get_bodylist()) {
+		hash.Add(body->GetPos());
+		hash.Add(body->GetRot());
+		hash.Add(body->GetPos_dt());
+		hash.Add(body->GetWvel_loc());
+	}
+
+	chrono::ChState x;
+	chrono::ChStateDelta v;
+	double time;
+	for (auto& item : system.Get_otherphysicslist()) {
+		auto mesh = std::dynamic_pointer_cast<chrono::fea::ChMesh>(item);
+		if (!mesh) {
+			continue;
+		}
+		for (unsigned int n = 0; n < mesh->GetNnodes(); n++) {
+			auto node = mesh->GetNode(n);
+			x.Reset(node->Get_ndof_x(), 1);
+			v.Reset(node->Get_ndof_w(), 1);
+			node->NodeIntStateGather(0, x, 0, v, time);
+			for (int i = 0; i < x.GetRows(); i++) {
+				hash.Add(x(i));
+			}
+			for (int i = 0; i < v.GetRows(); i++) {
+				hash.Add(v(i));
+			}
+		}
+	}
+	return hash.Value;
+}
+
+bool ChReplay::Run(FChBenchmarkScene& scene, EChSystemBackend::Type backend, int32 threads, int32 warmupSteps, int32 steps,
+	const FChReplayInput& input, double hashResolution, bool bThreadedShur, FChReplayRun& outRun, FString& outError)
+{
+	outRun = FChReplayRun();
+	FChBenchmarkResult& timing = outRun.Timing;
+	timing.Scene = scene.GetName();
+	timing.Backend = ChBenchmark::GetBackendName(backend);
+	timing.Threads = threads;
+	timing.bThreadedShur = bThreadedShur && backend == EChSystemBackend::PARALLEL_NSC;
+	outRun.StepSize = scene.GetStepSize();
+	outRun.HashResolution = FMath::Max(hashResolution, 0.0);
+	outRun.Platform = FPlatformMisc::GetCPUBrand().TrimStartAndEnd();
+	const bool bSMC = backend == EChSystemBackend::SERIAL_SMC || backend == EChSystemBackend::PARALLEL_SMC;
+
+	if (warmupSteps > 0) {
+		auto warmup = ChBenchmark::CreateSystem(backend, threads, bThreadedShur);
+		scene.Build(warmup.get(), bSMC);
+		if (!input.Bind(warmup.get(), outError)) {
+			return false;
+		}
+		for (int32 i = 0; i < warmupSteps; i++) {
+			input.Apply(warmup.get(), scene);
+			scene.PreStep(warmup.get(), outRun.StepSize);
+			warmup->DoStepDynamics(outRun.StepSize);
+		}
+	}
+
+	auto system = ChBenchmark::CreateSystem(backend, threads, bThreadedShur);
+	scene.Build(system.get(), bSMC);
+	if (!input.Bind(system.get(), outError)) {
+		return false;
+	}
+	timing.Bodies = (int32)system->Get_bodylist().size();
+
+	outRun.Hashes.Reserve(steps);
+	for (int32 i = 0; i < steps; i++) {
+		input.Apply(system.get(), scene);
+		scene.PreStep(system.get(), outRun.StepSize);
+		const double startTime = FPlatformTime::Seconds();
+		system->DoStepDynamics(outRun.StepSize);
+		timing.WallMs += (FPlatformTime::Seconds() - startTime) * 1e3;
+		ChBenchmark::AccumulateTimers(*system, timing);
+		outRun.Hashes.Add(HashState(*system, outRun.HashResolution));
+	}
+	ChBenchmark::FinishResult(timing, steps);
+	return true;
+}
+
+FChReplayVerdict ChReplay::Compare(const FChReplayRun& run, const FChReplayRun& golden, const FChReplayThresholds& thresholds)
+{
+	FChReplayVerdict verdict;
+	auto fail = [&verdict](const FString& failure) {
+		verdict.bPassed = false;
+		verdict.Failures.Add(failure);
+	};
+
+	const FChBenchmarkResult& a = run.Timing;
+	const FChBenchmarkResult& b = golden.Timing;
+	if (a.Scene != b.Scene || a.Backend != b.Backend || a.Threads != b.Threads || a.bThreadedShur != b.bThreadedShur
+		|| run.StepSize != golden.StepSize || run.HashResolution != golden.HashResolution) {
+		fail(FString::Printf(TEXT("the golden run is %s %s x%d%s with step %g and hash resolution %g"), *b.Scene, *b.Backend, b.Threads,
+			b.bThreadedShur ? TEXT(" threaded Schur") : TEXT(""), golden.StepSize, golden.HashResolution));
+		return verdict;
+	}
+
+	const int32 common = FMath::Min(run.Hashes.Num(), golden.Hashes.Num());
+	for (int32 i = 0; i < common; i++) {
+		if (run.Hashes[i] != golden.Hashes[i]) {
+			if (verdict.HashMismatches++ == 0) {
+				verdict.FirstMismatchStep = i;
+			}
+		}
+	}
+	if (run.Hashes.Num() != golden.Hashes.Num()) {
+		fail(FString::Printf(TEXT("%d steps replayed, the golden run has %d"), run.Hashes.Num(), golden.Hashes.Num()));
+	}
+	if (verdict.HashMismatches > thresholds.MaxHashMismatches) {
+		fail(FString::Printf(TEXT("%d of %d step hashes differ, the first after step %d"), verdict.HashMismatches, common, verdict.FirstMismatchStep));
+	}
+
+	struct FPhase {
+		const TCHAR* Name;
+		double Run;
+		double Golden;
+	};
+	const FPhase phases[] = {
+		{ TEXT("step"), a.StepMs, b.StepMs },
+		{ TEXT("collision"), a.CollisionMs, b.CollisionMs },
+		{ TEXT("solver"), a.SolverMs, b.SolverMs },
+		{ TEXT("setup"), a.SetupMs, b.SetupMs },
+		{ TEXT("update"), a.UpdateMs, b.UpdateMs },
+		{ TEXT("wall"), a.WallMs, b.WallMs },
+	};
+	if (!run.Platform.IsEmpty() && !golden.Platform.IsEmpty() && run.Platform != golden.Platform) {
+		verdict.Warnings.Add(FString::Printf(TEXT("perf checks skipped, the golden run is from %s, this one from %s"), *golden.Platform, *run.Platform));
+		return verdict;
+	}
+	for (const FPhase& phase : phases) {
+		if (phase.Run > phase.Golden * (1 + thresholds.PerfTolerance) && phase.Run - phase.Golden > thresholds.PerfFloorMs) {
+			fail(FString::Printf(TEXT("%s %.3f ms/step, %.3f in the golden run"), phase.Name, phase.Run, phase.Golden));
+		}
+	}
+	return verdict;
+}
+
+FString ChReplay::ToJson(const FChReplayRun& run)
+{
+	const FChBenchmarkResult& timing = run.Timing;
+	TSharedPtr<FJsonObject> root = MakeShared<FJsonObject>();
+	root->SetStringField(TEXT("scene"), timing.Scene);
+	root->SetStringField(TEXT("backend"), timing.Backend);
+	root->SetNumberField(TEXT("threads"), timing.Threads);
+	root->SetBoolField(TEXT("threaded_shur"), timing.bThreadedShur);
+	root->SetNumberField(TEXT("steps"), timing.Steps);
+	root->SetNumberField(TEXT("bodies"), timing.Bodies);
+	root->SetNumberField(TEXT("step_size"), run.StepSize);
+	root->SetNumberField(TEXT("hash_resolution"), run.HashResolution);
+	root->SetNumberField(TEXT("step_ms"), timing.StepMs);
+	root->SetNumberField(TEXT("collision_ms"), timing.CollisionMs);
+	root->SetNumberField(TEXT("solver_ms"), timing.SolverMs);
+	root->SetNumberField(TEXT("setup_ms"), timing.SetupMs);
+	root->SetNumberField(TEXT("update_ms"), timing.UpdateMs);
+	root->SetNumberField(TEXT("wall_ms"), timing.WallMs);
+	root->SetStringField(TEXT("platform"), run.Platform);
+
+	TArray<TSharedPtr<FJsonValue>> hashes;
+	hashes.Reserve(run.Hashes.Num());
+	for (uint64 hash : run.Hashes) {
+		hashes.Add(MakeShared<FJsonValueString>(FString::Printf(TEXT("%016llx"), hash)));
+	}
+	root->SetArrayField(TEXT("hashes"), hashes);
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	FJsonSerializer::Serialize(root.ToSharedRef(), writer);
+	return json;
+}
+
+bool ChReplay::FromJson(const FString& json, FChReplayRun& outRun)
+{
+	TSharedPtr<FJsonObject> root;
+	TSharedRef<TJsonReader<>> reader = TJsonReaderFactory<>::Create(json);
+	if (!FJsonSerializer::Deserialize(reader, root) || !root.IsValid()) {
+		return false;
+	}
+
+	outRun = FChReplayRun();
+	FChBenchmarkResult& timing = outRun.Timing;
+	timing.Scene = root->GetStringField(TEXT("scene"));
+	timing.Backend = root->GetStringField(TEXT("backend"));
+	timing.Threads = (int32)root->GetNumberField(TEXT("threads"));
+	timing.bThreadedShur = root->GetBoolField(TEXT("threaded_shur"));
+	timing.Steps = (int32)root->GetNumberField(TEXT("steps"));
+	timing.Bodies = (int32)root->GetNumberField(TEXT("bodies"));
+	outRun.StepSize = root->GetNumberField(TEXT("step_size"));
+	outRun.HashResolution = root->GetNumberField(TEXT("hash_resolution"));
+	timing.StepMs = root->GetNumberField(TEXT("step_ms"));
+	timing.CollisionMs = root->GetNumberField(TEXT("collision_ms"));
+	timing.SolverMs = root->GetNumberField(TEXT("solver_ms"));
+	timing.SetupMs = root->GetNumberField(TEXT("setup_ms"));
+	timing.UpdateMs = root->GetNumberField(TEXT("update_ms"));
+	timing.WallMs = root->GetNumberField(TEXT("wall_ms"));
+	root->TryGetStringField(TEXT("platform"), outRun.Platform);
+
+	const TArray<TSharedPtr<FJsonValue>>* hashes;
+	if (!root->TryGetArrayField(TEXT("hashes"), hashes)) {
+		return false;
+	}
+	outRun.Hashes.Reserve(hashes->Num());
+	for (auto& hash : *hashes) {
+		outRun.Hashes.Add(FCString::Strtoui64(*hash->AsString(), nullptr, 16));
+	}
+	return true;
+}
@@ -0,0 +1,337 @@
+#include "ChSCMTerrainComponent.h"
+#include "GameFramework/Actor.h"
+#include "ChBodyComponent.h"
+#include "ChParallelSCMSoil.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/assets/ChTriangleMeshShape.h"
+#include "chrono_vehicle/terrain/SCMDeformableTerrain.h"
+#include "ChBatchConvert.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "util.h"
+
+// Vertices closer than this to their uploaded position are left alone, in cm
+static const float SCMVertexTolerance = 0.01f;
+
+UChSCMTerrainComponent::UChSCMTerrainComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	bUseAsyncCooking = true;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+}
+
+void UChSCMTerrainComponent::PhysicsObjectConstruct()
+{
+	// The soil plane is Chrono's Y-up ground, so only the component's yaw is honoured
+	DivX = FMath::Max(1, DivX);
+	DivY = FMath::Max(1, DivY);
+	TilesPerAxis = FMath::Max(1, TilesPerAxis);
+	FTransform transform = GetComponentTransform();
+
+	cachedPositions.Reset((DivX + 1) * (DivY + 1));
+	for (int j = 0; j <= DivY; j++) {
+		for (int i = 0; i <= DivX; i++) {
+			FVector local(-SizeX * 0.5f + SizeX * i / DivX, -SizeY * 0.5f + SizeY * j / DivY, 0.f);
+			cachedPositions.Add(transform.TransformPosition(local));
+		}
+	}
+
+	cachedFaces.Reset(DivX * DivY * 2);
+	for (int j = 0; j < DivY; j++) {
+		for (int i = 0; i < DivX; i++) {
+			int32 v00 = j * (DivX + 1) + i;
+			int32 v10 = v00 + 1;
+			int32 v01 = v00 + DivX + 1;
+			int32 v11 = v01 + 1;
+			cachedFaces.Add(FIntVector(v00, v10, v11));
+			cachedFaces.Add(FIntVector(v00, v11, v01));
+		}
+	}
+
+	Tiles.Reset();
+	Tiles.SetNum(TilesPerAxis * TilesPerAxis);
+	changedFaces.Init(true, cachedFaces.Num());
+	RebuildTiles();
+	RebuildAdjacency();
+}
+
+void UChSCMTerrainComponent::PhysicsObjectInitalize()
+{
+	trackedBody = nullptr;
+	if (bMovingPatch && TrackedActor) {
+		auto comp = TrackedActor->FindComponentByClass<UChBodyComponent>();
+		trackedBody = comp ? comp->GetChData() : nullptr;
+	}
+
+	UpdateVisualAsset();
+}
+
+void UChSCMTerrainComponent::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	if (isForParallel) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: SCM terrain needs a serial system backend"), *GetName());
+		return;
+	}
+
+	std::vector<chrono::ChVector<>> vertices;
+	ChBatchConvert::ToChrono(cachedPositions, FVector(1.f / CHRONO_SCALE), vertices);
+	std::vector<chrono::ChVector<int>> indices;
+	ChBatchConvert::Faces(cachedFaces, indices);
+
+	if (bParallelSoil) {
+		if (bBulldozing || bAutomaticRefinement || bMovingPatch) {
+			UE_LOG(LogTemp, Warning, TEXT("%s: the parallel SCM soil has no bulldozing, refinement or moving patch, they are ignored"), *GetName());
+		}
+		FChSCMSoilParameters parameters;
+		parameters.BekkerKphi = BekkerKphi;
+		parameters.BekkerKc = BekkerKc;
+		parameters.BekkerN = BekkerN;
+		parameters.MohrCohesion = MohrCohesion;
+		parameters.MohrFriction = MohrFriction;
+		parameters.JanosiShear = JanosiShear / CHRONO_SCALE;
+		parameters.ElasticK = ElasticK;
+		parameters.DampingR = DampingR;
+		parameters.TestHighOffset = TestHighOffset / CHRONO_SCALE;
+		parallelSoil = std::make_shared<FChParallelSCMSoil>();
+		parallelSoil->Initialize(vertices, indices, DivX, DivY, parameters);
+		system = phySystem.get();
+		return;
+	}
+
+	ChDataTerrain = std::make_shared<chrono::vehicle::SCMDeformableTerrain>(phySystem.get());
+	ChDataTerrain->SetSoilParametersSCM(BekkerKphi, BekkerKc, BekkerN, MohrCohesion, MohrFriction, JanosiShear / CHRONO_SCALE, ElasticK, DampingR);
+	ChDataTerrain->SetBulldozingFlow(bBulldozing);
+	ChDataTerrain->SetTestHighOffset(TestHighOffset / CHRONO_SCALE);
+	ChDataTerrain->SetAutomaticRefinement(bAutomaticRefinement);
+	ChDataTerrain->SetAutomaticRefinementResolution(RefinementResolution / CHRONO_SCALE);
+	if (trackedBody) {
+		ChDataTerrain->EnableMovingPatch(trackedBody, FVECTOR_TO_CHRONO_VEC(PatchOffset), PatchSize.X / CHRONO_SCALE, PatchSize.Y / CHRONO_SCALE);
+	}
+	ChDataTerrain->m_ground->Initialize(vertices, indices);
+}
+
+void UChSCMTerrainComponent::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	if (parallelSoil) {
+		parallelSoil->Release();
+		parallelSoil = nullptr;
+	}
+	system = nullptr;
+}
+
+void UChSCMTerrainComponent::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	if (parallelSoil) {
+		objList.Add(this);
+	}
+}
+
+void UChSCMTerrainComponent::UpdatePhysicsState()
+{
+	// The loads of the coming step, from where the last one left the bodies
+	if (parallelSoil && system) {
+		parallelSoil->Step(system, system->GetStep());
+	}
+}
+
+int UChSCMTerrainComponent::GetTouchedVertexCount() const
+{
+	return parallelSoil ? parallelSoil->GetTouchedVertexNum() : 0;
+}
+
+void UChSCMTerrainComponent::CacheVisualState()
+{
+	if (!ChDataTerrain && !parallelSoil) {
+		return;
+	}
+
+	// The parallel soil keeps the grid's faces, its vertices only move up and down
+	static const std::vector<chrono::ChVector<int>> noFaces;
+	auto mesh = ChDataTerrain ? ChDataTerrain->GetMesh()->GetMesh() : nullptr;
+	auto& vertices = mesh ? mesh->getCoordsVertices() : parallelSoil->GetVertices();
+	auto& faces = mesh ? mesh->getIndicesVertexes() : noFaces;
+	int32 vertexNum = (int32)vertices.size();
+	movedVertices.Init(false, vertexNum);
+
+	// Refinement appends vertices and splits faces, every tile whose face list changed is recreated
+	bool bTopology = mesh && (vertexNum != cachedPositions.Num() || (int32)faces.size() != cachedFaces.Num());
+	if (bTopology) {
+		int32 oldNum = cachedPositions.Num();
+		cachedPositions.SetNum(vertexNum);
+		for (int32 i = 0; i < vertexNum; i++) {
+			FVector position = CHRONO_VEC_TO_FVECTOR(vertices[i]);
+			if (i >= oldNum || !position.Equals(cachedPositions[i], SCMVertexTolerance)) {
+				cachedPositions[i] = position;
+				movedVertices[i] = true;
+			}
+		}
+		int32 oldFaceNum = cachedFaces.Num();
+		cachedFaces.SetNum(faces.size());
+		changedFaces.Init(false, cachedFaces.Num());
+		for (int32 i = 0; i < cachedFaces.Num(); i++) {
+			FIntVector face(faces[i].x(), faces[i].y(), faces[i].z());
+			if (i >= oldFaceNum || face != cachedFaces[i]) {
+				cachedFaces[i] = face;
+				changedFaces[i] = true;
+			}
+		}
+		RebuildTiles();
+		RebuildAdjacency();
+	}
+
+	// With a moving patch only the tiles around it can deform
+	bPatchBoundsValid = false;
+	if (trackedBody && ChDataTerrain && !bTopology) {
+		FVector center = CHRONO_VEC_TO_FVECTOR(trackedBody->TransformPointLocalToParent(FVECTOR_TO_CHRONO_VEC(PatchOffset)));
+		// Twice the patch size, bulldozing reaches past the patch border
+		FVector2D extent = PatchSize;
+		patchBounds = FBox2D(FVector2D(center) - extent, FVector2D(center) + extent);
+		bPatchBoundsValid = true;
+	}
+
+	for (auto& tile : Tiles) {
+		if (bPatchBoundsValid && !tile.Bounds.Intersect(patchBounds)) {
+			continue;
+		}
+		if (!bTopology) {
+			for (int32 v : tile.Vertices) {
+				FVector position = CHRONO_VEC_TO_FVECTOR(vertices[v]);
+				if (!position.Equals(cachedPositions[v], SCMVertexTolerance)) {
+					cachedPositions[v] = position;
+					movedVertices[v] = true;
+				}
+			}
+		}
+	}
+
+	// Border vertices are shared, so tiles are only marked once every moved vertex is known
+	for (auto& tile : Tiles) {
+		if (tile.bDirty || (bPatchBoundsValid && !tile.Bounds.Intersect(patchBounds))) {
+			continue;
+		}
+		for (int32 v : tile.Vertices) {
+			if (movedVertices[v]) {
+				tile.bDirty = true;
+				break;
+			}
+		}
+	}
+}
+
+void UChSCMTerrainComponent::UpdateVisualAsset()
+{
+	lastUploadedTiles = 0;
+	for (int32 i = 0; i < Tiles.Num(); i++) {
+		if (Tiles[i].bDirty || Tiles[i].bTopologyDirty) {
+			UploadTile(i);
+			lastUploadedTiles++;
+		}
+	}
+}
+
+void UChSCMTerrainComponent::RebuildTiles()
+{
+	FTransform transform = GetComponentTransform();
+	TArray<TArray<int32>> tileFaces;
+	tileFaces.SetNum(Tiles.Num());
+
+	for (int32 f = 0; f < cachedFaces.Num(); f++) {
+		auto& face = cachedFaces[f];
+		FVector centroid = transform.InverseTransformPosition((cachedPositions[face.X] + cachedPositions[face.Y] + cachedPositions[face.Z]) / 3.f);
+		int32 x = FMath::Clamp(FMath::FloorToInt((centroid.X / SizeX + 0.5f) * TilesPerAxis), 0, TilesPerAxis - 1);
+		int32 y = FMath::Clamp(FMath::FloorToInt((centroid.Y / SizeY + 0.5f) * TilesPerAxis), 0, TilesPerAxis - 1);
+		tileFaces[y * TilesPerAxis + x].Add(f);
+	}
+
+	TMap<int32, int32> localIndex;
+	for (int32 t = 0; t < Tiles.Num(); t++) {
+		auto& tile = Tiles[t];
+		// Split faces keep their index, the same list can hold other triangles
+		if (tile.Faces == tileFaces[t] && !tile.bTopologyDirty && !tile.Faces.ContainsByPredicate([this](int32 f) { return changedFaces[f]; })) {
+			continue;
+		}
+
+		tile.Faces = MoveTemp(tileFaces[t]);
+		tile.Vertices.Reset();
+		tile.Triangles.Reset(tile.Faces.Num() * 3);
+		tile.Bounds = FBox2D(ForceInit);
+		localIndex.Reset();
+		for (int32 f : tile.Faces) {
+			for (int32 k = 0; k < 3; k++) {
+				int32 v = cachedFaces[f][k];
+				int32* found = localIndex.Find(v);
+				if (!found) {
+					found = &localIndex.Add(v, tile.Vertices.Add(v));
+					tile.Bounds += FVector2D(cachedPositions[v]);
+				}
+				tile.Triangles.Add(*found);
+			}
+		}
+		tile.bTopologyDirty = true;
+	}
+}
+
+void UChSCMTerrainComponent::RebuildAdjacency()
+{
+	vertexFaceOffsets.Init(0, cachedPositions.Num() + 1);
+	for (auto& face : cachedFaces) {
+		vertexFaceOffsets[face.X + 1]++;
+		vertexFaceOffsets[face.Y + 1]++;
+		vertexFaceOffsets[face.Z + 1]++;
+	}
+	for (int32 i = 1; i < vertexFaceOffsets.Num(); i++) {
+		vertexFaceOffsets[i] += vertexFaceOffsets[i - 1];
+	}
+
+	TArray<int32> fill(vertexFaceOffsets.GetData(), cachedPositions.Num());
+	vertexFaces.SetNumUninitialized(cachedFaces.Num() * 3);
+	for (int32 f = 0; f < cachedFaces.Num(); f++) {
+		for (int32 k = 0; k < 3; k++) {
+			vertexFaces[fill[cachedFaces[f][k]]++] = f;
+		}
+	}
+}
+
+void UChSCMTerrainComponent::UploadTile(int32 tileIndex)
+{
+	auto& tile = Tiles[tileIndex];
+	FTransform transform = GetComponentTransform();
+
+	sectionVertices.Reset(tile.Vertices.Num());
+	sectionNormals.Reset(tile.Vertices.Num());
+	sectionUVs.Reset(tile.Vertices.Num());
+	for (int32 v : tile.Vertices) {
+		FVector local = transform.InverseTransformPosition(cachedPositions[v]);
+		sectionVertices.Add(local);
+		sectionUVs.Add(FVector2D(local.X, local.Y) * UVScale);
+
+		// Area weighted, the faces of neighbouring tiles included so borders match
+		FVector normal = FVector::ZeroVector;
+		for (int32 i = vertexFaceOffsets[v]; i < vertexFaceOffsets[v + 1]; i++) {
+			auto& face = cachedFaces[vertexFaces[i]];
+			normal += FVector::CrossProduct(cachedPositions[face.Y] - cachedPositions[face.X], cachedPositions[face.Z] - cachedPositions[face.X]);
+		}
+		sectionNormals.Add(transform.InverseTransformVectorNoScale(normal.GetSafeNormal(SMALL_NUMBER, FVector::UpVector)));
+	}
+
+	if (tile.bTopologyDirty) {
+		CreateMeshSection(tileIndex, sectionVertices, tile.Triangles, sectionNormals, sectionUVs, TArray<FColor>(), TArray<FProcMeshTangent>(), false);
+	}
+	else {
+		UpdateMeshSection(tileIndex, sectionVertices, sectionNormals, sectionUVs, TArray<FColor>(), TArray<FProcMeshTangent>());
+	}
+	tile.bDirty = false;
+	tile.bTopologyDirty = false;
+}
+
+void UChSCMTerrainComponent::OnRegister()
+{
+	Super::OnRegister();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void UChSCMTerrainComponent::OnUnregister()
+{
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::OnUnregister();
+}
@@ -0,0 +1,223 @@
+#include "ChSceneFile.h"
+#include "PhysicsObjectGeneratorBasis.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+
+namespace {
+	const uint32 SceneFileMagic = 0x4E534843; // CHSN
+	const uint32 SceneFileVersion = 1;
+
+	struct FSceneFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		int32 BodyCount;
+		int32 LinkCount;
+	};
+
+	// Single lookup per field, the arrays hold fewer than three numbers in broken files
+	bool ReadTriple(const FJsonObject& object, const TCHAR* field, float& outX, float& outY, float& outZ)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* values;
+		if (!object.TryGetArrayField(field, values) || values->Num() < 3) {
+			return false;
+		}
+		outX = (*values)[0]->AsNumber();
+		outY = (*values)[1]->AsNumber();
+		outZ = (*values)[2]->AsNumber();
+		return true;
+	}
+}
+
+static_assert(sizeof(FChSceneBody) == 44, "FChSceneBody is stored as is");
+static_assert(sizeof(FChSceneLink) == 36, "FChSceneLink is stored as is");
+
+uint8 FChSceneData::FindShape(const FString& name)
+{
+	// FName compares ignoring case, the same as the ToLower compares this replaces
+	static const TMap<FName, uint8> shapes = {
+		{ FName(TEXT("Box")), (uint8)EShapeType::Box },
+		{ FName(TEXT("Cylinder")), (uint8)EShapeType::Cylinder },
+		{ FName(TEXT("Sphere")), (uint8)EShapeType::Sphere },
+	};
+	const uint8* shape = shapes.Find(FName(*name, FNAME_Find));
+	return shape ? *shape : (uint8)EShapeType::Sphere;
+}
+
+uint8 FChSceneData::FindLinkType(const FString& name)
+{
+	static const TMap<FName, uint8> linkTypes = {
+		{ FName(TEXT("LOCK")), (uint8)ELinkType::LOCK },
+		{ FName(TEXT("SPHERICAL")), (uint8)ELinkType::SPHERICAL },
+		{ FName(TEXT("POINTPLANE")), (uint8)ELinkType::POINTPLANE },
+		{ FName(TEXT("POINTLINE")), (uint8)ELinkType::POINTLINE },
+		{ FName(TEXT("CYLINDRICAL")), (uint8)ELinkType::CYLINDRICAL },
+		{ FName(TEXT("PRISMATIC")), (uint8)ELinkType::PRISMATIC },
+		{ FName(TEXT("PLANEPLANE")), (uint8)ELinkType::PLANEPLANE },
+		{ FName(TEXT("OLDHAM")), (uint8)ELinkType::OLDHAM },
+		{ FName(TEXT("REVOLUTE")), (uint8)ELinkType::REVOLUTE },
+		{ FName(TEXT("FREE")), (uint8)ELinkType::FREE },
+		{ FName(TEXT("ALIGN")), (uint8)ELinkType::ALIGN },
+		{ FName(TEXT("PARALLEL")), (uint8)ELinkType::PARALLEL },
+		{ FName(TEXT("PERPEND")), (uint8)ELinkType::PERPEND },
+		{ FName(TEXT("TRAJECTORY")), (uint8)ELinkType::TRAJECTORY },
+		{ FName(TEXT("CLEARANCE")), (uint8)ELinkType::CLEARANCE },
+		{ FName(TEXT("REVOLUTEPRISMATIC")), (uint8)ELinkType::REVOLUTEPRISMATIC },
+		{ FName(TEXT("ENGINE_TORQUE")), (uint8)ELinkType::ENGINE_TORQUE },
+		{ FName(TEXT("ENGINE_ROTATION")), (uint8)ELinkType::ENGINE_ROTATION },
+		{ FName(TEXT("ENGINE_SPEED")), (uint8)ELinkType::ENGINE_SPEED },
+	};
+	const uint8* linkType = linkTypes.Find(FName(*name, FNAME_Find));
+	return linkType ? *linkType : (uint8)ELinkType::FREE;
+}
+
+bool FChSceneData::LoadJson(const FString& filePath)
+{
+	Bodies.Reset();
+	Links.Reset();
+
+	FString jsonData;
+	if (!FFileHelper::LoadFileToString(jsonData, *filePath)) {
+		return false;
+	}
+	TSharedPtr<FJsonObject> root;
+	TSharedRef<TJsonReader<>> reader = TJsonReaderFactory<>::Create(jsonData);
+	if (!FJsonSerializer::Deserialize(reader, root) || !root.IsValid()) {
+		return false;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* bodyValues;
+	const TArray<TSharedPtr<FJsonValue>>* linkValues;
+	if (!root->TryGetArrayField(TEXT("Body"), bodyValues)) {
+		return false;
+	}
+	if (!root->TryGetArrayField(TEXT("Link"), linkValues)) {
+		linkValues = nullptr;
+	}
+
+	// A repeated name refers to the last body with it, as the name map did
+	TMap<FString, int32> bodyIndices;
+	bodyIndices.Reserve(bodyValues->Num());
+	Bodies.Reserve(bodyValues->Num());
+	for (auto& value : *bodyValues) {
+		const TSharedPtr<FJsonObject>* object;
+		if (!value->TryGetObject(object)) {
+			continue;
+		}
+		const FJsonObject& bodyObject = **object;
+		FChSceneBody& body = Bodies.AddZeroed_GetRef();
+		body.Scale = FVector::OneVector;
+
+		FString text;
+		body.Shape = FindShape(bodyObject.TryGetStringField(TEXT("Shape"), text) ? text : FString());
+		if (ReadTriple(bodyObject, TEXT("Position"), body.Position.X, body.Position.Y, body.Position.Z)) {
+			body.Flags |= EChSceneFlags::Position;
+		}
+		if (ReadTriple(bodyObject, TEXT("Rotation"), body.Rotation.Pitch, body.Rotation.Yaw, body.Rotation.Roll)) {
+			body.Flags |= EChSceneFlags::Rotation;
+		}
+		if (ReadTriple(bodyObject, TEXT("Scale"), body.Scale.X, body.Scale.Y, body.Scale.Z)) {
+			body.Flags |= EChSceneFlags::Scale;
+		}
+		bool bFixed;
+		if (bodyObject.TryGetBoolField(TEXT("Fixed"), bFixed) && bFixed) {
+			body.Flags |= EChSceneFlags::Fixed;
+		}
+		double density;
+		if (bodyObject.TryGetNumberField(TEXT("Density"), density)) {
+			body.Density = density;
+			body.Flags |= EChSceneFlags::Density;
+		}
+		bodyIndices.Add(bodyObject.TryGetStringField(TEXT("Name"), text) ? text : FString(), Bodies.Num() - 1);
+	}
+
+	if (linkValues) {
+		Links.Reserve(linkValues->Num());
+		for (auto& value : *linkValues) {
+			const TSharedPtr<FJsonObject>* object;
+			if (!value->TryGetObject(object)) {
+				continue;
+			}
+			const FJsonObject& linkObject = **object;
+			FChSceneLink& link = Links.AddZeroed_GetRef();
+			link.Target1 = INDEX_NONE;
+			link.Target2 = INDEX_NONE;
+
+			FString text;
+			link.Type = FindLinkType(linkObject.TryGetStringField(TEXT("Type"), text) ? text : FString());
+			const TArray<TSharedPtr<FJsonValue>>* targets;
+			if (linkObject.TryGetArrayField(TEXT("Target"), targets) && targets->Num() >= 2) {
+				const int32* target1 = bodyIndices.Find((*targets)[0]->AsString());
+				const int32* target2 = bodyIndices.Find((*targets)[1]->AsString());
+				link.Target1 = target1 ? *target1 : INDEX_NONE;
+				link.Target2 = target2 ? *target2 : INDEX_NONE;
+			}
+			if (ReadTriple(linkObject, TEXT("Position"), link.Position.X, link.Position.Y, link.Position.Z)) {
+				link.Flags |= EChSceneFlags::Position;
+			}
+			if (ReadTriple(linkObject, TEXT("Rotation"), link.Rotation.Pitch, link.Rotation.Yaw, link.Rotation.Roll)) {
+				link.Flags |= EChSceneFlags::Rotation;
+			}
+		}
+	}
+	return true;
+}
+
+bool FChSceneData::LoadBinary(const FString& filePath)
+{
+	Bodies.Reset();
+	Links.Reset();
+
+	TArray<uint8> buffer;
+	if (!FFileHelper::LoadFileToArray(buffer, *filePath, FILEREAD_Silent) || buffer.Num() < (int32)sizeof(FSceneFileHeader)) {
+		return false;
+	}
+	FSceneFileHeader header;
+	FMemory::Memcpy(&header, buffer.GetData(), sizeof(header));
+	if (header.Magic != SceneFileMagic || header.Version != SceneFileVersion || header.BodyCount < 0 || header.LinkCount < 0) {
+		return false;
+	}
+	int64 bodyBytes = (int64)header.BodyCount * sizeof(FChSceneBody);
+	int64 linkBytes = (int64)header.LinkCount * sizeof(FChSceneLink);
+	if ((int64)sizeof(header) + bodyBytes + linkBytes != (int64)buffer.Num()) {
+		return false;
+	}
+
+	Bodies.SetNumUninitialized(header.BodyCount);
+	Links.SetNumUninitialized(header.LinkCount);
+	FMemory::Memcpy(Bodies.GetData(), buffer.GetData() + sizeof(header), bodyBytes);
+	FMemory::Memcpy(Links.GetData(), buffer.GetData() + sizeof(header) + bodyBytes, linkBytes);
+	return true;
+}
+
+bool FChSceneData::SaveBinary(const FString& filePath) const
+{
+	FSceneFileHeader header = { SceneFileMagic, SceneFileVersion, Bodies.Num(), Links.Num() };
+	TArray<uint8> buffer;
+	buffer.Reserve(sizeof(header) + Bodies.Num() * sizeof(FChSceneBody) + Links.Num() * sizeof(FChSceneLink));
+	buffer.Append(reinterpret_cast<const uint8*>(&header), sizeof(header));
+	buffer.Append(reinterpret_cast<const uint8*>(Bodies.GetData()), Bodies.Num() * sizeof(FChSceneBody));
+	buffer.Append(reinterpret_cast<const uint8*>(Links.GetData()), Links.Num() * sizeof(FChSceneLink));
+	return FFileHelper::SaveArrayToFile(buffer, *filePath);
+}
+
+bool FChSceneData::Load(const FString& jsonPath, const FString& binaryPath, bool bWriteBinary)
+{
+	IFileManager& fileManager = IFileManager::Get();
+	FDateTime jsonTime = fileManager.GetTimeStamp(*jsonPath);
+	FDateTime binaryTime = fileManager.GetTimeStamp(*binaryPath);
+	// A missing file has the minimum time stamp, a scene shipped only as binary loads too
+	if (binaryTime != FDateTime::MinValue() && binaryTime >= jsonTime && LoadBinary(binaryPath)) {
+		return true;
+	}
+	if (!LoadJson(jsonPath)) {
+		return false;
+	}
+	if (bWriteBinary) {
+		SaveBinary(binaryPath);
+	}
+	return true;
+}
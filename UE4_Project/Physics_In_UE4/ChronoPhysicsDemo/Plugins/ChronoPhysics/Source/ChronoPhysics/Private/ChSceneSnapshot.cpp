@@ -0,0 +1,54 @@
+#include "ChSceneSnapshot.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/timestepper/ChState.h"
+
+FChSceneSnapshot::FChSceneSnapshot()
+	: x(new chrono::ChState())
+	, v(new chrono::ChStateDelta())
+	, a(new chrono::ChStateDelta())
+	, L(new chrono::ChVectorDynamic<double>())
+{
+}
+
+FChSceneSnapshot::~FChSceneSnapshot()
+{
+}
+
+void FChSceneSnapshot::Allocate(chrono::ChSystem* system)
+{
+	// Reset only reallocates when the size changes
+	ncoordsX = system->GetNcoords_x();
+	ncoordsV = system->GetNcoords_v();
+	nconstr = system->GetNconstr();
+	x->Reset(ncoordsX, system);
+	v->Reset(ncoordsV, system);
+	a->Reset(ncoordsV, system);
+	L->Reset(nconstr);
+	bValid = false;
+}
+
+bool FChSceneSnapshot::Save(chrono::ChSystem* system)
+{
+	if (system->GetNcoords_x() != ncoordsX || system->GetNcoords_v() != ncoordsV || system->GetNconstr() != nconstr) {
+		Allocate(system);
+	}
+
+	system->StateGather(*x, *v, time);
+	system->StateGatherAcceleration(*a);
+	system->StateGatherReactions(*L);
+	bValid = true;
+	return true;
+}
+
+bool FChSceneSnapshot::Restore(chrono::ChSystem* system) const
+{
+	if (!bValid || system->GetNcoords_x() != ncoordsX || system->GetNcoords_v() != ncoordsV || system->GetNconstr() != nconstr) {
+		return false;
+	}
+
+	system->StateScatter(*x, *v, time);
+	system->StateScatterAcceleration(*a);
+	// Reactions seed the solver's warm start for links
+	system->StateScatterReactions(*L);
+	return true;
+}
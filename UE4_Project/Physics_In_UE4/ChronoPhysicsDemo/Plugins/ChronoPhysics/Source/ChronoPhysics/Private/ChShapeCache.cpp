@@ -0,0 +1,177 @@
+#include "ChShapeCache.h"
+#include "Engine/StaticMesh.h"
+#include "UObject/Package.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Misc/ScopeLock.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "chrono/collision/ChCCollisionModel.h"
+
+namespace {
+	const uint32 ShapeCacheMagic = 0x43485343;
+	// 2: trimeshes are stored as imported, indexed and without the weld
+	const uint32 ShapeCacheVersion = 2;
+
+	bool ReadHeader(const TArray<uint8>& buffer, int64& offset)
+	{
+		if (buffer.Num() < 2 * sizeof(uint32)) {
+			return false;
+		}
+		uint32 header[2];
+		FMemory::Memcpy(header, buffer.GetData(), sizeof(header));
+		offset = sizeof(header);
+		return header[0] == ShapeCacheMagic && header[1] == ShapeCacheVersion;
+	}
+
+	void WriteHeader(TArray<uint8>& buffer)
+	{
+		uint32 header[2] = { ShapeCacheMagic, ShapeCacheVersion };
+		buffer.Append(reinterpret_cast<uint8*>(header), sizeof(header));
+	}
+
+	bool ReadBlock(const TArray<uint8>& buffer, int64& offset, void* dest, int64 size)
+	{
+		if (size < 0 || offset + size > buffer.Num()) {
+			return false;
+		}
+		FMemory::Memcpy(dest, buffer.GetData() + offset, size);
+		offset += size;
+		return true;
+	}
+
+	void WriteBlock(TArray<uint8>& buffer, const void* src, int64 size)
+	{
+		buffer.Append(static_cast<const uint8*>(src), size);
+	}
+
+	// Keys this process wrote or is writing. Components sharing a mesh build it on parallel tasks, only the
+	// first of them writes the file
+	FCriticalSection savedKeysLock;
+	TSet<FString> savedKeys;
+
+	bool ClaimSave(const FString& key)
+	{
+		FScopeLock lock(&savedKeysLock);
+		bool bClaimed = false;
+		savedKeys.Add(key, &bClaimed);
+		return !bClaimed;
+	}
+
+	bool FinishSave(const FString& key, const TArray<uint8>& buffer, const FString& path)
+	{
+		if (FFileHelper::SaveArrayToFile(buffer, *path)) {
+			return true;
+		}
+		// The next build may try again
+		FScopeLock lock(&savedKeysLock);
+		savedKeys.Remove(key);
+		return false;
+	}
+}
+
+static_assert(sizeof(chrono::ChVector<double>) == 3 * sizeof(double), "ChVector<double> must be tightly packed");
+static_assert(sizeof(chrono::ChVector<int>) == 3 * sizeof(int32), "ChVector<int> must be tightly packed");
+
+FString FChShapeCache::MakeKey(const UStaticMesh* mesh, const FVector& scale, const TCHAR* shapeKind)
+{
+	FString source = FString::Printf(TEXT("%s|%s|%s|%s|%f"),
+		shapeKind,
+		*mesh->GetPathName(),
+		*mesh->GetOutermost()->GetGuid().ToString(),
+		*scale.ToString(),
+		chrono::collision::ChCollisionModel::GetDefaultSuggestedMargin());
+	return FMD5::HashAnsiString(*source);
+}
+
+FString FChShapeCache::GetCacheFile(const FString& key)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), FString("ChronoShapeCache"), key + FString(".bin"));
+}
+
+bool FChShapeCache::LoadTriMesh(const FString& key, chrono::geometry::ChTriangleMeshConnected& mesh)
+{
+	TArray<uint8> buffer;
+	int64 offset;
+	if (!FFileHelper::LoadFileToArray(buffer, *GetCacheFile(key), FILEREAD_Silent) || !ReadHeader(buffer, offset)) {
+		return false;
+	}
+
+	int32 counts[2];
+	if (!ReadBlock(buffer, offset, counts, sizeof(counts))) {
+		return false;
+	}
+
+	mesh.Clear();
+	mesh.getCoordsVertices().resize(counts[0]);
+	mesh.getIndicesVertexes().resize(counts[1]);
+	if (!ReadBlock(buffer, offset, mesh.getCoordsVertices().data(), int64(counts[0]) * sizeof(chrono::ChVector<double>)) ||
+		!ReadBlock(buffer, offset, mesh.getIndicesVertexes().data(), int64(counts[1]) * sizeof(chrono::ChVector<int>))) {
+		mesh.Clear();
+		return false;
+	}
+	return true;
+}
+
+bool FChShapeCache::SaveTriMesh(const FString& key, chrono::geometry::ChTriangleMeshConnected& mesh)
+{
+	if (!ClaimSave(key)) {
+		return true;
+	}
+	TArray<uint8> buffer;
+	int32 counts[2] = { (int32)mesh.getCoordsVertices().size(), (int32)mesh.getIndicesVertexes().size() };
+
+	WriteHeader(buffer);
+	WriteBlock(buffer, counts, sizeof(counts));
+	WriteBlock(buffer, mesh.getCoordsVertices().data(), int64(counts[0]) * sizeof(chrono::ChVector<double>));
+	WriteBlock(buffer, mesh.getIndicesVertexes().data(), int64(counts[1]) * sizeof(chrono::ChVector<int>));
+	return FinishSave(key, buffer, GetCacheFile(key));
+}
+
+bool FChShapeCache::LoadHulls(const FString& key, TArray<TArray<FVector>>& hulls)
+{
+	TArray<uint8> buffer;
+	int64 offset;
+	if (!FFileHelper::LoadFileToArray(buffer, *GetCacheFile(key), FILEREAD_Silent) || !ReadHeader(buffer, offset)) {
+		return false;
+	}
+
+	int32 hullCount;
+	if (!ReadBlock(buffer, offset, &hullCount, sizeof(hullCount))) {
+		return false;
+	}
+
+	hulls.Reset(hullCount);
+	for (int i = 0; i < hullCount; i++) {
+		int32 pointCount;
+		auto& points = hulls[hulls.AddDefaulted()];
+		if (!ReadBlock(buffer, offset, &pointCount, sizeof(pointCount))) {
+			hulls.Empty();
+			return false;
+		}
+		points.SetNumUninitialized(pointCount);
+		if (!ReadBlock(buffer, offset, points.GetData(), int64(pointCount) * sizeof(FVector))) {
+			hulls.Empty();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FChShapeCache::SaveHulls(const FString& key, const TArray<TArray<FVector>>& hulls)
+{
+	if (!ClaimSave(key)) {
+		return true;
+	}
+	TArray<uint8> buffer;
+	int32 hullCount = hulls.Num();
+
+	WriteHeader(buffer);
+	WriteBlock(buffer, &hullCount, sizeof(hullCount));
+	for (auto& points : hulls) {
+		int32 pointCount = points.Num();
+		WriteBlock(buffer, &pointCount, sizeof(pointCount));
+		WriteBlock(buffer, points.GetData(), int64(pointCount) * sizeof(FVector));
+	}
+	return FinishSave(key, buffer, GetCacheFile(key));
+}
@@ -0,0 +1,62 @@
+#include "ChShapeInstances.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include "Misc/ScopeLock.h"
+
+namespace {
+	FCriticalSection templateLock;
+	// Weak, so a template is freed with the last body component holding it
+	TMap<FString, std::weak_ptr<FChShapeTemplate>> templates;
+}
+
+FString FChShapeInstances::MakeKey(const TCHAR* shapeKind, const FVector& size)
+{
+	return FString::Printf(TEXT("%s|%.6g|%.6g|%.6g|%g|%g"), shapeKind, size.X, size.Y, size.Z,
+		chrono::collision::ChCollisionModel::GetDefaultSuggestedEnvelope(),
+		chrono::collision::ChCollisionModel::GetDefaultSuggestedMargin());
+}
+
+std::shared_ptr<FChShapeTemplate> FChShapeInstances::Find(const FString& key, TFunctionRef<void(chrono::collision::ChCollisionModel& model)> build)
+{
+	FScopeLock scopeLock(&templateLock);
+	if (std::weak_ptr<FChShapeTemplate>* found = templates.Find(key)) {
+		if (std::shared_ptr<FChShapeTemplate> shape = found->lock()) {
+			return shape;
+		}
+	}
+
+	// The template never joins a system, the shapes go in without ClearModel and BuildModel
+	auto shape = std::make_shared<FChShapeTemplate>();
+	shape->Model = std::make_shared<chrono::collision::ChModelBullet>();
+	build(*shape->Model);
+
+	for (auto it = templates.CreateIterator(); it; ++it) {
+		if (it->Value.expired()) {
+			it.RemoveCurrent();
+		}
+	}
+	templates.Add(key, shape);
+	return shape;
+}
+
+bool FChShapeInstances::Instance(chrono::ChBody& body, const FChShapeTemplate& shape)
+{
+	auto model = std::dynamic_pointer_cast<chrono::collision::ChModelBullet>(body.GetCollisionModel());
+	if (!model || !shape.Model) {
+		return false;
+	}
+	model->ClearModel();
+	model->AddCopyOfAnotherModel(shape.Model.get());
+	model->BuildModel();
+	return true;
+}
+
+int32 FChShapeInstances::GetTemplateNum()
+{
+	FScopeLock scopeLock(&templateLock);
+	int32 count = 0;
+	for (auto& pair : templates) {
+		count += pair.Value.expired() ? 0 : 1;
+	}
+	return count;
+}
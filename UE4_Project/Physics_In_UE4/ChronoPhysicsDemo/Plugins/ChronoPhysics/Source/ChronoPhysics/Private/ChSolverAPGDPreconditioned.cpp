@@ -0,0 +1,211 @@
+#include "ChSolverAPGDPreconditioned.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+#include "chrono/solver/ChConstraintTwoTuplesContactN.h"
+#include "chrono/solver/ChConstraintTwoTuplesRollingN.h"
+#include <cmath>
+
+namespace {
+	double Dot(const chrono::ChMatrixDynamic<>& a, const chrono::ChMatrixDynamic<>& b)
+	{
+		double sum = 0;
+		for (int i = 0; i < a.GetRows(); i++) {
+			sum += a.ElementN(i) * b.ElementN(i);
+		}
+		return sum;
+	}
+}
+
+void FChSolverAPGDPreconditioned::BuildPreconditioner(chrono::ChSystemDescriptor& sysd)
+{
+	std::vector<chrono::ChConstraint*> active;
+	active.reserve(nc);
+	for (auto constraint : sysd.GetConstraintsList()) {
+		if (constraint->IsActive()) {
+			active.push_back(constraint);
+		}
+	}
+
+	preconditioner.assign(nc, 1.0);
+	int row = 0;
+	while (row < nc) {
+		// A contact's normal row comes before its two tangents, the rolling row before rolling and spin
+		bool bTriple = dynamic_cast<chrono::ChConstraintTwoTuplesContactNall*>(active[row]) || dynamic_cast<chrono::ChConstraintTwoTuplesRollingNall*>(active[row]);
+		int size = bTriple && row + 3 <= nc ? 3 : 1;
+		double diagonal = 0;
+		for (int k = 0; k < size; k++) {
+			diagonal += active[row + k]->Get_g_i();
+		}
+		diagonal /= size;
+		double scale = diagonal > 1e-12 ? 1.0 / diagonal : 1.0;
+		for (int k = 0; k < size; k++) {
+			preconditioner[row + k] = scale;
+		}
+		row += size;
+	}
+}
+
+void FChSolverAPGDPreconditioned::ComputeSchurRhs(chrono::ChSystemDescriptor& sysd)
+{
+	// b = -c - D'*M^-1*k, with the sign of the multipliers flipped like ChSolverAPGD
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			variable->Compute_invMb_v(variable->Get_qb(), variable->Get_fb());
+		}
+	}
+	int row = 0;
+	for (auto constraint : sysd.GetConstraintsList()) {
+		if (constraint->IsActive()) {
+			r.ElementN(row++) = constraint->Compute_Cq_q();
+		}
+	}
+	sysd.BuildBiVector(tmp);
+	r.MatrDec(tmp);
+}
+
+double FChSolverAPGDPreconditioned::Objective(chrono::ChSystemDescriptor& sysd, chrono::ChMatrixDynamic<>& x)
+{
+	sysd.ShurComplementProduct(product, &x);
+	double value = 0;
+	for (int i = 0; i < nc; i++) {
+		value += x.ElementN(i) * (0.5 * product.ElementN(i) - r.ElementN(i));
+	}
+	return value;
+}
+
+double FChSolverAPGDPreconditioned::Residual(chrono::ChSystemDescriptor& sysd, chrono::ChMatrixDynamic<>& x)
+{
+	double gdiff = 1.0 / ((double)nc * nc);
+	sysd.ShurComplementProduct(product, &x);
+	for (int i = 0; i < nc; i++) {
+		tmp.ElementN(i) = x.ElementN(i) - gdiff * (product.ElementN(i) - r.ElementN(i));
+	}
+	sysd.ConstraintsProject(tmp);
+	double sum = 0;
+	for (int i = 0; i < nc; i++) {
+		double step = (x.ElementN(i) - tmp.ElementN(i)) / gdiff;
+		sum += step * step;
+	}
+	return std::sqrt(sum);
+}
+
+double FChSolverAPGDPreconditioned::Solve(chrono::ChSystemDescriptor& sysd)
+{
+	tot_iterations = 0;
+	residual = 10e30;
+	for (auto constraint : sysd.GetConstraintsList()) {
+		constraint->Update_auxiliary();
+	}
+
+	nc = sysd.CountActiveConstraints();
+	gamma.Reset(nc, 1);
+	gammaBest.Reset(nc, 1);
+	gammaNew.Reset(nc, 1);
+	y.Reset(nc, 1);
+	yNew.Reset(nc, 1);
+	g.Reset(nc, 1);
+	r.Reset(nc, 1);
+	tmp.Reset(nc, 1);
+	product.Reset(nc, 1);
+
+	ComputeSchurRhs(sysd);
+	if (nc == 0) {
+		// The variables already hold M^-1*f
+		return 0;
+	}
+	BuildPreconditioner(sysd);
+
+	if (warm_start) {
+		sysd.FromConstraintsToVector(gamma);
+	}
+	// Lipschitz estimate in the metric of the preconditioner
+	for (int i = 0; i < nc; i++) {
+		tmp.ElementN(i) = gamma.ElementN(i) - 1.0;
+	}
+	sysd.ShurComplementProduct(product, &tmp);
+	double numerator = 0;
+	double denominator = 0;
+	for (int i = 0; i < nc; i++) {
+		numerator += preconditioner[i] * product.ElementN(i) * product.ElementN(i);
+		denominator += tmp.ElementN(i) * tmp.ElementN(i) / preconditioner[i];
+	}
+	double L = denominator > 0 ? std::sqrt(numerator / denominator) : 1.0;
+	L = L > 1e-12 ? L : 1.0;
+	double t = 1.0 / L;
+	double theta = 1.0;
+	y = gamma;
+	gammaBest = gamma;
+
+	for (int iter = 0; iter < max_iterations; iter++) {
+		sysd.ShurComplementProduct(g, &y);
+		g.MatrDec(r);
+		double objectiveY = Objective(sysd, y);
+
+		double objectiveNew, bound;
+		while (true) {
+			for (int i = 0; i < nc; i++) {
+				gammaNew.ElementN(i) = y.ElementN(i) - t * preconditioner[i] * g.ElementN(i);
+			}
+			sysd.ConstraintsProject(gammaNew);
+			objectiveNew = Objective(sysd, gammaNew);
+			double slope = 0;
+			double distance = 0;
+			for (int i = 0; i < nc; i++) {
+				double step = gammaNew.ElementN(i) - y.ElementN(i);
+				slope += g.ElementN(i) * step;
+				distance += step * step / preconditioner[i];
+			}
+			bound = objectiveY + slope + 0.5 * L * distance;
+			if (objectiveNew < bound || L > 1e30) {
+				break;
+			}
+			L *= 2.0;
+			t = 1.0 / L;
+		}
+
+		double thetaNew = (-theta * theta + theta * std::sqrt(theta * theta + 4.0)) / 2.0;
+		double beta = theta * (1.0 - theta) / (theta * theta + thetaNew);
+		for (int i = 0; i < nc; i++) {
+			yNew.ElementN(i) = gammaNew.ElementN(i) + beta * (gammaNew.ElementN(i) - gamma.ElementN(i));
+		}
+
+		double res = Residual(sysd, gammaNew);
+		if (res < residual) {
+			residual = res;
+			gammaBest = gammaNew;
+		}
+		AtIterationEnd(residual, 0, iter);
+		tot_iterations++;
+		if (residual < tolerance) {
+			break;
+		}
+
+		// Restart the momentum when it points uphill
+		for (int i = 0; i < nc; i++) {
+			tmp.ElementN(i) = gammaNew.ElementN(i) - gamma.ElementN(i);
+		}
+		if (Dot(g, tmp) > 0) {
+			yNew = gammaNew;
+			thetaNew = 1.0;
+		}
+
+		L *= 0.9;
+		t = 1.0 / L;
+		theta = thetaNew;
+		gamma = gammaNew;
+		y = yNew;
+	}
+
+	// v = M^-1*(f + D*l), the products above overwrote the variables' q
+	sysd.FromVectorToConstraints(gammaBest);
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			variable->Compute_invMb_v(variable->Get_qb(), variable->Get_fb());
+		}
+	}
+	for (auto constraint : sysd.GetConstraintsList()) {
+		if (constraint->IsActive()) {
+			constraint->Increment_q(constraint->Get_l_i());
+		}
+	}
+	return residual;
+}
@@ -0,0 +1,458 @@
+#include "ChSolverArticulated.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+#include "chrono/solver/ChConstraintTwoBodies.h"
+#include "chrono/solver/ChVariablesBody.h"
+#include <cmath>
+
+namespace {
+	// Redundant rows leave a joint block singular, its pivots are kept off zero
+	const double PivotEpsilon = 1e-12;
+
+	// In place Gauss-Jordan with partial pivoting, the blocks are symmetric but indefinite
+	void Invert(double m[6][6], int32 n)
+	{
+		double a[6][12];
+		double scale = 0;
+		for (int32 i = 0; i < n; i++) {
+			for (int32 j = 0; j < n; j++) {
+				a[i][j] = m[i][j];
+				a[i][n + j] = i == j ? 1.0 : 0.0;
+				scale = FMath::Max(scale, std::fabs(m[i][j]));
+			}
+		}
+		double epsilon = PivotEpsilon * FMath::Max(scale, 1.0);
+		for (int32 c = 0; c < n; c++) {
+			int32 pivot = c;
+			for (int32 r = c + 1; r < n; r++) {
+				if (std::fabs(a[r][c]) > std::fabs(a[pivot][c])) {
+					pivot = r;
+				}
+			}
+			if (pivot != c) {
+				for (int32 k = 0; k < 2 * n; k++) {
+					Swap(a[c][k], a[pivot][k]);
+				}
+			}
+			if (std::fabs(a[c][c]) < epsilon) {
+				a[c][c] = a[c][c] < 0 ? -epsilon : epsilon;
+			}
+			double inverse = 1.0 / a[c][c];
+			for (int32 k = 0; k < 2 * n; k++) {
+				a[c][k] *= inverse;
+			}
+			for (int32 r = 0; r < n; r++) {
+				if (r != c && a[r][c] != 0.0) {
+					double factor = a[r][c];
+					for (int32 k = 0; k < 2 * n; k++) {
+						a[r][k] -= factor * a[c][k];
+					}
+				}
+			}
+		}
+		for (int32 i = 0; i < n; i++) {
+			for (int32 j = 0; j < n; j++) {
+				m[i][j] = a[i][n + j];
+			}
+		}
+	}
+
+	FORCEINLINE chrono::ChVariablesBody* GetActiveBody(chrono::ChVariables* variables)
+	{
+		return variables && variables->IsActive() ? dynamic_cast<chrono::ChVariablesBody*>(variables) : nullptr;
+	}
+
+	FORCEINLINE double GetCq(chrono::ChConstraint* row, bool bSideA, int32 column)
+	{
+		auto two = static_cast<chrono::ChConstraintTwoBodies*>(row);
+		return (*(bSideA ? two->Get_Cq_a() : two->Get_Cq_b()))(0, column);
+	}
+
+	int32 FindRoot(std::vector<int32>& parents, int32 i)
+	{
+		while (parents[i] != i) {
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+}
+
+void FChSolverArticulated::BuildTrees(chrono::ChSystemDescriptor& sysd)
+{
+	active.clear();
+	for (auto constraint : sysd.GetConstraintsList()) {
+		if (constraint->IsActive()) {
+			active.push_back(constraint);
+		}
+	}
+
+	// The rows of a ChLinkLock follow each other and act on the same two bodies
+	struct FJoint
+	{
+		int32 First;
+		int32 Size;
+		chrono::ChVariables* RawA;
+		chrono::ChVariables* RawB;
+		chrono::ChVariablesBody* A;
+		chrono::ChVariablesBody* B;
+	};
+	std::vector<FJoint> joints;
+	units.clear();
+	for (int32 i = 0; i < (int32)active.size();) {
+		chrono::ChConstraint* constraint = active[i];
+		auto two = constraint->GetMode() == chrono::CONSTRAINT_LOCK ? dynamic_cast<chrono::ChConstraintTwoBodies*>(constraint) : nullptr;
+		if (!two) {
+			int32 size = constraint->GetMode() == chrono::CONSTRAINT_FRIC && i + 2 < (int32)active.size() ? 3 : 1;
+			units.push_back({ i, size });
+			i += size;
+			continue;
+		}
+		FJoint joint = { i, 1, two->GetVariables_a(), two->GetVariables_b(), GetActiveBody(two->GetVariables_a()), GetActiveBody(two->GetVariables_b()) };
+		i++;
+		while (i < (int32)active.size() && joint.Size < 6 && active[i]->GetMode() == chrono::CONSTRAINT_LOCK) {
+			auto next = dynamic_cast<chrono::ChConstraintTwoBodies*>(active[i]);
+			if (!next || next->GetVariables_a() != joint.RawA || next->GetVariables_b() != joint.RawB) {
+				break;
+			}
+			joint.Size++;
+			i++;
+		}
+		joints.push_back(joint);
+	}
+
+	// Joints closing a loop, or whose bodies aren't rigid bodies, are swept with the contacts
+	TMap<chrono::ChVariablesBody*, int32> bodyIndices;
+	std::vector<chrono::ChVariablesBody*> bodies;
+	std::vector<int32> roots;
+	auto indexOf = [&](chrono::ChVariablesBody* body) {
+		if (int32* found = bodyIndices.Find(body)) {
+			return *found;
+		}
+		bodies.push_back(body);
+		roots.push_back((int32)roots.size());
+		return bodyIndices.Add(body, (int32)bodies.size() - 1);
+	};
+	std::vector<FJoint> treeJoints;
+	for (const FJoint& joint : joints) {
+		bool bRigidA = joint.A || !joint.RawA || !joint.RawA->IsActive();
+		bool bRigidB = joint.B || !joint.RawB || !joint.RawB->IsActive();
+		bool bTree = bRigidA && bRigidB && (joint.A || joint.B);
+		if (bTree && joint.A && joint.B) {
+			int32 rootA = FindRoot(roots, indexOf(joint.A));
+			int32 rootB = FindRoot(roots, indexOf(joint.B));
+			bTree = rootA != rootB;
+			if (bTree) {
+				roots[rootA] = rootB;
+			}
+		}
+		if (!bTree) {
+			for (int32 k = 0; k < joint.Size; k++) {
+				units.push_back({ joint.First + k, 1 });
+			}
+			continue;
+		}
+		if (joint.A) {
+			indexOf(joint.A);
+		}
+		if (joint.B) {
+			indexOf(joint.B);
+		}
+		treeJoints.push_back(joint);
+	}
+	treeJointNum = (int32)treeJoints.size();
+
+	std::vector<std::vector<int32>> bodyJoints(bodies.size());
+	for (int32 j = 0; j < treeJointNum; j++) {
+		if (treeJoints[j].A) {
+			bodyJoints[bodyIndices[treeJoints[j].A]].push_back(j);
+		}
+		if (treeJoints[j].B) {
+			bodyJoints[bodyIndices[treeJoints[j].B]].push_back(j);
+		}
+	}
+
+	// Breadth first from a body of each tree, reversed below so children come before their parents
+	struct FVisit
+	{
+		bool bJoint;
+		int32 Index;
+		int32 Parent;
+	};
+	std::vector<FVisit> visits;
+	std::vector<char> bodyVisited(bodies.size(), 0);
+	std::vector<char> jointVisited(treeJointNum, 0);
+	for (int32 start = 0; start < (int32)bodies.size(); start++) {
+		if (bodyVisited[start] || bodyJoints[start].empty()) {
+			continue;
+		}
+		bodyVisited[start] = 1;
+		size_t head = visits.size();
+		visits.push_back({ false, start, INDEX_NONE });
+		while (head < visits.size()) {
+			FVisit visit = visits[head];
+			int32 self = (int32)head++;
+			if (!visit.bJoint) {
+				for (int32 j : bodyJoints[visit.Index]) {
+					if (!jointVisited[j]) {
+						jointVisited[j] = 1;
+						visits.push_back({ true, j, self });
+					}
+				}
+			}
+			else {
+				for (chrono::ChVariablesBody* body : { treeJoints[visit.Index].A, treeJoints[visit.Index].B }) {
+					int32 b = body ? bodyIndices[body] : INDEX_NONE;
+					if (b != INDEX_NONE && !bodyVisited[b]) {
+						bodyVisited[b] = 1;
+						visits.push_back({ false, b, self });
+					}
+				}
+			}
+		}
+	}
+
+	int32 count = (int32)visits.size();
+	nodes.assign(count, FNode());
+	treeRows.clear();
+	for (int32 v = 0; v < count; v++) {
+		const FVisit& visit = visits[v];
+		FNode& node = nodes[count - 1 - v];
+		node.Parent = visit.Parent == INDEX_NONE ? INDEX_NONE : count - 1 - visit.Parent;
+		FMemory::Memzero(node.DInv, sizeof(node.DInv));
+		FMemory::Memzero(node.H, sizeof(node.H));
+
+		// DInv holds D until Factor inverts it
+		if (!visit.bJoint) {
+			chrono::ChVariablesBody* body = bodies[visit.Index];
+			node.Size = 6;
+			for (int32 k = 0; k < 3; k++) {
+				node.DInv[k][k] = body->GetBodyMass();
+			}
+			const chrono::ChMatrix33<>& inertia = body->GetBodyInertia();
+			for (int32 r = 0; r < 3; r++) {
+				for (int32 c = 0; c < 3; c++) {
+					node.DInv[3 + r][3 + c] = inertia(r, c);
+				}
+			}
+			// The parent is a joint, H is the transpose of its rows for this body
+			if (visit.Parent != INDEX_NONE) {
+				const FJoint& parent = treeJoints[visits[visit.Parent].Index];
+				bool bSideA = parent.A == body;
+				for (int32 k = 0; k < parent.Size; k++) {
+					for (int32 c = 0; c < 6; c++) {
+						node.H[c][k] = GetCq(active[parent.First + k], bSideA, c);
+					}
+				}
+			}
+		}
+		else {
+			const FJoint& joint = treeJoints[visit.Index];
+			node.Size = joint.Size;
+			node.FirstRow = (int32)treeRows.size();
+			for (int32 k = 0; k < joint.Size; k++) {
+				treeRows.push_back(active[joint.First + k]);
+				node.DInv[k][k] = -active[joint.First + k]->Get_cfm_i();
+			}
+			chrono::ChVariablesBody* parentBody = bodies[visits[visit.Parent].Index];
+			bool bSideA = joint.A == parentBody;
+			for (int32 k = 0; k < joint.Size; k++) {
+				for (int32 c = 0; c < 6; c++) {
+					node.H[k][c] = GetCq(active[joint.First + k], bSideA, c);
+				}
+			}
+		}
+	}
+}
+
+void FChSolverArticulated::Factor()
+{
+	for (FNode& node : nodes) {
+		Invert(node.DInv, node.Size);
+		if (node.Parent == INDEX_NONE) {
+			continue;
+		}
+		FNode& parent = nodes[node.Parent];
+		for (int32 r = 0; r < node.Size; r++) {
+			for (int32 c = 0; c < parent.Size; c++) {
+				double sum = 0;
+				for (int32 k = 0; k < node.Size; k++) {
+					sum += node.DInv[r][k] * node.H[k][c];
+				}
+				node.J[r][c] = sum;
+			}
+		}
+		// D(parent) -= H^T D^-1 H
+		for (int32 r = 0; r < parent.Size; r++) {
+			for (int32 c = 0; c < parent.Size; c++) {
+				double sum = 0;
+				for (int32 k = 0; k < node.Size; k++) {
+					sum += node.H[k][r] * node.J[k][c];
+				}
+				parent.DInv[r][c] -= sum;
+			}
+		}
+	}
+}
+
+double FChSolverArticulated::SolveTrees(double& outDeltaLambda)
+{
+	// H [dv; dl] = [0; r] with r the joint residual, dl is then the exact multiplier correction
+	double violation = 0;
+	for (FNode& node : nodes) {
+		for (int32 k = 0; k < node.Size; k++) {
+			node.X[k] = 0;
+		}
+		if (node.FirstRow == INDEX_NONE) {
+			continue;
+		}
+		for (int32 k = 0; k < node.Size; k++) {
+			chrono::ChConstraint* row = treeRows[node.FirstRow + k];
+			double residual = row->Compute_Cq_q() + row->Get_b_i();
+			violation = FMath::Max(violation, std::fabs(residual));
+			node.X[k] = residual + row->Get_cfm_i() * row->Get_l_i();
+		}
+	}
+
+	for (FNode& node : nodes) {
+		if (node.Parent == INDEX_NONE) {
+			continue;
+		}
+		FNode& parent = nodes[node.Parent];
+		for (int32 c = 0; c < parent.Size; c++) {
+			double sum = 0;
+			for (int32 k = 0; k < node.Size; k++) {
+				sum += node.J[k][c] * node.X[k];
+			}
+			parent.X[c] -= sum;
+		}
+	}
+	for (FNode& node : nodes) {
+		double x[6];
+		for (int32 r = 0; r < node.Size; r++) {
+			x[r] = 0;
+			for (int32 k = 0; k < node.Size; k++) {
+				x[r] += node.DInv[r][k] * node.X[k];
+			}
+		}
+		for (int32 r = 0; r < node.Size; r++) {
+			node.X[r] = x[r];
+		}
+	}
+	for (int32 i = (int32)nodes.size() - 1; i >= 0; i--) {
+		FNode& node = nodes[i];
+		if (node.Parent == INDEX_NONE) {
+			continue;
+		}
+		const FNode& parent = nodes[node.Parent];
+		for (int32 r = 0; r < node.Size; r++) {
+			double sum = 0;
+			for (int32 c = 0; c < parent.Size; c++) {
+				sum += node.J[r][c] * parent.X[c];
+			}
+			node.X[r] -= sum;
+		}
+	}
+
+	outDeltaLambda = 0;
+	for (const FNode& node : nodes) {
+		if (node.FirstRow == INDEX_NONE) {
+			continue;
+		}
+		for (int32 k = 0; k < node.Size; k++) {
+			chrono::ChConstraint* row = treeRows[node.FirstRow + k];
+			row->Set_l_i(row->Get_l_i() + node.X[k]);
+			row->Increment_q(node.X[k]);
+			outDeltaLambda = FMath::Max(outDeltaLambda, std::fabs(node.X[k]));
+		}
+	}
+	return violation;
+}
+
+double FChSolverArticulated::SolveUnit(const FUnit& unit, double& outDeltaLambda)
+{
+	double oldLambda[3];
+	double violation = 0;
+	for (int32 k = 0; k < unit.Size; k++) {
+		chrono::ChConstraint* constraint = active[unit.First + k];
+		double residual = constraint->Compute_Cq_q() + constraint->Get_b_i();
+		double deltal = (omega / constraint->Get_g_i()) * (-residual - constraint->Get_cfm_i() * constraint->Get_l_i());
+		oldLambda[k] = constraint->Get_l_i();
+		constraint->Set_l_i(oldLambda[k] + deltal);
+		if (unit.Size == 1) {
+			violation = std::fabs(constraint->Violation(residual));
+		}
+		else if (k == 0) {
+			violation = std::fabs(FMath::Min(0.0, residual));
+		}
+	}
+
+	// The normal row projects the whole friction cone
+	active[unit.First]->Project();
+	outDeltaLambda = 0;
+	for (int32 k = 0; k < unit.Size; k++) {
+		chrono::ChConstraint* constraint = active[unit.First + k];
+		double newLambda = constraint->Get_l_i();
+		if (shlambda != 1.0) {
+			newLambda = shlambda * newLambda + (1.0 - shlambda) * oldLambda[k];
+			constraint->Set_l_i(newLambda);
+		}
+		double trueDelta = newLambda - oldLambda[k];
+		constraint->Increment_q(trueDelta);
+		outDeltaLambda = FMath::Max(outDeltaLambda, std::fabs(trueDelta));
+	}
+	return violation;
+}
+
+double FChSolverArticulated::Solve(chrono::ChSystemDescriptor& sysd)
+{
+	tot_iterations = 0;
+	for (auto constraint : sysd.GetConstraintsList()) {
+		constraint->Update_auxiliary();
+	}
+	// Masses and Jacobians hold for the whole solve, the trees are factored once
+	BuildTrees(sysd);
+	Factor();
+
+	// The three rows of a contact share one g_i, like ChSolverSOR
+	for (const FUnit& unit : units) {
+		if (unit.Size == 3) {
+			double average = (active[unit.First]->Get_g_i() + active[unit.First + 1]->Get_g_i() + active[unit.First + 2]->Get_g_i()) / 3.0;
+			for (int32 k = 0; k < 3; k++) {
+				active[unit.First + k]->Set_g_i(average);
+			}
+		}
+	}
+
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			variable->Compute_invMb_v(variable->Get_qb(), variable->Get_fb());
+		}
+	}
+	if (warm_start) {
+		for (auto constraint : active) {
+			constraint->Increment_q(constraint->Get_l_i());
+		}
+	}
+	else {
+		for (auto constraint : sysd.GetConstraintsList()) {
+			constraint->Set_l_i(0.);
+		}
+	}
+
+	double maxViolation = 0;
+	for (int32 iter = 0; iter < max_iterations; iter++) {
+		double maxDeltaLambda = 0;
+		maxViolation = nodes.empty() ? 0 : SolveTrees(maxDeltaLambda);
+		for (const FUnit& unit : units) {
+			double deltaLambda;
+			maxViolation = FMath::Max(maxViolation, SolveUnit(unit, deltaLambda));
+			maxDeltaLambda = FMath::Max(maxDeltaLambda, deltaLambda);
+		}
+		AtIterationEnd(maxViolation, maxDeltaLambda, iter);
+		tot_iterations++;
+		if (maxViolation < tolerance) {
+			break;
+		}
+	}
+	return maxViolation;
+}
@@ -0,0 +1,226 @@
+#include "ChSolverColoredSOR.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+#include "chrono/solver/ChConstraintTwo.h"
+#include "chrono/solver/ChConstraintThree.h"
+#include "chrono/solver/ChConstraintTwoTuples.h"
+#include "Async/ParallelFor.h"
+#include <cmath>
+
+namespace {
+	// One bit per color in each variable's mask
+	const int32 MaxColors = 64;
+	// Smaller batches are swept on the calling thread
+	const int32 ParallelUnitCount = 64;
+
+	typedef chrono::ChVariableTupleCarrier_1vars<6>::type_constraint_tuple FBodyTuple;
+	typedef chrono::ChVariableTupleCarrier_1vars<3>::type_constraint_tuple FNodeTuple;
+
+	template <class Ta, class Tb>
+	bool GetTupleVariables(chrono::ChConstraint* constraint, chrono::ChVariables** outVariables, int32& outNum)
+	{
+		auto tuples = dynamic_cast<chrono::ChConstraintTwoTuples<Ta, Tb>*>(constraint);
+		if (!tuples) {
+			return false;
+		}
+		outVariables[outNum++] = tuples->Get_tuple_a().GetVariables();
+		outVariables[outNum++] = tuples->Get_tuple_b().GetVariables();
+		return true;
+	}
+
+	// The variables a constraint writes to, false for constraint types whose variables aren't known here
+	bool GetConstraintVariables(chrono::ChConstraint* constraint, chrono::ChVariables** outVariables, int32& outNum)
+	{
+		if (auto two = dynamic_cast<chrono::ChConstraintTwo*>(constraint)) {
+			outVariables[outNum++] = two->GetVariables_a();
+			outVariables[outNum++] = two->GetVariables_b();
+			return true;
+		}
+		if (auto three = dynamic_cast<chrono::ChConstraintThree*>(constraint)) {
+			outVariables[outNum++] = three->GetVariables_a();
+			outVariables[outNum++] = three->GetVariables_b();
+			outVariables[outNum++] = three->GetVariables_c();
+			return true;
+		}
+		// Contacts between bodies, particles and nodes
+		return GetTupleVariables<FBodyTuple, FBodyTuple>(constraint, outVariables, outNum)
+			|| GetTupleVariables<FNodeTuple, FBodyTuple>(constraint, outVariables, outNum)
+			|| GetTupleVariables<FBodyTuple, FNodeTuple>(constraint, outVariables, outNum)
+			|| GetTupleVariables<FNodeTuple, FNodeTuple>(constraint, outVariables, outNum);
+	}
+}
+
+void FChSolverColoredSOR::BuildColors(chrono::ChSystemDescriptor& sysd)
+{
+	active.clear();
+	for (auto constraint : sysd.GetConstraintsList()) {
+		if (constraint->IsActive()) {
+			active.push_back(constraint);
+		}
+	}
+
+	// Friction rows come as normal, u, v
+	units.clear();
+	for (int32 i = 0; i < (int32)active.size();) {
+		int32 size = 1;
+		if (active[i]->GetMode() == chrono::CONSTRAINT_FRIC && i + 2 < (int32)active.size()) {
+			size = 3;
+		}
+		units.push_back({ i, size });
+		i += size;
+	}
+
+	int32 dofs = 0;
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			dofs = FMath::Max(dofs, variable->GetOffset() + variable->Get_ndof());
+		}
+	}
+	std::vector<uint64> usedColors(dofs, 0);
+	std::vector<int32> unitColor(units.size());
+	std::vector<int32> colorCount(MaxColors + 1, 0);
+	colorNum = 0;
+
+	for (int32 u = 0; u < (int32)units.size(); u++) {
+		chrono::ChVariables* variables[3];
+		int32 variableNum = 0;
+		// The rows of a unit act on the same bodies
+		if (!GetConstraintVariables(active[units[u].First], variables, variableNum)) {
+			unitColor[u] = MaxColors;
+			colorCount[MaxColors]++;
+			continue;
+		}
+
+		// A fixed body's variables are inactive, the solver never writes to them
+		uint64 used = 0;
+		for (int32 v = 0; v < variableNum; v++) {
+			if (variables[v] && variables[v]->IsActive()) {
+				used |= usedColors[variables[v]->GetOffset()];
+			}
+		}
+		int32 color = ~used ? (int32)FMath::CountTrailingZeros64(~used) : MaxColors;
+		if (color < MaxColors) {
+			for (int32 v = 0; v < variableNum; v++) {
+				if (variables[v] && variables[v]->IsActive()) {
+					usedColors[variables[v]->GetOffset()] |= 1ull << color;
+				}
+			}
+			colorNum = FMath::Max(colorNum, color + 1);
+		}
+		unitColor[u] = color;
+		colorCount[color]++;
+	}
+
+	// Counting sort by color, stable so each batch keeps the descriptor order
+	batchStart.assign(MaxColors + 2, 0);
+	for (int32 c = 0; c <= MaxColors; c++) {
+		batchStart[c + 1] = batchStart[c] + colorCount[c];
+	}
+	std::vector<int32> cursor(batchStart.begin(), batchStart.end() - 1);
+	batchUnits.resize(units.size());
+	for (int32 u = 0; u < (int32)units.size(); u++) {
+		batchUnits[cursor[unitColor[u]]++] = u;
+	}
+	unitViolation.assign(units.size(), 0.0);
+	unitDeltaLambda.assign(units.size(), 0.0);
+}
+
+double FChSolverColoredSOR::SolveUnit(const FUnit& unit, double& outDeltaLambda)
+{
+	double oldLambda[3];
+	double violation = 0;
+	for (int32 k = 0; k < unit.Size; k++) {
+		chrono::ChConstraint* constraint = active[unit.First + k];
+		double residual = constraint->Compute_Cq_q() + constraint->Get_b_i();
+		double deltal = (omega / constraint->Get_g_i()) * (-residual - constraint->Get_cfm_i() * constraint->Get_l_i());
+		oldLambda[k] = constraint->Get_l_i();
+		constraint->Set_l_i(oldLambda[k] + deltal);
+		if (unit.Size == 1) {
+			violation = std::fabs(constraint->Violation(residual));
+		}
+		else if (k == 0) {
+			violation = std::fabs(FMath::Min(0.0, residual));
+		}
+	}
+
+	// The normal row projects the whole friction cone
+	active[unit.First]->Project();
+	outDeltaLambda = 0;
+	for (int32 k = 0; k < unit.Size; k++) {
+		chrono::ChConstraint* constraint = active[unit.First + k];
+		double newLambda = constraint->Get_l_i();
+		if (shlambda != 1.0) {
+			newLambda = shlambda * newLambda + (1.0 - shlambda) * oldLambda[k];
+			constraint->Set_l_i(newLambda);
+		}
+		double trueDelta = newLambda - oldLambda[k];
+		constraint->Increment_q(trueDelta);
+		outDeltaLambda = FMath::Max(outDeltaLambda, std::fabs(trueDelta));
+	}
+	return violation;
+}
+
+double FChSolverColoredSOR::Solve(chrono::ChSystemDescriptor& sysd)
+{
+	tot_iterations = 0;
+	for (auto constraint : sysd.GetConstraintsList()) {
+		constraint->Update_auxiliary();
+	}
+	BuildColors(sysd);
+
+	// The three rows of a contact share one g_i, like ChSolverSOR
+	for (const FUnit& unit : units) {
+		if (unit.Size == 3) {
+			double average = (active[unit.First]->Get_g_i() + active[unit.First + 1]->Get_g_i() + active[unit.First + 2]->Get_g_i()) / 3.0;
+			for (int32 k = 0; k < 3; k++) {
+				active[unit.First + k]->Set_g_i(average);
+			}
+		}
+	}
+
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			variable->Compute_invMb_v(variable->Get_qb(), variable->Get_fb());
+		}
+	}
+	if (warm_start) {
+		for (auto constraint : active) {
+			constraint->Increment_q(constraint->Get_l_i());
+		}
+	}
+	else {
+		for (auto constraint : sysd.GetConstraintsList()) {
+			constraint->Set_l_i(0.);
+		}
+	}
+
+	double maxViolation = 0;
+	for (int32 iter = 0; iter < max_iterations; iter++) {
+		for (int32 c = 0; c <= MaxColors; c++) {
+			int32 begin = batchStart[c];
+			int32 count = batchStart[c + 1] - begin;
+			if (count == 0) {
+				continue;
+			}
+			// The batch past the colors shares bodies, it always runs serially
+			bool bSerial = c == MaxColors || count < ParallelUnitCount;
+			ParallelFor(count, [&](int32 i) {
+				int32 u = batchUnits[begin + i];
+				unitViolation[u] = SolveUnit(units[u], unitDeltaLambda[u]);
+			}, bSerial);
+		}
+
+		// Reduced in unit order, the same for any thread count
+		maxViolation = 0;
+		double maxDeltaLambda = 0;
+		for (int32 u = 0; u < (int32)units.size(); u++) {
+			maxViolation = FMath::Max(maxViolation, unitViolation[u]);
+			maxDeltaLambda = FMath::Max(maxDeltaLambda, unitDeltaLambda[u]);
+		}
+		AtIterationEnd(maxViolation, maxDeltaLambda, iter);
+		tot_iterations++;
+		if (maxViolation < tolerance) {
+			break;
+		}
+	}
+	return maxViolation;
+}
@@ -0,0 +1,289 @@
+#include "ChSolverIslands.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+#include "chrono/solver/ChConstraintTwo.h"
+#include "chrono/solver/ChConstraintThree.h"
+#include "chrono/solver/ChConstraintTwoTuples.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	typedef chrono::ChVariableTupleCarrier_1vars<6>::type_constraint_tuple FBodyTuple;
+	typedef chrono::ChVariableTupleCarrier_1vars<3>::type_constraint_tuple FNodeTuple;
+
+	template <class Ta, class Tb>
+	bool GetTupleVariables(chrono::ChConstraint* constraint, chrono::ChVariables** outVariables, int32& outNum)
+	{
+		auto tuples = dynamic_cast<chrono::ChConstraintTwoTuples<Ta, Tb>*>(constraint);
+		if (!tuples) {
+			return false;
+		}
+		outVariables[outNum++] = tuples->Get_tuple_a().GetVariables();
+		outVariables[outNum++] = tuples->Get_tuple_b().GetVariables();
+		return true;
+	}
+
+	// The variables a constraint writes to, false for constraint types whose variables aren't known here
+	bool GetConstraintVariables(chrono::ChConstraint* constraint, chrono::ChVariables** outVariables, int32& outNum)
+	{
+		if (auto two = dynamic_cast<chrono::ChConstraintTwo*>(constraint)) {
+			outVariables[outNum++] = two->GetVariables_a();
+			outVariables[outNum++] = two->GetVariables_b();
+			return true;
+		}
+		if (auto three = dynamic_cast<chrono::ChConstraintThree*>(constraint)) {
+			outVariables[outNum++] = three->GetVariables_a();
+			outVariables[outNum++] = three->GetVariables_b();
+			outVariables[outNum++] = three->GetVariables_c();
+			return true;
+		}
+		// Contacts between bodies, particles and nodes
+		return GetTupleVariables<FBodyTuple, FBodyTuple>(constraint, outVariables, outNum)
+			|| GetTupleVariables<FNodeTuple, FBodyTuple>(constraint, outVariables, outNum)
+			|| GetTupleVariables<FBodyTuple, FNodeTuple>(constraint, outVariables, outNum)
+			|| GetTupleVariables<FNodeTuple, FNodeTuple>(constraint, outVariables, outNum);
+	}
+
+	// Union-find over variable offsets
+	int32 FindRoot(std::vector<int32>& parents, int32 i)
+	{
+		while (parents[i] != i) {
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+}
+
+void FChSolverIslands::BuildIslands(chrono::ChSystemDescriptor& sysd)
+{
+	active.clear();
+	for (auto constraint : sysd.GetConstraintsList()) {
+		if (constraint->IsActive()) {
+			active.push_back(constraint);
+		}
+	}
+
+	// Friction rows come as normal, u, v
+	units.clear();
+	for (int32 i = 0; i < (int32)active.size();) {
+		int32 size = 1;
+		if (active[i]->GetMode() == chrono::CONSTRAINT_FRIC && i + 2 < (int32)active.size()) {
+			size = 3;
+		}
+		units.push_back({ i, size });
+		i += size;
+	}
+
+	int32 dofs = 0;
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			dofs = FMath::Max(dofs, variable->GetOffset() + variable->Get_ndof());
+		}
+	}
+	std::vector<int32> parents(dofs);
+	for (int32 i = 0; i < dofs; i++) {
+		parents[i] = i;
+	}
+
+	// The first active variable of each unit, -1 when it touches only fixed or sleeping bodies
+	std::vector<int32> unitRoot(units.size(), -1);
+	bool bSingleIsland = false;
+	for (int32 u = 0; u < (int32)units.size(); u++) {
+		chrono::ChVariables* variables[3];
+		int32 variableNum = 0;
+		// The rows of a unit act on the same bodies
+		if (!GetConstraintVariables(active[units[u].First], variables, variableNum)) {
+			bSingleIsland = true;
+			continue;
+		}
+		for (int32 v = 0; v < variableNum; v++) {
+			if (!variables[v] || !variables[v]->IsActive()) {
+				continue;
+			}
+			int32 offset = variables[v]->GetOffset();
+			if (unitRoot[u] < 0) {
+				unitRoot[u] = offset;
+			}
+			else {
+				int32 rootA = FindRoot(parents, unitRoot[u]);
+				int32 rootB = FindRoot(parents, offset);
+				if (rootA != rootB) {
+					parents[rootB] = rootA;
+				}
+			}
+		}
+	}
+
+	// Islands numbered by their first unit, so the order only depends on the descriptor
+	std::vector<int32> islandOf(dofs, -1);
+	std::vector<int32> unitIsland(units.size(), -1);
+	std::vector<int32> islandSize;
+	skippedNum = 0;
+	for (int32 u = 0; u < (int32)units.size(); u++) {
+		if (bSingleIsland) {
+			if (islandSize.empty()) {
+				islandSize.push_back(0);
+			}
+			unitIsland[u] = 0;
+		}
+		else if (unitRoot[u] >= 0) {
+			int32 root = FindRoot(parents, unitRoot[u]);
+			if (islandOf[root] < 0) {
+				islandOf[root] = (int32)islandSize.size();
+				islandSize.push_back(0);
+			}
+			unitIsland[u] = islandOf[root];
+		}
+		else {
+			skippedNum += units[u].Size;
+			continue;
+		}
+		islandSize[unitIsland[u]]++;
+	}
+
+	std::vector<int32> order(islandSize.size());
+	for (int32 i = 0; i < (int32)order.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int32 a, int32 b) { return islandSize[a] > islandSize[b]; });
+	std::vector<int32> rank(order.size());
+	islandStart.assign(order.size() + 1, 0);
+	for (int32 i = 0; i < (int32)order.size(); i++) {
+		rank[order[i]] = i;
+		islandStart[i + 1] = islandStart[i] + islandSize[order[i]];
+	}
+
+	// Counting sort by island, stable so each island keeps the descriptor order
+	std::vector<int32> cursor(islandStart.begin(), islandStart.end() - 1);
+	islandUnits.resize(islandStart.back());
+	for (int32 u = 0; u < (int32)units.size(); u++) {
+		if (unitIsland[u] >= 0) {
+			islandUnits[cursor[rank[unitIsland[u]]]++] = u;
+		}
+	}
+}
+
+double FChSolverIslands::SolveUnit(const FUnit& unit, double& outDeltaLambda)
+{
+	double oldLambda[3];
+	double violation = 0;
+	for (int32 k = 0; k < unit.Size; k++) {
+		chrono::ChConstraint* constraint = active[unit.First + k];
+		double residual = constraint->Compute_Cq_q() + constraint->Get_b_i();
+		double deltal = (omega / constraint->Get_g_i()) * (-residual - constraint->Get_cfm_i() * constraint->Get_l_i());
+		oldLambda[k] = constraint->Get_l_i();
+		constraint->Set_l_i(oldLambda[k] + deltal);
+		if (unit.Size == 1) {
+			violation = std::fabs(constraint->Violation(residual));
+		}
+		else if (k == 0) {
+			violation = std::fabs(FMath::Min(0.0, residual));
+		}
+	}
+
+	// The normal row projects the whole friction cone
+	active[unit.First]->Project();
+	outDeltaLambda = 0;
+	for (int32 k = 0; k < unit.Size; k++) {
+		chrono::ChConstraint* constraint = active[unit.First + k];
+		double newLambda = constraint->Get_l_i();
+		if (shlambda != 1.0) {
+			newLambda = shlambda * newLambda + (1.0 - shlambda) * oldLambda[k];
+			constraint->Set_l_i(newLambda);
+		}
+		double trueDelta = newLambda - oldLambda[k];
+		constraint->Increment_q(trueDelta);
+		outDeltaLambda = FMath::Max(outDeltaLambda, std::fabs(trueDelta));
+	}
+	return violation;
+}
+
+int32 FChSolverIslands::SolveIsland(int32 island)
+{
+	// Only the last iteration is kept when no history is recorded
+	int32 stride = record_violation_history ? max_iterations : 1;
+	int32 iterations = 0;
+	for (int32 iter = 0; iter < max_iterations; iter++) {
+		double maxViolation = 0;
+		double maxDeltaLambda = 0;
+		for (int32 i = islandStart[island]; i < islandStart[island + 1]; i++) {
+			double deltaLambda;
+			maxViolation = FMath::Max(maxViolation, SolveUnit(units[islandUnits[i]], deltaLambda));
+			maxDeltaLambda = FMath::Max(maxDeltaLambda, deltaLambda);
+		}
+		int32 slot = island * stride + (record_violation_history ? iter : 0);
+		islandViolation[slot] = maxViolation;
+		islandDeltaLambda[slot] = maxDeltaLambda;
+		iterations++;
+		if (maxViolation < tolerance) {
+			break;
+		}
+	}
+	return iterations;
+}
+
+double FChSolverIslands::Solve(chrono::ChSystemDescriptor& sysd)
+{
+	tot_iterations = 0;
+	for (auto constraint : sysd.GetConstraintsList()) {
+		constraint->Update_auxiliary();
+	}
+	BuildIslands(sysd);
+
+	// The three rows of a contact share one g_i, like ChSolverSOR
+	for (const FUnit& unit : units) {
+		if (unit.Size == 3) {
+			double average = (active[unit.First]->Get_g_i() + active[unit.First + 1]->Get_g_i() + active[unit.First + 2]->Get_g_i()) / 3.0;
+			for (int32 k = 0; k < 3; k++) {
+				active[unit.First + k]->Set_g_i(average);
+			}
+		}
+	}
+
+	for (auto variable : sysd.GetVariablesList()) {
+		if (variable->IsActive()) {
+			variable->Compute_invMb_v(variable->Get_qb(), variable->Get_fb());
+		}
+	}
+	if (warm_start) {
+		for (auto constraint : active) {
+			constraint->Increment_q(constraint->Get_l_i());
+		}
+	}
+	else {
+		for (auto constraint : sysd.GetConstraintsList()) {
+			constraint->Set_l_i(0.);
+		}
+	}
+
+	int32 islandNum = GetIslandNum();
+	int32 stride = record_violation_history ? max_iterations : 1;
+	islandViolation.assign(islandNum * stride, 0.0);
+	islandDeltaLambda.assign(islandNum * stride, 0.0);
+	islandIterations.assign(islandNum, 0);
+	// Islands share no active variable, each one is solved whole on one thread
+	ParallelFor(islandNum, [&](int32 island) {
+		islandIterations[island] = SolveIsland(island);
+	}, islandNum < 2);
+
+	for (int32 island = 0; island < islandNum; island++) {
+		tot_iterations = FMath::Max(tot_iterations, islandIterations[island]);
+	}
+	// Reduced in island order, an island that converged early keeps its final value
+	double maxViolation = 0;
+	for (int32 iter = 0; iter < tot_iterations; iter++) {
+		if (!record_violation_history && iter + 1 < tot_iterations) {
+			continue;
+		}
+		maxViolation = 0;
+		double maxDeltaLambda = 0;
+		for (int32 island = 0; island < islandNum; island++) {
+			int32 slot = island * stride + (record_violation_history ? FMath::Min(iter, islandIterations[island] - 1) : 0);
+			maxViolation = FMath::Max(maxViolation, islandViolation[slot]);
+			maxDeltaLambda = FMath::Max(maxDeltaLambda, islandDeltaLambda[slot]);
+		}
+		AtIterationEnd(maxViolation, maxDeltaLambda, iter);
+	}
+	return maxViolation;
+}
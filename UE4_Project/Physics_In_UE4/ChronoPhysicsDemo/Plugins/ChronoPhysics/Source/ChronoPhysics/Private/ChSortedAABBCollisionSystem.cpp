@@ -0,0 +1,631 @@
+#include "ChSortedAABBCollisionSystem.h"
+#include "chrono_parallel/ChDataManager.h"
+#include "chrono_parallel/collision/ChCollision.h"
+#include "chrono_parallel/collision/ChNarrowphaseR.h"
+#include "chrono_parallel/collision/ChNarrowphaseMPR.h"
+#include "Async/ParallelFor.h"
+#include "ChTrace.h"
+#include <cmath>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace {
+	// Groups of four shapes, below this many a single loop beats the task overhead
+	const int32 ParallelGroupCount = 256;
+	// Slots of a pair that isn't sphere based, box-box is the most the analytic tests write
+	const int32 MaxPairContacts = 8;
+	// Centers closer than this give no contact direction, the stock tests skip them too
+	const double MinContactDist2 = 1e-12;
+
+	// Four doubles, one per shape. Builds without AVX get the same kernel as plain loops for the compiler to vectorize
+#if defined(__AVX__)
+	struct FLane4
+	{
+		__m256d V;
+
+		static FORCEINLINE FLane4 Load(const double* p) { return { _mm256_loadu_pd(p) }; }
+		static FORCEINLINE FLane4 Set(double s) { return { _mm256_set1_pd(s) }; }
+		FORCEINLINE void Store(double* p) const { _mm256_storeu_pd(p, V); }
+		FORCEINLINE FLane4 operator+(const FLane4& b) const { return { _mm256_add_pd(V, b.V) }; }
+		FORCEINLINE FLane4 operator-(const FLane4& b) const { return { _mm256_sub_pd(V, b.V) }; }
+		FORCEINLINE FLane4 operator*(const FLane4& b) const { return { _mm256_mul_pd(V, b.V) }; }
+		FORCEINLINE FLane4 operator/(const FLane4& b) const { return { _mm256_div_pd(V, b.V) }; }
+		FORCEINLINE FLane4 Abs() const { return { _mm256_andnot_pd(_mm256_set1_pd(-0.0), V) }; }
+		FORCEINLINE FLane4 Sqrt() const { return { _mm256_sqrt_pd(V) }; }
+		FORCEINLINE FLane4 Min(const FLane4& b) const { return { _mm256_min_pd(V, b.V) }; }
+		FORCEINLINE FLane4 Max(const FLane4& b) const { return { _mm256_max_pd(V, b.V) }; }
+	};
+#else
+	struct FLane4
+	{
+		double V[4];
+
+		static FORCEINLINE FLane4 Load(const double* p) { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = p[i]; return r; }
+		static FORCEINLINE FLane4 Set(double s) { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = s; return r; }
+		FORCEINLINE void Store(double* p) const { for (int32 i = 0; i < 4; i++) p[i] = V[i]; }
+		FORCEINLINE FLane4 operator+(const FLane4& b) const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = V[i] + b.V[i]; return r; }
+		FORCEINLINE FLane4 operator-(const FLane4& b) const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = V[i] - b.V[i]; return r; }
+		FORCEINLINE FLane4 operator*(const FLane4& b) const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = V[i] * b.V[i]; return r; }
+		FORCEINLINE FLane4 operator/(const FLane4& b) const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = V[i] / b.V[i]; return r; }
+		FORCEINLINE FLane4 Abs() const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = FMath::Abs(V[i]); return r; }
+		FORCEINLINE FLane4 Sqrt() const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = std::sqrt(V[i]); return r; }
+		FORCEINLINE FLane4 Min(const FLane4& b) const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = FMath::Min(V[i], b.V[i]); return r; }
+		FORCEINLINE FLane4 Max(const FLane4& b) const { FLane4 r; for (int32 i = 0; i < 4; i++) r.V[i] = FMath::Max(V[i], b.V[i]); return r; }
+	};
+#endif
+
+	struct FQuat4
+	{
+		FLane4 W, X, Y, Z;
+	};
+
+	// Row major rotation matrix of four unit quaternions
+	FORCEINLINE void RotationMatrix(const FQuat4& q, FLane4 m[9])
+	{
+		const FLane4 one = FLane4::Set(1.0), two = FLane4::Set(2.0);
+		const FLane4 xx = q.X * q.X, yy = q.Y * q.Y, zz = q.Z * q.Z;
+		const FLane4 xy = q.X * q.Y, xz = q.X * q.Z, yz = q.Y * q.Z;
+		const FLane4 wx = q.W * q.X, wy = q.W * q.Y, wz = q.W * q.Z;
+		m[0] = one - two * (yy + zz);
+		m[1] = two * (xy - wz);
+		m[2] = two * (xz + wy);
+		m[3] = two * (xy + wz);
+		m[4] = one - two * (xx + zz);
+		m[5] = two * (yz - wx);
+		m[6] = two * (xz - wy);
+		m[7] = two * (yz + wx);
+		m[8] = one - two * (xx + yy);
+	}
+
+	FORCEINLINE FQuat4 Multiply(const FQuat4& a, const FQuat4& b)
+	{
+		FQuat4 r;
+		r.W = a.W * b.W - a.X * b.X - a.Y * b.Y - a.Z * b.Z;
+		r.X = a.W * b.X + a.X * b.W + a.Y * b.Z - a.Z * b.Y;
+		r.Y = a.W * b.Y - a.X * b.Z + a.Y * b.W + a.Z * b.X;
+		r.Z = a.W * b.Z + a.X * b.Y - a.Y * b.X + a.Z * b.W;
+		return r;
+	}
+
+	// Gathered per group, lane i is the i-th shape of the group
+	struct FShapeGroup
+	{
+		double BodyRot[4][4];
+		double BodyPos[3][4];
+		double LocalRot[4][4];
+		double LocalPos[3][4];
+		double Half[3][4];
+		double Min[3][4];
+		double Max[3][4];
+	};
+
+	FORCEINLINE FQuat4 LoadQuat(const double q[4][4])
+	{
+		return { FLane4::Load(q[0]), FLane4::Load(q[1]), FLane4::Load(q[2]), FLane4::Load(q[3]) };
+	}
+
+	enum EPairKernel {
+		SPHERE_KERNEL,
+		BOX_KERNEL,
+		CAPSULE_KERNEL
+	};
+
+	// Four pairs of a sphere based bucket, A is the sphere, box or capsule and B the sphere
+	struct FPairGroup
+	{
+		double PosA[3][4];
+		double RotA[4][4];
+		// Sphere radius, box half extents or capsule radius and half length
+		double DimsA[3][4];
+		double PosB[3][4];
+		double RadiusB[4];
+
+		double Norm[3][4];
+		double PtA[3][4];
+		double PtB[3][4];
+		double Depth[4];
+		double Dist2[4];
+		// The sphere center in the box frame, to tell faces from edges
+		double Local[3][4];
+	};
+
+	// The closed forms of sphere_sphere, box_sphere and capsule_sphere in ChNarrowphaseR for four pairs. Every lane
+	// is computed, whether it is a contact is decided per lane from Dist2 afterwards
+	template<EPairKernel Kernel>
+	FORCEINLINE void CollideGroup(FPairGroup& g)
+	{
+		FLane4 posA[3], posB[3], delta[3], norm[3], base[3];
+		for (int32 r = 0; r < 3; r++) {
+			posA[r] = FLane4::Load(g.PosA[r]);
+			posB[r] = FLane4::Load(g.PosB[r]);
+			delta[r] = posB[r] - posA[r];
+			base[r] = posA[r];
+		}
+		const FLane4 radiusB = FLane4::Load(g.RadiusB);
+		FLane4 reachA = FLane4::Load(g.DimsA[0]);
+		FLane4 m[9];
+		FLane4 local[3];
+
+		if (Kernel == BOX_KERNEL) {
+			// Box: snap the sphere center to the box in its frame
+			RotationMatrix(LoadQuat(g.RotA), m);
+			FLane4 snapped[3];
+			for (int32 r = 0; r < 3; r++) {
+				local[r] = m[0 * 3 + r] * delta[0] + m[1 * 3 + r] * delta[1] + m[2 * 3 + r] * delta[2];
+				const FLane4 half = FLane4::Load(g.DimsA[r]);
+				snapped[r] = local[r].Max(FLane4::Set(0.0) - half).Min(half);
+				local[r].Store(g.Local[r]);
+			}
+			FLane4 deltaLocal[3] = { local[0] - snapped[0], local[1] - snapped[1], local[2] - snapped[2] };
+			for (int32 r = 0; r < 3; r++) {
+				delta[r] = m[r * 3 + 0] * deltaLocal[0] + m[r * 3 + 1] * deltaLocal[1] + m[r * 3 + 2] * deltaLocal[2];
+				base[r] = posA[r] + m[r * 3 + 0] * snapped[0] + m[r * 3 + 1] * snapped[1] + m[r * 3 + 2] * snapped[2];
+			}
+			reachA = FLane4::Set(0.0);
+		}
+		else if (Kernel == CAPSULE_KERNEL) {
+			// Capsule: the closest point of the center line along its Y
+			RotationMatrix(LoadQuat(g.RotA), m);
+			const FLane4 halfLength = FLane4::Load(g.DimsA[1]);
+			const FLane4 alpha = (delta[0] * m[1] + delta[1] * m[4] + delta[2] * m[7]).Max(FLane4::Set(0.0) - halfLength).Min(halfLength);
+			for (int32 r = 0; r < 3; r++) {
+				base[r] = posA[r] + m[r * 3 + 1] * alpha;
+				delta[r] = posB[r] - base[r];
+			}
+		}
+
+		const FLane4 dist2 = delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2];
+		const FLane4 dist = dist2.Max(FLane4::Set(MinContactDist2)).Sqrt();
+		dist2.Store(g.Dist2);
+		(dist - reachA - radiusB).Store(g.Depth);
+		for (int32 r = 0; r < 3; r++) {
+			norm[r] = delta[r] / dist;
+			norm[r].Store(g.Norm[r]);
+			(base[r] + norm[r] * reachA).Store(g.PtA[r]);
+			(posB[r] - norm[r] * radiusB).Store(g.PtB[r]);
+		}
+	}
+
+	FORCEINLINE void StoreReal3(double dst[3][4], int32 lane, const chrono::real3& v)
+	{
+		for (int32 r = 0; r < 3; r++) {
+			dst[r][lane] = v[r];
+		}
+	}
+
+	FORCEINLINE chrono::real3 LoadReal3(const double src[3][4], int32 lane)
+	{
+		return chrono::real3(src[0][lane], src[1][lane], src[2][lane]);
+	}
+
+	// Same boxes as the generator: the center is the body pose applied to the shape position, the half extents
+	// of oriented shapes go through the absolute body times shape rotation, spheres keep their radius
+	template<bool bOriented>
+	FORCEINLINE void BoundGroup(FShapeGroup& g)
+	{
+		FLane4 m[9];
+		RotationMatrix(LoadQuat(g.BodyRot), m);
+		const FLane4 ox = FLane4::Load(g.LocalPos[0]), oy = FLane4::Load(g.LocalPos[1]), oz = FLane4::Load(g.LocalPos[2]);
+		FLane4 center[3];
+		for (int32 r = 0; r < 3; r++) {
+			center[r] = FLane4::Load(g.BodyPos[r]) + m[r * 3 + 0] * ox + m[r * 3 + 1] * oy + m[r * 3 + 2] * oz;
+		}
+
+		const FLane4 hx = FLane4::Load(g.Half[0]), hy = FLane4::Load(g.Half[1]), hz = FLane4::Load(g.Half[2]);
+		FLane4 half[3] = { hx, hy, hz };
+		if (bOriented) {
+			RotationMatrix(Multiply(LoadQuat(g.BodyRot), LoadQuat(g.LocalRot)), m);
+			for (int32 r = 0; r < 3; r++) {
+				half[r] = m[r * 3 + 0].Abs() * hx + m[r * 3 + 1].Abs() * hy + m[r * 3 + 2].Abs() * hz;
+			}
+		}
+		for (int32 r = 0; r < 3; r++) {
+			(center[r] - half[r]).Store(g.Min[r]);
+			(center[r] + half[r]).Store(g.Max[r]);
+		}
+	}
+}
+
+FChSortedAABBCollisionSystem::FChSortedAABBCollisionSystem(chrono::ChParallelDataManager* dataManager)
+	: chrono::collision::ChCollisionSystemParallel(dataManager), data(dataManager)
+{
+}
+
+bool FChSortedAABBCollisionSystem::PrepareSortedPass()
+{
+	const auto& shapes = data->shape_data;
+	if (shapes.typ_rigid == sortedTypes && shapes.id_rigid == sortedBodies) {
+		return bSupported;
+	}
+
+	sortedTypes = shapes.typ_rigid;
+	sortedBodies = shapes.id_rigid;
+	cachedEnvelope = -1;
+	for (TArray<int32>& list : lists) {
+		list.Reset();
+	}
+	bSupported = true;
+	const int32 num = (int32)data->num_rigid_shapes;
+	for (int32 i = 0; i < num && bSupported; i++) {
+		if (sortedBodies[i] >= data->num_rigid_bodies) {
+			bSupported = false;
+			break;
+		}
+		switch (sortedTypes[i]) {
+		case chrono::collision::SPHERE:
+			lists[SPHERE_LIST].Add(i);
+			break;
+		case chrono::collision::BOX:
+			lists[BOX_LIST].Add(i);
+			break;
+		case chrono::collision::CAPSULE:
+			lists[CAPSULE_LIST].Add(i);
+			break;
+		default:
+			bSupported = false;
+			break;
+		}
+	}
+	return bSupported;
+}
+
+void FChSortedAABBCollisionSystem::GenerateAABB()
+{
+	const auto& shapes = data->shape_data;
+	const auto& host = data->host_data;
+	const int32 numShapes = (int32)data->num_rigid_shapes;
+	const int32 numBodies = (int32)data->num_rigid_bodies;
+	const double envelope = data->settings.collision.collision_envelope;
+
+	// A new envelope or shape list recomputes everything
+	if (envelope != cachedEnvelope || (int32)shapeMin.size() != numShapes || bodyCached.Num() != numBodies) {
+		shapeMin.resize(numShapes);
+		shapeMax.resize(numShapes);
+		cachedPos.resize(numBodies);
+		cachedRot.resize(numBodies);
+		bodyCached.Init(false, numBodies);
+		cachedEnvelope = envelope;
+	}
+
+	// Fixed and sleeping bodies are inactive, their boxes are reused until the pose changes
+	bodyReused.SetNumUninitialized(numBodies);
+	ParallelFor(numBodies, [&](int32 b) {
+		const chrono::real3& pos = host.pos_rigid[b];
+		const chrono::quaternion& rot = host.rot_rigid[b];
+		const bool bInactive = !host.active_rigid[b];
+		bodyReused[b] = bInactive && bodyCached[b] && pos == cachedPos[b] && rot.w == cachedRot[b].w && rot.x == cachedRot[b].x
+			&& rot.y == cachedRot[b].y && rot.z == cachedRot[b].z;
+		if (bInactive) {
+			cachedPos[b] = pos;
+			cachedRot[b] = rot;
+		}
+		bodyCached[b] = bInactive;
+	}, numBodies < ParallelGroupCount * 4);
+
+	boundedCount = 0;
+	for (int32 type = 0; type < NUM_LISTS; type++) {
+		dirty.Reset();
+		for (int32 shape : lists[type]) {
+			if (!bodyReused[shapes.id_rigid[shape]]) {
+				dirty.Add(shape);
+			}
+		}
+		boundedCount += dirty.Num();
+		const int32 groups = FMath::DivideAndRoundUp(dirty.Num(), 4);
+		ParallelFor(groups, [&](int32 group) {
+			FShapeGroup g;
+			int32 members[4];
+			for (int32 lane = 0; lane < 4; lane++) {
+				// The last group repeats its last shape, the lane writes the same box twice
+				const int32 shape = dirty[FMath::Min(group * 4 + lane, dirty.Num() - 1)];
+				const uint body = shapes.id_rigid[shape];
+				const int32 start = shapes.start_rigid[shape];
+				members[lane] = shape;
+
+				const chrono::quaternion& bodyRot = host.rot_rigid[body];
+				const chrono::quaternion& localRot = shapes.ObR_rigid[shape];
+				g.BodyRot[0][lane] = bodyRot.w;
+				g.BodyRot[1][lane] = bodyRot.x;
+				g.BodyRot[2][lane] = bodyRot.y;
+				g.BodyRot[3][lane] = bodyRot.z;
+				g.LocalRot[0][lane] = localRot.w;
+				g.LocalRot[1][lane] = localRot.x;
+				g.LocalRot[2][lane] = localRot.y;
+				g.LocalRot[3][lane] = localRot.z;
+				for (int32 r = 0; r < 3; r++) {
+					g.BodyPos[r][lane] = host.pos_rigid[body][r];
+					g.LocalPos[r][lane] = shapes.ObA_rigid[shape][r];
+				}
+
+				chrono::real3 half;
+				if (type == SPHERE_LIST) {
+					half = chrono::real3(shapes.sphere_rigid[start]);
+				}
+				else if (type == BOX_LIST) {
+					half = shapes.box_like_rigid[start];
+				}
+				else {
+					// Radius and half length of the cylinder part, along the capsule's Y
+					const chrono::real2& capsule = shapes.capsule_rigid[start];
+					half = chrono::real3(capsule.x, capsule.x + capsule.y, capsule.x);
+				}
+				for (int32 r = 0; r < 3; r++) {
+					g.Half[r][lane] = half[r] + envelope;
+				}
+			}
+
+			if (type == SPHERE_LIST) {
+				BoundGroup<false>(g);
+			}
+			else {
+				BoundGroup<true>(g);
+			}
+
+			for (int32 lane = 0; lane < 4; lane++) {
+				const int32 shape = members[lane];
+				shapeMin[shape] = chrono::real3(g.Min[0][lane], g.Min[1][lane], g.Min[2][lane]);
+				shapeMax[shape] = chrono::real3(g.Max[0][lane], g.Max[1][lane], g.Max[2][lane]);
+			}
+		}, groups < ParallelGroupCount);
+	}
+	cachedCount = numShapes - boundedCount;
+
+	// The broadphase offsets these in place, the cache keeps the world boxes
+	auto& aabbMin = data->host_data.aabb_min;
+	auto& aabbMax = data->host_data.aabb_max;
+	aabbMin.resize(numShapes);
+	aabbMax.resize(numShapes);
+	ParallelFor(FMath::DivideAndRoundUp(numShapes, ParallelGroupCount * 4), [&](int32 chunk) {
+		const int32 end = FMath::Min(numShapes, (chunk + 1) * ParallelGroupCount * 4);
+		for (int32 i = chunk * ParallelGroupCount * 4; i < end; i++) {
+			aabbMin[i] = shapeMin[i];
+			aabbMax[i] = shapeMax[i];
+		}
+	});
+}
+
+void FChSortedAABBCollisionSystem::ProcessRigidPairs()
+{
+	auto& host = data->host_data;
+	auto& shapes = data->shape_data;
+	// The broadphase leaves the candidate pair count where the contact count goes
+	const int32 numPairs = (int32)data->num_rigid_contacts;
+	// As the stock dispatcher: the analytic tests get both shapes' envelopes, MPR grows each shape itself
+	const double envelope = data->settings.collision.collision_envelope;
+	const double edgeRadius = chrono::collision::GetDefaultEdgeRadius();
+
+	// Global shape poses, for the kernels and for the generic tests through ConvexShape
+	data->narrowphase->PreprocessLocalToParent();
+
+	// Each pair owns fixed slots in pair order, so the compacted contacts come out in the stock order
+	for (TArray<int32>& bucket : buckets) {
+		bucket.Reset();
+	}
+	pairSlot.SetNumUninitialized(numPairs + 1);
+	pairSlot[0] = 0;
+	for (int32 p = 0; p < numPairs; p++) {
+		const long long pair = host.contact_pairs[p];
+		const int typeA = shapes.typ_rigid[(int32)(pair >> 32)];
+		const int typeB = shapes.typ_rigid[(int32)(pair & 0xffffffff)];
+		int32 bucket = GENERIC_BUCKET;
+		if (typeA == chrono::collision::SPHERE || typeB == chrono::collision::SPHERE) {
+			const int other = typeA == chrono::collision::SPHERE ? typeB : typeA;
+			if (other == chrono::collision::SPHERE) {
+				bucket = SPHERE_SPHERE_BUCKET;
+			}
+			else if (other == chrono::collision::BOX) {
+				bucket = BOX_SPHERE_BUCKET;
+			}
+			else if (other == chrono::collision::CAPSULE) {
+				bucket = CAPSULE_SPHERE_BUCKET;
+			}
+		}
+		buckets[bucket].Add(p);
+		pairSlot[p + 1] = pairSlot[p] + (bucket == GENERIC_BUCKET ? MaxPairContacts : 1);
+	}
+
+	const int32 numSlots = pairSlot[numPairs];
+	host.norm_rigid_rigid.resize(numSlots);
+	host.cpta_rigid_rigid.resize(numSlots);
+	host.cptb_rigid_rigid.resize(numSlots);
+	host.dpth_rigid_rigid.resize(numSlots);
+	host.erad_rigid_rigid.resize(numSlots);
+	host.bids_rigid_rigid.resize(numSlots);
+	slotActive.Init(false, numSlots);
+
+	for (int32 bucket = SPHERE_SPHERE_BUCKET; bucket < GENERIC_BUCKET; bucket++) {
+		const TArray<int32>& list = buckets[bucket];
+		const int32 groups = FMath::DivideAndRoundUp(list.Num(), 4);
+		ParallelFor(groups, [&](int32 group) {
+			FPairGroup g;
+			int32 members[4];
+			bool bSwapped[4];
+			for (int32 lane = 0; lane < 4; lane++) {
+				// The last group repeats its last pair, the lane writes the same slot twice
+				const int32 p = list[FMath::Min(group * 4 + lane, list.Num() - 1)];
+				const long long pair = host.contact_pairs[p];
+				int32 shapeA = (int32)(pair >> 32);
+				int32 shapeB = (int32)(pair & 0xffffffff);
+				// The sphere goes second, its contact is flipped back below
+				bSwapped[lane] = bucket != SPHERE_SPHERE_BUCKET && shapes.typ_rigid[shapeA] == chrono::collision::SPHERE;
+				if (bSwapped[lane]) {
+					Swap(shapeA, shapeB);
+				}
+				members[lane] = p;
+
+				const chrono::quaternion& rot = shapes.obj_data_R_global[shapeA];
+				g.RotA[0][lane] = rot.w;
+				g.RotA[1][lane] = rot.x;
+				g.RotA[2][lane] = rot.y;
+				g.RotA[3][lane] = rot.z;
+				StoreReal3(g.PosA, lane, shapes.obj_data_A_global[shapeA]);
+				StoreReal3(g.PosB, lane, shapes.obj_data_A_global[shapeB]);
+				const int32 startA = shapes.start_rigid[shapeA];
+				if (bucket == SPHERE_SPHERE_BUCKET) {
+					StoreReal3(g.DimsA, lane, chrono::real3(shapes.sphere_rigid[startA]));
+				}
+				else if (bucket == BOX_SPHERE_BUCKET) {
+					StoreReal3(g.DimsA, lane, shapes.box_like_rigid[startA]);
+				}
+				else {
+					const chrono::real2& capsule = shapes.capsule_rigid[startA];
+					StoreReal3(g.DimsA, lane, chrono::real3(capsule.x, capsule.y, 0));
+				}
+				g.RadiusB[lane] = shapes.sphere_rigid[shapes.start_rigid[shapeB]];
+			}
+
+			if (bucket == SPHERE_SPHERE_BUCKET) {
+				CollideGroup<SPHERE_KERNEL>(g);
+			}
+			else if (bucket == BOX_SPHERE_BUCKET) {
+				CollideGroup<BOX_KERNEL>(g);
+			}
+			else {
+				CollideGroup<CAPSULE_KERNEL>(g);
+			}
+
+			for (int32 lane = 0; lane < 4; lane++) {
+				const double radiusA = bucket == BOX_SPHERE_BUCKET ? 0.0 : g.DimsA[0][lane];
+				const double radiusB = g.RadiusB[lane];
+				const double reach = radiusA + radiusB + 2 * envelope;
+				if (g.Dist2[lane] >= reach * reach || g.Dist2[lane] < MinContactDist2) {
+					continue;
+				}
+
+				chrono::real3 norm = LoadReal3(g.Norm, lane);
+				chrono::real3 ptA = LoadReal3(g.PtA, lane);
+				chrono::real3 ptB = LoadReal3(g.PtB, lane);
+				if (bSwapped[lane]) {
+					norm = -norm;
+					Swap(ptA, ptB);
+				}
+				double radius;
+				if (bucket == BOX_SPHERE_BUCKET) {
+					// Off a face the sphere keeps its radius, edges and corners get the default edge radius
+					int32 clamped = 0;
+					for (int32 r = 0; r < 3; r++) {
+						clamped += FMath::Abs(g.Local[r][lane]) > g.DimsA[r][lane];
+					}
+					radius = clamped == 1 ? radiusB : radiusB * edgeRadius / (radiusB + edgeRadius);
+				}
+				else {
+					radius = radiusA * radiusB / (radiusA + radiusB);
+				}
+
+				const long long pair = host.contact_pairs[members[lane]];
+				const int32 slot = pairSlot[members[lane]];
+				host.norm_rigid_rigid[slot] = norm;
+				host.cpta_rigid_rigid[slot] = ptA;
+				host.cptb_rigid_rigid[slot] = ptB;
+				host.dpth_rigid_rigid[slot] = g.Depth[lane];
+				host.erad_rigid_rigid[slot] = radius;
+				host.bids_rigid_rigid[slot] = chrono::_make_vec2(shapes.id_rigid[(int32)(pair >> 32)], shapes.id_rigid[(int32)(pair & 0xffffffff)]);
+				slotActive[slot] = true;
+			}
+		}, groups < ParallelGroupCount);
+	}
+
+	// One pair at a time, the same tests as NARROWPHASE_HYBRID_MPR
+	const TArray<int32>& generic = buckets[GENERIC_BUCKET];
+	ParallelFor(generic.Num(), [&](int32 i) {
+		const int32 p = generic[i];
+		const long long pair = host.contact_pairs[p];
+		chrono::collision::ConvexShape shapeA((int32)(pair >> 32), &shapes);
+		chrono::collision::ConvexShape shapeB((int32)(pair & 0xffffffff), &shapes);
+		chrono::real3 norm[MaxPairContacts];
+		chrono::real3 ptA[MaxPairContacts];
+		chrono::real3 ptB[MaxPairContacts];
+		chrono::real depth[MaxPairContacts];
+		chrono::real radius[MaxPairContacts];
+		int nC = 0;
+		if (!chrono::collision::RCollision(&shapeA, &shapeB, 2 * envelope, norm, ptA, ptB, depth, radius, nC)) {
+			nC = chrono::collision::MPRCollision(&shapeA, &shapeB, envelope, norm[0], ptA[0], ptB[0], depth[0]) ? 1 : 0;
+			radius[0] = edgeRadius;
+		}
+
+		const chrono::vec2 ids = chrono::_make_vec2(shapes.id_rigid[shapeA.index], shapes.id_rigid[shapeB.index]);
+		const int32 slot = pairSlot[p];
+		for (int32 k = 0; k < FMath::Min(nC, MaxPairContacts); k++) {
+			host.norm_rigid_rigid[slot + k] = norm[k];
+			host.cpta_rigid_rigid[slot + k] = ptA[k];
+			host.cptb_rigid_rigid[slot + k] = ptB[k];
+			host.dpth_rigid_rigid[slot + k] = depth[k];
+			host.erad_rigid_rigid[slot + k] = radius[k];
+			host.bids_rigid_rigid[slot + k] = ids;
+			slotActive[slot + k] = true;
+		}
+	}, generic.Num() < ParallelGroupCount);
+
+	// Stable, the contacts keep the pair order
+	int32 num = 0;
+	for (int32 slot = 0; slot < numSlots; slot++) {
+		if (!slotActive[slot]) {
+			continue;
+		}
+		if (num != slot) {
+			host.norm_rigid_rigid[num] = host.norm_rigid_rigid[slot];
+			host.cpta_rigid_rigid[num] = host.cpta_rigid_rigid[slot];
+			host.cptb_rigid_rigid[num] = host.cptb_rigid_rigid[slot];
+			host.dpth_rigid_rigid[num] = host.dpth_rigid_rigid[slot];
+			host.erad_rigid_rigid[num] = host.erad_rigid_rigid[slot];
+			host.bids_rigid_rigid[num] = host.bids_rigid_rigid[slot];
+		}
+		num++;
+	}
+	host.norm_rigid_rigid.resize(num);
+	host.cpta_rigid_rigid.resize(num);
+	host.cptb_rigid_rigid.resize(num);
+	host.dpth_rigid_rigid.resize(num);
+	host.erad_rigid_rigid.resize(num);
+	host.bids_rigid_rigid.resize(num);
+	data->num_rigid_contacts = num;
+
+	batchedPairCount = numPairs - generic.Num();
+	genericPairCount = generic.Num();
+}
+
+void FChSortedAABBCollisionSystem::Run()
+{
+	const auto& settings = data->settings.collision;
+	const bool bStockScene = data->num_rigid_shapes == 0 || data->num_fluid_bodies != 0 || data->num_fea_nodes != 0 || settings.use_aabb_active;
+	const bool bSortedPass = !bStockScene && bSortedAABB && PrepareSortedPass();
+	batchedPairCount = 0;
+	genericPairCount = 0;
+	if (!bSortedPass) {
+		boundedCount = 0;
+		cachedCount = 0;
+		// The stock pass doesn't keep the cache up to date
+		cachedEnvelope = -1;
+	}
+	if (bStockScene || (!bSortedPass && !bBatchedNarrowphase)) {
+		ChCollisionSystemParallel::Run();
+		return;
+	}
+
+	// Same sequence and timers as ChCollisionSystemParallel::Run without the freeze box, fluid and FEA branches
+	data->system_timer.start("collision_broad");
+	if (bSortedPass) {
+		GenerateAABB();
+	}
+	else {
+		data->aabb_generator->GenerateAABB();
+	}
+	data->broadphase->DetermineBoundingBox();
+	data->broadphase->OffsetAABB();
+	data->broadphase->ComputeTopLevelResolution();
+	data->broadphase->DispatchRigid();
+	data->system_timer.stop("collision_broad");
+
+	data->system_timer.start("collision_narrow");
+	if (bBatchedNarrowphase) {
+		ProcessRigidPairs();
+	}
+	else {
+		data->narrowphase->ProcessRigids();
+	}
+	data->system_timer.stop("collision_narrow");
+
+	CH_TRACE(COLLISION, VERBOSE, NAME_None, "Sorted collision pass: %d shapes bounded, %d cached, %d pairs batched, %d generic",
+		boundedCount, cachedCount, batchedPairCount, genericPairCount);
+}
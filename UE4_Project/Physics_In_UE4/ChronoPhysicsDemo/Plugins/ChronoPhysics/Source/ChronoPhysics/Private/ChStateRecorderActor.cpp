@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ChStateRecorderActor.h"
+#include "ChPhysicsSceneManagerActor.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+
+AChStateRecorderActor::AChStateRecorderActor()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AChStateRecorderActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (SceneManager) {
+		// Drain after the manager has stepped this frame
+		AddTickPrerequisiteActor(SceneManager);
+	}
+	if (bRecordOnBeginPlay) {
+		// The manager registers its telemetry channels in its own BeginPlay, open on the first tick
+		pendingRecordingFile = RecordingFile;
+	}
+}
+
+void AChStateRecorderActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopRecording();
+	ClosePlayback();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AChStateRecorderActor::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!pendingRecordingFile.IsEmpty()) {
+		StartRecording(pendingRecordingFile);
+		pendingRecordingFile.Empty();
+	}
+
+	if (writer.IsOpen() && SceneManager) {
+		int count = SceneManager->DrainTelemetry(drainFrames, drainTimes);
+		writer.AppendFrames(drainFrames, drainTimes, count);
+	}
+}
+
+FString AChStateRecorderActor::ResolvePath(const FString& filePath) const
+{
+	if (FPaths::IsRelative(filePath)) {
+		return FPaths::Combine(FPaths::ProjectSavedDir(), FString("ChronoRecordings"), filePath);
+	}
+	return filePath;
+}
+
+bool AChStateRecorderActor::StartRecording(const FString& filePath)
+{
+	if (!SceneManager) {
+		UE_LOG(LogTemp, Warning, TEXT("AChStateRecorderActor: no SceneManager set"));
+		return false;
+	}
+
+	auto& telemetry = SceneManager->GetTelemetry();
+	if (telemetry.GetFrameWidth() == 0) {
+		UE_LOG(LogTemp, Warning, TEXT("AChStateRecorderActor: scene manager records no telemetry, enable bRecordTelemetry and bExportData on the bodies"));
+		return false;
+	}
+
+	FString path = ResolvePath(filePath);
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(path), true);
+
+	// Frames stepped before recording started are not part of the run
+	SceneManager->DrainTelemetry(drainFrames, drainTimes);
+	return writer.Open(path, telemetry, FramesPerChunk);
+}
+
+void AChStateRecorderActor::StopRecording()
+{
+	if (writer.IsOpen() && SceneManager) {
+		int count = SceneManager->DrainTelemetry(drainFrames, drainTimes);
+		writer.AppendFrames(drainFrames, drainTimes, count);
+	}
+	writer.Close();
+}
+
+bool AChStateRecorderActor::OpenPlayback(const FString& filePath)
+{
+	return reader.Open(ResolvePath(filePath));
+}
+
+void AChStateRecorderActor::ClosePlayback()
+{
+	reader.Close();
+}
+
+bool AChStateRecorderActor::ReadPlaybackFrame(int frame, TArray<float>& values, float& time)
+{
+	const float* frameData = reader.GetFrame(frame, &time);
+	if (!frameData) {
+		values.Reset();
+		return false;
+	}
+	values.SetNumUninitialized(reader.GetFrameWidth(), false);
+	FMemory::Memcpy(values.GetData(), frameData, reader.GetFrameWidth() * sizeof(float));
+	return true;
+}
+
+FVector AChStateRecorderActor::ReadPlaybackVector(int frame, int channel)
+{
+	const float* frameData = reader.GetFrame(frame);
+	if (!frameData || channel < 0 || channel >= reader.GetChannelNum() || reader.GetChannelWidth(channel) < 3) {
+		return FVector::ZeroVector;
+	}
+	const float* value = frameData + reader.GetChannelOffset(channel);
+	return FVector(value[0], value[1], value[2]);
+}
+
+FRotator AChStateRecorderActor::ReadPlaybackRotation(int frame, int channel)
+{
+	const float* frameData = reader.GetFrame(frame);
+	if (!frameData || channel < 0 || channel >= reader.GetChannelNum() || reader.GetChannelWidth(channel) < 4) {
+		return FRotator::ZeroRotator;
+	}
+	const float* value = frameData + reader.GetChannelOffset(channel);
+	return FQuat(value[0], value[1], value[2], value[3]).Rotator();
+}
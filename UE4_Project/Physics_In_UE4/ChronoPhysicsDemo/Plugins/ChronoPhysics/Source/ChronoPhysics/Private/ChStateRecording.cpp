@@ -0,0 +1,286 @@
+#include "ChStateRecording.h"
+#include "ChTelemetry.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+
+namespace {
+	const uint32 RecordingMagic = 0x43485243;
+	const uint32 RecordingVersion = 1;
+	const int64 FooterSize = sizeof(int64) + 2 * sizeof(int32) + 2 * sizeof(uint32);
+
+	template<typename T>
+	void WriteValue(IFileHandle* file, const T& value)
+	{
+		file->Write(reinterpret_cast<const uint8*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(const uint8* data, int64 dataSize, int64& offset, T& value)
+	{
+		if (offset + (int64)sizeof(T) > dataSize) {
+			return false;
+		}
+		FMemory::Memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+}
+
+FChStateRecordWriter::~FChStateRecordWriter()
+{
+	Close();
+}
+
+bool FChStateRecordWriter::Open(const FString& filePath, const FChTelemetry& layout, int32 framesPerChunk)
+{
+	Close();
+
+	file = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*filePath);
+	if (!file) {
+		return false;
+	}
+
+	frameWidth = layout.GetFrameWidth();
+	chunkFrames = FMath::Max(framesPerChunk, 1);
+	frameCount = 0;
+	chunkTimes.Reset(chunkFrames);
+	chunkValues.Reset(chunkFrames * frameWidth);
+	chunkOffsets.Reset();
+	chunkSizes.Reset();
+
+	WriteValue(file, RecordingMagic);
+	WriteValue(file, RecordingVersion);
+	WriteValue(file, frameWidth);
+	WriteValue(file, chunkFrames);
+	WriteValue(file, layout.GetChannelNum());
+	for (int32 c = 0; c < layout.GetChannelNum(); c++) {
+		FTCHARToUTF8 name(*layout.GetChannelName(c).ToString());
+		WriteValue(file, layout.GetChannelWidth(c));
+		WriteValue(file, name.Length());
+		file->Write(reinterpret_cast<const uint8*>(name.Get()), name.Length());
+	}
+	return true;
+}
+
+void FChStateRecordWriter::AppendFrames(const TArray<float>& frames, const TArray<float>& times, int32 count)
+{
+	if (!file) {
+		return;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		chunkTimes.Add(times[i]);
+		chunkValues.Append(frames.GetData() + i * frameWidth, frameWidth);
+		frameCount++;
+		if (chunkTimes.Num() == chunkFrames) {
+			FlushChunk();
+		}
+	}
+}
+
+void FChStateRecordWriter::FlushChunk()
+{
+	if (chunkTimes.Num() == 0) {
+		return;
+	}
+
+	int32 timeBytes = chunkTimes.Num() * sizeof(float);
+	int32 valueBytes = chunkValues.Num() * sizeof(float);
+	chunkRaw.SetNumUninitialized(timeBytes + valueBytes, false);
+	FMemory::Memcpy(chunkRaw.GetData(), chunkTimes.GetData(), timeBytes);
+	FMemory::Memcpy(chunkRaw.GetData() + timeBytes, chunkValues.GetData(), valueBytes);
+
+	int32 compressedSize = FCompression::CompressMemoryBound(NAME_Zlib, chunkRaw.Num());
+	compressed.SetNumUninitialized(compressedSize, false);
+	if (!FCompression::CompressMemory(NAME_Zlib, compressed.GetData(), compressedSize, chunkRaw.GetData(), chunkRaw.Num())) {
+		UE_LOG(LogTemp, Warning, TEXT("FChStateRecordWriter: chunk compression failed, recording dropped"));
+		delete file;
+		file = nullptr;
+		chunkTimes.Reset();
+		chunkValues.Reset();
+		return;
+	}
+
+	chunkOffsets.Add(file->Tell());
+	chunkSizes.Add(compressedSize);
+	file->Write(compressed.GetData(), compressedSize);
+
+	chunkTimes.Reset();
+	chunkValues.Reset();
+}
+
+void FChStateRecordWriter::Close()
+{
+	if (!file) {
+		return;
+	}
+
+	FlushChunk();
+	if (!file) {
+		return;
+	}
+
+	int64 tableOffset = file->Tell();
+	file->Write(reinterpret_cast<const uint8*>(chunkOffsets.GetData()), chunkOffsets.Num() * sizeof(int64));
+	file->Write(reinterpret_cast<const uint8*>(chunkSizes.GetData()), chunkSizes.Num() * sizeof(int32));
+	WriteValue(file, tableOffset);
+	WriteValue(file, chunkOffsets.Num());
+	WriteValue(file, frameCount);
+	WriteValue(file, RecordingMagic);
+	WriteValue(file, RecordingVersion);
+
+	delete file;
+	file = nullptr;
+}
+
+FChStateRecordReader::~FChStateRecordReader()
+{
+	Close();
+}
+
+bool FChStateRecordReader::Open(const FString& filePath)
+{
+	Close();
+
+	mappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filePath);
+	if (mappedFile) {
+		mappedRegion = mappedFile->MapRegion();
+	}
+	if (mappedRegion) {
+		data = mappedRegion->GetMappedPtr();
+		dataSize = mappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(loadedData, *filePath, FILEREAD_Silent)) {
+		data = loadedData.GetData();
+		dataSize = loadedData.Num();
+	}
+	else {
+		Close();
+		return false;
+	}
+
+	// Footer
+	int64 offset = dataSize - FooterSize;
+	int64 tableOffset;
+	int32 chunkCount;
+	uint32 magic, version;
+	if (offset < 0 ||
+		!ReadValue(data, dataSize, offset, tableOffset) ||
+		!ReadValue(data, dataSize, offset, chunkCount) ||
+		!ReadValue(data, dataSize, offset, frameCount) ||
+		!ReadValue(data, dataSize, offset, magic) ||
+		!ReadValue(data, dataSize, offset, version) ||
+		magic != RecordingMagic || version != RecordingVersion) {
+		Close();
+		return false;
+	}
+
+	// Header
+	offset = 0;
+	int32 channelCount;
+	if (!ReadValue(data, dataSize, offset, magic) ||
+		!ReadValue(data, dataSize, offset, version) ||
+		!ReadValue(data, dataSize, offset, frameWidth) ||
+		!ReadValue(data, dataSize, offset, chunkFrames) ||
+		!ReadValue(data, dataSize, offset, channelCount) ||
+		chunkFrames <= 0) {
+		Close();
+		return false;
+	}
+
+	int32 channelOffset = 0;
+	for (int32 c = 0; c < channelCount; c++) {
+		int32 width, nameLength;
+		if (!ReadValue(data, dataSize, offset, width) || !ReadValue(data, dataSize, offset, nameLength) || offset + nameLength > dataSize) {
+			Close();
+			return false;
+		}
+		FUTF8ToTCHAR name(reinterpret_cast<const ANSICHAR*>(data + offset), nameLength);
+		channelNames.Add(FName(*FString(name.Length(), name.Get())));
+		channelOffsets.Add(channelOffset);
+		channelWidths.Add(width);
+		channelOffset += width;
+		offset += nameLength;
+	}
+
+	// Chunk table
+	int64 tableSize = chunkCount * (sizeof(int64) + sizeof(int32));
+	if (tableOffset < 0 || tableOffset + tableSize > dataSize - FooterSize) {
+		Close();
+		return false;
+	}
+	chunkOffsets.SetNumUninitialized(chunkCount);
+	chunkSizes.SetNumUninitialized(chunkCount);
+	FMemory::Memcpy(chunkOffsets.GetData(), data + tableOffset, chunkCount * sizeof(int64));
+	FMemory::Memcpy(chunkSizes.GetData(), data + tableOffset + chunkCount * sizeof(int64), chunkCount * sizeof(int32));
+	return true;
+}
+
+void FChStateRecordReader::Close()
+{
+	delete mappedRegion;
+	mappedRegion = nullptr;
+	delete mappedFile;
+	mappedFile = nullptr;
+	loadedData.Empty();
+	data = nullptr;
+	dataSize = 0;
+
+	channelNames.Empty();
+	channelOffsets.Empty();
+	channelWidths.Empty();
+	frameWidth = 0;
+	chunkFrames = 0;
+	frameCount = 0;
+	chunkOffsets.Empty();
+	chunkSizes.Empty();
+	cachedChunk = INDEX_NONE;
+}
+
+int32 FChStateRecordReader::FindChannel(FName name) const
+{
+	return channelNames.Find(name);
+}
+
+bool FChStateRecordReader::LoadChunk(int32 chunk)
+{
+	if (chunk == cachedChunk) {
+		return true;
+	}
+
+	int32 framesInChunk = FMath::Min(chunkFrames, frameCount - chunk * chunkFrames);
+	int32 rawSize = framesInChunk * (1 + frameWidth) * sizeof(float);
+	if (chunkOffsets[chunk] + chunkSizes[chunk] > dataSize) {
+		return false;
+	}
+
+	chunkRaw.SetNumUninitialized(rawSize, false);
+	if (!FCompression::UncompressMemory(NAME_Zlib, chunkRaw.GetData(), rawSize, data + chunkOffsets[chunk], chunkSizes[chunk])) {
+		cachedChunk = INDEX_NONE;
+		return false;
+	}
+	cachedChunk = chunk;
+	return true;
+}
+
+const float* FChStateRecordReader::GetFrame(int32 frame, float* outTime)
+{
+	if (!data || frame < 0 || frame >= frameCount) {
+		return nullptr;
+	}
+
+	int32 chunk = frame / chunkFrames;
+	if (chunk >= chunkOffsets.Num() || !LoadChunk(chunk)) {
+		return nullptr;
+	}
+
+	int32 framesInChunk = FMath::Min(chunkFrames, frameCount - chunk * chunkFrames);
+	int32 local = frame - chunk * chunkFrames;
+	const float* times = reinterpret_cast<const float*>(chunkRaw.GetData());
+	if (outTime) {
+		*outTime = times[local];
+	}
+	return times + framesInChunk + local * frameWidth;
+}
@@ -0,0 +1,553 @@
+#include "ChStaticMeshCollider.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/physics/ChContactContainer.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "Async/ParallelFor.h"
+#include "Math/VectorRegister.h"
+
+namespace {
+	const int32 SAHBins = 16;
+	// Below this many proxies the collision pass stays on the stepping thread
+	const int32 ParallelProxyCount = 64;
+
+	FORCEINLINE float HalfArea(const FBox& box)
+	{
+		FVector size = box.GetSize();
+		return size.X * size.Y + size.Y * size.Z + size.Z * size.X;
+	}
+
+	FORCEINLINE FVector ToVector(const chrono::ChVector<>& v)
+	{
+		return FVector(v.x(), v.y(), v.z());
+	}
+
+	FORCEINLINE chrono::ChVector<> ToChVector(const FVector& v)
+	{
+		return chrono::ChVector<>(v.X, v.Y, v.Z);
+	}
+
+	FORCEINLINE FVector Lane(const float* x, const float* y, const float* z, int32 lane)
+	{
+		return FVector(x[lane], y[lane], z[lane]);
+	}
+
+	// n.p - d of a point against the packet's four planes
+	FORCEINLINE VectorRegister PlaneDistances(const FChStaticMeshBVH::FPacket& packet, const FVector& point)
+	{
+		VectorRegister distance = VectorMultiply(VectorLoad(packet.NX), VectorSetFloat1(point.X));
+		distance = VectorMultiplyAdd(VectorLoad(packet.NY), VectorSetFloat1(point.Y), distance);
+		distance = VectorMultiplyAdd(VectorLoad(packet.NZ), VectorSetFloat1(point.Z), distance);
+		return VectorSubtract(distance, VectorLoad(packet.D));
+	}
+
+	// Ericson, Real-Time Collision Detection 5.1.5
+	FVector ClosestPointOnTriangle(const FVector& p, const FVector& a, const FVector& b, const FVector& c)
+	{
+		FVector ab = b - a, ac = c - a, ap = p - a;
+		float d1 = ab | ap, d2 = ac | ap;
+		if (d1 <= 0 && d2 <= 0) {
+			return a;
+		}
+		FVector bp = p - b;
+		float d3 = ab | bp, d4 = ac | bp;
+		if (d3 >= 0 && d4 <= d3) {
+			return b;
+		}
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			return a + ab * (d1 / (d1 - d3));
+		}
+		FVector cp = p - c;
+		float d5 = ab | cp, d6 = ac | cp;
+		if (d6 >= 0 && d5 <= d6) {
+			return c;
+		}
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			return a + ac * (d2 / (d2 - d6));
+		}
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+		float denom = 1.f / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	// Point already on the triangle's plane
+	FORCEINLINE bool IsInsideTriangle(const FVector& q, const FVector& a, const FVector& b, const FVector& c, const FVector& normal)
+	{
+		return (((b - a) ^ (q - a)) | normal) >= 0 && (((c - b) ^ (q - b)) | normal) >= 0 && (((a - c) ^ (q - c)) | normal) >= 0;
+	}
+}
+
+void FChStaticMeshBVH::Build(const std::vector<chrono::ChVector<double>>& vertices, const std::vector<chrono::ChVector<int>>& faces)
+{
+	nodes.Reset();
+	packets.Reset();
+
+	TArray<FVector> positions;
+	positions.Reserve(vertices.size());
+	for (auto& vertex : vertices) {
+		positions.Add(ToVector(vertex));
+	}
+
+	TArray<FIntVector> triangles;
+	TArray<FBox> triangleBounds;
+	TArray<FVector> centroids;
+	triangles.Reserve(faces.size());
+	triangleBounds.Reserve(faces.size());
+	centroids.Reserve(faces.size());
+	FBox meshBounds(ForceInit);
+	for (auto& face : faces) {
+		const FVector& a = positions[face.x()];
+		const FVector& b = positions[face.y()];
+		const FVector& c = positions[face.z()];
+		// Slivers have no plane to push along
+		if (((b - a) ^ (c - a)).SizeSquared() < SMALL_NUMBER * SMALL_NUMBER) {
+			continue;
+		}
+		triangles.Add(FIntVector(face.x(), face.y(), face.z()));
+		FBox bounds(ForceInit);
+		bounds += a;
+		bounds += b;
+		bounds += c;
+		triangleBounds.Add(bounds);
+		centroids.Add((a + b + c) / 3.f);
+		meshBounds += bounds;
+	}
+	if (triangles.Num() == 0) {
+		return;
+	}
+
+	origin = meshBounds.Min;
+	FVector size = meshBounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+	scale = FVector(65535.f) / size;
+
+	TArray<int32> order;
+	order.SetNumUninitialized(triangles.Num());
+	for (int32 i = 0; i < order.Num(); i++) {
+		order[i] = i;
+	}
+	nodes.Reserve(FMath::DivideAndRoundUp(triangles.Num(), LeafSize) * 2);
+	packets.Reserve(FMath::DivideAndRoundUp(triangles.Num(), LeafSize) * 2);
+	BuildNode(order, 0, order.Num(), triangleBounds, centroids, positions, triangles);
+	nodes.Shrink();
+	packets.Shrink();
+}
+
+int32 FChStaticMeshBVH::BuildNode(TArray<int32>& order, int32 begin, int32 end, const TArray<FBox>& triangleBounds, const TArray<FVector>& centroids, const TArray<FVector>& positions, const TArray<FIntVector>& triangles)
+{
+	FBox bounds(ForceInit);
+	FBox centroidBounds(ForceInit);
+	for (int32 i = begin; i < end; i++) {
+		bounds += triangleBounds[order[i]];
+		centroidBounds += centroids[order[i]];
+	}
+
+	int32 nodeIndex = nodes.AddUninitialized();
+	Quantize(bounds, nodes[nodeIndex].Min, nodes[nodeIndex].Max);
+
+	int32 count = end - begin;
+	if (count <= LeafSize) {
+		nodes[nodeIndex].Data = LeafFlag | (uint32)packets.Num();
+		FPacket& packet = packets.AddZeroed_GetRef();
+		packet.Count = count;
+		for (int32 lane = 0; lane < 4; lane++) {
+			const FIntVector& triangle = triangles[order[begin + FMath::Min(lane, count - 1)]];
+			const FVector& a = positions[triangle.X];
+			const FVector& b = positions[triangle.Y];
+			const FVector& c = positions[triangle.Z];
+			FVector normal = ((b - a) ^ (c - a)).GetSafeNormal();
+			packet.AX[lane] = a.X; packet.AY[lane] = a.Y; packet.AZ[lane] = a.Z;
+			packet.BX[lane] = b.X; packet.BY[lane] = b.Y; packet.BZ[lane] = b.Z;
+			packet.CX[lane] = c.X; packet.CY[lane] = c.Y; packet.CZ[lane] = c.Z;
+			packet.NX[lane] = normal.X; packet.NY[lane] = normal.Y; packet.NZ[lane] = normal.Z;
+			packet.D[lane] = normal | a;
+		}
+		return nodeIndex;
+	}
+
+	// Binned SAH along the longest centroid axis
+	FVector centroidSize = centroidBounds.GetSize();
+	int32 axis = centroidSize.X > centroidSize.Y ? (centroidSize.X > centroidSize.Z ? 0 : 2) : (centroidSize.Y > centroidSize.Z ? 1 : 2);
+	float axisMin = centroidBounds.Min[axis];
+	float axisSize = centroidSize[axis];
+	int32 mid = begin + count / 2;
+
+	if (axisSize > KINDA_SMALL_NUMBER) {
+		FBox binBounds[SAHBins];
+		int32 binCounts[SAHBins] = {};
+		for (int32 b = 0; b < SAHBins; b++) {
+			binBounds[b].Init();
+		}
+		float binScale = SAHBins / axisSize;
+		auto getBin = [&](int32 triangle) {
+			return FMath::Clamp((int32)((centroids[triangle][axis] - axisMin) * binScale), 0, SAHBins - 1);
+		};
+		for (int32 i = begin; i < end; i++) {
+			int32 b = getBin(order[i]);
+			binBounds[b] += triangleBounds[order[i]];
+			binCounts[b]++;
+		}
+
+		float rightCosts[SAHBins];
+		FBox accumulated(ForceInit);
+		int32 accumulatedCount = 0;
+		for (int32 b = SAHBins - 1; b > 0; b--) {
+			accumulated += binBounds[b];
+			accumulatedCount += binCounts[b];
+			rightCosts[b] = accumulatedCount ? HalfArea(accumulated) * accumulatedCount : 0;
+		}
+		float bestCost = MAX_flt;
+		int32 bestSplit = INDEX_NONE;
+		accumulated.Init();
+		accumulatedCount = 0;
+		for (int32 b = 0; b < SAHBins - 1; b++) {
+			accumulated += binBounds[b];
+			accumulatedCount += binCounts[b];
+			float cost = (accumulatedCount ? HalfArea(accumulated) * accumulatedCount : 0) + rightCosts[b + 1];
+			if (accumulatedCount > 0 && accumulatedCount < count && cost < bestCost) {
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestSplit != INDEX_NONE) {
+			int32 left = begin;
+			for (int32 i = begin; i < end; i++) {
+				if (getBin(order[i]) <= bestSplit) {
+					Swap(order[i], order[left++]);
+				}
+			}
+			mid = left;
+		}
+	}
+
+	BuildNode(order, begin, mid, triangleBounds, centroids, positions, triangles);
+	int32 right = BuildNode(order, mid, end, triangleBounds, centroids, positions, triangles);
+	nodes[nodeIndex].Data = (uint32)right;
+	return nodeIndex;
+}
+
+void FChStaticMeshBVH::Quantize(const FBox& box, uint16 outMin[3], uint16 outMax[3]) const
+{
+	// Rounded outwards so the quantized bounds always contain the real ones
+	for (int32 k = 0; k < 3; k++) {
+		outMin[k] = (uint16)FMath::Clamp(FMath::FloorToInt((box.Min[k] - origin[k]) * scale[k]), 0, 65535);
+		outMax[k] = (uint16)FMath::Clamp(FMath::CeilToInt((box.Max[k] - origin[k]) * scale[k]), 0, 65535);
+	}
+}
+
+void FChStaticMeshBVH::QueryPackets(const FBox& box, TArray<int32>& outPackets) const
+{
+	outPackets.Reset();
+	if (nodes.Num() == 0) {
+		return;
+	}
+	uint16 queryMin[3];
+	uint16 queryMax[3];
+	Quantize(box, queryMin, queryMax);
+
+	TArray<int32, TInlineAllocator<64>> stack;
+	stack.Add(0);
+	while (stack.Num()) {
+		int32 index = stack.Pop(false);
+		const FNode& node = nodes[index];
+		if (node.Min[0] > queryMax[0] || node.Max[0] < queryMin[0] ||
+			node.Min[1] > queryMax[1] || node.Max[1] < queryMin[1] ||
+			node.Min[2] > queryMax[2] || node.Max[2] < queryMin[2]) {
+			continue;
+		}
+		if (node.Data & LeafFlag) {
+			outPackets.Add(node.Data & ~LeafFlag);
+		}
+		else {
+			stack.Add(node.Data);
+			stack.Add(index + 1);
+		}
+	}
+}
+
+void FChStaticColliderSet::AddMesh(std::shared_ptr<chrono::ChBody> body, std::shared_ptr<FChStaticMeshBVH> bvh)
+{
+	if (!body || !bvh || bvh->IsEmpty()) {
+		return;
+	}
+	meshes.Add({ body, bvh });
+	for (auto& proxy : proxies) {
+		proxy.CachedBoxes.Add(FBox(ForceInit));
+		proxy.CachedPackets.AddDefaulted();
+	}
+}
+
+void FChStaticColliderSet::RemoveMesh(chrono::ChBody* body)
+{
+	for (int32 i = meshes.Num() - 1; i >= 0; i--) {
+		if (meshes[i].Body.get() == body) {
+			meshes.RemoveAt(i);
+			for (auto& proxy : proxies) {
+				proxy.CachedBoxes.RemoveAt(i);
+				proxy.CachedPackets.RemoveAt(i);
+			}
+		}
+	}
+}
+
+void FChStaticColliderSet::AddProxy(std::shared_ptr<chrono::ChBody> body, const FChColliderProxy& proxy)
+{
+	if (!body || ContainsProxy(body.get())) {
+		return;
+	}
+	FProxyState& state = proxies.AddDefaulted_GetRef();
+	state.Body = body;
+	state.Shape = proxy;
+	state.CachedBoxes.Init(FBox(ForceInit), meshes.Num());
+	state.CachedPackets.SetNum(meshes.Num());
+}
+
+void FChStaticColliderSet::RemoveProxy(chrono::ChBody* body)
+{
+	proxies.RemoveAllSwap([body](const FProxyState& proxy) { return proxy.Body.get() == body; });
+}
+
+bool FChStaticColliderSet::ContainsProxy(chrono::ChBody* body) const
+{
+	return proxies.ContainsByPredicate([body](const FProxyState& proxy) { return proxy.Body.get() == body; });
+}
+
+bool FChStaticColliderSet::ContainsMesh(chrono::ChBody* body) const
+{
+	return meshes.ContainsByPredicate([body](const FMesh& mesh) { return mesh.Body.get() == body; });
+}
+
+bool FChStaticColliderSet::SweepSphere(const chrono::ChVector<>& start, const chrono::ChVector<>& motion, double radius, double& outFraction) const
+{
+	outFraction = 1;
+	bool bHit = false;
+	TArray<int32> packetList;
+	for (const FMesh& mesh : meshes) {
+		const auto& frame = mesh.Body->GetFrame_REF_to_abs();
+		FVector from = ToVector(frame.TransformPointParentToLocal(start));
+		FVector delta = ToVector(frame.TransformDirectionParentToLocal(motion));
+		FBox query(from, from);
+		query += from + delta;
+		mesh.BVH->QueryPackets(query.ExpandBy(radius), packetList);
+
+		for (int32 index : packetList) {
+			const FChStaticMeshBVH::FPacket& packet = mesh.BVH->GetPacket(index);
+			for (int32 lane = 0; lane < packet.Count; lane++) {
+				FVector faceNormal = Lane(packet.NX, packet.NY, packet.NZ, lane);
+				FVector normal = faceNormal;
+				float distance = (normal | from) - packet.D[lane];
+				float approach = normal | delta;
+				// Sweep against the side the sphere starts on
+				if (distance < 0) {
+					normal = -normal;
+					distance = -distance;
+					approach = -approach;
+				}
+				if (distance <= radius || approach >= 0) {
+					continue;
+				}
+				float touch = (distance - radius) / -approach;
+				if (touch >= outFraction) {
+					continue;
+				}
+				FVector a = Lane(packet.AX, packet.AY, packet.AZ, lane);
+				FVector b = Lane(packet.BX, packet.BY, packet.BZ, lane);
+				FVector c = Lane(packet.CX, packet.CY, packet.CZ, lane);
+				FVector q = from + delta * touch - normal * radius;
+				// A center that passes through the face near an edge touches it no later than the plane does
+				float cross = distance / -approach;
+				if (!IsInsideTriangle(q, a, b, c, faceNormal) && (cross > 1 || !IsInsideTriangle(from + delta * cross, a, b, c, faceNormal))) {
+					continue;
+				}
+				outFraction = touch;
+				bHit = true;
+			}
+		}
+	}
+	return bHit;
+}
+
+void FChStaticColliderSet::OnCustomCollision(chrono::ChSystem* system)
+{
+	if (meshes.Num() == 0 || proxies.Num() == 0) {
+		lastContactCount = 0;
+		return;
+	}
+
+	// Proxies only write their own state, the contacts go into the container afterwards in proxy order
+	ParallelFor(proxies.Num(), [this](int32 i) {
+		CollideProxy(proxies[i]);
+	}, proxies.Num() < ParallelProxyCount);
+
+	auto container = system->GetContactContainer();
+	lastContactCount = 0;
+	for (auto& proxy : proxies) {
+		for (auto& contact : proxy.Contacts) {
+			container->AddContact(contact);
+		}
+		lastContactCount += proxy.Contacts.Num();
+	}
+}
+
+void FChStaticColliderSet::CollideProxy(FProxyState& proxy)
+{
+	proxy.Contacts.Reset();
+	chrono::ChBody* body = proxy.Body.get();
+	if (!body->GetCollide() || body->GetSleeping() || !body->GetSystem()) {
+		return;
+	}
+	double envelope = body->GetCollisionModel()->GetEnvelope();
+
+	for (int32 m = 0; m < meshes.Num(); m++) {
+		const FMesh& mesh = meshes[m];
+		const auto& frame = mesh.Body->GetFrame_REF_to_abs();
+		chrono::ChVector<> center = frame.TransformPointParentToLocal(body->GetPos());
+
+		FVector corners[8];
+		FBox query(ForceInit);
+		if (proxy.Shape.Type == FChColliderProxy::Sphere) {
+			query = FBox::BuildAABB(ToVector(center), FVector(proxy.Shape.Extent.X + envelope));
+		}
+		else {
+			for (int32 k = 0; k < 8; k++) {
+				chrono::ChVector<> corner((k & 1) ? proxy.Shape.Extent.X : -proxy.Shape.Extent.X, (k & 2) ? proxy.Shape.Extent.Y : -proxy.Shape.Extent.Y, (k & 4) ? proxy.Shape.Extent.Z : -proxy.Shape.Extent.Z);
+				corners[k] = ToVector(frame.TransformPointParentToLocal(body->TransformPointLocalToParent(corner)));
+				query += corners[k];
+			}
+			query = query.ExpandBy(envelope);
+		}
+
+		// Temporal coherence: the packets found for the inflated box last time cover this query while it stays inside
+		if (!proxy.CachedBoxes[m].IsValid || !proxy.CachedBoxes[m].IsInside(query)) {
+			FBox inflated = query.ExpandBy(query.GetSize().GetMax() * 0.25f + envelope);
+			mesh.BVH->QueryPackets(inflated, proxy.CachedPackets[m]);
+			proxy.CachedBoxes[m] = inflated;
+		}
+		const TArray<int32>& packetList = proxy.CachedPackets[m];
+		if (packetList.Num() == 0) {
+			continue;
+		}
+
+		if (proxy.Shape.Type == FChColliderProxy::Sphere) {
+			CollideSphere(proxy, mesh, packetList, center, envelope);
+		}
+		else {
+			CollideBox(proxy, mesh, packetList, center, corners, envelope);
+		}
+	}
+}
+
+void FChStaticColliderSet::CollideSphere(FProxyState& proxy, const FMesh& mesh, const TArray<int32>& packetList, const chrono::ChVector<>& localCenter, double envelope)
+{
+	float radius = proxy.Shape.Extent.X;
+	FVector center = ToVector(localCenter);
+	VectorRegister reach = VectorSetFloat1(radius + envelope);
+
+	float bestDistance = MAX_flt;
+	FVector bestPoint;
+	FVector bestNormal;
+	for (int32 index : packetList) {
+		const FChStaticMeshBVH::FPacket& packet = mesh.BVH->GetPacket(index);
+		// Four plane distances at once, only triangles whose plane is in reach get the exact test
+		int32 mask = VectorMaskBits(VectorCompareGT(reach, VectorAbs(PlaneDistances(packet, center)))) & ((1 << packet.Count) - 1);
+		while (mask) {
+			int32 lane = FMath::CountTrailingZeros(mask);
+			mask &= mask - 1;
+
+			FVector a = Lane(packet.AX, packet.AY, packet.AZ, lane);
+			FVector b = Lane(packet.BX, packet.BY, packet.BZ, lane);
+			FVector c = Lane(packet.CX, packet.CY, packet.CZ, lane);
+			FVector point = ClosestPointOnTriangle(center, a, b, c);
+			FVector offset = center - point;
+			float distance = offset.Size();
+			if (distance - radius >= envelope || distance - radius >= bestDistance) {
+				continue;
+			}
+			FVector normal = Lane(packet.NX, packet.NY, packet.NZ, lane);
+			bestNormal = distance > KINDA_SMALL_NUMBER ? offset / distance : ((normal | offset) < 0 ? -normal : normal);
+			bestDistance = distance - radius;
+			bestPoint = point;
+		}
+	}
+	if (bestDistance == MAX_flt) {
+		return;
+	}
+
+	// A is the mesh, B the proxy body; the normal points from the mesh to the body
+	const auto& frame = mesh.Body->GetFrame_REF_to_abs();
+	chrono::collision::ChCollisionInfo& contact = proxy.Contacts.AddDefaulted_GetRef();
+	contact.modelA = mesh.Body->GetCollisionModel().get();
+	contact.modelB = proxy.Body->GetCollisionModel().get();
+	contact.vN = frame.TransformDirectionLocalToParent(ToChVector(bestNormal));
+	contact.vpA = frame.TransformPointLocalToParent(ToChVector(bestPoint));
+	contact.vpB = proxy.Body->GetPos() - contact.vN * radius;
+	contact.distance = bestDistance;
+	contact.eff_radius = radius;
+	contact.reaction_cache = nullptr;
+}
+
+void FChStaticColliderSet::CollideBox(FProxyState& proxy, const FMesh& mesh, const TArray<int32>& packetList, const chrono::ChVector<>& localCenter, const FVector corners[8], double envelope)
+{
+	FVector center = ToVector(localCenter);
+	// Corners deeper than the thinnest half extent came through from the other side
+	float maxDepth = proxy.Shape.Extent.GetMin();
+	VectorRegister upper = VectorSetFloat1(envelope);
+	VectorRegister lower = VectorSetFloat1(-maxDepth);
+
+	float bestDistance[8];
+	FVector bestPoint[8];
+	FVector bestNormal[8];
+	for (int32 k = 0; k < 8; k++) {
+		bestDistance[k] = MAX_flt;
+	}
+
+	for (int32 index : packetList) {
+		const FChStaticMeshBVH::FPacket& packet = mesh.BVH->GetPacket(index);
+		int32 laneMask = (1 << packet.Count) - 1;
+		// Meshes are two sided, each triangle pushes towards the side the box center is on
+		VectorRegister centerDistance = PlaneDistances(packet, center);
+		VectorRegister side = VectorSelect(VectorCompareGE(centerDistance, VectorZero()), VectorOne(), VectorNegate(VectorOne()));
+
+		for (int32 k = 0; k < 8; k++) {
+			VectorRegister distance = VectorMultiply(PlaneDistances(packet, corners[k]), side);
+			int32 mask = VectorMaskBits(VectorBitwiseAnd(VectorCompareGT(upper, distance), VectorCompareGT(distance, lower))) & laneMask;
+			while (mask) {
+				int32 lane = FMath::CountTrailingZeros(mask);
+				mask &= mask - 1;
+
+				float sign = VectorGetComponent(side, lane);
+				float cornerDistance = VectorGetComponent(distance, lane);
+				if (cornerDistance >= bestDistance[k]) {
+					continue;
+				}
+				FVector normal = Lane(packet.NX, packet.NY, packet.NZ, lane);
+				FVector point = corners[k] - normal * (cornerDistance * sign);
+				if (!IsInsideTriangle(point, Lane(packet.AX, packet.AY, packet.AZ, lane), Lane(packet.BX, packet.BY, packet.BZ, lane), Lane(packet.CX, packet.CY, packet.CZ, lane), normal)) {
+					continue;
+				}
+				bestDistance[k] = cornerDistance;
+				bestPoint[k] = point;
+				bestNormal[k] = normal * sign;
+			}
+		}
+	}
+
+	const auto& frame = mesh.Body->GetFrame_REF_to_abs();
+	for (int32 k = 0; k < 8; k++) {
+		if (bestDistance[k] == MAX_flt) {
+			continue;
+		}
+		chrono::collision::ChCollisionInfo& contact = proxy.Contacts.AddDefaulted_GetRef();
+		contact.modelA = mesh.Body->GetCollisionModel().get();
+		contact.modelB = proxy.Body->GetCollisionModel().get();
+		contact.vN = frame.TransformDirectionLocalToParent(ToChVector(bestNormal[k]));
+		contact.vpA = frame.TransformPointLocalToParent(ToChVector(bestPoint[k]));
+		contact.vpB = frame.TransformPointLocalToParent(ToChVector(corners[k]));
+		contact.distance = bestDistance[k];
+		contact.reaction_cache = nullptr;
+	}
+}
@@ -0,0 +1,101 @@
+#include "ChTelemetry.h"
+
+int32 FChTelemetry::RegisterChannel(FName name, int32 width)
+{
+	if (IsAllocated() || width <= 0) {
+		return INDEX_NONE;
+	}
+
+	channelNames.Add(name);
+	channelOffsets.Add(frameWidth);
+	frameWidth += width;
+	return channelWidths.Add(width);
+}
+
+int32 FChTelemetry::FindChannel(FName name) const
+{
+	return channelNames.Find(name);
+}
+
+void FChTelemetry::Allocate(int32 inFrameCapacity)
+{
+	frameCapacity = FMath::Max(inFrameCapacity, 1);
+	ring.SetNumZeroed(frameCapacity * frameWidth);
+	ringTimes.SetNumZeroed(frameCapacity);
+	head = 0;
+	pending = 0;
+	currentFrame = nullptr;
+}
+
+void FChTelemetry::Reset()
+{
+	channelNames.Empty();
+	channelOffsets.Empty();
+	channelWidths.Empty();
+	frameWidth = 0;
+	ring.Empty();
+	ringTimes.Empty();
+	frameCapacity = 0;
+	head = 0;
+	pending = 0;
+	currentFrame = nullptr;
+}
+
+void FChTelemetry::BeginFrame(float time)
+{
+	if (!IsAllocated()) {
+		return;
+	}
+
+	// The oldest frame is dropped when nobody drained in time
+	currentFrame = ring.GetData() + head * frameWidth;
+	ringTimes[head] = time;
+	head = (head + 1) % frameCapacity;
+	pending = FMath::Min(pending + 1, frameCapacity);
+}
+
+void FChTelemetry::Write(int32 handle, float value)
+{
+	if (currentFrame && channelWidths.IsValidIndex(handle)) {
+		currentFrame[channelOffsets[handle]] = value;
+	}
+}
+
+void FChTelemetry::Write(int32 handle, const FVector& value)
+{
+	if (currentFrame && channelWidths.IsValidIndex(handle) && channelWidths[handle] >= 3) {
+		float* dest = currentFrame + channelOffsets[handle];
+		dest[0] = value.X;
+		dest[1] = value.Y;
+		dest[2] = value.Z;
+	}
+}
+
+void FChTelemetry::Write(int32 handle, const FQuat& value)
+{
+	if (currentFrame && channelWidths.IsValidIndex(handle) && channelWidths[handle] >= 4) {
+		float* dest = currentFrame + channelOffsets[handle];
+		dest[0] = value.X;
+		dest[1] = value.Y;
+		dest[2] = value.Z;
+		dest[3] = value.W;
+	}
+}
+
+int32 FChTelemetry::Drain(TArray<float>& outFrames, TArray<float>& outTimes)
+{
+	int32 count = pending;
+	outFrames.SetNumUninitialized(count * frameWidth, false);
+	outTimes.SetNumUninitialized(count, false);
+
+	int32 first = (head - count + frameCapacity) % FMath::Max(frameCapacity, 1);
+	for (int32 i = 0; i < count; i++) {
+		int32 slot = (first + i) % frameCapacity;
+		FMemory::Memcpy(outFrames.GetData() + i * frameWidth, ring.GetData() + slot * frameWidth, frameWidth * sizeof(float));
+		outTimes[i] = ringTimes[slot];
+	}
+
+	pending = 0;
+	currentFrame = nullptr;
+	return count;
+}
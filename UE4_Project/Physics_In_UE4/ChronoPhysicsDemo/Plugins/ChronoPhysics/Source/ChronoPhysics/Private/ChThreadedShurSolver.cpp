@@ -0,0 +1,109 @@
+#include "ChThreadedShurSolver.h"
+#include "chrono_parallel/ChDataManager.h"
+#include "chrono_parallel/solver/ChIterativeSolverParallel.h"
+#include "chrono/physics/ChSystem.h"
+#include "Async/ParallelFor.h"
+#include <typeinfo>
+
+namespace {
+	// Rows of one task in either product
+	const int32 RowBlock = 1024;
+
+	// y[row] = A(row, :) x for the rows of one block, CSR order so each task only reads its own rows
+	template<typename FunctionType>
+	FORCEINLINE void ForRowBlocks(int32 rows, FunctionType function)
+	{
+		ParallelFor(FMath::DivideAndRoundUp(rows, RowBlock), [&](int32 block) {
+			const int32 begin = block * RowBlock;
+			function(begin, FMath::Min(begin + RowBlock, rows));
+		});
+	}
+
+	FORCEINLINE chrono::real RowDot(const blaze::CompressedMatrix<chrono::real>& matrix, size_t row, const blaze::DynamicVector<chrono::real>& x)
+	{
+		chrono::real sum = 0;
+		for (auto it = matrix.begin(row); it != matrix.end(row); ++it) {
+			sum += it->value() * x[it->index()];
+		}
+		return sum;
+	}
+}
+
+void FChThreadedShurProduct::operator()(const blaze::DynamicVector<chrono::real>& x, blaze::DynamicVector<chrono::real>& AX)
+{
+	const auto& settings = data_manager->settings.solver;
+	const auto& D_T = data_manager->host_data.D_T;
+	const auto& M_invD = data_manager->host_data.M_invD;
+	const auto& E = data_manager->host_data.E;
+	const size_t rows = D_T.rows();
+
+	// The block wise products of the normal prepass and the assembled N stay with Chrono
+	const bool bFullProduct = settings.local_solver_mode == settings.solver_mode && !settings.compute_N;
+	if (!bFullProduct || (int32)rows < threshold || x.size() != rows || M_invD.columns() != rows || E.size() != rows) {
+		(*fallback)(x, AX);
+		return;
+	}
+
+	const int32 dofs = (int32)M_invD.rows();
+	velocity.resize(dofs, false);
+	ForRowBlocks(dofs, [&](int32 begin, int32 end) {
+		for (int32 row = begin; row < end; row++) {
+			velocity[row] = RowDot(M_invD, row, x);
+		}
+	});
+
+	AX.resize(rows, false);
+	ForRowBlocks((int32)rows, [&](int32 begin, int32 end) {
+		for (int32 row = begin; row < end; row++) {
+			AX[row] = RowDot(D_T, row, velocity) + E[row] * x[row];
+		}
+	});
+}
+
+FChThreadedShurSolver::FChThreadedShurSolver(chrono::ChSolverParallel* inner, int32 threshold)
+	: inner(inner)
+{
+	data_manager = inner->data_manager;
+	product.SetThreshold(threshold);
+}
+
+FChThreadedShurSolver::~FChThreadedShurSolver()
+{
+	delete inner;
+}
+
+uint FChThreadedShurSolver::Solve(chrono::ChShurProduct& ShurProduct, chrono::ChProjectConstraints& Project, const uint max_iter,
+	const uint size, const blaze::DynamicVector<chrono::real>& b, blaze::DynamicVector<chrono::real>& x)
+{
+	// The iterative solver sets these on the wrapper before each solve
+	inner->data_manager = data_manager;
+	inner->current_iteration = current_iteration;
+	inner->rigid_rigid = rigid_rigid;
+	inner->bilateral = bilateral;
+	inner->three_dof = three_dof;
+	inner->fem = fem;
+	inner->mpm = mpm;
+
+	uint iterations;
+	// Only the full contact product, derived functors (bilateral, FEM) have their own layout
+	if (typeid(ShurProduct) == typeid(chrono::ChShurProduct)) {
+		product.Setup(data_manager);
+		product.SetFallback(&ShurProduct);
+		iterations = inner->Solve(product, Project, max_iter, size, b, x);
+	}
+	else {
+		iterations = inner->Solve(ShurProduct, Project, max_iter, size, b, x);
+	}
+	current_iteration = inner->current_iteration;
+	return iterations;
+}
+
+bool FChThreadedShurSolver::Install(chrono::ChSystem* system, int32 threshold)
+{
+	auto iterative = std::dynamic_pointer_cast<chrono::ChIterativeSolverParallel>(system->GetSolver());
+	if (!iterative || !iterative->solver || dynamic_cast<FChThreadedShurSolver*>(iterative->solver)) {
+		return false;
+	}
+	iterative->solver = new FChThreadedShurSolver(iterative->solver, threshold);
+	return true;
+}
@@ -0,0 +1,181 @@
+#include "ChTiledRigidTerrain.h"
+#include "ChShapeCache.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/collision/ChCCollisionSystem.h"
+#include "chrono/geometry/ChTriangleMeshConnected.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+namespace {
+	// Same ray RigidTerrain casts
+	const double RayHeight = 1000;
+	// Off every enabled tile
+	const float DefaultFriction = 0.8f;
+
+	double FootprintDistanceSquared(const FVector2D& footprintMin, const FVector2D& footprintMax, const chrono::ChVector<>& p)
+	{
+		double dx = FMath::Max(FMath::Max(footprintMin.X - p.x(), p.x() - footprintMax.X), 0.0);
+		double dy = FMath::Max(FMath::Max(footprintMin.Y - p.y(), p.y() - footprintMax.Y), 0.0);
+		return dx * dx + dy * dy;
+	}
+
+	FString MakeTileKey(const FString& path)
+	{
+		// A changed OBJ file gets a new entry
+		FDateTime timeStamp = IFileManager::Get().GetTimeStamp(*path);
+		return FString::Printf(TEXT("TerrainTile_%s_%08x_%llx"), *FPaths::GetBaseFilename(path), GetTypeHash(path), timeStamp.GetTicks());
+	}
+}
+
+int32 FChTiledRigidTerrain::AddMeshTile(const chrono::ChCoordsys<>& position, const std::string& meshFile, const FVector2D& footprintMin, const FVector2D& footprintMax,
+	double sweepRadius, float friction)
+{
+	FTile& tile = tiles[tiles.AddDefaulted()];
+	tile.Position = position;
+	tile.MeshFile = meshFile;
+	tile.FootprintMin = footprintMin;
+	tile.FootprintMax = footprintMax;
+	tile.SweepRadius = sweepRadius;
+	tile.Friction = friction;
+	return tiles.Num() - 1;
+}
+
+int32 FChTiledRigidTerrain::AddMeshTile(const chrono::ChCoordsys<>& position, const std::string& meshFile, double sweepRadius, float friction)
+{
+	int32 index = AddMeshTile(position, meshFile, FVector2D::ZeroVector, FVector2D::ZeroVector, sweepRadius, friction);
+	FTile& tile = tiles[index];
+	if (!LoadMesh(tile)) {
+		return index;
+	}
+	FBox2D footprint(ForceInit);
+	for (auto& vertex : tile.Mesh->getCoordsVertices()) {
+		chrono::ChVector<> world = position.TransformPointLocalToParent(vertex);
+		footprint += FVector2D(world.x(), world.y());
+	}
+	tile.FootprintMin = footprint.Min;
+	tile.FootprintMax = footprint.Max;
+	return index;
+}
+
+void FChTiledRigidTerrain::Update(const TArray<chrono::ChVector<>>& vehiclePositions)
+{
+	double enableSquared = activationRadius * activationRadius;
+	double disableRadius = activationRadius * (1 + activationHysteresis);
+	double disableSquared = disableRadius * disableRadius;
+	for (auto& tile : tiles) {
+		double nearest = TNumericLimits<double>::Max();
+		for (auto& position : vehiclePositions) {
+			nearest = FMath::Min(nearest, FootprintDistanceSquared(tile.FootprintMin, tile.FootprintMax, position));
+		}
+		if (!tile.bEnabled && nearest <= enableSquared) {
+			SetEnabled(tile, true);
+		}
+		else if (tile.bEnabled && nearest > disableSquared) {
+			SetEnabled(tile, false);
+		}
+	}
+}
+
+void FChTiledRigidTerrain::SetEnabled(FTile& tile, bool bEnabled)
+{
+	if (bEnabled && !tile.Body) {
+		if (!tile.Mesh && !LoadMesh(tile)) {
+			return;
+		}
+		CreateBody(tile);
+	}
+	if (tile.Body) {
+		// Takes the model out of or back into the collision system
+		tile.Body->SetCollide(bEnabled);
+	}
+	tile.bEnabled = bEnabled;
+	enabledNum += bEnabled ? 1 : -1;
+}
+
+bool FChTiledRigidTerrain::LoadMesh(FTile& tile)
+{
+	FString path = FPaths::ConvertRelativePathToFull(UTF8_TO_TCHAR(tile.MeshFile.c_str()));
+	auto mesh = std::make_shared<chrono::geometry::ChTriangleMeshConnected>();
+	FString key = MakeTileKey(path);
+	if (!FChShapeCache::LoadTriMesh(key, *mesh)) {
+		if (!FPaths::FileExists(path)) {
+			UE_LOG(LogTemp, Warning, TEXT("Terrain tile mesh %s not found"), *path);
+			return false;
+		}
+		mesh->LoadWavefrontMesh(tile.MeshFile, true, false);
+		FChShapeCache::SaveTriMesh(key, *mesh);
+	}
+	tile.Mesh = mesh;
+	loadedNum++;
+	return true;
+}
+
+void FChTiledRigidTerrain::CreateBody(FTile& tile)
+{
+	auto body = std::make_shared<chrono::ChBody>(system->GetContactMethod());
+	body->SetBodyFixed(true);
+	body->SetPos(tile.Position.pos);
+	body->SetRot(tile.Position.rot);
+	if (system->GetContactMethod() == chrono::ChMaterialSurface::NSC) {
+		body->GetMaterialSurfaceNSC()->SetFriction(tile.Friction);
+	}
+	else {
+		body->GetMaterialSurfaceSMC()->SetFriction(tile.Friction);
+	}
+	body->GetCollisionModel()->ClearModel();
+	body->GetCollisionModel()->AddTriangleMesh(tile.Mesh, true, false, chrono::VNULL, chrono::ChMatrix33<>(1), tile.SweepRadius);
+	body->GetCollisionModel()->BuildModel();
+	body->SetCollide(true);
+	system->AddBody(body);
+	tile.Body = body;
+}
+
+bool FChTiledRigidTerrain::FindPoint(double x, double y, double& outHeight, chrono::ChVector<>& outNormal, float& outFriction) const
+{
+	chrono::ChVector<> from(x, y, RayHeight);
+	chrono::ChVector<> to(x, y, -RayHeight);
+	auto collisionSystem = system->GetCollisionSystem();
+	bool bFound = false;
+	for (auto& tile : tiles) {
+		if (!tile.bEnabled || !tile.Body || x < tile.FootprintMin.X || x > tile.FootprintMax.X || y < tile.FootprintMin.Y || y > tile.FootprintMax.Y) {
+			continue;
+		}
+		chrono::collision::ChCollisionSystem::ChRayhitResult result;
+		// Tiles can overlap at the seams, the highest one is the surface
+		if (collisionSystem->RayHit(from, to, tile.Body->GetCollisionModel().get(), result) && result.hit && (!bFound || result.abs_hitPoint.z() > outHeight)) {
+			outHeight = result.abs_hitPoint.z();
+			outNormal = result.abs_hitNormal;
+			outFriction = tile.Friction;
+			bFound = true;
+		}
+	}
+	return bFound;
+}
+
+double FChTiledRigidTerrain::GetHeight(double x, double y) const
+{
+	double height = 0;
+	chrono::ChVector<> normal;
+	float friction;
+	return FindPoint(x, y, height, normal, friction) ? height : 0.0;
+}
+
+chrono::ChVector<> FChTiledRigidTerrain::GetNormal(double x, double y) const
+{
+	double height;
+	chrono::ChVector<> normal;
+	float friction;
+	return FindPoint(x, y, height, normal, friction) ? normal : chrono::ChVector<>(0, 0, 1);
+}
+
+float FChTiledRigidTerrain::GetCoefficientFriction(double x, double y) const
+{
+	if (m_friction_fun) {
+		return (*m_friction_fun)(x, y);
+	}
+	double height;
+	chrono::ChVector<> normal;
+	float friction;
+	return FindPoint(x, y, height, normal, friction) ? friction : DefaultFriction;
+}
@@ -0,0 +1,272 @@
+#include "ChTrace.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTLS.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Algo/Sort.h"
+
+DEFINE_LOG_CATEGORY(LogChronoTrace);
+
+namespace {
+	// ms between two drains, a ring fills in no less than this at 20k records per second and thread
+	const uint32 DrainInterval = 50;
+
+	struct FChTraceRing
+	{
+		TArray<FChTraceRecord> Records;
+		// Monotonic, the slot is the count modulo the capacity. Only the owning thread adds to Pushed, only the writer to Popped
+		FThreadSafeCounter Pushed;
+		FThreadSafeCounter Popped;
+		uint32 ThreadId = 0;
+	};
+
+	class FChTraceWriter : public FRunnable
+	{
+	public:
+		FChTraceWriter(const FString& filePath)
+		{
+			if (!filePath.IsEmpty()) {
+				file = IFileManager::Get().CreateFileWriter(*filePath, FILEWRITE_AllowRead);
+				if (!file) {
+					UE_LOG(LogChronoTrace, Warning, TEXT("Can't open %s, tracing to the log"), *filePath);
+				}
+			}
+			startTime = FPlatformTime::Seconds();
+			wakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		}
+
+		virtual ~FChTraceWriter()
+		{
+			delete file;
+			FPlatformProcess::ReturnSynchEventToPool(wakeEvent);
+		}
+
+		virtual uint32 Run() override
+		{
+			while (stopping.GetValue() == 0) {
+				wakeEvent->Wait(DrainInterval);
+				Drain();
+			}
+			Drain();
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			stopping.Set(1);
+			wakeEvent->Trigger();
+		}
+
+	private:
+		void Drain();
+		void WriteLine(EChTraceLevel::Type level, const FString& line);
+
+		FArchive* file = nullptr;
+		double startTime = 0;
+		int32 reportedDrops = 0;
+		TArray<FChTraceRing*> drainRings;
+		TArray<FChTraceRecord> drainRecords;
+		FThreadSafeCounter stopping;
+		FEvent* wakeEvent = nullptr;
+	};
+
+	FCriticalSection ringLock;
+	// Never freed, a thread keeps its ring for as long as it runs
+	TArray<FChTraceRing*> rings;
+	thread_local FChTraceRing* threadRing = nullptr;
+
+	FThreadSafeCounter running;
+	FThreadSafeCounter dropped;
+	FChTraceWriter* writer = nullptr;
+	FRunnableThread* writerThread = nullptr;
+
+	void FChTraceWriter::Drain()
+	{
+		{
+			FScopeLock lock(&ringLock);
+			drainRings = rings;
+		}
+
+		// The slots stay the producer's until Popped moves, so copy out before the slow formatting
+		drainRecords.Reset();
+		for (FChTraceRing* ring : drainRings) {
+			int32 tail = ring->Popped.GetValue();
+			int32 count = ring->Pushed.GetValue() - tail;
+			for (int32 i = 0; i < count; i++) {
+				drainRecords.Add(ring->Records[(tail + i) % FChTrace::RingCapacity]);
+			}
+			ring->Popped.Add(count);
+		}
+
+		// Each ring is in order already, the sort interleaves the threads
+		Algo::Sort(drainRecords, [](const FChTraceRecord& a, const FChTraceRecord& b) {
+			return a.Time < b.Time;
+		});
+		for (const FChTraceRecord& record : drainRecords) {
+			WriteLine(record.Level, FString::Printf(TEXT("[%.6f][%u] %s"), record.Time - startTime, record.ThreadId, *record.ToString()));
+		}
+
+		int32 drops = dropped.GetValue();
+		bool bWritten = drainRecords.Num() > 0 || drops != reportedDrops;
+		if (drops != reportedDrops) {
+			WriteLine(EChTraceLevel::WARNING, FString::Printf(TEXT("%d records dropped on full rings"), drops - reportedDrops));
+			reportedDrops = drops;
+		}
+		if (file && bWritten) {
+			file->Flush();
+		}
+	}
+
+	void FChTraceWriter::WriteLine(EChTraceLevel::Type level, const FString& line)
+	{
+		if (file) {
+			FTCHARToUTF8 utf8(*line);
+			file->Serialize((void*)utf8.Get(), utf8.Length());
+			file->Serialize((void*)"\n", 1);
+			return;
+		}
+		switch (level) {
+		case EChTraceLevel::SEVERE:
+			UE_LOG(LogChronoTrace, Error, TEXT("%s"), *line);
+			break;
+		case EChTraceLevel::WARNING:
+			UE_LOG(LogChronoTrace, Warning, TEXT("%s"), *line);
+			break;
+		case EChTraceLevel::LOG:
+			UE_LOG(LogChronoTrace, Log, TEXT("%s"), *line);
+			break;
+		default:
+			UE_LOG(LogChronoTrace, Verbose, TEXT("%s"), *line);
+			break;
+		}
+	}
+}
+
+FString FChTraceRecord::ToString() const
+{
+	FString result;
+	if (!Object.IsNone()) {
+		result = Object.ToString();
+		result += TEXT(": ");
+	}
+
+	// Flags, width and precision are kept, the length and conversion follow the stored type
+	int32 arg = 0;
+	for (const TCHAR* c = Format; *c; c++) {
+		if (*c != TEXT('%')) {
+			result.AppendChar(*c);
+			continue;
+		}
+		if (c[1] == TEXT('%')) {
+			result.AppendChar(TEXT('%'));
+			c++;
+			continue;
+		}
+		TCHAR spec[32];
+		int32 length = 0;
+		spec[length++] = TEXT('%');
+		c++;
+		while (*c && FCString::Strchr(TEXT("-+ #0123456789."), *c) && length < 24) {
+			spec[length++] = *c++;
+		}
+		while (*c && FCString::Strchr(TEXT("hlLqjzt"), *c)) {
+			c++;
+		}
+		if (!*c) {
+			break;
+		}
+		if (arg >= ArgNum) {
+			result += TEXT("<?>");
+			continue;
+		}
+
+		TCHAR buffer[64];
+		if (ArgTypes[arg] == ARG_FLOAT) {
+			spec[length++] = FCString::Strchr(TEXT("eEfgG"), *c) ? *c : TEXT('f');
+			spec[length] = 0;
+			FCString::Snprintf(buffer, ARRAY_COUNT(buffer), spec, Args[arg].Float);
+		}
+		else {
+			spec[length++] = TEXT('l');
+			spec[length++] = TEXT('l');
+			spec[length++] = FCString::Strchr(TEXT("ouxX"), *c) ? *c : TEXT('d');
+			spec[length] = 0;
+			FCString::Snprintf(buffer, ARRAY_COUNT(buffer), spec, Args[arg].Int);
+		}
+		result += buffer;
+		arg++;
+	}
+	return result;
+}
+
+void FChTrace::Start()
+{
+#if CHRONO_TRACE_LEVEL > 0
+	if (writerThread) {
+		return;
+	}
+	FString filePath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("ChronoTraceFile="), filePath) && FPaths::IsRelative(filePath)) {
+		filePath = FPaths::Combine(FPaths::ProjectLogDir(), filePath);
+	}
+	writer = new FChTraceWriter(filePath);
+	writerThread = FRunnableThread::Create(writer, TEXT("ChTraceWriter"), 0, TPri_Lowest);
+	running.Set(1);
+#endif
+}
+
+void FChTrace::Stop()
+{
+	running.Set(0);
+	if (writerThread) {
+		// Stop lets Run drain the rings once more before it returns
+		writerThread->Kill(true);
+		delete writerThread;
+		writerThread = nullptr;
+	}
+	delete writer;
+	writer = nullptr;
+}
+
+int32 FChTrace::GetDroppedCount()
+{
+	return dropped.GetValue();
+}
+
+FChTraceRecord* FChTrace::BeginRecord()
+{
+	if (running.GetValue() == 0) {
+		return nullptr;
+	}
+	FChTraceRing* ring = threadRing;
+	if (!ring) {
+		ring = new FChTraceRing();
+		ring->Records.SetNum(RingCapacity);
+		ring->ThreadId = FPlatformTLS::GetCurrentThreadId();
+		FScopeLock lock(&ringLock);
+		rings.Add(ring);
+		threadRing = ring;
+	}
+
+	int32 head = ring->Pushed.GetValue();
+	if (head - ring->Popped.GetValue() >= RingCapacity) {
+		dropped.Increment();
+		return nullptr;
+	}
+	FChTraceRecord* record = &ring->Records[head % RingCapacity];
+	record->Time = FPlatformTime::Seconds();
+	record->ThreadId = ring->ThreadId;
+	return record;
+}
+
+void FChTrace::EndRecord()
+{
+	// Interlocked, the slot is written before the writer can see it
+	threadRing->Pushed.Increment();
+}
@@ -0,0 +1,182 @@
+#include "ChVehicleFleet.h"
+#include "chrono_vehicle/wheeled_vehicle/ChWheeledVehicle.h"
+#include "chrono_vehicle/wheeled_vehicle/ChTire.h"
+#include "chrono_vehicle/ChDriver.h"
+#include "chrono_vehicle/ChTerrain.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+
+namespace {
+	const int32 TableSize = 256;
+	// What ChSimpleMapPowertrain uses for neutral, no torque gets through
+	const double NeutralGearRatio = 1e20;
+
+	// Piecewise linear like ChFunction_Recorder, held flat past the ends
+	double Interpolate(const std::vector<std::pair<double, double>>& points, double x)
+	{
+		if (points.empty()) {
+			return 0;
+		}
+		if (x <= points.front().first) {
+			return points.front().second;
+		}
+		for (size_t i = 1; i < points.size(); i++) {
+			if (x <= points[i].first) {
+				double span = points[i].first - points[i - 1].first;
+				double alpha = span > 0 ? (x - points[i - 1].first) / span : 1;
+				return FMath::Lerp(points[i - 1].second, points[i].second, alpha);
+			}
+		}
+		return points.back().second;
+	}
+}
+
+FChWheeledVehicleFleet::FChWheeledVehicleFleet(const FChFleetPowertrainMap& inMap)
+	: map(inMap)
+{
+	if (map.GearRatios.empty()) {
+		map.GearRatios.push_back(1);
+	}
+	auto zeroMap = map.ZeroThrottleMap;
+	auto fullMap = map.FullThrottleMap;
+	auto bySpeed = [](const std::pair<double, double>& a, const std::pair<double, double>& b) { return a.first < b.first; };
+	std::sort(zeroMap.begin(), zeroMap.end(), bySpeed);
+	std::sort(fullMap.begin(), fullMap.end(), bySpeed);
+
+	tableStep = FMath::Max(map.MaxEngineSpeed, 1.0) / (TableSize - 1);
+	zeroThrottleTable.SetNum(TableSize);
+	fullThrottleTable.SetNum(TableSize);
+	for (int32 i = 0; i < TableSize; i++) {
+		zeroThrottleTable[i] = Interpolate(zeroMap, i * tableStep);
+		fullThrottleTable[i] = Interpolate(fullMap, i * tableStep);
+	}
+}
+
+int32 FChWheeledVehicleFleet::Add(chrono::vehicle::ChWheeledVehicle& vehicle, std::shared_ptr<chrono::vehicle::ChDriver> driver,
+	const std::vector<std::shared_ptr<chrono::vehicle::ChTire>>& vehicleTires)
+{
+	vehicles.Add(&vehicle);
+	drivers.Add(driver);
+	tires.Add(vehicleTires);
+	tireForces.Emplace(vehicleTires.size());
+	throttle.Add(0);
+	shaftSpeed.Add(0);
+	motorSpeed.Add(0);
+	motorTorque.Add(0);
+	shaftTorque.Add(0);
+	gearRatio.Add(map.GearRatios[0]);
+	gear.Add(0);
+	driveMode.Add(chrono::vehicle::ChPowertrain::FORWARD);
+	return vehicles.Num() - 1;
+}
+
+void FChWheeledVehicleFleet::SetDriveMode(int32 index, chrono::vehicle::ChPowertrain::DriveMode mode)
+{
+	driveMode[index] = mode;
+	switch (mode) {
+	case chrono::vehicle::ChPowertrain::FORWARD:
+		SetGear(index, 0);
+		break;
+	case chrono::vehicle::ChPowertrain::REVERSE:
+		gearRatio[index] = map.ReverseGearRatio;
+		break;
+	default:
+		gearRatio[index] = NeutralGearRatio;
+		break;
+	}
+}
+
+void FChWheeledVehicleFleet::Synchronize(double time, const chrono::vehicle::ChTerrain& terrain, bool bParallelTires)
+{
+	int32 num = vehicles.Num();
+	ParallelFor(num, [&](int32 i) {
+		chrono::vehicle::TerrainForces& forces = tireForces[i];
+		for (size_t w = 0; w < tires[i].size(); w++) {
+			forces[w] = tires[i][w]->GetTireForce();
+		}
+		if (drivers[i]) {
+			drivers[i]->Synchronize(time);
+		}
+		if (bParallelTires) {
+			for (size_t w = 0; w < tires[i].size(); w++) {
+				tires[i][w]->Synchronize(time, vehicles[i]->GetWheelState(chrono::vehicle::WheelID((int)w)), terrain);
+			}
+		}
+		throttle[i] = drivers[i] ? drivers[i]->GetThrottle() : 0;
+		shaftSpeed[i] = vehicles[i]->GetDriveshaftSpeed();
+	});
+	if (!bParallelTires) {
+		for (int32 i = 0; i < num; i++) {
+			for (size_t w = 0; w < tires[i].size(); w++) {
+				tires[i][w]->Synchronize(time, vehicles[i]->GetWheelState(chrono::vehicle::WheelID((int)w)), terrain);
+			}
+		}
+	}
+
+	SynchronizePowertrains();
+
+	// Forces go onto the shared system's bodies
+	for (int32 i = 0; i < num; i++) {
+		double steering = drivers[i] ? drivers[i]->GetSteering() : 0;
+		double braking = drivers[i] ? drivers[i]->GetBraking() : 0;
+		vehicles[i]->Synchronize(time, steering, braking, shaftTorque[i], tireForces[i]);
+	}
+}
+
+void FChWheeledVehicleFleet::Advance(double step)
+{
+	ParallelFor(vehicles.Num(), [&](int32 i) {
+		if (drivers[i]) {
+			drivers[i]->Advance(step);
+		}
+		for (auto& tire : tires[i]) {
+			tire->Advance(step);
+		}
+	});
+}
+
+void FChWheeledVehicleFleet::SynchronizePowertrains()
+{
+	int32 num = vehicles.Num();
+	const double maxSpeed = map.MaxEngineSpeed;
+	const double invStep = 1 / tableStep;
+	const double* zeroTable = zeroThrottleTable.GetData();
+	const double* fullTable = fullThrottleTable.GetData();
+
+	for (int32 i = 0; i < num; i++) {
+		motorSpeed[i] = FMath::Clamp(FMath::Abs(shaftSpeed[i] / gearRatio[i]), 0.0, maxSpeed);
+	}
+	// Motor torque between the two maps by throttle, as ChSimpleMapPowertrain
+	for (int32 i = 0; i < num; i++) {
+		double x = motorSpeed[i] * invStep;
+		int32 cell = FMath::Min((int32)x, TableSize - 2);
+		double alpha = x - cell;
+		double zero = zeroTable[cell] + (zeroTable[cell + 1] - zeroTable[cell]) * alpha;
+		double full = fullTable[cell] + (fullTable[cell + 1] - fullTable[cell]) * alpha;
+		motorTorque[i] = zero + (full - zero) * throttle[i];
+		shaftTorque[i] = motorTorque[i] / gearRatio[i];
+	}
+
+	if (!map.bAutomatic || map.ShiftBands.empty()) {
+		return;
+	}
+	int32 topGear = (int32)FMath::Min(map.GearRatios.size(), map.ShiftBands.size()) - 1;
+	for (int32 i = 0; i < num; i++) {
+		if (driveMode[i] != chrono::vehicle::ChPowertrain::FORWARD) {
+			continue;
+		}
+		const std::pair<double, double>& band = map.ShiftBands[FMath::Min(gear[i], topGear)];
+		if (motorSpeed[i] > band.second && gear[i] < topGear) {
+			SetGear(i, gear[i] + 1);
+		}
+		else if (motorSpeed[i] < band.first && gear[i] > 0) {
+			SetGear(i, gear[i] - 1);
+		}
+	}
+}
+
+void FChWheeledVehicleFleet::SetGear(int32 index, int32 newGear)
+{
+	gear[index] = FMath::Clamp(newGear, 0, (int32)map.GearRatios.size() - 1);
+	gearRatio[index] = map.GearRatios[gear[index]];
+}
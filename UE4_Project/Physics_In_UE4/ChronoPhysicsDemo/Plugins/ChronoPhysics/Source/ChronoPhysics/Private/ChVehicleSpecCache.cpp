@@ -0,0 +1,91 @@
+#include "ChVehicleSpecCache.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+namespace {
+	struct FSpecEntry
+	{
+		FDateTime TimeStamp;
+		std::shared_ptr<const rapidjson::Document> Document;
+	};
+
+	FCriticalSection& GetLock()
+	{
+		static FCriticalSection lock;
+		return lock;
+	}
+
+	TMap<FString, FSpecEntry>& GetEntries()
+	{
+		static TMap<FString, FSpecEntry> entries;
+		return entries;
+	}
+
+	FThreadSafeCounter parseNum;
+	FThreadSafeCounter hitNum;
+}
+
+std::shared_ptr<const rapidjson::Document> FChVehicleSpecCache::Get(const FString& path)
+{
+	FString key = FPaths::ConvertRelativePathToFull(path);
+	FDateTime timeStamp = IFileManager::Get().GetTimeStamp(*key);
+	if (timeStamp == FDateTime::MinValue()) {
+		return nullptr;
+	}
+	{
+		FScopeLock scopeLock(&GetLock());
+		FSpecEntry* entry = GetEntries().Find(key);
+		if (entry && entry->TimeStamp == timeStamp) {
+			hitNum.Increment();
+			return entry->Document;
+		}
+	}
+
+	// Parsed outside the lock, two threads asking for the same new file both parse it and one of them wins
+	FString json;
+	if (!FFileHelper::LoadFileToString(json, *key)) {
+		return nullptr;
+	}
+	auto document = std::make_shared<rapidjson::Document>();
+	document->Parse<0>(TCHAR_TO_UTF8(*json));
+	if (document->HasParseError()) {
+		UE_LOG(LogTemp, Warning, TEXT("Vehicle spec %s: JSON parse error %d at %d"), *key, (int32)document->GetParseError(), (int32)document->GetErrorOffset());
+		return nullptr;
+	}
+	parseNum.Increment();
+
+	FScopeLock scopeLock(&GetLock());
+	FSpecEntry& entry = GetEntries().FindOrAdd(key);
+	entry.TimeStamp = timeStamp;
+	entry.Document = document;
+	return entry.Document;
+}
+
+TFuture<void> FChVehicleSpecCache::Prefetch(const TArray<FString>& paths)
+{
+	return Async<void>(EAsyncExecution::ThreadPool, [paths]() {
+		for (const FString& path : paths) {
+			Get(path);
+		}
+	});
+}
+
+void FChVehicleSpecCache::Empty()
+{
+	FScopeLock scopeLock(&GetLock());
+	GetEntries().Empty();
+}
+
+int32 FChVehicleSpecCache::GetParseNum()
+{
+	return parseNum.GetValue();
+}
+
+int32 FChVehicleSpecCache::GetHitNum()
+{
+	return hitNum.GetValue();
+}
@@ -0,0 +1,322 @@
+#include "ChVolumeFillGenerator.h"
+#include "ChBodyComponent.h"
+#include "ChShapeInstances.h"
+#include "Engine/StaticMesh.h"
+#include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
+#include "Async/ParallelFor.h"
+#include "Math/RandomStream.h"
+#include "chrono/physics/ChBody.h"
+#include "chrono/utils/ChUtilsSamplers.h"
+#include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "util.h"
+
+namespace {
+	// Poisson disk tiles are this many spacings wide, large enough that the seams between them stay sparse
+	const float FillTileSpacings = 8.f;
+	// Candidates tried around an active point before it is retired
+	const int32 PoissonAttempts = 30;
+	// Bodies per task
+	const int32 BodyChunkSize = 1024;
+
+	float GetBoundingRadius(const FChFillIngredient& ingredient)
+	{
+		switch (ingredient.Shape) {
+		case EShapeType::Box:
+			return ingredient.Radius * 1.7320508f;
+		case EShapeType::Cylinder:
+			return ingredient.Radius * 1.4142136f;
+		default:
+			return ingredient.Radius;
+		}
+	}
+
+	// Bridson's sampling of one box, a background grid of cells holding at most one point each
+	void SampleBoxPoissonDisk(const FVector& boxMin, const FVector& boxMax, float spacing, FRandomStream& random, TArray<FVector>& outPoints)
+	{
+		FVector size = boxMax - boxMin;
+		if (size.GetMin() < 0.f) {
+			return;
+		}
+		float cellSize = spacing / FMath::Sqrt(3.f);
+		FIntVector dims(
+			FMath::Max(1, FMath::CeilToInt(size.X / cellSize)),
+			FMath::Max(1, FMath::CeilToInt(size.Y / cellSize)),
+			FMath::Max(1, FMath::CeilToInt(size.Z / cellSize)));
+		TArray<int32> cells;
+		cells.Init(INDEX_NONE, dims.X * dims.Y * dims.Z);
+
+		auto cellOf = [&](const FVector& p) {
+			FVector c = (p - boxMin) / cellSize;
+			return FIntVector(
+				FMath::Clamp((int32)c.X, 0, dims.X - 1),
+				FMath::Clamp((int32)c.Y, 0, dims.Y - 1),
+				FMath::Clamp((int32)c.Z, 0, dims.Z - 1));
+		};
+		auto cellIndex = [&](const FIntVector& c) {
+			return (c.Z * dims.Y + c.Y) * dims.X + c.X;
+		};
+		// Two cells reach past the spacing, the neighbours further away can't be closer
+		auto isFree = [&](const FVector& p) {
+			FIntVector c = cellOf(p);
+			for (int32 z = FMath::Max(c.Z - 2, 0); z <= FMath::Min(c.Z + 2, dims.Z - 1); z++) {
+				for (int32 y = FMath::Max(c.Y - 2, 0); y <= FMath::Min(c.Y + 2, dims.Y - 1); y++) {
+					for (int32 x = FMath::Max(c.X - 2, 0); x <= FMath::Min(c.X + 2, dims.X - 1); x++) {
+						int32 other = cells[cellIndex(FIntVector(x, y, z))];
+						if (other != INDEX_NONE && FVector::DistSquared(outPoints[other], p) < spacing * spacing) {
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		};
+		auto insert = [&](const FVector& p, TArray<int32>& active) {
+			int32 index = outPoints.Add(p);
+			cells[cellIndex(cellOf(p))] = index;
+			active.Add(index);
+		};
+
+		TArray<int32> active;
+		insert(FVector(random.FRandRange(boxMin.X, boxMax.X), random.FRandRange(boxMin.Y, boxMax.Y), random.FRandRange(boxMin.Z, boxMax.Z)), active);
+		while (active.Num()) {
+			int32 slot = random.RandHelper(active.Num());
+			FVector center = outPoints[active[slot]];
+			bool bFound = false;
+			for (int32 attempt = 0; attempt < PoissonAttempts && !bFound; attempt++) {
+				FVector candidate = center + random.VRand() * random.FRandRange(spacing, 2.f * spacing);
+				if (candidate.X < boxMin.X || candidate.Y < boxMin.Y || candidate.Z < boxMin.Z
+					|| candidate.X > boxMax.X || candidate.Y > boxMax.Y || candidate.Z > boxMax.Z) {
+					continue;
+				}
+				if (isFree(candidate)) {
+					insert(candidate, active);
+					bFound = true;
+				}
+			}
+			if (!bFound) {
+				active.RemoveAtSwap(slot, 1, false);
+			}
+		}
+	}
+}
+
+AChVolumeFillGenerator::AChVolumeFillGenerator()
+{
+	bUseInstancedRendering = true;
+	Ingredients.AddDefaulted();
+}
+
+void AChVolumeFillGenerator::PhysicsObjectConstruct()
+{
+	// One spacing for the whole mixture, the samplers place points of a single distance
+	float boundingRadius = 0.f;
+	float totalRatio = 0.f;
+	TArray<float> cumulativeRatios;
+	TArray<FVector> visualScales;
+	for (const FChFillIngredient& ingredient : Ingredients) {
+		// The instanced visual is the generator's shape mesh scaled up to the ingredient
+		FVector scale = FVector::ZeroVector;
+		if (ingredient.Shape == EShapeType::Box && boxMesh->BodySetup->AggGeom.BoxElems.Num()) {
+			auto box = boxMesh->BodySetup->AggGeom.BoxElems[0];
+			scale = FVector(2.f * ingredient.Radius / box.X, 2.f * ingredient.Radius / box.Y, 2.f * ingredient.Radius / box.Z);
+		}
+		else if (ingredient.Shape == EShapeType::Cylinder && cylinderMesh->BodySetup->AggGeom.SphylElems.Num()) {
+			auto cylinder = cylinderMesh->BodySetup->AggGeom.SphylElems[0];
+			scale = FVector(ingredient.Radius / cylinder.Radius, ingredient.Radius / cylinder.Radius, 2.f * ingredient.Radius / cylinder.Length);
+		}
+		else if (ingredient.Shape == EShapeType::Sphere && sphereMesh->BodySetup->AggGeom.SphereElems.Num()) {
+			scale = FVector(ingredient.Radius / sphereMesh->BodySetup->AggGeom.SphereElems[0].Radius);
+		}
+
+		// Ingredients without a collision shape on their mesh are left out of the mixture
+		float ratio = scale.IsZero() ? 0.f : FMath::Max(ingredient.Ratio, 0.f);
+		if (ratio > 0.f) {
+			boundingRadius = FMath::Max(boundingRadius, GetBoundingRadius(ingredient));
+		}
+		totalRatio += ratio;
+		cumulativeRatios.Add(totalRatio);
+		visualScales.Add(scale);
+	}
+	if (totalRatio <= 0.f) {
+		return;
+	}
+
+	TArray<FVector> points;
+	SamplePoints(2.f * boundingRadius * (1.f + Gap), boundingRadius, points);
+	if (!points.Num()) {
+		return;
+	}
+
+	// Shapes are built here once, the tasks below only reference them. A parallel system keeps
+	// its shapes in its own arrays, so there each body gets its own model
+	shapeTemplates.Reset();
+	for (const FChFillIngredient& ingredient : Ingredients) {
+		double radius = ingredient.Radius / CHRONO_SCALE;
+		if (bGenerateForParallel) {
+			shapeTemplates.Add(nullptr);
+			continue;
+		}
+		const TCHAR* kind = ingredient.Shape == EShapeType::Box ? TEXT("Box") : ingredient.Shape == EShapeType::Cylinder ? TEXT("Cylinder") : TEXT("Sphere");
+		EShapeType::Type shape = ingredient.Shape;
+		shapeTemplates.Add(FChShapeInstances::Find(FChShapeInstances::MakeKey(kind, FVector(radius)), [shape, radius](chrono::collision::ChCollisionModel& model) {
+			if (shape == EShapeType::Box) {
+				model.AddBox(radius, radius, radius);
+			}
+			else if (shape == EShapeType::Cylinder) {
+				model.AddCylinder(radius, radius, radius);
+			}
+			else {
+				model.AddSphere(radius);
+			}
+		}));
+	}
+
+	// Every body of the fill shares this material
+	auto contactMethod = CHRONO_CONTACT_METHOD(bGenerateForSMC);
+	std::shared_ptr<chrono::ChMaterialSurface> material = GetDefault<UChBodyComponent>()->GetSharedMaterial(bGenerateForSMC);
+
+	FTransform frame(GetActorQuat(), GetActorLocation());
+	TArray<FChInstancedBody> instances;
+	instances.SetNum(points.Num());
+	int32 chunkNum = (points.Num() + BodyChunkSize - 1) / BodyChunkSize;
+
+	ParallelFor(chunkNum, [&](int32 chunk) {
+		FRandomStream random(HashCombine(GetTypeHash(RandomSeed), GetTypeHash(chunk)));
+		int32 end = FMath::Min((chunk + 1) * BodyChunkSize, points.Num());
+		for (int32 i = chunk * BodyChunkSize; i < end; i++) {
+			float pick = random.FRand() * totalRatio;
+			int32 index = 0;
+			while (index < cumulativeRatios.Num() - 1 && cumulativeRatios[index] <= pick) {
+				index++;
+			}
+			const FChFillIngredient& ingredient = Ingredients[index];
+
+			FQuat rotation = frame.GetRotation();
+			if (bRandomRotation && ingredient.Shape != EShapeType::Sphere) {
+				rotation = rotation * FQuat(random.VRand(), random.FRandRange(0.f, 2.f * PI));
+			}
+			FTransform transform(rotation, frame.TransformPosition(points[i]), visualScales[index]);
+
+			// Mass and inertia in closed form, Chrono units
+			double r = ingredient.Radius / CHRONO_SCALE;
+			double mass, inertiaXZ, inertiaY;
+			if (ingredient.Shape == EShapeType::Box) {
+				mass = ingredient.Density * 8.0 * r * r * r;
+				inertiaXZ = inertiaY = mass * 4.0 * r * r / 6.0;
+			}
+			else if (ingredient.Shape == EShapeType::Cylinder) {
+				mass = ingredient.Density * PI * r * r * 2.0 * r;
+				inertiaXZ = mass * 7.0 * r * r / 12.0;
+				inertiaY = mass * r * r / 2.0;
+			}
+			else {
+				mass = ingredient.Density * 4.0 / 3.0 * PI * r * r * r;
+				inertiaXZ = inertiaY = 0.4 * mass * r * r;
+			}
+
+			auto body = std::make_shared<chrono::ChBody>(contactMethod);
+			body->SetMass(mass);
+			body->SetInertiaXX(chrono::ChVector<>(inertiaXZ, inertiaY, inertiaXZ));
+			body->SetMaterialSurface(material);
+			if (bGenerateForParallel) {
+				body->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+				body->GetCollisionModel()->ClearModel();
+				if (ingredient.Shape == EShapeType::Box) {
+					body->GetCollisionModel()->AddBox(r, r, r);
+				}
+				else if (ingredient.Shape == EShapeType::Cylinder) {
+					body->GetCollisionModel()->AddCylinder(r, r, r);
+				}
+				else {
+					body->GetCollisionModel()->AddSphere(r);
+				}
+				body->GetCollisionModel()->BuildModel();
+			}
+			else {
+				FChShapeInstances::Instance(*body, *shapeTemplates[index]);
+			}
+			ConfigureInstanceBody(*body, transform, false);
+
+			FChInstancedBody& instance = instances[i];
+			instance.ChData = body;
+			instance.Shape = ingredient.Shape;
+			instance.bFixed = false;
+			instance.Scale = visualScales[index];
+			instance.CachedTransform = transform;
+			instance.PreviousTransform = transform;
+		}
+	});
+
+	AddBodyInstances(instances);
+}
+
+void AChVolumeFillGenerator::SamplePoints(float spacing, float boundingRadius, TArray<FVector>& outPoints) const
+{
+	FVector inner = HalfExtent - FVector(boundingRadius);
+	if (inner.GetMin() < 0.f || spacing <= 0.f) {
+		return;
+	}
+
+	if (Sampling == EChFillSampling::PoissonDisk) {
+		SamplePoissonDisk(spacing, Volume == EChFillVolume::Cylinder ? FVector(inner.X, inner.X, inner.Z) : inner, outPoints);
+		if (Volume == EChFillVolume::Cylinder) {
+			float radiusSquared = inner.X * inner.X;
+			outPoints.RemoveAll([radiusSquared](const FVector& p) { return p.X * p.X + p.Y * p.Y > radiusSquared; });
+		}
+	}
+	else {
+		// Chrono's lattices are cheap enough to build serially
+		chrono::utils::GridSampler<double> grid(spacing);
+		chrono::utils::HCPSampler<double> hcp(spacing);
+		chrono::utils::Sampler<double>& sampler = Sampling == EChFillSampling::HCP ? (chrono::utils::Sampler<double>&)hcp : grid;
+		chrono::utils::PointVectorD sampled = Volume == EChFillVolume::Cylinder
+			? sampler.SampleCylinderZ(chrono::ChVector<>(0, 0, 0), inner.X, inner.Z)
+			: sampler.SampleBox(chrono::ChVector<>(0, 0, 0), chrono::ChVector<>(inner.X, inner.Y, inner.Z));
+		outPoints.Reserve(sampled.size());
+		for (const auto& p : sampled) {
+			outPoints.Add(FVector(p.x(), p.y(), p.z()));
+		}
+	}
+
+	if (outPoints.Num() > MaxBodies) {
+		outPoints.SetNum(MaxBodies);
+	}
+}
+
+void AChVolumeFillGenerator::SamplePoissonDisk(float spacing, const FVector& halfExtent, TArray<FVector>& outPoints) const
+{
+	float tileSize = FillTileSpacings * spacing;
+	FIntVector tiles(
+		FMath::Max(1, FMath::CeilToInt(2.f * halfExtent.X / tileSize)),
+		FMath::Max(1, FMath::CeilToInt(2.f * halfExtent.Y / tileSize)),
+		FMath::Max(1, FMath::CeilToInt(2.f * halfExtent.Z / tileSize)));
+	int32 tileNum = tiles.X * tiles.Y * tiles.Z;
+	TArray<TArray<FVector>> tilePoints;
+	tilePoints.SetNum(tileNum);
+
+	ParallelFor(tileNum, [&](int32 tile) {
+		FIntVector t(tile % tiles.X, (tile / tiles.X) % tiles.Y, tile / (tiles.X * tiles.Y));
+		FVector tileMin = -halfExtent + FVector(t) * tileSize;
+		FVector tileMax = FVector::Min(tileMin + FVector(tileSize), halfExtent);
+		// Faces shared with another tile step back half the spacing, so points of neighbouring tiles stay apart too
+		for (int32 axis = 0; axis < 3; axis++) {
+			if (t[axis] > 0) {
+				tileMin[axis] += spacing * 0.5f;
+			}
+			if (t[axis] < tiles[axis] - 1) {
+				tileMax[axis] -= spacing * 0.5f;
+			}
+		}
+		FRandomStream random(HashCombine(GetTypeHash(RandomSeed), GetTypeHash(tile)));
+		SampleBoxPoissonDisk(tileMin, tileMax, spacing, random, tilePoints[tile]);
+	});
+
+	int32 count = 0;
+	for (const TArray<FVector>& tile : tilePoints) {
+		count += tile.Num();
+	}
+	outPoints.Reserve(outPoints.Num() + count);
+	for (const TArray<FVector>& tile : tilePoints) {
+		outPoints.Append(tile);
+	}
+}
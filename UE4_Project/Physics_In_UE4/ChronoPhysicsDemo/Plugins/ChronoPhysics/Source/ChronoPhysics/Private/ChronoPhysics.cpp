@@ -1,18 +1,21 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "ChronoPhysics.h"
+#include "ChTrace.h"
 
 #define LOCTEXT_NAMESPACE "FChronoPhysicsModule"
 
 void FChronoPhysicsModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	FChTrace::Start();
 }
 
 void FChronoPhysicsModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FChTrace::Stop();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -7,6 +7,16 @@
 #include "ChBody_BoxComponent.h"
 #include "ChBody_CylinderComponent.h"
 #include "ChBody_SphereComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Runtime/Engine/Classes/PhysicsEngine/BodySetup.h"
+#include "chrono/physics/ChBodyEasy.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono_parallel/collision/ChCollisionModelParallel.h"
+#include "ChMortonOrder.h"
+#include "ChBodyBatch.h"
+#include "ChPhysicsObjectRegistry.h"
+#include "util.h"
 
 // Sets default values
 APhysicsObjectGeneratorBasis::APhysicsObjectGeneratorBasis()
@@ -28,20 +38,83 @@ APhysicsObjectGeneratorBasis::APhysicsObjectGeneratorBasis()
 	cylinderMesh = cylinderFinder.Object;
 	static ConstructorHelpers::FObjectFinder<UStaticMesh> sphereFinder(TEXT("/ChronoPhysics/BasicShapeMesh/SM_Sphere.SM_Sphere"));
 	sphereMesh = sphereFinder.Object;
+
+	ShapeInstancers.Init(nullptr, 3);
+	ShapeInstanceList.SetNum(3);
+}
+
+void APhysicsObjectGeneratorBasis::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+	FChPhysicsObjectRegistry::Register(this);
+}
+
+void APhysicsObjectGeneratorBasis::PostUnregisterAllComponents()
+{
+	CloseMotionBuffer();
+	FChPhysicsObjectRegistry::Unregister(this);
+	Super::PostUnregisterAllComponents();
+}
+
+void APhysicsObjectGeneratorBasis::PhysicsObjectBuildGeometry()
+{
+	for (auto obj : PhysicsObjectList) {
+		obj->PhysicsObjectBuildGeometry();
+	}
 }
 
 void APhysicsObjectGeneratorBasis::PhysicsObjectInitalize()
 {
 	for (auto obj : PhysicsObjectList) {
+		obj->SetSleepingParameter(bSceneUseSleeping, sceneSleepTime, sceneSleepMinSpeed, sceneSleepMinAngularSpeed);
 		obj->PhysicsObjectInitalize();
 	}
+	OpenMotionBuffer();
+}
+
+void APhysicsObjectGeneratorBasis::SetSleepingParameter(bool bUseSleeping, float sleepTime, float minSpeed, float minAngularSpeed)
+{
+	this->bSceneUseSleeping = bUseSleeping;
+	this->sceneSleepTime = sleepTime;
+	this->sceneSleepMinSpeed = minSpeed;
+	this->sceneSleepMinAngularSpeed = minAngularSpeed;
 }
 
 void APhysicsObjectGeneratorBasis::AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem)
 {
+	// Thousands of instances, the body list grows once
+	FChBodyBatch batch(phySystem);
 	for (auto obj : PhysicsObjectList) {
 		obj->AddToSystem(phySystem);
 	}
+	if (bSpatialBodyOrder) {
+		// Only the insertion order changes, instance indices stay valid
+		TArray<FVector> locations;
+		locations.Reserve(InstancedBodyList.Num());
+		for (auto& instance : InstancedBodyList) {
+			locations.Add(instance.CachedTransform.GetLocation());
+		}
+		for (int32 index : ChMortonOrder::SortedIndices(locations)) {
+			FChBodyBatch::AddBody(phySystem, InstancedBodyList[index].ChData);
+		}
+		return;
+	}
+	for (auto& instance : InstancedBodyList) {
+		FChBodyBatch::AddBody(phySystem, instance.ChData);
+	}
+}
+
+void APhysicsObjectGeneratorBasis::RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem)
+{
+	FChBodyBatch batch(phySystem);
+	for (auto obj : PhysicsObjectList) {
+		obj->RemoveFromSystem(phySystem);
+	}
+	for (auto& instance : InstancedBodyList) {
+		if (instance.ChData->GetSystem() == phySystem.get()) {
+			FChBodyBatch::RemoveBody(phySystem, instance.ChData);
+		}
+	}
 }
 
 void APhysicsObjectGeneratorBasis::UpdatePhysicsState()
@@ -51,11 +124,69 @@ void APhysicsObjectGeneratorBasis::UpdatePhysicsState()
 	}
 }
 
+void APhysicsObjectGeneratorBasis::CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList)
+{
+	for (auto obj : PhysicsObjectList) {
+		obj->CollectPhysicsStateUpdate(objList);
+	}
+}
+
+void APhysicsObjectGeneratorBasis::RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList)
+{
+	// Children write their own channels, the generator itself has none
+	for (auto obj : PhysicsObjectList) {
+		obj->RegisterTelemetry(telemetry, writerList);
+	}
+}
+
 void APhysicsObjectGeneratorBasis::UpdateVisualAsset()
 {
 	for (auto obj : PhysicsObjectList) {
 		obj->UpdateVisualAsset();
 	}
+	UpdateInstanceVisual(1.f);
+}
+
+void APhysicsObjectGeneratorBasis::InterpolateVisualAsset(float alpha)
+{
+	for (auto obj : PhysicsObjectList) {
+		obj->InterpolateVisualAsset(alpha);
+	}
+	UpdateInstanceVisual(alpha);
+}
+
+void APhysicsObjectGeneratorBasis::GatherVisualTransforms(TArray<class USceneComponent*>& components, TArray<FTransform>& transforms, float alpha, float tolerance)
+{
+	for (auto obj : PhysicsObjectList) {
+		obj->GatherVisualTransforms(components, transforms, alpha, tolerance);
+	}
+	UpdateInstanceVisual(alpha);
+}
+
+void APhysicsObjectGeneratorBasis::LatchPhysicsInput()
+{
+	for (auto obj : PhysicsObjectList) {
+		obj->LatchPhysicsInput();
+	}
+	if (motionBuffer) {
+		// After the engines latched their own motion, the buffer wins
+		for (int32 i = 0; i < EngineList.Num(); i++) {
+			EngineList[i]->LatchMotion(motionBuffer[i]);
+		}
+	}
+}
+
+void APhysicsObjectGeneratorBasis::CacheVisualState()
+{
+	for (auto obj : PhysicsObjectList) {
+		obj->CacheVisualState();
+	}
+	for (auto& instance : InstancedBodyList) {
+		if (!instance.bFixed) {
+			instance.PreviousTransform = instance.CachedTransform;
+			instance.CachedTransform = FTransform(CHRONO_QUAT_TO_FQUAT(instance.ChData->GetRot()), CHRONO_VEC_TO_FVECTOR(instance.ChData->GetPos()), instance.Scale);
+		}
+	}
 }
 
 bool APhysicsObjectGeneratorBasis::SetEngineMotion(int index, float motion)
@@ -75,9 +206,68 @@ float APhysicsObjectGeneratorBasis::GetEngineMotion(int index)
 	return 99999999.f;
 }
 
-AChBody_GeneratedActor * APhysicsObjectGeneratorBasis::NewChBodyActor(EShapeType::Type shape)
+void APhysicsObjectGeneratorBasis::SetEngineMotions(const TArray<float>& motions)
 {
-	auto newBody = GetWorld()->SpawnActor<AChBody_GeneratedActor>(AChBody_GeneratedActor::StaticClass());
+	int32 num = FMath::Min(motions.Num(), EngineList.Num());
+	if (motionBuffer) {
+		FMemory::Memcpy(motionBuffer, motions.GetData(), num * sizeof(float));
+		return;
+	}
+	for (int32 i = 0; i < num; i++) {
+		EngineList[i]->SetMotion(motions[i]);
+	}
+}
+
+void APhysicsObjectGeneratorBasis::GetEngineMotions(TArray<float>& motions) const
+{
+	motions.SetNumUninitialized(EngineList.Num());
+	for (int32 i = 0; i < EngineList.Num(); i++) {
+		motions[i] = EngineList[i]->GetMotion();
+	}
+}
+
+void APhysicsObjectGeneratorBasis::OpenMotionBuffer()
+{
+	CloseMotionBuffer();
+	if (!bUseMotionBuffer || EngineList.Num() == 0) {
+		return;
+	}
+
+	if (!MotionBufferName.IsEmpty()) {
+		SIZE_T size = EngineList.Num() * sizeof(float);
+		motionRegion = FPlatformMemory::MapNamedSharedMemoryRegion(MotionBufferName, true, FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write, size);
+		if (motionRegion) {
+			motionBuffer = (float*)motionRegion->GetAddress();
+		}
+		else {
+			UE_LOG(LogTemp, Warning, TEXT("%s: can't map the motion buffer %s, using a local one"), *GetName(), *MotionBufferName);
+		}
+	}
+	if (!motionBuffer) {
+		localMotionBuffer.SetNumUninitialized(EngineList.Num());
+		motionBuffer = localMotionBuffer.GetData();
+	}
+
+	// Starts from the engines' current motions, a controller that hasn't written yet changes nothing
+	for (int32 i = 0; i < EngineList.Num(); i++) {
+		motionBuffer[i] = EngineList[i]->GetMotion();
+	}
+}
+
+void APhysicsObjectGeneratorBasis::CloseMotionBuffer()
+{
+	if (motionRegion) {
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(motionRegion);
+	}
+	motionRegion = nullptr;
+	motionBuffer = nullptr;
+	localMotionBuffer.Empty();
+}
+
+AChBody_GeneratedActor * APhysicsObjectGeneratorBasis::NewChBodyActor(EShapeType::Type shape, const FTransform& transform)
+{
+	// Owned by the generator, so the registry leaves it to the generator's object list
+	auto newBody = GetWorld()->SpawnActorDeferred<AChBody_GeneratedActor>(AChBody_GeneratedActor::StaticClass(), transform, this, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
 
 	UChBodyComponent* newComp;
 	if (shape == EShapeType::Box) {
@@ -99,14 +289,22 @@ AChBody_GeneratedActor * APhysicsObjectGeneratorBasis::NewChBodyActor(EShapeType
 		newBody->ChComp = newComp;
 	}
 
+	newBody->ChComp->isForParallel = bGenerateForParallel;
+	newBody->ChComp->isForSMC = bGenerateForSMC;
+	if (InstanceCollisionFamily >= 0 && !bInstanceSelfCollision) {
+		newBody->ChComp->CollisionFamily = InstanceCollisionFamily;
+		newBody->ChComp->NoCollisionWithFamiliy.AddUnique(InstanceCollisionFamily);
+	}
+	// Construction and BeginPlay see the mesh and the configured body
+	newBody->FinishSpawning(transform);
 	PhysicsObjectList.Add(newBody->ChComp);
 	return newBody;
 }
 
-AChLinkActor * APhysicsObjectGeneratorBasis::NewChLinkActor(ELinkType::Type linkType)
+AChLinkActor * APhysicsObjectGeneratorBasis::NewChLinkActor(ELinkType::Type linkType, const FTransform& transform)
 {
 	if (linkType == ELinkType::ENGINE_ROTATION || linkType == ELinkType::ENGINE_SPEED || linkType == ELinkType::ENGINE_TORQUE) {
-		auto engine = GetWorld()->SpawnActor<AChLink_EngineActor>(AChLink_EngineActor::StaticClass());
+		auto engine = GetWorld()->SpawnActorDeferred<AChLink_EngineActor>(AChLink_EngineActor::StaticClass(), transform, this, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
 		switch (linkType) {
 		case ELinkType::ENGINE_ROTATION:
 			engine->EngineType = EEngineMode::ENG_MODE_ROTATION;
@@ -117,12 +315,13 @@ AChLinkActor * APhysicsObjectGeneratorBasis::NewChLinkActor(ELinkType::Type link
 		default:
 			engine->EngineType = EEngineMode::ENG_MODE_TORQUE;
 		}
+		engine->FinishSpawning(transform);
 		PhysicsObjectList.Add(engine);
 		EngineList.Add(engine);
 		return engine;
 	}
 	else {
-		auto newActor = GetWorld()->SpawnActor<AChLinkLockActor>(AChLinkLockActor::StaticClass());
+		auto newActor = GetWorld()->SpawnActorDeferred<AChLinkLockActor>(AChLinkLockActor::StaticClass(), transform, this, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
 		ELinkLockType::Type linkLockType;
 		switch (linkType) {
 		case ELinkType::FREE:
@@ -172,8 +371,167 @@ AChLinkActor * APhysicsObjectGeneratorBasis::NewChLinkActor(ELinkType::Type link
 			break;
 		}
 		newActor->LinkLockType = linkLockType;
+		newActor->bUseMarkerFreeLink = bMarkerFreeLinks;
+		newActor->FinishSpawning(transform);
 		PhysicsObjectList.Add(newActor);
 		return newActor;
 	}
 }
 
+int APhysicsObjectGeneratorBasis::NewChBodyInstance(EShapeType::Type shape, const FTransform& transform, double density, bool fixed)
+{
+	auto scale = transform.GetScale3D();
+	auto contactMethod = CHRONO_CONTACT_METHOD(bGenerateForSMC);
+	std::shared_ptr<chrono::ChBody> body;
+
+	if (shape == EShapeType::Box && boxMesh->BodySetup->AggGeom.BoxElems.Num()) {
+		auto box = boxMesh->BodySetup->AggGeom.BoxElems[0];
+		body = std::make_shared<chrono::ChBodyEasyBox>(box.X * scale.X / CHRONO_SCALE, box.Z * scale.Z / CHRONO_SCALE, box.Y * scale.Y / CHRONO_SCALE, density, true, false, contactMethod);
+		if (bGenerateForParallel) {
+			body->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+			body->GetCollisionModel()->ClearModel();
+			body->GetCollisionModel()->AddBox(box.X * scale.X / 2.0f / CHRONO_SCALE, box.Z * scale.Z / 2.0f / CHRONO_SCALE, box.Y * scale.Y / 2.0f / CHRONO_SCALE);
+			body->GetCollisionModel()->BuildModel();
+		}
+	}
+	else if (shape == EShapeType::Cylinder && cylinderMesh->BodySetup->AggGeom.SphylElems.Num()) {
+		auto cylinder = cylinderMesh->BodySetup->AggGeom.SphylElems[0];
+		body = std::make_shared<chrono::ChBodyEasyCylinder>(cylinder.Radius * scale.X / CHRONO_SCALE, cylinder.Length * scale.Z / CHRONO_SCALE, density, true, false, contactMethod);
+		if (bGenerateForParallel) {
+			body->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+			body->GetCollisionModel()->ClearModel();
+			body->GetCollisionModel()->AddCylinder(cylinder.Radius * scale.X / CHRONO_SCALE, cylinder.Radius * scale.X / CHRONO_SCALE, cylinder.Length * scale.Z / CHRONO_SCALE * 0.5);
+			body->GetCollisionModel()->BuildModel();
+		}
+	}
+	else if (shape == EShapeType::Sphere && sphereMesh->BodySetup->AggGeom.SphereElems.Num()) {
+		auto sphere = sphereMesh->BodySetup->AggGeom.SphereElems[0];
+		body = std::make_shared<chrono::ChBodyEasySphere>(sphere.Radius / CHRONO_SCALE * scale.X, density, true, false, contactMethod);
+		if (bGenerateForParallel) {
+			body->SetCollisionModel(std::make_shared<chrono::collision::ChCollisionModelParallel>());
+			body->GetCollisionModel()->ClearModel();
+			body->GetCollisionModel()->AddSphere(sphere.Radius / CHRONO_SCALE * scale.X);
+			body->GetCollisionModel()->BuildModel();
+		}
+	}
+
+	auto instancer = GetShapeInstancer(shape);
+	if (!body || !instancer) {
+		return INDEX_NONE;
+	}
+
+	ConfigureInstanceBody(*body, transform, fixed);
+	GetDefault<UChBodyComponent>()->ApplyMaterialParameter(body, bGenerateForSMC);
+
+	FChInstancedBody instance;
+	instance.ChData = body;
+	instance.Shape = shape;
+	instance.bFixed = fixed;
+	instance.Scale = scale;
+	instance.CachedTransform = transform;
+	instance.PreviousTransform = transform;
+
+	instancer->AddInstanceWorldSpace(transform);
+	ShapeInstanceList[shape].Add(InstancedBodyList.Num());
+	return InstancedBodyList.Add(instance);
+}
+
+void APhysicsObjectGeneratorBasis::ConfigureInstanceBody(chrono::ChBody& body, const FTransform& transform, bool fixed) const
+{
+	// Generated bodies share the defaults of a freshly placed body component
+	auto defaults = GetDefault<UChBodyComponent>();
+	body.SetBodyFixed(fixed);
+	body.SetCollide(true);
+	if (InstanceCollisionFamily >= 0) {
+		body.GetCollisionModel()->SetFamily(InstanceCollisionFamily);
+		if (!bInstanceSelfCollision) {
+			body.GetCollisionModel()->SetFamilyMaskNoCollisionWithFamily(InstanceCollisionFamily);
+		}
+	}
+	body.SetIdentifier(FMath::Max(InstanceCollisionGroup, 0));
+	body.SetLimitSpeed(true);
+	body.SetMaxSpeed(defaults->MaxSpeed);
+	body.SetMaxWvel(defaults->MaxAngularSpeed);
+	body.SetPos(FVECTOR_TO_CHRONO_VEC(transform.GetLocation()));
+	body.SetRot(FQUAT_TO_CHRONO_QUAT(transform.GetRotation()));
+	body.SetUseSleeping(bSceneUseSleeping && defaults->bAllowSleeping);
+	body.SetSleepTime(sceneSleepTime);
+	body.SetSleepMinSpeed(sceneSleepMinSpeed / CHRONO_SCALE);
+	body.SetSleepMinWvel(sceneSleepMinAngularSpeed);
+}
+
+void APhysicsObjectGeneratorBasis::AddBodyInstances(TArray<FChInstancedBody>& instances)
+{
+	TArray<TArray<FTransform>> shapeTransforms;
+	shapeTransforms.SetNum(ShapeInstanceList.Num());
+	InstancedBodyList.Reserve(InstancedBodyList.Num() + instances.Num());
+	for (auto& instance : instances) {
+		if (!instance.ChData || !GetShapeInstancer(instance.Shape)) {
+			continue;
+		}
+		shapeTransforms[instance.Shape].Add(instance.CachedTransform);
+		ShapeInstanceList[instance.Shape].Add(InstancedBodyList.Num());
+		InstancedBodyList.Add(MoveTemp(instance));
+	}
+	instances.Reset();
+
+	// Every added instance would start a tree build of its own
+	for (int shape = 0; shape < shapeTransforms.Num(); shape++) {
+		if (shapeTransforms[shape].Num() == 0) {
+			continue;
+		}
+		auto instancer = ShapeInstancers[shape];
+		instancer->bAutoRebuildTreeOnInstanceChanges = false;
+		for (auto& transform : shapeTransforms[shape]) {
+			instancer->AddInstanceWorldSpace(transform);
+		}
+		instancer->bAutoRebuildTreeOnInstanceChanges = true;
+		instancer->BuildTreeIfOutdated(true, true);
+	}
+}
+
+std::shared_ptr<chrono::ChBody> APhysicsObjectGeneratorBasis::GetInstanceBody(int index)
+{
+	return InstancedBodyList.IsValidIndex(index) ? InstancedBodyList[index].ChData : nullptr;
+}
+
+void APhysicsObjectGeneratorBasis::UpdateInstanceVisual(float alpha)
+{
+	for (int shape = 0; shape < ShapeInstanceList.Num(); shape++) {
+		if (!ShapeInstancers[shape] || ShapeInstanceList[shape].Num() == 0) {
+			continue;
+		}
+
+		instanceTransformBuffer.Reset();
+		for (int index : ShapeInstanceList[shape]) {
+			auto& instance = InstancedBodyList[index];
+			if (alpha >= 1.f || instance.bFixed) {
+				instanceTransformBuffer.Add(instance.CachedTransform);
+			}
+			else {
+				FTransform blended;
+				blended.Blend(instance.PreviousTransform, instance.CachedTransform, alpha);
+				instanceTransformBuffer.Add(blended);
+			}
+		}
+		ShapeInstancers[shape]->BatchUpdateInstancesTransforms(0, instanceTransformBuffer, true, true, true);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent * APhysicsObjectGeneratorBasis::GetShapeInstancer(EShapeType::Type shape)
+{
+	if (!ShapeInstancers.IsValidIndex(shape)) {
+		return nullptr;
+	}
+
+	if (!ShapeInstancers[shape]) {
+		auto instancer = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		instancer->SetStaticMesh(shape == EShapeType::Box ? boxMesh : (shape == EShapeType::Cylinder ? cylinderMesh : sphereMesh));
+		instancer->SetMobility(EComponentMobility::Movable);
+		instancer->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		instancer->SetupAttachment(RootComponent);
+		instancer->RegisterComponent();
+		ShapeInstancers[shape] = instancer;
+	}
+	return ShapeInstancers[shape];
+}
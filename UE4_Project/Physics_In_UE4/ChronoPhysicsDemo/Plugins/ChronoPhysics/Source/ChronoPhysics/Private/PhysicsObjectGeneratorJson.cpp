@@ -2,192 +2,136 @@
 
 
 #include "PhysicsObjectGeneratorJson.h"
-#include "Dom/JsonObject.h"
-#include "Serialization/JsonReader.h"
-#include "Serialization/JsonSerializer.h"
-#include "Misc/FileHelper.h"
+#include "ChSceneFile.h"
+#include "Async/Async.h"
 #include "Misc/Paths.h"
 
-void APhysicsObjectGeneratorJson::PhysicsObjectConstruct()
+FString APhysicsObjectGeneratorJson::GetScenePath(const TCHAR* extension) const
 {
-	auto Jsonlocation = FPaths::Combine(FPaths::ProjectDir(), FString("Config"), JsonFileName + FString(".json"));
-	FString JsonData;
-
-	TMap<FString, AChBody_GeneratedActor*> bodyMap;
-	TArray<AChLinkActor*> linkArray;
+	return FPaths::Combine(FPaths::ProjectDir(), FString("Config"), JsonFileName + extension);
+}
 
-	if (FFileHelper::LoadFileToString(JsonData, *Jsonlocation)) {
-		//UE_LOG(LogTemp, Warning, TEXT("Data:%s"), *JsonData);
+FString APhysicsObjectGeneratorJson::GetBinaryScenePath() const
+{
+	// Generated, so with the other caches rather than next to the json in Config
+	return FPaths::Combine(FPaths::ProjectSavedDir(), FString("ChronoScenes"), JsonFileName + FString(".chscene"));
+}
 
-		TSharedPtr<FJsonObject> JsonObject;
-		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonData);
+void APhysicsObjectGeneratorJson::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+	if (GetWorld() && GetWorld()->IsGameWorld()) {
+		StartSceneLoad();
+	}
+}
 
-		if (FJsonSerializer::Deserialize(Reader, JsonObject)) {
-			UE_LOG(LogTemp, Warning, TEXT("Deserialize Success"));
+void APhysicsObjectGeneratorJson::StartSceneLoad()
+{
+	FString jsonPath = GetScenePath(TEXT(".json"));
+	FString binaryPath = GetBinaryScenePath();
+	bool bBinary = bUseBinaryScene;
+	sceneLoad = Async(EAsyncExecution::ThreadPool, [jsonPath, binaryPath, bBinary]() {
+		TSharedPtr<FChSceneData, ESPMode::ThreadSafe> scene = MakeShared<FChSceneData, ESPMode::ThreadSafe>();
+		bool bLoaded = bBinary ? scene->Load(jsonPath, binaryPath, true) : scene->LoadJson(jsonPath);
+		return bLoaded ? scene : nullptr;
+	});
+}
 
-			auto bodyJsonArray = JsonObject->GetArrayField("Body");
-			UE_LOG(LogTemp, Warning, TEXT("Body Num:%d"), bodyJsonArray.Num());
-			auto linkJsonArray = JsonObject->GetArrayField("Link");
-			UE_LOG(LogTemp, Warning, TEXT("Link Num:%d"), linkJsonArray.Num());
+void APhysicsObjectGeneratorJson::PhysicsObjectConstruct()
+{
+	if (!sceneLoad.IsValid()) {
+		StartSceneLoad();
+	}
+	// Usually finished long before the scene manager gets here
+	TSharedPtr<FChSceneData, ESPMode::ThreadSafe> scene = sceneLoad.Get();
+	sceneLoad.Reset();
 
-			for (auto bodyItem : bodyJsonArray) {
+	if (!scene.IsValid()) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: can't load scene %s"), *GetName(), *JsonFileName);
+		return;
+	}
+	UE_LOG(LogTemp, Log, TEXT("Body Num:%d Link Num:%d"), scene->Bodies.Num(), scene->Links.Num());
+	SpawnScene(*scene);
+}
 
-				AChBody_GeneratedActor* body;
-				if (bodyItem->AsObject()->GetStringField("Shape").ToLower().Compare(FString("box")) == 0) {
-					body = NewChBodyActor(EShapeType::Box);
-				}
-				else if(bodyItem->AsObject()->GetStringField("Shape").ToLower().Compare(FString("cylinder")) == 0) {
-					body = NewChBodyActor(EShapeType::Cylinder);
-				}
-				else{
-					body = NewChBodyActor(EShapeType::Sphere);
-				}
+void APhysicsObjectGeneratorJson::ConvertToBinaryScene()
+{
+	FChSceneData scene;
+	if (!scene.LoadJson(GetScenePath(TEXT(".json"))) || !scene.SaveBinary(GetBinaryScenePath())) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: can't convert scene %s"), *GetName(), *JsonFileName);
+	}
+}
 
-				if (bodyItem->AsObject()->HasField("Position")) {
-					if (bodyItem->AsObject()->GetArrayField("Position").Num() >= 3) {
-						float tx = bodyItem->AsObject()->GetArrayField("Position")[0]->AsNumber();
-						float ty = bodyItem->AsObject()->GetArrayField("Position")[1]->AsNumber();
-						float tz = bodyItem->AsObject()->GetArrayField("Position")[2]->AsNumber();
-						body->SetActorLocation(FVector(tx, ty, tz));
-					}
-				}
-				if (bodyItem->AsObject()->HasField("Rotation")) {
-					if (bodyItem->AsObject()->GetArrayField("Rotation").Num() >= 3) {
-						float rx = bodyItem->AsObject()->GetArrayField("Rotation")[0]->AsNumber();
-						float ry = bodyItem->AsObject()->GetArrayField("Rotation")[1]->AsNumber();
-						float rz = bodyItem->AsObject()->GetArrayField("Rotation")[2]->AsNumber();
-						body->SetActorRotation(FRotator(rx, ry, rz));
-					}
-				}
-				if (bodyItem->AsObject()->HasField("Scale")) {
-					if (bodyItem->AsObject()->GetArrayField("Scale").Num() >= 3) {
-						float sx = bodyItem->AsObject()->GetArrayField("Scale")[0]->AsNumber();
-						float sy = bodyItem->AsObject()->GetArrayField("Scale")[1]->AsNumber();
-						float sz = bodyItem->AsObject()->GetArrayField("Scale")[2]->AsNumber();
-						body->SetActorScale3D(FVector(sx, sy, sz));
-					}
-				}
-				if (bodyItem->AsObject()->HasField("Fixed")) {
-					if (bodyItem->AsObject()->GetBoolField("Fixed")) {
-						body->ChComp->isFixed = true;
-					}
-				}
-				if (bodyItem->AsObject()->HasField("Density")) {
-					body->ChComp->Density = bodyItem->AsObject()->GetNumberField("Density");
-				}
-				body->ChComp->PhysicsObjectConstruct();
-				bodyMap.Add(bodyItem->AsObject()->GetStringField("Name"), body);
+void APhysicsObjectGeneratorJson::SpawnScene(const FChSceneData& scene)
+{
+	// Indexed like scene.Bodies, only one of them is filled
+	TArray<AChBody_GeneratedActor*> bodyActors;
+	TArray<int> bodyInstances;
+	FVector offset = bPositionRelative ? GetActorLocation() : FVector::ZeroVector;
+
+	// Final transforms up front, every actor is spawned where it stays
+	auto bodyTransform = [&offset](const FChSceneBody& body) {
+		return FTransform(
+			(body.Flags & EChSceneFlags::Rotation) ? FQuat(body.Rotation) : FQuat::Identity,
+			((body.Flags & EChSceneFlags::Position) ? body.Position : FVector::ZeroVector) + offset,
+			(body.Flags & EChSceneFlags::Scale) ? body.Scale : FVector::OneVector);
+	};
+
+	if (bUseInstancedRendering) {
+		bodyInstances.Reserve(scene.Bodies.Num());
+		InstancedBodyList.Reserve(InstancedBodyList.Num() + scene.Bodies.Num());
+		double defaultDensity = GetDefault<UChBodyComponent>()->Density;
+		for (auto& body : scene.Bodies) {
+			double density = (body.Flags & EChSceneFlags::Density) ? body.Density : defaultDensity;
+			bodyInstances.Add(NewChBodyInstance((EShapeType::Type)body.Shape, bodyTransform(body), density, (body.Flags & EChSceneFlags::Fixed) != 0));
+		}
+	}
+	else {
+		bodyActors.Reserve(scene.Bodies.Num());
+		PhysicsObjectList.Reserve(PhysicsObjectList.Num() + scene.Bodies.Num() + scene.Links.Num());
+		for (auto& body : scene.Bodies) {
+			AChBody_GeneratedActor* actor = NewChBodyActor((EShapeType::Type)body.Shape, bodyTransform(body));
+			if (body.Flags & EChSceneFlags::Fixed) {
+				actor->ChComp->isFixed = true;
 			}
-
-			for (auto linkItem : linkJsonArray) {
-
-				AChBody_GeneratedActor* target1 = nullptr;
-				AChBody_GeneratedActor* target2 = nullptr;
-
-				if (linkItem->AsObject()->HasField("Target")) {
-					auto targetArray = linkItem->AsObject()->GetArrayField("Target");
-					if (targetArray.Num() >= 2) {
-						if (bodyMap.Contains(targetArray[0]->AsString()) && bodyMap.Contains(targetArray[1]->AsString())) {
-							target1 = bodyMap[targetArray[0]->AsString()];
-							target2 = bodyMap[targetArray[1]->AsString()];
-						}
-					}
-				}
-
-				if (!(target1 && target2)) {
-					continue;
-				}
-
-				AChLinkActor* link;
-				if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("REVOLUTE")) == 0) {
-					link = NewChLinkActor(ELinkType::REVOLUTE);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("ALIGN")) == 0) {
-					link = NewChLinkActor(ELinkType::ALIGN);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("CLEARANCE")) == 0) {
-					link = NewChLinkActor(ELinkType::CLEARANCE);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("CYLINDRICAL")) == 0) {
-					link = NewChLinkActor(ELinkType::CYLINDRICAL);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("ENGINE_ROTATION")) == 0) {
-					link = NewChLinkActor(ELinkType::ENGINE_ROTATION);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("ENGINE_SPEED")) == 0) {
-					link = NewChLinkActor(ELinkType::ENGINE_SPEED);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("ENGINE_TORQUE")) == 0) {
-					link = NewChLinkActor(ELinkType::ENGINE_TORQUE);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("LOCK")) == 0) {
-					link = NewChLinkActor(ELinkType::LOCK);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("OLDHAM")) == 0) {
-					link = NewChLinkActor(ELinkType::OLDHAM);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("PARALLEL")) == 0) {
-					link = NewChLinkActor(ELinkType::PARALLEL);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("PERPEND")) == 0) {
-					link = NewChLinkActor(ELinkType::PERPEND);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("PLANEPLANE")) == 0) {
-					link = NewChLinkActor(ELinkType::PLANEPLANE);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("POINTLINE")) == 0) {
-					link = NewChLinkActor(ELinkType::POINTLINE);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("PRISMATIC")) == 0) {
-					link = NewChLinkActor(ELinkType::PRISMATIC);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("REVOLUTEPRISMATIC")) == 0) {
-					link = NewChLinkActor(ELinkType::REVOLUTEPRISMATIC);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("SPHERICAL")) == 0) {
-					link = NewChLinkActor(ELinkType::SPHERICAL);
-				}
-				else if (linkItem->AsObject()->GetStringField("Type").ToUpper().Compare(FString("TRAJECTORY")) == 0) {
-					link = NewChLinkActor(ELinkType::TRAJECTORY);
-				}
-				else {
-					link = NewChLinkActor(ELinkType::FREE);
-				}
-
-				if (linkItem->AsObject()->HasField("Position")) {
-					if (linkItem->AsObject()->GetArrayField("Position").Num() >= 3) {
-						float tx = linkItem->AsObject()->GetArrayField("Position")[0]->AsNumber();
-						float ty = linkItem->AsObject()->GetArrayField("Position")[1]->AsNumber();
-						float tz = linkItem->AsObject()->GetArrayField("Position")[2]->AsNumber();
-						link->SetActorLocation(FVector(tx, ty, tz));
-					}
-				}
-				if (linkItem->AsObject()->HasField("Rotation")) {
-					if (linkItem->AsObject()->GetArrayField("Rotation").Num() >= 3) {
-						float rx = linkItem->AsObject()->GetArrayField("Rotation")[0]->AsNumber();
-						float ry = linkItem->AsObject()->GetArrayField("Rotation")[1]->AsNumber();
-						float rz = linkItem->AsObject()->GetArrayField("Rotation")[2]->AsNumber();
-						link->SetActorRotation(FRotator(rx, ry, rz));
-					}
-				}
-				link->target1 = target1;
-				link->target2 = target2;
-
-				link->PhysicsObjectConstruct();
-				linkArray.Add(link);
+			if (body.Flags & EChSceneFlags::Density) {
+				actor->ChComp->Density = body.Density;
 			}
+			actor->ChComp->PhysicsObjectConstruct();
+			bodyActors.Add(actor);
+		}
+	}
 
-			if (bPositionRelative) {
-				for (auto kvp : bodyMap) {
-					kvp.Value->SetActorLocation(kvp.Value->GetActorLocation() + GetActorLocation());
-				}
-				for (auto link : linkArray) {
-					link->SetActorLocation(link->GetActorLocation() + GetActorLocation());
-				}
-			}
+	for (auto& linkData : scene.Links) {
+		if (!scene.Bodies.IsValidIndex(linkData.Target1) || !scene.Bodies.IsValidIndex(linkData.Target2)) {
+			continue;
+		}
+
+		AChBody_GeneratedActor* target1 = nullptr;
+		AChBody_GeneratedActor* target2 = nullptr;
+		std::shared_ptr<chrono::ChBody> targetBody1;
+		std::shared_ptr<chrono::ChBody> targetBody2;
+		if (bUseInstancedRendering) {
+			targetBody1 = GetInstanceBody(bodyInstances[linkData.Target1]);
+			targetBody2 = GetInstanceBody(bodyInstances[linkData.Target2]);
 		}
 		else {
-			UE_LOG(LogTemp, Warning, TEXT("Deserialize Fail"));
+			target1 = bodyActors[linkData.Target1];
+			target2 = bodyActors[linkData.Target2];
+		}
+		if (!(target1 && target2) && !(targetBody1 && targetBody2)) {
+			continue;
+		}
+
+		FTransform transform(
+			(linkData.Flags & EChSceneFlags::Rotation) ? FQuat(linkData.Rotation) : FQuat::Identity,
+			((linkData.Flags & EChSceneFlags::Position) ? linkData.Position : FVector::ZeroVector) + offset);
+		AChLinkActor* link = NewChLinkActor((ELinkType::Type)linkData.Type, transform);
+		link->target1 = target1;
+		link->target2 = target2;
+		if (targetBody1 && targetBody2) {
+			link->SetTargetBodies(targetBody1, targetBody2);
 		}
+		link->PhysicsObjectConstruct();
 	}
 }
@@ -5,23 +5,47 @@
 
 void APhysicsObjectGeneratorSample::PhysicsObjectConstruct()
 {
+	if (bUseInstancedRendering) {
+		PhysicsObjectConstructInstanced();
+		return;
+	}
+
 	TArray<AChBody_GeneratedActor*> boxList;
+	boxList.Reserve(BoxCount);
+	PhysicsObjectList.Reserve(PhysicsObjectList.Num() + BoxCount * 2);
 	for (int i = 0; i < BoxCount; i++) {
-		auto box = NewChBodyActor(EShapeType::Box);
+		FVector location = FVector(i * 50, i * 50, -i * 150);
+		auto box = NewChBodyActor(EShapeType::Box, FTransform(location));
+		box->ChComp->isFixed = i == 0;
 		box->ChComp->PhysicsObjectConstruct();
 		boxList.Add(box);
-		box->SetActorLocation(FVector(i * 50, i * 50, -i * 150));
 
-		if (i == 0) {
-			box->ChComp->isFixed = true;
-		}
-		else {
-			box->ChComp->isFixed = false;
-			auto link = NewChLinkActor(ELinkType::SPHERICAL);
+		if (i > 0) {
+			auto link = NewChLinkActor(ELinkType::SPHERICAL, FTransform((location + boxList[i - 1]->GetActorLocation()) / 2));
 			link->PhysicsObjectConstruct();
 			link->target1 = box;
 			link->target2 = boxList[i - 1];
-			link->SetActorLocation((box->GetActorLocation() + boxList[i - 1]->GetActorLocation()) / 2);
 		}
 	}
 }
+
+void APhysicsObjectGeneratorSample::PhysicsObjectConstructInstanced()
+{
+	double density = GetDefault<UChBodyComponent>()->Density;
+	int lastBox = INDEX_NONE;
+	FVector lastLocation;
+	InstancedBodyList.Reserve(InstancedBodyList.Num() + BoxCount);
+
+	for (int i = 0; i < BoxCount; i++) {
+		FVector location = FVector(i * 50, i * 50, -i * 150);
+		int box = NewChBodyInstance(EShapeType::Box, FTransform(location), density, i == 0);
+
+		if (i > 0 && box != INDEX_NONE && lastBox != INDEX_NONE) {
+			auto link = NewChLinkActor(ELinkType::SPHERICAL, FTransform((location + lastLocation) / 2));
+			link->PhysicsObjectConstruct();
+			link->SetTargetBodies(GetInstanceBody(box), GetInstanceBody(lastBox));
+		}
+		lastBox = box;
+		lastLocation = location;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include <memory>
+#include <vector>
+
+namespace chrono {
+	class ChSystem;
+}
+
+enum class EChArchiveFormat : uint8 {
+	JSON,
+	XML
+};
+
+/**
+ * Human readable dumps of a system without the step waiting on them. Capture writes the system to a
+ * ChArchiveOutBinary in memory, which is a plain copy of the members. Each export reads that back into a
+ * system of its own on the thread pool and writes ChArchiveOutJSON or ChArchiveOutXML from there, so the
+ * live system keeps stepping while the text is formatted
+ */
+class CHRONOPHYSICS_API FChArchiveSnapshot
+{
+public:
+	bool Capture(chrono::ChSystem* system);
+	FORCEINLINE bool IsValid() const { return bytes != nullptr; }
+
+	// The task keeps the captured bytes, a new Capture doesn't touch exports still running
+	TFuture<bool> ExportAsync(const FString& filePath, EChArchiveFormat format) const;
+
+private:
+	std::shared_ptr<const std::vector<char>> bytes;
+	// Archives only hold the members, the contact method picks the system class to read them into
+	bool bSMC = false;
+};
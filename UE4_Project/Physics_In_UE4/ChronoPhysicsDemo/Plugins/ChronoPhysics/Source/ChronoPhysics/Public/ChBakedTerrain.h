@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "HAL/CriticalSection.h"
+#include "chrono_vehicle/ChTerrain.h"
+#include <atomic>
+#include <memory>
+
+namespace chrono {
+	class ChBezierCurve;
+}
+
+/**
+ * Height, normal and friction of another terrain sampled once onto a grid, for sources as slow to query as
+ * CRGTerrain. Only the tiles within a half width of the road's reference line are baked, each a dense block
+ * of samples, and queries inside them are a tile lookup and a bilinear blend. Queries outside the baked
+ * tiles, or before the bake has finished, go to the source. The bake runs on the thread pool; CRG evaluates
+ * through one shared contact point, so unless the source is thread safe it is sampled from one worker, and
+ * queries on the source wait for the rows that worker is on
+ */
+class CHRONOPHYSICS_API FChBakedTerrain : public chrono::vehicle::ChTerrain
+{
+public:
+	// Chrono units, Z up like the rest of chrono_vehicle
+	FChBakedTerrain(std::shared_ptr<chrono::vehicle::ChTerrain> source, double cellSize = 0.05);
+
+	// The terrain has to outlive the returned future, and a bake must finish before the next one starts
+	TFuture<void> Bake(const chrono::ChBezierCurve& path, double halfWidth, bool bThreadSafeSource = false);
+	FORCEINLINE bool IsBaked() const { return bBaked; }
+
+	virtual double GetHeight(double x, double y) const override;
+	virtual chrono::ChVector<> GetNormal(double x, double y) const override;
+	virtual float GetCoefficientFriction(double x, double y) const override;
+
+	FORCEINLINE int32 GetTileNum() const { return tiles.Num(); }
+	SIZE_T GetAllocatedSize() const { return tiles.GetAllocatedSize(); }
+
+private:
+	static constexpr int32 TileCells = 32;
+	static constexpr int32 TileSamples = TileCells + 1;
+
+	struct FTile
+	{
+		FIntPoint Coordinate;
+		float Height[TileSamples * TileSamples];
+		float Normal[3][TileSamples * TileSamples];
+		float Friction[TileSamples * TileSamples];
+	};
+
+	void BakeTile(FTile& tile, bool bLock);
+	// The baked tile under x, y with the sample index of its cell and the blend weights in it
+	const FTile* FindCell(double x, double y, int32& outIndex, float& outAlphaX, float& outAlphaY) const;
+
+	std::shared_ptr<chrono::vehicle::ChTerrain> source;
+	double cellSize;
+	double tileSize;
+	TArray<FTile> tiles;
+	TMap<FIntPoint, int32> tileIndices;
+	std::atomic<bool> bBaked{ false };
+	mutable FCriticalSection sourceLock;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "chrono/core/ChVector.h"
+#include "util.h"
+
+// Array conversions for the mesh paths. The loops work on the raw component arrays so the compiler can vectorize them
+namespace ChBatchConvert {
+	static_assert(sizeof(chrono::ChVector<double>) == 3 * sizeof(double), "ChVector<double> must be tightly packed");
+	static_assert(sizeof(chrono::ChVector<int>) == 3 * sizeof(int32), "ChVector<int> must be tightly packed");
+	static_assert(sizeof(FTriIndices) == 3 * sizeof(int32), "FTriIndices must be tightly packed");
+
+	// Below this many elements a single loop beats the task overhead
+	static const int32 ParallelGrain = 16384;
+
+	template<typename FunctionType>
+	FORCEINLINE void ForChunks(int32 num, FunctionType function)
+	{
+		int32 chunks = FMath::DivideAndRoundUp(num, ParallelGrain);
+		if (chunks <= 1) {
+			function(0, num);
+			return;
+		}
+		ParallelFor(chunks, [&](int32 chunk) {
+			int32 begin = chunk * ParallelGrain;
+			function(begin, FMath::Min(begin + ParallelGrain, num));
+		});
+	}
+
+	// UE points into Chrono axes, scale is per UE axis and already includes CHRONO_SCALE
+	inline void ToChrono(const FVector* src, int32 num, const FVector& scale, chrono::ChVector<double>* dst)
+	{
+		const float* in = &src[0].X;
+		double* out = &dst[0][0];
+		const double sx = scale.X, sy = scale.Z, sz = scale.Y;
+		ForChunks(num, [=](int32 begin, int32 end) {
+			for (int32 i = begin; i < end; i++) {
+				out[i * 3 + 0] = in[i * 3 + 0] * sx;
+				out[i * 3 + 1] = in[i * 3 + 2] * sy;
+				out[i * 3 + 2] = in[i * 3 + 1] * sz;
+			}
+		});
+	}
+
+	inline void ToChrono(const TArray<FVector>& src, const FVector& scale, std::vector<chrono::ChVector<double>>& dst)
+	{
+		dst.resize(src.Num());
+		if (src.Num()) {
+			ToChrono(src.GetData(), src.Num(), scale, dst.data());
+		}
+	}
+
+	// Points already in Chrono units, only widened to double
+	inline void Widen(const TArray<FVector>& src, std::vector<chrono::ChVector<double>>& dst)
+	{
+		dst.resize(src.Num());
+		const float* in = src.Num() ? &src[0].X : nullptr;
+		double* out = src.Num() ? &dst[0][0] : nullptr;
+		for (int32 i = 0; i < src.Num() * 3; i++) {
+			out[i] = in[i];
+		}
+	}
+
+	// Same layout on both sides, triangle winding is kept
+	template<typename IndexType>
+	inline void Faces(const TArray<IndexType>& src, std::vector<chrono::ChVector<int>>& dst)
+	{
+		static_assert(sizeof(IndexType) == 3 * sizeof(int32), "Faces takes three packed int32 indices");
+		dst.resize(src.Num());
+		if (src.Num()) {
+			FMemory::Memcpy(dst.data(), src.GetData(), src.Num() * sizeof(IndexType));
+		}
+	}
+}
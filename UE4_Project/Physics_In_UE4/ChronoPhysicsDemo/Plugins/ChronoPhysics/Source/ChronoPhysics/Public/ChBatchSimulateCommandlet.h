@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ChParameterSweep.h"
+#include "ChBatchSimulateCommandlet.generated.h"
+
+/**
+ * Loads a map as a game world without a viewport and runs every scene manager in it through RunHeadless,
+ * one after the other, for parameter sweeps on build machines:
+ *
+ * UE4Editor-Cmd.exe ChronoPhysicsDemo.uproject -run=ChBatchSimulate -Map=/Game/Maps/Demo -Duration=60 -Step=0.005 -Output=D:/Sweep/Run0 -nullrhi
+ *
+ * Only the Chrono systems step, no actor or component ticks, so inputs have to come from the
+ * objects' UpdatePhysicsState. Telemetry is forced on and written to <Output>/<manager name>.csv
+ *
+ * -Sweep=<variants.json> runs a parameter sweep instead, see ChParameterSweep::LoadVariants. The scene is
+ * built once per process and every variant restarts from its snapshot. -Workers=N starts N child processes
+ * that each take every Nth variant, so the sweep uses N cores with one construction per worker
+ */
+UCLASS()
+class CHRONOPHYSICS_API UChBatchSimulateCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UChBatchSimulateCommandlet();
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	int32 SpawnWorkers(const FString& Params, int32 workers);
+	bool WriteSweepSummary(const FString& filePath, const TArray<FChSweepResult>& results, const class AChPhysicsSceneManagerActor* manager);
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChPhysicsSceneManagerActor.h"
+#include <memory>
+
+namespace chrono {
+	class ChSystem;
+}
+
+// Per step means over the measured steps, in milliseconds, the same timers chrono/utils/ChBenchmark.h sums
+struct FChBenchmarkResult
+{
+	FString Scene;
+	FString Backend;
+	int32 Threads = 1;
+	// Parallel NSC only, Schur products through FChThreadedShurSolver
+	bool bThreadedShur = false;
+	int32 Steps = 0;
+	int32 Bodies = 0;
+	double StepMs = 0;
+	double CollisionMs = 0;
+	double SolverMs = 0;
+	double SetupMs = 0;
+	double UpdateMs = 0;
+	// Wall clock around DoStepDynamics, includes what the Chrono timers don't cover
+	double WallMs = 0;
+	// Why the scene's own check failed after the last step, empty when it passed
+	FString CheckFailure;
+};
+
+/**
+ * A standard scene built straight into a ChSystem, without actors, so runs only measure Chrono and
+ * compare across backends and thread counts. Geometry is in Chrono units, Y up
+ */
+class CHRONOPHYSICS_API FChBenchmarkScene
+{
+public:
+	virtual ~FChBenchmarkScene() {}
+
+	virtual const TCHAR* GetName() const = 0;
+	virtual void Build(chrono::ChSystem* system, bool bSMC) = 0;
+	virtual bool SupportsBackend(EChSystemBackend::Type backend) const { return true; }
+	virtual double GetStepSize() const { return 1e-3; }
+	// Joystick axes of a replay, scenes without a driver ignore them
+	virtual void ApplyJoystick(const TArray<double>& axes) {}
+	// Before every step, warmup included, for scenes that drive bodies along a path
+	virtual void PreStep(chrono::ChSystem* system, double stepSize) {}
+	// After the last step, false with the reason when the scene didn't behave
+	virtual bool Check(chrono::ChSystem* system, FString& outFailure) const { return true; }
+};
+
+namespace ChBenchmark {
+	// Box stack, granular pile, wheeled rig on SCM and on rigid ground, FEA cable, large trimesh ground, box on a
+	// kinematic platform
+	CHRONOPHYSICS_API void CreateScenes(int32 granularCount, TArray<TUniquePtr<FChBenchmarkScene>>& outScenes);
+
+	// Names as in EChSystemBackend, case insensitive
+	CHRONOPHYSICS_API const TCHAR* GetBackendName(EChSystemBackend::Type backend);
+	CHRONOPHYSICS_API bool FindBackend(const FString& name, EChSystemBackend::Type& outBackend);
+
+	CHRONOPHYSICS_API std::shared_ptr<chrono::ChSystem> CreateSystem(EChSystemBackend::Type backend, int32 threads, bool bThreadedShur = false);
+
+	// warmupSteps run first and are not measured. The threaded Schur product is compared with the stock one through
+	// the commandlet's ThreadedShur=0,1 on the granular pile with Backends=PARALLEL_NSC
+	CHRONOPHYSICS_API FChBenchmarkResult Run(FChBenchmarkScene& scene, EChSystemBackend::Type backend, int32 threads, int32 warmupSteps, int32 steps, bool bThreadedShur = false);
+
+	// Adds the Chrono timers of the step that just ran
+	CHRONOPHYSICS_API void AccumulateTimers(chrono::ChSystem& system, FChBenchmarkResult& result);
+	// Turns the sums of steps measured steps, WallMs included, into per step means
+	CHRONOPHYSICS_API void FinishResult(FChBenchmarkResult& result, int32 steps);
+
+	CHRONOPHYSICS_API FString ToJson(const TArray<FChBenchmarkResult>& results);
+}
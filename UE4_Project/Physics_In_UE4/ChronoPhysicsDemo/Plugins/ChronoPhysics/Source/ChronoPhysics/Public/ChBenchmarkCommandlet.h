@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ChBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the standard benchmark scenes over every backend and thread count asked for and writes the
+ * per step timings as JSON:
+ *
+ * UE4Editor-Cmd.exe ChronoPhysicsDemo.uproject -run=ChBenchmark -Scenes=BoxStack,GranularPile
+ *     -Backends=SERIAL_NSC,PARALLEL_NSC -Threads=1,4,8 -Steps=500 -Warmup=50 -Output=D:/Bench/run.json -nullrhi
+ *
+ * All scenes, SERIAL_NSC and the Chrono thread budget when the lists are left out. Backends a scene
+ * doesn't support are skipped. Scenes that check their own outcome, like the box carried by the
+ * KinematicPlatform, make the run return 1 when the check fails
+ */
+UCLASS()
+class CHRONOPHYSICS_API UChBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UChBenchmarkCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/core/ChVector.h"
+#include <memory>
+
+namespace chrono {
+	class ChBezierCurve;
+}
+
+// Where a follower last was on the path, one per controller
+struct FChBezierPathCursor
+{
+	int32 Interval = INDEX_NONE;
+	double Param = 0;
+
+	FORCEINLINE bool IsValid() const { return Interval != INDEX_NONE; }
+	FORCEINLINE void Reset() { Interval = INDEX_NONE; Param = 0; }
+};
+
+/**
+ * Closest points on a ChBezierCurve for many followers. The segments' control points are taken out of the
+ * curve once with a bounding box each, and a follower's cursor makes every query a Newton solve started at its
+ * last parameter that only moves on to the neighbour segment when it runs off an end. Followers without a
+ * cursor yet, or ones that moved further than the relocation distance from their last point, are found over
+ * all segments with the boxes sorted by distance, stopping at the first box further than the best point.
+ * The index doesn't change after construction and can be shared by any number of followers
+ */
+class CHRONOPHYSICS_API FChBezierPathIndex
+{
+public:
+	explicit FChBezierPathIndex(const chrono::ChBezierCurve& curve, bool bInClosedPath = false);
+
+	// Chrono units, defaults to the longest segment
+	void SetRelocationDistance(double distance) { relocationDistance = distance; }
+
+	// Updates the cursor, returns the squared distance to the closest point
+	double Locate(const chrono::ChVector<>& location, FChBezierPathCursor& cursor, chrono::ChVector<>& outPoint) const;
+	// Ignores any cursor
+	double LocateGlobal(const chrono::ChVector<>& location, FChBezierPathCursor& outCursor, chrono::ChVector<>& outPoint) const;
+
+	chrono::ChVector<> Eval(const FChBezierPathCursor& cursor) const;
+	chrono::ChVector<> EvalTangent(const FChBezierPathCursor& cursor) const;
+
+	FORCEINLINE int32 GetSegmentNum() const { return segments.Num(); }
+	FORCEINLINE bool IsClosedPath() const { return bClosedPath; }
+
+private:
+	struct FSegment
+	{
+		chrono::ChVector<> P[4];
+		chrono::ChVector<> BoundsMin;
+		chrono::ChVector<> BoundsMax;
+	};
+
+	FORCEINLINE chrono::ChVector<> Eval(const FSegment& segment, double t) const;
+	FORCEINLINE chrono::ChVector<> EvalD(const FSegment& segment, double t) const;
+	FORCEINLINE chrono::ChVector<> EvalDD(const FSegment& segment, double t) const;
+	// Newton from t, which ends on the local minimum, returns its squared distance
+	double Solve(const chrono::ChVector<>& location, int32 segment, double& t) const;
+	int32 GetNext(int32 segment) const;
+	int32 GetPrevious(int32 segment) const;
+
+	TArray<FSegment> segments;
+	bool bClosedPath;
+	double relocationDistance = 0;
+};
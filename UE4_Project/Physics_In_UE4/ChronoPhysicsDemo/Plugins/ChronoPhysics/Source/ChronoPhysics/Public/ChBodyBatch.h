@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+#include <vector>
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+}
+
+/**
+ * Game thread scope that turns the AddBody and RemoveBody calls of the objects into one bulk update of a serial
+ * system's body list. While it is open, AddBody and RemoveBody only queue the body. On close the removals go
+ * out in a single erase-remove pass over the list instead of one linear search and erase per body, then the
+ * list is reserved once for the additions. Collision models are registered in one pass over the batch after
+ * the list is complete. Nested scopes of the same system join the outer one. The parallel
+ * systems keep their own AddBody bookkeeping and get the calls right away
+ */
+class CHRONOPHYSICS_API FChBodyBatch
+{
+public:
+	explicit FChBodyBatch(std::shared_ptr<chrono::ChSystem> phySystem);
+	~FChBodyBatch();
+
+	// Straight to the system when no batch of it is open
+	static void AddBody(std::shared_ptr<chrono::ChSystem> phySystem, std::shared_ptr<chrono::ChBody> body);
+	static void RemoveBody(std::shared_ptr<chrono::ChSystem> phySystem, std::shared_ptr<chrono::ChBody> body);
+
+private:
+	void Flush();
+
+	chrono::ChSystem* system;
+	// False for a scope nested in another one of the same system, and for the parallel systems
+	bool bOwner = false;
+	FChBodyBatch* previous = nullptr;
+	std::vector<std::shared_ptr<chrono::ChBody>> added;
+	std::vector<std::shared_ptr<chrono::ChBody>> removed;
+
+	static FChBodyBatch* current;
+};
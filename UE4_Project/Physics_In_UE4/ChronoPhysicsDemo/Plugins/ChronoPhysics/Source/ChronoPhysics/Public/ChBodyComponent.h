@@ -3,14 +3,24 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "ChPhysicsObjectInterface.h"
+#include "Templates/Function.h"
 #include <memory>
 #include "ChBodyComponent.generated.h"
 
 
 namespace chrono {
 	class ChBody;
+	class ChForce;
+	class ChMaterialSurface;
+	namespace collision {
+		class ChCollisionModel;
+	}
 }
 
+struct FChColliderProxy;
+struct FChShapeTemplate;
+struct FChMaterialValues;
+
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class CHRONOPHYSICS_API UChBodyComponent : public UActorComponent, public IChPhysicsObjectInterface
@@ -22,9 +32,19 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|BodyBasicProperty")
 	bool isFixed = false;
 
+	// Follows the owner's transform, an animated robot arm or gantry, with a mass no contact can move, see FChKinematicBody.
+	// Each substep the pose moves on between the last two frames and the velocity is the motion's, for the contacts
 	UPROPERTY(EditAnywhere, Category = "Chrono|BodyBasicProperty")
+	bool bKinematic = false;
+
+	// Set by the scene manager from its system backend
+	UPROPERTY(VisibleInstanceOnly, Category = "Chrono|BodyBasicProperty")
 	bool isForParallel = false;
 
+	// Set by the scene manager from its system backend
+	UPROPERTY(VisibleInstanceOnly, Category = "Chrono|BodyBasicProperty")
+	bool isForSMC = false;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|BodyBasicProperty")
 	double Density = 1000;
 
@@ -37,6 +57,15 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|Collision")
 	TArray<int> NoCollisionWithFamiliy;
 
+	// Serial backends: bodies with the same non zero group never collide, whatever their families. For the
+	// parts of one assembly, track chains or cranes, without spending families on them
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (ClampMin = "0"))
+	int CollisionGroup = 0;
+
+	// Serial backends: bodies with identical geometry share one set of Bullet shapes instead of building their own
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision")
+	bool bShareCollisionShape = true;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|DynamicPreset")
 	float MaxSpeed = 1000.0f;
 
@@ -58,6 +87,41 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|DynamicPreset", meta = (editcondition = "bUseDrag"))
 	float DragCoefRot = 0.001f;
 
+	// Serial backends: before each step the body is swept as a sphere along its velocity and moved up to the
+	// first hit it would pass through. For fast small bodies, instead of a low MaxSpeed or more substeps
+	UPROPERTY(EditAnywhere, Category = "Chrono|CCD", meta = (EditConditionToggle))
+	bool bContinuousCollision = false;
+
+	// cm, 0 takes the collider proxy, or half the smallest extent of the root component's bounds
+	UPROPERTY(EditAnywhere, Category = "Chrono|CCD", meta = (editcondition = "bContinuousCollision"))
+	float CCDSweptSphereRadius = 0.f;
+
+	// Swept only when a step moves it further than this fraction of the radius
+	UPROPERTY(EditAnywhere, Category = "Chrono|CCD", meta = (editcondition = "bContinuousCollision"))
+	float CCDMotionThreshold = 0.5f;
+
+	// Only takes effect when the scene manager uses sleeping
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping")
+	bool bAllowSleeping = true;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (EditConditionToggle))
+	bool bOverrideSleepThreshold = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bOverrideSleepThreshold"))
+	float SleepTime = 0.6f;
+
+	// cm/s
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bOverrideSleepThreshold"))
+	float SleepMinSpeed = 10.f;
+
+	// rad/s
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bOverrideSleepThreshold"))
+	float SleepMinAngularSpeed = 0.04f;
+
+	// Takes the place of the parameters below. Bodies with the same parameters share one Chrono material either way
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	class UChPhysicalMaterial* PhysicalMaterial = nullptr;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
 	float StaticFriction = 0.55f;
 
@@ -91,6 +155,12 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
 	float ComplianceSpin = 0.0f;
 
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameterSMC")
+	float YoungModulus = 2e7f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameterSMC")
+	float PoissonRatio = 0.3f;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|ExportData", meta = (EditConditionToggle))
 	bool bExportData = false;
 
@@ -100,6 +170,9 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|ExportData", meta = (editcondition = "bExportData"))
 	bool bExportPos = false;
 
+	UPROPERTY(EditAnywhere, Category = "Chrono|ExportData", meta = (editcondition = "bExportData"))
+	bool bExportRot = false;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|ExportData", meta = (editcondition = "bExportData"))
 	bool bExportVel = false;
 
@@ -115,19 +188,103 @@ public:
 public:	
 	UChBodyComponent();
 
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 	virtual void PhysicsObjectConstruct() override;
 	virtual void PhysicsObjectInitalize() override;
 	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
 	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
 	virtual void UpdateVisualAsset() override;
+	virtual void InterpolateVisualAsset(float alpha) override;
+	virtual void GatherVisualTransforms(TArray<class USceneComponent*>& components, TArray<FTransform>& transforms, float alpha, float tolerance) override;
+	virtual void LatchPhysicsInput() override;
+	virtual void CacheVisualState() override;
+	// Gives the body the shared material of this component's parameters
+	void ApplyMaterialParameter(std::shared_ptr<chrono::ChBody> body, bool bSMC) const;
+	std::shared_ptr<chrono::ChMaterialSurface> GetSharedMaterial(bool bSMC) const;
+	FChMaterialValues GetMaterialValues() const;
 	FORCEINLINE std::shared_ptr<chrono::ChBody> GetChData() { return this->ChData; }
 	virtual bool IsBody() override { return true; }
+	// Shape used against the BVH static meshes, false when the body has none
+	virtual bool GetColliderProxy(FChColliderProxy& outProxy) const { return false; }
+	// Swept sphere radius in Chrono units, 0 when the body doesn't use continuous collision
+	double GetCCDRadius() const;
 	virtual bool& GetIsForParallel() override { return isForParallel; }
+	virtual bool& GetIsForSMC() override { return isForSMC; }
+	virtual void SetSleepingParameter(bool bUseSleeping, float sleepTime, float minSpeed, float minAngularSpeed) override;
+	// The pose of the last cached step, what a replicating server sends
+	FORCEINLINE void GetNetPose(FVector& outLocation, FQuat& outRotation) const { outLocation = cachedLocation; outRotation = cachedRotation; }
+	// Replicated clients: the body is placed instead of stepped, shown as it is on the next visual update
+	void ApplyNetPose(const FVector& location, const FQuat& rotation);
+
+	// Applied before the next step
+	UFUNCTION(BlueprintCallable, Category = "Chrono")
+	void WakeUp() { bWakeRequested = true; }
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	bool IsSleeping() const { return bCachedSleeping; }
 	virtual FExportData ExportData() override;
+	virtual void RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList) override;
+	virtual void WriteTelemetry(FChTelemetry& telemetry) override;
 	virtual bool& GetIsExportData() override { return bExportData; }
 	virtual FName& GetExportDataOwnerName() override { return BodyExportDataOwnerName; }
 
 protected:
 	std::shared_ptr<chrono::ChBody> ChData;
+	// Custom force evaluated inside Chrono, in body coordinates
+	std::shared_ptr<chrono::ChForce> customForceData;
+
+	void ApplyCustomForce();
+	// Gives ChData the shared shapes of the key, built with build by the first body. False when sharing doesn't apply
+	bool InstanceCollisionShape(const FString& key, TFunctionRef<void(chrono::collision::ChCollisionModel& model)> build);
+	// Picks the envelope and margin for shapes spanning size, full size in Chrono units. False when the scene
+	// doesn't tune them, the shapes keep the global defaults then
+	bool SelectCollisionEnvelope(const FVector& size);
+	// Gives a model the picked values, before its shapes are added
+	void ApplyCollisionEnvelope(chrono::collision::ChCollisionModel& model) const;
+
+	// Chrono units, negative while the body uses the global defaults
+	double tunedEnvelope = -1;
+	double tunedMargin = -1;
+
+	// Keeps the shared shapes alive while the body uses them
+	std::shared_ptr<FChShapeTemplate> shapeInstance;
+
+	FVector latchedCustomForce = FVector::ZeroVector;
+	FVector cachedLocation = FVector::ZeroVector;
+	FQuat cachedRotation = FQuat::Identity;
+	FVector previousLocation = FVector::ZeroVector;
+	FQuat previousRotation = FQuat::Identity;
+	bool bCachedSleeping = false;
+	// The resting pose of a sleeping body only has to be written once
+	bool bSleepPoseApplied = false;
+	bool bWakeRequested = false;
+	bool bSceneUseSleeping = false;
+	float sceneSleepTime = 0.6f;
+	float sceneSleepMinSpeed = 10.f;
+	float sceneSleepMinAngularSpeed = 0.04f;
+	FTransform lastSyncedTransform;
+
+	// Kinematic motion of the frame being stepped, from the pose at the latch to the owner's transform
+	FVector kinematicStartLocation = FVector::ZeroVector;
+	FQuat kinematicStartRotation = FQuat::Identity;
+	FVector kinematicTargetLocation = FVector::ZeroVector;
+	FQuat kinematicTargetRotation = FQuat::Identity;
+	double kinematicStartTime = 0;
+	float kinematicDuration = 0.f;
+
+	void ApplyKinematicPose();
+
+	// Telemetry handles, INDEX_NONE when the channel is not exported
+	int32 posChannel = INDEX_NONE;
+	int32 rotChannel = INDEX_NONE;
+	int32 velChannel = INDEX_NONE;
+	int32 acceChannel = INDEX_NONE;
+	int32 angVelChannel = INDEX_NONE;
+	int32 contactForceChannel = INDEX_NONE;
 
 };
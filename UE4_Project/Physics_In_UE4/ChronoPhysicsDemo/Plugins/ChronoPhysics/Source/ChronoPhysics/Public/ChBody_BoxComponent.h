@@ -14,4 +14,9 @@ class CHRONOPHYSICS_API UChBody_BoxComponent : public UChBodyComponent
 	
 public:
 	virtual void PhysicsObjectConstruct() override;
+	virtual bool GetColliderProxy(FChColliderProxy& outProxy) const override;
+
+protected:
+	// Chrono units, zero until constructed
+	FVector halfExtent = FVector::ZeroVector;
 };
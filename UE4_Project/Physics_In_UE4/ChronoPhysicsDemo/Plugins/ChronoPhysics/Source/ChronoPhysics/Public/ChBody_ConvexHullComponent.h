@@ -13,5 +13,26 @@ class CHRONOPHYSICS_API UChBody_ConvexHullComponent : public UChBodyComponent
 	GENERATED_BODY()
 	
 public:
+	// Reuse the hull point sets from Saved/ChronoShapeCache when the mesh, scale and margin match
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|PhysicsParameter")
+		bool bUseShapeCache = true;
+
 	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectBuildGeometry() override;
+
+	// Point sets in component space and UE units, used instead of the static mesh's convex elements. For
+	// fragments made at runtime: the hulls are built with the collision model, mass comes from their volume
+	void SetRuntimePointSets(TArray<TArray<FVector>> pointSets) { runtimePointSets = MoveTemp(pointSets); }
+
+protected:
+	void ConstructRuntimeHulls();
+	void BuildRuntimeHulls();
+
+	TArray<TArray<FVector>> runtimePointSets;
+
+	// Hull points copied on the game thread, already scaled and in Chrono units
+	TArray<TArray<FVector>> hullPointList;
+
+	FString shapeCacheKey;
+	bool bLoadedFromCache = false;
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChBodyComponent.h"
+#include "ChBody_HeightfieldComponent.generated.h"
+
+struct FChHeightfield;
+
+/**
+ * Fixed terrain body colliding as a height grid sampled from the Landscape it is added to, 2 bytes per
+ * sample instead of a triangle mesh. The samples are saved with the component; SampleLandscape takes
+ * them again after the landscape was edited and runs on its own when there are none yet in the editor.
+ * The parallel backends have no heightfield shape, they get the grid as triangles
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class CHRONOPHYSICS_API UChBody_HeightfieldComponent : public UChBodyComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Every Nth landscape vertex along each axis
+	UPROPERTY(EditAnywhere, Category = "Chrono|Heightfield", meta = (ClampMin = "1"))
+	int SampleStride = 1;
+
+	UChBody_HeightfieldComponent();
+
+	UFUNCTION(CallInEditor, Category = "Chrono|Heightfield")
+	void SampleLandscape();
+
+	// Terrain height under a world location from the samples, cell lookup and bilinear blend
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	float GetHeightAt(const FVector& worldLocation) const;
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	FIntPoint GetGridSize() const { return GridSize; }
+
+	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectBuildGeometry() override;
+
+protected:
+	// Landscape heights minus the 32768 midpoint, GridSize.X columns along local X by GridSize.Y rows
+	UPROPERTY()
+	TArray<int16> HeightData;
+
+	UPROPERTY()
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	// Owner space, cm: position of sample (0, 0) at height 0
+	UPROPERTY()
+	FVector GridOrigin = FVector::ZeroVector;
+
+	// Owner space, cm: sample distance along X and Y, and height per unit in Z
+	UPROPERTY()
+	FVector GridSpacing = FVector::OneVector;
+
+	std::shared_ptr<FChHeightfield> heightfield;
+
+	void AddGridTriangles();
+};
@@ -14,4 +14,9 @@ class CHRONOPHYSICS_API UChBody_SphereComponent : public UChBodyComponent
 	
 public:
 	virtual void PhysicsObjectConstruct() override;
+	virtual bool GetColliderProxy(FChColliderProxy& outProxy) const override;
+
+protected:
+	// Chrono units, zero until constructed
+	float radius = 0.f;
 };
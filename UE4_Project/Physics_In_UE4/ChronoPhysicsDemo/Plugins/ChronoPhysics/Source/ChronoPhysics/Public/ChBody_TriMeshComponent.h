@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "ChBodyComponent.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "PhysicsEngine/AggregateGeom.h"
 #include "ChBody_TriMeshComponent.generated.h"
 
 namespace chrono {
@@ -12,14 +14,118 @@ namespace chrono {
 	}
 }
 
+class FChStaticMeshBVH;
+
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class CHRONOPHYSICS_API UChBody_TriMeshComponent : public UChBodyComponent
 {
 	GENERATED_BODY()
 	
 public:
+	// Reuse the converted collision mesh from Saved/ChronoShapeCache when the mesh, scale and margin match
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|PhysicsParameter")
+		bool bUseShapeCache = true;
+
+	// Dynamic bodies collide as the convex hulls of an HACD decomposition instead of the triangle mesh.
+	// Decomposed on the geometry build task the first time and kept in the shape cache; fixed bodies keep the mesh
+	UPROPERTY(EditAnywhere, Category = "Chrono|ConvexDecomposition", meta = (EditConditionToggle))
+		bool bUseConvexDecomposition = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ConvexDecomposition", meta = (editcondition = "bUseConvexDecomposition"))
+		int MaxHullCount = 32;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ConvexDecomposition", meta = (editcondition = "bUseConvexDecomposition"))
+		int MaxHullVertices = 32;
+
+	// Lower keeps more detail and gives more hulls
+	UPROPERTY(EditAnywhere, Category = "Chrono|ConvexDecomposition", meta = (editcondition = "bUseConvexDecomposition"))
+		float Concavity = 0.2f;
+
+	// Fixed bodies on serial backends: boxes and spheres collide with the mesh through a quantized BVH instead of
+	// Bullet's trimesh pairs. Every other shape still collides with the Bullet trimesh
+	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsParameter")
+		bool bUseStaticMeshCollider = false;
+
+	// Collide with the mesh's simple collision instead of the triangle mesh while far from every view. Serial backends only
+	UPROPERTY(EditAnywhere, Category = "Chrono|CollisionLOD", meta = (EditConditionToggle))
+		bool bUseCollisionLOD = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|CollisionLOD", meta = (editcondition = "bUseCollisionLOD"))
+		float CollisionLODDistance = 3000.f;
+
+	// Fraction of the distance a view has to come closer before the triangle mesh returns
+	UPROPERTY(EditAnywhere, Category = "Chrono|CollisionLOD", meta = (editcondition = "bUseCollisionLOD"))
+		float CollisionLODHysteresis = 0.1f;
+
+	// Serial backends: SetDeformedVertices moves the collision mesh in place and only refits its BVH, the body
+	// keeps its Bullet object. Moving bodies collide through a GImpact mesh like other moving trimeshes, fixed ones
+	// through a BVH mesh. Not with convex decomposition or the static mesh collider
+	UPROPERTY(EditAnywhere, Category = "Chrono|DeformableMesh", meta = (EditConditionToggle))
+		bool bDeformable = false;
+
+	// cm past the rest bounds the vertices may move before the tree is quantized again. Fixed bodies only, GImpact
+	// always pads by a metre
+	UPROPERTY(EditAnywhere, Category = "Chrono|DeformableMesh", meta = (editcondition = "bDeformable", ClampMin = "0"))
+		float DeformationMargin = 50.f;
+
+	// Growth of the summed node area since the last build that rebuilds the tree instead of refitting it
+	UPROPERTY(EditAnywhere, Category = "Chrono|DeformableMesh", meta = (editcondition = "bDeformable", ClampMin = "1"))
+		float RebuildThreshold = 2.f;
+
 	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectBuildGeometry() override;
+	virtual void PhysicsObjectInitalize() override;
+	virtual void LatchPhysicsInput() override;
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	bool IsUsingCollisionProxy() const { return bUsingCollisionProxy; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetConvexHullCount() const { return hullPointList.Num(); }
+
+	// Component space, same count and order as the static mesh's collision vertices. Applied before the next step
+	UFUNCTION(BlueprintCallable, Category = "Chrono")
+	void SetDeformedVertices(const TArray<FVector>& Vertices);
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetTreeRebuildCount() const;
+
+	// Built with the geometry, null unless the static mesh collider applies
+	FORCEINLINE std::shared_ptr<FChStaticMeshBVH> GetStaticBVH() const { return staticBVH; }
 
 protected:
 	std::shared_ptr<chrono::geometry::ChTriangleMeshConnected> triMesh;
+
+	// Taken from the static mesh on the game thread, converted to Chrono units on the build task
+	TArray<FVector> meshVertices;
+	TArray<FTriIndices> meshIndices;
+	FVector meshScale;
+
+	FString shapeCacheKey;
+	bool bLoadedFromCache = false;
+
+	// Chrono units, already scaled; empty when the body collides as the triangle mesh
+	TArray<TArray<FVector>> hullPointList;
+	FString hullCacheKey;
+	bool bHullsFromCache = false;
+	// Decomposed on the build task, written to the cache back on the game thread
+	bool bHullsToSave = false;
+
+	bool ShouldDecompose() const { return bUseConvexDecomposition && !isFixed; }
+	bool IsDeformable() const { return bDeformable && !isForParallel && !ShouldDecompose(); }
+	void DecomposeMesh();
+
+	std::shared_ptr<FChStaticMeshBVH> staticBVH;
+
+	void BuildCollisionModel(bool bProxy);
+	void AddCollisionProxy();
+
+	// Simple collision of the static mesh, copied on the game thread for the proxy model
+	FKAggregateGeom proxyGeom;
+	FBox proxyBounds;
+	bool bUsingCollisionProxy = false;
+
+	// Set on the game thread, refit into the model when the input is latched
+	TArray<FVector> deformedVertices;
+	bool bDeformPending = false;
 };
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+
+namespace chrono {
+	class ChLink;
+}
+
+/**
+ * Break thresholds of links, checked after every step in one pass. The reactions of all links are gathered
+ * into flat arrays first, then compared against the squared thresholds in a loop of their own. A link over
+ * either threshold is set broken, which disables its constraints where it is, the system's link list is
+ * left as it is, and goes into the batch of breaks until DrainBreaks. Slots stay put when links are removed
+ */
+class CHRONOPHYSICS_API FChBreakableLinks
+{
+public:
+	struct FBreak
+	{
+		int32 Slot;
+		double Time;
+		// Chrono units on Unreal axes, like the exported reactions, in the link frame
+		FVector Force;
+		FVector Torque;
+	};
+
+	// Chrono units, a threshold of 0 or less never breaks. Returns the slot, reused after Remove
+	int32 Add(std::shared_ptr<chrono::ChLink> link, double breakForce, double breakTorque);
+	void Remove(int32 slot);
+	FORCEINLINE int32 GetLinkNum() const { return linkNum; }
+
+	// After the step, on the thread that steps. Returns the links broken by it
+	int32 Check(double time);
+
+	// Breaks since the last drain, oldest first
+	void DrainBreaks(TArray<FBreak>& outBreaks);
+
+private:
+	TArray<std::shared_ptr<chrono::ChLink>> links;
+	// Squared, FLT_MAX for no threshold and for free slots
+	TArray<float> forceLimits;
+	TArray<float> torqueLimits;
+	TArray<float> forces;
+	TArray<float> torques;
+	TArray<int32> freeSlots;
+	TArray<FBreak> breaks;
+	int32 linkNum = 0;
+};
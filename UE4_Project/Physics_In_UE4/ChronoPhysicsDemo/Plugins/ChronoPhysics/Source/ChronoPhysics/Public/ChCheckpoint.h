@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+namespace chrono {
+	class ChSystem;
+}
+
+// Body record of a checkpoint, written as is
+struct FChCheckpointBody
+{
+	double Position[3];
+	double Rotation[4];
+	double Velocity[3];
+	// Body frame, like ChBody
+	double AngularVelocity[3];
+	// Into the class name table
+	uint32 ClassIndex;
+	// EChCheckpointBodyFlags
+	uint32 Flags;
+};
+
+namespace EChCheckpointBodyFlags {
+	enum Type : uint32 {
+		Fixed = 1 << 0,
+		Sleeping = 1 << 1,
+		Collide = 1 << 2
+	};
+}
+
+/**
+ * Whole system state as one binary file: a header, then the class names of the bodies once, the body
+ * records and the state, velocity, acceleration and reaction vectors as contiguous blocks. Capture only
+ * copies on the calling thread, compression and the write run on the thread pool. Load maps the file
+ * and an uncompressed checkpoint is applied straight from the mapping
+ */
+class CHRONOPHYSICS_API FChCheckpoint
+{
+public:
+	~FChCheckpoint();
+
+	void Capture(chrono::ChSystem* system);
+	// The captured payload goes with the task, Capture can run again right away. LZ4 when the engine has it, zlib otherwise
+	TFuture<bool> SaveAsync(const FString& filePath, bool bCompress);
+
+	bool Load(const FString& filePath);
+	// Fails if the system's bodies, their classes or its state sizes differ from the checkpoint
+	bool Apply(chrono::ChSystem* system) const;
+	void Close();
+
+	FORCEINLINE double GetTime() const { return time; }
+	FORCEINLINE int32 GetBodyNum() const { return bodyCount; }
+
+private:
+	// Points the blocks below into data, checks every block fits
+	bool ParsePayload(const uint8* data, int64 size);
+
+	// Captured or decompressed, empty when an uncompressed file is read from the mapping
+	TArray<uint8> payload;
+	double time = 0;
+
+	class IMappedFileHandle* mappedFile = nullptr;
+	class IMappedFileRegion* mappedRegion = nullptr;
+	int32 ncoordsX = 0;
+	int32 ncoordsV = 0;
+	int32 nconstr = 0;
+	int32 bodyCount = 0;
+	TArray<FString> classNames;
+	const FChCheckpointBody* bodies = nullptr;
+	const double* x = nullptr;
+	const double* v = nullptr;
+	const double* a = nullptr;
+	const double* L = nullptr;
+};
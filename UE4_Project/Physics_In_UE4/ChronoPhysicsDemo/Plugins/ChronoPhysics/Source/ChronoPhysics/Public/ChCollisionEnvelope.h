@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Scene wide settings of the per body envelope selection, Chrono units
+struct FChEnvelopeTuning
+{
+	bool bEnabled = false;
+	// Envelope as a fraction of the smallest AABB dimension
+	float SizeFraction = 0.05f;
+	// Inward Bullet margin as a fraction of the smallest AABB dimension
+	float MarginFraction = 0.02f;
+	float MinEnvelope = 0.0005f;
+	// The body's speed limit counts up to this, m/s
+	float SpeedLimit = 5.f;
+	// Seconds, one step of the system
+	float StepLength = 0.004f;
+};
+
+/**
+ * Per body collision envelope and margin, picked from the size of the body's shapes and how far it can move in
+ * one step instead of one global default for pebbles and boulders alike. A small body keeps a small envelope, so
+ * it doesn't report contacts with everything around it, a large or fast one gets enough to find its contacts
+ * before it penetrates. Bullet adds the envelope into the shape when it is created, so the values have to be on
+ * the model before its shapes go in. The serial backends only, the parallel one has a single envelope
+ */
+class CHRONOPHYSICS_API FChCollisionEnvelope
+{
+public:
+	// Set by the scene manager before the bodies are built, also resets the counters
+	static void SetTuning(const FChEnvelopeTuning& tuning);
+	static bool IsEnabled();
+
+	// Envelope and margin for a body whose shapes span size, full size in Chrono units. False when tuning is off
+	static bool Select(const FVector& size, float maxSpeed, double& outEnvelope, double& outMargin);
+
+	// Bodies tuned since SetTuning and their mean envelope, Chrono units
+	static int32 GetTunedNum();
+	static double GetMeanEnvelope();
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+
+namespace chrono {
+	class ChSystem;
+}
+
+/**
+ * Bullet overlap filter that keeps the family test of the pair cache and adds collision groups: bodies
+ * with the same non zero group never become a pair. Runs where the broadphase emits pairs, so a group's
+ * bodies cost no manifold or narrowphase work. The group is the body's Chrono identifier
+ */
+class CHRONOPHYSICS_API FChCollisionGroupFilter : public btOverlapFilterCallback
+{
+public:
+	virtual bool needBroadphaseCollision(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1) const override;
+
+	// Serial backends. The pair cache holds the filter as a plain pointer, it has to outlive the system
+	bool Install(chrono::ChSystem* system);
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace chrono {
+	class ChSystem;
+	class ChPhysicsItem;
+}
+
+/**
+ * Contacts of the last step in flat arrays, refilled in place so the
+ * allocations are reused once the contact count has settled
+ */
+class CHRONOPHYSICS_API FChContactBuffer
+{
+public:
+	void Refill(chrono::ChSystem* system);
+	void Empty();
+
+	FORCEINLINE int32 Num() const { return Positions.Num(); }
+
+	// Forces are the ones acting on the queried item, in world space (N)
+	int32 QueryItem(const chrono::ChPhysicsItem* item, TArray<FVector>& outPositions, TArray<FVector>& outNormals, TArray<FVector>& outForces) const;
+	int32 QueryFamily(int family, TArray<FVector>& outPositions, TArray<FVector>& outNormals, TArray<FVector>& outForces) const;
+	FVector SumItemForce(const chrono::ChPhysicsItem* item) const;
+
+	// Unreal units, normal points from A to B, force acts on B
+	TArray<FVector> Positions;
+	TArray<FVector> Normals;
+	TArray<FVector> Forces;
+	TArray<chrono::ChPhysicsItem*> ItemsA;
+	TArray<chrono::ChPhysicsItem*> ItemsB;
+};
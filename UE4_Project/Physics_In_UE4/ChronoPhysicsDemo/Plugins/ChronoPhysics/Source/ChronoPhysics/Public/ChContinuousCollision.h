@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+}
+
+class FChStaticColliderSet;
+
+/**
+ * Conservative advancement for the bodies added to it. Before a step each one that would move further than
+ * its threshold is swept as a sphere along its velocity through the Bullet world; on a hit it is moved up
+ * to just short of the contact with its velocity kept, so the step's own collision pass finds the contact
+ * and resolves it with the full impact speed. The static collider meshes sit outside the proxies' Bullet
+ * families, so they are swept separately. Everything else steps as before
+ */
+class CHRONOPHYSICS_API FChContinuousCollision
+{
+public:
+	// Chrono units; the sweep only runs when a step covers more than motionThreshold * radius
+	void Add(std::shared_ptr<chrono::ChBody> body, double radius, double motionThreshold);
+	void Remove(chrono::ChBody* body);
+	bool Contains(chrono::ChBody* body) const;
+
+	// Returns the number of bodies that were moved to a hit. Serial systems only, needs the Bullet collision system
+	int32 Advance(chrono::ChSystem* system, double stepSize);
+
+	// Meshes the bodies are also swept against, may be null
+	FORCEINLINE void SetStaticColliders(const FChStaticColliderSet* inStaticColliders) { staticColliders = inStaticColliders; }
+
+	FORCEINLINE int32 GetBodyNum() const { return bodies.Num(); }
+
+private:
+	struct FSweptBody
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		double Radius;
+		double MotionThreshold;
+	};
+
+	TArray<FSweptBody> bodies;
+	const FChStaticColliderSet* staticColliders = nullptr;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Hull of one point set, in the units of its points
+struct CHRONOPHYSICS_API FChConvexHull
+{
+	// Hull vertices only, interior and coplanar input points are dropped
+	TArray<FVector> Points;
+	// Three indices into Points per outward facing triangle
+	TArray<int32> Triangles;
+	float Volume = 0;
+	FVector Centroid = FVector::ZeroVector;
+	// False for fewer than four points or flat and collinear sets, Points is then the input as it was
+	bool bValid = false;
+};
+
+/**
+ * 3D quickhull for point sets made at runtime, destructible fragments and the like, where no convex element
+ * was cooked. The faces, outside sets and horizon live in a scratch arena per thread that keeps its memory
+ * from hull to hull, so a thread only allocates for the results once it has built its largest hull.
+ * BuildHulls spreads many sets over the task graph, BuildHull is safe to call from inside parallel loops
+ */
+class CHRONOPHYSICS_API FChConvexHullBuilder
+{
+public:
+	static bool BuildHull(TArrayView<const FVector> points, FChConvexHull& outHull);
+	static void BuildHulls(TArrayView<const TArray<FVector>> pointSets, TArray<FChConvexHull>& outHulls);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/fea/ChElementTetra_4.h"
+#include "chrono/fea/ChMesh.h"
+
+// Linear tetrahedron whose corotational frame an FChCorotationalMesh updates in bulk with all the others
+class CHRONOPHYSICS_API FChElementTetra4Batched : public chrono::fea::ChElementTetra_4
+{
+public:
+	// Only the mesh's batch is skipped, on its own the element decomposes as usual
+	virtual void UpdateRotation() override
+	{
+		if (!bBatched) {
+			ChElementTetra_4::UpdateRotation();
+		}
+	}
+
+	// Gradient of the current positions over the reference ones, column major
+	void ComputeDeformationGradient(double* outF) const;
+
+private:
+	friend class FChCorotationalMesh;
+
+	bool bBatched = false;
+};
+
+/**
+ * ChMesh that extracts the rotations of its FChElementTetra4Batched elements all at once before their
+ * Update. The deformation gradients are gathered into one flat array, the rotations come out of
+ * ComputeRotations in chunks across worker threads and are written back, and the elements then skip their
+ * own per element ChPolarDecomposition. Other elements update as before
+ */
+class CHRONOPHYSICS_API FChCorotationalMesh : public chrono::fea::ChMesh
+{
+public:
+	virtual FChCorotationalMesh* Clone() const override { return new FChCorotationalMesh(*this); }
+
+	virtual void SetupInitial() override;
+	virtual void Update(double m_time, bool update_assets = true) override;
+
+	/**
+	 * Rotation of the polar decomposition of each 3x3 matrix, 9 column major doubles per matrix. With the
+	 * CUDA toolkit the float SVD of chrono_parallel/math/svd.h is used, its rotation U V' is proper even for
+	 * inverted elements and is orthonormalized again in double; otherwise ChPolarDecomposition in double,
+	 * flipped like ChElementTetra_4 does. outValid is false for matrices too degenerate for the SVD, their
+	 * rotation is left untouched
+	 */
+	static void ComputeRotations(const double* F, double* outR, bool* outValid, int32 num);
+
+	FORCEINLINE int32 GetBatchedElementNum() const { return batched.Num(); }
+
+private:
+	void GatherBatchedElements();
+
+	TArray<FChElementTetra4Batched*> batched;
+	int32 gatheredElementNum = INDEX_NONE;
+	TArray<double> gradients;
+	TArray<double> rotations;
+	TArray<bool> valid;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+
+// One wheel per record, Chrono units and axes so a Chrono terrain node can use them as they are
+struct FChCosimWheelState
+{
+	double Time;
+	int32 Index;
+	int32 Frame;
+	double Pos[3];
+	double Rot[4];
+	double LinVel[3];
+	double AngVel[3];
+};
+
+struct FChCosimWheelForce
+{
+	double Time;
+	int32 Index;
+	int32 Frame;
+	double Force[3];
+	double Torque[3];
+};
+
+/**
+ * Single producer, single consumer ring of fixed size records in named shared memory.
+ * Each side of a co-simulation opens the same name, one ring per direction
+ */
+class CHRONOPHYSICS_API FChCosimChannel
+{
+public:
+	~FChCosimChannel() { Close(); }
+
+	// The creating side sizes the ring, the other side adopts the size from the header
+	bool Open(const FString& name, bool bCreate, int32 recordBytes, int32 recordCapacity);
+	void Close();
+
+	// Both return false instead of blocking when the ring is full or empty
+	bool Push(const void* record);
+	bool Pop(void* record);
+
+	FORCEINLINE bool IsOpen() const { return header != nullptr; }
+	FORCEINLINE int32 GetRecordBytes() const { return header ? header->RecordBytes : 0; }
+
+private:
+	struct FRingHeader
+	{
+		uint32 Magic;
+		int32 RecordBytes;
+		int32 RecordCapacity;
+		int32 Pad;
+		// Wrapping counters, the record slot is the counter modulo the capacity
+		volatile int32 WriteIndex;
+		volatile int32 ReadIndex;
+	};
+
+	FPlatformMemory::FSharedMemoryRegion* region = nullptr;
+	FRingHeader* header = nullptr;
+	uint8* records = nullptr;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ChPhysicsObjectInterface.h"
+#include "ChCosimChannel.h"
+#include "ChCosimTerrainActor.generated.h"
+
+namespace chrono {
+	class ChBody;
+	class ChForce;
+}
+
+/**
+ * Terrain side of a vehicle co-simulation. Every substep the wheel states go out
+ * through <SharedMemoryName>_State and the terrain forces come back through
+ * <SharedMemoryName>_Force, both in Chrono units and axes. The terrain itself
+ * runs in a separate process, which opens the same two rings
+ */
+UCLASS()
+class CHRONOPHYSICS_API AChCosimTerrainActor : public AActor, public IChPhysicsObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|Cosim")
+	FString SharedMemoryName = TEXT("ChronoCosim");
+
+	// Actors with a Chrono body component, the record index is the position in this list
+	UPROPERTY(EditAnywhere, Category = "Chrono|Cosim")
+	TArray<AActor*> WheelActors;
+
+	// Create the rings here, otherwise attach to the ones the terrain process created
+	UPROPERTY(EditAnywhere, Category = "Chrono|Cosim")
+	bool bCreateChannels = true;
+
+	// Records per ring, rounded up to a power of two
+	UPROPERTY(EditAnywhere, Category = "Chrono|Cosim")
+	int RingCapacity = 1024;
+
+	// Wait each substep for this substep's forces, otherwise apply the newest forces available
+	UPROPERTY(EditAnywhere, Category = "Chrono|Cosim", meta = (EditConditionToggle))
+	bool bLockstep = true;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Cosim", meta = (editcondition = "bLockstep"))
+	float LockstepTimeoutMs = 5.f;
+
+	AChCosimTerrainActor();
+
+	virtual void PostRegisterAllComponents() override;
+	virtual void PostUnregisterAllComponents() override;
+	virtual void PhysicsObjectConstruct() override {}
+	virtual void PhysicsObjectInitalize() override;
+	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override {}
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
+	virtual void UpdateVisualAsset() override {}
+
+	// Substeps between the newest state sent and the newest forces received
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetTerrainLag() const { return frame - lastForceFrame; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	bool IsConnected() const { return stateChannel.IsValid() && forceChannel.IsValid(); }
+
+protected:
+	void SendWheelStates();
+	void ReceiveWheelForces();
+	void RemoveTerrainForces();
+
+	TUniquePtr<FChCosimChannel> stateChannel;
+	TUniquePtr<FChCosimChannel> forceChannel;
+	TArray<std::shared_ptr<chrono::ChBody>> wheelBodies;
+	// Last forces per wheel, applied again when the terrain falls behind
+	TArray<FChCosimWheelForce> wheelForces;
+	// Force then torque per wheel, null for the missing wheels; the accumulators belong to UChBodyComponent's drag
+	TArray<std::shared_ptr<chrono::ChForce>> terrainForces;
+	int32 frame = 0;
+	int32 lastForceFrame = 0;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include <memory>
+#include <vector>
+
+class btTriangleIndexVertexArray;
+class btGImpactMeshShape;
+class FChRefitTriangleMeshShape;
+class FChRefitOptimizedBvh;
+
+/**
+ * Bullet collision model with one triangle mesh whose vertices move in place. Refit copies the new positions
+ * into the vertex array Bullet reads and refits the quantized BVH bottom up, the leaves in parallel and then
+ * the inner nodes level by level, each level in parallel, so a deforming mesh never goes through
+ * ClearModel/AddTriangleMesh/BuildModel or leaves the collision system. The tree is only rebuilt, still in
+ * place, when a vertex leaves the quantization bounds or the summed node area grows past the rebuild threshold.
+ * Bullet has no algorithm between two BVH triangle mesh shapes, so that shape is only used for fixed bodies; a
+ * moving one gets a GImpact mesh over the same arrays, as AddTriangleMesh gives moving meshes, and Refit refits
+ * GImpact's own quantized tree instead. Vertex count and faces are fixed, a new topology needs the usual
+ * ClearModel/BuildModel pair
+ */
+class CHRONOPHYSICS_API FChDeformableMeshModel : public chrono::collision::ChModelBullet
+{
+public:
+	FChDeformableMeshModel();
+	virtual ~FChDeformableMeshModel();
+
+	virtual int ClearModel() override;
+
+	// Only shape of the model, between ClearModel and BuildModel. growth is how far, in Chrono units, the
+	// vertices may move past the starting bounds before the quantization has to be redone. GImpact pads its
+	// quantization by a fixed unit instead, growth is only used for static meshes
+	bool AddDeformableMesh(const std::vector<chrono::ChVector<>>& vertices, const std::vector<chrono::ChVector<int>>& faces, double growth, bool bStatic);
+
+	// Body frame, same count and order as added. Returns false when the count doesn't match
+	bool Refit(const std::vector<chrono::ChVector<>>& vertices);
+
+	// Summed inner node area over the area right after a build that triggers a rebuild
+	FORCEINLINE void SetRebuildThreshold(float threshold) { rebuildThreshold = FMath::Max(threshold, 1.f); }
+	FORCEINLINE int32 GetVertexNum() const { return vertexData.Num() / 3; }
+	FORCEINLINE int32 GetRefitCount() const { return refitCount; }
+	FORCEINLINE int32 GetRebuildCount() const { return rebuildCount; }
+
+private:
+	void RebuildTree();
+	// bRebuild quantizes the GImpact trees again, otherwise they are only refit
+	void UpdateGImpact(bool bRebuild);
+
+	// What Bullet reads, three btScalars per vertex and three indices per face
+	TArray<double> vertexData;
+	TArray<int32> indexData;
+	TUniquePtr<btTriangleIndexVertexArray> meshInterface;
+	TUniquePtr<FChRefitOptimizedBvh> tree;
+	std::shared_ptr<FChRefitTriangleMeshShape> shape;
+	std::shared_ptr<btGImpactMeshShape> gimpactShape;
+	// Vertex bounds the GImpact trees were quantized for
+	btVector3 gimpactMin;
+	btVector3 gimpactMax;
+
+	double growth = 0;
+	float rebuildThreshold = 2.f;
+	// Summed node area of the last build
+	double builtCost = 0;
+	int32 refitCount = 0;
+	int32 rebuildCount = 0;
+};
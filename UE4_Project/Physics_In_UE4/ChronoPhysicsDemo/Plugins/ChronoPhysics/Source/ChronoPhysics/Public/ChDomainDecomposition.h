@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include <memory>
+#include <vector>
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+}
+class btCollisionShape;
+
+/**
+ * Free bodies split over several serial Chrono systems by slabs along one axis, all stepped at the same time.
+ * Domain 0 is the scene's own system and keeps everything that can't move between systems: links and their
+ * bodies, excluded bodies, particles and custom items. Each step a body whose AABB gets within the ghost width
+ * of a neighbor slab is copied into that domain as a ghost with its mass and velocity; both domains resolve the
+ * contact and each keeps the result of its own bodies, the ghost is overwritten on the next step. A body whose
+ * center crosses a boundary migrates into the other system. Fixed bodies and the bodies kept in domain 0 are
+ * mirrored into every other domain as fixed bodies following their source, they push the free bodies there but
+ * only feel the free bodies of domain 0. Mirrors of kinematic bodies are kinematic too, so they carry what rests on
+ * them in every domain. Boundaries are quantiles of the free bodies along the axis at setup,
+ * so the domains start with about the same number of bodies. The domains step in parallel, so every domain but
+ * main collides its bodies and ghosts with its own copies of the shapes that change while they collide
+ */
+class CHRONOPHYSICS_API FChDomainDecomposition
+{
+public:
+	static constexpr int32 MaxDomains = 16;
+
+	// Axis in Chrono coordinates, ghost width in Chrono units. Factory makes a system configured like main
+	void Setup(std::shared_ptr<chrono::ChSystem> main, int32 domainNum, int32 axis, double ghostWidth,
+		TFunctionRef<std::shared_ptr<chrono::ChSystem>()> factory, const TSet<chrono::ChBody*>& excluded);
+	// Deals the free bodies main got since the last call to their domains, mirrors the new fixed ones
+	void Refresh(const TSet<chrono::ChBody*>& excluded);
+	// Back into main, before the body is removed from the system
+	void Reclaim(chrono::ChBody* body);
+	// Everything back into main
+	void Reset();
+
+	void Step(double stepSize);
+
+	FORCEINLINE const std::vector<std::shared_ptr<chrono::ChSystem>>& GetSystems() const { return systems; }
+	FORCEINLINE int32 GetDomainNum() const { return (int32)systems.size(); }
+	FORCEINLINE int32 GetGhostNum() const { return ghostNum; }
+	FORCEINLINE int32 GetLastMigrationNum() const { return lastMigrationNum; }
+
+private:
+	struct FGhost
+	{
+		int32 Domain;
+		std::shared_ptr<chrono::ChBody> Body;
+	};
+
+	struct FOwned
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		int32 Domain;
+		TArray<FGhost, TInlineAllocator<2>> Ghosts;
+	};
+
+	// A body of main copied as a fixed body into every other domain
+	struct FMirror
+	{
+		std::shared_ptr<chrono::ChBody> Source;
+		TArray<std::shared_ptr<chrono::ChBody>> Clones;
+	};
+
+	void Deal(const std::shared_ptr<chrono::ChBody>& body, const TSet<chrono::ChBody*>& excluded, const TSet<chrono::ChBody*>& linked);
+	void Migrate();
+	void UpdateGhosts();
+	void SyncMirrors();
+	int32 FindDomain(double coordinate) const;
+	std::shared_ptr<chrono::ChBody> Clone(chrono::ChBody& source, bool bFixed, int32 domain);
+	btCollisionShape* DomainShape(btCollisionShape* shape, int32 domain);
+	// Puts the domain's copies of the shapes, or the originals in main, into the body's Bullet object
+	void AssignShapes(chrono::ChBody& body, int32 domain);
+	void RemoveGhosts(FOwned& owned);
+
+	std::vector<std::shared_ptr<chrono::ChSystem>> systems;
+	// Interior boundaries in increasing order, domain i is between boundaries[i - 1] and boundaries[i]
+	TArray<double> boundaries;
+	int32 axis = 0;
+	double ghostWidth = 0;
+
+	TArray<FOwned> owned;
+	TMap<chrono::ChBody*, int32> ownedIndices;
+	TArray<FMirror> mirrors;
+	// Every main body already looked at, dealt or not, so Refresh only sees new ones
+	TSet<chrono::ChBody*> known;
+	// Copies by original shape and domain, and the original of each copy
+	TMap<TPair<btCollisionShape*, int32>, std::shared_ptr<btCollisionShape>> domainShapes;
+	TMap<btCollisionShape*, btCollisionShape*> shapeSources;
+	int32 ghostNum = 0;
+	int32 lastMigrationNum = 0;
+};
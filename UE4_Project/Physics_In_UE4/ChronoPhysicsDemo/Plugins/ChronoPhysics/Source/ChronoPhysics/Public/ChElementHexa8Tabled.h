@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChShapeFunctionTable.h"
+#include "chrono/fea/ChElementGeneric.h"
+#include "chrono/fea/ChNodeFEAxyz.h"
+#include "chrono/physics/ChContinuumMaterial.h"
+
+/**
+ * Eight node brick with Green-Lagrange strain and a St. Venant-Kirchhoff material, the continuum of
+ * ChElementBrick without its enhanced strains. The shape functions come from one shared table and the
+ * reference derivatives, quadrature weights and mass matrix are kept per element from SetupInitial, so
+ * internal forces and the tangent are fixed size contractions over 8 nodes and 8 points with nothing
+ * evaluated again. Damping is stiffness proportional on the strain rate, like Chrono's SetAlphaDamp
+ */
+class CHRONOPHYSICS_API FChElementHexa8Tabled : public chrono::fea::ChElementGeneric
+{
+public:
+	static constexpr int32 NodeNum = FChHexa8ShapeTable::Nodes;
+	static constexpr int32 PointNum = FChHexa8ShapeTable::Points;
+	static constexpr int32 DofNum = NodeNum * 3;
+
+	void SetNodes(const std::shared_ptr<chrono::fea::ChNodeFEAxyz> (&inNodes)[NodeNum]);
+	void SetMaterial(std::shared_ptr<chrono::fea::ChContinuumElastic> inMaterial) { material = inMaterial; }
+	void SetAlphaDamp(double alpha) { alphaDamp = alpha; }
+
+	virtual int GetNnodes() override { return NodeNum; }
+	virtual int GetNdofs() override { return DofNum; }
+	virtual int GetNodeNdofs(int n) override { return 3; }
+	virtual std::shared_ptr<chrono::fea::ChNodeFEAbase> GetNodeN(int n) override { return nodes[n]; }
+
+	virtual void GetStateBlock(chrono::ChMatrixDynamic<>& mD) override;
+	virtual void SetupInitial(chrono::ChSystem* system) override;
+	virtual void ComputeNodalMass() override;
+	virtual void ComputeKRMmatricesGlobal(chrono::ChMatrix<>& H, double Kfactor, double Rfactor = 0, double Mfactor = 0) override;
+	virtual void ComputeInternalForces(chrono::ChMatrixDynamic<>& Fi) override;
+
+	double GetVolume() const { return volume; }
+
+private:
+	// Deformation gradient and its rate at a point
+	void ComputeGradients(int32 point, double (&F)[3][3], double (&Fdot)[3][3]) const;
+	void ComputeStress(const double (&E)[3][3], double (&S)[3][3]) const;
+
+	std::shared_ptr<chrono::fea::ChNodeFEAxyz> nodes[NodeNum];
+	std::shared_ptr<chrono::fea::ChContinuumElastic> material;
+	double alphaDamp = 0;
+
+	// d N / d X in the reference configuration and det(J0) times the weight, per point
+	double dNdX[PointNum][NodeNum][3];
+	double pointVolume[PointNum];
+	// Consistent, the same for all three directions
+	double mass[NodeNum][NodeNum];
+	double volume = 0;
+};
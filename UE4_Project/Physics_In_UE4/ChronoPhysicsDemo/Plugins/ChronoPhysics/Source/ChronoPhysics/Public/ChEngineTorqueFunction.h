@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/motion_functions/ChFunction_Base.h"
+#include <vector>
+
+namespace chrono {
+	class ChLinkEngine;
+}
+
+/**
+ * Torque function of a ChLinkEngine that looks its torque up from the engine's own angular speed.
+ * The curve is a uniform table over speed, indexed without a search, and Chrono calls it whenever it
+ * updates the link's forces, so the torque follows the speed inside a step instead of once per substep
+ */
+class CHRONOPHYSICS_API FChEngineTorqueFunction : public chrono::ChFunction
+{
+public:
+	// The engine owns this function, it is kept as a plain pointer
+	explicit FChEngineTorqueFunction(const chrono::ChLinkEngine* inEngine) : engine(inEngine) {}
+
+	virtual FChEngineTorqueFunction* Clone() const override { return new FChEngineTorqueFunction(*this); }
+
+	// Time is ignored, torque is throttle * scale * curve(|speed|)
+	virtual double Get_y(double x) const override;
+
+	// Samples spread evenly over [minSpeed, maxSpeed], lookups outside clamp to the ends
+	void SetTable(std::vector<double>&& samples, double minSpeed, double maxSpeed);
+	void SetThrottle(double inThrottle) { throttle = inThrottle; }
+	void SetScale(double inScale) { scale = inScale; }
+
+	// The curve in the table at a speed, without throttle and scale
+	double Lookup(double speed) const;
+
+private:
+	const chrono::ChLinkEngine* engine;
+	std::vector<double> table;
+	double tableMin = 0;
+	double invSpacing = 0;
+	double throttle = 0;
+	double scale = 1;
+};
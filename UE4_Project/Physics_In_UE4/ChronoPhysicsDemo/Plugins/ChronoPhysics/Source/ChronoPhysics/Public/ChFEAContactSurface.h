@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChStaticMeshCollider.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/collision/ChCCollisionInfo.h"
+#include <memory>
+
+namespace chrono {
+	class ChBody;
+	namespace collision {
+		class ChCollisionModel;
+	}
+	namespace fea {
+		class ChContactSurface;
+		class ChContactSurfaceMesh;
+		class ChContactSurfaceNodeCloud;
+		class ChNodeFEAxyz;
+	}
+}
+
+/**
+ * BVH over primitives of one to three moving points, triangles or single nodes. The tree is built once
+ * from the rest positions and only refit afterwards: leaf bounds are recomputed from the current points in
+ * parallel, then the inner nodes level by level from the deepest up, each level in parallel. Nodes are
+ * depth first, the left child follows its parent
+ */
+class CHRONOPHYSICS_API FChRefitBVH
+{
+public:
+	static const int32 LeafSize = 4;
+
+	// Primitives index points, unused corners repeat the first
+	void Build(const TArray<FIntVector>& primitives, const TArray<FVector>& points);
+	// Every primitive's bounds grow by inflate
+	void Refit(const TArray<FVector>& points, float inflate);
+	void Query(const FBox& box, TArray<int32>& outPrimitives) const;
+
+	FORCEINLINE bool IsEmpty() const { return nodes.Num() == 0; }
+	FORCEINLINE int32 GetNodeNum() const { return nodes.Num(); }
+
+private:
+	struct FNode
+	{
+		float Min[3];
+		float Max[3];
+		// Right child, or first slot of order for leaves
+		int32 Data;
+		// Primitives of a leaf, 0 for inner nodes
+		int32 Count;
+	};
+
+	int32 BuildNode(int32 begin, int32 end, int32 depth, const TArray<FVector>& centroids);
+
+	TArray<FNode> nodes;
+	TArray<FIntVector> primitiveList;
+	// Primitives in leaf order
+	TArray<int32> order;
+	TArray<int32> leaves;
+	// Inner nodes per depth
+	TArray<TArray<int32>> levels;
+};
+
+/**
+ * Contacts between the proxies of rigid bodies and FEA contact surfaces, each surface one object with its
+ * own refit BVH instead of one Bullet model per triangle or node. Surfaces handed over here must not be added
+ * to their mesh, so their per primitive models never reach the collision system; they only carry the
+ * contactables the contacts are written with, straight into the system's contact container from the custom
+ * collision step. Triangle surfaces of ChNodeFEAxyz nodes and their node clouds are supported
+ */
+class CHRONOPHYSICS_API FChFEAContactSet : public chrono::ChSystem::CustomCollisionCallback
+{
+public:
+	// sphereSwept is the surface thickness, Chrono units
+	void AddSurface(std::shared_ptr<chrono::fea::ChContactSurfaceMesh> surface, double sphereSwept);
+	void AddNodeCloud(std::shared_ptr<chrono::fea::ChContactSurfaceNodeCloud> cloud, double radius);
+	void RemoveSurface(chrono::fea::ChContactSurface* surface);
+	bool ContainsSurface(chrono::fea::ChContactSurface* surface) const;
+	void AddProxy(std::shared_ptr<chrono::ChBody> body, const FChColliderProxy& proxy);
+	void RemoveProxy(chrono::ChBody* body);
+	bool ContainsProxy(chrono::ChBody* body) const;
+
+	FORCEINLINE bool HasSurfaces() const { return surfaces.Num() > 0; }
+	FORCEINLINE int32 GetLastContactCount() const { return lastContactCount; }
+
+	virtual void OnCustomCollision(chrono::ChSystem* system) override;
+
+private:
+	struct FSurface
+	{
+		std::shared_ptr<chrono::fea::ChContactSurface> Owner;
+		bool bNodes = false;
+		double Radius = 0;
+		double Envelope = 0;
+		TArray<chrono::fea::ChNodeFEAxyz*> Points;
+		// Point indices per primitive, nodes repeat theirs
+		TArray<FIntVector> Primitives;
+		TArray<chrono::collision::ChCollisionModel*> Models;
+		// This step, world frame
+		TArray<FVector> Positions;
+		FChRefitBVH BVH;
+	};
+
+	struct FProxyState
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		FChColliderProxy Shape;
+		TArray<int32> Candidates;
+		// Point and triangle of each vertex of the candidates, box proxies only
+		TArray<FIntPoint> Vertices;
+		TArray<chrono::collision::ChCollisionInfo> Contacts;
+	};
+
+	void GatherPositions(FSurface& surface);
+	void CollideProxy(FProxyState& proxy);
+	// Corners of box proxies in the world frame
+	void CollideTriangles(FProxyState& proxy, const FSurface& surface, const FVector corners[8], double proxyEnvelope);
+	void CollideNodes(FProxyState& proxy, const FSurface& surface, double proxyEnvelope);
+
+	TArray<FSurface> surfaces;
+	TArray<FProxyState> proxies;
+	int32 lastContactCount = 0;
+};
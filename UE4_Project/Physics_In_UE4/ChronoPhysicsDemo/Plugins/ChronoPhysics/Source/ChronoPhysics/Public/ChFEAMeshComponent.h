@@ -0,0 +1,136 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/MeshComponent.h"
+#include "PackedNormal.h"
+#include "ChPhysicsObjectInterface.h"
+#include <memory>
+#include "ChFEAMeshComponent.generated.h"
+
+namespace chrono {
+	class ChSystem;
+	namespace fea {
+		class ChContactSurface;
+		class ChMesh;
+		class ChNodeFEAxyz;
+		class ChNodeFEAxyzrot;
+	}
+}
+
+// Per node value written to the second UV channel, for materials to map to a color
+UENUM()
+namespace EChFEAScalarField {
+	enum Type {
+		NONE,
+		// m/s
+		SPEED,
+		// m, from the reference position
+		DISPLACEMENT
+	};
+}
+
+// How the bulk contact sees the mesh
+UENUM()
+namespace EChFEAContactType {
+	enum Type {
+		// Boundary triangles of the volume elements and shells
+		MESH,
+		// A sphere on every node
+		NODE_CLOUD
+	};
+}
+
+/**
+ * Renders a Chrono FEA mesh with a static topology and per frame vertex uploads. The boundary faces of
+ * tetrahedra and bricks, shell quads and beam or cable segments become one vertex per node and fixed index
+ * buffers when the mesh is set; after each step only the node positions, normals and the optional scalar
+ * field are copied into the vertex buffers of the proxy's local vertex factory, so nothing is rebuilt on
+ * the CPU and no section is recreated. Shells are single sided, use a two sided material for them
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class CHRONOPHYSICS_API UChFEAMeshComponent : public UMeshComponent, public IChPhysicsObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|FEAVisual")
+	TEnumAsByte<EChFEAScalarField::Type> ScalarField = EChFEAScalarField::NONE;
+
+	// Off keeps the reference normals, for meshes that barely bend
+	UPROPERTY(EditAnywhere, Category = "Chrono|FEAVisual")
+	bool bRecomputeNormals = true;
+
+	// Serial backends: the mesh collides with the box and sphere bodies as one surface with its own BVH
+	// through the scene's FChFEAContactSet; other shapes don't see it
+	UPROPERTY(EditAnywhere, Category = "Chrono|FEAContact", meta = (EditConditionToggle))
+	bool bBulkContact = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|FEAContact", meta = (editcondition = "bBulkContact"))
+	TEnumAsByte<EChFEAContactType::Type> ContactType = EChFEAContactType::MESH;
+
+	// cm, the surface thickness or the node radius
+	UPROPERTY(EditAnywhere, Category = "Chrono|FEAContact", meta = (editcondition = "bBulkContact", ClampMin = "0"))
+	float ContactRadius = 0.5f;
+
+	UChFEAMeshComponent();
+
+	// Game thread, before the scene adds its objects; rebuilds the topology and the render state
+	void SetMesh(std::shared_ptr<chrono::fea::ChMesh> inMesh);
+	FORCEINLINE std::shared_ptr<chrono::fea::ChMesh> GetMesh() const { return mesh; }
+	// The surface for bBulkContact, made on first use and never added to the mesh
+	std::shared_ptr<chrono::fea::ChContactSurface> GetBulkContactSurface(bool bSMC);
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetVertexCount() const { return vertexPoints.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetTriangleCount() const { return triangleIndices.Num() / 3; }
+
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	virtual int32 GetNumMaterials() const override { return 1; }
+
+	virtual void PhysicsObjectConstruct() override {}
+	virtual void PhysicsObjectInitalize() override {}
+	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void UpdatePhysicsState() override {}
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override {}
+	virtual void LatchPhysicsInput() override;
+	virtual void CacheVisualState() override;
+	virtual void UpdateVisualAsset() override;
+
+protected:
+	void BuildTopology();
+	// Two packed tangents per vertex, the normal from the area weighted faces around it
+	void ComputeNormals(const TArray<FVector>& positions, TArray<FPackedNormal>& outTangents) const;
+
+	std::shared_ptr<chrono::fea::ChMesh> mesh;
+	std::shared_ptr<chrono::fea::ChContactSurface> bulkSurface;
+
+	// One node per vertex, the other entry is null
+	TArray<chrono::fea::ChNodeFEAxyz*> vertexPoints;
+	TArray<chrono::fea::ChNodeFEAxyzrot*> vertexFrames;
+	TArray<uint32> triangleIndices;
+	TArray<uint32> lineIndices;
+	// Triangles around each vertex, vertexTriangleStart[i] to vertexTriangleStart[i + 1]
+	TArray<int32> vertexTriangleStart;
+	TArray<int32> vertexTriangles;
+
+	// Component space at the reference configuration, what a new proxy starts from
+	TArray<FVector> restPositions;
+	TArray<FPackedNormal> restTangents;
+
+	// Latched on the game thread for the physics thread
+	FTransform componentTransform;
+
+	// Last step in component space, two packed tangents and two UVs per vertex, handed to the render thread
+	TArray<FVector> cachedPositions;
+	TArray<FPackedNormal> cachedTangents;
+	TArray<FVector2D> cachedUVs;
+	FBox cachedBounds = FBox(ForceInit);
+	bool bVisualDirty = false;
+	FBox localBounds = FBox(ForceInit);
+};
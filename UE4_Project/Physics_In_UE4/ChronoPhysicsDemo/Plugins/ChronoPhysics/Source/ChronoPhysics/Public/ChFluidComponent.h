@@ -0,0 +1,146 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "RenderResource.h"
+#include "RHIResources.h"
+#include "ChPhysicsObjectInterface.h"
+#include <memory>
+#include "ChFluidComponent.generated.h"
+
+namespace chrono {
+	class ChFluidContainer;
+	class ChParallelDataManager;
+}
+
+UENUM()
+namespace EChFluidShape {
+	enum Type {
+		BOX,
+		SPHERE
+	};
+}
+
+/**
+ * Fluid particle positions on the GPU as a structured buffer, in the Chrono frame and meters with the layout
+ * of chrono::real3: x, y, z and a zero pad, all doubles. Vertex factories and Niagara data interfaces bind
+ * the SRV; it is only valid on the render thread
+ */
+class CHRONOPHYSICS_API FChFluidParticleBuffer : public FRenderResource
+{
+public:
+	static const uint32 Stride = 4 * sizeof(double);
+
+	// Render thread, one copy of the snapshot into the buffer, which only grows
+	void Upload(const TArray<uint8>& positions, int32 count);
+	virtual void ReleaseRHI() override;
+
+	FORCEINLINE FShaderResourceViewRHIRef GetPositionsSRV() const { return positionsSRV; }
+	FORCEINLINE int32 GetParticleCount() const { return particleCount; }
+
+private:
+	FStructuredBufferRHIRef positions;
+	FShaderResourceViewRHIRef positionsSRV;
+	int32 capacity = 0;
+	int32 particleCount = 0;
+};
+
+/**
+ * Chrono parallel fluid (ChFluidContainer) seeded on a lattice filling a box or sphere around the component.
+ * The container is the system's 3DOF container, so it needs the parallel NSC backend and there is one per scene.
+ * Each step the positions are copied out of the data manager in one block, and each frame that block goes
+ * into the particle buffer as is; nothing per particle runs on the CPU or exists as a UObject
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class CHRONOPHYSICS_API UChFluidComponent : public USceneComponent, public IChPhysicsObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|Fluid")
+	TEnumAsByte<EChFluidShape::Type> Shape = EChFluidShape::BOX;
+
+	// Half size in cm, the radius is X for a sphere
+	UPROPERTY(EditAnywhere, Category = "Chrono|Fluid")
+	FVector Extent = FVector(50.f, 50.f, 50.f);
+
+	// cm, the SPH kernel radius is twice this and the lattice spacing too
+	UPROPERTY(EditAnywhere, Category = "Chrono|Fluid", meta = (ClampMin = "0.1"))
+	float ParticleRadius = 2.f;
+
+	// cm/s, world space
+	UPROPERTY(EditAnywhere, Category = "Chrono|Fluid")
+	FVector InitialVelocity = FVector::ZeroVector;
+
+	// kg/m^3
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidMaterial")
+	float Density = 1000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidMaterial", meta = (EditConditionToggle))
+	bool bEnableViscosity = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidMaterial", meta = (editcondition = "bEnableViscosity"))
+	float Viscosity = 0.01f;
+
+	// Keeps the particles from clumping
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidMaterial")
+	bool bArtificialPressure = true;
+
+	// Density constraint relaxation, in steps
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidSolver")
+	float RelaxationSteps = 4.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidSolver")
+	float Compliance = 1e-8f;
+
+	// Regularization of the density constraint
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidSolver")
+	float Epsilon = 1e-3f;
+
+	// cm/s
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidSolver")
+	float MaxSpeed = 2000.f;
+
+	// cm/s
+	UPROPERTY(EditAnywhere, Category = "Chrono|FluidSolver")
+	float ContactRecoverySpeed = 1200.f;
+
+	UChFluidComponent();
+
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectInitalize() override {}
+	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
+	virtual void UpdateVisualAsset() override;
+	virtual void CacheVisualState() override;
+	virtual bool& GetIsForParallel() override { return isForParallel; }
+	virtual bool& GetIsForSMC() override { return isForSMC; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetParticleCount() const { return seedPositions.Num(); }
+
+	// Render thread users only, the buffer is released by OnUnregister
+	FORCEINLINE FChFluidParticleBuffer* GetParticleBuffer() const { return particleBuffer; }
+	FORCEINLINE std::shared_ptr<chrono::ChFluidContainer> GetChData() { return ChDataFluid; }
+
+protected:
+	std::shared_ptr<chrono::ChFluidContainer> ChDataFluid;
+	chrono::ChParallelDataManager* dataManager = nullptr;
+	chrono::ChSystem* system = nullptr;
+
+	bool isForParallel = false;
+	bool isForSMC = false;
+
+	// World space, made by PhysicsObjectConstruct
+	TArray<FVector> seedPositions;
+
+	// Raw real3 block of the last step, written by CacheVisualState and handed to the render thread
+	TArray<uint8> cachedPositions;
+	int32 cachedCount = 0;
+	bool bPositionsDirty = false;
+
+	FChFluidParticleBuffer* particleBuffer = nullptr;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/motion_functions/ChFunction_Base.h"
+#include <memory>
+
+// Value and first two derivatives of a function at one argument
+struct FChFunctionValue
+{
+	double Y = 0;
+	double Dy = 0;
+	double Ddy = 0;
+};
+
+/**
+ * A ChFunction tree flattened into one instruction array and run as a stack machine on value and derivative
+ * triples, so the derivatives are exact instead of Chrono's finite differences and a tree costs no virtual
+ * calls. Const, ramp, sine, polynomial and the add, sub, mul, div, max, min, abs and composition operations
+ * compile; anything else becomes a leaf that calls back into the original function
+ */
+class CHRONOPHYSICS_API FChFunctionProgram
+{
+public:
+	void Compile(std::shared_ptr<chrono::ChFunction> function);
+	FChFunctionValue Evaluate(double x) const;
+
+	FORCEINLINE bool IsEmpty() const { return instructions.Num() == 0; }
+	// Leaves that still go through a virtual Get_y, none when the whole tree compiled
+	FORCEINLINE int32 GetOpaqueNum() const { return opaque.Num(); }
+
+private:
+	enum class EOp : uint8 {
+		Const,
+		Ramp,
+		Sine,
+		Poly,
+		Opaque,
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Max,
+		Min,
+		Abs,
+		// Runs subprogram Operand at the value on top of the stack
+		Compose
+	};
+
+	struct FInstruction
+	{
+		EOp Op;
+		// Constant offset for Poly, leaf index for Opaque, subprogram index for Compose
+		int32 Operand;
+		double A;
+		double B;
+		double C;
+	};
+
+	void Emit(const std::shared_ptr<chrono::ChFunction>& function);
+	int32 MaxStackDepth() const;
+
+	TArray<FInstruction> instructions;
+	TArray<double> constants;
+	TArray<std::shared_ptr<chrono::ChFunction>> opaque;
+	TArray<FChFunctionProgram> subprograms;
+	int32 stackDepth = 0;
+};
+
+/**
+ * Link driver functions evaluated together once per step. Advance evaluates every program at the step's
+ * end time and keeps the previous results, which are the values at its start, so a driver asked at either
+ * time reads a stored value; any other argument runs its program. Whoever builds the links owns the batch
+ * and calls Advance before each step. Only drivers that depend on time alone fit, the actors' drivers are
+ * constants they rewrite every tick and stay as they are
+ */
+class CHRONOPHYSICS_API FChFunctionBatch
+{
+public:
+	int32 Add(std::shared_ptr<chrono::ChFunction> function);
+	void Reset();
+	void Advance(double x);
+	FChFunctionValue Get(int32 slot, double x) const;
+
+	FORCEINLINE int32 GetNum() const { return programs.Num(); }
+
+private:
+	TArray<FChFunctionProgram> programs;
+	TArray<FChFunctionValue> current;
+	TArray<FChFunctionValue> previous;
+	double currentX = TNumericLimits<double>::Lowest();
+	double previousX = TNumericLimits<double>::Lowest();
+};
+
+// Stands in for the original function in the link, reads its slot of the batch
+class CHRONOPHYSICS_API FChBatchedFunction : public chrono::ChFunction
+{
+public:
+	FChBatchedFunction(std::shared_ptr<const FChFunctionBatch> inBatch, int32 inSlot) : batch(inBatch), slot(inSlot) {}
+
+	virtual FChBatchedFunction* Clone() const override { return new FChBatchedFunction(*this); }
+
+	virtual double Get_y(double x) const override { return batch->Get(slot, x).Y; }
+	virtual double Get_y_dx(double x) const override { return batch->Get(slot, x).Dy; }
+	virtual double Get_y_dxdx(double x) const override { return batch->Get(slot, x).Ddy; }
+
+private:
+	std::shared_ptr<const FChFunctionBatch> batch;
+	int32 slot;
+};
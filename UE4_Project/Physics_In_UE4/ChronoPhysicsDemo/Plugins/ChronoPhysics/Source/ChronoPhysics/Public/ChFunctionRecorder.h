@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/motion_functions/ChFunction_Recorder.h"
+#include <vector>
+
+/**
+ * ChFunction_Recorder with its points in one sorted array instead of a list. Appending in argument order
+ * is an amortized push, a lookup starts from the interval of the last one and falls back to a binary search,
+ * so stepping forward through a curve is O(1) and a random argument O(log n). Same values as the recorder:
+ * linear between points, clamped at both ends
+ */
+class CHRONOPHYSICS_API FChFunctionRecorder : public chrono::ChFunction
+{
+public:
+	FChFunctionRecorder() {}
+	FChFunctionRecorder(const FChFunctionRecorder& other);
+
+	virtual FChFunctionRecorder* Clone() const override { return new FChFunctionRecorder(*this); }
+
+	virtual double Get_y(double x) const override;
+	// Slope of the interval, exact for the piecewise linear curve
+	virtual double Get_y_dx(double x) const override;
+
+	// A point at an argument that is already recorded replaces it
+	void AddPoint(double x, double y, double w = 1);
+	void Reserve(int32 count) { points.reserve(count); }
+	void Reset();
+
+	const std::vector<chrono::ChRecPoint>& GetPoints() const { return points; }
+
+	virtual void Estimate_x_range(double& xmin, double& xmax) const override;
+
+	virtual void ArchiveOUT(chrono::ChArchiveOut& marchive) override;
+	virtual void ArchiveIN(chrono::ChArchiveIn& marchive) override;
+
+private:
+	// Index i with points[i].x <= x < points[i + 1].x, needs two points and x inside their range
+	size_t FindInterval(double x) const;
+
+	std::vector<chrono::ChRecPoint> points;
+	// Interval of the last lookup
+	mutable size_t lastInterval = 0;
+};
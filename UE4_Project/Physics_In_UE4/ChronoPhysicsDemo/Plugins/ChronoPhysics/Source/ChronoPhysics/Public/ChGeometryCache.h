@@ -0,0 +1,86 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UProceduralMeshComponent;
+
+namespace chrono {
+	namespace geometry {
+		class ChTriangleMeshConnected;
+	}
+}
+
+// One frame converted for a procedural mesh section, the arrays keep their allocation when the frame is reused
+struct FChGeometryCacheMesh
+{
+	float Frame = 0.f;
+	TArray<FVector> Vertices;
+	TArray<FVector> Normals;
+	TArray<FLinearColor> Colors;
+	TArray<int32> Triangles;
+};
+
+/**
+ * Reader for the per frame .hgeo files Houdini_Project/Scripts/hou.export_geo.py writes: a header, a block
+ * table, then one block per point attribute and the triangle indices, each 16 byte aligned and optionally
+ * zlib compressed. Uncompressed blocks are used straight from the mapping, compressed ones are inflated on first use
+ */
+class CHRONOPHYSICS_API FChGeometryCacheReader
+{
+public:
+	~FChGeometryCacheReader();
+
+	bool Open(const FString& filePath);
+	// Takes a file that was already read, the streaming player reads on its I/O thread and parses on a worker
+	bool OpenMemory(TArray<uint8>&& fileData);
+	void Close();
+
+	FORCEINLINE bool IsOpen() const { return data != nullptr; }
+	FORCEINLINE float GetFrame() const { return frame; }
+	FORCEINLINE int32 GetPointCount() const { return pointCount; }
+	FORCEINLINE int32 GetIndexCount() const { return indexCount; }
+
+	// Houdini axes and units, pointCount * width values; nullptr when missing or of another type or width
+	const float* GetFloatAttribute(FName name, int32 width);
+	const int32* GetIntAttribute(FName name, int32 width);
+	// Triangle list in Houdini's winding, nullptr when an index is outside the points; checked on the first call
+	const int32* GetIndices();
+	// Inflates every compressed block now, so the accessors above don't allocate later
+	bool DecodeAll();
+
+	// P and N in UE axes and centimeters, Cd as linear color, winding flipped for UE's front faces
+	bool ConvertToMesh(FChGeometryCacheMesh& outMesh);
+	bool CopyToProceduralMesh(UProceduralMeshComponent* mesh, int32 section, bool bCreateCollision);
+	// Houdini's axes and meters are Chrono's, only the winding is flipped
+	bool CopyToChronoMesh(chrono::geometry::ChTriangleMeshConnected& mesh);
+
+private:
+	struct FBlock {
+		FName name;
+		uint8 type;
+		uint8 width;
+		uint8 compression;
+		int64 offset;
+		int64 storedSize;
+		int64 rawSize;
+		TArray<uint8> decoded;
+	};
+
+	bool Parse();
+	const uint8* GetBlock(FName name, uint8 type, int32 width, int64 count);
+	const uint8* Decode(FBlock& block);
+
+	class IMappedFileHandle* mappedFile = nullptr;
+	class IMappedFileRegion* mappedRegion = nullptr;
+	// Used when the platform can't map files, or for OpenMemory
+	TArray<uint8> loadedData;
+	const uint8* data = nullptr;
+	int64 dataSize = 0;
+
+	float frame = 0.f;
+	int32 pointCount = 0;
+	int32 indexCount = 0;
+	TArray<FBlock> blocks;
+	// Unset until GetIndices has checked them against pointCount
+	TOptional<bool> indicesInRange;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "ChGeometryCache.h"
+#include "ChGeometryCacheComponent.generated.h"
+
+class FChGeometryCacheStream;
+
+/**
+ * Plays a Houdini .hgeo frame sequence on section 0. Frames are streamed ahead of the playhead,
+ * the one on screen and the next ones are separate buffers, so an upload never waits for a decode.
+ * When a frame isn't ready in time the last one stays up and the stall is counted
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class CHRONOPHYSICS_API UChGeometryCacheComponent : public UProceduralMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Relative to the project directory, {frame} is replaced with the padded frame number
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	FString FilePattern = TEXT("GeometryCache/output_data.{frame}.hgeo");
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	int FramePadding = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	int StartFrame = 1;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	int EndFrame = 240;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	float FrameRate = 24.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|GeometryCache")
+	bool bLoop = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|GeometryCache")
+	bool bPlaying = true;
+
+	// Frames read and decoded ahead of the playhead
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	int ReadAhead = 8;
+
+	// Cooking collision every frame is expensive, meant for short or sparse sequences
+	UPROPERTY(EditAnywhere, Category = "Chrono|GeometryCache")
+	bool bCreateCollision = false;
+
+	UChGeometryCacheComponent();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono")
+	void SetPlaybackTime(float seconds);
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetCurrentFrame() const { return currentFrame; }
+
+	// Ticks that wanted a new frame and kept showing the old one
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetStallCount() const { return stalls; }
+
+protected:
+	int32 GetFrameAt(float seconds) const;
+	void ShowFrame(TUniquePtr<FChGeometryCacheMesh> mesh);
+
+	TUniquePtr<FChGeometryCacheStream> stream;
+	// The frame on screen, kept until the next one replaces it
+	TUniquePtr<FChGeometryCacheMesh> shownMesh;
+	float playbackTime = 0.f;
+	int32 currentFrame = INDEX_NONE;
+	int32 stalls = 0;
+};
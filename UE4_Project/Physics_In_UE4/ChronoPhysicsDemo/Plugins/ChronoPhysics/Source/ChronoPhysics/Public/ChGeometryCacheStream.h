@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "ChGeometryCache.h"
+
+/**
+ * Reads a numbered .hgeo sequence ahead of the playhead. The I/O thread only loads file bytes, parsing,
+ * inflating and converting each frame runs as a thread pool task, so a slow disk and a slow decode overlap.
+ * Converted frames wait in the ready set until the game thread takes them, frames that fall out of
+ * the read ahead window are dropped and their arrays reused for the next ones. A frame that can't be read or
+ * decoded goes back in the queue after a delay, the exporter may still be writing it
+ */
+class CHRONOPHYSICS_API FChGeometryCacheStream : public FRunnable
+{
+public:
+	// filePattern contains {frame}, replaced with the frame number padded to framePadding digits
+	FChGeometryCacheStream(const FString& inFilePattern, int32 inFramePadding, int32 inFirstFrame, int32 inLastFrame, int32 inReadAhead);
+	virtual ~FChGeometryCacheStream();
+
+	// Game thread, frames from the playhead on are wanted, wrapping to the first frame when looping
+	void SetPlayhead(int32 frame, bool bLoop);
+	// Game thread, nullptr while the frame is still being read or decoded
+	TUniquePtr<FChGeometryCacheMesh> Take(int32 frame);
+	// Returns the arrays of a frame the caller is done with
+	void Recycle(TUniquePtr<FChGeometryCacheMesh> mesh);
+
+	FString GetFramePath(int32 frame) const;
+	// Failed reads and decodes, a frame that keeps failing counts once per attempt
+	FORCEINLINE int32 GetFailedFrames() const { return failedFrames.GetValue(); }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	// The frames of the window in playback order, under lock
+	void GetWantedFrames(TArray<int32>& outFrames) const;
+	bool IsWanted(int32 frame) const;
+	void Decode(int32 frame, TArray<uint8>&& fileData);
+	// Under lock
+	void MarkFailed(int32 frame);
+
+	FString filePattern;
+	int32 framePadding;
+	int32 firstFrame;
+	int32 lastFrame;
+	int32 readAhead;
+
+	mutable FCriticalSection lock;
+	int32 playhead;
+	bool bLooping = false;
+	// On screen, the caller holds on to it so it isn't read again
+	int32 taken = INDEX_NONE;
+	// Read or being decoded
+	TSet<int32> inFlight;
+	TMap<int32, TUniquePtr<FChGeometryCacheMesh>> ready;
+	// Missing or broken files, with the time they may be read again
+	TMap<int32, double> failed;
+	TArray<TUniquePtr<FChGeometryCacheMesh>> pool;
+
+	FThreadSafeCounter pendingTasks;
+	FThreadSafeCounter failedFrames;
+	FThreadSafeCounter stopping;
+	FEvent* wakeEvent = nullptr;
+	FRunnableThread* thread = nullptr;
+};
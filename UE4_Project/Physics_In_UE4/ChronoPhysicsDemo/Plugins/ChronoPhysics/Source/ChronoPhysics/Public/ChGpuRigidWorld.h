@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChStaticMeshCollider.h"
+#include <memory>
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+}
+
+namespace ChGpuRigid {
+	struct FWorld;
+}
+
+/**
+ * Sphere and box bodies stepped on the CUDA device. Hashed grid broadphase, narrowphase and APGD contact
+ * solve run there with the state resident between steps; only the poses come back. While the device owns
+ * them the dynamic bodies are fixed and collide with nothing in Chrono, the poses are written into them after
+ * each step so the visuals read them as before. Fixed bodies are obstacles on the device and stay in Chrono.
+ * The device bodies only touch each other: trimesh, heightfield and static collider meshes, the bodies left
+ * in Chrono and any force applied through Chrono don't reach them. Release hands them back to Chrono.
+ * Without WITH_CHRONO_CUDA nothing is available and Create fails
+ */
+class CHRONOPHYSICS_API FChGpuRigidWorld
+{
+public:
+	~FChGpuRigidWorld();
+
+	static bool IsAvailable();
+
+	// Before Create only, the proxy gives the shape in Chrono units
+	void Add(std::shared_ptr<chrono::ChBody> body, const FChColliderProxy& proxy);
+	bool Contains(chrono::ChBody* body) const;
+
+	// Copies the bodies to the device and takes the dynamic ones out of the system's dynamics and collision
+	bool Create(chrono::ChSystem* system, float envelope, float recoverySpeed, int32 iterations, int32 maxContacts);
+
+	// Writes the last poses and velocities into the dynamic bodies and gives them back to the system's dynamics
+	// and collision; the world is empty afterwards and takes new bodies before the next Create
+	void Release();
+
+	// Queued on the device, returns right away so the Chrono step can run meanwhile
+	void Step(double stepSize);
+	// Waits for the step and writes the poses into the Chrono bodies
+	void ApplyPoses();
+
+	FORCEINLINE bool IsCreated() const { return world != nullptr; }
+	FORCEINLINE int32 GetBodyNum() const { return bodies.Num(); }
+	int32 GetContactCount() const;
+	// Contacts of the last step that didn't fit the capacity
+	int32 GetDroppedContactCount() const;
+
+private:
+	struct FDeviceBody
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		FChColliderProxy Proxy;
+		// Index in the device arrays
+		int32 DeviceIndex;
+	};
+
+	TArray<FDeviceBody> bodies;
+	ChGpuRigid::FWorld* world = nullptr;
+	bool bStepQueued = false;
+	// Including the fixed ones, which aren't kept in bodies
+	int32 deviceBodyNum = 0;
+};
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicsObjectGeneratorBasis.h"
+#include "ChGranularTerrainActor.generated.h"
+
+/**
+ * Patch of instanced sphere particles on a fixed floor between two side walls.
+ * The patch starts at the actor location and extends along world X, centered in Y.
+ * With a moving patch, particles left behind the tracked body are moved to the front.
+ */
+UCLASS()
+class CHRONOPHYSICS_API AChGranularTerrainActor : public APhysicsObjectGeneratorBasis
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	float PatchLength = 1000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	float PatchWidth = 400.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	int NumLayers = 5;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	float ParticleRadius = 5.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	float ParticleDensity = 2000.f;
+
+	// Horizontal jitter of the initial lattice, as a fraction of the particle radius
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	float PositionJitter = 0.2f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	int RandomSeed = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain")
+	float WallThickness = 20.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain", meta = (EditConditionToggle))
+	bool bMovingPatch = false;
+
+	// Actor with a Chrono body component the moving patch follows
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain", meta = (editcondition = "bMovingPatch"))
+	AActor* TrackedActor;
+
+	// Shift the patch once the tracked body is closer than this to its front
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain", meta = (editcondition = "bMovingPatch"))
+	float BufferDistance = 300.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|GranularTerrain", meta = (editcondition = "bMovingPatch"))
+	float ShiftDistance = 100.f;
+
+	AChGranularTerrainActor();
+
+	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectInitalize() override;
+	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
+	virtual void CacheVisualState() override;
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetParticleCount() const { return ParticleList.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	float GetPatchRear() const { return patchRear; }
+
+protected:
+	int NewContainerBox(const FVector& center, const FVector& size);
+	void ShiftPatch();
+
+	TArray<int> ParticleList;
+	TArray<int> ContainerList;
+
+	std::shared_ptr<chrono::ChBody> trackedBody;
+	float patchRear = 0.f;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/collision/ChCModelBullet.h"
+#include <memory>
+
+class btHeightfieldTerrainShape;
+
+/**
+ * Regular grid of 16 bit heights in Chrono units, X columns by Z rows, offset from the body frame by Origin.
+ * Kept alive by every model that collides with it, Bullet reads the samples in place
+ */
+struct CHRONOPHYSICS_API FChHeightfield
+{
+	TArray<int16> Heights;
+	int32 SizeX = 0;
+	int32 SizeZ = 0;
+	// Distance between samples along X and Z
+	double SpacingX = 1;
+	double SpacingZ = 1;
+	// Height of one unit of a sample
+	double HeightScale = 1;
+	// Sample (0, 0) at height 0 in the body frame
+	chrono::ChVector<> Origin;
+
+	FORCEINLINE bool IsValid() const { return SizeX > 1 && SizeZ > 1 && Heights.Num() == SizeX * SizeZ; }
+	FORCEINLINE double GetSample(int32 x, int32 z) const { return Heights[z * SizeX + x] * HeightScale; }
+	// Bilinear between the four samples of the cell, clamped to the grid
+	double GetHeight(double x, double z) const;
+	void GetHeightRange(double& outMin, double& outMax) const;
+};
+
+/**
+ * Bullet collision model with a btHeightfieldTerrainShape, Y up like the rest of Chrono. Bullet finds the
+ * cells under a shape's AABB directly from the grid, there is no triangle BVH to build or store
+ */
+class CHRONOPHYSICS_API FChHeightfieldModel : public chrono::collision::ChModelBullet
+{
+public:
+	virtual int ClearModel() override;
+
+	// Only shape of the model, between ClearModel and BuildModel
+	bool AddHeightfield(std::shared_ptr<const FChHeightfield> heightfield);
+
+	FORCEINLINE std::shared_ptr<const FChHeightfield> GetHeightfield() const { return heightfield; }
+
+private:
+	std::shared_ptr<const FChHeightfield> heightfield;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChBezierPathIndex.h"
+#include "chrono_vehicle/ChDriver.h"
+#include "chrono_vehicle/utils/ChSteeringController.h"
+#include "chrono_vehicle/utils/ChSpeedController.h"
+#include "chrono_vehicle/utils/ChAdaptiveSpeedController.h"
+#include <memory>
+
+// ChPathSteeringController whose target point comes from a shared FChBezierPathIndex and its own cursor
+class CHRONOPHYSICS_API FChIndexedPathSteeringController : public chrono::vehicle::ChSteeringController
+{
+public:
+	explicit FChIndexedPathSteeringController(std::shared_ptr<const FChBezierPathIndex> index) : pathIndex(index) {}
+
+	virtual void Reset(const chrono::vehicle::ChVehicle& vehicle) override;
+
+	const FChBezierPathCursor& GetCursor() const { return cursor; }
+	std::shared_ptr<const FChBezierPathIndex> GetPathIndex() const { return pathIndex; }
+
+protected:
+	virtual void CalcTargetLocation() override;
+
+private:
+	std::shared_ptr<const FChBezierPathIndex> pathIndex;
+	FChBezierPathCursor cursor;
+};
+
+/**
+ * ChPathFollowerDriver and ChPathFollowerACCDriver on an indexed path: same speed and steering laws, but the
+ * steering target is looked up from where the vehicle was on the last step instead of searched for again.
+ * Adaptive cruise is off until SetFollowing, then the speed comes from ChAdaptiveSpeedController as in the
+ * ACC driver. The path isn't drawn, ExportPathPovray has no counterpart
+ */
+class CHRONOPHYSICS_API FChIndexedPathFollowerDriver : public chrono::vehicle::ChDriver
+{
+public:
+	FChIndexedPathFollowerDriver(chrono::vehicle::ChVehicle& vehicle, std::shared_ptr<const FChBezierPathIndex> index, double targetSpeed);
+
+	void SetDesiredSpeed(double val) { targetSpeed = val; }
+	void SetThresholdThrottle(double val) { throttleThreshold = val; }
+	void SetFollowing(double followingTime, double minDistance);
+	void SetCurrentDistance(double val) { currentDistance = val; }
+
+	FChIndexedPathSteeringController& GetSteeringController() { return steeringPID; }
+	chrono::vehicle::ChSpeedController& GetSpeedController() { return speedPID; }
+	chrono::vehicle::ChAdaptiveSpeedController& GetAdaptiveSpeedController() { return adaptiveSpeedPID; }
+
+	void Reset();
+	virtual void Advance(double step) override;
+
+private:
+	FChIndexedPathSteeringController steeringPID;
+	chrono::vehicle::ChSpeedController speedPID;
+	chrono::vehicle::ChAdaptiveSpeedController adaptiveSpeedPID;
+	double targetSpeed;
+	double throttleThreshold = 0.2;
+	bool bAdaptiveCruise = false;
+	double followingTime = 0;
+	double minDistance = 0;
+	double currentDistance = 0;
+};
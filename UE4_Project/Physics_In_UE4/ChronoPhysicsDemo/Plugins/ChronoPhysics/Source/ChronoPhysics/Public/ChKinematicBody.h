@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/core/ChVector.h"
+#include "chrono/core/ChQuaternion.h"
+
+namespace chrono {
+	class ChBody;
+}
+
+/**
+ * Bodies moved from outside along a path, robot arms and gantries animated in UE. Fixing them would keep them
+ * still, but a fixed body's variables are inactive and the contact rows never see its velocity, so a box on a
+ * moving platform stays where it is. A kinematic body stays in the solver instead, with a mass and inertia so
+ * large that no contact impulse changes its velocity, and Drive sets its pose and velocity before each step.
+ * Gravity is cancelled through the force accumulator and the gyroscopic torque is off, so the velocity it is
+ * given is the one the contacts see over the whole step. Serial systems only, the parallel ones apply gravity
+ * on their own side
+ */
+class CHRONOPHYSICS_API FChKinematicBody
+{
+public:
+	// kg and kg m^2, a body at least this heavy is kinematic
+	static constexpr double Mass = 1e20;
+
+	// Before the body takes part in a step, after its real mass was set
+	static void Make(chrono::ChBody& body);
+	static bool IsKinematic(const chrono::ChBody& body);
+
+	// Pose at the start of the step and the velocity over it, absolute frame
+	static void Drive(chrono::ChBody& body, const chrono::ChVector<>& position, const chrono::ChQuaternion<>& rotation,
+		const chrono::ChVector<>& velocity, const chrono::ChVector<>& angularVelocity);
+};
@@ -10,6 +10,7 @@
 
 namespace chrono {
 	class ChLink;
+	class ChBody;
 }
 
 UCLASS()
@@ -28,6 +29,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono")
 	AActor* target2;
 
+	// The link breaks in the step its reaction goes past a threshold, see OnLinksBroken of the scene manager
+	UPROPERTY(EditAnywhere, Category = "Chrono|Break", meta = (EditConditionToggle))
+	bool bBreakable = false;
+
+	// Same units as the exported reactions, 0 never breaks
+	UPROPERTY(EditAnywhere, Category = "Chrono|Break", meta = (editcondition = "bBreakable"))
+	float BreakForce = 0.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Break", meta = (editcondition = "bBreakable"))
+	float BreakTorque = 0.f;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|ExportData", meta = (EditConditionToggle))
 	bool bExportData = false;
 
@@ -42,20 +54,47 @@ public:
 
 	AChLinkActor();
 
+	virtual void PostRegisterAllComponents() override;
+	virtual void PostUnregisterAllComponents() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 	virtual void PhysicsObjectConstruct() override;
 	virtual void PhysicsObjectInitalize() override;
 	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
 	virtual void UpdatePhysicsState() override {}
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override {}
 	virtual void UpdateVisualAsset() override {}
 	virtual FExportData ExportData() override;
+	virtual void RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList) override;
+	virtual void WriteTelemetry(FChTelemetry& telemetry) override;
 	virtual bool& GetIsExportData() override { return bExportData; }
 	virtual FName& GetExportDataOwnerName() override { return LinkExportDataOwnerName; }
 
+	UFUNCTION(BlueprintPure, Category = "Chrono|Break")
+	bool IsBroken() const;
+
 	bool IsReadyForInitialize();
 	virtual void ChLinkInitialize() {}
 
+	// Bind Chrono bodies directly, for generated bodies that have no actor
+	void SetTargetBodies(std::shared_ptr<chrono::ChBody> body1, std::shared_ptr<chrono::ChBody> body2);
+	std::shared_ptr<chrono::ChBody> GetTargetBody1();
+	std::shared_ptr<chrono::ChBody> GetTargetBody2();
+
 	std::shared_ptr<chrono::ChLink> ChData;
 
+protected:
+	std::shared_ptr<chrono::ChBody> targetBody1;
+	std::shared_ptr<chrono::ChBody> targetBody2;
+
+	class AChPhysicsSceneManagerActor* breakScene = nullptr;
+	int32 breakSlot = INDEX_NONE;
+
+	int32 reactForceChannel = INDEX_NONE;
+	int32 reactTorqueChannel = INDEX_NONE;
+
 	
 
 };
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChLinkMate.h"
+#include "chrono/solver/ChConstraintTwoBodies.h"
+#include "chrono/solver/ChSystemDescriptor.h"
+
+// Coordinates of frame 1 relative to frame 2 a fixed link constrains, same order as ChLinkMateGeneric
+namespace EChLinkDof {
+	enum Type : uint8 {
+		X = 1 << 0,
+		Y = 1 << 1,
+		Z = 1 << 2,
+		Rx = 1 << 3,
+		Ry = 1 << 4,
+		Rz = 1 << 5
+	};
+}
+
+constexpr int32 CountLinkDofs(uint8 mask)
+{
+	return mask ? (mask & 1) + CountLinkDofs(mask >> 1) : 0;
+}
+
+// A constraint row whose 1x6 Jacobian blocks the links write in place
+class FChLinkRow final : public chrono::ChConstraintTwoBodies
+{
+public:
+	FORCEINLINE double* GetCqA() { return Cq_a.GetAddress(); }
+	FORCEINLINE double* GetCqB() { return Cq_b.GetAddress(); }
+};
+
+// The frames and initialization a fixed link shares with ChLinkMateGeneric, whatever its mask
+class CHRONOPHYSICS_API FChLinkFixedBase : public chrono::ChLinkMate
+{
+public:
+	virtual chrono::ChCoordsys<> GetLinkRelativeCoords() override { return frame2.GetCoord(); }
+	virtual chrono::ChFrame<> GetAssetsFrame(unsigned int nclone = 0) override { return frame2 >> *GetBody2(); }
+
+	chrono::ChFrame<>& GetFrame1() { return frame1; }
+	chrono::ChFrame<>& GetFrame2() { return frame2; }
+
+	// Both frames start on the absolute frame
+	void Initialize(std::shared_ptr<chrono::ChBodyFrame> body1, std::shared_ptr<chrono::ChBodyFrame> body2, const chrono::ChFrame<>& absFrame);
+
+	virtual void ArchiveOUT(chrono::ChArchiveOut& marchive) override;
+	virtual void ArchiveIN(chrono::ChArchiveIn& marchive) override;
+
+protected:
+	chrono::ChFrame<> frame1;
+	chrono::ChFrame<> frame2;
+};
+
+/**
+ * ChLinkMateGeneric with its mask known at compile time. The generic link loads its rows through a ChLinkMask
+ * and a dynamic residual vector and tests every coordinate flag on each call; here the row count is a
+ * constant, the residuals and rows are plain arrays and the Jacobians are written straight into each row's
+ * fixed 1x6 blocks, so the loops over the mask fold away. The solvers still see ordinary
+ * ChConstraintTwoBodies rows, with the same residuals, Jacobians and reaction convention as the generic link
+ */
+template <uint8 Mask>
+class FChLinkFixed : public FChLinkFixedBase
+{
+public:
+	static constexpr int32 DOC = CountLinkDofs(Mask);
+	static_assert(DOC > 0 && Mask < 64, "A fixed link constrains one to six coordinates");
+
+	virtual FChLinkFixed* Clone() const override { return new FChLinkFixed(*this); }
+
+	virtual int GetDOC() override { return DOC; }
+	virtual int GetDOC_c() override { return DOC; }
+	virtual int GetDOC_d() override { return 0; }
+
+	virtual void SetDisabled(bool mdis) override
+	{
+		FChLinkFixedBase::SetDisabled(mdis);
+		UpdateRowsActive();
+	}
+
+	virtual void SetBroken(bool mon) override
+	{
+		FChLinkFixedBase::SetBroken(mon);
+		UpdateRowsActive();
+	}
+
+	virtual void Update(double mytime, bool update_assets = true) override;
+
+	virtual void IntStateGatherReactions(const unsigned int off_L, chrono::ChVectorDynamic<>& L) override
+	{
+		for (int32 i = 0, n = 0; i < 6; i++) {
+			if (Mask & (1 << i)) {
+				L(off_L + n++) = i < 3 ? -react_force[i] : -2.0 * react_torque[i - 3];
+			}
+		}
+	}
+
+	virtual void IntStateScatterReactions(const unsigned int off_L, const chrono::ChVectorDynamic<>& L) override
+	{
+		react_force = chrono::VNULL;
+		react_torque = chrono::VNULL;
+		for (int32 i = 0, n = 0; i < 6; i++) {
+			if (Mask & (1 << i)) {
+				SetReaction(i, L(off_L + n++));
+			}
+		}
+	}
+
+	virtual void IntLoadResidual_CqL(const unsigned int off_L, chrono::ChVectorDynamic<>& R, const chrono::ChVectorDynamic<>& L, const double c) override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			if (rows[n].IsActive()) {
+				rows[n].MultiplyTandAdd(R, L(off_L + n) * c);
+			}
+		}
+	}
+
+	virtual void IntLoadConstraint_C(const unsigned int off, chrono::ChVectorDynamic<>& Qc, const double c, bool do_clamp, double recovery_clamp) override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			if (rows[n].IsActive()) {
+				Qc(off + n) += Clamp(c * residuals[n], do_clamp, recovery_clamp);
+			}
+		}
+	}
+
+	// Nothing moves the frames over time
+	virtual void IntLoadConstraint_Ct(const unsigned int off, chrono::ChVectorDynamic<>& Qc, const double c) override {}
+
+	virtual void IntToDescriptor(const unsigned int off_v, const chrono::ChStateDelta& v, const chrono::ChVectorDynamic<>& R,
+		const unsigned int off_L, const chrono::ChVectorDynamic<>& L, const chrono::ChVectorDynamic<>& Qc) override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			rows[n].Set_l_i(L(off_L + n));
+			rows[n].Set_b_i(Qc(off_L + n));
+		}
+	}
+
+	virtual void IntFromDescriptor(const unsigned int off_v, chrono::ChStateDelta& v, const unsigned int off_L, chrono::ChVectorDynamic<>& L) override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			L(off_L + n) = rows[n].Get_l_i();
+		}
+	}
+
+	virtual void InjectConstraints(chrono::ChSystemDescriptor& mdescriptor) override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			mdescriptor.InsertConstraint(&rows[n]);
+		}
+	}
+
+	virtual void ConstraintsBiReset() override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			rows[n].Set_b_i(0.);
+		}
+	}
+
+	virtual void ConstraintsBiLoad_C(double factor = 1, double recovery_clamp = 0.1, bool do_clamp = false) override
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			if (rows[n].IsActive()) {
+				rows[n].Set_b_i(rows[n].Get_b_i() + Clamp(factor * residuals[n], do_clamp, recovery_clamp));
+			}
+		}
+	}
+
+	virtual void ConstraintsBiLoad_Ct(double factor = 1) override {}
+
+	// Loaded by Update already
+	virtual void ConstraintsLoadJacobians() override {}
+
+	virtual void ConstraintsFetch_react(double factor = 1) override
+	{
+		react_force = chrono::VNULL;
+		react_torque = chrono::VNULL;
+		for (int32 i = 0, n = 0; i < 6; i++) {
+			if (Mask & (1 << i)) {
+				if (rows[n].IsActive()) {
+					SetReaction(i, rows[n].Get_l_i() * factor);
+				}
+				n++;
+			}
+		}
+	}
+
+private:
+	FORCEINLINE static double Clamp(double value, bool bClamp, double recoveryClamp)
+	{
+		return bClamp ? FMath::Clamp(value, -recoveryClamp, recoveryClamp) : value;
+	}
+
+	// Rotational rows are the halved imaginary part of the relative quaternion
+	FORCEINLINE void SetReaction(int32 coordinate, double lambda)
+	{
+		if (coordinate < 3) {
+			react_force[coordinate] = -lambda;
+		}
+		else {
+			react_torque[coordinate - 3] = -0.5 * lambda;
+		}
+	}
+
+	void UpdateRowsActive()
+	{
+		for (int32 n = 0; n < DOC; n++) {
+			rows[n].SetDisabled(!IsActive());
+		}
+	}
+
+	FChLinkRow rows[DOC];
+	double residuals[DOC] = {};
+};
+
+template <uint8 Mask>
+void FChLinkFixed<Mask>::Update(double mytime, bool update_assets)
+{
+	FChLinkFixedBase::Update(mytime, update_assets);
+	if (!Body1 || !Body2) {
+		return;
+	}
+	for (int32 n = 0; n < DOC; n++) {
+		rows[n].SetVariables(&Body1->Variables(), &Body2->Variables());
+	}
+
+	// Frame 1 relative to frame 2, in frame 2
+	chrono::ChFrame<> abs1 = frame1 >> *Body1;
+	chrono::ChFrame<> local1;
+	static_cast<chrono::ChFrame<>*>(Body2)->TransformParentToLocal(abs1, local1);
+	chrono::ChFrame<> relative;
+	frame2.TransformParentToLocal(local1, relative);
+	const chrono::ChQuaternion<>& q = relative.GetRot();
+
+	chrono::ChMatrix33<> plane;
+	plane.MatrMultiply(Body2->GetA(), frame2.GetA());
+	chrono::ChMatrix33<> jw1, jw2, jr1, jr2, temp;
+	jw1.MatrTMultiply(plane, Body1->GetA());
+	jw2.MatrTMultiply(plane, Body2->GetA());
+	if (Mask & (EChLinkDof::X | EChLinkDof::Y | EChLinkDof::Z)) {
+		temp.Set_X_matrix(frame1.GetPos());
+		jr1.MatrMultiply(jw1, temp);
+		jr1.MatrNeg();
+		temp.Set_X_matrix(frame2.GetPos());
+		jr2.MatrMultiply(jw2, temp);
+		// Body 2 turning moves the plane under frame 1 too, by the offset between both frames
+		chrono::ChMatrix33<> offset;
+		offset.Set_X_matrix(Body2->GetA().MatrT_x_Vect(abs1.GetPos() - (frame2 >> *Body2).GetPos()));
+		temp.MatrTMultiply(frame2.GetA(), offset);
+		jr2.MatrInc(temp);
+	}
+	if (Mask & (EChLinkDof::Rx | EChLinkDof::Ry | EChLinkDof::Rz)) {
+		// 0.5 [Fp(q)]' so the residual is the imaginary part of the quaternion at any misalignment
+		chrono::ChMatrix33<> fp;
+		fp.Set_X_matrix(q.GetVector() * 0.5);
+		fp(0, 0) = fp(1, 1) = fp(2, 2) = 0.5 * q.e0();
+		temp.MatrTMultiply(fp, jw1);
+		jw1 = temp;
+		jw2.MatrNeg();
+		temp.MatrTMultiply(fp, jw2);
+		jw2 = temp;
+	}
+
+	for (int32 i = 0, n = 0; i < 6; i++) {
+		if (!(Mask & (1 << i))) {
+			continue;
+		}
+		double* cqA = rows[n].GetCqA();
+		double* cqB = rows[n].GetCqB();
+		if (i < 3) {
+			residuals[n] = relative.GetPos()[i];
+			for (int32 c = 0; c < 3; c++) {
+				cqA[c] = plane(c, i);
+				cqB[c] = -plane(c, i);
+				cqA[3 + c] = jr1(i, c);
+				cqB[3 + c] = jr2(i, c);
+			}
+		}
+		else {
+			residuals[n] = q.GetVector()[i - 3];
+			for (int32 c = 0; c < 3; c++) {
+				cqA[c] = 0;
+				cqB[c] = 0;
+				cqA[3 + c] = jw1(i - 3, c);
+				cqB[3 + c] = jw2(i - 3, c);
+			}
+		}
+		n++;
+	}
+}
+
+typedef FChLinkFixed<EChLinkDof::X | EChLinkDof::Y | EChLinkDof::Z | EChLinkDof::Rx | EChLinkDof::Ry | EChLinkDof::Rz> FChLinkFixedLock;
+typedef FChLinkFixed<EChLinkDof::X | EChLinkDof::Y | EChLinkDof::Z> FChLinkFixedSpherical;
+typedef FChLinkFixed<EChLinkDof::Z> FChLinkFixedPointPlane;
+typedef FChLinkFixed<EChLinkDof::Y | EChLinkDof::Z> FChLinkFixedPointLine;
+typedef FChLinkFixed<EChLinkDof::X | EChLinkDof::Y | EChLinkDof::Rx | EChLinkDof::Ry> FChLinkFixedCylindrical;
+typedef FChLinkFixed<EChLinkDof::X | EChLinkDof::Y | EChLinkDof::Rx | EChLinkDof::Ry | EChLinkDof::Rz> FChLinkFixedPrismatic;
+typedef FChLinkFixed<EChLinkDof::Z | EChLinkDof::Rx | EChLinkDof::Ry> FChLinkFixedPlanePlane;
+typedef FChLinkFixed<EChLinkDof::X | EChLinkDof::Y | EChLinkDof::Z | EChLinkDof::Rx | EChLinkDof::Ry> FChLinkFixedRevolute;
@@ -6,6 +6,8 @@
 #include "ChLinkMarkersActor.h"
 #include "ChLinkLockActor.generated.h"
 
+class FChLinkFixedBase;
+
 UENUM()
 namespace ELinkLockType {
 	enum Type {
@@ -37,6 +39,12 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|LinkType")
 	TEnumAsByte<ELinkLockType::Type> LinkLockType;
 
+	// Build LOCK, SPHERICAL, POINTPLANE, POINTLINE, CYLINDRICAL, PRISMATIC, PLANEPLANE and REVOLUTE links
+	// without markers, as links specialized for their mask, so the bodies have no markers to update each step.
+	// Ignored when a limit is used
+	UPROPERTY(EditAnywhere, Category = "Chrono|LinkType")
+	bool bUseMarkerFreeLink = false;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|LinkLimit", meta = (EditConditionToggle))
 	uint8 bUseLimitX : 1;
 	UPROPERTY(EditAnywhere, Category = "Chrono|LinkLimit", meta = (DisplayName = "X max", editcondition = "bUseLimitX"))
@@ -77,4 +85,8 @@ public:
 	virtual void PhysicsObjectConstruct() override;
 	virtual void ChLinkInitialize() override;
 
+protected:
+	// The fixed mask link of the link type, null when it has no marker-free form
+	std::shared_ptr<FChLinkFixedBase> NewFixedLink() const;
+
 };
@@ -4,8 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "ChLinkLockActor.h"
+#include <memory>
 #include "ChLink_EngineActor.generated.h"
 
+class FChFunctionRecorder;
+class FChEngineTorqueFunction;
+
+namespace chrono {
+	class ChLinkEngine;
+	class ChFunction_Const;
+}
+
 UENUM()
 namespace EEngineMode {
 	enum Type {
@@ -35,6 +44,19 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Chrono|EngineCurve", meta = (editcondition = "bUseEngineCurve"))
 	class UCurveFloat* Curve;
 
+	// Multiplies the curve's torque, parameter sweeps vary this instead of authoring curves
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|EngineCurve", meta = (editcondition = "bUseEngineCurve"))
+	float CurveScale = 1.f;
+
+	// The curve is sampled this many times into a recorder on construction, the step never touches the asset
+	UPROPERTY(EditAnywhere, Category = "Chrono|EngineCurve", meta = (editcondition = "bUseEngineCurve", ClampMin = "2"))
+	int CurveSamples = 256;
+
+	// Torque mode only, the curve goes into the engine's torque function as a table and Chrono reads it at the
+	// speed of every force update, the substeps only pass on the throttle
+	UPROPERTY(EditAnywhere, Category = "Chrono|EngineCurve", meta = (editcondition = "bUseEngineCurve"))
+	bool bEvaluateCurveInSolver = false;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|ExportData", meta = (editcondition = "bExportData"))
 	bool bExportEngineSpeed = false;
 
@@ -43,19 +65,36 @@ public:
 
 	virtual void PhysicsObjectConstruct() override;
 	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override { objList.Add(this); }
+	virtual void LatchPhysicsInput() override { latchedMotion = motion; }
 	UFUNCTION(BlueprintCallable, Category = "Chrono")
 	void SetMotion(float motion);
 	UFUNCTION(BlueprintCallable, Category = "Chrono")
 	void AddMotion(float motion);
 	UFUNCTION(BlueprintPure, Category = "Chrono")
 	float GetMotion() { return motion; }
+	// Sets and latches at once, for the generator's motion buffer after the input is latched
+	FORCEINLINE void LatchMotion(float value) { motion = value; latchedMotion = value; }
 	virtual FExportData ExportData() override;
+	virtual void RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList) override;
+	virtual void WriteTelemetry(FChTelemetry& telemetry) override;
 
 	void ShowDebugMessage();
 
 private:
-	float motion;
+	float motion = 0;
+	float latchedMotion = 0;
 	float engineTorque;
+	// Torque over angular speed, baked from Curve
+	std::shared_ptr<FChFunctionRecorder> torqueCurveData;
+	// Set instead of torqueCurveData with bEvaluateCurveInSolver
+	std::shared_ptr<FChEngineTorqueFunction> solverTorqueFunction;
+	// Typed once on construction, the substeps don't cast
+	std::shared_ptr<chrono::ChLinkEngine> engineLink;
+	// The constant function of the engine mode that takes the motion
+	std::shared_ptr<chrono::ChFunction_Const> motionFunction;
+	int32 engineSpeedChannel = INDEX_NONE;
+	int32 engineTorqueChannel = INDEX_NONE;
 
 
 };
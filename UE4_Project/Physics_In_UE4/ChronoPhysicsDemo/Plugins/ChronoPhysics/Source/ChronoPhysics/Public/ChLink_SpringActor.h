@@ -21,7 +21,15 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Chrono|SpringParameter")
 	float DampCoef = 50;
 
+	// Substepped inside the system step by the scene manager, for springs too stiff for the scene's step
+	UPROPERTY(EditAnywhere, Category = "Chrono|SpringParameter")
+	bool bMultirate = false;
 
 	virtual void PhysicsObjectConstruct() override;
 	virtual void ChLinkInitialize() override;
+	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+
+private:
+	class AChPhysicsSceneManagerActor* multirateScene = nullptr;
 };
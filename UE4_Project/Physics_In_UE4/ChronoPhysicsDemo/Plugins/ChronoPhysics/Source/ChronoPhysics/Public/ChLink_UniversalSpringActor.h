@@ -52,10 +52,14 @@ public:
 
 	AChLink_UniversalSpringActor();
 
+	virtual void PostRegisterAllComponents() override;
+	virtual void PostUnregisterAllComponents() override;
 	virtual void PhysicsObjectConstruct() override;
 	virtual void PhysicsObjectInitalize() override;
 	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
 	virtual void UpdatePhysicsState() override {}
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override {}
 	virtual void UpdateVisualAsset() override {}
 
 protected:
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "ChPhysicsObjectInterface.h"
+#include "ChStaticMeshCollider.h"
+#include <memory>
+#include <vector>
+#include "ChMPMTerrainComponent.generated.h"
+
+namespace chrono {
+	class ChBody;
+	class ChForce;
+	class ChSystem;
+}
+
+namespace ChMPMTerrain {
+	struct FTerrain;
+}
+
+class AVolume;
+class UTextureRenderTarget2D;
+class UMaterialInstanceDynamic;
+
+UENUM()
+namespace EChMPMSoilMaterial {
+	enum Type {
+		// Drucker-Prager plasticity, cohesionless
+		SAND,
+		ELASTIC
+	};
+}
+
+/**
+ * Soil as MPM particles filling a volume actor, stepped on the CUDA device alongside the Chrono step.
+ * The sphere and box bodies of the coupled actors are moving boundaries of the grid, the soil's push on them
+ * comes back as one force and torque per body and is applied on the next step. The particles never come back:
+ * the device writes them into a render target that the particle material offsets its quads by.
+ * Without WITH_CHRONO_CUDA nothing is simulated
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class CHRONOPHYSICS_API UChMPMTerrainComponent : public UProceduralMeshComponent, public IChPhysicsObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	// The particles fill the part of its bounds the volume encompasses
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMTerrain")
+	AVolume* SoilVolume;
+
+	// cm, the grid cells are twice as large
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMTerrain", meta = (ClampMin = "0.5"))
+	float ParticleSpacing = 5.f;
+
+	// Room around the volume the soil can be pushed into, in cm. Its border is a slip wall
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMTerrain")
+	FVector GridPadding = FVector(100.f, 100.f, 100.f);
+
+	// Actors with a sphere or box Chrono body the soil pushes and is pushed by
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMTerrain")
+	TArray<AActor*> CoupledActors;
+
+	// Done with a material that offsets every vertex by its texel of the position texture minus the object position
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMTerrain")
+	UMaterialInterface* ParticleMaterial;
+
+	// Texture parameter of ParticleMaterial that gets the positions, in UE world space, one texel per particle
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMTerrain")
+	FName PositionTextureParameter = TEXT("PositionTexture");
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMSoil")
+	TEnumAsByte<EChMPMSoilMaterial::Type> SoilMaterial = EChMPMSoilMaterial::SAND;
+
+	// kg/m^3
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMSoil")
+	float Density = 1600.f;
+
+	// Pa, the substep shrinks with the square root of it
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMSoil")
+	float YoungModulus = 1e6f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMSoil", meta = (ClampMin = "0.0", ClampMax = "0.49"))
+	float PoissonRatio = 0.3f;
+
+	// Degrees, sand only
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMSoil")
+	float FrictionAngle = 30.f;
+
+	// Between the soil and the coupled bodies
+	UPROPERTY(EditAnywhere, Category = "Chrono|MPMSoil")
+	float BodyFriction = 0.5f;
+
+	UChMPMTerrainComponent();
+
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectInitalize() override;
+	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void UpdatePhysicsState() override;
+	virtual void UpdateVisualAsset() override;
+	virtual bool& GetIsForParallel() override { return isForParallel; }
+	virtual bool& GetIsForSMC() override { return isForSMC; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetParticleCount() const { return particlePositions.Num() / 3; }
+
+protected:
+	void FillVolume();
+	void BuildParticleQuads();
+	void CreatePositionTarget();
+	// Waits for the device and destroys the terrain, the render thread is flushed first
+	void ReleaseTerrain();
+	// Takes the soil loads off the coupled bodies
+	void RemoveSoilForces();
+
+	UPROPERTY(Transient)
+	UTextureRenderTarget2D* PositionTarget;
+
+	UPROPERTY(Transient)
+	UMaterialInstanceDynamic* particleMaterialInstance;
+
+	ChMPMTerrain::FTerrain* terrain = nullptr;
+	chrono::ChSystem* system = nullptr;
+	bool bStepQueued = false;
+
+	bool isForParallel = false;
+	bool isForSMC = false;
+
+	// Chrono frame, uploaded once by AddToSystem
+	TArray<float> particlePositions;
+	// Chrono frame, the grid's lowest node and its size in nodes
+	FVector gridMin;
+	FIntVector gridBins;
+	// UE world space, what the particles can reach
+	FBox gridBounds = FBox(ForceInit);
+
+	std::vector<std::shared_ptr<chrono::ChBody>> coupledBodies;
+	TArray<FChColliderProxy> coupledProxies;
+	// Force then torque per coupled body, the accumulators belong to UChBodyComponent's drag
+	std::vector<std::shared_ptr<chrono::ChForce>> soilForces;
+};
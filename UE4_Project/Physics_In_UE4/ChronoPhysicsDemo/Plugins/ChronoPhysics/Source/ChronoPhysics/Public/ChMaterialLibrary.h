@@ -0,0 +1,130 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include <memory>
+#include "ChMaterialLibrary.generated.h"
+
+namespace chrono {
+	class ChMaterialSurface;
+	class ChSystem;
+}
+
+class UChPhysicalMaterial;
+
+// Combined coefficients for contacts between the owning material and Other, negative keeps Chrono's law
+USTRUCT()
+struct CHRONOPHYSICS_API FChMaterialPair
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialPair")
+	UChPhysicalMaterial* Other = nullptr;
+
+	// Static and sliding friction of the pair
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialPair")
+	float Friction = -1.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialPair")
+	float Restitution = -1.f;
+};
+
+// Contact material shared by every body that uses it, in place of the body component's own parameters
+UCLASS(BlueprintType)
+class CHRONOPHYSICS_API UChPhysicalMaterial : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float StaticFriction = 0.55f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float SlidingFriction = 0.5f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float RollingFriction = 0.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float SpinningFriction = 0.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float Cohension = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float Restitution = 0.5f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float DampingF = 0.2f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float Compliance = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float ComplianceT = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float ComplianceRoll = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameter")
+	float ComplianceSpin = 0.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameterSMC")
+	float YoungModulus = 2e7f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialParameterSMC")
+	float PoissonRatio = 0.3f;
+
+	// Either side of a pair may list it, the later listing wins
+	UPROPERTY(EditAnywhere, Category = "Chrono|MaterialPair")
+	TArray<FChMaterialPair> Pairs;
+};
+
+// The parameters a contact material is built from, also the key it is shared by
+struct CHRONOPHYSICS_API FChMaterialValues
+{
+	float StaticFriction;
+	float SlidingFriction;
+	float RollingFriction;
+	float SpinningFriction;
+	float Cohension;
+	float Restitution;
+	float DampingF;
+	float Compliance;
+	float ComplianceT;
+	float ComplianceRoll;
+	float ComplianceSpin;
+	float YoungModulus;
+	float PoissonRatio;
+
+	static FChMaterialValues FromAsset(const UChPhysicalMaterial& material);
+};
+
+/**
+ * Chrono materials built once per asset or distinct set of parameters and shared by reference, so a scene
+ * holds one material object per kind instead of one per body. The pair table holds the assets' explicit pair
+ * overrides only, keyed by the two assets; the serial systems look a contact's two materials up in it from
+ * the contact container's add contact callback, every other pair combines by Chrono's min() laws. Materials
+ * are held by their bodies only and go with the last of them
+ */
+class CHRONOPHYSICS_API FChMaterialLibrary
+{
+public:
+	// Thread safe. An NSC or SMC material for the contact method
+	static std::shared_ptr<chrono::ChMaterialSurface> Find(const FChMaterialValues& values, bool bSMC);
+	static std::shared_ptr<chrono::ChMaterialSurface> Find(const UChPhysicalMaterial* material, bool bSMC);
+
+	// Changes whenever a material or a pair joins the table
+	static uint32 GetRevision();
+
+	// Gives the system a composition strategy and contact callback over a copy of the current table, contacts
+	// between materials built later combine by Chrono's laws until the next call. The parallel systems have no
+	// contact callback, there the overrides are keyed by coefficient values. Not while the system steps
+	static void ApplyComposition(chrono::ChSystem* system);
+
+	static int32 GetMaterialNum();
+
+private:
+	// Under the library lock, asset is null for the materials built from parameters
+	static std::shared_ptr<chrono::ChMaterialSurface> FindLocked(const FString& key, const FChMaterialValues& values, bool bSMC, const UChPhysicalMaterial* asset);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChMatterSPH.h"
+#include <vector>
+
+/**
+ * ChMatterSPH that finds its neighbours in a uniform grid instead of through the collision system and a
+ * ChProximityContainerSPH. The particles are counting sorted into hashed cells of one kernel radius every
+ * force evaluation and the density and force passes run in parallel over particles on copies of their state
+ * in separate arrays. Same kernels as Chrono's container and no container is needed. The nodes still collide
+ * with bodies through the collision system, their family masks off the node pairs the grid already handles
+ */
+class CHRONOPHYSICS_API FChMatterSPHGrid : public chrono::ChMatterSPH
+{
+public:
+	FChMatterSPHGrid();
+
+	virtual FChMatterSPHGrid* Clone() const override { return new FChMatterSPHGrid(*this); }
+
+	virtual void IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c) override;
+	virtual void VariablesFbLoadForces(double factor = 1) override;
+	virtual void AddCollisionModelsToSystem() override;
+
+	// Before the matter is added to the system; bodies in this family don't touch the nodes either
+	FORCEINLINE void SetNodeFamily(int32 family) { nodeFamily = family; }
+	FORCEINLINE int32 GetNodeFamily() const { return nodeFamily; }
+
+	// Neighbour pairs within the kernel radius in the last evaluation, each pair counted from both sides
+	FORCEINLINE int64 GetLastNeighborCount() const { return lastNeighborCount; }
+
+private:
+	// Fills forceX/Y/Z with pressure, viscosity and user forces, without gravity
+	void ComputeForces();
+	void GatherState();
+	void BuildGrid();
+
+	std::vector<chrono::ChNodeSPH*> nodeList;
+	double kernelRadius = 0;
+	int32 nodeFamily = 14;
+
+	// Particle state, indexed like nodeList
+	std::vector<double> posX, posY, posZ;
+	std::vector<double> velX, velY, velZ;
+	std::vector<double> mass;
+	std::vector<double> density;
+	std::vector<double> pressure;
+	std::vector<double> forceX, forceY, forceZ;
+
+	// Counting sort of the particles by cell, cellStart has one more entry than there are cells
+	std::vector<int32> particleCell;
+	std::vector<int32> cellStart;
+	std::vector<int32> sortedParticles;
+	uint32 cellMask = 0;
+
+	int64 lastNeighborCount = 0;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace chrono {
+	class ChSystem;
+}
+
+namespace EChMemoryCategory {
+	enum Type {
+		Bodies,
+		Contacts,
+		CollisionShapes,
+		Descriptor,
+		ParallelData,
+		Num
+	};
+}
+
+/**
+ * Bytes held by one Chrono system, per category, with the high water mark of each since the last reset.
+ * Chrono is linked prebuilt, so its allocators can't be hooked; the bytes are the sizes of the containers
+ * and objects the categories are made of, read from their counts and capacities. Bodies with their
+ * collision models and variables, contact objects and Bullet's manifolds, the Bullet shapes (shared ones
+ * counted once), the descriptor's lists and the state vectors stepping sizes them to, and all host
+ * vectors and matrices of the parallel data manager
+ */
+class CHRONOPHYSICS_API FChMemoryStats
+{
+public:
+	// Shapes don't change between steps, they are walked again only when bFull or the body count changed
+	void Measure(chrono::ChSystem& system, bool bFull);
+	void Reset();
+
+	FORCEINLINE SIZE_T GetBytes(EChMemoryCategory::Type category) const { return bytes[category]; }
+	FORCEINLINE SIZE_T GetPeakBytes(EChMemoryCategory::Type category) const { return peakBytes[category]; }
+	SIZE_T GetTotalBytes() const;
+	static const TCHAR* GetCategoryName(EChMemoryCategory::Type category);
+
+	// One line per category, current and peak in MB
+	void Log(const FString& owner) const;
+
+private:
+	SIZE_T bytes[EChMemoryCategory::Num] = {};
+	SIZE_T peakBytes[EChMemoryCategory::Num] = {};
+	int32 measuredBodyNum = INDEX_NONE;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace ChMortonOrder {
+	// Spreads the low 21 bits of v so that two zero bits follow each bit
+	FORCEINLINE uint64 SpreadBits(uint64 v)
+	{
+		v &= 0x1fffff;
+		v = (v | v << 32) & 0x1f00000000ffff;
+		v = (v | v << 16) & 0x1f0000ff0000ff;
+		v = (v | v << 8) & 0x100f00f00f00f00f;
+		v = (v | v << 4) & 0x10c30c30c30c30c3;
+		v = (v | v << 2) & 0x1249249249249249;
+		return v;
+	}
+
+	// 63 bit Morton code of location inside bounds
+	FORCEINLINE uint64 Encode(const FVector& location, const FBox& bounds)
+	{
+		FVector size = bounds.GetSize();
+		FVector local = location - bounds.Min;
+		uint64 x = size.X > 0 ? (uint64)FMath::Clamp(local.X / size.X * 2097151.f, 0.f, 2097151.f) : 0;
+		uint64 y = size.Y > 0 ? (uint64)FMath::Clamp(local.Y / size.Y * 2097151.f, 0.f, 2097151.f) : 0;
+		uint64 z = size.Z > 0 ? (uint64)FMath::Clamp(local.Z / size.Z * 2097151.f, 0.f, 2097151.f) : 0;
+		return SpreadBits(x) | SpreadBits(y) << 1 | SpreadBits(z) << 2;
+	}
+
+	// Indices of locations, ordered along the Morton curve of their common bounds
+	inline TArray<int32> SortedIndices(const TArray<FVector>& locations)
+	{
+		FBox bounds(locations);
+		TArray<uint64> codes;
+		TArray<int32> order;
+		codes.Reserve(locations.Num());
+		order.Reserve(locations.Num());
+		for (int32 i = 0; i < locations.Num(); i++) {
+			codes.Add(Encode(locations[i], bounds));
+			order.Add(i);
+		}
+		order.StableSort([&codes](int32 a, int32 b) { return codes[a] < codes[b]; });
+		return order;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChPhysicsItem.h"
+#include <memory>
+#include <vector>
+
+namespace chrono {
+	class ChBody;
+	class ChLinkSpring;
+}
+
+/**
+ * Stiff springs integrated at a fraction of the system step. Before each step Advance substeps the spring
+ * bodies' translation on their own, with the rest of the system's pull on each body taken from its last
+ * acceleration and extrapolated over the step. The time averaged spring forces go into the system step as
+ * applied forces, so the springs no longer force the whole system down to their stable step. The springs'
+ * own links stay in the system for their markers and visuals, with their stiffness and damping zeroed
+ */
+class CHRONOPHYSICS_API FChMultirateSprings : public chrono::ChPhysicsItem
+{
+public:
+	virtual FChMultirateSprings* Clone() const override { return new FChMultirateSprings(*this); }
+
+	// The link must be initialized, its markers give the attachment points and its rest length is kept
+	void AddSpring(std::shared_ptr<chrono::ChLinkSpring> link, double stiffness, double damping);
+	void RemoveSpring(chrono::ChLinkSpring* link);
+	FORCEINLINE int32 GetSpringNum() const { return (int32)springs.size(); }
+
+	void SetSubsteps(int32 inSubsteps) { substeps = FMath::Max(inSubsteps, 1); }
+	FORCEINLINE int32 GetSubsteps() const { return substeps; }
+
+	// Before the system step of stepSize, on the thread that steps
+	void Advance(double stepSize);
+
+	virtual void IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c) override;
+	virtual void VariablesFbLoadForces(double factor = 1) override;
+
+private:
+	struct FSpring
+	{
+		std::shared_ptr<chrono::ChLinkSpring> Link;
+		int32 Body1;
+		int32 Body2;
+		// Body frames
+		chrono::ChVector<> Point1;
+		chrono::ChVector<> Point2;
+		double RestLength;
+		double Stiffness;
+		double Damping;
+	};
+
+	struct FSpringBody
+	{
+		chrono::ChBody* Body;
+		int32 SpringCount;
+		// Everything but these springs, from the last two steps
+		chrono::ChVector<> CouplingAcceleration;
+		chrono::ChVector<> LastCouplingAcceleration;
+		bool bHasCoupling;
+		// World frame, averaged over the last Advance
+		chrono::ChVector<> Force;
+		chrono::ChVector<> Torque;
+	};
+
+	int32 FindOrAddBody(chrono::ChBody* body);
+
+	std::vector<FSpring> springs;
+	std::vector<FSpringBody> bodies;
+	int32 substeps = 5;
+
+	// Substep state, indexed like bodies
+	std::vector<chrono::ChVector<>> positions;
+	std::vector<chrono::ChVector<>> velocities;
+	std::vector<chrono::ChVector<>> forces;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ChNetReplicationComponent.generated.h"
+
+class AChPhysicsSceneManagerActor;
+
+/**
+ * The channel of one client for the Chrono snapshots of a replicating scene manager. The server adds it to
+ * every remote player controller, so each connection gets its own snapshots against its own acknowledged
+ * baseline; snapshots and acknowledgements are unreliable, a lost one is covered by the next
+ */
+UCLASS(ClassGroup = (Custom))
+class CHRONOPHYSICS_API UChNetReplicationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UChNetReplicationComponent();
+
+	UFUNCTION(Client, Unreliable)
+	void ClientReceiveSnapshot(const TArray<uint8>& data);
+
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerAckSnapshot(int32 sequence);
+
+	FORCEINLINE int32 GetAckedSequence() const { return ackedSequence; }
+
+	TWeakObjectPtr<AChPhysicsSceneManagerActor> Scene;
+
+private:
+	// Server side, the newest snapshot the client decoded
+	int32 ackedSequence = INDEX_NONE;
+};
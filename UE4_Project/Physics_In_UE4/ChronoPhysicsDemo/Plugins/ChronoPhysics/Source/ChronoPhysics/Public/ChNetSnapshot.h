@@ -0,0 +1,88 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+class UChBodyComponent;
+
+// A body pose on the wire: position in steps of the resolution, rotation as the smallest three components
+struct FChNetPose
+{
+	int32 Position[3] = { 0, 0, 0 };
+	uint32 Rotation = 0;
+
+	FORCEINLINE bool operator==(const FChNetPose& other) const
+	{
+		return Position[0] == other.Position[0] && Position[1] == other.Position[1] && Position[2] == other.Position[2] && Rotation == other.Rotation;
+	}
+	FORCEINLINE bool operator!=(const FChNetPose& other) const { return !(*this == other); }
+};
+
+// The poses of all replicated bodies at one server time, indexed like the replicator's bodies
+struct FChNetFrame
+{
+	int32 Sequence = INDEX_NONE;
+	double Time = 0;
+	TArray<FChNetPose> Poses;
+};
+
+class CHRONOPHYSICS_API FChNetSnapshotCodec
+{
+public:
+	// Resolution in UE units
+	static FChNetPose Quantize(const FVector& location, const FQuat& rotation, float resolution);
+	static void Dequantize(const FChNetPose& pose, float resolution, FVector& outLocation, FQuat& outRotation);
+
+	// 2 bits for the largest component, 10 bits for each of the other three
+	static uint32 PackRotation(const FQuat& rotation);
+	static FQuat UnpackRotation(uint32 packed);
+
+	// Only the bodies whose pose differs from the baseline are written, a null baseline is all identities at the origin
+	static void Encode(const FChNetFrame& frame, const FChNetFrame* baseline, uint32 layoutHash, TArray<uint8>& outData);
+	// Reads the baseline sequence first and asks findBaseline for it. False when the layout differs or the baseline is gone
+	static bool Decode(const TArray<uint8>& data, uint32 layoutHash, int32 bodyNum, TFunctionRef<const FChNetFrame*(int32)> findBaseline, FChNetFrame& outFrame);
+};
+
+/**
+ * Server authoritative replication of the body poses of one scene. The server captures a frame at the send rate
+ * and encodes it for each client against the last frame that client acknowledged, so a body that didn't move
+ * since, a sleeping one in particular, costs nothing and the bandwidth goes with the moving bodies. Clients keep
+ * the frames they decoded as the baselines and render a fixed delay behind the newest one, interpolating between
+ * the two frames around it. Bodies are matched by their component's path name, so server and client must load the
+ * same level; the layout hash in every snapshot makes a client drop snapshots of a different body set
+ */
+class CHRONOPHYSICS_API FChNetReplicator
+{
+public:
+	static constexpr int32 HistorySize = 32;
+
+	// Fixed and kinematic bodies are left out, every machine knows their pose
+	void SetBodies(const TArray<UChBodyComponent*>& bodies);
+	FORCEINLINE int32 GetBodyNum() const { return bodies.Num(); }
+
+	// Server, game thread after the step was joined
+	void Capture(double time, float resolution);
+	// The newest captured frame against the client's acknowledged one, or against nothing
+	bool EncodeLatest(int32 ackedSequence, TArray<uint8>& outData) const;
+
+	// Client, false when the snapshot can't be decoded or is older than the newest one
+	bool Receive(const TArray<uint8>& data, int32& outSequence);
+	// Moves the render clock by deltaTime and gives the bodies their interpolated poses
+	void Apply(float deltaTime, float delay, float resolution);
+
+private:
+	const FChNetFrame* FindFrame(int32 sequence) const;
+	FChNetFrame& AddFrame();
+
+	TArray<UChBodyComponent*> bodies;
+	uint32 layoutHash = 0;
+	// Ring of the last frames sent or received, newest at historyHead
+	FChNetFrame history[HistorySize];
+	int32 historyHead = INDEX_NONE;
+	int32 nextSequence = 0;
+
+	double renderTime = -1;
+	// What each body was last given on the client, so bodies at rest aren't touched every frame
+	TArray<FChNetPose> appliedPoses;
+	TBitArray<> appliedValid;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "ChStateRecording.h"
+
+class FChTelemetry;
+
+/**
+ * Full rate telemetry to a recording file without the step touching the disk. The physics step copies
+ * every decimation-th frame into a single producer, single consumer ring, a writer thread appends what is
+ * there to the chunked, compressed FChStateRecordWriter. A full ring drops the frame and counts it,
+ * the step never waits for a slow disk
+ */
+class CHRONOPHYSICS_API FChOutputPipeline : public FRunnable
+{
+public:
+	// Opens the file on the calling thread, the layout must not change while the pipeline runs
+	FChOutputPipeline(const FString& filePath, const FChTelemetry& layout, int32 framesPerChunk, int32 ringFrames, int32 inDecimation);
+	virtual ~FChOutputPipeline();
+
+	FORCEINLINE bool IsOpen() const { return thread != nullptr; }
+	// Producer side, one thread only. frame is GetFrameWidth floats
+	void Push(float time, const float* frame);
+
+	FORCEINLINE int32 GetDroppedFrames() const { return droppedFrames.GetValue(); }
+	FORCEINLINE int32 GetWrittenFrames() const { return writtenFrames.GetValue(); }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	// Writer thread, everything pushed so far
+	void DrainRing();
+
+	FChStateRecordWriter writer;
+	int32 frameWidth = 0;
+	int32 capacity = 0;
+	int32 decimation = 1;
+	int32 stepCount = 0;
+
+	TArray<float> ring;
+	TArray<float> ringTimes;
+	// Monotonic, the slot is the count modulo the capacity. Only the producer adds to pushed, only the writer to popped
+	FThreadSafeCounter pushed;
+	FThreadSafeCounter popped;
+	FThreadSafeCounter droppedFrames;
+	FThreadSafeCounter writtenFrames;
+
+	TArray<float> drainFrames;
+	TArray<float> drainTimes;
+
+	FThreadSafeCounter stopping;
+	FEvent* wakeEvent = nullptr;
+	FRunnableThread* thread = nullptr;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChContactContainerSMC.h"
+#include <memory>
+
+namespace chrono {
+	class ChBody;
+}
+
+/**
+ * Spans over the packed contacts of one step, Num entries each, Chrono units and world frame. Bodies is indexed
+ * by BodyA and BodyB. The material columns hold each pair's composite and may be overwritten by a batch callback,
+ * the forces are computed from whatever is there afterwards
+ */
+struct CHRONOPHYSICS_API FChContactBatch
+{
+	int32 Num = 0;
+	int32 BodyNum = 0;
+	chrono::ChBody* const* Bodies = nullptr;
+	const int32* BodyA = nullptr;
+	const int32* BodyB = nullptr;
+	const double* PointA[3] = {};
+	const double* PointB[3] = {};
+	// From A to B
+	const double* Normal[3] = {};
+	const double* Overlap = nullptr;
+	const double* EffRadius = nullptr;
+	float* YoungModulus = nullptr;
+	float* ShearModulus = nullptr;
+	float* Friction = nullptr;
+	float* Restitution = nullptr;
+	float* Adhesion = nullptr;
+	float* StiffnessN = nullptr;
+	float* StiffnessT = nullptr;
+	float* DampingN = nullptr;
+	float* DampingT = nullptr;
+	// World force on B once the step computed it, null inside the callback
+	const double* Force[3] = {};
+};
+
+// Once per step with every packed contact, after the collision and before the forces. Free to split the
+// work over ParallelFor; replaces a per contact AddContactCallback for material overrides
+class CHRONOPHYSICS_API FChContactBatchCallback
+{
+public:
+	virtual ~FChContactBatchCallback() {}
+	virtual void OnContactBatch(FChContactBatch& batch) = 0;
+};
+
+/**
+ * SMC contact container of the serial system that keeps rigid body contacts in flat per field arrays
+ * instead of ChContactSMC objects. EndAddContact computes the Hooke, Hertz or Coulomb forces of all packed
+ * contacts in parallel, same laws as ChContactSMC, then sums them per body over the contacts sorted by body,
+ * one segment per body and no atomics, so the residual load is one add per body instead of two per contact.
+ * Contacts of particles and meshes, and every contact when stiff contacts need Jacobians, go to the base
+ * container as before
+ */
+class CHRONOPHYSICS_API FChPackedContactContainerSMC : public chrono::ChContactContainerSMC
+{
+public:
+	virtual FChPackedContactContainerSMC* Clone() const override { return new FChPackedContactContainerSMC(*this); }
+
+	// The system's own strategy is out of reach of containers, Chrono's min() laws unless one is set here
+	void SetCompositionStrategy(std::shared_ptr<chrono::ChMaterialCompositionStrategy<float>> strategy) { compositionStrategy = strategy; }
+
+	// Runs after the per contact AddContactCallback, so it sees and can replace its changes
+	void SetContactBatchCallback(std::shared_ptr<FChContactBatchCallback> callback) { batchCallback = callback; }
+	// The packed contacts of the last step with their forces, valid until the next collision. Contacts of the
+	// base container are only in ReportAllContacts
+	FChContactBatch GetContactBatch();
+
+	virtual int GetNcontacts() const override { return ChContactContainerSMC::GetNcontacts() + contactNum; }
+	FORCEINLINE int32 GetPackedContactNum() const { return contactNum; }
+	// Bytes held by the packed arrays, capacity rather than use
+	SIZE_T GetAllocatedSize() const;
+
+	virtual void RemoveAllContacts() override;
+	virtual void BeginAddContact() override;
+	virtual void AddContact(const chrono::collision::ChCollisionInfo& mcontact) override;
+	virtual void EndAddContact() override;
+	virtual void ReportAllContacts(ReportContactCallback* mcallback) override;
+	virtual void ComputeContactForces() override;
+
+	virtual void IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c) override;
+	virtual void ConstraintsFbLoadForces(double factor) override;
+
+private:
+	int32 FindOrAddBody(chrono::ChBody* body);
+	FChContactBatch MakeBatch(bool bWithForces);
+	void ComputeForces();
+	void ReduceForces();
+
+	std::shared_ptr<chrono::ChMaterialCompositionStrategy<float>> compositionStrategy;
+	std::shared_ptr<FChContactBatchCallback> batchCallback;
+
+	// Contacts, one entry per field
+	int32 contactNum = 0;
+	TArray<int32> bodyA;
+	TArray<int32> bodyB;
+	TArray<double> pointA[3];
+	TArray<double> pointB[3];
+	TArray<double> normal[3];
+	TArray<double> overlap;
+	TArray<double> effRadius;
+	TArray<double> effMass;
+	// Composite material, reduced to the coefficients of the contact model
+	TArray<float> youngModulus;
+	TArray<float> shearModulus;
+	TArray<float> friction;
+	TArray<float> restitution;
+	TArray<float> adhesion;
+	TArray<float> stiffnessN;
+	TArray<float> stiffnessT;
+	TArray<float> dampingN;
+	TArray<float> dampingT;
+	// World force on B, A takes the opposite
+	TArray<double> force[3];
+
+	// Bodies of the packed contacts, per body totals in world frame, torques about the center of mass
+	TArray<chrono::ChBody*> bodies;
+	TMap<chrono::ChBody*, int32> bodyIndices;
+	TArray<chrono::ChVector<>> bodyForces;
+	TArray<chrono::ChVector<>> bodyTorques;
+	// Both ends of every contact sorted by body, each body's ends are bodySegments[i] to bodySegments[i + 1]
+	TArray<int32> bodySegments;
+	TArray<int32> sortedEnds;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChSystem.h"
+#include <vector>
+
+namespace chrono {
+	class ChSystemNSC;
+	class ChSystemSMC;
+}
+
+/**
+ * Serial system whose residual and constraint loads run in parallel over its items instead of one item
+ * after the other. Bodies, and for M*v and C every item, only write their own rows and go straight into
+ * the output. Links, meshes and other items can add forces to any body's rows, so they go into per thread
+ * partial vectors summed at the end. The contact container still loads on the calling thread.
+ * Instantiated for ChSystemNSC and ChSystemSMC
+ */
+template <class TSystem>
+class TChParallelResidualSystem : public TSystem
+{
+public:
+	virtual TChParallelResidualSystem* Clone() const override { return new TChParallelResidualSystem(*this); }
+
+	// Partial vectors of the forces pass, items below the threshold load serially like Chrono does
+	void SetPartialCount(int32 count) { partialCount = FMath::Max(count, 1); }
+
+	virtual void IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c) override;
+	virtual void IntLoadResidual_Mv(const unsigned int off, chrono::ChVectorDynamic<>& R, const chrono::ChVectorDynamic<>& w, const double c) override;
+	virtual void IntLoadConstraint_C(const unsigned int off, chrono::ChVectorDynamic<>& Qc, const double c, bool do_clamp, double recovery_clamp) override;
+
+private:
+	// Active items other than bodies, rebuilt every call, the lists change between steps
+	void GatherCouplingItems();
+	bool IsWorthParallel() const;
+
+	int32 partialCount = 1;
+	std::vector<chrono::ChPhysicsItem*> couplingItems;
+	std::vector<chrono::ChVectorDynamic<>> partials;
+};
+
+typedef TChParallelResidualSystem<chrono::ChSystemNSC> FChParallelResidualSystemNSC;
+typedef TChParallelResidualSystem<chrono::ChSystemSMC> FChParallelResidualSystemSMC;
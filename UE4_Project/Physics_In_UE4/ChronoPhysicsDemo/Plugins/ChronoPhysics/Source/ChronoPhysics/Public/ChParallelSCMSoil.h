@@ -0,0 +1,150 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/core/ChVector.h"
+#include <memory>
+#include <vector>
+
+class btCollisionObject;
+class btCollisionShape;
+
+namespace chrono {
+	class ChBody;
+	class ChForce;
+	class ChSystem;
+}
+
+// SCM soil parameters in Chrono units, as SCMDeformableTerrain::SetSoilParametersSCM takes them
+struct FChSCMSoilParameters
+{
+	double BekkerKphi = 2e6;
+	double BekkerKc = 0;
+	double BekkerN = 1.1;
+	// Pa
+	double MohrCohesion = 0;
+	// Degrees
+	double MohrFriction = 30;
+	// m
+	double JanosiShear = 0.01;
+	double ElasticK = 2e8;
+	double DampingR = 3e4;
+	// How far above the soil a body is still looked for, m
+	double TestHighOffset = 0.1;
+};
+
+/**
+ * SCM soil on a flat regular grid, computed on the plugin side in place of SCMDeformableSoil::ComputeInternalForces,
+ * which walks every vertex serially each step. The grid is split into coarse cells of CellVertices x CellVertices
+ * vertices and every step bins the colliding bodies over the cells their bounds cover, so only the cells under a
+ * body, or under one last step, are visited and a vertex is only ray tested against the shapes of its cell. The
+ * cells go out to tasks in fixed groups, each with its own force, torque and contact area accumulators per body,
+ * reduced in task order after the pass, so the loads don't depend on the thread count. A vertex hit below its
+ * level sinks elastic-plastic along the Bekker curve, with vertical damping, and shears by Mohr-Coulomb with the
+ * Janosi-Hanamoto displacement; the Bekker width is the half square root of the body's contact area. The loads
+ * go to the bodies as ChForces at the center of mass and hold for the next step. No bulldozing and no refinement,
+ * GImpact meshes are not tested. Y up, the grid's own frame may be turned about Y
+ */
+class CHRONOPHYSICS_API FChParallelSCMSoil
+{
+public:
+	static constexpr int32 CellVertices = 16;
+
+	~FChParallelSCMSoil();
+
+	// Row major, divX + 1 vertices per row, at the soil's initial level. The faces only give the vertex areas
+	void Initialize(const std::vector<chrono::ChVector<>>& inVertices, const std::vector<chrono::ChVector<int>>& faces, int32 divX, int32 divY,
+		const FChSCMSoilParameters& parameters);
+	// Loads for the coming step, from the bodies of the system where the last one left them
+	void Step(chrono::ChSystem* system, double stepSize);
+	// Takes the loads off the bodies
+	void Release();
+
+	// Current surface, Chrono frame
+	FORCEINLINE const std::vector<chrono::ChVector<>>& GetVertices() const { return vertices; }
+	FORCEINLINE int32 GetTouchedVertexNum() const { return touchedNum; }
+	FORCEINLINE int32 GetActiveCellNum() const { return activeCells.Num(); }
+
+private:
+	// A convex, mesh or heightfield shape of a body, compounds are flattened so the ray tests only read them
+	struct FLeaf
+	{
+		const btCollisionShape* Shape;
+		// Relative to the body frame, 3x4 row major
+		double Transform[12];
+	};
+
+	struct FCandidate
+	{
+		chrono::ChBody* Body;
+		btCollisionObject* Object;
+		int32 FirstLeaf;
+		int32 LeafNum;
+		int32 Load;
+	};
+
+	struct FLeafPose
+	{
+		const btCollisionShape* Shape;
+		double Transform[12];
+		double Min[3];
+		double Max[3];
+	};
+
+	struct FLoad
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		std::shared_ptr<chrono::ChForce> Force;
+		std::shared_ptr<chrono::ChForce> Torque;
+	};
+
+	// Reused between steps, sized candidates per task
+	struct FAccumulator
+	{
+		chrono::ChVector<> Force;
+		chrono::ChVector<> Torque;
+		double Area = 0;
+	};
+
+	void GatherCandidates(chrono::ChSystem* system);
+	const TArray<FLeaf>& FindLeaves(const btCollisionShape* root);
+	void BinCandidates();
+	// Vertex range of the cells, false when the box misses the grid
+	bool GridRange(double boxMinX, double boxMinZ, double boxMaxX, double boxMaxZ, int32& outCellX0, int32& outCellY0, int32& outCellX1, int32& outCellY1) const;
+	// Lowest hit of the vertex's vertical among the cell's candidates, INDEX_NONE for none below the test height
+	int32 CastVertex(int32 vertex, const TArray<int32>& cellList, double& outHitLevel) const;
+	void SolveVertex(int32 vertex, int32 candidate, double level, double stepSize, const TArray<double>& bekkerWidths, FAccumulator* taskAccumulators);
+	int32 FindLoad(const std::shared_ptr<chrono::ChBody>& body);
+
+	FChSCMSoilParameters params;
+	int32 vertexX = 0;
+	int32 vertexY = 0;
+	int32 cellX = 0;
+	int32 cellY = 0;
+	// XZ of vertex 0, and the inverse of the two grid steps, for mapping points to grid coordinates
+	double originX = 0, originZ = 0;
+	double inverse[4] = { 0, 0, 0, 0 };
+	double minX = 0, minZ = 0, maxX = 0, maxZ = 0;
+	double maxLevel = 0;
+
+	std::vector<chrono::ChVector<>> vertices;
+	std::vector<double> levelInitial;
+	std::vector<double> sinkagePlastic;
+	std::vector<double> kShear;
+	std::vector<double> area;
+	std::vector<uint8> touched;
+	// Per step, first pass to second
+	std::vector<int32> hitCandidate;
+	std::vector<double> hitLevel;
+
+	TArray<FCandidate> candidates;
+	TArray<FLeafPose> leafPoses;
+	TMap<const btCollisionShape*, TArray<FLeaf>> leafCache;
+	TArray<TArray<int32>> cellCandidates;
+	std::vector<uint8> cellTouched;
+	TArray<int32> activeCells;
+	TArray<FAccumulator> accumulators;
+
+	TArray<FLoad> loads;
+	TMap<chrono::ChBody*, int32> loadIndices;
+	int32 touchedNum = 0;
+};
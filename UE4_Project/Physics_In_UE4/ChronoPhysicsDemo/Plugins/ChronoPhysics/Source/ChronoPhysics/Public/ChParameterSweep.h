@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChParameterSweep.generated.h"
+
+// One run of a parameter sweep, the values without their override keep what the scene was built with
+USTRUCT(BlueprintType)
+struct CHRONOPHYSICS_API FChSweepVariant
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep")
+	FString Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep", meta = (InlineEditConditionToggle))
+	bool bOverrideStaticFriction = false;
+
+	// Every body in the system
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep", meta = (editcondition = "bOverrideStaticFriction"))
+	float StaticFriction = 0.55f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep", meta = (InlineEditConditionToggle))
+	bool bOverrideSlidingFriction = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep", meta = (editcondition = "bOverrideSlidingFriction"))
+	float SlidingFriction = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep", meta = (InlineEditConditionToggle))
+	bool bOverrideRestitution = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep", meta = (editcondition = "bOverrideRestitution"))
+	float Restitution = 0.5f;
+
+	// Multiplies the torque curve of every engine in curve mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Sweep")
+	float EngineCurveScale = 1.f;
+};
+
+// What a variant ended with: the last telemetry frame, laid out like the scene manager's frames
+USTRUCT(BlueprintType)
+struct CHRONOPHYSICS_API FChSweepResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Sweep")
+	FString Name;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Sweep")
+	float SimulatedTime = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Sweep")
+	float WallSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Sweep")
+	TArray<float> FinalFrame;
+};
+
+namespace ChParameterSweep {
+	// A json array of FChSweepVariant objects, field names as in the struct
+	CHRONOPHYSICS_API bool LoadVariants(const FString& filePath, TArray<FChSweepVariant>& outVariants);
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChPhysicsItem.h"
+#include "chrono/physics/ChContactable.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/physics/ChMaterialSurface.h"
+#include "chrono/collision/ChCCollisionModel.h"
+#include "chrono/collision/ChCCollisionInfo.h"
+#include "chrono/solver/ChVariablesBodySharedMass.h"
+#include <memory>
+#include <vector>
+
+class FChParticleCloud;
+
+// Collision model of a cloud particle, holds no shape, the cloud generates the particle's contacts itself
+class CHRONOPHYSICS_API FChCloudCollisionModel : public chrono::collision::ChCollisionModel
+{
+public:
+	FChParticleCloud* Cloud = nullptr;
+	int32 Index = 0;
+
+	virtual int ClearModel() override { return 1; }
+	virtual int BuildModel() override { return 1; }
+	virtual bool AddSphere(double radius, const chrono::ChVector<>& pos) override { return false; }
+	virtual bool AddEllipsoid(double rx, double ry, double rz, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddBox(double hx, double hy, double hz, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddCylinder(double rx, double rz, double hy, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddCone(double rx, double rz, double hy, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddCapsule(double radius, double hlen, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddRoundedBox(double hx, double hy, double hz, double sphere_r, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddRoundedCylinder(double rx, double rz, double hy, double sphere_r, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddRoundedCone(double rx, double rz, double hy, double sphere_r, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddConvexHull(const std::vector<chrono::ChVector<double>>& pointlist, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddTriangleMesh(std::shared_ptr<chrono::geometry::ChTriangleMesh> trimesh, bool is_static, bool is_convex, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot, double sphereswept_thickness) override { return false; }
+	virtual bool AddBarrel(double Y_low, double Y_high, double R_vert, double R_hor, double R_offset, const chrono::ChVector<>& pos, const chrono::ChMatrix33<>& rot) override { return false; }
+	virtual bool AddCopyOfAnotherModel(chrono::collision::ChCollisionModel* another) override { return false; }
+	virtual void SyncPosition() override {}
+	virtual void GetAABB(chrono::ChVector<>& bbmin, chrono::ChVector<>& bbmax) const override;
+	virtual chrono::ChPhysicsItem* GetPhysicsItem() override;
+};
+
+// Contact side of one cloud particle, reads and writes the cloud's arrays at its index
+class CHRONOPHYSICS_API FChCloudParticle : public chrono::ChContactable_1vars<6>
+{
+public:
+	FChParticleCloud* Cloud = nullptr;
+	int32 Index = 0;
+
+	virtual chrono::ChVariables* GetVariables1() override;
+	virtual bool IsContactActive() override { return true; }
+	virtual int ContactableGet_ndof_x() override { return 7; }
+	virtual int ContactableGet_ndof_w() override { return 6; }
+	virtual void ContactableGetStateBlock_x(chrono::ChState& x) override;
+	virtual void ContactableGetStateBlock_w(chrono::ChStateDelta& w) override;
+	virtual void ContactableIncrementState(const chrono::ChState& x, const chrono::ChStateDelta& dw, chrono::ChState& x_new) override;
+	virtual std::shared_ptr<chrono::ChMaterialSurface>& GetMaterialSurfaceBase() override;
+	virtual chrono::ChVector<> GetContactPoint(const chrono::ChVector<>& loc_point, const chrono::ChState& state_x) override;
+	virtual chrono::ChVector<> GetContactPointSpeed(const chrono::ChVector<>& loc_point, const chrono::ChState& state_x, const chrono::ChStateDelta& state_w) override;
+	virtual chrono::ChVector<> GetContactPointSpeed(const chrono::ChVector<>& abs_point) override;
+	virtual chrono::ChCoordsys<> GetCsysForCollisionModel() override;
+	virtual void ContactForceLoadResidual_F(const chrono::ChVector<>& F, const chrono::ChVector<>& abs_point, chrono::ChVectorDynamic<>& R) override;
+	virtual void ContactForceLoadQ(const chrono::ChVector<>& F, const chrono::ChVector<>& point, const chrono::ChState& state_x, chrono::ChVectorDynamic<>& Q, int offset) override;
+	virtual void ComputeJacobianForContactPart(const chrono::ChVector<>& abs_point, chrono::ChMatrix33<>& contact_plane,
+		type_constraint_tuple& jacobian_tuple_N, type_constraint_tuple& jacobian_tuple_U, type_constraint_tuple& jacobian_tuple_V, bool second) override;
+	virtual double GetContactableMass() override;
+	virtual chrono::ChPhysicsItem* GetPhysicsItem() override;
+};
+
+/**
+ * Identical sphere grains kept as arrays instead of one ChAparticle with its own variables, collision model
+ * and frame per grain. Positions, rotations and velocities are contiguous, the inertia is shared, and the
+ * variables and contactables are two arrays allocated once for the whole cloud. There are no Bullet objects
+ * per grain: as the system's custom collision callback the cloud bins the grains into a hashed grid for the
+ * grain pairs and tests one reused sphere against the Bullet world for everything else.
+ * Add it with AChPhysicsSceneManagerActor::AddParticleCloud, which also registers the callback
+ */
+class CHRONOPHYSICS_API FChParticleCloud : public chrono::ChPhysicsItem, public chrono::ChSystem::CustomCollisionCallback
+{
+public:
+	FChParticleCloud();
+	FChParticleCloud(const FChParticleCloud& other);
+
+	virtual FChParticleCloud* Clone() const override { return new FChParticleCloud(*this); }
+
+	// Reallocates every array, only before the cloud is added to a system
+	void SetParticles(const std::vector<chrono::ChVector<>>& inPositions);
+	FORCEINLINE int32 GetParticleNum() const { return (int32)positions.size(); }
+
+	// Keeps the density, the mass follows the radius
+	void SetRadius(double inRadius);
+	FORCEINLINE double GetRadius() const { return radius; }
+	// Mass and inertia of a solid sphere of the radius
+	void SetDensity(double inDensity);
+	void SetMaterialSurface(const std::shared_ptr<chrono::ChMaterialSurface>& inMaterial) { material = inMaterial; }
+	void SetEnvelope(double inEnvelope) { envelope = inEnvelope; }
+	// Chrono's families, 0 to 15
+	void SetFamily(int32 inFamily) { family = FMath::Clamp(inFamily, 0, 15); }
+	// Grains against the bodies in the Bullet world, off leaves only the grain pairs
+	void SetCollideWithWorld(bool bCollide) { bCollideWithWorld = bCollide; }
+
+	FORCEINLINE const chrono::ChVector<>& GetPosition(int32 i) const { return positions[i]; }
+	FORCEINLINE const chrono::ChQuaternion<>& GetRotation(int32 i) const { return rotations[i]; }
+	FORCEINLINE const chrono::ChVector<>& GetVelocity(int32 i) const { return velocities[i]; }
+	void SetPosition(int32 i, const chrono::ChVector<>& position) { positions[i] = position; }
+	void SetVelocity(int32 i, const chrono::ChVector<>& velocity) { velocities[i] = velocity; }
+	FORCEINLINE int32 GetLastContactCount() const { return lastContactCount; }
+
+	virtual void OnCustomCollision(chrono::ChSystem* system) override;
+
+	virtual int GetDOF() override { return 7 * GetParticleNum(); }
+	virtual int GetDOF_w() override { return 6 * GetParticleNum(); }
+
+	virtual void IntStateGather(const unsigned int off_x, chrono::ChState& x, const unsigned int off_v, chrono::ChStateDelta& v, double& T) override;
+	virtual void IntStateScatter(const unsigned int off_x, const chrono::ChState& x, const unsigned int off_v, const chrono::ChStateDelta& v, const double T) override;
+	virtual void IntStateGatherAcceleration(const unsigned int off_a, chrono::ChStateDelta& a) override;
+	virtual void IntStateScatterAcceleration(const unsigned int off_a, const chrono::ChStateDelta& a) override;
+	virtual void IntStateIncrement(const unsigned int off_x, chrono::ChState& x_new, const chrono::ChState& x, const unsigned int off_v, const chrono::ChStateDelta& Dv) override;
+	virtual void IntLoadResidual_F(const unsigned int off, chrono::ChVectorDynamic<>& R, const double c) override;
+	virtual void IntLoadResidual_Mv(const unsigned int off, chrono::ChVectorDynamic<>& R, const chrono::ChVectorDynamic<>& w, const double c) override;
+	virtual void IntToDescriptor(const unsigned int off_v, const chrono::ChStateDelta& v, const chrono::ChVectorDynamic<>& R,
+		const unsigned int off_L, const chrono::ChVectorDynamic<>& L, const chrono::ChVectorDynamic<>& Qc) override;
+	virtual void IntFromDescriptor(const unsigned int off_v, chrono::ChStateDelta& v, const unsigned int off_L, chrono::ChVectorDynamic<>& L) override;
+
+	virtual void InjectVariables(chrono::ChSystemDescriptor& descriptor) override;
+	virtual void VariablesFbReset() override;
+	virtual void VariablesFbLoadForces(double factor = 1) override;
+	virtual void VariablesQbLoadSpeed() override;
+	virtual void VariablesFbIncrementMq() override;
+	virtual void VariablesQbSetSpeed(double step = 0) override;
+	virtual void VariablesQbIncrementPosition(double step) override;
+
+	// Rotation composed with a rotation vector given in the frame of the rotation
+	static chrono::ChQuaternion<> IncrementRotation(const chrono::ChQuaternion<>& rotation, const chrono::ChVector<>& localRotation);
+
+private:
+	friend class FChCloudParticle;
+	friend class FChCloudCollisionModel;
+
+	// Points the contactables and models at this cloud and the variables at the shared mass
+	void BindElements();
+	// Gravity and gyroscopic torque of grain i, local torque
+	void GetForces(int32 i, chrono::ChVector<>& outForce, chrono::ChVector<>& outTorque) const;
+	void CollidePairs(std::vector<chrono::collision::ChCollisionInfo>& outContacts);
+	void CollideWorld(chrono::ChSystem* system, std::vector<chrono::collision::ChCollisionInfo>& outContacts);
+
+	std::vector<chrono::ChVector<>> positions;
+	std::vector<chrono::ChQuaternion<>> rotations;
+	std::vector<chrono::ChVector<>> velocities;
+	// Local frame, like ChBody
+	std::vector<chrono::ChVector<>> angularVelocities;
+	std::vector<chrono::ChVector<>> accelerations;
+	std::vector<chrono::ChVector<>> angularAccelerations;
+
+	chrono::ChSharedMassBody sharedMass;
+	// Never resized, ChVariables doesn't copy its vectors, a new count replaces the whole array
+	std::vector<chrono::ChVariablesBodySharedMass> variables;
+	std::vector<FChCloudParticle> contactables;
+	std::vector<FChCloudCollisionModel> models;
+
+	std::shared_ptr<chrono::ChMaterialSurface> material;
+	double radius = 0.05;
+	double density = 1000;
+	double envelope = 0.01;
+	int32 family = 0;
+	bool bCollideWithWorld = true;
+
+	// Counting sort of the grains by hashed cell, reused between steps
+	std::vector<uint32> grainCell;
+	std::vector<int32> cellStart;
+	std::vector<int32> sortedGrains;
+	int32 lastContactCount = 0;
+};
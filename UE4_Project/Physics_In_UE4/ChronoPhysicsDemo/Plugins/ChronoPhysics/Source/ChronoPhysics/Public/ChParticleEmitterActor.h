@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicsObjectGeneratorBasis.h"
+#include "Math/RandomStream.h"
+#include "ChParticleEmitterActor.generated.h"
+
+/**
+ * Emits instanced particles from a box around the actor, along the actor's forward direction.
+ * Every particle of the pool is created and added to the system once; removed particles are
+ * parked, fixed and without collision, until they are emitted again.
+ */
+UCLASS()
+class CHRONOPHYSICS_API AChParticleEmitterActor : public APhysicsObjectGeneratorBasis
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	TEnumAsByte<EShapeType::Type> ParticleShape = EShapeType::Sphere;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	FVector ParticleScale = FVector(0.1f);
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	float ParticleDensity = 1000.f;
+
+	// Particles alive at most at the same time
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	int PoolSize = 1000;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	float ParticlesPerSecond = 100.f;
+
+	// Half size of the spawn box, in actor space
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	FVector EmitExtent = FVector(20.f);
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	float EmitSpeed = 100.f;
+
+	// Random part of the emit speed, as a fraction of it
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	float SpeedSpread = 0.1f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleEmitter")
+	int RandomSeed = 0;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleRemover", meta = (EditConditionToggle))
+	bool bUseLifeTime = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleRemover", meta = (editcondition = "bUseLifeTime"))
+	float LifeTime = 10.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleRemover", meta = (EditConditionToggle))
+	bool bUseRemoveHeight = true;
+
+	// Particles falling below this world height go back to the pool
+	UPROPERTY(EditAnywhere, Category = "Chrono|ParticleRemover", meta = (editcondition = "bUseRemoveHeight"))
+	float RemoveHeight = -1000.f;
+
+	AChParticleEmitterActor();
+
+	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectInitalize() override;
+	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
+	virtual void CacheVisualState() override;
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetActiveParticleCount() const { return ActiveList.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetFreeParticleCount() const { return FreeList.Num(); }
+
+protected:
+	void ParkParticle(int slot);
+	void EmitParticle(int slot, double time);
+
+	// Instance index of every pool slot
+	TArray<int> PoolList;
+	TArray<int> ActiveList;
+	TArray<int> FreeList;
+	TArray<double> SpawnTime;
+
+	FRandomStream random;
+	FTransform emitTransform;
+	double lastTime = 0.0;
+	double emitCredit = 0.0;
+};
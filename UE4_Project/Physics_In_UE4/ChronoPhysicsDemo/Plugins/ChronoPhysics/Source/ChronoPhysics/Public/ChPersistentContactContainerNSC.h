@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChPooledContactContainerNSC.h"
+
+namespace chrono {
+	namespace collision {
+		class ChCollisionModel;
+	}
+}
+
+/**
+ * NSC contact container that keeps manifolds across steps for contacts the collision system hands over without
+ * a reaction cache, keyed by the pair of collision models. A new contact takes over the multipliers of the
+ * closest point of its pair's last manifold, matched in the models' own frames, so the warm started solver
+ * and the friction of resting contacts don't restart from zero every step. Bullet's contacts already come
+ * with the cache of its persistent manifolds and go through as they are. The contact objects are pooled
+ */
+class CHRONOPHYSICS_API FChPersistentContactContainerNSC : public FChPooledContactContainerNSC
+{
+public:
+	// Points of one manifold, the same as a Bullet manifold holds
+	static const int32 ManifoldPoints = 4;
+
+	FChPersistentContactContainerNSC() {}
+	// A clone starts without manifolds, they point into the contacts of this container's system
+	FChPersistentContactContainerNSC(const FChPersistentContactContainerNSC& other) : FChPooledContactContainerNSC(other), matchDistance(other.matchDistance) {}
+	virtual FChPersistentContactContainerNSC* Clone() const override { return new FChPersistentContactContainerNSC(*this); }
+
+	// How far apart, in either model's frame, two steps' points still count as the same contact (m)
+	void SetMatchDistance(double distance) { matchDistance = distance; }
+
+	// Contacts of the last step that started from the multipliers of the step before
+	FORCEINLINE int32 GetPersistentContactNum() const { return persistentNum; }
+	FORCEINLINE int32 GetManifoldNum() const { return manifolds.Num(); }
+
+	virtual void RemoveAllContacts() override;
+	virtual void BeginAddContact() override;
+	virtual void AddContact(const chrono::collision::ChCollisionInfo& mcontact) override;
+	virtual void EndAddContact() override;
+
+private:
+	struct FManifoldPoint
+	{
+		chrono::ChVector<> LocalA;
+		chrono::ChVector<> LocalB;
+		// N, U, V and the rolling multipliers, what ChContactNSC reads in Reset and writes back after the solve
+		float Reactions[6];
+		int32 Step = INDEX_NONE;
+	};
+
+	struct FManifold
+	{
+		FManifoldPoint Points[ManifoldPoints];
+		int32 Num = 0;
+		int32 Step = 0;
+	};
+
+	float* FindReactionCache(const chrono::collision::ChCollisionInfo& mcontact, bool& bOutPersistent);
+	int32 AllocatePoint(FManifold& manifold) const;
+
+	// Values stay put while the map grows, the contacts keep pointers into them until the next collision
+	TMap<TPair<chrono::collision::ChCollisionModel*, chrono::collision::ChCollisionModel*>, TUniquePtr<FManifold>> manifolds;
+	double matchDistance = 0.01;
+	int32 step = 0;
+	int32 persistentNum = 0;
+};
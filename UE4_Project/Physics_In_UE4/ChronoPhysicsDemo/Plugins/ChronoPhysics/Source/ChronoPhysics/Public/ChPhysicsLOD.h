@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/core/ChVector.h"
+#include <memory>
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+}
+
+namespace EChLODTier {
+	enum Type : uint8 {
+		FULL,
+		REDUCED,
+		FROZEN,
+		Num
+	};
+}
+
+// Chrono units and seconds
+struct FChLODSettings
+{
+	double ReducedDistance = 20;
+	double FrozenDistance = 60;
+	// Fraction of a distance a body has to come back inside it before it is promoted
+	double Hysteresis = 0.1;
+	// Reduced bodies slower than this for RestTime are frozen until they are promoted or hit
+	double RestSpeed = 0.05;
+	double RestTime = 0.5;
+};
+
+/**
+ * Simulation detail of the bodies added to it by their distance to the nearest focus point. Full bodies step
+ * as before; reduced ones are frozen as soon as they have come to rest, frozen ones are taken out of the solve
+ * whatever they do. A frozen body keeps its velocities aside and gets them back when it is promoted, or when an
+ * awake body runs into it, so it carries on where it stopped. A single system has one step for all of its
+ * bodies, so fidelity is cut by not solving a body at all rather than by stepping it less often
+ */
+class CHRONOPHYSICS_API FChPhysicsLOD
+{
+public:
+	void SetSettings(const FChLODSettings& inSettings) { settings = inSettings; }
+
+	// Bodies not in the list any more are thawed and forgotten, new ones start at full detail
+	void SetBodies(const TArray<std::shared_ptr<chrono::ChBody>>& bodies);
+	// No focus points means no one looks, nothing changes. The systems' contacts wake the frozen bodies they touch
+	void Update(const TArray<chrono::ChVector<>>& focus, double elapsed, const TArray<chrono::ChSystem*>& systems);
+	// Thaws everything
+	void Reset();
+
+	FORCEINLINE int32 GetTierNum(EChLODTier::Type tier) const { return tierNums[tier]; }
+	FORCEINLINE int32 GetFrozenNum() const { return frozenNum; }
+
+private:
+	struct FEntry
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		EChLODTier::Type Tier = EChLODTier::FULL;
+		bool bFrozen = false;
+		// Frozen because it was at rest, a reduced body stays so
+		bool bRested = false;
+		double RestTime = 0;
+		// Left after being hit, a frozen tier body isn't frozen again before
+		double WakeTime = 0;
+		chrono::ChVector<> Velocity;
+		chrono::ChVector<> AngularVelocity;
+	};
+
+	void Freeze(FEntry& entry, bool bRested);
+	void Thaw(FEntry& entry);
+	EChLODTier::Type SelectTier(const FEntry& entry, double distanceSquared) const;
+	void WakeTouched(const TArray<chrono::ChSystem*>& systems);
+
+	FChLODSettings settings;
+	TArray<FEntry> entries;
+	TMap<chrono::ChBody*, int32> entryIndices;
+	int32 tierNums[EChLODTier::Num] = {};
+	int32 frozenNum = 0;
+};
@@ -8,6 +8,8 @@ namespace chrono {
 	class ChSystem;
 }
 
+class FChTelemetry;
+
 USTRUCT(BlueprintType)
 struct FExportData
 {
@@ -36,16 +38,39 @@ class IChPhysicsObjectInterface
 
 public:
 	virtual void PhysicsObjectConstruct() = 0;
+	// Runs as a parallel task after every PhysicsObjectConstruct; must not touch UObjects
+	virtual void PhysicsObjectBuildGeometry() {}
 	virtual void PhysicsObjectInitalize() = 0;
 	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) = 0;
 	virtual void AddToSystem(TArray<TScriptInterface<IChPhysicsObjectInterface>>& objList) {}
+	// Undoes AddToSystem for objects destroyed while the scene runs; objects that can't leave the system keep the default
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) {}
 	virtual void UpdatePhysicsState() = 0;
+	// Opt into the per-substep UpdatePhysicsState list; objects with nothing to do per substep add nothing
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) { objList.Add(this); }
 	virtual void UpdateVisualAsset() = 0;
+	// Blend between the last two cached physics states, alpha in [0, 1]
+	virtual void InterpolateVisualAsset(float alpha) { UpdateVisualAsset(); }
+	// Append changed root transforms for a batched write-back; objects that can't batch update themselves
+	virtual void GatherVisualTransforms(TArray<class USceneComponent*>& components, TArray<FTransform>& transforms, float alpha, float tolerance) { InterpolateVisualAsset(alpha); }
+	// Game thread: copy blueprint driven inputs into the values read by UpdatePhysicsState
+	virtual void LatchPhysicsInput() {}
+	// Physics thread: snapshot the simulated state read by UpdateVisualAsset
+	virtual void CacheVisualState() {}
 	virtual bool IsBody() { return false; }
 	virtual bool& GetIsForParallel() { return mute; }
+	virtual bool& GetIsForSMC() { return mute; }
+	// Scene-wide sleeping defaults, pushed before PhysicsObjectInitalize. Speeds in UE units
+	virtual void SetSleepingParameter(bool bUseSleeping, float sleepTime, float minSpeed, float minAngularSpeed) {}
 	virtual FExportData ExportData() { return FExportData(); }
+	// Register telemetry channels once and add the writer to writerList if it registered any
+	virtual void RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList) {}
+	// Physics thread: write this step's values into the channels registered above
+	virtual void WriteTelemetry(FChTelemetry& telemetry) {}
 	virtual bool& GetIsExportData() { return bExportDataInterface; }
 	virtual FName& GetExportDataOwnerName() { return DataOnwnerNameInterface; }
+	// Editor preview: the next construct and initialize build the object again from its properties
+	virtual void ResetPhysicsObject() { isInitialized = false; }
 
 
 protected:
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AChPhysicsSceneManagerActor;
+
+/**
+ * Physics objects of one game world. Chrono components register in OnRegister and Chrono actors once their
+ * components are registered, both before any BeginPlay, so the scene manager finds every level object
+ * without scanning the world. Objects spawned later announce themselves through OnAdded and OnRemoved.
+ * Objects whose actor is owned by another physics object, e.g. the bodies a generator spawns, are
+ * driven by that owner and are not registered. Game thread only
+ */
+class CHRONOPHYSICS_API FChPhysicsObjectRegistry
+{
+public:
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnPhysicsObjectChanged, UObject*);
+
+	// nullptr for editor and preview worlds
+	static FChPhysicsObjectRegistry* Get(UWorld* world);
+	static void Register(UObject* object);
+	static void Unregister(UObject* object);
+
+	FORCEINLINE const TArray<UObject*>& GetObjects() const { return objects; }
+	FORCEINLINE bool Contains(UObject* object) const { return indices.Contains(object); }
+
+	// An object belongs to the first scene manager whose SceneTag its actor has, otherwise to the first untagged one
+	void AddScene(AChPhysicsSceneManagerActor* scene);
+	void RemoveScene(AChPhysicsSceneManagerActor* scene);
+	AChPhysicsSceneManagerActor* FindScene(UObject* object) const;
+	FORCEINLINE int32 GetSceneCount() const { return scenes.Num(); }
+
+	FOnPhysicsObjectChanged OnAdded;
+	FOnPhysicsObjectChanged OnRemoved;
+
+	// A Chrono object's properties were changed in the editor, in any world, editor worlds included
+	static FOnPhysicsObjectChanged& OnObjectEdited();
+	static void NotifyEdited(UObject* object);
+
+private:
+	void Add(UObject* object);
+	void Remove(UObject* object);
+
+	// Unordered, removal swaps the last object in
+	TArray<UObject*> objects;
+	TMap<UObject*, int32> indices;
+	TArray<AChPhysicsSceneManagerActor*> scenes;
+};
@@ -5,32 +5,306 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ChPhysicsObjectInterface.h"
+#include "ChContactBuffer.h"
+#include "ChTelemetry.h"
+#include "ChOutputPipeline.h"
+#include "ChSceneSnapshot.h"
+#include "ChCheckpoint.h"
+#include "ChArchiveExport.h"
+#include "ChParameterSweep.h"
+#include "ChRayQuery.h"
+#include "ChBreakableLinks.h"
+#include "ChMemoryStats.h"
+#include "ChNetSnapshot.h"
+#include "ChPhysicsLOD.h"
+#include "ChRealtimeStepper.h"
+#include "Async/Future.h"
 #include <memory>
 #include "ChPhysicsSceneManagerActor.generated.h"
 
 namespace chrono {
 	class ChSystem;
 	class ChContactable;
+	class ChLinkSpring;
 }
 
+class FChStaticColliderSet;
+class FChFEAContactSet;
+class FChCollisionGroupFilter;
+class FChContinuousCollision;
+class FChParticleCloud;
+class FChMultirateSprings;
+class FChGpuRigidWorld;
+class FChDomainDecomposition;
+class AChLinkActor;
+
+UENUM()
+namespace EChSystemBackend {
+	enum Type {
+		SERIAL_NSC,
+		SERIAL_SMC,
+		PARALLEL_NSC,
+		PARALLEL_SMC
+	};
+}
+
+UENUM()
+namespace EChNarrowphase {
+	enum Type {
+		HYBRID_MPR,
+		ANALYTIC,
+		MPR,
+		// Sphere pairs four at a time through type-sorted kernels, the other pairs as HYBRID_MPR
+		BATCHED
+	};
+}
+
+UENUM()
+namespace EChSerialSolver {
+	enum Type {
+		SOR,
+		// SOR run on each island of connected bodies side by side, islands of sleeping bodies are skipped
+		ISLANDS,
+		SYMMSOR,
+		JACOBI,
+		APGD,
+		BARZILAIBORWEIN,
+		// Graph colored SOR, parallel and independent of the thread count
+		SOR_COLORED,
+		// SOR with the joints of link trees solved exactly in linear time, for long chains
+		ARTICULATED
+	};
+}
+
+UENUM()
+namespace EChTimestepper {
+	enum Type {
+		EULER_IMPLICIT_LINEARIZED,
+		EULER_IMPLICIT_PROJECTED,
+		EULER_IMPLICIT,
+		HHT
+	};
+}
+
+UENUM()
+namespace EChConstructionPhase {
+	enum Type {
+		CONSTRUCT,
+		BUILD_GEOMETRY,
+		INITIALIZE,
+		ADD_TO_SYSTEM,
+		READY
+	};
+}
+
+// Second tick of a scene manager, joins the step its actor tick started earlier in the frame
+USTRUCT()
+struct FChSceneJoinTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	class AChPhysicsSceneManagerActor* Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+USTRUCT(BlueprintType)
+struct FChLinkBreak
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Link")
+	AChLinkActor* Link = nullptr;
+
+	// System time of the step that broke it
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Link")
+	float Time = 0.f;
+
+	// Reaction that broke it, same units as the exported reactions
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Link")
+	FVector Force = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Link")
+	FVector Torque = FVector::ZeroVector;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FChLinksBrokenSignature, const TArray<FChLinkBreak>&, Breaks);
+
+template<>
+struct TStructOpsTypeTraits<FChSceneJoinTickFunction> : public TStructOpsTypeTraitsBase2<FChSceneJoinTickFunction>
+{
+	enum { WithCopy = false };
+};
+
 UCLASS()
 class CHRONOPHYSICS_API AChPhysicsSceneManagerActor : public AActor
 {
 	GENERATED_BODY()
 	
 public:	
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	TEnumAsByte<EChSystemBackend::Type> SystemBackend = EChSystemBackend::SERIAL_NSC;
+
+	// Several managers can share a world, each with its own system. Objects whose actor has this tag
+	// belong to this manager; the manager without a tag takes the objects no other manager claims
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	FName SceneTag;
+
+	// 0 uses the thread budget, see ReservedEngineThreads
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	int ParallelThreadCount = 0;
+
+	// Serial backends: the timesteppers' force, mass and constraint loads run in parallel over the items
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	bool bParallelResidual = false;
+
+	// SERIAL_SMC: rigid body contacts are kept packed, their forces computed and summed per body in parallel
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	bool bPackedSMCContacts = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	FIntVector BinsPerAxis = FIntVector(20, 20, 20);
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	bool bFixedBins = true;
+
+	// ANALYTIC only handles the shape pairs with closed form tests (spheres, boxes, capsules, ...) and
+	// skips the MPR fallback. BATCHED gives the same contacts as HYBRID_MPR with the sphere-sphere, box-sphere
+	// and capsule-sphere pairs vectorized, the fastest choice for sphere-dominated granular scenes
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	TEnumAsByte<EChNarrowphase::Type> NarrowphaseAlgorithm = EChNarrowphase::HYBRID_MPR;
+
+	// Parallel backends: sphere, box and capsule AABBs computed per shape type four at a time, resting bodies
+	// keep last step's boxes. Scenes with other shapes, fluid or FEA fall back to the stock pass
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	bool bSortedAABBPass = false;
+
+	// Add bodies in Morton order of their start location, so that the parallel backend's body arrays
+	// keep spatial neighbours close in memory
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	bool bSpatialBodyOrder = false;
+
+	// Re-target BinsPerAxis from the live shape count and scene extents after every step
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (EditConditionToggle))
+	bool bAdaptiveBins = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (editcondition = "bAdaptiveBins"))
+	float TargetShapesPerBin = 4.f;
+
+	// Relative change an axis needs before the bins are rebuilt
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (editcondition = "bAdaptiveBins"))
+	float BinHysteresis = 0.25f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	float ParallelSolverTolerance = 1e-4;
+
+	// Parallel NSC: frictionless iterations on the normal impulses only (one row per contact instead of three)
+	// before the full sliding solve, a cheap way to get most of the way to the solution
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	int ParallelNormalPrepassIterations = 0;
+
+	// Build M^-1 D from the diagonal of the body inertia only, cheaper to assemble and apply
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	bool bParallelDiagonalInertia = false;
+
+	// Parallel NSC: the solver's D^T M^-1 D products run in row blocks on the task graph instead of on one thread
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (EditConditionToggle))
+	bool bThreadedShurProduct = false;
+
+	// Constraint rows below which the product stays serial
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (editcondition = "bThreadedShurProduct"))
+	int ThreadedShurMinRows = 600;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend")
+	float ContactRecoverySpeed = 0.6;
+
+	// NSC backends: free sphere and box bodies without links, CCD or ChForces step on the CUDA device, see FChGpuRigidWorld.
+	// They only collide with each other and the fixed sphere and box bodies: trimesh, heightfield and BVH static meshes,
+	// the CPU bodies and forces added from the components don't reach them. Rebuilt whenever objects stream in or out.
+	// Only in builds WITH_CHRONO_CUDA, elsewhere everything stays on the CPU. Snapshots don't cover the device state
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (EditConditionToggle))
+	bool bGpuRigidContacts = false;
+
+	// Contacts allocated on the device, the ones past it are dropped
+	UPROPERTY(EditAnywhere, Category = "Chrono|SystemBackend", meta = (editcondition = "bGpuRigidContacts"))
+	int GpuContactCapacity = 262144;
+
+	// Speed and stabilization solver of the serial NSC backend
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	TEnumAsByte<EChSerialSolver::Type> SerialSolverType = EChSerialSolver::SOR;
+
+	// Scales APGD's step per contact by the inverse diagonal of its rows, for stacks with high mass ratios.
+	// Serial NSC with the APGD solver, and the parallel backends' own preconditioning flag
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	bool bPreconditionSolver = false;
+
+	// Serial backends, the implicit Euler and HHT steppers are for SMC and FEA scenes
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	TEnumAsByte<EChTimestepper::Type> Timestepper = EChTimestepper::EULER_IMPLICIT_LINEARIZED;
+
+	// HHT: the Jacobian is factored once per step and reused by the step's Newton iterations
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	bool bReuseJacobian = false;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
 	int Substep = 5;
 
 	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
 	float MaxStepLengthms = 6;
 
+	// Internal steps per system step of the springs with bMultirate
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	int MultirateSubsteps = 5;
+
+	// Run 0..N steps of FixedStepLengthms per frame and interpolate the visuals
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (EditConditionToggle))
+	bool bUseFixedTimestep = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (editcondition = "bUseFixedTimestep"))
+	float FixedStepLengthms = 4;
+
+	// Simulated time beyond this many steps per frame is dropped
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (editcondition = "bUseFixedTimestep"))
+	int MaxCatchUpSteps = 8;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
 	int MaxItersSolverSpeed = 30;
 
 	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
 	int MaxItersSolverStab = 10;
 
+	// Serial backends: stop the speed solver once it converges and move its iteration cap between
+	// MinItersSolverSpeed and MaxItersSolverSpeed, growing it only while the residual still improves
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (EditConditionToggle))
+	bool bAdaptiveSolverIterations = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (editcondition = "bAdaptiveSolverIterations"))
+	int MinItersSolverSpeed = 8;
+
+	// N, the solver's impulse tolerance is this times the step length
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (editcondition = "bAdaptiveSolverIterations"))
+	float SolverForceTolerance = 0.001f;
+
+	// Has the iterative solver record its violation every iteration, for GetLastSolverResidual and the Solver Residual
+	// stat. Always on with bAdaptiveSolverIterations, which reads it
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	bool bRecordSolverResidual = false;
+
+	// Serial NSC: start the iterative solver from last step's multipliers. Contact impulses are matched
+	// through Bullet's persistent manifolds, so they survive as long as a contact stays within the breaking threshold
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	bool bSolverWarmStarting = false;
+
+	// Serial NSC: contacts without a Bullet manifold, from custom collision callbacks, keep their multipliers across
+	// steps in the plugin's own manifolds
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter")
+	bool bPersistentContacts = false;
+
+	// Serial NSC: how far a contact point may move on its bodies between steps and still be the same contact (m)
+	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (editcondition = "bPersistentContacts"))
+	float PersistentContactMatchDistance = 0.01f;
+
 	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (EditConditionToggle))
 	bool bSetDefaultCollisionParameter = true;
 
@@ -42,30 +316,569 @@ public:
 
 	UPROPERTY(EditAnywhere, Category = "Chrono|SolverParameter", meta = (editcondition = "bSetDefaultCollisionParameter"))
 	float SetContactBreakingThreshold = 0.0001;
+
+	// Serial backends: each body picks its envelope and margin from the smallest dimension of its shapes' AABB
+	// and the distance its MaxSpeed covers in one step, instead of the default envelope. Small bodies then
+	// report fewer far contacts, compare the Contacts stat with it on and off
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (EditConditionToggle))
+	bool bAutoCollisionEnvelope = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (editcondition = "bAutoCollisionEnvelope", ClampMin = "0"))
+	float EnvelopeSizeFraction = 0.05f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (editcondition = "bAutoCollisionEnvelope", ClampMin = "0"))
+	float MarginSizeFraction = 0.02f;
+
+	// Chrono units
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (editcondition = "bAutoCollisionEnvelope", ClampMin = "0"))
+	float MinCollisionEnvelope = 0.0005f;
+
+	// m/s, body speed limits only count up to this, the default MaxSpeed would give every body a huge envelope
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (editcondition = "bAutoCollisionEnvelope", ClampMin = "0"))
+	float EnvelopeSpeedLimit = 5.f;
+
+	// Serial backends: only moving bodies get their broadphase AABB updated each step. Fixed bodies are
+	// parked in Bullet's static set and skipped until RefreshStaticCollision is called
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision")
+	bool bIncrementalBroadphase = false;
+
+	// Serial backends: box and sphere bodies collide with the fixed trimeshes that use bUseStaticMeshCollider
+	// through their BVH instead of Bullet. Those meshes are moved to this family, keep it free for them
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision")
+	int StaticColliderFamily = 15;
+
+	// Let bodies at rest fall asleep; sleeping bodies are woken by contact with moving bodies
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (EditConditionToggle))
+	bool bUseSleeping = false;
+
+	// Seconds a body has to stay below the thresholds before it sleeps
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bUseSleeping"))
+	float SleepTime = 0.6f;
+
+	// cm/s
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bUseSleeping"))
+	float SleepMinSpeed = 10.f;
+
+	// rad/s
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bUseSleeping"))
+	float SleepMinAngularSpeed = 0.04f;
+
+	// Parallel backends only: bodies leaving this box are frozen
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (EditConditionToggle))
+	bool bUseFreezeBox = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bUseFreezeBox"))
+	FVector FreezeBoxMin = FVector(-10000.f, -10000.f, -10000.f);
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Sleeping", meta = (editcondition = "bUseFreezeBox"))
+	FVector FreezeBoxMax = FVector(10000.f, 10000.f, 10000.f);
+
+	// Gather all body poses and apply them in one teleport pass, skipping sleeping and unchanged bodies
+	UPROPERTY(EditAnywhere, Category = "Chrono|VisualSync", meta = (EditConditionToggle))
+	bool bBatchTransformSync = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VisualSync", meta = (editcondition = "bBatchTransformSync"))
+	float TransformSyncTolerance = 0.01f;
+
+	// Networked games: the server simulates and sends the poses of the moving bodies to every client, clients
+	// don't step and show them with NetInterpolationDelay. Server and clients have to load the same level
+	UPROPERTY(EditAnywhere, Category = "Chrono|Network", meta = (EditConditionToggle))
+	bool bReplicateSimulation = false;
+
+	// Snapshots per second
+	UPROPERTY(EditAnywhere, Category = "Chrono|Network", meta = (editcondition = "bReplicateSimulation", ClampMin = "1"))
+	float NetSendRate = 20.f;
+
+	// UE units, positions are sent as whole multiples of it
+	UPROPERTY(EditAnywhere, Category = "Chrono|Network", meta = (editcondition = "bReplicateSimulation", ClampMin = "0.001"))
+	float NetPositionResolution = 0.05f;
+
+	// Seconds, clients render this far behind the newest snapshot, more than one send interval
+	UPROPERTY(EditAnywhere, Category = "Chrono|Network", meta = (editcondition = "bReplicateSimulation", ClampMin = "0"))
+	float NetInterpolationDelay = 0.1f;
+
+	// Serial backends: the free bodies are split into DomainCount slabs along DomainAxis, each stepped by its own
+	// system in parallel. Bodies near a boundary are ghosted into the neighbour slab, see FChDomainDecomposition.
+	// Linked, CCD and fixed bodies stay in the main system, queries and snapshots only see those and slab 0
+	UPROPERTY(EditAnywhere, Category = "Chrono|Domain", meta = (EditConditionToggle))
+	bool bDomainDecomposition = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Domain", meta = (editcondition = "bDomainDecomposition", ClampMin = "2", ClampMax = "16"))
+	int DomainCount = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Domain", meta = (editcondition = "bDomainDecomposition"))
+	TEnumAsByte<EAxis::Type> DomainAxis = EAxis::X;
+
+	// UE units past its bounds a body is ghosted into the neighbour slab
+	UPROPERTY(EditAnywhere, Category = "Chrono|Domain", meta = (editcondition = "bDomainDecomposition", ClampMin = "0"))
+	float DomainGhostWidth = 20.f;
+
+	// Bodies far from every player view and LODFocusActors are frozen once at rest, or altogether past
+	// LODFrozenDistance, and pick up where they stopped when one comes close again, see FChPhysicsLOD
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (EditConditionToggle))
+	bool bPhysicsLOD = false;
+
+	// Sensors and other points the simulation has to be right around, besides the players
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD"))
+	TArray<AActor*> LODFocusActors;
+
+	// UE units
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD", ClampMin = "0"))
+	float LODReducedDistance = 2000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD", ClampMin = "0"))
+	float LODFrozenDistance = 6000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD", ClampMin = "0", ClampMax = "0.9"))
+	float LODHysteresis = 0.1f;
+
+	// UE units per second and seconds a reduced body has to stay below it before it is frozen
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD", ClampMin = "0"))
+	float LODRestSpeed = 5.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD", ClampMin = "0"))
+	float LODRestTime = 0.5f;
+
+	// Steps between two passes over the bodies
+	UPROPERTY(EditAnywhere, Category = "Chrono|LOD", meta = (editcondition = "bPhysicsLOD", ClampMin = "1"))
+	int LODUpdateInterval = 4;
+
+	// Refill the contact buffer after every step so contacts can be queried per body or family
+	UPROPERTY(EditAnywhere, Category = "Chrono|Contact")
+	bool bCollectContacts = false;
+
+	// Record the exported channels of every object into a ring buffer after each step
+	UPROPERTY(EditAnywhere, Category = "Chrono|Telemetry", meta = (EditConditionToggle))
+	bool bRecordTelemetry = false;
+
+	// Frames kept between two drains, older frames are overwritten
+	UPROPERTY(EditAnywhere, Category = "Chrono|Telemetry", meta = (editcondition = "bRecordTelemetry"))
+	int TelemetryFrameCapacity = 256;
+
+	// Snapshot buffers preallocated after the scene is built, for rollback and scenario resets
+	UPROPERTY(EditAnywhere, Category = "Chrono|Snapshot")
+	int SnapshotSlotCount = 2;
+
+	// Step frame N on a worker thread while the game thread renders; visuals lag one frame behind
+	UPROPERTY(EditAnywhere, Category = "Chrono|Threading", meta = (EditConditionToggle))
+	bool bStepOnWorkerThread = false;
+
+	// Join the worker in JoinTickGroup of the same frame instead of in the next tick. The step starts
+	// in the actor's own tick group, so every manager's system steps concurrently in between, without the frame of lag
+	UPROPERTY(EditAnywhere, Category = "Chrono|Threading", meta = (editcondition = "bStepOnWorkerThread"))
+	bool bJoinStepInFrame = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Threading", meta = (editcondition = "bStepOnWorkerThread"))
+	TEnumAsByte<ETickingGroup> JoinTickGroup = TG_PostPhysics;
+
+	// Hardware in the loop: FixedStepLengthms steps on a time critical thread paced by the wall clock instead of
+	// the frame rate. Each tick holds the thread at its next step boundary for the rest of the frame, latches the
+	// inputs of every object and updates their visuals from the steps taken since the last tick
+	UPROPERTY(EditAnywhere, Category = "Chrono|Realtime", meta = (EditConditionToggle))
+	bool bRealtimePacing = false;
+
+	// Logical core the physics thread is pinned to, -1 leaves it to the scheduler
+	UPROPERTY(EditAnywhere, Category = "Chrono|Realtime", meta = (editcondition = "bRealtimePacing"))
+	int RealtimeCore = -1;
+
+	// Spun instead of slept before each deadline, at least the OS timer granularity
+	UPROPERTY(EditAnywhere, Category = "Chrono|Realtime", meta = (editcondition = "bRealtimePacing"))
+	int RealtimeSpinMicroseconds = 1500;
+
+	// Late steps run back to back until this many are due, then the schedule starts over from now
+	UPROPERTY(EditAnywhere, Category = "Chrono|Realtime", meta = (editcondition = "bRealtimePacing"))
+	int RealtimeMaxCatchUpSteps = 4;
+
+	// Logical cores left to the game, render and task graph threads; Chrono's OpenMP and solver
+	// threads share the rest so the two pools don't oversubscribe the machine, split evenly between the managers
+	UPROPERTY(EditAnywhere, Category = "Chrono|Threading")
+	int ReservedEngineThreads = 2;
+
+	// Spread object construction over the first frames instead of doing it all in BeginPlay,
+	// the system only starts stepping once every object was added
+	UPROPERTY(EditAnywhere, Category = "Chrono|Construction", meta = (EditConditionToggle))
+	bool bIncrementalConstruction = false;
+
+	// Game thread time per frame spent on construction; one object is always finished, however long it takes
+	UPROPERTY(EditAnywhere, Category = "Chrono|Construction", meta = (editcondition = "bIncrementalConstruction"))
+	float ConstructionBudgetMs = 5.f;
+
+	// Objects register themselves with the world's FChPhysicsObjectRegistry. This also scans every actor
+	// and component, for blueprint or project classes that implement the interface without registering
+	UPROPERTY(EditAnywhere, Category = "Chrono|Construction")
+	bool bScanWorldForObjects = false;
+
+	// Simulates the level in the editor viewport without Play. The built system stays alive between edits:
+	// changing a Chrono body or link, or moving an actor, rebuilds only those objects and the links on them,
+	// then the preview starts over from its initial snapshot. The authored poses are put back for saving and
+	// before Play in Editor. Generators are left out, they spawn their bodies as level actors
+	UPROPERTY(EditAnywhere, Transient, Category = "Chrono|EditorPreview", meta = (EditConditionToggle))
+	bool bEditorPreview = false;
+
+	// Simulated time the preview loops over
+	UPROPERTY(EditAnywhere, Category = "Chrono|EditorPreview", meta = (editcondition = "bEditorPreview"))
+	float EditorPreviewSeconds = 5.f;
 	
 
 	// Sets default values for this actor's properties
 	AChPhysicsSceneManagerActor();
 	virtual void Tick(float DeltaTime) override;
+	virtual void PostRegisterAllComponents() override;
+	virtual void PostUnregisterAllComponents() override;
+	virtual bool ShouldTickIfViewportsOnly() const override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+	virtual void Destroyed() override;
+#endif
+	void JoinStep();
+
+	// Back to the initial snapshot of the editor preview
+	UFUNCTION(CallInEditor, Category = "Chrono|EditorPreview")
+	void RestartEditorPreview();
 
 	virtual void SystemInitialize();
+	virtual void ParallelSystemInitialize();
 	virtual void FetchPhysicsObject();
 	virtual void InitPhysicsObject();
 	virtual void AddObjectToSystem();
+	// Step lists, telemetry layout, static collision and snapshot buffers, once every object is in the system
+	virtual void FinishConstruction();
+	// Works through the construction phases until the budget is used up, true once the scene is ready
+	bool AdvanceConstruction(float budgetMs);
 	virtual void StepPhysics(float deltaTime);
+	virtual void StepPhysicsFixed(float deltaTime);
+	virtual void UpdateVisualAsset();
+	virtual void RecordStepOutput();
+	// One DoStepDynamics with the bookkeeping every substep shares, followed by the pre step objects
+	void DoChronoStep(double stepSize);
+	// Chrono's step timers and the system's counts into "stat ChronoPhysics"
+	void PublishStepStats();
+	virtual void AdaptSolverIterations();
+	virtual void AdaptBroadphaseBins();
+	void TrackContactCount();
+	// Estimated Chrono bytes per category into the memory stats of "stat ChronoPhysics"
+	void TrackMemory();
+	// Server side of bReplicateSimulation, with the step joined
+	void SendNetSnapshots(float deltaTime);
+	void RebuildNetBodies();
+	// Game thread, before the step is started
+	void GatherLODFocus();
+	void RebuildLODBodies();
+	void UpdatePhysicsLOD(double stepSize);
+	void WaitForPhysicsStep();
+	// Tick of bRealtimePacing, the stepper thread owns the system in between
+	void TickRealtime();
+	void StepRealtime(double stepSeconds);
+#if WITH_EDITOR
+	// Tick of bEditorPreview in the editor world, the whole pipeline runs once and then only for what was edited
+	void TickEditorPreview(float deltaTime);
+	void StartEditorPreview();
+	void StopEditorPreview();
+	void ApplyEditorPreviewEdits();
+	void CaptureEditorPreviewPose(UObject* object);
+	void RestoreEditorPreviewPoses(bool bMobility);
+	void OnEditorPreviewObjectEdited(UObject* object);
+	void OnEditorPreviewActorMoved(AActor* actor);
+	void OnEditorPreviewPreBeginPIE(bool bIsSimulating);
+#endif
+	// After the state jumped, no interpolation from the pose before it
+	void ResetVisualsAfterRestore();
+	int GetChronoThreadBudget() const;
 
 	UFUNCTION(BlueprintCallable, Category = "Chrono")
 	const TMap<FName, FExportData> ExportData();
 
+	UFUNCTION(BlueprintPure, Category = "Chrono|Construction")
+	bool IsSceneReady() const { return constructionPhase == EChConstructionPhase::READY; }
+
+	// 0 to 1 over the construction phases
+	UFUNCTION(BlueprintPure, Category = "Chrono|Construction")
+	float GetConstructionProgress() const;
+
+	// Re-sync the broadphase after fixed bodies were moved, only needed with bIncrementalBroadphase
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Collision")
+	void RefreshStaticCollision();
+
+	// Contacts the BVH static meshes generated in the last step
+	UFUNCTION(BlueprintPure, Category = "Chrono|Collision")
+	int GetStaticColliderContactCount() const;
+
+	// Contacts of the bBulkContact FEA meshes in the last step
+	UFUNCTION(BlueprintPure, Category = "Chrono|Collision")
+	int GetFEAContactCount() const;
+
+	// Adds the cloud and registers its collision callback, serial backends only; the manager keeps it alive
+	bool AddParticleCloud(std::shared_ptr<FChParticleCloud> cloud);
+	// Integrates the spring at MultirateSubsteps per step and zeroes the link's own stiffness, serial backends only
+	bool AddMultirateSpring(std::shared_ptr<chrono::ChLinkSpring> link, double stiffness, double damping);
+	void RemoveMultirateSpring(chrono::ChLinkSpring* link);
+	// Thresholds checked after every step, returns the slot to remove the link with
+	int32 AddBreakableLink(AChLinkActor* link, double breakForce, double breakTorque);
+	void RemoveBreakableLink(int32 slot);
+
+	// Every link broken since the last frame, once per frame on the game thread after the step is joined
+	UPROPERTY(BlueprintAssignable, Category = "Chrono|Link")
+	FChLinksBrokenSignature OnLinksBroken;
+
+	// Speed solver iterations and final constraint violation of the last step
+	UFUNCTION(BlueprintPure, Category = "Chrono|SolverParameter")
+	int GetLastSolverIterations() const { return lastSolverIterations; }
+
+	// 0 unless the violation is recorded, see bRecordSolverResidual
+	UFUNCTION(BlueprintPure, Category = "Chrono|SolverParameter")
+	float GetLastSolverResidual() const { return lastSolverResidual; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|SystemBackend")
+	FIntVector GetCurrentBinsPerAxis() const { return currentBins; }
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Contact")
+	int GetContactCount();
+
+	// Most contacts any step had since BeginPlay, from the contact pools where the serial NSC systems have them
+	UFUNCTION(BlueprintPure, Category = "Chrono|Contact")
+	int GetContactHighWater() const { return contactHighWater; }
+
+	// Serial NSC: contact objects kept alive by the pools, in use or parked for the next step
+	UFUNCTION(BlueprintPure, Category = "Chrono|Contact")
+	int GetPooledContactCount() const { return pooledContactCount; }
+
+	// Client side of bReplicateSimulation, false when the snapshot was dropped
+	bool ReceiveNetSnapshot(const TArray<uint8>& data, int32& outSequence);
+	FORCEINLINE bool IsNetReplica() const { return bReplicateSimulation && GetNetMode() == NM_Client; }
+
+	// Logs the bytes the system holds per category and their peaks, also "Chrono.DumpMemory" in the console
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Memory")
+	void DumpChronoMemory();
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Contact")
+	int QueryBodyContacts(class UChBodyComponent* body, TArray<FVector>& positions, TArray<FVector>& normals, TArray<FVector>& forces);
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Contact")
+	int QueryFamilyContacts(int family, TArray<FVector>& positions, TArray<FVector>& normals, TArray<FVector>& forces);
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Contact")
+	FVector GetBodyContactForce(class UChBodyComponent* body);
+
+	// Frames are flat, GetTelemetryFrameWidth floats each; returns the number of frames
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Telemetry")
+	int DrainTelemetry(TArray<float>& frames, TArray<float>& times);
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Telemetry")
+	bool AppendTelemetryToCSV(const FString& filePath);
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Telemetry")
+	int GetTelemetryChannel(FName channelName) const { return telemetry.FindChannel(channelName); }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Telemetry")
+	int GetTelemetryChannelOffset(int channel) const { return channel >= 0 && channel < telemetry.GetChannelNum() ? telemetry.GetChannelOffset(channel) : INDEX_NONE; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Telemetry")
+	int GetTelemetryFrameWidth() const { return telemetry.GetFrameWidth(); }
+
+	// Every decimation-th telemetry frame to a recording file from a writer thread, frames that don't fit
+	// in the ring are dropped instead of stalling the step. Relative paths are under Saved/ChronoRecordings
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Telemetry")
+	bool StartOutputStream(const FString& filePath, int decimation = 1, int ringFrames = 4096);
+
+	// Writes out what is still in the ring and closes the file
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Telemetry")
+	void StopOutputStream();
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Telemetry")
+	int GetOutputStreamDroppedFrames() const { return outputPipeline ? outputPipeline->GetDroppedFrames() : 0; }
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Snapshot")
+	bool SaveSnapshot(int slot);
+
+	// Only valid while the scene has the same bodies and links as when the snapshot was saved
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Snapshot")
+	bool RestoreSnapshot(int slot);
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Snapshot")
+	float GetSnapshotTime(int slot) const;
+
+	// Captures now, compresses and writes on the thread pool. A save still writing finishes first
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Snapshot")
+	bool SaveCheckpoint(const FString& filePath, bool bCompress = true);
+
+	// Same scene requirement as RestoreSnapshot, the checkpoint also checks the class of every body
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Snapshot")
+	bool LoadCheckpoint(const FString& filePath);
+
+	// Chrono's JSON and XML archives of the current state, written on the thread pool. An empty path skips that format
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Snapshot")
+	bool ExportArchive(const FString& jsonPath, const FString& xmlPath);
+
+	// Handed to RealtimeInputHandler from the next real-time step on, channels are added as they are set
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Realtime")
+	void SetRealtimeInput(int channel, float value);
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Realtime")
+	FChRealtimeStats GetRealtimeStats() const;
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Realtime")
+	bool IsRealtimeRunning() const { return realtimeStepper.IsValid(); }
+
+	// Physics thread with bRealtimePacing, before every step with the channels of the last published frame
+	TFunction<void(const TArray<float>& inputs)> RealtimeInputHandler;
+
+	// Batch runs without a render tick: finishes construction, then steps back to back for simulatedSeconds
+	// with no visual sync and appends the telemetry to telemetryPath (none when empty). Returns the step count
+	int RunHeadless(float simulatedSeconds, float stepSeconds, const FString& telemetryPath);
+
+	// Constructs once and runs every variant headless from the same snapshot of the built scene.
+	// Telemetry of each variant goes to <outputDir>/<manager>_<variant>.csv when outputDir is set
+	TArray<FChSweepResult> RunSweep(const TArray<FChSweepVariant>& variants, float simulatedSeconds, float stepSeconds, const FString& outputDir);
+
+	// Closest hits of a batch of segments against the current collision world, traced in parallel into
+	// outHits, which callers keep between frames. Returns the hit count, 0 on the parallel backends
+	int TraceRays(const FChRayBatch& batch, FChRayHits& outHits);
+
+	FORCEINLINE FChTelemetry& GetTelemetry() { WaitForPhysicsStep(); return telemetry; }
+	FORCEINLINE const FChContactBuffer& GetContactBuffer() { WaitForPhysicsStep(); return contactBuffer; }
+
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void BuildAddOrder();
+	void AddObjectToSystemAt(int32 orderIndex);
+	void RebuildObjectIndices();
+	void OnObjectRegistered(UObject* object);
+	void OnObjectUnregistered(UObject* object);
+	// Objects registered after BeginPlay, built and added to the system as one batch before the next step
+	void AddPendingObjects();
+	// Unregistered objects stay in PhysicsObjectList, which keeps them from being collected, until this batch
+	void RemovePendingObjects();
+	void FlushPendingObjects();
+	// A streamed level adds or removes its objects in one burst, the batch is applied right away
+	void OnLevelStreamingChanged(ULevel* level, UWorld* world);
+	// Hands the BVH meshes and the proxies of the other bodies to staticColliders, objects already in it are skipped
+	void SyncColliderProxies();
+	// Hands the bBulkContact FEA surfaces and the box and sphere bodies to feaContacts
+	void SyncFEAContacts();
+	void SyncContinuousCollision();
+	// Moves the bodies bGpuRigidContacts applies to onto the device, after handing back the ones already there
+	void SyncGpuRigidWorld();
+	// Splits the bodies over the slabs bDomainDecomposition asks for, once per construction
+	void SetupDomains();
+	std::shared_ptr<chrono::ChSystem> CreateDomainSystem() const;
+	TSet<chrono::ChBody*> GetDomainExcludedBodies() const;
+	void BroadcastLinkBreaks();
 
 	std::shared_ptr<chrono::ChSystem> phySystem;
+	TFuture<void> PhysicsStepTask;
+	// Registered with phySystem as its custom collision callback, serial backends only
+	std::shared_ptr<FChStaticColliderSet> staticColliders;
+	// Registered next to staticColliders, serial backends only
+	std::shared_ptr<FChFEAContactSet> feaContacts;
+	// The Bullet pair cache's overlap filter, serial backends only
+	std::shared_ptr<FChCollisionGroupFilter> collisionGroupFilter;
+	// Bodies with bContinuousCollision, serial backends only
+	std::shared_ptr<FChContinuousCollision> continuousCollision;
+	// The system holds the callbacks as plain pointers
+	TArray<std::shared_ptr<FChParticleCloud>> particleClouds;
+	// Created with the first multirate spring
+	std::shared_ptr<FChMultirateSprings> multirateSprings;
+	// Created by FinishConstruction when the device took any bodies
+	std::shared_ptr<FChGpuRigidWorld> gpuWorld;
+	// Created by FinishConstruction with bDomainDecomposition, steps phySystem along with the other slabs
+	std::shared_ptr<FChDomainDecomposition> domains;
+	// Created with the first breakable link, breakableActors is indexed by its slots
+	std::shared_ptr<FChBreakableLinks> breakableLinks;
+	TArray<AChLinkActor*> breakableActors;
+	TArray<FChBreakableLinks::FBreak> pendingBreaks;
+	TArray<FChLinkBreak> linkBreaks;
+	// Library revision of the pair table phySystem composes contacts with
+	uint32 materialRevision = 0;
+
+	FChSceneJoinTickFunction joinTick;
+	// OpenMP thread counts are per calling thread, every step sets this again on the thread that runs it
+	int ompThreadCount = 1;
+
+	EChConstructionPhase::Type constructionPhase = EChConstructionPhase::READY;
+	int32 constructionCursor = 0;
+	TFuture<void> geometryTask;
+	// Object indices in the order they are added to the system
+	TArray<int32> addOrder;
+	float stepAccumulator = 0;
+	float interpolationAlpha = 1;
+	int lastSolverIterations = 0;
+	FIntVector currentBins;
+	float lastSolverResidual = 0;
+	int lastContactCount = 0;
+	int contactHighWater = 0;
+	int pooledContactHighWater = 0;
+	int pooledContactCount = 0;
+	FChMemoryStats memoryStats;
+	FChNetReplicator netReplicator;
+	FChPhysicsLOD physicsLOD;
+	TArray<chrono::ChVector<>> lodFocus;
+	int32 lodStepCounter = 0;
+	double lodElapsed = 0;
+	float netSendAccumulator = 0;
+	TArray<uint8> netSnapshotData;
+
+	TArray<class USceneComponent*> syncComponents;
+	TArray<FTransform> syncTransforms;
+
+	FChContactBuffer contactBuffer;
+
+	TArray<TUniquePtr<FChSceneSnapshot>> snapshots;
+	FChCheckpoint checkpoint;
+	TFuture<bool> checkpointTask;
+	TArray<TFuture<bool>> archiveTasks;
+
+	FChTelemetry telemetry;
+	TArray<IChPhysicsObjectInterface*> TelemetryWriterList;
+	TUniquePtr<FChOutputPipeline> outputPipeline;
+	TArray<float> telemetryFrames;
+	TArray<float> telemetryTimes;
+	// Newest frame of the last drain to CSV
+	TArray<float> lastTelemetryFrame;
+	FString telemetryCSV;
 
 	UPROPERTY(VisibleInstanceOnly)
 	TArray<TScriptInterface<IChPhysicsObjectInterface>> PhysicsObjectList;
+
+	// Objects that registered for UpdatePhysicsState after every substep
+	TArray<IChPhysicsObjectInterface*> PreStepObjectList;
+
+	// Position of every object in PhysicsObjectList
+	TMap<UObject*, int32> objectIndices;
+	TArray<TScriptInterface<IChPhysicsObjectInterface>> pendingObjects;
+	TSet<UObject*> pendingRemovals;
+	FDelegateHandle registryAddedHandle;
+	FDelegateHandle registryRemovedHandle;
+	FDelegateHandle levelAddedHandle;
+	FDelegateHandle levelRemovedHandle;
+
+	TUniquePtr<FChRealtimeStepper> realtimeStepper;
+	TChTripleBuffer<TArray<float>> realtimeInput;
+	// Game thread copy of the channels, published whole every tick
+	TArray<float> realtimeInputValues;
+	// Step count of the last visual update
+	int32 realtimeVisualStep = 0;
+
+#if WITH_EDITOR
+	struct FEditorPreviewPose
+	{
+		FTransform Transform;
+		TEnumAsByte<EComponentMobility::Type> Mobility;
+	};
+	// State of the preview scene as it was built, what it loops back to
+	TUniquePtr<FChSceneSnapshot> previewSnapshot;
+	// Root transforms of the actors as they were authored, building a body also makes its root movable
+	TMap<TWeakObjectPtr<AActor>, FEditorPreviewPose> previewPoses;
+	TSet<TWeakObjectPtr<UObject>> previewEdited;
+	TSet<TWeakObjectPtr<AActor>> previewMoved;
+	FDelegateHandle previewEditedHandle;
+	FDelegateHandle previewMovedHandle;
+	FDelegateHandle previewPIEHandle;
+#endif
 	
 };
 
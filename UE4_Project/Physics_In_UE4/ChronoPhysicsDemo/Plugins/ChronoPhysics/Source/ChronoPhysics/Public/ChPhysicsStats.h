@@ -0,0 +1,6 @@
+#pragma once
+
+#include "Stats/Stats.h"
+
+// "stat ChronoPhysics" in the console
+DECLARE_STATS_GROUP(TEXT("ChronoPhysics"), STATGROUP_ChronoPhysics, STATCAT_Advanced);
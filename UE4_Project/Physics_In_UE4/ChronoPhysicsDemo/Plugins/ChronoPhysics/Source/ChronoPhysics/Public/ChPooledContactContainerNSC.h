@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChContactContainerNSC.h"
+#include <list>
+
+/**
+ * NSC contact container whose contact objects, tuples included, outlive the step. Chrono's container already
+ * reuses the contacts of the last step but deletes what a smaller step leaves over and allocates again when the
+ * count goes back up. Here the left over contacts of each type are spliced into a parked list of that type at
+ * the end of the collision pass, list nodes included, and spliced back in front of the next pass, so only a
+ * step above the high water mark allocates. RemoveAllContacts parks everything in one go
+ */
+class CHRONOPHYSICS_API FChPooledContactContainerNSC : public chrono::ChContactContainerNSC
+{
+public:
+	FChPooledContactContainerNSC() {}
+	// A clone starts with an empty pool
+	FChPooledContactContainerNSC(const FChPooledContactContainerNSC& other) : ChContactContainerNSC(other) {}
+	virtual ~FChPooledContactContainerNSC();
+	virtual FChPooledContactContainerNSC* Clone() const override { return new FChPooledContactContainerNSC(*this); }
+
+	// Most contacts one collision pass added since the container was created
+	FORCEINLINE int32 GetContactHighWater() const { return highWater; }
+	// Contact objects alive, in use or parked
+	int32 GetPooledContactNum() const;
+
+	virtual void RemoveAllContacts() override;
+	virtual void BeginAddContact() override;
+	virtual void AddContact(const chrono::collision::ChCollisionInfo& mcontact) override;
+	virtual void EndAddContact() override;
+
+protected:
+	// Both sides fixed or kinematic, nothing the contact could move. Against the mass of a kinematic body the rows
+	// would only pile up impulses the size of that mass
+	static bool IsImmovablePair(const chrono::collision::ChCollisionInfo& mcontact);
+
+private:
+	std::list<ChContactNSC_6_6*> parked_6_6;
+	std::list<ChContactNSC_6_3*> parked_6_3;
+	std::list<ChContactNSC_3_3*> parked_3_3;
+	std::list<ChContactNSC_333_3*> parked_333_3;
+	std::list<ChContactNSC_333_6*> parked_333_6;
+	std::list<ChContactNSC_333_333*> parked_333_333;
+	std::list<ChContactNSC_666_3*> parked_666_3;
+	std::list<ChContactNSC_666_6*> parked_666_6;
+	std::list<ChContactNSC_666_333*> parked_666_333;
+	std::list<ChContactNSC_666_666*> parked_666_666;
+	std::list<ChContactNSCrolling_6_6*> parked_6_6_rolling;
+
+	int32 highWater = 0;
+};
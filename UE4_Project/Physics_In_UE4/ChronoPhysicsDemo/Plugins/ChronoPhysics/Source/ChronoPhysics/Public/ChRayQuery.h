@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace chrono {
+	class ChSystem;
+	class ChPhysicsItem;
+}
+
+// Segments in UE world space, a zero radius traces rays and a positive one sweeps a sphere of that radius in cm
+struct CHRONOPHYSICS_API FChRayBatch
+{
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	float SweepRadius = 0.f;
+};
+
+// Closest hit of every segment, indexed like the batch. Kept between batches so its arrays are allocated once
+struct CHRONOPHYSICS_API FChRayHits
+{
+	TArray<bool> bHit;
+	// cm from the start, for sweeps to the sphere center at the hit
+	TArray<float> Distance;
+	TArray<FVector> Point;
+	TArray<FVector> Normal;
+	TArray<chrono::ChPhysicsItem*> Item;
+
+	// Doesn't shrink, the arrays only reallocate when a batch is larger than every one before
+	void SetNum(int32 num);
+};
+
+/**
+ * Batched closest hit queries against the Bullet world of a serial system, on the task graph. Bullet's own
+ * world queries share a traversal stack in the broadphase, so each ray walks the broadphase trees itself with
+ * the re-entrant dbvt traversal and is tested against the candidates with Bullet's per object queries.
+ * Custom collision callbacks (static colliders, particle clouds) aren't in the Bullet world and aren't hit
+ */
+class CHRONOPHYSICS_API FChRayQuery
+{
+public:
+	// Not while the system steps. Returns the number of hits, none on systems without a Bullet dbvt broadphase
+	static int32 Trace(chrono::ChSystem* system, const FChRayBatch& batch, FChRayHits& outHits);
+};
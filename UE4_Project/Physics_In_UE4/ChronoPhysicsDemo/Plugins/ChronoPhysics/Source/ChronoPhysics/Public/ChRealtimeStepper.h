@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "ChRealtimeStepper.generated.h"
+
+// Pacing of the real-time stepper since it started, copied out by GetStats
+USTRUCT(BlueprintType)
+struct CHRONOPHYSICS_API FChRealtimeStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	int32 Steps = 0;
+
+	// Steps that ended after the deadline of the next one
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	int32 MissedDeadlines = 0;
+
+	// Steps given up on when the schedule fell more than MaxCatchUpSteps behind
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	int32 DroppedSteps = 0;
+
+	// Wall clock between two step starts, what the pacing is measured by
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	float MeanPeriodMs = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	float MaxPeriodErrorMs = 0;
+
+	// How late step starts were against their deadline, HistogramBinMs per bin, the last bin holds everything later
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	TArray<int32> LatenessHistogram;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	float HistogramBinMs = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Chrono|Realtime")
+	float MaxLatenessMs = 0;
+};
+
+struct FChRealtimeSettings
+{
+	double StepSeconds = 0.001;
+	// Logical core the thread is pinned to, none when negative
+	int32 Core = INDEX_NONE;
+	// Before a deadline the thread sleeps until this much is left and spins the rest, covering the scheduler's wake up latency
+	double SpinSeconds = 0.0015;
+	// Late steps run back to back until the schedule is this far behind, then it starts over from now
+	int32 MaxCatchUpSteps = 4;
+};
+
+/**
+ * Lock-free handoff of the latest value between one writer and one reader thread. Of the three copies the
+ * writer fills one, the reader holds one and the third is swapped between them on publish and on update,
+ * so neither side waits and the reader never sees a copy being written. Copies are reused, arrays in T keep
+ * their memory once both sides have gone through all three
+ */
+template<typename T>
+class TChTripleBuffer
+{
+public:
+	// Writer only
+	FORCEINLINE T& GetWriteBuffer() { return buffers[writeIndex]; }
+	FORCEINLINE void Publish()
+	{
+		writeIndex = FPlatformAtomics::InterlockedExchange(&shared, writeIndex | DirtyBit) & IndexMask;
+	}
+
+	// Reader only, false when nothing was published since the last update and the read buffer stays as it was
+	FORCEINLINE bool Update()
+	{
+		if ((FPlatformAtomics::AtomicRead(&shared) & DirtyBit) == 0) {
+			return false;
+		}
+		readIndex = FPlatformAtomics::InterlockedExchange(&shared, readIndex) & IndexMask;
+		return true;
+	}
+	FORCEINLINE const T& GetReadBuffer() const { return buffers[readIndex]; }
+
+private:
+	static const int32 IndexMask = 3;
+	static const int32 DirtyBit = 4;
+
+	T buffers[3];
+	int32 writeIndex = 0;
+	volatile int32 shared = 1;
+	int32 readIndex = 2;
+};
+
+/**
+ * Runs fixed steps on a dedicated time critical thread, each started on a deadline of the monotonic clock
+ * instead of once per frame. The thread sleeps until SpinSeconds before the deadline and spins the rest, the
+ * wall clock step period is measured with Chrono's ChRealtimeStepTimer. Everything else reaching into the system
+ * pauses the thread with Pause, which returns once the current step is done; the schedule starts over on Resume,
+ * so the time spent paused doesn't count as missed deadlines
+ */
+class CHRONOPHYSICS_API FChRealtimeStepper : public FRunnable
+{
+public:
+	static const int32 HistogramBins = 32;
+	static const int32 HistogramBinMicroseconds = 50;
+	static const int32 PauseCheckMs = 100;
+
+	FChRealtimeStepper(const FChRealtimeSettings& inSettings, TFunction<void(double)> inStepFunction);
+	virtual ~FChRealtimeStepper();
+
+	// Game thread; the pause holds until Resume. Also returns once the thread has exited
+	void Pause();
+	void Resume();
+	FORCEINLINE bool IsPaused() const { return bHeld; }
+	FORCEINLINE int32 GetStepCount() const { return steps.GetValue(); }
+	void GetStats(FChRealtimeStats& outStats) const;
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void WaitUntil(double deadline) const;
+	void RecordLateness(double lateness);
+
+	FChRealtimeSettings settings;
+	TFunction<void(double)> stepFunction;
+
+	FThreadSafeCounter steps;
+	FThreadSafeCounter missedDeadlines;
+	FThreadSafeCounter droppedSteps;
+	FThreadSafeCounter maxLatenessMicroseconds;
+	FThreadSafeCounter maxPeriodErrorMicroseconds;
+	FThreadSafeCounter64 periodMicroseconds;
+	FThreadSafeCounter periodCount;
+	FThreadSafeCounter histogram[HistogramBins];
+
+	FThreadSafeCounter stopping;
+	FThreadSafeCounter exited;
+	FThreadSafeCounter pauseRequested;
+	// Game thread side of the pause
+	bool bHeld = false;
+	FEvent* pausedEvent = nullptr;
+	FEvent* resumeEvent = nullptr;
+	FRunnableThread* thread = nullptr;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ChReplayCommandlet.generated.h"
+
+/**
+ * Replays a recorded input stream against one benchmark scene and checks the run against a golden file:
+ * the state hash of every step and the per step timings of each phase.
+ *
+ * UE4Editor-Cmd.exe ChronoPhysicsDemo.uproject -run=ChReplay -Scene=WheeledRigOnRigid -Backend=SERIAL_NSC -Threads=4
+ *     -Input=D:/Recordings/drive.csv -Golden=D:/Golden/drive_rig.json -PerfTolerance=0.15 -nullrhi
+ *
+ * -Record writes the golden file instead of comparing. Steps default to the length of the input, 1000 without
+ * one. -HashResolution rounds the state before hashing, for goldens shared between compilers; the default of 0
+ * compares exact bits. -Warmup=50 untimed steps run first on a separate build of the scene. The perf checks are
+ * skipped with a warning against a golden file recorded on another CPU. Returns 1 when a check fails, the failures
+ * are logged
+ */
+UCLASS()
+class CHRONOPHYSICS_API UChReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UChReplayCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
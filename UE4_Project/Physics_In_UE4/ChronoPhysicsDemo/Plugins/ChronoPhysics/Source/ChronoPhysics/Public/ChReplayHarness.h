@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChBenchmark.h"
+#include <memory>
+
+class FChFunctionRecorder;
+
+namespace chrono {
+	class ChSystem;
+}
+
+/**
+ * Recorded inputs of a replay, in the layout AppendTelemetryToCSV writes: a Time column, then a column per
+ * channel component named <Channel>[<component>], [0] when left out. The channels a replay drives:
+ *   Motor<N>         function value of the Nth motor link of the system, the speed of a speed motor
+ *   Force<N>[0..2]   world force on the center of mass of the Nth body, Torque<N> the same for torques
+ *   Joystick[0..]    axes handed to the scene's ApplyJoystick, throttle and steering on the wheeled rigs
+ * Columns are linear between their samples and hold their end values outside them. Unknown columns are
+ * ignored, so a telemetry recording with other channels next to these replays as it is
+ */
+class CHRONOPHYSICS_API FChReplayInput
+{
+public:
+	bool LoadCSV(const FString& filePath, FString& outError);
+	FORCEINLINE double GetDuration() const { return duration; }
+	FORCEINLINE int32 GetColumnNum() const { return columns.Num(); }
+
+	// Motor columns become the motor functions, Chrono evaluates them itself. False when a target doesn't exist
+	bool Bind(chrono::ChSystem* system, FString& outError) const;
+	// Forces, torques and joystick axes for the step starting at the system's time
+	void Apply(chrono::ChSystem* system, FChBenchmarkScene& scene) const;
+
+private:
+	enum EChannel { MOTOR, FORCE, TORQUE, JOYSTICK };
+
+	struct FColumn
+	{
+		EChannel Channel;
+		int32 Index;
+		int32 Component;
+		std::shared_ptr<FChFunctionRecorder> Samples;
+	};
+
+	TArray<FColumn> columns;
+	int32 joystickAxes = 0;
+	double duration = 0;
+	mutable TArray<double> axes;
+};
+
+// One replay, or the golden run it is compared with
+struct FChReplayRun
+{
+	FChBenchmarkResult Timing;
+	double StepSize = 0;
+	// 0 hashes the exact bits of the state, otherwise the state rounded to multiples of it
+	double HashResolution = 0;
+	// CPU the timings were taken on, empty in golden files older than the field
+	FString Platform;
+	// After every step
+	TArray<uint64> Hashes;
+};
+
+struct FChReplayThresholds
+{
+	// Steps whose hash may differ from the golden one
+	int32 MaxHashMismatches = 0;
+	// A phase fails when it is this fraction slower than in the golden run...
+	double PerfTolerance = 0.15;
+	// ...and slower by at least this much, so sub-millisecond phases don't fail on timer noise
+	double PerfFloorMs = 0.05;
+};
+
+struct FChReplayVerdict
+{
+	bool bPassed = true;
+	int32 HashMismatches = 0;
+	int32 FirstMismatchStep = INDEX_NONE;
+	// One line per failed check
+	TArray<FString> Failures;
+	// Checks that were skipped, the perf ones when the golden run is from another CPU
+	TArray<FString> Warnings;
+};
+
+namespace ChReplay {
+	// Positions, rotations and velocities of every body and FEA node, in system order
+	CHRONOPHYSICS_API uint64 HashState(chrono::ChSystem& system, double resolution);
+
+	// Builds the scene fresh and steps it steps times with the inputs applied before each step. Timings are
+	// the benchmark's, the hashing is outside the timed part. warmupSteps run first on a throwaway build of the
+	// scene, so they warm the caches and allocator without moving the replayed states the hashes are taken of
+	CHRONOPHYSICS_API bool Run(FChBenchmarkScene& scene, EChSystemBackend::Type backend, int32 threads, int32 warmupSteps, int32 steps,
+		const FChReplayInput& input, double hashResolution, bool bThreadedShur, FChReplayRun& outRun, FString& outError);
+
+	// The perf checks are skipped with a warning when the runs are from different CPUs
+	CHRONOPHYSICS_API FChReplayVerdict Compare(const FChReplayRun& run, const FChReplayRun& golden, const FChReplayThresholds& thresholds);
+
+	// Hashes as hex strings, JSON numbers don't hold 64 bits
+	CHRONOPHYSICS_API FString ToJson(const FChReplayRun& run);
+	CHRONOPHYSICS_API bool FromJson(const FString& json, FChReplayRun& outRun);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "ChPhysicsObjectInterface.h"
+#include <memory>
+#include "ChSCMTerrainComponent.generated.h"
+
+class FChParallelSCMSoil;
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+	namespace vehicle {
+		class SCMDeformableTerrain;
+	}
+}
+
+// Square block of the terrain mesh drawn as one procedural mesh section
+struct FChSCMTerrainTile
+{
+	TArray<int32> Faces;
+	TArray<int32> Vertices;
+	TArray<int32> Triangles;
+	FBox2D Bounds = FBox2D(ForceInit);
+	bool bDirty = false;
+	bool bTopologyDirty = false;
+};
+
+/**
+ * Flat SCM deformable soil, sized in component space and split into tiles.
+ * Only the tiles whose vertices moved since the last upload are sent to the renderer.
+ * SCM soil is a load container, so only the serial backends are supported.
+ * With bParallelSoil the soil runs on FChParallelSCMSoil instead of Chrono's SCMDeformableTerrain.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class CHRONOPHYSICS_API UChSCMTerrainComponent : public UProceduralMeshComponent, public IChPhysicsObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMTerrain")
+	float SizeX = 2000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMTerrain")
+	float SizeY = 2000.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMTerrain")
+	int DivX = 256;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMTerrain")
+	int DivY = 256;
+
+	// Tiles per axis, each one is a separate mesh section
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMTerrain")
+	int TilesPerAxis = 8;
+
+	// Texture coordinates per cm
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMTerrain")
+	float UVScale = 0.01f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float BekkerKphi = 2e6f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float BekkerKc = 0.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float BekkerN = 1.1f;
+
+	// Pa
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float MohrCohesion = 0.f;
+
+	// Degrees
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float MohrFriction = 30.f;
+
+	// cm
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float JanosiShear = 1.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float ElasticK = 2e8f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float DampingR = 3e4f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	bool bBulldozing = false;
+
+	// Vertices are ray tested only up to this height above the soil, in cm. Keep it near the expected rubble height
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	float TestHighOffset = 10.f;
+
+	// Forces from the cells under the bodies, computed on all cores. No bulldozing, refinement or moving patch
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil")
+	bool bParallelSoil = false;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil", meta = (EditConditionToggle))
+	bool bAutomaticRefinement = false;
+
+	// cm
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil", meta = (editcondition = "bAutomaticRefinement"))
+	float RefinementResolution = 4.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil", meta = (EditConditionToggle))
+	bool bMovingPatch = false;
+
+	// Actor with a Chrono body component the soil patch follows
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil", meta = (editcondition = "bMovingPatch"))
+	AActor* TrackedActor;
+
+	// Patch center relative to the tracked body
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil", meta = (editcondition = "bMovingPatch"))
+	FVector PatchOffset = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|SCMSoil", meta = (editcondition = "bMovingPatch"))
+	FVector2D PatchSize = FVector2D(600.f, 400.f);
+
+	UChSCMTerrainComponent();
+
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void PhysicsObjectConstruct() override;
+	virtual void PhysicsObjectInitalize() override;
+	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
+	virtual void UpdateVisualAsset() override;
+	virtual void CacheVisualState() override;
+	virtual bool& GetIsForParallel() override { return isForParallel; }
+	virtual bool& GetIsForSMC() override { return isForSMC; }
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetDirtyTileCount() const { return lastUploadedTiles; }
+
+	// Vertices under a body after the last step, parallel soil only
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetTouchedVertexCount() const;
+
+	FORCEINLINE std::shared_ptr<chrono::vehicle::SCMDeformableTerrain> GetChData() { return this->ChDataTerrain; }
+
+protected:
+	void RebuildTiles();
+	void RebuildAdjacency();
+	void UploadTile(int32 tile);
+
+	std::shared_ptr<chrono::vehicle::SCMDeformableTerrain> ChDataTerrain;
+	std::shared_ptr<FChParallelSCMSoil> parallelSoil;
+	chrono::ChSystem* system = nullptr;
+	std::shared_ptr<chrono::ChBody> trackedBody;
+
+	bool isForParallel = false;
+	bool isForSMC = false;
+
+	// Simulated state in UE world space, written by CacheVisualState
+	TArray<FVector> cachedPositions;
+	TArray<FIntVector> cachedFaces;
+	// Faces added or given other corners by the last topology change, a tile with its old face list still rebuilds
+	TBitArray<> changedFaces;
+	TBitArray<> movedVertices;
+	TArray<FChSCMTerrainTile> Tiles;
+	FBox2D patchBounds;
+	bool bPatchBoundsValid = false;
+
+	// Faces around each vertex, flattened with per-vertex offsets
+	TArray<int32> vertexFaceOffsets;
+	TArray<int32> vertexFaces;
+
+	TArray<FVector> sectionVertices;
+	TArray<FVector> sectionNormals;
+	TArray<FVector2D> sectionUVs;
+	int lastUploadedTiles = 0;
+};
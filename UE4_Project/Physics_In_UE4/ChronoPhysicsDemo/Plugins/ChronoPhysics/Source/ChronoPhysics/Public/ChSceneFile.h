@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Flags of FChSceneBody and FChSceneLink, the fields without their flag keep the defaults
+namespace EChSceneFlags {
+	enum Type : uint8 {
+		Position = 1 << 0,
+		Rotation = 1 << 1,
+		Scale = 1 << 2,
+		Density = 1 << 3,
+		Fixed = 1 << 4
+	};
+}
+
+// Stored as is in the binary scene, 44 bytes
+struct FChSceneBody
+{
+	FVector Position;
+	FRotator Rotation;
+	FVector Scale;
+	float Density;
+	// EShapeType
+	uint8 Shape;
+	uint8 Flags;
+	uint16 Pad;
+};
+
+// Stored as is in the binary scene, 36 bytes
+struct FChSceneLink
+{
+	FVector Position;
+	FRotator Rotation;
+	// Body indices, INDEX_NONE when the name didn't match a body
+	int32 Target1;
+	int32 Target2;
+	// ELinkType
+	uint8 Type;
+	uint8 Flags;
+	uint16 Pad;
+};
+
+/**
+ * Bodies and links of an APhysicsObjectGeneratorJson scene. The json names the link targets, the
+ * binary .chscene file stores the resolved body indices instead, a header followed by the two record
+ * arrays, so loading it is one read and two copies. Nothing here touches UObjects, it can load on any thread
+ */
+struct CHRONOPHYSICS_API FChSceneData
+{
+	TArray<FChSceneBody> Bodies;
+	TArray<FChSceneLink> Links;
+
+	bool LoadJson(const FString& filePath);
+	bool LoadBinary(const FString& filePath);
+	bool SaveBinary(const FString& filePath) const;
+	// The binary file when it is newer than the json, otherwise the json, written back as binary when bWriteBinary
+	bool Load(const FString& jsonPath, const FString& binaryPath, bool bWriteBinary);
+
+	// Case insensitive, unknown names give sphere and FREE like before
+	static uint8 FindShape(const FString& name);
+	static uint8 FindLinkType(const FString& name);
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <memory>
+
+namespace chrono {
+	class ChSystem;
+	class ChState;
+	class ChStateDelta;
+	template <class Real> class ChVectorDynamic;
+}
+
+/**
+ * Full integrable state of a ChSystem: positions, velocities, accelerations,
+ * constraint reactions and time. Buffers are sized on Allocate and reused by
+ * every Save/Restore as long as the system layout does not change
+ */
+class CHRONOPHYSICS_API FChSceneSnapshot
+{
+public:
+	FChSceneSnapshot();
+	~FChSceneSnapshot();
+
+	void Allocate(chrono::ChSystem* system);
+	bool Save(chrono::ChSystem* system);
+	// Fails if bodies or links were added or removed since the snapshot was taken
+	bool Restore(chrono::ChSystem* system) const;
+
+	FORCEINLINE bool IsValid() const { return bValid; }
+	FORCEINLINE double GetTime() const { return time; }
+
+private:
+	std::unique_ptr<chrono::ChState> x;
+	std::unique_ptr<chrono::ChStateDelta> v;
+	std::unique_ptr<chrono::ChStateDelta> a;
+	std::unique_ptr<chrono::ChVectorDynamic<double>> L;
+	double time = 0;
+	int ncoordsX = 0;
+	int ncoordsV = 0;
+	int nconstr = 0;
+	bool bValid = false;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace chrono {
+	namespace geometry {
+		class ChTriangleMeshConnected;
+	}
+}
+
+/**
+ * Binary cache of converted collision shapes in Saved/ChronoShapeCache,
+ * keyed by static mesh package GUID, scale and collision margin. Saving is thread safe, each key
+ * is written once per run however many build tasks save it
+ */
+class CHRONOPHYSICS_API FChShapeCache
+{
+public:
+	static FString MakeKey(const class UStaticMesh* mesh, const FVector& scale, const TCHAR* shapeKind);
+
+	// Indexed mesh, stored in Chrono's own vertex and face layout
+	static bool LoadTriMesh(const FString& key, chrono::geometry::ChTriangleMeshConnected& mesh);
+	static bool SaveTriMesh(const FString& key, chrono::geometry::ChTriangleMeshConnected& mesh);
+
+	// Hull point sets, already scaled and in Chrono units
+	static bool LoadHulls(const FString& key, TArray<TArray<FVector>>& hulls);
+	static bool SaveHulls(const FString& key, const TArray<TArray<FVector>>& hulls);
+
+private:
+	static FString GetCacheFile(const FString& key);
+};
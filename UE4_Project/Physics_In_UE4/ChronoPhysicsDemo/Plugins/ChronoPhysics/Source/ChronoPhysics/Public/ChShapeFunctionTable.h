@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Shape function values and parametric derivatives of one element type at the points of its quadrature
+ * rule, evaluated once per process. Sizes are template arguments, so the loops over nodes and points in
+ * the elements using a table have fixed trip counts
+ */
+template <int32 NodeNum, int32 PointNum>
+struct TChShapeFunctionTable
+{
+	static constexpr int32 Nodes = NodeNum;
+	static constexpr int32 Points = PointNum;
+
+	double N[PointNum][NodeNum];
+	// d N / d (xi, eta, zeta)
+	double DN[PointNum][NodeNum][3];
+	double Weight[PointNum];
+};
+
+// Trilinear hexahedron, corners in the usual order, 2 x 2 x 2 Gauss points
+typedef TChShapeFunctionTable<8, 8> FChHexa8ShapeTable;
+CHRONOPHYSICS_API const FChHexa8ShapeTable& GetHexa8ShapeTable();
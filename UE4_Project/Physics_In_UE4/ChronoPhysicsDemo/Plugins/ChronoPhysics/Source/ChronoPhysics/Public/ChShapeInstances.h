@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include <memory>
+
+namespace chrono {
+	class ChBody;
+	namespace collision {
+		class ChCollisionModel;
+		class ChModelBullet;
+	}
+}
+
+// One built Bullet model whose shapes are shared by every body instanced from it
+struct FChShapeTemplate
+{
+	std::shared_ptr<chrono::collision::ChModelBullet> Model;
+};
+
+/**
+ * Identical collision geometry built once and shared by reference. A body instanced from a template
+ * points its Bullet object at the template's shape, several hulls stay one compound with Bullet's own
+ * AABB tree over the children. Templates are held by the bodies' components only and go with the last of them
+ */
+class CHRONOPHYSICS_API FChShapeInstances
+{
+public:
+	// Shape kind and its dimensions in Chrono units, the collision margins go into the key as well
+	static FString MakeKey(const TCHAR* shapeKind, const FVector& size);
+
+	// The template for the key, built with build on first use. Thread safe, build runs under the lock
+	static std::shared_ptr<FChShapeTemplate> Find(const FString& key, TFunctionRef<void(chrono::collision::ChCollisionModel& model)> build);
+
+	// Replaces the body's collision model shapes with the template's, the body needs a Bullet model
+	static bool Instance(chrono::ChBody& body, const FChShapeTemplate& shape);
+
+	static int32 GetTemplateNum();
+};
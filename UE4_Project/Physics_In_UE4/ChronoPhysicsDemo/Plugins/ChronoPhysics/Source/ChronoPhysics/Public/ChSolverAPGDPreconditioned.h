@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/solver/ChIterativeSolver.h"
+#include "chrono/core/ChMatrixDynamic.h"
+#include <vector>
+
+/**
+ * APGD with a block Jacobi preconditioner. Each step the diagonal of the Schur complement, which every
+ * constraint caches from its bodies' inverse masses, is averaged over each contact's normal and tangent
+ * rows and over each rolling triple, and its inverse scales the gradient step of the whole block. One
+ * factor per block keeps the friction cone projection exact, and rows of light and heavy bodies converge
+ * at the same rate instead of the heaviest dictating the step. Otherwise Chrono's ChSolverAPGD
+ */
+class CHRONOPHYSICS_API FChSolverAPGDPreconditioned : public chrono::ChIterativeSolver
+{
+public:
+	FChSolverAPGDPreconditioned(int maxIterations = 1000, bool bWarmStart = false, double tolerance = 0.0)
+		: ChIterativeSolver(maxIterations, bWarmStart, tolerance, 0.0001) {}
+
+	virtual Type GetType() const override { return Type::APGD; }
+	virtual double Solve(chrono::ChSystemDescriptor& sysd) override;
+
+	FORCEINLINE double GetResidual() const { return residual; }
+
+private:
+	// The inverse block diagonal, one entry per active constraint row
+	void BuildPreconditioner(chrono::ChSystemDescriptor& sysd);
+	// b of N*l = b like ChSolverAPGD, leaves M^-1*f in the variables
+	void ComputeSchurRhs(chrono::ChSystemDescriptor& sysd);
+	// 0.5 * x' * N * x - x' * r
+	double Objective(chrono::ChSystemDescriptor& sysd, chrono::ChMatrixDynamic<>& x);
+	// Norm of the projected gradient step, Chrono's Res4
+	double Residual(chrono::ChSystemDescriptor& sysd, chrono::ChMatrixDynamic<>& x);
+
+	double residual = 0;
+	int nc = 0;
+	std::vector<double> preconditioner;
+	chrono::ChMatrixDynamic<> gamma, gammaBest, gammaNew, y, yNew, g, r, tmp, product;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/solver/ChIterativeSolver.h"
+#include <vector>
+
+namespace chrono {
+	class ChConstraint;
+	class ChVariablesBody;
+}
+
+/**
+ * Projected SOR whose bilateral body to body joints are solved exactly when they form trees, as the link
+ * chains of cranes, arms and tracks do. The joints of a tree and their bodies make a sparse KKT matrix that
+ * is factored without fill in, children before parents, once per solve (Baraff's linear time method), so
+ * every sweep corrects all joint multipliers of the tree at once in O(n) against the current contact
+ * impulses instead of relaxing them row by row. Contacts, unilateral rows and joints closing a loop are
+ * swept like ChSolverSOR, and both go through the descriptor's variables, so they couple as usual
+ */
+class CHRONOPHYSICS_API FChSolverArticulated : public chrono::ChIterativeSolver
+{
+public:
+	FChSolverArticulated(int maxIterations = 50, bool bWarmStart = false, double tolerance = 0.0, double omega = 1.0)
+		: ChIterativeSolver(maxIterations, bWarmStart, tolerance, omega) {}
+
+	virtual Type GetType() const override { return Type::SOR; }
+	virtual double Solve(chrono::ChSystemDescriptor& sysd) override;
+
+	FORCEINLINE int32 GetTreeJointNum() const { return treeJointNum; }
+
+private:
+	// A body or a joint of the trees, blocks are at most 6 wide
+	struct FNode
+	{
+		int32 Size = 0;
+		int32 Parent = INDEX_NONE;
+		// Rows in treeRows for joints, INDEX_NONE for bodies
+		int32 FirstRow = INDEX_NONE;
+		// D^-1 and J = D^-1 * H(node, parent) of the factorization, H(node, parent) itself
+		double DInv[6][6];
+		double J[6][6];
+		double H[6][6];
+		double X[6];
+	};
+
+	// A constraint, or the three rows of a friction contact
+	struct FUnit
+	{
+		int32 First;
+		int32 Size;
+	};
+
+	void BuildTrees(chrono::ChSystemDescriptor& sysd);
+	void Factor();
+	// Exact multiplier update of every tree joint, returns the largest joint violation before it
+	double SolveTrees(double& outDeltaLambda);
+	double SolveUnit(const FUnit& unit, double& outDeltaLambda);
+
+	std::vector<chrono::ChConstraint*> active;
+	std::vector<FUnit> units;
+	std::vector<chrono::ChConstraint*> treeRows;
+	// Children before parents
+	std::vector<FNode> nodes;
+	int32 treeJointNum = 0;
+};
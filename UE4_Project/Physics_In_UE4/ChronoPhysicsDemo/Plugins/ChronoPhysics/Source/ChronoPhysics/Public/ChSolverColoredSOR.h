@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/solver/ChIterativeSolver.h"
+#include <vector>
+
+namespace chrono {
+	class ChConstraint;
+	class ChVariables;
+}
+
+/**
+ * Projected SOR like ChSolverSOR, with the constraints greedily colored by the bodies they act on once
+ * per solve. Constraints of one color share no active body, so each color is swept in parallel without
+ * races and the colors run in a fixed order: the result does not depend on the thread count and converges
+ * like a serial sweep in that order. A contact's normal and tangent rows are one unit, bodies that are
+ * fixed don't connect anything, and constraints whose bodies can't be read run serially after the colors
+ */
+class CHRONOPHYSICS_API FChSolverColoredSOR : public chrono::ChIterativeSolver
+{
+public:
+	FChSolverColoredSOR(int maxIterations = 50, bool bWarmStart = false, double tolerance = 0.0, double omega = 1.0)
+		: ChIterativeSolver(maxIterations, bWarmStart, tolerance, omega) {}
+
+	virtual Type GetType() const override { return Type::SOR; }
+	virtual double Solve(chrono::ChSystemDescriptor& sysd) override;
+
+	FORCEINLINE int32 GetColorNum() const { return colorNum; }
+
+private:
+	// A constraint, or the three rows of a friction contact
+	struct FUnit
+	{
+		int32 First;
+		int32 Size;
+	};
+
+	void BuildColors(chrono::ChSystemDescriptor& sysd);
+	// One projected Gauss-Seidel update of a unit, returns its violation
+	double SolveUnit(const FUnit& unit, double& outDeltaLambda);
+
+	std::vector<chrono::ChConstraint*> active;
+	std::vector<FUnit> units;
+	// Units sorted by color, the last batch is the serial one
+	std::vector<int32> batchStart;
+	std::vector<int32> batchUnits;
+	std::vector<double> unitViolation;
+	std::vector<double> unitDeltaLambda;
+	int32 colorNum = 0;
+};
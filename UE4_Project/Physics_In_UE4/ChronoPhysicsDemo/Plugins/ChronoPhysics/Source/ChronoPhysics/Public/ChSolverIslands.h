@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/solver/ChIterativeSolver.h"
+#include <vector>
+
+namespace chrono {
+	class ChConstraint;
+	class ChVariables;
+}
+
+/**
+ * Projected SOR like ChSolverSOR, run separately on every island of the descriptor. Islands are found once
+ * per solve with a union-find over the active variables each constraint acts on, so bodies joined by links
+ * or contacts end up together and fixed bodies, whose variables are inactive, join nothing. Islands are
+ * solved side by side, each serially in descriptor order and until its own violation is below the tolerance,
+ * so the result does not depend on the thread count and a settled pile stops iterating while a busy one goes
+ * on. Sleeping bodies leave their variables inactive too: an island made only of them has no active variable
+ * and is skipped. Constraints whose bodies can't be read merge everything into one island
+ */
+class CHRONOPHYSICS_API FChSolverIslands : public chrono::ChIterativeSolver
+{
+public:
+	FChSolverIslands(int maxIterations = 50, bool bWarmStart = false, double tolerance = 0.0, double omega = 1.0)
+		: ChIterativeSolver(maxIterations, bWarmStart, tolerance, omega) {}
+
+	virtual Type GetType() const override { return Type::SOR; }
+	virtual double Solve(chrono::ChSystemDescriptor& sysd) override;
+
+	FORCEINLINE int32 GetIslandNum() const { return (int32)islandStart.size() - 1; }
+	// Constraints left out because all their bodies were fixed or asleep
+	FORCEINLINE int32 GetSkippedConstraintNum() const { return skippedNum; }
+
+private:
+	// A constraint, or the three rows of a friction contact
+	struct FUnit
+	{
+		int32 First;
+		int32 Size;
+	};
+
+	void BuildIslands(chrono::ChSystemDescriptor& sysd);
+	// One projected Gauss-Seidel update of a unit, returns its violation
+	double SolveUnit(const FUnit& unit, double& outDeltaLambda);
+	// Iterations run, the island's violation and multiplier change after each go to the history arrays
+	int32 SolveIsland(int32 island);
+
+	std::vector<chrono::ChConstraint*> active;
+	std::vector<FUnit> units;
+	// Units grouped by island, largest islands first so the long ones start early
+	std::vector<int32> islandStart;
+	std::vector<int32> islandUnits;
+	// max_iterations entries per island
+	std::vector<double> islandViolation;
+	std::vector<double> islandDeltaLambda;
+	std::vector<int32> islandIterations;
+	int32 skippedNum = 0;
+};
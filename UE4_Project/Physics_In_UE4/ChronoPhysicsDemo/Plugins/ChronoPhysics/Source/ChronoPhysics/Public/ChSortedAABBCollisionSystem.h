@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono_parallel/collision/ChCollisionSystemParallel.h"
+#include <vector>
+
+/**
+ * Parallel collision system whose AABB pass runs per shape type instead of through the generator's switch over
+ * every shape. Spheres, boxes and capsules each have their own index list and are bounded four at a time, the
+ * body and shape rotations as lanes of one AVX register. Shapes of bodies that are fixed or asleep and haven't
+ * moved since the last step keep their cached boxes. Scenes with any other shape type use the stock generator.
+ *
+ * With the batched narrowphase the candidate pairs are bucketed by shape types the same way: sphere-sphere,
+ * box-sphere and capsule-sphere pairs run four at a time through closed form kernels, every other pair goes
+ * through Chrono's analytic tests with MPR as the fallback, like NARROWPHASE_HYBRID_MPR. Contacts come out in
+ * pair order, as the stock pass writes them. Fluid, FEA nodes or the freeze box go through the stock Run
+ */
+class CHRONOPHYSICS_API FChSortedAABBCollisionSystem : public chrono::collision::ChCollisionSystemParallel
+{
+public:
+	FChSortedAABBCollisionSystem(chrono::ChParallelDataManager* dataManager);
+
+	virtual void Run() override;
+
+	FORCEINLINE void SetSortedAABB(bool bEnable) { bSortedAABB = bEnable; }
+	FORCEINLINE void SetBatchedNarrowphase(bool bEnable) { bBatchedNarrowphase = bEnable; }
+
+	// Last step, zero when it went through the stock Run
+	FORCEINLINE int32 GetBoundedCount() const { return boundedCount; }
+	FORCEINLINE int32 GetCachedCount() const { return cachedCount; }
+	FORCEINLINE int32 GetBatchedPairCount() const { return batchedPairCount; }
+	FORCEINLINE int32 GetGenericPairCount() const { return genericPairCount; }
+
+private:
+	enum EShapeList {
+		SPHERE_LIST,
+		BOX_LIST,
+		CAPSULE_LIST,
+		NUM_LISTS
+	};
+
+	enum EPairBucket {
+		SPHERE_SPHERE_BUCKET,
+		BOX_SPHERE_BUCKET,
+		CAPSULE_SPHERE_BUCKET,
+		// Analytic test of any other pair, MPR when there is none
+		GENERIC_BUCKET,
+		NUM_BUCKETS
+	};
+
+	// Rebuilds the lists when the shapes changed, false when the sorted pass can't bound this scene
+	bool PrepareSortedPass();
+	void GenerateAABB();
+	// Fills the rigid contact arrays from the broadphase pairs, in place of the dispatcher's ProcessRigids
+	void ProcessRigidPairs();
+
+	// ChCollisionSystemParallel keeps its own private
+	chrono::ChParallelDataManager* data;
+
+	// What the lists were built from
+	std::vector<int> sortedTypes;
+	std::vector<uint> sortedBodies;
+	bool bSupported = false;
+	bool bSortedAABB = true;
+	bool bBatchedNarrowphase = false;
+	TArray<int32> lists[NUM_LISTS];
+	TArray<int32> dirty;
+
+	// World boxes before the broadphase offsets them, and the body poses they were computed for
+	std::vector<chrono::real3> shapeMin;
+	std::vector<chrono::real3> shapeMax;
+	std::vector<chrono::real3> cachedPos;
+	std::vector<chrono::quaternion> cachedRot;
+	TArray<bool> bodyCached;
+	TArray<bool> bodyReused;
+	double cachedEnvelope = -1;
+
+	// Pair indices per bucket, and each pair's first contact slot
+	TArray<int32> buckets[NUM_BUCKETS];
+	TArray<int32> pairSlot;
+	TArray<bool> slotActive;
+
+	int32 boundedCount = 0;
+	int32 cachedCount = 0;
+	int32 batchedPairCount = 0;
+	int32 genericPairCount = 0;
+};
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ChStateRecording.h"
+#include "ChStateRecorderActor.generated.h"
+
+/**
+ * Streams the scene manager's telemetry (the bExport* channels) into a
+ * recording file, and plays recordings back without re-simulating
+ */
+UCLASS()
+class CHRONOPHYSICS_API AChStateRecorderActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Needs bRecordTelemetry on the scene manager; the recorder becomes its telemetry sink
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Recorder")
+	class AChPhysicsSceneManagerActor* SceneManager;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Recorder", meta = (EditConditionToggle))
+	bool bRecordOnBeginPlay = false;
+
+	// Relative paths are under Saved/ChronoRecordings
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chrono|Recorder", meta = (editcondition = "bRecordOnBeginPlay"))
+	FString RecordingFile = TEXT("Recording.chrec");
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|Recorder")
+	int FramesPerChunk = 64;
+
+	AChStateRecorderActor();
+	virtual void Tick(float DeltaTime) override;
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	bool StartRecording(const FString& filePath);
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	void StopRecording();
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	bool OpenPlayback(const FString& filePath);
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	void ClosePlayback();
+
+	UFUNCTION(BlueprintPure, Category = "Chrono|Recorder")
+	int GetPlaybackFrameCount() const { return reader.GetFrameCount(); }
+
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	int FindPlaybackChannel(FName channelName) const { return reader.FindChannel(channelName); }
+
+	// Whole frame, laid out like the scene manager's telemetry frames
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	bool ReadPlaybackFrame(int frame, TArray<float>& values, float& time);
+
+	// First three floats of a channel, e.g. "<Owner>.Pos"
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	FVector ReadPlaybackVector(int frame, int channel);
+
+	// "<Owner>.Rot" channels
+	UFUNCTION(BlueprintCallable, Category = "Chrono|Recorder")
+	FRotator ReadPlaybackRotation(int frame, int channel);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	FString ResolvePath(const FString& filePath) const;
+
+	FChStateRecordWriter writer;
+	FChStateRecordReader reader;
+	TArray<float> drainFrames;
+	TArray<float> drainTimes;
+	FString pendingRecordingFile;
+};
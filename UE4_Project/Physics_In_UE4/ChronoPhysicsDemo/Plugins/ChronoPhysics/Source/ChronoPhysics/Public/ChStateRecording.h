@@ -0,0 +1,86 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FChTelemetry;
+
+/**
+ * Recording file: a header with the telemetry channel layout, zlib compressed
+ * chunks of FramesPerChunk frames, then a chunk table and a fixed size footer.
+ * Chunk payload is the frame times followed by the flat frame values
+ */
+class CHRONOPHYSICS_API FChStateRecordWriter
+{
+public:
+	~FChStateRecordWriter();
+
+	bool Open(const FString& filePath, const FChTelemetry& layout, int32 framesPerChunk);
+	void AppendFrames(const TArray<float>& frames, const TArray<float>& times, int32 frameCount);
+	// Flushes the partial chunk and writes the chunk table
+	void Close();
+
+	FORCEINLINE bool IsOpen() const { return file != nullptr; }
+	FORCEINLINE int32 GetFrameCount() const { return frameCount; }
+
+private:
+	void FlushChunk();
+
+	class IFileHandle* file = nullptr;
+	int32 frameWidth = 0;
+	int32 chunkFrames = 0;
+	int32 frameCount = 0;
+
+	TArray<float> chunkTimes;
+	TArray<float> chunkValues;
+	TArray<uint8> chunkRaw;
+	TArray<uint8> compressed;
+	TArray<int64> chunkOffsets;
+	TArray<int32> chunkSizes;
+};
+
+/**
+ * Memory mapped reader for FChStateRecordWriter files. Seeking to a frame is
+ * a table lookup plus one chunk decompression; the last chunk stays cached
+ */
+class CHRONOPHYSICS_API FChStateRecordReader
+{
+public:
+	~FChStateRecordReader();
+
+	bool Open(const FString& filePath);
+	void Close();
+
+	// Values of one frame, GetFrameWidth floats; nullptr when out of range
+	const float* GetFrame(int32 frame, float* outTime = nullptr);
+
+	FORCEINLINE bool IsOpen() const { return data != nullptr; }
+	FORCEINLINE int32 GetFrameCount() const { return frameCount; }
+	FORCEINLINE int32 GetFrameWidth() const { return frameWidth; }
+	int32 FindChannel(FName name) const;
+	FORCEINLINE int32 GetChannelNum() const { return channelNames.Num(); }
+	FORCEINLINE int32 GetChannelOffset(int32 channel) const { return channelOffsets[channel]; }
+	FORCEINLINE int32 GetChannelWidth(int32 channel) const { return channelWidths[channel]; }
+
+private:
+	bool LoadChunk(int32 chunk);
+
+	class IMappedFileHandle* mappedFile = nullptr;
+	class IMappedFileRegion* mappedRegion = nullptr;
+	// Used when the platform can't map files
+	TArray<uint8> loadedData;
+	const uint8* data = nullptr;
+	int64 dataSize = 0;
+
+	TArray<FName> channelNames;
+	TArray<int32> channelOffsets;
+	TArray<int32> channelWidths;
+	int32 frameWidth = 0;
+	int32 chunkFrames = 0;
+	int32 frameCount = 0;
+
+	TArray<int64> chunkOffsets;
+	TArray<int32> chunkSizes;
+
+	int32 cachedChunk = INDEX_NONE;
+	TArray<uint8> chunkRaw;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/physics/ChSystem.h"
+#include "chrono/collision/ChCCollisionInfo.h"
+#include <memory>
+#include <vector>
+
+namespace chrono {
+	class ChBody;
+}
+
+// Shape a dynamic body collides with the static meshes as, centered on the body frame, Chrono units
+struct FChColliderProxy
+{
+	enum EType : uint8 {
+		Sphere,
+		Box
+	};
+	EType Type = Sphere;
+	// Radius in X for spheres, half extents for boxes
+	FVector Extent = FVector::ZeroVector;
+};
+
+/**
+ * Quantized BVH over a fixed triangle mesh. Nodes are 16 bytes, bounds quantized to 16 bits against
+ * the mesh bounds and rounded outwards, stored depth first so the left child follows its parent.
+ * Leaves hold up to four triangles as one SIMD packet
+ */
+class CHRONOPHYSICS_API FChStaticMeshBVH
+{
+public:
+	struct FNode
+	{
+		uint16 Min[3];
+		uint16 Max[3];
+		// Right child index, or LeafFlag | packet index
+		uint32 Data;
+	};
+
+	// Structure of arrays, lanes past the leaf's triangle count repeat its last triangle
+	struct alignas(16) FPacket
+	{
+		float AX[4], AY[4], AZ[4];
+		float BX[4], BY[4], BZ[4];
+		float CX[4], CY[4], CZ[4];
+		// Unit normals and plane offsets, n.p = d on the triangle
+		float NX[4], NY[4], NZ[4], D[4];
+		int32 Count;
+	};
+
+	static const uint32 LeafFlag = 0x80000000u;
+	static const int32 LeafSize = 4;
+
+	// Vertices in the static body's frame
+	void Build(const std::vector<chrono::ChVector<double>>& vertices, const std::vector<chrono::ChVector<int>>& faces);
+	// Packets of the leaves whose bounds overlap the box, mesh coordinates
+	void QueryPackets(const FBox& box, TArray<int32>& outPackets) const;
+
+	FORCEINLINE const FPacket& GetPacket(int32 index) const { return packets[index]; }
+	FORCEINLINE int32 GetNodeNum() const { return nodes.Num(); }
+	FORCEINLINE bool IsEmpty() const { return nodes.Num() == 0; }
+
+private:
+	int32 BuildNode(TArray<int32>& order, int32 begin, int32 end, const TArray<FBox>& triangleBounds, const TArray<FVector>& centroids, const TArray<FVector>& positions, const TArray<FIntVector>& triangles);
+	void Quantize(const FBox& box, uint16 outMin[3], uint16 outMax[3]) const;
+
+	TArray<FNode> nodes;
+	TArray<FPacket> packets;
+	FVector origin = FVector::ZeroVector;
+	FVector scale = FVector::OneVector;
+};
+
+static_assert(sizeof(FChStaticMeshBVH::FNode) == 16, "BVH nodes are 16 bytes");
+
+/**
+ * Contacts between the proxies of dynamic bodies and the fixed meshes added to it, generated in the
+ * system's collision step instead of the Bullet trimesh pairs. The meshes sit in their own collision
+ * family that the proxy bodies don't collide with in Bullet, so every other shape still collides there.
+ * Each proxy keeps the packets it found inside an inflated query box and reuses them while it stays inside
+ */
+class CHRONOPHYSICS_API FChStaticColliderSet : public chrono::ChSystem::CustomCollisionCallback
+{
+public:
+	void AddMesh(std::shared_ptr<chrono::ChBody> body, std::shared_ptr<FChStaticMeshBVH> bvh);
+	void RemoveMesh(chrono::ChBody* body);
+	void AddProxy(std::shared_ptr<chrono::ChBody> body, const FChColliderProxy& proxy);
+	void RemoveProxy(chrono::ChBody* body);
+	bool ContainsProxy(chrono::ChBody* body) const;
+	bool ContainsMesh(chrono::ChBody* body) const;
+	// Earliest fraction of motion at which a sphere starting at start touches a mesh, absolute coordinates.
+	// Faces the sphere already touches at the start are skipped, they are a contact of the step itself
+	bool SweepSphere(const chrono::ChVector<>& start, const chrono::ChVector<>& motion, double radius, double& outFraction) const;
+
+	FORCEINLINE bool HasMeshes() const { return meshes.Num() > 0; }
+	FORCEINLINE int32 GetLastContactCount() const { return lastContactCount; }
+
+	virtual void OnCustomCollision(chrono::ChSystem* system) override;
+
+private:
+	struct FMesh
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		std::shared_ptr<FChStaticMeshBVH> BVH;
+	};
+
+	struct FProxyState
+	{
+		std::shared_ptr<chrono::ChBody> Body;
+		FChColliderProxy Shape;
+		// Per mesh, the inflated query box and the packets inside it
+		TArray<FBox> CachedBoxes;
+		TArray<TArray<int32>> CachedPackets;
+		TArray<chrono::collision::ChCollisionInfo> Contacts;
+	};
+
+	void CollideProxy(FProxyState& proxy);
+	void CollideSphere(FProxyState& proxy, const FMesh& mesh, const TArray<int32>& packetList, const chrono::ChVector<>& center, double envelope);
+	// Corners of the box in mesh coordinates
+	void CollideBox(FProxyState& proxy, const FMesh& mesh, const TArray<int32>& packetList, const chrono::ChVector<>& center, const FVector corners[8], double envelope);
+
+	TArray<FMesh> meshes;
+	TArray<FProxyState> proxies;
+	int32 lastContactCount = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Telemetry channels registered once, recorded as fixed width float frames
+ * into a preallocated ring buffer. The physics step is the only writer and
+ * sinks drain on the game thread after the step has been joined
+ */
+class CHRONOPHYSICS_API FChTelemetry
+{
+public:
+	// Returns the channel handle, or INDEX_NONE once the buffer is allocated
+	int32 RegisterChannel(FName name, int32 width);
+	int32 FindChannel(FName name) const;
+	void Allocate(int32 frameCapacity);
+	void Reset();
+
+	void BeginFrame(float time);
+	void Write(int32 handle, float value);
+	void Write(int32 handle, const FVector& value);
+	void Write(int32 handle, const FQuat& value);
+
+	// Copies the pending frames into the caller's arrays, oldest first; reuses their allocation
+	int32 Drain(TArray<float>& outFrames, TArray<float>& outTimes);
+
+	FORCEINLINE bool IsAllocated() const { return frameCapacity > 0; }
+	FORCEINLINE int32 GetFrameWidth() const { return frameWidth; }
+	FORCEINLINE int32 GetChannelNum() const { return channelNames.Num(); }
+	FORCEINLINE FName GetChannelName(int32 handle) const { return channelNames[handle]; }
+	FORCEINLINE int32 GetChannelOffset(int32 handle) const { return channelOffsets[handle]; }
+	FORCEINLINE int32 GetChannelWidth(int32 handle) const { return channelWidths[handle]; }
+	// The frame of the last BeginFrame, null before the first one
+	FORCEINLINE const float* GetCurrentFrame() const { return currentFrame; }
+
+private:
+	TArray<FName> channelNames;
+	TArray<int32> channelOffsets;
+	TArray<int32> channelWidths;
+	int32 frameWidth = 0;
+
+	TArray<float> ring;
+	TArray<float> ringTimes;
+	int32 frameCapacity = 0;
+	int32 head = 0;
+	int32 pending = 0;
+	float* currentFrame = nullptr;
+};
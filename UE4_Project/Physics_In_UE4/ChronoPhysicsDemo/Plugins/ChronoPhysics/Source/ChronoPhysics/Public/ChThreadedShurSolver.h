@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono_parallel/solver/ChSolverParallel.h"
+#include <memory>
+
+namespace chrono {
+	class ChSystem;
+}
+
+/**
+ * Schur product D^T (M^-1 D x) + E x of the parallel NSC solve with both sparse products split into row
+ * blocks over the task graph, the pool the rest of the plugin runs on. The prebuilt chrono_parallel does
+ * the same product through blaze on the calling thread. Systems with fewer constraint rows than the threshold,
+ * the normal only prepass and bilateral or FEM products go to the stock functor
+ */
+class CHRONOPHYSICS_API FChThreadedShurProduct : public chrono::ChShurProduct
+{
+public:
+	// blaze's own SMP_SMATDVECMULT_THRESHOLD
+	static const int32 DefaultThreshold = 600;
+
+	void SetFallback(chrono::ChShurProduct* product) { fallback = product; }
+	void SetThreshold(int32 rows) { threshold = FMath::Max(rows, 1); }
+
+	virtual void operator()(const blaze::DynamicVector<chrono::real>& x, blaze::DynamicVector<chrono::real>& AX) override;
+
+private:
+	chrono::ChShurProduct* fallback = nullptr;
+	int32 threshold = DefaultThreshold;
+	blaze::DynamicVector<chrono::real> velocity;
+};
+
+/**
+ * Wraps the parallel system's iterative solver so its Schur products go through FChThreadedShurProduct.
+ * Owns the wrapped solver; ChangeSolverType replaces the wrapper too, so install it after the solver type
+ */
+class CHRONOPHYSICS_API FChThreadedShurSolver : public chrono::ChSolverParallel
+{
+public:
+	FChThreadedShurSolver(chrono::ChSolverParallel* inner, int32 threshold);
+	virtual ~FChThreadedShurSolver();
+
+	virtual uint Solve(chrono::ChShurProduct& ShurProduct, chrono::ChProjectConstraints& Project, const uint max_iter,
+		const uint size, const blaze::DynamicVector<chrono::real>& b, blaze::DynamicVector<chrono::real>& x) override;
+
+	// False when the system isn't a parallel one or is wrapped already
+	static bool Install(chrono::ChSystem* system, int32 threshold = FChThreadedShurProduct::DefaultThreshold);
+
+private:
+	chrono::ChSolverParallel* inner;
+	FChThreadedShurProduct product;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono/core/ChCoordsys.h"
+#include "chrono_vehicle/ChTerrain.h"
+#include <memory>
+#include <string>
+
+namespace chrono {
+	class ChBody;
+	class ChSystem;
+	namespace collision {
+		class ChCollisionModel;
+	}
+	namespace geometry {
+		class ChTriangleMeshConnected;
+	}
+}
+
+/**
+ * RigidTerrain made of mesh tiles of which only the ones near a vehicle collide. Update enables the tiles whose
+ * footprint is within the radius of any vehicle and disables the ones that went past it by the hysteresis, so
+ * the rest of a long track is out of the broadphase. A tile's mesh is loaded the first time it is enabled,
+ * from the shape cache when the OBJ file hasn't changed since, and its ground body stays in the system after.
+ * Heights, normals and friction come from the enabled tiles, Z up like the rest of chrono_vehicle
+ */
+class CHRONOPHYSICS_API FChTiledRigidTerrain : public chrono::vehicle::ChTerrain
+{
+public:
+	explicit FChTiledRigidTerrain(chrono::ChSystem* system) : system(system) {}
+
+	// World XY footprint of the tile, a tile without one is loaded right away to find it
+	int32 AddMeshTile(const chrono::ChCoordsys<>& position, const std::string& meshFile, const FVector2D& footprintMin, const FVector2D& footprintMax,
+		double sweepRadius = 0, float friction = 0.8f);
+	int32 AddMeshTile(const chrono::ChCoordsys<>& position, const std::string& meshFile, double sweepRadius = 0, float friction = 0.8f);
+
+	// Chrono units
+	void SetActivationRadius(double radius, double hysteresis = 0.2) { activationRadius = radius; activationHysteresis = hysteresis; }
+	void Update(const TArray<chrono::ChVector<>>& vehiclePositions);
+
+	virtual double GetHeight(double x, double y) const override;
+	virtual chrono::ChVector<> GetNormal(double x, double y) const override;
+	virtual float GetCoefficientFriction(double x, double y) const override;
+
+	FORCEINLINE int32 GetTileNum() const { return tiles.Num(); }
+	FORCEINLINE int32 GetEnabledNum() const { return enabledNum; }
+	FORCEINLINE int32 GetLoadedNum() const { return loadedNum; }
+	std::shared_ptr<chrono::ChBody> GetGroundBody(int32 tile) const { return tiles[tile].Body; }
+
+private:
+	struct FTile
+	{
+		chrono::ChCoordsys<> Position;
+		std::string MeshFile;
+		FVector2D FootprintMin;
+		FVector2D FootprintMax;
+		double SweepRadius = 0;
+		float Friction = 0.8f;
+		std::shared_ptr<chrono::geometry::ChTriangleMeshConnected> Mesh;
+		std::shared_ptr<chrono::ChBody> Body;
+		bool bEnabled = false;
+	};
+
+	bool LoadMesh(FTile& tile);
+	void CreateBody(FTile& tile);
+	void SetEnabled(FTile& tile, bool bEnabled);
+	// The enabled tile under x, y
+	bool FindPoint(double x, double y, double& outHeight, chrono::ChVector<>& outNormal, float& outFriction) const;
+
+	chrono::ChSystem* system;
+	TArray<FTile> tiles;
+	double activationRadius = 50;
+	double activationHysteresis = 0.2;
+	int32 enabledNum = 0;
+	int32 loadedNum = 0;
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Templates/EnableIf.h"
+#include "Templates/IsEnum.h"
+#include "Templates/IsFloatingPoint.h"
+#include "Templates/IsIntegral.h"
+
+// Highest EChTraceLevel compiled in, 0 compiles every CH_TRACE out. Set per configuration by ChronoPhysics.Build.cs
+#ifndef CHRONO_TRACE_LEVEL
+#define CHRONO_TRACE_LEVEL 0
+#endif
+
+// One bit per EChTraceCategory, cleared categories compile out like levels above CHRONO_TRACE_LEVEL
+#ifndef CHRONO_TRACE_CATEGORIES
+#define CHRONO_TRACE_CATEGORIES 0xFF
+#endif
+
+DECLARE_LOG_CATEGORY_EXTERN(LogChronoTrace, Log, All);
+
+namespace EChTraceCategory {
+	enum Type : uint8 {
+		SCENE,
+		COLLISION,
+		SOLVER,
+		FEA,
+		TERRAIN,
+		IO,
+		NUM
+	};
+}
+
+namespace EChTraceLevel {
+	enum Type : uint8 {
+		// ERROR is a Windows macro
+		SEVERE = 1,
+		WARNING,
+		LOG,
+		VERBOSE
+	};
+}
+
+/**
+ * One trace line before formatting. The format is a printf string literal, kept by pointer, and the arguments
+ * are numbers only; names of actors and components go in Object as an FName, no string is copied on the hot path
+ */
+struct CHRONOPHYSICS_API FChTraceRecord
+{
+	static const int32 MaxArgs = 6;
+
+	enum EArgType : uint8 {
+		ARG_INT,
+		ARG_FLOAT
+	};
+
+	union FArg {
+		int64 Int;
+		double Float;
+	};
+
+	double Time;
+	const TCHAR* Format;
+	FName Object;
+	uint32 ThreadId;
+	EChTraceCategory::Type Category;
+	EChTraceLevel::Type Level;
+	uint8 ArgNum;
+	EArgType ArgTypes[MaxArgs];
+	FArg Args[MaxArgs];
+
+	template<typename T>
+	FORCEINLINE typename TEnableIf<TIsFloatingPoint<T>::Value>::Type SetArg(int32 index, T value)
+	{
+		ArgTypes[index] = ARG_FLOAT;
+		Args[index].Float = (double)value;
+	}
+
+	template<typename T>
+	FORCEINLINE typename TEnableIf<!TIsFloatingPoint<T>::Value>::Type SetArg(int32 index, T value)
+	{
+		static_assert(TIsIntegral<T>::Value || TIsEnum<T>::Value, "Trace arguments are numbers, names go in the object");
+		ArgTypes[index] = ARG_INT;
+		Args[index].Int = (int64)value;
+	}
+
+	// The line without the time and thread prefix
+	FString ToString() const;
+};
+
+/**
+ * Trace channel for the plugin's hot paths. Every thread writes fixed size records into its own single producer
+ * ring, no lock and no allocation after a thread's first record; a background thread drains the rings, orders
+ * the records by time and writes them to LogChronoTrace, or to a file given by -ChronoTraceFile=. A full ring
+ * drops the record and counts it, the writer never waits. Use CH_TRACE, not Write, so disabled categories
+ * and levels leave nothing behind
+ */
+class CHRONOPHYSICS_API FChTrace
+{
+public:
+	static const int32 RingCapacity = 1024;
+
+	// From the module, records written before Start or after Stop are dropped
+	static void Start();
+	static void Stop();
+
+	template<typename... ArgTypes>
+	static void Write(EChTraceCategory::Type category, EChTraceLevel::Type level, FName object, const TCHAR* format, ArgTypes... args)
+	{
+		static_assert(sizeof...(ArgTypes) <= FChTraceRecord::MaxArgs, "Too many trace arguments");
+		FChTraceRecord* record = BeginRecord();
+		if (!record) {
+			return;
+		}
+		record->Format = format;
+		record->Object = object;
+		record->Category = category;
+		record->Level = level;
+		record->ArgNum = (uint8)sizeof...(ArgTypes);
+		int32 index = 0;
+		int32 unpack[] = { 0, (record->SetArg(index++, args), 0)... };
+		(void)unpack;
+		(void)index;
+		EndRecord();
+	}
+
+	static int32 GetDroppedCount();
+
+private:
+	// Null when the ring is full or the channel isn't running
+	static FChTraceRecord* BeginRecord();
+	static void EndRecord();
+};
+
+#define CH_TRACE_ACTIVE(Category, Level) \
+	(CHRONO_TRACE_LEVEL >= EChTraceLevel::Level && (CHRONO_TRACE_CATEGORIES & (1 << EChTraceCategory::Category)) != 0)
+
+#if CHRONO_TRACE_LEVEL > 0
+#define CH_TRACE(Category, Level, Object, Format, ...) \
+	do { \
+		if (CH_TRACE_ACTIVE(Category, Level)) { \
+			FChTrace::Write(EChTraceCategory::Category, EChTraceLevel::Level, Object, TEXT(Format), ##__VA_ARGS__); \
+		} \
+	} while (0)
+#else
+#define CH_TRACE(Category, Level, Object, Format, ...) do {} while (0)
+#endif
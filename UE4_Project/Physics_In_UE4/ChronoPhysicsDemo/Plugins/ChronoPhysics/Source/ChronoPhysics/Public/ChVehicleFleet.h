@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "chrono_vehicle/ChPowertrain.h"
+#include "chrono_vehicle/ChSubsysDefs.h"
+#include <memory>
+#include <vector>
+
+namespace chrono {
+	namespace vehicle {
+		class ChWheeledVehicle;
+		class ChDriver;
+		class ChTire;
+		class ChTerrain;
+	}
+}
+
+// What a ChSimpleMapPowertrain model returns from its map, gear and shift point overrides, rad/s and N m
+struct FChFleetPowertrainMap
+{
+	double MaxEngineSpeed = 0;
+	std::vector<std::pair<double, double>> ZeroThrottleMap;
+	std::vector<std::pair<double, double>> FullThrottleMap;
+	std::vector<double> GearRatios;
+	double ReverseGearRatio = -0.1;
+	std::vector<std::pair<double, double>> ShiftBands;
+	bool bAutomatic = true;
+};
+
+/**
+ * Copies of one wheeled vehicle model on the same system, stepped together. Their powertrain is the
+ * ChSimpleMapPowertrain law kept as one array per field across the fleet, with both torque maps resampled
+ * to a shared uniform table, so a step is a few branch free loops over all vehicles instead of a virtual
+ * call chain per vehicle. Drivers and tires are the vehicles' own objects, synchronized and advanced for
+ * all vehicles in parallel. Vehicles take their powertrain torque from here and are not given a powertrain
+ * object; the caller steps the shared system once after Advance
+ */
+class CHRONOPHYSICS_API FChWheeledVehicleFleet
+{
+public:
+	explicit FChWheeledVehicleFleet(const FChFleetPowertrainMap& map);
+
+	// Tires in wheel order, returns the vehicle's index in the fleet
+	int32 Add(chrono::vehicle::ChWheeledVehicle& vehicle, std::shared_ptr<chrono::vehicle::ChDriver> driver,
+		const std::vector<std::shared_ptr<chrono::vehicle::ChTire>>& tires);
+	void SetDriveMode(int32 index, chrono::vehicle::ChPowertrain::DriveMode mode);
+
+	// Tires query the terrain from several threads unless bParallelTires is off, SCM terrain needs it off
+	void Synchronize(double time, const chrono::vehicle::ChTerrain& terrain, bool bParallelTires = true);
+	void Advance(double step);
+
+	FORCEINLINE int32 GetVehicleNum() const { return vehicles.Num(); }
+	FORCEINLINE double GetMotorSpeed(int32 index) const { return motorSpeed[index]; }
+	FORCEINLINE double GetMotorTorque(int32 index) const { return motorTorque[index]; }
+	FORCEINLINE double GetOutputTorque(int32 index) const { return shaftTorque[index]; }
+	FORCEINLINE int32 GetCurrentGear(int32 index) const { return gear[index] + 1; }
+
+private:
+	void SynchronizePowertrains();
+	void SetGear(int32 index, int32 newGear);
+
+	FChFleetPowertrainMap map;
+	// Torque at zero and full throttle every tableStep rad/s from 0 to MaxEngineSpeed
+	TArray<double> zeroThrottleTable;
+	TArray<double> fullThrottleTable;
+	double tableStep = 1;
+
+	TArray<chrono::vehicle::ChWheeledVehicle*> vehicles;
+	TArray<std::shared_ptr<chrono::vehicle::ChDriver>> drivers;
+	TArray<std::vector<std::shared_ptr<chrono::vehicle::ChTire>>> tires;
+	TArray<chrono::vehicle::TerrainForces> tireForces;
+
+	// Powertrain state, one entry per vehicle
+	TArray<double> throttle;
+	TArray<double> shaftSpeed;
+	TArray<double> motorSpeed;
+	TArray<double> motorTorque;
+	TArray<double> shaftTorque;
+	TArray<double> gearRatio;
+	TArray<int32> gear;
+	TArray<uint8> driveMode;
+};
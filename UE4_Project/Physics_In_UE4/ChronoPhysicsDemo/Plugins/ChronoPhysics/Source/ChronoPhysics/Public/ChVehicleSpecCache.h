@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "chrono_thirdparty/rapidjson/document.h"
+#include <memory>
+
+/**
+ * Parsed chrono_vehicle JSON specifications, process wide, keyed by full path and checked against the file's
+ * time stamp on every lookup, so an edited file is parsed again. The JSON subsystem constructors all take a
+ * rapidjson::Document as well as a file name and read it while they are constructed, so every instance of a
+ * model shares one document. Prefetch parses on the thread pool ahead of spawning. Files a vehicle JSON pulls
+ * in by name are still read by Chrono unless their subsystems are built from here
+ */
+class CHRONOPHYSICS_API FChVehicleSpecCache
+{
+public:
+	// nullptr when the file is missing or not valid JSON
+	static std::shared_ptr<const rapidjson::Document> Get(const FString& path);
+
+	// Subsystem from its JSON constructor, e.g. Create<RigidChassis>(path)
+	template <class T>
+	static std::shared_ptr<T> Create(const FString& path)
+	{
+		auto document = Get(path);
+		return document ? std::make_shared<T>(*document) : nullptr;
+	}
+
+	static TFuture<void> Prefetch(const TArray<FString>& paths);
+
+	static void Empty();
+	static int32 GetParseNum();
+	static int32 GetHitNum();
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicsObjectGeneratorBasis.h"
+#include "ChVolumeFillGenerator.generated.h"
+
+struct FChShapeTemplate;
+
+UENUM()
+namespace EChFillSampling {
+	enum Type {
+		// Regular lattice, Chrono's GridSampler
+		Grid,
+		// Hexagonally close packed, Chrono's HCPSampler
+		HCP,
+		// Random points at least the spacing apart, sampled tile by tile in parallel
+		PoissonDisk
+	};
+}
+
+UENUM()
+namespace EChFillVolume {
+	enum Type {
+		Box,
+		// Around the actor's Z axis, radius HalfExtent.X
+		Cylinder
+	};
+}
+
+// One kind of body of the fill mixture, as a utils::MixtureIngredient
+USTRUCT()
+struct CHRONOPHYSICS_API FChFillIngredient
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	TEnumAsByte<EShapeType::Type> Shape = EShapeType::Sphere;
+
+	// Share of the bodies, relative to the other ingredients
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill", meta = (ClampMin = "0"))
+	float Ratio = 1.f;
+
+	// Sphere and cylinder radius or half the box edge, cylinders are as tall as they are wide
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill", meta = (ClampMin = "0.1"))
+	float Radius = 5.f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	float Density = 2000.f;
+};
+
+/**
+ * Fills a box or a cylinder around the actor with non overlapping instanced bodies, spaced by the largest
+ * bounding sphere of the mixture. Sampling and body creation run on the task graph, the bodies of an ingredient
+ * share one collision shape and every body shares one material, so a fill of 10^5 to 10^6 bodies is built in seconds
+ */
+UCLASS()
+class CHRONOPHYSICS_API AChVolumeFillGenerator : public APhysicsObjectGeneratorBasis
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	TEnumAsByte<EChFillVolume::Type> Volume = EChFillVolume::Box;
+
+	// Half size of the volume, the bodies stay inside it
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	FVector HalfExtent = FVector(200.f, 200.f, 200.f);
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	TEnumAsByte<EChFillSampling::Type> Sampling = EChFillSampling::PoissonDisk;
+
+	// Free space between neighbouring bounding spheres, as a fraction of their diameter
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill", meta = (ClampMin = "0"))
+	float Gap = 0.02f;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	TArray<FChFillIngredient> Ingredients;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill", meta = (ClampMin = "1"))
+	int MaxBodies = 1000000;
+
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	int RandomSeed = 0;
+
+	// Boxes and cylinders start at a random orientation
+	UPROPERTY(EditAnywhere, Category = "Chrono|VolumeFill")
+	bool bRandomRotation = true;
+
+	AChVolumeFillGenerator();
+
+	virtual void PhysicsObjectConstruct() override;
+
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetBodyCount() const { return InstancedBodyList.Num(); }
+
+protected:
+	// Points relative to the actor where a sphere of the bounding radius fits inside the volume
+	void SamplePoints(float spacing, float boundingRadius, TArray<FVector>& outPoints) const;
+	void SamplePoissonDisk(float spacing, const FVector& halfExtent, TArray<FVector>& outPoints) const;
+
+	// Held for the generator's lifetime, the bodies only reference the shapes
+	TArray<std::shared_ptr<FChShapeTemplate>> shapeTemplates;
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "HAL/PlatformMemory.h"
 #include "ChPhysicsObjectInterface.h"
 #include "ChBody_GeneratedActor.h"
 #include "ChBodyComponent.h"
@@ -11,6 +12,10 @@
 #include "ChLink_EngineActor.h"
 #include "PhysicsObjectGeneratorBasis.generated.h"
 
+namespace chrono {
+	class ChBody;
+}
+
 UENUM()
 namespace EShapeType {
 	enum Type {
@@ -45,6 +50,17 @@ namespace ELinkType {
 	};
 }
 
+// Generated body without an actor, drawn as one instance of its shape's instanced mesh
+struct FChInstancedBody
+{
+	std::shared_ptr<chrono::ChBody> ChData;
+	EShapeType::Type Shape;
+	bool bFixed;
+	FVector Scale;
+	FTransform CachedTransform;
+	FTransform PreviousTransform;
+};
+
 UCLASS()
 class CHRONOPHYSICS_API APhysicsObjectGeneratorBasis : public AActor, public IChPhysicsObjectInterface
 {
@@ -56,27 +72,118 @@ public:
 
 	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsObjectGenerator")
 	TArray<TScriptInterface<IChPhysicsObjectInterface>> PhysicsObjectList;
+
+	// Create Chrono bodies only and draw them with one instanced mesh per shape
+	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsObjectGenerator")
+	bool bUseInstancedRendering = false;
+
+	// Add instanced bodies to the system in Morton order of their start location
+	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsObjectGenerator")
+	bool bSpatialBodyOrder = false;
+
+	// Generated lock links have no limits, so this builds them as AChLinkLockActor::bUseMarkerFreeLink links
+	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsObjectGenerator")
+	bool bMarkerFreeLinks = false;
+
+	// Collision family of every instanced body, -1 keeps the default family
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision")
+	int InstanceCollisionFamily = -1;
+
+	// Chains like track shoes only touch the other bodies, so their pairs can be culled in the broadphase
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision")
+	bool bInstanceSelfCollision = true;
+
+	// Serial backends: as UChBodyComponent::CollisionGroup, for every instanced body
+	UPROPERTY(EditAnywhere, Category = "Chrono|Collision", meta = (ClampMin = "0"))
+	int InstanceCollisionGroup = 0;
+
+	// Every engine's motion is latched from one float buffer instead of SetEngineMotion, one pass before the step.
+	// Native controllers write it through GetMotionBuffer
+	UPROPERTY(EditAnywhere, Category = "Chrono|Actuators")
+	bool bUseMotionBuffer = false;
+
+	// The buffer becomes named shared memory of GetEngineCount floats, so another process such as a Python
+	// policy can map it and write the motions directly
+	UPROPERTY(EditAnywhere, Category = "Chrono|Actuators", meta = (editcondition = "bUseMotionBuffer"))
+	FString MotionBufferName;
 	
 	// Sets default values for this actor's properties
 	APhysicsObjectGeneratorBasis();
 
+	virtual void PostRegisterAllComponents() override;
+	virtual void PostUnregisterAllComponents() override;
+
 	virtual void PhysicsObjectConstruct() override {}
+	virtual void PhysicsObjectBuildGeometry() override;
 	virtual void PhysicsObjectInitalize() override;
 	virtual void AddToSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
+	virtual void RemoveFromSystem(std::shared_ptr<chrono::ChSystem> phySystem) override;
 	virtual void UpdatePhysicsState() override;
+	virtual void CollectPhysicsStateUpdate(TArray<IChPhysicsObjectInterface*>& objList) override;
 	virtual void UpdateVisualAsset() override;
+	virtual void InterpolateVisualAsset(float alpha) override;
+	virtual void GatherVisualTransforms(TArray<class USceneComponent*>& components, TArray<FTransform>& transforms, float alpha, float tolerance) override;
+	virtual void LatchPhysicsInput() override;
+	virtual void CacheVisualState() override;
 	virtual void AddToSystem(TArray<TScriptInterface<IChPhysicsObjectInterface>>& objList) override {}
+	virtual bool& GetIsForParallel() override { return bGenerateForParallel; }
+	virtual bool& GetIsForSMC() override { return bGenerateForSMC; }
+	virtual void SetSleepingParameter(bool bUseSleeping, float sleepTime, float minSpeed, float minAngularSpeed) override;
+	virtual void RegisterTelemetry(FChTelemetry& telemetry, TArray<IChPhysicsObjectInterface*>& writerList) override;
 	
 	UFUNCTION(BlueprintCallable, Category = "Chrono")
 	bool SetEngineMotion(int index, float motion);
 	UFUNCTION(BlueprintPure, Category = "Chrono")
 	float GetEngineMotion(int index);
 
+	// All engines in one call, in EngineList order. Extra values are ignored, engines past the end keep their motion
+	UFUNCTION(BlueprintCallable, Category = "Chrono")
+	void SetEngineMotions(const TArray<float>& motions);
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	void GetEngineMotions(TArray<float>& motions) const;
+	UFUNCTION(BlueprintPure, Category = "Chrono")
+	int GetEngineCount() const { return EngineList.Num(); }
+
+	// GetEngineCount floats, null until initialized or without bUseMotionBuffer. Written from any thread, a value
+	// lands in the next step that latches after it
+	FORCEINLINE float* GetMotionBuffer() const { return motionBuffer; }
+
 protected:
-	class AChBody_GeneratedActor* NewChBodyActor(EShapeType::Type shape);
-	class AChLinkActor* NewChLinkActor(ELinkType::Type linkType);
+	// Spawned deferred and finished at the final transform, so the actor's components are moved only once
+	class AChBody_GeneratedActor* NewChBodyActor(EShapeType::Type shape, const FTransform& transform = FTransform::Identity);
+	class AChLinkActor* NewChLinkActor(ELinkType::Type linkType, const FTransform& transform = FTransform::Identity);
+	int NewChBodyInstance(EShapeType::Type shape, const FTransform& transform, double density, bool fixed);
+	// The instance defaults of NewChBodyInstance except the material, safe on worker threads
+	void ConfigureInstanceBody(chrono::ChBody& body, const FTransform& transform, bool fixed) const;
+	// Appends bodies built elsewhere, the instanced meshes rebuild their trees once at the end. Entries without a body are skipped
+	void AddBodyInstances(TArray<FChInstancedBody>& instances);
+	std::shared_ptr<chrono::ChBody> GetInstanceBody(int index);
+	void UpdateInstanceVisual(float alpha);
+	class UHierarchicalInstancedStaticMeshComponent* GetShapeInstancer(EShapeType::Type shape);
+
+	TArray<FChInstancedBody> InstancedBodyList;
+	TArray<TArray<int>> ShapeInstanceList;
+	TArray<FTransform> instanceTransformBuffer;
+
+	UPROPERTY()
+	TArray<class UHierarchicalInstancedStaticMeshComponent*> ShapeInstancers;
 	TArray<class AChLink_EngineActor*> EngineList;
 
+	void OpenMotionBuffer();
+	void CloseMotionBuffer();
+
+	// Points into localMotionBuffer or motionRegion
+	float* motionBuffer = nullptr;
+	TArray<float> localMotionBuffer;
+	FPlatformMemory::FSharedMemoryRegion* motionRegion = nullptr;
+
+	bool bGenerateForParallel = false;
+	bool bGenerateForSMC = false;
+	bool bSceneUseSleeping = false;
+	float sceneSleepTime = 0.6f;
+	float sceneSleepMinSpeed = 10.f;
+	float sceneSleepMinAngularSpeed = 0.04f;
+
 	UStaticMesh* boxMesh;
 	UStaticMesh* sphereMesh;
 	UStaticMesh* cylinderMesh;
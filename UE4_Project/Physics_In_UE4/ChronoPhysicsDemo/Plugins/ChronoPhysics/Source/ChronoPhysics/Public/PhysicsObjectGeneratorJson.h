@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "PhysicsObjectGeneratorBasis.h"
+#include "Async/Future.h"
 #include "PhysicsObjectGeneratorJson.generated.h"
 
 /**
@@ -27,6 +28,24 @@ public:
 	FString JsonFileName;
 	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsObjectGeneratorJson")
 	bool bPositionRelative = false;
+	// Load Saved/ChronoScenes/<JsonFileName>.chscene when it is newer than the json, and write it whenever the json
+	// is parsed
+	UPROPERTY(EditAnywhere, Category = "Chrono|PhysicsObjectGeneratorJson")
+	bool bUseBinaryScene = true;
 
+	// Starts reading the scene on a worker, so it overlaps with the rest of the level starting up
+	virtual void PostInitializeComponents() override;
 	virtual void PhysicsObjectConstruct() override;
+
+	// Writes the .chscene file to Saved/ChronoScenes
+	UFUNCTION(CallInEditor, Category = "Chrono|PhysicsObjectGeneratorJson")
+	void ConvertToBinaryScene();
+
+protected:
+	FString GetScenePath(const TCHAR* extension) const;
+	FString GetBinaryScenePath() const;
+	void StartSceneLoad();
+	void SpawnScene(const struct FChSceneData& scene);
+
+	TFuture<TSharedPtr<struct FChSceneData, ESPMode::ThreadSafe>> sceneLoad;
 };
@@ -19,4 +19,7 @@ public:
 	int BoxCount = 10;
 
 	virtual void PhysicsObjectConstruct() override;
+
+protected:
+	void PhysicsObjectConstructInstanced();
 };
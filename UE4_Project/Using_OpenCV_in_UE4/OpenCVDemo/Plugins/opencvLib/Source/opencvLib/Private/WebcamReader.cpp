@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WebcamReader.h"
+#include "Engine/Texture2D.h"
+#include "RenderingThread.h"
+
+AWebcamReader::AWebcamReader()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AWebcamReader::BeginPlay()
+{
+	Super::BeginPlay();
+	Capture = MakeUnique<FcvWebcamCapture>(CameraIndex, Resolution.X, Resolution.Y, FrameRate, RingSize);
+	UploadRegions.SetNum(FMath::Max(RingSize, 3));
+}
+
+void AWebcamReader::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The uploads still queued give their slots back first
+	FlushRenderingCommands();
+	Capture.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWebcamReader::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (!Capture)
+	{
+		return;
+	}
+	GrabbedFrames = Capture->GetGrabbedCount();
+	DroppedFrames = Capture->GetDroppedCount();
+
+	const cv::Mat* Frame = nullptr;
+	uint64 FrameNumber = 0;
+	int32 Slot = Capture->TakeLatest(Frame, FrameNumber);
+	if (Slot == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (!VideoTexture || VideoTexture->GetSizeX() != Frame->cols || VideoTexture->GetSizeY() != Frame->rows)
+	{
+		VideoTexture = UTexture2D::CreateTransient(Frame->cols, Frame->rows, PF_B8G8R8A8);
+		VideoTexture->SRGB = true;
+		VideoTexture->UpdateResource();
+	}
+
+	// The slot's region, like its pixels, isn't touched again before the slot comes back
+	FUpdateTextureRegion2D* Region = &UploadRegions[Slot];
+	*Region = FUpdateTextureRegion2D(0, 0, 0, 0, Frame->cols, Frame->rows);
+	FcvWebcamCapture* Source = Capture.Get();
+	VideoTexture->UpdateTextureRegions(0, 1, Region, (uint32)Frame->step, 4, Frame->data,
+		[Source, Slot](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+	{
+		Source->Return(Slot);
+	});
+	UploadedFrames++;
+}
@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvCaptureManager.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "cvStereoRectifier.h"
+
+FcvCaptureManager::~FcvCaptureManager()
+{
+	Release();
+}
+
+int32 FcvCaptureManager::AddGroup(const TArray<UTextureRenderTarget2D*>& Targets, int32 CaptureInterval, FcvStereoRectifier* Rectifier)
+{
+	check(!bInitialized);
+	FGroup& Group = Groups.AddDefaulted_GetRef();
+	Group.Targets = Targets;
+	Group.Rectifier = Rectifier;
+	Group.Interval = FMath::Max(CaptureInterval, 1);
+	return Groups.Num() - 1;
+}
+
+bool FcvCaptureManager::Initialize(bool bAsync, int32 RingSize)
+{
+	bAsyncReadback = bAsync;
+	FrameCounter = 0;
+
+	// Round robin over the groups sharing an interval, so every frame reads back about the same number of targets
+	TMap<int32, int32> IntervalCounts;
+	for (FGroup& Group : Groups)
+	{
+		int32& Count = IntervalCounts.FindOrAdd(Group.Interval);
+		Group.Phase = Count % Group.Interval;
+		Count++;
+
+		Group.Resources.Reset();
+		Group.Readbacks.Reset();
+		Group.Pixels.SetNum(Group.Targets.Num());
+		Group.PixelFrames.Init(0, Group.Targets.Num());
+		Group.ProcessedFrame = 0;
+		for (UTextureRenderTarget2D* Target : Group.Targets)
+		{
+			FTextureRenderTargetResource* Resource = Target ? Target->GameThread_GetRenderTargetResource() : nullptr;
+			if (!Resource)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("A capture group is missing its render target"));
+				Groups.Reset();
+				return false;
+			}
+			// All targets of a group are processed together, so they share one size
+			if (Group.Resources.Num() == 0)
+			{
+				Group.Width = Target->SizeX;
+				Group.Height = Target->SizeY;
+			}
+			else if (Target->SizeX != Group.Width || Target->SizeY != Group.Height)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s is not the size of the other targets in its capture group"), *Target->GetName());
+				Groups.Reset();
+				return false;
+			}
+			Group.Resources.Add(Resource);
+
+			if (bAsyncReadback)
+			{
+				TUniquePtr<FcvRenderTargetReadback> Readback = MakeUnique<FcvRenderTargetReadback>();
+				if (!Readback->Initialize(Target, RingSize))
+				{
+					bAsyncReadback = false;
+				}
+				Group.Readbacks.Add(MoveTemp(Readback));
+			}
+		}
+	}
+
+	if (!bAsyncReadback)
+	{
+		for (FGroup& Group : Groups)
+		{
+			Group.Readbacks.Reset();
+		}
+	}
+	bInitialized = true;
+	return true;
+}
+
+void FcvCaptureManager::Release()
+{
+	if (!bInitialized)
+	{
+		return;
+	}
+
+	// Each readback waits for the commands still pointing at it
+	for (FGroup& Group : Groups)
+	{
+		Group.Readbacks.Reset();
+	}
+	bInitialized = false;
+}
+
+void FcvCaptureManager::Capture()
+{
+	if (!bInitialized)
+	{
+		return;
+	}
+
+	uint64 Frame = ++FrameCounter;
+	TArray<FcvRenderTargetReadback*> Due;
+	TArray<FcvStereoRectifier*> DueRectifiers;
+	for (FGroup& Group : Groups)
+	{
+		if ((Frame + Group.Phase) % Group.Interval != 0)
+		{
+			continue;
+		}
+
+		if (!bAsyncReadback)
+		{
+			if (Group.Rectifier)
+			{
+				// ReadPixels flushes the render thread, so this runs first
+				FcvStereoRectifier* Rectifier = Group.Rectifier;
+				ENQUEUE_RENDER_COMMAND(cvCaptureRectify)([Rectifier](FRHICommandListImmediate& RHICmdList)
+				{
+					Rectifier->RectifyRenderThread(RHICmdList);
+				});
+			}
+			for (int32 i = 0; i < Group.Resources.Num(); i++)
+			{
+				Group.Resources[i]->ReadPixels(Group.Pixels[i]);
+				Group.PixelFrames[i] = Frame;
+			}
+			continue;
+		}
+		for (TUniquePtr<FcvRenderTargetReadback>& Readback : Group.Readbacks)
+		{
+			Due.Add(Readback.Get());
+		}
+		if (Group.Rectifier)
+		{
+			DueRectifiers.Add(Group.Rectifier);
+		}
+	}
+
+	if (Due.Num() == 0)
+	{
+		return;
+	}
+	ENQUEUE_RENDER_COMMAND(cvCaptureReadback)([Due, DueRectifiers, Frame](FRHICommandListImmediate& RHICmdList)
+	{
+		for (FcvStereoRectifier* Rectifier : DueRectifiers)
+		{
+			Rectifier->RectifyRenderThread(RHICmdList);
+		}
+		for (FcvRenderTargetReadback* Readback : Due)
+		{
+			Readback->CopyRenderThread(RHICmdList, Frame);
+		}
+	});
+}
+
+bool FcvCaptureManager::GetLatest(int32 GroupIndex, TArrayView<TArray<FColor>*> OutPixels, uint64& OutFrame)
+{
+	if (!bInitialized || !Groups.IsValidIndex(GroupIndex))
+	{
+		return false;
+	}
+
+	FGroup& Group = Groups[GroupIndex];
+	// The arrays keep the last frame when nothing new came back
+	for (int32 i = 0; i < Group.Readbacks.Num(); i++)
+	{
+		Group.Readbacks[i]->GetLatest(Group.Pixels[i], Group.PixelFrames[i]);
+	}
+
+	uint64 Frame = Group.PixelFrames.Num() ? Group.PixelFrames[0] : 0;
+	for (uint64 PixelFrame : Group.PixelFrames)
+	{
+		if (PixelFrame != Frame)
+		{
+			return false;
+		}
+	}
+	if (Frame == Group.ProcessedFrame)
+	{
+		return false;
+	}
+
+	Group.ProcessedFrame = Frame;
+	OutFrame = Frame;
+	for (int32 i = 0; i < Group.Pixels.Num() && i < OutPixels.Num(); i++)
+	{
+		// Handed over, the next frame needs new copies of every target anyway
+		Exchange(*OutPixels[i], Group.Pixels[i]);
+	}
+	return true;
+}
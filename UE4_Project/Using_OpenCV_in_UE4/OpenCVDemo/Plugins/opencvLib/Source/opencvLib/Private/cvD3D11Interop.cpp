@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvD3D11Interop.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "cvStereoPipeline.h"
+#include "opencv2/core/directx.hpp"
+
+static bool GcvD3D11ContextInitialized = false;
+
+FcvD3D11Capture::~FcvD3D11Capture()
+{
+	Release();
+}
+
+bool FcvD3D11Capture::InitializeContext()
+{
+	if (GcvD3D11ContextInitialized)
+	{
+		return true;
+	}
+	if (!GDynamicRHI || FCString::Strcmp(GDynamicRHI->GetName(), TEXT("D3D11")) != 0)
+	{
+		return false;
+	}
+	ID3D11Device* Device = (ID3D11Device*)GDynamicRHI->RHIGetNativeDevice();
+	if (!Device)
+	{
+		return false;
+	}
+
+	// Throws when no OpenCL platform offers cl_khr_d3d11_sharing for this device
+	try
+	{
+		cv::directx::ocl::initializeContextFromD3D11Device(Device);
+	}
+	catch (const cv::Exception& Exception)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("OpenCL can't share with the D3D11 device: %s"), UTF8_TO_TCHAR(Exception.what()));
+		return false;
+	}
+	cv::ocl::setUseOpenCL(true);
+	GcvD3D11ContextInitialized = true;
+	return true;
+}
+
+int32 FcvD3D11Capture::AddGroup(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, int32 CaptureInterval)
+{
+	check(!bInitialized);
+	FGroup& Group = Groups.AddDefaulted_GetRef();
+	Group.Left = Left;
+	Group.Right = Right;
+	Group.Interval = FMath::Max(CaptureInterval, 1);
+	return Groups.Num() - 1;
+}
+
+bool FcvD3D11Capture::Initialize()
+{
+	FrameCounter = 0;
+	TMap<int32, int32> IntervalCounts;
+	for (FGroup& Group : Groups)
+	{
+		int32& Count = IntervalCounts.FindOrAdd(Group.Interval);
+		Group.Phase = Count % Group.Interval;
+		Count++;
+
+		Group.LeftResource = Group.Left ? Group.Left->GameThread_GetRenderTargetResource() : nullptr;
+		Group.RightResource = Group.Right ? Group.Right->GameThread_GetRenderTargetResource() : nullptr;
+		if (!Group.LeftResource || !Group.RightResource)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("A shared capture group is missing its render target"));
+			return false;
+		}
+		EPixelFormat Format = Group.Left->GetFormat();
+		if ((Format != PF_B8G8R8A8 && Format != PF_R8G8B8A8) || Group.Right->GetFormat() != Format)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: only 8 bit RGBA or BGRA targets are shared with OpenCL"), *Group.Left->GetName());
+			return false;
+		}
+		if (Group.Left->SizeX != Group.Right->SizeX || Group.Left->SizeY != Group.Right->SizeY)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s is not the size of the other target in its capture group"), *Group.Right->GetName());
+			return false;
+		}
+		Group.bRGBA = Format == PF_R8G8B8A8;
+		Group.Width = Group.Left->SizeX;
+		Group.Height = Group.Left->SizeY;
+	}
+	bInitialized = true;
+	return true;
+}
+
+void FcvD3D11Capture::Start(FcvStereoPipeline* InPipeline, int32 InReprojectGroup)
+{
+	Pipeline = InPipeline;
+	ReprojectGroup = InReprojectGroup;
+}
+
+void FcvD3D11Capture::Release()
+{
+	if (!bInitialized)
+	{
+		return;
+	}
+
+	FcvD3D11Capture* Capture = this;
+	ENQUEUE_RENDER_COMMAND(cvD3D11CaptureRelease)([Capture](FRHICommandListImmediate& RHICmdList)
+	{
+		for (FGroup& Group : Capture->Groups)
+		{
+			Group.Fence.SafeRelease();
+		}
+	});
+	FlushRenderingCommands();
+	Pipeline = nullptr;
+	bInitialized = false;
+}
+
+void FcvD3D11Capture::Capture()
+{
+	if (!bInitialized || !Pipeline)
+	{
+		return;
+	}
+
+	uint64 Frame = ++FrameCounter;
+	TArray<int32> Due;
+	for (int32 i = 0; i < Groups.Num(); i++)
+	{
+		if ((Frame + Groups[i].Phase) % Groups[i].Interval == 0)
+		{
+			Due.Add(i);
+		}
+	}
+
+	// Queued every frame, the fences of earlier frames are polled whether or not a group is due
+	FcvD3D11Capture* Capture = this;
+	ENQUEUE_RENDER_COMMAND(cvD3D11Capture)([Capture, Due, Frame](FRHICommandListImmediate& RHICmdList)
+	{
+		Capture->CaptureRenderThread(RHICmdList, Due, Frame);
+	});
+}
+
+void FcvD3D11Capture::CaptureRenderThread(FRHICommandListImmediate& RHICmdList, const TArray<int32>& Due, uint64 Frame)
+{
+	for (int32 i = 0; i < Groups.Num(); i++)
+	{
+		if (Groups[i].Fence && Groups[i].Fence->Poll())
+		{
+			CopyGroup(i);
+			Groups[i].Fence.SafeRelease();
+		}
+	}
+
+	// A group still waiting on its last fence skips this frame
+	FGPUFenceRHIRef Fence;
+	for (int32 GroupIndex : Due)
+	{
+		FGroup& Group = Groups[GroupIndex];
+		if (Group.Fence)
+		{
+			continue;
+		}
+		if (!Fence)
+		{
+			Fence = RHICreateGPUFence(TEXT("cvD3D11Capture"));
+			RHICmdList.WriteGPUFence(Fence);
+		}
+		Group.Fence = Fence;
+		Group.FenceFrame = Frame;
+	}
+}
+
+void FcvD3D11Capture::CopyGroup(int32 GroupIndex)
+{
+	FGroup& Group = Groups[GroupIndex];
+	FTexture2DRHIRef Left = Group.LeftResource->GetRenderTargetTexture();
+	FTexture2DRHIRef Right = Group.RightResource->GetRenderTargetTexture();
+	if (!Left || !Right)
+	{
+		return;
+	}
+	TUniquePtr<FcvStereoFrame> Frame = Pipeline->AcquireFrame(GroupIndex);
+	if (!Frame)
+	{
+		return;
+	}
+
+	// Device to device, the frame's images are already the right size so nothing is allocated. The acquire
+	// inside waits for the D3D11 work on the textures, which the fence has seen finish
+	try
+	{
+		cv::directx::convertFromD3D11Texture2D((ID3D11Texture2D*)Left->GetNativeResource(), Frame->LeftDevice);
+		cv::directx::convertFromD3D11Texture2D((ID3D11Texture2D*)Right->GetNativeResource(), Frame->RightDevice);
+	}
+	catch (const cv::Exception& Exception)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't copy a capture into OpenCL: %s"), UTF8_TO_TCHAR(Exception.what()));
+		Pipeline->Recycle(MoveTemp(Frame));
+		return;
+	}
+	Frame->Frame = Group.FenceFrame;
+	Frame->bDeviceSource = true;
+	Frame->bSourceRGBA = Group.bRGBA;
+	Frame->bReproject = GroupIndex == ReprojectGroup;
+	Pipeline->Submit(MoveTemp(Frame));
+}
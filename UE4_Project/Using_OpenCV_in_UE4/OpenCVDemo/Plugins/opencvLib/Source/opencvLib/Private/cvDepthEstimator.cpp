@@ -8,7 +8,9 @@ AcvDepthEstimator::AcvDepthEstimator()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
-	
+
+	PointCloud = CreateDefaultSubobject<UcvPointCloudComponent>(TEXT("PointCloud"));
+	RootComponent = PointCloud;
 }
 
 // Called when the game starts or when spawned
@@ -18,49 +20,100 @@ void AcvDepthEstimator::BeginPlay()
 
 	GEngine->AddOnScreenDebugMessage(-1, 8.0f, FColor::Yellow, FString("WebCamera Begin Play"));
 	
-	//camera_1 initial
-	RenderTarget_1 = SceneCapture_1->GameThread_GetRenderTargetResource();
-	TargetX_1 = SceneCapture_1->SizeX;
-	TargetY_1 = SceneCapture_1->SizeY;
-	RenderTarget_1->ReadPixels(ImageData_1);
-	frame.create(TargetY_1, TargetX_1, CV_8UC(3));
-
-
-	//camera_2 initial
-	RenderTarget_2 = SceneCapture_2->GameThread_GetRenderTargetResource();
-	TargetX_2 = SceneCapture_1->SizeX;
-	TargetY_2 = SceneCapture_1->SizeY;
-	RenderTarget_2->ReadPixels(ImageData_2);
-	frame_2.create(TargetY_2, TargetX_2, CV_8UC(3));
-
-	//camera_2 initial
-	RenderTarget_3 = SceneCapture_3->GameThread_GetRenderTargetResource();
-	TargetX_3 = SceneCapture_1->SizeX;
-	TargetY_3 = SceneCapture_1->SizeY;
-	RenderTarget_3->ReadPixels(ImageData_3);
-	realDepth.create(TargetY_3, TargetX_3, CV_8UC(3));
-	
-	for (int y = 0; y < TargetY_1; y++)
+	if (StereoRigs.Num() == 0 && SceneCapture_1 && SceneCapture_2)
+	{
+		FcvStereoRig& Rig = StereoRigs.AddDefaulted_GetRef();
+		Rig.Left = SceneCapture_1;
+		Rig.Right = SceneCapture_2;
+		Rig.Depth = SceneCapture_3;
+	}
+
+	Rectifiers.SetNum(StereoRigs.Num());
+	for (int32 i = 0; i < StereoRigs.Num(); i++)
 	{
-		for (int x = 0; x <TargetX_1; x++)
+		FcvStereoRig& Rig = StereoRigs[i];
+		if (Rig.Calibration.FilePath.IsEmpty() || !Rig.Left || !Rig.Right)
+		{
+			continue;
+		}
+		FString Path = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), Rig.Calibration.FilePath);
+		TUniquePtr<FcvStereoRectifier> Rectifier = MakeUnique<FcvStereoRectifier>();
+		Rig.RectifiedLeft = FcvStereoRectifier::CreatePackedTarget(this, Rig.Left->SizeX, Rig.Left->SizeY);
+		Rig.RectifiedRight = FcvStereoRectifier::CreatePackedTarget(this, Rig.Right->SizeX, Rig.Right->SizeY);
+		if (Rectifier->LoadCalibration(Path, Rig.Left->SizeX, Rig.Left->SizeY)
+			&& Rectifier->Initialize(Rig.Left, Rig.Right, Rig.RectifiedLeft, Rig.RectifiedRight))
+		{
+			Rectifiers[i] = MoveTemp(Rectifier);
+		}
+		else
 		{
-			int i = x + (y * TargetX_1);
-			frame.data[i * 3 + 0] = ImageData_1[i].B;
-			frame.data[i * 3 + 1] = ImageData_1[i].G;
-			frame.data[i * 3 + 2] = ImageData_1[i].R;
-			frame_2.data[i * 3 + 0] = ImageData_2[i].B;
-			frame_2.data[i * 3 + 1] = ImageData_2[i].G;
-			frame_2.data[i * 3 + 2] = ImageData_2[i].R;
-			realDepth.data[i * 3 + 0] = ImageData_3[i].B;
-			realDepth.data[i * 3 + 1] = ImageData_3[i].G;
-			realDepth.data[i * 3 + 2] = ImageData_3[i].R;
+			UE_LOG(LogTemp, Warning, TEXT("Rig %d can't be rectified on the GPU, it needs SM5 and a width that is a multiple of 4"), i);
+			Rig.RectifiedLeft = nullptr;
+			Rig.RectifiedRight = nullptr;
 		}
 	}
 
-	//cv dual camera initial
+	CaptureManager = MakeUnique<FcvCaptureManager>();
+	for (int32 i = 0; i < StereoRigs.Num(); i++)
+	{
+		FcvStereoRig& Rig = StereoRigs[i];
+		if (Rectifiers[i])
+		{
+			CaptureManager->AddGroup({ Rig.RectifiedLeft, Rig.RectifiedRight }, Rig.CaptureInterval, Rectifiers[i].Get());
+			continue;
+		}
+		TArray<UTextureRenderTarget2D*> Targets = { Rig.Left, Rig.Right };
+		if (Rig.Depth)
+		{
+			Targets.Add(Rig.Depth);
+		}
+		CaptureManager->AddGroup(Targets, Rig.CaptureInterval);
+	}
+
+	if (bGPUStereo && StereoRigs.Num() > 0 && StereoRigs[0].Left)
+	{
+		const FcvStereoRig& Rig = StereoRigs[0];
+		DisparityTarget = NewObject<UTextureRenderTarget2D>(this);
+		DisparityTarget->RenderTargetFormat = RTF_R32f;
+		DisparityTarget->InitAutoFormat(Rig.Left->SizeX, Rig.Left->SizeY);
+		DisparityTarget->UpdateResourceImmediate(true);
 
-	cv::cvtColor(frame, grayImageL, CV_BGR2GRAY);
-	cv::cvtColor(frame_2, grayImageR, CV_BGR2GRAY);
+		float FocalLength = Rig.Left->SizeX * 0.5f / FMath::Tan(FMath::DegreesToRadians(CaptureFOV) * 0.5f);
+		GPUStereo = MakeUnique<FcvGPUStereo>();
+		if (!GPUStereo->Initialize(Rig.Left, Rig.Right, Rig.Depth, DisparityTarget,
+			FMath::DivideAndRoundUp(NumDisparities, 16) * 16, FocalLength * StereoBaseline, BadPixelThreshold))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("GPU stereo is not available, falling back to OpenCV"));
+			GPUStereo.Reset();
+		}
+	}
+
+	// The shared captures would skip the rectification
+	if (bD3D11Interop && Rectifiers.ContainsByPredicate([](const TUniquePtr<FcvStereoRectifier>& Rectifier) { return Rectifier.IsValid(); }))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Calibrated rigs are read back rectified, the D3D11 interop is off"));
+	}
+	else if (bD3D11Interop && !GPUStereo)
+	{
+		D3D11Capture = MakeUnique<FcvD3D11Capture>();
+		for (FcvStereoRig& Rig : StereoRigs)
+		{
+			D3D11Capture->AddGroup(Rig.Left, Rig.Right, Rig.CaptureInterval);
+		}
+		// The context has to come first, the frame pools allocate their device images in it
+		if (!FcvD3D11Capture::InitializeContext() || !D3D11Capture->Initialize())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("The captures can't be shared with OpenCL, reading them back instead"));
+			D3D11Capture.Reset();
+		}
+	}
+
+	if (GPUStereo || D3D11Capture || !CaptureManager->Initialize(bAsyncReadback, ReadbackRingSize))
+	{
+		CaptureManager.Reset();
+	}
+
+	//cv dual camera initial
 
 	//using for detect circle
 	bm->setBlockSize(2 * blockSize + 5);     //SADڴС5~21֮Ϊ
@@ -68,7 +121,8 @@ void AcvDepthEstimator::BeginPlay()
 	//bm->setROI2(validROIR);
 	bm->setPreFilterCap(31);
 	bm->setMinDisparity(0);  //СӲĬֵΪ0, Ǹֵint
-	bm->setNumDisparities(numDisparities * 16 + 16);//ӲڣӲֵСӲֵ֮,ڴС16int
+	NumDisparities = FMath::DivideAndRoundUp(NumDisparities, 16) * 16;
+	bm->setNumDisparities(NumDisparities);//ӲڣӲֵСӲֵ֮,ڴС16int
 	bm->setTextureThreshold(10);
 	bm->setUniquenessRatio(uniquenessRatio);//uniquenessRatioҪԷֹƥ
 	bm->setSpeckleWindowSize(100);
@@ -79,51 +133,326 @@ void AcvDepthEstimator::BeginPlay()
 	//reprojectImageTo3D(disp, xyz, Q, true); //ʵʱReprojectTo3DX / W, Y / W, Z / WҪ16(ҲW16)ܵõȷάϢ
 	//xyz = xyz * 16;
 
+	bool bUseOpenCL = false;
+	if (StereoBackend == EcvStereoBackend::OpenCL || D3D11Capture)
+	{
+		cv::ocl::setUseOpenCL(true);
+		bUseOpenCL = cv::ocl::haveOpenCL() && cv::ocl::useOpenCL();
+		if (bUseOpenCL)
+		{
+			// StereoBM only takes its OpenCL path without the texture threshold
+			bm->setTextureThreshold(0);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("No OpenCL device, the stereo matching runs on the CPU"));
+		}
+	}
+
+	if (GPUStereo)
+	{
+		return;
+	}
+
+	// Both sources have one group per rig
+	int32 GroupCount = CaptureManager ? CaptureManager->GetGroupCount() : D3D11Capture ? D3D11Capture->GetGroupCount() : 0;
+	auto GroupSize = [this](int32 Group)
+	{
+		if (!CaptureManager)
+		{
+			return FIntPoint(D3D11Capture->GetWidth(Group), D3D11Capture->GetHeight(Group));
+		}
+		// The rectified targets hold four pixels a texel
+		int32 Packing = Rectifiers.IsValidIndex(Group) && Rectifiers[Group] ? 4 : 1;
+		return FIntPoint(CaptureManager->GetWidth(Group) * Packing, CaptureManager->GetHeight(Group));
+	};
+
+	// The matcher is only used on the stereo threads from here on
+	int32 RigCount = FMath::Max(StereoRigs.Num(), 1);
+	StereoPipeline = MakeUnique<FcvStereoPipeline>(bm, NumDisparities, PipelineQueueCapacity * RigCount, StereoWorkers, bUseOpenCL);
+	for (int32 Rig = 0; Rig < GroupCount; Rig++)
+	{
+		// Enough for full queues, one frame in every stage, the newest result and the uploads in flight
+		int32 FrameCount = PipelineQueueCapacity * 4 + StereoWorkers + 4;
+		FIntPoint Size = GroupSize(Rig);
+		StereoPipeline->AddFramePool(Rig, Size.X, Size.Y, FrameCount, bPointCloud && Rig == 0 ? PointCloudMaxPoints : 0);
+	}
+	if (D3D11Capture)
+	{
+		D3D11Capture->Start(StereoPipeline.Get(), bPointCloud ? 0 : INDEX_NONE);
+	}
+
+	if (bPointCloud && GroupCount > 0)
+	{
+		FcvPointCloudSettings Settings;
+		Settings.VoxelSize = PointCloudVoxelSize;
+		Settings.MaxDepth = PointCloudMaxDepth;
+		Settings.MaxPoints = PointCloudMaxPoints;
+		if (CalibrationQ.Num() == 0 && Rectifiers.Num() > 0 && Rectifiers[0])
+		{
+			Settings.Q = Rectifiers[0]->GetQ().clone();
+		}
+		else if (CalibrationQ.Num() == 16)
+		{
+			Settings.Q = cv::Mat(4, 4, CV_64F);
+			for (int32 i = 0; i < 16; i++)
+			{
+				Settings.Q.at<double>(i / 4, i % 4) = CalibrationQ[i];
+			}
+		}
+		else
+		{
+			// The virtual cameras are ideal pinholes, the principal point is the image center
+			double Width = GroupSize(0).X, Height = GroupSize(0).Y;
+			double FocalLength = Width * 0.5 / FMath::Tan(FMath::DegreesToRadians(CaptureFOV) * 0.5f);
+			Settings.Q = (cv::Mat_<double>(4, 4) <<
+				1, 0, 0, -Width * 0.5,
+				0, 1, 0, -Height * 0.5,
+				0, 0, 0, FocalLength,
+				0, 0, 1 / StereoBaseline, 0);
+		}
+		StereoPipeline->SetPointCloud(Settings);
+	}
+}
+void AcvDepthEstimator::OnMouseClickedBegin()
+{
+	myviewport = GEngine->GameViewport ? GEngine->GameViewport->Viewport : nullptr;
+	if (!myviewport)
+	{
+		return;
+	}
+	isClicked = true;
+	bBeginTrack = false;
+	myviewport->GetMousePos(MouseIni);
 }
-//void AcvDepthEstimator::OnMouseClickedBegin()
-//{
-//	isClicked = true;
-//	myviewport->GetMousePos(MouseIni);
-//}
 
-//void AcvDepthEstimator::OnMouseClickedEnd()
-//{
-//	isClicked = false;
-//	Model = viewportframe(ViewportBox);
-//	cv::cvtColor(Model, Model, cv::COLOR_BGR2GRAY);
-//	bBeginTrack = true;
-//	searchWindow.width = ViewportBox.width;
-//	searchWindow.height = ViewportBox.height;
-//}
+void AcvDepthEstimator::OnMouseClickedEnd()
+{
+	if (!isClicked || !myviewport)
+	{
+		return;
+	}
+	isClicked = false;
+	myviewport->GetMousePos(MouseFinal);
+	ViewportBox = cv::Rect(cv::Point(MouseIni.X, MouseIni.Y), cv::Point(MouseFinal.X, MouseFinal.Y));
 
+	myviewport->ReadPixels(ViewportImage);
+	FIntPoint Size = myviewport->GetSizeXY();
+	viewportX = Size.X;
+	viewportY = Size.Y;
+	viewportframe = cv::Mat(viewportY, viewportX, CV_8UC4, ViewportImage.GetData());
+	cv::cvtColor(viewportframe, temp, cv::COLOR_BGRA2GRAY);
 
+	Tracker.Configure(TrackingPyramidLevels, TrackingSearchMargin, TrackingConfidence);
+	bBeginTrack = Tracker.SetTemplate(temp, ViewportBox);
+	if (bBeginTrack)
+	{
+		Model = temp(ViewportBox & cv::Rect(0, 0, temp.cols, temp.rows)).clone();
+		searchWindow = ViewportBox;
+	}
+}
+
+void AcvDepthEstimator::TrackViewport()
+{
+	myviewport->ReadPixels(ViewportImage);
+	FIntPoint Size = myviewport->GetSizeXY();
+	if (ViewportImage.Num() != Size.X * Size.Y)
+	{
+		return;
+	}
+	viewportframe = cv::Mat(Size.Y, Size.X, CV_8UC4, ViewportImage.GetData());
+	cv::cvtColor(viewportframe, temp, cv::COLOR_BGRA2GRAY);
+
+	Tracker.Track(temp, ViewportBox, mag_r);
+	TrackingScore = mag_r;
+	TrackedPosition = FVector2D(ViewportBox.x, ViewportBox.y);
+
+	cv::rectangle(viewportframe, ViewportBox, mag_r >= TrackingConfidence ? cv::Scalar(0, 255, 0, 255) : cv::Scalar(0, 0, 255, 255), 2);
+	ShowImage("tracking", viewportframe);
+}
+
+
+
+void AcvDepthEstimator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The uploads still queued give their frames back to the pipeline, then this joins the worker threads
+	FlushRenderingCommands();
+	// Its render commands submit into the pipeline
+	D3D11Capture.Reset();
+	StereoPipeline.Reset();
+	GPUStereo.Reset();
+	CaptureManager.Reset();
+	Rectifiers.Empty();
+	VideoSink.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AcvDepthEstimator::SubmitFrames()
+{
+	CaptureManager->Capture();
+
+	uint64 Frame = 0;
+	for (int32 Rig = 0; Rig < CaptureManager->GetGroupCount(); Rig++)
+	{
+		// All frames of the rig in flight, its images wait in the capture manager
+		TUniquePtr<FcvStereoFrame> StereoFrame = StereoPipeline->AcquireFrame(Rig);
+		if (!StereoFrame)
+		{
+			continue;
+		}
+
+		// The frame's arrays go to the capture manager in exchange, a rig without a depth target keeps black
+		TArray<FColor>* Pixels[] = { &StereoFrame->Left, &StereoFrame->Right, &StereoFrame->Depth };
+		if (!CaptureManager->GetLatest(Rig, Pixels, Frame))
+		{
+			StereoPipeline->Recycle(MoveTemp(StereoFrame));
+			continue;
+		}
+		StereoFrame->Frame = Frame;
+		StereoFrame->bReproject = bPointCloud && Rig == 0;
+		StereoFrame->bPackedGray = Rectifiers.IsValidIndex(Rig) && Rectifiers[Rig].IsValid();
+		StereoPipeline->Submit(MoveTemp(StereoFrame));
+	}
+}
+
+void AcvDepthEstimator::PublishResults()
+{
+	for (int32 Rig = 0; Rig < StereoRigs.Num(); Rig++)
+	{
+		TUniquePtr<FcvStereoFrame> Result = StereoPipeline->GetLatest(Rig);
+		if (!Result)
+		{
+			continue;
+		}
+
+		// The first rig keeps the window names it always had
+		std::string Suffix = Rig ? " " + std::to_string(Rig) : std::string();
+		ShowImage("frame" + Suffix, Result->LeftImage);
+		ShowImage("frame2" + Suffix, Result->RightImage);
+		ShowImage("disparity" + Suffix, Result->Disparity8);
+		ShowImage("realDepth" + Suffix, Result->DepthImage);
+		ShowImage("overlay" + Suffix, Result->LeftImage, Result->Disparity8);
+
+		if (Result->bReproject)
+		{
+			PointCloud->CopyPoints(Result->Points);
+		}
+
+		UTexture2D*& DisparityTexture = StereoRigs[Rig].DisparityTexture;
+		if (!DisparityTexture)
+		{
+			DisparityTexture = UTexture2D::CreateTransient(Result->Width, Result->Height, PF_G8);
+			DisparityTexture->SRGB = false;
+			DisparityTexture->UpdateResource();
+		}
+
+		// Uploaded straight from the frame, which the render thread gives back to the pool afterwards
+		FTexture2DResource* Resource = (FTexture2DResource*)DisparityTexture->Resource;
+		FcvStereoPipeline* Pipeline = StereoPipeline.Get();
+		FcvStereoFrame* Frame = Result.Release();
+		ENQUEUE_RENDER_COMMAND(cvUploadDisparity)([Resource, Pipeline, Frame](FRHICommandListImmediate& RHICmdList)
+		{
+			if (Resource && Resource->GetTexture2DRHI())
+			{
+				FUpdateTextureRegion2D Region(0, 0, 0, 0, Frame->Width, Frame->Height);
+				RHIUpdateTexture2D(Resource->GetTexture2DRHI(), 0, Region, (uint32)Frame->Disparity8.step, Frame->Disparity8.data);
+			}
+			Pipeline->Recycle(TUniquePtr<FcvStereoFrame>(Frame));
+		});
+	}
+}
+
+void AcvDepthEstimator::ShowImage(const std::string& Name, const cv::Mat& Image, const cv::Mat& Overlay)
+{
+	// The shared captures have no CPU images
+	if (Image.empty())
+	{
+		return;
+	}
+	if (DebugOutput == EcvDebugOutput::Window)
+	{
+		// The overlay is only composed for the videos
+		if (Overlay.empty())
+		{
+			cv::imshow(Name, Image);
+		}
+		return;
+	}
+	if (DebugOutput != EcvDebugOutput::Video)
+	{
+		return;
+	}
+
+	if (!VideoSink)
+	{
+		FString Directory = VideoDirectory.IsEmpty() ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("cvDebug")) : VideoDirectory;
+		VideoSink = MakeUnique<FcvVideoSink>(FPaths::ConvertRelativePathToFull(Directory), VideoFrameRate, VideoQueueCapacity);
+	}
+	if (Overlay.empty())
+	{
+		VideoSink->Write(Name, Image);
+	}
+	else
+	{
+		VideoSink->WriteOverlay(Name, Image, Overlay);
+	}
+}
+
+void AcvDepthEstimator::SetDebugOutput(EcvDebugOutput Output)
+{
+	if (Output != EcvDebugOutput::Window && DebugOutput == EcvDebugOutput::Window)
+	{
+		cv::destroyAllWindows();
+	}
+	if (Output != EcvDebugOutput::Video)
+	{
+		// Joins the encoder thread, which finishes the files
+		VideoSink.Reset();
+	}
+	DebugOutput = Output;
+}
 
 // Called every frame
 void AcvDepthEstimator::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	RenderTarget_1->ReadPixels(ImageData_1);
-	RenderTarget_2->ReadPixels(ImageData_2);
-	RenderTarget_3->ReadPixels(ImageData_3);
+	if (bBeginTrack && myviewport)
+	{
+		TrackViewport();
+	}
 
-	for (int y = 0; y < TargetY_1; y++)
+	if (GPUStereo)
 	{
-		for (int x = 0; x <TargetX_1; x++)
+		GPUStereo->Dispatch();
+		FcvStereoErrors Errors;
+		if (GPUStereo->GetLatestErrors(Errors))
 		{
-			int i = x + (y * TargetX_1);
-			frame.data[i * 3 + 0] = ImageData_1[i].B;
-			frame.data[i * 3 + 1] = ImageData_1[i].G;
-			frame.data[i * 3 + 2] = ImageData_1[i].R;
-			frame_2.data[i * 3 + 0] = ImageData_2[i].B;
-			frame_2.data[i * 3 + 1] = ImageData_2[i].G;
-			frame_2.data[i * 3 + 2] = ImageData_2[i].R;
-			realDepth.data[i * 3 + 0] = ImageData_3[i].B;
-			realDepth.data[i * 3 + 1] = ImageData_3[i].G;
-			realDepth.data[i * 3 + 2] = ImageData_3[i].R;
+			MeanDepthErrorCm = Errors.MeanAbsErrorCm;
+			BadPixelRatio = Errors.ValidPixels ? (float)Errors.BadPixels / Errors.ValidPixels : 0.0f;
 		}
+		return;
 	}
 
+	if (D3D11Capture)
+	{
+		// The render thread submits the frames itself once their fence has passed
+		D3D11Capture->Capture();
+	}
+	else if (CaptureManager)
+	{
+		SubmitFrames();
+	}
+	else
+	{
+		return;
+	}
+	PublishResults();
+
+	int32 Allocations = GcvBufferAllocations.GetValue();
+	BufferAllocationsLastFrame = Allocations - BufferAllocations;
+	BufferAllocations = Allocations;
+
 	//dual = (frame + frame_2) / 2;
 	//cv::GaussianBlur(frame, frame, cv::Size(3, 3), 0, 0);
 	//cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
@@ -149,18 +478,6 @@ void AcvDepthEstimator::Tick(float DeltaTime)
 
 //flag:
 	sum = 0;
-	cv::imshow("frame",frame);
-	cv::imshow("frame2", frame_2);
-
-	cv::cvtColor(frame, grayImageL, CV_BGR2GRAY);
-	cv::cvtColor(frame_2, grayImageR, CV_BGR2GRAY);
-
-	bm->compute(grayImageL, grayImageR, disp);
-	//disp.convertTo(disp8, CV_8U, 255 / ((numDisparities * 16 + 16)*16.));
-	//disp = 2500 / disp;
-	disp.convertTo(disp8, CV_8U, 255 / ((numDisparities * 16 + 16)*16.));
-	imshow("disparity", disp8);
-	imshow("realDepth", realDepth);
 
 
 	//cv::GaussianBlur(grayImageL, edges, cv::Size(37, 37), 2, 2);
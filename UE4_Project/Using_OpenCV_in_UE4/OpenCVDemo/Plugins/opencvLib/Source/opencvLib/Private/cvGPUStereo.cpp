@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvGPUStereo.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "RHIGPUReadback.h"
+#include "cvShaders.h"
+#include "Misc/ScopeLock.h"
+
+// Matches TILE_SIZE and MAX_DISPARITIES in cvStereoMatch.usf
+static const int32 StereoTileSize = 16;
+static const int32 StereoMaxDisparities = 256;
+
+FcvGPUStereo::~FcvGPUStereo()
+{
+	Release();
+}
+
+bool FcvGPUStereo::Initialize(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, UTextureRenderTarget2D* Depth, UTextureRenderTarget2D* Disparity,
+	int32 InNumDisparities, float InFocalBaseline, float InBadPixelThreshold)
+{
+	Release();
+	if (!Left || !Right || !Depth || !Disparity || GMaxRHIFeatureLevel < ERHIFeatureLevel::SM5)
+	{
+		return false;
+	}
+	if (Right->SizeX != Left->SizeX || Right->SizeY != Left->SizeY || Disparity->SizeX != Left->SizeX || Disparity->SizeY != Left->SizeY)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("GPU stereo needs the captures and the disparity target at the same size"));
+		return false;
+	}
+
+	LeftResource = Left->GameThread_GetRenderTargetResource();
+	RightResource = Right->GameThread_GetRenderTargetResource();
+	DepthResource = Depth->GameThread_GetRenderTargetResource();
+	DisparityResource = Disparity->GameThread_GetRenderTargetResource();
+	if (!LeftResource || !RightResource || !DepthResource || !DisparityResource)
+	{
+		LeftResource = nullptr;
+		return false;
+	}
+	Width = Left->SizeX;
+	Height = Left->SizeY;
+	NumDisparities = FMath::Clamp(InNumDisparities, 1, StereoMaxDisparities);
+	FocalBaseline = InFocalBaseline;
+	BadPixelThreshold = InBadPixelThreshold;
+	FrameCounter = 0;
+	bHasLatest = false;
+	return true;
+}
+
+void FcvGPUStereo::Release()
+{
+	if (!LeftResource)
+	{
+		return;
+	}
+
+	FcvGPUStereo* Stereo = this;
+	ENQUEUE_RENDER_COMMAND(cvGPUStereoRelease)([Stereo](FRHICommandListImmediate& RHICmdList)
+	{
+		for (FErrorSlot& Slot : Stereo->Slots)
+		{
+			Slot = FErrorSlot();
+		}
+		Stereo->DisparityUAV.SafeRelease();
+		Stereo->DisparityTexture.SafeRelease();
+	});
+	FlushRenderingCommands();
+	LeftResource = nullptr;
+}
+
+void FcvGPUStereo::Dispatch()
+{
+	if (!LeftResource)
+	{
+		return;
+	}
+
+	FcvGPUStereo* Stereo = this;
+	uint64 Frame = ++FrameCounter;
+	ENQUEUE_RENDER_COMMAND(cvGPUStereoDispatch)([Stereo, Frame](FRHICommandListImmediate& RHICmdList)
+	{
+		Stereo->DispatchRenderThread(RHICmdList, Frame);
+	});
+}
+
+bool FcvGPUStereo::CreateResources()
+{
+	if (DisparityTexture)
+	{
+		return true;
+	}
+
+	FRHIResourceCreateInfo CreateInfo;
+	DisparityTexture = RHICreateTexture2D(Width, Height, PF_R32_FLOAT, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
+	DisparityUAV = RHICreateUnorderedAccessView(DisparityTexture, 0);
+	for (FErrorSlot& Slot : Slots)
+	{
+		Slot.Buffer = RHICreateVertexBuffer(sizeof(uint32) * 4, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+		Slot.UAV = RHICreateUnorderedAccessView(Slot.Buffer, PF_R32_UINT);
+		Slot.Readback = MakeUnique<FRHIGPUBufferReadback>(TEXT("cvStereoErrors"));
+	}
+	return DisparityTexture.IsValid();
+}
+
+void FcvGPUStereo::DispatchRenderThread(FRHICommandListImmediate& RHICmdList, uint64 Frame)
+{
+	FTexture2DRHIRef Left = LeftResource->GetRenderTargetTexture();
+	FTexture2DRHIRef Right = RightResource->GetRenderTargetTexture();
+	FTexture2DRHIRef Depth = DepthResource->GetRenderTargetTexture();
+	FTexture2DRHIRef Disparity = DisparityResource->GetRenderTargetTexture();
+	if (!Left || !Right || !Depth || !Disparity || !CreateResources())
+	{
+		return;
+	}
+
+	ReadErrors();
+	FErrorSlot& Slot = Slots[WriteIndex];
+	if (Slot.bPending)
+	{
+		return;
+	}
+
+	uint32 Zero[4] = { 0, 0, 0, 0 };
+	RHICmdList.ClearTinyUAV(Slot.UAV, Zero);
+
+	TShaderMapRef<FcvStereoMatchCS> ComputeShader(GetGlobalShaderMap(ERHIFeatureLevel::SM5));
+	FcvStereoMatchCS::FParameters Parameters;
+	Parameters.LeftTexture = Left;
+	Parameters.RightTexture = Right;
+	Parameters.DepthTexture = Depth;
+	Parameters.DisparityOutput = DisparityUAV;
+	Parameters.ErrorOutput = Slot.UAV;
+	Parameters.TextureSize = FIntPoint(Width, Height);
+	Parameters.NumDisparities = NumDisparities;
+	Parameters.FocalBaseline = FocalBaseline;
+	Parameters.BadPixelThreshold = BadPixelThreshold;
+
+	FUnorderedAccessViewRHIParamRef UAVs[] = { DisparityUAV, Slot.UAV };
+	RHICmdList.TransitionResources(EResourceTransitionAccess::ERWBarrier, EResourceTransitionPipeline::EGfxToCompute, UAVs, ARRAY_COUNT(UAVs));
+	RHICmdList.SetComputeShader(ComputeShader->GetComputeShader());
+	SetShaderParameters(RHICmdList, *ComputeShader, ComputeShader->GetComputeShader(), Parameters);
+	RHICmdList.DispatchComputeShader(FMath::DivideAndRoundUp(Width, StereoTileSize), FMath::DivideAndRoundUp(Height, StereoTileSize), 1);
+	UnsetShaderUAVs(RHICmdList, *ComputeShader, ComputeShader->GetComputeShader());
+	RHICmdList.TransitionResources(EResourceTransitionAccess::EReadable, EResourceTransitionPipeline::EComputeToGfx, UAVs, ARRAY_COUNT(UAVs));
+
+	// Into the target the materials read, the formats are the same
+	RHICmdList.CopyToResolveTarget(DisparityTexture, Disparity, FResolveParams());
+
+	Slot.Readback->EnqueueCopy(RHICmdList, Slot.Buffer);
+	Slot.Frame = Frame;
+	Slot.bPending = true;
+	WriteIndex = (WriteIndex + 1) % ErrorRingSize;
+}
+
+void FcvGPUStereo::ReadErrors()
+{
+	// Oldest first, the copies finish in order
+	for (int32 i = 0; i < ErrorRingSize; i++)
+	{
+		FErrorSlot& Slot = Slots[(WriteIndex + i) % ErrorRingSize];
+		if (!Slot.bPending)
+		{
+			continue;
+		}
+		if (!Slot.Readback->IsReady())
+		{
+			break;
+		}
+
+		const uint32* Totals = (const uint32*)Slot.Readback->Lock(sizeof(uint32) * 4);
+		FcvStereoErrors Errors;
+		Errors.Frame = Slot.Frame;
+		Errors.ValidPixels = Totals[0];
+		Errors.BadPixels = Totals[2];
+		Errors.UnmatchedPixels = Totals[3];
+		Errors.MeanAbsErrorCm = Totals[0] ? (float)Totals[1] / Totals[0] : 0.0f;
+		Slot.Readback->Unlock();
+		Slot.bPending = false;
+
+		FScopeLock Lock(&LatestLock);
+		LatestErrors = Errors;
+		bHasLatest = true;
+	}
+}
+
+bool FcvGPUStereo::GetLatestErrors(FcvStereoErrors& OutErrors)
+{
+	FScopeLock Lock(&LatestLock);
+	if (!bHasLatest)
+	{
+		return false;
+	}
+	OutErrors = LatestErrors;
+	bHasLatest = false;
+	return true;
+}
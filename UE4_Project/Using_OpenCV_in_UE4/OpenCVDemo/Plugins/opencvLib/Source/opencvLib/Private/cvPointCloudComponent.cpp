@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvPointCloudComponent.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+#include "RenderingThread.h"
+
+class FcvPointCloudSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	FcvPointCloudSceneProxy(const UcvPointCloudComponent* Component)
+		: FPrimitiveSceneProxy(Component)
+		, PointSize(Component->PointSize)
+		, PointColor(Component->PointColor)
+	{
+	}
+
+	virtual SIZE_T GetTypeHash() const override
+	{
+		static size_t UniquePointer;
+		return reinterpret_cast<size_t>(&UniquePointer);
+	}
+
+	void SetPoints_RenderThread(TArray<FVector>&& InPoints)
+	{
+		// The old set is freed here, off the game thread
+		Points = MoveTemp(InPoints);
+	}
+
+	void CopyPoints_RenderThread(const TArray<FVector>& InPoints)
+	{
+		Points.Reset();
+		Points.Append(InPoints);
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		const FMatrix& LocalToWorld = GetLocalToWorld();
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+		{
+			if (!(VisibilityMap & (1 << ViewIndex)))
+			{
+				continue;
+			}
+			// Batched into one draw per view
+			FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
+			for (const FVector& Point : Points)
+			{
+				PDI->DrawPoint(LocalToWorld.TransformPosition(Point), PointColor, PointSize, SDPG_World);
+			}
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bDynamicRelevance = true;
+		Result.bShadowRelevance = false;
+		return Result;
+	}
+
+	virtual uint32 GetMemoryFootprint() const override
+	{
+		return sizeof(*this) + GetAllocatedSize() + Points.GetAllocatedSize();
+	}
+
+private:
+	float PointSize;
+	FLinearColor PointColor;
+	TArray<FVector> Points;
+};
+
+UcvPointCloudComponent::UcvPointCloudComponent()
+{
+	CastShadow = false;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+}
+
+void UcvPointCloudComponent::SetPoints(TArray<FVector>&& InPoints)
+{
+	PointCount = InPoints.Num();
+	FcvPointCloudSceneProxy* Proxy = (FcvPointCloudSceneProxy*)SceneProxy;
+	if (!Proxy)
+	{
+		return;
+	}
+	ENQUEUE_RENDER_COMMAND(cvPointCloudUpdate)([Proxy, Points = MoveTemp(InPoints)](FRHICommandListImmediate& RHICmdList) mutable
+	{
+		Proxy->SetPoints_RenderThread(MoveTemp(Points));
+	});
+}
+
+void UcvPointCloudComponent::CopyPoints(const TArray<FVector>& InPoints)
+{
+	PointCount = InPoints.Num();
+	FcvPointCloudSceneProxy* Proxy = (FcvPointCloudSceneProxy*)SceneProxy;
+	if (!Proxy)
+	{
+		return;
+	}
+	const TArray<FVector>* Source = &InPoints;
+	ENQUEUE_RENDER_COMMAND(cvPointCloudCopy)([Proxy, Source](FRHICommandListImmediate& RHICmdList)
+	{
+		Proxy->CopyPoints_RenderThread(*Source);
+	});
+}
+
+FPrimitiveSceneProxy* UcvPointCloudComponent::CreateSceneProxy()
+{
+	// A new proxy starts empty and gets the next set of points
+	return new FcvPointCloudSceneProxy(this);
+}
+
+FBoxSphereBounds UcvPointCloudComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	return FBoxSphereBounds(FVector::ZeroVector, FVector(BoundsRadius), BoundsRadius).TransformBy(LocalToWorld);
+}
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvRenderTargetReadback.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "Misc/ScopeLock.h"
+#include "cvStereoPipeline.h"
+
+FcvRenderTargetReadback::~FcvRenderTargetReadback()
+{
+	Release();
+}
+
+bool FcvRenderTargetReadback::Initialize(UTextureRenderTarget2D* Target, int32 InRingSize)
+{
+	Release();
+	if (!Target)
+	{
+		return false;
+	}
+	// Other formats go through the synchronous ReadPixels path, which converts them
+	EPixelFormat Format = Target->GetFormat();
+	if (Format != PF_B8G8R8A8 && Format != PF_R8G8B8A8 && Format != PF_FloatRGBA)
+	{
+		return false;
+	}
+	Resource = Target->GameThread_GetRenderTargetResource();
+	if (!Resource)
+	{
+		return false;
+	}
+	Width = Target->SizeX;
+	Height = Target->SizeY;
+	RingSize = FMath::Max(InRingSize, 1);
+	FrameCounter = 0;
+	bHasLatest = false;
+	return true;
+}
+
+void FcvRenderTargetReadback::Release()
+{
+	if (!Resource)
+	{
+		return;
+	}
+
+	// The commands already queued still point at this object
+	FcvRenderTargetReadback* Readback = this;
+	ENQUEUE_RENDER_COMMAND(cvReadbackRelease)([Readback](FRHICommandListImmediate& RHICmdList)
+	{
+		Readback->Slots.Empty();
+		Readback->WriteIndex = 0;
+		Readback->PendingCount = 0;
+	});
+	FlushRenderingCommands();
+	Resource = nullptr;
+}
+
+void FcvRenderTargetReadback::Enqueue()
+{
+	if (!Resource)
+	{
+		return;
+	}
+
+	FcvRenderTargetReadback* Readback = this;
+	uint64 Frame = ++FrameCounter;
+	ENQUEUE_RENDER_COMMAND(cvReadbackCopy)([Readback, Frame](FRHICommandListImmediate& RHICmdList)
+	{
+		Readback->CopyRenderThread(RHICmdList, Frame);
+	});
+}
+
+void FcvRenderTargetReadback::CopyRenderThread(FRHICommandListImmediate& RHICmdList, uint64 Frame)
+{
+	FTexture2DRHIRef Source = Resource ? Resource->GetRenderTargetTexture() : nullptr;
+	if (!Source)
+	{
+		return;
+	}
+
+	if (Slots.Num() == 0)
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		Slots.SetNum(RingSize);
+		for (FSlot& Slot : Slots)
+		{
+			Slot.Staging = RHICreateTexture2D(Width, Height, Source->GetFormat(), 1, 1, TexCreate_CPUReadback, CreateInfo);
+		}
+	}
+
+	// Frees the slots whose copies are done before this frame takes one
+	MapFinished(RHICmdList);
+	if (PendingCount == Slots.Num())
+	{
+		return;
+	}
+
+	FSlot& Slot = Slots[WriteIndex];
+	RHICmdList.CopyToResolveTarget(Source, Slot.Staging, FResolveParams());
+	Slot.Fence = RHICreateGPUFence(TEXT("cvReadback"));
+	RHICmdList.WriteGPUFence(Slot.Fence);
+	Slot.Frame = Frame;
+	WriteIndex = (WriteIndex + 1) % Slots.Num();
+	PendingCount++;
+}
+
+void FcvRenderTargetReadback::MapFinished(FRHICommandListImmediate& RHICmdList)
+{
+	// Copies finish in order, only the newest finished one is mapped
+	int32 Count = Slots.Num();
+	int32 Finished = 0;
+	while (Finished < PendingCount && Slots[(WriteIndex - PendingCount + Finished + Count) % Count].Fence->Poll())
+	{
+		Finished++;
+	}
+	if (Finished == 0)
+	{
+		return;
+	}
+
+	FSlot& Slot = Slots[(WriteIndex - PendingCount + Finished - 1 + Count) % Count];
+	void* Data = nullptr;
+	int32 PitchPixels = 0, Rows = 0;
+	RHICmdList.MapStagingSurface(Slot.Staging, Data, PitchPixels, Rows);
+	if (Data)
+	{
+		EPixelFormat Format = Slot.Staging->GetFormat();
+		bool bSwapRB = Format == PF_R8G8B8A8;
+		FScopeLock Lock(&LatestLock);
+		// The arrays handed out come back through GetLatest, so after the first frames this never allocates
+		const FColor* Before = LatestPixels.GetData();
+		LatestPixels.SetNumUninitialized(Width * Height);
+		if (LatestPixels.GetData() != Before)
+		{
+			GcvBufferAllocations.Increment();
+		}
+		for (int32 y = 0; y < Height; y++)
+		{
+			FColor* Dest = LatestPixels.GetData() + y * Width;
+			if (Format == PF_FloatRGBA)
+			{
+				// Half float targets, converted to sRGB bytes the way ReadPixels does
+				const FFloat16Color* Row = (const FFloat16Color*)Data + y * PitchPixels;
+				for (int32 x = 0; x < Width; x++)
+				{
+					Dest[x] = FLinearColor(Row[x].R.GetFloat(), Row[x].G.GetFloat(), Row[x].B.GetFloat(), Row[x].A.GetFloat()).ToFColor(true);
+				}
+				continue;
+			}
+			const FColor* Row = (const FColor*)Data + y * PitchPixels;
+			FMemory::Memcpy(Dest, Row, Width * sizeof(FColor));
+			if (bSwapRB)
+			{
+				for (int32 x = 0; x < Width; x++)
+				{
+					Swap(Dest[x].R, Dest[x].B);
+				}
+			}
+		}
+		LatestFrame = Slot.Frame;
+		bHasLatest = true;
+	}
+	RHICmdList.UnmapStagingSurface(Slot.Staging);
+
+	for (int32 i = 0; i < Finished; i++)
+	{
+		Slots[(WriteIndex - PendingCount + i + Count) % Count].Fence.SafeRelease();
+	}
+	PendingCount -= Finished;
+}
+
+bool FcvRenderTargetReadback::GetLatest(TArray<FColor>& OutPixels, uint64& OutFrame)
+{
+	FScopeLock Lock(&LatestLock);
+	if (!bHasLatest)
+	{
+		return false;
+	}
+	Exchange(OutPixels, LatestPixels);
+	OutFrame = LatestFrame;
+	bHasLatest = false;
+	return true;
+}
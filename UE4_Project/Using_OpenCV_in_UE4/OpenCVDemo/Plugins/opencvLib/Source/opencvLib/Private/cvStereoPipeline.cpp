@@ -0,0 +1,430 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvStereoPipeline.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
+#include "opencv2/imgproc.hpp"
+
+FThreadSafeCounter GcvBufferAllocations;
+
+void FcvStereoFrame::Allocate(int32 InWidth, int32 InHeight, int32 MaxPoints, bool bDevice)
+{
+	Width = InWidth;
+	Height = InHeight;
+	Left.SetNumUninitialized(Width * Height);
+	Right.SetNumUninitialized(Width * Height);
+	Depth.Init(FColor::Black, Width * Height);
+	GrayL.create(Height, Width, CV_8UC1);
+	GrayR.create(Height, Width, CV_8UC1);
+	Disparity.create(Height, Width, CV_16SC1);
+	Disparity8.create(Height, Width, CV_8UC1);
+	Points.Reserve(MaxPoints);
+	if (bDevice)
+	{
+		GrayLDevice.create(Height, Width, CV_8UC1);
+		GrayRDevice.create(Height, Width, CV_8UC1);
+		DisparityDevice.create(Height, Width, CV_16SC1);
+		Disparity8Device.create(Height, Width, CV_8UC1);
+		LeftDevice.create(Height, Width, CV_8UC4);
+		RightDevice.create(Height, Width, CV_8UC4);
+	}
+}
+
+void FcvStereoFrame::SnapshotBuffers(const void* OutBuffers[12]) const
+{
+	OutBuffers[0] = Left.GetData();
+	OutBuffers[1] = Right.GetData();
+	OutBuffers[2] = Depth.GetData();
+	OutBuffers[3] = GrayL.data;
+	OutBuffers[4] = GrayR.data;
+	OutBuffers[5] = Disparity.data;
+	OutBuffers[6] = Disparity8.data;
+	OutBuffers[7] = Points.GetData();
+	OutBuffers[8] = DisparityDevice.u;
+	OutBuffers[9] = Disparity8Device.u;
+	OutBuffers[10] = LeftDevice.u;
+	OutBuffers[11] = RightDevice.u;
+}
+
+void FcvStereoFrame::CountAllocations(const void* const Buffers[12]) const
+{
+	const void* Current[12];
+	SnapshotBuffers(Current);
+	for (int32 i = 0; i < 12; i++)
+	{
+		if (Current[i] != Buffers[i])
+		{
+			GcvBufferAllocations.Increment();
+		}
+	}
+}
+
+FcvFramePool::FcvFramePool(int32 Rig, int32 Width, int32 Height, int32 Count, int32 MaxPoints, bool bDevice)
+{
+	for (int32 i = 0; i < Count; i++)
+	{
+		TUniquePtr<FcvStereoFrame> Frame = MakeUnique<FcvStereoFrame>();
+		Frame->Rig = Rig;
+		Frame->Allocate(Width, Height, MaxPoints, bDevice);
+		Free.Add(MoveTemp(Frame));
+	}
+}
+
+TUniquePtr<FcvStereoFrame> FcvFramePool::Acquire()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Free.Num() == 0)
+	{
+		return nullptr;
+	}
+	return Free.Pop(false);
+}
+
+void FcvFramePool::Recycle(TUniquePtr<FcvStereoFrame> Frame)
+{
+	// The array never grows past the frames the pool made
+	FScopeLock ScopeLock(&Lock);
+	Frame->bReproject = false;
+	Frame->bDeviceSource = false;
+	Frame->bPackedGray = false;
+	Free.Add(MoveTemp(Frame));
+}
+
+FcvFrameQueue::FcvFrameQueue(int32 InCapacity)
+	: Event(FPlatformProcess::GetSynchEventFromPool(false))
+{
+	Ring.SetNum(FMath::Max(InCapacity, 1));
+}
+
+FcvFrameQueue::~FcvFrameQueue()
+{
+	FPlatformProcess::ReturnSynchEventToPool(Event);
+}
+
+bool FcvFrameQueue::Push(TUniquePtr<FcvStereoFrame>& Frame)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (Count == Ring.Num())
+		{
+			return false;
+		}
+		Ring[(Head + Count) % Ring.Num()] = MoveTemp(Frame);
+		Count++;
+	}
+	Event->Trigger();
+	return true;
+}
+
+bool FcvFrameQueue::Pop(TUniquePtr<FcvStereoFrame>& OutFrame)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Count == 0)
+	{
+		return false;
+	}
+	OutFrame = MoveTemp(Ring[Head]);
+	Head = (Head + 1) % Ring.Num();
+	Count--;
+	return true;
+}
+
+void FcvFrameQueue::Trigger()
+{
+	Event->Trigger();
+}
+
+void FcvFrameQueue::Wait(uint32 WaitMs)
+{
+	Event->Wait(WaitMs);
+}
+
+FcvStereoPipeline::FStage::FStage(FcvStereoPipeline& InPipeline, FcvFrameQueue& InInput, FcvFrameQueue& InOutput, TFunction<void(FcvStereoFrame&)> InWork)
+	: Pipeline(InPipeline)
+	, Input(InInput)
+	, Output(InOutput)
+	, Work(MoveTemp(InWork))
+{
+}
+
+uint32 FcvStereoPipeline::FStage::Run()
+{
+	while (!bStop)
+	{
+		TUniquePtr<FcvStereoFrame> Frame;
+		if (!Input.Pop(Frame))
+		{
+			Input.Wait(100);
+			continue;
+		}
+		const void* Buffers[12];
+		Frame->SnapshotBuffers(Buffers);
+		Work(*Frame);
+		Frame->CountAllocations(Buffers);
+		if (!Output.Push(Frame))
+		{
+			Pipeline.Dropped.Increment();
+			Pipeline.Recycle(MoveTemp(Frame));
+		}
+	}
+	return 0;
+}
+
+static cv::Ptr<cv::StereoBM> CloneMatcher(const cv::Ptr<cv::StereoBM>& Source)
+{
+	cv::Ptr<cv::StereoBM> Clone = cv::StereoBM::create(Source->getNumDisparities(), Source->getBlockSize());
+	Clone->setPreFilterType(Source->getPreFilterType());
+	Clone->setPreFilterSize(Source->getPreFilterSize());
+	Clone->setPreFilterCap(Source->getPreFilterCap());
+	Clone->setMinDisparity(Source->getMinDisparity());
+	Clone->setTextureThreshold(Source->getTextureThreshold());
+	Clone->setUniquenessRatio(Source->getUniquenessRatio());
+	Clone->setSpeckleWindowSize(Source->getSpeckleWindowSize());
+	Clone->setSpeckleRange(Source->getSpeckleRange());
+	Clone->setDisp12MaxDiff(Source->getDisp12MaxDiff());
+	Clone->setSmallerBlockSize(Source->getSmallerBlockSize());
+	Clone->setROI1(Source->getROI1());
+	Clone->setROI2(Source->getROI2());
+	return Clone;
+}
+
+FcvStereoPipeline::FcvStereoPipeline(cv::Ptr<cv::StereoBM> InMatcher, int32 InNumDisparities, int32 QueueCapacity, int32 StereoWorkers, bool bInUseOpenCL)
+	: NumDisparities(InNumDisparities)
+	, bUseOpenCL(bInUseOpenCL)
+	, ConvertQueue(QueueCapacity)
+	, StereoQueue(QueueCapacity)
+	, PostprocessQueue(QueueCapacity)
+	, ResultQueue(QueueCapacity)
+{
+	StereoWorkers = FMath::Max(StereoWorkers, 1);
+	for (int32 i = 0; i < StereoWorkers; i++)
+	{
+		Matchers.Add(i == 0 ? InMatcher : CloneMatcher(InMatcher));
+	}
+
+	Stages.Add(MakeUnique<FStage>(*this, ConvertQueue, StereoQueue, [this](FcvStereoFrame& Frame) { Convert(Frame); }));
+	Threads.Add(FRunnableThread::Create(Stages.Last().Get(), TEXT("cvConvert")));
+	for (int32 i = 0; i < StereoWorkers; i++)
+	{
+		cv::StereoBM* Matcher = Matchers[i].get();
+		Stages.Add(MakeUnique<FStage>(*this, StereoQueue, PostprocessQueue, [this, Matcher](FcvStereoFrame& Frame) { Match(Frame, *Matcher); }));
+		Threads.Add(FRunnableThread::Create(Stages.Last().Get(), *FString::Printf(TEXT("cvStereo%d"), i)));
+	}
+	Stages.Add(MakeUnique<FStage>(*this, PostprocessQueue, ResultQueue, [this](FcvStereoFrame& Frame) { Postprocess(Frame); }));
+	Threads.Add(FRunnableThread::Create(Stages.Last().Get(), TEXT("cvPostprocess")));
+}
+
+FcvStereoPipeline::~FcvStereoPipeline()
+{
+	for (int32 i = 0; i < Threads.Num(); i++)
+	{
+		if (Threads[i])
+		{
+			Threads[i]->Kill(true);
+			delete Threads[i];
+		}
+	}
+	Threads.Empty();
+	Stages.Empty();
+}
+
+bool FcvStereoPipeline::Submit(TUniquePtr<FcvStereoFrame> Frame)
+{
+	if (!ConvertQueue.Push(Frame))
+	{
+		Dropped.Increment();
+		Recycle(MoveTemp(Frame));
+		return false;
+	}
+	return true;
+}
+
+void FcvStereoPipeline::AddFramePool(int32 Rig, int32 Width, int32 Height, int32 Count, int32 MaxPoints)
+{
+	if (Rig >= FramePools.Num())
+	{
+		FramePools.SetNum(Rig + 1);
+	}
+	FramePools[Rig] = MakeUnique<FcvFramePool>(Rig, Width, Height, Count, MaxPoints, bUseOpenCL);
+}
+
+TUniquePtr<FcvStereoFrame> FcvStereoPipeline::AcquireFrame(int32 Rig)
+{
+	if (!FramePools.IsValidIndex(Rig) || !FramePools[Rig])
+	{
+		return nullptr;
+	}
+	return FramePools[Rig]->Acquire();
+}
+
+void FcvStereoPipeline::Recycle(TUniquePtr<FcvStereoFrame> Frame)
+{
+	if (Frame && FramePools.IsValidIndex(Frame->Rig) && FramePools[Frame->Rig])
+	{
+		FramePools[Frame->Rig]->Recycle(MoveTemp(Frame));
+	}
+}
+
+TUniquePtr<FcvStereoFrame> FcvStereoPipeline::GetLatest(int32 Rig)
+{
+	// The stereo workers can finish a rig's frames out of order
+	TUniquePtr<FcvStereoFrame> Frame;
+	while (ResultQueue.Pop(Frame))
+	{
+		if (Frame->Rig >= LatestResults.Num())
+		{
+			LatestResults.SetNum(Frame->Rig + 1);
+		}
+		TUniquePtr<FcvStereoFrame>& Latest = LatestResults[Frame->Rig];
+		if (Latest && Latest->Frame > Frame->Frame)
+		{
+			Recycle(MoveTemp(Frame));
+			continue;
+		}
+		Recycle(MoveTemp(Latest));
+		Latest = MoveTemp(Frame);
+	}
+	if (!LatestResults.IsValidIndex(Rig))
+	{
+		return nullptr;
+	}
+	return MoveTemp(LatestResults[Rig]);
+}
+
+static cv::Mat WrapPixels(TArray<FColor>& Pixels, int32 Width, int32 Height)
+{
+	// A capture that never came back stays black
+	if (Pixels.Num() != Width * Height)
+	{
+		Pixels.Init(FColor::Black, Width * Height);
+	}
+	return cv::Mat(Height, Width, CV_8UC4, Pixels.GetData());
+}
+
+void FcvStereoPipeline::Convert(FcvStereoFrame& Frame)
+{
+	if (Frame.bDeviceSource)
+	{
+		// Copied on the device by the render thread, the captures never were on the CPU
+		Frame.LeftImage.release();
+		Frame.RightImage.release();
+		Frame.DepthImage.release();
+		int Code = Frame.bSourceRGBA ? cv::COLOR_RGBA2GRAY : cv::COLOR_BGRA2GRAY;
+		cv::cvtColor(Frame.LeftDevice, Frame.GrayLDevice, Code);
+		cv::cvtColor(Frame.RightDevice, Frame.GrayRDevice, Code);
+		return;
+	}
+	if (Frame.bPackedGray)
+	{
+		// Rectified and converted on the GPU, only the upload to the device is left
+		Frame.LeftImage = WrapPixels(Frame.Left, Frame.Width / 4, Frame.Height).reshape(1, Frame.Height);
+		Frame.RightImage = WrapPixels(Frame.Right, Frame.Width / 4, Frame.Height).reshape(1, Frame.Height);
+		Frame.DepthImage.release();
+		if (bUseOpenCL)
+		{
+			Frame.LeftImage.copyTo(Frame.GrayLDevice);
+			Frame.RightImage.copyTo(Frame.GrayRDevice);
+		}
+		return;
+	}
+
+	// FColor is BGRA8 in memory, so the arrays are used as they are
+	Frame.LeftImage = WrapPixels(Frame.Left, Frame.Width, Frame.Height);
+	Frame.RightImage = WrapPixels(Frame.Right, Frame.Width, Frame.Height);
+	Frame.DepthImage = WrapPixels(Frame.Depth, Frame.Width, Frame.Height);
+	if (bUseOpenCL)
+	{
+		// The one upload, the conversion already runs on the device
+		cv::cvtColor(Frame.LeftImage.getUMat(cv::ACCESS_READ), Frame.GrayLDevice, cv::COLOR_BGRA2GRAY);
+		cv::cvtColor(Frame.RightImage.getUMat(cv::ACCESS_READ), Frame.GrayRDevice, cv::COLOR_BGRA2GRAY);
+		return;
+	}
+	cv::cvtColor(Frame.LeftImage, Frame.GrayL, cv::COLOR_BGRA2GRAY);
+	cv::cvtColor(Frame.RightImage, Frame.GrayR, cv::COLOR_BGRA2GRAY);
+}
+
+void FcvStereoPipeline::Match(FcvStereoFrame& Frame, cv::StereoBM& Matcher)
+{
+	if (bUseOpenCL)
+	{
+		Matcher.compute(Frame.GrayLDevice, Frame.GrayRDevice, Frame.DisparityDevice);
+		return;
+	}
+	if (Frame.bPackedGray)
+	{
+		Matcher.compute(Frame.LeftImage, Frame.RightImage, Frame.Disparity);
+		return;
+	}
+	Matcher.compute(Frame.GrayL, Frame.GrayR, Frame.Disparity);
+}
+
+void FcvStereoPipeline::Postprocess(FcvStereoFrame& Frame)
+{
+	// StereoBM gives 16 times the disparity in CV_16S
+	double Scale = 255 / (NumDisparities * 16.);
+	if (bUseOpenCL)
+	{
+		Frame.DisparityDevice.convertTo(Frame.Disparity8Device, CV_8U, Scale);
+		Frame.Disparity8Device.copyTo(Frame.Disparity8);
+	}
+	else
+	{
+		Frame.Disparity.convertTo(Frame.Disparity8, CV_8U, Scale);
+	}
+	if (Frame.bReproject && !PointCloud.Q.empty())
+	{
+		Reproject(Frame);
+	}
+}
+
+void FcvStereoPipeline::Reproject(FcvStereoFrame& Frame)
+{
+	// Whole pixels, the invalid ones end up below the minimum and are marked missing
+	if (bUseOpenCL)
+	{
+		Frame.DisparityDevice.getMat(cv::ACCESS_READ).convertTo(DisparityFloat, CV_32F, 1 / 16.);
+	}
+	else
+	{
+		Frame.Disparity.convertTo(DisparityFloat, CV_32F, 1 / 16.);
+	}
+	cv::reprojectImageTo3D(DisparityFloat, Points3D, PointCloud.Q, true);
+
+	VoxelIndex.Reset();
+	Voxels.Reset();
+	float InvVoxel = 1.0f / FMath::Max(PointCloud.VoxelSize, 0.01f);
+	for (int32 y = 0; y < Points3D.rows; y++)
+	{
+		const cv::Vec3f* Row = Points3D.ptr<cv::Vec3f>(y);
+		for (int32 x = 0; x < Points3D.cols; x++)
+		{
+			const cv::Vec3f& P = Row[x];
+			if (P[2] <= 0 || P[2] > PointCloud.MaxDepth)
+			{
+				continue;
+			}
+			FIntVector Key(FMath::FloorToInt(P[0] * InvVoxel), FMath::FloorToInt(P[1] * InvVoxel), FMath::FloorToInt(P[2] * InvVoxel));
+			int32* Index = VoxelIndex.Find(Key);
+			if (!Index)
+			{
+				if (Voxels.Num() >= PointCloud.MaxPoints)
+				{
+					continue;
+				}
+				Index = &VoxelIndex.Add(Key, Voxels.Num());
+				Voxels.Add(FVector4(0, 0, 0, 0));
+			}
+			Voxels[*Index] += FVector4(P[0], P[1], P[2], 1);
+		}
+	}
+
+	// OpenCV's camera looks down +z with y down, UE's down +X with Z up
+	Frame.Points.SetNumUninitialized(Voxels.Num());
+	for (int32 i = 0; i < Voxels.Num(); i++)
+	{
+		const FVector4& Sum = Voxels[i];
+		Frame.Points[i] = FVector(Sum.Z, Sum.X, -Sum.Y) / Sum.W;
+	}
+}
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvStereoRectifier.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "TextureResource.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "cvShaders.h"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/imgproc.hpp"
+
+// Matches GROUP_SIZE in cvRectify.usf
+static const int32 RectifyGroupSize = 8;
+
+FcvStereoRectifier::~FcvStereoRectifier()
+{
+	Release();
+}
+
+bool FcvStereoRectifier::LoadCalibration(const FString& Path, int32 InWidth, int32 InHeight)
+{
+	cv::Mat M1, D1, M2, D2, R, T, R1, R2, P1, P2;
+	try
+	{
+		cv::FileStorage Storage(TCHAR_TO_UTF8(*Path), cv::FileStorage::READ);
+		if (!Storage.isOpened())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Couldn't open the stereo calibration %s"), *Path);
+			return false;
+		}
+		Storage["M1"] >> M1;
+		Storage["D1"] >> D1;
+		Storage["M2"] >> M2;
+		Storage["D2"] >> D2;
+		Storage["R"] >> R;
+		Storage["T"] >> T;
+		Storage["R1"] >> R1;
+		Storage["R2"] >> R2;
+		Storage["P1"] >> P1;
+		Storage["P2"] >> P2;
+		Storage["Q"] >> Q;
+	}
+	catch (const cv::Exception& Exception)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't read the stereo calibration %s: %s"), *Path, UTF8_TO_TCHAR(Exception.what()));
+		return false;
+	}
+	if (M1.empty() || M2.empty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no camera matrices"), *Path);
+		return false;
+	}
+
+	Width = InWidth;
+	Height = InHeight;
+	cv::Size Size(Width, Height);
+	if (R1.empty() || R2.empty() || P1.empty() || P2.empty() || Q.empty())
+	{
+		if (R.empty() || T.empty())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s has neither the rectification nor R and T"), *Path);
+			return false;
+		}
+		cv::stereoRectify(M1, D1, M2, D2, Size, R, T, R1, R2, P1, P2, Q, cv::CALIB_ZERO_DISPARITY, 0);
+	}
+
+	// Once, remap then only does the table lookups
+	cv::initUndistortRectifyMap(M1, D1, R1, P1, Size, CV_16SC2, Maps[0], Fractions[0]);
+	cv::initUndistortRectifyMap(M2, D2, R2, P2, Size, CV_16SC2, Maps[1], Fractions[1]);
+	Q.convertTo(Q, CV_64F);
+	return true;
+}
+
+UTextureRenderTarget2D* FcvStereoRectifier::CreatePackedTarget(UObject* Outer, int32 CaptureWidth, int32 CaptureHeight)
+{
+	if (CaptureWidth % 4 != 0)
+	{
+		return nullptr;
+	}
+	UTextureRenderTarget2D* Target = NewObject<UTextureRenderTarget2D>(Outer);
+	Target->InitCustomFormat(CaptureWidth / 4, CaptureHeight, PF_R8G8B8A8, true);
+	Target->UpdateResourceImmediate(false);
+	return Target;
+}
+
+bool FcvStereoRectifier::Initialize(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, UTextureRenderTarget2D* PackedLeft, UTextureRenderTarget2D* PackedRight)
+{
+	Release();
+	if (Maps[0].empty() || !Left || !Right || !PackedLeft || !PackedRight || GMaxRHIFeatureLevel < ERHIFeatureLevel::SM5)
+	{
+		return false;
+	}
+	if (Left->SizeX != Width || Left->SizeY != Height || Right->SizeX != Width || Right->SizeY != Height
+		|| PackedLeft->SizeX * 4 != Width || PackedRight->SizeX * 4 != Width || PackedLeft->SizeY != Height || PackedRight->SizeY != Height)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: the rectified targets don't match the calibrated size"), *Left->GetName());
+		return false;
+	}
+
+	UTextureRenderTarget2D* Targets[] = { Left, Right, PackedLeft, PackedRight };
+	for (int32 i = 0; i < 2; i++)
+	{
+		Sources[i] = Targets[i]->GameThread_GetRenderTargetResource();
+		PackedTargets[i] = Targets[i + 2]->GameThread_GetRenderTargetResource();
+		if (!Sources[i] || !PackedTargets[i])
+		{
+			Sources[0] = nullptr;
+			return false;
+		}
+	}
+	return true;
+}
+
+void FcvStereoRectifier::Release()
+{
+	if (!Sources[0])
+	{
+		return;
+	}
+
+	FcvStereoRectifier* Rectifier = this;
+	ENQUEUE_RENDER_COMMAND(cvRectifierRelease)([Rectifier](FRHICommandListImmediate& RHICmdList)
+	{
+		for (int32 i = 0; i < 2; i++)
+		{
+			Rectifier->MapTextures[i].SafeRelease();
+			Rectifier->FractionTextures[i].SafeRelease();
+			Rectifier->PackedUAVs[i].SafeRelease();
+			Rectifier->PackedTextures[i].SafeRelease();
+		}
+	});
+	FlushRenderingCommands();
+	Sources[0] = nullptr;
+}
+
+bool FcvStereoRectifier::CreateResources()
+{
+	if (PackedTextures[0])
+	{
+		return true;
+	}
+
+	FRHIResourceCreateInfo CreateInfo;
+	FUpdateTextureRegion2D Region(0, 0, 0, 0, Width, Height);
+	for (int32 i = 0; i < 2; i++)
+	{
+		// The coordinates go up as unsigned, the shader sign extends them
+		MapTextures[i] = RHICreateTexture2D(Width, Height, PF_R16G16_UINT, 1, 1, TexCreate_ShaderResource, CreateInfo);
+		RHIUpdateTexture2D(MapTextures[i], 0, Region, (uint32)Maps[i].step, Maps[i].data);
+		FractionTextures[i] = RHICreateTexture2D(Width, Height, PF_R16_UINT, 1, 1, TexCreate_ShaderResource, CreateInfo);
+		RHIUpdateTexture2D(FractionTextures[i], 0, Region, (uint32)Fractions[i].step, Fractions[i].data);
+		PackedTextures[i] = RHICreateTexture2D(Width / 4, Height, PF_R8G8B8A8, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
+		PackedUAVs[i] = RHICreateUnorderedAccessView(PackedTextures[i], 0);
+		Maps[i].release();
+		Fractions[i].release();
+	}
+	return PackedTextures[0].IsValid();
+}
+
+void FcvStereoRectifier::RectifyRenderThread(FRHICommandListImmediate& RHICmdList)
+{
+	if (!Sources[0] || !CreateResources())
+	{
+		return;
+	}
+
+	TShaderMapRef<FcvRectifyCS> ComputeShader(GetGlobalShaderMap(ERHIFeatureLevel::SM5));
+	for (int32 i = 0; i < 2; i++)
+	{
+		FTexture2DRHIRef Source = Sources[i]->GetRenderTargetTexture();
+		FTexture2DRHIRef Packed = PackedTargets[i]->GetRenderTargetTexture();
+		if (!Source || !Packed)
+		{
+			continue;
+		}
+
+		FcvRectifyCS::FParameters Parameters;
+		Parameters.SourceTexture = Source;
+		Parameters.MapTexture = MapTextures[i];
+		Parameters.FractionTexture = FractionTextures[i];
+		Parameters.PackedOutput = PackedUAVs[i];
+		Parameters.SourceSize = FIntPoint(Width, Height);
+		Parameters.OutputSize = FIntPoint(Width, Height);
+
+		FUnorderedAccessViewRHIParamRef UAVs[] = { PackedUAVs[i] };
+		RHICmdList.TransitionResources(EResourceTransitionAccess::ERWBarrier, EResourceTransitionPipeline::EGfxToCompute, UAVs, ARRAY_COUNT(UAVs));
+		RHICmdList.SetComputeShader(ComputeShader->GetComputeShader());
+		SetShaderParameters(RHICmdList, *ComputeShader, ComputeShader->GetComputeShader(), Parameters);
+		RHICmdList.DispatchComputeShader(FMath::DivideAndRoundUp(Width / 4, RectifyGroupSize), FMath::DivideAndRoundUp(Height, RectifyGroupSize), 1);
+		UnsetShaderUAVs(RHICmdList, *ComputeShader, ComputeShader->GetComputeShader());
+		RHICmdList.TransitionResources(EResourceTransitionAccess::EReadable, EResourceTransitionPipeline::EComputeToGfx, UAVs, ARRAY_COUNT(UAVs));
+
+		// Into the target the readback copies from, the formats are the same
+		RHICmdList.CopyToResolveTarget(PackedTextures[i], Packed, FResolveParams());
+	}
+}
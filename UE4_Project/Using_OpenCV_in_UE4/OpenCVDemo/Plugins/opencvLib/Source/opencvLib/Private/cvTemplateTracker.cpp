@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvTemplateTracker.h"
+#include "opencv2/imgproc.hpp"
+
+// Pixels around the upsampled position searched on each finer level
+static const int RefineRadius = 2;
+
+void FcvTemplateTracker::Configure(int32 InLevels, float InMargin, float InConfidence)
+{
+	Levels = FMath::Clamp(InLevels, 0, 5);
+	Margin = FMath::Max(InMargin, 0.0f);
+	Confidence = InConfidence;
+}
+
+bool FcvTemplateTracker::SetTemplate(const cv::Mat& Gray, const cv::Rect& Box)
+{
+	Reset();
+	cv::Rect Clipped = Box & cv::Rect(0, 0, Gray.cols, Gray.rows);
+	if (Clipped.area() == 0)
+	{
+		return false;
+	}
+
+	Templates.push_back(Gray(Clipped).clone());
+	// A level needs a template of a few pixels to match anything
+	for (int32 i = 0; i < Levels && Templates.back().cols >= 16 && Templates.back().rows >= 16; i++)
+	{
+		cv::Mat Down;
+		cv::pyrDown(Templates.back(), Down);
+		Templates.push_back(Down);
+	}
+	LastBox = Clipped;
+	bHasPosition = true;
+	return true;
+}
+
+void FcvTemplateTracker::Reset()
+{
+	Templates.clear();
+	bHasPosition = false;
+}
+
+bool FcvTemplateTracker::Track(const cv::Mat& Gray, cv::Rect& OutBox, double& OutScore)
+{
+	OutBox = LastBox;
+	OutScore = 0.0;
+	if (!HasTemplate())
+	{
+		return false;
+	}
+
+	cv::Rect Frame(0, 0, Gray.cols, Gray.rows);
+	cv::Point Position;
+	double Score = -1.0;
+	if (bHasPosition)
+	{
+		int BorderX = (int)(LastBox.width * Margin) + RefineRadius;
+		int BorderY = (int)(LastBox.height * Margin) + RefineRadius;
+		cv::Rect Window(LastBox.x - BorderX, LastBox.y - BorderY, LastBox.width + 2 * BorderX, LastBox.height + 2 * BorderY);
+		Score = Search(Gray, Window & Frame, Position);
+	}
+	if (Score < Confidence)
+	{
+		// Lost or occluded, the whole frame costs as much as the untracked search used to
+		Score = Search(Gray, Frame, Position);
+	}
+
+	OutScore = Score;
+	bHasPosition = Score >= Confidence;
+	if (!bHasPosition)
+	{
+		return false;
+	}
+	LastBox = cv::Rect(Position, LastBox.size());
+	OutBox = LastBox;
+	return true;
+}
+
+double FcvTemplateTracker::Search(const cv::Mat& Gray, const cv::Rect& Region, cv::Point& OutPosition)
+{
+	const cv::Mat& Template = Templates[0];
+	if (Region.width < Template.cols || Region.height < Template.rows)
+	{
+		return -1.0;
+	}
+
+	// Only the region is downsampled, so the pyramid costs as much as the window
+	int32 Top = (int32)Templates.size() - 1;
+	Pyramid.resize(Templates.size());
+	Pyramid[0] = Gray(Region);
+	for (int32 i = 1; i <= Top; i++)
+	{
+		cv::pyrDown(Pyramid[i - 1], Pyramid[i]);
+	}
+	while (Top > 0 && (Pyramid[Top].cols < Templates[Top].cols || Pyramid[Top].rows < Templates[Top].rows))
+	{
+		Top--;
+	}
+
+	double Best = -1.0;
+	cv::Point Location;
+	cv::matchTemplate(Pyramid[Top], Templates[Top], Scores, cv::TM_CCOEFF_NORMED);
+	cv::minMaxLoc(Scores, nullptr, &Best, nullptr, &Location);
+
+	for (int32 Level = Top - 1; Level >= 0; Level--)
+	{
+		const cv::Mat& Image = Pyramid[Level];
+		const cv::Mat& LevelTemplate = Templates[Level];
+		cv::Rect Refine(Location.x * 2 - RefineRadius, Location.y * 2 - RefineRadius,
+			LevelTemplate.cols + 2 * RefineRadius, LevelTemplate.rows + 2 * RefineRadius);
+		Refine &= cv::Rect(0, 0, Image.cols, Image.rows);
+		if (Refine.width < LevelTemplate.cols || Refine.height < LevelTemplate.rows)
+		{
+			return -1.0;
+		}
+
+		cv::Point Offset;
+		cv::matchTemplate(Image(Refine), LevelTemplate, Scores, cv::TM_CCOEFF_NORMED);
+		cv::minMaxLoc(Scores, nullptr, &Best, nullptr, &Offset);
+		Location = Refine.tl() + Offset;
+	}
+
+	OutPosition = Region.tl() + Location;
+	return Best;
+}
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvVideoSink.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/FileManager.h"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+#include <map>
+
+FcvVideoSink::FcvVideoSink(const FString& InDirectory, double InFrameRate, int32 InQueueCapacity)
+	: Directory(TCHAR_TO_UTF8(*InDirectory))
+	, FrameRate(FMath::Max(InFrameRate, 1.0))
+	, Capacity(FMath::Max(InQueueCapacity, 1))
+	, Event(FPlatformProcess::GetSynchEventFromPool(false))
+{
+	IFileManager::Get().MakeDirectory(*InDirectory, true);
+	Thread = FRunnableThread::Create(this, TEXT("cvVideoSink"));
+}
+
+FcvVideoSink::~FcvVideoSink()
+{
+	if (Thread)
+	{
+		// Stop wakes the thread, which closes the videos on its way out
+		Thread->Kill(true);
+		delete Thread;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(Event);
+}
+
+bool FcvVideoSink::Write(const std::string& Stream, const cv::Mat& Image)
+{
+	return Push({ Stream, Image.clone(), cv::Mat() });
+}
+
+bool FcvVideoSink::WriteOverlay(const std::string& Stream, const cv::Mat& Image, const cv::Mat& Disparity8)
+{
+	return Push({ Stream, Image.clone(), Disparity8.clone() });
+}
+
+bool FcvVideoSink::Push(FItem&& Item)
+{
+	if (Item.Image.empty() || Count.GetValue() >= Capacity)
+	{
+		Dropped.Increment();
+		return false;
+	}
+	Queue.Enqueue(MoveTemp(Item));
+	Count.Increment();
+	Event->Trigger();
+	return true;
+}
+
+void FcvVideoSink::Stop()
+{
+	bStop = true;
+	Event->Trigger();
+}
+
+uint32 FcvVideoSink::Run()
+{
+	struct FStreamWriter
+	{
+		cv::VideoWriter Writer;
+		cv::Size Size;
+	};
+
+	// Opened on the first image of a stream, which fixes its size
+	std::map<std::string, FStreamWriter> Writers;
+	cv::Mat Color, Mapped;
+	while (!bStop)
+	{
+		FItem Item;
+		if (!Queue.Dequeue(Item))
+		{
+			Event->Wait(100);
+			continue;
+		}
+		Count.Decrement();
+
+		switch (Item.Image.channels())
+		{
+		case 4: cv::cvtColor(Item.Image, Color, cv::COLOR_BGRA2BGR); break;
+		case 1: cv::cvtColor(Item.Image, Color, cv::COLOR_GRAY2BGR); break;
+		default: Color = Item.Image; break;
+		}
+		if (!Item.Overlay.empty())
+		{
+			cv::applyColorMap(Item.Overlay, Mapped, cv::COLORMAP_JET);
+			cv::addWeighted(Color, 0.5, Mapped, 0.5, 0.0, Color);
+		}
+
+		FStreamWriter& Stream = Writers[Item.Stream];
+		if (!Stream.Writer.isOpened())
+		{
+			std::string Path = Directory + "/" + Item.Stream;
+			if (!Stream.Writer.open(Path + ".mp4", cv::VideoWriter::fourcc('H', '2', '6', '4'), FrameRate, Color.size())
+				&& !Stream.Writer.open(Path + ".avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), FrameRate, Color.size()))
+			{
+				continue;
+			}
+			Stream.Size = Color.size();
+		}
+		if (Color.size() == Stream.Size)
+		{
+			Stream.Writer.write(Color);
+		}
+	}
+	Writers.clear();
+	return 0;
+}
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "cvWebcamCapture.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
+#include "opencv2/imgproc.hpp"
+#include "cvStereoPipeline.h"
+
+// Grabs failing in a row before the camera is given up on, about a second at the retry interval
+static const int32 MaxGrabFailures = 100;
+
+FcvWebcamCapture::FcvWebcamCapture(int32 InDevice, int32 InWidth, int32 InHeight, double InFrameRate, int32 InRingSize)
+	: Device(InDevice)
+	, Width(InWidth)
+	, Height(InHeight)
+	, FrameRate(InFrameRate)
+	, RingSize(FMath::Max(InRingSize, 3))
+{
+	// Opening the device can take seconds, so that happens on the thread too
+	Thread = FRunnableThread::Create(this, TEXT("cvWebcamCapture"));
+}
+
+FcvWebcamCapture::~FcvWebcamCapture()
+{
+	if (Thread)
+	{
+		// Waits for the grab in progress, at most one frame
+		Thread->Kill(true);
+		delete Thread;
+	}
+}
+
+int32 FcvWebcamCapture::TakeLatest(const cv::Mat*& OutFrame, uint64& OutFrameNumber)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Latest == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+	int32 Slot = Latest;
+	Latest = INDEX_NONE;
+	Slots[Slot].State = ESlotState::Taken;
+	OutFrame = &Slots[Slot].Frame;
+	OutFrameNumber = Slots[Slot].FrameNumber;
+	return Slot;
+}
+
+void FcvWebcamCapture::Return(int32 Slot)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Slots.IsValidIndex(Slot))
+	{
+		Slots[Slot].State = ESlotState::Free;
+	}
+}
+
+uint32 FcvWebcamCapture::Run()
+{
+	if (!Capture.open(Device))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't open camera %d"), Device);
+		bFailed = true;
+		return 0;
+	}
+	if (Width > 0 && Height > 0)
+	{
+		Capture.set(cv::CAP_PROP_FRAME_WIDTH, Width);
+		Capture.set(cv::CAP_PROP_FRAME_HEIGHT, Height);
+	}
+	if (FrameRate > 0)
+	{
+		Capture.set(cv::CAP_PROP_FPS, FrameRate);
+	}
+
+	// The driver may not honour the request, the ring takes the size it settled on
+	int32 FrameWidth = (int32)Capture.get(cv::CAP_PROP_FRAME_WIDTH);
+	int32 FrameHeight = (int32)Capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+	{
+		FScopeLock ScopeLock(&Lock);
+		Slots.SetNum(RingSize);
+		for (FSlot& Slot : Slots)
+		{
+			Slot.Frame.create(FrameHeight, FrameWidth, CV_8UC4);
+		}
+	}
+	bOpen = true;
+
+	uint64 FrameNumber = 0;
+	int32 Failures = 0;
+	while (!bStop)
+	{
+		// Blocks until the camera has the next frame, retrieve then only decodes it
+		if (!Capture.grab())
+		{
+			if (++Failures >= MaxGrabFailures)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Camera %d stopped delivering frames"), Device);
+				bFailed = true;
+				break;
+			}
+			FPlatformProcess::Sleep(0.01f);
+			continue;
+		}
+		Failures = 0;
+		Grabbed.Increment();
+		FrameNumber++;
+
+		int32 WriteSlot = INDEX_NONE;
+		{
+			FScopeLock ScopeLock(&Lock);
+			for (int32 i = 0; i < Slots.Num(); i++)
+			{
+				if (Slots[i].State == ESlotState::Free)
+				{
+					WriteSlot = i;
+					Slots[i].State = ESlotState::Writing;
+					break;
+				}
+			}
+		}
+		if (WriteSlot == INDEX_NONE || !Capture.retrieve(Retrieved) || Retrieved.empty())
+		{
+			Dropped.Increment();
+			Return(WriteSlot);
+			continue;
+		}
+
+		// Into the slot's own memory, which only reallocates when the camera changes its size
+		cv::Mat& Frame = Slots[WriteSlot].Frame;
+		const void* Before = Frame.data;
+		switch (Retrieved.channels())
+		{
+		case 1: cv::cvtColor(Retrieved, Frame, cv::COLOR_GRAY2BGRA); break;
+		case 4: Retrieved.copyTo(Frame); break;
+		default: cv::cvtColor(Retrieved, Frame, cv::COLOR_BGR2BGRA); break;
+		}
+		if (Frame.data != Before)
+		{
+			GcvBufferAllocations.Increment();
+		}
+
+		FScopeLock ScopeLock(&Lock);
+		if (Latest != INDEX_NONE)
+		{
+			// Never taken, the game thread only wants the newest
+			Slots[Latest].State = ESlotState::Free;
+			Dropped.Increment();
+		}
+		Slots[WriteSlot].State = ESlotState::Ready;
+		Slots[WriteSlot].FrameNumber = FrameNumber;
+		Latest = WriteSlot;
+	}
+	Capture.release();
+	bOpen = false;
+	return 0;
+}
@@ -3,13 +3,12 @@
 #include "opencvLib.h"
 #include "Core.h"
 #include "Modules/ModuleManager.h"
-#include "Interfaces/IPluginManager.h"
 
 #define LOCTEXT_NAMESPACE "FopencvLibModule"
 
 void FopencvLibModule::StartupModule()
 {
-
+	// The GPU stereo shaders are registered by opencvLibShaders, which loads at PostConfigInit
 }
 
 void FopencvLibModule::ShutdownModule()
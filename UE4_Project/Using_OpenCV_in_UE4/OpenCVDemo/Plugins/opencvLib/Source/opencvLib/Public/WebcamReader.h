@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "cvWebcamCapture.h"
+#include "WebcamReader.generated.h"
+
+class UTexture2D;
+
+// Shows a camera in VideoTexture. FcvWebcamCapture grabs on its own thread, each tick the newest frame is
+// uploaded straight from its ring slot, which goes back to the capture once the render thread has copied it
+UCLASS()
+class OPENCVLIB_API AWebcamReader : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AWebcamReader();
+
+	// OpenCV's camera index
+	UPROPERTY(EditAnywhere, Category = Webcam, meta = (ClampMin = "0"))
+	int32 CameraIndex = 0;
+
+	// Requested from the driver, 0 keeps its default
+	UPROPERTY(EditAnywhere, Category = Webcam, meta = (ClampMin = "0"))
+	FIntPoint Resolution = FIntPoint(0, 0);
+
+	UPROPERTY(EditAnywhere, Category = Webcam, meta = (ClampMin = "0", ClampMax = "240"))
+	float FrameRate = 0.0f;
+
+	// Frames the capture can hold, the one being written, the newest and those still uploading
+	UPROPERTY(EditAnywhere, Category = Webcam, meta = (ClampMin = "3", ClampMax = "8"))
+	int32 RingSize = 4;
+
+	// BGRA, made with the camera's size once its first frame arrives
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient, Category = Webcam)
+	UTexture2D* VideoTexture = nullptr;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Webcam)
+	int32 GrabbedFrames = 0;
+
+	// Replaced before a tick took them or grabbed with no free slot
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Webcam)
+	int32 DroppedFrames = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Webcam)
+	int32 UploadedFrames = 0;
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	TUniquePtr<FcvWebcamCapture> Capture;
+	// One per ring slot, UpdateTextureRegions reads them on the render thread after the tick that queued them
+	TArray<FUpdateTextureRegion2D> UploadRegions;
+};
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/ArrayView.h"
+#include "cvRenderTargetReadback.h"
+
+class UTextureRenderTarget2D;
+class FTextureRenderTargetResource;
+class FcvStereoRectifier;
+
+// Reads back any number of capture targets. The targets come in groups that are always captured in the same frame,
+// a stereo rig for example, and each group is read back every CaptureInterval frames. Groups with the same interval
+// are spread over the frames in between, and all copies due in a frame go out in one render command
+class OPENCVLIB_API FcvCaptureManager
+{
+public:
+	~FcvCaptureManager();
+
+	// Before Initialize, returns the group index. A rectifier writing the targets runs before each of their copies
+	int32 AddGroup(const TArray<UTextureRenderTarget2D*>& Targets, int32 CaptureInterval, FcvStereoRectifier* Rectifier = nullptr);
+	// bAsync reads through FcvRenderTargetReadback rings, otherwise through ReadPixels on the game thread
+	bool Initialize(bool bAsync, int32 RingSize);
+	// Waits for the render commands using the readbacks
+	void Release();
+
+	// Once per frame, queues the copies of the groups that are due
+	void Capture();
+	// The pixels of all targets of a group once every one of them came back from the same frame, BGRA. They are
+	// exchanged with the arrays passed in, which are reused for later frames. False when the group has nothing
+	// new since the last call
+	bool GetLatest(int32 Group, TArrayView<TArray<FColor>*> OutPixels, uint64& OutFrame);
+
+	int32 GetGroupCount() const { return Groups.Num(); }
+	int32 GetWidth(int32 Group) const { return Groups[Group].Width; }
+	int32 GetHeight(int32 Group) const { return Groups[Group].Height; }
+
+private:
+	struct FGroup
+	{
+		TArray<UTextureRenderTarget2D*> Targets;
+		TArray<FTextureRenderTargetResource*> Resources;
+		TArray<TUniquePtr<FcvRenderTargetReadback>> Readbacks;
+		FcvStereoRectifier* Rectifier = nullptr;
+		// Newest pixels of each target and the frame they are from
+		TArray<TArray<FColor>> Pixels;
+		TArray<uint64> PixelFrames;
+		uint64 ProcessedFrame = 0;
+		int32 Interval = 1;
+		int32 Phase = 0;
+		int32 Width = 0;
+		int32 Height = 0;
+	};
+
+	TArray<FGroup> Groups;
+	bool bAsyncReadback = true;
+	bool bInitialized = false;
+	uint64 FrameCounter = 0;
+};
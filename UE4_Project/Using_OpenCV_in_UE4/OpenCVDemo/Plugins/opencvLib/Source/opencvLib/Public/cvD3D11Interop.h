@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHIResources.h"
+
+class UTextureRenderTarget2D;
+class FTextureRenderTargetResource;
+class FcvStereoPipeline;
+
+// Hands the stereo captures to the pipeline as UMats through OpenCL's D3D11 sharing, the pixels never go
+// through the CPU. One fence follows the rigs captured in a frame, and once it has passed the render thread
+// copies their targets into pipeline frames on the device, so the interop acquire has nothing left to wait for.
+// Any D3D11 texture that ends up in a UE render target works the same, DXRender's Displayer output included.
+// Needs the D3D11 RHI, 8 bit RGBA or BGRA targets and an OpenCL device that shares with UE's D3D11 device
+class OPENCVLIB_API FcvD3D11Capture
+{
+public:
+	~FcvD3D11Capture();
+
+	// Makes OpenCV's default OpenCL context one created from UE's D3D11 device, call before any UMat exists.
+	// Once per process, false when the RHI isn't D3D11 or OpenCL can't share with it
+	static bool InitializeContext();
+
+	// Before Initialize, returns the group index. Groups are read every CaptureInterval frames as in FcvCaptureManager
+	int32 AddGroup(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, int32 CaptureInterval);
+	// Checks the targets, false when a group can't be shared
+	bool Initialize();
+	// The pipeline the frames go to, from the render thread. Frames of ReprojectGroup are reprojected
+	void Start(FcvStereoPipeline* InPipeline, int32 InReprojectGroup);
+	// Waits for the render commands using this object
+	void Release();
+
+	// Once per frame, copies the groups whose fence passed and fences the groups that are due
+	void Capture();
+
+	int32 GetGroupCount() const { return Groups.Num(); }
+	int32 GetWidth(int32 Group) const { return Groups[Group].Width; }
+	int32 GetHeight(int32 Group) const { return Groups[Group].Height; }
+
+private:
+	struct FGroup
+	{
+		UTextureRenderTarget2D* Left = nullptr;
+		UTextureRenderTarget2D* Right = nullptr;
+		FTextureRenderTargetResource* LeftResource = nullptr;
+		FTextureRenderTargetResource* RightResource = nullptr;
+		bool bRGBA = false;
+		int32 Interval = 1;
+		int32 Phase = 0;
+		int32 Width = 0;
+		int32 Height = 0;
+		// Render thread only, shared by the groups fenced in the same frame
+		FGPUFenceRHIRef Fence;
+		uint64 FenceFrame = 0;
+	};
+
+	// Render thread only
+	void CaptureRenderThread(FRHICommandListImmediate& RHICmdList, const TArray<int32>& Due, uint64 Frame);
+	void CopyGroup(int32 GroupIndex);
+
+	TArray<FGroup> Groups;
+	FcvStereoPipeline* Pipeline = nullptr;
+	int32 ReprojectGroup = INDEX_NONE;
+	bool bInitialized = false;
+	uint64 FrameCounter = 0;
+};
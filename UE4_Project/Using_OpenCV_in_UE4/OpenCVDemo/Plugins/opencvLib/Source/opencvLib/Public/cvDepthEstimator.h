@@ -33,8 +33,70 @@
 #include "Runtime/Engine/Public/SceneInterface.h"
 #include "Runtime/Engine/Classes/Components/LightComponent.h"
 #include "Runtime/Engine/Classes/Engine/SceneCapture2D.h"
+#include "cvCaptureManager.h"
+#include "cvStereoPipeline.h"
+#include "cvGPUStereo.h"
+#include "cvD3D11Interop.h"
+#include "cvStereoRectifier.h"
+#include "cvVideoSink.h"
+#include "cvTemplateTracker.h"
+#include "cvPointCloudComponent.h"
 #include "cvDepthEstimator.generated.h"
 
+UENUM(BlueprintType)
+enum class EcvStereoBackend : uint8
+{
+	CPU,
+	// OpenCV's T-API, the images stay in UMats on the OpenCL device from the upload to the 8 bit disparity
+	OpenCL,
+};
+
+UENUM(BlueprintType)
+enum class EcvDebugOutput : uint8
+{
+	// HighGUI windows, blocks the game thread on their messages
+	Window,
+	// Encoded into videos on a background thread, see FcvVideoSink
+	Video,
+	None,
+};
+
+// Two rectified captures and optionally the ground truth depth, read back and matched together
+USTRUCT(BlueprintType)
+struct FcvStereoRig
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = Webcam)
+	UTextureRenderTarget2D* Left = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = Webcam)
+	UTextureRenderTarget2D* Right = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = Webcam)
+	UTextureRenderTarget2D* Depth = nullptr;
+
+	// Stereo calibration of a real rig, see FcvStereoRectifier::LoadCalibration. The captures are then
+	// undistorted and rectified on the GPU and only their gray is read back; Depth isn't read
+	UPROPERTY(EditAnywhere, Category = Webcam, meta = (FilePathFilter = "yml"))
+	FFilePath Calibration;
+
+	// Packed rectified gray, made at BeginPlay when Calibration is set
+	UPROPERTY(VisibleAnywhere, Transient, Category = Webcam)
+	UTextureRenderTarget2D* RectifiedLeft = nullptr;
+
+	UPROPERTY(VisibleAnywhere, Transient, Category = Webcam)
+	UTextureRenderTarget2D* RectifiedRight = nullptr;
+
+	// Read back every this many frames, the rigs with the same interval take turns
+	UPROPERTY(EditAnywhere, Category = Webcam, meta = (ClampMin = "1", ClampMax = "60"))
+	int32 CaptureInterval = 1;
+
+	// Disparity of the newest finished frame, 8 bit
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Transient, Category = Webcam)
+	UTexture2D* DisparityTexture = nullptr;
+};
+
 
 UCLASS()
 class OPENCVLIB_API AcvDepthEstimator : public AActor
@@ -48,6 +110,15 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// Reads back the rigs due this frame and hands the complete ones to the pipeline
+	void SubmitFrames();
+	// Shows the newest frame the pipeline finished for each rig and uploads its disparity
+	void PublishResults();
+	// Follows the selected template in the viewport
+	void TrackViewport();
+	// Sends a debug image to the current DebugOutput
+	void ShowImage(const std::string& Name, const cv::Mat& Image, const cv::Mat& Overlay = cv::Mat());
 
 public:	
 	// Called every frame
@@ -68,7 +139,7 @@ public:
 
 	//cv dual camera
 	//**************************************
-	int blockSize = 2, uniquenessRatio = 0, numDisparities = 0;
+	int blockSize = 2, uniquenessRatio = 0;
 	cv::Ptr<cv::StereoBM> bm = cv::StereoBM::create(9, 9);
 	cv::Mat disp, disp8, grayImageL, grayImageR;
 
@@ -83,14 +154,11 @@ public:
 
 	//read from gamethread rendertarget
 	//*************************************
-	TArray<FColor> ImageData_1, ImageData_2, ImageData_3;
-
-	FTextureRenderTargetResource* RenderTarget_1;
-	FTextureRenderTargetResource* RenderTarget_2;
-	FTextureRenderTargetResource* RenderTarget_3;
-
-	int32 TargetX_1, TargetY_1, TargetX_2, TargetY_2, TargetX_3, TargetY_3;
+	// Any number of camera pairs, all of them share the readback batching and the stereo workers
+	UPROPERTY(Editanywhere, Category = Webcam)
+	TArray<FcvStereoRig> StereoRigs;
 
+	// SceneCapture_1 to 3 are the left, right and depth target of the only rig when StereoRigs is empty
 	UPROPERTY(Editanywhere,  Category = Webcam)
 	UTextureRenderTarget2D *SceneCapture_1;
 
@@ -100,10 +168,130 @@ public:
 	UPROPERTY(Editanywhere, Category = Webcam)
 	UTextureRenderTarget2D *SceneCapture_3;
 
+	// Read the captures back through a ring of staging textures instead of ReadPixels, which flushes the
+	// render thread. The CV then runs on frames one or two ticks old
+	UPROPERTY(Editanywhere, Category = Webcam)
+	bool bAsyncReadback = true;
+
+	UPROPERTY(Editanywhere, Category = Webcam, meta = (ClampMin = "2", ClampMax = "4"))
+	int32 ReadbackRingSize = 3;
+
+	TUniquePtr<FcvCaptureManager> CaptureManager;
+
+	// Per rig, null for the rigs without a calibration
+	TArray<TUniquePtr<FcvStereoRectifier>> Rectifiers;
+
+	// Hand the left and right captures to OpenCL through D3D11 sharing instead of reading them back, the
+	// stereo then runs on the OpenCL backend without the images ever reaching the CPU. Needs the D3D11 RHI
+	// and 8 bit targets, falls back to the readback otherwise. No depth image or source debug images
+	UPROPERTY(Editanywhere, Category = Webcam)
+	bool bD3D11Interop = false;
+
+	TUniquePtr<FcvD3D11Capture> D3D11Capture;
+
+	// Falls back to the CPU when no OpenCL device is available
+	UPROPERTY(Editanywhere, Category = Stereo)
+	EcvStereoBackend StereoBackend = EcvStereoBackend::CPU;
+
+	// Disparity search range in pixels, rounded up to a multiple of 16
+	UPROPERTY(Editanywhere, Category = Stereo, meta = (ClampMin = "16", ClampMax = "256"))
+	int32 NumDisparities = 16;
+
+	// Frames per rig each pipeline stage may hold before new ones are dropped
+	UPROPERTY(Editanywhere, Category = Webcam, meta = (ClampMin = "1", ClampMax = "8"))
+	int32 PipelineQueueCapacity = 2;
+
+	// Threads running the stereo matching for all rigs
+	UPROPERTY(Editanywhere, Category = Stereo, meta = (ClampMin = "1", ClampMax = "16"))
+	int32 StereoWorkers = 2;
+
+	TUniquePtr<FcvStereoPipeline> StereoPipeline;
+
+	// Block matching in a compute shader straight on the first rig's targets, nothing but the error against
+	// its depth target comes back to the CPU. Expects a rectified pair and the scene depth in cm
+	UPROPERTY(Editanywhere, Category = Stereo)
+	bool bGPUStereo = false;
+
+	// Distance between the two capture components in cm
+	UPROPERTY(Editanywhere, Category = Stereo, meta = (editcondition = "bGPUStereo"))
+	float StereoBaseline = 10.0f;
+
+	// Horizontal field of view of the capture components
+	UPROPERTY(Editanywhere, Category = Stereo, meta = (editcondition = "bGPUStereo", ClampMin = "1", ClampMax = "170"))
+	float CaptureFOV = 90.0f;
+
+	// Relative depth error above which a pixel counts as bad
+	UPROPERTY(Editanywhere, Category = Stereo, meta = (editcondition = "bGPUStereo", ClampMin = "0"))
+	float BadPixelThreshold = 0.05f;
+
+	// Disparity in pixels, R32F
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stereo)
+	UTextureRenderTarget2D* DisparityTarget = nullptr;
+
+	// Of the newest frame read back, a few frames behind
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stereo)
+	float MeanDepthErrorCm = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stereo)
+	float BadPixelRatio = 0.0f;
+
+	TUniquePtr<FcvGPUStereo> GPUStereo;
+
+	// Reproject the first rig's disparity into points on the postprocess thread and draw them with PointCloud,
+	// place the actor at that rig's left camera
+	UPROPERTY(Editanywhere, Category = PointCloud)
+	bool bPointCloud = false;
+
+	// Row major disparity to depth matrix from stereoRectify. When empty the first rig's calibration gives it,
+	// in the calibration's units, and without one it is built from StereoBaseline and CaptureFOV
+	UPROPERTY(Editanywhere, Category = PointCloud, meta = (editcondition = "bPointCloud"))
+	TArray<float> CalibrationQ;
+
+	UPROPERTY(Editanywhere, Category = PointCloud, meta = (editcondition = "bPointCloud", ClampMin = "0.1"))
+	float PointCloudVoxelSize = 5.0f;
+
+	UPROPERTY(Editanywhere, Category = PointCloud, meta = (editcondition = "bPointCloud", ClampMin = "1"))
+	float PointCloudMaxDepth = 2000.0f;
+
+	UPROPERTY(Editanywhere, Category = PointCloud, meta = (editcondition = "bPointCloud", ClampMin = "1"))
+	int32 PointCloudMaxPoints = 65536;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = PointCloud)
+	UcvPointCloudComponent* PointCloud;
+
+	// Buffers the stereo path allocated or grew, zero per frame in the steady state when DebugOutput is None.
+	// The windows and the video copies allocate on their own
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Debug)
+	int32 BufferAllocationsLastFrame = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Debug)
+	int32 BufferAllocations = 0;
+
+	// Where the source, disparity and overlay images go
+	UPROPERTY(Editanywhere, Category = Debug)
+	EcvDebugOutput DebugOutput = EcvDebugOutput::Window;
+
+	// Saved/cvDebug when empty
+	UPROPERTY(Editanywhere, Category = Debug)
+	FString VideoDirectory;
+
+	UPROPERTY(Editanywhere, Category = Debug, meta = (ClampMin = "1", ClampMax = "120"))
+	float VideoFrameRate = 30.0f;
+
+	// Images waiting for the encoder before new ones are dropped
+	UPROPERTY(Editanywhere, Category = Debug, meta = (ClampMin = "1", ClampMax = "64"))
+	int32 VideoQueueCapacity = 8;
+
+	// Switching away from Video closes the files
+	UFUNCTION(BlueprintCallable, Category = Debug)
+	void SetDebugOutput(EcvDebugOutput Output);
+
+	TUniquePtr<FcvVideoSink> VideoSink;
+
 
 	//read from viewport
 	//****************************
-	FViewport* myviewport;
+	FViewport* myviewport = nullptr;
 	int32 viewportX, viewportY;
 	TArray<FColor> ViewportImage;
 	cv::Mat viewportframe,Model, similarity,showsimilarity,temp;
@@ -113,9 +301,34 @@ public:
 
 	FIntPoint MouseIni,MouseCur,MouseFinal;
 
+	// Template levels below the full resolution one
+	UPROPERTY(Editanywhere, Category = Tracking, meta = (ClampMin = "0", ClampMax = "5"))
+	int32 TrackingPyramidLevels = 2;
+
+	// Border of the search window around the last position, in template sizes
+	UPROPERTY(Editanywhere, Category = Tracking, meta = (ClampMin = "0"))
+	float TrackingSearchMargin = 0.5f;
+
+	// Normalized correlation below which the whole viewport is searched
+	UPROPERTY(Editanywhere, Category = Tracking, meta = (ClampMin = "-1", ClampMax = "1"))
+	float TrackingConfidence = 0.7f;
+
+	// Viewport pixels of the template's top left corner
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Tracking)
+	FVector2D TrackedPosition;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Tracking)
+	float TrackingScore = 0.0f;
+
+	FcvTemplateTracker Tracker;
+
 public:
-	//void OnMouseClickedBegin();
-	//void OnMouseClickedEnd();
+	// The template is the viewport box between the mouse positions of the two calls
+	UFUNCTION(BlueprintCallable, Category = Tracking)
+	void OnMouseClickedBegin();
+
+	UFUNCTION(BlueprintCallable, Category = Tracking)
+	void OnMouseClickedEnd();
 
 	bool isClicked = false,bBeginTrack = false;
 
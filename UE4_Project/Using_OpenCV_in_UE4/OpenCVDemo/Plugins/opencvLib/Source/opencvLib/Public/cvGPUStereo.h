@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHIResources.h"
+#include "HAL/CriticalSection.h"
+
+class UTextureRenderTarget2D;
+class FTextureRenderTargetResource;
+class FRHIGPUBufferReadback;
+
+// Depth error of one GPU stereo frame against the ground truth capture
+struct FcvStereoErrors
+{
+	uint64 Frame = 0;
+	int32 ValidPixels = 0;
+	int32 BadPixels = 0;
+	int32 UnmatchedPixels = 0;
+	float MeanAbsErrorCm = 0.0f;
+};
+
+// Block matching of two render targets in a compute shader (Shaders/Private/cvStereoMatch.usf). The disparity
+// stays on the GPU in a render target, only the error totals against the depth capture are read back,
+// through a small ring so the render thread never waits for them either
+class OPENCVLIB_API FcvGPUStereo
+{
+public:
+	~FcvGPUStereo();
+
+	// Disparity is written in pixels and needs a PF_R32_FLOAT target of the same size as the captures.
+	// FocalBaseline is the focal length in pixels times the baseline in cm
+	bool Initialize(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, UTextureRenderTarget2D* Depth, UTextureRenderTarget2D* Disparity,
+		int32 InNumDisparities, float InFocalBaseline, float InBadPixelThreshold);
+	// Waits for the render commands using this object, call before it is destroyed
+	void Release();
+	// Queues this frame's matching, a full error ring skips the frame
+	void Dispatch();
+	// The newest errors read back since the last call
+	bool GetLatestErrors(FcvStereoErrors& OutErrors);
+
+private:
+	static const int32 ErrorRingSize = 3;
+
+	struct FErrorSlot
+	{
+		FVertexBufferRHIRef Buffer;
+		FUnorderedAccessViewRHIRef UAV;
+		TUniquePtr<FRHIGPUBufferReadback> Readback;
+		uint64 Frame = 0;
+		bool bPending = false;
+	};
+
+	// Render thread only
+	bool CreateResources();
+	void DispatchRenderThread(FRHICommandListImmediate& RHICmdList, uint64 Frame);
+	void ReadErrors();
+
+	FTextureRenderTargetResource* LeftResource = nullptr;
+	FTextureRenderTargetResource* RightResource = nullptr;
+	FTextureRenderTargetResource* DepthResource = nullptr;
+	FTextureRenderTargetResource* DisparityResource = nullptr;
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumDisparities = 16;
+	float FocalBaseline = 0.0f;
+	float BadPixelThreshold = 0.05f;
+	uint64 FrameCounter = 0;
+
+	// Render thread only
+	FTexture2DRHIRef DisparityTexture;
+	FUnorderedAccessViewRHIRef DisparityUAV;
+	FErrorSlot Slots[ErrorRingSize];
+	int32 WriteIndex = 0;
+
+	FCriticalSection LatestLock;
+	FcvStereoErrors LatestErrors;
+	bool bHasLatest = false;
+};
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "cvPointCloudComponent.generated.h"
+
+// Draws a point cloud in component space. New points are moved to the scene proxy by a render command,
+// the render thread draws the last set while the next one is being filled, no objects are created per update
+UCLASS(ClassGroup = (Rendering), meta = (BlueprintSpawnableComponent))
+class OPENCVLIB_API UcvPointCloudComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UcvPointCloudComponent();
+
+	// Screen pixels
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = PointCloud, meta = (ClampMin = "1"))
+	float PointSize = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = PointCloud)
+	FLinearColor PointColor = FLinearColor::Green;
+
+	// Fixed, so new points never update the bounds
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = PointCloud)
+	float BoundsRadius = 5000.0f;
+
+	// Replaces the drawn points, the array is taken over
+	void SetPoints(TArray<FVector>&& InPoints);
+	// Replaces the drawn points with a copy made on the render thread into a buffer that only grows. The array
+	// has to stay unchanged until the render commands queued after this call ran
+	void CopyPoints(const TArray<FVector>& InPoints);
+
+	UFUNCTION(BlueprintPure, Category = PointCloud)
+	int32 GetPointCount() const { return PointCount; }
+
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+
+private:
+	int32 PointCount = 0;
+};
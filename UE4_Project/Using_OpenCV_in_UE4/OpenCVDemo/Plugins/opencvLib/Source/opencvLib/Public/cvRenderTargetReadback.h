@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "HAL/CriticalSection.h"
+
+class UTextureRenderTarget2D;
+class FTextureRenderTargetResource;
+
+// Copies a render target into a small ring of CPU readable textures on the render thread. A copy is mapped
+// once its fence has passed, usually one or two frames later, and only the newest finished copy is kept.
+// The game thread picks that frame up without waiting on the render thread or the GPU
+class OPENCVLIB_API FcvRenderTargetReadback
+{
+public:
+	~FcvRenderTargetReadback();
+
+	// False for targets that are not 8 bit or half float RGBA, those need ReadPixels
+	bool Initialize(UTextureRenderTarget2D* Target, int32 RingSize);
+	// Waits for the render commands using this readback, call before it is destroyed
+	void Release();
+	// Queues this frame's copy, a full ring skips the frame
+	void Enqueue();
+	// The copy itself, for callers batching several readbacks into one render command
+	void CopyRenderThread(FRHICommandListImmediate& RHICmdList, uint64 Frame);
+	// Takes the newest frame that came back since the last call, BGRA as ReadPixels returns it
+	bool GetLatest(TArray<FColor>& OutPixels, uint64& OutFrame);
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+private:
+	struct FSlot
+	{
+		FTexture2DRHIRef Staging;
+		FGPUFenceRHIRef Fence;
+		uint64 Frame = 0;
+	};
+
+	// Render thread only
+	void MapFinished(FRHICommandListImmediate& RHICmdList);
+
+	FTextureRenderTargetResource* Resource = nullptr;
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 RingSize = 0;
+	uint64 FrameCounter = 0;
+
+	// Render thread only
+	TArray<FSlot> Slots;
+	int32 WriteIndex = 0;
+	int32 PendingCount = 0;
+
+	// Handed over from the render thread
+	FCriticalSection LatestLock;
+	TArray<FColor> LatestPixels;
+	uint64 LatestFrame = 0;
+	bool bHasLatest = false;
+};
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/CriticalSection.h"
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/core/ocl.hpp"
+
+class FRunnableThread;
+class FEvent;
+
+// Buffers the stereo path had to allocate or grow, frames, pixel arrays and mats. Stays put in the steady state
+extern OPENCVLIB_API FThreadSafeCounter GcvBufferAllocations;
+
+// One stereo frame on its way through the pipeline, each stage fills in its part. Frames come from
+// FcvFramePool with all of their buffers allocated, and go back to it, so the stages only ever write into them
+struct FcvStereoFrame
+{
+	uint64 Frame = 0;
+	// The stereo rig the images come from
+	int32 Rig = 0;
+	int32 Width = 0;
+	int32 Height = 0;
+	// Readback, BGRA
+	TArray<FColor> Left, Right, Depth;
+	// Left and Right hold rectified gray from FcvStereoRectifier, four pixels to an FColor. LeftImage and
+	// RightImage are then CV_8UC1 headers on them and are matched as they are
+	bool bPackedGray = false;
+	// Convert, the images are CV_8UC4 headers on the arrays above and share their memory
+	cv::Mat LeftImage, RightImage, DepthImage, GrayL, GrayR;
+	// Stereo
+	cv::Mat Disparity;
+	// Postprocess
+	cv::Mat Disparity8;
+	// Reprojected and voxel decimated, in cm in UE axes relative to the left camera. Only when bReproject is set
+	bool bReproject = false;
+	TArray<FVector> Points;
+	// The OpenCL backend's images, only the 8 bit disparity comes back into Disparity8
+	cv::UMat GrayLDevice, GrayRDevice, DisparityDevice, Disparity8Device;
+	// Set when FcvD3D11Capture copied the captures into LeftDevice and RightDevice. The arrays and the images
+	// on them are then left empty
+	bool bDeviceSource = false;
+	bool bSourceRGBA = false;
+	cv::UMat LeftDevice, RightDevice;
+
+	// Every buffer at its final size, the mats through OpenCV's aligned allocator
+	void Allocate(int32 InWidth, int32 InHeight, int32 MaxPoints, bool bDevice);
+	// Counts the buffers whose memory differs from the snapshot into GcvBufferAllocations
+	void SnapshotBuffers(const void* OutBuffers[12]) const;
+	void CountAllocations(const void* const Buffers[12]) const;
+};
+
+// The frames of one rig, taken and given back from any thread
+class FcvFramePool
+{
+public:
+	FcvFramePool(int32 Rig, int32 Width, int32 Height, int32 Count, int32 MaxPoints, bool bDevice);
+
+	// Null when all frames are in flight
+	TUniquePtr<FcvStereoFrame> Acquire();
+	void Recycle(TUniquePtr<FcvStereoFrame> Frame);
+
+private:
+	FCriticalSection Lock;
+	TArray<TUniquePtr<FcvStereoFrame>> Free;
+};
+
+// Reprojection of the disparity into points, see cv::reprojectImageTo3D
+struct FcvPointCloudSettings
+{
+	// 4x4 CV_64F disparity to depth matrix, its units are the points' units
+	cv::Mat Q;
+	// Points in the same voxel are averaged into one
+	float VoxelSize = 5.0f;
+	float MaxDepth = 2000.0f;
+	int32 MaxPoints = 65536;
+};
+
+// Any number of producers and consumers, a push into a full queue drops the frame. A ring of fixed size,
+// so pushing never allocates
+class FcvFrameQueue
+{
+public:
+	FcvFrameQueue(int32 InCapacity);
+	~FcvFrameQueue();
+
+	bool Push(TUniquePtr<FcvStereoFrame>& Frame);
+	bool Pop(TUniquePtr<FcvStereoFrame>& OutFrame);
+	// Wakes the consumer, also on shutdown
+	void Trigger();
+	void Wait(uint32 WaitMs);
+
+private:
+	FCriticalSection Lock;
+	TArray<TUniquePtr<FcvStereoFrame>> Ring;
+	int32 Head = 0;
+	int32 Count = 0;
+	FEvent* Event;
+};
+
+// Convert, stereo and postprocess run on their own threads, connected by FcvFrameQueue. The game thread
+// submits the read back images and picks up finished frames, so its frame rate no longer depends on the CV cost.
+// All stereo rigs share one pipeline, the stereo stage, which does most of the work, has a pool of workers
+// with a matcher each. Under load the frames are dropped at the first full queue
+class OPENCVLIB_API FcvStereoPipeline
+{
+public:
+	// The stereo workers take copies of the matcher's settings. InNumDisparities is the search range in pixels
+	FcvStereoPipeline(cv::Ptr<cv::StereoBM> InMatcher, int32 InNumDisparities, int32 QueueCapacity, int32 StereoWorkers, bool bInUseOpenCL);
+	~FcvStereoPipeline();
+
+	// Frames for a rig of this size, only call before the first Submit
+	void AddFramePool(int32 Rig, int32 Width, int32 Height, int32 Count, int32 MaxPoints);
+	// Null when the rig has no pool or all of its frames are in flight
+	TUniquePtr<FcvStereoFrame> AcquireFrame(int32 Rig);
+	// From any thread, frames of rigs without a pool are deleted
+	void Recycle(TUniquePtr<FcvStereoFrame> Frame);
+
+	// False when the frame was dropped
+	bool Submit(TUniquePtr<FcvStereoFrame> Frame);
+	// The newest finished frame of a rig, older finished ones are dropped. Null when none finished since the last call
+	TUniquePtr<FcvStereoFrame> GetLatest(int32 Rig);
+	int32 GetDroppedCount() const { return Dropped.GetValue(); }
+	// Used for the frames with bReproject, only call before the first Submit
+	void SetPointCloud(const FcvPointCloudSettings& Settings) { PointCloud = Settings; }
+
+private:
+	class FStage : public FRunnable
+	{
+	public:
+		FStage(FcvStereoPipeline& InPipeline, FcvFrameQueue& InInput, FcvFrameQueue& InOutput, TFunction<void(FcvStereoFrame&)> InWork);
+		virtual uint32 Run() override;
+		virtual void Stop() override { bStop = true; Input.Trigger(); }
+
+	private:
+		FcvStereoPipeline& Pipeline;
+		FcvFrameQueue& Input;
+		FcvFrameQueue& Output;
+		TFunction<void(FcvStereoFrame&)> Work;
+		FThreadSafeBool bStop;
+	};
+
+	void Convert(FcvStereoFrame& Frame);
+	void Match(FcvStereoFrame& Frame, cv::StereoBM& Matcher);
+	void Postprocess(FcvStereoFrame& Frame);
+	void Reproject(FcvStereoFrame& Frame);
+
+	// One per stereo worker, StereoBM keeps per call buffers
+	TArray<cv::Ptr<cv::StereoBM>> Matchers;
+	int32 NumDisparities;
+	bool bUseOpenCL;
+	FThreadSafeCounter Dropped;
+
+	FcvFrameQueue ConvertQueue, StereoQueue, PostprocessQueue, ResultQueue;
+	TArray<TUniquePtr<FStage>> Stages;
+	TArray<FRunnableThread*> Threads;
+	TArray<TUniquePtr<FcvFramePool>> FramePools;
+
+	// Postprocess thread, kept between frames
+	FcvPointCloudSettings PointCloud;
+	cv::Mat DisparityFloat, Points3D;
+	TMap<FIntVector, int32> VoxelIndex;
+	TArray<FVector4> Voxels;
+
+	// Game thread, drained from the result queue
+	TArray<TUniquePtr<FcvStereoFrame>> LatestResults;
+};
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHIResources.h"
+#include "opencv2/core.hpp"
+
+class UTextureRenderTarget2D;
+class FTextureRenderTargetResource;
+
+// Undistorts and rectifies a calibrated stereo pair on the GPU before it is read back. The maps of
+// cv::initUndistortRectifyMap are built once in the fixed point form, CV_16SC2 coordinates and CV_16UC1
+// interpolation indices, and uploaded as textures. A compute shader (Shaders/Private/cvRectify.usf) remaps
+// both captures, converts them to gray and packs four pixels to a texel, so only one byte per pixel is read back
+class OPENCVLIB_API FcvStereoRectifier
+{
+public:
+	~FcvStereoRectifier();
+
+	// cv::FileStorage file with M1 D1 M2 D2 R T as stereoCalibrate gives them, for captures of Width by Height.
+	// R1 R2 P1 P2 Q are taken from the file when present, otherwise stereoRectify computes them
+	bool LoadCalibration(const FString& Path, int32 InWidth, int32 InHeight);
+	// The packed targets are PF_R8G8B8A8, a quarter of the capture width, see CreatePackedTarget
+	bool Initialize(UTextureRenderTarget2D* Left, UTextureRenderTarget2D* Right, UTextureRenderTarget2D* PackedLeft, UTextureRenderTarget2D* PackedRight);
+	// Waits for the render commands using this object
+	void Release();
+	// Render thread, writes the packed targets from the current captures
+	void RectifyRenderThread(FRHICommandListImmediate& RHICmdList);
+
+	// A target the packed gray of a capture of this size fits in, false when the width isn't a multiple of 4
+	static UTextureRenderTarget2D* CreatePackedTarget(UObject* Outer, int32 CaptureWidth, int32 CaptureHeight);
+
+	// Disparity to depth matrix of the rectified pair, 4x4 CV_64F in the units of the calibration's T
+	const cv::Mat& GetQ() const { return Q; }
+
+private:
+	// Render thread only
+	bool CreateResources();
+
+	int32 Width = 0;
+	int32 Height = 0;
+	// Kept until they are uploaded
+	cv::Mat Maps[2], Fractions[2];
+	cv::Mat Q;
+
+	FTextureRenderTargetResource* Sources[2] = {};
+	FTextureRenderTargetResource* PackedTargets[2] = {};
+
+	// Render thread only
+	FTexture2DRHIRef MapTextures[2], FractionTextures[2];
+	FTexture2DRHIRef PackedTextures[2];
+	FUnorderedAccessViewRHIRef PackedUAVs[2];
+};
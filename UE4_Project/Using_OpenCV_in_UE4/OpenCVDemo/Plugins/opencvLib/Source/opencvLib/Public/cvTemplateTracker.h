@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "opencv2/core.hpp"
+
+// Follows a template from frame to frame. Each frame is only searched in a window around the last position,
+// first on the coarsest level of an image pyramid and then refined a few pixels per finer level. A match
+// below the confidence threshold falls back to the same coarse to fine search over the whole frame
+class OPENCVLIB_API FcvTemplateTracker
+{
+public:
+	// Levels below the full resolution one, Margin is the search window's border in template sizes
+	void Configure(int32 InLevels, float InMargin, float InConfidence);
+	// Gray image, the template is cut out of it
+	bool SetTemplate(const cv::Mat& Gray, const cv::Rect& Box);
+	void Reset();
+	// False when neither the windowed nor the full search found the template, the box keeps the last position
+	bool Track(const cv::Mat& Gray, cv::Rect& OutBox, double& OutScore);
+
+	bool HasTemplate() const { return Templates.size() > 0; }
+
+private:
+	// Coarse to fine search of Region, returns the full resolution position of the best match
+	double Search(const cv::Mat& Gray, const cv::Rect& Region, cv::Point& OutPosition);
+
+	std::vector<cv::Mat> Templates;
+	cv::Rect LastBox;
+	bool bHasPosition = false;
+	int32 Levels = 2;
+	float Margin = 0.5f;
+	float Confidence = 0.7f;
+
+	// Reused between frames
+	std::vector<cv::Mat> Pyramid;
+	cv::Mat Scores;
+};
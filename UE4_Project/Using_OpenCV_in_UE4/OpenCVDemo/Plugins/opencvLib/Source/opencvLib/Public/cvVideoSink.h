@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeBool.h"
+#include "opencv2/core.hpp"
+#include <string>
+
+class FRunnableThread;
+class FEvent;
+
+// Encodes debug images into one video per stream name on its own thread, instead of showing them in HighGUI
+// windows. The game thread only copies the images in, when the encoder falls behind the new ones are dropped
+class OPENCVLIB_API FcvVideoSink : public FRunnable
+{
+public:
+	// Stream videos go to <Directory>/<stream>.mp4, H.264 when the codec is available, MJPEG in an .avi otherwise
+	FcvVideoSink(const FString& InDirectory, double InFrameRate, int32 InQueueCapacity);
+	~FcvVideoSink();
+
+	// BGRA, BGR or gray, false when the frame was dropped
+	bool Write(const std::string& Stream, const cv::Mat& Image);
+	// The 8 bit disparity color mapped over the image, blended on the encoder thread
+	bool WriteOverlay(const std::string& Stream, const cv::Mat& Image, const cv::Mat& Disparity8);
+	int32 GetDroppedCount() const { return Dropped.GetValue(); }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FItem
+	{
+		std::string Stream;
+		cv::Mat Image;
+		cv::Mat Overlay;
+	};
+
+	bool Push(FItem&& Item);
+
+	std::string Directory;
+	double FrameRate;
+	int32 Capacity;
+
+	TQueue<FItem, EQueueMode::Spsc> Queue;
+	FThreadSafeCounter Count;
+	FThreadSafeCounter Dropped;
+	FThreadSafeBool bStop;
+	FEvent* Event = nullptr;
+	FRunnableThread* Thread = nullptr;
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/CriticalSection.h"
+#include "opencv2/core.hpp"
+#include "opencv2/videoio.hpp"
+
+class FRunnableThread;
+
+// Grabs a camera on its own thread into a ring of BGRA frames allocated once the camera is open, so the game
+// thread never blocks at the camera's rate. Only the newest frame is delivered, a frame replaced before it was
+// taken or grabbed while every slot is busy counts as dropped. A taken frame stays out of the ring until it is
+// returned, which lets the texture upload read it in place
+class OPENCVLIB_API FcvWebcamCapture : public FRunnable
+{
+public:
+	// Width, height and frame rate are requests to the driver, 0 keeps its defaults. RingSize is at least 3,
+	// one frame being written, one waiting and one taken
+	FcvWebcamCapture(int32 InDevice, int32 InWidth, int32 InHeight, double InFrameRate, int32 InRingSize);
+	~FcvWebcamCapture();
+
+	// The newest frame grabbed since the last call, INDEX_NONE when there is none. The frame is BGRA
+	// and stays valid until Return
+	int32 TakeLatest(const cv::Mat*& OutFrame, uint64& OutFrameNumber);
+	// From any thread, once the frame's pixels are no longer read
+	void Return(int32 Slot);
+
+	bool IsOpen() const { return bOpen; }
+	bool HasFailed() const { return bFailed; }
+	int32 GetGrabbedCount() const { return Grabbed.GetValue(); }
+	int32 GetDroppedCount() const { return Dropped.GetValue(); }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override { bStop = true; }
+
+private:
+	enum class ESlotState : uint8
+	{
+		Free,
+		Writing,
+		Ready,
+		Taken,
+	};
+
+	struct FSlot
+	{
+		cv::Mat Frame;
+		uint64 FrameNumber = 0;
+		ESlotState State = ESlotState::Free;
+	};
+
+	int32 Device;
+	int32 Width;
+	int32 Height;
+	double FrameRate;
+	int32 RingSize;
+
+	// Capture thread only
+	cv::VideoCapture Capture;
+	cv::Mat Retrieved;
+
+	FCriticalSection Lock;
+	TArray<FSlot> Slots;
+	int32 Latest = INDEX_NONE;
+
+	FThreadSafeCounter Grabbed;
+	FThreadSafeCounter Dropped;
+	FThreadSafeBool bOpen;
+	FThreadSafeBool bFailed;
+	FThreadSafeBool bStop;
+	FRunnableThread* Thread = nullptr;
+};
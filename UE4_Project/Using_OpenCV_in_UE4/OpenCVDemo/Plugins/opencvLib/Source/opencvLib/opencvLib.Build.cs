@@ -9,7 +9,10 @@ public class opencvLib : ModuleRules
 	{
         PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
 
-        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "RHI", "Engine", "ImageWrapper", "InputCore", "Projects"});
+        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "RHI", "Engine", "ImageWrapper", "InputCore", "Projects", "RenderCore", "opencvLibShaders"});
+
+        // OpenCV reports a missing D3D11 sharing device by throwing
+        bEnableExceptions = true;
 
         PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Include"));
 
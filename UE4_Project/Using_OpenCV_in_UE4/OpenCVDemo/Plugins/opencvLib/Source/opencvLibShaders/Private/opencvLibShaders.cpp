@@ -0,0 +1,27 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "opencvLibShaders.h"
+#include "cvShaders.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/Paths.h"
+#include "ShaderCore.h"
+
+#define LOCTEXT_NAMESPACE "FopencvLibShadersModule"
+
+IMPLEMENT_GLOBAL_SHADER(FcvStereoMatchCS, "/Plugin/opencvLib/Private/cvStereoMatch.usf", "MainCS", SF_Compute);
+IMPLEMENT_GLOBAL_SHADER(FcvRectifyCS, "/Plugin/opencvLib/Private/cvRectify.usf", "MainCS", SF_Compute);
+
+void FopencvLibShadersModule::StartupModule()
+{
+	// PostConfigInit, the engine compiles the global shaders after this
+	FString ShaderDirectory = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("opencvLib"))->GetBaseDir(), TEXT("Shaders"));
+	AddShaderSourceDirectoryMapping(TEXT("/Plugin/opencvLib"), ShaderDirectory);
+}
+
+void FopencvLibShadersModule::ShutdownModule()
+{
+}
+
+#undef LOCTEXT_NAMESPACE
+
+IMPLEMENT_MODULE(FopencvLibShadersModule, opencvLibShaders)
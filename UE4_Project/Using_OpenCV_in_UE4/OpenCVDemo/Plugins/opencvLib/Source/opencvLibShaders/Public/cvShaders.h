@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GlobalShader.h"
+#include "ShaderParameterStruct.h"
+
+// Block matching of the left capture against the right one, see cvStereoMatch.usf
+class OPENCVLIBSHADERS_API FcvStereoMatchCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FcvStereoMatchCS);
+	SHADER_USE_PARAMETER_STRUCT(FcvStereoMatchCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, LeftTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, RightTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, DepthTexture)
+		SHADER_PARAMETER_UAV(RWTexture2D<float>, DisparityOutput)
+		SHADER_PARAMETER_UAV(RWBuffer<uint>, ErrorOutput)
+		SHADER_PARAMETER(FIntPoint, TextureSize)
+		SHADER_PARAMETER(int32, NumDisparities)
+		SHADER_PARAMETER(float, FocalBaseline)
+		SHADER_PARAMETER(float, BadPixelThreshold)
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+// Remap of a capture through the rectification maps, see cvRectify.usf
+class OPENCVLIBSHADERS_API FcvRectifyCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FcvRectifyCS);
+	SHADER_USE_PARAMETER_STRUCT(FcvRectifyCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_TEXTURE(Texture2D<float4>, SourceTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D<uint2>, MapTexture)
+		SHADER_PARAMETER_TEXTURE(Texture2D<uint>, FractionTexture)
+		SHADER_PARAMETER_UAV(RWTexture2D<float4>, PackedOutput)
+		SHADER_PARAMETER(FIntPoint, SourceSize)
+		SHADER_PARAMETER(FIntPoint, OutputSize)
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
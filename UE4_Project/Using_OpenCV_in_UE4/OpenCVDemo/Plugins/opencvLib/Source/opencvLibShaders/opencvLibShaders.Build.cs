@@ -0,0 +1,15 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+// The global shaders and their source directory, loaded at PostConfigInit before the engine compiles global
+// shaders; everything with UObjects stays in opencvLib
+public class opencvLibShaders : ModuleRules
+{
+	public opencvLibShaders(ReadOnlyTargetRules Target) : base(Target)
+	{
+        PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+        PublicDependencyModuleNames.AddRange(new string[] { "Core", "RHI", "RenderCore", "Projects" });
+    }
+}